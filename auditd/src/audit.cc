@@ -81,6 +81,8 @@ AuditImpl::~AuditImpl() {
         // so we should kick it in the but as well to make sure that
         // it is let loose
         events_arrived.notify_all();
+        // and release the producers waiting for room in the queue
+        queue_drained.notify_all();
     }
 
     // Wait for the consumer thread to stop
@@ -345,10 +347,26 @@ bool AuditImpl::put_event(uint32_t event_id, std::string_view payload) {
     //       format (or missing fields)
     try {
         auto new_event = std::make_unique<Event>(event_id, payload);
-        std::lock_guard<std::mutex> guard(producer_consumer_lock);
-        if (filleventqueue.size() < max_audit_queue) {
+        std::unique_lock<std::mutex> lock(producer_consumer_lock);
+        const auto max_queue = config.get_max_queue_size();
+        if (filleventqueue.size() >= max_queue &&
+            config.is_block_when_full() && !stop_audit_consumer) {
+            // The consumer swaps out the entire queue every time it wakes
+            // up, so there is room for all of the waiting producers once
+            // it is notified
+            blocked_events++;
+            queue_drained.wait(lock, [this, max_queue]() {
+                return filleventqueue.size() < max_queue ||
+                       stop_audit_consumer;
+            });
+        }
+        if (filleventqueue.size() < max_queue) {
             filleventqueue.push(std::move(new_event));
-            events_arrived.notify_all();
+            // The consumer only waits for an empty queue, no need to wake
+            // it up for every event
+            if (filleventqueue.size() == 1) {
+                events_arrived.notify_all();
+            }
             return true;
         }
     } catch (const std::bad_alloc&) {
@@ -400,6 +418,16 @@ void AuditImpl::stats(const AddStatFn& add_stats,
     const auto* enabled = config.is_auditd_enabled() ? "true" : "false";
     add_stats("enabled"sv, enabled, cookie.get());
     add_stats("dropped_events"sv, std::to_string(dropped_events), cookie.get());
+    add_stats("blocked_events"sv, std::to_string(blocked_events), cookie.get());
+    add_stats("batches_written"sv,
+              std::to_string(batches_written),
+              cookie.get());
+    add_stats("max_queue_size"sv,
+              std::to_string(config.get_max_queue_size()),
+              cookie.get());
+    add_stats("block_when_full"sv,
+              config.is_block_when_full() ? "true" : "false",
+              cookie.get());
 }
 
 void AuditImpl::consume_events() {
@@ -427,7 +455,11 @@ void AuditImpl::consume_events() {
         processeventqueue.swap(filleventqueue);
         lock.unlock();
         // Now outside of the producer_consumer_lock
+        queue_drained.notify_all();
 
+        if (!processeventqueue.empty()) {
+            batches_written++;
+        }
         while (!processeventqueue.empty()) {
             auto& event = processeventqueue.front();
             if (!event->process(*this)) {
@@ -133,16 +133,22 @@ protected:
     std::queue<std::unique_ptr<Event>> processeventqueue;
     std::queue<std::unique_ptr<Event>> filleventqueue;
     std::condition_variable events_arrived;
+    /// Notified when the consumer swapped the queues (so there is room for
+    /// the producers blocked on a full queue)
+    std::condition_variable queue_drained;
     std::mutex producer_consumer_lock;
 
     /// The number of events currently dropped.
     std::atomic<uint32_t> dropped_events = {0};
 
+    /// The number of events which had to wait for room in the queue
+    std::atomic<uint64_t> blocked_events = {0};
+
+    /// The number of batches of events written by the consumer
+    std::atomic<uint64_t> batches_written = {0};
+
     ServerCookieIface* cookie_api;
 
     /// The hostname we want to inject to the audit events
     const std::string hostname;
-
-private:
-    const size_t max_audit_queue = 50000;
 };
@@ -36,6 +36,8 @@ AuditConfig::AuditConfig(const nlohmann::json& json) : AuditConfig() {
     set_rotate_interval(json.at("rotate_interval"));
     set_auditd_enabled(json.at("auditd_enabled"));
     set_buffered(json.value("buffered", true));
+    set_max_queue_size(json.value("max_queue_size", size_t(50000)));
+    set_block_when_full(json.value("block_when_full", false));
     set_log_directory(json.at("log_path"));
     set_descriptors_path(json.at("descriptors_path"));
     set_sync(json.at("sync"));
@@ -70,6 +72,8 @@ AuditConfig::AuditConfig(const nlohmann::json& json) : AuditConfig() {
     tags["rotate_interval"] = 1;
     tags["auditd_enabled"] = 1;
     tags["buffered"] = 1;
+    tags["max_queue_size"] = 1;
+    tags["block_when_full"] = 1;
     tags["log_path"] = 1;
     tags["descriptors_path"] = 1;
     tags["sync"] = 1;
@@ -141,6 +145,25 @@ bool AuditConfig::is_buffered() const {
     return buffered;
 }
 
+void AuditConfig::set_max_queue_size(size_t size) {
+    if (size == 0) {
+        throw std::string("error: max_queue_size must be greater than 0");
+    }
+    max_queue_size = size;
+}
+
+size_t AuditConfig::get_max_queue_size() const {
+    return max_queue_size;
+}
+
+void AuditConfig::set_block_when_full(bool enable) {
+    block_when_full = enable;
+}
+
+bool AuditConfig::is_block_when_full() const {
+    return block_when_full;
+}
+
 void AuditConfig::set_log_directory(const std::string &directory) {
     std::lock_guard<std::mutex> guard(log_path_mutex);
     /* Sanitize path */
@@ -375,6 +398,8 @@ nlohmann::json AuditConfig::to_json() const {
     ret["rotate_size"] = get_rotate_size();
     ret["rotate_interval"] = get_rotate_interval();
     ret["buffered"] = is_buffered();
+    ret["max_queue_size"] = get_max_queue_size();
+    ret["block_when_full"] = is_block_when_full();
     ret["log_path"] = get_log_directory();
     ret["descriptors_path"] = get_descriptors_path();
     ret["filtering_enabled"] = is_filtering_enabled();
@@ -426,6 +451,8 @@ void AuditConfig::initialize_config(const nlohmann::json& json) {
     rotate_interval = other.rotate_interval;
     rotate_size = other.rotate_size;
     buffered = other.buffered;
+    max_queue_size = other.max_queue_size;
+    block_when_full = other.block_when_full;
     filtering_enabled = other.filtering_enabled;
     {
         std::lock_guard<std::mutex> guard(log_path_mutex);
@@ -38,6 +38,8 @@ public:
         rotate_interval(900),
         rotate_size(20 * 1024 * 1024),
         buffered(true),
+        max_queue_size(50000),
+        block_when_full(false),
         filtering_enabled(false),
         version(0),
         uuid(""),
@@ -71,6 +73,10 @@ public:
     uint32_t get_rotate_interval() const;
     void set_buffered(bool enable);
     bool is_buffered() const;
+    void set_max_queue_size(size_t size);
+    size_t get_max_queue_size() const;
+    void set_block_when_full(bool enable);
+    bool is_block_when_full() const;
     void set_log_directory(const std::string &directory);
     std::string get_log_directory() const;
     void set_descriptors_path(const std::string &directory);
@@ -136,6 +142,11 @@ protected:
     cb::RelaxedAtomic<uint32_t> rotate_interval;
     cb::RelaxedAtomic<size_t> rotate_size;
     cb::RelaxedAtomic<bool> buffered;
+    /// The maximum number of events queued for the consumer thread
+    cb::RelaxedAtomic<size_t> max_queue_size;
+    /// Should put_event block (rather than drop the event) while the
+    /// queue is full
+    cb::RelaxedAtomic<bool> block_when_full;
     cb::RelaxedAtomic<bool> filtering_enabled;
     cb::RelaxedAtomic<uint32_t> version;
 
@@ -223,8 +223,12 @@ void AuditFile::cleanup_old_logfile(const std::string& log_path) {
 bool AuditFile::write_event_to_disk(nlohmann::json& output) {
     bool ret = true;
     try {
-        const auto content = output.dump();
-        current_size += fprintf(file.get(), "%s\n", content.c_str());
+        auto content = output.dump();
+        content.push_back('\n');
+        // The stream is buffered (and flushed by the consumer at the end of
+        // each batch of events unless running unbuffered)
+        current_size +=
+                fwrite(content.data(), 1, content.size(), file.get());
         if (ferror(file.get())) {
             LOG_WARNING("Audit: writing to disk error: {}", cb_strerror());
             ret = false;
@@ -262,6 +262,32 @@ TEST_F(AuditConfigTest, TestLegalBuffered) {
     EXPECT_NO_THROW(config.initialize_config(json));
 }
 
+// max_queue_size and block_when_full
+
+TEST_F(AuditConfigTest, TestNoQueuePolicy) {
+    // Both are optional, and default to drop the events past 50000
+    EXPECT_NO_THROW(config.initialize_config(json));
+    EXPECT_EQ(50000, config.get_max_queue_size());
+    EXPECT_FALSE(config.is_block_when_full());
+}
+
+TEST_F(AuditConfigTest, TestLegalQueuePolicy) {
+    json["max_queue_size"] = 10;
+    json["block_when_full"] = true;
+    EXPECT_NO_THROW(config.initialize_config(json));
+    EXPECT_EQ(10, config.get_max_queue_size());
+    EXPECT_TRUE(config.is_block_when_full());
+}
+
+TEST_F(AuditConfigTest, TestIllegalQueuePolicy) {
+    json["max_queue_size"] = 0;
+    EXPECT_THROW(config.initialize_config(json), std::string);
+
+    json["max_queue_size"] = 10;
+    json["block_when_full"] = "foobar";
+    EXPECT_THROW(config.initialize_config(json), nlohmann::json::exception);
+}
+
 // log_path
 
 TEST_F(AuditConfigTest, TestNoLogPath) {
@@ -151,6 +151,10 @@ public:
             const cb::mcbp::Request& request) override {
         throw std::runtime_error("get_inflated_payload not implemented");
     }
+    std::optional<std::chrono::steady_clock::time_point> get_deadline(
+            gsl::not_null<const void*> cookie) override {
+        throw std::runtime_error("get_deadline not implemented");
+    }
 };
 
 class AuditDaemonTest
@@ -0,0 +1,99 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "key_cache.h"
+
+namespace cb::sasl::mechanism::scram {
+
+KeyCache& KeyCache::instance() {
+    static KeyCache cache;
+    return cache;
+}
+
+void KeyCache::setCapacity(size_t value) {
+    std::lock_guard<std::mutex> guard(mutex);
+    capacity = value;
+    evict();
+}
+
+std::optional<Keys> KeyCache::lookup(Mechanism mechanism,
+                                     const std::string& username,
+                                     const std::string& saltedPassword) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (capacity == 0) {
+        return {};
+    }
+
+    auto iter = entries.find(makeKey(mechanism, username));
+    if (iter == entries.end() || iter->second.saltedPassword != saltedPassword) {
+        ++misses;
+        return {};
+    }
+
+    ++hits;
+    lru.splice(lru.begin(), lru, iter->second.lruPosition);
+    return iter->second.keys;
+}
+
+void KeyCache::insert(Mechanism mechanism,
+                      const std::string& username,
+                      const std::string& saltedPassword,
+                      Keys keys) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (capacity == 0) {
+        return;
+    }
+
+    auto key = makeKey(mechanism, username);
+    auto iter = entries.find(key);
+    if (iter == entries.end()) {
+        lru.push_front(key);
+        entries.emplace(std::move(key),
+                        Entry{saltedPassword, std::move(keys), lru.begin()});
+        evict();
+    } else {
+        iter->second.saltedPassword = saltedPassword;
+        iter->second.keys = std::move(keys);
+        lru.splice(lru.begin(), lru, iter->second.lruPosition);
+    }
+}
+
+cb::sasl::server::KeyCacheStats KeyCache::getStats() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return {capacity, entries.size(), hits, misses, evictions};
+}
+
+void KeyCache::clear() {
+    std::lock_guard<std::mutex> guard(mutex);
+    lru.clear();
+    entries.clear();
+}
+
+std::string KeyCache::makeKey(Mechanism mechanism,
+                              const std::string& username) {
+    // The mechanism is a number, so the first comma always terminates it
+    return std::to_string(int(mechanism)) + ',' + username;
+}
+
+void KeyCache::evict() {
+    while (entries.size() > capacity) {
+        entries.erase(lru.back());
+        lru.pop_back();
+        ++evictions;
+    }
+}
+
+} // namespace cb::sasl::mechanism::scram
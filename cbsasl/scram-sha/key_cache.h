@@ -0,0 +1,109 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <cbsasl/mechanism.h>
+#include <cbsasl/server.h>
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace cb::sasl::mechanism::scram {
+
+/**
+ * The keys derived from the salted password of a user (see RFC 5802):
+ *
+ * ClientKey := HMAC(SaltedPassword, "Client Key")
+ * StoredKey := H(ClientKey)
+ * ServerKey := HMAC(SaltedPassword, "Server Key")
+ */
+struct Keys {
+    std::string clientKey;
+    std::string storedKey;
+    std::string serverKey;
+};
+
+/**
+ * A bounded (least recently used) cache of the keys the server derived
+ * for the users who successfully authenticated, so that the clients
+ * reconnecting over and over (typically all of them at once after a
+ * node restart or network blip) don't need them derived over again.
+ *
+ * An entry is only used as long as the salted password it was derived
+ * from is the one in the password database, so a password change (or a
+ * new iteration count) invalidates it.
+ */
+class KeyCache {
+public:
+    static KeyCache& instance();
+
+    /// Set the maximum number of entries (0 disables the cache)
+    void setCapacity(size_t value);
+
+    /**
+     * Look up the keys for the user
+     *
+     * @param mechanism the SCRAM mechanism being used
+     * @param username the name of the user
+     * @param saltedPassword the current salted password of the user
+     * @return the keys if they're cached and derived from saltedPassword
+     */
+    std::optional<Keys> lookup(Mechanism mechanism,
+                               const std::string& username,
+                               const std::string& saltedPassword);
+
+    /// Add (or replace) the keys for the user, evicting the least recently
+    /// used entry if the cache is full
+    void insert(Mechanism mechanism,
+                const std::string& username,
+                const std::string& saltedPassword,
+                Keys keys);
+
+    cb::sasl::server::KeyCacheStats getStats() const;
+
+    void clear();
+
+protected:
+    struct Entry {
+        std::string saltedPassword;
+        Keys keys;
+        /// The position of the entry in the lru list
+        std::list<std::string>::iterator lruPosition;
+    };
+
+    static std::string makeKey(Mechanism mechanism,
+                               const std::string& username);
+
+    /// Evict the least recently used entries until there is at most
+    /// capacity entries left
+    void evict();
+
+    mutable std::mutex mutex;
+    size_t capacity = 0;
+    /// The keys of the cache, most recently used first
+    std::list<std::string> lru;
+    std::unordered_map<std::string, Entry> entries;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+} // namespace cb::sasl::mechanism::scram
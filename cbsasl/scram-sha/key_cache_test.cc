@@ -0,0 +1,82 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <cbsasl/scram-sha/key_cache.h>
+#include <folly/portability/GTest.h>
+
+using cb::sasl::Mechanism;
+using cb::sasl::mechanism::scram::KeyCache;
+using cb::sasl::mechanism::scram::Keys;
+
+class KeyCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        cache.setCapacity(2);
+    }
+
+    KeyCache cache;
+    const Keys keys{"client", "stored", "server"};
+};
+
+TEST_F(KeyCacheTest, Disabled) {
+    cache.setCapacity(0);
+    cache.insert(Mechanism::SCRAM_SHA512, "user", "salted", keys);
+    EXPECT_FALSE(cache.lookup(Mechanism::SCRAM_SHA512, "user", "salted"));
+    const auto stats = cache.getStats();
+    EXPECT_EQ(0, stats.size);
+    EXPECT_EQ(0, stats.misses);
+}
+
+TEST_F(KeyCacheTest, Lookup) {
+    EXPECT_FALSE(cache.lookup(Mechanism::SCRAM_SHA512, "user", "salted"));
+    cache.insert(Mechanism::SCRAM_SHA512, "user", "salted", keys);
+    auto cached = cache.lookup(Mechanism::SCRAM_SHA512, "user", "salted");
+    ASSERT_TRUE(cached);
+    EXPECT_EQ("client", cached->clientKey);
+    EXPECT_EQ("stored", cached->storedKey);
+    EXPECT_EQ("server", cached->serverKey);
+
+    // The entries are per mechanism
+    EXPECT_FALSE(cache.lookup(Mechanism::SCRAM_SHA1, "user", "salted"));
+
+    const auto stats = cache.getStats();
+    EXPECT_EQ(1, stats.size);
+    EXPECT_EQ(1, stats.hits);
+    EXPECT_EQ(2, stats.misses);
+}
+
+TEST_F(KeyCacheTest, PasswordChanged) {
+    cache.insert(Mechanism::SCRAM_SHA512, "user", "salted", keys);
+    EXPECT_FALSE(cache.lookup(Mechanism::SCRAM_SHA512, "user", "changed"));
+}
+
+TEST_F(KeyCacheTest, EvictLeastRecentlyUsed) {
+    cache.insert(Mechanism::SCRAM_SHA512, "a", "salted", keys);
+    cache.insert(Mechanism::SCRAM_SHA512, "b", "salted", keys);
+    // Make b the least recently used
+    EXPECT_TRUE(cache.lookup(Mechanism::SCRAM_SHA512, "a", "salted"));
+    cache.insert(Mechanism::SCRAM_SHA512, "c", "salted", keys);
+
+    EXPECT_TRUE(cache.lookup(Mechanism::SCRAM_SHA512, "a", "salted"));
+    EXPECT_FALSE(cache.lookup(Mechanism::SCRAM_SHA512, "b", "salted"));
+    EXPECT_TRUE(cache.lookup(Mechanism::SCRAM_SHA512, "c", "salted"));
+    EXPECT_EQ(1, cache.getStats().evictions);
+
+    // Shrinking the cache evicts the entries which no longer fit
+    cache.setCapacity(1);
+    EXPECT_EQ(1, cache.getStats().size);
+    EXPECT_TRUE(cache.lookup(Mechanism::SCRAM_SHA512, "c", "salted"));
+}
@@ -229,10 +229,7 @@ void ScramShaBackend::addAttribute(std::ostream& out,
  * ServerSignature := HMAC(ServerKey, AuthMessage)
  */
 std::string ScramShaBackend::getServerSignature() {
-    auto serverKey =
-            cb::crypto::HMAC(algorithm, getSaltedPassword(), "Server Key");
-
-    return cb::crypto::HMAC(algorithm, serverKey, getAuthMessage());
+    return cb::crypto::HMAC(algorithm, getKeys().serverKey, getAuthMessage());
 }
 
 /**
@@ -248,9 +245,8 @@ std::string ScramShaBackend::getServerSignature() {
  * ClientProof     := ClientKey XOR ClientSignature
  */
 std::string ScramShaBackend::getClientProof() {
-    auto clientKey =
-            cb::crypto::HMAC(algorithm, getSaltedPassword(), "Client Key");
-    auto storedKey = cb::crypto::digest(algorithm, clientKey);
+    const auto& clientKey = getKeys().clientKey;
+    const auto& storedKey = getKeys().storedKey;
     std::string authMessage = getAuthMessage();
     auto clientSignature = cb::crypto::HMAC(algorithm, storedKey, authMessage);
 
@@ -269,6 +265,20 @@ std::string ScramShaBackend::getClientProof() {
     return proof;
 }
 
+const Keys& ScramShaBackend::getKeys() {
+    if (!keys) {
+        const auto saltedPassword = getSaltedPassword();
+        Keys derived;
+        derived.clientKey =
+                cb::crypto::HMAC(algorithm, saltedPassword, "Client Key");
+        derived.storedKey = cb::crypto::digest(algorithm, derived.clientKey);
+        derived.serverKey =
+                cb::crypto::HMAC(algorithm, saltedPassword, "Server Key");
+        keys = std::move(derived);
+    }
+    return *keys;
+}
+
 /********************************************************************
  * Generic SHA Server API
  *******************************************************************/
@@ -384,6 +394,11 @@ std::pair<Error, std::string_view> ServerBackend::start(
     }
 
     const auto& passwordMeta = user.getPassword(mechanism);
+    if (!user.isDummy()) {
+        keys = KeyCache::instance().lookup(
+                mechanism, username, passwordMeta.getPassword());
+        cachedKeys = keys.has_value();
+    }
 
     nonce = clientNonce + std::string(serverNonce.data(), serverNonce.size());
 
@@ -458,6 +473,11 @@ std::pair<Error, std::string_view> ServerBackend::step(std::string_view input) {
         }
     }
 
+    if (!cachedKeys) {
+        KeyCache::instance().insert(
+                mechanism, username, getSaltedPassword(), getKeys());
+    }
+
     logging::log(&context, logging::Level::Trace, server_final_message);
     return std::make_pair<Error, std::string_view>(Error::OK,
                                                    server_final_message);
@@ -30,7 +30,9 @@
 #include <cbsasl/server.h>
 #include <array>
 #include <iostream>
+#include <optional>
 #include <vector>
+#include "cbsasl/scram-sha/key_cache.h"
 #include "cbsasl/user.h"
 
 namespace cb {
@@ -85,6 +87,10 @@ protected:
 
     virtual std::string getSaltedPassword() = 0;
 
+    /// Get the keys derived from the salted password (they're derived the
+    /// first time they're needed unless they're already set)
+    const Keys& getKeys();
+
     /**
      * Get the AUTH message (as specified in the RFC)
      */
@@ -101,6 +107,8 @@ protected:
     std::string serverNonce;
     std::string nonce;
 
+    std::optional<Keys> keys;
+
     Mechanism mechanism;
     const cb::crypto::Algorithm algorithm;
 };
@@ -122,6 +130,9 @@ protected:
     }
 
     pwdb::User user;
+
+    /// Set if the keys were found in the KeyCache
+    bool cachedKeys = false;
 };
 
 class Sha512ServerBackend : public ServerBackend {
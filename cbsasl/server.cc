@@ -20,6 +20,7 @@
 
 #include <cbsasl/logging.h>
 #include <cbsasl/plain/plain.h>
+#include <cbsasl/scram-sha/key_cache.h>
 #include <cbsasl/scram-sha/scram-sha.h>
 #include <cbsasl/server.h>
 
@@ -105,4 +106,12 @@ void set_scramsha_fallback_salt(const std::string& salt) {
     pwdb::UserFactory::setScramshaFallbackSalt(salt);
 }
 
+void set_scram_key_cache_size(size_t size) {
+    mechanism::scram::KeyCache::instance().setCapacity(size);
+}
+
+KeyCacheStats get_scram_key_cache_stats() {
+    return mechanism::scram::KeyCache::instance().getStats();
+}
+
 } // namespace cb::sasl::server
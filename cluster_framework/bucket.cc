@@ -22,6 +22,8 @@
 #include <platform/uuid.h>
 #include <protocol/connection/client_connection.h>
 #include <protocol/connection/client_mcbp_commands.h>
+#include <algorithm>
+#include <thread>
 #include <utility>
 
 namespace cb::test {
@@ -143,6 +145,144 @@ std::unique_ptr<MemcachedConnection> Bucket::getConnection(
     return cluster.getConnection(vbucketmap[vbucket.get()][replica_number + 1]);
 }
 
+std::unique_ptr<MemcachedConnection> Bucket::getBucketConnection(
+        size_t node) const {
+    auto conn = cluster.getConnection(node);
+    conn->authenticate("@admin", "password", "PLAIN");
+    conn->selectBucket(name);
+    return conn;
+}
+
+nlohmann::json Bucket::getTopology(size_t vbucket) const {
+    nlohmann::json chain = nlohmann::json::array();
+    for (int node : vbucketmap[vbucket]) {
+        if (node == -1) {
+            chain.emplace_back(nullptr);
+        } else {
+            chain.emplace_back("n_" + std::to_string(node));
+        }
+    }
+    return {{"topology", nlohmann::json::array({chain})}};
+}
+
+void Bucket::updateManifest() {
+    manifest["rev"] = manifest["rev"].get<int>() + 1;
+    manifest["vBucketServerMap"]["vBucketMap"] = vbucketmap;
+}
+
+/// Get the high seqno of the vbucket on the node the connection is to
+static uint64_t getHighSeqno(MemcachedConnection& conn, Vbid vbucket) {
+    const auto vb = std::to_string(vbucket.get());
+    const auto stats = conn.statsMap("vbucket-seqno " + vb);
+    const auto iter = stats.find("vb_" + vb + ":high_seqno");
+    if (iter == stats.end()) {
+        throw std::runtime_error("getHighSeqno: high_seqno missing for vb:" +
+                                 vb);
+    }
+    return std::stoull(iter->second);
+}
+
+void Bucket::moveActive(Vbid vbucket,
+                        size_t replica_number,
+                        std::chrono::milliseconds timeout) {
+    const auto vb = vbucket.get();
+    if (vb >= vbucketmap.size()) {
+        throw std::invalid_argument("Bucket::moveActive: Invalid vbucket");
+    }
+    if ((replica_number + 1) >= vbucketmap[vb].size() ||
+        vbucketmap[vb][replica_number + 1] == -1) {
+        throw std::invalid_argument(
+                "Bucket::moveActive: Invalid replica number");
+    }
+
+    const auto from = size_t(vbucketmap[vb][0]);
+    const auto to = size_t(vbucketmap[vb][replica_number + 1]);
+    auto active = getBucketConnection(from);
+    auto replica = getBucketConnection(to);
+
+    // Let the replica catch up before the active stops taking mutations
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (getHighSeqno(*replica, vbucket) < getHighSeqno(*active, vbucket)) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error(
+                    "Bucket::moveActive: Timed out waiting for the replica "
+                    "of " +
+                    vbucket.to_string() + " to catch up");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    active->setVbucket(vbucket, vbucket_state_dead, {});
+
+    const bool replicating = bool(replicators);
+    shutdownReplication();
+
+    std::swap(vbucketmap[vb][0], vbucketmap[vb][replica_number + 1]);
+    replica->setVbucket(vbucket, vbucket_state_active, getTopology(vb));
+    active->setVbucket(vbucket, vbucket_state_replica, {});
+    updateManifest();
+
+    if (replicating) {
+        setupReplication();
+    }
+}
+
+void Bucket::failover(size_t node) {
+    if (node >= cluster.size()) {
+        throw std::invalid_argument("Bucket::failover: Invalid node");
+    }
+
+    // Validate the whole map before touching anything
+    for (const auto& chain : vbucketmap) {
+        if (chain[0] == int(node) &&
+            std::none_of(chain.begin() + 1, chain.end(), [](int n) {
+                return n != -1;
+            })) {
+            throw std::invalid_argument(
+                    "Bucket::failover: n_" + std::to_string(node) +
+                    " holds the only copy of a vbucket");
+        }
+    }
+
+    const bool replicating = bool(replicators);
+    shutdownReplication();
+
+    auto failed = getBucketConnection(node);
+    std::vector<std::unique_ptr<MemcachedConnection>> connections(
+            cluster.size());
+    for (size_t vb = 0; vb < vbucketmap.size(); ++vb) {
+        auto& chain = vbucketmap[vb];
+        auto iter = std::find(chain.begin(), chain.end(), int(node));
+        if (iter == chain.end()) {
+            continue;
+        }
+        failed->setVbucket(Vbid(vb), vbucket_state_dead, {});
+
+        if (iter == chain.begin()) {
+            // Promote the first remaining replica (and keep the order of
+            // the rest of the chain)
+            auto replica = std::find_if(
+                    chain.begin() + 1, chain.end(), [](int n) {
+                        return n != -1;
+                    });
+            std::rotate(chain.begin(), replica, replica + 1);
+            iter = chain.begin() + 1;
+        }
+        *iter = -1;
+
+        // Update the topology (and state) of the active
+        auto& active = connections[chain[0]];
+        if (!active) {
+            active = getBucketConnection(chain[0]);
+        }
+        active->setVbucket(Vbid(vb), vbucket_state_active, getTopology(vb));
+    }
+    updateManifest();
+
+    if (replicating) {
+        setupReplication();
+    }
+}
+
 void Bucket::setCollectionManifest(nlohmann::json next) {
     const auto payload = next.dump(2);
     for (size_t idx = 0; idx < cluster.size(); ++idx) {
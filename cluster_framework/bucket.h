@@ -20,6 +20,7 @@
 
 #include <memcached/vbucket.h>
 #include <nlohmann/json.hpp>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
@@ -38,7 +39,10 @@ struct ReplicationConfig;
  * full vbucket map of the cluster, and a thread which runs all DCP
  * replication streams for that bucket.
  *
- * @todo add support for rebalance and moving vbuckets around
+ * The vbuckets may be moved around with moveActive() (the way a rebalance
+ * would move them) and failover(), which both recreate the replication
+ * streams to match the new vbucket map. Neither is safe to call while
+ * other threads use the vbucket map.
  */
 class Bucket {
 public:
@@ -81,7 +85,8 @@ public:
      *     vb  |   A   |   R   |   R   |   R   |
      *      #  | node# | node# | node# | node# |
      *
-     * The node# is the index into the clusters array of nodes.
+     * The node# is the index into the clusters array of nodes (or -1 if
+     * the replica is missing as the node it was on was failed over).
      *
      */
     const std::vector<std::vector<int>>& getVbucketMap() const {
@@ -129,6 +134,42 @@ public:
 
     void shutdownReplication();
 
+    /**
+     * Move the active copy of the vbucket to the node holding the given
+     * replica of it, and make the old active node hold that replica
+     * instead (the way a rebalance swaps the two).
+     *
+     * The move waits for the replica to catch up with the active, sets the
+     * old active to dead (so it stops accepting mutations), promotes the
+     * replica and then recreates the replication streams. Mutations
+     * accepted between the final catch up check and the old active being
+     * set to dead may not reach the new active.
+     *
+     * @param vbucket The vbucket to move
+     * @param replica_number The replica to promote
+     * @param timeout How long to wait for the replica to catch up
+     * @throws std::invalid_argument if the vbucket or the replica number is
+     *                               invalid (or the replica is missing)
+     * @throws std::runtime_error if the replica doesn't catch up in time
+     */
+    void moveActive(Vbid vbucket,
+                    size_t replica_number = 0,
+                    std::chrono::milliseconds timeout = std::chrono::seconds{
+                            30});
+
+    /**
+     * Fail over the node: every vbucket it holds the active copy of is
+     * promoted on the node holding its first remaining replica, the node
+     * is removed from all of the replication chains (its copies of the
+     * vbuckets are set to dead) and the replication streams are recreated.
+     * The node itself keeps running.
+     *
+     * @param node The node to fail over
+     * @throws std::invalid_argument if the node is invalid, or holds the
+     *                               only copy of a vbucket
+     */
+    void failover(size_t node);
+
     /// Set the connection manifest for the bucket (creates / deletes
     /// scopes and collections.
     void setCollectionManifest(nlohmann::json next);
@@ -139,6 +180,16 @@ public:
     }
 
 protected:
+    /// Get an authenticated connection to the node's bucket
+    std::unique_ptr<MemcachedConnection> getBucketConnection(
+            size_t node) const;
+
+    /// Get the topology for the vbucket (as passed to set vbucket state)
+    nlohmann::json getTopology(size_t vbucket) const;
+
+    /// Update the vbucket map in the manifest to the current one
+    void updateManifest();
+
     const Cluster& cluster;
     const std::string name;
     const std::string uuid;
@@ -169,6 +169,14 @@ std::shared_ptr<Bucket> ClusterImpl::createBucket(
                            {"max_num_shards", 4}};
 
     json.update(attributes);
+    // A null attribute removes the default setting
+    for (auto it = json.begin(); it != json.end();) {
+        if (it->is_null()) {
+            it = json.erase(it);
+        } else {
+            ++it;
+        }
+    }
 
     auto iter = json.find("max_vbuckets");
     if (iter != json.end()) {
@@ -47,7 +47,8 @@ public:
      *
      * @param name The name of the bucket to create
      * @param attributes A JSON object containing properties for the
-     *                   bucket.
+     *                   bucket (a null property removes the default
+     *                   setting of the property).
      * @param packet_filter An optional packet filter which is called for
      *                      with all of the packets going over the replication
      *                      streams for the bucket _before_ it is passed to
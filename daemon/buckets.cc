@@ -36,6 +36,7 @@ void Bucket::reset() {
         c.reset();
     }
     subjson_operation_times.reset();
+    subdocPathCache.clear();
     timings.reset();
     for (auto& s : stats) {
         s.reset();
@@ -60,6 +61,11 @@ void Bucket::destroyEngine(bool force) {
     engine.reset();
 }
 
+unique_engine_ptr Bucket::releaseEngine() {
+    bucketDcp = nullptr;
+    return std::move(engine);
+}
+
 void Bucket::setEngine(unique_engine_ptr engine_) {
     engine = std::move(engine_);
     bucketDcp = dynamic_cast<DcpIface*>(engine.get());
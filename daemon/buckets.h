@@ -19,6 +19,7 @@
 #include "bucket_type.h"
 #include "cluster_config.h"
 #include "mcbp_validators.h"
+#include "subdoc_path_cache.h"
 #include "timings.h"
 
 #include <memcached/engine.h>
@@ -71,6 +72,10 @@ public:
     /// Destroy the underlying engine
     void destroyEngine(bool force);
 
+    /// Take the underlying engine out of the bucket (so that it may be
+    /// destroyed once the bucket entry is reset)
+    unique_engine_ptr releaseEngine();
+
     /**
      * @returns the DCP interface for the connected bucket, or nullptr if the
      *          conencted bucket doesn't implement DCP.
@@ -126,6 +131,11 @@ public:
      */
     Hdr1sfMicroSecHistogram subjson_operation_times;
 
+    /**
+     * Locations of the values found by sub-document lookups
+     */
+    SubdocPathCache subdocPathCache;
+
     using ResponseCounter = cb::RelaxedAtomic<uint64_t>;
 
     /**
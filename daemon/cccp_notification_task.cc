@@ -20,9 +20,9 @@
 #include "connection.h"
 #include "log_macros.h"
 #include "memcached.h"
+#include "sendbuffer.h"
 #include "server_event.h"
 
-#include <mcbp/protocol/framebuilder.h>
 #include <memory>
 #include <string>
 
@@ -59,44 +59,33 @@ public:
     }
 
     bool execute(Connection& connection) override {
+        connection.setClustermapPushPending(false);
+
+        // Send the latest configuration (which may be newer than the one
+        // which caused this push to be queued). The frame is encoded once
+        // per revision and shared by all of the connections.
         auto& bucket = connection.getBucket();
-        auto payload = bucket.clusterConfiguration.getConfiguration();
-        if (payload.first < connection.getClustermapRevno()) {
-            // Ignore.. we've already sent a newer cluster config
+        auto notification =
+                bucket.clusterConfiguration.getNotification(bucket.name);
+        if (notification.first == ClusterConfiguration::NoConfiguration ||
+            notification.first <= connection.getClustermapRevno()) {
+            // Ignore.. we've already sent this (or a newer) cluster config
             return true;
         }
 
-        connection.setClustermapRevno(payload.first);
+        connection.setClustermapRevno(notification.first);
         LOG_INFO("{}: Sending Cluster map revision {}",
                  connection.getId(),
-                 payload.first);
-
-        std::string name = bucket.name;
-
-        using namespace cb::mcbp;
-        size_t needed = sizeof(Request) + // packet header
-                        4 + // rev number in extdata
-                        name.size() + // the name of the bucket
-                        payload.second->size(); // The actual payload
-        std::string buffer;
-        buffer.resize(needed);
-        RequestBuilder builder(buffer);
-        builder.setMagic(Magic::ServerRequest);
-        builder.setDatatype(cb::mcbp::Datatype::JSON);
-        builder.setOpcode(ServerOpcode::ClustermapChangeNotification);
-
-        // The extras contains the cluster revision number as an uint32_t
-        const uint32_t rev = htonl(payload.first);
-        builder.setExtras(
-                {reinterpret_cast<const uint8_t*>(&rev), sizeof(rev)});
-        builder.setKey(
-                {reinterpret_cast<const uint8_t*>(name.data()), name.size()});
-        builder.setValue(
-                {reinterpret_cast<const uint8_t*>(payload.second->data()),
-                 payload.second->size()});
+                 notification.first);
 
         // Inject our packet into the stream!
-        connection.copyToOutputStream(builder.getFrame()->getFrame());
+        if (notification.second->size() < SendBuffer::MinimumDataSize) {
+            connection.copyToOutputStream(*notification.second);
+        } else {
+            connection.chainDataToOutputStream(
+                    std::make_unique<SharedSendBuffer>(
+                            std::move(notification.second)));
+        }
         return true;
     }
 };
@@ -132,11 +121,21 @@ Task::Status CccpNotificationTask::execute() {
                 return;
             }
 
+            if (connection.isClustermapPushPending()) {
+                // The queued push sends the latest configuration
+                LOG_INFO("{}: Client is using {}. Push of {} coalesced",
+                         connection.getId(),
+                         connection.getClustermapRevno(),
+                         rev);
+                return;
+            }
+
             LOG_INFO("{}: Client is using {}. Push {}",
                      connection.getId(),
                      connection.getClustermapRevno(),
                      rev);
 
+            connection.setClustermapPushPending(true);
             connection.enqueueServerEvent(
                     std::make_unique<CccpPushNotificationServerEvent>());
             connection.signalIfIdle();
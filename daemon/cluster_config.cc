@@ -16,6 +16,8 @@
  */
 #include "cluster_config.h"
 
+#include <mcbp/protocol/framebuilder.h>
+#include <platform/socket.h>
 #include <subdoc/operations.h>
 
 #include <cstdlib>
@@ -25,6 +27,7 @@ void ClusterConfiguration::setConfiguration(std::string_view buffer, int rev) {
     std::lock_guard<std::mutex> guard(mutex);
     revision = rev;
     config = std::make_shared<std::string>(buffer.begin(), buffer.end());
+    notification.reset();
 }
 
 void ClusterConfiguration::setConfiguration(std::string_view buffer) {
@@ -38,6 +41,7 @@ void ClusterConfiguration::setConfiguration(std::string_view buffer) {
     std::lock_guard<std::mutex> guard(mutex);
     revision = rev;
     config = std::make_shared<std::string>(buffer.begin(), buffer.end());
+    notification.reset();
 }
 
 int ClusterConfiguration::getRevisionNumber(std::string_view buffer) {
@@ -70,4 +74,38 @@ void ClusterConfiguration::reset() {
     std::lock_guard<std::mutex> guard(mutex);
     revision = NoConfiguration;
     config = std::make_shared<std::string>();
+    notification.reset();
+}
+
+std::pair<int, std::shared_ptr<const std::string>>
+ClusterConfiguration::getNotification(std::string_view bucketName) const {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (revision == NoConfiguration) {
+        return {NoConfiguration, {}};
+    }
+
+    if (!notification) {
+        using namespace cb::mcbp;
+        auto buffer = std::make_shared<std::string>();
+        buffer->resize(sizeof(Request) + // packet header
+                       sizeof(uint32_t) + // rev number in extdata
+                       bucketName.size() + // the name of the bucket
+                       config->size()); // The actual payload
+        RequestBuilder builder(*buffer);
+        builder.setMagic(Magic::ServerRequest);
+        builder.setDatatype(cb::mcbp::Datatype::JSON);
+        builder.setOpcode(ServerOpcode::ClustermapChangeNotification);
+
+        // The extras contains the cluster revision number as an uint32_t
+        const uint32_t rev = htonl(revision);
+        builder.setExtras(
+                {reinterpret_cast<const uint8_t*>(&rev), sizeof(rev)});
+        builder.setKey({reinterpret_cast<const uint8_t*>(bucketName.data()),
+                        bucketName.size()});
+        builder.setValue({reinterpret_cast<const uint8_t*>(config->data()),
+                          config->size()});
+        notification = std::move(buffer);
+    }
+
+    return {revision, notification};
 }
@@ -20,6 +20,8 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <utility>
 
 /**
  * A class to hold a cluster configuration object for a given bucket.
@@ -58,6 +60,19 @@ public:
      */
     static int getRevisionNumber(std::string_view buffer);
 
+    /**
+     * Get the ClustermapChangeNotification frame for the current
+     * configuration. The frame is only encoded once per revision and
+     * shared by all of the connections the configuration is pushed to.
+     *
+     * @param bucketName The name of the bucket (the key of the frame)
+     * @return a pair where the first element is the revision number, and
+     *         the second element is the encoded frame (nullptr if no
+     *         configuration is set)
+     */
+    std::pair<int, std::shared_ptr<const std::string>> getNotification(
+            std::string_view bucketName) const;
+
     /**
      * Reset the ClusterConfig object to represent that no configuration
      * has been set.
@@ -83,4 +98,10 @@ protected:
      * Cached revision so we don't have to parse it every time
      */
     int revision;
+
+    /**
+     * The ClustermapChangeNotification frame for the current revision
+     * (built on demand, and dropped every time the configuration changes)
+     */
+    mutable std::shared_ptr<const std::string> notification;
 };
@@ -0,0 +1,87 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "command_trace_log.h"
+
+#include <memcached/isotime.h>
+#include <nlohmann/json.hpp>
+
+void CommandTraceLog::add(Record record) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (records.size() < Capacity) {
+        records.emplace_back(std::move(record));
+    } else {
+        records[next] = std::move(record);
+    }
+    next = (next + 1) % Capacity;
+}
+
+std::vector<CommandTraceLog::Record> CommandTraceLog::getRecords() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (records.size() < Capacity) {
+        return records;
+    }
+    // The log is full; the oldest record is the next to be replaced
+    std::vector<Record> ret;
+    ret.reserve(records.size());
+    ret.insert(ret.end(), records.begin() + next, records.end());
+    ret.insert(ret.end(), records.begin(), records.begin() + next);
+    return ret;
+}
+
+void CommandTraceLog::clear() {
+    std::lock_guard<std::mutex> guard(mutex);
+    records.clear();
+    next = 0;
+}
+
+nlohmann::json to_json(const CommandTraceLog::Record& record) {
+    using namespace std::chrono;
+    nlohmann::json ret;
+    const auto usec = duration_cast<microseconds>(
+                              record.timestamp.time_since_epoch())
+                              .count();
+    ret["timestamp"] = ISOTime::generatetimestamp(time_t(usec / 1000000),
+                                                  uint32_t(usec % 1000000));
+    try {
+        ret["opcode"] = to_string(record.opcode);
+    } catch (const std::exception&) {
+        ret["opcode"] = uint8_t(record.opcode);
+    }
+    ret["connection_id"] = record.connectionId;
+    ret["bucket"] = record.bucket;
+    ret["duration_us"] = record.duration.count();
+    ret["reason"] = record.slow ? "slow" : "sampled";
+
+    auto spans = nlohmann::json::array();
+    for (const auto& span : record.spans) {
+        nlohmann::json entry;
+        entry["name"] = to_string(span.code);
+        entry["start_us"] = duration_cast<microseconds>(
+                                    span.start - record.spans.front().start)
+                                    .count();
+        if (span.duration == cb::tracing::Span::Duration::max()) {
+            // the span wasn't ended
+            entry["duration_us"] = nullptr;
+        } else {
+            entry["duration_us"] = span.duration.count();
+        }
+        spans.push_back(entry);
+    }
+    ret["spans"] = spans;
+    return ret;
+}
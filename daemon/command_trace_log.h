@@ -0,0 +1,89 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <mcbp/protocol/opcode.h>
+#include <memcached/tracer.h>
+#include <nlohmann/json_fwd.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * A ring buffer of the traces (the spans recorded by the cb::tracing::Tracer
+ * of the cookie) of commands sampled by a front end thread: 1 in
+ * command_trace_sample_rate commands, and every command slower than the
+ * slow op threshold of its opcode.
+ *
+ * Each front end thread has its own log, so only the owning thread adds to
+ * it and the mutex is only contended when the traces are requested (by
+ * "stats command_traces").
+ */
+class CommandTraceLog {
+public:
+    struct Record {
+        /// When the command completed
+        std::chrono::system_clock::time_point timestamp;
+        cb::mcbp::ClientOpcode opcode;
+        uint32_t connectionId;
+        std::string bucket;
+        /// The total time spent executing the command
+        std::chrono::microseconds duration;
+        /// Was the command recorded as it was slow (or was it sampled)
+        bool slow;
+        std::vector<cb::tracing::Span> spans;
+    };
+
+    /// The number of records kept by each log
+    static const size_t Capacity = 64;
+
+    /// Add a record, replacing the oldest one if the log is full
+    void add(Record record);
+
+    /// Get a copy of the records in the log (oldest first)
+    std::vector<Record> getRecords() const;
+
+    void clear();
+
+private:
+    mutable std::mutex mutex;
+    std::vector<Record> records;
+    /// The index in records the next record is written to
+    size_t next = 0;
+};
+
+/**
+ * Get the JSON representation of a record:
+ *
+ *   {
+ *     "timestamp": "2020-04-04T18:17:04.123456Z",
+ *     "opcode": "GET",
+ *     "connection_id": 12,
+ *     "bucket": "default",
+ *     "duration_us": 5120,
+ *     "reason": "slow",
+ *     "spans": [
+ *       {"name": "request", "start_us": 0, "duration_us": 5120},
+ *       {"name": "bg.wait", "start_us": 12, "duration_us": 2010}, ...
+ *     ]
+ *   }
+ *
+ * The start of each span is relative to the first one (the request).
+ */
+nlohmann::json to_json(const CommandTraceLog::Record& record);
@@ -0,0 +1,70 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "command_trace_log.h"
+#include <folly/portability/GTest.h>
+#include <nlohmann/json.hpp>
+
+static CommandTraceLog::Record makeRecord(uint32_t id) {
+    const auto start = std::chrono::steady_clock::now();
+    return {std::chrono::system_clock::now(),
+            cb::mcbp::ClientOpcode::Get,
+            id,
+            "default",
+            std::chrono::microseconds(100),
+            false,
+            {{cb::tracing::Code::Request,
+              start,
+              cb::tracing::Span::Duration(100)},
+             {cb::tracing::Code::BackgroundWait,
+              start + std::chrono::microseconds(10),
+              cb::tracing::Span::Duration(50)}}};
+}
+
+TEST(CommandTraceLogTest, KeepsTheLatestRecords) {
+    CommandTraceLog log;
+    EXPECT_TRUE(log.getRecords().empty());
+
+    for (uint32_t ii = 0; ii < CommandTraceLog::Capacity + 10; ++ii) {
+        log.add(makeRecord(ii));
+    }
+
+    const auto records = log.getRecords();
+    ASSERT_EQ(CommandTraceLog::Capacity, records.size());
+    // Oldest first
+    for (size_t ii = 0; ii < records.size(); ++ii) {
+        EXPECT_EQ(ii + 10, records[ii].connectionId);
+    }
+
+    log.clear();
+    EXPECT_TRUE(log.getRecords().empty());
+}
+
+TEST(CommandTraceLogTest, ToJson) {
+    const auto json = to_json(makeRecord(12));
+    EXPECT_EQ("GET", json["opcode"]);
+    EXPECT_EQ(12, json["connection_id"]);
+    EXPECT_EQ("default", json["bucket"]);
+    EXPECT_EQ(100, json["duration_us"]);
+    EXPECT_EQ("sampled", json["reason"]);
+    ASSERT_EQ(2, json["spans"].size());
+    EXPECT_EQ("request", json["spans"][0]["name"]);
+    EXPECT_EQ(0, json["spans"][0]["start_us"]);
+    EXPECT_EQ("bg.wait", json["spans"][1]["name"]);
+    EXPECT_EQ(10, json["spans"][1]["start_us"]);
+    EXPECT_EQ(50, json["spans"][1]["duration_us"]);
+}
@@ -32,6 +32,7 @@
 #include "settings.h"
 #include "ssl_utils.h"
 #include "tracing.h"
+#include "workload_capture.h"
 
 #include <event2/bufferevent.h>
 #include <event2/bufferevent_ssl.h>
@@ -44,6 +45,7 @@
 #include <nlohmann/json.hpp>
 #include <phosphor/phosphor.h>
 #include <platform/checked_snprintf.h>
+#include <platform/compress.h>
 #include <platform/socket.h>
 #include <platform/strerror.h>
 #include <platform/string_hex.h>
@@ -51,10 +53,18 @@
 #include <utilities/logtags.h>
 #include <gsl/gsl>
 
+#include <algorithm>
 #include <exception>
 #ifndef WIN32
 #include <netinet/tcp.h> // For TCP_NODELAY etc
 #endif
+#ifdef __linux__
+#include <linux/errqueue.h> // For SO_EE_ORIGIN_ZEROCOPY
+#include <sys/socket.h>
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define HAVE_MSG_ZEROCOPY 1
+#endif
+#endif
 
 std::string to_string(Connection::Priority priority) {
     switch (priority) {
@@ -211,11 +221,33 @@ nlohmann::json Connection::toJSON() const {
     }
 
     ret["ssl"] = ssl;
+    ret["ktls"] = ktls;
     ret["total_recv"] = totalRecv;
     ret["total_send"] = totalSend;
+    ret["buffers"]["input_high_watermark"] = inputHighWatermark;
+    ret["buffers"]["output_high_watermark"] = outputHighWatermark;
+    ret["buffers"]["borrowed"] =
+            int(corkBuffer.capacity() != 0) + int(dcpBatch.capacity() != 0);
 
     ret["datatype"] = mcbp::datatype::to_string(datatypeFilter.getRaw());
 
+    if (dcpFrameCompression) {
+        auto& compression = ret["dcp_frame_compression"];
+        const auto& stats = dcpFrameCompressionStats;
+        compression["algorithm"] = "snappy";
+        compression["batches"] = stats.batches;
+        compression["uncompressed_bytes"] = stats.uncompressedBytes;
+        compression["compressed_bytes"] = stats.compressedBytes;
+        compression["ratio"] = stats.compressedBytes
+                                       ? double(stats.uncompressedBytes) /
+                                                 double(stats.compressedBytes)
+                                       : 0.0;
+        compression["time_usec"] =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        stats.time)
+                        .count();
+    }
+
     ret["sendqueue"]["size"] = sendQueueInfo.size;
     ret["sendqueue"]["last"] = sendQueueInfo.last.time_since_epoch().count();
     ret["sendqueue"]["term"] = sendQueueInfo.term;
@@ -423,6 +455,131 @@ void Connection::addCpuTime(std::chrono::nanoseconds ns) {
     max_sched_time = std::max(min_sched_time, ns);
 }
 
+/// @returns true if the opcode is one of the plain GET commands
+static bool isPrefetchableGet(cb::mcbp::ClientOpcode opcode) {
+    switch (opcode) {
+    case cb::mcbp::ClientOpcode::Get:
+    case cb::mcbp::ClientOpcode::Getq:
+    case cb::mcbp::ClientOpcode::Getk:
+    case cb::mcbp::ClientOpcode::Getkq:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// @returns true if the packet is a plain GET which may be pipelined on a
+///          connection which requires the responses in order
+static bool isPipelinableRead(const cb::mcbp::Header& header) {
+    // Commands with frame info may change the privilege context
+    return cb::mcbp::Magic(header.getMagic()) ==
+                   cb::mcbp::Magic::ClientRequest &&
+           isPrefetchableGet(header.getRequest().getClientOpcode());
+}
+
+bool Connection::mayPipelineOrderedRead() const {
+    if (allowUnorderedExecution() || isDCP() ||
+        !Settings::instance().isOrderedReadPipelining()) {
+        return false;
+    }
+    for (const auto& cookie : cookies) {
+        if (!cookie->empty() && !isPipelinableRead(cookie->getHeader())) {
+            return false;
+        }
+    }
+    return !isPacketAvailable() || isPipelinableRead(getPacket());
+}
+
+bool Connection::executeCookie(Cookie& cookie) {
+    if (!cookie.isHoldingResponses()) {
+        return cookie.execute();
+    }
+    heldOutput = cookie.getHeldResponses();
+    auto guard = gsl::finally([this] { heldOutput = nullptr; });
+    return cookie.execute();
+}
+
+bool Connection::flushHeldResponses() {
+    auto iter = cookies.begin();
+    while (iter != cookies.end()) {
+        auto& cookie = **iter;
+        if (!cookie.empty()) {
+            // This command is still in flight; everything after it must
+            // wait for it to complete
+            return std::any_of(iter, cookies.end(), [](const auto& c) {
+                return c->isHoldingResponses();
+            });
+        }
+        if (cookie.isHoldingResponses()) {
+            flushCorkBuffer();
+            cookie.releaseHeldResponses(*getOutputBuffer());
+            if (iter != cookies.begin() && !cookie.getRefcount()) {
+                iter = cookies.erase(iter);
+                continue;
+            }
+        }
+        ++iter;
+    }
+    return false;
+}
+
+void Connection::prefetchPipelinedGets(Cookie& cookie, size_t offset) {
+    const auto& blocked = cookie.getRequest();
+    if (!isPrefetchableGet(blocked.getClientOpcode())) {
+        return;
+    }
+    const auto collection = makeDocKey(blocked.getKey()).getCollectionID();
+
+    // Make a bounded window of the input buffer continuous once, so that
+    // the keys we collect stay valid until we've passed them to the engine
+    auto* input = bufferevent_get_input(bev.get());
+    const auto window = std::min(evbuffer_get_length(input),
+                                 offset + MaxPrefetchWindowSize);
+    const auto* data = evbuffer_pullup(input, window);
+    if (data == nullptr) {
+        return;
+    }
+
+    std::vector<std::pair<Vbid, DocKey>> keys;
+    while (keys.size() < MaxPrefetchKeys &&
+           offset + sizeof(cb::mcbp::Header) <= window) {
+        const auto& header =
+                *reinterpret_cast<const cb::mcbp::Header*>(data + offset);
+        if (!header.isValid() || !header.isRequest()) {
+            break;
+        }
+        const auto framesize = sizeof(header) + header.getBodylen();
+        if (offset + framesize > window) {
+            break;
+        }
+        const auto& req = header.getRequest();
+        // Stop at the first command which isn't a plain GET (we don't
+        // want to prefetch keys past a mutation of the same key). Commands
+        // with frame info may change the privilege context.
+        if (!isPrefetchableGet(req.getClientOpcode()) ||
+            req.getFramingExtraslen() != 0 || req.getKeylen() == 0 ||
+            size_t(req.getExtlen()) + req.getKeylen() > req.getBodylen()) {
+            break;
+        }
+        auto key = req.getKey();
+        if (isCollectionsSupported() &&
+            !cb::mcbp::unsigned_leb128<CollectionIDType>::decodeCanonical(
+                     key)
+                     .second.data()) {
+            break;
+        }
+        auto docKey = makeDocKey(key);
+        if (docKey.getCollectionID() == collection) {
+            keys.emplace_back(req.getVBucket(), docKey);
+        }
+        offset += framesize;
+    }
+
+    if (!keys.empty()) {
+        bucket_prefetch(cookie, keys);
+    }
+}
+
 void Connection::enqueueServerEvent(std::unique_ptr<ServerEvent> event) {
     server_events.push(std::move(event));
 }
@@ -496,15 +653,18 @@ bool Connection::processAllReadyCookies() {
             continue;
         }
 
-        if (active && !cookie->mayReorder()) {
+        if (active && !cookie->mayReorder() &&
+            !cookie->isHoldingResponses()) {
             // we've got active commands, and this command can't be
             // reordered... stop executing!
             break;
         }
 
-        if (cookie->execute()) {
-            // The command executed successfully
-            if (iter == cookies.begin() || cookie->getRefcount()) {
+        if (executeCookie(*cookie)) {
+            // The command executed successfully. If its responses are held
+            // the cookie must stay in the pipeline until they're flushed
+            if (iter == cookies.begin() || cookie->getRefcount() ||
+                cookie->isHoldingResponses()) {
                 cookie->reset();
                 ++iter;
             } else {
@@ -530,6 +690,9 @@ void Connection::executeCommandPipeline() {
             Settings::instance().getMaxConcurrentCommandsPerConnection();
 
     bool active = processAllReadyCookies();
+    if (flushHeldResponses()) {
+        active = true;
+    }
 
     // We might add more commands to the queue
     if (is_bucket_dying(*this)) {
@@ -538,29 +701,70 @@ void Connection::executeCommandPipeline() {
     }
 
     const auto maxSendQueueSize = Settings::instance().getMaxSendQueueSize();
-    if (!active || cookies.back()->mayReorder()) {
+    bool deferred = false;
+    if (!active || cookies.back()->mayReorder() || mayPipelineOrderedRead()) {
         // Only look at new commands if we don't have any active commands
-        // or the active command allows for reordering.
+        // or the active command allows for reordering (or we may pipeline
+        // reads behind it).
         auto input = bufferevent_get_input(bev.get());
+        inputHighWatermark =
+                std::max(inputHighWatermark, evbuffer_get_length(input));
         bool stop = (getSendQueueSize() >= maxSendQueueSize);
         while (!stop && cookies.size() < maxActiveCommands &&
                isPacketAvailable() && numEvents > 0) {
-            if (!cookies.back()->empty()) {
+            if (isDCP() && getPacket().isRequest()) {
+                const auto& request = getPacket().getRequest();
+                if (request.getMagic() == cb::mcbp::Magic::ClientRequest &&
+                    request.getClientOpcode() ==
+                            cb::mcbp::ClientOpcode::DcpCompressedFrames) {
+                    // The peer compressed a batch of messages; unpack them
+                    // in place and carry on executing them in order.
+                    expandDcpCompressedFrames();
+                    continue;
+                }
+            }
+
+            // If there are commands in flight on a connection which doesn't
+            // allow reordering we may only start a GET (and hold back its
+            // responses until the commands before it have completed)
+            const bool hold = active && !allowUnorderedExecution();
+            if (hold && !mayPipelineOrderedRead()) {
+                break;
+            }
+
+            if (shouldDeferMutation(getPacket())) {
+                deferred = true;
+                break;
+            }
+
+            if (!cookies.back()->empty() ||
+                cookies.back()->isHoldingResponses()) {
                 // Create a new entry if we can't reuse the last entry
                 cookies.emplace_back(std::make_unique<Cookie>(*this));
             }
 
             auto& cookie = *cookies.back();
             cookie.initialize(getPacket(), isTracingEnabled());
+            if (hold) {
+                cookie.holdResponses();
+            }
             auto drainSize = cookie.getPacket().size();
 
             const auto status = cookie.validate();
+            if (status == cb::mcbp::Status::Success &&
+                WorkloadCapture::instance().isEnabled() &&
+                cookie.getHeader().isRequest()) {
+                WorkloadCapture::instance().record(
+                        getThread(), getId(), cookie.getRequest());
+            }
             if (status == cb::mcbp::Status::Success) {
                 // We may only start execute the packet if:
                 //  * We don't have any ongoing commands
                 //  * We have an ongoing command and this command allows
                 //    for reorder
-                if ((!active || cookie.mayReorder()) && cookie.execute()) {
+                if ((!active || cookie.mayReorder() ||
+                     cookie.isHoldingResponses()) &&
+                    executeCookie(cookie)) {
                     // Command executed successfully, reset the cookie to allow
                     // it to be reused
                     cookie.reset();
@@ -572,16 +776,28 @@ void Connection::executeCommandPipeline() {
                     // We need to block so we need to preserve the request
                     // as we'll drain the data from the buffer)
                     cookie.preserveRequest();
-                    if (!cookie.mayReorder()) {
+                    if (!cookie.mayReorder() &&
+                        !(isPipelinableRead(cookie.getHeader()) &&
+                          mayPipelineOrderedRead())) {
                         // Don't add commands as we need the last one to
                         // complete
                         stop = true;
+                        if (cookie.isEwouldblock()) {
+                            prefetchPipelinedGets(cookie, drainSize);
+                        }
                     }
                 }
                 --numEvents;
             } else {
                 // Packet validation failed
-                cookie.sendResponse(status);
+                if (cookie.isHoldingResponses()) {
+                    heldOutput = cookie.getHeldResponses();
+                    auto guard =
+                            gsl::finally([this] { heldOutput = nullptr; });
+                    cookie.sendResponse(status);
+                } else {
+                    cookie.sendResponse(status);
+                }
                 cookie.reset();
             }
 
@@ -590,6 +806,7 @@ void Connection::executeCommandPipeline() {
                         "Connection::executeCommandsCallback(): Failed to "
                         "drain buffer");
             }
+            framedBytes -= std::min(framedBytes, drainSize);
 
             totalRecv += drainSize;
         }
@@ -609,9 +826,14 @@ void Connection::executeCommandPipeline() {
     // the thread to be run again if we've got a pending notification for
     // the thread (an active command running which is waiting for the engine)
     // If the last command in the pipeline may be reordered we can add more
-    if ((getSendQueueSize() < maxSendQueueSize) &&
-        (!active || (cookies.back()->mayReorder() &&
-                     cookies.size() < maxActiveCommands))) {
+    if (deferred) {
+        // Push back on the client until we retry the deferred mutation
+        disableReadEvent();
+        scheduleAdmissionRetry();
+    } else if ((getSendQueueSize() < maxSendQueueSize) &&
+               (!active ||
+                ((cookies.back()->mayReorder() || mayPipelineOrderedRead()) &&
+                 cookies.size() < maxActiveCommands))) {
         enableReadEvent();
         if ((!active || numEvents == 0) && isPacketAvailable()) {
             triggerCallback();
@@ -629,10 +851,15 @@ bool Connection::executeCommandsCallback() {
     const auto start = std::chrono::steady_clock::now();
 
     shutdownIfSendQueueStuck(start);
+    processZeroCopyCompletions();
     if (state == State::running) {
         try {
-            // continue to run the state machine
+            // continue to run the state machine (gathering the responses
+            // of the pipeline so that they are sent with a single write)
+            cork();
+            auto corkGuard = gsl::finally([this] { corked = false; });
             executeCommandPipeline();
+            uncork();
         } catch (const std::exception& e) {
             setTerminationReason(std::string("Received exception: ") + e.what());
             shutdown();
@@ -672,6 +899,8 @@ bool Connection::executeCommandsCallback() {
             const auto maxSendQueueSize =
                     Settings::instance().getMaxSendQueueSize();
             bool more = (getSendQueueSize() < maxSendQueueSize);
+            dcpBatching = true;
+            auto batchGuard = gsl::finally([this] { dcpBatching = false; });
             while (more) {
                 const auto ret = getBucket().getDcpIface()->step(
                         static_cast<const void*>(cookies.front().get()), this);
@@ -695,9 +924,28 @@ bool Connection::executeCommandsCallback() {
                     more = false;
                 }
             }
+            try {
+                flushDcpBatch();
+            } catch (const std::bad_alloc&) {
+                setTerminationReason("Failed to write DCP messages");
+                shutdown();
+            }
         }
     }
 
+    try {
+        // (anything left corked if the pipeline threw)
+        flushCorkBuffer();
+        flushTlsRecords(true);
+    } catch (const std::bad_alloc&) {
+        setTerminationReason("Failed to write TLS records");
+        shutdown();
+    }
+
+    if (bev) {
+        outputHighWatermark = std::max(outputHighWatermark, getSendQueueSize());
+    }
+
     const auto stop = std::chrono::steady_clock::now();
     const auto ns = duration_cast<nanoseconds>(stop - start);
     scheduler_info[getThread().index].add(duration_cast<microseconds>(ns));
@@ -717,17 +965,27 @@ bool Connection::executeCommandsCallback() {
             disassociate_bucket(*this);
 
             // Do the final cleanup of the connection:
-            thread.notification.remove(this);
+            thread->notification.remove(this);
             // remove from pending-io list
             {
-                std::lock_guard<std::mutex> lock(thread.pending_io.mutex);
-                thread.pending_io.map.erase(this);
+                std::lock_guard<std::mutex> lock(thread->pending_io.mutex);
+                thread->pending_io.map.erase(this);
             }
 
             // delete the object
             return false;
         }
     }
+
+    if (threadMigrationRequested && state == State::running) {
+        threadMigrationRequested = false;
+        if (migrateThread()) {
+            // The connection is owned by another thread now
+            return true;
+        }
+    }
+
+    scheduleZeroCopyPoll();
     return true;
 }
 
@@ -824,6 +1082,12 @@ void Connection::ssl_read_callback(bufferevent* bev, void* ctx) {
     auto& instance = *reinterpret_cast<Connection*>(ctx);
     // Lets inspect the certificate before we'll do anything further
     auto* ssl_st = bufferevent_openssl_get_ssl(bev);
+    auto& threadStats = *get_thread_stats(&instance);
+    if (SSL_session_reused(ssl_st)) {
+        ++threadStats.tls_resumed_handshakes;
+    } else {
+        ++threadStats.tls_full_handshakes;
+    }
     cb::openssl::unique_x509_ptr cert(SSL_get_peer_certificate(ssl_st));
     auto certResult = Settings::instance().lookupUser(cert.get());
     bool disconnect = false;
@@ -867,9 +1131,15 @@ void Connection::ssl_read_callback(bufferevent* bev, void* ctx) {
                     certResult.second);
         }
     } else {
-        LOG_INFO("{}: Using SSL cipher:{}",
+#ifdef BIO_get_ktls_send
+        instance.ktls = BIO_get_ktls_send(SSL_get_wbio(ssl_st)) != 0;
+#endif
+        LOG_INFO("{}: Using SSL cipher:{}{}",
                  instance.getId(),
-                 SSL_get_cipher_name(ssl_st));
+                 SSL_get_cipher_name(ssl_st),
+                 instance.ktls ? " (kTLS)" : "");
+        SSL_set_msg_callback(ssl_st, Connection::ssl_msg_callback);
+        SSL_set_msg_callback_arg(ssl_st, ctx);
     }
 
     // update the callback to call the normal read callback
@@ -883,6 +1153,30 @@ void Connection::ssl_read_callback(bufferevent* bev, void* ctx) {
     Connection::rw_callback(bev, ctx);
 }
 
+void Connection::ssl_msg_callback(int write_p,
+                                  int,
+                                  int content_type,
+                                  const void* buf,
+                                  size_t len,
+                                  SSL*,
+                                  void* arg) {
+    if (!write_p || content_type != SSL3_RT_HEADER ||
+        len < SSL3_RT_HEADER_LENGTH) {
+        return;
+    }
+    // The record header is type (1 byte), version (2 bytes) and the
+    // length of the record (2 bytes)
+    const auto* header = static_cast<const uint8_t*>(buf);
+    if (header[0] != SSL3_RT_APPLICATION_DATA) {
+        return;
+    }
+    const size_t size = (size_t(header[3]) << 8) | header[4];
+    auto& threadStats =
+            *get_thread_stats(reinterpret_cast<Connection*>(arg));
+    ++threadStats.tls_records_sent;
+    threadStats.tls_record_bytes += size;
+}
+
 void Connection::setAuthenticated(bool authenticated_) {
     Connection::authenticated = authenticated_;
     if (authenticated_) {
@@ -928,7 +1222,7 @@ void Connection::triggerCallback() {
 }
 
 bool Connection::dcpUseWriteBuffer(size_t size) const {
-    return isSslEnabled() && size < thread.scratch_buffer.size();
+    return isSslEnabled() && size < thread->scratch_buffer.size();
 }
 
 void Connection::copyToOutputStream(std::string_view data) {
@@ -936,13 +1230,215 @@ void Connection::copyToOutputStream(std::string_view data) {
         return;
     }
 
-    if (bufferevent_write(bev.get(), data.data(), data.size()) == -1) {
+    if (heldOutput) {
+        if (evbuffer_add(heldOutput, data.data(), data.size()) == -1) {
+            throw std::bad_alloc();
+        }
+        totalSend += data.size();
+        return;
+    }
+
+    if (corked) {
+        if (corkBuffer.size() + data.size() > CorkBufferSize) {
+            flushCorkBuffer();
+        }
+        if (data.size() <= CorkBufferSize) {
+            if (corkBuffer.capacity() == 0) {
+                corkBuffer = thread->bufferPool.borrow();
+            }
+            corkBuffer.insert(corkBuffer.end(), data.begin(), data.end());
+            totalSend += data.size();
+            return;
+        }
+    } else if (!corkBuffer.empty()) {
+        // The pipeline was left without uncorking (it threw); keep the
+        // order of the data on the wire.
+        flushCorkBuffer();
+    }
+
+    if (dcpBatching) {
+        if (dcpBatch.size() + data.size() > DcpBatchSize) {
+            flushDcpBatch();
+        }
+        if (data.size() <= DcpBatchSize) {
+            if (dcpBatch.capacity() == 0) {
+                dcpBatch = thread->bufferPool.borrow();
+            }
+            dcpBatch.insert(dcpBatch.end(), data.begin(), data.end());
+            totalSend += data.size();
+            return;
+        }
+    } else if (!dcpBatch.empty()) {
+        // The step loop was left without flushing (it threw); keep the
+        // order of the data on the wire.
+        flushDcpBatch();
+    }
+
+    if (evbuffer_add(getOutputBuffer(), data.data(), data.size()) == -1) {
         throw std::bad_alloc();
     }
+    flushTlsRecords(false);
 
     totalSend += data.size();
 }
 
+void Connection::flushDcpBatch() {
+    if (dcpBatch.empty()) {
+        return;
+    }
+
+    if (dcpFrameCompression && dcpBatch.size() >= DcpFrameCompressionMinSize &&
+        writeCompressedDcpBatch()) {
+        thread->bufferPool.release(dcpBatch);
+        return;
+    }
+
+    if (evbuffer_add(getOutputBuffer(), dcpBatch.data(), dcpBatch.size()) ==
+        -1) {
+        throw std::bad_alloc();
+    }
+    flushTlsRecords(false);
+    thread->bufferPool.release(dcpBatch);
+}
+
+void Connection::cork() {
+    corked = true;
+    corkedResponses = 0;
+}
+
+void Connection::uncork() {
+    corked = false;
+    flushCorkBuffer();
+    if (corkedResponses != 0) {
+        auto& threadStats = *get_thread_stats(this);
+        ++threadStats.response_sends;
+        threadStats.responses_sent += corkedResponses;
+        corkedResponses = 0;
+    }
+}
+
+void Connection::flushCorkBuffer() {
+    if (corkBuffer.empty()) {
+        return;
+    }
+
+    if (evbuffer_add(getOutputBuffer(), corkBuffer.data(), corkBuffer.size()) ==
+        -1) {
+        throw std::bad_alloc();
+    }
+    flushTlsRecords(false);
+    thread->bufferPool.release(corkBuffer);
+}
+
+evbuffer* Connection::getOutputBuffer() {
+    if (tlsOutput) {
+        return tlsOutput.get();
+    }
+    return bufferevent_get_output(bev.get());
+}
+
+void Connection::flushTlsRecords(bool partial) {
+    if (!tlsOutput) {
+        return;
+    }
+
+    auto* output = bufferevent_get_output(bev.get());
+    auto length = evbuffer_get_length(tlsOutput.get());
+    while (length >= TlsMaxRecordSize || (partial && length > 0)) {
+        auto chunk = std::min(length, TlsMaxRecordSize);
+        evbuffer_iovec vec{};
+        evbuffer_peek(tlsOutput.get(), -1, nullptr, &vec, 1);
+        if (vec.iov_len >= chunk) {
+            // Already contiguous (typically a value chained by reference);
+            // move the entire chain rather than copying it. OpenSSL splits
+            // it into full records.
+            chunk = vec.iov_len;
+        } else if (evbuffer_pullup(tlsOutput.get(), chunk) == nullptr) {
+            throw std::bad_alloc();
+        }
+        if (evbuffer_remove_buffer(tlsOutput.get(), output, chunk) !=
+            int(chunk)) {
+            throw std::bad_alloc();
+        }
+        length -= chunk;
+    }
+}
+
+bool Connection::writeCompressedDcpBatch() {
+    const auto start = std::chrono::steady_clock::now();
+    cb::compression::Buffer deflated;
+    const bool success =
+            cb::compression::deflate(cb::compression::Algorithm::Snappy,
+                                     {dcpBatch.data(), dcpBatch.size()},
+                                     deflated);
+    dcpFrameCompressionStats.time += std::chrono::steady_clock::now() - start;
+
+    const auto frameSize = sizeof(cb::mcbp::Request) + deflated.size();
+    if (!success || frameSize >= dcpBatch.size()) {
+        return false;
+    }
+
+    cb::mcbp::Request req = {};
+    req.setMagic(cb::mcbp::Magic::ClientRequest);
+    req.setOpcode(cb::mcbp::ClientOpcode::DcpCompressedFrames);
+    req.setBodylen(gsl::narrow<uint32_t>(deflated.size()));
+    req.setDatatype(cb::mcbp::Datatype::Snappy);
+
+    auto* output = getOutputBuffer();
+    if (evbuffer_add(output, &req, sizeof(req)) == -1 ||
+        evbuffer_add(output, deflated.data(), deflated.size()) == -1) {
+        throw std::bad_alloc();
+    }
+    flushTlsRecords(false);
+
+    // totalSend was incremented as the messages were staged
+    totalSend -= dcpBatch.size();
+    totalSend += frameSize;
+    ++dcpFrameCompressionStats.batches;
+    dcpFrameCompressionStats.uncompressedBytes += dcpBatch.size();
+    dcpFrameCompressionStats.compressedBytes += frameSize;
+    return true;
+}
+
+void Connection::expandDcpCompressedFrames() {
+    const auto& req = getPacket().getRequest();
+    if (req.getExtlen() != 0 || req.getKeylen() != 0 ||
+        !mcbp::datatype::is_snappy(uint8_t(req.getDatatype()))) {
+        audit_invalid_packet(*this, getAvailableBytes());
+        throw std::runtime_error(
+                "Connection::expandDcpCompressedFrames(): Invalid packet");
+    }
+
+    const auto value = req.getValue();
+    const std::string_view compressed{
+            reinterpret_cast<const char*>(value.data()), value.size()};
+    const auto maxSize = Settings::instance().getMaxPacketSize();
+    cb::compression::Buffer inflated;
+    if (cb::compression::get_uncompressed_length(
+                cb::compression::Algorithm::Snappy, compressed) > maxSize ||
+        !cb::compression::inflate(
+                cb::compression::Algorithm::Snappy, compressed, inflated)) {
+        throw std::runtime_error(
+                "Connection::expandDcpCompressedFrames(): Failed to inflate "
+                "frames");
+    }
+
+    // The packets are replaced with the ones in the frame
+    framedBytes = 0;
+    auto* input = bufferevent_get_input(bev.get());
+    const auto packetSize = sizeof(cb::mcbp::Request) + req.getBodylen();
+    if (evbuffer_drain(input, packetSize) == -1) {
+        throw std::runtime_error(
+                "Connection::expandDcpCompressedFrames(): Failed to drain "
+                "buffer");
+    }
+    totalRecv += packetSize;
+
+    if (evbuffer_prepend(input, inflated.data(), inflated.size()) == -1) {
+        throw std::bad_alloc();
+    }
+}
+
 static void sendbuffer_cleanup_cb(const void*, size_t, void* extra) {
     delete reinterpret_cast<SendBuffer*>(extra);
 }
@@ -953,8 +1449,19 @@ void Connection::chainDataToOutputStream(std::unique_ptr<SendBuffer> buffer) {
                 "McbpConnection::chainDataToOutputStream: buffer must be set");
     }
 
+    auto* output = heldOutput;
+    if (!output) {
+        flushCorkBuffer();
+        flushDcpBatch();
+
+        if (trySendZeroCopy(buffer)) {
+            return;
+        }
+        output = getOutputBuffer();
+    }
+
     auto data = buffer->getPayload();
-    if (evbuffer_add_reference(bufferevent_get_output(bev.get()),
+    if (evbuffer_add_reference(output,
                                data.data(),
                                data.size(),
                                sendbuffer_cleanup_cb,
@@ -967,13 +1474,239 @@ void Connection::chainDataToOutputStream(std::unique_ptr<SendBuffer> buffer) {
     // Move the ownership of the buffer!
     (void)buffer.release();
     totalSend += data.size();
+    flushTlsRecords(false);
+}
+
+static void shared_sendbuffer_cleanup_cb(const void*, size_t, void* extra) {
+    delete reinterpret_cast<std::shared_ptr<SendBuffer>*>(extra);
+}
+
+bool Connection::trySendZeroCopy(std::unique_ptr<SendBuffer>& buffer) {
+#ifdef HAVE_MSG_ZEROCOPY
+    const auto threshold = Settings::instance().getZeroCopySendThreshold();
+    auto payload = buffer->getPayload();
+    if (threshold == 0 || payload.size() < threshold || isSslEnabled()) {
+        return false;
+    }
+
+    auto& threadStats = *get_thread_stats(this);
+    if (zeroCopyState == ZeroCopyState::Unknown) {
+        const int enable = 1;
+        if (cb::net::setsockopt(socketDescriptor,
+                                SOL_SOCKET,
+                                SO_ZEROCOPY,
+                                reinterpret_cast<const void*>(&enable),
+                                sizeof(enable)) == 0) {
+            zeroCopyState = ZeroCopyState::Enabled;
+            zeroCopyTimer.reset(
+                    event_new(base, -1, 0, zerocopy_timer_callback, this));
+        } else {
+            LOG_DEBUG("{}: setsockopt(SO_ZEROCOPY) failed: {}",
+                      getId(),
+                      cb_strerror(cb::net::get_socket_error()));
+            zeroCopyState = ZeroCopyState::Unsupported;
+        }
+    }
+
+    if (zeroCopyState != ZeroCopyState::Enabled || !zeroCopyTimer) {
+        ++threadStats.zero_copy_fallbacks;
+        return false;
+    }
+
+    // The payload must follow whatever is already in the output stream
+    // (at least the response header) on the wire, so we may only bypass
+    // libevent if we manage to flush all of it to the socket.
+    auto* output = bufferevent_get_output(bev.get());
+    while (evbuffer_get_length(output) != 0) {
+        if (evbuffer_write(output, socketDescriptor) <= 0) {
+            ++threadStats.zero_copy_fallbacks;
+            return false;
+        }
+    }
+
+    iovec iov{const_cast<char*>(payload.data()), payload.size()};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    const auto nw =
+            ::sendmsg(socketDescriptor, &msg, MSG_ZEROCOPY | MSG_DONTWAIT);
+    if (nw <= 0) {
+        // EAGAIN (socket buffer full), ENOBUFS (exceeded the optmem limit
+        // for pinned pages) or a socket error; let libevent deal with it
+        ++threadStats.zero_copy_fallbacks;
+        return false;
+    }
+
+    // Every successful send is assigned the next id by the kernel
+    std::shared_ptr<SendBuffer> shared(std::move(buffer));
+    zeroCopySends.push_back(
+            {zeroCopyNextId++, shared, std::chrono::steady_clock::now()});
+    threadStats.zero_copy_bytes += nw;
+    totalSend += payload.size();
+
+    if (size_t(nw) < payload.size()) {
+        // The socket buffer filled up; leave the rest for libevent
+        auto remainder = payload.substr(nw);
+        auto* ref = new std::shared_ptr<SendBuffer>(shared);
+        if (evbuffer_add_reference(output,
+                                   remainder.data(),
+                                   remainder.size(),
+                                   shared_sendbuffer_cleanup_cb,
+                                   ref) == -1) {
+            delete ref;
+            throw std::bad_alloc();
+        }
+    }
+
+    scheduleZeroCopyPoll();
+    return true;
+#else
+    (void)buffer;
+    return false;
+#endif
+}
+
+void Connection::processZeroCopyCompletions() {
+#ifdef HAVE_MSG_ZEROCOPY
+    auto& threadStats = *get_thread_stats(this);
+    while (!zeroCopySends.empty()) {
+        std::array<char, 128> control;
+        msghdr msg{};
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        if (::recvmsg(socketDescriptor, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) ==
+            -1) {
+            // Nothing (more) in the error queue
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!(cmsg->cmsg_level == SOL_IP &&
+                  cmsg->cmsg_type == IP_RECVERR) &&
+                !(cmsg->cmsg_level == SOL_IPV6 &&
+                  cmsg->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+            const auto* err =
+                    reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+            if (err->ee_errno != 0 ||
+                err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+
+            if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                // The kernel had to copy the data anyway (e.g. over
+                // loopback) so there is no point in continuing to pay for
+                // the notifications
+                zeroCopyState = ZeroCopyState::Unsupported;
+            }
+
+            // The notification covers the (inclusive and possibly wrapped)
+            // range of ids [ee_info, ee_data]. Completions are normally
+            // reported in order, but that isn't guaranteed.
+            const uint32_t lo = err->ee_info;
+            const uint32_t hi = err->ee_data;
+            auto iter = zeroCopySends.begin();
+            while (iter != zeroCopySends.end()) {
+                if (iter->id - lo <= hi - lo) {
+                    ++threadStats.zero_copy_completions;
+                    threadStats.zero_copy_completion_us +=
+                            std::chrono::duration_cast<
+                                    std::chrono::microseconds>(now -
+                                                               iter->start)
+                                    .count();
+                    iter = zeroCopySends.erase(iter);
+                } else {
+                    ++iter;
+                }
+            }
+        }
+    }
+#endif
+}
+
+void Connection::scheduleZeroCopyPoll() {
+    if (zeroCopySends.empty() || !zeroCopyTimer) {
+        return;
+    }
+    // Completions arrive once the client acked the data; poll often
+    // enough that we don't hold on to the items for much longer than that
+    struct timeval tv = {0, 1000};
+    event_add(zeroCopyTimer.get(), &tv);
+}
+
+void Connection::zerocopy_timer_callback(evutil_socket_t, short, void* ctx) {
+    // Run the connection so that it picks up the completions (and may
+    // complete the shutdown if it's waiting for them)
+    reinterpret_cast<Connection*>(ctx)->triggerCallback();
+}
+
+bool Connection::shouldDeferMutation(const cb::mcbp::Header& header) {
+    const auto maxDelay = Settings::instance().getMutationAdmissionMaxDelay();
+    if (maxDelay.count() == 0 || isDCP() || !header.isRequest() ||
+        !cb::mcbp::is_client_magic(header.getRequest().getMagic())) {
+        admissionDeferredSince.reset();
+        return false;
+    }
+
+    using cb::mcbp::ClientOpcode;
+    switch (header.getRequest().getClientOpcode()) {
+    case ClientOpcode::Set:
+    case ClientOpcode::Setq:
+    case ClientOpcode::Add:
+    case ClientOpcode::Addq:
+    case ClientOpcode::Replace:
+    case ClientOpcode::Replaceq:
+    case ClientOpcode::Append:
+    case ClientOpcode::Appendq:
+    case ClientOpcode::Prepend:
+    case ClientOpcode::Prependq:
+        break;
+    default:
+        admissionDeferredSince.reset();
+        return false;
+    }
+
+    if (!getBucketEngine().isUnderMemoryPressure()) {
+        admissionDeferredSince.reset();
+        return false;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!admissionDeferredSince) {
+        admissionDeferredSince = now;
+        get_thread_stats(this)->mutations_deferred++;
+    } else if (now - *admissionDeferredSince >= maxDelay) {
+        // Give up waiting; the engine decides what to do with it
+        admissionDeferredSince.reset();
+        return false;
+    }
+    return true;
+}
+
+void Connection::scheduleAdmissionRetry() {
+    if (!admissionTimer) {
+        admissionTimer.reset(
+                event_new(base, -1, 0, admission_timer_callback, this));
+    }
+    // The engine frees memory in the background; check again shortly
+    struct timeval tv = {0, 1000};
+    event_add(admissionTimer.get(), &tv);
+}
+
+void Connection::admission_timer_callback(evutil_socket_t,
+                                          short,
+                                          void* ctx) {
+    reinterpret_cast<Connection*>(ctx)->triggerCallback();
 }
 
 Connection::Connection(FrontEndThread& thr)
     : socketDescriptor(INVALID_SOCKET),
       connectedToSystemPort(false),
       base(nullptr),
-      thread(thr),
+      thread(&thr),
       peername("unknown"),
       sockname("unknown"),
       max_reqs_per_event(Settings::instance().getRequestsPerEventNotification(
@@ -992,7 +1725,7 @@ Connection::Connection(SOCKET sfd,
     : socketDescriptor(sfd),
       connectedToSystemPort(ifc.system),
       base(b),
-      thread(thr),
+      thread(&thr),
       parent_port(ifc.port),
       peername(cb::net::getpeername(socketDescriptor)),
       sockname(cb::net::getsockname(socketDescriptor)),
@@ -1013,6 +1746,10 @@ Connection::Connection(SOCKET sfd,
                 createSslStructure(ifc).release(),
                 BUFFEREVENT_SSL_ACCEPTING,
                 options));
+        tlsOutput.reset(evbuffer_new());
+        if (!tlsOutput) {
+            throw std::bad_alloc();
+        }
         bufferevent_setcb(bev.get(),
                           Connection::ssl_read_callback,
                           Connection::rw_callback,
@@ -1027,10 +1764,126 @@ Connection::Connection(SOCKET sfd,
                           static_cast<void*>(this));
     }
 
-    bufferevent_enable(bev.get(), EV_READ);
+    configureBufferevent();
     stats.conn_structs++;
 }
 
+void Connection::configureBufferevent() {
+    // Read (and write) more than libevent's default of 16k per system
+    // call, and into fewer evbuffer chains (so that fewer of the packets
+    // in the input span two chains and need to be copied to be made
+    // contiguous)
+    const auto ioSize = Settings::instance().getNetworkIoSize();
+    if (ioSize != 0) {
+        bufferevent_set_max_single_read(bev.get(), ioSize);
+        bufferevent_set_max_single_write(bev.get(), ioSize);
+    }
+
+    bufferevent_enable(bev.get(), EV_READ);
+}
+
+bool Connection::migrateThread() {
+    auto* target = select_bucket_thread(*this);
+    if (target == nullptr) {
+        return false;
+    }
+
+    // Only move idle connections (with nothing but the data buffered in
+    // libevent tied to this thread). The TLS state lives in the
+    // bufferevent, so TLS connections stay where they are.
+    if (ssl || isDCP() || cookies.size() != 1 || !cookies.front()->empty() ||
+        !zeroCopySends.empty() || refcount > 1) {
+        return false;
+    }
+
+    migratedInput.reset(evbuffer_new());
+    migratedOutput.reset(evbuffer_new());
+    if (!migratedInput || !migratedOutput) {
+        migratedInput.reset();
+        migratedOutput.reset();
+        return false;
+    }
+
+    get_thread_stats(this)->conn_migrations++;
+    LOG_DEBUG("{}: Moving connection from thread {} to thread {}",
+              getId(),
+              thread->index,
+              target->index);
+
+    try {
+        target->migrations.push(this, [this, target]() {
+            evbuffer_add_buffer(migratedInput.get(),
+                                bufferevent_get_input(bev.get()));
+            evbuffer_add_buffer(migratedOutput.get(),
+                                bufferevent_get_output(bev.get()));
+            // Release the bufferevent without closing the socket
+            bufferevent_setfd(bev.get(), INVALID_SOCKET);
+            bev.reset();
+            zeroCopyTimer.reset();
+            admissionTimer.reset();
+            framedBytes = 0;
+            reservedFrameSize = 0;
+
+            thread->notification.remove(this);
+            {
+                std::lock_guard<std::mutex> lock(thread->pending_io.mutex);
+                thread->pending_io.map.erase(this);
+            }
+            thread->bufferPool.release(corkBuffer);
+            thread->bufferPool.release(dcpBatch);
+
+            with_connections_locked([this, target]() {
+                thread = target;
+                base = target->base;
+            });
+        });
+    } catch (const std::bad_alloc&) {
+        migratedInput.reset();
+        migratedOutput.reset();
+        return false;
+    }
+
+    notify_thread(*target);
+    return true;
+}
+
+bool Connection::attachToThread() {
+    const auto options = BEV_OPT_THREADSAFE | BEV_OPT_UNLOCK_CALLBACKS |
+                         BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS;
+    bev.reset(bufferevent_socket_new(base, socketDescriptor, options));
+    if (!bev) {
+        LOG_WARNING("{}: Failed to attach connection to thread {}",
+                    getId(),
+                    thread->index);
+        safe_close(socketDescriptor);
+        stats.curr_conns.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    bufferevent_setcb(bev.get(),
+                      Connection::rw_callback,
+                      Connection::rw_callback,
+                      Connection::event_callback,
+                      static_cast<void*>(this));
+
+    evbuffer_add_buffer(bufferevent_get_output(bev.get()),
+                        migratedOutput.get());
+    auto* input = bufferevent_get_input(bev.get());
+    evbuffer_add_buffer(input, migratedInput.get());
+    migratedInput.reset();
+    migratedOutput.reset();
+    if (zeroCopyState == ZeroCopyState::Enabled) {
+        zeroCopyTimer.reset(
+                event_new(base, -1, 0, zerocopy_timer_callback, this));
+    }
+    configureBufferevent();
+
+    // Run the commands the client pipelined behind the bucket selection
+    if (evbuffer_get_length(input) != 0) {
+        triggerCallback();
+    }
+    return true;
+}
+
 Connection::~Connection() {
     cb::audit::addSessionTerminated(*this);
 
@@ -1046,6 +1899,8 @@ Connection::~Connection() {
         stats.curr_conns.fetch_sub(1, std::memory_order_relaxed);
     }
 
+    thread->bufferPool.release(corkBuffer);
+    thread->bufferPool.release(dcpBatch);
     --stats.conn_structs;
 }
 
@@ -1083,6 +1938,10 @@ size_t Connection::getNumberOfCookies() const {
 }
 
 bool Connection::isPacketAvailable() const {
+    if (framedBytes != 0) {
+        return true;
+    }
+
     auto* event = bev.get();
     auto* input = bufferevent_get_input(event);
     auto size = evbuffer_get_length(input);
@@ -1108,6 +1967,7 @@ bool Connection::isPacketAvailable() const {
 
     const auto framesize = sizeof(*header) + header->getBodylen();
     if (size >= framesize) {
+        reservedFrameSize = 0;
         // We've got the entire buffer available.. make sure it is continuous
         if (evbuffer_pullup(input, framesize) == nullptr) {
             throw std::runtime_error(
@@ -1115,6 +1975,14 @@ bool Connection::isPacketAvailable() const {
                     "event input buffer: " +
                     std::to_string(framesize));
         }
+
+        // Frame the packets following it in the same chunk of the buffer
+        // (which are continuous in memory as well) while they're in the
+        // CPU cache
+        const auto contiguous = evbuffer_get_contiguous_space(input);
+        const auto* data = evbuffer_pullup(input, contiguous);
+        framedBytes = framesize + scanPackets(data + framesize,
+                                              contiguous - framesize);
         return true;
     }
 
@@ -1128,9 +1996,51 @@ bool Connection::isPacketAvailable() const {
                 std::to_string(Settings::instance().getMaxPacketSize()));
     }
 
+    if (framesize >= MinReservedFrameSize && reservedFrameSize != framesize) {
+        reserveInputFrame(input, size, framesize);
+    }
+
     return false;
 }
 
+void Connection::reserveInputFrame(evbuffer* input,
+                                   size_t size,
+                                   size_t framesize) const {
+    // The rest of the frame would otherwise be read into chunks the size
+    // of a read, which evbuffer_pullup() copies into a new chunk (of the
+    // size of the frame) once the frame is complete. Move the (small) part
+    // we've got into a chunk big enough for the entire frame instead, so
+    // that it is read into place and the value is only copied out of the
+    // input buffer once (into the item it is stored in)
+    std::vector<uint8_t> partial(size);
+    if (evbuffer_remove(input, partial.data(), size) != int(size) ||
+        evbuffer_expand(input, framesize) == -1 ||
+        evbuffer_add(input, partial.data(), size) == -1) {
+        throw std::runtime_error(
+                "Connection::reserveInputFrame(): Failed to reserve " +
+                std::to_string(framesize) + " bytes in the input buffer");
+    }
+    reservedFrameSize = framesize;
+}
+
+size_t Connection::scanPackets(const uint8_t* data, size_t size) {
+    size_t offset = 0;
+    while (size - offset >= sizeof(cb::mcbp::Header)) {
+        const auto* header =
+                reinterpret_cast<const cb::mcbp::Header*>(data + offset);
+        // Leave the invalid packets for isPacketAvailable() to report
+        if (!header->isValid()) {
+            break;
+        }
+        const auto framesize = sizeof(*header) + header->getBodylen();
+        if (size - offset < framesize) {
+            break;
+        }
+        offset += framesize;
+    }
+    return offset;
+}
+
 const cb::mcbp::Header& Connection::getPacket() const {
     // Drain all of the data available in bufferevent into the
     // socket read buffer
@@ -1230,8 +2140,8 @@ bool Connection::signalIfIdle() {
     }
 
     if (state != State::immediate_close) {
-        thread.notification.push(this);
-        notify_thread(thread);
+        thread->notification.push(this);
+        notify_thread(*thread);
         return true;
     }
     return false;
@@ -1294,11 +2204,18 @@ bool Connection::havePendingData() const {
         return false;
     }
 
-    return getSendQueueSize() != 0;
+    // The kernel still references memory for zero-copy sends which haven't
+    // completed yet
+    return getSendQueueSize() != 0 || !zeroCopySends.empty();
 }
 
 size_t Connection::getSendQueueSize() const {
-    return evbuffer_get_length(bufferevent_get_output(bev.get()));
+    size_t ret = evbuffer_get_length(bufferevent_get_output(bev.get())) +
+                 dcpBatch.size() + corkBuffer.size();
+    if (tlsOutput) {
+        ret += evbuffer_get_length(tlsOutput.get());
+    }
+    return ret;
 }
 
 void Connection::sendResponseHeaders(Cookie& cookie,
@@ -1311,8 +2228,8 @@ void Connection::sendResponseHeaders(Cookie& cookie,
                           (sizeof(cb::mcbp::Response) + 3),
                   "scratch buffer too small");
     const auto& request = cookie.getRequest();
-    auto wbuf = cb::char_buffer{thread.scratch_buffer.data(),
-                                thread.scratch_buffer.size()};
+    auto wbuf = cb::char_buffer{thread->scratch_buffer.data(),
+                                thread->scratch_buffer.size()};
     auto& response = *reinterpret_cast<cb::mcbp::Response*>(wbuf.data());
 
     response.setOpcode(request.getClientOpcode());
@@ -1377,7 +2294,7 @@ void Connection::sendResponseHeaders(Cookie& cookie,
     // if we can fit the key and extras in the scratch buffer lets copy them
     // in to avoid the extra mutex lock
     if ((wbuf.size() + extras.size() + key.size()) <
-        thread.scratch_buffer.size()) {
+        thread->scratch_buffer.size()) {
         std::copy(extras.begin(), extras.end(), wbuf.end());
         wbuf = {wbuf.data(), wbuf.size() + extras.size()};
         std::copy(key.begin(), key.end(), wbuf.end());
@@ -1390,6 +2307,9 @@ void Connection::sendResponseHeaders(Cookie& cookie,
         copyToOutputStream(key);
     }
     ++getBucket().responseCounters[uint16_t(status)];
+    if (corked) {
+        ++corkedResponses;
+    }
 }
 
 void Connection::sendResponse(Cookie& cookie,
@@ -1486,7 +2406,7 @@ ENGINE_ERROR_CODE Connection::add_stream_rsp(uint32_t opaque,
                                              cb::mcbp::Status status) {
     cb::mcbp::response::DcpAddStreamPayload extras;
     extras.setOpaque(dialogopaque);
-    cb::mcbp::ResponseBuilder builder(thread.getScratchBuffer());
+    cb::mcbp::ResponseBuilder builder(thread->getScratchBuffer());
     builder.setMagic(cb::mcbp::Magic::ClientResponse);
     builder.setOpcode(cb::mcbp::ClientOpcode::DcpAddStream);
     builder.setStatus(status);
@@ -1512,7 +2432,7 @@ ENGINE_ERROR_CODE Connection::marker_rsp(uint32_t opaque,
 
 ENGINE_ERROR_CODE Connection::set_vbucket_state_rsp(uint32_t opaque,
                                                     cb::mcbp::Status status) {
-    cb::mcbp::ResponseBuilder builder(thread.getScratchBuffer());
+    cb::mcbp::ResponseBuilder builder(thread->getScratchBuffer());
     builder.setMagic(cb::mcbp::Magic::ClientResponse);
     builder.setOpcode(cb::mcbp::ClientOpcode::DcpSetVbucketState);
     builder.setStatus(status);
@@ -1526,7 +2446,7 @@ ENGINE_ERROR_CODE Connection::stream_end(uint32_t opaque,
                                          cb::mcbp::DcpStreamEndStatus status,
                                          cb::mcbp::DcpStreamId sid) {
     using Framebuilder = cb::mcbp::FrameBuilder<cb::mcbp::Request>;
-    Framebuilder builder(thread.getScratchBuffer());
+    Framebuilder builder(thread->getScratchBuffer());
     builder.setMagic(sid ? cb::mcbp::Magic::AltClientRequest
                          : cb::mcbp::Magic::ClientRequest);
     builder.setOpcode(cb::mcbp::ClientOpcode::DcpStreamEnd);
@@ -1625,7 +2545,7 @@ ENGINE_ERROR_CODE Connection::mutation(uint32_t opaque,
                        (sid ? sizeof(cb::mcbp::DcpStreamIdFrameInfo) : 0) +
                        sizeof(cb::mcbp::Request);
     if (dcpUseWriteBuffer(total)) {
-        cb::mcbp::RequestBuilder builder(thread.getScratchBuffer());
+        cb::mcbp::RequestBuilder builder(thread->getScratchBuffer());
         builder.setMagic(sid ? cb::mcbp::Magic::AltClientRequest
                              : cb::mcbp::Magic::ClientRequest);
         builder.setOpcode(cb::mcbp::ClientOpcode::DcpMutation);
@@ -1739,7 +2659,7 @@ ENGINE_ERROR_CODE Connection::deletion(uint32_t opaque,
                        sizeof(cb::mcbp::Request);
 
     if (dcpUseWriteBuffer(total)) {
-        cb::mcbp::RequestBuilder builder(thread.getScratchBuffer());
+        cb::mcbp::RequestBuilder builder(thread->getScratchBuffer());
 
         builder.setMagic(sid ? cb::mcbp::Magic::AltClientRequest
                              : cb::mcbp::Magic::ClientRequest);
@@ -1826,7 +2746,7 @@ ENGINE_ERROR_CODE Connection::deletion_v2(uint32_t opaque,
                        sizeof(cb::mcbp::Request);
 
     if (dcpUseWriteBuffer(total)) {
-        cb::mcbp::RequestBuilder builder(thread.getScratchBuffer());
+        cb::mcbp::RequestBuilder builder(thread->getScratchBuffer());
         builder.setMagic(sid ? cb::mcbp::Magic::AltClientRequest
                              : cb::mcbp::Magic::ClientRequest);
         builder.setOpcode(cb::mcbp::ClientOpcode::DcpDeletion);
@@ -1911,7 +2831,7 @@ ENGINE_ERROR_CODE Connection::expiration(uint32_t opaque,
                        sizeof(cb::mcbp::Request);
 
     if (dcpUseWriteBuffer(total)) {
-        cb::mcbp::RequestBuilder builder(thread.getScratchBuffer());
+        cb::mcbp::RequestBuilder builder(thread->getScratchBuffer());
         builder.setMagic(sid ? cb::mcbp::Magic::AltClientRequest
                              : cb::mcbp::Magic::ClientRequest);
         builder.setOpcode(cb::mcbp::ClientOpcode::DcpExpiration);
@@ -1975,7 +2895,7 @@ ENGINE_ERROR_CODE Connection::set_vbucket_state(uint32_t opaque,
 
     cb::mcbp::request::DcpSetVBucketState extras;
     extras.setState(static_cast<uint8_t>(st));
-    cb::mcbp::RequestBuilder builder(thread.getScratchBuffer());
+    cb::mcbp::RequestBuilder builder(thread->getScratchBuffer());
     builder.setMagic(cb::mcbp::Magic::ClientRequest);
     builder.setOpcode(cb::mcbp::ClientOpcode::DcpSetVbucketState);
     builder.setOpaque(opaque);
@@ -1986,7 +2906,7 @@ ENGINE_ERROR_CODE Connection::set_vbucket_state(uint32_t opaque,
 }
 
 ENGINE_ERROR_CODE Connection::noop(uint32_t opaque) {
-    cb::mcbp::RequestBuilder builder(thread.getScratchBuffer());
+    cb::mcbp::RequestBuilder builder(thread->getScratchBuffer());
     builder.setMagic(cb::mcbp::Magic::ClientRequest);
     builder.setOpcode(cb::mcbp::ClientOpcode::DcpNoop);
     builder.setOpaque(opaque);
@@ -1999,7 +2919,7 @@ ENGINE_ERROR_CODE Connection::buffer_acknowledgement(uint32_t opaque,
                                                      uint32_t buffer_bytes) {
     cb::mcbp::request::DcpBufferAckPayload extras;
     extras.setBufferBytes(buffer_bytes);
-    cb::mcbp::RequestBuilder builder(thread.getScratchBuffer());
+    cb::mcbp::RequestBuilder builder(thread->getScratchBuffer());
     builder.setMagic(cb::mcbp::Magic::ClientRequest);
     builder.setOpcode(cb::mcbp::ClientOpcode::DcpBufferAcknowledgement);
     builder.setOpaque(opaque);
@@ -2059,7 +2979,7 @@ ENGINE_ERROR_CODE Connection::system_event(uint32_t opaque,
 ENGINE_ERROR_CODE Connection::get_error_map(uint32_t opaque, uint16_t version) {
     cb::mcbp::request::GetErrmapPayload body;
     body.setVersion(version);
-    cb::mcbp::RequestBuilder builder(thread.getScratchBuffer());
+    cb::mcbp::RequestBuilder builder(thread->getScratchBuffer());
     builder.setMagic(cb::mcbp::Magic::ClientRequest);
     builder.setOpcode(cb::mcbp::ClientOpcode::GetErrorMap);
     builder.setOpaque(opaque);
@@ -2110,7 +3030,7 @@ ENGINE_ERROR_CODE Connection::prepare(uint32_t opaque,
                    sizeof(cb::mcbp::Request);
     if (dcpUseWriteBuffer(total)) {
         // Format a local copy and send
-        cb::mcbp::RequestBuilder builder(thread.getScratchBuffer());
+        cb::mcbp::RequestBuilder builder(thread->getScratchBuffer());
         builder.setMagic(cb::mcbp::Magic::ClientRequest);
         builder.setOpcode(cb::mcbp::ClientOpcode::DcpPrepare);
         builder.setExtras(extras.getBuffer());
@@ -2169,7 +3089,7 @@ ENGINE_ERROR_CODE Connection::seqno_acknowledged(uint32_t opaque,
                                                  Vbid vbucket,
                                                  uint64_t prepared_seqno) {
     cb::mcbp::request::DcpSeqnoAcknowledgedPayload extras(prepared_seqno);
-    cb::mcbp::RequestBuilder builder(thread.getScratchBuffer());
+    cb::mcbp::RequestBuilder builder(thread->getScratchBuffer());
     builder.setMagic(cb::mcbp::Magic::ClientRequest);
     builder.setOpcode(cb::mcbp::ClientOpcode::DcpSeqnoAcknowledged);
     builder.setOpaque(opaque);
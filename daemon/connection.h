@@ -36,8 +36,10 @@
 #include <chrono>
 #include <deque>
 #include <memory>
+#include <optional>
 #include <queue>
 #include <string>
+#include <vector>
 
 class Bucket;
 class Cookie;
@@ -194,9 +196,26 @@ public:
     }
 
     FrontEndThread& getThread() const {
-        return thread;
+        return *thread;
     }
 
+    /**
+     * Move the connection to one of the front-end threads serving its
+     * bucket (see the "bucket_thread_reservations" setting) once the
+     * current callback completes, unless it's served by one already.
+     */
+    void requestThreadMigration() {
+        threadMigrationRequested = true;
+    }
+
+    /**
+     * Attach a connection moved to this thread by another thread to the
+     * event base of its new thread (and resume its execution).
+     *
+     * @return false if the connection should be deleted
+     */
+    bool attachToThread();
+
     in_port_t getParentPort() const {
         return parent_port;
     }
@@ -235,6 +254,14 @@ public:
         clustermap_revno = revno;
     }
 
+    bool isClustermapPushPending() const {
+        return clustermapPushPending;
+    }
+
+    void setClustermapPushPending(bool pending) {
+        clustermapPushPending = pending;
+    }
+
     /**
      * Restart the authentication (this clears all of the authentication
      * data...)
@@ -379,6 +406,16 @@ public:
         dcpNoValue = enable;
     }
 
+    bool isDcpFrameCompression() const {
+        return dcpFrameCompression;
+    }
+
+    /// Should batches of DCP messages be snappy compressed into a single
+    /// DcpCompressedFrames message?
+    void setDcpFrameCompression(bool enable) {
+        dcpFrameCompression = enable;
+    }
+
     /**
      * Copy the provided data to the end of the output stream
      *
@@ -404,6 +441,81 @@ public:
      */
     void chainDataToOutputStream(std::unique_ptr<SendBuffer> buffer);
 
+    /**
+     * Move the DCP messages staged in dcpBatch to the output stream.
+     *
+     * @throws std::bad_alloc if we failed to insert the data into the output
+     *                        stream.
+     */
+    void flushDcpBatch();
+
+    /**
+     * Cork the output stream: the responses produced until uncork() is
+     * called are gathered in corkBuffer rather than added to the output
+     * stream one by one, so that the responses of a round of pipelined
+     * commands are sent with a single write.
+     */
+    void cork();
+
+    /**
+     * Move the responses gathered since cork() to the output stream and
+     * update the response_sends / responses_sent stats.
+     *
+     * @throws std::bad_alloc if we failed to insert the data into the output
+     *                        stream.
+     */
+    void uncork();
+
+    /**
+     * Move the data staged in corkBuffer to the output stream (so that
+     * whatever is added to the output stream directly keeps its order on
+     * the wire).
+     *
+     * @throws std::bad_alloc if we failed to insert the data into the output
+     *                        stream.
+     */
+    void flushCorkBuffer();
+
+    /**
+     * Get the buffer data for the client should be added to. For TLS
+     * connections this is the staging buffer coalescing the output into
+     * TLS records (see flushTlsRecords()), otherwise the output stream.
+     */
+    evbuffer* getOutputBuffer();
+
+    /**
+     * Move the data staged for a TLS connection to the output stream in
+     * chunks of the maximum TLS record size, so that OpenSSL creates
+     * full records rather than one record per response fragment.
+     *
+     * @param partial set to true to also move the trailing data which
+     *                don't fill a complete record
+     * @throws std::bad_alloc if we failed to insert the data into the output
+     *                        stream.
+     */
+    void flushTlsRecords(bool partial);
+
+    /**
+     * Try to send dcpBatch as a single snappy compressed DcpCompressedFrames
+     * message.
+     *
+     * @return true if sent, false if the batch does not compress (and should
+     *         be sent as-is)
+     * @throws std::bad_alloc if we failed to insert the data into the output
+     *                        stream.
+     */
+    bool writeCompressedDcpBatch();
+
+    /**
+     * Replace the DcpCompressedFrames message at the head of the input
+     * buffer with the messages it contains, so that they're executed as if
+     * they had been received individually.
+     *
+     * @throws std::runtime_error if the message is invalid or can't be
+     *                            inflated
+     */
+    void expandDcpCompressedFrames();
+
     /**
      * Enable the datatype which corresponds to the feature
      *
@@ -859,8 +971,20 @@ protected:
     /// creator has a reference)
     uint8_t refcount{1};
 
-    /** Pointer to the thread object serving this connection */
-    FrontEndThread& thread;
+    /**
+     * Pointer to the thread object serving this connection (it is only
+     * changed while holding the lock of the list of all connections, as
+     * the connections are iterated from other threads)
+     */
+    FrontEndThread* thread;
+
+    /// Should the connection move to the threads of its bucket?
+    bool threadMigrationRequested{false};
+
+    /// The data read from, and to be written to, the socket kept while
+    /// the connection moves to another thread
+    cb::libevent::unique_evbuffer_ptr migratedInput;
+    cb::libevent::unique_evbuffer_ptr migratedOutput;
 
     /** Listening port that creates this connection instance */
     const in_port_t parent_port{0};
@@ -886,6 +1010,14 @@ protected:
     /** The cluster map revision used by this client */
     int clustermap_revno{-2};
 
+    /**
+     * Set while a cluster map push is queued for the connection (the push
+     * sends the latest configuration when it runs, so there is no need to
+     * queue another until it did). Only accessed while holding the mutex
+     * of the front end thread owning the connection.
+     */
+    bool clustermapPushPending{false};
+
     /**
      * Is XERROR supported for this connection or not (or should we just
      * silently disconnect the client)
@@ -975,6 +1107,21 @@ protected:
     /** Shuld values be stripped off? */
     bool dcpNoValue = false;
 
+    /** Should DCP batches be compressed (see flushDcpBatch)? */
+    bool dcpFrameCompression = false;
+
+    /// Counters for the DCP batches compressed by this connection
+    struct DcpFrameCompressionStats {
+        size_t batches = 0;
+        /// Size of the messages in the compressed batches
+        size_t uncompressedBytes = 0;
+        /// Size of the DcpCompressedFrames messages sent for them
+        size_t compressedBytes = 0;
+        /// Time spent compressing (including batches not worth sending
+        /// compressed)
+        std::chrono::nanoseconds time{0};
+    } dcpFrameCompressionStats;
+
     /** Is Tracing enabled for this connection? */
     bool tracingEnabled = false;
 
@@ -1002,9 +1149,79 @@ protected:
 
     // Total number of bytes received on the network
     size_t totalRecv = 0;
+
+    /**
+     * The number of bytes at the start of the input buffer known to hold
+     * complete packets with a valid header (and to be continuous in
+     * memory). isPacketAvailable() frames all of the packets in the first
+     * chunk of the input buffer in one pass, so that it doesn't have to
+     * look at the input buffer again for each of the packets of a pipeline.
+     */
+    mutable size_t framedBytes = 0;
+
+    /**
+     * The size of the (incomplete) frame at the start of the input buffer
+     * that reserveInputFrame() made room for, or 0 if none.
+     */
+    mutable size_t reservedFrameSize = 0;
+
+    /// The frames at least this big are read into a chunk of the input
+    /// buffer reserved for the entire frame
+    static constexpr size_t MinReservedFrameSize = 64 * 1024;
     // Total number of bytes sent to the network
     size_t totalSend = 0;
 
+    /**
+     * DCP messages are written as several small pieces (header, extras,
+     * key and value). While the DCP step loop runs, copyToOutputStream()
+     * stages the pieces in dcpBatch so that a batch of messages reaches the
+     * output stream with a single write, rather than one write per piece.
+     * Values large enough to be chained by reference flush the batch first
+     * (to preserve ordering) and are still sent without a copy. The buffer
+     * is borrowed from the thread's buffer pool while it holds data.
+     */
+    bool dcpBatching = false;
+    std::vector<char> dcpBatch;
+
+    /// The number of bytes staged in dcpBatch before it is flushed
+    static constexpr size_t DcpBatchSize = 16 * 1024;
+
+    /**
+     * Set between cork() and uncork() (while executeCommandsCallback runs
+     * the command pipeline). copyToOutputStream() stages the responses in
+     * corkBuffer (borrowed from the thread's buffer pool while it holds
+     * data), and the values chained by reference flush it first.
+     */
+    bool corked = false;
+    std::vector<char> corkBuffer;
+    /// The number of responses produced since cork()
+    size_t corkedResponses = 0;
+
+    /// The number of bytes staged in corkBuffer before it is flushed
+    static constexpr size_t CorkBufferSize = 16 * 1024;
+
+    /// The most data seen in the input buffer (for the connection stats)
+    size_t inputHighWatermark = 0;
+
+    /// The biggest send queue seen (for the connection stats)
+    size_t outputHighWatermark = 0;
+
+    /// Batches smaller than this are not worth compressing
+    static constexpr size_t DcpFrameCompressionMinSize = 256;
+
+    /// The maximum payload of a TLS record
+    static constexpr size_t TlsMaxRecordSize = 16 * 1024;
+
+    /**
+     * The data written to a TLS connection is staged here (and moved to
+     * the output stream by flushTlsRecords()) as OpenSSL encrypts every
+     * chunk added to the output stream as (at least) one record.
+     */
+    cb::libevent::unique_evbuffer_ptr tlsOutput;
+
+    /// Is the TLS record encryption done by the kernel (kTLS)
+    bool ktls = false;
+
     /**
      * The "list" of commands currently being processed. We ALWAYS keep the
      * the first entry in the list (and try to reuse that) due to how DCP
@@ -1040,6 +1257,42 @@ protected:
         bool term{false};
     } sendQueueInfo;
 
+    /// Is MSG_ZEROCOPY enabled on the socket (SO_ZEROCOPY is only set once
+    /// we've got a value large enough to use it)
+    enum class ZeroCopyState : uint8_t { Unknown, Enabled, Unsupported };
+    ZeroCopyState zeroCopyState = ZeroCopyState::Unknown;
+
+    /**
+     * A SendBuffer handed to the kernel with MSG_ZEROCOPY. The kernel
+     * references the memory until it tells us (via the socket error queue)
+     * that the send with the given id completed, so we keep the buffer (and
+     * the item it holds) alive until then. The buffer is shared as the tail
+     * of a partial send is left for libevent to send.
+     */
+    struct ZeroCopySend {
+        uint32_t id;
+        std::shared_ptr<SendBuffer> buffer;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    /// The zero-copy sends the kernel has not yet completed
+    std::deque<ZeroCopySend> zeroCopySends;
+
+    /// The id the kernel will assign to the next zero-copy send
+    uint32_t zeroCopyNextId = 0;
+
+    /// Timer used to poll the error queue for completions while we've got
+    /// outstanding zero-copy sends (the socket may otherwise be idle)
+    cb::libevent::unique_event_ptr zeroCopyTimer;
+
+    /// Timer used to retry the mutation at the head of the input while its
+    /// admission is deferred (created on first use)
+    cb::libevent::unique_event_ptr admissionTimer;
+
+    /// When we started deferring the mutation at the head of the input
+    /// (empty if it isn't deferred)
+    std::optional<std::chrono::steady_clock::time_point> admissionDeferredSince;
+
     /**
      * Given that we "ack" the writing once we drain the write buffer in
      * memcached we need an extra state variable to make sure that we don't
@@ -1064,6 +1317,124 @@ protected:
      */
     void shutdownIfSendQueueStuck(std::chrono::steady_clock::time_point now);
 
+    /**
+     * The command in the provided cookie (a GET) is blocked waiting for the
+     * engine, and as the client doesn't allow for reordering we won't start
+     * any of the commands following it until it completes. Look at the
+     * GETs the client pipelined behind it and pass their keys to the engine
+     * as a prefetch hint, so that any background fetches needed are batched
+     * with the one for the blocked command.
+     *
+     * Only keys in the same collection as the blocked GET (for which the
+     * privilege check succeeded) are considered.
+     *
+     * @param cookie the cookie for the blocked command
+     * @param offset the offset in the input buffer of the next packet
+     */
+    void prefetchPipelinedGets(Cookie& cookie, size_t offset);
+
+    /**
+     * Get the number of bytes of the complete packets with a valid header
+     * at the start of the provided data.
+     */
+    static size_t scanPackets(const uint8_t* data, size_t size);
+
+    /**
+     * Move the start of the incomplete frame in the input buffer into a
+     * chunk of the buffer with room for the entire frame, so that the rest
+     * of it is read right behind it (and the frame doesn't need to be
+     * copied to be made continuous once it is complete).
+     *
+     * @param input the input buffer
+     * @param size the number of bytes in the input buffer
+     * @param framesize the size of the frame at the start of it
+     */
+    void reserveInputFrame(evbuffer* input,
+                           size_t size,
+                           size_t framesize) const;
+
+    /// The maximum number of keys to pass in a single prefetch hint
+    static constexpr size_t MaxPrefetchKeys = 256;
+
+    /// The maximum number of bytes of the input buffer to look at for
+    /// pipelined GETs to prefetch
+    static constexpr size_t MaxPrefetchWindowSize = 64 * 1024;
+
+    /**
+     * Try to send the payload of the buffer straight to the socket with
+     * MSG_ZEROCOPY instead of chaining it to the libevent output stream
+     * (which results in the kernel copying it into the socket buffer).
+     *
+     * This is only done for non-TLS connections when the payload is at
+     * least Settings::getZeroCopySendThreshold() bytes and the data already
+     * in the output stream could be flushed to the socket.
+     *
+     * @param buffer the buffer to send (ownership is taken if sent)
+     * @return true if the buffer was consumed, false if the caller should
+     *         use the normal send path
+     */
+    bool trySendZeroCopy(std::unique_ptr<SendBuffer>& buffer);
+
+    /// Read the zero-copy completion notifications from the socket error
+    /// queue and release the buffers the kernel is done with
+    void processZeroCopyCompletions();
+
+    /// Arm the timer used to poll for zero-copy completions if we've got
+    /// outstanding sends
+    void scheduleZeroCopyPoll();
+
+    /// Callback for the zero-copy poll timer
+    static void zerocopy_timer_callback(evutil_socket_t, short, void* ctx);
+
+    /**
+     * May we start the next GET pipelined by the client while earlier
+     * commands are still in flight, even though the client didn't enable
+     * unordered execution? That's only the case if ordered read pipelining
+     * is enabled and all of the commands in flight (and the next packet, if
+     * available) are GETs, so that the GET can't observe a different state
+     * than if it was run in order.
+     */
+    bool mayPipelineOrderedRead() const;
+
+    /**
+     * Should the next packet be left in the input buffer (and reading from
+     * the socket be paused) as it is a mutation and the bucket is under
+     * memory pressure? A mutation is only deferred for up to
+     * Settings::getMutationAdmissionMaxDelay(); after that it is executed
+     * (and most likely rejected with a temporary failure) as usual.
+     */
+    bool shouldDeferMutation(const cb::mcbp::Header& header);
+
+    /// Arm the timer used to retry a deferred mutation
+    void scheduleAdmissionRetry();
+
+    /// Callback for the admission retry timer
+    static void admission_timer_callback(evutil_socket_t, short, void* ctx);
+
+    /**
+     * Execute the command in the cookie, redirecting the responses to the
+     * cookie's held response buffer if it holds back its responses.
+     *
+     * @return the return value of Cookie::execute()
+     */
+    bool executeCookie(Cookie& cookie);
+
+    /**
+     * Move the held responses of the completed commands at the front of
+     * the pipeline (which no longer have to wait for an earlier command) to
+     * the output stream, and release their cookies.
+     *
+     * @return true if there are commands still holding responses
+     */
+    bool flushHeldResponses();
+
+    /**
+     * When set, copyToOutputStream() and chainDataToOutputStream() append
+     * to this buffer (the held responses of the cookie being executed)
+     * rather than the connection's output stream.
+     */
+    evbuffer* heldOutput = nullptr;
+
     /**
      * Iterate over all of the existing cookies (commands) and try to call
      * execute() on all of the cookies which isn't blocked in the engine.
@@ -1095,6 +1466,17 @@ protected:
      */
     bool executeCommandsCallback();
 
+    /**
+     * Move the connection to another front-end thread if its bucket is
+     * served by a different set of threads (and the connection is idle).
+     * The connection must not be touched by the calling thread once this
+     * returns true.
+     */
+    bool migrateThread();
+
+    /// Set the read and write limits of the bufferevent and start reading
+    void configureBufferevent();
+
     /**
      * The callback method called from bufferevent for read/write callbacks
      *
@@ -1121,6 +1503,18 @@ protected:
      * the standard read callback.
      */
     static void ssl_read_callback(bufferevent*, void* ctx);
+
+    /**
+     * The OpenSSL message callback used to count the TLS records (and
+     * their size) sent to the client once the handshake is complete.
+     */
+    static void ssl_msg_callback(int write_p,
+                                 int version,
+                                 int content_type,
+                                 const void* buf,
+                                 size_t len,
+                                 SSL* ssl,
+                                 void* arg);
 };
 
 /**
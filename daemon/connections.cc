@@ -58,6 +58,11 @@ void iterate_thread_connections(FrontEndThread* thread,
     }
 }
 
+void with_connections_locked(const std::function<void()>& callback) {
+    auto locked = connections.wlock();
+    callback();
+}
+
 Connection* conn_new(SOCKET sfd,
                      const ListeningPort& interface,
                      struct event_base* base,
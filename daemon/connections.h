@@ -48,6 +48,15 @@ Connection* conn_new(SOCKET sfd,
  */
 void conn_destroy(Connection* c);
 
+/**
+ * Run the callback while holding the lock of the list of all connections
+ * (exclusively), so that the connections may be moved between the threads
+ * without racing with the threads iterating over them.
+ *
+ * @param callback the callback to run
+ */
+void with_connections_locked(const std::function<void()>& callback);
+
 /**
  * Signal all of the idle clients in the system.
  *
@@ -22,12 +22,15 @@
 #include "cookie_trace_context.h"
 #include "executorpool.h"
 #include "external_auth_manager_thread.h"
+#include "front_end_thread.h"
 #include "get_authorization_task.h"
 #include "mcaudit.h"
 #include "mcbp_executors.h"
 #include "memcached.h"
 #include "opentelemetry.h"
+#include "protocol/mcbp/steppable_command_context.h"
 #include "settings.h"
+#include "stats.h"
 
 #include <logger/logger.h>
 #include <mcbp/mcbp.h>
@@ -40,6 +43,7 @@
 #include <platform/timeutils.h>
 #include <platform/uuid.h>
 #include <utilities/engine_errc_2_mcbp.h>
+#include <utilities/fast_clock.h>
 #include <utilities/logtags.h>
 #include <chrono>
 
@@ -131,6 +135,19 @@ bool Cookie::execute() {
     // Reset ewouldblock state!
     setEwouldblock(false);
 
+    if (!started) {
+        started = true;
+        if (isDeadlineExceeded()) {
+            // The command waited in the pipeline for longer than the client
+            // is prepared to wait for it, don't waste any work on it
+            get_thread_stats(&connection)->cmd_deadline_exceeded++;
+            setErrorContext("Deadline exceeded before the command started");
+            sendResponse(cb::mcbp::Status::Etmpfail);
+            collectTimings();
+            return true;
+        }
+    }
+
     if (euid && !euidPrivilegeContext) {
         // We're supposed to run as a different user, but we don't
         // have the privilege set configured yet...
@@ -149,7 +166,13 @@ bool Cookie::execute() {
     }
 
     const auto& header = getHeader();
-    if (header.isResponse()) {
+    if (steppableContext && authorized) {
+        // We're being re-executed after the engine notified us that the
+        // blocking operation completed. The command already passed the
+        // privilege checks and the executor created the context, so we
+        // may resume the state machine directly.
+        steppableContext->drive();
+    } else if (header.isResponse()) {
         execute_response_packet(*this, header.getResponse());
     } else {
         // We've already verified that the packet is a legal packet
@@ -369,7 +392,26 @@ void Cookie::logResponse(ENGINE_ERROR_CODE code) const {
     logResponse(cb::to_string(cb::engine_errc(code)).c_str());
 }
 
+void Cookie::holdResponses() {
+    if (!heldResponses) {
+        heldResponses.reset(evbuffer_new());
+        if (!heldResponses) {
+            throw std::bad_alloc();
+        }
+    }
+}
+
+void Cookie::releaseHeldResponses(evbuffer& output) {
+    if (heldResponses) {
+        if (evbuffer_add_buffer(&output, heldResponses.get()) == -1) {
+            throw std::bad_alloc();
+        }
+        heldResponses.reset();
+    }
+}
+
 void Cookie::setCommandContext(CommandContext* ctx) {
+    steppableContext = nullptr;
     commandContext.reset(ctx);
 }
 
@@ -416,6 +458,35 @@ void Cookie::maybeLogSlowCommand(
     }
 }
 
+void Cookie::maybeRecordTrace(std::chrono::steady_clock::duration elapsed) {
+    const auto rate = Settings::instance().getCommandTraceSampleRate();
+    if (rate == 0 || !isTracingEnabled()) {
+        return;
+    }
+
+    const auto opcode = getRequest().getClientOpcode();
+    auto& thread = connection.getThread();
+    const bool sampled = (++thread.commandTraceCount % rate) == 0;
+    const bool slow = elapsed > cb::mcbp::sla::getSlowOpThreshold(opcode);
+    if (!sampled && !slow) {
+        return;
+    }
+
+    try {
+        thread.commandTraces.add(
+                {std::chrono::system_clock::now(),
+                 opcode,
+                 connection.getId(),
+                 connection.getBucket().name,
+                 std::chrono::duration_cast<std::chrono::microseconds>(
+                         elapsed),
+                 slow,
+                 tracer.getSpans()});
+    } catch (const std::bad_alloc&) {
+        // Failed to record the trace, continue...
+    }
+}
+
 Cookie::Cookie(Connection& conn)
     : connection(conn), privilegeContext(conn.getUser().domain) {
 }
@@ -423,9 +494,10 @@ Cookie::Cookie(Connection& conn)
 void Cookie::initialize(const cb::mcbp::Header& header, bool tracing_enabled) {
     reset();
     setTracingEnabled(tracing_enabled ||
-                      Settings::instance().alwaysCollectTraceInfo());
+                      Settings::instance().alwaysCollectTraceInfo() ||
+                      Settings::instance().getCommandTraceSampleRate() != 0);
     setPacket(header);
-    start = std::chrono::steady_clock::now();
+    start = cb::FastClock::now();
     tracer.begin(cb::tracing::Code::Request, start);
 
     if (Settings::instance().getVerbose() > 1) {
@@ -504,12 +576,15 @@ void Cookie::reset() {
     packet = {};
     validated = false;
     cas = 0;
+    steppableContext = nullptr;
     commandContext.reset();
     tracer.clear();
     ewouldblock = false;
     openTracingContext.clear();
     authorized = false;
     preserveTtl = false;
+    started = false;
+    deadline.reset();
     reorder = connection.allowUnorderedExecution();
     inflated_input_payload.reset();
     currentCollectionInfo.reset();
@@ -553,14 +628,15 @@ void Cookie::collectTimings() {
     }
 
     const auto opcode = packet->getRequest().getClientOpcode();
-    const auto endTime = std::chrono::steady_clock::now();
+    const auto endTime = cb::FastClock::now();
     const auto elapsed = endTime - start;
 
     // End the tracing span (Request) which is the first span in the tracer
     tracer.end(cb::tracing::SpanId{0}, endTime);
 
-    // aggregated timing for all buckets
-    all_buckets[0].timings.collect(opcode, elapsed);
+    // aggregated timing for all buckets (the histograms may be sampled)
+    const auto weight = get_stats_sample_weight(SampledStat::Timings);
+    all_buckets[0].timings.collect(opcode, elapsed, weight);
 
     // timing for current bucket
     const auto bucketid = connection.getBucketIndex();
@@ -569,12 +645,14 @@ void Cookie::collectTimings() {
      * to delete the bucket you're associated with and your're idle.
      */
     if (bucketid != 0) {
-        all_buckets[bucketid].timings.collect(opcode, elapsed);
+        all_buckets[bucketid].timings.collect(opcode, elapsed, weight);
     }
 
     // Log operations taking longer than the "slow" threshold for the opcode.
     maybeLogSlowCommand(elapsed);
 
+    maybeRecordTrace(elapsed);
+
     if (isOpenTracingEnabled()) {
         OpenTelemetry::pushTraceLog(extractTraceContext());
     }
@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include <libevent/utilities.h>
 #include <mcbp/protocol/datatype.h>
 #include <mcbp/protocol/status.h>
 #include <memcached/dockey.h>
@@ -29,6 +30,7 @@
 // Forward decls
 class Connection;
 class CommandContext;
+class SteppableCommandContext;
 struct CookieTraceContext;
 class Task;
 namespace cb::mcbp {
@@ -393,6 +395,19 @@ public:
 
     void setCommandContext(CommandContext* ctx = nullptr);
 
+    /**
+     * Register the steppable command context currently bound to this
+     * cookie. When the command is re-executed after the engine returned
+     * EWOULDBLOCK we resume the context directly instead of going through
+     * the opcode dispatch table and the dynamic_cast in obtainContext().
+     *
+     * Called from the SteppableCommandContext constructor; the pointer is
+     * cleared whenever the owning command context is released.
+     */
+    void setSteppableContext(SteppableCommandContext* ctx) {
+        steppableContext = ctx;
+    }
+
     /**
      * Log the current connection if its execution time exceeds the
      * threshold for the command
@@ -401,6 +416,15 @@ public:
      */
     void maybeLogSlowCommand(std::chrono::steady_clock::duration elapsed) const;
 
+    /**
+     * Record the trace of the command in the command trace log of the
+     * thread if it is sampled, or if it was slower than the slow op
+     * threshold for the opcode (see Settings::getCommandTraceSampleRate)
+     *
+     * @param elapsed the time elapsed while executing the command
+     */
+    void maybeRecordTrace(std::chrono::steady_clock::duration elapsed);
+
     uint8_t getRefcount() {
         return refcount;
     }
@@ -464,6 +488,30 @@ public:
         return reorder;
     }
 
+    /**
+     * Hold back the responses for this command in a private buffer rather
+     * than writing them to the connection's output stream. Used when the
+     * command is executed ahead of an earlier (blocked) command on a
+     * connection which requires the responses to be sent in order.
+     */
+    void holdResponses();
+
+    /// Are the responses for this command being held back?
+    bool isHoldingResponses() const {
+        return bool(heldResponses);
+    }
+
+    /// The buffer holding the responses (nullptr unless holding)
+    evbuffer* getHeldResponses() const {
+        return heldResponses.get();
+    }
+
+    /**
+     * Move the held responses to the provided output stream and stop
+     * holding responses for this cookie.
+     */
+    void releaseHeldResponses(evbuffer& output);
+
     /**
      * Get the inflated payload (inflated as part of package validation),
      * and if the payload wasn't inflated the packets value is returned.
@@ -561,6 +609,24 @@ public:
         preserveTtl = val;
     }
 
+    /**
+     * Set the deadline of the command (from the Deadline frame info); the
+     * client won't wait for the response for longer than the timeout
+     * from when we read the command.
+     */
+    void setDeadline(std::chrono::milliseconds timeout) {
+        deadline = start + timeout;
+    }
+
+    std::optional<std::chrono::steady_clock::time_point> getDeadline() const {
+        return deadline;
+    }
+
+    /// Has the deadline of the command (if it has one) passed?
+    bool isDeadlineExceeded() const {
+        return deadline && std::chrono::steady_clock::now() > *deadline;
+    }
+
 protected:
     /// Check if the current command have the requested privilege for
     /// for the provided scope collection identifier
@@ -648,6 +714,15 @@ protected:
      */
     std::unique_ptr<CommandContext> commandContext;
 
+    /**
+     * Non-owning pointer to commandContext if it is a steppable command
+     * context (used for the fast resume path in execute())
+     */
+    SteppableCommandContext* steppableContext = nullptr;
+
+    /// Responses held back until the earlier commands have completed
+    cb::libevent::unique_evbuffer_ptr heldResponses;
+
     /**
      * Pointer to engine-specific data which the engine has requested the server
      * to persist for the life of the connection.
@@ -682,6 +757,12 @@ protected:
     /// should we try to preserve TTL for this operation
     bool preserveTtl{false};
 
+    /// Set once the command started executing
+    bool started{false};
+
+    /// The time the client stops waiting for the response (if it told us)
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+
     cb::compression::Buffer inflated_input_payload;
 
     /// The Scope and Collection information for the current command picked
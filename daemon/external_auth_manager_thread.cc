@@ -22,10 +22,12 @@
 #include "server_event.h"
 #include "start_sasl_auth_task.h"
 
+#include <cbcrypto/cbcrypto.h>
 #include <logger/logger.h>
 #include <mcbp/protocol/framebuilder.h>
 #include <nlohmann/json.hpp>
 #include <platform/base64.h>
+#include <platform/random.h>
 #include <algorithm>
 
 /// The one and only handle to the external authentication manager
@@ -366,6 +368,9 @@ void ExternalAuthManagerThread::setRbacCacheEpoch(
     using namespace std::chrono;
     const auto age = duration_cast<seconds>(tp.time_since_epoch()).count();
     rbacCacheEpoch.store(static_cast<uint64_t>(age), std::memory_order_release);
+    // The provider wants the users to be looked up again, don't let the
+    // cached authentications bypass that
+    authCache.clear();
 }
 
 void ExternalAuthManagerThread::processResponseQueue() {
@@ -445,6 +450,100 @@ bool ExternalAuthManagerThread::haveRbacEntryForUser(
            (age >= rbacCacheEpoch.load(std::memory_order_acquire));
 }
 
+bool ExternalAuthManagerThread::isCachedAuthentication(
+        const std::string& user, std::string_view challenge) {
+    // The authentication-only requests rely on the RBAC entry being kept
+    // up to date, and so does the cache
+    return authCache.lookup(user, challenge) && haveRbacEntryForUser(user);
+}
+
+ExternalAuthManagerThread::AuthCache::AuthCache() {
+    std::string bytes(32, '\0');
+    cb::RandomGenerator randomGenerator;
+    if (!randomGenerator.getBytes(bytes.data(), bytes.size())) {
+        throw std::runtime_error("AuthCache: Failed to get random bytes");
+    }
+    salt = std::move(bytes);
+}
+
+void ExternalAuthManagerThread::AuthCache::setTtl(std::chrono::seconds value) {
+    std::lock_guard<std::mutex> guard(mutex);
+    ttl = value;
+    if (ttl.count() == 0) {
+        entries.clear();
+    }
+}
+
+std::string ExternalAuthManagerThread::AuthCache::hash(
+        std::string_view challenge) const {
+    return cb::crypto::HMAC(cb::crypto::Algorithm::SHA256, salt, challenge);
+}
+
+bool ExternalAuthManagerThread::AuthCache::lookup(const std::string& user,
+                                                  std::string_view challenge) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (ttl.count() == 0) {
+        return false;
+    }
+    auto iter = entries.find(user);
+    if (iter == entries.end()) {
+        ++misses;
+        return false;
+    }
+    if (iter->second.expiry <= std::chrono::steady_clock::now()) {
+        entries.erase(iter);
+        ++misses;
+        return false;
+    }
+    if (iter->second.hash != hash(challenge)) {
+        ++misses;
+        return false;
+    }
+    ++hits;
+    return true;
+}
+
+void ExternalAuthManagerThread::AuthCache::insert(const std::string& user,
+                                                  std::string_view challenge) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (ttl.count() == 0) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    // Drop the expired entries every now and then so that the users which
+    // stopped connecting don't linger
+    if (entries.size() >= 1024 && entries.size() % 1024 == 0) {
+        for (auto iter = entries.begin(); iter != entries.end();) {
+            if (iter->second.expiry <= now) {
+                iter = entries.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+    entries[user] = Entry{hash(challenge), now + ttl};
+}
+
+void ExternalAuthManagerThread::AuthCache::remove(const std::string& user) {
+    std::lock_guard<std::mutex> guard(mutex);
+    entries.erase(user);
+}
+
+void ExternalAuthManagerThread::AuthCache::clear() {
+    std::lock_guard<std::mutex> guard(mutex);
+    entries.clear();
+}
+
+ExternalAuthManagerThread::AuthCacheStats
+ExternalAuthManagerThread::AuthCache::getStats() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    AuthCacheStats ret;
+    ret.size = entries.size();
+    ret.hits = hits;
+    ret.misses = misses;
+    return ret;
+}
+
 void ExternalAuthManagerThread::ActiveUsers::login(const std::string& user) {
     std::lock_guard<std::mutex> guard(mutex);
     users[user]++;
@@ -25,6 +25,7 @@
 #include <gsl/gsl>
 #include <mutex>
 #include <queue>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -107,6 +108,45 @@ public:
     /// Check to see if we've got an up to date RBAC entry for the user
     bool haveRbacEntryForUser(const std::string& user) const;
 
+    /// Set how long a successful authentication may be reused for
+    /// (0 disables (and clears) the cache of authentications)
+    void setAuthCacheTtl(std::chrono::seconds ttl) {
+        authCache.setTtl(ttl);
+    }
+
+    /**
+     * Check if the user successfully authenticated with the same
+     * credentials within the TTL of the authentication cache (and we've
+     * got an up to date RBAC entry for the user), so that the
+     * authentication provider doesn't need to be asked again.
+     *
+     * @param user the name of the user
+     * @param challenge the (PLAIN) challenge the client sent
+     */
+    bool isCachedAuthentication(const std::string& user,
+                                std::string_view challenge);
+
+    /// Remember that the user successfully authenticated with the challenge
+    void cacheAuthentication(const std::string& user,
+                             std::string_view challenge) {
+        authCache.insert(user, challenge);
+    }
+
+    /// Forget the cached authentication of the user (if any)
+    void forgetAuthentication(const std::string& user) {
+        authCache.remove(user);
+    }
+
+    struct AuthCacheStats {
+        size_t size = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    AuthCacheStats getAuthCacheStats() const {
+        return authCache.getStats();
+    }
+
 protected:
     /// The main loop of the thread
     void run() override;
@@ -195,6 +235,45 @@ protected:
 
     std::vector<Connection*> pendingRemoveConnection;
 
+    /**
+     * The successful external authentications, keyed by the user. Only
+     * a salted hash of the credentials is stored (the salt is generated
+     * at startup and never leaves the process).
+     */
+    class AuthCache {
+    public:
+        AuthCache();
+
+        void setTtl(std::chrono::seconds value);
+
+        /// Is the (unexpired) cached credential hash of the user the
+        /// hash of the challenge?
+        bool lookup(const std::string& user, std::string_view challenge);
+
+        void insert(const std::string& user, std::string_view challenge);
+
+        void remove(const std::string& user);
+
+        void clear();
+
+        AuthCacheStats getStats() const;
+
+    private:
+        std::string hash(std::string_view challenge) const;
+
+        struct Entry {
+            std::string hash;
+            std::chrono::steady_clock::time_point expiry;
+        };
+
+        mutable std::mutex mutex;
+        std::string salt;
+        std::chrono::seconds ttl{0};
+        std::unordered_map<std::string, Entry> entries;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    } authCache;
+
     class ActiveUsers {
     public:
         void login(const std::string& user);
@@ -17,19 +17,27 @@
 
 #pragma once
 
-#include <JSON_checker.h>
+#include "command_trace_log.h"
+#include "workload_capture.h"
+
 #include <event.h>
+#include <memcached/dockey.h>
 #include <memcached/engine_error.h>
+#include <memcached/vbucket.h>
+#include <platform/compress.h>
 #include <platform/platform_thread.h>
 #include <platform/sized_buffer.h>
 #include <platform/socket.h>
 #include <subdoc/operations.h>
+#include <utilities/json_validator.h>
 
 #include <array>
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -113,9 +121,70 @@ struct FrontEndThread {
         std::vector<Connection*> connections;
     } notification;
 
+    /**
+     * The connections other threads moved to this thread (because of the
+     * bucket they selected), waiting to be attached to its event base.
+     */
+    class MigrationQueue {
+    public:
+        /**
+         * Queue the connection and call detach to release it from the
+         * thread it's moving from. The queue is locked until detach
+         * returns so that the connection isn't picked up before it's
+         * detached (and nothing is changed if the connection can't be
+         * queued).
+         *
+         * @throws std::bad_alloc if the connection can't be queued
+         */
+        void push(Connection* c, const std::function<void()>& detach);
+        void swap(std::vector<Connection*>& other);
+
+    protected:
+        std::mutex mutex;
+        std::vector<Connection*> connections;
+    } migrations;
+
+    /**
+     * The fixed size buffers the connections of this thread stage their
+     * output in (Connection::corkBuffer and Connection::dcpBatch). A
+     * connection borrows a buffer when it starts staging data and returns
+     * it once the data is flushed, so that the (mostly idle) connections
+     * don't each keep one. Only used from this thread (no locking).
+     */
+    class BufferPool {
+    public:
+        /// The capacity of the buffers
+        static constexpr size_t BufferSize = 16 * 1024;
+
+        /// The number of free buffers kept in the pool
+        static constexpr size_t MaxPooledBuffers = 64;
+
+        ~BufferPool();
+
+        /**
+         * Borrow an (empty) buffer with a capacity of BufferSize.
+         *
+         * @throws std::bad_alloc if a new buffer is needed and the memory
+         *                        can't be allocated
+         */
+        std::vector<char> borrow();
+
+        /**
+         * Return a buffer (which is left without storage). It is freed if
+         * the pool is full.
+         */
+        void release(std::vector<char>& buffer);
+
+    protected:
+        std::vector<std::vector<char>> buffers;
+    } bufferPool;
+
     /// index of this thread in the threads array
     size_t index = 0;
 
+    /// NUMA node this thread is pinned to (-1 if NUMA placement is disabled)
+    int numa_node = -1;
+
     /**
      * Shared sub-document operation for all connections serviced by this
      * thread
@@ -126,7 +195,58 @@ struct FrontEndThread {
      * Shared validator used by all connections serviced by this thread
      * when they need to validate a JSON document
      */
-    JSON_checker::Validator validator;
+    cb::json::Validator validator;
+
+    /**
+     * The document most recently inflated by a sub-document lookup on this
+     * thread, so that lookups of the same version of a compressed document
+     * don't all have to inflate it again.
+     */
+    struct InflatedDocument {
+        int bucket = -1;
+        Vbid vbid;
+        std::string key;
+        uint64_t cas = 0;
+        std::shared_ptr<const cb::compression::Buffer> value;
+    } inflatedDocument;
+
+    /// The largest inflated document kept in inflatedDocument
+    static const size_t MaxInflatedDocumentSize = 1024 * 1024;
+
+    /**
+     * A GET response cached on this thread, so that repeated GETs of a hot
+     * document may be served without entering the engine. It's only valid
+     * while the engine returns the same document generation (see
+     * EngineIface::getDocumentGeneration()).
+     */
+    struct CachedGetResponse {
+        int bucket = -1;
+        Vbid vbid;
+        CollectionID collection;
+        /// The key (without the collection)
+        std::string key;
+        uint64_t generation = 0;
+        uint64_t cas = 0;
+        /// The flags (in network byte order, as in item_info)
+        uint32_t flags = 0;
+        uint8_t datatype = 0;
+        std::string value;
+    };
+
+    /// The cached GET responses, indexed by the hash of the key
+    std::array<CachedGetResponse, 64> getResponseCache;
+
+    /// The largest value kept in getResponseCache
+    static const size_t MaxCachedGetResponseSize = 4096;
+
+    /// The traces of the commands sampled on this thread
+    CommandTraceLog commandTraces;
+
+    /// The number of commands considered for sampling on this thread
+    uint64_t commandTraceCount = 0;
+
+    /// The requests recorded on this thread by the workload capture
+    WorkloadCapture::CaptureBuffer workloadCapture;
 
     /// Is the thread running or not
     std::atomic_bool running{false};
@@ -253,6 +253,9 @@ void mc_time_clock_tick() {
 
     // check on tasks to be made runnable in the future
     executorPool->clockTick();
+    if (authExecutorPool) {
+        authExecutorPool->clockTick();
+    }
 }
 
 static void mc_gather_timing_samples() {
@@ -52,6 +52,7 @@
 #include "session_cas.h"
 #include "settings.h"
 #include "ssl_utils.h"
+#include "stats.h"
 #include "subdocument.h"
 #include <logger/logger.h>
 #include <mcbp/protocol/header.h>
@@ -67,6 +68,10 @@ std::array<bool, 0x100>&  topkey_commands = get_mcbp_topkeys();
 void update_topkeys(const Cookie& cookie) {
     const auto opcode = cookie.getHeader().getOpcode();
     if (topkey_commands[opcode]) {
+        const auto weight = get_stats_sample_weight(SampledStat::Topkeys);
+        if (weight == 0) {
+            return;
+        }
         auto& bucket = cookie.getConnection().getBucket();
         const auto key = cookie.getRequestKey();
         // MB-32828: ChesireCat will deprecate top-keys and until removal
@@ -76,7 +81,8 @@ void update_topkeys(const Cookie& cookie) {
             const auto defaultKey = key.makeDocKeyWithoutCollectionID();
             bucket.topkeys->updateKey(defaultKey.data(),
                                       defaultKey.size(),
-                                      mc_time_get_current_time());
+                                      mc_time_get_current_time(),
+                                      weight);
         }
     }
 }
@@ -205,6 +205,7 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
 
     setup(cb::mcbp::ClientOpcode::EvictKey, require<Privilege::NodeManagement>);
     setup(cb::mcbp::ClientOpcode::GetLocked, require<Privilege::Read>);
+    setup(cb::mcbp::ClientOpcode::GetLockedMeta, require<Privilege::Read>);
     setup(cb::mcbp::ClientOpcode::UnlockKey, require<Privilege::Read>);
 
     /**
@@ -224,6 +225,12 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
     setup(cb::mcbp::ClientOpcode::AddqWithMeta, require<Privilege::MetaWrite>);
     setup(cb::mcbp::ClientOpcode::DelWithMeta, require<Privilege::MetaWrite>);
     setup(cb::mcbp::ClientOpcode::DelqWithMeta, require<Privilege::MetaWrite>);
+    /**
+     * The engine checks the privilege against the collection of each of
+     * the documents in the batch
+     */
+    setup(cb::mcbp::ClientOpcode::SetWithMetaBatch,
+          require<Privilege::MetaWrite>);
 
     /**
      * Command to create a new checkpoint on a given vbucket by force
@@ -275,6 +282,14 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
      * Command to get all keys
      */
     setup(cb::mcbp::ClientOpcode::GetKeys, require<Privilege::Read>);
+    /**
+     * Command to scan a range of keys
+     */
+    setup(cb::mcbp::ClientOpcode::RangeScan, require<Privilege::Read>);
+    /**
+     * Command to sample the documents of a collection
+     */
+    setup(cb::mcbp::ClientOpcode::SampleDocuments, require<Privilege::Read>);
 
     /**
      * Commands for the Sub-document API.
@@ -28,9 +28,13 @@
 #include <memcached/durability_spec.h>
 #include <memcached/protocol_binary.h>
 #include <nlohmann/json.hpp>
+#include <platform/compress.h>
 #include <platform/string_hex.h>
 #include <utilities/engine_errc_2_mcbp.h>
 
+#include <array>
+#include <cstring>
+
 using cb::mcbp::Status;
 
 static bool is_valid_xattr_blob(Cookie& cookie,
@@ -42,9 +46,9 @@ static bool is_valid_xattr_blob(Cookie& cookie,
     return cb::xattr::validate(cookie.getInflatedInputPayload());
 }
 
-bool is_document_key_valid(Cookie& cookie) {
-    const auto& req = cookie.getRequest();
-    const auto& key = req.getKey();
+/// Is the key (the request key, or a key in the value of the request)
+/// a valid document key for the connection
+static bool is_document_key_valid(Cookie& cookie, cb::const_byte_buffer key) {
     if (!cookie.getConnection().isCollectionsSupported()) {
         return true;
     }
@@ -99,6 +103,10 @@ bool is_document_key_valid(Cookie& cookie) {
     return rv;
 }
 
+bool is_document_key_valid(Cookie& cookie) {
+    return is_document_key_valid(cookie, cookie.getRequest().getKey());
+}
+
 static inline bool may_accept_dcp_deleteV2(const Cookie& cookie) {
     return cookie.getConnection().isDcpDeleteV2();
 }
@@ -111,6 +119,36 @@ using ExpectedKeyLen = McbpValidator::ExpectedKeyLen;
 using ExpectedValueLen = McbpValidator::ExpectedValueLen;
 using ExpectedCas = McbpValidator::ExpectedCas;
 
+/**
+ * Is the request a plain request with the given extras length: without
+ * frame extras (the magic is ClientRequest) and with no datatype set?
+ * That's the case for most of the gets and sets, and there is nothing to
+ * check in their datatype or frame extras. The magic, extras length and
+ * datatype are checked with a single compare of the first 8 bytes of the
+ * header.
+ */
+static bool is_plain_request(const cb::mcbp::Header& header, uint8_t extlen) {
+    static_assert(sizeof(cb::mcbp::Header) >= sizeof(uint64_t),
+                  "The header must hold the word compared");
+    const std::array<uint8_t, 8> mask = {{0xff, 0, 0, 0, 0xff, 0xff, 0, 0}};
+    const std::array<uint8_t, 8> expected = {
+            {uint8_t(cb::mcbp::Magic::ClientRequest),
+             0,
+             0,
+             0,
+             extlen,
+             PROTOCOL_BINARY_RAW_BYTES,
+             0,
+             0}};
+    uint64_t word;
+    uint64_t maskWord;
+    uint64_t expectedWord;
+    std::memcpy(&word, &header, sizeof(word));
+    std::memcpy(&maskWord, mask.data(), sizeof(maskWord));
+    std::memcpy(&expectedWord, expected.data(), sizeof(expectedWord));
+    return (word & maskWord) == expectedWord;
+}
+
 /**
  * Verify the header meets basic sanity checks and fields length
  * match the provided expected lengths.
@@ -126,20 +164,24 @@ Status McbpValidator::verify_header(Cookie& cookie,
                                     uint8_t expected_datatype_mask) {
     const auto& header = cookie.getHeader();
     auto& connection = cookie.getConnection();
+    const bool plain = is_plain_request(header, expected_extlen);
 
-    if (!mcbp::datatype::is_valid(header.getDatatype())) {
-        cookie.setErrorContext("Request datatype invalid");
-        return Status::Einval;
-    }
+    if (!plain) {
+        if (!mcbp::datatype::is_valid(header.getDatatype())) {
+            cookie.setErrorContext("Request datatype invalid");
+            return Status::Einval;
+        }
 
-    if ((expected_extlen == 0) && (header.getExtlen() != 0)) {
-        cookie.setErrorContext("Request must not include extras");
-        return Status::Einval;
-    }
-    if ((expected_extlen != 0) && (header.getExtlen() != expected_extlen)) {
-        cookie.setErrorContext("Request must include extras of length " +
-                               std::to_string(expected_extlen));
-        return Status::Einval;
+        if ((expected_extlen == 0) && (header.getExtlen() != 0)) {
+            cookie.setErrorContext("Request must not include extras");
+            return Status::Einval;
+        }
+        if ((expected_extlen != 0) &&
+            (header.getExtlen() != expected_extlen)) {
+            cookie.setErrorContext("Request must include extras of length " +
+                                   std::to_string(expected_extlen));
+            return Status::Einval;
+        }
     }
 
     switch (expected_keylen) {
@@ -205,12 +247,12 @@ Status McbpValidator::verify_header(Cookie& cookie,
         break;
     }
 
-    if ((~expected_datatype_mask) & header.getDatatype()) {
+    if (!plain && ((~expected_datatype_mask) & header.getDatatype())) {
         cookie.setErrorContext("Request datatype invalid");
         return Status::Einval;
     }
 
-    if (!connection.isDatatypeEnabled(header.getDatatype())) {
+    if (!plain && !connection.isDatatypeEnabled(header.getDatatype())) {
         uint8_t result = 0;
         const auto datatypes = header.getDatatype();
         for (int ii = 0; ii < 8; ++ii) {
@@ -237,12 +279,12 @@ Status McbpValidator::verify_header(Cookie& cookie,
         return Status::Einval;
     }
 
-    if (!is_valid_xattr_blob(cookie, request)) {
+    if (!plain && !is_valid_xattr_blob(cookie, request)) {
         cookie.setErrorContext("The provided xattr segment is not valid");
         return Status::XattrEinval;
     }
 
-    // Validate the frame id's
+    // Validate the frame id's (there are none in a plain request)
     auto status = Status::Success;
     auto opcode = request.getClientOpcode();
 
@@ -349,6 +391,23 @@ Status McbpValidator::verify_header(Cookie& cookie,
                             "PreserveTtl should not contain value");
                 }
                 return status == Status::Success;
+            case cb::mcbp::request::FrameInfoId::Deadline:
+                if (data.size() != sizeof(uint16_t)) {
+                    status = Status::Einval;
+                    cookie.setErrorContext("Deadline invalid size:" +
+                                           std::to_string(data.size()));
+                    return false;
+                } else {
+                    const auto timeout = ntohs(
+                            *reinterpret_cast<const uint16_t*>(data.data()));
+                    if (timeout == 0) {
+                        status = Status::Einval;
+                        cookie.setErrorContext("Deadline cannot be 0");
+                        return false;
+                    }
+                    cookie.setDeadline(std::chrono::milliseconds{timeout});
+                }
+                return true;
             } // switch (id)
             status = Status::UnknownFrameInfo;
             return false;
@@ -1296,6 +1355,30 @@ static Status get_validator(Cookie& cookie) {
     return Status::Success;
 }
 
+static Status get_replica_validator(Cookie& cookie) {
+    // The consistency token is optional
+    auto& header = cookie.getHeader();
+    if (header.getExtlen() != 0 &&
+        header.getExtlen() != sizeof(cb::mcbp::request::GetReplicaPayload)) {
+        return Status::Einval;
+    }
+
+    auto status = McbpValidator::verify_header(cookie,
+                                               header.getExtlen(),
+                                               ExpectedKeyLen::NonZero,
+                                               ExpectedValueLen::Zero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+    if (!is_document_key_valid(cookie)) {
+        return Status::Einval;
+    }
+
+    return Status::Success;
+}
+
 static Status gat_validator(Cookie& cookie) {
     auto status =
             McbpValidator::verify_header(cookie,
@@ -1720,6 +1803,90 @@ static Status mutate_with_meta_validator(Cookie& cookie) {
     return Status::Success;
 }
 
+static Status set_with_meta_batch_validator(Cookie& cookie) {
+    auto& header = cookie.getHeader();
+    // The extras are either empty or the (4-byte) options
+    auto status = McbpValidator::verify_header(cookie,
+                                               header.getExtlen(),
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::NonZero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+    if (header.getExtlen() != 0 && header.getExtlen() != sizeof(uint32_t)) {
+        cookie.setErrorContext("Request extras invalid");
+        return Status::Einval;
+    }
+
+    using cb::mcbp::request::SetWithMetaBatchEntry;
+    auto& connection = cookie.getConnection();
+    auto value = header.getValue();
+    size_t offset = 0;
+    while (offset < value.size()) {
+        if (value.size() - offset < sizeof(SetWithMetaBatchEntry)) {
+            cookie.setErrorContext("Document " + std::to_string(offset) +
+                                   " truncated");
+            return Status::Einval;
+        }
+        const auto& entry = *reinterpret_cast<const SetWithMetaBatchEntry*>(
+                value.data() + offset);
+        if (value.size() - offset < entry.getSize()) {
+            cookie.setErrorContext("Document " + std::to_string(offset) +
+                                   " truncated");
+            return Status::Einval;
+        }
+
+        const auto key = entry.getKey();
+        if (key.empty() || (!connection.isCollectionsSupported() &&
+                            key.size() > KEY_MAX_LENGTH)) {
+            cookie.setErrorContext("Document " + std::to_string(offset) +
+                                   " key length invalid");
+            return Status::Einval;
+        }
+        if (!is_document_key_valid(cookie, key)) {
+            return Status::Einval;
+        }
+
+        const auto datatype = entry.getDatatype();
+        if (!mcbp::datatype::is_valid(datatype) ||
+            !connection.isDatatypeEnabled(datatype)) {
+            cookie.setErrorContext("Document " + std::to_string(offset) +
+                                   " datatype invalid");
+            return Status::Einval;
+        }
+
+        if (mcbp::datatype::is_xattr(datatype)) {
+            const auto doc = entry.getValue();
+            std::string_view blob{reinterpret_cast<const char*>(doc.data()),
+                                  doc.size()};
+            cb::compression::Buffer inflated;
+            if (mcbp::datatype::is_snappy(datatype)) {
+                if (!cb::compression::inflate(
+                            cb::compression::Algorithm::Snappy,
+                            blob,
+                            inflated)) {
+                    cookie.setErrorContext("Document " +
+                                           std::to_string(offset) +
+                                           " failed to inflate");
+                    return Status::Einval;
+                }
+                blob = {inflated.data(), inflated.size()};
+            }
+            if (!cb::xattr::validate(blob)) {
+                cookie.setErrorContext("Document " + std::to_string(offset) +
+                                       " xattr segment is not valid");
+                return Status::XattrEinval;
+            }
+        }
+
+        offset += entry.getSize();
+    }
+
+    return Status::Success;
+}
+
 static Status get_errmap_validator(Cookie& cookie) {
     auto status = McbpValidator::verify_header(cookie,
                                                0,
@@ -1930,6 +2097,33 @@ static Status get_random_key_validator(Cookie& cookie) {
                                         PROTOCOL_BINARY_RAW_BYTES);
 }
 
+static Status sample_documents_validator(Cookie& cookie) {
+    using cb::mcbp::request::SampleDocumentsPayload;
+    // The count, followed by the collection-id on collection connections
+    uint8_t extras = sizeof(uint32_t);
+    if (cookie.getConnection().isCollectionsSupported()) {
+        extras = sizeof(SampleDocumentsPayload);
+    }
+    auto status = McbpValidator::verify_header(cookie,
+                                               extras,
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::Zero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    const auto extdata = cookie.getHeader().getRequest().getExtdata();
+    const auto& payload =
+            *reinterpret_cast<const SampleDocumentsPayload*>(extdata.data());
+    if (payload.getCount() == 0) {
+        cookie.setErrorContext("The sample must have at least one document");
+        return Status::Einval;
+    }
+    return Status::Success;
+}
+
 /**
  * The SetVbucket may contain 3 different encodings:
  *
@@ -2061,6 +2255,41 @@ static Status get_keys_validator(Cookie& cookie) {
     return Status::Success;
 }
 
+static Status range_scan_validator(Cookie& cookie) {
+    using cb::mcbp::request::RangeScanFlags;
+    using cb::mcbp::request::RangeScanPayload;
+    auto status = McbpValidator::verify_header(cookie,
+                                               sizeof(RangeScanPayload),
+                                               ExpectedKeyLen::NonZero,
+                                               ExpectedValueLen::Any,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    if (!is_document_key_valid(cookie)) {
+        return Status::Einval;
+    }
+
+    auto extras = cookie.getHeader().getExtdata();
+    const auto* payload =
+            reinterpret_cast<const RangeScanPayload*>(extras.data());
+    const auto knownFlags = uint32_t(RangeScanFlags::KeyOnly) |
+                            uint32_t(RangeScanFlags::Prefix);
+    if ((payload->getFlags() & ~knownFlags) != 0) {
+        cookie.setErrorContext("Request contains invalid flags");
+        return Status::Einval;
+    }
+
+    if (payload->isPrefix() && !cookie.getHeader().getValue().empty()) {
+        cookie.setErrorContext("A prefix scan cannot have an end key");
+        return Status::Einval;
+    }
+
+    return Status::Success;
+}
+
 static Status set_param_validator(Cookie& cookie) {
     using cb::mcbp::request::SetParamPayload;
     auto status = McbpValidator::verify_header(cookie,
@@ -2353,6 +2582,7 @@ McbpValidator::McbpValidator() {
     setup(cb::mcbp::ClientOpcode::DelqWithMeta, mutate_with_meta_validator);
     setup(cb::mcbp::ClientOpcode::GetErrorMap, get_errmap_validator);
     setup(cb::mcbp::ClientOpcode::GetLocked, get_locked_validator);
+    setup(cb::mcbp::ClientOpcode::GetLockedMeta, get_locked_validator);
     setup(cb::mcbp::ClientOpcode::UnlockKey, unlock_validator);
     setup(cb::mcbp::ClientOpcode::UpdateExternalUserPermissions,
           update_user_permissions_validator);
@@ -2376,6 +2606,7 @@ McbpValidator::McbpValidator() {
     setup(cb::mcbp::ClientOpcode::AdjustTimeofday, adjust_timeofday_validator);
     setup(cb::mcbp::ClientOpcode::EwouldblockCtl, ewb_validator);
     setup(cb::mcbp::ClientOpcode::GetRandomKey, get_random_key_validator);
+    setup(cb::mcbp::ClientOpcode::SampleDocuments, sample_documents_validator);
     setup(cb::mcbp::ClientOpcode::SetVbucket, set_vbucket_validator);
     setup(cb::mcbp::ClientOpcode::DelVbucket, del_vbucket_validator);
     setup(cb::mcbp::ClientOpcode::GetVbucket, get_vbucket_validator);
@@ -2388,8 +2619,11 @@ McbpValidator::McbpValidator() {
     setup(cb::mcbp::ClientOpcode::DisableTraffic,
           enable_disable_traffic_validator);
     setup(cb::mcbp::ClientOpcode::GetKeys, get_keys_validator);
+    setup(cb::mcbp::ClientOpcode::RangeScan, range_scan_validator);
+    setup(cb::mcbp::ClientOpcode::SetWithMetaBatch,
+          set_with_meta_batch_validator);
     setup(cb::mcbp::ClientOpcode::SetParam, set_param_validator);
-    setup(cb::mcbp::ClientOpcode::GetReplica, get_validator);
+    setup(cb::mcbp::ClientOpcode::GetReplica, get_replica_validator);
     setup(cb::mcbp::ClientOpcode::ReturnMeta, return_meta_validator);
     setup(cb::mcbp::ClientOpcode::SeqnoPersistence,
           seqno_persistence_validator);
@@ -46,6 +46,7 @@
 #include "topkeys.h"
 #include "tracing.h"
 #include "utilities/terminate_handler.h"
+#include "workload_capture.h"
 
 #include <cbsasl/logging.h>
 #include <cbsasl/mechanism.h>
@@ -57,6 +58,7 @@
 #include <phosphor/phosphor.h>
 #include <platform/dirutils.h>
 #include <platform/interrupt.h>
+#include <platform/platform_thread.h>
 #include <platform/strerror.h>
 #include <platform/sysinfo.h>
 #include <statistics/prometheus.h>
@@ -113,6 +115,7 @@ bool is_memcached_shutting_down() {
 }
 
 std::unique_ptr<cb::ExecutorPool> executorPool;
+std::unique_ptr<cb::ExecutorPool> authExecutorPool;
 
 /* Mutex for global stats */
 std::mutex stats_mutex;
@@ -201,6 +204,8 @@ bool associate_bucket(Connection& connection, const char* name) {
         connection.setBucketIndex(0);
     }
 
+    // The bucket may be served by a different set of front-end threads
+    connection.requestThreadMigration();
     return found;
 }
 
@@ -385,6 +390,11 @@ static void scramsha_fallback_salt_changed_listener(const std::string&,
     cb::sasl::server::set_scramsha_fallback_salt(s.getScramshaFallbackSalt());
 }
 
+static void scram_key_cache_size_changed_listener(const std::string&,
+                                                  Settings& s) {
+    cb::sasl::server::set_scram_key_cache_size(s.getScramKeyCacheSize());
+}
+
 static void opcode_attributes_override_changed_listener(const std::string&,
                                                         Settings& s) {
     try {
@@ -435,6 +445,24 @@ static std::string configure_numa_policy() {
 }
 #endif  // HAVE_LIBNUMA
 
+/**
+ * (Re)start the workload capture with the current settings (or stop it if
+ * workload_capture_file is empty)
+ */
+static void workload_capture_changed_listener(const std::string&,
+                                              Settings& s) {
+    const auto file = s.getWorkloadCaptureFile();
+    if (file.empty()) {
+        WorkloadCapture::instance().stop();
+        return;
+    }
+    try {
+        WorkloadCapture::instance().start(file, s.isWorkloadCaptureHashKeys());
+    } catch (const std::exception& e) {
+        LOG_WARNING("Failed to start the workload capture: {}", e.what());
+    }
+}
+
 static void settings_init() {
     auto& settings = Settings::instance();
 
@@ -443,6 +471,12 @@ static void settings_init() {
                                            interfaces_changed_listener);
     settings.addChangeListener(
             "scramsha_fallback_salt", scramsha_fallback_salt_changed_listener);
+    settings.addChangeListener("scram_key_cache_size",
+                               scram_key_cache_size_changed_listener);
+    settings.addChangeListener("workload_capture_file",
+                               workload_capture_changed_listener);
+    settings.addChangeListener("workload_capture_hash_keys",
+                               workload_capture_changed_listener);
     settings.addChangeListener(
             "active_external_users_push_interval",
             [](const std::string&, Settings& s) -> void {
@@ -451,6 +485,14 @@ static void settings_init() {
                             s.getActiveExternalUsersPushInterval());
                 }
             });
+    settings.addChangeListener(
+            "external_auth_cache_ttl",
+            [](const std::string&, Settings& s) -> void {
+                if (externalAuthManager) {
+                    externalAuthManager->setAuthCacheTtl(
+                            s.getExternalAuthCacheTtl());
+                }
+            });
 
     NetworkInterface default_interface;
     settings.addInterface(default_interface);
@@ -555,6 +597,18 @@ static void settings_init() {
                                [](const std::string&, Settings&) -> void {
                                    invalidateSslCache();
                                });
+    settings.addChangeListener("ssl_kernel_offload",
+                               [](const std::string&, Settings&) -> void {
+                                   invalidateSslCache();
+                               });
+    settings.addChangeListener("ssl_session_tickets",
+                               [](const std::string&, Settings&) -> void {
+                                   invalidateSslCache();
+                               });
+    settings.addChangeListener("ssl_session_ticket_rotation",
+                               [](const std::string&, Settings&) -> void {
+                                   invalidateSslCache();
+                               });
     settings.addChangeListener("ssl_cipher_list",
                                [](const std::string&, Settings&) -> void {
                                    invalidateSslCache();
@@ -914,6 +968,33 @@ void CreateBucketThread::run()
     task->makeRunnable();
 }
 
+/**
+ * The engines of the buckets deleted with force which are still shutting
+ * down. Their bucket entry is released before the engine is destroyed, so
+ * that a bucket with the same name may be created right away.
+ */
+static struct {
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t pending = 0;
+} detachedEngines;
+
+static void destroyDetachedEngine(std::string name, unique_engine_ptr engine) {
+    {
+        std::lock_guard<std::mutex> guard(detachedEngines.mutex);
+        ++detachedEngines.pending;
+    }
+    std::thread([name = std::move(name), engine = std::move(engine)]() mutable {
+        cb_set_thread_name("mc:bucket_del");
+        engine.get_deleter().force = true;
+        engine.reset();
+        LOG_INFO("Delete bucket [{}]. Engine shut down", name);
+        std::lock_guard<std::mutex> guard(detachedEngines.mutex);
+        --detachedEngines.pending;
+        detachedEngines.cond.notify_all();
+    }).detach();
+}
+
 void DestroyBucketThread::destroy() {
     ENGINE_ERROR_CODE ret = ENGINE_KEY_ENOENT;
     std::unique_lock<std::mutex> all_bucket_lock(buckets_lock);
@@ -1078,6 +1159,22 @@ void DestroyBucketThread::destroy() {
         }
     }
 
+    if (force) {
+        // Nothing is to be written back, so the engine doesn't need the
+        // bucket entry to stop its tasks and close its files. Release the
+        // entry (which allows the bucket to be recreated) and complete the
+        // request now, and shut down the engine in the background
+        LOG_INFO("{} Delete bucket [{}]. Shut down the bucket in the "
+                 "background",
+                 connection_id,
+                 name);
+        destroyDetachedEngine(name, bucket.releaseEngine());
+        bucket.reset();
+        LOG_INFO("{} Delete bucket [{}] complete", connection_id, name);
+        result = ENGINE_SUCCESS;
+        return;
+    }
+
     LOG_INFO(
             "{} Delete bucket [{}]. Shut down the bucket", connection_id, name);
     bucket.destroyEngine(force);
@@ -1220,6 +1317,15 @@ void delete_all_buckets() {
             LOG_INFO("Bucket {} deleted", name);
         }
     } while (!done);
+
+    // Wait for the engines of the buckets deleted with force to shut down
+    std::unique_lock<std::mutex> guard(detachedEngines.mutex);
+    if (detachedEngines.pending > 0) {
+        LOG_INFO("Waiting for {} deleted bucket(s) to shut down",
+                 detachedEngines.pending);
+        detachedEngines.cond.wait(
+                guard, [] { return detachedEngines.pending == 0; });
+    }
 }
 
 /**
@@ -1254,6 +1360,8 @@ static void initialize_sasl() {
     using namespace cb::sasl;
     logging::set_log_callback(sasl_log_callback);
     server::initialize();
+    server::set_scram_key_cache_size(
+            Settings::instance().getScramKeyCacheSize());
     set_default_bucket_enabled(
             mechanism::plain::authenticate("default", "") == Error::OK);
 
@@ -1401,6 +1509,8 @@ int memcached_main(int argc, char** argv) {
     externalAuthManager = std::make_unique<ExternalAuthManagerThread>();
     externalAuthManager->setPushActiveUsersInterval(
             Settings::instance().getActiveExternalUsersPushInterval());
+    externalAuthManager->setAuthCacheTtl(
+            Settings::instance().getExternalAuthCacheTtl());
     externalAuthManager->start();
 
     initialize_audit();
@@ -1450,8 +1560,16 @@ int memcached_main(int argc, char** argv) {
     /* start up worker threads if MT mode */
     worker_threads_init();
 
+    if (Settings::instance().isReusePortListenersEnabled()) {
+        networkInterfaceManager->startAcceptSharding();
+    }
+
     executorPool = std::make_unique<cb::ExecutorPool>(
             Settings::instance().getNumWorkerThreads());
+    if (Settings::instance().getNumAuthThreads() != 0) {
+        authExecutorPool = std::make_unique<cb::ExecutorPool>(
+                Settings::instance().getNumAuthThreads());
+    }
 
     initializeTracing();
     TRACE_GLOBAL0("memcached", "Started");
@@ -1495,6 +1613,9 @@ int memcached_main(int argc, char** argv) {
     LOG_INFO("Shutting down client worker threads");
     threads_shutdown();
 
+    LOG_INFO("Stopping the workload capture");
+    WorkloadCapture::instance().stop();
+
     LOG_INFO("Releasing server sockets");
     networkInterfaceManager.reset();
 
@@ -1508,6 +1629,7 @@ int memcached_main(int argc, char** argv) {
     threads_cleanup();
 
     LOG_INFO("Shutting down executor pool");
+    authExecutorPool.reset();
     executorPool.reset();
 
     LOG_INFO("Releasing signal handlers");
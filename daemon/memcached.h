@@ -61,12 +61,36 @@ void threads_cleanup();
 bool create_nonblocking_socketpair(std::array<SOCKET, 2>& sockets);
 
 class ListeningPort;
+struct FrontEndThread;
 void dispatch_conn_new(SOCKET sfd, std::shared_ptr<ListeningPort>& interface);
+/**
+ * Create the connection for a client accepted by the front-end thread which
+ * is going to serve it (must be called from that thread)
+ */
+void dispatch_conn_new_local(SOCKET sfd,
+                             std::shared_ptr<ListeningPort>& interface,
+                             FrontEndThread& thread);
+
+/**
+ * Get the front-end thread a connection should move to in order to be
+ * served by the threads of its bucket (see the "bucket_thread_reservations"
+ * setting)
+ *
+ * @return the thread to move to, or nullptr if the connection is already
+ *         served by one of the threads of its bucket
+ */
+FrontEndThread* select_bucket_thread(const Connection& connection);
+
+void iterate_all_front_end_threads(
+        std::function<void(FrontEndThread&)> callback);
 
 void threadlocal_stats_reset(std::vector<thread_stats>& thread_stats);
 
 void notify_io_complete(gsl::not_null<const void*> cookie,
                         ENGINE_ERROR_CODE status);
+void notify_io_complete_batch(
+        gsl::span<const std::pair<const void*, ENGINE_ERROR_CODE>>
+                notifications);
 void safe_close(SOCKET sfd);
 int add_conn_to_pending_io_list(Connection* c,
                                 Cookie* cookie,
@@ -104,6 +128,12 @@ class ExecutorPool;
 }
 extern std::unique_ptr<cb::ExecutorPool> executorPool;
 
+/**
+ * The executor pool running the SASL authentication tasks (not set if
+ * num_auth_threads is 0, in which case they're run by executorPool)
+ */
+extern std::unique_ptr<cb::ExecutorPool> authExecutorPool;
+
 void iterate_all_connections(std::function<void(Connection&)> callback);
 
 void start_stdin_listener(std::function<void()> function);
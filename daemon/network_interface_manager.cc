@@ -339,6 +339,18 @@ static SOCKET new_server_socket(struct addrinfo* ai) {
                     cb_strerror(cb::net::get_socket_error()));
     }
 
+#ifdef SO_REUSEPORT
+    if (Settings::instance().isReusePortListenersEnabled() &&
+        cb::net::setsockopt(sfd,
+                            SOL_SOCKET,
+                            SO_REUSEPORT,
+                            reinterpret_cast<const void*>(&flags),
+                            sizeof(flags)) != 0) {
+        LOG_WARNING("setsockopt(SO_REUSEPORT): {}",
+                    cb_strerror(cb::net::get_socket_error()));
+    }
+#endif
+
     if (cb::net::setsockopt(sfd,
                             SOL_SOCKET,
                             SO_KEEPALIVE,
@@ -360,6 +372,60 @@ static SOCKET new_server_socket(struct addrinfo* ai) {
     return sfd;
 }
 
+void NetworkInterfaceManager::startAcceptSharding() {
+    acceptSharding = true;
+    for (auto& connection : listen_conn) {
+        if (!connection->isSharded()) {
+            shardListener(*connection);
+        }
+    }
+}
+
+void NetworkInterfaceManager::shardListener(ServerSocket& listener) {
+#ifdef SO_REUSEPORT
+    sockaddr_storage addr{};
+    socklen_t len = sizeof(addr);
+    if (getsockname(listener.getSocket(),
+                    reinterpret_cast<sockaddr*>(&addr),
+                    &len) != 0) {
+        LOG_WARNING("Failed to look up the address of {}: {}",
+                    listener.getSocket(),
+                    cb_strerror(cb::net::get_socket_error()));
+        return;
+    }
+
+    addrinfo ai = {};
+    ai.ai_family = addr.ss_family;
+    ai.ai_socktype = SOCK_STREAM;
+    ai.ai_protocol = IPPROTO_TCP;
+    ai.ai_addr = reinterpret_cast<sockaddr*>(&addr);
+    ai.ai_addrlen = len;
+
+    // Every front-end thread gets its own socket in the SO_REUSEPORT group
+    // so that the kernel spreads the incoming connections between them
+    // (the listener owned by the dispatcher stays in the group)
+    iterate_all_front_end_threads([&listener, &ai](FrontEndThread& thread) {
+        auto sfd = new_server_socket(&ai);
+        if (sfd == INVALID_SOCKET) {
+            LOG_WARNING("Failed to create listener shard for worker thread {}",
+                        thread.index);
+            return;
+        }
+        if (bind(sfd, ai.ai_addr, ai.ai_addrlen) == SOCKET_ERROR) {
+            LOG_WARNING("Failed to bind listener shard for worker thread "
+                        "{}: {}",
+                        thread.index,
+                        cb_strerror(cb::net::get_socket_error()));
+            safe_close(sfd);
+            return;
+        }
+        listener.addShard(sfd, thread);
+    });
+#else
+    (void)listener;
+#endif
+}
+
 bool NetworkInterfaceManager::createInterface(const std::string& tag,
                                               const std::string& host,
                                               in_port_t port,
@@ -492,6 +558,9 @@ bool NetworkInterfaceManager::createInterface(const std::string& tag,
         listen_conn.emplace_back(std::make_unique<ServerSocket>(
                 sfd, event_get_base(event.get()), inter));
         stats.curr_conns.fetch_add(1, std::memory_order_relaxed);
+        if (acceptSharding) {
+            shardListener(*listen_conn.back());
+        }
     }
 
     freeaddrinfo(ai);
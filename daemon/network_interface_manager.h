@@ -47,6 +47,14 @@ public:
      */
     void signal();
 
+    /**
+     * Give each front-end thread its own SO_REUSEPORT listener for all
+     * of the current (and future) interfaces so that new clients are
+     * accepted on the thread which is going to serve them. Must be called
+     * once the front-end threads are running.
+     */
+    void startAcceptSharding();
+
 protected:
     /**
      * Create the file containing all of the interfaces we're currently
@@ -72,6 +80,10 @@ protected:
                          NetworkInterface::Protocol iv4,
                          NetworkInterface::Protocol iv6);
 
+    /// Add a listener for each front-end thread bound to the same
+    /// address as the provided listener
+    void shardListener(ServerSocket& listener);
+
     /// The event handler called from libevent
     void event_handler();
 
@@ -88,6 +100,8 @@ protected:
     cb::libevent::unique_event_ptr event;
     std::atomic_bool check_listen_conn{};
     std::vector<std::unique_ptr<ServerSocket>> listen_conn;
+    /// Set once the front-end threads accept clients on their own sockets
+    bool acceptSharding = false;
 };
 
 /// The one and only instance of the network interface manager.
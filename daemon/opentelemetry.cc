@@ -20,11 +20,14 @@
 #include "cookie_trace_context.h"
 #include "log_macros.h"
 
+#include <folly/MPMCQueue.h>
 #include <mcbp/protocol/request.h>
-#include <sstream>
-
 #include <platform/thread.h>
 
+#include <atomic>
+#include <sstream>
+#include <vector>
+
 namespace cb {
 using Thread = Couchbase::Thread;
 using ThreadState = Couchbase::ThreadState;
@@ -34,16 +37,21 @@ std::unique_ptr<OpenTelemetry> OpenTelemetry::instance;
 
 class OpenTelemetryThread : public OpenTelemetry, public cb::Thread {
 public:
+    /// The maximum number of trace contexts waiting to be exported; pushes
+    /// beyond this are dropped rather than blocking the front-end thread
+    static constexpr size_t QueueCapacity = 10000;
+    /// The maximum number of trace contexts exported in one batch
+    static constexpr size_t MaxBatchSize = 512;
+    /// How long the exporter waits for a trace context before checking if
+    /// it should stop
+    static constexpr std::chrono::milliseconds PollInterval{100};
+
     explicit OpenTelemetryThread(const OpenTelemetryConfig& config)
         : OpenTelemetry(config), cb::Thread("mcd:trace") {
     }
 
     void stop() {
-        {
-            std::lock_guard<std::mutex> guard(mutex);
-            running = false;
-        }
-        condition_variable.notify_all();
+        running = false;
     }
 
 protected:
@@ -54,67 +62,78 @@ protected:
                  std::chrono::steady_clock::time_point steady_now,
                  const CookieTraceContext& entry);
 
-    /// move all of the contents to the internal list. We live under
-    /// the assumption that only a few commands contains trace requests
-    /// so there won't be too many elemnets.
+    /// Export a batch of trace contexts
+    void exportBatch(
+            const std::vector<std::unique_ptr<CookieTraceContext>>& batch);
+
+    /// Queue the context for the exporter thread. This never blocks the
+    /// (front-end) calling thread: the queue is lock-free and, if the
+    /// exporter has fallen behind and the queue is full, the context is
+    /// dropped and counted.
     void push(CookieTraceContext& context) override {
-        {
-            std::lock_guard<std::mutex> guard(mutex);
-            contexts.push_back(std::move(context));
+        if (!queue.write(
+                    std::make_unique<CookieTraceContext>(std::move(context)))) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
         }
-        condition_variable.notify_all();
     }
 
-    bool running = true;
+    std::atomic<bool> running{true};
 
-    /// The mutex variable used to protect access to _all_ the internal
-    /// members
-    std::mutex mutex;
-    /// The daemon thread will block and wait on this variable when there
-    /// isn't any work to do
-    std::condition_variable condition_variable;
+    /// The trace contexts waiting to be exported
+    folly::MPMCQueue<std::unique_ptr<CookieTraceContext>> queue{QueueCapacity};
 
-    /// The list of entries to submit
-    std::vector<CookieTraceContext> contexts;
+    /// The number of trace contexts dropped as the queue was full
+    std::atomic<uint64_t> dropped{0};
 };
 
 void OpenTelemetryThread::run() {
     setRunning();
-    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<std::unique_ptr<CookieTraceContext>> batch;
+    batch.reserve(MaxBatchSize);
+    uint64_t reportedDropped = 0;
     while (running) {
-        if (contexts.empty()) {
-            // There isn't any work to do... wait until we get some
-            condition_variable.wait(
-                    lock, [this] { return !running || !contexts.empty(); });
+        // Wait for the first entry of a batch, then take whatever else is
+        // queued (up to the batch size) without waiting
+        std::unique_ptr<CookieTraceContext> entry;
+        if (!queue.tryReadUntil(std::chrono::steady_clock::now() + PollInterval,
+                                entry)) {
+            continue;
+        }
+        batch.push_back(std::move(entry));
+        while (batch.size() < MaxBatchSize && queue.read(entry)) {
+            batch.push_back(std::move(entry));
         }
-
-        // move the entries over to another vector so the clients don't have
-        // to wait while I'm working
-        std::vector<CookieTraceContext> entries{};
-        std::swap(contexts, entries);
-
-        // Release the lock to the internal variables while I process the
-        // batch of trace elements
-        lock.unlock();
 
         if (isEnabled()) {
-            // Unfortunately OpenTelemetry want system clock, and we operate
-            // with steady clocks internally.. snapshot the two and try to
-            // convert between them. (I don't want to cache this "forever"
-            // as the system clock could have been changed)
-            const auto system_now = std::chrono::system_clock::now();
-            const auto steady_now = std::chrono::steady_clock::now();
-
-            for (const auto& e : entries) {
-                pushOne(system_now, steady_now, e);
-            }
+            exportBatch(batch);
         }
 
-        // make sure we run all destructors before we're grabbing the lock
-        entries.clear();
+        // make sure we run all destructors before waiting for more
+        batch.clear();
+
+        const auto totalDropped = dropped.load(std::memory_order_relaxed);
+        if (totalDropped != reportedDropped) {
+            LOG_WARNING(
+                    "OpenTelemetry: dropped {} trace contexts as the exporter "
+                    "fell behind ({} in total)",
+                    totalDropped - reportedDropped,
+                    totalDropped);
+            reportedDropped = totalDropped;
+        }
+    }
+}
 
-        // acquire the lock
-        lock.lock();
+void OpenTelemetryThread::exportBatch(
+        const std::vector<std::unique_ptr<CookieTraceContext>>& batch) {
+    // Unfortunately OpenTelemetry want system clock, and we operate
+    // with steady clocks internally.. snapshot the two and try to
+    // convert between them. (I don't want to cache this "forever"
+    // as the system clock could have been changed)
+    const auto system_now = std::chrono::system_clock::now();
+    const auto steady_now = std::chrono::steady_clock::now();
+
+    for (const auto& e : batch) {
+        pushOne(system_now, steady_now, *e);
     }
 }
 
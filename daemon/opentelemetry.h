@@ -46,7 +46,9 @@ public:
     static void shutdown();
 
     /**
-     * Push the trace to the OpenTelemetry module
+     * Push the trace to the OpenTelemetry module. The trace is queued for
+     * the exporter thread which exports in batches; this never blocks, and
+     * the trace is dropped if the exporter has fallen too far behind.
      */
     static void pushTraceLog(CookieTraceContext&& context);
 
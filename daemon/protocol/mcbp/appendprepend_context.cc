@@ -32,13 +32,18 @@ AppendPrependCommandContext::AppendPrependCommandContext(
                    : Mode::Prepend),
       vbucket(req.getVBucket()),
       cas(req.getCas()),
-      state(State::GetItem) {
+      state(cas == 0 && !cookie.getRequest().getDurabilityRequirements()
+                    ? State::UpdateInEngine
+                    : State::GetItem) {
 }
 
 ENGINE_ERROR_CODE AppendPrependCommandContext::step() {
     auto ret = ENGINE_SUCCESS;
     do {
         switch (state) {
+        case State::UpdateInEngine:
+            ret = updateInEngine();
+            break;
         case State::GetItem:
             ret = getItem();
             break;
@@ -70,6 +75,31 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::step() {
     return ret;
 }
 
+ENGINE_ERROR_CODE AppendPrependCommandContext::updateInEngine() {
+    uint64_t ncas = 0;
+    mutation_descr_t mutation{};
+    auto ret = bucket_append_prepend(cookie,
+                                     cookie.getRequestKey(),
+                                     vbucket,
+                                     mode == Mode::Append,
+                                     cookie.getInflatedInputPayload(),
+                                     ncas,
+                                     mutation);
+    switch (ret) {
+    case ENGINE_SUCCESS:
+        sendResult(ncas, mutation);
+        state = State::Done;
+        break;
+    case ENGINE_ENOTSUP:
+        state = State::GetItem;
+        ret = ENGINE_SUCCESS;
+        break;
+    default:
+        break;
+    }
+    return ret;
+}
+
 ENGINE_ERROR_CODE AppendPrependCommandContext::getItem() {
     auto ret = bucket_get(cookie, cookie.getRequestKey(), vbucket);
     if (ret.first == cb::engine_errc::success) {
@@ -196,27 +226,11 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::storeItem() {
                             false);
 
     if (ret == ENGINE_SUCCESS) {
-        update_topkeys(cookie);
-        cookie.setCas(ncas);
-        if (connection.isSupportsMutationExtras()) {
-            item_info newItemInfo;
-            if (!bucket_get_item_info(
-                        connection, newitem.get(), &newItemInfo)) {
-                return ENGINE_FAILED;
-            }
-            mutation_descr_t extras = {};
-            extras.vbucket_uuid = htonll(newItemInfo.vbucket_uuid);
-            extras.seqno = htonll(newItemInfo.seqno);
-            cookie.sendResponse(
-                    cb::mcbp::Status::Success,
-                    {reinterpret_cast<const char*>(&extras), sizeof(extras)},
-                    {},
-                    {},
-                    cb::mcbp::Datatype::Raw,
-                    ncas);
-        } else {
-            cookie.sendResponse(cb::mcbp::Status::Success);
+        item_info newItemInfo;
+        if (!bucket_get_item_info(connection, newitem.get(), &newItemInfo)) {
+            return ENGINE_FAILED;
         }
+        sendResult(ncas, {newItemInfo.vbucket_uuid, newItemInfo.seqno});
         state = State::Done;
     } else if (ret == ENGINE_KEY_EEXISTS && cas == 0) {
         state = State::Reset;
@@ -227,6 +241,26 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::storeItem() {
     return ret;
 }
 
+void AppendPrependCommandContext::sendResult(
+        uint64_t ncas, const mutation_descr_t& mutation) {
+    update_topkeys(cookie);
+    cookie.setCas(ncas);
+    if (connection.isSupportsMutationExtras()) {
+        mutation_descr_t extras = {};
+        extras.vbucket_uuid = htonll(mutation.vbucket_uuid);
+        extras.seqno = htonll(mutation.seqno);
+        cookie.sendResponse(
+                cb::mcbp::Status::Success,
+                {reinterpret_cast<const char*>(&extras), sizeof(extras)},
+                {},
+                {},
+                cb::mcbp::Datatype::Raw,
+                ncas);
+    } else {
+        cookie.sendResponse(cb::mcbp::Status::Success);
+    }
+}
+
 ENGINE_ERROR_CODE AppendPrependCommandContext::reset() {
     olditem.reset();
     newitem.reset();
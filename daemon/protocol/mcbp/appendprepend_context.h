@@ -29,6 +29,10 @@
  * the document in the underlying engine. Multiple clients operating on the
  * same document will be detected by the CAS store operation returning EEXISTS,
  * and we just retry the operation.
+ *
+ * Requests without a CAS or durability requirements are first offered to
+ * the underlying engine to perform in a single step (see
+ * EngineIface::appendPrepend).
  */
 class AppendPrependCommandContext : public SteppableCommandContext {
 public:
@@ -38,6 +42,8 @@ public:
      * implement it.
      */
     enum class State : uint8_t {
+        // Let the underlying engine perform the operation if it can
+            UpdateInEngine,
         // Look up the item to operate on
             GetItem,
         // Allocate the destination object
@@ -60,6 +66,8 @@ public:
 protected:
     ENGINE_ERROR_CODE step() override;
 
+    ENGINE_ERROR_CODE updateInEngine();
+
     ENGINE_ERROR_CODE getItem();
 
     ENGINE_ERROR_CODE allocateNewItem();
@@ -68,6 +76,9 @@ protected:
 
     ENGINE_ERROR_CODE reset();
 
+    /// Send the response for a successful update
+    void sendResult(uint64_t ncas, const mutation_descr_t& mutation);
+
 private:
     const Mode mode;
     const Vbid vbucket;
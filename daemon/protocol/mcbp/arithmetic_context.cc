@@ -35,7 +35,35 @@ ArithmeticCommandContext::ArithmeticCommandContext(Cookie& cookie,
       cas(req.getCas()),
       vbucket(req.getVBucket()),
       increment(req.getClientOpcode() == cb::mcbp::ClientOpcode::Increment ||
-                req.getClientOpcode() == cb::mcbp::ClientOpcode::Incrementq) {
+                req.getClientOpcode() == cb::mcbp::ClientOpcode::Incrementq),
+      state(cas == 0 && !cookie.getRequest().getDurabilityRequirements()
+                    ? State::UpdateInEngine
+                    : State::GetItem) {
+}
+
+ENGINE_ERROR_CODE ArithmeticCommandContext::updateInEngine() {
+    uint64_t ncas = 0;
+    auto ret = bucket_arithmetic(cookie,
+                                 cookie.getRequestKey(),
+                                 vbucket,
+                                 increment,
+                                 extras.getDelta(),
+                                 result,
+                                 ncas,
+                                 mutationDescr);
+    switch (ret) {
+    case ENGINE_SUCCESS:
+        cookie.setCas(ncas);
+        state = State::SendResult;
+        break;
+    case ENGINE_ENOTSUP:
+        state = State::GetItem;
+        ret = ENGINE_SUCCESS;
+        break;
+    default:
+        break;
+    }
+    return ret;
 }
 
 ENGINE_ERROR_CODE ArithmeticCommandContext::getItem() {
@@ -258,15 +286,20 @@ ENGINE_ERROR_CODE ArithmeticCommandContext::sendResult() {
                               sizeof(result)};
 
     if (connection.isSupportsMutationExtras()) {
-        item_info newItemInfo;
-        if (!bucket_get_item_info(connection, newitem.get(), &newItemInfo)) {
-            return ENGINE_FAILED;
+        if (newitem) {
+            item_info newItemInfo;
+            if (!bucket_get_item_info(
+                        connection, newitem.get(), &newItemInfo)) {
+                return ENGINE_FAILED;
+            }
+            mutationDescr.vbucket_uuid = newItemInfo.vbucket_uuid;
+            mutationDescr.seqno = newItemInfo.seqno;
         }
 
         // Response includes vbucket UUID and sequence number
         // (in addition to value)
-        mutation_descr.vbucket_uuid = htonll(newItemInfo.vbucket_uuid);
-        mutation_descr.seqno = htonll(newItemInfo.seqno);
+        mutation_descr.vbucket_uuid = htonll(mutationDescr.vbucket_uuid);
+        mutation_descr.seqno = htonll(mutationDescr.seqno);
     } else {
         extras = {};
     }
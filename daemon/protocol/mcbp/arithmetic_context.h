@@ -36,8 +36,14 @@ class ArithmeticCommandContext : public SteppableCommandContext {
 public:
     /**
      * The internal state diagram for performing an arithmetic operation.
-     * We've got two different paths through the state diagram depending
-     * if the counter exists or not:
+     * Requests without a CAS or durability requirements first ask the
+     * engine to update the counter in a single step:
+     *
+     *    UpdateInEngine -> SendResult -> Done
+     *
+     * If the engine doesn't support that (for the bucket or the document)
+     * we move on to GetItem, which has two different paths through the
+     * state diagram depending if the counter exists or not:
      *
      * If the document exists:
      *
@@ -57,6 +63,7 @@ public:
      * forever we give up after a 10 times.
      */
     enum class State {
+        UpdateInEngine,
         GetItem,
         CreateNewItem,
         StoreNewItem,
@@ -78,6 +85,9 @@ protected:
         auto ret = ENGINE_SUCCESS;
         do {
             switch (state) {
+            case State::UpdateInEngine:
+                ret = updateInEngine();
+                break;
             case State::GetItem:
                 ret = getItem();
                 break;
@@ -107,6 +117,8 @@ protected:
         return ret;
     }
 
+    ENGINE_ERROR_CODE updateInEngine();
+
     ENGINE_ERROR_CODE getItem();
 
     ENGINE_ERROR_CODE createNewItem();
@@ -132,5 +144,8 @@ private:
     cb::unique_item_ptr newitem;
     cb::compression::Buffer buffer;
     uint64_t result = 0;
-    State state = State::GetItem;
+    /// The vbucket uuid and seqno of the update made by the engine in
+    /// UpdateInEngine (the other paths take them from newitem)
+    mutation_descr_t mutationDescr{};
+    State state;
 };
@@ -19,8 +19,30 @@
 
 #include "engine_wrapper.h"
 #include "utilities.h"
+#include <daemon/connection.h>
+#include <daemon/cookie.h>
 #include <memcached/protocol_binary.h>
 
+/**
+ * Frames are encoded by the core, so frame_compression is handled here
+ * rather than being passed to the engine.
+ */
+static ENGINE_ERROR_CODE setFrameCompression(Cookie& cookie,
+                                             std::string_view value) {
+    auto& connection = cookie.getConnection();
+    if (value == "snappy") {
+        connection.setDcpFrameCompression(true);
+        return ENGINE_SUCCESS;
+    }
+    if (value == "none") {
+        connection.setDcpFrameCompression(false);
+        return ENGINE_SUCCESS;
+    }
+    cookie.setErrorContext("Unsupported value '" + std::string(value) +
+                           "' for ctrl parameter 'frame_compression'");
+    return ENGINE_EINVAL;
+}
+
 void dcp_control_executor(Cookie& cookie) {
     auto ret = cookie.swapAiostat(ENGINE_SUCCESS);
 
@@ -31,12 +53,16 @@ void dcp_control_executor(Cookie& cookie) {
             const auto& req = cookie.getRequest();
             const auto key = req.getKey();
             const auto val = req.getValue();
+            const std::string_view keyView{
+                    reinterpret_cast<const char*>(key.data()), key.size()};
+            const std::string_view valView{
+                    reinterpret_cast<const char*>(val.data()), val.size()};
 
-            ret = dcpControl(
-                    cookie,
-                    req.getOpaque(),
-                    {reinterpret_cast<const char*>(key.data()), key.size()},
-                    {reinterpret_cast<const char*>(val.data()), val.size()});
+            if (keyView == "frame_compression") {
+                ret = setFrameCompression(cookie, valView);
+            } else {
+                ret = dcpControl(cookie, req.getOpaque(), keyView, valView);
+            }
         }
     }
 
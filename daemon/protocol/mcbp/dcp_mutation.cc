@@ -38,8 +38,12 @@ static inline ENGINE_ERROR_CODE do_dcp_mutation(Cookie& cookie) {
                                         nmeta};
     value = {value.data(), value.size() - nmeta};
 
+    // The system xattrs of documents replicated between nodes (internal
+    // connections) were limited when the document was written, so don't
+    // parse (and possibly decompress) the value again to check them.
     uint32_t priv_bytes = 0;
-    if (mcbp::datatype::is_xattr(datatype)) {
+    if (mcbp::datatype::is_xattr(datatype) &&
+        !cookie.getConnection().isInternal()) {
         const char* payload = reinterpret_cast<const char*>(value.data());
         cb::xattr::Blob blob({const_cast<char*>(payload), value.size()},
                              mcbp::datatype::is_snappy(datatype));
@@ -35,8 +35,11 @@ void dcp_prepare_executor(Cookie& cookie) {
         const auto datatype = uint8_t(req.getDatatype());
         const auto value = req.getValue();
 
+        // As for DcpMutation, only check the system xattrs of external
+        // connections
         uint32_t priv_bytes = 0;
-        if (mcbp::datatype::is_xattr(datatype)) {
+        if (mcbp::datatype::is_xattr(datatype) &&
+            !cookie.getConnection().isInternal()) {
             const char* payload = reinterpret_cast<const char*>(value.data());
             cb::xattr::Blob blob({const_cast<char*>(payload), value.size()},
                                  mcbp::datatype::is_snappy(datatype));
@@ -132,6 +132,71 @@ ENGINE_ERROR_CODE bucket_store(
     return ret;
 }
 
+ENGINE_ERROR_CODE bucket_arithmetic(Cookie& cookie,
+                                    const DocKey& key,
+                                    Vbid vbucket,
+                                    bool increment,
+                                    uint64_t delta,
+                                    uint64_t& result,
+                                    uint64_t& cas,
+                                    mutation_descr_t& mutation) {
+    auto& c = cookie.getConnection();
+    auto ret = c.getBucketEngine().arithmetic(
+            &cookie, key, vbucket, increment, delta, result, cas, mutation);
+
+    LOG_TRACE("bucket_arithmetic() key:{} vbucket:{} incr:{} delta:{} -> {}",
+              cb::UserDataView(std::string_view{key}),
+              vbucket,
+              increment,
+              delta,
+              cb::to_engine_errc(ret));
+
+    if (ret == ENGINE_SUCCESS) {
+        using namespace cb::audit::document;
+        add(cookie, Operation::Modify);
+    } else if (ret == ENGINE_DISCONNECT) {
+        LOG_WARNING("{}: {} bucket_arithmetic return ENGINE_DISCONNECT",
+                    c.getId(),
+                    c.getDescription());
+        c.setTerminationReason("Engine forced disconnect");
+    }
+
+    return ret;
+}
+
+ENGINE_ERROR_CODE bucket_append_prepend(Cookie& cookie,
+                                        const DocKey& key,
+                                        Vbid vbucket,
+                                        bool append,
+                                        std::string_view value,
+                                        uint64_t& cas,
+                                        mutation_descr_t& mutation) {
+    auto& c = cookie.getConnection();
+    auto ret = c.getBucketEngine().appendPrepend(
+            &cookie, key, vbucket, append, value, cas, mutation);
+
+    LOG_TRACE(
+            "bucket_append_prepend() key:{} vbucket:{} append:{} size:{} -> "
+            "{}",
+            cb::UserDataView(std::string_view{key}),
+            vbucket,
+            append,
+            value.size(),
+            cb::to_engine_errc(ret));
+
+    if (ret == ENGINE_SUCCESS) {
+        using namespace cb::audit::document;
+        add(cookie, Operation::Modify);
+    } else if (ret == ENGINE_DISCONNECT) {
+        LOG_WARNING("{}: {} bucket_append_prepend return ENGINE_DISCONNECT",
+                    c.getId(),
+                    c.getDescription());
+        c.setTerminationReason("Engine forced disconnect");
+    }
+
+    return ret;
+}
+
 cb::EngineErrorCasPair bucket_store_if(
         Cookie& cookie,
         gsl::not_null<item*> item_,
@@ -209,6 +274,20 @@ cb::EngineErrorItemPair bucket_get(Cookie& cookie,
     return ret;
 }
 
+void bucket_prefetch(Cookie& cookie,
+                     const std::vector<std::pair<Vbid, DocKey>>& keys) {
+    auto& c = cookie.getConnection();
+    c.getBucketEngine().prefetch(&cookie, keys);
+    LOG_TRACE("bucket_prefetch() #keys:{}", keys.size());
+}
+
+std::optional<uint64_t> bucket_get_document_generation(Cookie& cookie,
+                                                       const DocKey& key,
+                                                       Vbid vbucket) {
+    auto& c = cookie.getConnection();
+    return c.getBucketEngine().getDocumentGeneration(&cookie, key, vbucket);
+}
+
 BucketCompressionMode bucket_get_compression_mode(Cookie& cookie) {
     auto& c = cookie.getConnection();
     return c.getBucketEngine().getCompressionMode();
@@ -63,6 +63,23 @@ ENGINE_ERROR_CODE bucket_store(
         DocumentState document_state,
         bool preserveTtl);
 
+ENGINE_ERROR_CODE bucket_arithmetic(Cookie& cookie,
+                                    const DocKey& key,
+                                    Vbid vbucket,
+                                    bool increment,
+                                    uint64_t delta,
+                                    uint64_t& result,
+                                    uint64_t& cas,
+                                    mutation_descr_t& mutation);
+
+ENGINE_ERROR_CODE bucket_append_prepend(Cookie& cookie,
+                                        const DocKey& key,
+                                        Vbid vbucket,
+                                        bool append,
+                                        std::string_view value,
+                                        uint64_t& cas,
+                                        mutation_descr_t& mutation);
+
 cb::EngineErrorCasPair bucket_store_if(
         Cookie& cookie,
         gsl::not_null<item*> item_,
@@ -100,6 +117,13 @@ cb::EngineErrorItemPair bucket_get_and_touch(
         uint32_t expiration,
         std::optional<cb::durability::Requirements> durability);
 
+void bucket_prefetch(Cookie& cookie,
+                     const std::vector<std::pair<Vbid, DocKey>>& keys);
+
+std::optional<uint64_t> bucket_get_document_generation(Cookie& cookie,
+                                                       const DocKey& key,
+                                                       Vbid vbucket);
+
 BucketCompressionMode bucket_get_compression_mode(Cookie& cookie);
 
 size_t bucket_get_max_item_size(Cookie& cookie);
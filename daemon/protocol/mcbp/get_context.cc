@@ -20,15 +20,96 @@
 
 #include <daemon/buckets.h>
 #include <daemon/debug_helpers.h>
+#include <daemon/executorpool.h>
+#include <daemon/front_end_thread.h>
 #include <daemon/mcaudit.h>
 #include <daemon/memcached.h>
 #include <daemon/sendbuffer.h>
+#include <daemon/settings.h>
 #include <logger/logger.h>
 #include <xattr/utils.h>
 #include <gsl/gsl>
 
+// The cached responses are copied to the output stream (the entry may be
+// replaced before the data is sent)
+static_assert(FrontEndThread::MaxCachedGetResponseSize <=
+                      SendBuffer::MinimumDataSize,
+              "The cached responses must be small enough to be copied");
+
+/// Get the entry of the GET response cache the key maps to
+static FrontEndThread::CachedGetResponse& getCacheEntry(
+        FrontEndThread& thread, std::string_view key) {
+    auto& cache = thread.getResponseCache;
+    return cache[std::hash<std::string_view>{}(key) % cache.size()];
+}
+
+static std::string_view getKeyWithoutCollection(const DocKey& key) {
+    const auto name = key.makeDocKeyWithoutCollectionID();
+    return {reinterpret_cast<const char*>(name.data()), name.size()};
+}
+
+bool GetCommandContext::lookupCachedResponse(const DocKey& key) {
+    const auto name = getKeyWithoutCollection(key);
+    const auto& entry = getCacheEntry(connection.getThread(), name);
+    if (entry.generation != *generation ||
+        entry.bucket != connection.getBucketIndex() ||
+        entry.vbid != vbucket || entry.collection != key.getCollectionID() ||
+        entry.key != name) {
+        return false;
+    }
+    if (mcbp::datatype::is_snappy(entry.datatype) &&
+        !connection.isSnappyEnabled()) {
+        // Not worth inflating; let the engine path deal with it
+        return false;
+    }
+
+    info.key = key;
+    info.cas = entry.cas;
+    info.flags = entry.flags;
+    info.datatype = entry.datatype;
+    payload = entry.value;
+    cached = true;
+    return true;
+}
+
+void GetCommandContext::cacheResponse() {
+    // Only cache what can be sent as-is to other connections, and what
+    // doesn't change without the document generation changing (an expiry
+    // time or a lock may time out)
+    if (!generation || !buffer.empty() || info.exptime != 0 ||
+        info.cas == LOCKED_CAS ||
+        payload.size() > FrontEndThread::MaxCachedGetResponseSize) {
+        return;
+    }
+
+    const auto name = getKeyWithoutCollection(info.key);
+    auto& entry = getCacheEntry(connection.getThread(), name);
+    try {
+        entry.bucket = connection.getBucketIndex();
+        entry.vbid = vbucket;
+        entry.collection = info.key.getCollectionID();
+        entry.key.assign(name.data(), name.size());
+        entry.generation = *generation;
+        entry.cas = info.cas;
+        entry.flags = info.flags;
+        entry.datatype = info.datatype;
+        entry.value.assign(payload.data(), payload.size());
+    } catch (const std::bad_alloc&) {
+        // The entry might be half updated; make sure it doesn't match
+        entry.bucket = -1;
+    }
+}
+
 ENGINE_ERROR_CODE GetCommandContext::getItem() {
     const auto key = cookie.getRequestKey();
+    // The generation must be read before the item, so that the item is
+    // at least as new as the generation it is cached with
+    generation = bucket_get_document_generation(cookie, key, vbucket);
+    if (generation && lookupCachedResponse(key)) {
+        state = State::SendResponse;
+        return ENGINE_SUCCESS;
+    }
+
     auto ret = bucket_get(cookie, key, vbucket);
     if (ret.first == cb::engine_errc::success) {
         it = std::move(ret.second);
@@ -59,7 +140,58 @@ ENGINE_ERROR_CODE GetCommandContext::getItem() {
     return ENGINE_ERROR_CODE(ret.first);
 }
 
+/**
+ * A task used to inflate large documents off the front end thread, so that
+ * the other connections served by the thread aren't stalled while a
+ * document is inflated.
+ */
+class BackgroundInflateTask : public Task {
+public:
+    BackgroundInflateTask(Cookie& cookie,
+                          std::string_view payload,
+                          cb::compression::Buffer& buffer)
+        : cookie(cookie), payload(payload), buffer(buffer) {
+    }
+
+    Status execute() override {
+        try {
+            if (!cb::compression::inflate(
+                        cb::compression::Algorithm::Snappy, payload, buffer)) {
+                LOG_WARNING("{}: Failed to inflate item",
+                            cookie.getConnection().getId());
+                status = ENGINE_FAILED;
+            }
+        } catch (const std::bad_alloc&) {
+            status = ENGINE_ENOMEM;
+        }
+        return Status::Finished;
+    }
+
+    void notifyExecutionComplete() override {
+        notify_io_complete(static_cast<void*>(&cookie), status);
+    }
+
+private:
+    Cookie& cookie;
+    /// The compressed value (owned by the command context)
+    const std::string_view payload;
+    /// The buffer in the command context to inflate the value into
+    cb::compression::Buffer& buffer;
+    ENGINE_ERROR_CODE status = ENGINE_SUCCESS;
+};
+
 ENGINE_ERROR_CODE GetCommandContext::inflateItem() {
+    const auto threshold = Settings::instance().getBackgroundInflateThreshold();
+    if (threshold != 0 &&
+        cb::compression::get_uncompressed_length(
+                cb::compression::Algorithm::Snappy, payload) >= threshold) {
+        task = std::make_shared<BackgroundInflateTask>(cookie, payload, buffer);
+        std::lock_guard<std::mutex> guard(task->getMutex());
+        executorPool->schedule(task);
+        state = State::InflatedItem;
+        return ENGINE_EWOULDBLOCK;
+    }
+
     try {
         if (!cb::compression::inflate(cb::compression::Algorithm::Snappy,
                                       payload, buffer)) {
@@ -76,12 +208,26 @@ ENGINE_ERROR_CODE GetCommandContext::inflateItem() {
     return ENGINE_SUCCESS;
 }
 
+ENGINE_ERROR_CODE GetCommandContext::inflatedItem() {
+    task.reset();
+    payload = buffer;
+    info.datatype &= ~PROTOCOL_BINARY_DATATYPE_SNAPPY;
+    state = State::SendResponse;
+    return ENGINE_SUCCESS;
+}
+
 ENGINE_ERROR_CODE GetCommandContext::sendResponse() {
     if (mcbp::datatype::is_xattr(info.datatype)) {
         payload = cb::xattr::get_body(payload);
         info.datatype &= ~PROTOCOL_BINARY_DATATYPE_XATTR;
     }
 
+    if (cached) {
+        get_thread_stats(&connection)->get_cache_hits++;
+    } else {
+        cacheResponse();
+    }
+
     info.datatype = connection.getEnabledDatatypes(info.datatype);
 
     std::size_t keylen = 0;
@@ -167,6 +313,9 @@ ENGINE_ERROR_CODE GetCommandContext::step() {
         case State::InflateItem:
             ret = inflateItem();
             break;
+        case State::InflatedItem:
+            ret = inflatedItem();
+            break;
         case State::SendResponse:
             ret = sendResponse();
             break;
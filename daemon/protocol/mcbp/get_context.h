@@ -18,6 +18,7 @@
 
 #include <daemon/cookie.h>
 #include <daemon/stats.h>
+#include <daemon/task.h>
 #include <daemon/topkeys.h>
 #include <mcbp/protocol/header.h>
 #include <memcached/engine.h>
@@ -37,6 +38,7 @@ public:
         GetItem,
         NoSuchItem,
         InflateItem,
+        InflatedItem,
         SendResponse,
         Done
     };
@@ -102,14 +104,28 @@ protected:
     ENGINE_ERROR_CODE noSuchItem();
 
     /**
-     * Inflate the document before progressing to State::SendResponse
+     * Inflate the document before progressing to State::SendResponse.
+     *
+     * Documents which inflate to at least background_inflate_threshold
+     * bytes are inflated by a task on the executor pool (so that we don't
+     * block the other connections bound to the front end thread), and
+     * we'll progress to State::InflatedItem once the task completes.
      *
      * @return ENGINE_FAILED if inflate failed
      *         ENGINE_ENOMEM if we're out of memory
+     *         ENGINE_EWOULDBLOCK if the document is inflated in the background
      *         ENGINE_SUCCESS to go to the next state
      */
     ENGINE_ERROR_CODE inflateItem();
 
+    /**
+     * The background task inflated the document into the buffer; use it
+     * as the payload and progress to State::SendResponse
+     *
+     * @return ENGINE_SUCCESS to go to the next state
+     */
+    ENGINE_ERROR_CODE inflatedItem();
+
     /**
      * Craft up the response message and send it to the client. Given that
      * the command context object lives until we start the next command
@@ -121,6 +137,18 @@ protected:
      */
     ENGINE_ERROR_CODE sendResponse();
 
+    /**
+     * Look up the response in the front end thread's GET response cache,
+     * and if it's valid for the document generation (and this connection)
+     * use it as the item to send.
+     *
+     * @return true if the response should be sent from the cache
+     */
+    bool lookupCachedResponse(const DocKey& key);
+
+    /// Cache the response about to be sent (if it may be cached)
+    void cacheResponse();
+
 private:
     const Vbid vbucket;
 
@@ -130,4 +158,16 @@ private:
     std::string_view payload;
     cb::compression::Buffer buffer;
     State state;
+
+    /// The task inflating the document in the background (if any)
+    std::shared_ptr<Task> task;
+
+    /**
+     * The generation of the document, read before the item is fetched (an
+     * empty optional if the bucket doesn't allow the response to be cached)
+     */
+    std::optional<uint64_t> generation;
+
+    /// Is the response sent from the GET response cache
+    bool cached = false;
 };
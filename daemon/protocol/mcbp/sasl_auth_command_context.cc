@@ -54,8 +54,9 @@ ENGINE_ERROR_CODE SaslAuthCommandContext::initial() {
             "SaslAuthCommandContext() used with illegal opcode");
     }
 
+    auto& pool = authExecutorPool ? *authExecutorPool : *executorPool;
     std::lock_guard<std::mutex> guard(task->getMutex());
-    executorPool->schedule(task, true);
+    pool.schedule(task, true);
 
     state = State::ParseAuthTaskResult;
     return ENGINE_EWOULDBLOCK;
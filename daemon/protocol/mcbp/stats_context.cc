@@ -23,14 +23,18 @@
 #include <daemon/buckets.h>
 #include <daemon/cookie.h>
 #include <daemon/executorpool.h>
+#include <daemon/external_auth_manager_thread.h>
+#include <daemon/front_end_thread.h>
 #include <daemon/mc_time.h>
 #include <daemon/mcaudit.h>
 #include <daemon/memcached.h>
 #include <daemon/runtime.h>
+#include <daemon/sasl_tasks.h>
 #include <daemon/settings.h>
 #include <daemon/stats.h>
 #include <daemon/stats_tasks.h>
 #include <daemon/topkeys.h>
+#include <cbsasl/server.h>
 #include <mcbp/protocol/framebuilder.h>
 #include <mcbp/protocol/header.h>
 #include <nlohmann/json.hpp>
@@ -44,7 +48,9 @@
 #include <gsl/gsl>
 
 #include <daemon/server_socket.h>
+#include <algorithm>
 #include <cinttypes>
+#include <iterator>
 
 using namespace std::string_view_literals;
 
@@ -222,6 +228,61 @@ static ENGINE_ERROR_CODE stat_audit_executor(const std::string& arg,
     }
 }
 
+/**
+ * Handler for the <code>stats auth</code> used to get the latencies of
+ * the SASL authentications and the statistics of the SCRAM key cache.
+ *
+ * @param arg - should be empty
+ * @param cookie the command context
+ */
+static ENGINE_ERROR_CODE stat_auth_executor(const std::string& arg,
+                                            Cookie& cookie) {
+    if (!arg.empty()) {
+        return ENGINE_EINVAL;
+    }
+
+    append_stats("auth_threads",
+                 std::to_string(Settings::instance().getNumAuthThreads()),
+                 &cookie);
+    append_stats("auth_queue_time",
+                 saslAuthTimings.queue.wlock()->to_string(),
+                 &cookie);
+    append_stats("auth_start_time",
+                 saslAuthTimings.start.wlock()->to_string(),
+                 &cookie);
+    append_stats("auth_step_time",
+                 saslAuthTimings.step.wlock()->to_string(),
+                 &cookie);
+
+    const auto cache = cb::sasl::server::get_scram_key_cache_stats();
+    append_stats("scram_key_cache_capacity",
+                 std::to_string(cache.capacity),
+                 &cookie);
+    append_stats(
+            "scram_key_cache_size", std::to_string(cache.size), &cookie);
+    append_stats(
+            "scram_key_cache_hits", std::to_string(cache.hits), &cookie);
+    append_stats(
+            "scram_key_cache_misses", std::to_string(cache.misses), &cookie);
+    append_stats("scram_key_cache_evictions",
+                 std::to_string(cache.evictions),
+                 &cookie);
+
+    if (externalAuthManager) {
+        const auto external = externalAuthManager->getAuthCacheStats();
+        append_stats("external_auth_cache_size",
+                     std::to_string(external.size),
+                     &cookie);
+        append_stats("external_auth_cache_hits",
+                     std::to_string(external.hits),
+                     &cookie);
+        append_stats("external_auth_cache_misses",
+                     std::to_string(external.misses),
+                     &cookie);
+    }
+    return ENGINE_SUCCESS;
+}
+
 /**
  * Handler for the <code>stats bucket details</code> used to get information
  * of the buckets (type, state, #clients etc)
@@ -406,6 +467,45 @@ static ENGINE_ERROR_CODE stat_responses_json_executor(const std::string& arg,
     }
 }
 
+/**
+ * Handler for the <code>stats command_traces</code> command used to
+ * retrieve the traces of the commands sampled by the front end threads
+ * (see CommandTraceLog), oldest first.
+ *
+ * @param arg - should be empty
+ * @param cookie the command context
+ */
+static ENGINE_ERROR_CODE stat_command_traces_executor(const std::string& arg,
+                                                      Cookie& cookie) {
+    if (!arg.empty()) {
+        return ENGINE_EINVAL;
+    }
+
+    try {
+        std::vector<CommandTraceLog::Record> records;
+        iterate_all_front_end_threads([&records](FrontEndThread& thread) {
+            auto traces = thread.commandTraces.getRecords();
+            std::move(traces.begin(),
+                      traces.end(),
+                      std::back_inserter(records));
+        });
+        std::stable_sort(records.begin(),
+                         records.end(),
+                         [](const auto& a, const auto& b) {
+                             return a.timestamp < b.timestamp;
+                         });
+
+        nlohmann::json array = nlohmann::json::array();
+        for (const auto& record : records) {
+            array.push_back(to_json(record));
+        }
+        append_stats("command_traces"sv, array.dump(), &cookie);
+        return ENGINE_SUCCESS;
+    } catch (const std::bad_alloc&) {
+        return ENGINE_ENOMEM;
+    }
+}
+
 static ENGINE_ERROR_CODE stat_tracing_executor(const std::string& arg,
                                                Cookie& cookie) {
     class MemcachedCallback : public phosphor::StatsCallback {
@@ -551,6 +651,7 @@ static std::unordered_map<std::string, struct command_stat_handler>
                 {"worker_thread_info",
                  {true, false, true, stat_sched_executor}},
                 {"audit", {true, false, true, stat_audit_executor}},
+                {"auth", {true, false, true, stat_auth_executor}},
                 {"bucket_details",
                  {true, false, true, stat_bucket_details_executor}},
                 {"aggregate", {false, true, true, stat_aggregate_executor}},
@@ -564,6 +665,8 @@ static std::unordered_map<std::string, struct command_stat_handler>
                 {"responses",
                  {false, true, true, stat_responses_json_executor}},
                 {"tracing", {true, false, true, stat_tracing_executor}},
+                {"command_traces",
+                 {true, false, true, stat_command_traces_executor}},
                 {"allocator", {true, false, true, stat_allocator_executor}},
                 {"scopes", {false, true, false, stat_bucket_collections_stats}},
                 {"scopes-byid",
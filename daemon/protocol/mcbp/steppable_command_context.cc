@@ -27,6 +27,7 @@
 SteppableCommandContext::SteppableCommandContext(Cookie& cookie_)
     : cookie(cookie_), connection(cookie.getConnection()) {
     cookie.logCommand();
+    cookie.setSteppableContext(this);
 }
 
 void SteppableCommandContext::drive() {
@@ -29,6 +29,8 @@
 
 #include <utility>
 
+SaslAuthTimings saslAuthTimings;
+
 SaslAuthTask::SaslAuthTask(Cookie& cookie_,
                            Connection& connection_,
                            std::string mechanism_,
@@ -41,6 +43,22 @@ SaslAuthTask::SaslAuthTask(Cookie& cookie_,
     // no more init needed
 }
 
+std::chrono::steady_clock::time_point SaslAuthTask::recordQueueTime() const {
+    const auto now = std::chrono::steady_clock::now();
+    saslAuthTimings.queue.wlock()->add(
+            std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                                  created));
+    return now;
+}
+
+void SaslAuthTask::recordExecutionTime(
+        folly::Synchronized<Hdr1sfMicroSecHistogram>& histogram,
+        std::chrono::steady_clock::time_point started) {
+    histogram.wlock()->add(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - started));
+}
+
 void SaslAuthTask::notifyExecutionComplete() {
     connection.setAuthenticated(false);
     using PrivilegeContext = cb::rbac::PrivilegeContext;
@@ -18,6 +18,9 @@
 
 #include "authn_authz_service_task.h"
 #include <cbsasl/server.h>
+#include <folly/Synchronized.h>
+#include <utilities/hdrhistogram.h>
+#include <chrono>
 #include <string>
 
 class Connection;
@@ -31,6 +34,21 @@ class ServerContext;
 } // namespace sasl
 } // namespace cb
 
+/**
+ * The latencies of the SASL authentications run by the SaslAuthTasks
+ * (reported by the "auth" stat group)
+ */
+struct SaslAuthTimings {
+    /// The time the tasks waited for an executor thread
+    folly::Synchronized<Hdr1sfMicroSecHistogram> queue;
+    /// The time spent in cbsasl by the SASL_AUTH requests
+    folly::Synchronized<Hdr1sfMicroSecHistogram> start;
+    /// The time spent in cbsasl by the SASL_STEP requests
+    folly::Synchronized<Hdr1sfMicroSecHistogram> step;
+};
+
+extern SaslAuthTimings saslAuthTimings;
+
 /**
  * The SaslAuthTask is the abstract base class used during SASL
  * authentication (which is being run by the executor service)
@@ -64,6 +82,21 @@ public:
         return challenge;
     }
 protected:
+    /**
+     * Record the time the task waited to be run
+     *
+     * @return the time the task started running
+     */
+    std::chrono::steady_clock::time_point recordQueueTime() const;
+
+    /// Record the time since started in the given histogram
+    static void recordExecutionTime(
+            folly::Synchronized<Hdr1sfMicroSecHistogram>& histogram,
+            std::chrono::steady_clock::time_point started);
+
+    /// The task is scheduled as soon as it is created
+    const std::chrono::steady_clock::time_point created =
+            std::chrono::steady_clock::now();
     Cookie& cookie;
     Connection& connection;
     cb::sasl::server::ServerContext& serverContext;
@@ -18,6 +18,9 @@
 
 #include <memcached/engine.h>
 #include <platform/compression/buffer.h>
+
+#include <memory>
+#include <string>
 class Bucket;
 
 /**
@@ -92,3 +95,17 @@ protected:
     cb::compression::Allocator allocator;
     char* data;
 };
+
+/**
+ * Specialized class to send a buffer shared between multiple connections
+ * (the data is released once the last connection is done sending it)
+ */
+class SharedSendBuffer : public SendBuffer {
+public:
+    explicit SharedSendBuffer(std::shared_ptr<const std::string> buffer)
+        : SendBuffer(*buffer), data(std::move(buffer)) {
+    }
+
+protected:
+    std::shared_ptr<const std::string> data;
+};
@@ -177,6 +177,12 @@ struct ServerCookieApi : public ServerCookieIface {
         ::notify_io_complete(cookie, status);
     }
 
+    void notify_io_complete_batch(
+            gsl::span<const std::pair<const void*, ENGINE_ERROR_CODE>>
+                    notifications) override {
+        ::notify_io_complete_batch(notifications);
+    }
+
     ENGINE_ERROR_CODE reserve(gsl::not_null<const void*> void_cookie) override {
         getCookie(void_cookie).incrementRefcount();
         return ENGINE_SUCCESS;
@@ -323,6 +329,11 @@ struct ServerCookieApi : public ServerCookieIface {
         return getCookie(cookie).getConnection().getParentPort();
     }
 
+    std::optional<std::chrono::steady_clock::time_point> get_deadline(
+            gsl::not_null<const void*> cookie) override {
+        return getCookie(cookie).getDeadline();
+    }
+
     void set_error_context(gsl::not_null<void*> cookie,
                            std::string_view message) override {
         getCookie(cookie).setErrorContext(std::string{message});
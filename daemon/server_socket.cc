@@ -17,6 +17,7 @@
 
 #include "server_socket.h"
 
+#include "front_end_thread.h"
 #include "listening_port.h"
 #include "memcached.h"
 #include "network_interface.h"
@@ -58,6 +59,50 @@ void ServerSocket::listen_event_handler(evutil_socket_t, short, void* arg) {
     }
 }
 
+void ServerSocket::shard_event_handler(evutil_socket_t, short, void* arg) {
+    auto& shard = *reinterpret_cast<Shard*>(arg);
+
+    if (is_memcached_shutting_down()) {
+        // The front-end thread stops its own event loop once all of its
+        // clients are gone; just stop accepting new ones
+        return;
+    }
+
+    try {
+        shard.parent.acceptNewClient(shard.sfd, &shard.thread);
+    } catch (std::invalid_argument& e) {
+        LOG_WARNING("{}: exception occurred while accepting clients: {}",
+                    shard.sfd,
+                    e.what());
+    }
+}
+
+ServerSocket::Shard::Shard(ServerSocket& parent,
+                           SOCKET sfd,
+                           FrontEndThread& thread)
+    : parent(parent),
+      sfd(sfd),
+      thread(thread),
+      ev(event_new(thread.base,
+                   sfd,
+                   EV_READ | EV_PERSIST,
+                   shard_event_handler,
+                   reinterpret_cast<void*>(this))) {
+    if (!ev) {
+        safe_close(sfd);
+        throw std::bad_alloc();
+    }
+}
+
+ServerSocket::Shard::~Shard() {
+    // event_del waits for a callback running on the front-end thread
+    if (event_del(ev.get()) == -1) {
+        LOG_WARNING("Failed to remove listener shard from libevent: {}",
+                    cb_strerror());
+    }
+    safe_close(sfd);
+}
+
 ServerSocket::ServerSocket(SOCKET fd,
                            event_base* b,
                            std::shared_ptr<ListeningPort> interf)
@@ -97,6 +142,8 @@ ServerSocket::ServerSocket(SOCKET fd,
 }
 
 ServerSocket::~ServerSocket() {
+    shards.clear();
+
     std::string tagstr;
     if (!interface->tag.empty()) {
         tagstr = " \"" + interface->tag + "\"";
@@ -116,11 +163,44 @@ ServerSocket::~ServerSocket() {
     numInstances--;
 }
 
+void ServerSocket::addShard(SOCKET fd, FrontEndThread& thread) {
+    if (cb::net::listen(fd, backlog) == SOCKET_ERROR) {
+        LOG_WARNING("{}: Failed to listen on {} for worker thread {}: {}",
+                    fd,
+                    sockname,
+                    thread.index,
+                    cb_strerror(cb::net::get_socket_error()));
+        safe_close(fd);
+        return;
+    }
+
+    auto shard = std::make_unique<Shard>(*this, fd, thread);
+    if (event_add(shard->ev.get(), nullptr) == -1) {
+        LOG_WARNING("Failed to add listener shard to libevent: {}",
+                    cb_strerror());
+        return;
+    }
+    LOG_DEBUG("{} Listen on {} from worker thread {}",
+              fd,
+              sockname,
+              thread.index);
+    shards.emplace_back(std::move(shard));
+}
+
+std::shared_ptr<ListeningPort> ServerSocket::getInterface() const {
+    std::lock_guard<std::mutex> guard(interfaceMutex);
+    return interface;
+}
+
 void ServerSocket::acceptNewClient() {
+    acceptNewClient(sfd, nullptr);
+}
+
+void ServerSocket::acceptNewClient(SOCKET listener, FrontEndThread* owner) {
     sockaddr_storage addr{};
     socklen_t addrlen = sizeof(addr);
     auto client = cb::net::accept(
-            sfd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen);
+            listener, reinterpret_cast<struct sockaddr*>(&addr), &addrlen);
 
     if (client == INVALID_SOCKET) {
         auto error = cb::net::get_socket_error();
@@ -129,12 +209,13 @@ void ServerSocket::acceptNewClient() {
     }
 
     stats.curr_conns.fetch_add(1, std::memory_order_relaxed);
+    auto iface = getInterface();
 
     // Check if we're exceeding the connection limits
     size_t current;
     size_t limit;
 
-    if (interface->system) {
+    if (iface->system) {
         ++stats.system_conns;
         current = stats.getSystemConnections();
         limit = Settings::instance().getSystemConnections();
@@ -146,17 +227,17 @@ void ServerSocket::acceptNewClient() {
     LOG_DEBUG("Accepting client {} of {}{}",
               current,
               limit,
-              interface->system ? " on system port" : "");
+              iface->system ? " on system port" : "");
     if (current > limit) {
         stats.rejected_conns++;
         LOG_WARNING(
                 "Shutting down client as we're running "
                 "out of connections{}: {} of {}",
-                interface->system ? " on system interface" : "",
+                iface->system ? " on system interface" : "",
                 current,
                 limit);
         safe_close(client);
-        if (interface->system) {
+        if (iface->system) {
             --stats.system_conns;
         }
         return;
@@ -168,7 +249,11 @@ void ServerSocket::acceptNewClient() {
         return;
     }
 
-    dispatch_conn_new(client, interface);
+    if (owner) {
+        dispatch_conn_new_local(client, iface, *owner);
+    } else {
+        dispatch_conn_new(client, iface);
+    }
 }
 
 nlohmann::json ServerSocket::toJson() const {
@@ -186,6 +271,7 @@ nlohmann::json ServerSocket::toJson() const {
     ret["port"] = interface->port;
     ret["system"] = interface->system;
     ret["tag"] = interface->tag;
+    ret["shards"] = shards.size();
 
     return ret;
 }
@@ -206,11 +292,13 @@ void ServerSocket::updateSSL(const std::string& key, const std::string& cert) {
         ss << " (" << interface->tag << ")";
     }
     LOG_INFO(ss.str());
-    interface = std::make_shared<ListeningPort>(interface->tag,
-                                                interface->host,
-                                                interface->port,
-                                                interface->family,
-                                                interface->system,
-                                                key,
-                                                cert);
+    auto updated = std::make_shared<ListeningPort>(interface->tag,
+                                                   interface->host,
+                                                   interface->port,
+                                                   interface->family,
+                                                   interface->system,
+                                                   key,
+                                                   cert);
+    std::lock_guard<std::mutex> guard(interfaceMutex);
+    interface = std::move(updated);
 }
@@ -21,9 +21,12 @@
 #include <platform/socket.h>
 #include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 class ListeningPort;
 class NetworkInterface;
+struct FrontEndThread;
 
 /**
  * The ServerSocket represents the socket used to accept new clients.
@@ -55,6 +58,22 @@ public:
 
     void acceptNewClient();
 
+    /**
+     * Add a listening socket bound (with SO_REUSEPORT) to the same address
+     * as this socket, owned by the provided front-end thread. Clients
+     * accepted from it are served by that thread without being passed
+     * through the dispatcher.
+     *
+     * @param fd the bound socket (ownership is transferred)
+     * @param thread the front-end thread to accept the clients
+     */
+    void addShard(SOCKET fd, FrontEndThread& thread);
+
+    /// Does this socket have per-thread listening sockets?
+    bool isSharded() const {
+        return !shards.empty();
+    }
+
     const ListeningPort& getInterfaceDescription() const {
         return *interface;
     }
@@ -91,6 +110,39 @@ protected:
     /// The notification handler registered in libevent
     static void listen_event_handler(evutil_socket_t, short, void* arg);
 
+    /// A per-thread SO_REUSEPORT listening socket
+    struct Shard {
+        Shard(ServerSocket& parent, SOCKET sfd, FrontEndThread& thread);
+        ~Shard();
+        ServerSocket& parent;
+        const SOCKET sfd;
+        FrontEndThread& thread;
+        cb::libevent::unique_event_ptr ev;
+    };
+
+    /// The notification handler registered in the shard's thread's libevent
+    static void shard_event_handler(evutil_socket_t, short, void* arg);
+
+    /**
+     * Accept a client from the listening socket and dispatch it
+     *
+     * @param listener the listening socket to accept the client from
+     * @param owner the front-end thread to serve the client (nullptr to
+     *              let the dispatcher pick one)
+     */
+    void acceptNewClient(SOCKET listener, FrontEndThread* owner);
+
+    /// @return a copy of the interface description (may be called from
+    ///         any thread)
+    std::shared_ptr<ListeningPort> getInterface() const;
+
+    /// The per-thread listening sockets (empty unless reuse_port_listeners)
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    /// Protects interface when there are shards accepting clients on the
+    /// front-end threads while updateSSL() replaces it
+    mutable std::mutex interfaceMutex;
+
     /// The current number of instances of ServerSockets
     static std::atomic<uint64_t> numInstances;
 };
@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <limits>
 #include <gsl/gsl>
 #include <system_error>
 
@@ -94,6 +95,32 @@ static void handle_always_collect_trace_info(Settings& s,
     s.setAlwaysCollectTraceInfo(obj.get<bool>());
 }
 
+static void handle_command_trace_sample_rate(Settings& s,
+                                             const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("command_trace_sample_rate" must be a positive number)");
+    }
+    s.setCommandTraceSampleRate(obj.get<size_t>());
+}
+
+static void handle_workload_capture_file(Settings& s,
+                                         const nlohmann::json& obj) {
+    if (!obj.is_string()) {
+        cb::throwJsonTypeError(R"("workload_capture_file" must be a string)");
+    }
+    s.setWorkloadCaptureFile(obj.get<std::string>());
+}
+
+static void handle_workload_capture_hash_keys(Settings& s,
+                                              const nlohmann::json& obj) {
+    if (!obj.is_boolean()) {
+        cb::throwJsonTypeError(
+                R"("workload_capture_hash_keys" must be a boolean)");
+    }
+    s.setWorkloadCaptureHashKeys(obj.get<bool>());
+}
+
 /**
  * Handle the "rbac_file" tag in the settings
  *
@@ -198,6 +225,23 @@ static void handle_active_external_users_push_interval(
     }
 }
 
+static void handle_external_auth_cache_ttl(Settings& s,
+                                           const nlohmann::json& obj) {
+    switch (obj.type()) {
+    case nlohmann::json::value_t::number_unsigned:
+        s.setExternalAuthCacheTtl(std::chrono::seconds(obj.get<uint64_t>()));
+        break;
+    case nlohmann::json::value_t::string:
+        s.setExternalAuthCacheTtl(
+                std::chrono::duration_cast<std::chrono::seconds>(
+                        cb::text2time(obj.get<std::string>())));
+        break;
+    default:
+        cb::throwJsonTypeError(
+                R"("external_auth_cache_ttl" must be a number or string)");
+    }
+}
+
 static void handle_max_concurrent_commands_per_connection(
         Settings& s, const nlohmann::json& obj) {
     if (!obj.is_number_unsigned()) {
@@ -207,6 +251,49 @@ static void handle_max_concurrent_commands_per_connection(
     s.setMaxConcurrentCommandsPerConnection(obj.get<size_t>());
 }
 
+static void handle_stats_sample_rate(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("stats_sample_rate" must be an unsigned number)");
+    }
+    const auto value = obj.get<uint64_t>();
+    if (value == 0 || value > std::numeric_limits<uint16_t>::max()) {
+        throw std::invalid_argument(
+                R"("stats_sample_rate" must be in the range [1, 65535])");
+    }
+    s.setStatsSampleRate(uint32_t(value));
+}
+
+/**
+ * Handle the "bucket_thread_reservations" tag in the settings
+ *
+ *  The value must be an object mapping the bucket names to the (positive)
+ *  number of front-end threads to reserve for them
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_bucket_thread_reservations(Settings& s,
+                                              const nlohmann::json& obj) {
+    if (!obj.is_object()) {
+        cb::throwJsonTypeError(
+                R"("bucket_thread_reservations" must be an object)");
+    }
+    std::map<std::string, size_t> reservations;
+    for (const auto& [name, value] : obj.items()) {
+        if (!value.is_number_unsigned()) {
+            cb::throwJsonTypeError(
+                    R"("bucket_thread_reservations" entries must be unsigned numbers)");
+        }
+        if (value.get<size_t>() == 0) {
+            throw std::invalid_argument(
+                    R"("bucket_thread_reservations" entries must be greater than 0)");
+        }
+        reservations[name] = value.get<size_t>();
+    }
+    s.setBucketThreadReservations(std::move(reservations));
+}
+
 /**
  * Handle the "tracing_enabled" tag in the settings
  *
@@ -231,6 +318,32 @@ static void handle_stdin_listener(Settings& s, const nlohmann::json& obj) {
     s.setStdinListenerEnabled(obj.get<bool>());
 }
 
+/**
+ * Handle the "numa_thread_placement" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_numa_thread_placement(Settings& s,
+                                         const nlohmann::json& obj) {
+    s.setNumaThreadPlacementEnabled(obj.get<bool>());
+}
+
+/**
+ * Handle the "reuse_port_listeners" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_reuse_port_listeners(Settings& s,
+                                        const nlohmann::json& obj) {
+    s.setReusePortListenersEnabled(obj.get<bool>());
+}
+
 /**
  * Handle "default_reqs_per_event", "reqs_per_event_high_priority",
  * "reqs_per_event_med_priority" and "reqs_per_event_low_priority" tag in
@@ -402,6 +515,53 @@ static void handle_ssl_cipher_order(Settings& s, const nlohmann::json& obj) {
     s.setSslCipherOrder(obj.get<bool>());
 }
 
+/**
+ * Handle the "ssl_kernel_offload" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_ssl_kernel_offload(Settings& s, const nlohmann::json& obj) {
+    s.setSslKernelOffload(obj.get<bool>());
+}
+
+/**
+ * Handle the "ssl_session_tickets" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_ssl_session_tickets(Settings& s,
+                                       const nlohmann::json& obj) {
+    s.setSslSessionTickets(obj.get<bool>());
+}
+
+/**
+ * Handle the "ssl_session_ticket_rotation" tag in the settings
+ *
+ *  The value must be a (non-zero) unsigned number of seconds
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_ssl_session_ticket_rotation(Settings& s,
+                                               const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("ssl_session_ticket_rotation" must be an unsigned number)");
+    }
+    const auto value = obj.get<uint64_t>();
+    if (value == 0) {
+        throw std::invalid_argument(
+                R"("ssl_session_ticket_rotation" must be greater than 0)");
+    }
+    s.setSslSessionTicketRotation(std::chrono::seconds(value));
+}
+
 /**
  * Handle the "ssl_minimum_protocol" tag in the settings
  *
@@ -447,6 +607,49 @@ static void handle_max_send_queue_size(Settings& s, const nlohmann::json& obj) {
     s.setMaxSendQueueSize(obj.get<size_t>() * 1024 * 1024);
 }
 
+static void handle_zero_copy_send_threshold(Settings& s,
+                                            const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("zero_copy_send_threshold" must be an unsigned number)");
+    }
+    s.setZeroCopySendThreshold(obj.get<size_t>());
+}
+
+static void handle_mutation_admission_max_delay(Settings& s,
+                                                const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("mutation_admission_max_delay" must be an unsigned number)");
+    }
+    s.setMutationAdmissionMaxDelay(obj.get<size_t>());
+}
+
+static void handle_num_auth_threads(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("num_auth_threads" must be an unsigned number)");
+    }
+    s.setNumAuthThreads(obj.get<size_t>());
+}
+
+static void handle_scram_key_cache_size(Settings& s,
+                                        const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("scram_key_cache_size" must be an unsigned number)");
+    }
+    s.setScramKeyCacheSize(obj.get<size_t>());
+}
+
+static void handle_network_io_size(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("network_io_size" must be an unsigned number)");
+    }
+    s.setNetworkIoSize(obj.get<size_t>());
+}
+
 static void handle_max_connections(Settings& s, const nlohmann::json& obj) {
     if (!obj.is_number_unsigned()) {
         cb::throwJsonTypeError(
@@ -499,6 +702,46 @@ static void handle_dedupe_nmvb_maps(Settings& s, const nlohmann::json& obj) {
     s.setDedupeNmvbMaps(obj.get<bool>());
 }
 
+/**
+ * Handle the "ordered_read_pipelining" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_ordered_read_pipelining(Settings& s,
+                                           const nlohmann::json& obj) {
+    s.setOrderedReadPipelining(obj.get<bool>());
+}
+
+static void handle_subdoc_path_cache_size(Settings& s,
+                                          const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("subdoc_path_cache_size" must be a positive number)");
+    }
+    s.setSubdocPathCacheSize(obj.get<size_t>());
+}
+
+static void handle_prometheus_high_cardinality_interval(
+        Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("prometheus_high_cardinality_interval" must be a positive number)");
+    }
+    s.setPrometheusHighCardinalityInterval(obj.get<size_t>());
+}
+
+static void handle_background_inflate_threshold(Settings& s,
+                                                const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("background_inflate_threshold" must be a positive number)");
+    }
+    s.setBackgroundInflateThreshold(obj.get<size_t>());
+}
+
 /**
  * Handle the "xattr_enabled" tag in the settings
  *
@@ -726,6 +969,9 @@ void Settings::reconfigure(const nlohmann::json& json) {
     std::vector<settings_config_tokens> handlers = {
             {"admin", ignore_entry},
             {"always_collect_trace_info", handle_always_collect_trace_info},
+            {"command_trace_sample_rate", handle_command_trace_sample_rate},
+            {"workload_capture_file", handle_workload_capture_file},
+            {"workload_capture_hash_keys", handle_workload_capture_hash_keys},
             {"rbac_file", handle_rbac_file},
             {"privilege_debug", handle_privilege_debug},
             {"audit_file", handle_audit_file},
@@ -745,16 +991,32 @@ void Settings::reconfigure(const nlohmann::json& json) {
             {"root", handle_root},
             {"ssl_cipher_list", handle_ssl_cipher_list},
             {"ssl_cipher_order", handle_ssl_cipher_order},
+            {"ssl_kernel_offload", handle_ssl_kernel_offload},
+            {"ssl_session_tickets", handle_ssl_session_tickets},
+            {"ssl_session_ticket_rotation",
+             handle_ssl_session_ticket_rotation},
             {"ssl_minimum_protocol", handle_ssl_minimum_protocol},
             {"breakpad", handle_breakpad},
             {"max_packet_size", handle_max_packet_size},
             {"max_send_queue_size", handle_max_send_queue_size},
+            {"zero_copy_send_threshold", handle_zero_copy_send_threshold},
+            {"mutation_admission_max_delay",
+             handle_mutation_admission_max_delay},
+            {"network_io_size", handle_network_io_size},
             {"max_connections", handle_max_connections},
             {"system_connections", handle_system_connections},
             {"sasl_mechanisms", handle_sasl_mechanisms},
             {"ssl_sasl_mechanisms", handle_ssl_sasl_mechanisms},
             {"stdin_listener", handle_stdin_listener},
+            {"numa_thread_placement", handle_numa_thread_placement},
+            {"reuse_port_listeners", handle_reuse_port_listeners},
             {"dedupe_nmvb_maps", handle_dedupe_nmvb_maps},
+            {"ordered_read_pipelining", handle_ordered_read_pipelining},
+            {"subdoc_path_cache_size", handle_subdoc_path_cache_size},
+            {"prometheus_high_cardinality_interval",
+             handle_prometheus_high_cardinality_interval},
+            {"background_inflate_threshold",
+             handle_background_inflate_threshold},
             {"xattr_enabled", handle_xattr_enabled},
             {"client_cert_auth", handle_client_cert_auth},
             {"collections_enabled", handle_collections_enabled},
@@ -763,11 +1025,16 @@ void Settings::reconfigure(const nlohmann::json& json) {
             {"num_writer_threads", handle_num_writer_threads},
             {"num_storage_threads", handle_num_storage_threads},
             {"topkeys_enabled", handle_topkeys_enabled},
+            {"stats_sample_rate", handle_stats_sample_rate},
+            {"bucket_thread_reservations", handle_bucket_thread_reservations},
             {"tracing_enabled", handle_tracing_enabled},
             {"scramsha_fallback_salt", handle_scramsha_fallback_salt},
+            {"num_auth_threads", handle_num_auth_threads},
+            {"scram_key_cache_size", handle_scram_key_cache_size},
             {"external_auth_service", handle_external_auth_service},
             {"active_external_users_push_interval",
              handle_active_external_users_push_interval},
+            {"external_auth_cache_ttl", handle_external_auth_cache_ttl},
             {"max_concurrent_commands_per_connection",
              handle_max_concurrent_commands_per_connection},
             {"prometheus", handle_prometheus},
@@ -818,6 +1085,12 @@ void Settings::updateSettings(const Settings& other, bool apply) {
             throw std::invalid_argument("audit can't be changed dynamically");
         }
     }
+    if (other.has.num_auth_threads) {
+        if (other.num_auth_threads != num_auth_threads) {
+            throw std::invalid_argument(
+                    "num_auth_threads can't be changed dynamically");
+        }
+    }
     if (other.has.datatype_json) {
         if (other.datatype_json != datatype_json) {
             throw std::invalid_argument(
@@ -843,6 +1116,21 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.numa_thread_placement) {
+        if (other.numa_thread_placement.load() !=
+            numa_thread_placement.load()) {
+            throw std::invalid_argument(
+                    "numa_thread_placement can't be changed dynamically");
+        }
+    }
+
+    if (other.has.reuse_port_listeners) {
+        if (other.reuse_port_listeners.load() != reuse_port_listeners.load()) {
+            throw std::invalid_argument(
+                    "reuse_port_listeners can't be changed dynamically");
+        }
+    }
+
     if (other.has.logger) {
         if (other.logger_settings != logger_settings)
             throw std::invalid_argument(
@@ -890,6 +1178,34 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.command_trace_sample_rate) {
+        if (other.getCommandTraceSampleRate() != getCommandTraceSampleRate()) {
+            LOG_INFO("Change command trace sample rate from {} to {}",
+                     getCommandTraceSampleRate(),
+                     other.getCommandTraceSampleRate());
+            setCommandTraceSampleRate(other.getCommandTraceSampleRate());
+        }
+    }
+
+    if (other.has.workload_capture_hash_keys) {
+        if (other.isWorkloadCaptureHashKeys() != isWorkloadCaptureHashKeys()) {
+            LOG_INFO("Change workload capture hash keys from {} to {}",
+                     isWorkloadCaptureHashKeys(),
+                     other.isWorkloadCaptureHashKeys());
+            setWorkloadCaptureHashKeys(other.isWorkloadCaptureHashKeys());
+        }
+    }
+
+    if (other.has.workload_capture_file) {
+        const auto file = other.getWorkloadCaptureFile();
+        if (file != getWorkloadCaptureFile()) {
+            LOG_INFO(R"(Change workload capture file from "{}" to "{}")",
+                     getWorkloadCaptureFile(),
+                     file);
+            setWorkloadCaptureFile(file);
+        }
+    }
+
     if (other.has.datatype_snappy) {
         if (other.datatype_snappy != datatype_snappy) {
             std::string curr_val_str = datatype_snappy ? "true" : "false";
@@ -972,6 +1288,41 @@ void Settings::updateSettings(const Settings& other, bool apply) {
             setMaxSendQueueSize(other.max_send_queue_size);
         }
     }
+    if (other.has.zero_copy_send_threshold) {
+        if (other.zero_copy_send_threshold != zero_copy_send_threshold) {
+            LOG_INFO("Change zero copy send threshold from {} to {}",
+                     zero_copy_send_threshold.load(),
+                     other.zero_copy_send_threshold.load());
+            setZeroCopySendThreshold(other.zero_copy_send_threshold.load());
+        }
+    }
+    if (other.has.mutation_admission_max_delay) {
+        if (other.mutation_admission_max_delay !=
+            mutation_admission_max_delay) {
+            LOG_INFO("Change mutation admission max delay from {}ms to {}ms",
+                     mutation_admission_max_delay.load(),
+                     other.mutation_admission_max_delay.load());
+            setMutationAdmissionMaxDelay(
+                    other.mutation_admission_max_delay.load());
+        }
+    }
+    if (other.has.network_io_size) {
+        if (other.network_io_size != network_io_size) {
+            LOG_INFO("Change network I/O size from {} to {}",
+                     network_io_size.load(),
+                     other.network_io_size.load());
+            setNetworkIoSize(other.network_io_size.load());
+        }
+    }
+
+    if (other.has.scram_key_cache_size) {
+        if (other.scram_key_cache_size != scram_key_cache_size) {
+            LOG_INFO("Change SCRAM key cache size from {} to {}",
+                     scram_key_cache_size.load(),
+                     other.scram_key_cache_size.load());
+            setScramKeyCacheSize(other.scram_key_cache_size.load());
+        }
+    }
 
     if (other.has.ssl_cipher_list) {
         std::string his = *other.ssl_cipher_list.rlock();
@@ -1006,6 +1357,34 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.ssl_kernel_offload) {
+        if (other.ssl_kernel_offload != ssl_kernel_offload) {
+            LOG_INFO(R"(Change SSL kernel offload from "{}" to "{}")",
+                     ssl_kernel_offload ? "enabled" : "disabled",
+                     other.ssl_kernel_offload ? "enabled" : "disabled");
+            setSslKernelOffload(other.ssl_kernel_offload);
+        }
+    }
+
+    if (other.has.ssl_session_tickets) {
+        if (other.ssl_session_tickets != ssl_session_tickets) {
+            LOG_INFO(R"(Change SSL session tickets from "{}" to "{}")",
+                     ssl_session_tickets ? "enabled" : "disabled",
+                     other.ssl_session_tickets ? "enabled" : "disabled");
+            setSslSessionTickets(other.ssl_session_tickets);
+        }
+    }
+
+    if (other.has.ssl_session_ticket_rotation) {
+        const auto value = other.ssl_session_ticket_rotation.load();
+        if (value != ssl_session_ticket_rotation.load()) {
+            LOG_INFO("Change SSL session ticket key rotation from {}s to {}s",
+                     ssl_session_ticket_rotation.load().count(),
+                     value.count());
+            setSslSessionTicketRotation(value);
+        }
+    }
+
     if (other.has.client_cert_auth) {
         const auto m = client_cert_mapper.to_string();
         const auto o = other.client_cert_mapper.to_string();
@@ -1035,6 +1414,41 @@ void Settings::updateSettings(const Settings& other, bool apply) {
             setDedupeNmvbMaps(other.dedupe_nmvb_maps.load());
         }
     }
+    if (other.has.ordered_read_pipelining) {
+        if (other.ordered_read_pipelining != ordered_read_pipelining) {
+            LOG_INFO("{} pipelining of GETs on ordered connections",
+                     other.ordered_read_pipelining.load() ? "Enable"
+                                                          : "Disable");
+            setOrderedReadPipelining(other.ordered_read_pipelining.load());
+        }
+    }
+    if (other.has.subdoc_path_cache_size) {
+        if (other.getSubdocPathCacheSize() != getSubdocPathCacheSize()) {
+            LOG_INFO("Change subdoc path cache size from {} to {}",
+                     getSubdocPathCacheSize(),
+                     other.getSubdocPathCacheSize());
+            setSubdocPathCacheSize(other.getSubdocPathCacheSize());
+        }
+    }
+    if (other.has.prometheus_high_cardinality_interval) {
+        const auto interval = other.getPrometheusHighCardinalityInterval();
+        if (interval != getPrometheusHighCardinalityInterval()) {
+            LOG_INFO("Change prometheus high cardinality interval from {}s "
+                     "to {}s",
+                     getPrometheusHighCardinalityInterval().count(),
+                     interval.count());
+            setPrometheusHighCardinalityInterval(interval.count());
+        }
+    }
+    if (other.has.background_inflate_threshold) {
+        const auto threshold = other.getBackgroundInflateThreshold();
+        if (threshold != getBackgroundInflateThreshold()) {
+            LOG_INFO("Change background inflate threshold from {} to {}",
+                     getBackgroundInflateThreshold(),
+                     threshold);
+            setBackgroundInflateThreshold(threshold);
+        }
+    }
 
     if (other.has.max_connections) {
         if (other.max_connections != max_connections) {
@@ -1157,6 +1571,25 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         setTopkeysEnabled(other.isTopkeysEnabled());
     }
 
+    if (other.has.stats_sample_rate) {
+        if (other.getStatsSampleRate() != getStatsSampleRate()) {
+            LOG_INFO("Change stats sample rate from {} to {}",
+                     getStatsSampleRate(),
+                     other.getStatsSampleRate());
+            setStatsSampleRate(other.getStatsSampleRate());
+        }
+    }
+
+    if (other.has.bucket_thread_reservations) {
+        const auto reservations = other.getBucketThreadReservations();
+        if (reservations != getBucketThreadReservations()) {
+            LOG_INFO("Change bucket thread reservations from {} to {}",
+                     nlohmann::json(getBucketThreadReservations()).dump(),
+                     nlohmann::json(reservations).dump());
+            setBucketThreadReservations(reservations);
+        }
+    }
+
     if (other.has.tracing_enabled) {
         if (other.isTracingEnabled() != isTracingEnabled()) {
             LOG_INFO("{} tracing support",
@@ -1229,6 +1662,15 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.external_auth_cache_ttl) {
+        if (getExternalAuthCacheTtl() != other.getExternalAuthCacheTtl()) {
+            LOG_INFO("Change external authentication cache TTL from {}s to {}s",
+                     getExternalAuthCacheTtl().count(),
+                     other.getExternalAuthCacheTtl().count());
+            setExternalAuthCacheTtl(other.getExternalAuthCacheTtl());
+        }
+    }
+
     if (other.has.max_concurrent_commands_per_connection) {
         if (other.getMaxConcurrentCommandsPerConnection() !=
             getMaxConcurrentCommandsPerConnection()) {
@@ -29,6 +29,7 @@
 #include <folly/Synchronized.h>
 
 #include <atomic>
+#include <chrono>
 #include <cstdarg>
 #include <deque>
 #include <functional>
@@ -90,6 +91,46 @@ public:
         notify_changed("always_collect_trace_info");
     }
 
+    /**
+     * Get the rate at which commands are sampled into the per-thread
+     * command trace logs: 1 in N commands (and every slow command) is
+     * recorded; 0 disables the sampling.
+     */
+    size_t getCommandTraceSampleRate() const {
+        return command_trace_sample_rate.load(std::memory_order_relaxed);
+    }
+
+    void setCommandTraceSampleRate(size_t rate) {
+        command_trace_sample_rate.store(rate, std::memory_order_relaxed);
+        has.command_trace_sample_rate = true;
+        notify_changed("command_trace_sample_rate");
+    }
+
+    /**
+     * Get the file the requests received from the clients are captured to
+     * (to be replayed by mcreplay). An empty string disables the capture.
+     */
+    std::string getWorkloadCaptureFile() const {
+        return *workload_capture_file.rlock();
+    }
+
+    void setWorkloadCaptureFile(std::string file) {
+        *workload_capture_file.wlock() = std::move(file);
+        has.workload_capture_file = true;
+        notify_changed("workload_capture_file");
+    }
+
+    /// Should the workload capture store the hash of the keys (or the keys)
+    bool isWorkloadCaptureHashKeys() const {
+        return workload_capture_hash_keys.load(std::memory_order_relaxed);
+    }
+
+    void setWorkloadCaptureHashKeys(bool enable) {
+        workload_capture_hash_keys.store(enable, std::memory_order_relaxed);
+        has.workload_capture_hash_keys = true;
+        notify_changed("workload_capture_hash_keys");
+    }
+
     /**
      * Get the name of the file containing the RBAC data
      *
@@ -190,6 +231,49 @@ public:
         notify_changed("stdin_listener");
     }
 
+    /**
+     * Should front-end threads be pinned to NUMA nodes (and new connections
+     * be dispatched to a thread on the node which received them)?
+     *
+     * @return true if enabled, false otherwise
+     */
+    bool isNumaThreadPlacementEnabled() const {
+        return numa_thread_placement.load();
+    }
+
+    /**
+     * Set the NUMA thread placement mode
+     *
+     * @param enabled the new value
+     */
+    void setNumaThreadPlacementEnabled(bool enabled) {
+        numa_thread_placement.store(enabled);
+        has.numa_thread_placement = true;
+        notify_changed("numa_thread_placement");
+    }
+
+    /**
+     * Should each front-end thread accept clients from its own
+     * SO_REUSEPORT listening socket (for each of the interfaces) rather
+     * than having all clients accepted by the dispatcher?
+     *
+     * @return true if enabled, false otherwise
+     */
+    bool isReusePortListenersEnabled() const {
+        return reuse_port_listeners.load();
+    }
+
+    /**
+     * Set the SO_REUSEPORT listener mode
+     *
+     * @param enabled the new value
+     */
+    void setReusePortListenersEnabled(bool enabled) {
+        reuse_port_listeners.store(enabled);
+        has.reuse_port_listeners = true;
+        notify_changed("reuse_port_listeners");
+    }
+
     cb::logger::Config getLoggerConfig() const {
         auto config = logger_settings;
         // log_level is synthesised from settings.verbose.
@@ -482,6 +566,51 @@ public:
         notify_changed("max_send_queue_size");
     }
 
+    /// Get the minimum size (in bytes) of a value before we try to send it
+    /// with MSG_ZEROCOPY on non-TLS connections (0 == disabled)
+    size_t getZeroCopySendThreshold() const {
+        return zero_copy_send_threshold.load(std::memory_order_acquire);
+    }
+
+    /// Set the minimum size (in bytes) of a value before we try to send it
+    /// with MSG_ZEROCOPY on non-TLS connections (0 disables zero-copy sends)
+    void setZeroCopySendThreshold(size_t threshold) {
+        zero_copy_send_threshold.store(threshold, std::memory_order_release);
+        has.zero_copy_send_threshold = true;
+        notify_changed("zero_copy_send_threshold");
+    }
+
+    /// Get the longest time a mutation is left unread on its connection
+    /// while the bucket is under memory pressure (0 == disabled)
+    std::chrono::milliseconds getMutationAdmissionMaxDelay() const {
+        return std::chrono::milliseconds(
+                mutation_admission_max_delay.load(std::memory_order_acquire));
+    }
+
+    /// Set the longest time (in ms) a mutation is left unread on its
+    /// connection while the bucket is under memory pressure (0 disables it)
+    void setMutationAdmissionMaxDelay(size_t ms) {
+        mutation_admission_max_delay.store(ms, std::memory_order_release);
+        has.mutation_admission_max_delay = true;
+        notify_changed("mutation_admission_max_delay");
+    }
+
+    /// Get the maximum number of bytes read from (or written to) the
+    /// socket of a connection with a single system call (0 == the libevent
+    /// default)
+    size_t getNetworkIoSize() const {
+        return network_io_size.load(std::memory_order_acquire);
+    }
+
+    /// Set the maximum number of bytes read from (or written to) the
+    /// socket of a connection with a single system call. It only applies
+    /// to new connections.
+    void setNetworkIoSize(size_t size) {
+        network_io_size.store(size, std::memory_order_release);
+        has.network_io_size = true;
+        notify_changed("network_io_size");
+    }
+
     /**
      * Get the list of SSL ciphers to use for TLS < 1.3
      *
@@ -520,6 +649,55 @@ public:
 
     void setSslCipherOrder(bool ordered);
 
+    /**
+     * Should TLS connections move the record encryption into the kernel
+     * (kTLS) once the handshake completes (if supported by OpenSSL and
+     * the kernel)?
+     *
+     * @return true if enabled, false otherwise
+     */
+    bool isSslKernelOffload() const {
+        return ssl_kernel_offload.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Set if TLS connections should use kTLS when available
+     *
+     * @param enabled the new value
+     */
+    void setSslKernelOffload(bool enabled) {
+        ssl_kernel_offload.store(enabled, std::memory_order_release);
+        has.ssl_kernel_offload = true;
+        notify_changed("ssl_kernel_offload");
+    }
+
+    /**
+     * Should the TLS connections be offered session tickets (so that the
+     * clients may resume their session without a full handshake when
+     * they reconnect)?
+     */
+    bool isSslSessionTickets() const {
+        return ssl_session_tickets.load(std::memory_order_acquire);
+    }
+
+    void setSslSessionTickets(bool enabled) {
+        ssl_session_tickets.store(enabled, std::memory_order_release);
+        has.ssl_session_tickets = true;
+        notify_changed("ssl_session_tickets");
+    }
+
+    /// Get the number of seconds between the rotations of the key the
+    /// session tickets are encrypted with
+    std::chrono::seconds getSslSessionTicketRotation() const {
+        return ssl_session_ticket_rotation.load(std::memory_order_acquire);
+    }
+
+    void setSslSessionTicketRotation(std::chrono::seconds value) {
+        ssl_session_ticket_rotation.store(value, std::memory_order_release);
+        has.ssl_session_ticket_rotation = true;
+        notify_changed("ssl_session_ticket_rotation");
+    }
+
     /// get the configured SSL protocol mask
     long getSslProtocolMask()const {
         return ssl_protocol_mask.load();
@@ -630,6 +808,94 @@ public:
         notify_changed("dedupe_nmvb_maps");
     }
 
+    /**
+     * Should the server execute pipelined GETs concurrently on
+     * connections which didn't negotiate unordered execution (holding
+     * back their responses to preserve the order on the wire)
+     *
+     * @return true if GETs may be pipelined
+     */
+    bool isOrderedReadPipelining() const {
+        return ordered_read_pipelining.load();
+    }
+
+    /**
+     * Set if the server should execute pipelined GETs concurrently on
+     * connections which didn't negotiate unordered execution.
+     *
+     * @param enable true if GETs may be pipelined
+     */
+    void setOrderedReadPipelining(bool enable) {
+        ordered_read_pipelining.store(enable);
+        has.ordered_read_pipelining = true;
+        notify_changed("ordered_read_pipelining");
+    }
+
+    /**
+     * Get the number of sub-document lookup paths each bucket caches the
+     * location of (0 = the cache is disabled)
+     */
+    size_t getSubdocPathCacheSize() const {
+        return subdoc_path_cache_size.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Set the number of sub-document lookup paths each bucket caches the
+     * location of.
+     *
+     * @param size the number of paths (0 to disable the cache)
+     */
+    void setSubdocPathCacheSize(size_t size) {
+        subdoc_path_cache_size.store(size, std::memory_order_relaxed);
+        has.subdoc_path_cache_size = true;
+        notify_changed("subdoc_path_cache_size");
+    }
+
+    /**
+     * Get the minimum interval between two collections of the high
+     * cardinality Prometheus stats (0 = collect them on every scrape)
+     */
+    std::chrono::seconds getPrometheusHighCardinalityInterval() const {
+        return std::chrono::seconds(prometheus_high_cardinality_interval.load(
+                std::memory_order_relaxed));
+    }
+
+    /**
+     * Set the minimum interval between two collections of the high
+     * cardinality Prometheus stats. Scrapes within the interval are served
+     * the stats collected by the previous one.
+     *
+     * @param interval the interval in seconds (0 to collect on every scrape)
+     */
+    void setPrometheusHighCardinalityInterval(size_t interval) {
+        prometheus_high_cardinality_interval.store(interval,
+                                                   std::memory_order_relaxed);
+        has.prometheus_high_cardinality_interval = true;
+        notify_changed("prometheus_high_cardinality_interval");
+    }
+
+    /**
+     * Get the size of the inflated value from which GETs of Snappy
+     * compressed documents by clients which didn't enable Snappy inflate
+     * the value in the background instead of on the front end thread
+     * (0 = always inflate on the front end thread)
+     */
+    size_t getBackgroundInflateThreshold() const {
+        return background_inflate_threshold.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Set the size of the inflated value from which values are inflated
+     * in the background.
+     *
+     * @param size the size in bytes (0 to never inflate in the background)
+     */
+    void setBackgroundInflateThreshold(size_t size) {
+        background_inflate_threshold.store(size, std::memory_order_relaxed);
+        has.background_inflate_threshold = true;
+        notify_changed("background_inflate_threshold");
+    }
+
     /**
      * Get the breakpad settings
      *
@@ -732,6 +998,36 @@ public:
         notify_changed("topkeys_enabled");
     }
 
+    /**
+     * Get the sampling rate of the expensive per-operation accounting (the
+     * timing histograms and topkeys): only one in every N operations is
+     * recorded, with a weight of N (1 == record every operation)
+     */
+    uint32_t getStatsSampleRate() const {
+        return stats_sample_rate.load(std::memory_order_acquire);
+    }
+
+    void setStatsSampleRate(uint32_t value) {
+        stats_sample_rate.store(value, std::memory_order_release);
+        has.stats_sample_rate = true;
+        notify_changed("stats_sample_rate");
+    }
+
+    /**
+     * Get the number of front-end threads reserved for each bucket. The
+     * connections selecting a bucket with a reservation are moved to its
+     * threads, and the connections to the other buckets are kept off them.
+     */
+    std::map<std::string, size_t> getBucketThreadReservations() const {
+        return *bucket_thread_reservations.rlock();
+    }
+
+    void setBucketThreadReservations(std::map<std::string, size_t> value) {
+        *bucket_thread_reservations.wlock() = std::move(value);
+        has.bucket_thread_reservations = true;
+        notify_changed("bucket_thread_reservations");
+    }
+
     bool isTracingEnabled() const {
         return tracing_enabled.load(std::memory_order_acquire);
     }
@@ -752,6 +1048,29 @@ public:
         return std::string{*scramsha_fallback_salt.rlock()};
     }
 
+    /// Get the number of threads dedicated to run the SASL authentications
+    /// (0 == run them on the shared executor pool)
+    size_t getNumAuthThreads() const {
+        return num_auth_threads.load(std::memory_order_acquire);
+    }
+
+    void setNumAuthThreads(size_t value) {
+        num_auth_threads.store(value, std::memory_order_release);
+        has.num_auth_threads = true;
+        notify_changed("num_auth_threads");
+    }
+
+    /// Get the number of users to cache the SCRAM keys for (0 == disabled)
+    size_t getScramKeyCacheSize() const {
+        return scram_key_cache_size.load(std::memory_order_acquire);
+    }
+
+    void setScramKeyCacheSize(size_t value) {
+        scram_key_cache_size.store(value, std::memory_order_release);
+        has.scram_key_cache_size = true;
+        notify_changed("scram_key_cache_size");
+    }
+
     void setExternalAuthServiceEnabled(bool enable) {
         external_auth_service.store(enable, std::memory_order_release);
         has.external_auth_service = true;
@@ -775,6 +1094,18 @@ public:
         notify_changed("active_external_users_push_interval");
     }
 
+    /// Get the time a successful external authentication may be reused
+    /// for without asking the authentication provider (0 == disabled)
+    std::chrono::seconds getExternalAuthCacheTtl() const {
+        return external_auth_cache_ttl.load(std::memory_order_acquire);
+    }
+
+    void setExternalAuthCacheTtl(const std::chrono::seconds ttl) {
+        external_auth_cache_ttl.store(ttl, std::memory_order_release);
+        has.external_auth_cache_ttl = true;
+        notify_changed("external_auth_cache_ttl");
+    }
+
     std::string getPortnumberFile() const {
         return portnumber_file;
     }
@@ -839,6 +1170,15 @@ protected:
     /// Should the server always collect trace information for commands
     std::atomic_bool always_collect_trace_info{false};
 
+    /// 1 in N commands are recorded in the command trace logs (0 = disabled)
+    std::atomic<size_t> command_trace_sample_rate{0};
+
+    /// The file to capture the workload to (empty = disabled)
+    folly::Synchronized<std::string> workload_capture_file;
+
+    /// Store the hash of the keys in the workload capture
+    std::atomic_bool workload_capture_hash_keys{true};
+
     /**
      * The file containing the RBAC user data
      */
@@ -922,6 +1262,16 @@ protected:
     /// limit is set to 40MB (2x the max document size)
     std::atomic<size_t> max_send_queue_size{40 * 1024 * 1024};
 
+    /// The minimum value size to send with MSG_ZEROCOPY (0 == disabled)
+    std::atomic<size_t> zero_copy_send_threshold{0};
+
+    /// The longest (ms) a mutation is deferred under memory pressure
+    /// (0 == disabled)
+    std::atomic<size_t> mutation_admission_max_delay{0};
+
+    /// The maximum size of a socket read or write (0 == libevent default)
+    std::atomic<size_t> network_io_size{0};
+
     /// The SSL cipher list to use for TLS < 1.3
     folly::Synchronized<std::string> ssl_cipher_list;
 
@@ -931,6 +1281,16 @@ protected:
     /// if we should use the ssl cipher ordering
     std::atomic_bool ssl_cipher_order{true};
 
+    /// if we should use kTLS for TLS connections when available
+    std::atomic_bool ssl_kernel_offload{true};
+
+    /// if we should issue TLS session tickets
+    std::atomic_bool ssl_session_tickets{true};
+
+    /// how often the key used to encrypt the session tickets is rotated
+    std::atomic<std::chrono::seconds> ssl_session_ticket_rotation{
+            std::chrono::hours(1)};
+
     /**
      * The minimum ssl protocol to use (by default this is TLS1)
      */
@@ -958,6 +1318,28 @@ protected:
      */
     std::atomic_bool dedupe_nmvb_maps{false};
 
+    /**
+     * Should we execute pipelined GETs concurrently on ordered connections
+     */
+    std::atomic_bool ordered_read_pipelining{false};
+
+    /**
+     * The number of sub-document lookup paths each bucket caches
+     */
+    std::atomic<size_t> subdoc_path_cache_size{0};
+
+    /**
+     * The minimum interval (in seconds) between two collections of the high
+     * cardinality Prometheus stats
+     */
+    std::atomic<size_t> prometheus_high_cardinality_interval{0};
+
+    /**
+     * The size (in bytes) of the inflated value from which values are
+     * inflated in the background
+     */
+    std::atomic<size_t> background_inflate_threshold{1024 * 1024};
+
     /**
      * Map of version -> string for error maps
      */
@@ -981,6 +1363,12 @@ protected:
      */
     std::atomic_bool topkeys_enabled{false};
 
+    std::atomic<uint32_t> stats_sample_rate{1};
+
+    /// The number of front-end threads reserved for each bucket
+    folly::Synchronized<std::map<std::string, size_t>>
+            bucket_thread_reservations;
+
     /**
      * Is tracing enabled or not
      */
@@ -991,6 +1379,14 @@ protected:
      */
     std::atomic_bool stdin_listener{true};
 
+    /**
+     * Pin front-end threads to NUMA nodes
+     */
+    std::atomic_bool numa_thread_placement{false};
+
+    /// Should each front-end thread have its own SO_REUSEPORT listener
+    std::atomic_bool reuse_port_listeners{false};
+
     /**
      * Should we allow for using the external authentication service or not
      */
@@ -999,6 +1395,10 @@ protected:
     std::atomic<std::chrono::microseconds> active_external_users_push_interval{
             std::chrono::minutes(5)};
 
+    /// How long a successful external authentication may be reused for
+    std::atomic<std::chrono::seconds> external_auth_cache_ttl{
+            std::chrono::seconds(0)};
+
     /// The maximum number of connections allowed
     std::atomic<size_t> max_connections{60000};
 
@@ -1017,6 +1417,12 @@ protected:
     /// The salt to return to users we don't know about
     folly::Synchronized<std::string> scramsha_fallback_salt;
 
+    /// The number of threads running the SASL authentications
+    std::atomic<size_t> num_auth_threads{2};
+
+    /// The number of users to cache the SCRAM keys for
+    std::atomic<size_t> scram_key_cache_size{1024};
+
     /**
      * Note that it is not safe to add new listeners after we've spun up
      * new threads as we don't try to lock the object.
@@ -1047,6 +1453,9 @@ public:
      */
     struct {
         bool always_collect_trace_info = false;
+        bool command_trace_sample_rate = false;
+        bool workload_capture_file = false;
+        bool workload_capture_hash_keys = false;
         bool rbac_file = false;
         bool privilege_debug = false;
         bool threads = false;
@@ -1065,6 +1474,9 @@ public:
         bool breakpad = false;
         bool max_packet_size = false;
         bool max_send_queue_size = false;
+        bool zero_copy_send_threshold = false;
+        bool mutation_admission_max_delay = false;
+        bool network_io_size = false;
         bool ssl_cipher_list = false;
         bool ssl_cipher_order = false;
         bool ssl_cipher_suites = false;
@@ -1074,16 +1486,30 @@ public:
         bool sasl_mechanisms = false;
         bool ssl_sasl_mechanisms = false;
         bool dedupe_nmvb_maps = false;
+        bool ordered_read_pipelining = false;
+        bool subdoc_path_cache_size = false;
+        bool prometheus_high_cardinality_interval = false;
+        bool background_inflate_threshold = false;
         bool error_maps = false;
         bool xattr_enabled = false;
         bool collections_enabled = false;
         bool opcode_attributes_override = false;
         bool topkeys_enabled = false;
+        bool stats_sample_rate = false;
+        bool bucket_thread_reservations = false;
         bool tracing_enabled = false;
         bool stdin_listener = false;
+        bool numa_thread_placement = false;
+        bool reuse_port_listeners = false;
+        bool ssl_kernel_offload = false;
+        bool ssl_session_tickets = false;
+        bool ssl_session_ticket_rotation = false;
         bool scramsha_fallback_salt = false;
+        bool num_auth_threads = false;
+        bool scram_key_cache_size = false;
         bool external_auth_service = false;
         bool active_external_users_push_interval = false;
+        bool external_auth_cache_ttl = false;
         bool max_connections = false;
         bool system_connections = false;
         bool max_concurrent_commands_per_connection = false;
@@ -590,6 +590,52 @@ TEST_F(SettingsTest, StdinListener) {
     }
 }
 
+TEST_F(SettingsTest, NumaThreadPlacement) {
+    nonBooleanValuesShouldFail("numa_thread_placement");
+
+    nlohmann::json obj;
+    obj["numa_thread_placement"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isNumaThreadPlacementEnabled());
+        EXPECT_TRUE(settings.has.numa_thread_placement);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["numa_thread_placement"] = false;
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isNumaThreadPlacementEnabled());
+        EXPECT_TRUE(settings.has.numa_thread_placement);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, ReusePortListeners) {
+    nonBooleanValuesShouldFail("reuse_port_listeners");
+
+    nlohmann::json obj;
+    obj["reuse_port_listeners"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isReusePortListenersEnabled());
+        EXPECT_TRUE(settings.has.reuse_port_listeners);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["reuse_port_listeners"] = false;
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isReusePortListenersEnabled());
+        EXPECT_TRUE(settings.has.reuse_port_listeners);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
 TEST_F(SettingsTest, TopkeysEnabled) {
     nonBooleanValuesShouldFail("topkeys_enabled");
 
@@ -840,6 +886,68 @@ TEST_F(SettingsTest, SslCipherOrder) {
     }
 }
 
+TEST_F(SettingsTest, SslKernelOffload) {
+    nonBooleanValuesShouldFail("ssl_kernel_offload");
+
+    nlohmann::json obj;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.has.ssl_kernel_offload);
+    EXPECT_TRUE(settings.isSslKernelOffload());
+
+    obj["ssl_kernel_offload"] = false;
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isSslKernelOffload());
+        EXPECT_TRUE(settings.has.ssl_kernel_offload);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["ssl_kernel_offload"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isSslKernelOffload());
+        EXPECT_TRUE(settings.has.ssl_kernel_offload);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, SslSessionTickets) {
+    nonBooleanValuesShouldFail("ssl_session_tickets");
+
+    nlohmann::json obj;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.has.ssl_session_tickets);
+    EXPECT_TRUE(settings.isSslSessionTickets());
+
+    obj["ssl_session_tickets"] = false;
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isSslSessionTickets());
+        EXPECT_TRUE(settings.has.ssl_session_tickets);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, SslSessionTicketRotation) {
+    nonNumericValuesShouldFail("ssl_session_ticket_rotation");
+
+    EXPECT_EQ(std::chrono::hours(1),
+              Settings().getSslSessionTicketRotation());
+
+    nlohmann::json obj;
+    obj["ssl_session_ticket_rotation"] = 60;
+    Settings settings(obj);
+    EXPECT_EQ(std::chrono::seconds(60),
+              settings.getSslSessionTicketRotation());
+    EXPECT_TRUE(settings.has.ssl_session_ticket_rotation);
+
+    obj["ssl_session_ticket_rotation"] = 0;
+    expectFail<std::invalid_argument>(obj);
+}
+
 TEST_F(SettingsTest, SslMinimumProtocol) {
     nonStringValuesShouldFail("ssl_minimum_protocol");
 
@@ -916,6 +1024,76 @@ TEST_F(SettingsTest, max_packet_size) {
     }
 }
 
+TEST_F(SettingsTest, zero_copy_send_threshold) {
+    nonNumericValuesShouldFail("zero_copy_send_threshold");
+
+    EXPECT_EQ(0, Settings().getZeroCopySendThreshold());
+
+    nlohmann::json obj;
+    const size_t threshold = 64 * 1024;
+    obj["zero_copy_send_threshold"] = threshold;
+    Settings settings(obj);
+    EXPECT_EQ(threshold, settings.getZeroCopySendThreshold());
+    EXPECT_TRUE(settings.has.zero_copy_send_threshold);
+}
+
+TEST_F(SettingsTest, mutation_admission_max_delay) {
+    nonNumericValuesShouldFail("mutation_admission_max_delay");
+
+    EXPECT_EQ(std::chrono::milliseconds(0),
+              Settings().getMutationAdmissionMaxDelay());
+
+    nlohmann::json obj;
+    obj["mutation_admission_max_delay"] = 250;
+    Settings settings(obj);
+    EXPECT_EQ(std::chrono::milliseconds(250),
+              settings.getMutationAdmissionMaxDelay());
+    EXPECT_TRUE(settings.has.mutation_admission_max_delay);
+}
+
+TEST_F(SettingsTest, network_io_size) {
+    nonNumericValuesShouldFail("network_io_size");
+
+    EXPECT_EQ(0, Settings().getNetworkIoSize());
+
+    nlohmann::json obj;
+    const size_t size = 256 * 1024;
+    obj["network_io_size"] = size;
+    Settings settings(obj);
+    EXPECT_EQ(size, settings.getNetworkIoSize());
+    EXPECT_TRUE(settings.has.network_io_size);
+}
+
+TEST_F(SettingsTest, num_auth_threads) {
+    nonNumericValuesShouldFail("num_auth_threads");
+
+    EXPECT_EQ(2, Settings().getNumAuthThreads());
+
+    nlohmann::json obj;
+    obj["num_auth_threads"] = 4;
+    Settings settings(obj);
+    EXPECT_EQ(4, settings.getNumAuthThreads());
+    EXPECT_TRUE(settings.has.num_auth_threads);
+
+    // It can't be changed dynamically
+    obj["num_auth_threads"] = 8;
+    Settings updated(obj);
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
+TEST_F(SettingsTest, scram_key_cache_size) {
+    nonNumericValuesShouldFail("scram_key_cache_size");
+
+    EXPECT_EQ(1024, Settings().getScramKeyCacheSize());
+
+    nlohmann::json obj;
+    obj["scram_key_cache_size"] = 0;
+    Settings settings(obj);
+    EXPECT_EQ(0, settings.getScramKeyCacheSize());
+    EXPECT_TRUE(settings.has.scram_key_cache_size);
+}
+
 TEST_F(SettingsTest, max_connections) {
     nonNumericValuesShouldFail("max_connections");
 
@@ -997,6 +1175,82 @@ TEST_F(SettingsTest, DedupeNmvbMaps) {
     }
 }
 
+TEST_F(SettingsTest, OrderedReadPipelining) {
+    nonBooleanValuesShouldFail("ordered_read_pipelining");
+
+    nlohmann::json obj;
+    obj["ordered_read_pipelining"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isOrderedReadPipelining());
+        EXPECT_TRUE(settings.has.ordered_read_pipelining);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, SubdocPathCacheSize) {
+    nonNumericValuesShouldFail("subdoc_path_cache_size");
+
+    nlohmann::json obj;
+    const size_t size = 10000;
+    obj["subdoc_path_cache_size"] = size;
+    Settings settings(obj);
+    EXPECT_EQ(size, settings.getSubdocPathCacheSize());
+    EXPECT_TRUE(settings.has.subdoc_path_cache_size);
+}
+
+TEST_F(SettingsTest, CommandTraceSampleRate) {
+    nonNumericValuesShouldFail("command_trace_sample_rate");
+
+    nlohmann::json obj;
+    obj["command_trace_sample_rate"] = 1000;
+    Settings settings(obj);
+    EXPECT_EQ(1000, settings.getCommandTraceSampleRate());
+    EXPECT_TRUE(settings.has.command_trace_sample_rate);
+}
+
+TEST_F(SettingsTest, WorkloadCaptureFile) {
+    nonStringValuesShouldFail("workload_capture_file");
+
+    nlohmann::json obj;
+    obj["workload_capture_file"] = "/tmp/capture";
+    Settings settings(obj);
+    EXPECT_EQ("/tmp/capture", settings.getWorkloadCaptureFile());
+    EXPECT_TRUE(settings.has.workload_capture_file);
+}
+
+TEST_F(SettingsTest, WorkloadCaptureHashKeys) {
+    nonBooleanValuesShouldFail("workload_capture_hash_keys");
+
+    nlohmann::json obj;
+    obj["workload_capture_hash_keys"] = false;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.isWorkloadCaptureHashKeys());
+    EXPECT_TRUE(settings.has.workload_capture_hash_keys);
+}
+
+TEST_F(SettingsTest, PrometheusHighCardinalityInterval) {
+    nonNumericValuesShouldFail("prometheus_high_cardinality_interval");
+
+    nlohmann::json obj;
+    obj["prometheus_high_cardinality_interval"] = 60;
+    Settings settings(obj);
+    EXPECT_EQ(std::chrono::seconds(60),
+              settings.getPrometheusHighCardinalityInterval());
+    EXPECT_TRUE(settings.has.prometheus_high_cardinality_interval);
+}
+
+TEST_F(SettingsTest, BackgroundInflateThreshold) {
+    nonNumericValuesShouldFail("background_inflate_threshold");
+
+    nlohmann::json obj;
+    obj["background_inflate_threshold"] = 65536;
+    Settings settings(obj);
+    EXPECT_EQ(65536, settings.getBackgroundInflateThreshold());
+    EXPECT_TRUE(settings.has.background_inflate_threshold);
+}
+
 TEST_F(SettingsTest, XattrEnabled) {
     nonBooleanValuesShouldFail("xattr_enabled");
 
@@ -1066,6 +1320,62 @@ TEST_F(SettingsTest, ExternalAuthService) {
     }
 }
 
+TEST_F(SettingsTest, StatsSampleRate) {
+    nonNumericValuesShouldFail("stats_sample_rate");
+
+    EXPECT_EQ(1, Settings().getStatsSampleRate());
+
+    nlohmann::json obj;
+    obj["stats_sample_rate"] = 16;
+    Settings settings(obj);
+    EXPECT_EQ(16, settings.getStatsSampleRate());
+    EXPECT_TRUE(settings.has.stats_sample_rate);
+
+    obj["stats_sample_rate"] = 0;
+    expectFail<std::invalid_argument>(obj);
+    obj["stats_sample_rate"] = 65536;
+    expectFail<std::invalid_argument>(obj);
+}
+
+TEST_F(SettingsTest, BucketThreadReservations) {
+    nlohmann::json json;
+    json["bucket_thread_reservations"] = 1;
+    expectFail(json);
+    json["bucket_thread_reservations"] = nlohmann::json::array();
+    expectFail(json);
+    json["bucket_thread_reservations"] = {{"travel", "2"}};
+    expectFail(json);
+
+    EXPECT_TRUE(Settings().getBucketThreadReservations().empty());
+
+    nlohmann::json obj;
+    obj["bucket_thread_reservations"] = {{"travel", 2}, {"beer", 1}};
+    Settings settings(obj);
+    const std::map<std::string, size_t> expected = {{"beer", 1},
+                                                    {"travel", 2}};
+    EXPECT_EQ(expected, settings.getBucketThreadReservations());
+    EXPECT_TRUE(settings.has.bucket_thread_reservations);
+
+    obj["bucket_thread_reservations"] = {{"travel", 0}};
+    expectFail<std::invalid_argument>(obj);
+}
+
+TEST_F(SettingsTest, ExternalAuthCacheTtl) {
+    nlohmann::json json;
+    json["external_auth_cache_ttl"] = true;
+    expectFail(json);
+    json["external_auth_cache_ttl"] = nlohmann::json::array();
+    expectFail(json);
+
+    EXPECT_EQ(std::chrono::seconds(0), Settings().getExternalAuthCacheTtl());
+
+    nlohmann::json obj;
+    obj["external_auth_cache_ttl"] = 300;
+    Settings settings(obj);
+    EXPECT_EQ(std::chrono::seconds(300), settings.getExternalAuthCacheTtl());
+    EXPECT_TRUE(settings.has.external_auth_cache_ttl);
+}
+
 TEST_F(SettingsTest, ScramshaFallbackSalt) {
     nonStringValuesShouldFail("scramsha_fallback_salt");
     nlohmann::json obj;
@@ -1575,6 +1885,82 @@ TEST(SettingsUpdateTest, DedupeNmvbMapsIsDynamic) {
     EXPECT_FALSE(settings.isDedupeNmvbMaps());
 }
 
+TEST(SettingsUpdateTest, OrderedReadPipeliningIsDynamic) {
+    Settings settings;
+    Settings updated;
+    // setting it to the same value should work
+    settings.setOrderedReadPipelining(true);
+    updated.setOrderedReadPipelining(settings.isOrderedReadPipelining());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // Changing it should also work
+    updated.setOrderedReadPipelining(!settings.isOrderedReadPipelining());
+    EXPECT_TRUE(settings.isOrderedReadPipelining());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_TRUE(settings.isOrderedReadPipelining());
+    EXPECT_NO_THROW(settings.updateSettings(updated, true));
+    EXPECT_FALSE(settings.isOrderedReadPipelining());
+}
+
+TEST(SettingsUpdateTest, SubdocPathCacheSizeIsDynamic) {
+    Settings updated;
+    Settings settings;
+    settings.setSubdocPathCacheSize(10);
+    // setting it to the same value should work
+    updated.setSubdocPathCacheSize(10);
+    settings.updateSettings(updated, false);
+
+    // changing it should work
+    updated.setSubdocPathCacheSize(1000);
+    settings.updateSettings(updated, true);
+    EXPECT_EQ(1000, settings.getSubdocPathCacheSize());
+}
+
+TEST(SettingsUpdateTest, CommandTraceSampleRateIsDynamic) {
+    Settings updated;
+    Settings settings;
+    EXPECT_EQ(0, settings.getCommandTraceSampleRate());
+
+    updated.setCommandTraceSampleRate(100);
+    settings.updateSettings(updated, true);
+    EXPECT_EQ(100, settings.getCommandTraceSampleRate());
+}
+
+TEST(SettingsUpdateTest, WorkloadCaptureIsDynamic) {
+    Settings updated;
+    Settings settings;
+    EXPECT_EQ("", settings.getWorkloadCaptureFile());
+    EXPECT_TRUE(settings.isWorkloadCaptureHashKeys());
+
+    updated.setWorkloadCaptureFile("/tmp/capture");
+    updated.setWorkloadCaptureHashKeys(false);
+    settings.updateSettings(updated, true);
+    EXPECT_EQ("/tmp/capture", settings.getWorkloadCaptureFile());
+    EXPECT_FALSE(settings.isWorkloadCaptureHashKeys());
+}
+
+TEST(SettingsUpdateTest, PrometheusHighCardinalityIntervalIsDynamic) {
+    Settings updated;
+    Settings settings;
+    EXPECT_EQ(std::chrono::seconds(0),
+              settings.getPrometheusHighCardinalityInterval());
+
+    updated.setPrometheusHighCardinalityInterval(30);
+    settings.updateSettings(updated, true);
+    EXPECT_EQ(std::chrono::seconds(30),
+              settings.getPrometheusHighCardinalityInterval());
+}
+
+TEST(SettingsUpdateTest, BackgroundInflateThresholdIsDynamic) {
+    Settings updated;
+    Settings settings;
+    EXPECT_EQ(1024 * 1024, settings.getBackgroundInflateThreshold());
+
+    updated.setBackgroundInflateThreshold(0);
+    settings.updateSettings(updated, true);
+    EXPECT_EQ(0, settings.getBackgroundInflateThreshold());
+}
+
 TEST(SettingsUpdateTest, OpcodeAttributesOverrideIsDynamic) {
     Settings settings;
     Settings updated;
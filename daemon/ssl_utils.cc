@@ -20,9 +20,20 @@
 #include "listening_port.h"
 #include "settings.h"
 #include <folly/Synchronized.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
 #include <openssl/ssl.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <chrono>
+#include <cstring>
+#include <optional>
 #include <stdexcept>
 
 long decode_ssl_protocol(const std::string& protocol) {
@@ -73,6 +84,157 @@ void set_ssl_ctx_ciphers(SSL_CTX* ctx,
     }
 }
 
+/**
+ * The keys used to encrypt (and authenticate) the TLS session tickets.
+ * They're shared by all of the SSL_CTX objects (and hence by all of the
+ * front-end threads and interfaces), and survive invalidateSslCache() so
+ * that a settings change doesn't invalidate the tickets the clients hold.
+ *
+ * The current key is replaced by a new random key once it gets older than
+ * the "ssl_session_ticket_rotation" setting. The tickets encrypted with the
+ * previous key are still accepted (and replaced by a new ticket), so a
+ * ticket is valid for up to two rotation periods.
+ */
+class TicketKeys {
+public:
+    struct Key {
+        std::array<unsigned char, 16> name;
+        std::array<unsigned char, 32> aes;
+        std::array<unsigned char, 32> hmac;
+    };
+
+    /// Get the key to encrypt new tickets with (rotating it if due)
+    Key getCurrent() {
+        const auto now = std::chrono::steady_clock::now();
+        const auto rotation =
+                Settings::instance().getSslSessionTicketRotation();
+        auto locked = keys.wlock();
+        if (!locked->current || now - locked->created >= rotation) {
+            locked->previous = locked->current;
+            locked->current = generate();
+            locked->created = now;
+        }
+        return *locked->current;
+    }
+
+    /**
+     * Look up the key a ticket was encrypted with
+     *
+     * @param name the key name from the ticket
+     * @param key where to store the key
+     * @return 0 if the key is unknown (a full handshake is required), 1 if
+     *         it is the current key, 2 if the ticket should be renewed
+     */
+    int lookup(const unsigned char* name, Key& key) {
+        auto locked = keys.rlock();
+        if (locked->current &&
+            std::memcmp(name, locked->current->name.data(), 16) == 0) {
+            key = *locked->current;
+            return 1;
+        }
+        if (locked->previous &&
+            std::memcmp(name, locked->previous->name.data(), 16) == 0) {
+            key = *locked->previous;
+            return 2;
+        }
+        return 0;
+    }
+
+protected:
+    static Key generate() {
+        Key key;
+        if (RAND_bytes(key.name.data(), int(key.name.size())) != 1 ||
+            RAND_bytes(key.aes.data(), int(key.aes.size())) != 1 ||
+            RAND_bytes(key.hmac.data(), int(key.hmac.size())) != 1) {
+            throw std::runtime_error(
+                    "TicketKeys::generate: Failed to generate a new key");
+        }
+        return key;
+    }
+
+    struct State {
+        std::optional<Key> current;
+        std::optional<Key> previous;
+        std::chrono::steady_clock::time_point created;
+    };
+    folly::Synchronized<State> keys;
+};
+
+static TicketKeys ticketKeys;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+using TicketHmacCtx = EVP_MAC_CTX;
+#else
+using TicketHmacCtx = HMAC_CTX;
+#endif
+
+static bool initTicketHmac(TicketHmacCtx* hctx, const TicketKeys::Key& key) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    std::array<OSSL_PARAM, 3> params = {
+            {OSSL_PARAM_construct_octet_string(
+                     OSSL_MAC_PARAM_KEY,
+                     const_cast<unsigned char*>(key.hmac.data()),
+                     key.hmac.size()),
+             OSSL_PARAM_construct_utf8_string(
+                     OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA256"), 0),
+             OSSL_PARAM_construct_end()}};
+    return EVP_MAC_CTX_set_params(hctx, params.data()) == 1;
+#else
+    return HMAC_Init_ex(hctx,
+                        key.hmac.data(),
+                        int(key.hmac.size()),
+                        EVP_sha256(),
+                        nullptr) == 1;
+#endif
+}
+
+/**
+ * The callback OpenSSL calls to encrypt a new session ticket (enc == 1) or
+ * to decrypt a ticket presented by the client (enc == 0).
+ *
+ * @return -1 on error, 0 if the ticket can't be decrypted (so a full
+ *         handshake is needed), 1 on success and 2 on success if a new
+ *         ticket should be issued
+ */
+static int sessionTicketCallback(SSL*,
+                                 unsigned char* name,
+                                 unsigned char* iv,
+                                 EVP_CIPHER_CTX* ectx,
+                                 TicketHmacCtx* hctx,
+                                 int enc) {
+    try {
+        TicketKeys::Key key;
+        int ret = 1;
+        if (enc) {
+            key = ticketKeys.getCurrent();
+            std::copy(key.name.begin(), key.name.end(), name);
+            if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1 ||
+                EVP_EncryptInit_ex(ectx,
+                                   EVP_aes_256_cbc(),
+                                   nullptr,
+                                   key.aes.data(),
+                                   iv) != 1) {
+                return -1;
+            }
+        } else {
+            ret = ticketKeys.lookup(name, key);
+            if (ret == 0) {
+                return 0;
+            }
+            if (EVP_DecryptInit_ex(ectx,
+                                   EVP_aes_256_cbc(),
+                                   nullptr,
+                                   key.aes.data(),
+                                   iv) != 1) {
+                return -1;
+            }
+        }
+        return initTicketHmac(hctx, key) ? ret : -1;
+    } catch (const std::exception&) {
+        return -1;
+    }
+}
+
 struct ssl_ctx_st_deleter {
     void operator()(ssl_ctx_st* ctx) {
         SSL_CTX_free(ctx);
@@ -90,6 +252,34 @@ static uniqueSslCtxPtr createCacheEntry(const ListeningPort& ifc) {
     SSL_CTX_set_mode(server_ctx,
                      SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
                              SSL_MODE_ENABLE_PARTIAL_WRITE);
+#ifdef SSL_OP_ENABLE_KTLS
+    if (settings.isSslKernelOffload()) {
+        // OpenSSL hands the keys to the kernel after the handshake if
+        // the kernel supports the negotiated cipher
+        SSL_CTX_set_options(server_ctx, SSL_OP_ENABLE_KTLS);
+    }
+#endif
+
+    // The sessions of the clients which provided a certificate can only
+    // be resumed if the session id context is set
+    static const unsigned char sessionIdContext[] = "memcached";
+    SSL_CTX_set_session_id_context(
+            server_ctx, sessionIdContext, sizeof(sessionIdContext) - 1);
+    if (settings.isSslSessionTickets()) {
+        // Let the tickets live as long as the key they're encrypted with
+        // may be accepted
+        SSL_CTX_set_timeout(
+                server_ctx,
+                long(settings.getSslSessionTicketRotation().count() * 2));
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(server_ctx,
+                                             sessionTicketCallback);
+#else
+        SSL_CTX_set_tlsext_ticket_key_cb(server_ctx, sessionTicketCallback);
+#endif
+    } else {
+        SSL_CTX_set_options(server_ctx, SSL_OP_NO_TICKET);
+    }
 
     if (!SSL_CTX_use_certificate_chain_file(server_ctx, ifc.sslCert.c_str()) ||
         !SSL_CTX_use_PrivateKey_file(
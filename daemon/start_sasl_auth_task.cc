@@ -42,6 +42,7 @@ Task::Status StartSaslAuthTask::execute() {
 }
 
 Task::Status StartSaslAuthTask::internal_auth() {
+    const auto started = recordQueueTime();
     connection.restartAuthentication();
     auto& server = serverContext;
 
@@ -76,10 +77,17 @@ Task::Status StartSaslAuthTask::internal_auth() {
         cookie.setErrorContext("An exception occurred");
         response.first = cb::sasl::Error::FAIL;
     }
+    recordExecutionTime(saslAuthTimings.start, started);
 
     if (response.first == cb::sasl::Error::NO_USER &&
         Settings::instance().isExternalAuthServiceEnabled() &&
         mechanism == "PLAIN") {
+        if (externalAuthManager->isCachedAuthentication(getUsername(),
+                                                        challenge)) {
+            // The user recently authenticated with the same credentials
+            successfull_external_auth();
+            return Status::Finished;
+        }
         // We can't hold this lock when we're trying to enqueue the
         // request
         internal = false;
@@ -115,6 +123,10 @@ void StartSaslAuthTask::successfull_external_auth() {
         response.first = cb::sasl::Error::OK;
         externalAuthManager->login(serverContext.getUsername());
         serverContext.setDomain(cb::sasl::Domain::External);
+        if (!internal) {
+            externalAuthManager->cacheAuthentication(
+                    serverContext.getUsername(), challenge);
+        }
     } catch (const std::exception& e) {
         LOG_WARNING(R"({} successfull_external_auth() failed. UUID[{}] "{}")",
                     connection.getId(),
@@ -126,6 +138,11 @@ void StartSaslAuthTask::successfull_external_auth() {
 
 void StartSaslAuthTask::unsuccessfull_external_auth(
         cb::mcbp::Status status, const std::string& payload) {
+    if (status != cb::mcbp::Status::Etmpfail) {
+        // The credentials (or the user) are no longer valid
+        externalAuthManager->forgetAuthentication(getUsername());
+    }
+
     // The paylaod should contain an error message
     try {
         if (status == cb::mcbp::Status::AuthError) {
@@ -27,6 +27,7 @@
 #include <statistics/labelled_collector.h>
 #include <statistics/prometheus.h>
 
+#include <array>
 #include <string_view>
 
 // add global stats
@@ -47,6 +48,8 @@ static void server_global_stats(StatCollector& collector) {
                       stats.system_conns.load(std::memory_order_relaxed));
     collector.addStat(Key::total_connections, stats.total_conns);
     collector.addStat(Key::connection_structures, stats.conn_structs);
+    collector.addStat(Key::pooled_buffers, stats.pooled_buffers);
+    collector.addStat(Key::borrowed_buffers, stats.borrowed_buffers);
 }
 
 /// add stats aggregated over all buckets
@@ -98,6 +101,10 @@ static void server_bucket_stats(StatCollector& collector,
                       thread_stats.bytes_subdoc_mutation_total);
     collector.addStat(Key::bytes_subdoc_mutation_inserted,
                       thread_stats.bytes_subdoc_mutation_inserted);
+    collector.addStat(Key::subdoc_path_cache_hits,
+                      thread_stats.subdoc_path_cache_hits);
+    collector.addStat(Key::subdoc_path_cache_misses,
+                      thread_stats.subdoc_path_cache_misses);
 
     // bucket specific totals
     auto& current_bucket_timings = bucket.timings;
@@ -122,10 +129,31 @@ static void server_bucket_stats(StatCollector& collector,
     collector.addStat(Key::bytes_read, thread_stats.bytes_read);
     collector.addStat(Key::bytes_written, thread_stats.bytes_written);
     collector.addStat(Key::conn_yields, thread_stats.conn_yields);
+    collector.addStat(Key::conn_migrations, thread_stats.conn_migrations);
+    collector.addStat(Key::mutations_deferred,
+                      thread_stats.mutations_deferred);
     collector.addStat(Key::iovused_high_watermark,
                       thread_stats.iovused_high_watermark);
     collector.addStat(Key::msgused_high_watermark,
                       thread_stats.msgused_high_watermark);
+    collector.addStat(Key::zero_copy_bytes, thread_stats.zero_copy_bytes);
+    collector.addStat(Key::zero_copy_fallbacks,
+                      thread_stats.zero_copy_fallbacks);
+    collector.addStat(Key::zero_copy_completions,
+                      thread_stats.zero_copy_completions);
+    collector.addStat(Key::zero_copy_completion_us,
+                      thread_stats.zero_copy_completion_us);
+    collector.addStat(Key::tls_records_sent, thread_stats.tls_records_sent);
+    collector.addStat(Key::tls_record_bytes, thread_stats.tls_record_bytes);
+    collector.addStat(Key::tls_full_handshakes,
+                      thread_stats.tls_full_handshakes);
+    collector.addStat(Key::tls_resumed_handshakes,
+                      thread_stats.tls_resumed_handshakes);
+    collector.addStat(Key::response_sends, thread_stats.response_sends);
+    collector.addStat(Key::responses_sent, thread_stats.responses_sent);
+    collector.addStat(Key::get_cache_hits, thread_stats.get_cache_hits);
+    collector.addStat(Key::cmd_deadline_exceeded,
+                      thread_stats.cmd_deadline_exceeded);
 
     collector.addStat(Key::cmd_lock, thread_stats.cmd_lock);
     collector.addStat(Key::lock_errors, thread_stats.lock_errors);
@@ -183,4 +211,21 @@ ENGINE_ERROR_CODE server_prometheus_stats(
         return ENGINE_ENOMEM;
     }
     return ENGINE_SUCCESS;
-}
\ No newline at end of file
+}
+uint32_t get_stats_sample_weight(SampledStat stat) {
+    const auto rate = Settings::instance().getStatsSampleRate();
+    if (rate <= 1) {
+        return 1;
+    }
+
+    // Every thread records every rate'th operation (a counter is cheaper
+    // than a random number, and the operations of the connections served
+    // by a thread are interleaved anyway)
+    thread_local std::array<uint32_t, size_t(SampledStat::Count)> counters{};
+    auto& counter = counters[size_t(stat)];
+    if (++counter >= rate) {
+        counter = 0;
+        return rate;
+    }
+    return 0;
+}
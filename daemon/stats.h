@@ -55,6 +55,8 @@ struct thread_stats {
         bytes_read = 0;
         cmd_flush = 0;
         conn_yields = 0;
+        conn_migrations = 0;
+        mutations_deferred = 0;
         auth_cmds = 0;
         auth_errors = 0;
         cmd_subdoc_lookup = 0;
@@ -66,9 +68,28 @@ struct thread_stats {
         bytes_subdoc_lookup_extracted = 0;
         bytes_subdoc_mutation_total = 0;
         bytes_subdoc_mutation_inserted = 0;
+        subdoc_path_cache_hits = 0;
+        subdoc_path_cache_misses = 0;
 
         iovused_high_watermark = 0;
         msgused_high_watermark = 0;
+
+        zero_copy_bytes = 0;
+        zero_copy_fallbacks = 0;
+        zero_copy_completions = 0;
+        zero_copy_completion_us = 0;
+
+        tls_records_sent = 0;
+        tls_record_bytes = 0;
+        tls_full_handshakes = 0;
+        tls_resumed_handshakes = 0;
+
+        response_sends = 0;
+        responses_sent = 0;
+
+        get_cache_hits = 0;
+
+        cmd_deadline_exceeded = 0;
     }
 
     thread_stats & operator += (const thread_stats &other) {
@@ -89,6 +110,8 @@ struct thread_stats {
         bytes_written += other.bytes_written;
         cmd_flush += other.cmd_flush;
         conn_yields += other.conn_yields;
+        conn_migrations += other.conn_migrations;
+        mutations_deferred += other.mutations_deferred;
         auth_cmds += other.auth_cmds;
         auth_errors += other.auth_errors;
         cmd_subdoc_lookup += other.cmd_subdoc_lookup;
@@ -101,10 +124,29 @@ struct thread_stats {
         bytes_subdoc_lookup_extracted += other.bytes_subdoc_lookup_extracted;
         bytes_subdoc_mutation_total += other.bytes_subdoc_mutation_total;
         bytes_subdoc_mutation_inserted += other.bytes_subdoc_mutation_inserted;
+        subdoc_path_cache_hits += other.subdoc_path_cache_hits;
+        subdoc_path_cache_misses += other.subdoc_path_cache_misses;
 
         iovused_high_watermark.setIfGreater(other.iovused_high_watermark);
         msgused_high_watermark.setIfGreater(other.msgused_high_watermark);
 
+        zero_copy_bytes += other.zero_copy_bytes;
+        zero_copy_fallbacks += other.zero_copy_fallbacks;
+        zero_copy_completions += other.zero_copy_completions;
+        zero_copy_completion_us += other.zero_copy_completion_us;
+
+        tls_records_sent += other.tls_records_sent;
+        tls_record_bytes += other.tls_record_bytes;
+        tls_full_handshakes += other.tls_full_handshakes;
+        tls_resumed_handshakes += other.tls_resumed_handshakes;
+
+        response_sends += other.response_sends;
+        responses_sent += other.responses_sent;
+
+        get_cache_hits += other.get_cache_hits;
+
+        cmd_deadline_exceeded += other.cmd_deadline_exceeded;
+
         return *this;
     }
 
@@ -132,6 +174,11 @@ struct thread_stats {
     cb::RelaxedAtomic<uint64_t> cmd_flush;
     cb::RelaxedAtomic<uint64_t>
             conn_yields; /* # of yields for connections (-R option)*/
+    /// # of connections moved to the front-end threads of their bucket
+    cb::RelaxedAtomic<uint64_t> conn_migrations;
+    /// # of mutations left unread as the bucket was under memory pressure
+    /// (see mutation_admission_max_delay)
+    cb::RelaxedAtomic<uint64_t> mutations_deferred;
     cb::RelaxedAtomic<uint64_t> auth_cmds;
     cb::RelaxedAtomic<uint64_t> auth_errors;
     /* # of subdoc lookup commands (GET/EXISTS/MULTI_LOOKUP) */
@@ -158,11 +205,52 @@ struct thread_stats {
     /* # of bytes inserted during a subdoc mutation operation (which were
        received from the client). */
     cb::RelaxedAtomic<uint64_t> bytes_subdoc_mutation_inserted;
+    /* # of subdoc lookup paths found in the subdoc path cache (when
+       enabled) */
+    cb::RelaxedAtomic<uint64_t> subdoc_path_cache_hits;
+    /* # of subdoc lookup paths not found in the subdoc path cache (when
+       enabled) */
+    cb::RelaxedAtomic<uint64_t> subdoc_path_cache_misses;
 
     /* Highest value iovsize has got to */
     cb::RelaxedAtomic<int> iovused_high_watermark;
     /* High value Connection->msgused has got to */
     cb::RelaxedAtomic<int> msgused_high_watermark;
+
+    /* # of bytes handed to the kernel with MSG_ZEROCOPY */
+    cb::RelaxedAtomic<uint64_t> zero_copy_bytes;
+    /* # of values large enough for a zero-copy send which had to be copied
+       to the socket (TLS excluded) */
+    cb::RelaxedAtomic<uint64_t> zero_copy_fallbacks;
+    /* # of zero-copy sends the kernel reported as completed */
+    cb::RelaxedAtomic<uint64_t> zero_copy_completions;
+    /* Total time (in us) from a zero-copy send until the kernel reported it
+       as completed. Compare with 'zero_copy_completions' */
+    cb::RelaxedAtomic<uint64_t> zero_copy_completion_us;
+
+    /* # of TLS application data records sent (encrypted by OpenSSL) */
+    cb::RelaxedAtomic<uint64_t> tls_records_sent;
+    /* # of bytes in the TLS records sent. Compare with 'tls_records_sent'
+       for the average record size */
+    cb::RelaxedAtomic<uint64_t> tls_record_bytes;
+    /* # of TLS handshakes which negotiated a new session */
+    cb::RelaxedAtomic<uint64_t> tls_full_handshakes;
+    /* # of TLS handshakes which resumed a session (from a session ticket
+       or the session cache) */
+    cb::RelaxedAtomic<uint64_t> tls_resumed_handshakes;
+
+    /* # of times the responses of a round of commands were moved to the
+       output stream in one go */
+    cb::RelaxedAtomic<uint64_t> response_sends;
+    /* # of responses in them. Compare with 'response_sends' for the
+       average number of responses per send */
+    cb::RelaxedAtomic<uint64_t> responses_sent;
+
+    /* # of GETs served from the front end thread's response cache */
+    cb::RelaxedAtomic<uint64_t> get_cache_hits;
+
+    /* # of commands failed as their deadline passed before they started */
+    cb::RelaxedAtomic<uint64_t> cmd_deadline_exceeded;
 };
 
 /**
@@ -195,6 +283,12 @@ struct stats {
 
     /** The number of times I reject a client */
     cb::RelaxedAtomic<uint64_t> rejected_conns;
+
+    /** The number of free buffers in the front end thread buffer pools */
+    cb::RelaxedAtomic<uint64_t> pooled_buffers;
+
+    /** The number of buffers borrowed from them by the connections */
+    cb::RelaxedAtomic<uint64_t> borrowed_buffers;
 };
 
 extern stats stats;
@@ -202,6 +296,19 @@ extern stats stats;
 class Connection;
 struct thread_stats* get_thread_stats(Connection* c);
 
+/// The per-operation accounting which may be sampled
+/// (see Settings::getStatsSampleRate())
+enum class SampledStat { Timings, Topkeys, Count };
+
+/**
+ * Decide if the calling thread should record the current operation in the
+ * given (sampled) stat.
+ *
+ * @return the number of operations to record it as (the sample rate), or
+ *         0 if the operation should not be recorded
+ */
+uint32_t get_stats_sample_weight(SampledStat stat);
+
 class StatCollector;
 class Bucket;
 ENGINE_ERROR_CODE server_stats(StatCollector& collector, const Bucket& bucket);
@@ -30,6 +30,7 @@ StepSaslAuthTask::StepSaslAuthTask(Cookie& cookie_,
 }
 
 Task::Status StepSaslAuthTask::execute() {
+    const auto started = recordQueueTime();
     auto& server = connection.getSaslConn();
 
     try {
@@ -53,6 +54,7 @@ Task::Status StepSaslAuthTask::execute() {
         cookie.setErrorContext("An exception occurred");
         response.first = cb::sasl::Error::FAIL;
     }
+    recordExecutionTime(saslAuthTimings.step, started);
     return Status::Finished;
 }
 
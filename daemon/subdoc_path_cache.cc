@@ -0,0 +1,94 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "subdoc_path_cache.h"
+
+#include <algorithm>
+
+std::string SubdocPathCache::makeId(Vbid vbid,
+                                    std::string_view key,
+                                    std::string_view path) {
+    // The key length is encoded so that (key, path) pairs can't collide
+    const auto vb = vbid.get();
+    const auto keylen = uint16_t(key.size());
+    std::string id;
+    id.reserve(sizeof(vb) + sizeof(keylen) + key.size() + path.size());
+    id.append(reinterpret_cast<const char*>(&vb), sizeof(vb));
+    id.append(reinterpret_cast<const char*>(&keylen), sizeof(keylen));
+    id.append(key);
+    id.append(path);
+    return id;
+}
+
+std::optional<SubdocPathCache::Location> SubdocPathCache::lookup(
+        Vbid vbid,
+        std::string_view key,
+        uint64_t cas,
+        std::string_view path) {
+    if (size() == 0) {
+        return {};
+    }
+
+    const auto id = makeId(vbid, key, path);
+    auto& partition = getPartition(vbid);
+    std::lock_guard<std::mutex> guard(partition.mutex);
+    auto it = partition.index.find(id);
+    if (it == partition.index.end() || it->second->cas != cas) {
+        return {};
+    }
+    partition.lru.splice(partition.lru.begin(), partition.lru, it->second);
+    return it->second->location;
+}
+
+void SubdocPathCache::insert(Vbid vbid,
+                             std::string_view key,
+                             uint64_t cas,
+                             std::string_view path,
+                             Location location,
+                             size_t capacity) {
+    const size_t limit = std::max(size_t(1), capacity / NumPartitions);
+    auto id = makeId(vbid, key, path);
+    auto& partition = getPartition(vbid);
+    std::lock_guard<std::mutex> guard(partition.mutex);
+
+    auto it = partition.index.find(id);
+    if (it != partition.index.end()) {
+        // The document changed since the path was cached
+        it->second->cas = cas;
+        it->second->location = location;
+        partition.lru.splice(partition.lru.begin(), partition.lru, it->second);
+        return;
+    }
+
+    while (partition.lru.size() >= limit) {
+        partition.index.erase(partition.lru.back().id);
+        partition.lru.pop_back();
+        entries--;
+    }
+
+    partition.lru.push_front({std::move(id), cas, location});
+    partition.index.emplace(partition.lru.front().id, partition.lru.begin());
+    entries++;
+}
+
+void SubdocPathCache::clear() {
+    for (auto& partition : partitions) {
+        std::lock_guard<std::mutex> guard(partition.mutex);
+        entries -= partition.lru.size();
+        partition.index.clear();
+        partition.lru.clear();
+    }
+}
@@ -0,0 +1,116 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/vbucket.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Bounded cache of where in a document the value of a sub-document lookup
+ * was found, so that repeated SUBDOC_GET lookups of the same paths in an
+ * unchanged document don't need subjson to parse the document up to the
+ * value each time.
+ *
+ * Entries are keyed by (vBucket, key, path) and record the CAS of the
+ * document they were resolved in: an entry is only used for a document with
+ * the same CAS, and the next lookup after the document changed replaces it.
+ * The entries are partitioned by vBucket, with each partition evicting its
+ * least recently used entries.
+ */
+class SubdocPathCache {
+public:
+    /// Location of a value relative to the start of the document body
+    struct Location {
+        size_t offset;
+        size_t length;
+    };
+
+    /**
+     * Look up the location of a path in a document
+     *
+     * @param vbid the vBucket of the document
+     * @param key the key of the document
+     * @param cas the CAS of the document
+     * @param path the path looked up
+     * @return the location of the value if cached for this CAS
+     */
+    std::optional<Location> lookup(Vbid vbid,
+                                   std::string_view key,
+                                   uint64_t cas,
+                                   std::string_view path);
+
+    /**
+     * Record the location of a path in a document
+     *
+     * @param vbid the vBucket of the document
+     * @param key the key of the document
+     * @param cas the CAS of the document
+     * @param path the path looked up
+     * @param location where the value of the path is
+     * @param capacity the maximum number of entries of the whole cache
+     */
+    void insert(Vbid vbid,
+                std::string_view key,
+                uint64_t cas,
+                std::string_view path,
+                Location location,
+                size_t capacity);
+
+    /// Remove all of the entries
+    void clear();
+
+    /// @returns the number of entries in the cache
+    size_t size() const {
+        return entries.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t NumPartitions = 32;
+
+private:
+    struct Entry {
+        std::string id;
+        uint64_t cas;
+        Location location;
+    };
+
+    struct Partition {
+        std::mutex mutex;
+        /// The entries, most recently used first
+        std::list<Entry> lru;
+        /// The entries by their id (the views refer to Entry::id)
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    };
+
+    static std::string makeId(Vbid vbid,
+                              std::string_view key,
+                              std::string_view path);
+
+    Partition& getPartition(Vbid vbid) {
+        return partitions[vbid.get() % NumPartitions];
+    }
+
+    std::array<Partition, NumPartitions> partitions;
+    std::atomic<size_t> entries{0};
+};
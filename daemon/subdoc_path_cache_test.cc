@@ -0,0 +1,75 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "subdoc_path_cache.h"
+#include <folly/portability/GTest.h>
+
+TEST(SubdocPathCacheTest, LookupMatchesCas) {
+    SubdocPathCache cache;
+    EXPECT_FALSE(cache.lookup(Vbid(0), "key", 1, "a.b"));
+
+    cache.insert(Vbid(0), "key", 1, "a.b", {10, 4}, 100);
+    EXPECT_EQ(1, cache.size());
+    auto location = cache.lookup(Vbid(0), "key", 1, "a.b");
+    ASSERT_TRUE(location);
+    EXPECT_EQ(10, location->offset);
+    EXPECT_EQ(4, location->length);
+
+    // Another version of the document, path, key or vBucket misses
+    EXPECT_FALSE(cache.lookup(Vbid(0), "key", 2, "a.b"));
+    EXPECT_FALSE(cache.lookup(Vbid(0), "key", 1, "a.c"));
+    EXPECT_FALSE(cache.lookup(Vbid(0), "key2", 1, "a.b"));
+    EXPECT_FALSE(cache.lookup(Vbid(1), "key", 1, "a.b"));
+
+    // The key and path can't run into each other
+    EXPECT_FALSE(cache.lookup(Vbid(0), "keya", 1, ".b"));
+}
+
+TEST(SubdocPathCacheTest, InsertReplacesStaleEntry) {
+    SubdocPathCache cache;
+    cache.insert(Vbid(0), "key", 1, "a", {10, 4}, 100);
+    cache.insert(Vbid(0), "key", 2, "a", {20, 5}, 100);
+    EXPECT_EQ(1, cache.size());
+    EXPECT_FALSE(cache.lookup(Vbid(0), "key", 1, "a"));
+    auto location = cache.lookup(Vbid(0), "key", 2, "a");
+    ASSERT_TRUE(location);
+    EXPECT_EQ(20, location->offset);
+}
+
+TEST(SubdocPathCacheTest, EvictsLeastRecentlyUsed) {
+    SubdocPathCache cache;
+    // Two entries per partition
+    const size_t capacity = 2 * SubdocPathCache::NumPartitions;
+    cache.insert(Vbid(0), "key", 1, "a", {0, 1}, capacity);
+    cache.insert(Vbid(0), "key", 1, "b", {1, 1}, capacity);
+    // Use "a" so that "b" is evicted
+    EXPECT_TRUE(cache.lookup(Vbid(0), "key", 1, "a"));
+    cache.insert(Vbid(0), "key", 1, "c", {2, 1}, capacity);
+
+    EXPECT_EQ(2, cache.size());
+    EXPECT_TRUE(cache.lookup(Vbid(0), "key", 1, "a"));
+    EXPECT_FALSE(cache.lookup(Vbid(0), "key", 1, "b"));
+    EXPECT_TRUE(cache.lookup(Vbid(0), "key", 1, "c"));
+
+    // Other vBuckets have their own partitions
+    cache.insert(Vbid(1), "key", 1, "a", {0, 1}, capacity);
+    EXPECT_EQ(3, cache.size());
+
+    cache.clear();
+    EXPECT_EQ(0, cache.size());
+    EXPECT_FALSE(cache.lookup(Vbid(0), "key", 1, "a"));
+}
@@ -43,6 +43,9 @@
 #include <xattr/blob.h>
 #include <gsl/gsl>
 
+#include <cstring>
+#include <iterator>
+
 static const std::array<SubdocCmdContext::Phase, 2> phases{{SubdocCmdContext::Phase::XATTR,
                                                             SubdocCmdContext::Phase::Body}};
 
@@ -589,6 +592,34 @@ static bool subdoc_fetch(Cookie& cookie,
     return true;
 }
 
+/**
+ * Get the cache of the locations of lookup paths to use for an operation.
+ * Only the values found by SUBDOC_GET in the body of the document are
+ * cached, and only while the document isn't locked (when the CAS of the
+ * document isn't known).
+ *
+ * @return the cache, or nullptr if the result of the operation isn't cached
+ */
+static SubdocPathCache* get_subdoc_path_cache(
+        SubdocCmdContext& context,
+        const SubdocCmdContext::OperationSpec& spec) {
+    auto& cache = context.connection.getBucket().subdocPathCache;
+    if (Settings::instance().getSubdocPathCacheSize() == 0) {
+        if (cache.size() != 0) {
+            // The cache was disabled, release its memory
+            cache.clear();
+        }
+        return nullptr;
+    }
+
+    if (spec.traits.mcbpCommand != cb::mcbp::ClientOpcode::SubdocGet ||
+        context.getCurrentPhase() != SubdocCmdContext::Phase::Body ||
+        context.getInputItemInfo().cas == LOCKED_CAS) {
+        return nullptr;
+    }
+    return &cache;
+}
+
 /**
  * Perform the subjson operation specified by {spec} to one path in the
  * document.
@@ -597,6 +628,28 @@ static cb::mcbp::Status subdoc_operate_one_path(
         SubdocCmdContext& context,
         SubdocCmdContext::OperationSpec& spec,
         std::string_view in_doc) {
+    // A lookup of a path in the same version of the document as a previous
+    // lookup doesn't need to parse the document again.
+    auto* const cache = get_subdoc_path_cache(context, spec);
+    std::string_view key;
+    if (cache) {
+        const auto keybuf = context.cookie.getRequest().getKey();
+        key = {reinterpret_cast<const char*>(keybuf.data()), keybuf.size()};
+        const auto location = cache->lookup(context.vbucket,
+                                            key,
+                                            context.getInputItemInfo().cas,
+                                            spec.path);
+        auto* thread_stats = get_thread_stats(&context.connection);
+        if (location &&
+            location->offset + location->length <= in_doc.size()) {
+            thread_stats->subdoc_path_cache_hits++;
+            spec.result.set_matchloc(
+                    {in_doc.data() + location->offset, location->length});
+            return cb::mcbp::Status::Success;
+        }
+        thread_stats->subdoc_path_cache_misses++;
+    }
+
     // Prepare the specified sub-document command.
     auto& op = context.connection.getThread().subdoc_op;
     op.clear();
@@ -647,6 +700,19 @@ static cb::mcbp::Status subdoc_operate_one_path(
     // ... and execute it.
     const auto subdoc_res = op.op_exec(spec.path.data(), spec.path.size());
 
+    if (cache && subdoc_res == Subdoc::Error::SUCCESS) {
+        const auto& match = spec.result.matchloc();
+        if (match.at >= in_doc.data() &&
+            match.at + match.length <= in_doc.data() + in_doc.size()) {
+            cache->insert(context.vbucket,
+                          key,
+                          context.getInputItemInfo().cas,
+                          spec.path,
+                          {size_t(match.at - in_doc.data()), match.length},
+                          Settings::instance().getSubdocPathCacheSize());
+        }
+    }
+
     switch (subdoc_res) {
     case Subdoc::Error::SUCCESS:
         return cb::mcbp::Status::Success;
@@ -726,6 +792,91 @@ static cb::mcbp::Status subdoc_operate_wholedoc(
     }
 }
 
+/**
+ * Make the (contiguous) input document for the next operation from the
+ * result of a mutation.
+ *
+ * Most mutations produce a splice of their input: the head of the document,
+ * new content and the tail of the document. When the input is already held
+ * in temp_buffer and the spliced document fits in it, the splice is made in
+ * place by moving just the tail. Otherwise the result is copied into a new
+ * temp_buffer, allocated with headroom so that the following operations of
+ * a multi-path mutation can be spliced in place rather than each copying
+ * the whole document.
+ *
+ * @param newdoc the segments of the mutated document
+ * @param doc the input of the mutation, updated to the mutated document
+ * @param temp_buffer the buffer to hold the mutated document
+ * @param capacity the size of temp_buffer
+ */
+template <typename Segments>
+static void materialise_newdoc(const Segments& newdoc,
+                               std::string_view& doc,
+                               std::unique_ptr<char[]>& temp_buffer,
+                               size_t& capacity) {
+    size_t new_doc_len = 0;
+    for (auto& loc : newdoc) {
+        new_doc_len += loc.length;
+    }
+
+    char* const buf = temp_buffer.get();
+    const auto owned = [buf, &doc](const char* at, size_t length) {
+        return at >= buf && at + length <= buf + doc.size();
+    };
+    const auto outside = [buf, capacity](const char* at, size_t length) {
+        return length == 0 || at + length <= buf || at >= buf + capacity;
+    };
+
+    bool splice = buf && doc.data() == buf && new_doc_len <= capacity &&
+                  newdoc.size() >= 2;
+    if (splice) {
+        const auto& head = newdoc.front();
+        const auto& tail = newdoc.back();
+        splice = head.at == buf && owned(head.at, head.length) &&
+                 owned(tail.at, tail.length) &&
+                 tail.at + tail.length == buf + doc.size() &&
+                 tail.at >= head.at + head.length;
+        for (auto it = std::next(newdoc.begin());
+             splice && it != std::prev(newdoc.end());
+             ++it) {
+            splice = outside(it->at, it->length);
+        }
+    }
+
+    if (splice) {
+        const auto& head = newdoc.front();
+        const auto& tail = newdoc.back();
+        const size_t tail_offset = new_doc_len - tail.length;
+        std::memmove(buf + tail_offset, tail.at, tail.length);
+        size_t offset = head.length;
+        for (auto it = std::next(newdoc.begin()); it != std::prev(newdoc.end());
+             ++it) {
+            std::copy(it->at, it->at + it->length, buf + offset);
+            offset += it->length;
+        }
+        doc = {buf, new_doc_len};
+        return;
+    }
+
+    // We can't simply write into the dynamic_buffer, as that may be the
+    // underlying storage for iovecs from the result, so make a contiguous
+    // region in a new temporary char[], and point doc at that.
+    const size_t new_capacity = new_doc_len + new_doc_len / 4;
+    std::unique_ptr<char[]> temp(new char[new_capacity]);
+
+    size_t offset = 0;
+    for (auto& loc : newdoc) {
+        std::copy(loc.at, loc.at + loc.length, temp.get() + offset);
+        offset += loc.length;
+    }
+
+    // Copying complete - safe to delete the old temp_doc (even if it was the
+    // source of some of the newdoc iovecs).
+    temp_buffer.swap(temp);
+    capacity = new_capacity;
+    doc = {temp_buffer.get(), new_doc_len};
+}
+
 /**
  * Run through all of the subdoc operations for the current phase on
  * a single 'document' (either the user document, or a XATTR).
@@ -735,7 +886,8 @@ static cb::mcbp::Status subdoc_operate_wholedoc(
  * @param doc_datatype The datatype of the document. Updated if a
  *                     wholedoc op changes the datatype.
  * @param temp_buffer where to store the data for our temporary buffer
- *                    allocations if we need to change the doc.
+ *                    allocations if we need to change the doc. Must be
+ *                    empty on entry.
  * @param modified set to true upon return if any modifications happened
  *                 to the input document.
  * @return true if we should continue processing this request,
@@ -751,6 +903,7 @@ static bool operate_single_doc(SubdocCmdContext& context,
                                bool& modified) {
     modified = false;
     auto& operations = context.getOperations();
+    size_t temp_capacity = 0;
 
     // 2. Perform each of the operations on document.
     for (auto& op : operations) {
@@ -773,40 +926,21 @@ static bool operate_single_doc(SubdocCmdContext& context,
             if (context.traits.is_mutator) {
                 modified = true;
 
-                // Determine how much space we now need.
-                size_t new_doc_len = 0;
-                for (auto& loc : op.result.newdoc()) {
-                    new_doc_len += loc.length;
-                }
-
-                // TODO-PERF: We need to create a contiguous input
-                // region for the next subjson call, from the set of
-                // iovecs in the result. We can't simply write into
-                // the dynamic_buffer, as that may be the underlying
-                // storage for iovecs from the result. Ideally we'd
-                // either permit subjson to take an iovec as input, or
-                // permit subjson to take all the multipaths at once.
-                // For now we make a contiguous region in a temporary
-                // char[], and point in_doc at that.
-                std::unique_ptr<char[]> temp(new char[new_doc_len]);
-
-                size_t offset = 0;
-                for (auto& loc : op.result.newdoc()) {
-                    std::copy(loc.at, loc.at + loc.length, temp.get() + offset);
-                    offset += loc.length;
-                }
-
-                // Copying complete - safe to delete the old temp_doc
-                // (even if it was the source of some of the newdoc
-                // iovecs).
-                temp_buffer.swap(temp);
-                doc = {temp_buffer.get(), new_doc_len};
+                // We need to create a contiguous input region for the
+                // next subjson call from the set of iovecs in the result.
+                // Ideally we'd either permit subjson to take an iovec as
+                // input, or permit subjson to take all the multipaths at
+                // once; instead the result is spliced into temp_buffer
+                // in place where possible.
+                materialise_newdoc(
+                        op.result.newdoc(), doc, temp_buffer, temp_capacity);
 
                 if (op.traits.scope == CommandScope::WholeDoc) {
                     // the entire document has been replaced as part of a
                     // wholedoc op update the datatype to match
-                    JSON_checker::Validator validator;
-                    bool isValidJson = validator.validate(doc);
+                    bool isValidJson =
+                            context.connection.getThread().validator.validate(
+                                    doc);
 
                     // don't alter context.in_datatype directly here in case we
                     // are in xattrs phase
@@ -916,7 +1050,8 @@ static ENGINE_ERROR_CODE validate_xattr_privilege(SubdocCmdContext& context) {
 }
 
 /**
- * Replaces the xattrs on the document with the new ones provided
+ * Replaces the xattrs on the document with the new ones provided. The body
+ * isn't copied (see SubdocCmdContext::set_xattrs()).
  * @param new_xattr The new xattrs to use
  * @param context The command context for this operation
  * @param bodyoffset The offset in to the body of the xattr section
@@ -926,16 +1061,7 @@ static inline void replace_xattrs(std::string_view new_xattr,
                                   SubdocCmdContext& context,
                                   const size_t bodyoffset,
                                   const size_t bodysize) {
-    auto total = new_xattr.size() + bodysize;
-
-    std::unique_ptr<char[]> full_document(new char[total]);
-    std::copy(new_xattr.begin(), new_xattr.end(), full_document.get());
-    std::copy(context.in_doc.data() + bodyoffset,
-              context.in_doc.data() + bodyoffset + bodysize,
-              full_document.get() + new_xattr.size());
-
-    context.temp_doc.swap(full_document);
-    context.in_doc = {context.temp_doc.get(), total};
+    context.set_xattrs(new_xattr, context.in_doc.substr(bodyoffset, bodysize));
 
     if (new_xattr.empty()) {
         context.in_datatype &= ~PROTOCOL_BINARY_DATATYPE_XATTR;
@@ -959,6 +1085,7 @@ static bool do_xattr_delete_phase(SubdocCmdContext& context) {
     }
 
     // We need to remove the user keys from the Xattrs and rebuild the document
+    context.materialise_document();
 
     const auto bodyoffset = cb::xattr::get_body_offset(context.in_doc);
     const auto bodysize = context.in_doc.size() - bodyoffset;
@@ -1128,6 +1255,8 @@ static bool do_body_phase(SubdocCmdContext& context) {
         return true;
     }
 
+    context.materialise_document();
+
     size_t xattrsize = 0;
     std::string_view document{context.in_doc};
 
@@ -1238,11 +1367,10 @@ static ENGINE_ERROR_CODE subdoc_update(SubdocCmdContext& context,
         !(context.no_sys_xattrs && context.do_delete_doc)) {
 
         if (ret == ENGINE_SUCCESS) {
-            context.out_doc_len = context.in_doc.size();
+            context.out_doc_len = context.get_document_size();
             auto allocate_key = cookie.getConnection().makeDocKey(key);
-            const size_t priv_bytes =
-                cb::xattr::get_system_xattr_size(context.in_datatype,
-                                                 context.in_doc);
+            const size_t priv_bytes = cb::xattr::get_system_xattr_size(
+                    context.in_datatype, context.get_document_xattrs());
 
             // Calculate the updated document length - use the last operation result.
             try {
@@ -1297,9 +1425,10 @@ static ENGINE_ERROR_CODE subdoc_update(SubdocCmdContext& context,
             return ENGINE_FAILED;
         }
 
-        // Copy the new document into the item.
-        char* write_ptr = static_cast<char*>(new_doc_info.value[0].iov_base);
-        std::memcpy(write_ptr, context.in_doc.data(), context.in_doc.size());
+        // Copy the new document into the item (for an xattr only update
+        // this is the only copy of the body)
+        context.copy_document(
+                static_cast<char*>(new_doc_info.value[0].iov_base));
     }
 
     // And finally, store the new document.
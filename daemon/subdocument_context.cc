@@ -17,6 +17,7 @@
 #include "subdocument_context.h"
 
 #include "debug_helpers.h"
+#include "front_end_thread.h"
 #include "mc_time.h"
 #include "protocol/mcbp/engine_wrapper.h"
 
@@ -476,10 +477,7 @@ cb::mcbp::Status SubdocCmdContext::get_document_for_searching(
     if (mcbp::datatype::is_snappy(info.datatype)) {
         // Need to expand before attempting to extract from it.
         try {
-            using namespace cb::compression;
-            if (!inflate(Algorithm::Snappy,
-                         in_doc,
-                         inflated_doc_buffer)) {
+            if (!inflate_document()) {
                 char clean_key[KEY_MAX_LENGTH + 32];
                 if (buf_to_printable_buffer(
                             clean_key,
@@ -500,17 +498,258 @@ cb::mcbp::Status SubdocCmdContext::get_document_for_searching(
             return cb::mcbp::Status::Enomem;
         }
 
-        // Update document to point to the uncompressed version in the buffer.
-        in_doc = inflated_doc_buffer;
         in_datatype &= ~PROTOCOL_BINARY_DATATYPE_SNAPPY;
     }
 
     return cb::mcbp::Status::Success;
 }
 
+/**
+ * Decoder of a prefix of a Snappy compressed value.
+ *
+ * The raw Snappy format is the varint encoded length of the inflated value
+ * followed by literals and copies of earlier output, so a prefix of the
+ * inflated value only depends on a prefix of the compressed value.
+ */
+class SnappyPrefixDecoder {
+public:
+    explicit SnappyPrefixDecoder(std::string_view input) : input(input) {
+    }
+
+    /**
+     * Decode (at least) the first length bytes of the value
+     *
+     * @return false if the input is invalid or doesn't inflate to that many
+     *         bytes
+     */
+    bool decodeTo(size_t length, std::string& output) {
+        if (pos == 0 && !decodeLength()) {
+            return false;
+        }
+        if (length > inflatedLength) {
+            return false;
+        }
+        while (output.size() < length) {
+            if (!decodeElement(output)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    bool decodeLength() {
+        uint64_t length = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (pos == input.size()) {
+                return false;
+            }
+            const auto c = uint8_t(input[pos++]);
+            length |= uint64_t(c & 0x7f) << shift;
+            if ((c & 0x80) == 0) {
+                inflatedLength = length;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Read a little-endian integer of the given number of bytes
+    bool readLE(size_t bytes, size_t& value) {
+        if (input.size() - pos < bytes) {
+            return false;
+        }
+        value = 0;
+        for (size_t ii = 0; ii < bytes; ++ii) {
+            value |= size_t(uint8_t(input[pos++])) << (8 * ii);
+        }
+        return true;
+    }
+
+    bool decodeElement(std::string& output) {
+        if (pos == input.size()) {
+            return false;
+        }
+        const auto tag = uint8_t(input[pos++]);
+        size_t length;
+        size_t offset;
+        switch (tag & 3) {
+        case 0: // literal
+            length = tag >> 2;
+            if (length >= 60 && !readLE(length - 59, length)) {
+                return false;
+            }
+            ++length;
+            if (input.size() - pos < length ||
+                output.size() + length > inflatedLength) {
+                return false;
+            }
+            output.append(input.data() + pos, length);
+            pos += length;
+            return true;
+        case 1: // copy with a 1 byte offset
+            if (pos == input.size()) {
+                return false;
+            }
+            length = ((tag >> 2) & 7) + 4;
+            offset = (size_t(tag >> 5) << 8) | uint8_t(input[pos++]);
+            break;
+        case 2: // copy with a 2 byte offset
+            length = (tag >> 2) + 1;
+            if (!readLE(2, offset)) {
+                return false;
+            }
+            break;
+        default: // copy with a 4 byte offset
+            length = (tag >> 2) + 1;
+            if (!readLE(4, offset)) {
+                return false;
+            }
+        }
+
+        if (offset == 0 || offset > output.size() ||
+            output.size() + length > inflatedLength) {
+            return false;
+        }
+        // The copy may overlap the bytes it appends
+        for (size_t ii = 0; ii < length; ++ii) {
+            output.push_back(output[output.size() - offset]);
+        }
+        return true;
+    }
+
+    const std::string_view input;
+    size_t pos = 0;
+    uint64_t inflatedLength = 0;
+};
+
+bool SubdocCmdContext::is_xattr_only_lookup() {
+    if (traits.is_mutator || !getOperations(Phase::Body).empty()) {
+        return false;
+    }
+    for (const auto& op : getOperations(Phase::XATTR)) {
+        // $document reports the size and CRC of the body
+        if (std::string_view(op.path).substr(
+                    0, cb::xattr::vattrs::DOCUMENT.size()) ==
+            cb::xattr::vattrs::DOCUMENT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SubdocCmdContext::inflate_document() {
+    const auto& info = getInputItemInfo();
+    if (is_xattr_only_lookup()) {
+        if (!mcbp::datatype::is_xattr(info.datatype)) {
+            // No xattrs; the body is never looked at
+            in_doc = in_doc.substr(0, 0);
+            return true;
+        }
+
+        // Inflate the xattr blob (its length followed by the pairs)
+        SnappyPrefixDecoder decoder(in_doc);
+        inflated_xattrs.clear();
+        if (!decoder.decodeTo(sizeof(uint32_t), inflated_xattrs)) {
+            return false;
+        }
+        const auto xattrsize = cb::xattr::get_body_offset(inflated_xattrs);
+        if (!decoder.decodeTo(xattrsize, inflated_xattrs)) {
+            return false;
+        }
+        inflated_xattrs.resize(xattrsize);
+        in_doc = inflated_xattrs;
+        return true;
+    }
+
+    auto& cached = connection.getThread().inflatedDocument;
+    const std::string_view key{reinterpret_cast<const char*>(info.key.data()),
+                               info.key.size()};
+    const bool cacheable = !traits.is_mutator && info.cas != LOCKED_CAS;
+    if (cacheable && cached.value && cached.cas == info.cas &&
+        cached.vbid == vbucket && cached.key == key &&
+        cached.bucket == connection.getBucketIndex()) {
+        inflated_doc_buffer = cached.value;
+        in_doc = {inflated_doc_buffer->data(), inflated_doc_buffer->size()};
+        return true;
+    }
+
+    auto buffer = std::make_shared<cb::compression::Buffer>();
+    if (!cb::compression::inflate(
+                cb::compression::Algorithm::Snappy, in_doc, *buffer)) {
+        return false;
+    }
+    inflated_doc_buffer = buffer;
+    // Update document to point to the uncompressed version in the buffer.
+    in_doc = {inflated_doc_buffer->data(), inflated_doc_buffer->size()};
+
+    if (cacheable &&
+        inflated_doc_buffer->size() <= FrontEndThread::MaxInflatedDocumentSize) {
+        cached.bucket = connection.getBucketIndex();
+        cached.vbid = vbucket;
+        cached.key.assign(key);
+        cached.cas = info.cas;
+        cached.value = inflated_doc_buffer;
+    }
+    return true;
+}
+
+void SubdocCmdContext::set_xattrs(std::string_view xattrs,
+                                  std::string_view body_) {
+    new_xattrs.assign(xattrs.data(), xattrs.size());
+    body = body_;
+    split_document = true;
+}
+
+void SubdocCmdContext::materialise_document() {
+    if (!split_document) {
+        return;
+    }
+
+    // The body may live in the current temp_doc, so don't release it
+    // before the copy is complete
+    const auto total = get_document_size();
+    std::unique_ptr<char[]> full_document(new char[total]);
+    copy_document(full_document.get());
+    temp_doc.swap(full_document);
+    in_doc = {temp_doc.get(), total};
+
+    split_document = false;
+    new_xattrs.clear();
+    body = {};
+}
+
+size_t SubdocCmdContext::get_document_size() const {
+    if (split_document) {
+        return new_xattrs.size() + body.size();
+    }
+    return in_doc.size();
+}
+
+std::string_view SubdocCmdContext::get_document_xattrs() const {
+    if (split_document) {
+        return new_xattrs;
+    }
+    if (mcbp::datatype::is_xattr(in_datatype)) {
+        return in_doc.substr(0, cb::xattr::get_body_offset(in_doc));
+    }
+    return {};
+}
+
+void SubdocCmdContext::copy_document(char* dest) const {
+    if (split_document) {
+        std::copy(new_xattrs.begin(), new_xattrs.end(), dest);
+        std::copy(body.begin(), body.end(), dest + new_xattrs.size());
+    } else {
+        std::copy(in_doc.begin(), in_doc.end(), dest);
+    }
+}
+
 uint32_t SubdocCmdContext::computeValueCRC32C() {
     std::string_view value;
-    if (mcbp::datatype::is_xattr(in_datatype)) {
+    if (split_document) {
+        value = body;
+    } else if (mcbp::datatype::is_xattr(in_datatype)) {
         // Note: in the XAttr naming, body/value excludes XAttrs
         value = cb::xattr::get_body(in_doc);
     } else {
@@ -164,9 +164,14 @@ public:
     // TODO: Remove (b), and just use intermediate result.
     std::string_view in_doc{};
 
-    // Temporary buffer to hold the inflated content in case of the
-    // document in the engine being compressed
-    cb::compression::Buffer inflated_doc_buffer;
+    // Buffer holding the inflated content in case of the document in the
+    // engine being compressed. A lookup may share it with the front-end
+    // thread's cache of the most recently inflated document.
+    std::shared_ptr<const cb::compression::Buffer> inflated_doc_buffer;
+
+    // The inflated xattrs of a compressed document, when a lookup only
+    // accesses its xattrs (see inflate_document())
+    std::string inflated_xattrs;
 
     // Temporary buffer used to hold the intermediate result document for
     // multi-path mutations. {in_doc} is then updated to point to this to use
@@ -177,6 +182,13 @@ public:
     // may hold pointers into the repacked xattr buckets
     std::unique_ptr<char[]> xattr_buffer;
 
+    // [Mutations only] Set when the xattrs of the document were replaced
+    // by set_xattrs() (and it wasn't materialised since): the document is
+    // then {new_xattrs} followed by {body} rather than {in_doc}.
+    bool split_document = false;
+    std::string new_xattrs;
+    std::string_view body;
+
     // CAS value of the input document. Required to ensure we only store a
     // new document which was derived from the same original input document.
     uint64_t in_cas = 0;
@@ -275,6 +287,34 @@ public:
         Subdoc::Result result;
     };
 
+    /**
+     * Replace the xattrs of the document without copying its body (which
+     * may be big, and is copied into the new item anyway). Until
+     * materialise_document() is called the document is held in
+     * {new_xattrs} and {body} instead of {in_doc}.
+     *
+     * @param xattrs The new (encoded) xattrs of the document
+     * @param body_ The body of the document; it must stay valid until the
+     *             document is stored
+     */
+    void set_xattrs(std::string_view xattrs, std::string_view body_);
+
+    /**
+     * Assemble the document replaced by set_xattrs() into {temp_doc} and
+     * point {in_doc} to it (for the phases which need the document as a
+     * single buffer).
+     */
+    void materialise_document();
+
+    /// @returns the size of the document (as it is to be stored)
+    size_t get_document_size() const;
+
+    /// @returns the xattrs section of the document (as it is to be stored)
+    std::string_view get_document_xattrs() const;
+
+    /// Copy the document (as it is to be stored) into the given buffer
+    void copy_document(char* dest) const;
+
     /**
      * Get the xattr key being accessed in this context. Only one
      * xattr key is allowed in each multi op
@@ -391,6 +431,21 @@ private:
      */
     uint32_t computeValueCRC32C();
 
+    /**
+     * Inflate the Snappy compressed in_doc, and update in_doc to the
+     * inflated document. A lookup which only accesses the xattrs of the
+     * document only inflates the xattrs, and other lookups reuse the
+     * document the front-end thread inflated last if it is the same
+     * version of the document.
+     *
+     * @return false if the document can't be inflated
+     * @throws std::bad_alloc if allocation fails
+     */
+    bool inflate_document();
+
+    /// @returns true if the command only needs the xattrs of the document
+    bool is_xattr_only_lookup();
+
     std::string_view expand_virtual_document_macro(std::string_view macro);
 
     // The xattr key being accessed in this command
@@ -2,6 +2,7 @@
 /*
  * Thread management for memcached.
  */
+#include "buckets.h"
 #include "connection.h"
 #include "connections.h"
 #include "cookie.h"
@@ -14,12 +15,14 @@
 #include "tracing.h"
 #include <utilities/hdrhistogram.h>
 
+#include <folly/Synchronized.h>
 #include <nlohmann/json.hpp>
 #include <openssl/conf.h>
 #include <phosphor/phosphor.h>
 #include <platform/socket.h>
 #include <platform/strerror.h>
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <cstdlib>
@@ -29,6 +32,11 @@
 #endif
 #include <mutex>
 #include <queue>
+#include <unordered_map>
+
+#if HAVE_LIBNUMA
+#include <numa.h>
+#endif
 
 /* An item in the connection queue. */
 FrontEndThread::ConnectionQueue::~ConnectionQueue() {
@@ -49,6 +57,18 @@ void FrontEndThread::ConnectionQueue::swap(
     connections.swap(other);
 }
 
+void FrontEndThread::MigrationQueue::push(
+        Connection* c, const std::function<void()>& detach) {
+    std::lock_guard<std::mutex> guard(mutex);
+    connections.push_back(c);
+    detach();
+}
+
+void FrontEndThread::MigrationQueue::swap(std::vector<Connection*>& other) {
+    std::lock_guard<std::mutex> guard(mutex);
+    connections.swap(other);
+}
+
 void FrontEndThread::NotificationList::push(Connection* c) {
     std::lock_guard<std::mutex> lock(mutex);
     auto iter = std::find(connections.begin(), connections.end(), c);
@@ -75,6 +95,39 @@ void FrontEndThread::NotificationList::swap(std::vector<Connection*>& other) {
     connections.swap(other);
 }
 
+FrontEndThread::BufferPool::~BufferPool() {
+    stats.pooled_buffers -= buffers.size();
+}
+
+std::vector<char> FrontEndThread::BufferPool::borrow() {
+    std::vector<char> ret;
+    if (buffers.empty()) {
+        ret.reserve(BufferSize);
+    } else {
+        ret.swap(buffers.back());
+        buffers.pop_back();
+        --stats.pooled_buffers;
+    }
+    ++stats.borrowed_buffers;
+    return ret;
+}
+
+void FrontEndThread::BufferPool::release(std::vector<char>& buffer) {
+    if (buffer.capacity() == 0) {
+        return;
+    }
+    --stats.borrowed_buffers;
+    if (buffers.size() < MaxPooledBuffers &&
+        buffer.capacity() == BufferSize) {
+        buffer.clear();
+        buffers.emplace_back();
+        buffers.back().swap(buffer);
+        ++stats.pooled_buffers;
+    } else {
+        std::vector<char>().swap(buffer);
+    }
+}
+
 /*
  * Each libevent instance has a wakeup pipe, which other threads
  * can use to signal that they've put a new connection on its queue.
@@ -175,6 +228,23 @@ static void setup_thread(FrontEndThread& me) {
 static void worker_libevent(void *arg) {
     auto& me = *reinterpret_cast<FrontEndThread*>(arg);
 
+#if HAVE_LIBNUMA
+    if (me.numa_node != -1) {
+        // Run only on the CPUs of our node, and allocate from it (overriding
+        // the process-wide interleave policy) so the connection state and
+        // buffers this thread touches stay node-local.
+        if (numa_run_on_node(me.numa_node) == 0) {
+            numa_set_localalloc();
+        } else {
+            LOG_WARNING("Failed to pin worker thread {} to NUMA node {}: {}",
+                        me.index,
+                        me.numa_node,
+                        cb_strerror());
+            me.numa_node = -1;
+        }
+    }
+#endif
+
     // Any per-thread setup can happen here; thread_init() will block until
     // all threads have finished initializing.
     {
@@ -212,6 +282,21 @@ void drain_notification_channel(evutil_socket_t fd) {
     }
 }
 
+/*
+ * Attach the connections other threads moved to this thread
+ */
+static void attach_migrated_connections(FrontEndThread& me) {
+    std::vector<Connection*> migrated;
+    me.migrations.swap(migrated);
+
+    for (auto* c : migrated) {
+        if (!c->attachToThread()) {
+            disassociate_bucket(*c);
+            conn_destroy(c);
+        }
+    }
+}
+
 static void dispatch_new_connections(FrontEndThread& me) {
     std::vector<std::pair<SOCKET, SharedListeningPort>> connections;
     me.new_conn_queue.swap(connections);
@@ -249,6 +334,7 @@ static void thread_libevent_process(evutil_socket_t fd, short, void* arg) {
     }
 
     dispatch_new_connections(me);
+    attach_migrated_connections(me);
 
     FrontEndThread::PendingIoMap pending;
     {
@@ -328,17 +414,209 @@ void notify_io_complete(gsl::not_null<const void*> void_cookie,
     }
 }
 
+void notify_io_complete_batch(
+        gsl::span<const std::pair<const void*, ENGINE_ERROR_CODE>>
+                notifications) {
+    // Group the cookies by the thread serving them so that we only need to
+    // lock each thread's pending IO list, and wake the thread, once.
+    // There's only a handful of front-end threads so a linear search is fine.
+    std::vector<std::pair<FrontEndThread*,
+                          std::vector<std::pair<Cookie*, ENGINE_ERROR_CODE>>>>
+            perThread;
+    for (const auto& [void_cookie, status] : notifications) {
+        auto* cookie =
+                const_cast<Cookie*>(reinterpret_cast<const Cookie*>(void_cookie));
+        auto* thr = &cookie->getConnection().getThread();
+        auto iter = std::find_if(
+                perThread.begin(), perThread.end(), [thr](const auto& entry) {
+                    return entry.first == thr;
+                });
+        if (iter == perThread.end()) {
+            perThread.push_back({thr, {}});
+            iter = perThread.end() - 1;
+        }
+        iter->second.emplace_back(cookie, status);
+    }
+
+    for (auto& [thr, cookies] : perThread) {
+        int notify = 0;
+        {
+            std::lock_guard<std::mutex> lock(thr->pending_io.mutex);
+            for (const auto& [cookie, status] : cookies) {
+                notify |= add_conn_to_pending_io_list_UNLOCKED(
+                        *thr, &cookie->getConnection(), cookie, status);
+            }
+        }
+        if (notify) {
+            notify_thread(*thr);
+        }
+    }
+}
+
 /* Which thread we assigned a connection to most recently. */
 static size_t last_thread = 0;
 
+/*
+ * The front-end threads pinned to each NUMA node, and which of them we
+ * assigned a connection to most recently. Empty unless NUMA placement is
+ * enabled.
+ */
+static std::vector<std::vector<size_t>> numa_node_threads;
+static std::vector<size_t> numa_node_last_thread;
+
+/*
+ * The front-end threads reserved for buckets (computed from the
+ * "bucket_thread_reservations" setting whenever it changes)
+ */
+struct ThreadReservations {
+    /// The threads reserved for each bucket
+    std::unordered_map<std::string, std::vector<size_t>> buckets;
+    /// The threads serving the connections to all of the other buckets
+    std::vector<size_t> shared;
+    /// Is the thread (by index) reserved for a bucket?
+    std::vector<bool> reserved;
+};
+static folly::Synchronized<ThreadReservations> thread_reservations;
+static std::atomic_bool have_thread_reservations{false};
+
+/* Which of the candidate threads we moved or assigned a connection to most
+ * recently (shared by all of the candidate sets; it only spreads the
+ * connections) */
+static std::atomic<size_t> last_reserved_thread{0};
+
+static void update_thread_reservations() {
+    const auto nthr = threads.size();
+    ThreadReservations next;
+    next.reserved.resize(nthr);
+
+    // Reserve the threads from the last one downwards, always leaving (at
+    // least) the first thread to serve the other buckets
+    size_t available = nthr - 1;
+    for (const auto& [name, count] :
+         Settings::instance().getBucketThreadReservations()) {
+        if (count > available) {
+            LOG_WARNING(
+                    "Can only reserve {} of the {} front-end threads "
+                    "requested for bucket [{}]",
+                    available,
+                    count,
+                    name);
+        }
+        auto& entry = next.buckets[name];
+        for (size_t ii = 0; ii < count && available > 0; ++ii) {
+            const auto index = available--;
+            entry.push_back(index);
+            next.reserved[index] = true;
+        }
+        if (entry.empty()) {
+            next.buckets.erase(name);
+        } else {
+            LOG_INFO("Reserved front-end threads {} for bucket [{}]",
+                     nlohmann::json(entry).dump(),
+                     name);
+        }
+    }
+    for (size_t ii = 0; ii < nthr; ++ii) {
+        if (!next.reserved[ii]) {
+            next.shared.push_back(ii);
+        }
+    }
+
+    const bool reserved = !next.buckets.empty();
+    thread_reservations.withWLock(
+            [&next](auto& reservations) { reservations = std::move(next); });
+    have_thread_reservations = reserved;
+}
+
+/// Is the thread reserved for a bucket (so it won't accept new connections)?
+static bool is_reserved_thread(size_t index) {
+    if (!have_thread_reservations) {
+        return false;
+    }
+    return thread_reservations.withRLock([index](auto& reservations) {
+        return index < reservations.reserved.size() &&
+               reservations.reserved[index];
+    });
+}
+
+FrontEndThread* select_bucket_thread(const Connection& connection) {
+    if (!have_thread_reservations) {
+        return nullptr;
+    }
+    const std::string name = connection.getBucket().name;
+    const auto current = connection.getThread().index;
+    return thread_reservations.withRLock(
+            [&name, current](auto& reservations) -> FrontEndThread* {
+                auto iter = reservations.buckets.find(name);
+                const auto& candidates = iter == reservations.buckets.end()
+                                                 ? reservations.shared
+                                                 : iter->second;
+                if (candidates.empty() ||
+                    std::find(candidates.begin(), candidates.end(), current) !=
+                            candidates.end()) {
+                    return nullptr;
+                }
+                const auto next = last_reserved_thread++ % candidates.size();
+                return &threads[candidates[next]];
+            });
+}
+
+/*
+ * Select the thread to serve a new connection - if NUMA placement is enabled
+ * prefer a thread on the node whose CPU received the connection, otherwise
+ * (or if that isn't known) round-robin over all threads.
+ */
+static size_t select_any_thread(SOCKET sfd) {
+#if HAVE_LIBNUMA && defined(SO_INCOMING_CPU)
+    if (!numa_node_threads.empty()) {
+        int cpu = -1;
+        socklen_t len = sizeof(cpu);
+        if (cb::net::getsockopt(sfd,
+                                SOL_SOCKET,
+                                SO_INCOMING_CPU,
+                                reinterpret_cast<void*>(&cpu),
+                                &len) == 0 &&
+            cpu >= 0) {
+            const auto node = numa_node_of_cpu(cpu);
+            if (node >= 0 && size_t(node) < numa_node_threads.size() &&
+                !numa_node_threads[node].empty()) {
+                const auto& candidates = numa_node_threads[node];
+                auto& last = numa_node_last_thread[node];
+                last = (last + 1) % candidates.size();
+                return candidates[last];
+            }
+        }
+    }
+#endif
+    const auto nthr = Settings::instance().getNumWorkerThreads();
+    last_thread = (last_thread + 1) % nthr;
+    return last_thread;
+}
+
+/*
+ * Select the thread to serve a new connection, moving it to one of the
+ * shared threads if the thread selected is reserved for a bucket
+ */
+static size_t select_thread(SOCKET sfd) {
+    const auto index = select_any_thread(sfd);
+    if (!is_reserved_thread(index)) {
+        return index;
+    }
+    return thread_reservations.withRLock([index](auto& reservations) {
+        if (reservations.shared.empty()) {
+            return index;
+        }
+        return reservations.shared[last_reserved_thread++ %
+                                   reservations.shared.size()];
+    });
+}
+
 /*
  * Dispatches a new connection to another thread. This is only ever called
  * from the main thread, or because of an incoming connection.
  */
 void dispatch_conn_new(SOCKET sfd, SharedListeningPort& interface) {
-    size_t tid = (last_thread + 1) % Settings::instance().getNumWorkerThreads();
-    auto& thread = threads[tid];
-    last_thread = tid;
+    auto& thread = threads[select_thread(sfd)];
 
     try {
         thread.new_conn_queue.push(sfd, interface);
@@ -356,6 +634,29 @@ void dispatch_conn_new(SOCKET sfd, SharedListeningPort& interface) {
     notify_thread(thread);
 }
 
+void dispatch_conn_new_local(SOCKET sfd,
+                             SharedListeningPort& interface,
+                             FrontEndThread& thread) {
+    if (is_reserved_thread(thread.index)) {
+        // The thread only serves the connections to its bucket
+        dispatch_conn_new(sfd, interface);
+        return;
+    }
+    if (conn_new(sfd, *interface, thread.base, thread) == nullptr) {
+        if (interface->system) {
+            --stats.system_conns;
+        }
+        safe_close(sfd);
+    }
+}
+
+void iterate_all_front_end_threads(
+        std::function<void(FrontEndThread&)> callback) {
+    for (auto& thr : threads) {
+        callback(thr);
+    }
+}
+
 /******************************* GLOBAL STATS ******************************/
 
 void threadlocal_stats_reset(std::vector<thread_stats>& thread_stats) {
@@ -384,6 +685,36 @@ void worker_threads_init() {
         setup_thread(threads[ii]);
     }
 
+#if HAVE_LIBNUMA
+    if (Settings::instance().isNumaThreadPlacementEnabled()) {
+        const int nodes = numa_available() == 0 ? numa_max_node() + 1 : 0;
+        if (nodes > 1) {
+            // Spread the threads evenly over the nodes.
+            numa_node_threads.resize(nodes);
+            numa_node_last_thread.resize(nodes);
+            for (auto& thread : threads) {
+                thread.numa_node = int(thread.index % nodes);
+                numa_node_threads[thread.numa_node].push_back(thread.index);
+            }
+            LOG_INFO("NUMA: Placing {} front-end threads across {} nodes",
+                     nthr,
+                     nodes);
+        } else {
+            LOG_INFO(
+                    "NUMA: numa_thread_placement ignored - found {} NUMA "
+                    "node(s)",
+                    nodes);
+        }
+    }
+#endif
+
+    update_thread_reservations();
+    Settings::instance().addChangeListener(
+            "bucket_thread_reservations",
+            [](const std::string&, Settings&) {
+                update_thread_reservations();
+            });
+
     /* Create threads after we've done all the libevent setup. */
     for (auto& thread : threads) {
         const std::string name = "mc:worker_" + std::to_string(thread.index);
@@ -438,12 +769,15 @@ void notify_thread(FrontEndThread& thread) {
     }
 }
 
-int add_conn_to_pending_io_list(Connection* c,
-                                Cookie* cookie,
-                                ENGINE_ERROR_CODE status) {
-    auto& thread = c->getThread();
-
-    std::lock_guard<std::mutex> lock(thread.pending_io.mutex);
+/*
+ * Add the cookie to the pending IO list of the thread serving it. The caller
+ * must hold the thread's pending_io.mutex.
+ * Returns 1 if the cookie was added (and the thread should be notified).
+ */
+static int add_conn_to_pending_io_list_UNLOCKED(FrontEndThread& thread,
+                                                Connection* c,
+                                                Cookie* cookie,
+                                                ENGINE_ERROR_CODE status) {
     auto iter = thread.pending_io.map.find(c);
     if (iter == thread.pending_io.map.end()) {
         thread.pending_io.map.emplace(
@@ -463,3 +797,12 @@ int add_conn_to_pending_io_list(Connection* c,
     iter->second.emplace_back(cookie, status);
     return 1;
 }
+
+int add_conn_to_pending_io_list(Connection* c,
+                                Cookie* cookie,
+                                ENGINE_ERROR_CODE status) {
+    auto& thread = c->getThread();
+
+    std::lock_guard<std::mutex> lock(thread.pending_io.mutex);
+    return add_conn_to_pending_io_list_UNLOCKED(thread, c, cookie, status);
+}
@@ -16,25 +16,61 @@
  */
 #include "timings.h"
 
-Timings::Timings() {
+Timings::Timings()
+    : timings([this]() { return new ThreadTimings(*this); }) {
     reset();
 }
 
-Timings::~Timings() {
+Timings::~Timings() = default;
+
+Timings::ThreadTimings::~ThreadTimings() {
+    std::lock_guard<std::mutex> lg(parent.histogram_mutex);
+    for (size_t opcode = 0; opcode < histograms.size(); ++opcode) {
+        std::unique_ptr<Hdr1sfMicroSecHistogram> histo(histograms[opcode]);
+        if (histo && histo->getValueCount() > 0) {
+            if (!parent.retired[opcode]) {
+                parent.retired[opcode] = std::move(histo);
+            } else {
+                *parent.retired[opcode] += *histo;
+            }
+        }
+    }
+}
+
+Hdr1sfMicroSecHistogram& Timings::ThreadTimings::get_or_create(
+        uint8_t opcode) {
+    auto* histo = histograms[opcode].load(std::memory_order_acquire);
+    if (!histo) {
+        histo = new Hdr1sfMicroSecHistogram();
+        histograms[opcode].store(histo, std::memory_order_release);
+    }
+    return *histo;
+}
+
+template <typename Function>
+void Timings::for_each_histogram(uint8_t opcode, Function function) const {
+    // Holding the accessor blocks threads from exiting (and moving their
+    // histograms into the retired ones) while we visit them.
+    auto accessor = timings.accessAllThreads();
+    for (const auto& thread : accessor) {
+        auto* histo =
+                thread.histograms[opcode].load(std::memory_order_acquire);
+        if (histo) {
+            function(*histo);
+        }
+    }
+
     std::lock_guard<std::mutex> lg(histogram_mutex);
-    for (auto& t : timings) {
-        delete t;
+    if (retired[opcode]) {
+        function(*retired[opcode]);
     }
 }
 
 void Timings::reset() {
-    {
-        std::lock_guard<std::mutex> lg(histogram_mutex);
-        for (auto& t : timings) {
-            if (t) {
-                t.load()->reset();
-            }
-        }
+    for (size_t opcode = 0; opcode < MAX_NUM_OPCODES; ++opcode) {
+        for_each_histogram(opcode, [](Hdr1sfMicroSecHistogram& histo) {
+            histo.reset();
+        });
     }
 
     {
@@ -45,11 +81,15 @@ void Timings::reset() {
 }
 
 void Timings::collect(cb::mcbp::ClientOpcode opcode,
-                      std::chrono::nanoseconds nsec) {
+                      std::chrono::nanoseconds nsec,
+                      uint32_t weight) {
     using namespace std::chrono;
-    get_or_create_timing_histogram(
-            std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode))
-            .add(duration_cast<microseconds>(nsec));
+    if (weight != 0) {
+        timings->get_or_create(
+                       std::underlying_type<cb::mcbp::ClientOpcode>::type(
+                               opcode))
+                .add(duration_cast<microseconds>(nsec), weight);
+    }
     auto& interval =
             interval_counters
                     .get()[std::underlying_type<cb::mcbp::ClientOpcode>::type(
@@ -59,11 +99,10 @@ void Timings::collect(cb::mcbp::ClientOpcode opcode,
 }
 
 std::string Timings::generate(cb::mcbp::ClientOpcode opcode) {
-    auto* histoPtr =
-            timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode)]
-                    .load();
-    if (histoPtr) {
-        return histoPtr->to_string();
+    auto histo = get_timing_histogram(
+            std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode));
+    if (histo.getValueCount() > 0) {
+        return histo.to_string();
     }
     return std::string("{}");
 }
@@ -117,12 +156,11 @@ static const cb::mcbp::ClientOpcode timings_retrievals[] = {
 uint64_t Timings::get_aggregated_mutation_stats() const {
     uint64_t ret = 0;
     for (auto cmd : timings_mutations) {
-        auto* histoPtr =
-                timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd)]
-                        .load();
-        if (histoPtr) {
-            ret += histoPtr->getValueCount();
-        }
+        for_each_histogram(
+                std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd),
+                [&ret](const Hdr1sfMicroSecHistogram& histo) {
+                    ret += histo.getValueCount();
+                });
     }
     return ret;
 }
@@ -130,12 +168,11 @@ uint64_t Timings::get_aggregated_mutation_stats() const {
 uint64_t Timings::get_aggregated_retrieval_stats() const {
     uint64_t ret = 0;
     for (auto cmd : timings_retrievals) {
-        auto* histoPtr =
-                timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd)]
-                        .load();
-        if (histoPtr) {
-            ret += histoPtr->getValueCount();
-        }
+        for_each_histogram(
+                std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd),
+                [&ret](const Hdr1sfMicroSecHistogram& histo) {
+                    ret += histo.getValueCount();
+                });
     }
     return ret;
 }
@@ -150,19 +187,12 @@ cb::sampling::Interval Timings::get_interval_lookup_latency() {
     return interval_latency_lookups.getAggregate();
 }
 
-Hdr1sfMicroSecHistogram& Timings::get_or_create_timing_histogram(
-        uint8_t opcode) {
-    if (!timings[opcode]) {
-        std::lock_guard<std::mutex> allocLock(histogram_mutex);
-        if (!timings[opcode]) {
-            timings[opcode] = new Hdr1sfMicroSecHistogram();
-        }
-    }
-    return *(timings[opcode].load());
-}
-
-Hdr1sfMicroSecHistogram* Timings::get_timing_histogram(uint8_t opcode) const {
-    return timings[opcode].load();
+Hdr1sfMicroSecHistogram Timings::get_timing_histogram(uint8_t opcode) const {
+    Hdr1sfMicroSecHistogram ret;
+    for_each_histogram(opcode, [&ret](const Hdr1sfMicroSecHistogram& histo) {
+        ret += histo;
+    });
+    return ret;
 }
 
 void Timings::sample(std::chrono::seconds sample_interval) {
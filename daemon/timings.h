@@ -20,9 +20,12 @@
 
 #include <mcbp/protocol/opcode.h>
 
+#include <folly/ThreadLocal.h>
 #include <platform/corestore.h>
 #include <utilities/hdrhistogram.h>
 #include <array>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -38,7 +41,18 @@ public:
     ~Timings();
 
     void reset();
-    void collect(cb::mcbp::ClientOpcode opcode, std::chrono::nanoseconds nsec);
+    /**
+     * Record the duration of an operation
+     *
+     * @param opcode the opcode of the operation
+     * @param nsec the duration
+     * @param weight the number of operations to record the duration for in
+     *               the histogram (when sampled), 0 to only count it in the
+     *               interval counters
+     */
+    void collect(cb::mcbp::ClientOpcode opcode,
+                 std::chrono::nanoseconds nsec,
+                 uint32_t weight = 1);
     void sample(std::chrono::seconds sample_interval);
     std::string generate(cb::mcbp::ClientOpcode opcode);
     uint64_t get_aggregated_mutation_stats() const;
@@ -48,18 +62,46 @@ public:
     cb::sampling::Interval get_interval_lookup_latency();
 
     /**
-     * Get a pointer to the underlying histogram for the specified opcode
-     * @return a pointer to the underling HdrMicroSecHistogram for this opcode
-     * if there isn't one allocated already a nullptr will be returned.
+     * Get the histogram for the specified opcode, merged from the histograms
+     * of every thread
+     * @return the HdrMicroSecHistogram for this opcode, empty if no
+     * timings have been collected for it
      */
-    Hdr1sfMicroSecHistogram* get_timing_histogram(uint8_t opcode) const;
+    Hdr1sfMicroSecHistogram get_timing_histogram(uint8_t opcode) const;
 
 private:
     /**
-     * Method to get histogram for timing, if the histogram hasn't been created
-     * yet, for the given opcode then we will allocate one
+     * The histograms of one thread. Each front end thread records into its
+     * own histograms so command completions on different cores don't
+     * contend on the same cache lines; they are only merged when read.
      */
-    Hdr1sfMicroSecHistogram& get_or_create_timing_histogram(uint8_t opcode);
+    class ThreadTimings {
+    public:
+        explicit ThreadTimings(Timings& parent) : parent(parent) {
+        }
+        ThreadTimings(const ThreadTimings&) = delete;
+        // Moves the timings into the retired histograms of the parent
+        ~ThreadTimings();
+
+        /**
+         * Get the histogram for the opcode, allocating it if it hasn't been
+         * created yet (only called by the owning thread)
+         */
+        Hdr1sfMicroSecHistogram& get_or_create(uint8_t opcode);
+
+        // Histograms are created in a lazy manner as their foot print is
+        // larger than our old histogram class. Only the owning thread
+        // creates them, other threads may read or reset them.
+        std::array<std::atomic<Hdr1sfMicroSecHistogram*>, MAX_NUM_OPCODES>
+                histograms{};
+
+    private:
+        Timings& parent;
+    };
+
+    /// Call the function for every histogram of the opcode
+    template <typename Function>
+    void for_each_histogram(uint8_t opcode, Function function) const;
 
     // This lock is only held by sample() and some blocks within generate().
     // It guards the various IntervalSeries variables which internally
@@ -68,11 +110,18 @@ private:
 
     cb::sampling::IntervalSeries interval_latency_lookups;
     cb::sampling::IntervalSeries interval_latency_mutations;
-    // create an array of unique_ptrs as we want to create HdrHistograms
-    // in a lazy manner as their foot print is larger than our old
-    // histogram class
-    std::array<std::atomic<Hdr1sfMicroSecHistogram*>, MAX_NUM_OPCODES> timings;
-    std::mutex histogram_mutex;
+
+    // The timings of threads which have exited, guarded by
+    // histogram_mutex. Allocated in a lazy manner like the per-thread
+    // ones.
+    std::array<std::unique_ptr<Hdr1sfMicroSecHistogram>, MAX_NUM_OPCODES>
+            retired;
+    mutable std::mutex histogram_mutex;
+
+    struct ThreadTimingsTag {};
+    // Must be destroyed before the retired histograms: each ThreadTimings
+    // is moved into them when destroyed.
+    mutable folly::ThreadLocal<ThreadTimings, ThreadTimingsTag> timings;
 
     // Sharded by core as cache contention was observed due to the number of
     // threads attempting to update the same timings stats.
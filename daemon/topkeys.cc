@@ -18,16 +18,15 @@
 #include "topkeys.h"
 #include "settings.h"
 
-#include <platform/sysinfo.h>
-
-#include <folly/concurrency/CacheLocality.h>
+#include <folly/hash/Hash.h>
 #include <inttypes.h>
 #include <nlohmann/json.hpp>
 
 #include <algorithm>
 #include <gsl/gsl>
-#include <set>
+#include <limits>
 #include <stdexcept>
+#include <unordered_map>
 #include <utility>
 
 /*
@@ -35,77 +34,51 @@
  *
  * === TopKeys ===
  *
- * The TopKeys class is split into shards for performance reasons. We create one
- * shard per (logical) core to:
- *
- * a) prevent any cache contention
- * b) allow as much concurrent access as possible (each shard is guarded by a
- *    mutex)
- *
- * Topkeys passes on requests to the correct Shard (determined by the core id of
- * the calling thread), and when statistics are requested it aggregates
- * information from each shard. When aggregating information, the TopKeys class
- * has to remove duplicates from the possible pool of top keys because we shard
- * per core for performance. Previously, TopKeys would create 8 shards
- * (regardless of machine size), each with storage for a configurably amount of
- * keys and shard by key hash (which meant that we would not have duplicate keys
- * across shards). Now that we shard per core instead of by key hash, to keep
- * the size of the stat output the same we need a minimum of 8 X N keys per
- * shard (because each shard could be an exact duplicate of the others).
- *
- * === TopKeys::Shard ===
+ * The TopKeys class keeps one Sketch per thread (in a folly::ThreadLocal) so
+ * that updating the topkeys of a key doesn't need any locks or atomic
+ * read-modify-write operations, and can stay enabled in production.
  *
- * This is where the action happens. Each Shard maintains an ordered
- * list of key names and related statistics, orded by when they were
- * last accessed. There is a fixed number of keys each Shard tracks.
-
- * Given we generally track only a small number of keys per shard (10
- * by default), it's highly likely that any one key access will 'miss'
- * - i.e. not find an existing topkey. Therefore this class is
- * optimized for that case, attempting to minimise memory allocation
- * in steady-state.
- *
- * Internally Shard consists of a vector of topkey_t, storing the
- * current max_keys top_keys, and a list of topkey_t pointers, used to
- * main the current most -> least recently used ordering:
-
- * max_keys elements. Each element is a tuple of
- * {hash(key), key, topkey_stats}:
+ * When statistics are requested TopKeys visits the Sketch of every thread and
+ * aggregates their tables; as a key may be used by several threads the
+ * counts of the same key are added up. To keep the size of the stat output
+ * the same as when keys were sharded by hash, each table tracks 8 X N keys
+ * (because each table could be an exact duplicate of the others).
  *
+ * === TopKeys::Sketch ===
  *
- *       vector<topkey_t>
- *   +----------+-------------+---------------+
- *   | size_t   | std::string | topkey_item_t |
- *   +----------+-------------+---------------+
- *   | <hash 1> | <key 1>     | stats 1       | <--- Node1
- *   | <hash 2> | <key 2>     | stats 2       | <--- Node2
- *   | <hash 3> | <key 3>     | stats 3       | <--- Node3
- *   . ....                                   .
- *   | <hash N> | <key N>     | stats N       | <--- NodeN
- *   +----------------------------------------+
+ * This is where the action happens. Most key accesses are for keys which
+ * aren't (and won't become) top keys, so the Sketch first estimates how
+ * often the key has been used with a Count-Min sketch: Depth rows of Width
+ * counters, where the key hash selects one counter per row. The estimate is
+ * the lowest of the key's counters (it can only over count, when hashes
+ * collide), and only the counters equal to it are incremented (a
+ * "conservative update", which reduces the over counting):
  *
- *   Node3 <---> Node1 <---> ... <---> Node2
- *   ^^^                               ^^^
- *   MRU                               LRU
+ *          0   1   2   3        Width-1
+ *        +---+---+---+---+ ... +---+
+ *  row 0 |   | 7 |   |   |     |   |
+ *  row 1 |   |   |   | 5 |     |   |      estimate(key) = min(7, 5, 9, 5)
+ *  row 2 | 9 |   |   |   |     |   |
+ *  row 3 |   |   |   |   |     | 5 |
+ *        +---+---+---+---+ ... +---+
  *
+ * In front of that sits a table of the (8 X N) keys with the highest
+ * estimates, like the Space-Saving algorithm: if the key is in the table its
+ * count is set to the new estimate, and if not and the estimate is higher
+ * than the lowest count in the table the key replaces that entry. Only the
+ * replacement (and so the copy of the key) is done under the mutex of the
+ * Sketch, which is only contended while stats are being collected; the
+ * counts are relaxed atomics written by the owning thread alone.
  *
- * Upon a key 'hit', TopKeys::updateKey() is called. That hashes the
- * key, and finds the Shard responsible for that
- * key. TopKeys::Shard::updateKey() is then called.
- *
- * Shard::updateKey() iterates over the vector, searching for a hash
- * match with an existing element, using the actual key string to
- * validate (in case of a hash collision). If it is found, then the
- * stats are simply updated.  If it is not found, then the
- * least-recently-used element is selected as a 'victim' and it's
- * contents is replaced by the incoming key.  Finally the linked-list
- * is updated to move the updated element to the head of the list.
+ * Every DecayInterval updates all the counts of a Sketch are halved, so keys
+ * which are no longer used make way for the current ones. The access counts
+ * reported are therefore estimates of the recent accesses.
  */
 TopKeys::TopKeys(int mkeys)
-    : keys_to_return(mkeys * legacy_multiplier), shards(cb::get_cpu_count()) {
-    for (auto& shard : shards) {
-        shard->setMaxKeys(keys_to_return);
-    }
+    : keys_to_return(mkeys * legacy_multiplier),
+      sketches([capacity = keys_to_return]() {
+          return new Sketch(capacity);
+      }) {
 }
 
 TopKeys::~TopKeys() {
@@ -113,9 +86,10 @@ TopKeys::~TopKeys() {
 
 void TopKeys::updateKey(const void* key,
                         size_t nkey,
-                        rel_time_t operation_time) {
+                        rel_time_t operation_time,
+                        uint32_t count) {
     if (Settings::instance().isTopkeysEnabled()) {
-        doUpdateKey(key, nkey, operation_time);
+        doUpdateKey(key, nkey, operation_time, count);
     }
 }
 
@@ -138,76 +112,114 @@ ENGINE_ERROR_CODE TopKeys::json_stats(nlohmann::json& object,
     return ENGINE_SUCCESS;
 }
 
-TopKeys::Shard& TopKeys::getShard() {
-    auto stripe =
-            folly::AccessSpreader<std::atomic>::cachedCurrent(shards.size());
-    return *shards[stripe];
+TopKeys::Sketch::Sketch(size_t capacity)
+    : hashes(capacity), entries(capacity) {
 }
 
-TopKeys::topkey_t* TopKeys::Shard::searchForKey(size_t key_hash,
-                                                std::string_view key) {
-    for (auto& topkey : storage) {
-        if (topkey.first.hash == key_hash) {
-            // Double-check with full compare
-            if (topkey.first.key == key) {
-                // Match found.
-                return &topkey;
-            }
+uint32_t TopKeys::Sketch::incrementEstimate(size_t key_hash, uint32_t count) {
+    // Derive the row hashes from two hashes of the key
+    // (Kirsch-Mitzenmacher)
+    const uint64_t h1 = key_hash;
+    const uint64_t h2 = folly::hash::twang_mix64(key_hash) | 1;
+    std::array<uint32_t*, Depth> cells;
+    uint32_t estimate = std::numeric_limits<uint32_t>::max();
+    for (size_t row = 0; row < Depth; ++row) {
+        cells[row] = &counters[row * Width + ((h1 + row * h2) % Width)];
+        estimate = std::min(estimate, *cells[row]);
+    }
+    const auto newEstimate =
+            estimate > std::numeric_limits<uint32_t>::max() - count
+                    ? std::numeric_limits<uint32_t>::max()
+                    : estimate + count;
+    for (auto* cell : cells) {
+        *cell = std::max(*cell, newEstimate);
+    }
+    return newEstimate;
+}
+
+size_t TopKeys::Sketch::findLowest() const {
+    size_t lowest = 0;
+    for (size_t ii = 1; ii < used; ++ii) {
+        if (entries[ii].count.load(std::memory_order_relaxed) <
+            entries[lowest].count.load(std::memory_order_relaxed)) {
+            lowest = ii;
         }
     }
-    return nullptr;
+    return lowest;
 }
 
-bool TopKeys::Shard::updateKey(std::string_view key,
-                               size_t key_hash,
-                               const rel_time_t ct) {
-    try {
-        std::lock_guard<std::mutex> lock(mutex);
+void TopKeys::Sketch::decay() {
+    for (auto& counter : counters) {
+        counter /= 2;
+    }
+    for (size_t ii = 0; ii < used; ++ii) {
+        entries[ii].count.store(
+                entries[ii].count.load(std::memory_order_relaxed) / 2,
+                std::memory_order_relaxed);
+    }
+    lowestCount /= 2;
+    updates = 0;
+}
+
+void TopKeys::Sketch::updateKey(std::string_view key,
+                                size_t key_hash,
+                                const rel_time_t ct,
+                                uint32_t count) {
+    updates += std::min(count, DecayInterval);
+    if (updates >= DecayInterval) {
+        decay();
+    }
 
-        topkey_t* found_key = searchForKey(key_hash, key);
-
-        if (!found_key) {
-            // Key not found.
-            if (storage.size() == max_keys) {
-                // Re-use the lowest keys' storage.
-                found_key = list.back();
-                found_key->first.hash = key_hash;
-                found_key->first.key = key;
-                found_key->second = topkey_item_t(ct);
-
-                // Move back element to the front, shuffling down the
-                // rest.
-                list.splice(list.begin(), list, --list.end());
-
-            } else {
-                // add a new element to the storage array.
-
-                storage.emplace_back(std::make_pair(
-                        KeyId{key_hash, std::string(key)}, topkey_item_t(ct)));
-                found_key = &storage.back();
-
-                // Insert the new item to the front of the list
-                list.push_front(found_key);
-            }
-        } else {
-            // Found - shuffle to the front.
-            auto it = std::find(list.begin(), list.end(), found_key);
-            list.splice(list.begin(), list, it);
+    const auto estimate = incrementEstimate(key_hash, count);
+
+    for (size_t ii = 0; ii < used; ++ii) {
+        if (hashes[ii] == key_hash && entries[ii].key == key) {
+            entries[ii].count.store(estimate, std::memory_order_relaxed);
+            return;
         }
+    }
+
+    if (used < entries.size()) {
+        // Add a new entry to the table
+        std::lock_guard<std::mutex> lock(mutex);
+        hashes[used] = key_hash;
+        entries[used].key = key;
+        entries[used].ctime = ct;
+        entries[used].count.store(estimate, std::memory_order_relaxed);
+        ++used;
+        lowestCount = std::min(lowestCount, estimate);
+        return;
+    }
 
-        // Increment access count.
-        found_key->second.ti_access_count++;
-        return true;
+    if (entries.empty() || estimate <= lowestCount) {
+        return;
+    }
 
-    } catch (const std::bad_alloc&) {
-        // Failed to update.
-        return false;
+    // The counts in the table may have grown since lowestCount was
+    // calculated; find the current lowest one.
+    const auto victim = findLowest();
+    const auto victimCount =
+            entries[victim].count.load(std::memory_order_relaxed);
+    if (estimate <= victimCount) {
+        lowestCount = victimCount;
+        return;
+    }
+
+    {
+        // Re-use the lowest key's storage.
+        std::lock_guard<std::mutex> lock(mutex);
+        hashes[victim] = key_hash;
+        entries[victim].key = key;
+        entries[victim].ctime = ct;
+        entries[victim].count.store(estimate, std::memory_order_relaxed);
     }
+    lowestCount = entries[findLowest()].count.load(std::memory_order_relaxed);
 }
 
 void TopKeys::doUpdateKey(const void* key,
                           size_t nkey,
-                          rel_time_t operation_time) {
+                          rel_time_t operation_time,
+                          uint32_t count) {
     if (key == nullptr || nkey == 0) {
         throw std::invalid_argument(
                 "TopKeys::doUpdateKey: key must be specified");
@@ -220,7 +232,7 @@ void TopKeys::doUpdateKey(const void* key,
         std::hash<std::string_view> hash_fn;
         const size_t key_hash = hash_fn(key_buf);
 
-        getShard().updateKey(key_buf, key_hash, operation_time);
+        sketches->updateKey(key_buf, key_hash, operation_time, count);
     } catch (const std::bad_alloc&) {
         // Failed to increment topkeys, continue...
     }
@@ -262,7 +274,7 @@ static void tk_iterfunc(const std::string& key,
     rel_time_t created_time = c->current_time - it.ti_ctime;
     int vlen = snprintf(val_str,
                         sizeof(val_str) - 1,
-                        "get_hits=%d,"
+                        "get_hits=%" PRIu32 ","
                         "get_misses=0,cmd_set=0,incr_hits=0,incr_misses=0,"
                         "decr_hits=0,decr_misses=0,delete_hits=0,"
                         "delete_misses=0,evictions=0,cas_hits=0,cas_badval=0,"
@@ -303,15 +315,19 @@ static void tk_jsonfunc(const std::string& key,
     c->array->push_back(obj);
 }
 
-static void tk_aggregate_func(const TopKeys::topkey_t& it, void* arg) {
+static void tk_aggregate_func(const std::string& key,
+                              const topkey_item_t& it,
+                              void* arg) {
     auto* map =
             static_cast<std::unordered_map<std::string, topkey_item_t>*>(arg);
 
-    auto res = map->insert(std::make_pair(it.first.key, it.second));
+    auto res = map->insert(std::make_pair(key, it));
 
     // If insert failed, then we have a duplicate top key. Add the stats
     if (!res.second) {
-        res.first->second.ti_access_count += it.second.ti_access_count;
+        res.first->second.ti_access_count += it.ti_access_count;
+        res.first->second.ti_ctime =
+                std::min(res.first->second.ti_ctime, it.ti_ctime);
     }
 }
 
@@ -348,11 +364,15 @@ ENGINE_ERROR_CODE TopKeys::do_json_stats(nlohmann::json& object,
     return ENGINE_SUCCESS;
 }
 
-void TopKeys::Shard::accept_visitor(iterfunc_t visitor_func,
-                                    void* visitor_ctx) {
+void TopKeys::Sketch::accept_visitor(iterfunc_t visitor_func,
+                                     void* visitor_ctx) const {
     std::lock_guard<std::mutex> lock(mutex);
-    for (const auto* key : list) {
-        visitor_func(*key, visitor_ctx);
+    for (size_t ii = 0; ii < used; ++ii) {
+        const auto& entry = entries[ii];
+        visitor_func(entry.key,
+                     topkey_item_t(entry.ctime,
+                                   entry.count.load(std::memory_order_relaxed)),
+                     visitor_ctx);
     }
 }
 
@@ -361,8 +381,10 @@ void TopKeys::doStatsInner(const tk_context& stat_context) {
     std::unordered_map<std::string, topkey_item_t> map =
             std::unordered_map<std::string, topkey_item_t>();
 
-    for (auto& shard : shards) {
-        shard->accept_visitor(tk_aggregate_func, &map);
+    // Holding the accessor blocks threads from exiting (and destroying
+    // their Sketch) while we visit them.
+    for (const auto& sketch : sketches.accessAllThreads()) {
+        sketch.accept_visitor(tk_aggregate_func, &map);
     }
 
     // Easiest way to sort this by access_count is to drop the contents of the
@@ -18,31 +18,30 @@
 
 #include <memcached/engine.h>
 #include <nlohmann/json_fwd.hpp>
-#include <array>
 
-#include <folly/lang/Aligned.h>
-#include <list>
+#include <folly/ThreadLocal.h>
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 struct tk_context;
 /*
  * TopKeys
  *
- * Tracks the top N most recently accessed keys. The details are
+ * Tracks the N most frequently accessed keys. The details are
  * accessible by a stats call, which is used by ns_server to print the
  * top keys list in the GUI.
  */
 
 struct topkey_item_t {
-    explicit topkey_item_t(rel_time_t create_time)
-        : ti_ctime(create_time), ti_access_count(0) {
+    topkey_item_t(rel_time_t create_time, uint32_t access_count)
+        : ti_ctime(create_time), ti_access_count(access_count) {
     }
 
     rel_time_t ti_ctime; /* Time this item was created */
-    int ti_access_count; /* Int count for number of times key has been accessed
-                          */
+    uint32_t ti_access_count; /* (Estimated) number of times key has been
+                                 accessed */
 };
 
 /* Class to track the "top" keys in a bucket.
@@ -50,24 +49,23 @@ struct topkey_item_t {
 class TopKeys {
 public:
     /** Constructor.
-     * @param mkeys Number of keys stored in each shard (i.e. up to
-     *              mkeys * SHARDS will be tracked).
+     * @param mkeys Number of keys to return in stats (each thread tracks
+     *              up to mkeys * 8 candidates).
      */
     explicit TopKeys(int mkeys);
     ~TopKeys();
 
-    // Key type used in Shard. We store hashes of the key for faster lookup.
-    // Public for use in shard visitor functions.
-    struct KeyId {
-        size_t hash;
-        std::string key;
-    };
-
     // Pair of the key's string and the statistics related to it.
-    typedef std::pair<KeyId, topkey_item_t> topkey_t;
     typedef std::pair<std::string, topkey_item_t> topkey_stat_t;
 
-    void updateKey(const void* key, size_t nkey, rel_time_t operation_time);
+    /**
+     * Count the given number of accesses of the key (more than one when
+     * the accesses are sampled, see get_stats_sample_weight()).
+     */
+    void updateKey(const void* key,
+                   size_t nkey,
+                   rel_time_t operation_time,
+                   uint32_t count = 1);
 
     ENGINE_ERROR_CODE stats(const void* cookie,
                             rel_time_t current_time,
@@ -91,7 +89,10 @@ public:
                                  rel_time_t current_time);
 
 protected:
-    void doUpdateKey(const void* key, size_t nkey, rel_time_t operation_time);
+    void doUpdateKey(const void* key,
+                     size_t nkey,
+                     rel_time_t operation_time,
+                     uint32_t count);
 
     void doStatsInner(const tk_context& stat_context);
     ENGINE_ERROR_CODE doStats(const void* cookie,
@@ -103,9 +104,9 @@ protected:
 private:
     /**
      * Topkeys previously worked by storing 8 shards with variable size. As we
-     * now shard per core and not by key, topkeys may exist in multiple shards.
-     * We need to multiply our requested shard size by 8 to ensure that we
-     * have the same topkeys capacity.
+     * now track keys per thread and not by key, topkeys may exist in multiple
+     * sketches. We need to multiply our requested size by 8 to ensure that
+     * we have the same topkeys capacity.
      */
     const size_t legacy_multiplier = 8;
 
@@ -114,64 +115,83 @@ private:
      */
     const size_t keys_to_return;
 
-    class Shard;
-
-    Shard& getShard();
-
-    // One of N Shards which the keyspace has been broken
-    // into.
-    // Responsible for tracking the top {mkeys} within it's keyspace.
-    class Shard {
+    // The heavy hitters seen by one thread: a Count-Min sketch estimating
+    // the access count of every key, in front of a Space-Saving style table
+    // of the keys with the highest estimates.
+    // Only the owning thread updates a Sketch; the stats call reads it from
+    // another thread.
+    class Sketch {
     public:
-        void setMaxKeys(size_t mkeys) {
-            max_keys = mkeys;
-            storage.reserve(max_keys);
-            // reallocating storage invalidates the LRU list.
-            list.clear();
-        }
-
-        // Updates the topkey 'ranking' for the specified key.
-        // If the item does not exist it will be created (with it's creation
-        // time set to operation_time), otherwise the existing item will be
-        // updated.
-        // On success returns true, If insufficient memory to create a
-        // new item, returns false.
-        bool updateKey(std::string_view key,
+        explicit Sketch(size_t capacity);
+
+        // Counts an access of the specified key, adding it to the table
+        // (with it's creation time set to operation_time) if its estimated
+        // count is now higher than the lowest one in the table.
+        void updateKey(std::string_view key,
                        size_t key_hash,
-                       rel_time_t operation_time);
+                       rel_time_t operation_time,
+                       uint32_t count);
 
-        typedef void (*iterfunc_t)(const topkey_t& it, void* arg);
+        typedef void (*iterfunc_t)(const std::string& key,
+                                   const topkey_item_t& item,
+                                   void* arg);
 
-        /* For each key in this shard, invoke the given callback function.
+        /* For each key in the table, invoke the given callback function.
          */
-        void accept_visitor(iterfunc_t visitor_func, void* visitor_ctx);
+        void accept_visitor(iterfunc_t visitor_func, void* visitor_ctx) const;
+
+        // Rows (hash functions) and counters per row of the Count-Min sketch
+        static constexpr size_t Depth = 4;
+        static constexpr size_t Width = 256;
+
+        // Number of updates after which every count is halved, so that the
+        // table follows changes in the workload.
+        static constexpr uint32_t DecayInterval = 1 << 20;
 
     private:
-        // An ordered list of topkey_t*, used for LRU.
-        typedef std::list<topkey_t*> key_history_t;
+        struct Entry {
+            std::string key;
+            rel_time_t ctime = 0;
+            // Updated by the owning thread without the mutex
+            std::atomic<uint32_t> count{0};
+        };
+
+        // Adds count to the Count-Min counters of the key (a conservative
+        // update: only raising them to the new estimate), returning the new
+        // estimate.
+        uint32_t incrementEstimate(size_t key_hash, uint32_t count);
 
-        // Vector topkey_t, used for actual topkey storage.
-        typedef std::vector<topkey_t> key_storage_t;
+        // Index of the entry with the lowest count
+        size_t findLowest() const;
 
-        // Searches for the given key. If found returns a pointer to the
-        // topkey_t, else returns NULL.
-        topkey_t* searchForKey(size_t hash, std::string_view key);
+        void decay();
 
-        // Maximum numbers of keys to be tracked per shard.
-        size_t max_keys;
+        // Count-Min counters; only accessed by the owning thread.
+        std::array<uint32_t, Depth * Width> counters{};
 
-        // list of keys, ordered from most-recently used (front) to least
-        // recently used (back).
-        key_history_t list;
+        // Key hashes of the entries for a quick search; only accessed by the
+        // owning thread.
+        std::vector<size_t> hashes;
 
-        // Underlying topkey storage.
-        key_storage_t storage;
+        // The tracked keys. Only the first 'used' entries are valid.
+        std::vector<Entry> entries;
+        size_t used = 0;
 
-        // Mutex to serialize access to this shard.
-        std::mutex mutex;
+        // Lower bound of the lowest count in the table, avoiding a search for
+        // keys which can't enter the table.
+        uint32_t lowestCount = 0;
+
+        // Updates since the last decay
+        uint32_t updates = 0;
+
+        // Serialises changes to the keys of the table (and 'used') with the
+        // stats call. Only contended when stats are being collected.
+        mutable std::mutex mutex;
     };
 
-    // Array of topkey shards. We have one shard per core so we need to
-    // cache line pad the shards to prevent any contention.
-    std::vector<folly::cacheline_aligned<Shard>> shards;
+    struct SketchTag {};
+
+    // One Sketch per thread updating the topkeys of this bucket, merged
+    // when the stats are requested.
+    folly::ThreadLocal<Sketch, SketchTag> sketches;
 };
@@ -0,0 +1,173 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "workload_capture.h"
+
+#include "front_end_thread.h"
+#include "log_macros.h"
+#include "memcached.h"
+
+#include <mcbp/protocol/request.h>
+#include <utilities/workload_capture_format.h>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+WorkloadCapture& WorkloadCapture::instance() {
+    static WorkloadCapture capture;
+    return capture;
+}
+
+void WorkloadCapture::start(const std::string& file_path, bool hash_keys) {
+    stop();
+
+    FILE* fp = fopen(file_path.c_str(), "wb");
+    if (fp == nullptr) {
+        throw std::system_error(errno,
+                                std::system_category(),
+                                "WorkloadCapture: fopen " + file_path);
+    }
+
+    cb::workload::FileHeader header = {};
+    std::memcpy(header.magic, cb::workload::FileMagic, sizeof(header.magic));
+    header.version = cb::workload::FileVersion;
+    header.flags = hash_keys ? cb::workload::FlagKeysHashed : 0;
+    header.startTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::system_clock::now()
+                                       .time_since_epoch())
+                               .count();
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+        const auto error = errno;
+        fclose(fp);
+        throw std::system_error(error,
+                                std::system_category(),
+                                "WorkloadCapture: fwrite " + file_path);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        file = fp;
+        path = file_path;
+    }
+    numRecords = 0;
+    numBytes = sizeof(header);
+    hashKeys = hash_keys;
+    startTime = std::chrono::steady_clock::now();
+    ++generation;
+    enabled.store(true, std::memory_order_release);
+
+    LOG_INFO("Started capturing the workload to {} (keys {})",
+             file_path,
+             hash_keys ? "hashed" : "in the clear");
+}
+
+void WorkloadCapture::stop() {
+    enabled = false;
+
+    // Write out what the threads have buffered. They may still be in the
+    // middle of recording a request, which then is left in the buffer to be
+    // discarded by the next capture (as it has a different generation)
+    const auto current = generation.load();
+    iterate_all_front_end_threads([this, current](FrontEndThread& thread) {
+        auto& buffer = thread.workloadCapture;
+        std::lock_guard<std::mutex> guard(buffer.mutex);
+        if (buffer.generation == current) {
+            write(buffer.data);
+        }
+        buffer.data.clear();
+    });
+
+    std::lock_guard<std::mutex> guard(mutex);
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+        LOG_INFO("Stopped capturing the workload to {}: {} requests ({} bytes)",
+                 path,
+                 numRecords.load(),
+                 numBytes.load());
+    }
+}
+
+void WorkloadCapture::record(FrontEndThread& thread,
+                             uint32_t connectionId,
+                             const cb::mcbp::Request& request) {
+    using cb::mcbp::Magic;
+    const auto magic = request.getMagic();
+    if (magic != Magic::ClientRequest && magic != Magic::AltClientRequest) {
+        return;
+    }
+
+    const auto key = request.getKey();
+    cb::workload::RecordHeader record;
+    record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() -
+                               startTime.load())
+                               .count();
+    record.connectionId = connectionId;
+    record.valueSize = uint32_t(request.getValue().size());
+    record.vbucket = request.getVBucket().get();
+    record.keyLength = uint16_t(key.size());
+    record.magic = uint8_t(magic);
+    record.opcode = uint8_t(request.getClientOpcode());
+    record.datatype = uint8_t(request.getDatatype());
+    record.reserved = 0;
+
+    auto& buffer = thread.workloadCapture;
+    std::lock_guard<std::mutex> guard(buffer.mutex);
+    const auto current = generation.load();
+    if (buffer.generation != current) {
+        buffer.data.clear();
+        buffer.data.reserve(CaptureBuffer::FlushThreshold + 1024);
+        buffer.generation = current;
+    }
+
+    const auto* ptr = reinterpret_cast<const uint8_t*>(&record);
+    buffer.data.insert(buffer.data.end(), ptr, ptr + sizeof(record));
+    if (hashKeys) {
+        const auto hash = cb::workload::hashKey(
+                {reinterpret_cast<const char*>(key.data()), key.size()});
+        ptr = reinterpret_cast<const uint8_t*>(&hash);
+        buffer.data.insert(buffer.data.end(), ptr, ptr + sizeof(hash));
+    } else {
+        buffer.data.insert(buffer.data.end(), key.begin(), key.end());
+    }
+    ++numRecords;
+
+    if (buffer.data.size() >= CaptureBuffer::FlushThreshold) {
+        write(buffer.data);
+        buffer.data.clear();
+    }
+}
+
+void WorkloadCapture::write(const std::vector<uint8_t>& data) {
+    if (data.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(mutex);
+    if (file == nullptr) {
+        return;
+    }
+    if (fwrite(data.data(), data.size(), 1, file) != 1) {
+        // Stop recording (the file is closed once the capture is stopped)
+        LOG_WARNING("Failed to write the workload capture to {}: {}",
+                    path,
+                    std::strerror(errno));
+        enabled = false;
+        return;
+    }
+    numBytes += data.size();
+}
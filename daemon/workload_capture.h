@@ -0,0 +1,101 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cb::mcbp {
+class Request;
+}
+struct FrontEndThread;
+
+/**
+ * The capture of the requests received from the clients to a file, to be
+ * replayed by mcreplay (see utilities/workload_capture_format.h for the
+ * file format). It is enabled with the "workload_capture_file" setting.
+ *
+ * Each front end thread appends its records to a buffer of its own
+ * (FrontEndThread::workloadCapture), which is written to the file once
+ * it holds CaptureBuffer::FlushThreshold bytes (and when the capture is
+ * stopped), so the front end threads only contend for the file every few
+ * thousand requests.
+ */
+class WorkloadCapture {
+public:
+    /// The per thread buffer of the records not yet written to the file
+    struct CaptureBuffer {
+        /// The size at which the buffer is written to the file
+        static const size_t FlushThreshold = 64 * 1024;
+
+        /// Only contended when the capture is stopped
+        std::mutex mutex;
+        std::vector<uint8_t> data;
+        /// The capture the records in the buffer belong to
+        uint64_t generation = 0;
+    };
+
+    static WorkloadCapture& instance();
+
+    /**
+     * Start capturing to the given file (replacing any capture in
+     * progress, and any existing file).
+     *
+     * @param path the file to write the capture to
+     * @param hashKeys store the hash of the keys rather than the keys
+     * @throws std::system_error if the file can't be created
+     */
+    void start(const std::string& path, bool hashKeys);
+
+    /// Stop the capture in progress (if any), writing out all of the records
+    void stop();
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Record a (validated) request received by a connection served by the
+     * given thread. Must be called from that thread.
+     */
+    void record(FrontEndThread& thread,
+                uint32_t connectionId,
+                const cb::mcbp::Request& request);
+
+protected:
+    /// Write the data to the file (if the capture is still in progress)
+    void write(const std::vector<uint8_t>& data);
+
+    std::atomic_bool enabled{false};
+    /// Incremented every time a capture starts
+    std::atomic<uint64_t> generation{0};
+    std::atomic_bool hashKeys{true};
+    std::atomic<std::chrono::steady_clock::time_point> startTime{};
+
+    /// Protects the file (and the path)
+    std::mutex mutex;
+    FILE* file = nullptr;
+    std::string path;
+
+    std::atomic<uint64_t> numRecords{0};
+    std::atomic<uint64_t> numBytes{0};
+};
@@ -16,6 +16,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <mutex>
 #include <thread>
@@ -25,6 +27,14 @@
 #define hashsize(n) ((size_t)1<<(n))
 #define hashmask(n) (hashsize(n)-1)
 
+/*
+ * The number of locks protecting the hash table. A lock protects all of the
+ * buckets with the same low bits, so it must not exceed the size of the
+ * smallest table we expand from (hashsize(16)): the items of an old bucket
+ * then map to new buckets protected by the same lock.
+ */
+static const size_t assoc_lock_count = 1024;
+
 struct Assoc {
     explicit Assoc(unsigned int hp) : hashpower(hp) {
         primary_hashtable.resize(hashsize(hashpower));
@@ -44,25 +54,40 @@ struct Assoc {
     std::vector<hash_item*> old_hashtable;
 
     /* Number of items in the hash table. */
-    unsigned int hash_items{0};
+    std::atomic<unsigned int> hash_items{0};
 
     /* Flag: Are we in the middle of expanding now? */
-    bool expanding{false};
+    std::atomic_bool expanding{false};
 
     /*
      * During expansion we migrate values with bucket granularity; this is how
      * far we've gotten so far. Ranges from 0 .. hashsize(hashpower - 1) - 1.
      */
-    unsigned int expand_bucket{0};
+    std::atomic<unsigned int> expand_bucket{0};
 
     /*
-     * serialise access to the hashtable
+     * serialise access to the buckets of the hashtable (see
+     * assoc_lock_count). The hashpower and the tables themselves are only
+     * changed while holding all of the locks.
      */
-    std::mutex mutex;
+    std::array<std::mutex, assoc_lock_count> locks;
 };
 
-/* One hashtable for all */
-static struct Assoc* global_assoc = nullptr;
+static std::mutex& assoc_lock(struct Assoc* assoc, uint32_t hash) {
+    return assoc->locks[hash & (assoc_lock_count - 1)];
+}
+
+static void assoc_lock_all(struct Assoc* assoc) {
+    for (auto& lock : assoc->locks) {
+        lock.lock();
+    }
+}
+
+static void assoc_unlock_all(struct Assoc* assoc) {
+    for (auto& lock : assoc->locks) {
+        lock.unlock();
+    }
+}
 
 /* assoc factory. returns one new assoc or NULL if out-of-memory */
 static struct Assoc* assoc_consruct(int hashpower) {
@@ -73,39 +98,66 @@ static struct Assoc* assoc_consruct(int hashpower) {
     }
 }
 
+/*
+ * The initial hashpower for a bucket: enough buckets for one item per KB
+ * of the quota, so that a bucket filled with small items doesn't have to
+ * expand its table many times (and a small bucket doesn't waste memory on
+ * an oversized table).
+ */
+static unsigned int assoc_initial_hashpower(size_t maxbytes) {
+    unsigned int hashpower = 16;
+    while (hashpower < 26 && hashsize(hashpower) < maxbytes / 1024) {
+        ++hashpower;
+    }
+    return hashpower;
+}
+
 ENGINE_ERROR_CODE assoc_init(struct default_engine *engine) {
     /*
-        construct and save away one assoc for use by all buckets.
+        construct the hash table owned by this bucket.
     */
-    if (global_assoc == nullptr) {
-        global_assoc = assoc_consruct(16);
+    if (engine->assoc == nullptr) {
+        engine->assoc = assoc_consruct(
+                assoc_initial_hashpower(engine->config.maxbytes));
     }
-    return (global_assoc != nullptr) ? ENGINE_SUCCESS : ENGINE_ENOMEM;
+    return (engine->assoc != nullptr) ? ENGINE_SUCCESS : ENGINE_ENOMEM;
 }
 
-void assoc_destroy() {
-    if (global_assoc != nullptr) {
-        while (global_assoc->expanding) {
+void assoc_destroy(struct default_engine *engine) {
+    auto* assoc = engine->assoc;
+    if (assoc != nullptr) {
+        while (assoc->expanding) {
             std::this_thread::sleep_for(std::chrono::microseconds(250));
         }
-        delete global_assoc;
-        global_assoc = nullptr;
+        delete assoc;
+        engine->assoc = nullptr;
     }
 }
 
-hash_item *assoc_find(uint32_t hash, const hash_key *key) {
-    hash_item *it;
+/*
+    returns the address of the bucket the key belongs to.
+    the lock for the hash is assumed to be held by the caller.
+*/
+static hash_item** _hashitem_bucket(struct Assoc* assoc, uint32_t hash) {
     unsigned int oldbucket;
-    hash_item *ret = nullptr;
-    int depth = 0;
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
-    if (global_assoc->expanding &&
-        (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
+
+    if (assoc->expanding &&
+        (oldbucket = (hash & hashmask(assoc->hashpower - 1))) >= assoc->expand_bucket)
     {
-        it = global_assoc->old_hashtable[oldbucket];
-    } else {
-        it = global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
+        return &assoc->old_hashtable[oldbucket];
     }
+    return &assoc->primary_hashtable[hash & hashmask(assoc->hashpower)];
+}
+
+hash_item *assoc_find(struct default_engine *engine,
+                      uint32_t hash,
+                      const hash_key *key) {
+    auto* assoc = engine->assoc;
+    hash_item *it;
+    hash_item *ret = nullptr;
+    int depth = 0;
+    std::lock_guard<std::mutex> guard(assoc_lock(assoc, hash));
+    it = *_hashitem_bucket(assoc, hash);
 
     while (it) {
         const hash_key* it_key = item_get_key(it);
@@ -125,19 +177,12 @@ hash_item *assoc_find(uint32_t hash, const hash_key *key) {
 /*
     returns the address of the item pointer before the key.  if *item == 0,
     the item wasn't found
-    assoc->lock is assumed to be held by the caller.
+    the lock for the hash is assumed to be held by the caller.
 */
-static hash_item** _hashitem_before(uint32_t hash, const hash_key* key) {
-    hash_item **pos;
-    unsigned int oldbucket;
-
-    if (global_assoc->expanding &&
-        (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
-    {
-        pos = &global_assoc->old_hashtable[oldbucket];
-    } else {
-        pos = &global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
-    }
+static hash_item** _hashitem_before(struct Assoc* assoc,
+                                    uint32_t hash,
+                                    const hash_key* key) {
+    hash_item **pos = _hashitem_bucket(assoc, hash);
 
     while (*pos) {
         const hash_key* pos_key = item_get_key(*pos);
@@ -157,16 +202,26 @@ static hash_item** _hashitem_before(uint32_t hash, const hash_key* key) {
 static void assoc_maintenance_thread(void *arg);
 
 /*
-    grows the hashtable to the next power of 2.
-    assoc->lock is assumed to be held by the caller.
+    grows the hashtable to the next power of 2 if it is too full.
+    none of the locks may be held by the caller (all of them are taken
+    to switch the tables).
 */
-static void assoc_expand() {
-    global_assoc->old_hashtable.swap(global_assoc->primary_hashtable);
+static void assoc_expand(struct Assoc* assoc) {
+    assoc_lock_all(assoc);
+    if (assoc->expanding ||
+        assoc->hash_items <= (hashsize(assoc->hashpower) * 3) / 2) {
+        /* someone else started the expansion */
+        assoc_unlock_all(assoc);
+        return;
+    }
+
+    assoc->old_hashtable.swap(assoc->primary_hashtable);
 
     try {
-        global_assoc->primary_hashtable.resize(hashsize(global_assoc->hashpower + 1));
+        assoc->primary_hashtable.resize(hashsize(assoc->hashpower + 1));
     } catch (const std::bad_alloc&) {
-        global_assoc->primary_hashtable.swap(global_assoc->old_hashtable);
+        assoc->primary_hashtable.swap(assoc->old_hashtable);
+        assoc_unlock_all(assoc);
         /* Bad news, but we can keep running. */
         return;
     }
@@ -174,55 +229,64 @@ static void assoc_expand() {
     int ret = 0;
     cb_thread_t tid;
 
-    global_assoc->hashpower++;
-    global_assoc->expanding = true;
-    global_assoc->expand_bucket = 0;
+    assoc->hashpower++;
+    assoc->expanding = true;
+    assoc->expand_bucket = 0;
 
     /* start a thread to do the expansion */
     if ((ret = cb_create_named_thread(&tid, assoc_maintenance_thread,
-                                      nullptr, 1, "mc:assoc_maint")) != 0)
+                                      assoc, 1, "mc:assoc_maint")) != 0)
     {
         LOG_ERROR("Can't create thread for rebalance assoc table: {}",
                   cb_strerror());
-        global_assoc->hashpower--;
-        global_assoc->expanding = false;
-        global_assoc->primary_hashtable.swap(global_assoc->old_hashtable);
-        global_assoc->old_hashtable.resize(0);
-        global_assoc->old_hashtable.shrink_to_fit();
+        assoc->hashpower--;
+        assoc->expanding = false;
+        assoc->primary_hashtable.swap(assoc->old_hashtable);
+        assoc->old_hashtable.resize(0);
+        assoc->old_hashtable.shrink_to_fit();
     }
+    assoc_unlock_all(assoc);
 }
 
 /* Note: this isn't an assoc_update.  The key must not already exist to call this */
-int assoc_insert(uint32_t hash, hash_item *it) {
-    unsigned int oldbucket;
-
-    cb_assert(assoc_find(hash, item_get_key(it)) == nullptr);  /* shouldn't have duplicately named things defined */
+int assoc_insert(struct default_engine *engine, uint32_t hash, hash_item *it) {
+    cb_assert(assoc_find(engine, hash, item_get_key(it)) == nullptr);  /* shouldn't have duplicately named things defined */
 
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
-    if (global_assoc->expanding &&
-        (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
+    auto* assoc = engine->assoc;
+    unsigned int hash_items;
     {
-        it->h_next = global_assoc->old_hashtable[oldbucket];
-        global_assoc->old_hashtable[oldbucket] = it;
-    } else {
-        it->h_next = global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
-        global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)] = it;
+        std::lock_guard<std::mutex> guard(assoc_lock(assoc, hash));
+        hash_item** bucket = _hashitem_bucket(assoc, hash);
+        it->h_next = *bucket;
+        *bucket = it;
+        hash_items = ++assoc->hash_items;
     }
 
-    global_assoc->hash_items++;
-    if (! global_assoc->expanding && global_assoc->hash_items > (hashsize(global_assoc->hashpower) * 3) / 2) {
-        assoc_expand();
+    /* hashpower is only changed while holding all of the locks, so this
+       read may be stale; assoc_expand checks again */
+    if (!assoc->expanding) {
+        size_t size;
+        {
+            std::lock_guard<std::mutex> guard(assoc_lock(assoc, hash));
+            size = hashsize(assoc->hashpower);
+        }
+        if (hash_items > (size * 3) / 2) {
+            assoc_expand(assoc);
+        }
     }
     return 1;
 }
 
-void assoc_delete(uint32_t hash, const hash_key *key) {
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
-    hash_item **before = _hashitem_before(hash, key);
+void assoc_delete(struct default_engine *engine,
+                  uint32_t hash,
+                  const hash_key *key) {
+    auto* assoc = engine->assoc;
+    std::lock_guard<std::mutex> guard(assoc_lock(assoc, hash));
+    hash_item **before = _hashitem_before(assoc, hash, key);
 
     if (*before) {
         hash_item *nxt;
-        global_assoc->hash_items--;
+        assoc->hash_items--;
         nxt = (*before)->h_next;
         (*before)->h_next = nullptr;   /* probably pointless, but whatever. */
         *before = nxt;
@@ -239,42 +303,50 @@ void assoc_delete(uint32_t hash, const hash_key *key) {
 int hash_bulk_move = DEFAULT_HASH_BULK_MOVE;
 
 static void assoc_maintenance_thread(void *arg) {
-    bool done = false;
-    do {
+    auto* assoc = reinterpret_cast<struct Assoc*>(arg);
+    /* hashpower can't change until we're done expanding */
+    const unsigned int hashpower = assoc->hashpower;
+    const unsigned int old_size = hashsize(hashpower - 1);
+    unsigned int expand_bucket = 0;
+
+    while (expand_bucket < old_size) {
         int ii;
-        std::lock_guard<std::mutex> guard(global_assoc->mutex);
+        /* the items in an old bucket and the new buckets they're moved to
+           share the lock (see assoc_lock_count) */
+        std::lock_guard<std::mutex> guard(assoc_lock(assoc, expand_bucket));
 
-        for (ii = 0; ii < hash_bulk_move && global_assoc->expanding; ++ii) {
+        for (ii = 0; ii < hash_bulk_move && expand_bucket < old_size; ++ii) {
             hash_item *it, *next;
             int bucket;
 
-            for (it = global_assoc->old_hashtable[global_assoc->expand_bucket];
+            for (it = assoc->old_hashtable[expand_bucket];
                  nullptr != it; it = next) {
                 next = it->h_next;
                 const hash_key* key = item_get_key(it);
                 bucket = crc32c(hash_key_get_key(key),
                                 hash_key_get_key_len(key),
-                                0) & hashmask(global_assoc->hashpower);
-                it->h_next = global_assoc->primary_hashtable[bucket];
-                global_assoc->primary_hashtable[bucket] = it;
+                                0) & hashmask(hashpower);
+                it->h_next = assoc->primary_hashtable[bucket];
+                assoc->primary_hashtable[bucket] = it;
             }
 
-            global_assoc->old_hashtable[global_assoc->expand_bucket] = nullptr;
-            global_assoc->expand_bucket++;
-            if (global_assoc->expand_bucket == hashsize(global_assoc->hashpower - 1)) {
-                global_assoc->expanding = false;
-                global_assoc->old_hashtable.resize(0);
-                global_assoc->old_hashtable.shrink_to_fit();
-                LOG_INFO("Hash table expansion done");
-            }
-        }
-        if (!global_assoc->expanding) {
-            done = true;
+            assoc->old_hashtable[expand_bucket] = nullptr;
+            assoc->expand_bucket = ++expand_bucket;
         }
-    } while (!done);
+    }
+
+    assoc_lock_all(assoc);
+    assoc->old_hashtable.resize(0);
+    assoc->old_hashtable.shrink_to_fit();
+    assoc_unlock_all(assoc);
+
+    /* assoc_destroy waits for this flag to be cleared before deleting the
+       table, so this must be the last access to it. (The old table isn't
+       used any more as all of its buckets are migrated.) */
+    assoc->expanding = false;
+    LOG_INFO("Hash table expansion done");
 }
 
-bool assoc_expanding() {
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
-    return global_assoc->expanding;
+bool assoc_expanding(struct default_engine *engine) {
+    return engine->assoc->expanding;
 }
@@ -4,10 +4,16 @@
 
 #include "items.h"
 
-/* associative array */
+/* associative array (each bucket owns its own hash table) */
+struct Assoc;
+
 ENGINE_ERROR_CODE assoc_init(struct default_engine *engine);
-void assoc_destroy();
-hash_item *assoc_find(uint32_t hash, const hash_key* key);
-int assoc_insert(uint32_t hash, hash_item *item);
-void assoc_delete(uint32_t hash, const hash_key* key);
-bool assoc_expanding();
+void assoc_destroy(struct default_engine *engine);
+hash_item *assoc_find(struct default_engine *engine,
+                      uint32_t hash,
+                      const hash_key* key);
+int assoc_insert(struct default_engine *engine, uint32_t hash, hash_item *item);
+void assoc_delete(struct default_engine *engine,
+                  uint32_t hash,
+                  const hash_key* key);
+bool assoc_expanding(struct default_engine *engine);
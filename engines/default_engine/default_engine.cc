@@ -4,6 +4,7 @@
 #include "default_engine_public.h"
 #include "engine_manager.h"
 
+#include <logger/logger.h>
 #include <memcached/config_parser.h>
 #include <memcached/durability_spec.h>
 #include <memcached/protocol_binary.h>
@@ -85,6 +86,10 @@ void default_engine_constructor(struct default_engine* engine, bucket_id_t id)
     engine->config.xattr_enabled = true;
     engine->config.compression_mode = BucketCompressionMode::Off;
     engine->config.min_compression_ratio = default_min_compression_ratio;
+    engine->config.lru_crawler_interval = 60;
+    engine->config.slab_automove = true;
+    engine->config.ext_size = 1024 * 1024 * 1024;
+    engine->config.ext_item_size = 512;
 }
 
 ENGINE_ERROR_CODE create_memcache_instance(GET_SERVER_API get_server_api,
@@ -109,7 +114,6 @@ ENGINE_ERROR_CODE create_memcache_instance(GET_SERVER_API get_server_api,
 
 void destroy_memcache_engine() {
     engine_manager_shutdown();
-    assoc_destroy();
 }
 
 static struct default_engine* get_handle(EngineIface* handle) {
@@ -136,6 +140,17 @@ ENGINE_ERROR_CODE default_engine::initialize(const char* config_str) {
         return ret;
     }
 
+    if (config.ext_path != nullptr && *config.ext_path != '\0') {
+        try {
+            ext = std::make_unique<ExtStore>(config.ext_path, config.ext_size);
+        } catch (const std::exception& e) {
+            LOG_WARNING("Failed to create the flash tier: {}", e.what());
+            return ENGINE_FAILED;
+        }
+    }
+
+    crawler.last_run = server.core->get_current_time();
+    crawler.enabled = true;
     return ENGINE_SUCCESS;
 }
 
@@ -145,10 +160,15 @@ void default_engine::destroy(const bool force) {
 
 void destroy_engine_instance(struct default_engine* engine) {
     if (engine->initialized) {
+        /* Complete the reads from the flash tier (they use the items) */
+        engine->ext.reset();
+
         /* Destory the slabs cache */
         slabs_destroy(engine);
+        assoc_destroy(engine);
 
         cb_free(engine->config.uuid);
+        cb_free(engine->config.ext_path);
         engine->initialized = false;
     }
 }
@@ -342,7 +362,11 @@ cb::EngineErrorItemPair default_engine::get(
         return cb::makeEngineErrorItemPair(cb::engine_errc::unknown_collection);
     }
 
-    item* it = item_get(this, cookie, key, documentStateFilter);
+    auto* it = item_get(this, cookie, key, documentStateFilter);
+    if (it != nullptr && (it->iflag & ITEM_EXTSTORE) != 0) {
+        item_ext_read(this, cookie, it);
+        return cb::makeEngineErrorItemPair(cb::engine_errc::would_block);
+    }
     if (it != nullptr) {
         return cb::makeEngineErrorItemPair(cb::engine_errc::success, it, this);
     } else {
@@ -364,11 +388,15 @@ cb::EngineErrorItemPair default_engine::get_if(
         return cb::makeEngineErrorItemPair(cb::engine_errc::unknown_collection);
     }
 
-    cb::unique_item_ptr ret(item_get(this, cookie, key, DocStateFilter::Alive),
-                            cb::ItemDeleter{this});
-    if (!ret) {
+    auto* it = item_get(this, cookie, key, DocStateFilter::Alive);
+    if (it == nullptr) {
         return cb::makeEngineErrorItemPair(cb::engine_errc::no_such_key);
     }
+    if ((it->iflag & ITEM_EXTSTORE) != 0) {
+        item_ext_read(this, cookie, it);
+        return cb::makeEngineErrorItemPair(cb::engine_errc::would_block);
+    }
+    cb::unique_item_ptr ret(it, cb::ItemDeleter{this});
 
     item_info info;
     if (!get_item_info(ret.get(), &info)) {
@@ -453,13 +481,16 @@ cb::EngineErrorMetadataPair default_engine::get_meta(
         return std::make_pair(cb::engine_errc::unknown_collection, item_info());
     }
 
-    cb::unique_item_ptr item{
-            item_get(this, cookie, key, DocStateFilter::AliveOrDeleted),
-            cb::ItemDeleter(this)};
-
-    if (!item) {
+    auto* it = item_get(this, cookie, key, DocStateFilter::AliveOrDeleted);
+    if (it == nullptr) {
         return std::make_pair(cb::engine_errc::no_such_key, item_info());
     }
+    if ((it->iflag & ITEM_EXTSTORE) != 0) {
+        // The size of the value isn't the one of the header item
+        item_ext_read(this, cookie, it);
+        return std::make_pair(cb::engine_errc::would_block, item_info());
+    }
+    cb::unique_item_ptr item{it, cb::ItemDeleter(this)};
 
     item_info info;
     if (!get_item_info(item.get(), &info)) {
@@ -498,7 +529,16 @@ ENGINE_ERROR_CODE default_engine::get_stats(gsl::not_null<const void*> cookie,
                  cookie);
         add_stat("bytes"sv, std::to_string(stats.curr_bytes.load()), cookie);
         add_stat("reclaimed"sv, std::to_string(stats.reclaimed.load()), cookie);
+        add_stat("crawler_reclaimed"sv,
+                 std::to_string(stats.crawler_reclaimed.load()),
+                 cookie);
         add_stat("engine_maxbytes"sv, std::to_string(config.maxbytes), cookie);
+        if (ext) {
+            add_stat("ext_items"sv,
+                     std::to_string(stats.ext_items.load()),
+                     cookie);
+            ext->addStats(add_stat, cookie);
+        }
     } else if (key == "slabs"sv) {
         slabs_stats(this, add_stat, cookie);
     } else if (key == "items"sv) {
@@ -577,9 +617,13 @@ cb::EngineErrorCasPair default_engine::store_if(
             throw cb::engine_error(cb::engine_errc::failed,
                                    "default_store_if: item_get_key failed");
         }
-        cb::unique_item_ptr existing(
-                item_get(this, cookie, *key, DocStateFilter::Alive),
-                cb::ItemDeleter{this});
+        auto* existing_it = item_get(this, cookie, *key, DocStateFilter::Alive);
+        if (existing_it != nullptr &&
+            (existing_it->iflag & ITEM_EXTSTORE) != 0) {
+            item_ext_read(this, cookie, existing_it);
+            return {cb::engine_errc::would_block, 0};
+        }
+        cb::unique_item_ptr existing(existing_it, cb::ItemDeleter{this});
 
         cb::StoreIfStatus status;
         if (existing.get()) {
@@ -622,6 +666,7 @@ void default_engine::reset_stats(gsl::not_null<const void*> cookie) {
 
     stats.evictions.store(0);
     stats.reclaimed.store(0);
+    stats.crawler_reclaimed.store(0);
     stats.total_items.store(0);
 }
 
@@ -632,7 +677,7 @@ static ENGINE_ERROR_CODE initalize_configuration(struct default_engine *se,
    se->config.vb0 = true;
 
    if (cfg_str != nullptr) {
-       struct config_item items[13];
+       struct config_item items[18];
        int ii = 0;
 
        memset(&items, 0, sizeof(items));
@@ -695,9 +740,34 @@ static ENGINE_ERROR_CODE initalize_configuration(struct default_engine *se,
        items[ii].value.dt_bool = &se->config.keep_deleted;
        ++ii;
 
+       items[ii].key = "lru_crawler_interval";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.lru_crawler_interval;
+       ++ii;
+
+       items[ii].key = "slab_automove";
+       items[ii].datatype = DT_BOOL;
+       items[ii].value.dt_bool = &se->config.slab_automove;
+       ++ii;
+
+       items[ii].key = "ext_path";
+       items[ii].datatype = DT_STRING;
+       items[ii].value.dt_string = &se->config.ext_path;
+       ++ii;
+
+       items[ii].key = "ext_size";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.ext_size;
+       ++ii;
+
+       items[ii].key = "ext_item_size";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.ext_item_size;
+       ++ii;
+
        items[ii].key = nullptr;
        ++ii;
-       cb_assert(ii == 13);
+       cb_assert(ii == 18);
        ret = ENGINE_ERROR_CODE(se->server.core->parse_config(cfg_str,
                                                              items,
                                                              stderr));
@@ -13,6 +13,7 @@
 #include <relaxed_atomic.h>
 
 #include <atomic>
+#include <memory>
 #include <mutex>
 
 /** How long an object can reasonably be assumed to be locked before
@@ -26,6 +27,7 @@ struct default_engine;
 #include "items.h"
 #include "assoc.h"
 #include "slabs.h"
+#include "extstore.h"
 
    /* Flags */
 #define ITEM_LINKED (1)
@@ -36,9 +38,15 @@ struct default_engine;
 /** The item is deleted (may only be accessed if explicitly asked for) */
 #define ITEM_ZOMBIE (4)
 
+/** The item was accessed since it was linked in its LRU segment */
+#define ITEM_ACTIVE (8)
+
+/** The item is a header: its value is in the flash tier (see extstore.h) */
+#define ITEM_EXTSTORE (16)
+
 struct config {
    size_t verbose;
-   rel_time_t oldest_live;
+   std::atomic<rel_time_t> oldest_live;
    bool evict_to_free;
    size_t maxbytes;
    bool preallocate;
@@ -49,6 +57,16 @@ struct config {
    bool vb0;
    char *uuid;
    bool keep_deleted;
+   /* seconds between the runs of the LRU crawler (0 to disable it) */
+   size_t lru_crawler_interval;
+   /* move slabs to the slab classes evicting items */
+   bool slab_automove;
+   /* the file of the flash tier (the flash tier is disabled if not set) */
+   char *ext_path;
+   /* the size of the file of the flash tier */
+   size_t ext_size;
+   /* the smallest value moved to the flash tier */
+   size_t ext_item_size;
    std::atomic<bool> xattr_enabled;
    std::atomic<BucketCompressionMode> compression_mode;
    std::atomic<float> min_compression_ratio;
@@ -63,6 +81,10 @@ struct engine_stats {
     cb::RelaxedAtomic<uint64_t> curr_bytes{0};
     cb::RelaxedAtomic<uint64_t> curr_items{0};
     cb::RelaxedAtomic<uint64_t> total_items{0};
+    /* the part of reclaimed done by the LRU crawler */
+    cb::RelaxedAtomic<uint64_t> crawler_reclaimed{0};
+    /* the number of items with their value in the flash tier */
+    cb::RelaxedAtomic<uint64_t> ext_items{0};
 };
 
 struct engine_scrubber {
@@ -75,6 +97,13 @@ struct engine_scrubber {
     bool force_delete;
 };
 
+struct engine_crawler {
+    /* set once the engine is initialized (it may not be crawled before) */
+    std::atomic<bool> enabled{false};
+    /* when the crawler last ran (only used by the crawler) */
+    rel_time_t last_run{0};
+};
+
 struct vbucket_info {
     int state : 2;
 };
@@ -232,9 +261,16 @@ struct default_engine : public EngineIface {
     struct slabs slabs;
     struct items items;
 
+    /* The hash table of the items in the bucket (see assoc.cc) */
+    struct Assoc* assoc = nullptr;
+
+    /* The flash tier (if enabled) */
+    std::unique_ptr<ExtStore> ext;
+
     struct config config;
     struct engine_stats stats;
     struct engine_scrubber scrubber;
+    struct engine_crawler crawler;
 
     char vbucket_infos[NUM_VBUCKETS];
 
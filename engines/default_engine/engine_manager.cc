@@ -27,8 +27,11 @@
 #include "engine_manager.h"
 #include "default_engine_internal.h"
 
+#include <memcached/server_core_iface.h>
+
 #include <chrono>
 #include <memory>
+#include <vector>
 
 static std::unique_ptr<EngineManager> engineManager;
 static std::mutex createLock;
@@ -159,6 +162,32 @@ void EngineManager::notifyScrubComplete(struct default_engine* engine,
     cond.notify_one();
 }
 
+void EngineManager::maintainEngines() {
+    std::vector<struct default_engine*> candidates;
+    {
+        std::lock_guard<std::mutex> lck(lock);
+        if (shuttingdown) {
+            return;
+        }
+        candidates.assign(engines.begin(), engines.end());
+    }
+
+    for (auto* engine : candidates) {
+        if (!engine->crawler.enabled) {
+            continue;
+        }
+        const auto now = engine->server.core->get_current_time();
+        if (engine->config.lru_crawler_interval != 0 &&
+            now - engine->crawler.last_run >=
+                    engine->config.lru_crawler_interval) {
+            item_crawler_main(engine);
+            engine->crawler.last_run = now;
+        }
+        slabs_automove(engine);
+        item_ext_main(engine);
+    }
+}
+
 EngineManager& getEngineManager() {
     if (engineManager.get() == nullptr) {
         std::lock_guard<std::mutex> lg(createLock);
@@ -69,6 +69,15 @@ public:
      */
     void notifyScrubComplete(struct default_engine* engine, bool destroy);
 
+    /**
+     * Run the LRU crawler of the engines which haven't been crawled for
+     * their lru_crawler_interval, and the slab automover of the engines.
+     * Called by the scrubber task when it is idle (it is the only one
+     * deleting engines, so the engines can't go away while they are
+     * maintained).
+     */
+    void maintainEngines();
+
 protected:
     /**
      * Wait for the scrubber task to be idle. You <b>must</b> hold the
@@ -0,0 +1,340 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "extstore.h"
+
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Unistd.h>
+#include <logger/logger.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+using namespace std::string_view_literals;
+
+/*
+ * The write buffers are written to the file in one go. The file is a
+ * multiple of the buffer size, so a buffer never wraps around the end of
+ * the file (and the values never span two buffers).
+ */
+static const size_t buffer_size = 4 * 1024 * 1024;
+
+static const int reader_threads = 2;
+
+/* Each value is stored after a small header, 8 byte aligned */
+struct RecordHeader {
+    uint64_t cas;
+    uint32_t nbytes;
+    uint32_t unused;
+};
+
+static size_t record_size(size_t nbytes) {
+    return (sizeof(RecordHeader) + nbytes + 7) & ~size_t(7);
+}
+
+static void ext_writer_main(void* arg) {
+    reinterpret_cast<ExtStore*>(arg)->runWriter();
+}
+
+static void ext_reader_main(void* arg) {
+    reinterpret_cast<ExtStore*>(arg)->runReader();
+}
+
+static bool pwrite_fully(int fd,
+                         const char* buf,
+                         size_t nbytes,
+                         off_t offset) {
+    while (nbytes > 0) {
+        auto nw = pwrite(fd, buf, nbytes, offset);
+        if (nw < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nw <= 0) {
+            return false;
+        }
+        buf += nw;
+        nbytes -= nw;
+        offset += nw;
+    }
+    return true;
+}
+
+static bool pread_fully(int fd, char* buf, size_t nbytes, off_t offset) {
+    while (nbytes > 0) {
+        auto nr = pread(fd, buf, nbytes, offset);
+        if (nr < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nr <= 0) {
+            return false;
+        }
+        buf += nr;
+        nbytes -= nr;
+        offset += nr;
+    }
+    return true;
+}
+
+/* Get the value of a record if it is the one we're looking for */
+static bool decode_record(const char* record,
+                          uint64_t cas,
+                          uint32_t nbytes,
+                          std::string& value) {
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    if (header.cas != cas || header.nbytes != nbytes) {
+        return false;
+    }
+    value.assign(record + sizeof(header), nbytes);
+    return true;
+}
+
+ExtStore::ExtStore(std::string path, size_t size)
+    : path(std::move(path)), size(size - (size % buffer_size)) {
+    if (this->size < 2 * buffer_size) {
+        throw std::invalid_argument(
+                "ExtStore: the file must be at least " +
+                std::to_string(2 * buffer_size) + " bytes");
+    }
+
+    fd = open(this->path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        throw std::system_error(
+                errno, std::system_category(), "ExtStore: open " + this->path);
+    }
+
+    for (auto& buffer : buffers) {
+        buffer.data.resize(buffer_size);
+    }
+
+    if (cb_create_named_thread(
+                &writer, ext_writer_main, this, 0, "mc:ext write") != 0) {
+        close(fd);
+        unlink(this->path.c_str());
+        throw std::runtime_error("Error creating 'mc:ext write' thread");
+    }
+
+    for (int ii = 0; ii < reader_threads; ++ii) {
+        cb_thread_t tid;
+        if (cb_create_named_thread(
+                    &tid, ext_reader_main, this, 0, "mc:ext read") != 0) {
+            LOG_WARNING("Error creating 'mc:ext read' thread");
+            break;
+        }
+        readers.push_back(tid);
+    }
+
+    if (readers.empty()) {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        writerCond.notify_one();
+        cb_join_thread(writer);
+        close(fd);
+        unlink(this->path.c_str());
+        throw std::runtime_error("Error creating 'mc:ext read' threads");
+    }
+}
+
+ExtStore::~ExtStore() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+    }
+    writerCond.notify_one();
+    readerCond.notify_all();
+
+    // The readers complete the pending reads before returning, and may
+    // read from the write buffers (so join them before the writer)
+    for (auto& tid : readers) {
+        cb_join_thread(tid);
+    }
+    cb_join_thread(writer);
+
+    close(fd);
+    unlink(path.c_str());
+}
+
+size_t ExtStore::getMaxValueSize() {
+    return buffer_size - sizeof(RecordHeader);
+}
+
+bool ExtStore::write(uint64_t cas,
+                     std::string_view value,
+                     Location& location) {
+    if (value.size() > getMaxValueSize()) {
+        return false;
+    }
+    const size_t record = record_size(value.size());
+
+    std::lock_guard<std::mutex> guard(mutex);
+    auto* buffer = &buffers[active];
+    if (buffer->used + record > buffer_size) {
+        if (!buffer->sealed) {
+            buffer->sealed = true;
+            writerCond.notify_one();
+        }
+        auto& next = buffers[active ^ 1];
+        if (next.sealed) {
+            // Still being written to the file
+            ++writesRefused;
+            return false;
+        }
+        next.offset = buffer->offset + buffer_size;
+        next.used = 0;
+        active ^= 1;
+        buffer = &next;
+    }
+
+    const RecordHeader header{cas, uint32_t(value.size()), 0};
+    char* dst = buffer->data.data() + buffer->used;
+    std::memcpy(dst, &header, sizeof(header));
+    std::memcpy(dst + sizeof(header), value.data(), value.size());
+
+    location.offset = buffer->offset + buffer->used;
+    location.nbytes = uint32_t(value.size());
+    buffer->used += record;
+    bytesWritten += record;
+    return true;
+}
+
+void ExtStore::read(const Location& location,
+                    uint64_t cas,
+                    ReadCallback callback) {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        pending.push_back({location, cas, std::move(callback)});
+    }
+    readerCond.notify_one();
+}
+
+bool ExtStore::readValue(const Location& location,
+                         uint64_t cas,
+                         std::string& value) {
+    ++reads;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (location.offset < overwritten) {
+            ++readsLost;
+            return false;
+        }
+        for (const auto& buffer : buffers) {
+            if (location.offset >= buffer.offset &&
+                location.offset < buffer.offset + buffer.used) {
+                ++readsFromMemory;
+                const auto* record =
+                        buffer.data.data() + (location.offset - buffer.offset);
+                return decode_record(record, cas, location.nbytes, value);
+            }
+        }
+    }
+
+    // The value is in the file (unless it is overwritten while we read it)
+    std::vector<char> record(sizeof(RecordHeader) + location.nbytes);
+    if (!pread_fully(fd,
+                     record.data(),
+                     record.size(),
+                     off_t(location.offset % size)) ||
+        location.offset < overwritten ||
+        !decode_record(record.data(), cas, location.nbytes, value)) {
+        ++readsLost;
+        return false;
+    }
+    return true;
+}
+
+void ExtStore::runWriter() {
+    std::unique_lock<std::mutex> guard(mutex);
+    while (!stopping) {
+        // Write the oldest sealed buffer
+        Buffer* buffer = nullptr;
+        for (auto& candidate : buffers) {
+            if (candidate.sealed &&
+                (buffer == nullptr || candidate.offset < buffer->offset)) {
+                buffer = &candidate;
+            }
+        }
+        if (buffer == nullptr) {
+            writerCond.wait(guard);
+            continue;
+        }
+
+        // Writing the buffer overwrites what was written one file size
+        // before it
+        const uint64_t end = buffer->offset + buffer_size;
+        if (end > size) {
+            overwritten = end - size;
+        }
+
+        // Nothing modifies the buffer while it is sealed
+        guard.unlock();
+        if (!pwrite_fully(fd,
+                          buffer->data.data(),
+                          buffer_size,
+                          off_t(buffer->offset % size))) {
+            // The values just won't be found when read back
+            ++writeErrors;
+            LOG_WARNING("ExtStore: failed to write to {}: {}",
+                        path,
+                        std::strerror(errno));
+        }
+        guard.lock();
+        buffer->sealed = false;
+    }
+}
+
+void ExtStore::runReader() {
+    std::unique_lock<std::mutex> guard(mutex);
+    while (true) {
+        if (pending.empty()) {
+            if (stopping) {
+                return;
+            }
+            readerCond.wait(guard);
+            continue;
+        }
+
+        auto read = std::move(pending.front());
+        pending.pop_front();
+        guard.unlock();
+
+        std::string value;
+        const bool found = readValue(read.location, read.cas, value);
+        read.callback(found, value);
+
+        guard.lock();
+    }
+}
+
+void ExtStore::addStats(const AddStatFn& add_stat, const void* cookie) {
+    add_stat("ext_size"sv, std::to_string(size), cookie);
+    add_stat("ext_bytes_written"sv,
+             std::to_string(bytesWritten.load()),
+             cookie);
+    add_stat("ext_writes_refused"sv,
+             std::to_string(writesRefused.load()),
+             cookie);
+    add_stat("ext_write_errors"sv, std::to_string(writeErrors.load()), cookie);
+    add_stat("ext_reads"sv, std::to_string(reads.load()), cookie);
+    add_stat("ext_reads_memory"sv,
+             std::to_string(readsFromMemory.load()),
+             cookie);
+    add_stat("ext_reads_lost"sv, std::to_string(readsLost.load()), cookie);
+}
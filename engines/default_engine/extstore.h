@@ -0,0 +1,162 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/engine_common.h>
+#include <platform/platform_thread.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * The flash tier of a memcached bucket: the values of the cold items are
+ * moved to a file on flash, and only a small header item (the key, the
+ * metadata and the location of the value in the file) stays in memory.
+ *
+ * The file is a ring log: the values are appended to a write buffer, and
+ * the buffer is written to the file (by a thread of its own) once full,
+ * overwriting the oldest values in the file. The values are read back by a
+ * few reader threads, calling back once the value is read (or found to be
+ * overwritten).
+ *
+ * The content of the file is only valid for the lifetime of the bucket, so
+ * the file is removed when the bucket is deleted.
+ */
+class ExtStore {
+public:
+    /// Where a value is stored (the payload of the header items)
+    struct Location {
+        /// The offset of the value in the log (not wrapped to the file size)
+        uint64_t offset;
+        /// The size of the value
+        uint32_t nbytes;
+    };
+
+    /**
+     * Called by a reader thread with the value read (or with found set to
+     * false if the value was overwritten).
+     */
+    using ReadCallback = std::function<void(bool found, std::string_view)>;
+
+    /**
+     * Create the file (replacing any existing file) and start the threads.
+     *
+     * @param path the file to store the values in
+     * @param size the size of the file (rounded down to a number of write
+     *             buffers)
+     * @throws std::system_error if the file can't be created
+     * @throws std::invalid_argument if the file is too small
+     */
+    ExtStore(std::string path, size_t size);
+
+    /// Stop the threads (completing the pending reads) and remove the file
+    ~ExtStore();
+
+    ExtStore(const ExtStore&) = delete;
+
+    /// The biggest value which can be stored
+    static size_t getMaxValueSize();
+
+    /**
+     * Append a value to the log.
+     *
+     * @param cas the cas of the item (stored with the value, to tell it
+     *            apart from an overwritten value when read back)
+     * @param value the value to store
+     * @param location where to return the location of the value
+     * @return false if the value couldn't be stored (because the write
+     *         buffers are waiting to be written to the file)
+     */
+    bool write(uint64_t cas, std::string_view value, Location& location);
+
+    /**
+     * Read a value back (asynchronously).
+     *
+     * @param location the location returned by write
+     * @param cas the cas the value was written with
+     * @param callback called with the value from a reader thread
+     */
+    void read(const Location& location, uint64_t cas, ReadCallback callback);
+
+    void addStats(const AddStatFn& add_stat, const void* cookie);
+
+    /// Thread main functions (only to be called from the thread entry points)
+    void runWriter();
+    void runReader();
+
+private:
+    struct Buffer {
+        /// The offset in the log of the first byte of the buffer
+        uint64_t offset = 0;
+        /// The number of bytes of the buffer in use
+        size_t used = 0;
+        /// Full, and waiting to be written to the file
+        bool sealed = false;
+        std::vector<char> data;
+    };
+
+    struct PendingRead {
+        Location location;
+        uint64_t cas;
+        ReadCallback callback;
+    };
+
+    /// Read a value from the write buffers or the file
+    bool readValue(const Location& location, uint64_t cas, std::string& value);
+
+    const std::string path;
+    /// The size of the file (a multiple of the buffer size)
+    const uint64_t size;
+    int fd = -1;
+
+    /// Protects the buffers, the pending reads and the stopping flag
+    std::mutex mutex;
+    /// Notifies the writer of sealed buffers
+    std::condition_variable writerCond;
+    /// Notifies the readers of pending reads
+    std::condition_variable readerCond;
+
+    std::array<Buffer, 2> buffers;
+    /// The buffer the values are appended to
+    size_t active = 0;
+    std::deque<PendingRead> pending;
+    bool stopping = false;
+
+    /**
+     * The offset below which the values in the log may be overwritten
+     * (set before a buffer is written to the file)
+     */
+    std::atomic<uint64_t> overwritten{0};
+
+    cb_thread_t writer;
+    std::vector<cb_thread_t> readers;
+
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> writesRefused{0};
+    std::atomic<uint64_t> writeErrors{0};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> readsFromMemory{0};
+    std::atomic<uint64_t> readsLost{0};
+};
@@ -11,12 +11,16 @@
 #include "default_engine_internal.h"
 #include "engine_manager.h"
 #include <logger/logger.h>
+#include <memcached/server_cookie_iface.h>
 #include <memcached/server_core_iface.h>
 #include <memcached/server_document_iface.h>
 #include <platform/cb_malloc.h>
 #include <platform/cbassert.h>
 #include <platform/crc32c.h>
 
+#include <string_view>
+#include <vector>
+
 /* Forward Declarations */
 static void item_link_q(struct default_engine *engine, hash_item *it);
 static void item_unlink_q(struct default_engine *engine, hash_item *it);
@@ -25,7 +29,8 @@ static hash_item *do_item_alloc(struct default_engine *engine,
                                 const int flags, const rel_time_t exptime,
                                 const int nbytes,
                                 const void *cookie,
-                                uint8_t datatype);
+                                uint8_t datatype,
+                                bool key_locked);
 static hash_item* do_item_get(struct default_engine* engine,
                               const hash_key* key,
                               const DocStateFilter document_state);
@@ -33,6 +38,8 @@ static int do_item_link(struct default_engine *engine,
                         const void* cookie,
                         hash_item *it);
 static void do_item_unlink(struct default_engine *engine, hash_item *it);
+static void do_item_unlink_lru_locked(struct default_engine *engine,
+                                      hash_item *it);
 static ENGINE_ERROR_CODE do_safe_item_unlink(struct default_engine *engine,
                                              hash_item *it);
 static void do_item_release(struct default_engine *engine, hash_item *it);
@@ -42,6 +49,9 @@ static int do_item_replace(struct default_engine* engine,
                            hash_item* it,
                            hash_item* new_it);
 static void item_free(struct default_engine *engine, hash_item *it);
+static void do_item_ext_read(struct default_engine *engine,
+                             const void *cookie,
+                             const hash_item *it);
 
 static bool hash_key_create(hash_key* hkey,
                             const DocKey& key,
@@ -63,8 +73,98 @@ static void hash_key_copy_to_item(hash_item* dst, const hash_key* src);
 static const int search_items = 50;
 
 void item_stats_reset(struct default_engine *engine) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
-    memset(engine->items.itemstats, 0, sizeof(engine->items.itemstats));
+    for (int ii = 0; ii < POWER_LARGEST; ++ii) {
+        std::lock_guard<std::mutex> guard(engine->items.lru_locks[ii]);
+        memset(&engine->items.itemstats[ii], 0, sizeof(itemstats_t));
+    }
+}
+
+static uint32_t item_hash(const hash_key* key) {
+    return crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0);
+}
+
+/* The lock protecting the items with the given key */
+static std::mutex& item_lock(struct default_engine* engine,
+                             const hash_key* key) {
+    return engine->items.item_locks[item_hash(key) & (item_lock_count - 1)];
+}
+
+/*
+ * Try to acquire the lock of an item found while walking an LRU (the LRU
+ * lock is held, so we can't block waiting for it). The caller may already
+ * hold the lock (for the key being operated on).
+ */
+class ItemTryLock {
+public:
+    ItemTryLock(struct default_engine* engine,
+                hash_item* it,
+                const std::mutex* held) {
+        auto& lock = item_lock(engine, item_get_key(it));
+        if (&lock == held) {
+            locked = true;
+        } else if (lock.try_lock()) {
+            acquired = &lock;
+            locked = true;
+        }
+    }
+
+    ItemTryLock(const ItemTryLock&) = delete;
+
+    ~ItemTryLock() {
+        if (acquired != nullptr) {
+            acquired->unlock();
+        }
+    }
+
+    explicit operator bool() const {
+        return locked;
+    }
+
+private:
+    std::mutex* acquired = nullptr;
+    bool locked = false;
+};
+
+/*
+ * The share of the items of a slab class in the hot and warm segments of its
+ * LRU. The hot segment holds the items which were just linked, and the warm
+ * segment the items accessed again since.
+ */
+static const unsigned int hot_lru_percent = 20;
+static const unsigned int warm_lru_percent = 40;
+
+/*
+ * The oldest item of the LRU of a slab class: the tail of the cold segment
+ * (or of the warm or hot segment if the segments before them are empty).
+ * The LRU lock for the slab class is assumed to be held.
+ */
+static hash_item* item_lru_tail(struct default_engine* engine,
+                                unsigned int id) {
+    for (int segment = lru_segment_count - 1; segment >= 0; --segment) {
+        if (engine->items.tails[id][segment] != nullptr) {
+            return engine->items.tails[id][segment];
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * The item before the given item when walking the LRU of its slab class from
+ * the oldest item (moving on to the tail of the next segment when reaching
+ * the head of a segment).
+ * The LRU lock for the slab class is assumed to be held.
+ */
+static hash_item* item_lru_prev(struct default_engine* engine,
+                                const hash_item* it) {
+    if (it->prev != nullptr) {
+        return it->prev;
+    }
+    for (int segment = int(it->lru.load()) - 1; segment >= 0; --segment) {
+        if (engine->items.tails[it->slabs_clsid][segment] != nullptr) {
+            return engine->items.tails[it->slabs_clsid][segment];
+        }
+    }
+    return nullptr;
 }
 
 
@@ -77,7 +177,7 @@ static size_t ITEM_ntotal(struct default_engine *engine,
 
 /* Get the next CAS id for a new item. */
 static uint64_t get_cas_id() {
-    static uint64_t cas_id = 0;
+    static std::atomic<uint64_t> cas_id{0};
     return ++cas_id;
 }
 
@@ -100,7 +200,8 @@ hash_item *do_item_alloc(struct default_engine *engine,
                          const rel_time_t exptime,
                          const int nbytes,
                          const void *cookie,
-                         uint8_t datatype) {
+                         uint8_t datatype,
+                         bool key_locked) {
     hash_item *it = nullptr;
     int tries = search_items;
     hash_item *search;
@@ -114,30 +215,42 @@ hash_item *do_item_alloc(struct default_engine *engine,
         return nullptr;
     }
 
+    /* The items in the LRU may share the caller's lock */
+    const std::mutex* held = key_locked ? &item_lock(engine, key) : nullptr;
+    auto& lru_lock = engine->items.lru_locks[id];
+
     /* do a quick check if we have any expired items in the tail.. */
     oldest_live = engine->config.oldest_live;
     current_time = engine->server.core->get_current_time();
 
-    for (search = engine->items.tails[id];
-         tries > 0 && search != nullptr;
-         tries--, search=search->prev) {
-        if (search->refcount == 0 &&
-            ((search->time < oldest_live) || /* dead by flush */
-             (search->exptime != 0 && search->exptime < current_time)) &&
-            (search->locktime <= current_time)) {
-            it = search;
-            /* I don't want to actually free the object, just steal
-             * the item to avoid to grab the slab mutex twice ;-)
-             */
-            engine->stats.reclaimed++;
-            engine->items.itemstats[id].reclaimed++;
-            it->refcount = 1;
-            slabs_adjust_mem_requested(engine, it->slabs_clsid, ITEM_ntotal(engine, it), ntotal);
-            do_item_unlink(engine, it);
-            /* Initialize the item block: */
-            it->slabs_clsid = 0;
-            it->refcount = 0;
-            break;
+    {
+        std::lock_guard<std::mutex> guard(lru_lock);
+        for (search = item_lru_tail(engine, id);
+             tries > 0 && search != nullptr;
+             tries--, search = item_lru_prev(engine, search)) {
+            if ((search->iflag & ITEM_LINKED) == 0) {
+                /* a scrubber cursor */
+                continue;
+            }
+            ItemTryLock lock(engine, search, held);
+            if (lock && search->refcount == 0 &&
+                ((search->time < oldest_live) || /* dead by flush */
+                 (search->exptime != 0 && search->exptime < current_time)) &&
+                (search->locktime <= current_time)) {
+                it = search;
+                /* I don't want to actually free the object, just steal
+                 * the item to avoid to grab the slab mutex twice ;-)
+                 */
+                engine->stats.reclaimed++;
+                engine->items.itemstats[id].reclaimed++;
+                it->refcount = 1;
+                slabs_adjust_mem_requested(engine, it->slabs_clsid, ITEM_ntotal(engine, it), ntotal);
+                do_item_unlink_lru_locked(engine, it);
+                /* Initialize the item block: */
+                it->slabs_clsid = 0;
+                it->refcount = 0;
+                break;
+            }
         }
     }
 
@@ -149,6 +262,8 @@ hash_item *do_item_alloc(struct default_engine *engine,
         */
         tries = search_items;
 
+        std::unique_lock<std::mutex> guard(lru_lock);
+
         /* If requested to not push old items out of cache when memory runs out,
          * we're out of luck at this point...
          */
@@ -165,13 +280,17 @@ hash_item *do_item_alloc(struct default_engine *engine,
          * tries
          */
 
-        if (engine->items.tails[id] == nullptr) {
+        if (item_lru_tail(engine, id) == nullptr) {
             engine->items.itemstats[id].outofmemory++;
             return nullptr;
         }
 
-        for (search = engine->items.tails[id]; tries > 0 && search != nullptr; tries--, search=search->prev) {
-            if (search->refcount == 0 && search->locktime <= current_time) {
+        for (search = item_lru_tail(engine, id); tries > 0 && search != nullptr; tries--, search = item_lru_prev(engine, search)) {
+            if ((search->iflag & ITEM_LINKED) == 0) {
+                continue;
+            }
+            ItemTryLock lock(engine, search, held);
+            if (lock && search->refcount == 0 && search->locktime <= current_time) {
                 if (search->exptime == 0 || search->exptime > current_time) {
                     engine->items.itemstats[id].evicted++;
                     engine->items.itemstats[id].evicted_time = current_time - search->time;
@@ -183,12 +302,14 @@ hash_item *do_item_alloc(struct default_engine *engine,
                     engine->items.itemstats[id].reclaimed++;
                     engine->stats.reclaimed++;
                 }
-                do_item_unlink(engine, search);
+                do_item_unlink_lru_locked(engine, search);
                 break;
             }
         }
+        guard.unlock();
         it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id));
         if (it == nullptr) {
+            guard.lock();
             engine->items.itemstats[id].outofmemory++;
             /* Last ditch effort. There is a very rare bug which causes
              * refcount leaks. We've fixed most of them, but it still happens,
@@ -198,14 +319,19 @@ hash_item *do_item_alloc(struct default_engine *engine,
              * free it anyway.
              */
             tries = search_items;
-            for (search = engine->items.tails[id]; tries > 0 && search != nullptr; tries--, search=search->prev) {
-                if (search->refcount != 0 && search->time + TAIL_REPAIR_TIME < current_time) {
+            for (search = item_lru_tail(engine, id); tries > 0 && search != nullptr; tries--, search = item_lru_prev(engine, search)) {
+                if ((search->iflag & ITEM_LINKED) == 0) {
+                    continue;
+                }
+                ItemTryLock lock(engine, search, held);
+                if (lock && search->refcount != 0 && search->time + TAIL_REPAIR_TIME < current_time) {
                     engine->items.itemstats[id].tailrepairs++;
                     search->refcount = 0;
-                    do_item_unlink(engine, search);
+                    do_item_unlink_lru_locked(engine, search);
                     break;
                 }
             }
+            guard.unlock();
             it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id));
             if (it == nullptr) {
                 return nullptr;
@@ -217,8 +343,6 @@ hash_item *do_item_alloc(struct default_engine *engine,
 
     it->slabs_clsid = id;
 
-    cb_assert(it != engine->items.heads[it->slabs_clsid]);
-
     it->next = it->prev = it->h_next = nullptr;
     it->refcount = 1;     /* the caller will have a reference */
     DEBUG_REFCNT(it, '*');
@@ -228,6 +352,7 @@ hash_item *do_item_alloc(struct default_engine *engine,
     it->datatype = datatype;
     it->exptime = exptime;
     it->locktime = 0;
+    it->lru = LruSegment::Hot;
     hash_key_copy_to_item(it, key);
     return it;
 }
@@ -236,8 +361,6 @@ static void item_free(struct default_engine *engine, hash_item *it) {
     size_t ntotal = ITEM_ntotal(engine, it);
     unsigned int clsid;
     cb_assert((it->iflag & ITEM_LINKED) == 0);
-    cb_assert(it != engine->items.heads[it->slabs_clsid]);
-    cb_assert(it != engine->items.tails[it->slabs_clsid]);
     cb_assert(it->refcount == 0 || engine->scrubber.force_delete);
 
     /* so slab size changer can tell later if item is already free or not */
@@ -248,13 +371,15 @@ static void item_free(struct default_engine *engine, hash_item *it) {
     slabs_free(engine, it, ntotal, clsid);
 }
 
+/* the LRU lock for the slab class of the item is assumed to be held */
 static void item_link_q(struct default_engine *engine, hash_item *it) { /* item is the new head */
     hash_item **head, **tail;
     cb_assert(it->slabs_clsid < POWER_LARGEST);
     cb_assert((it->iflag & ITEM_SLABBED) == 0);
 
-    head = &engine->items.heads[it->slabs_clsid];
-    tail = &engine->items.tails[it->slabs_clsid];
+    const auto segment = int(it->lru.load());
+    head = &engine->items.heads[it->slabs_clsid][segment];
+    tail = &engine->items.tails[it->slabs_clsid][segment];
     cb_assert(it != *head);
     cb_assert((*head && *tail) || (*head == nullptr && *tail == nullptr));
     it->prev = nullptr;
@@ -262,15 +387,17 @@ static void item_link_q(struct default_engine *engine, hash_item *it) { /* item
     if (it->next) it->next->prev = it;
     *head = it;
     if (*tail == nullptr) *tail = it;
-    engine->items.sizes[it->slabs_clsid]++;
+    engine->items.sizes[it->slabs_clsid][segment]++;
     return;
 }
 
+/* the LRU lock for the slab class of the item is assumed to be held */
 static void item_unlink_q(struct default_engine *engine, hash_item *it) {
     hash_item **head, **tail;
     cb_assert(it->slabs_clsid < POWER_LARGEST);
-    head = &engine->items.heads[it->slabs_clsid];
-    tail = &engine->items.tails[it->slabs_clsid];
+    const auto segment = int(it->lru.load());
+    head = &engine->items.heads[it->slabs_clsid][segment];
+    tail = &engine->items.tails[it->slabs_clsid][segment];
 
     if (*head == it) {
         cb_assert(it->prev == nullptr);
@@ -285,10 +412,56 @@ static void item_unlink_q(struct default_engine *engine, hash_item *it) {
 
     if (it->next) it->next->prev = it->prev;
     if (it->prev) it->prev->next = it->next;
-    engine->items.sizes[it->slabs_clsid]--;
+    engine->items.sizes[it->slabs_clsid][segment]--;
     return;
 }
 
+/* move the item to the head of another segment of its LRU (the LRU lock for
+   its slab class is assumed to be held) */
+static void item_move_q(struct default_engine *engine,
+                        hash_item *it,
+                        LruSegment segment) {
+    item_unlink_q(engine, it);
+    it->lru = segment;
+    it->iflag &= ~ITEM_ACTIVE;
+    item_link_q(engine, it);
+}
+
+/*
+ * Move the items at the tail of the hot and warm segments of the LRU of a
+ * slab class on to the next segment when the segments grow above their
+ * share: active items to (the head of) the warm segment, and the others to
+ * the cold segment. This is done as items are linked in the hot or warm
+ * segment, so only a couple of items have to be moved each time.
+ * The LRU lock for the slab class is assumed to be held.
+ */
+static void item_lru_balance(struct default_engine *engine, unsigned int id) {
+    const auto* sizes = engine->items.sizes[id];
+    const unsigned int total = sizes[int(LruSegment::Hot)] +
+                               sizes[int(LruSegment::Warm)] +
+                               sizes[int(LruSegment::Cold)];
+
+    for (const auto segment : {LruSegment::Hot, LruSegment::Warm}) {
+        const auto limit = (total * (segment == LruSegment::Hot
+                                             ? hot_lru_percent
+                                             : warm_lru_percent)) /
+                           100;
+        for (int moves = 0; moves < 2 && sizes[int(segment)] > limit;
+             ++moves) {
+            hash_item* tail = engine->items.tails[id][int(segment)];
+            if ((tail->iflag & ITEM_LINKED) == 0) {
+                /* a cursor, it'll move on */
+                break;
+            }
+            if ((tail->iflag & ITEM_ACTIVE) != 0) {
+                item_move_q(engine, tail, LruSegment::Warm);
+            } else {
+                item_move_q(engine, tail, LruSegment::Cold);
+            }
+        }
+    }
+}
+
 int do_item_link(struct default_engine *engine,
                  const void* cookie,
                  hash_item *it) {
@@ -297,8 +470,7 @@ int do_item_link(struct default_engine *engine,
     it->iflag |= ITEM_LINKED;
     it->time = engine->server.core->get_current_time();
 
-    assoc_insert(crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0),
-                 it);
+    assoc_insert(engine, item_hash(key), it);
 
     engine->stats.curr_bytes += ITEM_ntotal(engine, it);
     engine->stats.curr_items += 1;
@@ -325,19 +497,24 @@ int do_item_link(struct default_engine *engine,
         return 0;
     }
 
+    std::lock_guard<std::mutex> guard(engine->items.lru_locks[it->slabs_clsid]);
     item_link_q(engine, it);
+    item_lru_balance(engine, it->slabs_clsid);
 
     return 1;
 }
 
-void do_item_unlink(struct default_engine *engine, hash_item *it) {
+/* the lock for the item and the LRU lock for its slab class are held */
+void do_item_unlink_lru_locked(struct default_engine *engine, hash_item *it) {
     const hash_key* key = item_get_key(it);
     if ((it->iflag & ITEM_LINKED) != 0) {
         it->iflag &= ~ITEM_LINKED;
         engine->stats.curr_bytes -= ITEM_ntotal(engine, it);
         engine->stats.curr_items -= 1;
-        assoc_delete(crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0),
-                     key);
+        if ((it->iflag & ITEM_EXTSTORE) != 0) {
+            engine->stats.ext_items -= 1;
+        }
+        assoc_delete(engine, item_hash(key), key);
         item_unlink_q(engine, it);
         if (it->refcount == 0 || engine->scrubber.force_delete) {
             item_free(engine, it);
@@ -345,6 +522,14 @@ void do_item_unlink(struct default_engine *engine, hash_item *it) {
     }
 }
 
+void do_item_unlink(struct default_engine *engine, hash_item *it) {
+    if ((it->iflag & ITEM_LINKED) != 0) {
+        std::lock_guard<std::mutex> guard(
+                engine->items.lru_locks[it->slabs_clsid]);
+        do_item_unlink_lru_locked(engine, it);
+    }
+}
+
 ENGINE_ERROR_CODE do_safe_item_unlink(struct default_engine* engine,
                                       hash_item* it) {
 
@@ -358,18 +543,7 @@ ENGINE_ERROR_CODE do_safe_item_unlink(struct default_engine* engine,
     auto ret = ENGINE_SUCCESS;
 
     if (it->cas == stored->cas) {
-        if ((stored->iflag & ITEM_LINKED) != 0) {
-            stored->iflag &= ~ITEM_LINKED;
-            engine->stats.curr_bytes -= ITEM_ntotal(engine, stored);
-            engine->stats.curr_items -= 1;
-            assoc_delete(crc32c(hash_key_get_key(key),
-                                hash_key_get_key_len(key), 0),
-                         key);
-            item_unlink_q(engine, stored);
-            if (stored->refcount == 0 || engine->scrubber.force_delete) {
-                item_free(engine, stored);
-            }
-        }
+        do_item_unlink(engine, stored);
     } else {
         ret = ENGINE_KEY_EEXISTS;
     }
@@ -393,10 +567,23 @@ void do_item_update(struct default_engine *engine, hash_item *it) {
     if (it->time < current_time - ITEM_UPDATE_INTERVAL) {
         cb_assert((it->iflag & ITEM_SLABBED) == 0);
 
-        if ((it->iflag & ITEM_LINKED) != 0) {
-            item_unlink_q(engine, it);
-            it->time = current_time;
-            item_link_q(engine, it);
+        if ((it->iflag & ITEM_LINKED) == 0) {
+            return;
+        }
+
+        it->time = current_time;
+        if (it->lru != LruSegment::Cold) {
+            /* Just flag it, it is moved to the warm segment when it
+               reaches the tail of its segment (without taking the LRU
+               lock here) */
+            it->iflag |= ITEM_ACTIVE;
+        } else {
+            std::lock_guard<std::mutex> guard(
+                    engine->items.lru_locks[it->slabs_clsid]);
+            /* Not balancing the segments here, or the item could move
+               right back to the cold segment. That's done when the next
+               item is linked */
+            item_move_q(engine, it, LruSegment::Warm);
         }
     }
 }
@@ -411,38 +598,92 @@ int do_item_replace(struct default_engine *engine,
     return do_item_link(engine, cookie, new_it);
 }
 
+/*
+ * Replace a linked item with a copy of it holding its value elsewhere (a
+ * header item for a value moved to the flash tier, or the other way
+ * around). The document doesn't change, so the copy keeps the CAS and the
+ * lock of the item, and the core isn't told about it.
+ */
+static void do_item_swap(struct default_engine *engine,
+                         hash_item *it,
+                         hash_item *new_it,
+                         LruSegment segment,
+                         rel_time_t time) {
+    const hash_key* key = item_get_key(new_it);
+    cb_assert((it->iflag & ITEM_LINKED) != 0);
+    cb_assert((new_it->iflag & (ITEM_LINKED|ITEM_SLABBED)) == 0);
+
+    new_it->cas = it->cas;
+    new_it->locktime = it->locktime;
+    do_item_unlink(engine, it);
+
+    new_it->iflag |= ITEM_LINKED;
+    new_it->time = time;
+    new_it->lru = segment;
+    assoc_insert(engine, item_hash(key), new_it);
+
+    engine->stats.curr_bytes += ITEM_ntotal(engine, new_it);
+    engine->stats.curr_items += 1;
+    if ((new_it->iflag & ITEM_EXTSTORE) != 0) {
+        engine->stats.ext_items += 1;
+    }
+
+    std::lock_guard<std::mutex> guard(
+            engine->items.lru_locks[new_it->slabs_clsid]);
+    item_link_q(engine, new_it);
+    item_lru_balance(engine, new_it->slabs_clsid);
+}
+
 static void do_item_stats(struct default_engine* engine,
                           const AddStatFn& add_stats,
                           const void* c) {
     int i;
     rel_time_t current_time = engine->server.core->get_current_time();
+    rel_time_t oldest_live = engine->config.oldest_live;
     for (i = 0; i < POWER_LARGEST; i++) {
-        if (engine->items.tails[i] != nullptr) {
+        std::lock_guard<std::mutex> guard(engine->items.lru_locks[i]);
+        if (item_lru_tail(engine, i) != nullptr) {
             const char *prefix = "items";
             int search = search_items;
-            while (search > 0 &&
-                   engine->items.tails[i] != nullptr &&
-                   ((engine->config.oldest_live != 0 && /* Item flushd */
-                     engine->config.oldest_live <= current_time &&
-                     engine->items.tails[i]->time <= engine->config.oldest_live) ||
-                    (engine->items.tails[i]->exptime != 0 && /* and not expired */
-                     engine->items.tails[i]->exptime < current_time))) {
+            while (search > 0 && item_lru_tail(engine, i) != nullptr) {
+                hash_item* tail = item_lru_tail(engine, i);
+                if ((tail->iflag & ITEM_LINKED) == 0) {
+                    break;
+                }
+                ItemTryLock lock(engine, tail, nullptr);
+                if (!lock ||
+                    !((oldest_live != 0 && /* Item flushd */
+                       oldest_live <= current_time &&
+                       tail->time <= oldest_live) ||
+                      (tail->exptime != 0 && /* and not expired */
+                       tail->exptime < current_time))) {
+                    break;
+                }
                 --search;
-                if (engine->items.tails[i]->refcount == 0) {
-                    do_item_unlink(engine, engine->items.tails[i]);
+                if (tail->refcount == 0) {
+                    do_item_unlink_lru_locked(engine, tail);
                 } else {
                     break;
                 }
             }
-            if (engine->items.tails[i] == nullptr) {
+            if (item_lru_tail(engine, i) == nullptr) {
                 /* We removed all of the items in this slab class */
                 continue;
             }
 
+            const auto* sizes = engine->items.sizes[i];
             add_statistics(c, add_stats, prefix, i, "number", "%u",
-                           engine->items.sizes[i]);
+                           sizes[int(LruSegment::Hot)] +
+                                   sizes[int(LruSegment::Warm)] +
+                                   sizes[int(LruSegment::Cold)]);
+            add_statistics(c, add_stats, prefix, i, "number_hot", "%u",
+                           sizes[int(LruSegment::Hot)]);
+            add_statistics(c, add_stats, prefix, i, "number_warm", "%u",
+                           sizes[int(LruSegment::Warm)]);
+            add_statistics(c, add_stats, prefix, i, "number_cold", "%u",
+                           sizes[int(LruSegment::Cold)]);
             add_statistics(c, add_stats, prefix, i, "age", "%u",
-                           engine->items.tails[i]->time);
+                           item_lru_tail(engine, i)->time.load());
             add_statistics(c, add_stats, prefix, i, "evicted",
                            "%u", engine->items.itemstats[i].evicted);
             add_statistics(c, add_stats, prefix, i, "evicted_nonzero",
@@ -474,17 +715,22 @@ static void do_item_stats_sizes(struct default_engine* engine,
 
         /* build the histogram */
         for (i = 0; i < POWER_LARGEST; i++) {
-            hash_item *iter = engine->items.heads[i];
-            while (iter) {
-                size_t ntotal = ITEM_ntotal(engine, iter);
-                size_t bucket = ntotal / 32;
-                if ((ntotal % 32) != 0) {
-                    bucket++;
-                }
-                if (bucket < num_buckets) {
-                    histogram[bucket]++;
+            std::lock_guard<std::mutex> guard(engine->items.lru_locks[i]);
+            for (auto* head : engine->items.heads[i]) {
+                for (hash_item* iter = head; iter; iter = iter->next) {
+                    if ((iter->iflag & ITEM_LINKED) == 0) {
+                        /* a cursor */
+                        continue;
+                    }
+                    size_t ntotal = ITEM_ntotal(engine, iter);
+                    size_t bucket = ntotal / 32;
+                    if ((ntotal % 32) != 0) {
+                        bucket++;
+                    }
+                    if (bucket < num_buckets) {
+                        histogram[bucket]++;
+                    }
                 }
-                iter = iter->next;
             }
         }
 
@@ -510,19 +756,18 @@ hash_item* do_item_get(struct default_engine* engine,
                        const hash_key* key,
                        const DocStateFilter documentStateFilter) {
     rel_time_t current_time = engine->server.core->get_current_time();
-    hash_item *it = assoc_find(crc32c(hash_key_get_key(key),
-                                      hash_key_get_key_len(key), 0),
-                               key);
-
-    if (it != nullptr && engine->config.oldest_live != 0 &&
-        engine->config.oldest_live <= current_time &&
-        it->time <= engine->config.oldest_live) {
-        do_item_unlink(engine, it);           /* MTSAFE - items.lock held */
+    rel_time_t oldest_live = engine->config.oldest_live;
+    hash_item *it = assoc_find(engine, item_hash(key), key);
+
+    if (it != nullptr && oldest_live != 0 &&
+        oldest_live <= current_time &&
+        it->time <= oldest_live) {
+        do_item_unlink(engine, it);           /* MTSAFE - item lock held */
         it = nullptr;
     }
 
     if (it != nullptr && it->exptime != 0 && it->exptime <= current_time) {
-        do_item_unlink(engine, it);           /* MTSAFE - items.lock held */
+        do_item_unlink(engine, it);           /* MTSAFE - item lock held */
         it = nullptr;
     }
 
@@ -549,7 +794,7 @@ hash_item* do_item_get(struct default_engine* engine,
 
 /*
  * Stores an item in the cache according to the semantics of one of the set
- * commands. In threaded mode, this is protected by the cache lock.
+ * commands. In threaded mode, this is protected by the item lock.
  *
  * Returns the state of storage.
  */
@@ -646,11 +891,8 @@ hash_item* item_alloc(struct default_engine* engine,
         return nullptr;
     }
 
-    {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
-        it = do_item_alloc(
-                engine, &hkey, flags, exptime, nbytes, cookie, datatype);
-    }
+    it = do_item_alloc(
+            engine, &hkey, flags, exptime, nbytes, cookie, datatype, false);
     hash_key_destroy(&hkey);
     return it;
 }
@@ -681,7 +923,7 @@ hash_item* item_get(struct default_engine* engine,
                     const void* cookie,
                     const hash_key& key,
                     const DocStateFilter state) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_lock(engine, &key));
     return do_item_get(engine, &key, state);
 }
 
@@ -690,7 +932,7 @@ hash_item* item_get(struct default_engine* engine,
  * needed.
  */
 void item_release(struct default_engine *engine, hash_item *item) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_lock(engine, item_get_key(item)));
     do_item_release(engine, item);
 }
 
@@ -698,13 +940,13 @@ void item_release(struct default_engine *engine, hash_item *item) {
  * Unlinks an item from the LRU and hashtable.
  */
 void item_unlink(struct default_engine *engine, hash_item *item) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_lock(engine, item_get_key(item)));
     do_item_unlink(engine, item);
 }
 
 ENGINE_ERROR_CODE safe_item_unlink(struct default_engine *engine,
                                    hash_item *it) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_lock(engine, item_get_key(it)));
     return do_safe_item_unlink(engine, it);
 }
 
@@ -725,7 +967,7 @@ ENGINE_ERROR_CODE store_item(struct default_engine* engine,
         item->iflag |= ITEM_ZOMBIE;
     }
 
-    std::lock_guard<std::mutex> guard(engine->items.lock);
+    std::lock_guard<std::mutex> guard(item_lock(engine, item_get_key(item)));
     ret = do_store_item(
             engine, item, operation, cookie, &stored_item, preserveTtl);
     if (ret == ENGINE_SUCCESS) {
@@ -751,6 +993,12 @@ ENGINE_ERROR_CODE do_item_get_locked(struct default_engine* engine,
         return ENGINE_LOCKED;
     }
 
+    if ((item->iflag & ITEM_EXTSTORE) != 0) {
+        do_item_ext_read(engine, cookie, item);
+        do_item_release(engine, item);
+        return ENGINE_EWOULDBLOCK;
+    }
+
     /*
      * Unfortunately I have to create an extra copy of the item to return
      * back to the caller, as I need a way to know if I should mask out
@@ -777,7 +1025,7 @@ ENGINE_ERROR_CODE do_item_get_locked(struct default_engine* engine,
         // Unfortunately I can't return the actual object as that'll cause
         // the item's cas to be masked out ;-)
         auto* clone = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                    item->nbytes, cookie, item->datatype);
+                                    item->nbytes, cookie, item->datatype, true);
         if (clone == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
@@ -798,14 +1046,14 @@ ENGINE_ERROR_CODE do_item_get_locked(struct default_engine* engine,
         // Multiple entities holds a reference to the object. We
         // need to do a copy/replace.
         auto* clone1 = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                     item->nbytes, cookie, item->datatype);
+                                     item->nbytes, cookie, item->datatype, true);
         if (clone1 == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
         }
 
         auto* clone2 = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                     item->nbytes, cookie, item->datatype);
+                                     item->nbytes, cookie, item->datatype, true);
         if (clone2 == nullptr) {
             do_item_release(engine, item);
             do_item_release(engine, clone1);
@@ -843,7 +1091,7 @@ ENGINE_ERROR_CODE item_get_locked(struct default_engine* engine,
 
     ENGINE_ERROR_CODE ret;
     {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
+        std::lock_guard<std::mutex> guard(item_lock(engine, &hkey));
         ret = do_item_get_locked(engine, cookie, it, &hkey, locktime);
     }
     hash_key_destroy(&hkey);
@@ -875,15 +1123,16 @@ static ENGINE_ERROR_CODE do_item_unlock(struct default_engine* engine,
         return ret;
     }
 
-    if (item->refcount == 1) {
-        // I'm the only one with a reference to the object..
+    if (item->refcount == 1 || (item->iflag & ITEM_EXTSTORE) != 0) {
+        // I'm the only one with a reference to the object (or it is
+        // the header of a value in the flash tier, which is never locked)..
         // Just do an in-place release of the object
         item->locktime = 0;
         do_item_release(engine, item);
     } else {
         // Someone else holds a reference to the object.
         auto* clone = do_item_alloc(engine, hkey, item->flags, item->exptime,
-                                    item->nbytes, cookie, item->datatype);
+                                    item->nbytes, cookie, item->datatype, true);
         if (clone == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
@@ -912,7 +1161,7 @@ ENGINE_ERROR_CODE item_unlock(struct default_engine* engine,
 
     ENGINE_ERROR_CODE ret;
     {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
+        std::lock_guard<std::mutex> guard(item_lock(engine, &hkey));
         ret = do_item_unlock(engine, cookie, &hkey, cas);
     }
     hash_key_destroy(&hkey);
@@ -936,6 +1185,12 @@ ENGINE_ERROR_CODE do_item_get_and_touch(struct default_engine* engine,
         return ENGINE_LOCKED;
     }
 
+    if ((item->iflag & ITEM_EXTSTORE) != 0) {
+        do_item_ext_read(engine, cookie, item);
+        do_item_release(engine, item);
+        return ENGINE_EWOULDBLOCK;
+    }
+
     /*
      * If I'm the only one accessing the object (refcount == 1) I can update
      * the in-memory object. Otherwise I need to swap it out with a new one
@@ -958,7 +1213,7 @@ ENGINE_ERROR_CODE do_item_get_and_touch(struct default_engine* engine,
         // Multiple entities holds a reference to the object. We
         // need to do a copy/replace.
         auto* clone = do_item_alloc(engine, hkey, item->flags, exptime,
-                                    item->nbytes, cookie, item->datatype);
+                                    item->nbytes, cookie, item->datatype, true);
         if (clone == nullptr) {
             do_item_release(engine, item);
             return ENGINE_TMPFAIL;
@@ -989,7 +1244,7 @@ ENGINE_ERROR_CODE item_get_and_touch(struct default_engine* engine,
 
     ENGINE_ERROR_CODE ret;
     {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
+        std::lock_guard<std::mutex> guard(item_lock(engine, &hkey));
         ret = do_item_get_and_touch(engine, cookie, it, &hkey, exptime);
     }
     hash_key_destroy(&hkey);
@@ -1001,31 +1256,34 @@ ENGINE_ERROR_CODE item_get_and_touch(struct default_engine* engine,
  * Flushes expired items after a flush_all call
  */
 void item_flush_expired(struct default_engine *engine) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
-
     rel_time_t now = engine->server.core->get_current_time();
     if (now > engine->config.oldest_live) {
         engine->config.oldest_live = now - 1;
     }
+    const rel_time_t oldest_live = engine->config.oldest_live;
 
-    for (auto& head : engine->items.heads) {
-        hash_item *iter, *next;
+    for (int ii = 0; ii < POWER_LARGEST; ++ii) {
+        std::lock_guard<std::mutex> guard(engine->items.lru_locks[ii]);
         /*
-         * The LRU is sorted in decreasing time order, and an item's
-         * timestamp is never newer than its last access time, so we
-         * only need to walk back until we hit an item older than the
-         * oldest_live time.
-         * The oldest_live checking will auto-expire the remaining items.
+         * The items accessed in the hot and warm segments are only flagged
+         * (and get a new timestamp) without being moved, and are moved to
+         * the head of the next segment when they reach the tail of theirs,
+         * so the segments aren't sorted by time and we have to look at all
+         * of the items.
+         * The oldest_live checking will auto-expire the remaining items
+         * (including the ones we fail to lock as they're being used).
          */
-        for (iter = head; iter != nullptr; iter = next) {
-            if (iter->time >= engine->config.oldest_live) {
+        for (auto* head : engine->items.heads[ii]) {
+            hash_item *iter, *next;
+            for (iter = head; iter != nullptr; iter = next) {
                 next = iter->next;
-                if ((iter->iflag & ITEM_SLABBED) == 0) {
-                    do_item_unlink(engine, iter);
+                if (iter->time >= oldest_live &&
+                    (iter->iflag & ITEM_LINKED) != 0) {
+                    ItemTryLock lock(engine, iter, nullptr);
+                    if (lock) {
+                        do_item_unlink_lru_locked(engine, iter);
+                    }
                 }
-            } else {
-                /* We've hit the first old item. Continue to the next queue. */
-                break;
             }
         }
     }
@@ -1034,31 +1292,38 @@ void item_flush_expired(struct default_engine *engine) {
 void item_stats(struct default_engine* engine,
                 const AddStatFn& add_stat,
                 const void* cookie) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
     do_item_stats(engine, add_stat, cookie);
 }
 
 void item_stats_sizes(struct default_engine* engine,
                       const AddStatFn& add_stat,
                       const void* cookie) {
-    std::lock_guard<std::mutex> guard(engine->items.lock);
     do_item_stats_sizes(engine, add_stat, cookie);
 }
 
 static void do_item_link_cursor(struct default_engine *engine,
-                                hash_item *cursor, int ii)
+                                hash_item *cursor, int ii,
+                                LruSegment segment)
 {
+    auto& tail = engine->items.tails[ii][int(segment)];
     cursor->slabs_clsid = (uint8_t)ii;
+    cursor->lru = segment;
     cursor->next = nullptr;
-    cursor->prev = engine->items.tails[ii];
-    engine->items.tails[ii]->next = cursor;
-    engine->items.tails[ii] = cursor;
-    engine->items.sizes[ii]++;
+    cursor->prev = tail;
+    tail->next = cursor;
+    tail = cursor;
+    engine->items.sizes[ii][int(segment)]++;
 }
 
 typedef ENGINE_ERROR_CODE (*ITERFUNC)(struct default_engine *engine,
                                       hash_item *item, void *cookie);
 
+/*
+ * Move the cursor towards the head of its LRU segment, calling itemfunc for
+ * (up to steplength of) the items it passes. Returns false (with the cursor
+ * unlinked) when it reached the head or itemfunc failed.
+ * The LRU lock for the slab class of the cursor is assumed to be held.
+ */
 static bool do_item_walk_cursor(struct default_engine *engine,
                                 hash_item *cursor,
                                 int steplength,
@@ -1069,15 +1334,22 @@ static bool do_item_walk_cursor(struct default_engine *engine,
     int ii = 0;
     *error = ENGINE_SUCCESS;
 
-    while (cursor->prev != nullptr && ii < steplength) {
+    while (ii < steplength) {
         /* Move cursor */
         hash_item *ptr = cursor->prev;
         bool done = false;
 
+        if (ptr == nullptr) {
+            /* the items in front of the cursor were unlinked */
+            item_unlink_q(engine, cursor);
+            return false;
+        }
+
         ++ii;
         item_unlink_q(engine, cursor);
 
-        if (ptr == engine->items.heads[cursor->slabs_clsid]) {
+        if (ptr == engine->items.heads[cursor->slabs_clsid]
+                                      [int(cursor->lru.load())]) {
             done = true;
             cursor->prev = nullptr;
         } else {
@@ -1087,12 +1359,15 @@ static bool do_item_walk_cursor(struct default_engine *engine,
             ptr->prev = cursor;
         }
 
-        /* Ignore cursors */
-        if (item_get_key(ptr)->header.len == 0 && ptr->nbytes == 0) {
+        /* Ignore cursors (the items in the LRU are always linked) */
+        if ((ptr->iflag & ITEM_LINKED) == 0) {
             --ii;
         } else {
             *error = itemfunc(engine, ptr, itemdata);
             if (*error != ENGINE_SUCCESS) {
+                if (!done) {
+                    item_unlink_q(engine, cursor);
+                }
                 return false;
             }
         }
@@ -1102,7 +1377,7 @@ static bool do_item_walk_cursor(struct default_engine *engine,
         }
     }
 
-    return (cursor->prev != nullptr);
+    return true;
 }
 
 static ENGINE_ERROR_CODE item_scrub(struct default_engine *engine,
@@ -1113,8 +1388,15 @@ static ENGINE_ERROR_CODE item_scrub(struct default_engine *engine,
     engine->scrubber.visited++;
     /*
         scrubber is used for generic bucket deletion and scrub_cmd
-        all expired or orphaned items are unlinked
+        all expired or orphaned items are unlinked. Items which are being
+        operated on are skipped (that doesn't happen during bucket deletion
+        as there are no connections to the bucket left).
     */
+    ItemTryLock lock(engine, item, nullptr);
+    if (!lock) {
+        return ENGINE_SUCCESS;
+    }
+
     if (engine->scrubber.force_delete && item->refcount > 0) {
         // warn that someone isn't releasing items before deleting their bucket.
         LOG_WARNING("Bucket ({}) deletion is removing an item with refcount {}",
@@ -1124,48 +1406,69 @@ static ENGINE_ERROR_CODE item_scrub(struct default_engine *engine,
 
     if (engine->scrubber.force_delete || (item->refcount == 0 &&
        (item->exptime != 0 && item->exptime < current_time))) {
-        do_item_unlink(engine, item);
+        do_item_unlink_lru_locked(engine, item);
         engine->scrubber.cleaned++;
     }
     return ENGINE_SUCCESS;
 }
 
-static void item_scrub_class(struct default_engine *engine,
-                             hash_item *cursor) {
+static void item_walk_lru(struct default_engine *engine,
+                          hash_item *cursor,
+                          ITERFUNC itemfunc,
+                          void *itemdata,
+                          int steplength) {
 
     ENGINE_ERROR_CODE ret;
     bool more;
     do {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
-        more = do_item_walk_cursor(engine, cursor, 200, item_scrub, nullptr, &ret);
-        if (ret != ENGINE_SUCCESS) {
-            break;
-        }
+        std::lock_guard<std::mutex> guard(
+                engine->items.lru_locks[cursor->slabs_clsid]);
+        more = do_item_walk_cursor(engine, cursor, steplength, itemfunc, itemdata, &ret);
     } while (more);
 }
 
-void item_scrubber_main(struct default_engine *engine)
-{
+/*
+ * Call itemfunc for all of the items in the LRU of a slab class, releasing
+ * the LRU lock after each steplength items.
+ */
+static void item_walk_class(struct default_engine *engine,
+                            int ii,
+                            ITERFUNC itemfunc,
+                            void *itemdata,
+                            int steplength) {
     hash_item cursor;
-    int ii;
 
     cursor.refcount = 1;
-    for (ii = 0; ii < POWER_LARGEST; ++ii) {
+    for (int segment = 0; segment < lru_segment_count; ++segment) {
         bool skip = false;
         {
-            std::lock_guard<std::mutex> guard(engine->items.lock);
-            if (engine->items.heads[ii] == nullptr) {
+            std::lock_guard<std::mutex> guard(engine->items.lru_locks[ii]);
+            if (engine->items.heads[ii][segment] == nullptr) {
                 skip = true;
             } else {
                 /* add the item at the tail */
-                do_item_link_cursor(engine, &cursor, ii);
+                do_item_link_cursor(engine, &cursor, ii, LruSegment(segment));
             }
         }
 
         if (!skip) {
-            item_scrub_class(engine, &cursor);
+            item_walk_lru(engine, &cursor, itemfunc, itemdata, steplength);
         }
     }
+}
+
+/* Call itemfunc for all of the items in all of the LRUs */
+static void item_walk_lrus(struct default_engine *engine,
+                           ITERFUNC itemfunc,
+                           int steplength) {
+    for (int ii = 0; ii < POWER_LARGEST; ++ii) {
+        item_walk_class(engine, ii, itemfunc, nullptr, steplength);
+    }
+}
+
+void item_scrubber_main(struct default_engine *engine)
+{
+    item_walk_lrus(engine, item_scrub, 200);
 
     std::lock_guard<std::mutex> guard(engine->scrubber.lock);
     engine->scrubber.stopped = time(nullptr);
@@ -1190,6 +1493,227 @@ bool item_start_scrub(struct default_engine *engine)
     return false;
 }
 
+/*
+ * The number of items the crawler looks at before releasing the LRU lock
+ * (it runs in the background, so it shouldn't hold up the front end
+ * threads operating on the same slab class for long).
+ */
+static const int crawler_step_length = 100;
+
+static ENGINE_ERROR_CODE item_crawl(struct default_engine *engine,
+                                    hash_item *item,
+                                    void *cookie) {
+    (void)cookie;
+    rel_time_t current_time = engine->server.core->get_current_time();
+    rel_time_t oldest_live = engine->config.oldest_live;
+
+    ItemTryLock lock(engine, item, nullptr);
+    if (lock && item->refcount == 0 &&
+        ((oldest_live != 0 && oldest_live <= current_time &&
+          item->time <= oldest_live) || /* dead by flush */
+         (item->exptime != 0 && item->exptime < current_time)) &&
+        (item->locktime <= current_time)) {
+        engine->stats.reclaimed++;
+        engine->stats.crawler_reclaimed++;
+        engine->items.itemstats[item->slabs_clsid].reclaimed++;
+        do_item_unlink_lru_locked(engine, item);
+    }
+    return ENGINE_SUCCESS;
+}
+
+void item_crawler_main(struct default_engine *engine)
+{
+    item_walk_lrus(engine, item_crawl, crawler_step_length);
+}
+
+/* The memory of a slab being moved to another slab class */
+struct SlabRange {
+    const char* begin;
+    const char* end;
+};
+
+static ENGINE_ERROR_CODE item_evict_from_slab(struct default_engine *engine,
+                                              hash_item *item,
+                                              void *cookie) {
+    const auto* range = reinterpret_cast<const SlabRange*>(cookie);
+    const auto* ptr = reinterpret_cast<const char*>(item);
+    if (ptr < range->begin || ptr >= range->end) {
+        return ENGINE_SUCCESS;
+    }
+
+    ItemTryLock lock(engine, item, nullptr);
+    if (lock) {
+        /* The memory is released once the item isn't referenced */
+        slabs_count_reassign_eviction(engine, item->slabs_clsid);
+        do_item_unlink_lru_locked(engine, item);
+    }
+    return ENGINE_SUCCESS;
+}
+
+void item_evict_slab(struct default_engine *engine,
+                     unsigned int id,
+                     const void *begin,
+                     const void *end) {
+    SlabRange range{reinterpret_cast<const char*>(begin),
+                    reinterpret_cast<const char*>(end)};
+    item_walk_class(engine, id, item_evict_from_slab, &range,
+                    crawler_step_length);
+}
+
+/*
+ * The number of items at the tail of the cold segment of each slab class
+ * looked at each time item_ext_main runs.
+ */
+static const int ext_search_items = 500;
+
+/*
+ * Move the value of an item to the flash tier, replacing the item with a
+ * header item (in the cold segment, keeping the access time of the item).
+ * The item lock is held.
+ */
+static bool do_item_ext_write(struct default_engine *engine, hash_item *it) {
+    ExtStore::Location location;
+    if (!engine->ext->write(it->cas,
+                            {item_get_data(it), it->nbytes},
+                            location)) {
+        return false;
+    }
+
+    auto* header = do_item_alloc(engine, item_get_key(it), it->flags,
+                                 it->exptime, sizeof(location), nullptr,
+                                 it->datatype, true);
+    if (header == nullptr) {
+        /* The value written is just never read back */
+        return false;
+    }
+    std::memcpy(item_get_data(header), &location, sizeof(location));
+    header->iflag |= ITEM_EXTSTORE;
+    do_item_swap(engine, it, header, LruSegment::Cold, it->time);
+    do_item_release(engine, header);
+    return true;
+}
+
+void item_ext_main(struct default_engine *engine) {
+    if (!engine->ext || !slabs_full(engine)) {
+        return;
+    }
+
+    const rel_time_t current_time = engine->server.core->get_current_time();
+    std::vector<hash_item*> candidates;
+    bool writable = true;
+    for (unsigned int id = POWER_SMALLEST; id < POWER_LARGEST && writable;
+         ++id) {
+        {
+            std::lock_guard<std::mutex> guard(engine->items.lru_locks[id]);
+            int tries = ext_search_items;
+            for (auto* search = engine->items.tails[id][int(LruSegment::Cold)];
+                 tries > 0 && search != nullptr;
+                 tries--, search = search->prev) {
+                /* skip the cursors, the headers and the deleted items */
+                if ((search->iflag & (ITEM_LINKED | ITEM_EXTSTORE |
+                                      ITEM_ZOMBIE)) != ITEM_LINKED ||
+                    search->nbytes < engine->config.ext_item_size ||
+                    search->nbytes > ExtStore::getMaxValueSize()) {
+                    continue;
+                }
+                ItemTryLock lock(engine, search, nullptr);
+                if (lock && search->refcount == 0 &&
+                    search->locktime <= current_time &&
+                    (search->exptime == 0 || search->exptime > current_time)) {
+                    /* Hold a reference while the LRU lock isn't held */
+                    search->refcount++;
+                    candidates.push_back(search);
+                }
+            }
+        }
+
+        for (auto* it : candidates) {
+            std::lock_guard<std::mutex> guard(
+                    item_lock(engine, item_get_key(it)));
+            if (writable && (it->iflag & ITEM_LINKED) != 0 &&
+                it->refcount == 1 && it->locktime <= current_time) {
+                writable = do_item_ext_write(engine, it);
+            }
+            do_item_release(engine, it);
+        }
+        candidates.clear();
+    }
+}
+
+/*
+ * Replace the header item of a value read back from the flash tier with
+ * the item (unless it changed in the meantime), and let the connection
+ * waiting for it retry the operation.
+ */
+static void item_ext_restore(struct default_engine *engine,
+                             const void *cookie,
+                             const hash_key *hkey,
+                             uint64_t cas,
+                             bool found,
+                             std::string_view value) {
+    auto status = ENGINE_SUCCESS;
+    {
+        std::lock_guard<std::mutex> guard(item_lock(engine, hkey));
+        auto* header =
+                do_item_get(engine, hkey, DocStateFilter::AliveOrDeleted);
+        if (header != nullptr && (header->iflag & ITEM_EXTSTORE) != 0 &&
+            header->cas == cas) {
+            if (!found) {
+                /* Overwritten in the file: the item is evicted */
+                engine->stats.evictions++;
+                do_item_unlink(engine, header);
+            } else {
+                auto* it = do_item_alloc(engine, hkey, header->flags,
+                                         header->exptime, int(value.size()),
+                                         cookie, header->datatype, true);
+                if (it == nullptr) {
+                    status = ENGINE_TMPFAIL;
+                } else {
+                    std::memcpy(item_get_data(it), value.data(), value.size());
+                    do_item_swap(engine, header, it, LruSegment::Warm,
+                                 engine->server.core->get_current_time());
+                    do_item_release(engine, it);
+                }
+            }
+        }
+        if (header != nullptr) {
+            do_item_release(engine, header);
+        }
+    }
+    engine->server.cookie->notify_io_complete(cookie, status);
+}
+
+static void do_item_ext_read(struct default_engine *engine,
+                             const void *cookie,
+                             const hash_item *it) {
+    ExtStore::Location location;
+    std::memcpy(&location, item_get_data(it), sizeof(location));
+
+    const hash_key* key = item_get_key(it);
+    const auto* begin = hash_key_get_key(key);
+    std::vector<uint8_t> keydata(begin, begin + hash_key_get_key_len(key));
+
+    engine->ext->read(
+            location,
+            it->cas,
+            [engine, cookie, cas = it->cas, keydata = std::move(keydata)](
+                    bool found, std::string_view value) mutable {
+                hash_key hkey;
+                hash_key_set_len(&hkey, gsl::narrow<uint16_t>(keydata.size()));
+                hkey.header.full_key =
+                        reinterpret_cast<hash_key_data*>(keydata.data());
+                item_ext_restore(engine, cookie, &hkey, cas, found, value);
+            });
+}
+
+void item_ext_read(struct default_engine *engine,
+                   const void *cookie,
+                   hash_item *it) {
+    std::lock_guard<std::mutex> guard(item_lock(engine, item_get_key(it)));
+    do_item_ext_read(engine, cookie, it);
+    do_item_release(engine, it);
+}
+
 static bool hash_key_create(hash_key* hkey,
                             const DocKey& key,
                             struct default_engine* engine) {
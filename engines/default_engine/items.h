@@ -4,10 +4,20 @@
 #include "slabs.h"
 
 #include <gsl/gsl-lite.h>
+#include <array>
 #include <atomic>
 #include <cstddef>
 #include <cstring>
 
+/*
+ * The LRU of a slab class is split in segments: new items are linked in the
+ * hot segment, and move to the warm segment if they're accessed again before
+ * they reach the tail of the hot segment (or to the cold segment otherwise).
+ * Items are evicted from the tail of the cold segment.
+ */
+enum class LruSegment : uint8_t { Hot, Warm, Cold };
+static const int lru_segment_count = 3;
+
 /*
  * You should not try to acquire any of the item locks before calling these
  * functions.
@@ -25,7 +35,7 @@ using hash_item = struct _hash_item {
     uint64_t cas{0};
 
     /** least recent access */
-    rel_time_t time{0};
+    std::atomic<rel_time_t> time{0};
 
     /** When the item will expire (relative to process startup) */
     rel_time_t exptime{0};
@@ -60,7 +70,10 @@ using hash_item = struct _hash_item {
     /** to identify the type of the data */
     uint8_t datatype{0};
 
-    // There is 3 spare bytes due to alignment
+    /** the segment of the LRU we're in (only changed with the LRU locked) */
+    std::atomic<LruSegment> lru{LruSegment::Hot};
+
+    // There is 2 spare bytes due to alignment
 };
 
 /*
@@ -147,15 +160,26 @@ typedef struct {
     unsigned int reclaimed;
 } itemstats_t;
 
+/* The number of locks protecting the items (see items::item_locks) */
+static const size_t item_lock_count = 1024;
+
 struct items {
-   hash_item *heads[POWER_LARGEST];
-   hash_item *tails[POWER_LARGEST];
+   hash_item *heads[POWER_LARGEST][lru_segment_count];
+   hash_item *tails[POWER_LARGEST][lru_segment_count];
    itemstats_t itemstats[POWER_LARGEST];
-   unsigned int sizes[POWER_LARGEST];
+   unsigned int sizes[POWER_LARGEST][lru_segment_count];
+   /*
+    * serialise access to the items with the same hash (their refcount,
+    * metadata and presence in the hash table). An operation on a key holds
+    * the lock for the key, and may then acquire the lru_lock for a slab
+    * class (but only try to acquire an item lock while holding an LRU lock).
+    */
+   std::array<std::mutex, item_lock_count> item_locks;
    /*
-    * serialise access to the items data
-   */
-   std::mutex lock;
+    * serialise access to the LRU of each slab class (heads, tails, sizes and
+    * itemstats, and the next, prev and lru segment of the items in it)
+    */
+   std::array<std::mutex, POWER_LARGEST> lru_locks;
 };
 
 /**
@@ -338,6 +362,49 @@ ENGINE_ERROR_CODE store_item(struct default_engine* engine,
  */
 void item_scrubber_main(struct default_engine *engine);
 
+/**
+ * Walk all of the LRUs of the engine (a batch of items at a time, to keep
+ * the LRU locks held for a short time) and reclaim the expired items.
+ * @param engine handle to the storage engine
+ */
+void item_crawler_main(struct default_engine *engine);
+
+/**
+ * Unlink the items of a slab class stored in the given memory (a slab being
+ * moved to another slab class). The items which are locked are skipped, so
+ * this has to be called again until all of the memory of the slab is free.
+ * @param engine handle to the storage engine
+ * @param id the slab class
+ * @param begin the start of the memory of the slab
+ * @param end the end of the memory of the slab
+ */
+void item_evict_slab(struct default_engine *engine,
+                     unsigned int id,
+                     const void *begin,
+                     const void *end);
+
+/**
+ * Move the values of the items at the tail of the cold segments of the LRUs
+ * to the flash tier (if enabled) when all of the memory is in use, leaving
+ * header items in their place. To be called periodically by the scrubber
+ * task.
+ * @param engine handle to the storage engine
+ */
+void item_ext_main(struct default_engine *engine);
+
+/**
+ * Read the value of a header item back from the flash tier (the header is
+ * replaced with the item once read). The reference to the header is
+ * released, and the cookie notified once done (the operation should then
+ * be retried).
+ * @param engine handle to the storage engine
+ * @param cookie the cookie waiting for the value
+ * @param it the header item
+ */
+void item_ext_read(struct default_engine *engine,
+                   const void *cookie,
+                   hash_item *it);
+
 /**
  * Start the item scrubber for the engine
  * @param engine handle to the storage engine
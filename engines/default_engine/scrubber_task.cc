@@ -19,6 +19,8 @@
 #include "default_engine_internal.h"
 #include "engine_manager.h"
 
+#include <chrono>
+
 static void scrubber_task_main(void* arg) {
     auto* task = reinterpret_cast<ScrubberTask*>(arg);
     task->run();
@@ -72,7 +74,16 @@ void ScrubberTask::run() {
             lck.lock();
         } else {
             state = State::Idle;
-            cvar.wait(lck);
+            // Wake up once in a while to run the LRU crawler and the slab
+            // automover of the engines
+            if (cvar.wait_for(lck, std::chrono::seconds(1)) ==
+                        std::cv_status::timeout &&
+                !shuttingdown && workQueue.empty()) {
+                state = State::Crawling;
+                lck.unlock();
+                engineManager.maintainEngines();
+                lck.lock();
+            }
         }
     }
     state = State::Stopped;
@@ -28,10 +28,15 @@ class EngineManager;
  * The scrubber task is charged with
  *   1. removing items from memory
  *   2. deleting engine structs
+ *   3. running the LRU crawler (reclaiming expired items) and the slab
+ *      automover of the engines when it is idle
  *
  * The common use-case is for bucket deletion performing tasks 1 and 2.
  * The start_scrub command only performs 1.
  *
+ * Running those on the same thread means that an engine can't be deleted
+ * while they work on it.
+ *
  * Global destruction can safely join the task and allow the engine to
  * safely unload the shared object.
  */
@@ -77,6 +82,9 @@ private:
         Idle,
         /// The scrubber is currently scrubbing a list
         Scrubbing,
+        /// The scrubber is currently running the LRU crawler (or the slab
+        /// automover)
+        Crawling,
         /// The scrubber task is stopped (returning from main)
         Stopped
     };
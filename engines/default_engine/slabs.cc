@@ -24,6 +24,8 @@
 
 #include "default_engine_internal.h"
 
+#include <memcached/server_core_iface.h>
+
 /*
  * Forward Declarations
  */
@@ -176,24 +178,33 @@ static int grow_slab_list (struct default_engine *engine, const unsigned int id)
     return 1;
 }
 
+/* the lock for the slab class is assumed to be held by the caller */
 static int do_slabs_newslab(struct default_engine *engine, const unsigned int id) {
     slabclass_t *p = &engine->slabs.slabclass[id];
-    int len = p->size * p->perslab;
+    /* All of the slabs have the same size (rather than p->size * p->perslab)
+       so that they may be moved to another slab class */
+    size_t len = engine->config.item_size_max;
     char *ptr;
 
-    if ((engine->slabs.mem_limit && engine->slabs.mem_malloced + len > engine->slabs.mem_limit && p->slabs > 0) ||
-        (grow_slab_list(engine, id) == 0) ||
-        ((ptr = static_cast<char*>(memory_allocate(engine, (size_t)len))) == nullptr)) {
-
+    if (grow_slab_list(engine, id) == 0) {
         return 0;
     }
 
-    memset(ptr, 0, (size_t)len);
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        if ((engine->slabs.mem_limit && engine->slabs.mem_malloced + len > engine->slabs.mem_limit && p->slabs > 0) ||
+            ((ptr = static_cast<char*>(memory_allocate(engine, len))) == nullptr)) {
+
+            return 0;
+        }
+        engine->slabs.mem_malloced += len;
+    }
+
+    memset(ptr, 0, len);
     p->end_page_ptr = ptr;
     p->end_page_free = p->perslab;
 
     p->slab_list[p->slabs++] = ptr;
-    engine->slabs.mem_malloced += len;
 
     return 1;
 }
@@ -210,11 +221,14 @@ static void *do_slabs_alloc(struct default_engine *engine, const size_t size, un
     p = &engine->slabs.slabclass[id];
 
 #ifdef USE_SYSTEM_MALLOC
-    if (engine->slabs.mem_limit && engine->slabs.mem_malloced + size > engine->slabs.mem_limit) {
-        MEMCACHED_SLABS_ALLOCATE_FAILED(size, id);
-        return 0;
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        if (engine->slabs.mem_limit && engine->slabs.mem_malloced + size > engine->slabs.mem_limit) {
+            MEMCACHED_SLABS_ALLOCATE_FAILED(size, id);
+            return 0;
+        }
+        engine->slabs.mem_malloced += size;
     }
-    engine->slabs.mem_malloced += size;
     ret = cb_calloc(1, size);
     MEMCACHED_SLABS_ALLOCATE(size, id, 0, ret);
     return ret;
@@ -247,6 +261,19 @@ static void *do_slabs_alloc(struct default_engine *engine, const size_t size, un
     return ret;
 }
 
+/*
+ * Is the chunk in the slab being moved out of the slab class? (the lock for
+ * the slab class is assumed to be held by the caller)
+ */
+static bool do_slabs_in_killing(const slabclass_t *p, const void *ptr) {
+    if (p->killing == 0) {
+        return false;
+    }
+    const auto* begin = static_cast<const char*>(p->slab_list[p->killing - 1]);
+    const auto* chunk = static_cast<const char*>(ptr);
+    return chunk >= begin && chunk < begin + size_t(p->size) * p->perslab;
+}
+
 static void do_slabs_free(struct default_engine *engine, void *ptr, const size_t size, unsigned int id) {
     slabclass_t *p;
 
@@ -256,11 +283,21 @@ static void do_slabs_free(struct default_engine *engine, void *ptr, const size_t
     p = &engine->slabs.slabclass[id];
 
 #ifdef USE_SYSTEM_MALLOC
-    engine->slabs.mem_malloced -= size;
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        engine->slabs.mem_malloced -= size;
+    }
     cb_free(ptr);
     return;
 #endif
 
+    if (do_slabs_in_killing(p, ptr)) {
+        /* Don't reuse it, the slab is moved once all of its chunks are free */
+        p->killing_free++;
+        p->requested -= size;
+        return;
+    }
+
     if (p->sl_curr == p->sl_total) { /* need more space on the free list */
         int new_size = (p->sl_total != 0) ? p->sl_total * 2 : 16;  /* 16 is arbitrary */
         void **new_slots = static_cast<void**>(cb_realloc(p->slots,
@@ -332,6 +369,13 @@ static void do_slabs_stats(struct default_engine* engine,
     unsigned int total = 0;
 
     for(i = POWER_SMALLEST; i <= engine->slabs.power_largest; i++) {
+        /* The LRU lock can't be acquired while holding the class lock */
+        unsigned int evicted;
+        {
+            std::lock_guard<std::mutex> guard(engine->items.lru_locks[i]);
+            evicted = engine->items.itemstats[i].evicted;
+        }
+        std::lock_guard<std::mutex> guard(engine->slabs.class_locks[i]);
         slabclass_t *p = &engine->slabs.slabclass[i];
         if (p->slabs != 0) {
             uint32_t perslab, slabs;
@@ -355,17 +399,33 @@ static void do_slabs_stats(struct default_engine* engine,
             add_statistics(cookie, add_stats, nullptr, i, "mem_requested",
                            "%" PRIu64,
                            (uint64_t)p->requested);
+            add_statistics(cookie, add_stats, nullptr, i, "evicted", "%u",
+                           evicted);
+            add_statistics(cookie, add_stats, nullptr, i, "pages_moved_in",
+                           "%u", p->pages_moved_in);
+            add_statistics(cookie, add_stats, nullptr, i, "pages_moved_out",
+                           "%u", p->pages_moved_out);
+            add_statistics(cookie, add_stats, nullptr, i, "reassign_evicted",
+                           "%u", p->reassign_evicted);
             total++;
         }
     }
 
     /* add overall slab stats and append terminator */
 
+    uint64_t mem_malloced;
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.lock);
+        mem_malloced = engine->slabs.mem_malloced;
+    }
     add_statistics(cookie, add_stats, nullptr, -1, "active_slabs", "%d", total);
     add_statistics(cookie, add_stats, nullptr, -1, "total_malloced", "%" PRIu64,
-                   (uint64_t)engine->slabs.mem_malloced);
+                   mem_malloced);
+    add_statistics(cookie, add_stats, nullptr, -1, "slabs_moved", "%" PRIu64,
+                   engine->slabs.slabs_moved.load());
 }
 
+/* engine->slabs.lock is assumed to be held by the caller */
 static void *memory_allocate(struct default_engine *engine, size_t size) {
     void *ret;
 
@@ -396,32 +456,51 @@ static void *memory_allocate(struct default_engine *engine, size_t size) {
 }
 
 void *slabs_alloc(struct default_engine *engine, size_t size, unsigned int id) {
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
+    if (id < POWER_SMALLEST || id > engine->slabs.power_largest) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[id]);
     return do_slabs_alloc(engine, size, id);
 }
 
 void slabs_free(struct default_engine *engine, void *ptr, size_t size, unsigned int id) {
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
+    if (id < POWER_SMALLEST || id > engine->slabs.power_largest) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[id]);
     do_slabs_free(engine, ptr, size, id);
 }
 
 void slabs_stats(struct default_engine* engine,
                  const AddStatFn& add_stats,
                  const void* c) {
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
     do_slabs_stats(engine, add_stats, c);
 }
 
+void slabs_count_reassign_eviction(struct default_engine *engine, unsigned int id)
+{
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[id]);
+    engine->slabs.slabclass[id].reassign_evicted++;
+}
+
+bool slabs_full(struct default_engine *engine)
+{
+    std::lock_guard<std::mutex> guard(engine->slabs.lock);
+    return engine->slabs.mem_limit != 0 &&
+           engine->slabs.mem_malloced + engine->config.item_size_max >
+                   engine->slabs.mem_limit;
+}
+
 void slabs_adjust_mem_requested(struct default_engine *engine, unsigned int id, size_t old, size_t ntotal)
 {
     slabclass_t *p;
-    std::lock_guard<std::mutex> guard(engine->slabs.lock);
     if (id < POWER_SMALLEST || id > engine->slabs.power_largest) {
         throw std::invalid_argument(
                 "slabs_adjust_mem_requested: Internal error! Invalid slab "
                 "class");
     }
 
+    std::lock_guard<std::mutex> guard(engine->slabs.class_locks[id]);
     p = &engine->slabs.slabclass[id];
     p->requested = p->requested - old + ntotal;
 }
@@ -444,3 +523,213 @@ void slabs_destroy(struct default_engine *e)
         cb_free(p->slab_list);
     }
 }
+
+#ifndef USE_SYSTEM_MALLOC
+/*
+ * The automover looks at the evictions in each slab class over windows of
+ * this many seconds, and moves a slab when a slab class evicted the most
+ * items (and another didn't evict any) for this many windows in a row.
+ */
+static const rel_time_t slab_automove_window = 10;
+static const unsigned int slab_automove_windows = 3;
+
+/*
+ * Start moving the first slab out of the slab class: take its free chunks
+ * off the freelist so that they're not reused (the lock for the slab class
+ * is assumed to be held by the caller).
+ */
+static void do_slabs_start_move(struct default_engine *engine,
+                                const unsigned int id) {
+    slabclass_t *p = &engine->slabs.slabclass[id];
+    unsigned int kept = 0;
+
+    p->killing = 1;
+    p->killing_free = 0;
+    for (unsigned int ii = 0; ii < p->sl_curr; ++ii) {
+        if (do_slabs_in_killing(p, p->slots[ii])) {
+            p->killing_free++;
+        } else {
+            p->slots[kept++] = p->slots[ii];
+        }
+    }
+    p->sl_curr = kept;
+
+    if (p->end_page_ptr != nullptr && do_slabs_in_killing(p, p->end_page_ptr)) {
+        p->killing_free += p->end_page_free;
+        p->end_page_ptr = nullptr;
+        p->end_page_free = 0;
+    }
+}
+
+/*
+ * Add a slab (moved from another slab class) to the slab class and put all
+ * of its chunks on the freelist (the lock for the slab class is assumed to
+ * be held by the caller).
+ */
+static bool do_slabs_add_slab(struct default_engine *engine,
+                              const unsigned int id,
+                              void *slab) {
+    slabclass_t *p = &engine->slabs.slabclass[id];
+
+    if (grow_slab_list(engine, id) == 0) {
+        return false;
+    }
+    if (p->sl_curr + p->perslab > p->sl_total) {
+        unsigned int new_size = p->sl_curr + p->perslab;
+        void** new_slots = static_cast<void**>(cb_realloc(p->slots,
+                                               new_size * sizeof(void *)));
+        if (new_slots == nullptr) {
+            return false;
+        }
+        p->slots = new_slots;
+        p->sl_total = new_size;
+    }
+
+    memset(slab, 0, engine->config.item_size_max);
+    for (unsigned int ii = 0; ii < p->perslab; ++ii) {
+        p->slots[p->sl_curr++] = static_cast<char*>(slab) + ii * p->size;
+    }
+    p->slab_list[p->slabs++] = slab;
+    return true;
+}
+
+/*
+ * Evict the items stored in the slab being moved, and move it once all of
+ * its chunks are free.
+ * Returns true if the slab was moved.
+ */
+static bool slabs_move_slab(struct default_engine *engine) {
+    auto& automove = engine->slabs.automove;
+    slabclass_t *p = &engine->slabs.slabclass[automove.src];
+    char* slab;
+
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.class_locks[automove.src]);
+        slab = static_cast<char*>(p->slab_list[p->killing - 1]);
+    }
+
+    /* Can't hold the class lock while evicting (it's acquired to free them) */
+    item_evict_slab(engine, automove.src, slab, slab + size_t(p->size) * p->perslab);
+
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.class_locks[automove.src]);
+        if (p->killing_free < p->perslab) {
+            /* Some of the items are still in use, try again later */
+            return false;
+        }
+        p->slab_list[p->killing - 1] = p->slab_list[--p->slabs];
+        p->killing = 0;
+        p->killing_free = 0;
+        p->pages_moved_out++;
+    }
+
+    bool moved;
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.class_locks[automove.dst]);
+        moved = do_slabs_add_slab(engine, automove.dst, slab);
+        if (moved) {
+            engine->slabs.slabclass[automove.dst].pages_moved_in++;
+        }
+    }
+
+    if (moved) {
+        engine->slabs.slabs_moved++;
+    } else {
+        std::lock_guard<std::mutex> guard(engine->slabs.class_locks[automove.src]);
+        if (do_slabs_add_slab(engine, automove.src, slab)) {
+            p->pages_moved_out--;
+        }
+        /* else the memory isn't used until the bucket is deleted */
+    }
+
+    automove.src = automove.dst = 0;
+    return moved;
+}
+#endif
+
+void slabs_automove(struct default_engine *engine)
+{
+#ifndef USE_SYSTEM_MALLOC
+    auto& automove = engine->slabs.automove;
+    if (automove.src != 0) {
+        slabs_move_slab(engine);
+        return;
+    }
+
+    if (!engine->config.slab_automove) {
+        return;
+    }
+
+    const auto now = engine->server.core->get_current_time();
+    if (now - automove.window_start < slab_automove_window) {
+        return;
+    }
+    automove.window_start = now;
+
+    /* find the slab class which evicted the most items in the window */
+    unsigned int busiest = 0;
+    unsigned int most = 0;
+    for (unsigned int ii = POWER_SMALLEST; ii <= engine->slabs.power_largest; ++ii) {
+        unsigned int evicted;
+        {
+            std::lock_guard<std::mutex> guard(engine->items.lru_locks[ii]);
+            evicted = engine->items.itemstats[ii].evicted;
+        }
+        /* (the stats may have been reset) */
+        const auto delta = evicted >= automove.evicted[ii]
+                                   ? evicted - automove.evicted[ii]
+                                   : evicted;
+        automove.evicted[ii] = evicted;
+        if (delta == 0) {
+            automove.idle_windows[ii]++;
+        } else {
+            automove.idle_windows[ii] = 0;
+            if (delta > most) {
+                most = delta;
+                busiest = ii;
+            }
+        }
+    }
+
+    if (busiest == 0 || busiest != automove.busiest) {
+        automove.busiest = busiest;
+        automove.busiest_windows = (busiest == 0) ? 0 : 1;
+        return;
+    }
+    if (++automove.busiest_windows < slab_automove_windows) {
+        return;
+    }
+
+    /* take a slab from the idle slab class with the most free memory (but
+       leave at least one slab in each class) */
+    unsigned int src = 0;
+    size_t most_free = 0;
+    for (unsigned int ii = POWER_SMALLEST; ii <= engine->slabs.power_largest; ++ii) {
+        if (ii == busiest || automove.idle_windows[ii] < slab_automove_windows) {
+            continue;
+        }
+        std::lock_guard<std::mutex> guard(engine->slabs.class_locks[ii]);
+        const slabclass_t *p = &engine->slabs.slabclass[ii];
+        const size_t free = size_t(p->sl_curr + p->end_page_free) * p->size;
+        if (p->slabs > 1 && (src == 0 || free > most_free)) {
+            src = ii;
+            most_free = free;
+        }
+    }
+
+    if (src == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(engine->slabs.class_locks[src]);
+        do_slabs_start_move(engine, src);
+    }
+    automove.src = src;
+    automove.dst = busiest;
+    automove.busiest_windows = 0;
+    slabs_move_slab(engine);
+#else
+    (void)engine;
+#endif
+}
@@ -3,7 +3,10 @@
 
 #include <memcached/engine_common.h>
 #include <memcached/engine_error.h>
+#include <memcached/types.h>
 
+#include <array>
+#include <atomic>
 #include <mutex>
 
 /* Slab sizing definitions. */
@@ -32,7 +35,12 @@ typedef struct {
     unsigned int list_size; /* size of prev array */
 
     unsigned int killing;  /* index+1 of dying slab, or zero if none */
+    unsigned int killing_free; /* number of free chunks in the dying slab */
     size_t requested; /* The number of requested bytes */
+
+    unsigned int pages_moved_in;  /* slabs moved here from other classes */
+    unsigned int pages_moved_out; /* slabs moved to other classes */
+    unsigned int reassign_evicted; /* items evicted to move slabs out */
 } slabclass_t;
 
 struct slabs {
@@ -52,9 +60,39 @@ struct slabs {
    } allocs;
 
    /**
-    * Access to the slab allocator is protected by this lock
+    * Access to each slab class is protected by its own lock (so that
+    * allocations of items of different sizes don't contend)
+    */
+   std::array<std::mutex, MAX_NUMBER_OF_SLAB_CLASSES> class_locks;
+
+   /**
+    * Access to the memory shared by all of the slab classes (mem_malloced,
+    * mem_current, mem_avail and allocs) is protected by this lock. It may
+    * be acquired while holding a class lock, but not the other way around.
     */
    std::mutex lock;
+
+   /**
+    * The state of the slab automover (see slabs_automove), which is only
+    * used by the scrubber task.
+    */
+   struct {
+      /* the slab classes we're moving a slab between (0 if none) */
+      unsigned int src;
+      unsigned int dst;
+      /* when the current window started */
+      rel_time_t window_start;
+      /* the number of evictions in each class when the window started */
+      unsigned int evicted[MAX_NUMBER_OF_SLAB_CLASSES];
+      /* the number of windows in a row each class didn't evict items */
+      unsigned int idle_windows[MAX_NUMBER_OF_SLAB_CLASSES];
+      /* the class evicting the most items, and for how many windows */
+      unsigned int busiest;
+      unsigned int busiest_windows;
+   } automove;
+
+   /** The number of slabs moved between slab classes */
+   std::atomic<uint64_t> slabs_moved;
 };
 
 
@@ -86,9 +124,24 @@ void *slabs_alloc(struct default_engine *engine, size_t size, unsigned int id);
 /** Free previously allocated object */
 void slabs_free(struct default_engine *engine, void *ptr, size_t size, unsigned int id);
 
+/** Count an item evicted from a slab being moved to another slab class */
+void slabs_count_reassign_eviction(struct default_engine *engine, unsigned int id);
+
+/** Is all of the memory of the engine allocated to slabs? */
+bool slabs_full(struct default_engine *engine);
+
 /** Adjust the stats for memory requested */
 void slabs_adjust_mem_requested(struct default_engine *engine, unsigned int id, size_t old, size_t ntotal);
 
+/**
+ * Move slabs from the slab classes which don't evict items to the one
+ * evicting the most items (when it has done so for a while), so that the
+ * memory follows changes in the sizes of the items stored. To be called
+ * periodically by the scrubber task; a slab is moved once the items stored
+ * in it have been evicted, which may take several calls.
+ */
+void slabs_automove(struct default_engine *engine);
+
 /** Fill buffer with stats */ /*@null@*/
 void slabs_stats(struct default_engine* engine,
                  const AddStatFn& add_stats,
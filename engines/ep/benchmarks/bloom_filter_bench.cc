@@ -0,0 +1,111 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks relating to the BloomFilter class.
+ */
+
+#include "bloomfilter.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+/**
+ * Fixture holding a bloom filter sized for, and populated with, state.range(1)
+ * keys. The filter type is given by state.range(0).
+ */
+class BloomFilterBench : public benchmark::Fixture {
+public:
+    void SetUp(const benchmark::State& state) override {
+        const auto type = BloomFilterType(state.range(0));
+        const auto numKeys = size_t(state.range(1));
+        filter = std::make_unique<BloomFilter>(
+                numKeys, 0.01, BFILTER_ENABLED, type);
+        present.reserve(numKeys);
+        absent.reserve(numKeys);
+        for (size_t ii = 0; ii < numKeys; ++ii) {
+            present.push_back(
+                    makeStoredDocKey("present_" + std::to_string(ii)));
+            absent.push_back(makeStoredDocKey("absent_" + std::to_string(ii)));
+            filter->addKey(present.back());
+        }
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        filter.reset();
+        present.clear();
+        absent.clear();
+    }
+
+protected:
+    std::unique_ptr<BloomFilter> filter;
+    std::vector<StoredDocKey> present;
+    std::vector<StoredDocKey> absent;
+};
+
+// Lookup of keys not in the filter - the full-eviction GET miss path.
+BENCHMARK_DEFINE_F(BloomFilterBench, MaybeKeyExistsMiss)
+(benchmark::State& state) {
+    size_t ii = 0;
+    size_t falsePositives = 0;
+    while (state.KeepRunning()) {
+        falsePositives += filter->maybeKeyExists(absent[ii]);
+        ii = (ii + 1) % absent.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["FalsePositiveRate"] =
+            double(falsePositives) / state.iterations();
+}
+
+BENCHMARK_DEFINE_F(BloomFilterBench, MaybeKeyExistsHit)
+(benchmark::State& state) {
+    size_t ii = 0;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(filter->maybeKeyExists(present[ii]));
+        ii = (ii + 1) % present.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_DEFINE_F(BloomFilterBench, AddKey)(benchmark::State& state) {
+    size_t ii = 0;
+    while (state.KeepRunning()) {
+        filter->addKey(absent[ii]);
+        ii = (ii + 1) % absent.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BloomFilterArgs(benchmark::internal::Benchmark* b) {
+    for (auto type : {BloomFilterType::Classic, BloomFilterType::Blocked}) {
+        // 10K keys is the default bfilter_key_count (filter fits in cache);
+        // 10M keys is a large vBucket (filter far exceeds cache).
+        for (int64_t keys : {10000, 10000000}) {
+            b->Args({int64_t(type), keys});
+        }
+    }
+    b->ArgNames({"type", "keys"});
+}
+
+BENCHMARK_REGISTER_F(BloomFilterBench, MaybeKeyExistsMiss)
+        ->Apply(BloomFilterArgs);
+BENCHMARK_REGISTER_F(BloomFilterBench, MaybeKeyExistsHit)
+        ->Apply(BloomFilterArgs);
+BENCHMARK_REGISTER_F(BloomFilterBench, AddKey)->Apply(BloomFilterArgs);
@@ -16,14 +16,17 @@
  */
 
 /*
- * Benchmarks relating to the CheckpointIterator class.
+ * Benchmarks relating to the CheckpointIterator class and the Checkpoint
+ * key index.
  */
 
 #include "atomic.h"
+#include "checkpoint.h"
 #include "checkpoint_iterator.h"
 
 #include <benchmark/benchmark.h>
 #include <list>
+#include <unordered_map>
 
 typedef std::unique_ptr<int> TestItem;
 typedef std::list<TestItem> ListContainer;
@@ -59,3 +62,61 @@ static void BM_CheckpointIteratorCompare(benchmark::State& state) {
 
 // Register the function as a benchmark
 BENCHMARK(BM_CheckpointIteratorCompare);
+
+// The node-based index previously used by Checkpoint, for comparison with
+// checkpoint_index.
+using NodeCheckpointIndex =
+        std::unordered_map<CheckpointIndexKeyType,
+                           index_entry,
+                           std::hash<CheckpointIndexKeyType>,
+                           std::equal_to<>,
+                           MemoryTrackingAllocator<CheckpointIndexValueType>>;
+
+/**
+ * Benchmark the insert / de-duplication cost and the memory used by a
+ * Checkpoint key index, as done by Checkpoint::queueDirty. Each iteration
+ * queues 4 mutations against each of state.range(0) distinct keys into a
+ * fresh index.
+ */
+template <class Index>
+static void BM_CheckpointKeyIndex(benchmark::State& state) {
+    const auto numKeys = size_t(state.range(0));
+    std::vector<StoredDocKey> keys;
+    for (size_t ii = 0; ii < numKeys; ++ii) {
+        keys.emplace_back("checkpoint_key_index_" + std::to_string(ii),
+                          CollectionID::Default);
+    }
+
+    CheckpointQueue queue;
+    const ChkptQueueIterator end(queue, ChkptQueueIterator::Position::end);
+
+    size_t bytesAllocated = 0;
+    while (state.KeepRunning()) {
+        typename Index::allocator_type allocator;
+        CheckpointIndexKeyType::allocator_type keyAllocator;
+        Index index(allocator);
+        int64_t seqno = 0;
+        for (int pass = 0; pass < 4; ++pass) {
+            for (const auto& key : keys) {
+                auto itr = index.find(CheckpointIndexKeyType(key));
+                if (itr != index.end()) {
+                    itr->second.mutation_id = ++seqno;
+                    continue;
+                }
+                index.emplace(CheckpointIndexKeyType(key, keyAllocator),
+                              index_entry{end, ++seqno});
+            }
+        }
+        bytesAllocated = *allocator.getBytesAllocated() +
+                         *keyAllocator.getBytesAllocated();
+        benchmark::DoNotOptimize(index);
+    }
+
+    state.SetItemsProcessed(state.iterations() * numKeys * 4);
+    state.counters["BytesPerKey"] = double(bytesAllocated) / numKeys;
+}
+
+BENCHMARK_TEMPLATE(BM_CheckpointKeyIndex, NodeCheckpointIndex)
+        ->Range(64, 64 * 1024);
+BENCHMARK_TEMPLATE(BM_CheckpointKeyIndex, checkpoint_index)
+        ->Range(64, 64 * 1024);
@@ -0,0 +1,62 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of the checksums of the MutationLog blocks.
+ */
+
+extern "C" {
+#include "crc32.h"
+}
+
+#include <benchmark/benchmark.h>
+#include <platform/crc32c.h>
+
+#include <random>
+#include <vector>
+
+/// Random bytes to checksum, state.range(0) of them
+static std::vector<uint8_t> makeBuffer(const benchmark::State& state) {
+    std::vector<uint8_t> buf(state.range(0));
+    std::mt19937 gen(0);
+    for (auto& b : buf) {
+        b = uint8_t(gen());
+    }
+    return buf;
+}
+
+/// The table-based CRC-32 of (legacy) MutationLog blocks
+static void BM_Crc32buf(benchmark::State& state) {
+    auto buf = makeBuffer(state);
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(crc32buf(buf.data(), buf.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * buf.size());
+}
+
+/// The (hardware accelerated where available) CRC-32C of MutationLog blocks
+static void BM_Crc32c(benchmark::State& state) {
+    const auto buf = makeBuffer(state);
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(crc32c(buf.data(), buf.size(), 0));
+    }
+    state.SetBytesProcessed(state.iterations() * buf.size());
+}
+
+// From a small key to a large value, via the default access log block size
+BENCHMARK(BM_Crc32buf)->RangeMultiplier(8)->Range(64, 1024 * 1024);
+BENCHMARK(BM_Crc32c)->RangeMultiplier(8)->Range(64, 1024 * 1024);
@@ -65,6 +65,7 @@ public:
                               std::make_unique<Collections::VB::Manifest>()));
 
         populateVbucket();
+        movedCount = 0;
     }
 
     void TearDown(const ::benchmark::State& state) override {
@@ -96,22 +97,42 @@ protected:
         ASSERT_EQ(ndocs, vbucket->ht.getNumItems());
     }
 
+    /* Delete 7 in 8 of the documents in the first half of the bucket, leaving
+     * sparse slabs for the values (and StoredValues) of the documents left
+     * there, while the slabs of the second half stay full.
+     */
+    void fragmentVbucket() {
+        const size_t ndocs = vbucket->ht.getNumItems();
+        for (size_t i = 0; i < ndocs / 2; i++) {
+            if (i % 8 == 0) {
+                continue;
+            }
+            std::string key = "key" + std::to_string(i);
+            auto res = vbucket->ht.findForWrite(makeStoredDocKey(key));
+            ASSERT_TRUE(res.storedValue);
+            vbucket->ht.unlocked_del(res.lock, res.storedValue);
+        }
+    }
+
     /* Measure the rate at which the defragmenter can defragment documents, using
      * the given age threshold.
      *
      * Setup a Defragmenter, then time how long it takes to visit them all
      * documents in the given vbucket, 10 passes times.
+     * The number of objects moved is added to movedCount.
      * @return a pair of {items visited, duration}.
      */
     std::pair<size_t, std::chrono::nanoseconds> benchmarkDefragment(
             uint8_t age_threshold,
-            std::chrono::milliseconds chunk_duration) {
+            std::chrono::milliseconds chunk_duration,
+            bool sparse_slabs_only = false) {
         // Create and run visitor for the specified number of iterations, with
         // the given age.
         DefragmentVisitor visitor(DefragmenterTask::getMaxValueSize());
 
         visitor.setBlobAgeThreshold(age_threshold);
         visitor.setStoredValueAgeThreshold(age_threshold);
+        visitor.setSparseSlabsOnly(sparse_slabs_only);
         visitor.setCurrentVBucket(*vbucket);
 
         // Need to run 10 passes; so we allow the deframenter to defrag at
@@ -133,10 +154,13 @@ protected:
         auto end = std::chrono::steady_clock::now();
         auto duration = (end - start);
 
+        movedCount += visitor.getDefragCount() +
+                      visitor.getStoredValueDefragCount();
         return {visitor.getVisitedCount(), duration};
     }
 
     std::unique_ptr<VBucket> vbucket;
+    size_t movedCount{0};
     EPStats globalStats;
     CheckpointConfig checkpointConfig;
     Configuration config;
@@ -187,8 +211,33 @@ BENCHMARK_DEFINE_F(DefragmentBench, DefragAge10_20ms)(benchmark::State& state) {
             total.first / std::chrono::duration<double>(total.second).count();
 }
 
+/* Defragment a fragmented bucket moving every object (param 1 == 0) or only
+ * the objects on sparse slabs (param 1 == 1). Reports how many objects were
+ * moved per pass along with the rate items were visited at.
+ */
+BENCHMARK_DEFINE_F(DefragmentBench, DefragFragmented)(benchmark::State& state) {
+    fragmentVbucket();
+    const bool sparseSlabsOnly = state.range(1) == 1;
+
+    std::pair<size_t, std::chrono::nanoseconds> total;
+    size_t runs = 0;
+    while (state.KeepRunning()) {
+        auto result = benchmarkDefragment(
+                0, std::chrono::minutes(1), sparseSlabsOnly);
+        total.first += result.first;
+        total.second += result.second;
+        runs++;
+    }
+    state.counters["ItemsPerSec"] =
+            total.first / std::chrono::duration<double>(total.second).count();
+    // benchmarkDefragment does 10 passes
+    state.counters["MovedPerPass"] = double(movedCount) / (runs * 10);
+}
+
 BENCHMARK_REGISTER_F(DefragmentBench, Visit)->Range(0,1);
 BENCHMARK_REGISTER_F(DefragmentBench, DefragAlways)->Range(0,1);
 BENCHMARK_REGISTER_F(DefragmentBench, DefragAge10)->Range(0,1);
 BENCHMARK_REGISTER_F(DefragmentBench, DefragAge10_20ms)->Range(0,1);
+BENCHMARK_REGISTER_F(DefragmentBench, DefragFragmented)
+        ->Ranges({{0, 1}, {0, 1}});
 
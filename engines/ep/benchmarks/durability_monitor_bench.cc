@@ -0,0 +1,100 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks relating to the ActiveDurabilityMonitor class.
+ */
+
+#include "engine_fixture.h"
+#include "item.h"
+#include "kv_bucket.h"
+#include "vbucket.h"
+
+#include "../tests/module_tests/test_helpers.h"
+
+#include <folly/portability/GTest.h>
+#include <nlohmann/json.hpp>
+#include <programs/engine_testapp/mock_cookie.h>
+
+class ActiveDurabilityMonitorBench : public EngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        varConfig = "max_size=1000000000";
+        EngineFixture::SetUp(state);
+        const auto meta = nlohmann::json{
+                {"topology", nlohmann::json::array({{"active", "replica"}})}};
+        engine->getKVBucket()->setVBucketState(
+                vbid, vbucket_state_active, &meta);
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        engine->getKVBucket()->deleteVBucket(vbid, nullptr);
+        EngineFixture::TearDown(state);
+    }
+};
+
+/**
+ * Benchmark completing SyncWrites: each iteration prepares a batch of
+ * SyncWrites (each from its own client) then a single seqno ack from the
+ * replica satisfies all of them, and they are committed and the clients
+ * notified.
+ */
+BENCHMARK_DEFINE_F(ActiveDurabilityMonitorBench, SeqnoAckCommit)
+(benchmark::State& state) {
+    const auto batchSize = size_t(state.range(0));
+    auto& bucket = *engine->getKVBucket();
+    auto vb = bucket.getVBucket(vbid);
+
+    std::vector<const void*> cookies;
+    for (size_t ii = 0; ii < batchSize; ++ii) {
+        cookies.push_back(create_mock_cookie(engine.get()));
+    }
+
+    std::vector<queued_item> prepares;
+    for (size_t ii = 0; ii < batchSize; ++ii) {
+        prepares.push_back(makePendingItem(
+                makeStoredDocKey("key" + std::to_string(ii)), "value"));
+    }
+
+    int64_t seqno = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        for (size_t ii = 0; ii < batchSize; ++ii) {
+            ASSERT_EQ(ENGINE_SYNC_WRITE_PENDING,
+                      bucket.set(*prepares[ii], cookies[ii]));
+        }
+        seqno = vb->getHighSeqno();
+        state.ResumeTiming();
+
+        {
+            folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+            vb->seqnoAcknowledged(rlh, "replica", seqno);
+        }
+        vb->processResolvedSyncWrites();
+    }
+
+    state.SetItemsProcessed(state.iterations() * batchSize);
+    for (const auto* cookie : cookies) {
+        destroy_mock_cookie(cookie);
+    }
+}
+
+BENCHMARK_REGISTER_F(ActiveDurabilityMonitorBench, SeqnoAckCommit)
+        ->Arg(1)
+        ->Arg(10)
+        ->Arg(100)
+        ->Arg(1000);
@@ -0,0 +1,273 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * End-to-end benchmarks of the front-end operations of a fully initialized
+ * bucket: the front-end threads store and get documents while the real
+ * flusher (and persistence callbacks, and durability completion) runs in
+ * the background, to catch regressions in the interactions between them
+ * which the component benchmarks don't see.
+ *
+ * Each benchmark thread operates on a vBucket of its own. Besides the
+ * ops/s the benchmarks report:
+ *
+ *   PersistLagMs   The time from the front-end threads completing until
+ *                  all of their mutations are persisted
+ *   BytesPerItem   The memory used by the bucket per item stored
+ */
+
+#include "engine_fixture.h"
+#include "ep_engine.h"
+#include "item.h"
+#include "kv_bucket.h"
+#include "vbucket.h"
+
+#include <memcached/durability_spec.h>
+#include <nlohmann/json.hpp>
+#include <programs/engine_testapp/mock_cookie.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+enum class Store { Couchstore = 0, Magma = 1 };
+
+static std::string to_string(Store store) {
+    switch (store) {
+    case Store::Couchstore:
+        return "couchdb";
+    case Store::Magma:
+        return "magma";
+    }
+    throw std::invalid_argument("to_string(Store): invalid enumeration " +
+                                std::to_string(int(store)));
+}
+
+class EngineBench : public ThreadedEngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        store = Store(state.range(0));
+        varConfig = "backend=" + to_string(store) +
+                    // Room for the keys of all of the threads
+                    ";max_size=1000000000";
+        if (state.thread_index == 0) {
+            threadsDone = 0;
+        }
+        ThreadedEngineFixture::SetUp(state);
+        if (state.thread_index == 0) {
+            // A single node topology, so that SyncWrites complete as soon
+            // as the active has persisted them.
+            const nlohmann::json meta = {
+                    {"topology", nlohmann::json::array({{"active"}})}};
+            for (uint16_t vb = 0; vb < numVbuckets; ++vb) {
+                engine->getKVBucket()->setVBucketState(
+                        Vbid(vb), vbucket_state_active, &meta);
+            }
+        }
+    }
+
+    Vbid getVbid(const benchmark::State& state) const {
+        return Vbid(state.thread_index % numVbuckets);
+    }
+
+    static std::string getKey(const benchmark::State& state, size_t ii) {
+        return "key_" + std::to_string(state.thread_index) + "_" +
+               std::to_string(ii % keysPerThread);
+    }
+
+    Item makeItem(Vbid vbid, const std::string& key, const std::string& value) {
+        Item item(StoredDocKey(key, CollectionID::Default),
+                  /*flags*/ 0,
+                  /*exp*/ 0,
+                  value.c_str(),
+                  value.size(),
+                  PROTOCOL_BINARY_DATATYPE_JSON);
+        item.setVBucketId(vbid);
+        return item;
+    }
+
+    /**
+     * Store the item (once the SyncWrite completes for a durable item, the
+     * way memcached does it: block the cookie and retry once notified).
+     */
+    ENGINE_ERROR_CODE storeItem(const void* cookie, Item& item) {
+        uint64_t cas = 0;
+        lock_mock_cookie(cookie);
+        auto ret =
+                engine->storeInner(cookie, item, cas, OPERATION_SET, false);
+        if (ret == ENGINE_EWOULDBLOCK) {
+            waitfor_mock_cookie(cookie);
+            ret = engine->storeInner(cookie, item, cas, OPERATION_SET, false);
+        }
+        unlock_mock_cookie(cookie);
+        return ret;
+    }
+
+    size_t getMemUsed() const {
+        return engine->getEpStats().getPreciseTotalMemoryUsed();
+    }
+
+    size_t getNumItems() const {
+        size_t ret = 0;
+        for (uint16_t vb = 0; vb < numVbuckets; ++vb) {
+            ret += engine->getKVBucket()->getVBucket(Vbid(vb))->getNumItems();
+        }
+        return ret;
+    }
+
+    /**
+     * Called by every thread once its benchmark loop is done. Thread 0 waits
+     * for the others, and then for the mutations to be persisted, and
+     * reports the persistence lag and the memory per item.
+     */
+    void complete(benchmark::State& state, size_t baseBytes) {
+        ++threadsDone;
+        if (state.thread_index != 0) {
+            return;
+        }
+        while (threadsDone < state.threads) {
+            std::this_thread::yield();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        waitForPersistence();
+        const auto lag = std::chrono::steady_clock::now() - start;
+
+        const auto items = std::max(size_t(1), getNumItems());
+        const auto memUsed = getMemUsed();
+        state.counters["PersistLagMs"] =
+                std::chrono::duration_cast<std::chrono::milliseconds>(lag)
+                        .count();
+        state.counters["BytesPerItem"] =
+                memUsed > baseBytes ? (memUsed - baseBytes) / items : 0;
+        state.SetLabel(("store:" + to_string(store)).c_str());
+    }
+
+    /// The number of distinct keys each thread stores (and overwrites)
+    static const size_t keysPerThread = 100000;
+
+    Store store;
+    std::atomic<int> threadsDone{0};
+};
+
+/**
+ * Store documents (with a background flusher persisting them).
+ */
+BENCHMARK_DEFINE_F(EngineBench, Store)(benchmark::State& state) {
+    const auto vbid = getVbid(state);
+    const std::string value(state.range(1), 'x');
+    const auto* cookie = create_mock_cookie();
+    const size_t baseBytes = state.thread_index == 0 ? getMemUsed() : 0;
+
+    size_t ii = 0;
+    while (state.KeepRunning()) {
+        auto item = makeItem(vbid, getKey(state, ii++), value);
+        if (storeItem(cookie, item) != ENGINE_SUCCESS) {
+            state.SkipWithError("Failed to store item");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    complete(state, baseBytes);
+    destroy_mock_cookie(cookie);
+}
+
+/**
+ * Store durable (PersistToMajority) documents: every store waits for the
+ * flusher to persist the prepare, and for the persistence callback to
+ * commit it.
+ */
+BENCHMARK_DEFINE_F(EngineBench, DurableStore)(benchmark::State& state) {
+    const auto vbid = getVbid(state);
+    const std::string value(state.range(1), 'x');
+    const auto* cookie = create_mock_cookie();
+    const size_t baseBytes = state.thread_index == 0 ? getMemUsed() : 0;
+
+    size_t ii = 0;
+    while (state.KeepRunning()) {
+        auto item = makeItem(vbid, getKey(state, ii++), value);
+        item.setPendingSyncWrite({cb::durability::Level::PersistToMajority,
+                                  cb::durability::Timeout()});
+        if (storeItem(cookie, item) != ENGINE_SUCCESS) {
+            state.SkipWithError("Failed to store durable item");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    complete(state, baseBytes);
+    destroy_mock_cookie(cookie);
+}
+
+/**
+ * Get (resident) documents, in a random order.
+ */
+BENCHMARK_DEFINE_F(EngineBench, Get)(benchmark::State& state) {
+    const auto vbid = getVbid(state);
+    const std::string value(state.range(1), 'x');
+    const auto* cookie = create_mock_cookie();
+    const size_t baseBytes = state.thread_index == 0 ? getMemUsed() : 0;
+
+    std::vector<StoredDocKey> keys;
+    for (size_t ii = 0; ii < keysPerThread; ++ii) {
+        const auto key = getKey(state, ii);
+        auto item = makeItem(vbid, key, value);
+        if (storeItem(cookie, item) != ENGINE_SUCCESS) {
+            state.SkipWithError("Failed to store item");
+            break;
+        }
+        keys.emplace_back(key, CollectionID::Default);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(state.thread_index));
+
+    size_t ii = 0;
+    while (state.KeepRunning()) {
+        auto ret = engine->get(
+                cookie, keys[ii++ % keys.size()], vbid, DocStateFilter::Alive);
+        if (ret.first != cb::engine_errc::success) {
+            state.SkipWithError("Failed to get item");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    complete(state, baseBytes);
+    destroy_mock_cookie(cookie);
+}
+
+static void EngineArguments(benchmark::internal::Benchmark* b) {
+    for (auto size : {256, 4096}) {
+        b->Args({std::underlying_type<Store>::type(Store::Couchstore), size});
+#ifdef EP_USE_MAGMA
+        b->Args({std::underlying_type<Store>::type(Store::Magma), size});
+#endif
+    }
+}
+
+BENCHMARK_REGISTER_F(EngineBench, Store)
+        ->Apply(EngineArguments)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+
+BENCHMARK_REGISTER_F(EngineBench, DurableStore)
+        ->Apply(EngineArguments)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
+
+BENCHMARK_REGISTER_F(EngineBench, Get)
+        ->Apply(EngineArguments)
+        ->ThreadRange(1, 8)
+        ->UseRealTime();
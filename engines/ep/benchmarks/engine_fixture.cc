@@ -25,8 +25,12 @@
 #include <thread>
 
 #include "benchmark_memory_tracker.h"
+#include "ep_engine.h"
+#include "ep_engine_public.h"
 #include "ep_time.h"
 #include "item.h"
+#include "kv_bucket.h"
+#include "vbucket.h"
 
 void EngineFixture::SetUp(const benchmark::State& state) {
     if (state.thread_index == 0) {
@@ -72,3 +76,62 @@ Item EngineFixture::make_item(Vbid vbid,
     item.setVBucketId(vbid);
     return item;
 }
+
+void ThreadedEngineFixture::SetUp(const benchmark::State& state) {
+    if (state.thread_index == 0) {
+        // Remove any files left over by a previous run
+        if (cb::io::isDirectory("benchmarks-test")) {
+            cb::io::rmrf("benchmarks-test");
+        }
+        EngineIface* handle;
+        if (create_ep_engine_instance(get_mock_server_api, &handle) !=
+            ENGINE_SUCCESS) {
+            throw std::runtime_error(
+                    "ThreadedEngineFixture: Failed to create ep engine");
+        }
+        auto* ep = reinterpret_cast<EventuallyPersistentEngine*>(handle);
+        ObjectRegistry::onSwitchThread(ep);
+
+        std::string config = "dbname=benchmarks-test;max_vbuckets=" +
+                             std::to_string(numVbuckets) +
+                             ";max_num_shards=4;" + varConfig;
+        if (ep->initialize(config.c_str()) != ENGINE_SUCCESS) {
+            throw std::runtime_error(
+                    "ThreadedEngineFixture: Failed to initialize engine");
+        }
+        while (ep->getKVBucket()->isWarmingUp()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+        }
+        for (uint16_t vb = 0; vb < numVbuckets; ++vb) {
+            ep->getKVBucket()->setVBucketState(Vbid(vb), vbucket_state_active);
+        }
+        engine = ep;
+    } else {
+        // 'engine' setup by thread:0; wait until it has completed.
+        while (!engine) {
+            std::this_thread::yield();
+        }
+        ObjectRegistry::onSwitchThread(engine);
+    }
+}
+
+void ThreadedEngineFixture::TearDown(const benchmark::State& state) {
+    if (state.thread_index == 0) {
+        ObjectRegistry::onSwitchThread(engine);
+        engine->destroy(true);
+        engine = nullptr;
+        ExecutorPool::shutdown();
+        cb::io::rmrf("benchmarks-test");
+    }
+    ObjectRegistry::onSwitchThread(nullptr);
+}
+
+void ThreadedEngineFixture::waitForPersistence() {
+    for (uint16_t vb = 0; vb < numVbuckets; ++vb) {
+        auto vbucket = engine->getKVBucket()->getVBucket(Vbid(vb));
+        while (vbucket->getPersistenceSeqno() <
+               uint64_t(vbucket->getHighSeqno())) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
@@ -22,6 +22,7 @@
 #include <memcached/vbucket.h>
 
 class BenchmarkMemoryTracker;
+class EventuallyPersistentEngine;
 class Item;
 class SingleThreadedExecutorPool;
 
@@ -44,3 +45,27 @@ protected:
     std::string varConfig;
     SingleThreadedExecutorPool* executorPool;
 };
+
+/**
+ * A fixture for benchmarking a fully initialized EpEngine (created the
+ * same way memcached creates it), with the real ExecutorPool running the
+ * flusher, BGFetcher and other background tasks in threads of their own.
+ *
+ * Use this (and not EngineFixture) to measure the interactions between the
+ * front-end threads and the background tasks.
+ */
+class ThreadedEngineFixture : public benchmark::Fixture {
+protected:
+    void SetUp(const benchmark::State& state) override;
+
+    void TearDown(const benchmark::State& state) override;
+
+    /// Wait until all of the items queued for persistence are persisted
+    void waitForPersistence();
+
+    EventuallyPersistentEngine* engine = nullptr;
+    const uint16_t numVbuckets = 16;
+
+    // Allows subclasses to add stuff to the config
+    std::string varConfig;
+};
@@ -21,6 +21,7 @@
 
 #include "executorpool.h"
 #include "folly_executorpool.h"
+#include "futurequeue.h"
 #include "tests/mock/mock_taskable.h"
 #include "tests/module_tests/executorpool_test.h"
 #include "tests/module_tests/lambda_task.h"
@@ -312,6 +313,72 @@ public:
         shutdownPool(state);
     }
 
+    /**
+     * Benchmark the scheduling latency of a high priority task under mixed
+     * load - i.e. while the NonIO pool is kept saturated by a number of
+     * low priority tasks which run back-to-back.
+     *
+     * This models (for example) a DurabilityCompletionTask or
+     * PendingOpsNotification being woken while a batch of background
+     * visitors (defragmenter, item compressor etc.) are occupying all NonIO
+     * threads.
+     *
+     * Each iteration schedules one high priority NonIO task and waits for it
+     * to run, so the (real) time per iteration is the wake -> run latency.
+     *
+     * Argument specifies how many low priority background tasks exist.
+     */
+    void bench_MixedLoadLatency(benchmark::State& state) {
+        setupPool(state, 2);
+
+        // Background tasks - spin for 100us then immediately re-run.
+        std::vector<ExTask> background;
+        for (int i = 0; i < state.range(0); i++) {
+            background.push_back(std::make_shared<LambdaTask>(
+                    taskable,
+                    TaskId::WorkLoadMonitor,
+                    0,
+                    false,
+                    [](LambdaTask& task) {
+                        const auto end = std::chrono::steady_clock::now() +
+                                         std::chrono::microseconds(100);
+                        while (std::chrono::steady_clock::now() < end) {
+                        }
+                        task.snooze(0);
+                        return true;
+                    }));
+            getPool()->schedule(background.back());
+        }
+
+        folly::Baton cv;
+        auto urgentFn = [&cv](LambdaTask&) {
+            cv.post();
+            return false;
+        };
+
+        while (state.KeepRunning()) {
+            ExTask task = std::make_shared<LambdaTask>(
+                    taskable,
+                    TaskId::PendingOpsNotification,
+                    0,
+                    true,
+                    urgentFn);
+            getPool()->schedule(task);
+            cv.wait();
+            cv.reset();
+        }
+
+        // Cancel all background tasks so they don't keep running during pool
+        // shutdown.
+        for (auto& t : background) {
+            t->cancel();
+        }
+
+        state.SetItemsProcessed(state.iterations());
+
+        shutdownPool(state);
+    }
+
 private:
     std::unique_ptr<T> pool;
     /// Semaphore used to coordinate pool creation/usage.
@@ -366,6 +433,27 @@ BENCHMARK_TEMPLATE_DEFINE_F(ExecutorPoolFixture,
     bench_TimeoutAddCancel(state);
 }
 
+BENCHMARK_TEMPLATE_DEFINE_F(ExecutorPoolFixture,
+                            MixedLoadLatency_CB3,
+                            CB3ExecutorPool)
+(benchmark::State& state) {
+    bench_MixedLoadLatency(state);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(ExecutorPoolFixture,
+                            MixedLoadLatency_Folly,
+                            FollyExecutorPool)
+(benchmark::State& state) {
+    bench_MixedLoadLatency(state);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(ExecutorPoolFixture,
+                            MixedLoadLatency_FollyWorkStealing,
+                            WorkStealingFollyExecutorPool)
+(benchmark::State& state) {
+    bench_MixedLoadLatency(state);
+}
+
 /**
  * Benchmark fixture using Folly's CPUThreadPoolPoolExecutor &
  * IOThreadPoolExecutor directly (without any higher-level GlobalTask
@@ -549,6 +637,43 @@ BENCHMARK_DEFINE_F(PureFollyExecutorBench, TimeoutAddCancel)
     }
 }
 
+/**
+ * Measure the cost of the CB3 TaskQueue's FutureQueue operations in
+ * isolation: with N tasks queued, wake a task (move it to the front) and then
+ * reschedule it (pop and push it back with a later waketime).
+ */
+static void FutureQueueWakeReschedule(benchmark::State& state) {
+    NullTaskable taskable;
+    FutureQueue queue;
+    std::mt19937_64 generator(0);
+    std::uniform_real_distribution<> snoozeDistribution(10.0, 30.0);
+
+    std::vector<ExTask> tasks;
+    for (int i = 0; i < state.range(0); i++) {
+        ExTask task = std::make_shared<LambdaTask>(
+                taskable,
+                TaskId::ItemPager,
+                snoozeDistribution(generator),
+                true,
+                [](LambdaTask&) { return false; });
+        queue.push(task);
+        tasks.push_back(task);
+    }
+
+    auto nextTask = tasks.begin();
+    while (state.KeepRunning()) {
+        queue.updateWaketime(*nextTask, std::chrono::steady_clock::now());
+        auto task = queue.top();
+        queue.pop();
+        task->snooze(snoozeDistribution(generator));
+        queue.push(task);
+        if (++nextTask == tasks.end()) {
+            nextTask = tasks.begin();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
 BENCHMARK_REGISTER_F(ExecutorPoolFixture, OneShotScheduleRun_CB3)
         ->ThreadRange(1, 16)
         ->UseRealTime();
@@ -573,17 +698,40 @@ BENCHMARK_REGISTER_F(ExecutorPoolFixture, LongLivedScheduleRun_Folly)
 
 BENCHMARK_REGISTER_F(ExecutorPoolFixture, TimeoutAddCancel_CB3)
         ->ThreadRange(1, 16)
-        ->Range(1000, 30000)
+        ->Range(1000, 100000)
         ->ArgName("Timeouts")
         ->UseRealTime();
 BENCHMARK_REGISTER_F(ExecutorPoolFixture, TimeoutAddCancel_Folly)
         ->ThreadRange(1, 16)
-        ->Range(1000, 30000)
+        ->Range(1000, 100000)
         ->ArgName("Timeouts")
         ->UseRealTime();
 
+BENCHMARK_REGISTER_F(ExecutorPoolFixture, MixedLoadLatency_CB3)
+        ->Arg(2)
+        ->Arg(8)
+        ->Arg(32)
+        ->ArgName("BackgroundTasks")
+        ->UseRealTime();
+BENCHMARK_REGISTER_F(ExecutorPoolFixture, MixedLoadLatency_Folly)
+        ->Arg(2)
+        ->Arg(8)
+        ->Arg(32)
+        ->ArgName("BackgroundTasks")
+        ->UseRealTime();
+BENCHMARK_REGISTER_F(ExecutorPoolFixture, MixedLoadLatency_FollyWorkStealing)
+        ->Arg(2)
+        ->Arg(8)
+        ->Arg(32)
+        ->ArgName("BackgroundTasks")
+        ->UseRealTime();
+
+BENCHMARK(FutureQueueWakeReschedule)
+        ->Range(1000, 100000)
+        ->ArgName("Tasks");
+
 BENCHMARK_REGISTER_F(PureFollyExecutorBench, TimeoutAddCancel)
         ->ThreadRange(1, 16)
-        ->Range(1000, 30000)
+        ->Range(1000, 100000)
         ->ArgName("Timeouts")
         ->UseRealTime();
@@ -15,6 +15,8 @@
  *   limitations under the License.
  */
 
+#include "benchmark_memory_tracker.h"
+#include "compact_stored_value_index.h"
 #include "configuration.h"
 #include "hash_table.h"
 #include "item.h"
@@ -27,14 +29,21 @@
 #include <folly/portability/GTest.h>
 #include <spdlog/fmt/fmt.h>
 
+#include <algorithm>
+#include <random>
+
 // Benchmarks inserting items into a HashTable
 class HashTableBench : public benchmark::Fixture {
 public:
-    HashTableBench()
+    HashTableBench() : HashTableBench(HashTableReadMode::Locked) {
+    }
+
+    explicit HashTableBench(HashTableReadMode readMode)
         : ht(stats,
              std::make_unique<StoredValueFactory>(stats),
              Configuration().getHtSize(),
-             Configuration().getHtLocks()) {
+             Configuration().getHtLocks(),
+             readMode) {
     }
 
     void SetUp(benchmark::State& state) override {
@@ -367,6 +376,162 @@ BENCHMARK_DEFINE_F(HashTableBench, HTStatsEpilogue)(benchmark::State& state) {
     state.SetItemsProcessed(state.iterations());
 }
 
+// Single-threaded lookup cost of the (chained) HashTable, reporting the
+// index memory per key alongside, for comparison with
+// CompactStoredValueIndex below.
+BENCHMARK_DEFINE_F(HashTableBench, ChainedIndexLookup)
+(benchmark::State& state) {
+    sharedItems = createUniqueItems("Index::");
+    for (auto& item : sharedItems) {
+        ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+    }
+    ht.resize();
+
+    while (state.KeepRunning()) {
+        auto& key = sharedItems[state.iterations() % numItems].getKey();
+        benchmark::DoNotOptimize(ht.findForRead(key, TrackReference::No));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    // Bucket array + per-StoredValue chain pointer.
+    state.counters["IndexBytesPerKey"] =
+            double(ht.memorySize() + numItems * sizeof(StoredValue*)) /
+            numItems;
+}
+
+BENCHMARK_DEFINE_F(HashTableBench, CompactIndexLookup)
+(benchmark::State& state) {
+    sharedItems = createUniqueItems("Index::");
+    CompactStoredValueIndex index;
+    for (auto& item : sharedItems) {
+        index.insert((*getValFact())(item, nullptr));
+    }
+
+    while (state.KeepRunning()) {
+        auto& key = sharedItems[state.iterations() % numItems].getKey();
+        benchmark::DoNotOptimize(index.find(key));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["IndexBytesPerKey"] =
+            double(index.memorySize()) / numItems;
+}
+
+// Random lookups into a (sparse) bucket array much larger than the TLB
+// reach, with the array on ordinary or (transparent) huge pages. Arguments:
+// huge pages (0/1), number of hash buckets.
+BENCHMARK_DEFINE_F(HashTableBench, HugePageLookup)(benchmark::State& state) {
+    HashTable table(stats,
+                    std::make_unique<StoredValueFactory>(stats),
+                    state.range(1),
+                    Configuration().getHtLocks(),
+                    HashTableReadMode::Locked,
+                    HashTableResizeMode::Blocking,
+                    state.range(0) != 0);
+    sharedItems = createUniqueItems("HugePage::");
+    for (auto& item : sharedItems) {
+        ASSERT_EQ(MutationStatus::WasClean, table.set(item));
+    }
+    // Visit the buckets in a random order, so that (almost) every lookup
+    // touches a different page of the bucket array
+    std::mt19937 random(0);
+    std::shuffle(sharedItems.begin(), sharedItems.end(), random);
+
+    while (state.KeepRunning()) {
+        auto& key = sharedItems[state.iterations() % numItems].getKey();
+        benchmark::DoNotOptimize(table.findForRead(key, TrackReference::No));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["HugePageBytes"] = double(stats.htHugePageBytes);
+    table.clear();
+}
+
+// Memory used per item by the StoredValues (and their values) of small
+// documents, with and without the values stored inline.
+BENCHMARK_DEFINE_F(HashTableBench, StoredValueMemory)
+(benchmark::State& state) {
+    auto* memoryTracker = BenchmarkMemoryTracker::getInstance();
+    StoredValueFactory factory(stats, state.range(0));
+    const std::string value(state.range(1), 'x');
+
+    std::vector<StoredDocKey> keys;
+    keys.reserve(numItems);
+    for (size_t i = 0; i < numItems; i++) {
+        keys.emplace_back(makeStoredDocKey("key" + std::to_string(i)));
+    }
+
+    size_t bytesPerItem = 0;
+    while (state.KeepRunning()) {
+        std::vector<StoredValue::UniquePtr> values;
+        values.reserve(numItems);
+        const auto baseBytes = memoryTracker->getCurrentAlloc();
+        for (const auto& key : keys) {
+            // The Item is gone once the StoredValue is created, just like
+            // the Items of the front end mutations
+            values.emplace_back(factory(
+                    Item(key, 0, 0, value.data(), value.size()), nullptr));
+        }
+        bytesPerItem =
+                (memoryTracker->getCurrentAlloc() - baseBytes) / numItems;
+    }
+
+    state.SetItemsProcessed(state.iterations() * numItems);
+    state.counters["BytesPerItem"] = bytesPerItem;
+}
+
+// Variant of HashTableBench using optimistic (mutex-free) reads.
+class HashTableOptimisticBench : public HashTableBench {
+public:
+    HashTableOptimisticBench()
+        : HashTableBench(HashTableReadMode::Optimistic) {
+    }
+};
+
+/**
+ * Multi-reader contention benchmark: thread 0 continually updates items while
+ * all other threads read them, measuring reader throughput. Instantiated
+ * for both locked and optimistic read modes so the two can be compared
+ * directly.
+ */
+template <typename Fixture>
+void multiReaderContention(Fixture& fixture, benchmark::State& state) {
+    if (state.thread_index == 0) {
+        fixture.sharedItems = fixture.createUniqueItems("Contention::");
+        for (auto& item : fixture.sharedItems) {
+            ASSERT_EQ(MutationStatus::WasClean, fixture.ht.set(item));
+        }
+    }
+
+    size_t index = 0;
+    while (state.KeepRunning()) {
+        auto& item = fixture.sharedItems[index++ % HashTableBench::numItems];
+        if (state.thread_index == 0) {
+            // Writer - keep the HashBucket mutexes (and ReadStripes) busy.
+            benchmark::DoNotOptimize(fixture.ht.set(item));
+            continue;
+        }
+        auto optimistic = fixture.ht.findForReadOptimistic(item.getKey());
+        if (optimistic) {
+            benchmark::DoNotOptimize(optimistic->storedValue);
+        } else {
+            benchmark::DoNotOptimize(fixture.ht.findForRead(item.getKey()));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_DEFINE_F(HashTableBench, MultiReaderContention)
+(benchmark::State& state) {
+    multiReaderContention(*this, state);
+}
+
+BENCHMARK_DEFINE_F(HashTableOptimisticBench, MultiReaderContention)
+(benchmark::State& state) {
+    multiReaderContention(*this, state);
+}
+
 BENCHMARK_REGISTER_F(HashTableBench, FindForRead)
         ->ThreadPerCpu()
         ->Iterations(HashTableBench::numItems);
@@ -392,3 +557,39 @@ BENCHMARK_REGISTER_F(HashTableBench, HTStatsEpilogue)
         ->ThreadPerCpu()
         ->Iterations(HashTableBench::numItems)
         ->Range(1, 1000);
+
+BENCHMARK_REGISTER_F(HashTableBench, MultiReaderContention)
+        ->ThreadPerCpu()
+        ->Iterations(HashTableBench::numItems);
+BENCHMARK_REGISTER_F(HashTableOptimisticBench, MultiReaderContention)
+        ->ThreadPerCpu()
+        ->Iterations(HashTableBench::numItems);
+
+BENCHMARK_REGISTER_F(HashTableBench, StoredValueMemory)
+        ->Iterations(10)
+        ->Args({0, 8})
+        ->Args({64, 8})
+        ->Args({0, 40})
+        ->Args({64, 40});
+
+BENCHMARK_REGISTER_F(HashTableBench, HugePageLookup)
+        ->Iterations(HashTableBench::numItems * 10)
+        ->Args({0, 1 << 20})
+        ->Args({1, 1 << 20})
+        ->Args({0, 1 << 24})
+        ->Args({1, 1 << 24});
+
+BENCHMARK_REGISTER_F(HashTableBench, ChainedIndexLookup)
+        ->Iterations(HashTableBench::numItems);
+BENCHMARK_REGISTER_F(HashTableBench, CompactIndexLookup)
+        ->Iterations(HashTableBench::numItems);
+
+// Cost of hashing a key (arg: the key length), paid for every key lookup
+static void DocKeyHash(benchmark::State& state) {
+    const auto key = makeStoredDocKey(std::string(state.range(0), 'k'));
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(key.hash());
+    }
+    state.SetBytesProcessed(state.iterations() * key.size());
+}
+BENCHMARK(DocKeyHash)->Arg(10)->Arg(32)->Arg(100)->Arg(250);
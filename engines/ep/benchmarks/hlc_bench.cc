@@ -0,0 +1,72 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks relating to the HLC class.
+ */
+
+#include "hlc.h"
+
+#include <benchmark/benchmark.h>
+
+#include <mutex>
+
+static HLC hlc{0,
+               0,
+               std::chrono::microseconds::max(),
+               std::chrono::microseconds::max()};
+
+/**
+ * Many front-end threads generating the CAS of mutations of the same
+ * vbucket, serialised by a lock as they are by the checkpoint queueLock.
+ */
+static void BM_NextHLCLocked(benchmark::State& state) {
+    static std::mutex queueLock;
+    while (state.KeepRunning()) {
+        std::lock_guard<std::mutex> lh(queueLock);
+        benchmark::DoNotOptimize(hlc.nextHLC());
+    }
+}
+
+/**
+ * Front-end threads generating CAS values while thread 0 applies the CAS
+ * of replicated mutations (as setWithMeta does).
+ */
+static void BM_NextHLCWithDrift(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        if (state.thread_index == 0) {
+            hlc.setMaxHLCAndTrackDrift(hlc.getMaxHLC() + 1);
+        } else {
+            benchmark::DoNotOptimize(hlc.nextHLC());
+        }
+    }
+}
+
+/// Unserialised callers, the worst case for the exchange in nextHLC
+static void BM_NextHLCContended(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(hlc.nextHLC());
+    }
+}
+
+BENCHMARK(BM_NextHLCLocked)->Threads(1);
+BENCHMARK(BM_NextHLCLocked)->Threads(8);
+BENCHMARK(BM_NextHLCWithDrift)->Threads(2);
+BENCHMARK(BM_NextHLCWithDrift)->Threads(8);
+BENCHMARK(BM_NextHLCContended)->Threads(1);
+BENCHMARK(BM_NextHLCContended)->Threads(8);
+BENCHMARK(BM_NextHLCContended)->ThreadPerCpu();
@@ -22,6 +22,7 @@
 #include "kvstore.h"
 #include "kvstore_config.h"
 #include "vb_commit.h"
+#include "vbucket_bgfetch_item.h"
 #ifdef EP_USE_ROCKSDB
 #include "rocksdb-kvstore/rocksdb-kvstore_config.h"
 #endif
@@ -34,6 +35,11 @@
 #include <platform/dirutils.h>
 #include <programs/engine_testapp/mock_server.h>
 
+#include <fcntl.h>
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
 using namespace std::string_literals;
 
 enum Storage {
@@ -196,6 +202,83 @@ BENCHMARK_DEFINE_F(KVStoreBench, Scan)(benchmark::State& state) {
     state.SetItemsProcessed(itemCountTotal);
 }
 
+/*
+ * Drop the vBucket's data files from the page cache, so the next fetch has
+ * to go to disk (as when warming up after a restart).
+ */
+static void dropFromPageCache(const std::string& dbname) {
+#ifdef POSIX_FADV_DONTNEED
+    for (const auto& file : cb::io::findFilesWithPrefix(dbname, "0.")) {
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd != -1) {
+            (void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+#else
+    (void)dbname;
+#endif
+}
+
+/*
+ * Benchmark for KVStore::getMulti() / getMultiBulk() of every 10th key
+ * from a cold page cache, as a warmup from the access log would do.
+ */
+static void fetchColdEveryTenth(benchmark::State& state,
+                                KVStore& kvstore,
+                                const std::string& dbname,
+                                Vbid vbid,
+                                int numItems,
+                                bool bulk) {
+    size_t itemCountTotal = 0;
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        vb_bgfetch_queue_t items;
+        for (int i = 1; i <= numItems; i += 10) {
+            auto key = makeDiskDocKey("key" + std::to_string(i));
+            auto& ctx = items[key];
+            ctx.bgfetched_list.emplace_back(
+                    std::make_unique<FrontEndBGFetchItem>(nullptr, false));
+        }
+        dropFromPageCache(dbname);
+        state.ResumeTiming();
+
+        if (bulk) {
+            kvstore.getMultiBulk(vbid, items);
+        } else {
+            kvstore.getMulti(vbid, items);
+        }
+
+        state.PauseTiming();
+        for (const auto& item : items) {
+            ASSERT_EQ(ENGINE_SUCCESS, item.second.value.getStatus());
+        }
+        itemCountTotal += items.size();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(itemCountTotal);
+}
+
+BENCHMARK_DEFINE_F(KVStoreBench, GetMultiCold)(benchmark::State& state) {
+    fetchColdEveryTenth(state,
+                        *kvstore,
+                        kvstoreConfig->getDBName(),
+                        vbid,
+                        numItems,
+                        false);
+}
+
+BENCHMARK_DEFINE_F(KVStoreBench, GetMultiBulkCold)(benchmark::State& state) {
+    fetchColdEveryTenth(state,
+                        *kvstore,
+                        kvstoreConfig->getDBName(),
+                        vbid,
+                        numItems,
+                        true);
+}
+
 const int NUM_ITEMS = 100000;
 
 BENCHMARK_REGISTER_F(KVStoreBench, Scan)
@@ -204,3 +287,17 @@ BENCHMARK_REGISTER_F(KVStoreBench, Scan)
         ->Args({NUM_ITEMS, ROCKSDB})
 #endif
         ;
+
+BENCHMARK_REGISTER_F(KVStoreBench, GetMultiCold)
+        ->Args({NUM_ITEMS, COUCHSTORE})
+#ifdef EP_USE_ROCKSDB
+        ->Args({NUM_ITEMS, ROCKSDB})
+#endif
+        ;
+
+BENCHMARK_REGISTER_F(KVStoreBench, GetMultiBulkCold)
+        ->Args({NUM_ITEMS, COUCHSTORE})
+#ifdef EP_USE_ROCKSDB
+        ->Args({NUM_ITEMS, ROCKSDB})
+#endif
+        ;
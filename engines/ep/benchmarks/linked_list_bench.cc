@@ -0,0 +1,127 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks relating to the BasicLinkedList (Ephemeral sequence list) class.
+ */
+
+#include "hash_table.h"
+#include "item.h"
+#include "linked_list.h"
+#include "stats.h"
+#include "stored_value_factories.h"
+
+#include "../tests/mock/mock_basic_ll.h"
+#include "../tests/module_tests/test_helpers.h"
+
+#include <benchmark/benchmark.h>
+#include <folly/portability/GTest.h>
+
+#include <atomic>
+#include <thread>
+
+/// What runs concurrently with the front-end appends.
+enum class Background { None = 0, StatsReader = 1, TombstonePurger = 2 };
+
+class BasicLinkedListBench : public benchmark::Fixture {
+public:
+    BasicLinkedListBench()
+        : ht(stats,
+             std::make_unique<OrderedStoredValueFactory>(stats),
+             numItems,
+             1) {
+    }
+
+    void SetUp(benchmark::State& state) override {
+        list = std::make_unique<MockBasicLinkedList>(stats);
+
+        // Populate the HashTable up front, we only want to measure the
+        // list appends.
+        const std::string data("x");
+        osvs.reserve(numItems);
+        for (size_t i = 0; i < numItems; ++i) {
+            auto key = makeStoredDocKey("key" + std::to_string(i));
+            Item item(key, 0, 0, data.data(), data.size());
+            ht.set(item);
+            osvs.push_back(
+                    ht.findForWrite(key).storedValue->toOrderedStoredValue());
+        }
+    }
+
+    void TearDown(benchmark::State& state) override {
+        // Like in a vbucket the list must be erased before the HashTable.
+        list.reset();
+        osvs.clear();
+        ht.clear();
+    }
+
+    static const size_t numItems = 1000000;
+
+    EPStats stats;
+    HashTable ht;
+    std::unique_ptr<MockBasicLinkedList> list;
+    std::vector<OrderedStoredValue*> osvs;
+};
+
+/*
+ * Benchmark appending new items to the sequence list as a front-end set does
+ * (under the vBucket sequence lock and the list writeLock), optionally with a
+ * stats reader or the tombstone purger concurrently accessing the list.
+ */
+BENCHMARK_DEFINE_F(BasicLinkedListBench, Append)(benchmark::State& state) {
+    const auto background = Background(state.range(0));
+    std::atomic<bool> stop{false};
+    std::thread bgThread([this, background, &stop]() {
+        while (!stop) {
+            switch (background) {
+            case Background::None:
+                return;
+            case Background::StatsReader:
+                benchmark::DoNotOptimize(list->getHighSeqno());
+                benchmark::DoNotOptimize(list->getMaxVisibleSeqno());
+                benchmark::DoNotOptimize(list->getNumDeletedItems());
+                break;
+            case Background::TombstonePurger:
+                list->purgeTombstones(list->getHighSeqno() - 1);
+                break;
+            }
+        }
+    });
+
+    std::mutex seqLock;
+    int64_t seqno = 0;
+    while (state.KeepRunning()) {
+        auto& osv = *osvs[seqno];
+        std::lock_guard<std::mutex> seqLg(seqLock);
+        std::lock_guard<std::mutex> listWriteLg(list->getListWriteLock());
+        list->appendToList(seqLg, listWriteLg, osv);
+        osv.setBySeqno(++seqno);
+        list->updateHighSeqno(listWriteLg, osv);
+        list->maybeUpdateMaxVisibleSeqno(seqLg, listWriteLg, osv);
+    }
+
+    stop = true;
+    bgThread.join();
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_REGISTER_F(BasicLinkedListBench, Append)
+        ->ArgName("background")
+        ->Arg(int(Background::None))
+        ->Arg(int(Background::StatsReader))
+        ->Arg(int(Background::TombstonePurger))
+        ->Iterations(BasicLinkedListBench::numItems);
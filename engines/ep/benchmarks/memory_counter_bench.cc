@@ -0,0 +1,78 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of the memory accounting of allocation heavy SETs from many
+ * threads: the update of the core-local memory counters for the new value,
+ * followed by the check of the estimated memory used against the quota.
+ */
+
+#include "stats.h"
+
+#include <benchmark/benchmark.h>
+
+static const size_t quota = 1024 * 1024 * 1024;
+static const size_t valueSize = 1024;
+
+enum class Estimate {
+    // Sum the core-local counters for each check
+    SumOfCores,
+    // Read the counter merged from the cores (mem_used_merge_threshold)
+    Merged
+};
+
+struct BenchStats {
+    BenchStats() {
+        stats.setMemUsedMergeThreshold(quota, 0.5);
+    }
+    EPStats stats;
+};
+
+static EPStats& getStats() {
+    static BenchStats benchStats;
+    return benchStats.stats;
+}
+
+static void BM_MemoryAccountingSet(benchmark::State& state) {
+    const auto estimate = Estimate(state.range(0));
+    state.SetLabel(estimate == Estimate::SumOfCores ? "SumOfCores" : "Merged");
+    auto& stats = getStats();
+
+    size_t overQuota = 0;
+    while (state.KeepRunning()) {
+        stats.coreLocal.get()->currentSize.fetch_add(valueSize);
+        const size_t memUsed =
+                estimate == Estimate::SumOfCores
+                        ? stats.getCurrentSize() + stats.getMemOverhead()
+                        : stats.getMergedMemoryUsed();
+        if (memUsed > quota) {
+            ++overQuota;
+        }
+    }
+    benchmark::DoNotOptimize(overQuota);
+    state.SetItemsProcessed(state.iterations());
+
+    // Leave the counters as found for the next run
+    stats.coreLocal.get()->currentSize.fetch_sub(state.iterations() *
+                                                 valueSize);
+}
+
+BENCHMARK(BM_MemoryAccountingSet)
+        ->Arg(int(Estimate::SumOfCores))
+        ->Arg(int(Estimate::Merged))
+        ->ThreadRange(1, 32)
+        ->UseRealTime();
@@ -0,0 +1,54 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks relating to the VBReadyQueue class.
+ */
+
+#include "vb_ready_queue.h"
+
+#include <benchmark/benchmark.h>
+
+static const size_t maxVBuckets = 1024;
+
+static VBReadyQueue readyQueue(maxVBuckets);
+
+/**
+ * Many front-end threads notifying the same ready queue (as seen when a
+ * large number of DCP producers share the notification path). Thread 0
+ * additionally drains the queue so pushes hit both the "newly queued" and
+ * "already queued" paths.
+ */
+static void BM_PushUniqueContended(benchmark::State& state) {
+    uint16_t vb = uint16_t(state.thread_index);
+    Vbid popped;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(readyQueue.pushUnique(Vbid(vb)));
+        vb = (vb + 1) % maxVBuckets;
+        if (state.thread_index == 0) {
+            readyQueue.popFront(popped);
+        }
+    }
+    if (state.thread_index == 0) {
+        readyQueue.clear();
+    }
+}
+
+BENCHMARK(BM_PushUniqueContended)->Threads(1);
+BENCHMARK(BM_PushUniqueContended)->Threads(8);
+BENCHMARK(BM_PushUniqueContended)->Threads(32);
+BENCHMARK(BM_PushUniqueContended)->ThreadPerCpu();
@@ -19,6 +19,7 @@
 #include "bucket_logger.h"
 #include "configuration.h"
 #include "ep_time.h"
+#include "failover-table.h"
 #include "hash_table.h"
 #include "kv_bucket.h"
 #include "mutation_log.h"
@@ -29,6 +30,7 @@
 #include <platform/dirutils.h>
 #include <platform/platform_time.h>
 
+#include <algorithm>
 #include <memory>
 #include <numeric>
 
@@ -51,8 +53,8 @@ public:
           as(aS),
           items_scanned(0),
           items_to_scan(items_to_scan) {
-        setVBucketFilter(VBucketFilter(
-                _store.getVBuckets().getShard(sh)->getVBuckets()));
+        const auto vbuckets = _store.getVBuckets().getShard(sh)->getVBuckets();
+        setVBucketFilter(VBucketFilter(vbuckets));
         name = conf.getAlogPath();
         name = name + "." + std::to_string(shardID);
         prev = name + ".old";
@@ -68,6 +70,11 @@ public:
                     "Attempting to generate new access file "
                     "'{}'",
                     next);
+            if (std::any_of(vbuckets.begin(), vbuckets.end(), [this](Vbid vb) {
+                    return as.signatures[vb.get()].valid;
+                })) {
+                openCurrentLog();
+            }
         }
     }
 
@@ -100,15 +107,27 @@ public:
         if (log == nullptr) {
             return;
         }
-        HashTable::Position ht_start;
         if (vBucketFilter(vb->getId())) {
-            while (ht_start != vb->ht.endPosition()) {
-                ht_start = vb->ht.pauseResumeVisit(*this, ht_start);
-                update(vb->getId());
-                log->commit1();
-                log->commit2();
-                items_scanned = 0;
+            AccessScanner::VBucketSignature signature;
+            signature.valid = true;
+            signature.uuid = vb->failovers->getLatestUUID();
+            signature.highSeqno = vb->getHighSeqno();
+            signature.numEjects = vb->ht.getNumEjects();
+            signature.numNonResident = vb->ht.getNumInMemoryNonResItems();
+
+            const auto& previous = as.signatures[vb->getId().get()];
+            if (!(previous.valid && previous == signature &&
+                  copyFromCurrentLog(vb->getId()))) {
+                HashTable::Position ht_start;
+                while (ht_start != vb->ht.endPosition()) {
+                    ht_start = vb->ht.pauseResumeVisit(*this, ht_start);
+                    update(vb->getId());
+                    log->commit1();
+                    log->commit2();
+                    items_scanned = 0;
+                }
             }
+            signatures.emplace_back(vb->getId(), signature);
         }
     }
 
@@ -127,6 +146,10 @@ public:
                     std::chrono::duration_cast<std::chrono::microseconds>(
                             std::chrono::steady_clock::now() - taskStart));
 
+            // Done reading the log about to be replaced
+            currentLogIt.reset();
+            currentLog.reset();
+
             if (num_items == 0) {
                 EP_LOG_INFO(
                         "The new access log file is empty. "
@@ -178,14 +201,86 @@ public:
             }
             EP_LOG_INFO(
                     "New access log file '{}' created with "
-                    "{} keys",
+                    "{} keys ({} vBuckets copied from the previous log)",
                     name,
-                    static_cast<uint64_t>(num_items));
+                    static_cast<uint64_t>(num_items),
+                    vbucketsCopied);
+            for (const auto& [vbid, signature] : signatures) {
+                as.signatures[vbid.get()] = signature;
+            }
             updateStateFinalizer(true);
         }
     }
 
 private:
+    /**
+     * Open the current access log of the shard to copy the keys of the
+     * unchanged vBuckets from (it was written by this process, as some of
+     * the signatures are valid).
+     */
+    void openCurrentLog() {
+        if (!cb::io::isFile(name)) {
+            return;
+        }
+        try {
+            currentLog = std::make_unique<MutationLog>(name);
+            currentLog->open(true);
+            currentLogIt = std::make_unique<MutationLog::iterator>(
+                    currentLog->begin());
+        } catch (const MutationLog::ReadException& e) {
+            EP_LOG_WARN("Failed to open access log '{}' to read: {}",
+                        name,
+                        e.what());
+            currentLogIt.reset();
+            currentLog.reset();
+        }
+    }
+
+    /**
+     * Copy the keys of the vBucket from the current access log. The log was
+     * written by visiting the vBuckets in ascending order, so the keys of a
+     * vBucket are contiguous and the log is only read once per run.
+     *
+     * @return false if the keys couldn't be copied (the vBucket must be
+     *         visited instead)
+     */
+    bool copyFromCurrentLog(Vbid vbid) {
+        if (!currentLogIt) {
+            return false;
+        }
+        auto& it = *currentLogIt;
+        try {
+            for (; it != currentLog->end(); ++it) {
+                const auto& le = *it;
+                if (le->type() != MutationLogType::New) {
+                    continue;
+                }
+                if (le->vbucket() > vbid) {
+                    break;
+                }
+                if (le->vbucket() == vbid) {
+                    log->newItem(vbid, StoredDocKey(le->key()));
+                }
+            }
+        } catch (const MutationLog::ReadException& e) {
+            EP_LOG_WARN(
+                    "Failed to read access log '{}', visiting the remaining "
+                    "vBuckets: {}",
+                    name,
+                    e.what());
+            currentLogIt.reset();
+            currentLog.reset();
+            // Any keys already copied are logged twice, which warmup
+            // tolerates
+            return false;
+        }
+        log->commit1();
+        log->commit2();
+        ++vbucketsCopied;
+        ++stats.alogNumVBucketsCopied;
+        return true;
+    }
+
     /**
      * Finalizer method called at the end of completing a visit.
      * @param created_log: Did we successfully create a MutationLog object on
@@ -219,6 +314,12 @@ private:
     std::vector<StoredDocKey> accessed;
 
     std::unique_ptr<MutationLog> log;
+    /// The access log being replaced, and where the copying is up to
+    std::unique_ptr<MutationLog> currentLog;
+    std::unique_ptr<MutationLog::iterator> currentLogIt;
+    /// The signatures of the vBuckets in the new access log
+    std::vector<std::pair<Vbid, AccessScanner::VBucketSignature>> signatures;
+    size_t vbucketsCopied = 0;
     std::atomic<bool> &stateFinalizer;
     AccessScanner &as;
 
@@ -239,6 +340,7 @@ AccessScanner::AccessScanner(KVBucket& _store,
                  sleeptime,
                  completeBeforeShutdown),
       completedCount(0),
+      signatures(_store.getVBuckets().getSize()),
       store(_store),
       conf(conf),
       stats(st),
@@ -309,6 +411,9 @@ bool AccessScanner::run() {
         {
             deleteAccessLogFiles = true;
         }
+        if (deleteAccessLogFiles) {
+            signatures.assign(signatures.size(), {});
+        }
         for (size_t i = 0; i < store.getVBuckets().getNumShards(); i++) {
             if (deleteAccessLogFiles) {
                 std::string name(alogPath + "." + std::to_string(i));
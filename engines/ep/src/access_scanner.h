@@ -19,6 +19,7 @@
 #include "globaltask.h"
 
 #include <string>
+#include <vector>
 
 // Forward declaration.
 class Configuration;
@@ -42,6 +43,36 @@ public:
 
     std::atomic<size_t> completedCount;
 
+    /**
+     * What the access log of a vBucket was generated from. While a
+     * vBucket's signature is unchanged since the current access log was
+     * written it has the same resident keys (every mutation moves the high
+     * seqno, every ejection the ejection count and every bgfetch the number
+     * of non-resident items), so its keys are copied from the current log
+     * rather than visiting its HashTable again.
+     */
+    struct VBucketSignature {
+        bool operator==(const VBucketSignature& other) const {
+            return uuid == other.uuid && highSeqno == other.highSeqno &&
+                   numEjects == other.numEjects &&
+                   numNonResident == other.numNonResident;
+        }
+
+        /// False until the vBucket is in the current access log
+        bool valid = false;
+        uint64_t uuid = 0;
+        int64_t highSeqno = 0;
+        size_t numEjects = 0;
+        size_t numNonResident = 0;
+    };
+
+    /**
+     * The signatures of the vBuckets in the current access logs, indexed by
+     * vBucket. Each shard's ItemAccessVisitor only updates its own vBuckets,
+     * and runs don't overlap.
+     */
+    std::vector<VBucketSignature> signatures;
+
 protected:
     void createAndScheduleTask(size_t shard);
 
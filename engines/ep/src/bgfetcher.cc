@@ -26,7 +26,10 @@
 #include "vbucket_bgfetch_item.h"
 #include <phosphor/phosphor.h>
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <climits>
+#include <map>
 #include <vector>
 
 BgFetcher::BgFetcher(KVBucket& s, KVShard& k)
@@ -70,7 +73,9 @@ void BgFetcher::wakeUpTaskIfSnoozed() {
     }
 }
 
-size_t BgFetcher::doFetch(Vbid vbId, vb_bgfetch_queue_t& itemsToFetch) {
+size_t BgFetcher::doFetch(Vbid vbId,
+                          vb_bgfetch_queue_t& itemsToFetch,
+                          BgFetchPriority priority) {
     TRACE_EVENT2("BgFetcher",
                  "doFetch",
                  "vbid",
@@ -88,6 +93,11 @@ size_t BgFetcher::doFetch(Vbid vbId, vb_bgfetch_queue_t& itemsToFetch) {
                     startTime.time_since_epoch())
                     .count());
 
+    const auto aborted = abortExpiredFetches(itemsToFetch);
+    if (itemsToFetch.empty()) {
+        return aborted;
+    }
+
     shard.getROUnderlying()->getMulti(vbId, itemsToFetch);
 
     std::vector<bgfetched_item_t> fetchedItems;
@@ -104,14 +114,60 @@ size_t BgFetcher::doFetch(Vbid vbId, vb_bgfetch_queue_t& itemsToFetch) {
 
     if (!fetchedItems.empty()) {
         store.completeBGFetchMulti(vbId, fetchedItems, startTime);
+        const auto stopTime = std::chrono::steady_clock::now();
         stats.getMultiHisto.add(
                 std::chrono::duration_cast<std::chrono::microseconds>(
-                        std::chrono::steady_clock::now() - startTime),
+                        stopTime - startTime),
                 fetchedItems.size());
         stats.getMultiBatchSizeHisto.addValue(fetchedItems.size());
+
+        auto& priorityHisto =
+                stats.bgFetchPriorityHisto[static_cast<size_t>(priority)];
+        for (const auto& fetched : fetchedItems) {
+            priorityHisto.add(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            stopTime - fetched.second->initTime));
+        }
+    }
+
+    return fetchedItems.size() + aborted;
+}
+
+size_t BgFetcher::abortExpiredFetches(vb_bgfetch_queue_t& itemsToFetch) {
+    auto& engine = store.getEPEngine();
+    auto* cookieApi = engine.getServerApi()->cookie;
+    const auto now = std::chrono::steady_clock::now();
+    std::map<const void*, ENGINE_ERROR_CODE> toNotify;
+    size_t aborted = 0;
+
+    for (auto fetch = itemsToFetch.begin(); fetch != itemsToFetch.end();) {
+        auto& list = fetch->second.bgfetched_list;
+        for (auto itm = list.begin(); itm != list.end();) {
+            const auto* cookie = (*itm)->getCookie();
+            if (cookie) {
+                const auto deadline = cookieApi->get_deadline(cookie);
+                if (deadline && now > *deadline) {
+                    (*itm)->abort(engine, ENGINE_TMPFAIL, toNotify);
+                    itm = list.erase(itm);
+                    ++aborted;
+                    continue;
+                }
+            }
+            ++itm;
+        }
+
+        if (list.empty()) {
+            fetch = itemsToFetch.erase(fetch);
+        } else {
+            ++fetch;
+        }
     }
 
-    return fetchedItems.size();
+    if (aborted) {
+        stats.bg_fetch_deadline_exceeded += aborted;
+        engine.notifyIOComplete(toNotify);
+    }
+    return aborted;
 }
 
 bool BgFetcher::run(GlobalTask *task) {
@@ -140,8 +196,13 @@ bool BgFetcher::run(GlobalTask *task) {
         pendingVbs.clear();
     }
 
-    size_t num_fetched_items = 0;
-
+    // Split the fetches of every vBucket by priority, so that the fetches
+    // of all of the vBuckets are serviced highest priority first; e.g. the
+    // client reads of the last vBucket aren't stuck behind the XDCR metadata
+    // fetches of the others.
+    std::array<std::vector<std::pair<Vbid, vb_bgfetch_queue_t>>,
+               NumBgFetchPriorities>
+            batches;
     for (const auto vbId : bg_vbs) {
         VBucketPtr vb = shard.getBucket(vbId);
         if (vb) {
@@ -156,9 +217,25 @@ bool BgFetcher::run(GlobalTask *task) {
             }
 
             auto items = vb->getBGFetchItems();
-            if (!items.empty()) {
-                num_fetched_items += doFetch(vbId, items);
+            std::array<vb_bgfetch_queue_t, NumBgFetchPriorities> byPriority;
+            while (!items.empty()) {
+                auto node = items.extract(items.begin());
+                byPriority[static_cast<size_t>(node.mapped().priority)]
+                        .insert(std::move(node));
             }
+            for (size_t ii = 0; ii < NumBgFetchPriorities; ++ii) {
+                if (!byPriority[ii].empty()) {
+                    batches[ii].emplace_back(vbId, std::move(byPriority[ii]));
+                }
+            }
+        }
+    }
+
+    size_t num_fetched_items = 0;
+    for (size_t ii = 0; ii < NumBgFetchPriorities; ++ii) {
+        for (auto& [vbId, items] : batches[ii]) {
+            num_fetched_items +=
+                    doFetch(vbId, items, static_cast<BgFetchPriority>(ii));
         }
     }
 
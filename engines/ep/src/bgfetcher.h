@@ -70,7 +70,24 @@ public:
     }
 
 private:
-    size_t doFetch(Vbid vbId, vb_bgfetch_queue_t& items);
+    /**
+     * Fetch the given items of a vBucket (all of the given priority) from
+     * disk, and complete them.
+     *
+     * @return the number of fetches completed or aborted
+     */
+    size_t doFetch(Vbid vbId,
+                   vb_bgfetch_queue_t& items,
+                   BgFetchPriority priority);
+
+    /**
+     * Remove the fetches of the requests whose deadline has passed (the
+     * client no longer waits for them) from items, and notify the
+     * requests with a temporary failure.
+     *
+     * @return the number of fetches removed
+     */
+    size_t abortExpiredFetches(vb_bgfetch_queue_t& items);
 
     /// If the BGFetch task is currently snoozed (not scheduled to
     /// run), wake it up. Has no effect the if the task has already
@@ -39,6 +39,12 @@ Blob* Blob::Copy(const Blob& other) {
     return t;
 }
 
+Blob* Blob::NewInline(void* buffer, const char* start, const size_t len) {
+    auto* t = new (buffer) Blob(len, inlineFlag);
+    std::memcpy(t->data, start, len);
+    return t;
+}
+
 Blob::Blob(const char* start, const size_t len)
     : size(static_cast<uint32_t>(len)), age(0) {
     if (start != nullptr) {
@@ -54,8 +60,12 @@ Blob::Blob(const char* start, const size_t len)
 Blob::Blob(const size_t len) : Blob(nullptr, len) {
 }
 
+Blob::Blob(const size_t len, uint32_t flags)
+    : size(static_cast<uint32_t>(len) | flags), age(0) {
+}
+
 Blob::Blob(const Blob& other)
-    : size(other.size.load()),
+    : size(other.size.load() & ~inlineFlag),
       // While this is a copy, it is a new allocation therefore reset age.
       age(0) {
     std::memcpy(data, other.data, other.valueSize());
@@ -67,5 +77,7 @@ const std::string Blob::to_s() const {
 }
 
 Blob::~Blob() {
-    ObjectRegistry::onDeleteBlob(this);
+    if (!isInline()) {
+        ObjectRegistry::onDeleteBlob(this);
+    }
 }
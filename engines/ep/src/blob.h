@@ -49,9 +49,33 @@ public:
 
     /**
      * Creates an exact copy of the specified Blob.
+     * (The copy is always a separate allocation, even if other is inline)
      */
     static Blob* Copy(const Blob& other);
 
+    /**
+     * Create a new Blob in a buffer owned by someone else (the inline value
+     * buffer of a StoredValue). An inline Blob isn't freed once the last
+     * reference to it is released (only destroyed), and isn't accounted
+     * for as a Blob in the memory stats (the owner of the buffer is).
+     *
+     * @param buffer where to create the blob, of (at least)
+     *               getInlineStorage(len) bytes
+     * @param start the beginning of the data to copy into this blob
+     * @param len the amount of data to copy in
+     *
+     * @return the new Blob instance
+     */
+    static Blob* NewInline(void* buffer, const char* start, const size_t len);
+
+    /**
+     * Get the number of bytes needed to create an inline Blob of the given
+     * size.
+     */
+    static size_t getInlineStorage(size_t len) {
+        return getAllocationSize(len);
+    }
+
     // Actual accessorish things.
 
     /**
@@ -65,7 +89,14 @@ public:
      * Get the size of this Blob's value.
      */
     size_t valueSize() const {
-        return size & ~(0x80000000);
+        return size & ~(0x80000000 | inlineFlag);
+    }
+
+    /**
+     * Is this Blob created in a buffer of someone else (see NewInline)?
+     */
+    bool isInline() const {
+        return (size & inlineFlag) != 0;
     }
 
     /**
@@ -132,7 +163,12 @@ public:
     class Deleter {
     public:
         void operator()(TaggedPtr<Blob> item) {
-            delete item.get();
+            if (item.get()->isInline()) {
+                // The memory belongs to the owner of the buffer
+                item.get()->~Blob();
+            } else {
+                delete item.get();
+            }
         }
     };
 
@@ -140,6 +176,10 @@ private:
     //Ensure Blob size of 12 bytes by padding by 3.
     static constexpr int paddingSize{3};
 
+    // The second highest bit of size marks the inline Blobs (the values
+    // are a lot smaller than 1 GiB)
+    static constexpr uint32_t inlineFlag{0x40000000};
+
 protected:
     /* Constructor.
      * @param start If non-NULL, pointer to array which will be copied into
@@ -153,6 +193,10 @@ protected:
 
     explicit Blob(const Blob& other);
 
+    /// Create a Blob (for the given size and size flags) without the data
+    /// and without accounting for it in the memory stats
+    Blob(const size_t len, uint32_t flags);
+
     static size_t getAllocationSize(size_t len) {
         return sizeof(Blob) + len - sizeof(Blob(nullptr, 0).data);
     }
@@ -21,7 +21,16 @@
 
 #include "murmurhash3.h"
 
+#include <folly/lang/Assume.h>
+
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #if __x86_64__ || __ppc64__
 #define MURMURHASH_3 MurmurHash3_x64_128
@@ -29,19 +38,58 @@
 #define MURMURHASH_3 MurmurHash3_x86_128
 #endif
 
-BloomFilter::BloomFilter(size_t key_count, double false_positive_prob,
-                         bfilter_status_t new_status) {
+std::string to_string(BloomFilterType type) {
+    switch (type) {
+    case BloomFilterType::Classic:
+        return "classic";
+    case BloomFilterType::Blocked:
+        return "blocked";
+    }
+    folly::assume_unreachable();
+}
+
+BloomFilterType bloomFilterTypeFromString(std::string_view type) {
+    if (type == "classic") {
+        return BloomFilterType::Classic;
+    }
+    if (type == "blocked") {
+        return BloomFilterType::Blocked;
+    }
+    throw std::invalid_argument(
+            "bloomFilterTypeFromString: unknown bloom filter type '" +
+            std::string(type) + "'");
+}
 
+BloomFilter::BloomFilter(size_t key_count,
+                         double false_positive_prob,
+                         bfilter_status_t new_status,
+                         BloomFilterType type)
+    : type(type) {
     status = new_status;
     filterSize = estimateFilterSize(key_count, false_positive_prob);
     noOfHashes = estimateNoOfHashes(key_count);
     keyCounter = 0;
-    bitArray.assign(filterSize, false);
+    if (type == BloomFilterType::Blocked) {
+        // Round up to whole blocks; every key sets one bit per word.
+        const auto numBlocks =
+                std::max(size_t(1),
+                         (filterSize + BitsPerBlock - 1) / BitsPerBlock);
+        filterSize = numBlocks * BitsPerBlock;
+        noOfHashes = WordsPerBlock;
+        blocks.assign(numBlocks, Block{});
+    } else {
+        bitArray.assign(filterSize, false);
+    }
 }
 
 BloomFilter::~BloomFilter() {
     status = BFILTER_DISABLED;
+    clearBits();
+}
+
+void BloomFilter::clearBits() {
     bitArray.clear();
+    blocks.clear();
 }
 
 size_t BloomFilter::estimateFilterSize(size_t key_count,
@@ -62,6 +110,49 @@ uint64_t BloomFilter::hashDocKey(const DocKey& key, uint32_t iteration) {
     return result;
 }
 
+size_t BloomFilter::getBlockMask(const DocKey& key, Block& mask) {
+    // A single hash supplies both the block (upper 32 bits) and the bit
+    // within each word (lower 32 bits, re-mixed per word with an odd salt).
+    static constexpr uint32_t salts[WordsPerBlock] = {0x47b6137bU,
+                                                      0x44974d91U,
+                                                      0x8824ad5bU,
+                                                      0xa2b7289dU,
+                                                      0x705495c7U,
+                                                      0x2df1424bU,
+                                                      0x9efc4947U,
+                                                      0x5c6bfb31U};
+    const uint64_t hash = hashDocKey(key, 0);
+    const auto block =
+            size_t((uint64_t(uint32_t(hash >> 32)) * blocks.size()) >> 32);
+    const auto lower = uint32_t(hash);
+    for (size_t ii = 0; ii < WordsPerBlock; ++ii) {
+        mask.words[ii] = uint64_t(1) << ((lower * salts[ii]) >> 26);
+    }
+    return block;
+}
+
+/// @returns true if every bit set in mask is also set in block.
+static bool blockContains(const uint64_t* block, const uint64_t* mask) {
+#if defined(__SSE2__)
+    __m128i missing = _mm_setzero_si128();
+    for (size_t ii = 0; ii < 8; ii += 2) {
+        const auto b =
+                _mm_load_si128(reinterpret_cast<const __m128i*>(block + ii));
+        const auto m =
+                _mm_load_si128(reinterpret_cast<const __m128i*>(mask + ii));
+        missing = _mm_or_si128(missing, _mm_andnot_si128(b, m));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) ==
+           0xffff;
+#else
+    uint64_t missing = 0;
+    for (size_t ii = 0; ii < 8; ++ii) {
+        missing |= mask[ii] & ~block[ii];
+    }
+    return missing == 0;
+#endif
+}
+
 void BloomFilter::setStatus(bfilter_status_t to) {
     switch (status) {
         case BFILTER_DISABLED:
@@ -72,7 +163,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_PENDING:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                clearBits();
             } else if (to == BFILTER_COMPACTING) {
                 status = to;
             }
@@ -80,7 +171,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_COMPACTING:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                clearBits();
             } else if (to == BFILTER_ENABLED) {
                 status = to;
             }
@@ -88,7 +179,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_ENABLED:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                clearBits();
             } else if (to == BFILTER_COMPACTING) {
                 status = to;
             }
@@ -115,7 +206,17 @@ std::string BloomFilter::getStatusString() {
 }
 
 void BloomFilter::addKey(const DocKey& key) {
-    if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
+    if ((status == BFILTER_COMPACTING || status == BFILTER_ENABLED) &&
+        type == BloomFilterType::Blocked) {
+        Block mask;
+        auto& block = blocks[getBlockMask(key, mask)];
+        if (!blockContains(block.words, mask.words)) {
+            keyCounter++;
+        }
+        for (size_t ii = 0; ii < WordsPerBlock; ++ii) {
+            block.words[ii] |= mask.words[ii];
+        }
+    } else if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
         bool overlap = true;
         for (uint32_t i = 0; i < noOfHashes; i++) {
             uint64_t result = hashDocKey(key, i);
@@ -131,7 +232,12 @@ void BloomFilter::addKey(const DocKey& key) {
 }
 
 bool BloomFilter::maybeKeyExists(const DocKey& key) {
-    if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
+    if ((status == BFILTER_COMPACTING || status == BFILTER_ENABLED) &&
+        type == BloomFilterType::Blocked) {
+        Block mask;
+        const auto& block = blocks[getBlockMask(key, mask)];
+        return blockContains(block.words, mask.words);
+    } else if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
         for (uint32_t i = 0; i < noOfHashes; i++) {
             uint64_t result = hashDocKey(key, i);
             if (bitArray[result % filterSize] == 0) {
@@ -167,3 +273,132 @@ size_t BloomFilter::getNoOfHashes() const {
         return 0;
     }
 }
+
+/**
+ * Header of a serialised BloomFilter; followed by the filter's bits - for
+ * Classic filters packed 8 per byte (bit N at byte N/8, bit N%8), for
+ * Blocked filters the 64-bit words of each block in little-endian order.
+ */
+struct SerialisedBloomFilterHeader {
+    static constexpr uint32_t Magic = 0x424c4f4f; // "BLOO"
+    static constexpr uint8_t Version = 1;
+
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint8_t padding[2];
+    uint64_t filterSize;
+    uint64_t noOfHashes;
+    uint64_t keyCounter;
+};
+static_assert(sizeof(SerialisedBloomFilterHeader) == 32,
+              "SerialisedBloomFilterHeader has unexpected size");
+
+static void putLE64(std::string& out, uint64_t value) {
+    for (int ii = 0; ii < 8; ++ii) {
+        out.push_back(char(value >> (ii * 8)));
+    }
+}
+
+static uint64_t getLE64(const char* in) {
+    uint64_t value = 0;
+    for (int ii = 0; ii < 8; ++ii) {
+        value |= uint64_t(uint8_t(in[ii])) << (ii * 8);
+    }
+    return value;
+}
+
+std::string BloomFilter::serialise() const {
+    if (status != BFILTER_COMPACTING && status != BFILTER_ENABLED) {
+        throw std::logic_error(
+                "BloomFilter::serialise: filter is not populated, status:" +
+                std::to_string(status));
+    }
+    std::string out;
+    const auto bitsBytes = (filterSize + 7) / 8;
+    out.reserve(sizeof(SerialisedBloomFilterHeader) + bitsBytes);
+
+    // Header; all multi-byte fields little-endian.
+    for (int ii = 0; ii < 4; ++ii) {
+        out.push_back(char(SerialisedBloomFilterHeader::Magic >> (ii * 8)));
+    }
+    out.push_back(char(SerialisedBloomFilterHeader::Version));
+    out.push_back(char(type));
+    out.append(2, '\0');
+    putLE64(out, filterSize);
+    putLE64(out, noOfHashes);
+    putLE64(out, keyCounter);
+
+    if (type == BloomFilterType::Blocked) {
+        for (const auto& block : blocks) {
+            for (auto word : block.words) {
+                putLE64(out, word);
+            }
+        }
+    } else {
+        const auto start = out.size();
+        out.append(bitsBytes, '\0');
+        for (size_t ii = 0; ii < filterSize; ++ii) {
+            if (bitArray[ii]) {
+                out[start + ii / 8] |= char(1 << (ii % 8));
+            }
+        }
+    }
+    return out;
+}
+
+std::unique_ptr<BloomFilter> BloomFilter::deserialise(std::string_view data) {
+    const auto headerSize = sizeof(SerialisedBloomFilterHeader);
+    if (data.size() < headerSize) {
+        throw std::invalid_argument(
+                "BloomFilter::deserialise: data too short for header");
+    }
+    const auto magic = uint32_t(getLE64(data.data()) & 0xffffffff);
+    if (magic != SerialisedBloomFilterHeader::Magic ||
+        uint8_t(data[4]) != SerialisedBloomFilterHeader::Version) {
+        throw std::invalid_argument(
+                "BloomFilter::deserialise: unknown magic or version");
+    }
+    const auto type = BloomFilterType(data[5]);
+    if (type != BloomFilterType::Classic && type != BloomFilterType::Blocked) {
+        throw std::invalid_argument("BloomFilter::deserialise: unknown type:" +
+                                    std::to_string(int(data[5])));
+    }
+    const auto filterSize = getLE64(data.data() + 8);
+    const auto noOfHashes = getLE64(data.data() + 16);
+    const auto keyCounter = getLE64(data.data() + 24);
+    const auto body = data.substr(headerSize);
+
+    if (filterSize == 0 ||
+        (type == BloomFilterType::Blocked &&
+         (filterSize % BitsPerBlock != 0 || noOfHashes != WordsPerBlock)) ||
+        body.size() != (filterSize + 7) / 8) {
+        throw std::invalid_argument(
+                "BloomFilter::deserialise: inconsistent filter size:" +
+                std::to_string(filterSize) +
+                " body:" + std::to_string(body.size()));
+    }
+
+    // Construct a minimal filter of the right type then replace its
+    // contents.
+    auto bf = std::make_unique<BloomFilter>(1, 0.5, BFILTER_ENABLED, type);
+    bf->filterSize = filterSize;
+    bf->noOfHashes = noOfHashes;
+    bf->keyCounter = keyCounter;
+    if (type == BloomFilterType::Blocked) {
+        bf->blocks.assign(filterSize / BitsPerBlock, Block{});
+        const char* in = body.data();
+        for (auto& block : bf->blocks) {
+            for (auto& word : block.words) {
+                word = getLE64(in);
+                in += 8;
+            }
+        }
+    } else {
+        bf->bitArray.assign(filterSize, false);
+        for (size_t ii = 0; ii < filterSize; ++ii) {
+            bf->bitArray[ii] = (uint8_t(body[ii / 8]) >> (ii % 8)) & 1;
+        }
+    }
+    return bf;
+}
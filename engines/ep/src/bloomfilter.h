@@ -16,7 +16,10 @@
  */
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 struct DocKey;
@@ -28,6 +31,23 @@ enum bfilter_status_t {
     BFILTER_ENABLED
 };
 
+/**
+ * Layout of the bits of a BloomFilter.
+ */
+enum class BloomFilterType : uint8_t {
+    /// One bit array over the whole filter; each of the k hashes of a key
+    /// selects a bit anywhere in the array.
+    Classic,
+    /// "Split block" filter: the array is divided into 64-byte (cache line)
+    /// blocks of 8 x 64-bit words. A key selects one block and sets exactly
+    /// one bit in each word of it, so a lookup touches a single cache line
+    /// and can be checked with a (SIMD) compare of the whole block. For the
+    /// same size the false positive rate is somewhat higher than Classic.
+    Blocked,
+};
+std::string to_string(BloomFilterType type);
+BloomFilterType bloomFilterTypeFromString(std::string_view type);
+
 /**
  * A bloom filter instance for a vbucket.
  * We are to maintain the vbucket-number of these instances.
@@ -36,8 +56,10 @@ enum bfilter_status_t {
  */
 class BloomFilter {
 public:
-    BloomFilter(size_t key_count, double false_positive_prob,
-                bfilter_status_t newStatus = BFILTER_DISABLED);
+    BloomFilter(size_t key_count,
+                double false_positive_prob,
+                bfilter_status_t newStatus = BFILTER_DISABLED,
+                BloomFilterType type = BloomFilterType::Classic);
     ~BloomFilter();
 
     void setStatus(bfilter_status_t to);
@@ -51,17 +73,56 @@ public:
     size_t getFilterSize();
     size_t getNoOfHashes() const;
 
+    BloomFilterType getType() const {
+        return type;
+    }
+
+    /**
+     * Serialise the filter (its layout, bits and key count) into a
+     * platform-independent byte string suitable for persisting to disk.
+     * Only valid for filters in state COMPACTING or ENABLED.
+     */
+    std::string serialise() const;
+
+    /**
+     * Recreate a filter previously written by serialise(). The returned
+     * filter is in state ENABLED.
+     * @throws std::invalid_argument if data is not a valid serialised filter.
+     */
+    static std::unique_ptr<BloomFilter> deserialise(std::string_view data);
+
 protected:
+    /// Number of 64-bit words (and hence bits set per key) in a block of a
+    /// Blocked filter.
+    static constexpr size_t WordsPerBlock = 8;
+    static constexpr size_t BitsPerBlock = WordsPerBlock * 64;
+
+    struct alignas(64) Block {
+        uint64_t words[WordsPerBlock];
+    };
+
     size_t estimateFilterSize(size_t key_count, double false_positive_prob);
     size_t estimateNoOfHashes(size_t key_count);
 
     uint64_t hashDocKey(const DocKey& key, uint32_t iteration);
 
+    /// Blocked filter: compute the block index and per-word bit masks for
+    /// the given key.
+    size_t getBlockMask(const DocKey& key, Block& mask);
+
+    /// Release the memory used by the filter's bits.
+    void clearBits();
+
     size_t filterSize;
     size_t noOfHashes;
 
     size_t keyCounter;
 
     bfilter_status_t status;
+    const BloomFilterType type;
+
+    /// Bits of a Classic filter.
     std::vector<bool> bitArray;
+    /// Blocks of a Blocked filter.
+    std::vector<Block> blocks;
 };
@@ -218,6 +218,10 @@ public:
         return numSleepers;
     }
 
+    size_t getNumReadyTasksOfType(task_type_t type) override {
+        return numReadyTasks[type];
+    }
+
     size_t schedule(ExTask task) override;
 
 protected:
@@ -136,6 +136,7 @@ void CB3ExecutorThread::run() {
 
             currentTask->getTaskable().logQTime(currentTask->getTaskId(),
                                                 scheduleOverhead);
+            manager->recordTaskWait(taskType, scheduleOverhead);
             // MB-25822: It could be useful to have the exact datetime of long
             // schedule times, in the same way we have for long runtimes.
             // It is more difficult to estimate the expected schedule time than
@@ -194,6 +194,7 @@ Checkpoint::Checkpoint(EPStats& st,
       checkpointState(CHECKPOINT_OPEN),
       numItems(0),
       numMetaItems(0),
+      keyIndexKeyTrackingAllocator(std::make_shared<CheckpointArena>()),
       toWrite(trackingAllocator),
       committedKeyIndex(keyIndexTrackingAllocator),
       preparedKeyIndex(keyIndexTrackingAllocator),
@@ -239,7 +240,7 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
         // Check in the appropriate key index if an item already exists.
         auto& keyIndex =
                 qi->isCommitted() ? committedKeyIndex : preparedKeyIndex;
-        auto it = keyIndex.find(makeIndexKey(qi));
+        auto it = keyIndex.find(makeLookupKey(qi));
 
         // Before de-duplication could discard a delete, store the largest
         // "rev-seqno" encountered
@@ -359,20 +360,12 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
         // the list.
         if (qi->isCheckPointMetaItem()) {
             // Insert the new entry into the metaKeyIndex
-            auto result = metaKeyIndex.emplace(makeIndexKey(qi), entry);
-            if (!result.second) {
-                // Did not manage to insert - so update the value directly
-                result.first->second = entry;
-            }
+            updateIndex(metaKeyIndex, qi, entry);
         } else {
             // Insert the new entry into the keyIndex
             auto& keyIndex =
                     qi->isCommitted() ? committedKeyIndex : preparedKeyIndex;
-            auto result = keyIndex.emplace(makeIndexKey(qi), entry);
-            if (!result.second) {
-                // Did not manage to insert - so update the value directly
-                result.first->second = entry;
-            }
+            updateIndex(keyIndex, qi, entry);
         }
 
         if (rv == QueueDirtyStatus::SuccessNewItem) {
@@ -472,7 +465,7 @@ CheckpointQueue Checkpoint::expelItems(
                 auto& keyIndex = toExpel->isCommitted() ? committedKeyIndex
                                                         : preparedKeyIndex;
 
-                auto itr = keyIndex.find(makeIndexKey(toExpel));
+                auto itr = keyIndex.find(makeLookupKey(toExpel));
                 Expects(itr != keyIndex.end());
                 Expects(itr->second.position == expelItr);
                 itr->second.invalidate(end());
@@ -523,10 +516,25 @@ CheckpointIndexKeyType Checkpoint::makeIndexKey(const queued_item& item) const {
     return CheckpointIndexKeyType(item->getKey(), keyIndexKeyTrackingAllocator);
 }
 
+CheckpointIndexKeyType Checkpoint::makeLookupKey(const queued_item& item) {
+    return CheckpointIndexKeyType(item->getKey());
+}
+
+void Checkpoint::updateIndex(checkpoint_index& index,
+                             const queued_item& item,
+                             const index_entry& entry) {
+    auto itr = index.find(makeLookupKey(item));
+    if (itr != index.end()) {
+        itr->second = entry;
+        return;
+    }
+    index.emplace(makeIndexKey(item), entry);
+}
+
 int64_t Checkpoint::getMutationId(const CheckpointCursor& cursor) const {
     if ((*cursor.currentPos)->isCheckPointMetaItem()) {
         auto cursor_item_idx =
-                metaKeyIndex.find(makeIndexKey(*cursor.currentPos));
+                metaKeyIndex.find(makeLookupKey(*cursor.currentPos));
         if (cursor_item_idx == metaKeyIndex.end()) {
             throw std::logic_error(
                     "Checkpoint::queueDirty: Unable "
@@ -541,7 +549,7 @@ int64_t Checkpoint::getMutationId(const CheckpointCursor& cursor) const {
 
     auto& keyIndex = (*cursor.currentPos)->isCommitted() ? committedKeyIndex
                                                          : preparedKeyIndex;
-    auto cursor_item_idx = keyIndex.find(makeIndexKey(*cursor.currentPos));
+    auto cursor_item_idx = keyIndex.find(makeLookupKey(*cursor.currentPos));
     if (cursor_item_idx == keyIndex.end()) {
         throw std::logic_error(
                 "Checkpoint::queueDirty: Unable "
@@ -570,6 +578,13 @@ void Checkpoint::addStats(const AddStatFn& add_stat, const void* cookie) {
                      getId());
     add_casted_stat(buf, getKeyIndexAllocatorBytes(), add_stat, cookie);
 
+    checked_snprintf(buf,
+                     sizeof(buf),
+                     "vb_%d:id_%" PRIu64 ":key_index_arena_bytes",
+                     vbucketId.get(),
+                     getId());
+    add_casted_stat(buf, getKeyIndexArenaBytes(), add_stat, cookie);
+
     checked_snprintf(buf,
                      sizeof(buf),
                      "vb_%d:id_%" PRIu64 ":to_write_allocator_bytes",
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "checkpoint_arena.h"
 #include "checkpoint_iterator.h"
 #include "checkpoint_types.h"
 #include "ep_types.h"
@@ -24,6 +25,7 @@
 #include "monotonic.h"
 
 #include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
 #include <memcached/engine_common.h>
 #include <platform/non_negative_counter.h>
 #include <utilities/memory_tracking_allocator.h>
@@ -32,7 +34,6 @@
 #include <list>
 #include <map>
 #include <set>
-#include <unordered_map>
 
 #define GIGANTOR ((size_t)1<<(sizeof(size_t)*8-1))
 
@@ -102,13 +103,19 @@ struct index_entry {
 
 /**
  * The checkpoint index maps a key to a checkpoint index_entry.
+ *
+ * The index is a flat (open-addressing) hash map which stores the key and
+ * index_entry inline in its slot array, avoiding a separately allocated node
+ * per key. The slot array is tracked by a MemoryTrackingAllocator; keys too
+ * long to be stored inline in the StoredDocKey live as long as the
+ * Checkpoint, so are allocated from the Checkpoint's CheckpointArena.
  */
-using CheckpointIndexKeyType = StoredDocKeyT<MemoryTrackingAllocator>;
+using CheckpointIndexKeyType = StoredDocKeyT<CheckpointArenaAllocator>;
 using CheckpointIndexValueType =
         std::pair<const CheckpointIndexKeyType, index_entry>;
 
 using checkpoint_index =
-        std::unordered_map<CheckpointIndexKeyType,
+        folly::F14ValueMap<CheckpointIndexKeyType,
                            index_entry,
                            std::hash<CheckpointIndexKeyType>,
                            std::equal_to<>,
@@ -605,15 +612,30 @@ public:
      * references to them.
      */
     size_t getMemoryOverhead() const {
+        return sizeof(Checkpoint) + getKeyIndexMemUsage() +
+               getWriteQueueMemUsage();
+    }
+
+    /**
+     * Returns the memory used by the key indexes of the checkpoint: the
+     * index entries and the keys they are indexed by.
+     */
+    size_t getKeyIndexMemUsage() const {
         // All 3 indexes (preparedKey, committedKey and metaKey) share the
         // same allocator and therefore getting the bytes allocated for the
         // one will include the others.
-        return sizeof(Checkpoint) +
-               *(committedKeyIndex.get_allocator().getBytesAllocated()) +
-               *(toWrite.get_allocator().getBytesAllocated()) +
+        return *(committedKeyIndex.get_allocator().getBytesAllocated()) +
                *(keyIndexKeyTrackingAllocator).getBytesAllocated();
     }
 
+    /**
+     * Returns the memory used by the queue of the checkpoint (the
+     * ref-counted pointers to the items, not the items themselves).
+     */
+    size_t getWriteQueueMemUsage() const {
+        return *(toWrite.get_allocator().getBytesAllocated());
+    }
+
     /**
      * Adds a queued_item to the checkpoint and updates the checkpoint stats
      * accordingly.
@@ -648,6 +670,11 @@ public:
         return ssize_t(*keyIndexTrackingAllocator.getBytesAllocated());
     }
 
+    /// @return bytes of arena blocks reserved for keyIndex/metaKeyIndex keys
+    size_t getKeyIndexArenaBytes() const {
+        return keyIndexKeyTrackingAllocator.getArena()->getReservedBytes();
+    }
+
     /// @return bytes allocated to the toWrite as a signed type
     ssize_t getWriteQueueAllocatorBytes() const {
         return *trackingAllocator.getBytesAllocated();
@@ -662,11 +689,27 @@ public:
 
 private:
     /**
-     * Make a CheckpointIndexKey for inserting items into or finding items in
-     * the key index(es).
+     * Make a CheckpointIndexKey for inserting items into the key index(es).
+     * The key is allocated from the checkpoint's arena.
      */
     CheckpointIndexKeyType makeIndexKey(const queued_item& item) const;
 
+    /**
+     * Make a (temporary) CheckpointIndexKey for finding items in the key
+     * index(es). The key is heap allocated so it does not consume arena
+     * space.
+     */
+    static CheckpointIndexKeyType makeLookupKey(const queued_item& item);
+
+    /**
+     * Set the entry for the given item's key in the index, inserting it if
+     * the key is not yet present. (Only allocates a key if a new entry is
+     * needed, unlike emplace() which constructs the key before finding it.)
+     */
+    void updateIndex(checkpoint_index& index,
+                     const queued_item& item,
+                     const index_entry& entry);
+
     /**
      * When checking if the existing item has already been processed by the
      * persistence cursor we use the mutation_id field in the index_entry (the
@@ -705,7 +748,7 @@ private:
     checkpoint_index::allocator_type keyIndexTrackingAllocator;
 
     // Allocator used for tracking memory that we allocate for the keys of the
-    // key and metaKey keyIndexes
+    // key and metaKey keyIndexes, which allocates from the checkpoint's arena.
     checkpoint_index::key_type::allocator_type keyIndexKeyTrackingAllocator;
 
     CheckpointQueue toWrite;
@@ -0,0 +1,65 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "checkpoint_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+CheckpointArena::~CheckpointArena() {
+    while (head) {
+        auto* next = head->next;
+        ::operator delete(head);
+        head = next;
+    }
+}
+
+void* CheckpointArena::allocate(size_t bytes, size_t align) {
+    auto alignUp = [align](char* p) {
+        const auto addr = reinterpret_cast<uintptr_t>(p);
+        return reinterpret_cast<char*>((addr + align - 1) & ~(align - 1));
+    };
+
+    char* p = cursor ? alignUp(cursor) : nullptr;
+    if (!p || p + bytes > blockEnd) {
+        allocateBlock(bytes + align);
+        p = alignUp(cursor);
+    }
+    cursor = p + bytes;
+    return p;
+}
+
+void CheckpointArena::allocateBlock(size_t minBytes) {
+    // The usable space starts after the (max_align_t aligned) block header.
+    constexpr size_t headerSize =
+            (sizeof(Block) + alignof(std::max_align_t) - 1) &
+            ~(alignof(std::max_align_t) - 1);
+
+    const auto size = std::max(nextBlockSize, minBytes + headerSize);
+    auto* block = static_cast<Block*>(::operator new(size));
+    block->next = head;
+    block->size = size;
+    head = block;
+
+    cursor = reinterpret_cast<char*>(block) + headerSize;
+    blockEnd = reinterpret_cast<char*>(block) + size;
+
+    nextBlockSize = std::min(nextBlockSize * 2, MaxBlockSize);
+    ++numBlocks;
+    reservedBytes += size;
+}
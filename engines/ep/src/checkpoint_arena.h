@@ -0,0 +1,205 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/non_negative_counter.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * A bump allocator owned by a single Checkpoint.
+ *
+ * The keys held by a Checkpoint's key indexes are never removed
+ * individually - de-duplication updates an entry in place and expelling only
+ * invalidates it - so they all share the lifetime of the Checkpoint. Carving
+ * them out of a few large blocks, rather than allocating each one from the
+ * general purpose allocator, means that destroying a Checkpoint releases its
+ * index memory as a handful of blocks and avoids interleaving long-lived
+ * small allocations with the rest of the heap.
+ *
+ * Blocks start small (many vBuckets may each have an open checkpoint holding
+ * a handful of keys) and double in size up to MaxBlockSize.
+ *
+ * Not thread-safe; callers must serialise allocations (Checkpoint is only
+ * modified under the CheckpointManager queueLock). getReservedBytes() may be
+ * called concurrently.
+ */
+class CheckpointArena {
+public:
+    /// Size of the first block allocated.
+    static constexpr size_t InitialBlockSize = 512;
+    /// Largest block size the arena grows to.
+    static constexpr size_t MaxBlockSize = 64 * 1024;
+    /**
+     * Allocations larger than this (e.g. a hash table's bucket array, which
+     * is replaced when it grows) are not served from the arena - they would
+     * waste a large part of a block when freed.
+     */
+    static constexpr size_t MaxAllocationSize = 256;
+
+    CheckpointArena() = default;
+    ~CheckpointArena();
+
+    CheckpointArena(const CheckpointArena&) = delete;
+    CheckpointArena& operator=(const CheckpointArena&) = delete;
+
+    /**
+     * Allocate bytes from the arena, aligned to align. The memory is only
+     * released when the arena is destroyed.
+     */
+    void* allocate(size_t bytes, size_t align);
+
+    /// @return the total size of the blocks allocated by the arena.
+    size_t getReservedBytes() const {
+        return reservedBytes;
+    }
+
+    /// @return the number of blocks allocated by the arena.
+    size_t getNumBlocks() const {
+        return numBlocks;
+    }
+
+private:
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+
+    void allocateBlock(size_t minBytes);
+
+    Block* head = nullptr;
+    char* cursor = nullptr;
+    char* blockEnd = nullptr;
+    size_t nextBlockSize = InitialBlockSize;
+    size_t numBlocks = 0;
+    std::atomic<size_t> reservedBytes{0};
+};
+
+/**
+ * Allocator which serves allocations from a CheckpointArena, tracking the
+ * bytes requested in the same way as MemoryTrackingAllocator (so the
+ * Checkpoint memory overhead stats are unchanged).
+ *
+ * A default-constructed allocator has no arena and allocates from the heap;
+ * this is used for temporary keys (e.g. to lookup the key index) which would
+ * otherwise consume arena space each time they are created.
+ */
+template <class T>
+class CheckpointArenaAllocator {
+public:
+    using value_type = T;
+
+    CheckpointArenaAllocator() noexcept
+        : bytesAllocated(std::make_shared<cb::NonNegativeCounter<size_t>>(0)) {
+    }
+
+    explicit CheckpointArenaAllocator(
+            std::shared_ptr<CheckpointArena> arena) noexcept
+        : arena(std::move(arena)),
+          bytesAllocated(std::make_shared<cb::NonNegativeCounter<size_t>>(0)) {
+    }
+
+    template <class U>
+    explicit CheckpointArenaAllocator(
+            CheckpointArenaAllocator<U> const& other) noexcept
+        /**
+         * Used during a rebind and therefore need to copy over the arena and
+         * byteAllocated shared pointers.
+         */
+        : arena(other.getArena()), bytesAllocated(other.getBytesAllocated()) {
+    }
+
+    CheckpointArenaAllocator(const CheckpointArenaAllocator& other) noexcept =
+            default;
+
+    // As MemoryTrackingAllocator; a moved-from container may still need to
+    // deallocate, so moves copy the shared state.
+    CheckpointArenaAllocator(CheckpointArenaAllocator&& other) noexcept
+        : arena(other.getArena()), bytesAllocated(other.getBytesAllocated()) {
+    }
+
+    CheckpointArenaAllocator& operator=(
+            const CheckpointArenaAllocator& other) noexcept = default;
+
+    CheckpointArenaAllocator& operator=(
+            CheckpointArenaAllocator&& other) noexcept {
+        arena = other.getArena();
+        bytesAllocated = other.getBytesAllocated();
+        return *this;
+    }
+
+    value_type* allocate(std::size_t n) {
+        const auto bytes = n * sizeof(T);
+        *bytesAllocated += bytes;
+        if (fromArena(bytes)) {
+            return static_cast<value_type*>(
+                    arena->allocate(bytes, alignof(T)));
+        }
+        return static_cast<value_type*>(::operator new(bytes));
+    }
+
+    void deallocate(value_type* p, std::size_t n) noexcept {
+        const auto bytes = n * sizeof(T);
+        *bytesAllocated -= bytes;
+        if (fromArena(bytes)) {
+            // Released with the arena.
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    CheckpointArenaAllocator select_on_container_copy_construction() const {
+        /**
+         * A copy of a container gets its own (heap) allocator; it should not
+         * extend the lifetime of, or be accounted against, this arena.
+         */
+        return CheckpointArenaAllocator();
+    }
+
+    auto getBytesAllocated() const {
+        return bytesAllocated;
+    }
+
+    const std::shared_ptr<CheckpointArena>& getArena() const {
+        return arena;
+    }
+
+private:
+    bool fromArena(size_t bytes) const {
+        return arena && bytes <= CheckpointArena::MaxAllocationSize;
+    }
+
+    std::shared_ptr<CheckpointArena> arena;
+    std::shared_ptr<cb::NonNegativeCounter<size_t>> bytesAllocated;
+};
+
+// Memory allocated by one allocator can only be deallocated by another if
+// they share the same arena (or neither has one).
+template <class T, class U>
+bool operator==(CheckpointArenaAllocator<T> const& a,
+                CheckpointArenaAllocator<U> const& b) noexcept {
+    return a.getArena() == b.getArena() &&
+           a.getBytesAllocated() == b.getBytesAllocated();
+}
+
+template <class T, class U>
+bool operator!=(CheckpointArenaAllocator<T> const& a,
+                CheckpointArenaAllocator<U> const& b) noexcept {
+    return !(a == b);
+}
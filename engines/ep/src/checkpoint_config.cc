@@ -45,6 +45,10 @@ public:
             config.allowItemNumBasedNewCheckpoint(value);
         } else if (key.compare("keep_closed_chks") == 0) {
             config.allowKeepClosedCheckpoints(value);
+        } else if (key.compare("chk_expel_eager") == 0) {
+            config.allowEagerExpel(value);
+        } else if (key.compare("chk_value_compression") == 0) {
+            config.allowValueCompression(value);
         }
     }
 
@@ -58,7 +62,8 @@ CheckpointConfig::CheckpointConfig()
       maxCheckpoints(DEFAULT_MAX_CHECKPOINTS),
       itemNumBasedNewCheckpoint(true),
       keepClosedCheckpoints(false),
-      persistenceEnabled(true) { /* empty */
+      persistenceEnabled(true),
+      eagerExpel(false) { /* empty */
 }
 
 CheckpointConfig::CheckpointConfig(rel_time_t period,
@@ -66,13 +71,15 @@ CheckpointConfig::CheckpointConfig(rel_time_t period,
                                    size_t max_ckpts,
                                    bool item_based_new_ckpt,
                                    bool keep_closed_ckpts,
-                                   bool persistence_enabled)
+                                   bool persistence_enabled,
+                                   bool eager_expel)
     : checkpointPeriod(period),
       checkpointMaxItems(max_items),
       maxCheckpoints(max_ckpts),
       itemNumBasedNewCheckpoint(item_based_new_ckpt),
       keepClosedCheckpoints(keep_closed_ckpts),
-      persistenceEnabled(persistence_enabled) {
+      persistenceEnabled(persistence_enabled),
+      eagerExpel(eager_expel) {
 }
 
 CheckpointConfig::CheckpointConfig(EventuallyPersistentEngine& e) {
@@ -83,6 +90,8 @@ CheckpointConfig::CheckpointConfig(EventuallyPersistentEngine& e) {
     itemNumBasedNewCheckpoint = config.isItemNumBasedNewChk();
     keepClosedCheckpoints = config.isKeepClosedChks();
     persistenceEnabled = config.getBucketType() == "persistent";
+    eagerExpel = config.isChkExpelEager();
+    valueCompression = config.isChkValueCompression();
 }
 
 void CheckpointConfig::addConfigChangeListener(
@@ -103,6 +112,12 @@ void CheckpointConfig::addConfigChangeListener(
     configuration.addValueChangedListener(
             "keep_closed_chks",
             std::make_unique<ChangeListener>(engine.getCheckpointConfig()));
+    configuration.addValueChangedListener(
+            "chk_expel_eager",
+            std::make_unique<ChangeListener>(engine.getCheckpointConfig()));
+    configuration.addValueChangedListener(
+            "chk_value_compression",
+            std::make_unique<ChangeListener>(engine.getCheckpointConfig()));
 }
 
 bool CheckpointConfig::validateCheckpointMaxItemsParam(
@@ -34,7 +34,8 @@ public:
                      size_t max_ckpts,
                      bool item_based_new_ckpt,
                      bool keep_closed_ckpts,
-                     bool persistence_enabled);
+                     bool persistence_enabled,
+                     bool eager_expel = false);
 
     explicit CheckpointConfig(EventuallyPersistentEngine& e);
 
@@ -62,6 +63,14 @@ public:
         return persistenceEnabled;
     }
 
+    bool isEagerExpelEnabled() const {
+        return eagerExpel;
+    }
+
+    bool isValueCompressionEnabled() const {
+        return valueCompression;
+    }
+
 protected:
     friend class CheckpointConfigChangeListener;
     friend class EventuallyPersistentEngine;
@@ -82,6 +91,14 @@ protected:
         keepClosedCheckpoints = value;
     }
 
+    void allowEagerExpel(bool value) {
+        eagerExpel = value;
+    }
+
+    void allowValueCompression(bool value) {
+        valueCompression = value;
+    }
+
     static void addConfigChangeListener(EventuallyPersistentEngine& engine);
 
 private:
@@ -104,4 +121,13 @@ private:
 
     // Flag indicating if persistence is enabled.
     bool persistenceEnabled;
+
+    // Flag indicating if the items behind the slowest cursor are expelled
+    // as soon as the cursor moves (rather than by the checkpoint remover
+    // under memory pressure).
+    bool eagerExpel;
+
+    // Flag indicating if the values are snappy compressed when they're
+    // queued into the checkpoints.
+    bool valueCompression = false;
 };
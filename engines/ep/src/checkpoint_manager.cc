@@ -28,6 +28,7 @@
 #include "vbucket.h"
 #include "vbucket_state.h"
 
+#include <algorithm>
 #include <utility>
 
 #include <gsl.h>
@@ -52,7 +53,7 @@ CheckpointManager::CheckpointManager(EPStats& st,
       maxVisibleSeqno(maxVisibleSeqno),
       pCursorPreCheckpointId(0),
       flusherCB(std::move(cb)) {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
 
     lastBySeqno.setLabel("CheckpointManager(" + vbucketId.to_string() +
                          ")::lastBySeqno");
@@ -81,7 +82,7 @@ uint64_t CheckpointManager::getOpenCheckpointId_UNLOCKED(const LockHolder& lh) {
 }
 
 uint64_t CheckpointManager::getOpenCheckpointId() {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return getOpenCheckpointId_UNLOCKED(lh);
 }
 
@@ -92,12 +93,12 @@ uint64_t CheckpointManager::getLastClosedCheckpointId_UNLOCKED(
 }
 
 uint64_t CheckpointManager::getLastClosedCheckpointId() {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return getLastClosedCheckpointId_UNLOCKED(lh);
 }
 
 void CheckpointManager::setOpenCheckpointId(uint64_t id) {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     setOpenCheckpointId_UNLOCKED(lh, id);
 }
 
@@ -274,7 +275,7 @@ void CheckpointManager::addOpenCheckpoint(
 
 CursorRegResult CheckpointManager::registerCursorBySeqno(
         const std::string& name, uint64_t startBySeqno) {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return registerCursorBySeqno_UNLOCKED(lh, name, startBySeqno);
 }
 
@@ -374,18 +375,27 @@ void CheckpointManager::registerBackupPersistenceCursor(const LockHolder& lh) {
 }
 
 bool CheckpointManager::removeCursor(CheckpointCursor* cursor) {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return removeCursor_UNLOCKED(cursor);
 }
 
 void CheckpointManager::removeBackupPersistenceCursor() {
-    LockHolder lh(queueLock);
-    const auto res = removeCursor_UNLOCKED(cursors.at(backupPCursorName).get());
-    Expects(res);
+    {
+        auto lh = lockQueue();
+        const auto res =
+                removeCursor_UNLOCKED(cursors.at(backupPCursorName).get());
+        Expects(res);
+    }
+
+    // The flush succeeded, the items between the backup and the pcursor
+    // are no longer needed for persistence
+    if (checkpointConfig.isEagerExpelEnabled()) {
+        expelUnreferencedCheckpointItems();
+    }
 }
 
 void CheckpointManager::resetPersistenceCursor() {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
 
     // Note: the logic here relies on the existing cursor copy-ctor and
     //  CM::removeCursor function for getting the checkpoint num-cursors
@@ -485,7 +495,7 @@ size_t CheckpointManager::removeClosedUnrefCheckpoints(
     // returns).
     CheckpointList unrefCheckpointList;
     {
-        LockHolder lh(queueLock);
+        auto lh = lockQueue();
         uint64_t oldCheckpointId = 0;
         bool canCreateNewCheckpoint = false;
         if (checkpointList.size() < checkpointConfig.getMaxCheckpoints() ||
@@ -574,7 +584,7 @@ CheckpointManager::ExpelResult
 CheckpointManager::expelUnreferencedCheckpointItems() {
     CheckpointQueue expelledItems;
     {
-        LockHolder lh(queueLock);
+        auto lh = lockQueue();
 
         Checkpoint* oldestCheckpoint = checkpointList.front().get();
 
@@ -711,7 +721,16 @@ CheckpointManager::expelUnreferencedCheckpointItems() {
 }
 
 std::vector<Cursor> CheckpointManager::getListOfCursorsToDrop() {
-    LockHolder lh(queueLock);
+    std::vector<Cursor> cursorsToDrop;
+    for (const auto& candidate : getCursorDropCandidates()) {
+        cursorsToDrop.emplace_back(candidate.cursor);
+    }
+    return cursorsToDrop;
+}
+
+std::vector<CheckpointManager::CursorDropCandidate>
+CheckpointManager::getCursorDropCandidates() {
+    auto lh = lockQueue();
 
     Checkpoint* persistentCheckpoint =
             (persistenceCursor == nullptr)
@@ -725,46 +744,66 @@ std::vector<Cursor> CheckpointManager::getListOfCursorsToDrop() {
                     : nullptr;
 
     /*
-     * Iterate through the list of checkpoints and add the checkpoint to
-     * a set of valid checkpoints until we reach either an open checkpoint
-     * or a checkpoint that contains the persistence cursor or the
-     * backup-pcursor.
+     * Group the cursors by the checkpoint they reside in, so that the
+     * candidates can be returned in checkpoint order below.
+     */
+    std::unordered_map<Checkpoint*, std::vector<CursorDropCandidate>>
+            cursorsByChkpt;
+    for (const auto& cursor : cursors) {
+        CursorDropCandidate candidate;
+        candidate.cursor = Cursor(cursor.second);
+        candidate.backfillItems =
+                getNumItemsForCursor_UNLOCKED(cursor.second.get());
+        cursorsByChkpt[cursor.second->currentCheckpoint->get()].push_back(
+                std::move(candidate));
+    }
+
+    /*
+     * Iterate through the list of checkpoints until we reach either an open
+     * checkpoint or a checkpoint that contains the persistence cursor or the
+     * backup-pcursor. Every cursor in the checkpoints before that point can
+     * be dropped.
+     *
+     * Dropping the cursors of a checkpoint (once all older cursors have been
+     * dropped) unreferences that checkpoint and any following checkpoints up
+     * to the next one holding a cursor, that memory is attributed to the last
+     * candidate of the checkpoint. Within a checkpoint the cursors furthest
+     * behind are returned first.
      */
-    std::unordered_set<Checkpoint*> validChkpts;
+    std::vector<CursorDropCandidate> cursorsToDrop;
+    CursorDropCandidate* lastCandidate = nullptr;
     for (const auto& chkpt : checkpointList) {
         if (persistentCheckpoint == chkpt.get() ||
             backupCheckpoint == chkpt.get() ||
             chkpt->getState() == CHECKPOINT_OPEN) {
             break;
-        } else {
-            validChkpts.insert(chkpt.get());
         }
-    }
-
-    /*
-     * If we cannot find any valid checkpoints to remove cursors from
-     * then just return an empty vector.
-     */
-    if (validChkpts.empty()) {
-        return {};
-    }
-
-    /*
-     * Iterate through all cursors and if the cursor resides in one of the
-     * valid checkpoints (i.e. a checkpoint that cursors can be deleted
-     * from) then add the cursor to the cursorsToDrop vector.
-     */
-    std::vector<Cursor> cursorsToDrop;
-    for (const auto& cursor : cursors) {
-        if (validChkpts.count(cursor.second->currentCheckpoint->get()) > 0) {
-            cursorsToDrop.emplace_back(cursor.second);
+        auto itr = cursorsByChkpt.find(chkpt.get());
+        if (itr == cursorsByChkpt.end()) {
+            // Either already unreferenced (before the first cursor) or freed
+            // along with the checkpoint of the last candidate.
+            if (lastCandidate) {
+                lastCandidate->memoryFreed += chkpt->getMemConsumption();
+            }
+            continue;
         }
+        auto& group = itr->second;
+        std::sort(group.begin(),
+                  group.end(),
+                  [](const auto& a, const auto& b) {
+                      return a.backfillItems > b.backfillItems;
+                  });
+        for (auto& candidate : group) {
+            cursorsToDrop.push_back(std::move(candidate));
+        }
+        lastCandidate = &cursorsToDrop.back();
+        lastCandidate->memoryFreed = chkpt->getMemConsumption();
     }
     return cursorsToDrop;
 }
 
 bool CheckpointManager::hasClosedCheckpointWhichCanBeRemoved() const {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     // Check oldest checkpoint; if closed and contains no cursors then
     // we can remove it (and possibly additional old-but-not-oldest
     // checkpoints).
@@ -774,7 +813,7 @@ bool CheckpointManager::hasClosedCheckpointWhichCanBeRemoved() const {
 }
 
 bool CheckpointManager::isEligibleForCheckpointRemovalAfterPersistence() const {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
 
     const auto& oldestCkpt = checkpointList.front();
 
@@ -825,7 +864,7 @@ bool CheckpointManager::queueDirty(
         const GenerateBySeqno generateBySeqno,
         const GenerateCas generateCas,
         PreLinkDocumentContext* preLinkDocumentContext) {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
 
     bool canCreateNewCheckpoint = false;
     if (checkpointList.size() < checkpointConfig.getMaxCheckpoints() ||
@@ -938,7 +977,7 @@ void CheckpointManager::queueSetVBState(VBucket& vb) {
     auto vbstate = vb.getTransitionState();
 
     // Take lock to serialize use of {lastBySeqno} and to queue op.
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
 
     // Create the setVBState operation, and enqueue it.
     queued_item item = createCheckpointItem(/*id*/0, vbucketId,
@@ -979,15 +1018,43 @@ CheckpointManager::ItemsForCursor CheckpointManager::getItemsForCursor(
         size_t approxLimit) {
     Expects(approxLimit > 0);
 
-    LockHolder lh(queueLock);
-    if (!cursorPtr) {
-        EP_LOG_WARN("getItemsForCursor(): Caller had a null cursor {}",
-                    vbucketId);
-        return {};
+    ItemsForCursor result;
+    bool expelBehindCursor = false;
+    {
+        auto lh = lockQueue();
+        if (!cursorPtr) {
+            EP_LOG_WARN("getItemsForCursor(): Caller had a null cursor {}",
+                        vbucketId);
+            return {};
+        }
+
+        // Only a cursor in the oldest checkpoint may be the slowest one, and
+        // leave expellable items behind when it moves. The pcursor can't:
+        // the backup pcursor holds its position until the flush succeeded
+        // (see removeBackupPersistenceCursor).
+        expelBehindCursor = checkpointConfig.isEagerExpelEnabled() &&
+                            cursorPtr != persistenceCursor &&
+                            cursorPtr->valid() &&
+                            cursorPtr->currentCheckpoint->get() ==
+                                    checkpointList.front().get();
+
+        result = getItemsForCursor_UNLOCKED(
+                lh, *cursorPtr, items, approxLimit);
+    }
+
+    if (expelBehindCursor) {
+        // Re-acquires the queueLock, the expelled items are freed outside it
+        expelUnreferencedCheckpointItems();
     }
 
-    auto& cursor = *cursorPtr;
+    return result;
+}
 
+CheckpointManager::ItemsForCursor CheckpointManager::getItemsForCursor_UNLOCKED(
+        const LockHolder& lh,
+        CheckpointCursor& cursor,
+        std::vector<queued_item>& items,
+        size_t approxLimit) {
     // Fetch whole checkpoints; as long as we don't exceed the approx item
     // limit.
     ItemsForCursor result(
@@ -1007,7 +1074,7 @@ CheckpointManager::ItemsForCursor CheckpointManager::getItemsForCursor(
 
     // For persistence, we register a backup pcursor for resetting the pcursor
     // to the backup position if persistence fails.
-    if (cursorPtr == persistenceCursor) {
+    if (&cursor == persistenceCursor) {
         registerBackupPersistenceCursor(lh);
         result.flushHandle = std::make_unique<FlushHandle>(*this);
     }
@@ -1136,18 +1203,18 @@ void CheckpointManager::notifyFlusher() {
 }
 
 int64_t CheckpointManager::getHighSeqno() const {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return lastBySeqno;
 }
 
 uint64_t CheckpointManager::getMaxVisibleSeqno() const {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return maxVisibleSeqno;
 }
 
 std::shared_ptr<CheckpointCursor>
 CheckpointManager::getBackupPersistenceCursor() {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     const auto exists = cursors.find(backupPCursorName) != cursors.end();
     return exists ? cursors[backupPCursorName] : nullptr;
 }
@@ -1157,7 +1224,7 @@ void CheckpointManager::dump() const {
 }
 
 void CheckpointManager::clear(VBucket& vb, uint64_t seqno) {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     clear_UNLOCKED(vb.getState(), seqno);
 
     // Reset the disk write queue size stat for the vbucket
@@ -1239,7 +1306,7 @@ bool CheckpointManager::moveCursorToNextCheckpoint(CheckpointCursor &cursor) {
 }
 
 size_t CheckpointManager::getNumOpenChkItems() const {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return getOpenCheckpoint_UNLOCKED(lh).getNumItems();
 }
 
@@ -1271,7 +1338,7 @@ uint64_t CheckpointManager::checkOpenCheckpoint_UNLOCKED(const LockHolder& lh,
 
 size_t CheckpointManager::getNumItemsForCursor(
         const CheckpointCursor* cursor) const {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return getNumItemsForCursor_UNLOCKED(cursor);
 }
 
@@ -1299,7 +1366,7 @@ size_t CheckpointManager::getNumItemsForCursor_UNLOCKED(
 }
 
 void CheckpointManager::clear(vbucket_state_t vbState) {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     clear_UNLOCKED(vbState, lastBySeqno);
 }
 
@@ -1326,7 +1393,7 @@ void CheckpointManager::createSnapshot(
     if (checkpointType == CheckpointType::Disk) {
         Expects(highCompletedSeqno.has_value());
     }
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
     const auto openCkptId = openCkpt.getId();
     if (openCkpt.getNumItems() == 0) {
@@ -1352,14 +1419,14 @@ void CheckpointManager::createSnapshot(
 void CheckpointManager::updateCurrentSnapshot(uint64_t snapEnd,
                                               uint64_t visibleSnapEnd,
                                               CheckpointType checkpointType) {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     auto& ckpt = getOpenCheckpoint_UNLOCKED(lh);
     ckpt.setSnapshotEndSeqno(snapEnd, visibleSnapEnd);
     ckpt.setCheckpointType(checkpointType);
 }
 
 snapshot_info_t CheckpointManager::getSnapshotInfo() {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
 
     const auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
 
@@ -1384,7 +1451,7 @@ snapshot_info_t CheckpointManager::getSnapshotInfo() {
 }
 
 uint64_t CheckpointManager::getOpenSnapshotStartSeqno() const {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     const auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
 
     return openCkpt.getSnapshotStartSeqno();
@@ -1392,7 +1459,7 @@ uint64_t CheckpointManager::getOpenSnapshotStartSeqno() const {
 
 uint64_t CheckpointManager::getVisibleSnapshotEndSeqno() const {
     // Follow what getSnapshotInfo does, but only for visible end-seqno
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     const auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
 
     // This clause is also in getSnapshotInfo, if we have no items for the open
@@ -1405,6 +1472,13 @@ uint64_t CheckpointManager::getVisibleSnapshotEndSeqno() const {
     return openCkpt.getVisibleSnapshotEndSeqno();
 }
 
+ProfiledLockHolder CheckpointManager::lockQueue(const char* site) const {
+    return {queueLock,
+            stats.lockProfiler,
+            LockProfiler::Lock::CheckpointQueue,
+            site};
+}
+
 queued_item CheckpointManager::createCheckpointItem(uint64_t id,
                                                     Vbid vbid,
                                                     queue_op checkpoint_op) {
@@ -1450,7 +1524,7 @@ queued_item CheckpointManager::createCheckpointItem(uint64_t id,
 }
 
 uint64_t CheckpointManager::createNewCheckpoint() {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
 
     const auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
 
@@ -1463,12 +1537,12 @@ uint64_t CheckpointManager::createNewCheckpoint() {
 }
 
 uint64_t CheckpointManager::getPersistenceCursorPreChkId() {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return pCursorPreCheckpointId;
 }
 
 void CheckpointManager::itemsPersisted() {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     auto itr = persistenceCursor->currentCheckpoint;
     pCursorPreCheckpointId = ((*itr)->getId() > 0) ? (*itr)->getId() - 1 : 0;
 }
@@ -1490,12 +1564,12 @@ size_t CheckpointManager::getMemoryOverhead_UNLOCKED() const {
 }
 
 size_t CheckpointManager::getMemoryUsage() const {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return getMemoryUsage_UNLOCKED();
 }
 
 size_t CheckpointManager::getMemoryUsageOfUnrefCheckpoints() const {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
 
     size_t memUsage = 0;
     for (const auto& checkpoint : checkpointList) {
@@ -1509,13 +1583,43 @@ size_t CheckpointManager::getMemoryUsageOfUnrefCheckpoints() const {
 }
 
 size_t CheckpointManager::getMemoryOverhead() const {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     return getMemoryOverhead_UNLOCKED();
 }
 
+CheckpointMemoryUsage CheckpointManager::getMemoryUsages() const {
+    auto lh = lockQueue();
+    CheckpointMemoryUsage ret;
+    bool unreferenced = true;
+    for (const auto& checkpoint : checkpointList) {
+        const auto usage = checkpoint->getMemConsumption();
+        ret.usage += usage;
+        ret.overhead += checkpoint->getMemoryOverhead();
+        // The unreferenced checkpoints are the ones before the first
+        // checkpoint with a cursor
+        unreferenced = unreferenced && checkpoint->isNoCursorsInCheckpoint();
+        if (unreferenced) {
+            ret.unreferenced += usage;
+        }
+    }
+    return ret;
+}
+
+CheckpointManager::MemoryBreakdown CheckpointManager::getMemoryBreakdown()
+        const {
+    auto lh = lockQueue();
+    MemoryBreakdown ret;
+    for (const auto& checkpoint : checkpointList) {
+        ret.queuedItems += checkpoint->getQueuedItemsMemUsage();
+        ret.keyIndex += checkpoint->getKeyIndexMemUsage();
+        ret.queue += sizeof(Checkpoint) + checkpoint->getWriteQueueMemUsage();
+    }
+    return ret;
+}
+
 void CheckpointManager::addStats(const AddStatFn& add_stat,
                                  const void* cookie) {
-    LockHolder lh(queueLock);
+    auto lh = lockQueue();
     char buf[256];
 
     try {
@@ -20,6 +20,7 @@
 #include "checkpoint_types.h"
 #include "cursor.h"
 #include "ep_types.h"
+#include "lock_profiler.h"
 #include "monotonic.h"
 #include "queue_op.h"
 
@@ -205,6 +206,8 @@ public:
 
     /**
      * Removes the backup persistence cursor created at getItemsForCursor().
+     * If eager expel is enabled, then expels the items the persistence
+     * cursor has left behind.
      */
     void removeBackupPersistenceCursor();
 
@@ -278,6 +281,9 @@ public:
      * Note: It is only valid to fetch complete checkpoints; as such we cannot
      * limit to a precise number of items.
      *
+     * If eager expel is enabled (chk_expel_eager) and the cursor was the
+     * slowest one, the items it left behind are expelled before returning.
+     *
      * @param cursor CheckpointCursor to read items from and advance
      * @param[in/out] items container which items will be appended to.
      * @param approxLimit Approximate number of items to add.
@@ -409,13 +415,55 @@ public:
      */
     size_t getMemoryUsageOfUnrefCheckpoints() const;
 
+    /// The memory used by all the checkpoints managed, by component
+    struct MemoryBreakdown {
+        /// The items queued (see Checkpoint::getQueuedItemsMemUsage)
+        size_t queuedItems = 0;
+        /// The key indexes (see Checkpoint::getKeyIndexMemUsage)
+        size_t keyIndex = 0;
+        /// The queues and the Checkpoint objects
+        size_t queue = 0;
+    };
+
+    MemoryBreakdown getMemoryBreakdown() const;
+
+    /**
+     * @returns getMemoryUsage(), getMemoryOverhead() and
+     * getMemoryUsageOfUnrefCheckpoints() under a single acquisition of the
+     * queue lock
+     */
+    CheckpointMemoryUsage getMemoryUsages() const;
+
+    /// A cursor which may be dropped, with the cost model inputs used by the
+    /// cursor-dropper to decide between candidates.
+    struct CursorDropCandidate {
+        Cursor cursor;
+        /**
+         * Estimate of the checkpoint memory which becomes unreferenced when
+         * this cursor (and every candidate before it) is dropped. Only the
+         * last candidate in a checkpoint carries the memory of that
+         * checkpoint, the others are 0.
+         */
+        size_t memoryFreed = 0;
+        /// Items the stream must backfill from disk to catch up once dropped
+        size_t backfillItems = 0;
+    };
+
     /**
      * Function returns a list of cursors to drop so as to unreference
      * certain checkpoints within the manager, invoked by the cursor-dropper.
+     * Cursors are ordered oldest first, as checkpoints can only be removed
+     * from the front of the checkpoint list.
      * @return a container of weak_ptr to cursors
      */
     std::vector<Cursor> getListOfCursorsToDrop();
 
+    /**
+     * As getListOfCursorsToDrop(), but also returns the estimated memory
+     * freed and backfill cost of dropping each cursor.
+     */
+    std::vector<CursorDropCandidate> getCursorDropCandidates();
+
     /**
      * @return True if at least one checkpoint is unreferenced and can
      * be removed.
@@ -534,6 +582,14 @@ protected:
      */
     void registerBackupPersistenceCursor(const LockHolder& lh);
 
+    /**
+     * The body of getItemsForCursor(), called with the queueLock held.
+     */
+    ItemsForCursor getItemsForCursor_UNLOCKED(const LockHolder& lh,
+                                              CheckpointCursor& cursor,
+                                              std::vector<queued_item>& items,
+                                              size_t approxLimit);
+
     size_t getNumItemsForCursor_UNLOCKED(const CheckpointCursor* cursor) const;
 
     void clear_UNLOCKED(vbucket_state_t vbState, uint64_t seqno);
@@ -621,6 +677,9 @@ protected:
                                      Vbid vbid,
                                      queue_op checkpoint_op);
 
+    /// Acquire the queueLock (profiled as LockProfiler::Lock::CheckpointQueue)
+    ProfiledLockHolder lockQueue(const char* site = LOCK_PROFILER_CALLER) const;
+
     CheckpointList checkpointList;
     EPStats                 &stats;
     CheckpointConfig        &checkpointConfig;
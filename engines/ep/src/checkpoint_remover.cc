@@ -26,6 +26,7 @@
 
 #include <phosphor/phosphor.h>
 #include <memory>
+#include <tuple>
 
 // isReductionInCheckpointMemoryNeeded() wants to determine if checkpoint
 // expelling and/or cursor dropping should be invoked, if true a calculated
@@ -150,6 +151,9 @@ ClosedUnrefCheckpointRemoverTask::isReductionInCheckpointMemoryNeeded() const {
 
 size_t ClosedUnrefCheckpointRemoverTask::attemptMemoryRecovery(
         MemoryRecoveryMechanism mechanism, size_t amountOfMemoryToClear) {
+    if (mechanism == MemoryRecoveryMechanism::cursorDrop) {
+        return attemptCursorDropping(amountOfMemoryToClear);
+    }
     size_t memoryCleared = 0;
     KVBucketIface* kvBucket = engine->getKVBucket();
     // Get a list of vbuckets sorted by memory usage
@@ -178,31 +182,123 @@ size_t ClosedUnrefCheckpointRemoverTask::attemptMemoryRecovery(
             memoryCleared += expelResult.estimateOfFreeMemory;
             break;
         }
-        case MemoryRecoveryMechanism::cursorDrop: {
-            // Get a list of cursors that can be dropped from the
-            // vbucket's checkpoint manager, so as to unreference
-            // an estimated number of checkpoints.
-            auto cursors = vb->checkpointManager->getListOfCursorsToDrop();
-            for (const auto& cursor : cursors) {
-                if (memoryCleared < amountOfMemoryToClear) {
-                    if (engine->getDcpConnMap().handleSlowStream(
-                                vbid, cursor.lock().get())) {
-                        auto memoryFreed =
-                                vb->getChkMgrMemUsageOfUnrefCheckpoints();
-                        ++stats.cursorsDropped;
-                        stats.cursorMemoryFreed += memoryFreed;
-                        memoryCleared += memoryFreed;
-                    }
-                } else { // memoryCleared >= amountOfMemoryToClear
-                    break;
-                }
-            }
-        } // case cursorDrop
+        case MemoryRecoveryMechanism::cursorDrop:
+            // Handled by attemptCursorDropping()
+            break;
         } // switch (mechanism)
     }
     return memoryCleared;
 }
 
+size_t ClosedUnrefCheckpointRemoverTask::attemptCursorDropping(
+        size_t amountOfMemoryToClear) {
+    KVBucketIface* kvBucket = engine->getKVBucket();
+
+    // The cursors which can be dropped from each vbucket, oldest first.
+    // Checkpoints are only removed from the front of the checkpoint list, so
+    // the cursors of a vbucket can only be dropped in that order - one
+    // checkpoint's worth of cursors (a "group") at a time.
+    struct VBCandidates {
+        Vbid vbid;
+        std::vector<CheckpointManager::CursorDropCandidate> candidates;
+        size_t next = 0;
+    };
+    std::vector<VBCandidates> vbCandidates;
+    auto vbuckets = kvBucket->getVBuckets().getVBucketsSortedByChkMgrMem();
+    for (const auto& it : vbuckets) {
+        VBucketPtr vb = kvBucket->getVBucket(it.first);
+        if (!vb) {
+            continue;
+        }
+        auto candidates = vb->checkpointManager->getCursorDropCandidates();
+        if (!candidates.empty()) {
+            vbCandidates.push_back({it.first, std::move(candidates)});
+        }
+    }
+
+    // Returns the end (exclusive) of the next group of the given vbucket,
+    // along with the estimated memory freed and backfill cost of dropping it.
+    auto nextGroup = [](const VBCandidates& vbc) {
+        size_t end = vbc.next;
+        size_t memory = 0;
+        size_t backfillItems = 0;
+        while (end < vbc.candidates.size()) {
+            const auto& candidate = vbc.candidates[end++];
+            backfillItems += candidate.backfillItems;
+            if (candidate.memoryFreed > 0) {
+                memory = candidate.memoryFreed;
+                break;
+            }
+        }
+        return std::make_tuple(end, memory, backfillItems);
+    };
+
+    // Greedily drop the group which frees the most memory per item that will
+    // need backfilling, so that (for example) a replica cursor which is
+    // nearly caught up is dropped only if there is nothing cheaper to drop.
+    size_t memoryCleared = 0;
+    while (memoryCleared < amountOfMemoryToClear) {
+        VBCandidates* best = nullptr;
+        double bestScore = 0;
+        for (auto& vbc : vbCandidates) {
+            if (vbc.next >= vbc.candidates.size()) {
+                continue;
+            }
+            size_t memory, backfillItems;
+            std::tie(std::ignore, memory, backfillItems) = nextGroup(vbc);
+            const double score = double(memory) / (backfillItems + 1);
+            if (!best || score > bestScore) {
+                best = &vbc;
+                bestScore = score;
+            }
+        }
+        if (!best) {
+            break;
+        }
+
+        size_t end, estimatedMemory, backfillItems;
+        std::tie(end, estimatedMemory, backfillItems) = nextGroup(*best);
+        bool allDropped = true;
+        size_t dropped = 0;
+        for (; best->next < end; ++best->next) {
+            const auto& candidate = best->candidates[best->next];
+            if (engine->getDcpConnMap().handleSlowStream(
+                        best->vbid, candidate.cursor.lock().get())) {
+                ++stats.cursorsDropped;
+                stats.cursorDropBackfillItems += candidate.backfillItems;
+                ++dropped;
+            } else {
+                allDropped = false;
+            }
+        }
+
+        size_t memoryFreed = 0;
+        VBucketPtr vb = kvBucket->getVBucket(best->vbid);
+        if (vb && dropped > 0) {
+            memoryFreed = vb->getChkMgrMemUsageOfUnrefCheckpoints();
+            stats.cursorMemoryFreed += memoryFreed;
+            memoryCleared += memoryFreed;
+        }
+        EP_LOG_INFO(
+                "{} Dropped {} cursor(s) estimated to free {} bytes at a "
+                "backfill cost of {} items (score {:.1f}), {} bytes of "
+                "unreferenced checkpoint memory now reclaimable",
+                best->vbid,
+                dropped,
+                estimatedMemory,
+                backfillItems,
+                bestScore,
+                memoryFreed);
+
+        // A cursor we failed to drop still references its checkpoint, so the
+        // later cursors of this vbucket would not free anything.
+        if (!allDropped) {
+            best->next = best->candidates.size();
+        }
+    }
+    return memoryCleared;
+}
+
 bool ClosedUnrefCheckpointRemoverTask::run() {
     TRACE_EVENT0("ep-engine/task", "ClosedUnrefCheckpointRemoverTask");
     bool inverse = true;
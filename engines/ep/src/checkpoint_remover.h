@@ -53,6 +53,16 @@ public:
     size_t attemptMemoryRecovery(MemoryRecoveryMechanism mechanism,
                                  size_t amountOfMemoryToClear);
 
+    /**
+     * Attempts to free memory by dropping cursors. Candidate cursors are
+     * chosen across all vbuckets by the estimated checkpoint memory freed
+     * per item which the affected streams will need to backfill.
+     * @param amountOfMemoryToClear  The amount of memory in bytes
+     * that needs to be recovered.
+     * @return the amount (in bytes) that was recovered.
+     */
+    size_t attemptCursorDropping(size_t amountOfMemoryToClear);
+
     bool run() override;
 
     std::string getDescription() override {
@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include <cstddef>
 #include <list>
 #include <memory>
 
@@ -26,6 +27,16 @@ class CheckpointManager;
 // a given vBucket.
 using CheckpointList = std::list<std::unique_ptr<Checkpoint>>;
 
+/// The memory used by the Checkpoints of a CheckpointManager
+struct CheckpointMemoryUsage {
+    /// The memory consumption of all of the checkpoints
+    size_t usage = 0;
+    /// The memory overhead of all of the checkpoints
+    size_t overhead = 0;
+    /// The memory consumption of the unreferenced checkpoints
+    size_t unreferenced = 0;
+};
+
 /**
  * RAII resource, used to reset the state of the CheckpointManager after
  * flush.
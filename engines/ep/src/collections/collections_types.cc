@@ -73,12 +73,29 @@ ScopeID getScopeIDFromKey(const DocKey& key) {
     return SystemEventFactory::getScopeIDFromKey(key);
 }
 
+CompressorStats& CompressorStats::operator+=(const CompressorStats& other) {
+    tried += other.tried;
+    compressed += other.compressed;
+    bytesSaved += other.bytesSaved;
+    skippedHot += other.skippedHot;
+    skippedSampled += other.skippedSampled;
+    return *this;
+}
+
+AccessedKeys& AccessedKeys::operator+=(const AccessedKeys& other) {
+    current += other.current;
+    previous += other.previous;
+    return *this;
+}
+
 AccumulatedStats& AccumulatedStats::operator+=(const AccumulatedStats& other) {
     itemCount += other.itemCount;
     diskSize += other.diskSize;
     opsStore += other.opsStore;
     opsDelete += other.opsDelete;
     opsGet += other.opsGet;
+    compressor += other.compressor;
+    accessedKeys += other.accessedKeys;
     return *this;
 }
 
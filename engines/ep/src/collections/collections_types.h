@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "hyperloglog.h"
 #include "monotonic.h"
 
 #include <memcached/types.h>
@@ -49,6 +50,31 @@ const size_t CouchstoreManifestLen = sizeof(CouchstoreManifest) - 1;
 
 using ManifestUid = WeaklyMonotonic<uint64_t>;
 
+// What the ItemCompressorVisitor did with the values of a collection
+struct CompressorStats {
+    CompressorStats& operator+=(const CompressorStats& other);
+    //! Values compression was tried on
+    uint64_t tried{0};
+    //! Values compressed (at least min_compression_ratio)
+    uint64_t compressed{0};
+    //! Bytes saved by compressing the values
+    uint64_t bytesSaved{0};
+    //! Values not tried as they are accessed too often
+    uint64_t skippedHot{0};
+    //! Values not tried as their datatype didn't compress in the collection
+    uint64_t skippedSampled{0};
+};
+
+// Sketches of the distinct keys accessed in a collection, see
+// VB::ManifestEntry::recordAccess
+struct AccessedKeys {
+    AccessedKeys& operator+=(const AccessedKeys& other);
+    //! Keys accessed so far in the current window
+    HyperLogLog current;
+    //! Keys accessed in the previous (complete) window
+    HyperLogLog previous;
+};
+
 // Struct/Map used in summary stat collecting (where we do vb accumulation)
 struct AccumulatedStats {
     AccumulatedStats& operator+=(const AccumulatedStats& other);
@@ -57,6 +83,8 @@ struct AccumulatedStats {
     uint64_t opsStore{0};
     uint64_t opsDelete{0};
     uint64_t opsGet{0};
+    CompressorStats compressor;
+    AccessedKeys accessedKeys;
 };
 using Summary = std::unordered_map<CollectionID, AccumulatedStats>;
 
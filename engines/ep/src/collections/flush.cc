@@ -21,6 +21,7 @@
 #include "collections/vbucket_manifest.h"
 #include "collections/vbucket_manifest_handles.h"
 #include "ep_bucket.h"
+#include "ep_engine.h"
 #include "item.h"
 
 namespace Collections::VB {
@@ -195,7 +196,19 @@ void Flush::checkAndTriggerPurge(Vbid vbid, KVBucket& bucket) const {
 void Flush::triggerPurge(Vbid vbid, KVBucket& bucket) {
     CompactionConfig config;
     config.db_file_id = vbid;
-    bucket.scheduleCompaction(vbid, config, nullptr);
+
+    // A KVStore which cannot compact just the dropped collections' key range
+    // must rewrite the vBucket; defer that so a burst of drops shares one
+    // rewrite. Reads already skip the dropped collections' data.
+    auto delay = std::chrono::seconds(0);
+    auto* kvstore = bucket.getRWUnderlying(vbid);
+    if (kvstore &&
+        !kvstore->getStorageProperties().hasEfficientCollectionDrop()) {
+        delay = std::chrono::seconds(bucket.getEPEngine()
+                                             .getConfiguration()
+                                             .getCollectionsDropCompactionDelay());
+    }
+    bucket.scheduleCompaction(vbid, config, nullptr, delay);
 }
 
 void Flush::updateStats(const DocKey& key,
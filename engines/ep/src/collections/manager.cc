@@ -28,6 +28,7 @@
 
 #include <nlohmann/json.hpp>
 #include <spdlog/fmt/ostr.h>
+#include <algorithm>
 #include <optional>
 #include <utility>
 
@@ -198,6 +199,38 @@ cb::EngineErrorGetScopeIDResult Collections::Manager::isScopeIDValid(
     return cb::EngineErrorGetScopeIDResult{manifestLocked->getUid()};
 }
 
+std::unordered_map<CollectionID, float>
+Collections::Manager::getEvictionWeights() const {
+    std::unordered_map<CollectionID, float> weights;
+    auto manifestLocked = currentManifest.rlock();
+    for (auto itr = manifestLocked->beginScopes();
+         itr != manifestLocked->endScopes();
+         ++itr) {
+        for (const auto& collection : itr->second.collections) {
+            if (collection.evictionWeight) {
+                weights.emplace(collection.id, *collection.evictionWeight);
+            }
+        }
+    }
+    return weights;
+}
+
+std::unordered_set<CollectionID>
+Collections::Manager::getEvictOnPersistCollections() const {
+    std::unordered_set<CollectionID> collections;
+    auto manifestLocked = currentManifest.rlock();
+    for (auto itr = manifestLocked->beginScopes();
+         itr != manifestLocked->endScopes();
+         ++itr) {
+        for (const auto& collection : itr->second.collections) {
+            if (collection.evictOnPersist) {
+                collections.insert(collection.id);
+            }
+        }
+    }
+    return collections;
+}
+
 void Collections::Manager::update(VBucket& vb) const {
     // Lock manager updates
     Collections::VB::ManifestUpdateStatus status;
@@ -702,6 +735,11 @@ Collections::CachedStats Collections::Manager::getPerCollectionStats(
             std::move(visitor.summary) /* accumulated collection stats */};
 }
 
+void Collections::Manager::doCollectionAccessStats(KVBucket& bucket,
+                                                   StatCollector& collector) {
+    getPerCollectionStats(bucket).addAccessStats(collector);
+}
+
 Collections::CachedStats::CachedStats(
         std::unordered_map<CollectionID, size_t>&& colMemUsed,
         std::unordered_map<CollectionID, AccumulatedStats>&& accumulatedStats)
@@ -806,4 +844,57 @@ void Collections::CachedStats::addAggregatedCollectionStats(
     addStat("ops_store", stats.opsStore);
     addStat("ops_delete", stats.opsDelete);
     addStat("ops_get", stats.opsGet);
+
+    addStat("compressor_tried", stats.compressor.tried);
+    addStat("compressor_compressed", stats.compressor.compressed);
+    addStat("compressor_bytes_saved", stats.compressor.bytesSaved);
+    addStat("compressor_skipped_hot", stats.compressor.skippedHot);
+    addStat("compressor_skipped_sampled", stats.compressor.skippedSampled);
+
+    const auto distinctKeys = stats.accessedKeys.current.estimate();
+    const auto distinctKeysLastWindow = stats.accessedKeys.previous.estimate();
+    addStat("distinct_keys", distinctKeys);
+    addStat("distinct_keys_last_window", distinctKeysLastWindow);
+    addStat("working_set_size",
+            getWorkingSetSize(std::max(distinctKeys, distinctKeysLastWindow),
+                              memUsed,
+                              stats.itemCount));
+}
+
+void Collections::CachedStats::addAccessStats(StatCollector& collector) {
+    using namespace cb::stats;
+    for (const auto& [cid, stats] : accumulatedStats) {
+        const auto collection = cid.to_string();
+        const auto addStat = [&collector, &collection](std::string_view name,
+                                                       auto value) {
+            collector.addStat(
+                    StatDef(fmt::format("collection_{}:{}", collection, name),
+                            name == "working_set_size" ? units::bytes
+                                                       : units::count,
+                            fmt::format("collection_{}", name),
+                            StatDef::Labels{{"collection_id", collection}}),
+                    value);
+        };
+        const auto distinctKeys = stats.accessedKeys.current.estimate();
+        const auto distinctKeysLastWindow =
+                stats.accessedKeys.previous.estimate();
+        addStat("distinct_keys", distinctKeys);
+        addStat("distinct_keys_last_window", distinctKeysLastWindow);
+        addStat("working_set_size",
+                getWorkingSetSize(
+                        std::max(distinctKeys, distinctKeysLastWindow),
+                        colMemUsed[cid],
+                        stats.itemCount));
+    }
+}
+
+size_t Collections::getWorkingSetSize(uint64_t distinctKeys,
+                                      size_t memUsed,
+                                      uint64_t items) {
+    if (items == 0) {
+        return 0;
+    }
+    // The sketches also count keys which were accessed and since deleted
+    distinctKeys = std::min(distinctKeys, items);
+    return size_t(double(memUsed) * distinctKeys / items);
 }
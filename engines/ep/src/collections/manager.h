@@ -24,8 +24,11 @@
 #include <folly/Synchronized.h>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 class KVBucket;
+class StatCollector;
 class VBucket;
 
 namespace Collections {
@@ -73,6 +76,13 @@ public:
                           const AddStatFn& add_stat,
                           const void* cookie);
 
+    /**
+     * Add the access (distinct keys and working set size) stats of every
+     * collection, labelled by collection ID.
+     * @param collector the collector to add the stats to
+     */
+    void addAccessStats(StatCollector& collector);
+
 private:
     void addAggregatedCollectionStats(const std::vector<CollectionID>& cids,
                                       std::string_view prefix,
@@ -82,6 +92,18 @@ private:
     std::unordered_map<CollectionID, AccumulatedStats> accumulatedStats;
 };
 
+/**
+ * Estimate the working set size of a collection: the memory needed to keep
+ * the keys accessed in a window resident, assuming they are of the average
+ * size of the collection's resident items.
+ *
+ * @param distinctKeys the (estimated) number of distinct keys accessed
+ * @param memUsed the memory used by the collection
+ * @param items the number of items of the collection
+ * @return the estimated working set size (bytes)
+ */
+size_t getWorkingSetSize(uint64_t distinctKeys, size_t memUsed, uint64_t items);
+
 /**
  * Collections::Manager provides some bucket level management functions
  * such as the code which enables the MCBP set_collections command.
@@ -147,6 +169,18 @@ public:
      */
     cb::EngineErrorGetScopeIDResult isScopeIDValid(ScopeID sid) const;
 
+    /**
+     * @return the eviction weight of each collection of the current manifest
+     *         which defines one (collections without a weight are omitted)
+     */
+    std::unordered_map<CollectionID, float> getEvictionWeights() const;
+
+    /**
+     * @return the collections of the current manifest whose items are
+     *         ejected once persisted
+     */
+    std::unordered_set<CollectionID> getEvictOnPersistCollections() const;
+
     /**
      * Update the vbucket's manifest with the current Manifest
      * The Manager is locked to prevent current changing whilst this update
@@ -202,6 +236,13 @@ public:
             const AddStatFn& add_stat,
             const std::string& statKey);
 
+    /**
+     * Add the distinct keys and working set size estimates of every
+     * collection of the bucket, labelled by collection ID (for Prometheus).
+     */
+    static void doCollectionAccessStats(KVBucket& bucket,
+                                        StatCollector& collector);
+
     /**
      * Test only hook
      */
@@ -50,6 +50,10 @@ static constexpr char const* UidKey = "uid";
 static constexpr char const* MaxTtlKey = "maxTTL";
 static constexpr nlohmann::json::value_t MaxTtlType =
         nlohmann::json::value_t::number_unsigned;
+static constexpr char const* EvictionWeightKey = "evictionWeight";
+static constexpr char const* EvictOnPersistKey = "evictOnPersist";
+static constexpr nlohmann::json::value_t EvictOnPersistType =
+        nlohmann::json::value_t::boolean;
 
 /**
  * Get json sub-object from the json object for key and check the type.
@@ -146,6 +150,11 @@ Manifest::Manifest(std::string_view json)
             auto cuid = getJsonObject(collection, UidKey, UidType);
             auto cmaxttl = cb::getOptionalJsonObject(
                     collection, MaxTtlKey, MaxTtlType);
+            // May be given as an integer or a float so no type is specified
+            auto cevictionweight =
+                    cb::getOptionalJsonObject(collection, EvictionWeightKey);
+            auto cevictionpersist = cb::getOptionalJsonObject(
+                    collection, EvictOnPersistKey, EvictOnPersistType);
 
             auto cnameValue = cname.get<std::string>();
             if (!validName(cnameValue)) {
@@ -201,10 +210,27 @@ Manifest::Manifest(std::string_view json)
                 maxTtl = std::chrono::seconds(value);
             }
 
+            std::optional<float> evictionWeight;
+            if (cevictionweight) {
+                if (!cevictionweight->is_number()) {
+                    throwInvalid("evictionWeight is not a number");
+                }
+                auto value = cevictionweight->get<double>();
+                if (!(value > 0.0) ||
+                    value > std::numeric_limits<float>::max()) {
+                    throwInvalid("evictionWeight:" + std::to_string(value));
+                }
+                evictionWeight = static_cast<float>(value);
+            }
+
             enableDefaultCollection(cuidValue);
             this->collections.emplace(std::make_pair(
                     cuidValue, Collection{uidValue, cnameValue}));
-            scopeCollections.push_back({cuidValue, maxTtl});
+            scopeCollections.push_back(
+                    {cuidValue,
+                     maxTtl,
+                     evictionWeight,
+                     cevictionpersist && cevictionpersist->get<bool>()});
         }
 
         this->scopes.emplace(uidValue,
@@ -288,6 +314,12 @@ nlohmann::json Manifest::toJson(
                 if (c.maxTtl) {
                     collection["maxTTL"] = c.maxTtl.value().count();
                 }
+                if (c.evictionWeight) {
+                    collection[EvictionWeightKey] = c.evictionWeight.value();
+                }
+                if (c.evictOnPersist) {
+                    collection[EvictOnPersistKey] = true;
+                }
                 scope["collections"].push_back(collection);
             }
         }
@@ -339,6 +371,24 @@ void Manifest::addCollectionStats(KVBucket& bucket,
                             key, "{}:{}:maxTTL", scope.first.to_string(), cid);
                     addStat({key.data(), key.size()}, entry.maxTtl->count());
                 }
+
+                if (entry.evictionWeight) {
+                    key.resize(0);
+                    format_to(key,
+                              "{}:{}:eviction_weight",
+                              scope.first.to_string(),
+                              cid);
+                    addStat({key.data(), key.size()}, *entry.evictionWeight);
+                }
+
+                if (entry.evictOnPersist) {
+                    key.resize(0);
+                    format_to(key,
+                              "{}:{}:evict_on_persist",
+                              scope.first.to_string(),
+                              cid);
+                    addStat({key.data(), key.size()}, entry.evictOnPersist);
+                }
             }
         }
     } catch (const std::exception& e) {
@@ -489,7 +539,9 @@ void Manifest::dump() const {
 }
 
 bool CollectionEntry::operator==(const CollectionEntry& other) const {
-    return id == other.id && maxTtl == other.maxTtl;
+    return id == other.id && maxTtl == other.maxTtl &&
+           evictionWeight == other.evictionWeight &&
+           evictOnPersist == other.evictOnPersist;
 }
 
 bool Scope::operator==(const Scope& other) const {
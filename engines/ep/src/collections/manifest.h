@@ -20,6 +20,7 @@
 #include <nlohmann/json_fwd.hpp>
 #include <algorithm>
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <unordered_map>
 
@@ -36,6 +37,17 @@ static const size_t MaxCollectionNameSize = 30;
 struct CollectionEntry {
     CollectionID id;
     cb::ExpiryLimit maxTtl;
+    /**
+     * Optional weight (> 0) biasing the ItemPager's choice of items to evict;
+     * items of collections with a weight above 1 are evicted before those
+     * with a weight below 1. Not set is equivalent to 1.
+     */
+    std::optional<float> evictionWeight;
+    /**
+     * Eject the items of the collection as soon as they're persisted (if not
+     * accessed since written), for write-once data which is rarely read back
+     */
+    bool evictOnPersist = false;
     bool operator==(const CollectionEntry& other) const;
     bool operator!=(const CollectionEntry& other) const {
         return !(*this == other);
@@ -29,6 +29,8 @@
 #include "systemevent.h"
 #include "vbucket.h"
 
+#include <folly/ScopeGuard.h>
+
 #include <memory>
 
 namespace Collections::VB {
@@ -50,6 +52,12 @@ Manifest::Manifest(const KVStore::Manifest& data)
     }
 }
 
+/// @return the level to log a collection or scope event at
+static spdlog::level::level_enum eventLogLevel(bool logEachEvent) {
+    return logEachEvent ? spdlog::level::level_enum::info
+                        : spdlog::level::level_enum::debug;
+}
+
 std::optional<CollectionID> Manifest::applyDeletions(
         const WriteHandle& wHandle,
         ::VBucket& vb,
@@ -169,6 +177,33 @@ void Manifest::completeUpdate(mutex_type::UpgradeHolder&& upgradeLock,
     // Write Handle now needed
     WriteHandle wHandle(*this, std::move(upgradeLock));
 
+    // Queue all of the events into one new checkpoint rather than one each;
+    // the events of an update have distinct keys so can't de-duplicate each
+    // other. A bulk update logs a single summary instead of every event.
+    const auto numChanges = changes.scopesToAdd.size() +
+                            changes.scopesToRemove.size() +
+                            changes.collectionsToAdd.size() +
+                            changes.collectionsToRemove.size();
+    const bool dropsScopes = !changes.scopesToRemove.empty();
+    vb.checkpointManager->createNewCheckpoint();
+    applyingUpdate = true;
+    logEachEvent = numChanges <= 1;
+    SCOPE_EXIT {
+        applyingUpdate = false;
+        logEachEvent = true;
+    };
+    if (numChanges > 1) {
+        EP_LOG_INFO(
+                "collections: {} applying manifest:{:#x} scopes+:{}, "
+                "collections+:{}, scopes-:{}, collections-:{}",
+                vb.getId(),
+                changes.uid,
+                changes.scopesToAdd.size(),
+                changes.collectionsToAdd.size(),
+                changes.scopesToRemove.size(),
+                changes.collectionsToRemove.size());
+    }
+
     auto finalScopeCreate = applyScopeCreates(wHandle, vb, changes.scopesToAdd);
     if (finalScopeCreate) {
         auto uid = changes.collectionsToAdd.empty() &&
@@ -219,6 +254,12 @@ void Manifest::completeUpdate(mutex_type::UpgradeHolder&& upgradeLock,
                   *finalScopeDrop,
                   OptionalSeqno{/*no-seqno*/});
     }
+
+    if (dropsScopes) {
+        // As for a single scope drop, nothing following may share the
+        // drop's checkpoint
+        vb.checkpointManager->createNewCheckpoint();
+    }
 }
 
 ManifestUpdateStatus Manifest::canUpdate(
@@ -254,7 +295,8 @@ void Manifest::addCollection(const WriteHandle& wHandle,
                                             false,
                                             optionalSeqno);
 
-    EP_LOG_INFO(
+    EP_LOG_FMT(
+            eventLogLevel(logEachEvent),
             "collections: {} adding collection:[name:{},id:{:#x}] to "
             "scope:{:#x}, "
             "maxTTL:{} {}, "
@@ -335,7 +377,8 @@ void Manifest::dropCollection(const WriteHandle& wHandle,
                                             true /*delete*/,
                                             optionalSeqno);
 
-    EP_LOG_INFO(
+    EP_LOG_FMT(
+            eventLogLevel(logEachEvent),
             "collections: {} drop of collection:{:#x} from scope:{:#x}"
             ", replica:{}, seqno:{}, manifest:{:#x} tombstone:{}",
             vb.getId(),
@@ -392,7 +435,8 @@ void Manifest::addScope(const WriteHandle& wHandle,
     auto seqno =
             vb.addSystemEventItem(item.release(), optionalSeqno, {}, wHandle);
 
-    EP_LOG_INFO(
+    EP_LOG_FMT(
+            eventLogLevel(logEachEvent),
             "collections: {} added scope:name:{},id:{:#x} "
             "replica:{}, seqno:{}, manifest:{:#x}",
             vb.getId(),
@@ -442,11 +486,12 @@ void Manifest::dropScope(const WriteHandle& wHandle,
 
     // If seq is not set, then this is an active vbucket queueing the event.
     // Collection events will end the CP so they don't de-dup.
-    if (!optionalSeqno.has_value()) {
+    if (!optionalSeqno.has_value() && !applyingUpdate) {
         vb.checkpointManager->createNewCheckpoint();
     }
 
-    EP_LOG_INFO(
+    EP_LOG_FMT(
+            eventLogLevel(logEachEvent),
             "collections: {} dropped scope:id:{:#x} "
             "replica:{}, seqno:{}, manifest:{:#x}",
             vb.getId(),
@@ -479,8 +524,7 @@ Manifest::ManifestChanges Manifest::processManifest(
     for (auto scopeItr = manifest.beginScopes();
          scopeItr != manifest.endScopes();
          scopeItr++) {
-        if (std::find(scopes.begin(), scopes.end(), scopeItr->first) ==
-            scopes.end()) {
+        if (scopes.count(scopeItr->first) == 0) {
             rv.scopesToAdd.push_back({scopeItr->first, scopeItr->second.name});
         }
 
@@ -504,7 +548,7 @@ bool Manifest::doesKeyContainValidCollection(const DocKey& key) const {
 }
 
 bool Manifest::isScopeValid(ScopeID scopeID) const {
-    return std::find(scopes.begin(), scopes.end(), scopeID) != scopes.end();
+    return scopes.count(scopeID) > 0;
 }
 
 Manifest::container::const_iterator Manifest::getManifestEntry(
@@ -617,8 +661,9 @@ int64_t Manifest::queueCollectionSystemEvent(const WriteHandle& wHandle,
                                              bool deleted,
                                              OptionalSeqno seq) const {
     // If seq is not set, then this is an active vbucket queueing the event.
-    // Collection events will end the CP so they don't de-dup.
-    if (!seq.has_value()) {
+    // Collection events will end the CP so they don't de-dup (completeUpdate
+    // has already done so for all of the events it queues).
+    if (!seq.has_value() && !applyingUpdate) {
         vb.checkpointManager->createNewCheckpoint();
     }
 
@@ -809,6 +854,14 @@ void Manifest::decrementDiskCount(CollectionID collection) const {
     return itr->second.decrementDiskCount();
 }
 
+void Manifest::addCompressorStats(CollectionID collection,
+                                  const CompressorStats& stats) const {
+    auto itr = map.find(collection);
+    if (itr != map.end()) {
+        itr->second.addCompressorStats(stats);
+    }
+}
+
 bool Manifest::addCollectionStats(Vbid vbid,
                                   const void* cookie,
                                   const AddStatFn& add_stat) const {
@@ -893,7 +946,7 @@ void Manifest::updateSummary(Summary& summary) const {
 
 std::optional<std::vector<CollectionID>> Manifest::getCollectionsForScope(
         ScopeID identifier) const {
-    if (std::find(scopes.begin(), scopes.end(), identifier) == scopes.end()) {
+    if (scopes.count(identifier) == 0) {
         return {};
     }
 
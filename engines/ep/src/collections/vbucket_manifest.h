@@ -579,6 +579,15 @@ protected:
      */
     void decrementDiskCount(CollectionID collection) const;
 
+    /**
+     * Add to the item compressor counts of the given collection (ignored if
+     * the collection has gone since its values were visited). Const and can
+     * be called via a ReadHandle because the read lock only ensures the map
+     * does not change.
+     */
+    void addCompressorStats(CollectionID collection,
+                            const CompressorStats& stats) const;
+
     container::const_iterator end() const {
         return map.end();
     }
@@ -755,6 +764,14 @@ protected:
     /// Does this vbucket need collection purging triggering
     bool dropInProgress{false};
 
+    /// Set while completeUpdate queues the events of an update, which share
+    /// a single new checkpoint
+    bool applyingUpdate{false};
+
+    /// False while applying an update of several changes, which logs a
+    /// summary rather than every event (those are logged at debug)
+    bool logEachEvent{true};
+
     /**
      * shared lock to allow concurrent readers and safe updates
      */
@@ -17,6 +17,7 @@
 
 #include "collections/vbucket_manifest_entry.h"
 #include "bucket_logger.h"
+#include "ep_time.h"
 #include "statistics/collector.h"
 
 #include <platform/checked_snprintf.h>
@@ -36,20 +37,100 @@ Collections::VB::ManifestEntry& Collections::VB::ManifestEntry::operator=(
     highSeqno.reset(other.highSeqno);
     persistedHighSeqno.store(other.persistedHighSeqno,
                              std::memory_order_relaxed);
-    numOpsStore = other.numOpsStore;
-    numOpsDelete = other.numOpsDelete;
-    numOpsGet = other.numOpsGet;
+    for (size_t i = 0; i < NumOpStripes; ++i) {
+        opStripes[i].store = other.opStripes[i].store;
+        opStripes[i].del = other.opStripes[i].del;
+        opStripes[i].get = other.opStripes[i].get;
+    }
+    compressorTried = other.compressorTried.load();
+    compressorCompressed = other.compressorCompressed.load();
+    compressorBytesSaved = other.compressorBytesSaved.load();
+    compressorSkippedHot = other.compressorSkippedHot.load();
+    compressorSkippedSampled = other.compressorSkippedSampled.load();
+    if (this != &other) {
+        const auto* otherSketch = other.accessSketch.load();
+        delete accessSketch.exchange(
+                otherSketch ? new AccessSketch(*otherSketch) : nullptr);
+    }
     return *this;
 }
 
+Collections::VB::ManifestEntry::~ManifestEntry() {
+    delete accessSketch.load();
+}
+
+void Collections::VB::ManifestEntry::recordAccess(const DocKey& key,
+                                                  std::chrono::seconds window,
+                                                  rel_time_t now) const {
+    const auto length = gsl::narrow_cast<uint32_t>(window.count());
+    const uint32_t index = now / length;
+    auto* sketch = accessSketch.load();
+    if (!sketch) {
+        auto fresh = std::make_unique<AccessSketch>(length, index);
+        if (accessSketch.compare_exchange_strong(sketch, fresh.get())) {
+            sketch = fresh.release();
+        } // else another thread allocated it first, sketch now points to it
+    }
+
+    const auto current = AccessSketch::makeWindow(length, index);
+    auto expected = sketch->window.load();
+    if (expected != current &&
+        sketch->window.compare_exchange_strong(expected, current)) {
+        // This thread rotates the sketches. Accesses recorded concurrently by
+        // other threads may land in either window, which the estimates
+        // tolerate.
+        if (expected + 1 == current) {
+            sketch->previous = sketch->current;
+        } else {
+            // Either windows were skipped or the length changed
+            sketch->previous.clear();
+        }
+        sketch->current.clear();
+    }
+    sketch->current.add(key);
+}
+
+Collections::AccessedKeys Collections::VB::ManifestEntry::getAccessedKeys(
+        rel_time_t now) const {
+    AccessedKeys keys;
+    const auto* sketch = accessSketch.load();
+    if (!sketch) {
+        return keys;
+    }
+    const auto window = sketch->window.load();
+    const auto length = uint32_t(window >> 32);
+    const auto sketchIndex = uint32_t(window);
+    const uint32_t index = now / length;
+    if (sketchIndex == index) {
+        keys.current = sketch->current;
+        keys.previous = sketch->previous;
+    } else if (sketchIndex + 1 == index) {
+        // No access yet in the current window
+        keys.previous = sketch->current;
+    }
+    return keys;
+}
+
+Collections::AccumulatedStats
+Collections::VB::ManifestEntry::getStatsForSummary() const {
+    return {getDiskCount(),
+            getDiskSize(),
+            getOpsStore(),
+            getOpsDelete(),
+            getOpsGet(),
+            getCompressorStats(),
+            getAccessedKeys(ep_current_time())};
+}
+
 bool Collections::VB::ManifestEntry::operator==(
         const ManifestEntry& other) const {
     return scopeID == other.scopeID && startSeqno == other.startSeqno &&
            maxTtl == other.maxTtl && highSeqno == other.highSeqno &&
            diskCount == other.diskCount && diskSize == other.diskSize &&
            persistedHighSeqno == other.persistedHighSeqno &&
-           numOpsGet == other.numOpsGet && numOpsDelete == other.numOpsDelete &&
-           numOpsStore == other.numOpsStore;
+           getOpsGet() == other.getOpsGet() &&
+           getOpsDelete() == other.getOpsDelete() &&
+           getOpsStore() == other.getOpsStore();
 }
 
 std::string Collections::VB::ManifestEntry::getExceptionString(
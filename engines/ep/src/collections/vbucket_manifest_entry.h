@@ -20,9 +20,13 @@
 #include "collections/collections_types.h"
 #include "memcached/engine_common.h"
 
+#include <folly/concurrency/CacheLocality.h>
 #include <platform/non_negative_counter.h>
 #include <relaxed_atomic.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <memory>
 
 namespace Collections {
@@ -57,6 +61,8 @@ public:
     ManifestEntry(const ManifestEntry& other);
     ManifestEntry& operator=(const ManifestEntry& other);
 
+    ~ManifestEntry();
+
     bool operator==(const ManifestEntry& other) const;
 
     int64_t getStartSeqno() const {
@@ -163,32 +169,123 @@ public:
                   const AddStatFn& add_stat) const;
 
     void incrementOpsStore() const {
-        numOpsStore++;
+        getOpStripe().store++;
     }
     void incrementOpsDelete() const {
-        numOpsDelete++;
+        getOpStripe().del++;
     }
     void incrementOpsGet() const {
-        numOpsGet++;
+        getOpStripe().get++;
     }
     uint64_t getOpsStore() const {
-        return numOpsStore.load();
+        return sumOpStripes(&OpCounters::store);
     }
     uint64_t getOpsDelete() const {
-        return numOpsDelete.load();
+        return sumOpStripes(&OpCounters::del);
     }
     uint64_t getOpsGet() const {
-        return numOpsGet.load();
+        return sumOpStripes(&OpCounters::get);
+    }
+
+    /// add what the item compressor did with the collection's values
+    void addCompressorStats(const CompressorStats& stats) const {
+        compressorTried.fetch_add(stats.tried);
+        compressorCompressed.fetch_add(stats.compressed);
+        compressorBytesSaved.fetch_add(stats.bytesSaved);
+        compressorSkippedHot.fetch_add(stats.skippedHot);
+        compressorSkippedSampled.fetch_add(stats.skippedSampled);
     }
-    AccumulatedStats getStatsForSummary() const {
-        return {getDiskCount(),
-                getDiskSize(),
-                getOpsStore(),
-                getOpsDelete(),
-                getOpsGet()};
+    CompressorStats getCompressorStats() const {
+        return {compressorTried.load(),
+                compressorCompressed.load(),
+                compressorBytesSaved.load(),
+                compressorSkippedHot.load(),
+                compressorSkippedSampled.load()};
     }
 
+    /**
+     * Record an access (read or write) of a key of the collection in the
+     * distinct keys sketch of the current window. The sketch is allocated by
+     * the first access, so collections never accessed in this vBucket (e.g.
+     * in replicas) don't pay for it.
+     *
+     * @param key the key accessed
+     * @param window the length of the windows the distinct keys are counted
+     *        over. A new length starts a new window.
+     * @param now the current time
+     */
+    void recordAccess(const DocKey& key,
+                      std::chrono::seconds window,
+                      rel_time_t now) const;
+
+    /**
+     * @param now the current time
+     * @return sketches of the keys accessed in the current window so far and
+     *         in the previous window (empty for windows without any access)
+     */
+    AccessedKeys getAccessedKeys(rel_time_t now) const;
+
+    AccumulatedStats getStatsForSummary() const;
+
 private:
+    /**
+     * The distinct keys sketches of the current and previous windows.
+     * Windows are numbered by the current time / their length, the sketches
+     * rotate when an access is recorded in a later window.
+     */
+    struct AccessSketch {
+        AccessSketch(uint32_t length, uint32_t index)
+            : window(makeWindow(length, index)) {
+        }
+
+        AccessSketch(const AccessSketch& other)
+            : window(other.window.load()),
+              current(other.current),
+              previous(other.previous) {
+        }
+
+        /// @return the window id of the given window
+        static uint64_t makeWindow(uint32_t length, uint32_t index) {
+            return (uint64_t(length) << 32) | index;
+        }
+
+        //! The window current is for (length in the upper 32 bits, index in
+        //! the lower)
+        std::atomic<uint64_t> window;
+        HyperLogLog current;
+        HyperLogLog previous;
+    };
+
+    /**
+     * The op counters of one stripe, see opStripes.
+     */
+    struct alignas(64) OpCounters {
+        //! The number of basic store (add, set, arithmetic, touch, etc.)
+        //! operations
+        cb::RelaxedAtomic<uint64_t> store{0};
+        //! The number of basic delete operations
+        cb::RelaxedAtomic<uint64_t> del{0};
+        //! The number of basic get operations
+        cb::RelaxedAtomic<uint64_t> get{0};
+    };
+
+    static constexpr size_t NumOpStripes = 4;
+
+    /// @return the stripe of the op counters for the calling thread's core
+    OpCounters& getOpStripe() const {
+        return opStripes[folly::AccessSpreader<std::atomic>::cachedCurrent(
+                NumOpStripes)];
+    }
+
+    /// @return the sum of the given op counter over all stripes
+    uint64_t sumOpStripes(cb::RelaxedAtomic<uint64_t> OpCounters::*op) const {
+        uint64_t total = 0;
+        for (const auto& stripe : opStripes) {
+            total += (stripe.*op).load();
+        }
+        return total;
+    }
+
     /**
      * Return a string for use in throwException, returns:
      *   "VB::ManifestEntry::<thrower>:<error>, this:<ostream *this>"
@@ -273,12 +370,32 @@ private:
      */
     mutable AtomicMonotonic<uint64_t, IgnorePolicy> persistedHighSeqno;
 
-    //! The number of basic store (add, set, arithmetic, touch, etc.) operations
-    mutable cb::RelaxedAtomic<uint64_t> numOpsStore;
-    //! The number of basic delete operations
-    mutable cb::RelaxedAtomic<uint64_t> numOpsDelete;
-    //! The number of basic get operations
-    mutable cb::RelaxedAtomic<uint64_t> numOpsGet;
+    /**
+     * The op counters are bumped by every front-end operation on the
+     * collection, from every core. Rather than all of the cores contending on
+     * one cache line they are striped: a thread bumps the stripe of the core
+     * it runs on and the getters sum the stripes.
+     * mutable - as the counts above.
+     */
+    mutable std::array<OpCounters, NumOpStripes> opStripes;
+
+    /**
+     * The counts of the item compressor (see CompressorStats), only updated
+     * by the ItemCompressorTask once per chunk.
+     * mutable - as the counts above.
+     */
+    mutable cb::RelaxedAtomic<uint64_t> compressorTried{0};
+    mutable cb::RelaxedAtomic<uint64_t> compressorCompressed{0};
+    mutable cb::RelaxedAtomic<uint64_t> compressorBytesSaved{0};
+    mutable cb::RelaxedAtomic<uint64_t> compressorSkippedHot{0};
+    mutable cb::RelaxedAtomic<uint64_t> compressorSkippedSampled{0};
+
+    /**
+     * The sketches of the distinct keys accessed, allocated by the first
+     * recordAccess() and owned by this entry.
+     * mutable - as the counts above.
+     */
+    mutable std::atomic<AccessSketch*> accessSketch{nullptr};
 };
 
 std::ostream& operator<<(std::ostream& os, const ManifestEntry& manifestEntry);
@@ -161,6 +161,11 @@ public:
         manifest->decrementDiskCount(collection);
     }
 
+    void addCompressorStats(CollectionID collection,
+                            const CompressorStats& stats) const {
+        manifest->addCompressorStats(collection, stats);
+    }
+
     bool addCollectionStats(Vbid vbid,
                             const void* cookie,
                             const AddStatFn& add_stat) const {
@@ -447,6 +452,17 @@ public:
         return itr->second.incrementOpsGet();
     }
 
+    /**
+     * Record an access of the key used in construction in its collection's
+     * distinct keys sketch, see ManifestEntry::recordAccess
+     */
+    void recordAccess(std::chrono::seconds window, rel_time_t now) const {
+        if (!valid()) {
+            return;
+        }
+        itr->second.recordAccess(key, window, now);
+    }
+
     /**
      * Dump this VB::Manifest to std::cerr
      */
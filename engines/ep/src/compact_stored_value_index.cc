@@ -0,0 +1,205 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "compact_stored_value_index.h"
+
+#include <folly/lang/Bits.h>
+#include <memcached/dockey.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <stdexcept>
+
+/// @returns true if the StoredValue lives in the Pending namespace.
+static bool isPendingNamespace(const StoredValue& sv) {
+    return sv.isPending() || sv.isCompleted();
+}
+
+CompactStoredValueIndex::CompactStoredValueIndex(size_t initialCapacity) {
+    const auto cap = std::max(GroupSize, folly::nextPowTwo(initialCapacity));
+    ctrl.assign(cap, Empty);
+    slots.resize(cap);
+}
+
+CompactStoredValueIndex::~CompactStoredValueIndex() = default;
+
+uint64_t CompactStoredValueIndex::mixHash(uint32_t hash) {
+    // Fibonacci hashing: spreads the (32-bit) DocKey hash over all 64 bits so
+    // both the fingerprint (low 7 bits) and group index (upper bits) are
+    // well distributed.
+    return (uint64_t(hash) | (uint64_t(hash) << 32)) * 0x9E3779B97F4A7C15ULL;
+}
+
+uint32_t CompactStoredValueIndex::matchGroup(size_t groupStart,
+                                             int8_t value) const {
+#if defined(__SSE2__)
+    const auto group = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(ctrl.data() + groupStart));
+    return static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value))));
+#else
+    uint32_t mask = 0;
+    for (size_t ii = 0; ii < GroupSize; ++ii) {
+        if (ctrl[groupStart + ii] == value) {
+            mask |= (1u << ii);
+        }
+    }
+    return mask;
+#endif
+}
+
+size_t CompactStoredValueIndex::findSlot(const DocKey& key,
+                                         bool pending) const {
+    const auto hash = mixHash(key.hash());
+    const auto fp = fingerprint(hash);
+    const auto groupMask = numGroups() - 1;
+    // Triangular probing over groups; visits every group when the number
+    // of groups is a power of two.
+    auto group = (hash >> 7) & groupMask;
+    for (size_t probe = 0; probe < numGroups(); ++probe) {
+        const auto start = group * GroupSize;
+        auto matches = matchGroup(start, fp);
+        while (matches) {
+            const auto slot = start + folly::findFirstSet(matches) - 1;
+            matches &= matches - 1;
+            const auto* sv = slots[slot].get().get();
+            if (sv->hasKey(key) && isPendingNamespace(*sv) == pending) {
+                return slot;
+            }
+        }
+        if (matchGroup(start, Empty)) {
+            // A group with an empty slot terminates any probe sequence.
+            return capacity();
+        }
+        group = (group + probe + 1) & groupMask;
+    }
+    return capacity();
+}
+
+size_t CompactStoredValueIndex::findSlot(const StoredValue* sv) const {
+    const auto slot = findSlot(sv->getKey(), isPendingNamespace(*sv));
+    if (slot != capacity() && slots[slot].get().get() == sv) {
+        return slot;
+    }
+    return capacity();
+}
+
+StoredValue* CompactStoredValueIndex::find(const DocKey& key,
+                                           bool pending) const {
+    const auto slot = findSlot(key, pending);
+    return slot == capacity() ? nullptr : slots[slot].get().get();
+}
+
+StoredValue* CompactStoredValueIndex::insert(StoredValue::UniquePtr sv) {
+    if (!sv) {
+        throw std::invalid_argument(
+                "CompactStoredValueIndex::insert: sv must be non-null");
+    }
+    // Keep the load factor (including tombstones) at or below 7/8. If most
+    // of the occupied slots are tombstones just rehash in place, otherwise
+    // double.
+    if ((numItems + numDeleted + 1) * 8 > capacity() * 7) {
+        const bool grow = (numItems + 1) * 16 > capacity() * 7;
+        rehash(grow ? capacity() * 2 : capacity());
+    }
+    return insertNoGrow(std::move(sv));
+}
+
+StoredValue* CompactStoredValueIndex::insertNoGrow(StoredValue::UniquePtr sv) {
+    const auto hash = mixHash(sv->getKey().hash());
+    const auto groupMask = numGroups() - 1;
+    auto group = (hash >> 7) & groupMask;
+    for (size_t probe = 0; probe < numGroups(); ++probe) {
+        const auto start = group * GroupSize;
+        const auto available =
+                matchGroup(start, Empty) | matchGroup(start, Deleted);
+        if (available) {
+            const auto slot = start + folly::findFirstSet(available) - 1;
+            if (ctrl[slot] == Deleted) {
+                --numDeleted;
+            }
+            ctrl[slot] = fingerprint(hash);
+            slots[slot] = std::move(sv);
+            ++numItems;
+            return slots[slot].get().get();
+        }
+        group = (group + probe + 1) & groupMask;
+    }
+    // Unreachable as the load factor is bounded below 1.
+    throw std::logic_error("CompactStoredValueIndex::insertNoGrow: no free slot");
+}
+
+StoredValue::UniquePtr CompactStoredValueIndex::release(const StoredValue* sv) {
+    const auto slot = findSlot(sv);
+    if (slot == capacity()) {
+        return {};
+    }
+    // If the group still has an empty slot then no probe sequence has ever
+    // continued past it, so the slot can be marked Empty rather than
+    // needing a tombstone.
+    const auto groupStart = slot - (slot % GroupSize);
+    if (matchGroup(groupStart, Empty)) {
+        ctrl[slot] = Empty;
+    } else {
+        ctrl[slot] = Deleted;
+        ++numDeleted;
+    }
+    --numItems;
+    return std::move(slots[slot]);
+}
+
+void CompactStoredValueIndex::rehash(size_t newCapacity) {
+    std::vector<int8_t> oldCtrl(newCapacity, Empty);
+    std::vector<StoredValue::UniquePtr> oldSlots(newCapacity);
+    // Swap in the new (empty) arrays; old contents are left in old*.
+    ctrl.swap(oldCtrl);
+    slots.swap(oldSlots);
+    numItems = 0;
+    numDeleted = 0;
+    for (size_t ii = 0; ii < oldCtrl.size(); ++ii) {
+        if (oldCtrl[ii] >= 0) {
+            insertNoGrow(std::move(oldSlots[ii]));
+        }
+    }
+}
+
+CompactStoredValueIndex::Position CompactStoredValueIndex::pauseResumeVisit(
+        const Visitor& visitor, Position startPos) {
+    // Restart from the beginning if rehashed since startPos was returned.
+    size_t slot = (startPos.capacity == capacity()) ? startPos.slot : 0;
+    for (; slot < capacity(); ++slot) {
+        if (ctrl[slot] < 0) {
+            continue;
+        }
+        if (!visitor(*slots[slot].get().get())) {
+            return Position(capacity(), slot + 1);
+        }
+    }
+    return endPosition();
+}
+
+void CompactStoredValueIndex::clear() {
+    std::fill(ctrl.begin(), ctrl.end(), Empty);
+    for (auto& sv : slots) {
+        sv.reset();
+    }
+    numItems = 0;
+    numDeleted = 0;
+}
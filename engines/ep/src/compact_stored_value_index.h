@@ -0,0 +1,197 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "stored-value.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct DocKey;
+
+/**
+ * An open-addressing index of StoredValues, as a compact alternative to the
+ * chained buckets of HashTable.
+ *
+ * Layout follows the "SwissTable" design: slots are arranged in groups of
+ * 16, and each slot has a one byte control word which is either Empty,
+ * Deleted (tombstone), or holds a 7-bit fingerprint of the key's hash. A
+ * lookup selects a group from the hash, compares the fingerprint against all
+ * 16 control bytes of the group at once (SSE2 where available) and only
+ * dereferences the StoredValues whose fingerprint matches. Probing stops at
+ * the first group containing an Empty slot.
+ *
+ * Compared to HashTable's chaining this needs 9 bytes per slot (control byte
+ * plus owning pointer) at a maximum load factor of 7/8, and a lookup costs
+ * one cache miss for the control bytes plus one per matching candidate,
+ * instead of one per chain hop.
+ *
+ * As with HashTable, a key may have both a Committed and a Pending
+ * StoredValue; both are held in the index and are distinguished on lookup.
+ * StoredValue::chain_next_or_replacement is not used for linkage by this
+ * index.
+ *
+ * The index is not thread-safe; callers must provide their own locking.
+ */
+class CompactStoredValueIndex {
+public:
+    /// Number of slots in a probe group.
+    static constexpr size_t GroupSize = 16;
+
+    /**
+     * Opaque position within the index, used to pause and resume visiting.
+     * As with HashTable::Position, visiting restarts from the beginning if
+     * the index has been rehashed since the position was returned.
+     */
+    class Position {
+    public:
+        Position() = default;
+
+        bool operator==(const Position& other) const {
+            return capacity == other.capacity && slot == other.slot;
+        }
+
+        bool operator!=(const Position& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Position(size_t capacity, size_t slot)
+            : capacity(capacity), slot(slot) {
+        }
+
+        size_t capacity = 0;
+        size_t slot = 0;
+
+        friend class CompactStoredValueIndex;
+    };
+
+    /**
+     * Visitor callback; return false to pause visiting.
+     */
+    using Visitor = std::function<bool(StoredValue&)>;
+
+    /**
+     * @param initialCapacity number of slots to initially allocate; rounded
+     *        up to a power of two (and at least one group).
+     */
+    explicit CompactStoredValueIndex(size_t initialCapacity = GroupSize);
+
+    ~CompactStoredValueIndex();
+
+    CompactStoredValueIndex(const CompactStoredValueIndex&) = delete;
+    CompactStoredValueIndex& operator=(const CompactStoredValueIndex&) =
+            delete;
+
+    /**
+     * Find the Committed (or Pending/Completed, if pending is true)
+     * StoredValue with the given key.
+     * @return the StoredValue, or nullptr if not found.
+     */
+    StoredValue* find(const DocKey& key, bool pending = false) const;
+
+    /**
+     * Insert the given StoredValue, taking ownership of it. The caller must
+     * ensure an SV with the same key and namespace is not already present.
+     * @return a pointer to the inserted StoredValue.
+     */
+    StoredValue* insert(StoredValue::UniquePtr sv);
+
+    /**
+     * Remove the given StoredValue from the index, returning ownership of
+     * it to the caller.
+     * @return the removed StoredValue, or nullptr if not present.
+     */
+    StoredValue::UniquePtr release(const StoredValue* sv);
+
+    /**
+     * Visit StoredValues starting at the given position.
+     * @return the position to resume from; equal to endPosition() once all
+     *         StoredValues have been visited.
+     */
+    Position pauseResumeVisit(const Visitor& visitor, Position startPos);
+
+    /// @returns the position representing the end of the index.
+    Position endPosition() const {
+        return Position(capacity(), capacity());
+    }
+
+    /// Remove (and free) all StoredValues.
+    void clear();
+
+    /// @returns the number of StoredValues in the index.
+    size_t size() const {
+        return numItems;
+    }
+
+    /// @returns the number of slots in the index.
+    size_t capacity() const {
+        return ctrl.size();
+    }
+
+    /// @returns the memory used by the index itself (excluding the
+    ///          StoredValues).
+    size_t memorySize() const {
+        return sizeof(*this) + ctrl.capacity() * sizeof(int8_t) +
+               slots.capacity() * sizeof(StoredValue::UniquePtr);
+    }
+
+private:
+    /// Control byte values. Full slots hold the (non-negative) fingerprint.
+    static constexpr int8_t Empty = -128;
+    static constexpr int8_t Deleted = -2;
+
+    /// Mix the 32-bit DocKey hash into a 64-bit value whose bits are all
+    /// well distributed, for splitting into group index and fingerprint.
+    static uint64_t mixHash(uint32_t hash);
+
+    static int8_t fingerprint(uint64_t hash) {
+        return static_cast<int8_t>(hash & 0x7f);
+    }
+
+    size_t numGroups() const {
+        return capacity() / GroupSize;
+    }
+
+    /**
+     * @returns a bitmask of the slots in the group starting at groupStart
+     * whose control byte equals the given value (bit N => slot N).
+     */
+    uint32_t matchGroup(size_t groupStart, int8_t value) const;
+
+    /**
+     * Find the slot containing the given SV's key in the given namespace.
+     * @return the slot index, or capacity() if not found.
+     */
+    size_t findSlot(const DocKey& key, bool pending) const;
+
+    /// Find the slot holding exactly the given StoredValue, or capacity().
+    size_t findSlot(const StoredValue* sv) const;
+
+    /// Rehash into an index with the given number of slots.
+    void rehash(size_t newCapacity);
+
+    /// Insert without checking the load factor.
+    StoredValue* insertNoGrow(StoredValue::UniquePtr sv);
+
+    std::vector<int8_t> ctrl;
+    std::vector<StoredValue::UniquePtr> slots;
+    size_t numItems = 0;
+    size_t numDeleted = 0;
+};
@@ -0,0 +1,134 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "compaction_throttle.h"
+
+#include "stats.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+constexpr std::chrono::milliseconds CompactionThrottle::updateInterval;
+
+CompactionThrottle::CompactionThrottle(EPStats& stats) : stats(stats) {
+}
+
+void CompactionThrottle::beforeWrite(size_t bytes) {
+    const auto wait = acquire(bytes, std::chrono::steady_clock::now());
+    if (wait.count() > 0) {
+        std::this_thread::sleep_for(wait);
+    }
+}
+
+std::chrono::nanoseconds CompactionThrottle::acquire(
+        size_t bytes, std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lh(mutex);
+    if (intervalStart == std::chrono::steady_clock::time_point{}) {
+        intervalStart = now;
+    } else if (now - intervalStart >= updateInterval) {
+        update(now);
+    }
+
+    intervalBytes += bytes;
+    const auto limit = rateLimit.load();
+    if (limit == 0) {
+        return std::chrono::nanoseconds{0};
+    }
+
+    // Time the bytes written so far this interval should take at the limit.
+    const auto allowed = std::chrono::nanoseconds{
+            uint64_t(double(intervalBytes) * 1000000000 / limit)};
+    const auto elapsed = now - intervalStart;
+    if (allowed <= elapsed) {
+        return std::chrono::nanoseconds{0};
+    }
+    return std::min(std::chrono::nanoseconds(allowed - elapsed),
+                    std::chrono::nanoseconds(updateInterval));
+}
+
+void CompactionThrottle::update(std::chrono::steady_clock::time_point now) {
+    const auto elapsed = std::chrono::nanoseconds(now - intervalStart);
+    const auto measured =
+            size_t(double(intervalBytes) * 1000000000 / elapsed.count());
+    writeRate = measured;
+    intervalStart = now;
+    intervalBytes = 0;
+
+    const auto over = isOverTarget();
+    if (getState() == State::Disabled) {
+        rateLimit = 0;
+        return;
+    }
+
+    const auto step = std::max(minRate.load(), size_t(1));
+    const auto limit = rateLimit.load();
+    if (over) {
+        const auto base = limit ? limit : std::max(measured, step);
+        rateLimit = std::max(step, base / 2);
+    } else if (limit != 0) {
+        if (measured < limit / 2) {
+            // Compaction is no longer held back by the limit.
+            rateLimit = 0;
+        } else {
+            rateLimit = limit + step;
+        }
+    }
+}
+
+bool CompactionThrottle::isOverTarget() {
+    // Average BgFetch latency since the last update.
+    const uint64_t fetches = stats.bgNumOperations;
+    const uint64_t fetchTime = stats.bgWait + stats.bgLoad;
+    const auto newFetches = fetches - lastBgFetches;
+    const auto newFetchTime = fetchTime - lastBgFetchTime;
+    lastBgFetches = fetches;
+    lastBgFetchTime = fetchTime;
+
+    const auto bgTarget = bgFetchLatencyTarget.load();
+    if (bgTarget.count() != 0 && newFetches != 0 &&
+        newFetchTime / newFetches > uint64_t(bgTarget.count())) {
+        return true;
+    }
+
+    const auto ageTarget = dirtyAgeTarget.load();
+    return ageTarget.count() != 0 &&
+           stats.dirtyAge.load() > uint64_t(ageTarget.count());
+}
+
+CompactionThrottle::State CompactionThrottle::getState() const {
+    if (bgFetchLatencyTarget.load().count() == 0 &&
+        dirtyAgeTarget.load().count() == 0) {
+        return State::Disabled;
+    }
+    return rateLimit.load() ? State::Throttled : State::Unthrottled;
+}
+
+const char* CompactionThrottle::to_string(State state) {
+    switch (state) {
+    case State::Disabled:
+        return "disabled";
+    case State::Unthrottled:
+        return "unthrottled";
+    case State::Throttled:
+        return "throttled";
+    }
+    throw std::invalid_argument(
+            "CompactionThrottle::to_string: invalid state:" +
+            std::to_string(int(state)));
+}
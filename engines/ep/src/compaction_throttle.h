@@ -0,0 +1,116 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <relaxed_atomic.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+class EPStats;
+
+/**
+ * Limits the rate at which a bucket's compactions write to disk, so that
+ * compaction I/O does not push front-end latency over a target.
+ *
+ * Every compaction of the bucket calls acquire() (via beforeWrite()) before
+ * each write; the bytes written by all compactions are counted against a
+ * single rate limit. The limit is re-evaluated every updateInterval from the
+ * average BgFetch latency (wait + load) over the interval and the age of the
+ * items last persisted by the flusher (EPStats::dirtyAge):
+ *
+ * - if either is over its target the limit is halved (starting from the
+ *   measured write rate), down to minRate;
+ * - otherwise the limit is raised by minRate, and removed altogether once
+ *   compaction no longer writes fast enough to be held back by it.
+ *
+ * A target of zero disables that signal; with both disabled compaction is
+ * never throttled.
+ */
+class CompactionThrottle {
+public:
+    enum class State { Disabled, Unthrottled, Throttled };
+
+    static constexpr std::chrono::milliseconds updateInterval{100};
+
+    explicit CompactionThrottle(EPStats& stats);
+
+    /// Block as needed for the compaction to write the given bytes.
+    void beforeWrite(size_t bytes);
+
+    /**
+     * Account for the given bytes written at time now, re-evaluating the
+     * rate limit if updateInterval has elapsed.
+     * @return how long the writer must wait before writing them
+     */
+    std::chrono::nanoseconds acquire(size_t bytes,
+                                     std::chrono::steady_clock::time_point now);
+
+    /// Target for the average BgFetch latency; 0 disables.
+    void setBgFetchLatencyTarget(std::chrono::microseconds target) {
+        bgFetchLatencyTarget = target;
+    }
+
+    /// Target for the age of items when persisted; 0 disables.
+    void setDirtyAgeTarget(std::chrono::microseconds target) {
+        dirtyAgeTarget = target;
+    }
+
+    /// Lowest rate limit (and the step it is raised by), in bytes/s.
+    void setMinRate(size_t bytesPerSec) {
+        minRate = bytesPerSec;
+    }
+
+    State getState() const;
+
+    static const char* to_string(State state);
+
+    /// @return the current rate limit in bytes/s; 0 if unlimited.
+    size_t getRateLimit() const {
+        return rateLimit;
+    }
+
+    /// @return the compaction write rate over the last interval, in bytes/s.
+    size_t getWriteRate() const {
+        return writeRate;
+    }
+
+private:
+    /// Re-evaluate the rate limit at the end of an interval.
+    void update(std::chrono::steady_clock::time_point now);
+
+    bool isOverTarget();
+
+    EPStats& stats;
+
+    cb::RelaxedAtomic<std::chrono::microseconds> bgFetchLatencyTarget{
+            std::chrono::microseconds{0}};
+    cb::RelaxedAtomic<std::chrono::microseconds> dirtyAgeTarget{
+            std::chrono::microseconds{0}};
+    cb::RelaxedAtomic<size_t> minRate{0};
+
+    cb::RelaxedAtomic<size_t> rateLimit{0};
+    cb::RelaxedAtomic<size_t> writeRate{0};
+
+    /// Serialises access to the interval state below.
+    std::mutex mutex;
+    std::chrono::steady_clock::time_point intervalStart;
+    size_t intervalBytes = 0;
+    uint64_t lastBgFetches = 0;
+    uint64_t lastBgFetchTime = 0;
+};
@@ -142,6 +142,10 @@ struct Configuration::value_t {
     /// Is this parameter dynamic (can be changed at runtime?)
     const bool dynamic;
 
+    /// Updates the atomic copy of the value (if any, see addCache()). Called
+    /// with the mutex held whenever the value is set.
+    std::function<void(const value_variant_t&)> updateCache;
+
     std::vector<ValueChangedListener*> copyListeners() {
         std::vector<ValueChangedListener*> copy;
 
@@ -180,6 +184,9 @@ void Configuration::setParameter(const std::string& key, T value) {
             it->second->validator->validate(key, value);
         }
         it->second->value = value;
+        if (it->second->updateCache) {
+            it->second->updateCache(it->second->value);
+        }
 
         // Take a copy of the listeners so we can call them without holding
         // the mutex.
@@ -217,6 +224,20 @@ T Configuration::getParameter(const std::string& key) const {
     return *value;
 }
 
+template <class T>
+void Configuration::addCache(const std::string& key, std::atomic<T>& cache) {
+    LockHolder lh(mutex);
+    auto& attribute = *attributes.at(key);
+    attribute.updateCache = [&cache](const value_variant_t& value) {
+        // A value of another type is rejected by getParameter(); keep the
+        // last valid one.
+        if (const auto* typed = std::get_if<T>(&value)) {
+            cache.store(*typed, std::memory_order_relaxed);
+        }
+    };
+    attribute.updateCache(attribute.value);
+}
+
 template bool Configuration::getParameter<bool>(const std::string& key) const;
 template size_t Configuration::getParameter<size_t>(
         const std::string& key) const;
@@ -18,6 +18,7 @@
 
 #include <memcached/engine.h>
 
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <mutex>
@@ -181,7 +182,10 @@ public:
     Configuration();
     ~Configuration();
 
-    // Include the generated prototypes for the member functions
+    // Include the generated prototypes for the member functions. The getters
+    // of scalar (bool and numeric) parameters read an atomic copy of the
+    // value (see addCache()), so are lock-free and cheap enough to be called
+    // on hot paths instead of caching the value elsewhere.
 #include "generated_configuration.h" // NOLINT(*)
 
     /**
@@ -290,6 +294,15 @@ protected:
     template <class T>
     T getParameter(const std::string& key) const;
 
+    /**
+     * Mirror the given (scalar) parameter into `cache`, now and whenever it
+     * is set, so that it can be read without taking the mutex.
+     * @param key the key of the parameter
+     * @param cache the atomic to store the parameter's value in
+     */
+    template <class T>
+    void addCache(const std::string& key, std::atomic<T>& cache);
+
 private:
     void initialize();
 
@@ -55,6 +55,13 @@ bool RevisionSeqnoResolution::resolve(const StoredValue& v,
 
 }
 
+bool RevisionSeqnoResolution::winsAgainstBounds(const ItemMetaData& meta,
+                                                uint64_t maxCas,
+                                                uint64_t maxRevSeqno) const {
+    // The revision seqno is compared first; a larger one always wins
+    return meta.revSeqno > maxRevSeqno;
+}
+
 /**
  * A conflict resolution strategy that compares the meta data for a document
  * from a remote node and this node. This conflict resolution works by picking
@@ -91,3 +98,10 @@ bool LastWriteWinsResolution::resolve(const StoredValue& v,
     }
     return true;
 }
+
+bool LastWriteWinsResolution::winsAgainstBounds(const ItemMetaData& meta,
+                                                uint64_t maxCas,
+                                                uint64_t maxRevSeqno) const {
+    // The CAS is compared first; a larger one always wins
+    return meta.cas > maxCas;
+}
@@ -18,6 +18,8 @@
 
 #include <mcbp/protocol/datatype.h>
 
+#include <cstdint>
+
 class ItemMetaData;
 class StoredValue;
 
@@ -46,6 +48,19 @@ public:
                          const protocol_binary_datatype_t meta_datatype,
                          bool isDelete = false) const = 0;
 
+    /**
+     * Does the remote document win against every local document whose CAS
+     * and revision seqno don't exceed the given bounds?
+     *
+     * @param meta the remote document's meta data
+     * @param maxCas the largest CAS of the local documents
+     * @param maxRevSeqno the largest revision seqno of the local documents
+     * @return true if the remote document is the winner whatever the local
+     *         document is (false if it's unknown)
+     */
+    virtual bool winsAgainstBounds(const ItemMetaData& meta,
+                                   uint64_t maxCas,
+                                   uint64_t maxRevSeqno) const = 0;
 };
 
 class RevisionSeqnoResolution : public ConflictResolution {
@@ -54,6 +69,10 @@ public:
                  const ItemMetaData& meta,
                  const protocol_binary_datatype_t meta_datatype,
                  bool isDelete = false) const override;
+
+    bool winsAgainstBounds(const ItemMetaData& meta,
+                           uint64_t maxCas,
+                           uint64_t maxRevSeqno) const override;
 };
 
 class LastWriteWinsResolution : public ConflictResolution {
@@ -62,4 +81,8 @@ public:
                  const ItemMetaData& meta,
                  const protocol_binary_datatype_t meta_datatype,
                  bool isDelete = false) const override;
+
+    bool winsAgainstBounds(const ItemMetaData& meta,
+                           uint64_t maxCas,
+                           uint64_t maxRevSeqno) const override;
 };
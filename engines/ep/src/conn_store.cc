@@ -20,19 +20,23 @@
 #include "connhandler.h"
 #include "ep_engine.h"
 
+#include <algorithm>
+
 ConnStore::ConnStore(EventuallyPersistentEngine& engine)
     : cookieToConnHandle(CookieToConnMapHandle(*this)),
       vbToConns(engine.getConfiguration().getMaxVbuckets()) {
+    const auto empty = std::make_shared<VBConnList>();
+    for (auto& conns : vbToConns) {
+        conns.store(empty);
+    }
 }
 
-ConnStore::IterableHandle<std::list<ConnStore::VBConn>>
-ConnStore::getConnsForVBHandle(Vbid vb) {
-    size_t index = vb.get() % vbConnLocks.size();
-    return {vbToConns[vb.get()],
-            std::unique_lock<std::mutex>(vbConnLocks[index])};
+ConnStore::IterableHandle<ConnStore::VBConnList>
+ConnStore::getConnsForVBHandle(Vbid vb) const {
+    return IterableHandle<VBConnList>(vbToConns[vb.get()].load());
 }
 
-void ConnStore::addVBConnByVbid(Vbid vbid, ConnHandler& conn) {
+void ConnStore::addVBConnByVbid(Vbid vbid, std::shared_ptr<ConnHandler> conn) {
     if (vbid.get() > vbToConns.size()) {
         throw std::out_of_range(
                 "ConnStore::addVBConnByVbid attempting to add a "
@@ -41,18 +45,19 @@ void ConnStore::addVBConnByVbid(Vbid vbid, ConnHandler& conn) {
     }
 
     size_t lock_num = vbid.get() % vbConnLocks.size();
-    std::unique_lock<std::mutex> lh(vbConnLocks[lock_num]);
+    std::lock_guard<std::mutex> lh(vbConnLocks[lock_num]);
 
-    auto& list = vbToConns[vbid.get()];
-    auto itr = getVBToConnsItr(lh, vbid, conn);
+    auto list = *vbToConns[vbid.get()].load();
+    auto itr = findVBConn(list, conn->getCookie());
 
     // For collections we will allow many streams for a given vBucket per
     // Producer. For this, bump the refCount of the VBConn with each new stream.
     if (itr == list.end()) {
-        vbToConns[vbid.get()].emplace_back(VBConn{conn, 1});
+        list.push_back(VBConn{std::move(conn), 1});
     } else {
-        itr->refCount++;
+        list[itr - list.cbegin()].refCount++;
     }
+    publishVBConns(vbid, std::move(list));
 }
 
 void ConnStore::removeVBConnByVbid(Vbid vbid, const void* cookie) {
@@ -64,71 +69,46 @@ void ConnStore::removeVBConnByVbid(Vbid vbid, const void* cookie) {
     }
 
     size_t lock_num = vbid.get() % vbConnLocks.size();
-    std::unique_lock<std::mutex> lh(vbConnLocks[lock_num]);
+    std::lock_guard<std::mutex> lh(vbConnLocks[lock_num]);
 
-    auto& list = vbToConns[vbid.get()];
-    auto itr = getVBToConnsItr(lh, vbid, cookie);
+    auto list = *vbToConns[vbid.get()].load();
+    auto itr = findVBConn(list, cookie);
 
     if (itr != list.end()) {
         // Decrement then check if we should remove the Conn from vbToConns map.
-        if (--itr->refCount == 0) {
+        auto& vbConn = list[itr - list.cbegin()];
+        if (--vbConn.refCount == 0) {
             list.erase(itr);
         }
+        publishVBConns(vbid, std::move(list));
     }
 }
 
-ConnStore::VBToConnsMap::value_type::iterator ConnStore::getVBToConnsItr(
-        std::unique_lock<std::mutex>& lock,
-        Vbid vbid,
-        const ConnHandler& conn) {
-    return getVBToConnsItr(lock, vbid, conn.getCookie());
-}
-
-ConnStore::VBToConnsMap::value_type::iterator ConnStore::getVBToConnsItr(
-        std::unique_lock<std::mutex>& lock, Vbid vbid, const void* cookie) {
-    return getVBToConnsItr(lock, vbid, [cookie](const VBConn& listConn) {
-        return listConn.connHandler.getCookie() == cookie;
-    });
-}
-
-ConnStore::VBToConnsMap::value_type::iterator ConnStore::getVBToConnsItr(
-        std::unique_lock<std::mutex>& lock,
-        Vbid vbid,
-        const std::string& name) {
-    return getVBToConnsItr(lock, vbid, [name](const VBConn& listConn) {
-        return listConn.connHandler.getName() == name;
-    });
-}
-
-template <class Predicate>
-ConnStore::VBToConnsMap::value_type::iterator ConnStore::getVBToConnsItr(
-        std::unique_lock<std::mutex>& lock, Vbid vbid, Predicate p) {
-    auto& list = vbToConns[vbid.get()];
-    return std::find_if(list.begin(), list.end(), p);
+ConnStore::VBConnList::const_iterator ConnStore::findVBConn(
+        const VBConnList& list, const void* cookie) {
+    return std::find_if(
+            list.begin(), list.end(), [cookie](const VBConn& listConn) {
+                return listConn.connHandler->getCookie() == cookie;
+            });
 }
 
-bool ConnStore::doesVbConnExist(Vbid vbid, const void* cookie) {
-    size_t lock_num = vbid.get() % vbConnLocks.size();
-    std::unique_lock<std::mutex> lh(vbConnLocks[lock_num]);
-    auto itr = getVBToConnsItr(lh, vbid, cookie);
-
-    return doesVbConnExistInner(vbid, itr);
+void ConnStore::publishVBConns(Vbid vbid, VBConnList list) {
+    vbToConns[vbid.get()].store(
+            std::make_shared<VBConnList>(std::move(list)));
 }
 
-bool ConnStore::doesVbConnExist(Vbid vbid, const std::string& name) {
-    size_t lock_num = vbid.get() % vbConnLocks.size();
-    std::unique_lock<std::mutex> lh(vbConnLocks[lock_num]);
-    auto itr = getVBToConnsItr(lh, vbid, name);
-    return doesVbConnExistInner(vbid, itr);
+bool ConnStore::doesVbConnExist(Vbid vbid, const void* cookie) const {
+    auto list = vbToConns[vbid.get()].load();
+    return findVBConn(*list, cookie) != list->end();
 }
 
-bool ConnStore::doesVbConnExistInner(
-        Vbid vbid, ConnStore::VBToConnsMap::value_type::iterator itr) {
-    auto& list = vbToConns[vbid.get()];
-    if (itr == list.end()) {
-        return false;
-    }
-    return true;
+bool ConnStore::doesVbConnExist(Vbid vbid, const std::string& name) const {
+    auto list = vbToConns[vbid.get()].load();
+    return std::find_if(list->begin(),
+                        list->end(),
+                        [&name](const VBConn& listConn) {
+                            return listConn.connHandler->getName() == name;
+                        }) != list->end();
 }
 
 std::shared_ptr<ConnHandler>
@@ -173,12 +153,15 @@ void ConnStore::CookieToConnMapHandle::removeConnByCookie(const void* cookie) {
         // Remove all ConnHandlers associated with this cookie from vbToConns
         for (size_t i = 0; i < connStore.vbToConns.size(); i++) {
             size_t lock_num = i % connStore.vbConnLocks.size();
-            std::unique_lock<std::mutex> lh(connStore.vbConnLocks[lock_num]);
-
-            auto& list = connStore.vbToConns[i];
-            list.remove_if([cookie](VBConn listConn) {
-                return cookie == listConn.connHandler.getCookie();
-            });
+            std::lock_guard<std::mutex> lh(connStore.vbConnLocks[lock_num]);
+
+            auto current = connStore.vbToConns[i].load();
+            if (findVBConn(*current, cookie) == current->end()) {
+                continue;
+            }
+            auto list = *current;
+            list.erase(findVBConn(list, cookie));
+            connStore.publishVBConns(Vbid(i), std::move(list));
         }
         cookieToConn.erase(itr);
     }
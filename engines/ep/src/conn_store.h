@@ -22,8 +22,8 @@
 #include "dcp/dcp-types.h"
 
 #include <folly/Synchronized.h>
+#include <folly/concurrency/AtomicSharedPtr.h>
 
-#include <list>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
@@ -55,6 +55,14 @@ class Vbid;
  * and should we have multiple streams per vBucket then a refCount is bumped.
  * This allows us to clean up the reference entry when all streams are closed.
  *
+ * The ConnHandlers of a vBucket are read on every mutation (to notify
+ * producers of new seqnos), but only change when streams are opened or closed.
+ * Each vBucket's list is therefore an immutable vector published through an
+ * atomic shared_ptr: readers take a snapshot without locking, writers
+ * (serialised by vbConnLocks) copy the current list, modify the copy and
+ * publish it. The VBConns hold an owning reference to their ConnHandler so
+ * that a reader's snapshot remains valid after the ConnHandler is removed.
+ *
  * When a connection is disconnected, (a ConnHandler is removed from the
  * CookieToConnection map) we clean up the reference to the ConnHandler in the
  * VbToConns map to ensure that we do not try to access a stale reference after
@@ -70,44 +78,39 @@ public:
      * refCount is 0.
      */
     struct VBConn {
-        ConnHandler& connHandler;
+        std::shared_ptr<ConnHandler> connHandler;
         uint8_t refCount = 0;
     };
 
-    using VBToConnsMap = std::vector<std::list<VBConn>>;
+    using VBConnList = std::vector<VBConn>;
+    using VBToConnsMap =
+            std::vector<folly::atomic_shared_ptr<VBConnList>>;
 
     explicit ConnStore(EventuallyPersistentEngine& engine);
 
     /**
-     * Locked iteration handle for consumers to iterate on one of the elements
-     * of VBToConnsMap.
+     * Iteration handle for consumers to iterate on a snapshot of one of the
+     * elements of VBToConnsMap. The snapshot is immutable and keeps its
+     * ConnHandlers alive, so no lock is held while iterating.
      *
      * @tparam Container Type of iterable container
      */
     template <typename Container>
     struct IterableHandle {
-        IterableHandle(Container& container, std::unique_lock<std::mutex>&& lg)
-            : container(container), lg(std::move(lg)) {
+        explicit IterableHandle(std::shared_ptr<const Container> container)
+            : container(std::move(container)) {
         }
 
-        // Copy is not allowed as we cannot copy the lock
-        IterableHandle(const IterableHandle&) = delete;
-        IterableHandle& operator=(const IterableHandle&) = delete;
-
-        IterableHandle(IterableHandle&& other) = default;
-        IterableHandle& operator=(IterableHandle&& other) = default;
-
         typename Container::const_iterator begin() const {
-            return container.cbegin();
+            return container->cbegin();
         }
 
         typename Container::const_iterator end() const {
-            return container.cend();
+            return container->cend();
         }
 
     protected:
-        Container& container;
-        std::unique_lock<std::mutex> lg;
+        std::shared_ptr<const Container> container;
     };
 
     /**
@@ -199,9 +202,10 @@ public:
     }
 
     /**
-     * Get a locked handle on the list of VBConns for a given VB.
+     * Get a handle on a snapshot of the list of VBConns for a given VB.
+     * Lock-free.
      */
-    IterableHandle<std::list<VBConn>> getConnsForVBHandle(Vbid vb);
+    IterableHandle<VBConnList> getConnsForVBHandle(Vbid vb) const;
 
     /**
      * Get the ConnHandler reference from the vbToConns map for the given name.
@@ -210,7 +214,7 @@ public:
      * @param name name to lookup
      * @return True if the ConnHandler exists
      */
-    bool doesVbConnExist(Vbid vbid, const std::string& name);
+    bool doesVbConnExist(Vbid vbid, const std::string& name) const;
 
     /**
      * Get the ConnHandler reference from the vbToConns map for the given cookie
@@ -219,7 +223,7 @@ public:
      * @param cookie cookie of the ConnHandler
      * @return True if the ConnHandler exists
      */
-    bool doesVbConnExist(Vbid vbid, const void* cookie);
+    bool doesVbConnExist(Vbid vbid, const void* cookie) const;
 
     /**
      * Add a reference to vbToConns for the given ConnHandler.
@@ -227,7 +231,7 @@ public:
      * @param vbid the vBucket that the ConnHandler serves
      * @param conn the connection
      */
-    void addVBConnByVbid(Vbid vbid, ConnHandler& conn);
+    void addVBConnByVbid(Vbid vbid, std::shared_ptr<ConnHandler> conn);
 
     /**
      * Remove the reference in vbToConns for the given cookie (ConnHandler).
@@ -238,24 +242,18 @@ public:
     void removeVBConnByVbid(Vbid vbid, const void* cookie);
 
 protected:
-    VBToConnsMap::value_type::iterator getVBToConnsItr(
-            std::unique_lock<std::mutex>& lock,
-            Vbid vbid,
-            const ConnHandler& conn);
-    VBToConnsMap::value_type::iterator getVBToConnsItr(
-            std::unique_lock<std::mutex>& lock, Vbid vbid, const void* cookie);
-    VBToConnsMap::value_type::iterator getVBToConnsItr(
-            std::unique_lock<std::mutex>& lock,
-            Vbid vbid,
-            const std::string& name);
-    template <class Predicate>
-    VBToConnsMap::value_type::iterator getVBToConnsItr(
-            std::unique_lock<std::mutex>& lock, Vbid vbid, Predicate p);
+    /**
+     * @return the position in the given list of the VBConn for the given
+     *         cookie, or list.end()
+     */
+    static VBConnList::const_iterator findVBConn(const VBConnList& list,
+                                                 const void* cookie);
 
     /**
-     * @return true if VbConn entry exists.
+     * Publish a new list of VBConns for the given vBucket. Caller must hold
+     * the vbConnLocks entry of the vBucket.
      */
-    bool doesVbConnExistInner(Vbid vbid, VBToConnsMap::value_type::iterator);
+    void publishVBConns(Vbid vbid, VBConnList list);
 
     folly::Synchronized<CookieToConnMapHandle> cookieToConnHandle;
 
@@ -266,5 +264,7 @@ protected:
      * ConnHandler for any given vBucket must always be valid.
      */
     VBToConnsMap vbToConns;
+
+    /// Serialise the writers of vbToConns, readers do not lock
     std::vector<std::mutex> vbConnLocks{32};
 };
@@ -177,8 +177,8 @@ void ConnMap::processPendingNotifications() {
     }
 }
 
-void ConnMap::addVBConnByVBId(ConnHandler& conn, Vbid vbid) {
-    connStore->addVBConnByVbid(vbid, conn);
+void ConnMap::addVBConnByVBId(std::shared_ptr<ConnHandler> conn, Vbid vbid) {
+    connStore->addVBConnByVbid(vbid, std::move(conn));
 }
 
 void ConnMap::removeVBConnByVBId(const void* connCookie, Vbid vbid) {
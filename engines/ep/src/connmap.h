@@ -26,6 +26,7 @@
 #include <iterator>
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -72,7 +73,7 @@ public:
      * @param conn Connection to add to the set.
      * @param vbid vBucket to add to.
      */
-    void addVBConnByVBId(ConnHandler& conn, Vbid vbid);
+    void addVBConnByVBId(std::shared_ptr<ConnHandler> conn, Vbid vbid);
 
     void removeVBConnByVBId(const void* connCookie, Vbid vbid);
 
@@ -0,0 +1,189 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-fs-coalesce-writes.h"
+#include "kvstore.h"
+
+couchstore_error_t CoalescingWriteOps::writeBuffer(
+        couchstore_error_info_t* errinfo, CoalescingFile& file) {
+    if (file.buffer.empty()) {
+        return COUCHSTORE_SUCCESS;
+    }
+
+    const auto size = file.buffer.size();
+    const auto written = wrapped_ops.pwrite(errinfo,
+                                            file.orig_handle,
+                                            file.buffer.data(),
+                                            size,
+                                            file.bufferOffset);
+    file.buffer.clear();
+    if (written < 0) {
+        return static_cast<couchstore_error_t>(written);
+    }
+    if (size_t(written) != size) {
+        return COUCHSTORE_ERROR_WRITE;
+    }
+    return COUCHSTORE_SUCCESS;
+}
+
+couch_file_handle CoalescingWriteOps::constructor(
+        couchstore_error_info_t* errinfo) {
+    auto* file = new CoalescingFile(wrapped_ops.constructor(errinfo));
+    return reinterpret_cast<couch_file_handle>(file);
+}
+
+couchstore_error_t CoalescingWriteOps::open(couchstore_error_info_t* errinfo,
+                                            couch_file_handle* h,
+                                            const char* path,
+                                            int flags) {
+    auto* file = reinterpret_cast<CoalescingFile*>(*h);
+    file->buffer.clear();
+    file->submitted_write_count_since_open = 0;
+    return wrapped_ops.open(errinfo, &file->orig_handle, path, flags);
+}
+
+couchstore_error_t CoalescingWriteOps::close(couchstore_error_info_t* errinfo,
+                                             couch_file_handle h) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    if (file->submitted_write_count_since_open > 0) {
+        stats.submittedWriteCountHisto.add(
+                file->submitted_write_count_since_open);
+    }
+
+    const auto err = writeBuffer(errinfo, *file);
+    // Release the buffer's memory while the file is closed.
+    std::vector<char>().swap(file->buffer);
+    const auto closeErr = wrapped_ops.close(errinfo, file->orig_handle);
+    return err != COUCHSTORE_SUCCESS ? err : closeErr;
+}
+
+couchstore_error_t CoalescingWriteOps::set_periodic_sync(
+        couch_file_handle h, uint64_t period_bytes) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    return wrapped_ops.set_periodic_sync(file->orig_handle, period_bytes);
+}
+
+couchstore_error_t CoalescingWriteOps::set_tracing_enabled(
+        couch_file_handle h) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    return wrapped_ops.set_tracing_enabled(file->orig_handle);
+}
+
+couchstore_error_t CoalescingWriteOps::set_write_validation_enabled(
+        couch_file_handle h) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    return wrapped_ops.set_write_validation_enabled(file->orig_handle);
+}
+
+couchstore_error_t CoalescingWriteOps::set_mprotect_enabled(
+        couch_file_handle h) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    return wrapped_ops.set_mprotect_enabled(file->orig_handle);
+}
+
+ssize_t CoalescingWriteOps::pread(couchstore_error_info_t* errinfo,
+                                  couch_file_handle h,
+                                  void* buf,
+                                  size_t sz,
+                                  cs_off_t off) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    // Reads of anything still buffered must see it.
+    if (!file->buffer.empty() && off + cs_off_t(sz) > file->bufferOffset) {
+        const auto err = writeBuffer(errinfo, *file);
+        if (err != COUCHSTORE_SUCCESS) {
+            return err;
+        }
+    }
+    return wrapped_ops.pread(errinfo, file->orig_handle, buf, sz, off);
+}
+
+ssize_t CoalescingWriteOps::pwrite(couchstore_error_info_t* errinfo,
+                                   couch_file_handle h,
+                                   const void* buf,
+                                   size_t sz,
+                                   cs_off_t off) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    ++file->submitted_write_count_since_open;
+
+    auto& buffer = file->buffer;
+    if (!buffer.empty() &&
+        off != file->bufferOffset + cs_off_t(buffer.size())) {
+        const auto err = writeBuffer(errinfo, *file);
+        if (err != COUCHSTORE_SUCCESS) {
+            return err;
+        }
+    }
+
+    if (buffer.empty()) {
+        if (sz >= bufferSize) {
+            // Too large to gain anything from buffering.
+            return wrapped_ops.pwrite(errinfo, file->orig_handle, buf, sz, off);
+        }
+        buffer.reserve(bufferSize);
+        file->bufferOffset = off;
+    }
+
+    const auto* data = static_cast<const char*>(buf);
+    buffer.insert(buffer.end(), data, data + sz);
+    if (buffer.size() >= bufferSize) {
+        const auto err = writeBuffer(errinfo, *file);
+        if (err != COUCHSTORE_SUCCESS) {
+            return err;
+        }
+    }
+    return sz;
+}
+
+cs_off_t CoalescingWriteOps::goto_eof(couchstore_error_info_t* errinfo,
+                                      couch_file_handle h) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    const auto err = writeBuffer(errinfo, *file);
+    if (err != COUCHSTORE_SUCCESS) {
+        return err;
+    }
+    return wrapped_ops.goto_eof(errinfo, file->orig_handle);
+}
+
+couchstore_error_t CoalescingWriteOps::sync(couchstore_error_info_t* errinfo,
+                                            couch_file_handle h) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    const auto err = writeBuffer(errinfo, *file);
+    if (err != COUCHSTORE_SUCCESS) {
+        return err;
+    }
+    return wrapped_ops.sync(errinfo, file->orig_handle);
+}
+
+couchstore_error_t CoalescingWriteOps::advise(couchstore_error_info_t* errinfo,
+                                              couch_file_handle h,
+                                              cs_off_t offs,
+                                              cs_off_t len,
+                                              couchstore_file_advice_t adv) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    return wrapped_ops.advise(errinfo, file->orig_handle, offs, len, adv);
+}
+
+FileOpsInterface::FHStats* CoalescingWriteOps::get_stats(couch_file_handle h) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    return wrapped_ops.get_stats(file->orig_handle);
+}
+
+void CoalescingWriteOps::destructor(couch_file_handle h) {
+    auto* file = reinterpret_cast<CoalescingFile*>(h);
+    wrapped_ops.destructor(file->orig_handle);
+    delete file;
+}
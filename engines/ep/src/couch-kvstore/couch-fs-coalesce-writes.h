@@ -0,0 +1,110 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <libcouchstore/couch_db.h>
+
+#include <vector>
+
+struct FileStats;
+
+/**
+ * FileOpsInterface implementation which coalesces the writes made by
+ * Couchstore, so that flushing a batch of documents issues a few large
+ * writes to the wrapped ops instead of one per document body / btree node.
+ *
+ * Couchstore only ever appends, so each write which continues the one before
+ * it is gathered into a per-file buffer of up to bufferSize bytes. The buffer
+ * is written out when it is full, when a non-contiguous write is made, and
+ * before any read of the buffered range, goto_eof(), sync() or close() of the
+ * file - so durability (which depends on sync) and read-your-writes are
+ * unchanged.
+ *
+ * The number of writes submitted by Couchstore per open() / close() pair is
+ * recorded in FileStats::submittedWriteCountHisto; compare with
+ * FileStats::writeCountHisto (recorded by the wrapped StatsOps) for the
+ * writes actually issued.
+ */
+class CoalescingWriteOps : public FileOpsInterface {
+public:
+    CoalescingWriteOps(FileStats& stats,
+                       FileOpsInterface& ops,
+                       size_t bufferSize)
+        : stats(stats), wrapped_ops(ops), bufferSize(bufferSize) {
+    }
+
+    couch_file_handle constructor(couchstore_error_info_t* errinfo) override;
+    couchstore_error_t open(couchstore_error_info_t* errinfo,
+                            couch_file_handle* handle,
+                            const char* path,
+                            int oflag) override;
+    couchstore_error_t close(couchstore_error_info_t* errinfo,
+                             couch_file_handle handle) override;
+    couchstore_error_t set_periodic_sync(couch_file_handle handle,
+                                         uint64_t period_bytes) override;
+    couchstore_error_t set_tracing_enabled(couch_file_handle handle) override;
+    couchstore_error_t set_write_validation_enabled(
+            couch_file_handle handle) override;
+    couchstore_error_t set_mprotect_enabled(couch_file_handle handle) override;
+
+    ssize_t pread(couchstore_error_info_t* errinfo,
+                  couch_file_handle handle,
+                  void* buf,
+                  size_t nbytes,
+                  cs_off_t offset) override;
+    ssize_t pwrite(couchstore_error_info_t* errinfo,
+                   couch_file_handle handle,
+                   const void* buf,
+                   size_t nbytes,
+                   cs_off_t offset) override;
+    cs_off_t goto_eof(couchstore_error_info_t* errinfo,
+                      couch_file_handle handle) override;
+    couchstore_error_t sync(couchstore_error_info_t* errinfo,
+                            couch_file_handle handle) override;
+    couchstore_error_t advise(couchstore_error_info_t* errinfo,
+                              couch_file_handle handle,
+                              cs_off_t offset,
+                              cs_off_t len,
+                              couchstore_file_advice_t advice) override;
+    FHStats* get_stats(couch_file_handle handle) override;
+    void destructor(couch_file_handle handle) override;
+
+protected:
+    struct CoalescingFile {
+        explicit CoalescingFile(couch_file_handle orig_handle)
+            : orig_handle(orig_handle) {
+        }
+
+        couch_file_handle orig_handle;
+
+        /// Data written but not yet passed to the wrapped ops.
+        std::vector<char> buffer;
+        /// File offset of the first byte of buffer.
+        cs_off_t bufferOffset = 0;
+        /// Number of pwrite() calls made since the file was last opened.
+        size_t submitted_write_count_since_open = 0;
+    };
+
+    /// Write out (and empty) the file's buffer.
+    couchstore_error_t writeBuffer(couchstore_error_info_t* errinfo,
+                                   CoalescingFile& file);
+
+    FileStats& stats;
+    FileOpsInterface& wrapped_ops;
+    const size_t bufferSize;
+};
@@ -0,0 +1,169 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-fs-deferred-sync.h"
+
+void DeferredSyncOps::setDeferSyncs(bool value) {
+    std::lock_guard<std::mutex> lh(mutex);
+    deferSyncs = value;
+}
+
+couchstore_error_t DeferredSyncOps::syncDeferred(
+        couchstore_error_info_t* errinfo) {
+    std::unordered_set<DeferredFile*> toSync;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        toSync.swap(deferred);
+    }
+
+    auto result = COUCHSTORE_SUCCESS;
+    for (auto* file : toSync) {
+        const auto err = wrapped_ops.sync(errinfo, file->orig_handle);
+        if (err != COUCHSTORE_SUCCESS && result == COUCHSTORE_SUCCESS) {
+            result = err;
+        }
+    }
+    return result;
+}
+
+size_t DeferredSyncOps::getNumDeferred() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return deferred.size();
+}
+
+couchstore_error_t DeferredSyncOps::syncIfDeferred(
+        couchstore_error_info_t* errinfo, DeferredFile& file) {
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        if (deferred.erase(&file) == 0) {
+            return COUCHSTORE_SUCCESS;
+        }
+    }
+    return wrapped_ops.sync(errinfo, file.orig_handle);
+}
+
+couch_file_handle DeferredSyncOps::constructor(
+        couchstore_error_info_t* errinfo) {
+    auto* file = new DeferredFile(wrapped_ops.constructor(errinfo));
+    return reinterpret_cast<couch_file_handle>(file);
+}
+
+couchstore_error_t DeferredSyncOps::open(couchstore_error_info_t* errinfo,
+                                         couch_file_handle* h,
+                                         const char* path,
+                                         int flags) {
+    auto* file = reinterpret_cast<DeferredFile*>(*h);
+    return wrapped_ops.open(errinfo, &file->orig_handle, path, flags);
+}
+
+couchstore_error_t DeferredSyncOps::close(couchstore_error_info_t* errinfo,
+                                          couch_file_handle h) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    // The file cannot be synced once closed.
+    const auto err = syncIfDeferred(errinfo, *file);
+    const auto closeErr = wrapped_ops.close(errinfo, file->orig_handle);
+    return err != COUCHSTORE_SUCCESS ? err : closeErr;
+}
+
+couchstore_error_t DeferredSyncOps::set_periodic_sync(couch_file_handle h,
+                                                      uint64_t period_bytes) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    return wrapped_ops.set_periodic_sync(file->orig_handle, period_bytes);
+}
+
+couchstore_error_t DeferredSyncOps::set_tracing_enabled(couch_file_handle h) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    return wrapped_ops.set_tracing_enabled(file->orig_handle);
+}
+
+couchstore_error_t DeferredSyncOps::set_write_validation_enabled(
+        couch_file_handle h) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    return wrapped_ops.set_write_validation_enabled(file->orig_handle);
+}
+
+couchstore_error_t DeferredSyncOps::set_mprotect_enabled(couch_file_handle h) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    return wrapped_ops.set_mprotect_enabled(file->orig_handle);
+}
+
+ssize_t DeferredSyncOps::pread(couchstore_error_info_t* errinfo,
+                               couch_file_handle h,
+                               void* buf,
+                               size_t sz,
+                               cs_off_t off) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    return wrapped_ops.pread(errinfo, file->orig_handle, buf, sz, off);
+}
+
+ssize_t DeferredSyncOps::pwrite(couchstore_error_info_t* errinfo,
+                                couch_file_handle h,
+                                const void* buf,
+                                size_t sz,
+                                cs_off_t off) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    // Anything written after a sync must not reach the disk before the data
+    // written before it, so perform any deferred sync first.
+    const auto err = syncIfDeferred(errinfo, *file);
+    if (err != COUCHSTORE_SUCCESS) {
+        return err;
+    }
+    return wrapped_ops.pwrite(errinfo, file->orig_handle, buf, sz, off);
+}
+
+cs_off_t DeferredSyncOps::goto_eof(couchstore_error_info_t* errinfo,
+                                   couch_file_handle h) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    return wrapped_ops.goto_eof(errinfo, file->orig_handle);
+}
+
+couchstore_error_t DeferredSyncOps::sync(couchstore_error_info_t* errinfo,
+                                         couch_file_handle h) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        if (deferSyncs) {
+            deferred.insert(file);
+            return COUCHSTORE_SUCCESS;
+        }
+    }
+    return wrapped_ops.sync(errinfo, file->orig_handle);
+}
+
+couchstore_error_t DeferredSyncOps::advise(couchstore_error_info_t* errinfo,
+                                           couch_file_handle h,
+                                           cs_off_t offs,
+                                           cs_off_t len,
+                                           couchstore_file_advice_t adv) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    return wrapped_ops.advise(errinfo, file->orig_handle, offs, len, adv);
+}
+
+FileOpsInterface::FHStats* DeferredSyncOps::get_stats(couch_file_handle h) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    return wrapped_ops.get_stats(file->orig_handle);
+}
+
+void DeferredSyncOps::destructor(couch_file_handle h) {
+    auto* file = reinterpret_cast<DeferredFile*>(h);
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        deferred.erase(file);
+    }
+    wrapped_ops.destructor(file->orig_handle);
+    delete file;
+}
@@ -0,0 +1,111 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <libcouchstore/couch_db.h>
+
+#include <mutex>
+#include <unordered_set>
+
+/**
+ * FileOpsInterface implementation which can defer the sync() calls made by
+ * Couchstore, so that the durability barriers of the commits to several files
+ * can be issued together (group commit).
+ *
+ * While deferring, a sync() of a file is only recorded. The recorded sync is
+ * performed before any further write to (or the close of) that file, so the
+ * ordering Couchstore relies on - data is synced before the header which
+ * references it is written - is preserved; only the final sync of a commit
+ * (of the header) is left outstanding until syncDeferred() is called.
+ *
+ * When not deferring all operations are passed through to the wrapped ops.
+ */
+class DeferredSyncOps : public FileOpsInterface {
+public:
+    explicit DeferredSyncOps(FileOpsInterface& ops) : wrapped_ops(ops) {
+    }
+
+    /// Start (or stop) deferring syncs. Stopping does not sync.
+    void setDeferSyncs(bool value);
+
+    /**
+     * Perform all deferred syncs.
+     * @return COUCHSTORE_SUCCESS, or the first error encountered (all
+     *         deferred syncs are attempted regardless).
+     */
+    couchstore_error_t syncDeferred(couchstore_error_info_t* errinfo);
+
+    /// @return the number of files with a deferred sync outstanding
+    size_t getNumDeferred() const;
+
+    couch_file_handle constructor(couchstore_error_info_t* errinfo) override;
+    couchstore_error_t open(couchstore_error_info_t* errinfo,
+                            couch_file_handle* handle,
+                            const char* path,
+                            int oflag) override;
+    couchstore_error_t close(couchstore_error_info_t* errinfo,
+                             couch_file_handle handle) override;
+    couchstore_error_t set_periodic_sync(couch_file_handle handle,
+                                         uint64_t period_bytes) override;
+    couchstore_error_t set_tracing_enabled(couch_file_handle handle) override;
+    couchstore_error_t set_write_validation_enabled(
+            couch_file_handle handle) override;
+    couchstore_error_t set_mprotect_enabled(couch_file_handle handle) override;
+
+    ssize_t pread(couchstore_error_info_t* errinfo,
+                  couch_file_handle handle,
+                  void* buf,
+                  size_t nbytes,
+                  cs_off_t offset) override;
+    ssize_t pwrite(couchstore_error_info_t* errinfo,
+                   couch_file_handle handle,
+                   const void* buf,
+                   size_t nbytes,
+                   cs_off_t offset) override;
+    cs_off_t goto_eof(couchstore_error_info_t* errinfo,
+                      couch_file_handle handle) override;
+    couchstore_error_t sync(couchstore_error_info_t* errinfo,
+                            couch_file_handle handle) override;
+    couchstore_error_t advise(couchstore_error_info_t* errinfo,
+                              couch_file_handle handle,
+                              cs_off_t offset,
+                              cs_off_t len,
+                              couchstore_file_advice_t advice) override;
+    FHStats* get_stats(couch_file_handle handle) override;
+    void destructor(couch_file_handle handle) override;
+
+protected:
+    struct DeferredFile {
+        explicit DeferredFile(couch_file_handle orig_handle)
+            : orig_handle(orig_handle) {
+        }
+
+        couch_file_handle orig_handle;
+    };
+
+    /// Perform the file's deferred sync, if it has one.
+    couchstore_error_t syncIfDeferred(couchstore_error_info_t* errinfo,
+                                      DeferredFile& file);
+
+    FileOpsInterface& wrapped_ops;
+
+    mutable std::mutex mutex;
+    bool deferSyncs = false;
+    /// Files which have a deferred sync outstanding.
+    std::unordered_set<DeferredFile*> deferred;
+};
@@ -0,0 +1,202 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-fs-mmap-reads.h"
+#include "kvstore.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+
+/// @return the major page faults taken by the calling thread so far.
+static long getThreadMajorFaults() {
+#ifdef RUSAGE_THREAD
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+        return usage.ru_majflt;
+    }
+#endif
+    return 0;
+}
+
+void MmapReadOps::map(MmapFile& file) {
+    struct stat st;
+    if (fstat(file.fd, &st) != 0 || size_t(st.st_size) <= file.mappedSize) {
+        return;
+    }
+
+    if (file.mapping) {
+        munmap(const_cast<char*>(file.mapping), file.mappedSize);
+        stats.mmapMappedBytes -= file.mappedSize;
+        file.mapping = nullptr;
+        file.mappedSize = 0;
+    }
+
+    auto* mapping =
+            mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, file.fd, 0);
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+    file.mapping = static_cast<const char*>(mapping);
+    file.mappedSize = st.st_size;
+    stats.mmapMappedBytes += file.mappedSize;
+}
+
+void MmapReadOps::unmap(MmapFile& file) {
+    if (file.mapping) {
+        munmap(const_cast<char*>(file.mapping), file.mappedSize);
+        stats.mmapMappedBytes -= file.mappedSize;
+        file.mapping = nullptr;
+        file.mappedSize = 0;
+    }
+    if (file.fd != -1) {
+        ::close(file.fd);
+        file.fd = -1;
+    }
+}
+
+couch_file_handle MmapReadOps::constructor(couchstore_error_info_t* errinfo) {
+    auto* file = new MmapFile(wrapped_ops.constructor(errinfo));
+    return reinterpret_cast<couch_file_handle>(file);
+}
+
+couchstore_error_t MmapReadOps::open(couchstore_error_info_t* errinfo,
+                                     couch_file_handle* h,
+                                     const char* path,
+                                     int flags) {
+    auto* file = reinterpret_cast<MmapFile*>(*h);
+    unmap(*file);
+    const auto err = wrapped_ops.open(errinfo, &file->orig_handle, path, flags);
+    if (err != COUCHSTORE_SUCCESS || (flags & O_ACCMODE) != O_RDONLY) {
+        return err;
+    }
+
+    // Failing to map the file isn't an error; reads just fall back to the
+    // wrapped ops.
+    file->fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (file->fd != -1) {
+        map(*file);
+        file->openThread = std::this_thread::get_id();
+        file->openMajorFaults = getThreadMajorFaults();
+    }
+    return COUCHSTORE_SUCCESS;
+}
+
+couchstore_error_t MmapReadOps::close(couchstore_error_info_t* errinfo,
+                                      couch_file_handle h) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    if (file->fd != -1) {
+        // Faults can only be attributed to the file if it was used by a
+        // single thread.
+        if (file->openThread == std::this_thread::get_id()) {
+            const auto faults = getThreadMajorFaults() - file->openMajorFaults;
+            if (faults > 0) {
+                stats.mmapMajorFaults += faults;
+            }
+        }
+        unmap(*file);
+    }
+    return wrapped_ops.close(errinfo, file->orig_handle);
+}
+
+couchstore_error_t MmapReadOps::set_periodic_sync(couch_file_handle h,
+                                                  uint64_t period_bytes) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    return wrapped_ops.set_periodic_sync(file->orig_handle, period_bytes);
+}
+
+couchstore_error_t MmapReadOps::set_tracing_enabled(couch_file_handle h) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    return wrapped_ops.set_tracing_enabled(file->orig_handle);
+}
+
+couchstore_error_t MmapReadOps::set_write_validation_enabled(
+        couch_file_handle h) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    return wrapped_ops.set_write_validation_enabled(file->orig_handle);
+}
+
+couchstore_error_t MmapReadOps::set_mprotect_enabled(couch_file_handle h) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    return wrapped_ops.set_mprotect_enabled(file->orig_handle);
+}
+
+ssize_t MmapReadOps::pread(couchstore_error_info_t* errinfo,
+                           couch_file_handle h,
+                           void* buf,
+                           size_t sz,
+                           cs_off_t off) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    if (file->fd != -1) {
+        const auto end = size_t(off) + sz;
+        if (end > file->mappedSize) {
+            // A newer header may have been written since the file was mapped.
+            map(*file);
+        }
+        if (file->mapping && end <= file->mappedSize) {
+            std::memcpy(buf, file->mapping + off, sz);
+            return sz;
+        }
+        ++stats.mmapFallbackReads;
+    }
+    return wrapped_ops.pread(errinfo, file->orig_handle, buf, sz, off);
+}
+
+ssize_t MmapReadOps::pwrite(couchstore_error_info_t* errinfo,
+                            couch_file_handle h,
+                            const void* buf,
+                            size_t sz,
+                            cs_off_t off) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    return wrapped_ops.pwrite(errinfo, file->orig_handle, buf, sz, off);
+}
+
+cs_off_t MmapReadOps::goto_eof(couchstore_error_info_t* errinfo,
+                               couch_file_handle h) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    return wrapped_ops.goto_eof(errinfo, file->orig_handle);
+}
+
+couchstore_error_t MmapReadOps::sync(couchstore_error_info_t* errinfo,
+                                     couch_file_handle h) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    return wrapped_ops.sync(errinfo, file->orig_handle);
+}
+
+couchstore_error_t MmapReadOps::advise(couchstore_error_info_t* errinfo,
+                                       couch_file_handle h,
+                                       cs_off_t offs,
+                                       cs_off_t len,
+                                       couchstore_file_advice_t adv) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    return wrapped_ops.advise(errinfo, file->orig_handle, offs, len, adv);
+}
+
+FileOpsInterface::FHStats* MmapReadOps::get_stats(couch_file_handle h) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    return wrapped_ops.get_stats(file->orig_handle);
+}
+
+void MmapReadOps::destructor(couch_file_handle h) {
+    auto* file = reinterpret_cast<MmapFile*>(h);
+    unmap(*file);
+    wrapped_ops.destructor(file->orig_handle);
+    delete file;
+}
@@ -0,0 +1,115 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <libcouchstore/couch_db.h>
+
+#include <thread>
+
+struct FileStats;
+
+/**
+ * FileOpsInterface implementation which serves Couchstore's reads of files
+ * opened read-only from a memory mapping of the file, instead of issuing a
+ * pread() for each one.
+ *
+ * Couchstore files are append-only, so everything up to the header a
+ * read-only Db was opened at is immutable: open() maps the whole file as it
+ * is at that point and reads within the mapping are copied from it. Reads
+ * beyond the end of the mapping (the file having grown since - i.e. a newer
+ * header was written) remap the file at its new size; anything still not
+ * covered falls back to the wrapped ops. Files opened for writing are not
+ * mapped and all of their operations are passed straight to the wrapped ops.
+ *
+ * Relies on a file never being truncated while open - reading a mapped page
+ * beyond the end of the file would raise SIGBUS.
+ *
+ * Records in FileStats the number of bytes currently mapped, the number of
+ * fallback reads and the major page faults taken by the thread between the
+ * open() and close() of a mapped file.
+ */
+class MmapReadOps : public FileOpsInterface {
+public:
+    MmapReadOps(FileStats& stats, FileOpsInterface& ops)
+        : stats(stats), wrapped_ops(ops) {
+    }
+
+    couch_file_handle constructor(couchstore_error_info_t* errinfo) override;
+    couchstore_error_t open(couchstore_error_info_t* errinfo,
+                            couch_file_handle* handle,
+                            const char* path,
+                            int oflag) override;
+    couchstore_error_t close(couchstore_error_info_t* errinfo,
+                             couch_file_handle handle) override;
+    couchstore_error_t set_periodic_sync(couch_file_handle handle,
+                                         uint64_t period_bytes) override;
+    couchstore_error_t set_tracing_enabled(couch_file_handle handle) override;
+    couchstore_error_t set_write_validation_enabled(
+            couch_file_handle handle) override;
+    couchstore_error_t set_mprotect_enabled(couch_file_handle handle) override;
+
+    ssize_t pread(couchstore_error_info_t* errinfo,
+                  couch_file_handle handle,
+                  void* buf,
+                  size_t nbytes,
+                  cs_off_t offset) override;
+    ssize_t pwrite(couchstore_error_info_t* errinfo,
+                   couch_file_handle handle,
+                   const void* buf,
+                   size_t nbytes,
+                   cs_off_t offset) override;
+    cs_off_t goto_eof(couchstore_error_info_t* errinfo,
+                      couch_file_handle handle) override;
+    couchstore_error_t sync(couchstore_error_info_t* errinfo,
+                            couch_file_handle handle) override;
+    couchstore_error_t advise(couchstore_error_info_t* errinfo,
+                              couch_file_handle handle,
+                              cs_off_t offset,
+                              cs_off_t len,
+                              couchstore_file_advice_t advice) override;
+    FHStats* get_stats(couch_file_handle handle) override;
+    void destructor(couch_file_handle handle) override;
+
+protected:
+    struct MmapFile {
+        explicit MmapFile(couch_file_handle orig_handle)
+            : orig_handle(orig_handle) {
+        }
+
+        couch_file_handle orig_handle;
+
+        /// Descriptor the file is mapped through; -1 if not mapped.
+        int fd = -1;
+        /// The mapping of the first mappedSize bytes of the file.
+        const char* mapping = nullptr;
+        size_t mappedSize = 0;
+
+        /// Thread which opened the file, and its major faults at the time.
+        std::thread::id openThread;
+        long openMajorFaults = 0;
+    };
+
+    /// (Re)map the file at its current size.
+    void map(MmapFile& file);
+
+    /// Unmap the file and close the descriptor it was mapped through.
+    void unmap(MmapFile& file);
+
+    FileStats& stats;
+    FileOpsInterface& wrapped_ops;
+};
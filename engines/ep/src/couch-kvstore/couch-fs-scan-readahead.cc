@@ -0,0 +1,192 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-fs-scan-readahead.h"
+#include "kvstore.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+
+void ScanReadaheadOps::onRead(ScanFile& file, cs_off_t offset, size_t nbytes) {
+    const auto end = offset + cs_off_t(nbytes);
+    const auto tolerance = std::max(file.window, MinWindow);
+    if (file.position >= 0 && offset >= file.position - tolerance &&
+        offset <= file.position + tolerance) {
+        file.misses = 0;
+        file.position = std::max(file.position, end);
+    } else {
+        if (file.position >= 0 && ++file.misses < RestartMisses) {
+            // Probably an interior node of the btree, the scan continues
+            return;
+        }
+        // (Re)start the scan here
+        file.position = end;
+        file.readaheadEnd = end;
+        file.dropStart = offset;
+        file.window = MinWindow;
+        file.misses = 0;
+        return;
+    }
+
+    if (readaheadSize > 0 &&
+        file.position + file.window / 2 >= file.readaheadEnd) {
+        const auto start = std::max(file.readaheadEnd, file.position);
+        const auto len = file.position + file.window - start;
+        if (posix_fadvise(file.fd, start, len, POSIX_FADV_WILLNEED) == 0) {
+            stats.scanReadaheadBytes += len;
+        }
+        file.readaheadEnd = start + len;
+        file.window = std::min(file.window * 2,
+                               std::max(readaheadSize, MinWindow));
+    }
+
+    if (file.position - file.dropStart >= 2 * DropBatch) {
+        drop(file, file.position - DropBatch);
+    }
+}
+
+void ScanReadaheadOps::drop(ScanFile& file, cs_off_t end) {
+    if (!dropBehind || file.fd == -1 || end <= file.dropStart) {
+        return;
+    }
+    const auto len = end - file.dropStart;
+    if (posix_fadvise(file.fd, file.dropStart, len, POSIX_FADV_DONTNEED) ==
+        0) {
+        stats.scanDroppedBytes += len;
+    }
+    file.dropStart = end;
+}
+
+void ScanReadaheadOps::release(ScanFile& file) {
+    if (file.fd != -1) {
+        ::close(file.fd);
+        file.fd = -1;
+    }
+    file.position = -1;
+    file.readaheadEnd = 0;
+    file.dropStart = 0;
+    file.window = MinWindow;
+    file.misses = 0;
+}
+
+couch_file_handle ScanReadaheadOps::constructor(
+        couchstore_error_info_t* errinfo) {
+    auto* file = new ScanFile(wrapped_ops.constructor(errinfo));
+    return reinterpret_cast<couch_file_handle>(file);
+}
+
+couchstore_error_t ScanReadaheadOps::open(couchstore_error_info_t* errinfo,
+                                          couch_file_handle* h,
+                                          const char* path,
+                                          int flags) {
+    auto* file = reinterpret_cast<ScanFile*>(*h);
+    release(*file);
+    const auto err = wrapped_ops.open(errinfo, &file->orig_handle, path, flags);
+    if (err != COUCHSTORE_SUCCESS || (flags & O_ACCMODE) != O_RDONLY) {
+        return err;
+    }
+
+    // Failing to open the descriptor isn't an error; the reads are just
+    // not followed.
+    file->fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    return COUCHSTORE_SUCCESS;
+}
+
+couchstore_error_t ScanReadaheadOps::close(couchstore_error_info_t* errinfo,
+                                           couch_file_handle h) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    release(*file);
+    return wrapped_ops.close(errinfo, file->orig_handle);
+}
+
+couchstore_error_t ScanReadaheadOps::set_periodic_sync(couch_file_handle h,
+                                                       uint64_t period_bytes) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    return wrapped_ops.set_periodic_sync(file->orig_handle, period_bytes);
+}
+
+couchstore_error_t ScanReadaheadOps::set_tracing_enabled(couch_file_handle h) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    return wrapped_ops.set_tracing_enabled(file->orig_handle);
+}
+
+couchstore_error_t ScanReadaheadOps::set_write_validation_enabled(
+        couch_file_handle h) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    return wrapped_ops.set_write_validation_enabled(file->orig_handle);
+}
+
+couchstore_error_t ScanReadaheadOps::set_mprotect_enabled(
+        couch_file_handle h) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    return wrapped_ops.set_mprotect_enabled(file->orig_handle);
+}
+
+ssize_t ScanReadaheadOps::pread(couchstore_error_info_t* errinfo,
+                                couch_file_handle h,
+                                void* buf,
+                                size_t sz,
+                                cs_off_t off) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    if (file->fd != -1) {
+        onRead(*file, off, sz);
+    }
+    return wrapped_ops.pread(errinfo, file->orig_handle, buf, sz, off);
+}
+
+ssize_t ScanReadaheadOps::pwrite(couchstore_error_info_t* errinfo,
+                                 couch_file_handle h,
+                                 const void* buf,
+                                 size_t sz,
+                                 cs_off_t off) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    return wrapped_ops.pwrite(errinfo, file->orig_handle, buf, sz, off);
+}
+
+cs_off_t ScanReadaheadOps::goto_eof(couchstore_error_info_t* errinfo,
+                                    couch_file_handle h) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    return wrapped_ops.goto_eof(errinfo, file->orig_handle);
+}
+
+couchstore_error_t ScanReadaheadOps::sync(couchstore_error_info_t* errinfo,
+                                          couch_file_handle h) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    return wrapped_ops.sync(errinfo, file->orig_handle);
+}
+
+couchstore_error_t ScanReadaheadOps::advise(couchstore_error_info_t* errinfo,
+                                            couch_file_handle h,
+                                            cs_off_t offs,
+                                            cs_off_t len,
+                                            couchstore_file_advice_t adv) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    return wrapped_ops.advise(errinfo, file->orig_handle, offs, len, adv);
+}
+
+FileOpsInterface::FHStats* ScanReadaheadOps::get_stats(couch_file_handle h) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    return wrapped_ops.get_stats(file->orig_handle);
+}
+
+void ScanReadaheadOps::destructor(couch_file_handle h) {
+    auto* file = reinterpret_cast<ScanFile*>(h);
+    release(*file);
+    wrapped_ops.destructor(file->orig_handle);
+    delete file;
+}
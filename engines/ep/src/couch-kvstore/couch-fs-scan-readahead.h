@@ -0,0 +1,144 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <libcouchstore/couch_db.h>
+
+struct FileStats;
+
+/**
+ * FileOpsInterface implementation used for by-seqno scans (DCP backfills),
+ * which follows the scan's progress through the file to issue large
+ * asynchronous readahead ahead of it, and to drop the pages it has finished
+ * with from the page cache.
+ *
+ * Couchstore only appends, so a by-seqno scan mostly reads its btree
+ * leaves and document bodies moving forward through the file (with the
+ * occasional read of an interior node elsewhere). Each read-only file
+ * tracks the position of the scan: a read within the readahead window of
+ * it moves the scan forward, and a few consecutive reads away from it
+ * restart the scan at the new position. As the scan moves forward:
+ *
+ *  - if readaheadSize is non-zero, POSIX_FADV_WILLNEED is issued for the
+ *    window ahead of it. The window starts at MinWindow and doubles every
+ *    time it is issued (up to readaheadSize), and restarts at MinWindow
+ *    when the scan does.
+ *  - if dropBehind is set, POSIX_FADV_DONTNEED is issued (in DropBatch
+ *    sized chunks, keeping the last DropBatch bytes) for the range the scan
+ *    has moved past. The scan's own pages then don't push the pages
+ *    BgFetches use out of the page cache. Only the range the scan moved
+ *    through is dropped, not where it (re)started - which is typically the
+ *    header and the btree roots at the end of the file.
+ *
+ * The advice is given through a private descriptor (the page cache being
+ * shared); failing to open it or to advise just leaves the reads as they
+ * were. Files opened for writing are passed straight to the wrapped ops.
+ *
+ * Records in FileStats the bytes advised to be read ahead and dropped.
+ */
+class ScanReadaheadOps : public FileOpsInterface {
+public:
+    /// The initial readahead window, and the distance within which a read
+    /// is considered part of the scan when readahead is disabled.
+    static constexpr cs_off_t MinWindow = 128 * 1024;
+    /// The granularity the pages behind the scan are dropped at.
+    static constexpr cs_off_t DropBatch = 1024 * 1024;
+    /// Consecutive reads away from the scan after which it restarts.
+    static constexpr int RestartMisses = 3;
+
+    ScanReadaheadOps(FileStats& stats,
+                     FileOpsInterface& ops,
+                     size_t readaheadSize,
+                     bool dropBehind)
+        : stats(stats),
+          wrapped_ops(ops),
+          readaheadSize(readaheadSize),
+          dropBehind(dropBehind) {
+    }
+
+    couch_file_handle constructor(couchstore_error_info_t* errinfo) override;
+    couchstore_error_t open(couchstore_error_info_t* errinfo,
+                            couch_file_handle* handle,
+                            const char* path,
+                            int oflag) override;
+    couchstore_error_t close(couchstore_error_info_t* errinfo,
+                             couch_file_handle handle) override;
+    couchstore_error_t set_periodic_sync(couch_file_handle handle,
+                                         uint64_t period_bytes) override;
+    couchstore_error_t set_tracing_enabled(couch_file_handle handle) override;
+    couchstore_error_t set_write_validation_enabled(
+            couch_file_handle handle) override;
+    couchstore_error_t set_mprotect_enabled(couch_file_handle handle) override;
+
+    ssize_t pread(couchstore_error_info_t* errinfo,
+                  couch_file_handle handle,
+                  void* buf,
+                  size_t nbytes,
+                  cs_off_t offset) override;
+    ssize_t pwrite(couchstore_error_info_t* errinfo,
+                   couch_file_handle handle,
+                   const void* buf,
+                   size_t nbytes,
+                   cs_off_t offset) override;
+    cs_off_t goto_eof(couchstore_error_info_t* errinfo,
+                      couch_file_handle handle) override;
+    couchstore_error_t sync(couchstore_error_info_t* errinfo,
+                            couch_file_handle handle) override;
+    couchstore_error_t advise(couchstore_error_info_t* errinfo,
+                              couch_file_handle handle,
+                              cs_off_t offset,
+                              cs_off_t len,
+                              couchstore_file_advice_t advice) override;
+    FHStats* get_stats(couch_file_handle handle) override;
+    void destructor(couch_file_handle handle) override;
+
+protected:
+    struct ScanFile {
+        explicit ScanFile(couch_file_handle orig_handle)
+            : orig_handle(orig_handle) {
+        }
+
+        couch_file_handle orig_handle;
+
+        /// Descriptor the advice is given through; -1 if not tracked.
+        int fd = -1;
+        /// The end of the furthest read of the scan; -1 before the first.
+        cs_off_t position = -1;
+        /// The end of the range advised to be read ahead.
+        cs_off_t readaheadEnd = 0;
+        /// The start of the range not yet advised to be dropped.
+        cs_off_t dropStart = 0;
+        /// The size of the next readahead.
+        cs_off_t window = MinWindow;
+        /// Consecutive reads away from the scan.
+        int misses = 0;
+    };
+
+    /// Follow the scan of the file with a read of [offset, offset + nbytes)
+    void onRead(ScanFile& file, cs_off_t offset, size_t nbytes);
+
+    /// Drop [file.dropStart, end) from the page cache (if dropBehind is set)
+    void drop(ScanFile& file, cs_off_t end);
+
+    /// Close the descriptor the advice is given through
+    void release(ScanFile& file);
+
+    FileStats& stats;
+    FileOpsInterface& wrapped_ops;
+    const cs_off_t readaheadSize;
+    const bool dropBehind;
+};
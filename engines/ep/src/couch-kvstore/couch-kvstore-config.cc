@@ -36,6 +36,9 @@ public:
         if (key == "couchstore_mprotect") {
             config.setCouchstoreMprotectEnabled(value);
         }
+        if (key == "couchstore_bgfetch_readahead") {
+            config.setCouchstoreBgFetchReadaheadEnabled(value);
+        }
     }
 
     void sizeValueChanged(const std::string& key, size_t value) override {
@@ -51,7 +54,13 @@ private:
 CouchKVStoreConfig::CouchKVStoreConfig(Configuration& config,
                                        uint16_t maxShards,
                                        uint16_t shardId)
-    : KVStoreConfig(config, maxShards, shardId), buffered(true) {
+    : KVStoreConfig(config, maxShards, shardId),
+      buffered(true),
+      couchstoreWriteCoalesceSize(config.getCouchstoreWriteCoalesceSize()),
+      couchstoreMmapReads(config.isCouchstoreMmapReads()),
+      couchstoreBackfillReadaheadSize(
+              config.getCouchstoreBackfillReadaheadSize()),
+      couchstoreBackfillDropBehind(config.isCouchstoreBackfillDropBehind()) {
     setCouchstoreTracingEnabled(config.isCouchstoreTracing());
     config.addValueChangedListener(
             "couchstore_tracing",
@@ -64,6 +73,10 @@ CouchKVStoreConfig::CouchKVStoreConfig(Configuration& config,
     config.addValueChangedListener(
             "couchstore_mprotect",
             std::make_unique<ConfigChangeListener>(*this));
+    setCouchstoreBgFetchReadaheadEnabled(config.isCouchstoreBgfetchReadahead());
+    config.addValueChangedListener(
+            "couchstore_bgfetch_readahead",
+            std::make_unique<ConfigChangeListener>(*this));
     setCouchstoreFileCacheMaxSize(config.getCouchstoreFileCacheMaxSize());
     config.addValueChangedListener(
             "couchstore_file_cache_max_size",
@@ -77,9 +90,14 @@ CouchKVStoreConfig::CouchKVStoreConfig(uint16_t maxVBuckets,
                                        uint16_t shardId)
     : KVStoreConfig(maxVBuckets, maxShards, dbname, backend, shardId),
       buffered(true),
+      couchstoreWriteCoalesceSize(0),
+      couchstoreMmapReads(false),
+      couchstoreBackfillReadaheadSize(0),
+      couchstoreBackfillDropBehind(false),
       couchstoreTracingEnabled(false),
       couchstoreWriteValidationEnabled(false),
-      couchstoreMprotectEnabled(false) {
+      couchstoreMprotectEnabled(false),
+      couchstoreBgFetchReadaheadEnabled(false) {
 }
 
 void CouchKVStoreConfig::setCouchstoreFileCacheMaxSize(size_t value) {
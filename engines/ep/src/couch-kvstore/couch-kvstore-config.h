@@ -83,13 +83,81 @@ public:
         return couchstoreMprotectEnabled;
     }
 
+    void setCouchstoreBgFetchReadaheadEnabled(bool value) {
+        couchstoreBgFetchReadaheadEnabled = value;
+    }
+
+    bool getCouchstoreBgFetchReadaheadEnabled() const {
+        return couchstoreBgFetchReadaheadEnabled;
+    }
+
     void setCouchstoreFileCacheMaxSize(size_t value);
 
+    /**
+     * Used to override the size of the buffer in which a flush's writes are
+     * coalesced (0 disables coalescing).
+     */
+    void setCouchstoreWriteCoalesceSize(size_t value) {
+        couchstoreWriteCoalesceSize = value;
+    }
+
+    size_t getCouchstoreWriteCoalesceSize() const {
+        return couchstoreWriteCoalesceSize;
+    }
+
+    /**
+     * Used to override whether reads of files opened read-only are served
+     * from a memory mapping of the file.
+     */
+    void setCouchstoreMmapReads(bool value) {
+        couchstoreMmapReads = value;
+    }
+
+    bool getCouchstoreMmapReads() const {
+        return couchstoreMmapReads;
+    }
+
+    /**
+     * Used to override the maximum readahead ahead of a by-seqno scan
+     * (0 disables the readahead).
+     */
+    void setCouchstoreBackfillReadaheadSize(size_t value) {
+        couchstoreBackfillReadaheadSize = value;
+    }
+
+    size_t getCouchstoreBackfillReadaheadSize() const {
+        return couchstoreBackfillReadaheadSize;
+    }
+
+    /**
+     * Used to override whether the pages a by-seqno scan moved past are
+     * dropped from the page cache.
+     */
+    void setCouchstoreBackfillDropBehind(bool value) {
+        couchstoreBackfillDropBehind = value;
+    }
+
+    bool getCouchstoreBackfillDropBehind() const {
+        return couchstoreBackfillDropBehind;
+    }
+
 private:
     class ConfigChangeListener;
 
     bool buffered;
 
+    /* size of the buffer coalescing the writes of a flush; 0 if disabled */
+    size_t couchstoreWriteCoalesceSize;
+
+    /* serve reads of read-only files from a memory mapping */
+    bool couchstoreMmapReads;
+
+    /* maximum readahead of a by-seqno scan; 0 if disabled */
+    size_t couchstoreBackfillReadaheadSize;
+
+    /* drop the pages a by-seqno scan moved past from the page cache */
+    bool couchstoreBackfillDropBehind;
+
     // Following config variables are atomic as can be changed (via
     // ConfigChangeListener) at runtime by front-end threads while read by
     // IO threads.
@@ -100,4 +168,6 @@ private:
     std::atomic_bool couchstoreWriteValidationEnabled;
     /* enbale mprotect of couchstore internal io buffer */
     std::atomic_bool couchstoreMprotectEnabled;
+    /* issue readahead for all document bodies of a getMulti batch */
+    std::atomic_bool couchstoreBgFetchReadaheadEnabled;
 };
\ No newline at end of file
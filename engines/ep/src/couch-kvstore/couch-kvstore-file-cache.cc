@@ -76,6 +76,7 @@ void CouchKVStoreFileCache::Handle::resize(size_t value) {
         EP_LOG_INFO("CouchKVStoreFileCache::resize: oldSize:{}, newSize:{}",
                     cache.getMaxSize(),
                     newLimit);
+        promotePinned();
         cache.setMaxSize(newLimit);
     }
 }
@@ -83,15 +84,25 @@ void CouchKVStoreFileCache::Handle::resize(size_t value) {
 void CouchKVStoreFileCache::Handle::clear() {
     // All the files should be closed now, nuke the cache.
     cache.clear(&cacheEvictionHandler);
+    pinned.clear();
 }
 
 CouchKVStoreFileCache::CacheMap::mapped_type::LockedPtr
 CouchKVStoreFileCache::Handle::get(const std::string& key) {
-    return cache.get(key).lock();
+    auto itr = cache.find(key);
+    if (itr == cache.end()) {
+        ++misses;
+        throw std::out_of_range(
+                "CouchKVStoreFileCache::Handle::get: no file cached for " +
+                key);
+    }
+    ++hits;
+    return itr->second.lock();
 }
 
 void CouchKVStoreFileCache::Handle::set(const std::string& key,
                                         DbHolder&& holder) {
+    promotePinned();
     cache.set(key,
               CouchKVStoreFileCache::CacheMap::mapped_type(std::move(holder)));
 }
@@ -99,6 +110,7 @@ void CouchKVStoreFileCache::Handle::set(const std::string& key,
 std::pair<CouchKVStoreFileCache::CacheMap::iterator, bool>
 CouchKVStoreFileCache::Handle::insert(const std::string& key,
                                       DbHolder&& holder) {
+    promotePinned();
     return cache.insert(
             key,
             CouchKVStoreFileCache::CacheMap::mapped_type(std::move(holder)));
@@ -121,3 +133,23 @@ void CouchKVStoreFileCache::Handle::erase(const std::string& key) {
 size_t CouchKVStoreFileCache::Handle::numFiles() const {
     return cache.size();
 }
+
+void CouchKVStoreFileCache::Handle::pin(const std::string& key) {
+    ++pinned[key];
+}
+
+void CouchKVStoreFileCache::Handle::unpin(const std::string& key) {
+    auto itr = pinned.find(key);
+    Expects(itr != pinned.end());
+    if (--itr->second == 0) {
+        pinned.erase(itr);
+    }
+}
+
+void CouchKVStoreFileCache::Handle::promotePinned() {
+    // The files are evicted from the back of the LRU, and at most one file
+    // at a time is added, so this keeps the pinned files (if they fit)
+    for (const auto& entry : pinned) {
+        cache.find(entry.first);
+    }
+}
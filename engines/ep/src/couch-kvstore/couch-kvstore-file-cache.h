@@ -23,6 +23,7 @@
 #include <folly/container/EvictingCacheMap.h>
 
 #include <string>
+#include <unordered_map>
 
 /**
  * FileCache is a static process wide cache for the file descriptors in use in
@@ -67,8 +68,39 @@ public:
 
         size_t numFiles() const;
 
+        /**
+         * Pin the file, so that it stays in the cache when files are evicted
+         * to make room for others (e.g. for the vBuckets with flush or
+         * BgFetch activity, rather than letting a scan of cold vBuckets
+         * evict them). This holds as long as fewer files are pinned than fit
+         * in the cache. The pins of a key nest, and the file doesn't need to
+         * be in the cache yet.
+         */
+        void pin(const std::string& key);
+        void unpin(const std::string& key);
+
+        /// The number of get() calls which found the file in the cache
+        size_t getHits() const {
+            return hits;
+        }
+
+        /// The number of get() calls which didn't find the file in the cache
+        size_t getMisses() const {
+            return misses;
+        }
+
     protected:
+        /// Move the pinned files to the front of the LRU, before anything
+        /// which may evict files from the cache
+        void promotePinned();
+
         CacheMap cache;
+
+        /// The pinned keys and their number of pins
+        std::unordered_map<std::string, size_t> pinned;
+
+        size_t hits = 0;
+        size_t misses = 0;
     };
 
     static CouchKVStoreFileCache& get();
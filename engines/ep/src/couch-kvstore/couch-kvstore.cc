@@ -19,6 +19,7 @@
 
 #include "bucket_logger.h"
 #include "collections/collection_persisted_stats.h"
+#include "couch-fs-write-throttle.h"
 #include "couch-kvstore-config.h"
 #include "couch-kvstore-db-holder.h"
 #include "diskdockey.h"
@@ -42,14 +43,27 @@
 #include <platform/dirutils.h>
 #include <gsl/gsl>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
 #include <memory>
+#include <optional>
 #include <shared_mutex>
 #include <utility>
 
 static int bySeqnoScanCallback(Db* db, DocInfo* docinfo, void* ctx);
+static int bySeqnoRangeScanCallback(Db* db, DocInfo* docinfo, void* ctx);
 static int byIdScanCallback(Db* db, DocInfo* docinfo, void* ctx);
 
+struct GetMultiCbCtx;
 static int getMultiCallback(Db* db, DocInfo* docinfo, void* ctx);
+static void getMultiCompleteFetch(GetMultiCbCtx& ctx,
+                                  Db* db,
+                                  DocInfo* docinfo,
+                                  vb_bgfetch_item_ctx_t& bg_itm_ctx);
 
 static bool endWithCompact(const std::string &filename) {
     const std::string suffix{".compact"};
@@ -173,14 +187,61 @@ static std::string getDBFileName(const std::string& dbname,
            std::to_string(rev);
 }
 
+/**
+ * A copy of a DocInfo (and the key / metadata it references) whose body read
+ * has been deferred by getMulti until all lookups of the batch are complete.
+ */
+class DeferredDocInfo {
+public:
+    DeferredDocInfo(const DocInfo& info, vb_bgfetch_item_ctx_t& itemCtx)
+        : info(info),
+          id(info.id.buf, info.id.size),
+          revMeta(info.rev_meta.buf, info.rev_meta.size),
+          itemCtx(itemCtx) {
+    }
+
+    /// @returns the DocInfo, pointing at this object's copies of the key and
+    /// metadata.
+    DocInfo* get() {
+        info.id = {id.data(), id.size()};
+        info.rev_meta = {revMeta.data(), revMeta.size()};
+        return &info;
+    }
+
+    uint64_t getBodyOffset() const {
+        return info.bp;
+    }
+
+    size_t getBodySize() const {
+        return info.physical_size;
+    }
+
+    vb_bgfetch_item_ctx_t& getItemCtx() {
+        return itemCtx;
+    }
+
+private:
+    DocInfo info;
+    std::string id;
+    std::string revMeta;
+    std::reference_wrapper<vb_bgfetch_item_ctx_t> itemCtx;
+};
+
 struct GetMultiCbCtx {
-    GetMultiCbCtx(CouchKVStore& c, Vbid v, vb_bgfetch_queue_t& f)
-        : cks(c), vbId(v), fetches(f) {
+    GetMultiCbCtx(CouchKVStore& c,
+                  Vbid v,
+                  vb_bgfetch_queue_t& f,
+                  bool deferBodyReads)
+        : cks(c), vbId(v), fetches(f), deferBodyReads(deferBodyReads) {
     }
 
     CouchKVStore &cks;
     Vbid vbId;
     vb_bgfetch_queue_t &fetches;
+    /// If true, documents whose body needs reading are added to `deferred`
+    /// instead of being read from the callback.
+    const bool deferBodyReads;
+    std::vector<DeferredDocInfo> deferred;
 };
 
 struct AllKeysCtx {
@@ -316,6 +377,35 @@ CouchKVStore::CouchKVStore(CouchKVStoreConfig& config,
     statCollectingFileOps = getCouchstoreStatsOps(st.fsStats, base_ops);
     statCollectingFileOpsCompaction = getCouchstoreStatsOps(
         st.fsStatsCompaction, base_ops);
+    if (configuration.getCouchstoreWriteCoalesceSize() > 0) {
+        coalescingFileOps = std::make_unique<CoalescingWriteOps>(
+                st.fsStats,
+                *statCollectingFileOps,
+                configuration.getCouchstoreWriteCoalesceSize());
+    }
+#ifndef WIN32
+    if (configuration.getCouchstoreMmapReads()) {
+        mmapFileOps = std::make_unique<MmapReadOps>(st.fsStats, base_ops);
+        statCollectingMmapFileOps =
+                getCouchstoreStatsOps(st.fsStats, *mmapFileOps);
+    }
+#endif
+#ifdef __linux__
+    if (configuration.getCouchstoreBackfillReadaheadSize() > 0 ||
+        configuration.getCouchstoreBackfillDropBehind()) {
+        // Follow the scan's reads before they are (possibly) served from
+        // a mapping.
+        FileOpsInterface& scanBaseOps =
+                mmapFileOps ? *mmapFileOps : base_ops;
+        scanFileOps = std::make_unique<ScanReadaheadOps>(
+                st.fsStats,
+                scanBaseOps,
+                configuration.getCouchstoreBackfillReadaheadSize(),
+                configuration.getCouchstoreBackfillDropBehind());
+        statCollectingScanFileOps =
+                getCouchstoreStatsOps(st.fsStats, *scanFileOps);
+    }
+#endif
 
     // init db file map with default revision number, 1
     auto numDbFiles = configuration.getMaxVBuckets();
@@ -361,10 +451,25 @@ CouchKVStore::CouchKVStore(CreateReadWrite,
 CouchKVStore::CouchKVStore(CreateReadOnly,
                            CouchKVStoreConfig& config,
                            FileOpsInterface& ops,
-                           std::shared_ptr<RevisionMap> dbFileRevMap)
+                           std::shared_ptr<RevisionMap> dbFileRevMap,
+                           const CouchKVStore* rwStore)
     : CouchKVStore(config, ops, true, dbFileRevMap) {
-    // intialise the store (reads vbstate etc...)
-    initialize(getVbucketRevisions(discoverDbFiles(dbname)));
+    if (rwStore == nullptr) {
+        // intialise the store (reads vbstate etc...)
+        initialize(getVbucketRevisions(discoverDbFiles(dbname)));
+        return;
+    }
+
+    // The RW store just read the vbstate of every file, take a copy of it
+    // rather than opening all of the files again
+    for (size_t ii = 0; ii < cachedVBStates.size(); ++ii) {
+        if (rwStore->cachedVBStates[ii]) {
+            cachedVBStates[ii] = std::make_unique<vbucket_state>(
+                    *rwStore->cachedVBStates[ii]);
+        }
+        cachedDocCount[ii] = rwStore->cachedDocCount[ii].load();
+    }
+    st.numLoadedVb = rwStore->st.numLoadedVb.load();
 }
 
 CouchKVStore::CouchKVStore(CouchKVStoreConfig& config, FileOpsInterface& ops)
@@ -380,7 +485,8 @@ std::unique_ptr<CouchKVStore> CouchKVStore::makeReadOnlyStore() const {
             new CouchKVStore(CreateReadOnly{},
                              configuration,
                              *couchstore_get_default_file_ops(),
-                             dbFileRevMap));
+                             dbFileRevMap,
+                             this));
 }
 
 void CouchKVStore::initialize(
@@ -473,14 +579,15 @@ void CouchKVStore::set(queued_item item) {
         throw std::logic_error("CouchKVStore::set: Not valid on a read-only "
                         "object.");
     }
-    if (!inTransaction) {
+    auto& txn = getFlushTransaction();
+    if (!txn.inTransaction) {
         throw std::invalid_argument(
                 "CouchKVStore::set: inTransaction must be "
                 "true to perform a set operation.");
     }
 
     // each req will be de-allocated after commit
-    pendingReqsQ.emplace_back(std::move(item));
+    txn.pendingReqsQ.emplace_back(std::move(item));
 }
 
 GetValue CouchKVStore::get(const DiskDocKey& key, Vbid vb) {
@@ -566,6 +673,16 @@ GetValue CouchKVStore::getWithHeader(DbHolder& db,
 }
 
 void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
+    getMultiImpl(vb, itms, configuration.getCouchstoreBgFetchReadaheadEnabled());
+}
+
+void CouchKVStore::getMultiBulk(Vbid vb, vb_bgfetch_queue_t& itms) {
+    getMultiImpl(vb, itms, true);
+}
+
+void CouchKVStore::getMultiImpl(Vbid vb,
+                                vb_bgfetch_queue_t& itms,
+                                bool readahead) {
     if (itms.empty()) {
         return;
     }
@@ -594,10 +711,17 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
         ++idx;
     }
 
-    GetMultiCbCtx ctx(*this, vb, itms);
+    GetMultiCbCtx ctx(*this, vb, itms, readahead);
 
     errCode = couchstore_docinfos_by_id(
             db, ids.data(), itms.size(), 0, getMultiCallback, &ctx);
+    if (!ctx.deferred.empty()) {
+        if (errCode == COUCHSTORE_SUCCESS) {
+            readDeferredBodies(db, vb, ctx.deferred, ctx);
+        } else {
+            ctx.deferred.clear();
+        }
+    }
     if (errCode != COUCHSTORE_SUCCESS) {
         st.numGetFailure += numItems;
         logger.warn(
@@ -622,6 +746,47 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
     }
 }
 
+void CouchKVStore::readDeferredBodies(DbHolder& db,
+                                      Vbid vb,
+                                      std::vector<DeferredDocInfo>& deferred,
+                                      GetMultiCbCtx& ctx) {
+    // Read the bodies in file order; after the readahead below this turns
+    // the remaining (synchronous) reads into mostly page cache hits, and
+    // any which do miss into a forward sweep across the file.
+    std::sort(deferred.begin(),
+              deferred.end(),
+              [](const auto& a, const auto& b) {
+                  return a.getBodyOffset() < b.getBodyOffset();
+              });
+
+#ifdef __linux__
+    // Hint the kernel to read every body of the batch. WILLNEED starts
+    // asynchronous reads for all of them at once, so the batch latency is
+    // bounded by the device's queue depth rather than the sum of the reads.
+    // The hint is advisory and done via a private fd (the page cache is
+    // shared); on failure the reads below simply go to disk as before.
+    const auto fname = getDBFileName(dbname, vb, db.getFileRev());
+    const int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        for (const auto& doc : deferred) {
+            // Allow for the chunk header and block markers couchstore
+            // interleaves with the body.
+            const auto len = doc.getBodySize() + doc.getBodySize() / 4096 + 64;
+            (void)posix_fadvise(fd,
+                                off_t(doc.getBodyOffset()),
+                                off_t(len),
+                                POSIX_FADV_WILLNEED);
+        }
+        ::close(fd);
+    }
+#endif
+
+    for (auto& doc : deferred) {
+        getMultiCompleteFetch(ctx, db, doc.get(), doc.getItemCtx());
+    }
+    deferred.clear();
+}
+
 void CouchKVStore::getRange(Vbid vb,
                             const DiskDocKey& startKey,
                             const DiskDocKey& endKey,
@@ -709,13 +874,14 @@ void CouchKVStore::del(queued_item item) {
         throw std::logic_error("CouchKVStore::del: Not valid on a read-only "
                         "object.");
     }
-    if (!inTransaction) {
+    auto& txn = getFlushTransaction();
+    if (!txn.inTransaction) {
         throw std::invalid_argument(
                 "CouchKVStore::del: inTransaction must be "
                 "true to perform a delete operation.");
     }
 
-    pendingReqsQ.emplace_back(std::move(item));
+    txn.pendingReqsQ.emplace_back(std::move(item));
 }
 
 void CouchKVStore::delVBucket(Vbid vbucket, uint64_t fileRev) {
@@ -1004,7 +1170,13 @@ bool CouchKVStore::compactDBInternal(
                 "CouchKVStore::compactDB: droppedKeyCb must be set ");
     }
 
-    auto* def_iops = statCollectingFileOpsCompaction.get();
+    FileOpsInterface* def_iops = statCollectingFileOpsCompaction.get();
+    // Must outlive the Db handles opened with it below.
+    std::optional<ThrottledWriteOps> throttledOps;
+    if (hook_ctx->writeThrottle) {
+        throttledOps.emplace(*def_iops, hook_ctx->writeThrottle);
+        def_iops = &*throttledOps;
+    }
     std::chrono::steady_clock::time_point start =
             std::chrono::steady_clock::now();
     Vbid vbid = hook_ctx->compactConfig.db_file_id;
@@ -1071,6 +1243,11 @@ bool CouchKVStore::compactDBInternal(
     // as callers _may_ use the existence of those for locking purposes)
     removeCompactFile(compact_file);
 
+    // The copy phase runs until couchstore calls the precommit hook; the
+    // commit phase from then until compact() returns.
+    const auto copyStart = std::chrono::steady_clock::now();
+    std::optional<std::chrono::steady_clock::time_point> commitStart;
+
     // Perform COMPACTION of vbucket.couch.rev into
     // vbucket.couch.rev.compact
     if (configuration.isPitrEnabled()) {
@@ -1105,7 +1282,10 @@ bool CouchKVStore::compactDBInternal(
                 },
                 std::move(docinfo_hook),
                 def_iops,
-                [hook_ctx, this](Db& compacted) {
+                [hook_ctx, this, &commitStart](Db& compacted) {
+                    if (!commitStart) {
+                        commitStart = std::chrono::steady_clock::now();
+                    }
                     // we don't try to delete the dropped collection document
                     // as it'll come back in the next database header anyway
                     PendingLocalDocRequestQueue localDocQueue;
@@ -1144,7 +1324,8 @@ bool CouchKVStore::compactDBInternal(
                 },
                 std::move(docinfo_hook),
                 def_iops,
-                [hook_ctx, this](Db& compacted) {
+                [hook_ctx, this, &commitStart](Db& compacted) {
+                    commitStart = std::chrono::steady_clock::now();
                     if (mb40415_regression_hook) {
                         return COUCHSTORE_ERROR_CANCEL;
                     }
@@ -1174,6 +1355,18 @@ bool CouchKVStore::compactDBInternal(
                     return ret;
                 });
     }
+
+    const auto swapStart = std::chrono::steady_clock::now();
+    auto& compactStats = hook_ctx->stats;
+    compactStats.copyDuration =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    commitStart.value_or(swapStart) - copyStart);
+    if (commitStart) {
+        compactStats.commitDuration =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        swapStart - *commitStart);
+    }
+
     if (errCode != COUCHSTORE_SUCCESS) {
         logger.warn(
                 "CouchKVStore::compactDB: cb::couchstore::compact() "
@@ -1255,8 +1448,15 @@ bool CouchKVStore::compactDBInternal(
     // Removing the stale couch file
     unlinkCouchFile(vbid, compactdb.getFileRev());
 
-    st.compactHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::steady_clock::now() - start));
+    const auto end = std::chrono::steady_clock::now();
+    compactStats.swapDuration =
+            std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                  swapStart);
+    st.compactCopyHisto.add(compactStats.copyDuration);
+    st.compactCommitHisto.add(compactStats.commitDuration);
+    st.compactSwapHisto.add(compactStats.swapDuration);
+    st.compactHisto.add(
+            std::chrono::duration_cast<std::chrono::microseconds>(end - start));
 
     return true;
 }
@@ -1404,7 +1604,8 @@ StorageProperties CouchKVStore::getStorageProperties() {
                          StorageProperties::PersistedDeletion::Yes,
                          StorageProperties::EfficientGet::Yes,
                          StorageProperties::ConcurrentWriteCompact::No,
-                         StorageProperties::ByIdScan::Yes);
+                         StorageProperties::ByIdScan::Yes,
+                         StorageProperties::EfficientCollectionDrop::No);
     return rv;
 }
 
@@ -1414,14 +1615,30 @@ bool CouchKVStore::commit(VB::Commit& commitData) {
                         "object.");
     }
 
-    if (inTransaction) {
+    auto& txn = getFlushTransaction();
+    if (txn.inTransaction) {
         if (commit2couchstore(commitData)) {
-            inTransaction = false;
-            transactionCtx.reset();
+            txn.inTransaction = false;
+            txn.ctx.reset();
         }
     }
 
-    return !inTransaction;
+    return !txn.inTransaction;
+}
+
+bool CouchKVStore::begin(std::unique_ptr<TransactionContext> txCtx) {
+    if (!txCtx) {
+        throw std::invalid_argument("CouchKVStore::begin: txCtx is null");
+    }
+    if (isReadOnly()) {
+        throw std::logic_error(
+                "CouchKVStore::begin: Not valid on a read-only object.");
+    }
+    auto& txn = getFlushTransaction();
+    txn.collectionsMeta.clear();
+    txn.inTransaction = true;
+    txn.ctx = std::move(txCtx);
+    return txn.inTransaction;
 }
 
 bool CouchKVStore::getStat(const char* name, size_t& value)  {
@@ -1459,6 +1676,45 @@ bool CouchKVStore::getStat(const char* name, size_t& value)  {
     return false;
 }
 
+void CouchKVStore::beginGroupCommit() {
+    if (isReadOnly()) {
+        throw std::logic_error(
+                "CouchKVStore::beginGroupCommit: Not valid on a read-only "
+                "object.");
+    }
+    auto& txn = getFlushTransaction();
+    if (!txn.groupCommitOps) {
+        txn.groupCommitOps =
+                std::make_unique<DeferredSyncOps>(*getFlushFileOps());
+    }
+    txn.inGroupCommit = true;
+    txn.groupCommitOps->setDeferSyncs(true);
+}
+
+bool CouchKVStore::endGroupCommit() {
+    auto& txn = getFlushTransaction();
+    if (!txn.inGroupCommit) {
+        return true;
+    }
+
+    couchstore_error_info_t errinfo{};
+    const auto errCode = txn.groupCommitOps->syncDeferred(&errinfo);
+    txn.groupCommitOps->setDeferSyncs(false);
+    txn.inGroupCommit = false;
+    const auto numFiles = txn.groupCommitDbs.size();
+    txn.groupCommitDbs.clear();
+
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.warn(
+                "CouchKVStore::endGroupCommit: sync error:{} [{}], files:{}",
+                couchstore_strerror(errCode),
+                cb_strerror(errinfo.error),
+                numFiles);
+        return false;
+    }
+    return true;
+}
+
 void CouchKVStore::pendingTasks() {
     if (isReadOnly()) {
         throw std::logic_error("CouchKVStore::pendingTasks: Not valid on a "
@@ -1494,7 +1750,7 @@ std::unique_ptr<BySeqnoScanContext> CouchKVStore::initBySeqnoScanContext(
         DocumentFilter options,
         ValueFilter valOptions,
         SnapshotSource source) {
-    auto handle = makeFileHandle(vbid);
+    auto handle = makeScanFileHandle(vbid);
 
     if (!handle) {
         // makeFileHandle/openDb will of logged details of failure.
@@ -1651,7 +1907,7 @@ scan_error_t CouchKVStore::scan(BySeqnoScanContext& ctx) {
     errorCode = couchstore_changes_since(db,
                                          start,
                                          getDocFilter(ctx.docFilter),
-                                         bySeqnoScanCallback,
+                                         bySeqnoRangeScanCallback,
                                          static_cast<void*>(&ctx));
 
     TRACE_EVENT_END1(
@@ -1659,6 +1915,10 @@ scan_error_t CouchKVStore::scan(BySeqnoScanContext& ctx) {
 
     if (errorCode != COUCHSTORE_SUCCESS) {
         if (errorCode == COUCHSTORE_ERROR_CANCEL) {
+            if (ctx.lastReadSeqno == ctx.maxSeqno) {
+                // Stopped at the end of the requested range
+                return scan_success;
+            }
             return scan_again;
         } else {
             logger.warn(
@@ -1755,7 +2015,7 @@ cb::couchstore::Header CouchKVStore::getDbInfo(Vbid vbid) {
 }
 
 void CouchKVStore::close() {
-    inTransaction = false;
+    getFlushTransaction().inTransaction = false;
 }
 
 void CouchKVStore::updateDbFileMap(Vbid vbucketId, uint64_t newFileRev) {
@@ -1795,7 +2055,12 @@ couchstore_error_t CouchKVStore::openSpecificDB(Vbid vbucketId,
     db.setFileRev(fileRev); // save the rev so the caller can log it
 
     if(ops == nullptr) {
-        ops = statCollectingFileOps.get();
+        if (statCollectingMmapFileOps &&
+            (options & COUCHSTORE_OPEN_FLAG_RDONLY)) {
+            ops = statCollectingMmapFileOps.get();
+        } else {
+            ops = statCollectingFileOps.get();
+        }
     }
 
     couchstore_error_t errorCode = COUCHSTORE_SUCCESS;
@@ -2172,6 +2437,20 @@ static int bySeqnoScanCallback(Db* db, DocInfo* docinfo, void* ctx) {
     return COUCHSTORE_SUCCESS;
 }
 
+/**
+ * bySeqnoScanCallback for a BySeqnoScanContext, which additionally ends the
+ * scan at the context's maxSeqno. maxSeqno is normally the high seqno of the
+ * file, but may have been lowered by the caller to scan a sub-range.
+ */
+static int bySeqnoRangeScanCallback(Db* db, DocInfo* docinfo, void* ctx) {
+    auto* sctx = static_cast<ScanContext*>(ctx);
+    if (int64_t(docinfo->db_seq) > sctx->maxSeqno) {
+        sctx->lastReadSeqno = sctx->maxSeqno;
+        return COUCHSTORE_ERROR_CANCEL;
+    }
+    return bySeqnoScanCallback(db, docinfo, ctx);
+}
+
 static int byIdScanCallback(Db* db, DocInfo* docinfo, void* ctx) {
     auto status = couchstore_error_t(bySeqnoScanCallback(db, docinfo, ctx));
     if (status == COUCHSTORE_ERROR_CANCEL) {
@@ -2185,12 +2464,13 @@ static int byIdScanCallback(Db* db, DocInfo* docinfo, void* ctx) {
 bool CouchKVStore::commit2couchstore(VB::Commit& commitData) {
     bool success = true;
 
-    size_t pendingCommitCnt = pendingReqsQ.size();
+    auto& txn = getFlushTransaction();
+    size_t pendingCommitCnt = txn.pendingReqsQ.size();
     if (pendingCommitCnt == 0) {
         return success;
     }
 
-    auto vbucket2flush = transactionCtx->vbid;
+    auto vbucket2flush = txn.ctx->vbid;
 
     TRACE_EVENT2("CouchKVStore",
                  "commit2couchstore",
@@ -2203,7 +2483,7 @@ bool CouchKVStore::commit2couchstore(VB::Commit& commitData) {
     std::vector<DocInfo*> docinfos(pendingCommitCnt);
 
     for (size_t i = 0; i < pendingCommitCnt; ++i) {
-        auto& req = pendingReqsQ[i];
+        auto& req = txn.pendingReqsQ[i];
         docs[i] = req.getDbDoc();
         docinfos[i] = req.getDbDocInfo();
     }
@@ -2225,9 +2505,9 @@ bool CouchKVStore::commit2couchstore(VB::Commit& commitData) {
         postFlushHook();
     }
 
-    commitCallback(pendingReqsQ, kvctx, errCode);
+    commitCallback(txn.pendingReqsQ, kvctx, errCode);
 
-    pendingReqsQ.clear();
+    txn.pendingReqsQ.clear();
     return success;
 }
 
@@ -2318,8 +2598,13 @@ couchstore_error_t CouchKVStore::saveDocs(Vbid vbid,
                                           std::vector<DocInfo*>& docinfos,
                                           kvstats_ctx& kvctx) {
     couchstore_error_t errCode;
+    auto& txn = getFlushTransaction();
     DbHolder db(*this);
-    errCode = openDB(vbid, db, COUCHSTORE_OPEN_FLAG_CREATE);
+    errCode = openDB(vbid,
+                     db,
+                     COUCHSTORE_OPEN_FLAG_CREATE,
+                     txn.inGroupCommit ? txn.groupCommitOps.get()
+                                       : getFlushFileOps());
     if (errCode != COUCHSTORE_SUCCESS) {
         logger.warn(
                 "CouchKVStore::saveDocs: openDB error:{}, {}, rev:{}, "
@@ -2382,24 +2667,24 @@ couchstore_error_t CouchKVStore::saveDocs(Vbid vbid,
 
         vbucket_state& state = kvctx.commitData.proposedVBState;
         state.onDiskPrepares += kvctx.onDiskPrepareDelta;
-        pendingLocalReqsQ.emplace_back("_local/vbstate",
-                                       makeJsonVBState(state));
+        txn.pendingLocalReqsQ.emplace_back("_local/vbstate",
+                                           makeJsonVBState(state));
 
-        if (collectionsMeta.isReadyForCommit()) {
+        if (txn.collectionsMeta.isReadyForCommit()) {
             updateCollectionsMeta(*db, kvctx.commitData.collections);
         }
 
         /// Update the local documents before we commit
-        errCode = updateLocalDocuments(*db, pendingLocalReqsQ);
+        errCode = updateLocalDocuments(*db, txn.pendingLocalReqsQ);
         if (errCode) {
             logger.warn(
                     "CouchKVStore::saveDocs: updateLocalDocuments size:{} "
                     "error:{} [{}]",
-                    pendingLocalReqsQ.size(),
+                    txn.pendingLocalReqsQ.size(),
                     couchstore_strerror(errCode),
                     couchkvstore_strerrno(db, errCode));
         }
-        pendingLocalReqsQ.clear();
+        txn.pendingLocalReqsQ.clear();
 
         auto cs_begin = std::chrono::steady_clock::now();
 
@@ -2445,6 +2730,12 @@ couchstore_error_t CouchKVStore::saveDocs(Vbid vbid,
                     vbid);
         }
         state.highSeqno = info.updateSeqNum;
+
+        if (txn.inGroupCommit) {
+            // The header sync is outstanding; keep the file open until
+            // endGroupCommit() performs it.
+            txn.groupCommitDbs.push_back(std::move(db));
+        }
     }
 
     /* update stat */
@@ -2458,6 +2749,7 @@ couchstore_error_t CouchKVStore::saveDocs(Vbid vbid,
 void CouchKVStore::commitCallback(PendingRequestQueue& committedReqs,
                                   kvstats_ctx& kvctx,
                                   couchstore_error_t errCode) {
+    auto& txn = getFlushTransaction();
     const auto flushSuccess = (errCode == COUCHSTORE_SUCCESS);
     for (auto& committed : committedReqs) {
         const auto docLogicalSize = calcLogicalDataSize(
@@ -2482,7 +2774,7 @@ void CouchKVStore::commitCallback(PendingRequestQueue& committedReqs,
                 ++st.numDelFailure;
             }
 
-            transactionCtx->deleteCallback(committed.getItem(), state);
+            txn.ctx->deleteCallback(committed.getItem(), state);
         } else {
             FlushStateMutation state;
             if (flushSuccess) {
@@ -2500,7 +2792,7 @@ void CouchKVStore::commitCallback(PendingRequestQueue& committedReqs,
                 ++st.numSetFailure;
             }
 
-            transactionCtx->setCallback(committed.getItem(), state);
+            txn.ctx->setCallback(committed.getItem(), state);
         }
     }
 }
@@ -2677,13 +2969,13 @@ void CouchKVStore::saveCollectionStats(Db& db,
                                        Collections::VB::PersistedStats stats) {
     // Write out the stats in BE to a local doc named after the collection
     // Using set-notation cardinality - |cid| which helps keep the keys small
-    pendingLocalReqsQ.emplace_back("|" + cid.to_string() + "|",
-                                   stats.getLebEncodedStats());
+    getFlushTransaction().pendingLocalReqsQ.emplace_back(
+            "|" + cid.to_string() + "|", stats.getLebEncodedStats());
 }
 
 void CouchKVStore::deleteCollectionStats(CollectionID cid) {
-    pendingLocalReqsQ.emplace_back("|" + cid.to_string() + "|",
-                                   CouchLocalDocRequest::IsDeleted{});
+    getFlushTransaction().pendingLocalReqsQ.emplace_back(
+            "|" + cid.to_string() + "|", CouchLocalDocRequest::IsDeleted{});
 }
 
 std::optional<Collections::VB::PersistedStats> CouchKVStore::getCollectionStats(
@@ -2744,7 +3036,6 @@ static int getMultiCallback(Db* db, DocInfo* docinfo, void* ctx) {
 
     auto *cbCtx = static_cast<GetMultiCbCtx *>(ctx);
     auto key = makeDiskDocKey(docinfo->id);
-    KVStoreStats& st = cbCtx->cks.getKVStoreStat();
 
     auto qitr = cbCtx->fetches.find(key);
     if (qitr == cbCtx->fetches.end()) {
@@ -2759,15 +3050,34 @@ static int getMultiCallback(Db* db, DocInfo* docinfo, void* ctx) {
     }
 
     vb_bgfetch_item_ctx_t& bg_itm_ctx = (*qitr).second;
+    if (cbCtx->deferBodyReads && bg_itm_ctx.isMetaOnly == GetMetaOnly::No &&
+        !docinfo->deleted) {
+        cbCtx->deferred.emplace_back(*docinfo, bg_itm_ctx);
+        return 0;
+    }
+
+    getMultiCompleteFetch(*cbCtx, db, docinfo, bg_itm_ctx);
+    return 0;
+}
+
+/**
+ * Fetch the document described by docinfo and complete all of the bgfetches
+ * waiting on it.
+ */
+static void getMultiCompleteFetch(GetMultiCbCtx& ctx,
+                                  Db* db,
+                                  DocInfo* docinfo,
+                                  vb_bgfetch_item_ctx_t& bg_itm_ctx) {
+    KVStoreStats& st = ctx.cks.getKVStoreStat();
     GetMetaOnly meta_only = bg_itm_ctx.isMetaOnly;
 
-    couchstore_error_t errCode = cbCtx->cks.fetchDoc(
-            db, docinfo, bg_itm_ctx.value, cbCtx->vbId, meta_only);
+    couchstore_error_t errCode = ctx.cks.fetchDoc(
+            db, docinfo, bg_itm_ctx.value, ctx.vbId, meta_only);
     if (errCode != COUCHSTORE_SUCCESS && (meta_only == GetMetaOnly::No)) {
         st.numGetFailure++;
     }
 
-    bg_itm_ctx.value.setStatus(cbCtx->cks.couchErr2EngineErr(errCode));
+    bg_itm_ctx.value.setStatus(ctx.cks.couchErr2EngineErr(errCode));
 
     bool return_val_ownership_transferred = false;
     for (auto& fetch : bg_itm_ctx.bgfetched_list) {
@@ -2784,14 +3094,12 @@ static int getMultiCallback(Db* db, DocInfo* docinfo, void* ctx) {
         }
     }
     if (!return_val_ownership_transferred) {
-        cbCtx->cks.getLogger().warn(
+        ctx.cks.getLogger().warn(
                 "getMultiCallback called with zero items in bgfetched_list, "
                 "{}, seqno:{}",
-                cbCtx->vbId,
+                ctx.vbId,
                 docinfo->rev_seq);
     }
-
-    return 0;
 }
 
 void CouchKVStore::closeDatabaseHandle(Db *db) {
@@ -3175,6 +3483,163 @@ std::unique_ptr<KVFileHandle> CouchKVStore::makeFileHandle(Vbid vbid) {
     return std::move(db);
 }
 
+std::unique_ptr<KVFileHandle> CouchKVStore::makeScanFileHandle(Vbid vbid) {
+    if (!statCollectingScanFileOps) {
+        return makeFileHandle(vbid);
+    }
+
+    auto db = std::make_unique<CouchKVFileHandle>(*this);
+    // openDB logs errors
+    if (openDB(vbid,
+               db->getDbHolder(),
+               COUCHSTORE_OPEN_FLAG_RDONLY,
+               statCollectingScanFileOps.get()) != COUCHSTORE_SUCCESS) {
+        return {};
+    }
+
+    return std::move(db);
+}
+
+std::optional<vbucket_state> CouchKVStore::exportSnapshot(
+        const KVFileHandle& kvFileHandle, Vbid vbid, const std::string& path) {
+    // const_cast away here, the lower level couchstore does not use const
+    auto& couchKvHandle = static_cast<CouchKVFileHandle&>(
+            const_cast<KVFileHandle&>(kvFileHandle));
+    auto& db = couchKvHandle.getDbHolder();
+
+    const auto res = readVBState(db, vbid);
+    if (res.status != ReadVBStateStatus::Success) {
+        logger.warn(
+                "CouchKVStore::exportSnapshot: {} failed to read vbstate, "
+                "status:{}",
+                vbid,
+                int(res.status));
+        return {};
+    }
+
+    // As for compaction, couchstore would append to a leftover file
+    if (remove(path.c_str()) != 0 && errno != ENOENT) {
+        logger.warn("CouchKVStore::exportSnapshot: {} remove error:{}, path:{}",
+                    vbid,
+                    cb_strerror(),
+                    path);
+        return {};
+    }
+
+    couchstore_open_flags flags(COUCHSTORE_COMPACT_FLAG_UPGRADE_DB);
+    if (!configuration.getBuffered()) {
+        flags |= COUCHSTORE_OPEN_FLAG_UNBUFFERED;
+    }
+    const auto periodicSyncBytes = configuration.getPeriodicSyncBytes();
+    if (periodicSyncBytes != 0) {
+        flags |= couchstore_encode_periodic_sync_flags(periodicSyncBytes);
+    }
+
+    // Compacting the file copies the btrees and local documents of the
+    // header the handle was opened at, so the copy is consistent however
+    // much the vBucket is flushed meanwhile. Everything is kept (including
+    // tombstones and prepares) so the copy matches a backfill of the snapshot
+    const auto errCode = cb::couchstore::compact(
+            *db,
+            path.c_str(),
+            flags,
+            [](Db&, DocInfo*, sized_buf) -> int {
+                return COUCHSTORE_COMPACT_KEEP_ITEM;
+            },
+            {},
+            statCollectingFileOps.get(),
+            [](Db&) { return COUCHSTORE_SUCCESS; });
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.warn(
+                "CouchKVStore::exportSnapshot: {} cb::couchstore::compact() "
+                "error:{} [{}], path:{}",
+                vbid,
+                couchstore_strerror(errCode),
+                couchkvstore_strerrno(db, errCode),
+                path);
+        remove(path.c_str());
+        return {};
+    }
+
+    logger.info(
+            "CouchKVStore::exportSnapshot: {} exported snapshot up to "
+            "seqno:{} to path:{}",
+            vbid,
+            res.state.highSeqno,
+            path);
+    return res.state;
+}
+
+std::optional<vbucket_state> CouchKVStore::importSnapshot(
+        Vbid vbid, const std::string& path) {
+    if (isReadOnly()) {
+        throw std::logic_error(
+                "CouchKVStore::importSnapshot: Cannot perform on a read-only "
+                "instance.");
+    }
+
+    const auto oldRev = getDbRevision(vbid);
+    const auto newRev = oldRev + 1;
+    const auto newFile = getDBFileName(dbname, vbid, newRev);
+    if (rename(path.c_str(), newFile.c_str()) != 0) {
+        logger.warn(
+                "CouchKVStore::importSnapshot: {} rename error:{}, old:{}, "
+                "new:{}",
+                vbid,
+                cb_strerror(),
+                path,
+                newFile);
+        return {};
+    }
+
+    DbHolder db(*this);
+    const auto errCode =
+            openSpecificDB(vbid, newRev, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.warn(
+                "CouchKVStore::importSnapshot: {} openDB error:{}, file:{}",
+                vbid,
+                couchstore_strerror(errCode),
+                newFile);
+        remove(newFile.c_str());
+        return {};
+    }
+
+    const auto res = readVBStateAndUpdateCache(db, vbid);
+    if (res.status != ReadVBStateStatus::Success) {
+        logger.warn(
+                "CouchKVStore::importSnapshot: {} failed to read vbstate, "
+                "status:{}, file:{}",
+                vbid,
+                int(res.status),
+                newFile);
+        db.close();
+        remove(newFile.c_str());
+        return {};
+    }
+
+    const auto info = cb::couchstore::getHeader(*db.getDb());
+    cachedDocCount[vbid.get()] = info.docCount;
+    cachedDeleteCount[vbid.get()] = info.deletedCount;
+    cachedFileSize[vbid.get()] = info.fileSize;
+    cachedSpaceUsed[vbid.get()] = info.spaceUsed;
+    db.close();
+
+    // Switch all operations to the new file before dropping the old one
+    updateDbFileMap(vbid, newRev);
+    if (cb::io::isFile(getDBFileName(dbname, vbid, oldRev))) {
+        unlinkCouchFile(vbid, oldRev);
+    }
+
+    logger.info(
+            "CouchKVStore::importSnapshot: {} installed snapshot up to "
+            "seqno:{} as file:{}",
+            vbid,
+            res.state.highSeqno,
+            newFile);
+    return res.state;
+}
+
 void CouchKVStore::prepareToCreateImpl(Vbid vbid) {
     if (!isReadOnly()) {
         (*dbFileRevMap->wlock())[vbid.get()]++;
@@ -3267,6 +3732,7 @@ CouchKVStore::getDroppedCollections(Db& db) {
 
 void CouchKVStore::updateCollectionsMeta(
         Db& db, Collections::VB::Flush& collectionsFlush) {
+    auto& collectionsMeta = getCollectionsMeta();
     updateManifestUid();
 
     if (collectionsMeta.isOpenCollectionsChanged()) {
@@ -3286,41 +3752,46 @@ void CouchKVStore::updateCollectionsMeta(
 }
 
 void CouchKVStore::updateManifestUid() {
+    auto& txn = getFlushTransaction();
     // write back, no read required
-    pendingLocalReqsQ.emplace_back(Collections::manifestName,
-                                   collectionsMeta.encodeManifestUid());
+    txn.pendingLocalReqsQ.emplace_back(Collections::manifestName,
+                                       txn.collectionsMeta.encodeManifestUid());
 }
 
 void CouchKVStore::updateOpenCollections(Db& db) {
+    auto& txn = getFlushTransaction();
     auto collections = readLocalDoc(db, Collections::openCollectionsName);
     cb::const_byte_buffer empty;
 
-    pendingLocalReqsQ.emplace_back(
+    txn.pendingLocalReqsQ.emplace_back(
             Collections::openCollectionsName,
-            collectionsMeta.encodeOpenCollections(
+            txn.collectionsMeta.encodeOpenCollections(
                     collections.getLocalDoc() ? collections.getBuffer()
                                               : empty));
 }
 
 void CouchKVStore::updateDroppedCollections(Db& db) {
-    for (const auto& [cid, event] : collectionsMeta.getDroppedCollections()) {
+    auto& txn = getFlushTransaction();
+    for (const auto& [cid, event] :
+         txn.collectionsMeta.getDroppedCollections()) {
         (void)event;
         // Delete the 'stats' document for the collection
         deleteCollectionStats(cid);
     }
 
     auto dropped = getDroppedCollections(db);
-    pendingLocalReqsQ.emplace_back(
+    txn.pendingLocalReqsQ.emplace_back(
             Collections::droppedCollectionsName,
-            collectionsMeta.encodeDroppedCollections(dropped));
+            txn.collectionsMeta.encodeDroppedCollections(dropped));
 }
 
 void CouchKVStore::updateScopes(Db& db) {
+    auto& txn = getFlushTransaction();
     auto scopes = readLocalDoc(db, Collections::scopesName);
     cb::const_byte_buffer empty;
-    pendingLocalReqsQ.emplace_back(
+    txn.pendingLocalReqsQ.emplace_back(
             Collections::scopesName,
-            collectionsMeta.encodeOpenScopes(
+            txn.collectionsMeta.encodeOpenScopes(
                     scopes.getLocalDoc() ? scopes.getBuffer() : empty));
 }
 
@@ -18,6 +18,10 @@
 
 #include "atomicqueue.h"
 #include "configuration.h"
+#include "couch-kvstore/couch-fs-coalesce-writes.h"
+#include "couch-kvstore/couch-fs-deferred-sync.h"
+#include "couch-kvstore/couch-fs-mmap-reads.h"
+#include "couch-kvstore/couch-fs-scan-readahead.h"
 #include "couch-kvstore/couch-fs-stats.h"
 #include "couch-kvstore/couch-kvstore-metadata.h"
 #include "kvstore.h"
@@ -27,6 +31,7 @@
 
 #include <folly/SharedMutex.h>
 #include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
 #include <platform/strerror.h>
 #include <relaxed_atomic.h>
 
@@ -117,6 +122,8 @@ protected:
 };
 
 struct kvstats_ctx;
+class DeferredDocInfo;
+struct GetMultiCbCtx;
 
 /**
  * KVStore with couchstore as the underlying storage system
@@ -146,7 +153,10 @@ public:
 
     /**
      * A read only CouchKVStore can only be created by a RW store. They should
-     * be created in pairs as they share some data.
+     * be created in pairs as they share some data. The RO store takes a copy
+     * of the vBucket states read by this store (rather than reading them from
+     * every vBucket file again), so it should be created before this store is
+     * in use.
      *
      * @return a unique_ptr holding a RO 'sibling' to this object.
      */
@@ -165,6 +175,8 @@ public:
      */
     bool commit(VB::Commit& commitData) override;
 
+    bool begin(std::unique_ptr<TransactionContext> txCtx) override;
+
     /**
      * Rollback a transaction (unless not currently in one).
      */
@@ -173,9 +185,10 @@ public:
             throw std::logic_error("CouchKVStore::rollback: Not valid on a "
                     "read-only object.");
         }
-        if (inTransaction) {
-            inTransaction = false;
-            transactionCtx.reset();
+        auto& txn = getFlushTransaction();
+        if (txn.inTransaction) {
+            txn.inTransaction = false;
+            txn.ctx.reset();
         }
     }
 
@@ -214,6 +227,10 @@ public:
 
     void getMulti(Vbid vb, vb_bgfetch_queue_t& itms) override;
 
+    /// Always reads the bodies in file order, as with
+    /// couchstore_bgfetch_readahead.
+    void getMultiBulk(Vbid vb, vb_bgfetch_queue_t& itms) override;
+
     void getRange(Vbid vb,
                   const DiskDocKey& startKey,
                   const DiskDocKey& endKey,
@@ -334,6 +351,18 @@ public:
         return true;
     }
 
+    bool supportsConcurrentFlush() const override {
+        return true;
+    }
+
+    bool supportsGroupCommit() const override {
+        return true;
+    }
+
+    void beginGroupCommit() override;
+
+    bool endGroupCommit() override;
+
     std::unique_ptr<BySeqnoScanContext> initBySeqnoScanContext(
             std::unique_ptr<StatusCallback<GetValue>> cb,
             std::unique_ptr<StatusCallback<CacheLookup>> cl,
@@ -356,6 +385,31 @@ public:
 
     std::unique_ptr<KVFileHandle> makeFileHandle(Vbid vbid) override;
 
+    /// @return a handle to scan the vBucket's file by seqno with
+    std::unique_ptr<KVFileHandle> makeScanFileHandle(Vbid vbid);
+
+    bool supportsSnapshotTransfer() const override {
+        return true;
+    }
+
+    /**
+     * The snapshot is written by compacting the header the handle was opened
+     * at into the new file, so it holds the documents and local documents
+     * (vbstate, collections metadata) of that header without the stale
+     * blocks of the source file.
+     */
+    std::optional<vbucket_state> exportSnapshot(
+            const KVFileHandle& kvFileHandle,
+            Vbid vbid,
+            const std::string& path) override;
+
+    /**
+     * The file is renamed to the next revision of the vBucket's data file,
+     * the previous revision is then unlinked.
+     */
+    std::optional<vbucket_state> importSnapshot(
+            Vbid vbid, const std::string& path) override;
+
     /**
      * prepareToCreate will increment the revision number of the vbucket, but is
      * a no-op if readOnly()
@@ -405,6 +459,24 @@ public:
     void closeDatabaseHandle(Db* db);
 
 protected:
+    /**
+     * Implementation of getMulti() / getMultiBulk().
+     * @param readahead Read the bodies in file order after issuing readahead
+     *        for them (see readDeferredBodies()), rather than as each is
+     *        found.
+     */
+    void getMultiImpl(Vbid vb, vb_bgfetch_queue_t& itms, bool readahead);
+
+    /**
+     * Second phase of getMulti() when couchstore_bgfetch_readahead is
+     * enabled: issue readahead for the bodies of all the given documents,
+     * then read them in file offset order and complete their bgfetches.
+     */
+    void readDeferredBodies(DbHolder& db,
+                            Vbid vb,
+                            std::vector<DeferredDocInfo>& deferred,
+                            GetMultiCbCtx& ctx);
+
     /**
      * RAII holder for a couchstore LocalDoc object
      */
@@ -752,15 +824,57 @@ protected:
      */
     std::shared_ptr<RevisionMap> dbFileRevMap;
 
-    PendingRequestQueue pendingReqsQ;
-
     /**
-     * A queue of pending local document updates (set or delete) that is used
-     * by the 'flush' path of KVStore (begin/[set|del]/commit). The commit
-     * path will write this queue of requests before finally calling
-     * couchstore_commit
+     * The state of a flush transaction (begin/[set|del]/commit). Each thread
+     * has its own, so that different vBuckets (which are different files) can
+     * be flushed concurrently - see supportsConcurrentFlush().
      */
-    PendingLocalDocRequestQueue pendingLocalReqsQ;
+    struct FlushTransaction {
+        // This variable is used to verify that the KVStore API is used
+        // correctly (see KVStore::inTransaction).
+        bool inTransaction = false;
+
+        std::unique_ptr<TransactionContext> ctx;
+
+        PendingRequestQueue pendingReqsQ;
+
+        /**
+         * A queue of pending local document updates (set or delete). The
+         * commit path will write this queue of requests before finally
+         * calling couchstore_commit
+         */
+        PendingLocalDocRequestQueue pendingLocalReqsQ;
+
+        /// Metadata that must be persisted with the flush-batch
+        Collections::KVStore::CommitMetaData collectionsMeta;
+
+        /**
+         * FileOpsInterface implementation used during a group commit, which
+         * defers the final sync of each commit until the group ends. Wraps
+         * getFlushFileOps(); created by the first group commit.
+         */
+        std::unique_ptr<DeferredSyncOps> groupCommitOps;
+
+        /// Set between beginGroupCommit() and endGroupCommit()
+        bool inGroupCommit = false;
+
+        /**
+         * The files committed to during the current group commit; kept open
+         * until the deferred syncs have been performed.
+         */
+        std::vector<DbHolder> groupCommitDbs;
+    };
+
+    /// @return the calling thread's flush transaction
+    FlushTransaction& getFlushTransaction() {
+        return *flushTransaction;
+    }
+
+    Collections::KVStore::CommitMetaData& getCollectionsMeta() override {
+        return getFlushTransaction().collectionsMeta;
+    }
+
+    folly::ThreadLocal<FlushTransaction> flushTransaction;
 
     /**
      * FileOpsInterface implementation for couchstore which tracks
@@ -778,6 +892,40 @@ protected:
      */
     std::unique_ptr<FileOpsInterface> statCollectingFileOpsCompaction;
 
+    /**
+     * FileOpsInterface implementation used when flushing, which coalesces
+     * couchstore's writes before passing them to statCollectingFileOps.
+     * Null if couchstore_write_coalesce_size is 0.
+     */
+    std::unique_ptr<CoalescingWriteOps> coalescingFileOps;
+
+    /**
+     * FileOpsInterface implementation serving the reads of files opened
+     * read-only from a memory mapping of the file, and the StatsOps (backed
+     * by this->st.fsStats) wrapping it which such files are opened with.
+     * Null if couchstore_mmap_reads is disabled.
+     */
+    std::unique_ptr<MmapReadOps> mmapFileOps;
+    std::unique_ptr<FileOpsInterface> statCollectingMmapFileOps;
+
+    /**
+     * FileOpsInterface implementation following by-seqno scans to read
+     * ahead of them and drop what they moved past from the page cache, and
+     * the StatsOps (backed by this->st.fsStats) wrapping it which the files
+     * scanned are opened with. Null unless couchstore_backfill_readahead_size
+     * or couchstore_backfill_drop_behind is set (Linux only).
+     */
+    std::unique_ptr<ScanReadaheadOps> scanFileOps;
+    std::unique_ptr<FileOpsInterface> statCollectingScanFileOps;
+
+    /// @return the FileOpsInterface to flush with (outside a group commit)
+    FileOpsInterface* getFlushFileOps() {
+        if (coalescingFileOps) {
+            return coalescingFileOps.get();
+        }
+        return statCollectingFileOps.get();
+    }
+
     /* deleted docs in each file, indexed by vBucket. RelaxedAtomic
        to allow stats access witout lock */
     std::vector<cb::RelaxedAtomic<size_t>> cachedDeleteCount;
@@ -834,17 +982,23 @@ protected:
     /**
      * Construction for a read-only CouchKVStore.
      * This constructor will initialise from files it finds in the data
-     * directory and use the given RevisionMap for operations.
+     * directory (or from the state the given read-write store read from
+     * them) and use the given RevisionMap for operations.
      *
      * @param CreateReadOnly tag to clearly differentiate from ReadWrite method
      * @param config config to use
      * @param ops The ops interface to use for File I/O
      * @param dbFileRevMap to use
+     * @param rwStore the read-write store (sharing the RevisionMap) to copy
+     *        the vBucket states from rather than opening every file again,
+     *        or nullptr to read them from disk. It mustn't be in use
+     *        (being flushed to) by another thread.
      */
     CouchKVStore(CreateReadOnly,
                  CouchKVStoreConfig& config,
                  FileOpsInterface& ops,
-                 std::shared_ptr<RevisionMap> dbFileRevMap);
+                 std::shared_ptr<RevisionMap> dbFileRevMap,
+                 const CouchKVStore* rwStore = nullptr);
 
     /**
      * Common RO/RW initialisation
@@ -19,6 +19,8 @@
 
 #include "checkpoint.h"
 #include "checkpoint_manager.h"
+#include "dcp/dcpconnmap.h"
+#include "dcp/item_encoding_cache.h"
 #include "dcp/producer.h"
 #include "dcp/response.h"
 #include "ep_time.h"
@@ -70,6 +72,10 @@ ActiveStream::ActiveStream(EventuallyPersistentEngine* e,
       engine(e),
       producerPtr(p),
       takeoverSendMaxTime(e->getConfiguration().getDcpTakeoverMaxTime()),
+      backfillSnapshotChunkItems(
+              e->getConfiguration().getDcpBackfillSnapshotChunkItems()),
+      readyQueueMaxBytes(
+              e->getConfiguration().getDcpStreamReadyQueueMaxBytes()),
       lastSentSnapEndSeqno(0),
       chkptItemsExtractionInProgress(false),
       includeDeleteTime(includeDeleteTime),
@@ -347,23 +353,35 @@ bool ActiveStream::markDiskSnapshot(uint64_t startSeqno,
                                  : std::nullopt;
         log(spdlog::level::level_enum::info,
             "{} ActiveStream::markDiskSnapshot: Sending disk snapshot with "
-            "start {}, end {}, and high completed {}, max visible {}",
+            "start {}, end {}, and high completed {}, max visible {}{}",
             logPrefix,
             startSeqno,
             endSeqno,
             to_string_or_none(hcsToSend),
-            to_string_or_none(mvsToSend));
-        pushToReadyQ(std::make_unique<SnapshotMarker>(
-                opaque_,
-                vb_,
-                startSeqno,
-                endSeqno,
-                MARKER_FLAG_DISK | MARKER_FLAG_CHK,
-                hcsToSend,
-                mvsToSend,
-                timestamp,
-                sid));
-        lastSentSnapEndSeqno.store(endSeqno, std::memory_order_relaxed);
+            to_string_or_none(mvsToSend),
+            backfillSnapshotChunkItems && !timestamp
+                    ? ", in chunks of " +
+                              std::to_string(backfillSnapshotChunkItems) +
+                              " items"
+                    : "");
+        if (backfillSnapshotChunkItems && !timestamp) {
+            // The markers are queued as the chunks fill up (a PiTR
+            // snapshot is always sent whole)
+            diskSnapshotChunks = DiskSnapshotChunks{
+                    startSeqno, endSeqno, hcsToSend, mvsToSend};
+        } else {
+            pushToReadyQ(std::make_unique<SnapshotMarker>(
+                    opaque_,
+                    vb_,
+                    startSeqno,
+                    endSeqno,
+                    MARKER_FLAG_DISK | MARKER_FLAG_CHK,
+                    hcsToSend,
+                    mvsToSend,
+                    timestamp,
+                    sid));
+            lastSentSnapEndSeqno.store(endSeqno, std::memory_order_relaxed);
+        }
 
         if (!isDiskOnly()) {
             // Only re-register the cursor if we still need to get memory
@@ -375,6 +393,42 @@ bool ActiveStream::markDiskSnapshot(uint64_t startSeqno,
     return true;
 }
 
+void ActiveStream::pushDiskSnapshotChunk_UNLOCKED(uint64_t end) {
+    auto& chunks = *diskSnapshotChunks;
+    if (end < chunks.start) {
+        // Nothing left of the snapshot
+        return;
+    }
+
+    // The high completed and max visible seqnos of a chunk are those of the
+    // part of the snapshot it covers (the last chunk sends the snapshot's)
+    std::optional<uint64_t> hcs;
+    if (chunks.highCompletedSeqno) {
+        hcs = std::min(*chunks.highCompletedSeqno, end);
+    }
+    std::optional<uint64_t> mvs;
+    if (chunks.maxVisibleSeqno) {
+        mvs = end == chunks.end ? *chunks.maxVisibleSeqno
+                                : chunks.lastVisibleSeqno;
+    }
+    pushToReadyQ(std::make_unique<SnapshotMarker>(opaque_,
+                                                  vb_,
+                                                  chunks.start,
+                                                  end,
+                                                  MARKER_FLAG_DISK |
+                                                          MARKER_FLAG_CHK,
+                                                  hcs,
+                                                  mvs,
+                                                  std::nullopt,
+                                                  sid));
+    lastSentSnapEndSeqno.store(end, std::memory_order_relaxed);
+    for (auto& resp : chunks.items) {
+        pushToReadyQ(std::move(resp));
+    }
+    chunks.items.clear();
+    chunks.start = end + 1;
+}
+
 bool ActiveStream::markOSODiskSnapshot(uint64_t endSeqno) {
     {
         std::unique_lock<std::mutex> lh(streamMutex);
@@ -434,18 +488,42 @@ bool ActiveStream::backfillReceived(std::unique_ptr<Item> itm,
             // Deleting resp may also delete itm (which is owned by
             // resp)
             resp.reset();
+            // The backfill pauses until the buffered items are sent, so
+            // they can't wait for the chunk to fill up
+            if (diskSnapshotChunks && !diskSnapshotChunks->items.empty()) {
+                pushDiskSnapshotChunk_UNLOCKED(diskSnapshotChunks->lastSeqno);
+                lh.unlock();
+                notifyStreamReady();
+            }
             return false;
         }
 
         bufferedBackfill.bytes.fetch_add(resp->getApproximateSize());
         bufferedBackfill.items++;
-        lastBackfilledSeqno = std::max<uint64_t>(lastBackfilledSeqno,
-                                                 uint64_t(*resp->getBySeqno()));
-
-        pushToReadyQ(std::move(resp));
+        const auto seqno = uint64_t(*resp->getBySeqno());
+        lastBackfilledSeqno = std::max<uint64_t>(lastBackfilledSeqno, seqno);
+
+        bool queued = true;
+        if (diskSnapshotChunks) {
+            auto& chunks = *diskSnapshotChunks;
+            if (qi->isVisible()) {
+                chunks.lastVisibleSeqno = seqno;
+            }
+            chunks.lastSeqno = seqno;
+            chunks.items.push_back(std::move(resp));
+            if (chunks.items.size() >= backfillSnapshotChunkItems) {
+                pushDiskSnapshotChunk_UNLOCKED(seqno);
+            } else {
+                queued = false;
+            }
+        } else {
+            pushToReadyQ(std::move(resp));
+        }
 
         lh.unlock();
-        notifyStreamReady();
+        if (queued) {
+            notifyStreamReady();
+        }
 
         if (backfill_source == BACKFILL_FROM_MEMORY) {
             backfillItems.memory++;
@@ -468,6 +546,11 @@ void ActiveStream::completeBackfill() {
             lastReadSeqno.store(lastBackfilledSeqno);
         }
 
+        if (diskSnapshotChunks) {
+            pushDiskSnapshotChunk_UNLOCKED(diskSnapshotChunks->end);
+            diskSnapshotChunks.reset();
+        }
+
         if (isSeqnoAdvancedNeededBackFill()) {
             queueSeqnoAdvanced();
         }
@@ -860,6 +943,18 @@ void ActiveStream::addStats(const AddStatFn& add_stat, const void* c) {
                          name_.c_str(),
                          vb_.get());
         add_casted_stat(buffer, getReadyQueueMemory(), add_stat, c);
+        checked_snprintf(buffer,
+                         bsize,
+                         "%s:stream_%d_ready_queue_spills",
+                         name_.c_str(),
+                         vb_.get());
+        add_casted_stat(buffer, readyQueueSpills, add_stat, c);
+        checked_snprintf(buffer,
+                         bsize,
+                         "%s:stream_%d_item_send_latency",
+                         name_.c_str(),
+                         vb_.get());
+        add_casted_stat(buffer, itemSendLatencyHisto, add_stat, c);
 
         checked_snprintf(buffer,
                          bsize,
@@ -988,6 +1083,7 @@ std::unique_ptr<DcpResponse> ActiveStream::nextQueuedItem() {
                     backfillItems.sent++;
                 } else {
                     itemsFromMemoryPhase++;
+                    recordItemSendLatency(*response);
                 }
             }
 
@@ -997,6 +1093,21 @@ std::unique_ptr<DcpResponse> ActiveStream::nextQueuedItem() {
     return nullptr;
 }
 
+void ActiveStream::recordItemSendLatency(const DcpResponse& response) {
+    const auto* mutation = dynamic_cast<const MutationResponse*>(&response);
+    if (!mutation) {
+        return;
+    }
+    const auto queuedTime = mutation->getItem()->getQueuedTime();
+    if (queuedTime == std::chrono::steady_clock::time_point{}) {
+        // Item was not queued via VBucket::queueDirty, nothing to measure.
+        return;
+    }
+    itemSendLatencyHisto.add(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - queuedTime));
+}
+
 bool ActiveStream::nextCheckpointItem() {
     VBucketPtr vbucket = engine->getVBucket(vb_);
     if (vbucket && vbucket->checkpointManager->getNumItemsForCursor(
@@ -1031,6 +1142,9 @@ void ActiveStream::nextCheckpointItemTask(const LockHolder& streamMutex) {
         // MB-29369: only run the task's work if the stream is in an in-memory
         // phase (of which takeover is a variant).
         if (isInMemory() || isTakeoverSend()) {
+            if (maybeSpillToBackfill_UNLOCKED()) {
+                return;
+            }
             auto res = getOutstandingItems(*vbucket);
             processItems(res, streamMutex);
         }
@@ -1043,6 +1157,31 @@ void ActiveStream::nextCheckpointItemTask(const LockHolder& streamMutex) {
     }
 }
 
+bool ActiveStream::maybeSpillToBackfill_UNLOCKED() {
+    // A takeover must complete from memory
+    if (readyQueueMaxBytes == 0 || !isInMemory() || pendingBackfill ||
+        getReadyQueueMemory() < readyQueueMaxBytes) {
+        return false;
+    }
+
+    log(spdlog::level::level_enum::info,
+        "{} Ready queue memory {} is above the limit of {}, dropping the "
+        "cursor and backfilling from lastReadSeqno:{} once drained",
+        logPrefix,
+        getReadyQueueMemory(),
+        readyQueueMaxBytes,
+        lastReadSeqno.load());
+
+    dropCheckpointCursor_UNLOCKED();
+    // dropCheckpointCursor_UNLOCKED ends the stream if the vBucket is gone
+    if (!isActive()) {
+        return true;
+    }
+    pendingBackfill = true;
+    ++readyQueueSpills;
+    return true;
+}
+
 ActiveStream::OutstandingItemsResult ActiveStream::getOutstandingItems(
         VBucket& vb) {
     OutstandingItemsResult result;
@@ -1164,30 +1303,57 @@ std::unique_ptr<DcpResponse> ActiveStream::makeResponseFromItem(
                              includeDeletedUserXattrs,
                              isForceValueCompressionEnabled(),
                              isSnappyEnabled())) {
-            auto finalItem = make_STRCPtr<Item>(*item);
-            finalItem->removeBodyAndOrXattrs(
-                    includeValue, includeXattributes, includeDeletedUserXattrs);
-
-            if (isSnappyEnabled()) {
-                if (isForceValueCompressionEnabled()) {
-                    if (!mcbp::datatype::is_snappy(finalItem->getDataType())) {
-                        if (!finalItem->compressValue()) {
+            // Every stream of the vBucket reading from the checkpoints sees
+            // the same queued_item, so a copy built (and possibly compressed)
+            // by one stream can be shared by all others wanting the same
+            // encoding. Backfilled items are unique to the stream reading
+            // them so are not cached.
+            DcpItemEncodingCache* cache = nullptr;
+            if (sendCommitSyncWriteAs == SendCommitSyncWriteAs::Commit) {
+                cache = engine->getDcpConnMap().getItemEncodingCache();
+            }
+            const DcpItemEncodingCache::Encoding encoding{
+                    includeValue,
+                    includeXattributes,
+                    includeDeletedUserXattrs,
+                    isForceValueCompressionEnabled(),
+                    isSnappyEnabled()};
+
+            queued_item finalItem;
+            if (cache) {
+                finalItem = cache->find(item, encoding);
+            }
+            if (!finalItem) {
+                finalItem = make_STRCPtr<Item>(*item);
+                finalItem->removeBodyAndOrXattrs(includeValue,
+                                                 includeXattributes,
+                                                 includeDeletedUserXattrs);
+
+                if (isSnappyEnabled()) {
+                    if (isForceValueCompressionEnabled()) {
+                        if (!mcbp::datatype::is_snappy(
+                                    finalItem->getDataType())) {
+                            if (!finalItem->compressValue()) {
+                                log(spdlog::level::level_enum::warn,
+                                    "{} Failed to snappy compress an "
+                                    "uncompressed value",
+                                    logPrefix);
+                            }
+                        }
+                    }
+                } else {
+                    if (mcbp::datatype::is_snappy(finalItem->getDataType())) {
+                        if (!finalItem->decompressValue()) {
                             log(spdlog::level::level_enum::warn,
-                                "{} Failed to snappy compress an uncompressed "
+
+                                "{} Failed to snappy uncompress a compressed "
                                 "value",
                                 logPrefix);
                         }
                     }
                 }
-            } else {
-                if (mcbp::datatype::is_snappy(finalItem->getDataType())) {
-                    if (!finalItem->decompressValue()) {
-                        log(spdlog::level::level_enum::warn,
-
-                            "{} Failed to snappy uncompress a compressed "
-                            "value",
-                            logPrefix);
-                    }
+                if (cache) {
+                    cache->insert(item, encoding, finalItem);
                 }
             }
 
@@ -1551,6 +1717,7 @@ void ActiveStream::endStream(cb::mcbp::DcpStreamEndStatus reason) {
             // If Stream were in Backfilling state, clear out the
             // backfilled items to clear up the backfill buffer.
             clear_UNLOCKED();
+            diskSnapshotChunks.reset();
             auto producer = producerPtr.lock();
             if (producer) {
                 producer->recordBackfillManagerBytesSent(
@@ -1741,10 +1908,13 @@ bool ActiveStream::tryAndScheduleOSOBackfill(DcpProducer& producer,
     // OSO only allowed:
     // if the filter is set to a single collection.
     // if this is the initial backfill request
-    // if the client has enabled OSO
+    // if the client has enabled OSO, for the connection or for this stream
+    // if the collection is small enough relative to the vBucket for its key
+    // range scan to be cheaper than a by-seqno scan
     if (filter.singleCollection() && lastReadSeqno.load() == 0 &&
         curChkSeqno.load() > lastReadSeqno.load() + 1 &&
-        producer.isOutOfOrderSnapshotsEnabled()) {
+        producer.isOutOfOrderSnapshotsEnabled(isOSOBackfillRequested()) &&
+        producer.shouldBackfillOSO(vb, filter.front())) {
         CollectionID cid = filter.front();
 
         // OSO possible - engage.
@@ -2140,6 +2310,10 @@ bool ActiveStream::isTakeoverStream() const {
     return flags_ & DCP_ADD_STREAM_FLAG_TAKEOVER;
 }
 
+bool ActiveStream::isOSOBackfillRequested() const {
+    return flags_ & DCP_ADD_STREAM_FLAG_OSO_BACKFILL;
+}
+
 bool ActiveStream::isSeqnoAdvancedEnabled() const {
     return isCollectionEnabledStream() && !supportSyncReplication();
 }
@@ -22,6 +22,8 @@
 #include <memcached/engine_error.h>
 #include <platform/non_negative_counter.h>
 #include <spdlog/common.h>
+#include <utilities/hdrhistogram.h>
+#include <deque>
 #include <optional>
 
 class CheckpointManager;
@@ -232,6 +234,15 @@ public:
 
     uint64_t getLastSentSeqno() const;
 
+    /**
+     * @return the histogram of the time items sent from memory spent between
+     * being queued into the CheckpointManager and being handed to the
+     * connection.
+     */
+    const Hdr1sfMicroSecHistogram& getItemSendLatencyHisto() const {
+        return itemSendLatencyHisto;
+    }
+
     // Defined in active_stream_impl.h to remove the need to include the
     // producer header here
     template <typename... Args>
@@ -322,6 +333,12 @@ public:
 
     void notifyEmptyBackfill_UNLOCKED(uint64_t lastSeenSeqno);
 
+    /**
+     * Queue the snapshot marker of the next chunk of diskSnapshotChunks
+     * (ending at end), followed by the items held back for it.
+     */
+    void pushDiskSnapshotChunk_UNLOCKED(uint64_t end);
+
     bool collectionAllowed(DocKey key) const;
 
     /**
@@ -334,6 +351,9 @@ public:
 
     bool isTakeoverStream() const;
 
+    /// @return true if the stream was requested with the OSO backfill flag
+    bool isOSOBackfillRequested() const;
+
     PointInTimeEnabled isPointInTimeEnabled() const {
         return pitrEnabled;
     }
@@ -393,6 +413,12 @@ protected:
 
     std::unique_ptr<DcpResponse> nextQueuedItem();
 
+    /**
+     * Record the time since the given response's item was queued into the
+     * CheckpointManager in itemSendLatencyHisto (for Mutation-type responses).
+     */
+    void recordItemSendLatency(const DcpResponse& response);
+
     /**
      * Create a DcpResponse message to send to the replica from the given item.
      *
@@ -551,6 +577,18 @@ private:
 
     bool isCurrentSnapshotCompleted() const;
 
+    /**
+     * Stop reading from the checkpoints if the readyQ is above
+     * readyQueueMaxBytes: the cursor is dropped (releasing the checkpoint
+     * items it pins) and the items after lastReadSeqno are backfilled once
+     * the consumer has drained the readyQ (see inMemoryPhase), keeping the
+     * memory of a slow stream bounded.
+     * Caller must hold streamMutex.
+     *
+     * @return true if the stream is now pending a backfill
+     */
+    bool maybeSpillToBackfill_UNLOCKED();
+
     /**
      * Drop the cursor registered with the checkpoint manager. Used during
      * cursor dropping. Upon failure to drop the cursor, puts stream to
@@ -655,6 +693,13 @@ private:
     //! The amount of items that have been sent during the memory phase
     std::atomic<size_t> itemsFromMemoryPhase;
 
+    /**
+     * Time from an item being queued into the CheckpointManager to it being
+     * handed to the connection. Only recorded for items sent from memory;
+     * backfilled items have no queued time.
+     */
+    Hdr1sfMicroSecHistogram itemSendLatencyHisto;
+
     //! Whether or not this is the first snapshot marker sent
     // @TODO - update to be part of the state machine.
     bool firstMarkerSent;
@@ -685,6 +730,18 @@ private:
      */
     const size_t takeoverSendMaxTime;
 
+    /// The (minimum) number of items of each of the snapshots a disk
+    /// backfill is split into; 0 sends it as a single snapshot
+    const size_t backfillSnapshotChunkItems;
+
+    /// The readyQ memory above which an in-memory stream stops reading from
+    /// the checkpoints and backfills instead; 0 for no limit
+    const size_t readyQueueMaxBytes;
+
+    /// Number of times the stream switched to backfilling as its readyQ
+    /// exceeded readyQueueMaxBytes
+    std::atomic<size_t> readyQueueSpills{0};
+
     //! Last snapshot end seqno sent to the DCP client
     std::atomic<uint64_t> lastSentSnapEndSeqno;
 
@@ -697,6 +754,28 @@ private:
      */
     uint64_t maxScanSeqno{0};
 
+    /**
+     * A disk snapshot which is being sent as a series of smaller snapshots
+     * (see backfillSnapshotChunkItems), so that a consumer which is
+     * restarted part way through a long backfill only has to receive the
+     * snapshot it didn't complete again. The items of the current chunk are
+     * held back until its end (the seqno of its last item) is known.
+     */
+    struct DiskSnapshotChunks {
+        /// The start of the next chunk
+        uint64_t start;
+        /// The end of the whole snapshot
+        uint64_t end;
+        std::optional<uint64_t> highCompletedSeqno;
+        std::optional<uint64_t> maxVisibleSeqno;
+        /// The highest visible seqno backfilled so far
+        uint64_t lastVisibleSeqno = 0;
+        /// The highest seqno in items
+        uint64_t lastSeqno = 0;
+        std::deque<std::unique_ptr<DcpResponse>> items;
+    };
+    std::optional<DiskSnapshotChunks> diskSnapshotChunks;
+
     /* Flag used by checkpointCreatorTask that is set before all items are
        extracted for given checkpoint cursor, and is unset after all retrieved
        items are added to the readyQ */
@@ -25,10 +25,16 @@
 #include <climits>
 
 ActiveStreamCheckpointProcessorTask::ActiveStreamCheckpointProcessorTask(
-        EventuallyPersistentEngine& e, std::shared_ptr<DcpProducer> p)
+        EventuallyPersistentEngine& e,
+        std::shared_ptr<DcpProducer> p,
+        size_t lane,
+        size_t numLanes)
     : GlobalTask(
               &e, TaskId::ActiveStreamCheckpointProcessorTask, INT_MAX, false),
-      description("Process checkpoint(s) for DCP producer " + p->getName()),
+      description("Process checkpoint(s) for DCP producer " + p->getName() +
+                  (numLanes > 1 ? " lane " + std::to_string(lane) : "")),
+      lane(lane),
+      queue(e.getConfiguration().getMaxVbuckets()),
       notified(false),
       iterationsBeforeYield(
               e.getConfiguration().getDcpProducerSnapshotMarkerYieldLimit()),
@@ -95,7 +101,9 @@ void ActiveStreamCheckpointProcessorTask::cancelTask() {
 void ActiveStreamCheckpointProcessorTask::addStats(const std::string& name,
                                                    const AddStatFn& add_stat,
                                                    const void* c) const {
-    auto prefix = name + ":ckpt_processor_queue_";
+    // The first lane reports under the original (un-suffixed) stat names.
+    const auto suffix = lane == 0 ? std::string{} : "_" + std::to_string(lane);
+    auto prefix = name + ":ckpt_processor_queue" + suffix + "_";
     queue.addStats(prefix, add_stat, c);
 
     add_casted_stat((prefix + "notified").c_str(), notified, add_stat, c);
@@ -33,10 +33,18 @@ class Stream;
 template <class E>
 class StreamContainer;
 
+/**
+ * Moves items from the checkpoints of a DcpProducer's in-memory streams to
+ * their readyQs. A producer has dcp_producer_checkpoint_processor_parallelism
+ * of these tasks ("lanes"); the vBuckets are partitioned between them, so each
+ * vBucket's streams are still processed in order by a single task.
+ */
 class ActiveStreamCheckpointProcessorTask : public GlobalTask {
 public:
     ActiveStreamCheckpointProcessorTask(EventuallyPersistentEngine& e,
-                                        std::shared_ptr<DcpProducer> p);
+                                        std::shared_ptr<DcpProducer> p,
+                                        size_t lane = 0,
+                                        size_t numLanes = 1);
 
     std::string getDescription() override {
         return description;
@@ -75,6 +83,9 @@ private:
     /// Human-readable description of this task.
     const std::string description;
 
+    /// Which of the producer's checkpoint processor tasks this is
+    const size_t lane;
+
     /*
      * Maintain a queue of unique vbucket ids for which stream should be
      * processed.
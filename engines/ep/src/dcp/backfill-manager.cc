@@ -142,6 +142,11 @@ void BackfillManager::addStats(DcpProducer& conn,
     conn.addStat("backfill_order", to_string(scheduleOrder), add_stat, c);
 }
 
+size_t BackfillManager::getBufferBytesRead() {
+    LockHolder lh(lock);
+    return buffer.bytesRead;
+}
+
 BackfillManager::~BackfillManager() {
     if (managerTask) {
         managerTask->cancel();
@@ -166,6 +166,9 @@ public:
 
     void addStats(DcpProducer& conn, const AddStatFn& add_stat, const void* c);
 
+    /// @returns the bytes read by the backfills and not yet sent
+    size_t getBufferBytesRead();
+
     /// The scheduling order for DCPBackfills
     enum class ScheduleOrder {
         /**
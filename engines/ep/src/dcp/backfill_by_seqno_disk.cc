@@ -17,11 +17,231 @@
 
 #include "dcp/backfill_by_seqno_disk.h"
 #include "dcp/active_stream_impl.h"
+#include "dcp/backfill-manager.h"
+#include "dcp/dcpconnmap.h"
+#include "dcp/shared_backfill_scan.h"
 #include "ep_engine.h"
+#include "executorpool.h"
 #include "kv_bucket.h"
 #include "kvstore.h"
 
 #include <mcbp/protocol/dcp_stream_end_status.h>
+#include <phosphor/phosphor.h>
+
+#include <climits>
+#include <deque>
+
+/**
+ * One lane of a parallel by-seqno backfill. The lane's task scans the lane's
+ * current chunk into a buffer (bounded by a BackfillScanBuffer), then waits
+ * for the owning DCPBackfillBySeqnoDisk to drain the chunk and advance the
+ * lane onto its next chunk.
+ *
+ * All state other than scanCtx is guarded by mutex. scanCtx is only used by
+ * whichever of the task or the backfill has set scanning / direct.
+ */
+class BackfillScanLane {
+public:
+    BackfillScanLane(std::shared_ptr<ActiveStream> stream,
+                     size_t maxBytes,
+                     size_t maxItems)
+        : stream(stream), directCallback(stream) {
+        buffer.bytesRead = 0;
+        buffer.itemsRead = 0;
+        buffer.maxBytes = maxBytes;
+        buffer.maxItems = maxItems;
+    }
+
+    /**
+     * Buffer an item read by the lane's task.
+     * @return false if the buffer is full; the item is not taken.
+     */
+    bool push(GetValue& val) {
+        std::lock_guard<std::mutex> lh(mutex);
+        const auto bytes = val.item->size();
+        // As BackfillManager::bytesCheckAndRead; always accept one item.
+        if (buffer.itemsRead >= buffer.maxItems ||
+            (buffer.bytesRead != 0 &&
+             buffer.bytesRead + bytes > buffer.maxBytes)) {
+            full = true;
+            return false;
+        }
+        buffer.bytesRead += bytes;
+        buffer.itemsRead++;
+        items.push_back(std::move(val.item));
+        return true;
+    }
+
+    /*
+     * The following must be called with mutex held.
+     */
+
+    /// Remove the front buffered item, waking the task if it was waiting
+    /// for space.
+    void pop() {
+        buffer.bytesRead -= items.front()->size();
+        buffer.itemsRead--;
+        items.pop_front();
+        full = false;
+        wakeIfWaiting();
+    }
+
+    void wakeIfWaiting() {
+        if (waiting && task) {
+            waiting = false;
+            ExecutorPool::get()->wake(task->getId());
+        }
+    }
+
+    /// Point the (idle) lane at the chunk [start, end].
+    void setChunk(uint64_t start, uint64_t end) {
+        // The next scan() resumes after lastReadSeqno
+        scanCtx->lastReadSeqno = start - 1;
+        scanCtx->maxSeqno = end;
+        chunkComplete = false;
+        wakeIfWaiting();
+    }
+
+    const std::weak_ptr<ActiveStream> stream;
+
+    /// Callback used instead of buffering once the backfill has taken over
+    /// the scan of the current chunk.
+    DiskCallback directCallback;
+
+    std::unique_ptr<BySeqnoScanContext> scanCtx;
+    ExTask task;
+
+    std::mutex mutex;
+    std::deque<std::unique_ptr<Item>> items;
+    BackfillScanBuffer buffer;
+    /// An item has been rejected as the buffer is full
+    bool full = false;
+    /// The current chunk has been fully read (into items / the stream)
+    bool chunkComplete = false;
+    /// A scan of the lane failed
+    bool failed = false;
+    /// The task is running scan() on scanCtx
+    bool scanning = false;
+    /// The backfill is scanning the current chunk directly into the stream
+    bool direct = false;
+    /// The task is snoozed until woken by the backfill
+    bool waiting = false;
+    /// The lane has no more chunks or the backfill was cancelled
+    bool cancelled = false;
+};
+
+namespace {
+
+/// Disk callback of a lane's scan context.
+class LaneDiskCallback : public StatusCallback<GetValue> {
+public:
+    explicit LaneDiskCallback(BackfillScanLane& lane) : lane(lane) {
+    }
+
+    void callback(GetValue& val) override {
+        if (lane.direct) {
+            lane.directCallback.callback(val);
+            setStatus(lane.directCallback.getStatus());
+            return;
+        }
+        // As DiskCallback; make the backfilled item cold.
+        val.item->setFreqCounterValue(0);
+        setStatus(lane.push(val) ? ENGINE_SUCCESS
+                                 : ENGINE_ENOMEM); // Pause the scan
+    }
+
+private:
+    BackfillScanLane& lane;
+};
+
+/**
+ * Cache callback of a lane's scan context. Items always come from disk (the
+ * in-memory copy may be newer than the chunk by the time it is sent), but
+ * keys the stream will not send are skipped as for CacheCallback.
+ */
+class LaneCacheCallback : public StatusCallback<CacheLookup> {
+public:
+    explicit LaneCacheCallback(BackfillScanLane& lane) : lane(lane) {
+    }
+
+    void callback(CacheLookup& lookup) override {
+        auto stream = lane.stream.lock();
+        if (stream && !lookup.getKey().isPrepared() &&
+            !stream->collectionAllowed(lookup.getKey().getDocKey())) {
+            setStatus(ENGINE_KEY_EEXISTS);
+            return;
+        }
+        setStatus(ENGINE_SUCCESS);
+    }
+
+private:
+    BackfillScanLane& lane;
+};
+
+/// Task which reads a BackfillScanLane's chunks.
+class BackfillScanLaneTask : public GlobalTask {
+public:
+    BackfillScanLaneTask(EventuallyPersistentEngine& e,
+                         KVBucket& bucket,
+                         std::shared_ptr<BackfillScanLane> lane)
+        : GlobalTask(&e, TaskId::BackfillScanLaneTask, 0, false),
+          bucket(bucket),
+          weakLane(lane) {
+    }
+
+    bool run() override {
+        TRACE_EVENT0("ep-engine/task", "BackfillScanLaneTask");
+        auto lane = weakLane.lock();
+        if (!lane || engine->getEpStats().isShutdown) {
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lh(lane->mutex);
+            if (lane->cancelled) {
+                return false;
+            }
+            if (lane->chunkComplete || lane->failed || lane->direct ||
+                lane->full) {
+                // Nothing to do until the backfill drains or advances us
+                lane->waiting = true;
+                snooze(INT_MAX);
+                return true;
+            }
+            lane->scanning = true;
+        }
+
+        auto* kvstore = bucket.getROUnderlying(lane->scanCtx->vbid);
+        const auto error = kvstore->scan(*lane->scanCtx);
+
+        std::lock_guard<std::mutex> lh(lane->mutex);
+        lane->scanning = false;
+        if (error == scan_success) {
+            lane->chunkComplete = true;
+        } else if (error == scan_failed) {
+            lane->failed = true;
+        }
+        // Run again to re-evaluate; if paused for space the buffer may
+        // already have been drained.
+        snooze(0);
+        return true;
+    }
+
+    std::string getDescription() override {
+        return "Backfill scan lane";
+    }
+
+    std::chrono::microseconds maxExpectedDuration() override {
+        // Bounded by the scan buffer limits, as BackfillManagerTask
+        return std::chrono::milliseconds(300);
+    }
+
+private:
+    KVBucket& bucket;
+    std::weak_ptr<BackfillScanLane> weakLane;
+};
+
+} // namespace
 
 // Here we must force call the baseclass (DCPBackfill(s) )because of the use of
 // multiple inheritance (and virtual inheritance), otherwise stream will be null
@@ -35,6 +255,11 @@ DCPBackfillBySeqnoDisk::DCPBackfillBySeqnoDisk(KVBucket& bucket,
       DCPBackfillBySeqno(s, startSeqno, endSeqno) {
 }
 
+DCPBackfillBySeqnoDisk::~DCPBackfillBySeqnoDisk() {
+    cancelScanLanes();
+    releaseSharedScan(false);
+}
+
 backfill_status_t DCPBackfillBySeqnoDisk::create() {
     auto stream = streamPtr.lock();
     if (!stream) {
@@ -164,6 +389,18 @@ backfill_status_t DCPBackfillBySeqnoDisk::create() {
             // This value may be an overestimate - it includes prepares/aborts
             // which will not be sent if the stream is not sync write aware
             stream->setBackfillRemaining(scanCtx->documentCount);
+            createScanLanes(stream,
+                            *kvstore,
+                            *scanCtx,
+                            valFilter,
+                            stream->isPointInTimeEnabled() ==
+                                            PointInTimeEnabled::Yes
+                                    ? SnapshotSource::Historical
+                                    : SnapshotSource::Head);
+            if (lanes.empty() &&
+                stream->isPointInTimeEnabled() != PointInTimeEnabled::Yes) {
+                shareScan(stream, *scanCtx, valFilter);
+            }
             transitionState(backfill_state_scanning);
         } else {
             transitionState(backfill_state_completing);
@@ -190,6 +427,13 @@ backfill_status_t DCPBackfillBySeqnoDisk::scan() {
     }
 
     KVStore* kvstore = bucket.getROUnderlying(vbid);
+    if (!lanes.empty()) {
+        return scanLanes(*stream, *kvstore);
+    }
+    if (subscription) {
+        return scanSubscribed(*stream, *kvstore);
+    }
+
     scan_error_t error =
             kvstore->scan(static_cast<BySeqnoScanContext&>(*scanCtx));
 
@@ -197,6 +441,11 @@ backfill_status_t DCPBackfillBySeqnoDisk::scan() {
         return backfill_success;
     }
 
+    if (error == scan_failed) {
+        // The subscribers must read the rest themselves
+        releaseSharedScan(false);
+    }
+
     stream->setBackfillScanLastRead(scanCtx->lastReadSeqno);
 
     transitionState(backfill_state_completing);
@@ -205,6 +454,9 @@ backfill_status_t DCPBackfillBySeqnoDisk::scan() {
 }
 
 void DCPBackfillBySeqnoDisk::complete(bool cancelled) {
+    cancelScanLanes();
+    releaseSharedScan(!cancelled);
+
     auto stream = streamPtr.lock();
     if (!stream) {
         EP_LOG_WARN(
@@ -257,3 +509,286 @@ DCPBackfillBySeqnoDisk::getHighSeqnoOfCollections(
 
     return {true, collHigh};
 }
+
+void DCPBackfillBySeqnoDisk::createScanLanes(
+        std::shared_ptr<ActiveStream> stream,
+        KVStore& kvstore,
+        const BySeqnoScanContext& primary,
+        ValueFilter valFilter,
+        SnapshotSource source) {
+    const auto& config = bucket.getEPEngine().getConfiguration();
+    const auto parallelism = config.getDcpBackfillScanParallelism();
+    const uint64_t end = primary.maxSeqno;
+    if (parallelism < 2 || end < startSeqno) {
+        return;
+    }
+
+    // A chunk is a single scan's worth of seqnos; ranges of only a couple of
+    // chunks are not worth the extra file handles and tasks.
+    chunkSize = std::max(size_t(1), config.getDcpScanItemLimit());
+    numChunks = (end - startSeqno + chunkSize) / chunkSize;
+    const auto numLanes = std::min(uint64_t(parallelism), numChunks);
+    if (numLanes < 2) {
+        return;
+    }
+
+    const auto vbid = stream->getVBucket();
+    std::vector<std::shared_ptr<BackfillScanLane>> newLanes;
+    for (uint64_t chunk = 0; chunk < numLanes; ++chunk) {
+        auto lane = std::make_shared<BackfillScanLane>(
+                stream, config.getDcpScanByteLimit(), chunkSize);
+        const auto chunkStart = startSeqno + chunk * chunkSize;
+        auto ctx = kvstore.initBySeqnoScanContext(
+                std::make_unique<LaneDiskCallback>(*lane),
+                std::make_unique<LaneCacheCallback>(*lane),
+                vbid,
+                chunkStart,
+                DocumentFilter::ALL_ITEMS,
+                valFilter,
+                source);
+        // Each lane opens the file separately; it must have opened the same
+        // snapshot as the primary scan context for the chunks to be
+        // consistent with each other and the snapshot marker already sent.
+        if (!ctx || uint64_t(ctx->maxSeqno) != end ||
+            ctx->purgeSeqno != primary.purgeSeqno) {
+            stream->log(spdlog::level::level_enum::info,
+                        "({}) Backfill could not open a consistent snapshot "
+                        "for parallel scan, scanning sequentially",
+                        vbid);
+            return;
+        }
+        ctx->maxSeqno = std::min(end, chunkStart + chunkSize - 1);
+        lane->scanCtx = std::move(ctx);
+        newLanes.push_back(std::move(lane));
+    }
+
+    for (auto& lane : newLanes) {
+        lane->task = std::make_shared<BackfillScanLaneTask>(
+                bucket.getEPEngine(), bucket, lane);
+        ExecutorPool::get()->schedule(lane->task);
+    }
+    lanes = std::move(newLanes);
+    nextChunk = 0;
+    scanEndSeqno = end;
+
+    stream->log(spdlog::level::level_enum::info,
+                "({}) Backfill scanning {} chunks of {} seqnos with {} lanes",
+                vbid,
+                numChunks,
+                chunkSize,
+                lanes.size());
+}
+
+backfill_status_t DCPBackfillBySeqnoDisk::scanLanes(ActiveStream& stream,
+                                                    KVStore& kvstore) {
+    int64_t lastReadSeqno = 0;
+    while (nextChunk < numChunks) {
+        auto& lane = *lanes[nextChunk % lanes.size()];
+        std::unique_lock<std::mutex> lh(lane.mutex);
+
+        if (!lane.direct) {
+            while (!lane.items.empty()) {
+                // backfillReceived consumes the Item even if it rejects it,
+                // so pass a copy (sharing the value) and pop on success.
+                if (!stream.backfillReceived(
+                            std::make_unique<Item>(*lane.items.front()),
+                            BACKFILL_FROM_DISK)) {
+                    return backfill_success;
+                }
+                lane.pop();
+            }
+
+            if (lane.failed) {
+                lh.unlock();
+                stream.log(spdlog::level::level_enum::warn,
+                           "DCPBackfillBySeqnoDisk::scanLanes(): ({}) scan "
+                           "failed",
+                           getVBucketId());
+                cancelScanLanes();
+                stream.setDead(cb::mcbp::DcpStreamEndStatus::BackfillFail);
+                transitionState(backfill_state_done);
+                return backfill_finished;
+            }
+
+            if (!lane.chunkComplete) {
+                if (lane.scanning) {
+                    // The lane's task is reading the chunk; come back for
+                    // what it has read.
+                    return backfill_success;
+                }
+                // Caught up with the lane - read the rest of the chunk
+                // directly into the stream, rather than waiting.
+                lane.direct = true;
+            }
+        }
+
+        if (lane.direct) {
+            lh.unlock();
+            const auto error = kvstore.scan(*lane.scanCtx);
+            if (error == scan_again) {
+                return backfill_success;
+            }
+            lh.lock();
+            lane.direct = false;
+            if (error == scan_failed) {
+                lane.failed = true;
+                continue;
+            }
+            lane.chunkComplete = true;
+        }
+
+        // Chunk sent; move the lane on to its next chunk, if any.
+        lastReadSeqno = lane.scanCtx->lastReadSeqno;
+        const auto laneNextChunk = nextChunk + lanes.size();
+        if (laneNextChunk < numChunks) {
+            const auto chunkStart = startSeqno + laneNextChunk * chunkSize;
+            lane.setChunk(chunkStart,
+                          std::min(scanEndSeqno, chunkStart + chunkSize - 1));
+        } else {
+            lane.cancelled = true;
+            lane.wakeIfWaiting();
+        }
+        ++nextChunk;
+    }
+
+    stream.setBackfillScanLastRead(lastReadSeqno);
+    transitionState(backfill_state_completing);
+    return backfill_success;
+}
+
+void DCPBackfillBySeqnoDisk::cancelScanLanes() {
+    for (auto& lane : lanes) {
+        std::lock_guard<std::mutex> lh(lane->mutex);
+        lane->cancelled = true;
+        if (lane->task) {
+            ExecutorPool::get()->cancel(lane->task->getId());
+        }
+    }
+    lanes.clear();
+}
+
+void DCPBackfillBySeqnoDisk::shareScan(std::shared_ptr<ActiveStream> stream,
+                                       BySeqnoScanContext& ctx,
+                                       ValueFilter valFilter) {
+    const auto& config = bucket.getEPEngine().getConfiguration();
+    if (!config.isDcpBackfillSharedScans()) {
+        return;
+    }
+
+    auto& registry = bucket.getEPEngine().getDcpConnMap().getSharedBackfills();
+
+    const auto vbid = stream->getVBucket();
+    for (auto& scan : registry.find(vbid, valFilter)) {
+        auto sub = scan->subscribe(
+                stream, startSeqno, ctx.maxSeqno, ctx.purgeSeqno);
+        if (!sub) {
+            continue;
+        }
+        subscribedEndSeqno = ctx.maxSeqno;
+        if (sub->headEnd < startSeqno) {
+            headScanned = true;
+        } else {
+            // Read what the leader has already moved past ourselves
+            ctx.maxSeqno = sub->headEnd;
+        }
+        subscribedScan = std::move(scan);
+        subscription = std::move(sub);
+        stream->log(spdlog::level::level_enum::info,
+                    "({}) Backfill subscribed to a shared scan, reading up to "
+                    "seqno {} itself",
+                    vbid,
+                    subscription->headEnd);
+        return;
+    }
+
+    sharedScan = std::make_shared<SharedBackfillScan>(
+            registry,
+            stream,
+            vbid,
+            valFilter,
+            startSeqno,
+            ctx.maxSeqno,
+            ctx.purgeSeqno,
+            config.getDcpScanByteLimit(),
+            std::max(size_t(1), config.getDcpScanItemLimit()));
+    ctx.callback = std::make_unique<SharedDiskCallback>(
+            sharedScan, std::move(ctx.callback));
+    ctx.lookup = std::make_unique<SharedCacheCallback>(sharedScan,
+                                                       std::move(ctx.lookup));
+    registry.add(sharedScan);
+}
+
+backfill_status_t DCPBackfillBySeqnoDisk::scanSubscribed(ActiveStream& stream,
+                                                         KVStore& kvstore) {
+    auto& ctx = static_cast<BySeqnoScanContext&>(*scanCtx);
+    if (!headScanned) {
+        const auto error = kvstore.scan(ctx);
+        if (error == scan_again) {
+            return backfill_success;
+        }
+        if (error == scan_failed) {
+            stream.log(spdlog::level::level_enum::warn,
+                       "DCPBackfillBySeqnoDisk::scanSubscribed(): ({}) scan "
+                       "failed",
+                       getVBucketId());
+            releaseSharedScan(false);
+            stream.setDead(cb::mcbp::DcpStreamEndStatus::BackfillFail);
+            transitionState(backfill_state_done);
+            return backfill_finished;
+        }
+        headScanned = true;
+    }
+
+    std::unique_lock<std::mutex> lh(subscription->mutex);
+    auto& items = subscription->items;
+    while (!items.empty()) {
+        // backfillReceived consumes the Item even if it rejects it, so pass
+        // a copy (sharing the value) and pop on success.
+        if (!stream.backfillReceived(std::make_unique<Item>(*items.front()),
+                                     BACKFILL_FROM_DISK)) {
+            return backfill_success;
+        }
+        subscription->bytes -= items.front()->size();
+        items.pop_front();
+    }
+
+    const auto lastSeqno = subscription->lastSeqno;
+    if (subscription->complete) {
+        lh.unlock();
+        releaseSharedScan(true);
+        stream.setBackfillScanLastRead(lastSeqno);
+        transitionState(backfill_state_completing);
+        return backfill_success;
+    }
+
+    if (subscription->detached) {
+        lh.unlock();
+        releaseSharedScan(false);
+        stream.log(spdlog::level::level_enum::info,
+                   "({}) Backfill detached from the shared scan, scanning "
+                   "from seqno {}",
+                   getVBucketId(),
+                   lastSeqno + 1);
+        // The next scan() continues after what we have received
+        ctx.lastReadSeqno = lastSeqno;
+        ctx.maxSeqno = subscribedEndSeqno;
+        return backfill_success;
+    }
+
+    // Waiting for the leader to read more
+    return backfill_success;
+}
+
+void DCPBackfillBySeqnoDisk::releaseSharedScan(bool complete) {
+    if (sharedScan) {
+        bucket.getEPEngine().getDcpConnMap().getSharedBackfills().remove(
+                *sharedScan);
+        sharedScan->finish(complete);
+        sharedScan.reset();
+    }
+    if (subscription) {
+        subscribedScan->unsubscribe(*subscription);
+        subscription.reset();
+        subscribedScan.reset();
+    }
+}
@@ -19,14 +19,20 @@
 
 #include "dcp/backfill_by_seqno.h"
 #include "dcp/backfill_disk.h"
+#include "dcp/shared_backfill_scan.h"
+#include <memory>
 #include <optional>
+#include <vector>
 
 namespace Collections::VB {
 class Filter;
 }
+class BackfillScanLane;
 class BySeqnoScanContext;
 class KVBucket;
 class KVStore;
+enum class SnapshotSource;
+enum class ValueFilter;
 
 /**
  * Concrete class that does backfill from the disk and informs the DCP stream
@@ -34,6 +40,19 @@ class KVStore;
  * This class calls asynchronous kvstore apis and manages a state machine to
  * read items in the sequential order from the disk and to call the DCP stream
  * for disk snapshot, backfill items and backfill completion.
+ *
+ * If dcp_backfill_scan_parallelism is greater than one, the seqno range is
+ * split into chunks of dcp_scan_item_limit seqnos which are striped across a
+ * number of scan "lanes". Each lane has its own scan context (of the same
+ * disk snapshot) and AuxIO task, and reads its next chunk into a buffer
+ * bounded like the BackfillManager's scan buffer. The backfill itself drains
+ * the chunks into the stream in seqno order, scanning a chunk inline if it
+ * catches up with the lane reading it.
+ *
+ * Otherwise, if dcp_backfill_shared_scans is enabled, a backfill of the head
+ * snapshot subscribes to a SharedBackfillScan of the same vBucket and
+ * snapshot if there is one running, or starts one which the backfills
+ * created while it runs can subscribe to.
  */
 class DCPBackfillBySeqnoDisk : public DCPBackfillDisk,
                                public DCPBackfillBySeqno {
@@ -43,6 +62,8 @@ public:
                            uint64_t startSeqno,
                            uint64_t endSeqno);
 
+    ~DCPBackfillBySeqnoDisk() override;
+
     // explicitly state how we want run to be called as it technically exists
     // from both parent classes
     backfill_status_t run() override {
@@ -79,6 +100,47 @@ private:
      */
     void complete(bool cancelled) override;
 
+    /**
+     * Create the scan lanes (and their tasks) for a parallel scan of
+     * [startSeqno, primary.maxSeqno], if configured and the range is large
+     * enough. Lanes are only created if all of their scan contexts are of
+     * the same snapshot as primary, otherwise the scan is sequential.
+     */
+    void createScanLanes(std::shared_ptr<ActiveStream> stream,
+                         KVStore& kvstore,
+                         const BySeqnoScanContext& primary,
+                         ValueFilter valFilter,
+                         SnapshotSource source);
+
+    /**
+     * Send the chunks read by the scan lanes to the stream, in order.
+     * @return backfill_success if the backfill should be run again to
+     *         continue (or complete).
+     */
+    backfill_status_t scanLanes(ActiveStream& stream, KVStore& kvstore);
+
+    /// Stop all scan lane tasks and release the lanes.
+    void cancelScanLanes();
+
+    /**
+     * Subscribe to a running SharedBackfillScan of the snapshot of ctx, or
+     * start one with ctx if there is none to subscribe to.
+     */
+    void shareScan(std::shared_ptr<ActiveStream> stream,
+                   BySeqnoScanContext& ctx,
+                   ValueFilter valFilter);
+
+    /**
+     * Scan what the leader had moved past when we subscribed, then send the
+     * items the leader offered to the stream.
+     * @return backfill_success if the backfill should be run again to
+     *         continue (or complete).
+     */
+    backfill_status_t scanSubscribed(ActiveStream& stream, KVStore& kvstore);
+
+    /// We no longer lead or subscribe to a SharedBackfillScan
+    void releaseSharedScan(bool complete);
+
     /**
      * Method to get hold of the highest high seqno of collections that are in
      * a streams filter.
@@ -94,4 +156,32 @@ private:
             const BySeqnoScanContext& seqnoScanCtx,
             KVStore& kvStore,
             const Collections::VB::Filter& filter) const;
+
+    /// Scan lanes of a parallel scan; empty if the scan is sequential.
+    std::vector<std::shared_ptr<BackfillScanLane>> lanes;
+
+    /// Number of seqnos in each chunk of a parallel scan.
+    uint64_t chunkSize = 0;
+
+    /// The next chunk (in seqno order) to be sent to the stream.
+    uint64_t nextChunk = 0;
+
+    /// Total number of chunks in a parallel scan.
+    uint64_t numChunks = 0;
+
+    /// The last seqno of the snapshot being scanned in parallel.
+    uint64_t scanEndSeqno = 0;
+
+    /// The shared scan we lead, if any.
+    std::shared_ptr<SharedBackfillScan> sharedScan;
+
+    /// The shared scan we subscribe to (and our subscription), if any.
+    std::shared_ptr<SharedBackfillScan> subscribedScan;
+    std::shared_ptr<SharedBackfillScan::Subscriber> subscription;
+
+    /// The last seqno of the snapshot of the shared scan subscribed to.
+    uint64_t subscribedEndSeqno = 0;
+
+    /// We have read what the leader had moved past when we subscribed.
+    bool headScanned = false;
 };
@@ -170,6 +170,12 @@ backfill_status_t DCPBackfillMemoryBuffered::create() {
             endSeqno =
                     std::min(endSeqno, static_cast<uint64_t>(rangeItr.back()));
 
+            /* Items after the snapshot end will never be read by this
+               backfill; release them from the range lock now so front end
+               updates to them de-duplicate in place rather than leaving
+               stale items in the seqList until the backfill completes */
+            rangeItr.truncate(static_cast<seqno_t>(endSeqno));
+
             /* Mark disk snapshot */
             bool markerSent =
                     stream->markDiskSnapshot(startSeqno,
@@ -317,8 +323,6 @@ void DCPBackfillMemoryBuffered::complete(bool cancelled) {
         return;
     }
 
-    /* [EPHE TODO]: invalidate cursor sooner before it gets deleted */
-
     stream->completeBackfill();
 
     auto severity = cancelled ? spdlog::level::level_enum::info
@@ -365,6 +369,13 @@ void DCPBackfillMemoryBuffered::transitionState(BackfillState newState) {
     }
 
     state = newState;
+
+    if (state == BackfillState::Done) {
+        /* Release the range iterator (and its range lock on the seqList) now,
+           rather than when the backfill object is eventually destroyed, so
+           any items which went stale during the backfill can be purged */
+        rangeItr = SequenceList::RangeIterator(nullptr);
+    }
 }
 
 std::string DCPBackfillMemoryBuffered::backfillStateToString(
@@ -35,11 +35,14 @@
 #include <phosphor/phosphor.h>
 #include <xattr/utils.h>
 
+#include <algorithm>
 #include <utility>
 
 const std::string DcpConsumer::noopCtrlMsg = "enable_noop";
 const std::string DcpConsumer::noopIntervalCtrlMsg = "set_noop_interval";
 const std::string DcpConsumer::connBufferCtrlMsg = "connection_buffer_size";
+const std::string DcpConsumer::connBufferMinCtrlMsg =
+        "connection_buffer_size_min";
 const std::string DcpConsumer::priorityCtrlMsg = "set_priority";
 const std::string DcpConsumer::extMetadataCtrlMsg = "enable_ext_metadata";
 const std::string DcpConsumer::forceCompressionCtrlMsg = "force_value_compression";
@@ -49,6 +52,7 @@ const std::string DcpConsumer::cursorDroppingCtrlMsg =
 const std::string DcpConsumer::sendStreamEndOnClientStreamCloseCtrlMsg =
         "send_stream_end_on_client_close_stream";
 const std::string DcpConsumer::hifiMFUCtrlMsg = "supports_hifi_MFU";
+const std::string DcpConsumer::frameCompressionCtrlMsg = "frame_compression";
 const std::string DcpConsumer::enableOpcodeExpiryCtrlMsg =
         "enable_expiry_opcode";
 
@@ -56,6 +60,7 @@ class DcpConsumerTask : public GlobalTask {
 public:
     DcpConsumerTask(EventuallyPersistentEngine* e,
                     std::shared_ptr<DcpConsumer> c,
+                    size_t lane,
                     double sleeptime = 1,
                     bool completeBeforeShutdown = true)
         : GlobalTask(e,
@@ -63,8 +68,12 @@ public:
                      sleeptime,
                      completeBeforeShutdown),
           consumerPtr(c),
+          lane(lane),
           description("DcpConsumerTask, processing buffered items for " +
-                      c->getName()) {
+                      c->getName() +
+                      (c->getNumProcessorLanes() > 1
+                               ? " lane " + std::to_string(lane)
+                               : "")) {
     }
 
     ~DcpConsumerTask() override {
@@ -86,7 +95,7 @@ public:
         }
 
         double sleepFor = 0.0;
-        enum process_items_error_t state = consumer->processBufferedItems();
+        enum process_items_error_t state = consumer->processBufferedItems(lane);
         switch (state) {
             case all_processed:
                 sleepFor = INT_MAX;
@@ -104,30 +113,30 @@ public:
         // Check if we've been notified of more work to do - if not then sleep;
         // if so then wakeup and re-run the task.
         // Note: The order of the wakeUp / snooze here is *critical* - another
-        // thread may concurrently notify us (set processorNotification=true)
+        // thread may concurrently notify us (set the lane notification=true)
         // while we are performing the checks, so we need to ensure we don't
         // loose a wakeup as that would result in this Task sleeping forever
         // (and DCP hanging).
         // To prevent this, we perform an initial check of notifiedProcessor(),
         // which if false we initially sleep, and then check a second time.
-        // We could race if the other actor sets processorNotification=true
+        // We could race if the other actor sets the lane notification=true
         // between the second `if(consumer->notifiedProcessor)` and us calling
         // `wakeUp()`; but that's essentially a benign race as it will just
         // result in wakeUp() being called twice which is benign.
-        if (consumer->notifiedProcessor(false)) {
+        if (consumer->notifiedProcessor(false, lane)) {
             wakeUp();
             state = more_to_process;
         } else {
             snooze(sleepFor);
             // Check if the processor was notified again,
             // in which case the task should wake immediately.
-            if (consumer->notifiedProcessor(false)) {
+            if (consumer->notifiedProcessor(false, lane)) {
                 wakeUp();
                 state = more_to_process;
             }
         }
 
-        consumer->setProcessorTaskState(state);
+        consumer->setProcessorTaskState(state, lane);
 
         return true;
     }
@@ -143,9 +152,11 @@ public:
     }
 
 private:
-    /* we have one task per consumer. the task only needs a reference to the
-       consumer object and does not own it. Hence std::weak_ptr should be used*/
+    /* we have one task per consumer processor lane. the task only needs a
+       reference to the consumer object and does not own it. Hence
+       std::weak_ptr should be used*/
     const std::weak_ptr<DcpConsumer> consumerPtr;
+    const size_t lane;
     const std::string description;
 };
 
@@ -157,9 +168,6 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine& engine,
       lastMessageTime(ep_current_time()),
       engine(engine),
       opaqueCounter(0),
-      processorTaskId(0),
-      processorTaskState(all_processed),
-      processorNotification(false),
       backoffs(0),
       dcpNoopTxInterval(engine.getConfiguration().getDcpNoopTxInterval()),
       pendingSendStreamEndOnClientStreamClose(true),
@@ -174,6 +182,13 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine& engine,
               engine.getConfiguration()
                       .getDcpConsumerProcessBufferedMessagesBatchSize()) {
     Configuration& config = engine.getConfiguration();
+    const auto lanes = std::max(
+            size_t(1),
+            config.getDcpConsumerProcessBufferedMessagesParallelism());
+    for (size_t ii = 0; ii < lanes; ++ii) {
+        processorLanes.push_back(
+                std::make_unique<ProcessorLane>(config.getMaxVbuckets()));
+    }
     setSupportAck(false);
     setLogHeader("DCP (Consumer) " + getName() + " -");
     setReserved(true);
@@ -187,6 +202,8 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine& engine,
     pendingSupportCursorDropping = true;
     pendingSupportHifiMFU = true;
     pendingEnableExpiryOpcode = true;
+    pendingEnableFrameCompression =
+            config.getDcpConsumerFrameCompression() != "none";
 
     // If a consumer_name was provided then tell the producer about it. Having
     // a consumer name determines if we should support SyncReplication. If we
@@ -214,7 +231,9 @@ DcpConsumer::~DcpConsumer() {
 void DcpConsumer::cancelTask() {
     bool exp = true;
     if (processorTaskRunning.compare_exchange_strong(exp, false)) {
-        ExecutorPool::get()->cancel(processorTaskId);
+        for (const auto& lane : processorLanes) {
+            ExecutorPool::get()->cancel(lane->taskId);
+        }
     }
 }
 
@@ -305,13 +324,15 @@ ENGINE_ERROR_CODE DcpConsumer::addStream(uint32_t opaque,
         }
     }
 
-    /* We need 'Processor' task only when we have a stream. Hence create it
-     only once when the first stream is added */
+    /* We need 'Processor' tasks only when we have a stream. Hence create
+     them only once when the first stream is added */
     bool exp = false;
     if (processorTaskRunning.compare_exchange_strong(exp, true)) {
-        ExTask task = std::make_shared<DcpConsumerTask>(
-                &engine, shared_from_this(), 1);
-        processorTaskId = ExecutorPool::get()->schedule(task);
+        for (size_t ii = 0; ii < processorLanes.size(); ++ii) {
+            ExTask task = std::make_shared<DcpConsumerTask>(
+                    &engine, shared_from_this(), ii, 1);
+            processorLanes[ii]->taskId = ExecutorPool::get()->schedule(task);
+        }
     }
 
     stream = makePassiveStream(engine_,
@@ -478,6 +499,7 @@ ENGINE_ERROR_CODE DcpConsumer::mutation(uint32_t opaque,
                                         uint32_t lock_time,
                                         cb::const_byte_buffer meta,
                                         uint8_t nru) {
+    HdrMicroSecBlockTimer timer(&mutationProcessingHisto);
     lastMessageTime = ep_current_time();
 
     if (bySeqno == 0) {
@@ -485,6 +507,9 @@ ENGINE_ERROR_CODE DcpConsumer::mutation(uint32_t opaque,
         return ENGINE_EINVAL;
     }
 
+    // The value is copied (once) straight from the packet into the Item's
+    // Blob. The packet is in the connection's read buffer, which is reused
+    // once this returns, so can't be adopted.
     queued_item item(new Item(key,
                               flags,
                               exptime,
@@ -861,6 +886,10 @@ ENGINE_ERROR_CODE DcpConsumer::step(struct dcp_message_producers* producers) {
         return ret;
     }
 
+    if ((ret = enableFrameCompression(producers)) != ENGINE_FAILED) {
+        return ret;
+    }
+
     if ((ret = sendStreamEndOnClientStreamClose(producers)) != ENGINE_FAILED) {
         return ret;
     }
@@ -1145,14 +1174,27 @@ void DcpConsumer::addStats(const AddStatFn& add_stat, const void* c) {
     }
 
     addStat("total_backoffs", backoffs, add_stat, c);
-    addStat("processor_task_state", getProcessorTaskStatusStr(), add_stat, c);
+    addStat("mutation_processing_time", mutationProcessingHisto, add_stat, c);
     flowControl.addStats(add_stat, c);
 
-    vbReady.addStats(getName() + ":dcp_buffered_ready_queue_", add_stat, c);
-    addStat("processor_notification",
-            processorNotification.load(),
-            add_stat,
-            c);
+    // The first lane reports under the original (un-suffixed) stat names.
+    addStat("processor_lanes", processorLanes.size(), add_stat, c);
+    for (size_t ii = 0; ii < processorLanes.size(); ++ii) {
+        const auto suffix = ii == 0 ? std::string{} : "_" + std::to_string(ii);
+        const auto& lane = *processorLanes[ii];
+        addStat("processor_task_state" + suffix,
+                getProcessorTaskStatusStr(ii),
+                add_stat,
+                c);
+        lane.vbReady.addStats(
+                getName() + ":dcp_buffered_ready_queue" + suffix + "_",
+                add_stat,
+                c);
+        addStat("processor_notification" + suffix,
+                lane.notification.load(),
+                add_stat,
+                c);
+    }
 
     addStat("synchronous_replication", isSyncReplicationEnabled(), add_stat, c);
 }
@@ -1166,6 +1208,7 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
     process_items_error_t rval = all_processed;
     uint32_t bytesProcessed = 0;
     size_t iterations = 0;
+    auto& vbReady = getProcessorLane(stream->getVBucket()).vbReady;
     do {
         switch (engine_.getReplicationThrottle().getStatus()) {
         case ReplicationThrottle::Status::Pause:
@@ -1213,9 +1256,10 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
     return rval;
 }
 
-process_items_error_t DcpConsumer::processBufferedItems() {
+process_items_error_t DcpConsumer::processBufferedItems(size_t lane) {
     process_items_error_t process_ret = all_processed;
     Vbid vbucket = Vbid(0);
+    auto& vbReady = processorLanes.at(lane)->vbReady;
     while (vbReady.popFront(vbucket)) {
         auto stream = findStream(vbucket);
 
@@ -1249,23 +1293,26 @@ process_items_error_t DcpConsumer::processBufferedItems() {
 }
 
 void DcpConsumer::notifyVbucketReady(Vbid vbucket) {
-    if (vbReady.pushUnique(vbucket) &&
-        notifiedProcessor(true)) {
-        ExecutorPool::get()->wake(processorTaskId);
+    const auto lane = vbucket.get() % processorLanes.size();
+    if (processorLanes[lane]->vbReady.pushUnique(vbucket) &&
+        notifiedProcessor(true, lane)) {
+        ExecutorPool::get()->wake(processorLanes[lane]->taskId);
     }
 }
 
-bool DcpConsumer::notifiedProcessor(bool to) {
+bool DcpConsumer::notifiedProcessor(bool to, size_t lane) {
     bool inverse = !to;
-    return processorNotification.compare_exchange_strong(inverse, to);
+    return processorLanes.at(lane)->notification.compare_exchange_strong(
+            inverse, to);
 }
 
-void DcpConsumer::setProcessorTaskState(enum process_items_error_t to) {
-    processorTaskState = to;
+void DcpConsumer::setProcessorTaskState(enum process_items_error_t to,
+                                        size_t lane) {
+    processorLanes.at(lane)->taskState = to;
 }
 
-std::string DcpConsumer::getProcessorTaskStatusStr() const {
-    switch (processorTaskState.load()) {
+std::string DcpConsumer::getProcessorTaskStatusStr(size_t lane) const {
+    switch (processorLanes.at(lane)->taskState.load()) {
         case all_processed:
             return "ALL_PROCESSED";
         case more_to_process:
@@ -1533,6 +1580,24 @@ ENGINE_ERROR_CODE DcpConsumer::supportHifiMFU(
     return ENGINE_FAILED;
 }
 
+ENGINE_ERROR_CODE DcpConsumer::enableFrameCompression(
+        struct dcp_message_producers* producers) {
+    /* The producer compresses batches of messages, which the core inflates
+       before they reach us. A producer which doesn't support it responds
+       with EINVAL, and we simply receive uncompressed messages. */
+    if (pendingEnableFrameCompression) {
+        uint32_t opaque = ++opaqueCounter;
+        ENGINE_ERROR_CODE ret = producers->control(
+                opaque,
+                frameCompressionCtrlMsg,
+                engine_.getConfiguration().getDcpConsumerFrameCompression());
+        pendingEnableFrameCompression = false;
+        return ret;
+    }
+
+    return ENGINE_FAILED;
+}
+
 ENGINE_ERROR_CODE DcpConsumer::sendStreamEndOnClientStreamClose(
         struct dcp_message_producers* producers) {
     /* Sending this ctrl message tells the DCP producer that the consumer is
@@ -1637,6 +1702,10 @@ const std::string& DcpConsumer::getControlMsgKey()
     return connBufferCtrlMsg;
 }
 
+const std::string& DcpConsumer::getMinBufferControlMsgKey() {
+    return connBufferMinCtrlMsg;
+}
+
 bool DcpConsumer::isStreamPresent(Vbid vbucket) {
     auto stream = findStream(vbucket);
     return stream && stream->isActive();
@@ -1850,7 +1919,7 @@ void DcpConsumer::registerStream(std::shared_ptr<PassiveStream> stream) {
 
     Expects(!connMap.vbConnectionExists(this, vbid));
 
-    connMap.addVBConnByVBId(*this, vbid);
+    connMap.addVBConnByVBId(shared_from_this(), vbid);
 }
 
 std::shared_ptr<PassiveStream> DcpConsumer::removeStream(Vbid vbid) {
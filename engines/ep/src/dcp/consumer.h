@@ -28,9 +28,12 @@
 #include <memcached/dcp_stream_id.h>
 
 #include <relaxed_atomic.h>
+#include <utilities/hdrhistogram.h>
 
 #include <list>
 #include <map>
+#include <memory>
+#include <vector>
 #include <engines/ep/src/collections/collections_types.h>
 
 class DcpResponse;
@@ -259,6 +262,15 @@ public:
 
     void addStats(const AddStatFn& add_stat, const void* c) override;
 
+    /**
+     * @return the histogram of the time the front-end thread took to process
+     *         each mutation received (from building its Item to queueing it
+     *         in the vBucket, or buffering it)
+     */
+    const Hdr1sfMicroSecHistogram& getMutationProcessingHisto() const {
+        return mutationProcessingHisto;
+    }
+
     void aggregateQueueStats(ConnCounter& aggregator) const override;
 
     void notifyStreamReady(Vbid vbucket);
@@ -267,7 +279,17 @@ public:
 
     void closeStreamDueToVbStateChange(Vbid vbucket, vbucket_state_t state);
 
-    process_items_error_t processBufferedItems();
+    /**
+     * Process the buffered messages of the vBuckets queued on one of the
+     * consumer's processor lanes.
+     * @param lane index of the lane (and so DcpConsumerTask) to run.
+     */
+    process_items_error_t processBufferedItems(size_t lane = 0);
+
+    /// @return the number of processor lanes (DcpConsumerTasks) in use.
+    size_t getNumProcessorLanes() const {
+        return processorLanes.size();
+    }
 
     uint64_t incrOpaqueCounter();
 
@@ -277,17 +299,19 @@ public:
 
     static const std::string& getControlMsgKey();
 
+    static const std::string& getMinBufferControlMsgKey();
+
     bool isStreamPresent(Vbid vbucket);
 
     void cancelTask();
 
     void taskCancelled();
 
-    bool notifiedProcessor(bool to);
+    bool notifiedProcessor(bool to, size_t lane = 0);
 
-    void setProcessorTaskState(enum process_items_error_t to);
+    void setProcessorTaskState(enum process_items_error_t to, size_t lane = 0);
 
-    std::string getProcessorTaskStatusStr() const;
+    std::string getProcessorTaskStatusStr(size_t lane = 0) const;
 
     /**
      * Check if the enough bytes have been removed from the flow control
@@ -380,6 +404,9 @@ protected:
 
     ENGINE_ERROR_CODE supportHifiMFU(struct dcp_message_producers* producers);
 
+    ENGINE_ERROR_CODE enableFrameCompression(
+            struct dcp_message_producers* producers);
+
     ENGINE_ERROR_CODE sendStreamEndOnClientStreamClose(
             struct dcp_message_producers* producers);
 
@@ -546,11 +573,29 @@ protected:
     /* Reference to the ep engine; need to create the 'Processor' task */
     EventuallyPersistentEngine& engine;
     uint64_t opaqueCounter;
-    size_t processorTaskId;
-    std::atomic<enum process_items_error_t> processorTaskState;
 
-    VBReadyQueue vbReady;
-    std::atomic<bool> processorNotification;
+    /**
+     * Buffered messages are processed by one DcpConsumerTask per lane. Each
+     * vBucket is always assigned to the same lane (vbid % lanes), so the
+     * messages of a vBucket are applied in order by a single task while
+     * different vBuckets may be applied concurrently on different NonIO
+     * threads.
+     */
+    struct ProcessorLane {
+        explicit ProcessorLane(size_t maxVBuckets) : vbReady(maxVBuckets) {
+        }
+
+        size_t taskId{0};
+        std::atomic<enum process_items_error_t> taskState{all_processed};
+        VBReadyQueue vbReady;
+        std::atomic<bool> notification{false};
+    };
+
+    ProcessorLane& getProcessorLane(Vbid vbucket) {
+        return *processorLanes[vbucket.get() % processorLanes.size()];
+    }
+
+    std::vector<std::unique_ptr<ProcessorLane>> processorLanes;
 
     std::mutex readyMutex;
     std::list<Vbid> ready;
@@ -567,6 +612,10 @@ protected:
     opaque_map opaqueMap_;
 
     cb::RelaxedAtomic<uint32_t> backoffs;
+
+    // The time spent processing each mutation, see getMutationProcessingHisto
+    Hdr1sfMicroSecHistogram mutationProcessingHisto;
+
     // The interval that the consumer tells the producer to send noops
     const std::chrono::seconds dcpNoopTxInterval;
 
@@ -581,6 +630,7 @@ protected:
     bool pendingSendStreamEndOnClientStreamClose;
     bool pendingSupportHifiMFU;
     bool pendingEnableExpiryOpcode;
+    bool pendingEnableFrameCompression;
 
     // Maintains the state of the Sync Replication negotiation
     BlockingDcpControlNegotiation syncReplNegotiation;
@@ -618,7 +668,7 @@ protected:
      */
     BlockingDcpControlNegotiation deletedUserXattrsNegotiation;
 
-    /* Indicates if the 'Processor' task is running */
+    /* Indicates if the 'Processor' tasks are running */
     std::atomic<bool> processorTaskRunning;
 
     FlowControl flowControl;
@@ -640,12 +690,14 @@ protected:
     static const std::string noopCtrlMsg;
     static const std::string noopIntervalCtrlMsg;
     static const std::string connBufferCtrlMsg;
+    static const std::string connBufferMinCtrlMsg;
     static const std::string priorityCtrlMsg;
     static const std::string extMetadataCtrlMsg;
     static const std::string forceCompressionCtrlMsg;
     static const std::string cursorDroppingCtrlMsg;
     static const std::string sendStreamEndOnClientStreamCloseCtrlMsg;
     static const std::string hifiMFUCtrlMsg;
+    static const std::string frameCompressionCtrlMsg;
     static const std::string enableOpcodeExpiryCtrlMsg;
 };
 
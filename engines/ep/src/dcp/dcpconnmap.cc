@@ -22,7 +22,9 @@
 #include "conn_notifier.h"
 #include "conn_store.h"
 #include "dcp/consumer.h"
+#include "dcp/item_encoding_cache.h"
 #include "dcp/producer.h"
+#include "dcp/shared_backfill_scan.h"
 #include "ep_engine.h"
 #include "statistics/collector.h"
 #include <daemon/tracing.h>
@@ -54,6 +56,15 @@ DcpConnMap::DcpConnMap(EventuallyPersistentEngine &e)
     minCompressionRatioForProducer.store(
                     engine.getConfiguration().getDcpMinCompressionRatio());
 
+    const auto encodingCacheSize =
+            engine.getConfiguration().getDcpEncodingCacheSize();
+    if (encodingCacheSize) {
+        itemEncodingCache =
+                std::make_unique<DcpItemEncodingCache>(encodingCacheSize);
+    }
+
+    sharedBackfills = std::make_unique<DcpSharedBackfills>();
+
     // Note: these allocations are deleted by ~Configuration
     engine.getConfiguration().addValueChangedListener(
             "dcp_consumer_process_buffered_messages_yield_limit",
@@ -226,6 +237,12 @@ void DcpConnMap::shutdownAllConnections() {
 
     closeStreams(mapCopy);
     cancelTasks(mapCopy);
+
+    // Release the Items referenced by the encoding cache now rather than
+    // at destruction, as they may outlive their checkpoints.
+    if (itemEncodingCache) {
+        itemEncodingCache->clear();
+    }
 }
 
 void DcpConnMap::vbucketStateChanged(
@@ -260,8 +277,8 @@ void DcpConnMap::closeStreamsDueToRollback(Vbid vbucket) {
 bool DcpConnMap::handleSlowStream(Vbid vbid, const CheckpointCursor* cursor) {
     bool ret = false;
     auto handle = connStore->getConnsForVBHandle(vbid);
-    for (auto itr : handle) {
-        auto* producer = dynamic_cast<DcpProducer*>(&itr.connHandler);
+    for (const auto& itr : handle) {
+        auto* producer = dynamic_cast<DcpProducer*>(itr.connHandler.get());
         if (producer && producer->handleSlowStream(vbid, cursor)) {
             return true;
         }
@@ -430,7 +447,7 @@ void DcpConnMap::notifyVBConnections(Vbid vbid,
                                      uint64_t bySeqno,
                                      SyncWriteOperation syncWrite) {
     for (auto& vbConn : connStore->getConnsForVBHandle(vbid)) {
-        auto* producer = dynamic_cast<DcpProducer*>(&vbConn.connHandler);
+        auto* producer = dynamic_cast<DcpProducer*>(vbConn.connHandler.get());
         if (producer) {
             producer->notifySeqnoAvailable(vbid, bySeqno, syncWrite);
         }
@@ -444,7 +461,7 @@ void DcpConnMap::seqnoAckVBPassiveStream(Vbid vbid, int64_t seqno) {
     // ConnHandlers for the Consumer with the alive PassiveStream for this
     // vBucket.
     for (auto& vbConn : connStore->getConnsForVBHandle(vbid)) {
-        auto* consumer = dynamic_cast<DcpConsumer*>(&vbConn.connHandler);
+        auto* consumer = dynamic_cast<DcpConsumer*>(vbConn.connHandler.get());
         if (consumer) {
             // Note: Sync Repl enabled at Consumer only if Producer supports it.
             //     This is to prevent that 6.5 Consumers send DCP_SEQNO_ACK to
@@ -511,6 +528,10 @@ void DcpConnMap::addStats(const AddStatFn& add_stat, const void* c) {
     LockHolder lh(connsLock);
     add_casted_stat("ep_dcp_dead_conn_count", deadConnections.size(), add_stat,
                     c);
+    if (itemEncodingCache) {
+        itemEncodingCache->addStats(add_stat, c);
+    }
+    sharedBackfills->addStats(add_stat, c);
 }
 
 void DcpConnMap::updateMinCompressionRatioForProducers(float value) {
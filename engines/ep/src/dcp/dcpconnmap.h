@@ -26,11 +26,14 @@
 #include <folly/SharedMutex.h>
 #include <atomic>
 #include <list>
+#include <memory>
 #include <string>
 
 class CheckpointCursor;
 class DcpProducer;
 class DcpConsumer;
+class DcpItemEncodingCache;
+class DcpSharedBackfills;
 
 class DcpConnMap : public ConnMap, public BackfillTrackingIface {
 public:
@@ -152,6 +155,20 @@ public:
 
     float getMinCompressionRatio();
 
+    /**
+     * @return the cache of encoded checkpoint items shared by all
+     *         ActiveStreams, or nullptr if dcp_encoding_cache_size is 0.
+     */
+    DcpItemEncodingCache* getItemEncodingCache() {
+        return itemEncodingCache.get();
+    }
+
+    /// @return the disk backfill scans of the bucket which other backfills
+    ///         may share (if dcp_backfill_shared_scans is enabled)
+    DcpSharedBackfills& getSharedBackfills() {
+        return *sharedBackfills;
+    }
+
     std::shared_ptr<ConnHandler> findByName(const std::string& name);
 
     bool isConnections() override;
@@ -235,6 +252,10 @@ protected:
 
     std::atomic<float> minCompressionRatioForProducer;
 
+    std::unique_ptr<DcpItemEncodingCache> itemEncodingCache;
+
+    std::unique_ptr<DcpSharedBackfills> sharedBackfills;
+
     /* Total memory used by all DCP consumer buffers */
     std::atomic<size_t> aggrDcpConsumerBufferSize;
 
@@ -39,6 +39,10 @@ bool DcpFlowControlManager::isEnabled() const
     return false;
 }
 
+size_t DcpFlowControlManager::getMinBufferSize() const {
+    return 0;
+}
+
 void DcpFlowControlManager::setBufSizeWithinBounds(DcpConsumer *consumerConn,
                                                    size_t &bufSize)
 {
@@ -223,3 +227,58 @@ void DcpFlowControlManagerAggressive::resizeBuffers_UNLOCKED(size_t bufferSize)
         iter.second->setFlowControlBufSize(bufferSize);
     }
 }
+
+DcpFlowControlManagerAdaptive::DcpFlowControlManagerAdaptive(
+        EventuallyPersistentEngine& engine)
+    : DcpFlowControlManager(engine), aggrDcpConsumerBufferSize(0) {
+}
+
+DcpFlowControlManagerAdaptive::~DcpFlowControlManagerAdaptive() = default;
+
+size_t DcpFlowControlManagerAdaptive::newConsumerConn(
+        DcpConsumer* consumerConn) {
+    if (consumerConn == nullptr) {
+        throw std::invalid_argument(
+                "DcpFlowControlManagerAdaptive::newConsumerConn: resp is NULL");
+    }
+    Configuration& config = engine_.getConfiguration();
+    size_t bufferSize = config.getDcpConnBufferSizeMax();
+
+    /* If aggr memory for flow control buffers across all consumers would
+       exceed the threshold, give this connection the minimum (which leaves
+       no room for adapting) */
+    double dcpConnBufferSizeThreshold =
+            static_cast<double>(config.getDcpConnBufferSizeAggrMemThreshold()) /
+            100;
+    if ((aggrDcpConsumerBufferSize + bufferSize) >
+        dcpConnBufferSizeThreshold * engine_.getEpStats().getMaxDataSize()) {
+        bufferSize = config.getDcpConnBufferSize();
+        EP_LOG_DEBUG(
+                "{} Conn flow control buffer is set to minimum, as aggr "
+                "memory used for flow control buffers across all consumers "
+                "is {} and is above the threshold ({}) * ({})",
+                consumerConn->logHeader(),
+                aggrDcpConsumerBufferSize.load(std::memory_order_relaxed),
+                dcpConnBufferSizeThreshold,
+                engine_.getEpStats().getMaxDataSize());
+    }
+    aggrDcpConsumerBufferSize += bufferSize;
+    EP_LOG_DEBUG("{} Conn flow control buffer is {} (min {})",
+                 consumerConn->logHeader(),
+                 bufferSize,
+                 getMinBufferSize());
+    return bufferSize;
+}
+
+void DcpFlowControlManagerAdaptive::handleDisconnect(
+        DcpConsumer* consumerConn) {
+    aggrDcpConsumerBufferSize -= consumerConn->getFlowControlBufSize();
+}
+
+bool DcpFlowControlManagerAdaptive::isEnabled() const {
+    return true;
+}
+
+size_t DcpFlowControlManagerAdaptive::getMinBufferSize() const {
+    return engine_.getConfiguration().getDcpConnBufferSize();
+}
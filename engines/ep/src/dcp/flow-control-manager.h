@@ -51,6 +51,10 @@ public:
     /* Will indicate if flow control is enabled */
     virtual bool isEnabled() const;
 
+    /* Returns the smallest size the producer may adaptively shrink the flow
+       control buffer to; 0 if the buffer size is fixed */
+    virtual size_t getMinBufferSize() const;
+
 protected:
     void setBufSizeWithinBounds(DcpConsumer *consumerConn, size_t &bufSize);
 
@@ -131,3 +135,30 @@ private:
     /* Fraction of memQuota for all dcp consumer connection buffers */
     std::atomic<double> dcpConnBufferSizeAggrFrac;
 };
+
+/**
+ * In this policy each consumer advertises the maximum flow control buffer
+ * size (dcp_conn_buffer_size_max) along with a minimum (dcp_conn_buffer_size),
+ * and the producer sizes the window it actually uses between the two from the
+ * estimated bandwidth-delay product of the connection. Once aggr flow control
+ * buffer memory usage goes beyond a threshold (as for the dynamic policy),
+ * subsequent connections get a fixed buffer of the minimum size.
+ */
+class DcpFlowControlManagerAdaptive : public DcpFlowControlManager {
+public:
+    explicit DcpFlowControlManagerAdaptive(EventuallyPersistentEngine& engine);
+
+    ~DcpFlowControlManagerAdaptive() override;
+
+    size_t newConsumerConn(DcpConsumer* consumerConn) override;
+
+    void handleDisconnect(DcpConsumer* consumerConn) override;
+
+    bool isEnabled() const override;
+
+    size_t getMinBufferSize() const override;
+
+private:
+    /* Total memory used by all DCP consumer buffers */
+    std::atomic_size_t aggrDcpConsumerBufferSize;
+};
@@ -28,7 +28,9 @@ FlowControl::FlowControl(EventuallyPersistentEngine& engine,
     : consumerConn(consumer),
       engine_(engine),
       enabled(engine.getDcpFlowControlManager().isEnabled()),
+      minBufferSize(engine.getDcpFlowControlManager().getMinBufferSize()),
       pendingControl(true),
+      pendingMinControl(minBufferSize != 0),
       lastBufferAck(ep_current_time()),
       ackedBytes(0),
       freedBytes(0) {
@@ -59,6 +61,17 @@ ENGINE_ERROR_CODE FlowControl::handleFlowCtl(
             NonBucketAllocationGuard guard;
             ret = producers->control(opaque, controlMsgKey, buf_size);
             return ret;
+        } else if (pendingMinControl) {
+            pendingMinControl = false;
+            lh.unlock();
+            /* An older producer rejects this control and keeps the fixed
+               size window, which is harmless */
+            uint64_t opaque = consumerConn->incrOpaqueCounter();
+            NonBucketAllocationGuard guard;
+            ret = producers->control(opaque,
+                                     consumerConn->getMinBufferControlMsgKey(),
+                                     std::to_string(minBufferSize));
+            return ret;
         } else if (isBufferSufficientlyDrained_UNLOCKED(ackable_bytes)) {
             lh.unlock();
             /* Send a buffer ack when at least 20% of the buffer is drained */
@@ -112,11 +125,21 @@ bool FlowControl::isBufferSufficientlyDrained() {
 }
 
 bool FlowControl::isBufferSufficientlyDrained_UNLOCKED(uint32_t ackable_bytes) {
-    return ackable_bytes > (bufferSize * .2);
+    /* With an adaptive buffer the producer's window may be as small as the
+       minimum, so ack relative to that or the producer would stall waiting
+       for the periodic ack */
+    size_t windowSize = bufferSize;
+    if (minBufferSize != 0) {
+        windowSize = std::min(windowSize, minBufferSize);
+    }
+    return ackable_bytes > (windowSize * .2);
 }
 
 void FlowControl::addStats(const AddStatFn& add_stat, const void* c) const {
     consumerConn->addStat("total_acked_bytes", ackedBytes, add_stat, c);
     consumerConn->addStat("max_buffer_bytes", bufferSize, add_stat, c);
     consumerConn->addStat("unacked_bytes", freedBytes, add_stat, c);
+    if (minBufferSize != 0) {
+        consumerConn->addStat("min_buffer_bytes", minBufferSize, add_stat, c);
+    }
 }
\ No newline at end of file
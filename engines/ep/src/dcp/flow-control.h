@@ -71,10 +71,18 @@ private:
     /* Indicates if flow control is enabled for this connection */
     const bool enabled;
 
+    /* Smallest buffer size the producer may adaptively shrink the buffer to;
+       0 if the buffer size is fixed */
+    const size_t minBufferSize;
+
     /* Indicates whether control msg regarding flow control has been sent to
        the producer */
     bool pendingControl;
 
+    /* Indicates whether the control msg for the minimum buffer size has been
+       sent to the producer */
+    bool pendingMinControl;
+
     /* Flow control buffer size */
     cb::RelaxedAtomic<uint32_t> bufferSize;
 
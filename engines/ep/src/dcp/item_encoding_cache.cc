@@ -0,0 +1,114 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "dcp/item_encoding_cache.h"
+
+#include "item.h"
+#include "statistics/collector.h"
+
+#include <folly/hash/Hash.h>
+
+#include <stdexcept>
+
+bool DcpItemEncodingCache::Encoding::operator==(const Encoding& other) const {
+    return includeValue == other.includeValue &&
+           includeXattrs == other.includeXattrs &&
+           includeDeletedUserXattrs == other.includeDeletedUserXattrs &&
+           forceValueCompression == other.forceValueCompression &&
+           snappyEnabled == other.snappyEnabled;
+}
+
+DcpItemEncodingCache::DcpItemEncodingCache(size_t numSlots)
+    : numSlots(numSlots), slots(std::make_unique<Slot[]>(numSlots)) {
+    if (numSlots == 0) {
+        throw std::invalid_argument(
+                "DcpItemEncodingCache: numSlots must be non-zero");
+    }
+}
+
+DcpItemEncodingCache::~DcpItemEncodingCache() = default;
+
+DcpItemEncodingCache::Slot& DcpItemEncodingCache::getSlot(
+        const queued_item& source, const Encoding& encoding) {
+    // Streams with differing encodings of the same Item should not evict
+    // each other, so the encoding contributes to the slot.
+    const uint64_t encodingBits =
+            uint64_t(encoding.includeValue) |
+            (uint64_t(encoding.includeXattrs) << 2) |
+            (uint64_t(encoding.includeDeletedUserXattrs) << 3) |
+            (uint64_t(encoding.forceValueCompression) << 4) |
+            (uint64_t(encoding.snappyEnabled) << 5);
+    const auto hash = folly::hash::twang_mix64(
+            reinterpret_cast<uintptr_t>(source.get()) ^ encodingBits);
+    return slots[hash % numSlots];
+}
+
+queued_item DcpItemEncodingCache::find(const queued_item& source,
+                                       const Encoding& encoding) {
+    auto& slot = getSlot(source, encoding);
+    std::lock_guard<std::mutex> lh(slot.mutex);
+    if (slot.source.get() == source.get() && slot.encoding == encoding) {
+        hits++;
+        bytesSaved += slot.encoded->getNBytes();
+        return slot.encoded;
+    }
+    misses++;
+    return {};
+}
+
+void DcpItemEncodingCache::insert(const queued_item& source,
+                                  const Encoding& encoding,
+                                  queued_item encoded) {
+    auto& slot = getSlot(source, encoding);
+    // Swap the previous entry out so its Items are released outside of
+    // the slot lock.
+    queued_item oldSource = source;
+    {
+        std::lock_guard<std::mutex> lh(slot.mutex);
+        slot.source.swap(oldSource);
+        slot.encoding = encoding;
+        slot.encoded.swap(encoded);
+    }
+}
+
+void DcpItemEncodingCache::clear() {
+    for (size_t ii = 0; ii < numSlots; ++ii) {
+        queued_item source;
+        queued_item encoded;
+        {
+            std::lock_guard<std::mutex> lh(slots[ii].mutex);
+            slots[ii].source.swap(source);
+            slots[ii].encoded.swap(encoded);
+        }
+    }
+}
+
+void DcpItemEncodingCache::addStats(const AddStatFn& add_stat,
+                                    const void* c) const {
+    const size_t h = hits;
+    const size_t m = misses;
+    add_casted_stat("ep_dcp_encoding_cache_hits", h, add_stat, c);
+    add_casted_stat("ep_dcp_encoding_cache_misses", m, add_stat, c);
+    add_casted_stat("ep_dcp_encoding_cache_hit_ratio",
+                    (h + m) ? double(h) / double(h + m) : 0.0,
+                    add_stat,
+                    c);
+    add_casted_stat("ep_dcp_encoding_cache_bytes_saved",
+                    bytesSaved.load(),
+                    add_stat,
+                    c);
+}
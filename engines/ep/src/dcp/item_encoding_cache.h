@@ -0,0 +1,116 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "dcp/dcp-types.h"
+#include "ep_types.h"
+
+#include <memcached/engine_common.h>
+#include <relaxed_atomic.h>
+
+#include <memory>
+#include <mutex>
+
+/**
+ * A cache of the DCP-ready forms of checkpoint items, shared by all the
+ * ActiveStreams of a bucket.
+ *
+ * When a stream cannot send a checkpoint item as-is (the value must be
+ * stripped, xattrs pruned, or the value snappy compressed / decompressed to
+ * suit the consumer), ActiveStream makes a modified copy of the Item. With
+ * many consumers of a vBucket (replicas, XDCR, indexer, eventing) the same
+ * copy is made, compressed, and accounted once per stream. This cache allows
+ * the first stream to build the copy and every other stream with the same
+ * encoding requirements to share it by reference.
+ *
+ * The cache is direct mapped: each source Item maps to one slot, and a newer
+ * entry simply replaces an older one. Each entry holds a reference to its
+ * source Item, so a source cannot be freed (and its address re-used) while
+ * an entry for it exists. Items are never modified once queued into a
+ * checkpoint, so the source pointer identifies the content.
+ */
+class DcpItemEncodingCache {
+public:
+    /**
+     * The parameters which determine how a stream transforms an Item; streams
+     * may only share an encoded Item if all of these match.
+     */
+    struct Encoding {
+        IncludeValue includeValue;
+        IncludeXattrs includeXattrs;
+        IncludeDeletedUserXattrs includeDeletedUserXattrs;
+        bool forceValueCompression;
+        bool snappyEnabled;
+
+        bool operator==(const Encoding& other) const;
+    };
+
+    /// @param numSlots number of entries the cache can hold.
+    explicit DcpItemEncodingCache(size_t numSlots);
+
+    ~DcpItemEncodingCache();
+
+    /**
+     * Lookup the encoded form of source for the given encoding.
+     * @return the encoded Item, or an empty pointer on a miss.
+     */
+    queued_item find(const queued_item& source, const Encoding& encoding);
+
+    /**
+     * Record that source encodes to encoded under the given encoding,
+     * replacing whatever entry occupied the slot.
+     */
+    void insert(const queued_item& source,
+                const Encoding& encoding,
+                queued_item encoded);
+
+    /// Drop all entries (and the Item references they hold).
+    void clear();
+
+    void addStats(const AddStatFn& add_stat, const void* c) const;
+
+    size_t getHits() const {
+        return hits;
+    }
+
+    size_t getMisses() const {
+        return misses;
+    }
+
+    size_t getBytesSaved() const {
+        return bytesSaved;
+    }
+
+private:
+    struct Slot {
+        std::mutex mutex;
+        queued_item source;
+        Encoding encoding{};
+        queued_item encoded;
+    };
+
+    Slot& getSlot(const queued_item& source, const Encoding& encoding);
+
+    const size_t numSlots;
+    std::unique_ptr<Slot[]> slots;
+
+    cb::RelaxedAtomic<size_t> hits{0};
+    cb::RelaxedAtomic<size_t> misses{0};
+    /// Bytes of encoded value which did not need to be re-created (and held
+    /// separately) because a cached copy was shared.
+    cb::RelaxedAtomic<size_t> bytesSaved{0};
+};
@@ -66,7 +66,9 @@ PassiveStream::PassiveStream(EventuallyPersistentEngine* e,
       cur_snapshot_type(Snapshot::None),
       cur_snapshot_ack(false),
       cur_snapshot_prepare(false),
-      vb_manifest_uid(vb_manifest_uid) {
+      vb_manifest_uid(vb_manifest_uid),
+      earlyPrepareAck(
+              e->getConfiguration().isDurabilityReplicaEarlyAck()) {
     LockHolder lh(streamMutex);
     streamRequest_UNLOCKED(vb_uuid);
     itemsReady.store(true);
@@ -321,7 +323,13 @@ ENGINE_ERROR_CODE PassiveStream::messageReceived(
         }
     }
 
-    switch (engine->getReplicationThrottle().getStatus()) {
+    const auto throttleStatus = engine->getReplicationThrottle().getStatus();
+    if (earlyPrepareAck &&
+        throttleStatus != ReplicationThrottle::Status::Disconnect) {
+        notifyMessageReceived(*dcpResponse);
+    }
+
+    switch (throttleStatus) {
     case ReplicationThrottle::Status::Disconnect:
         log(spdlog::level::level_enum::warn,
             "{} Disconnecting the connection as there is "
@@ -715,6 +723,37 @@ ENGINE_ERROR_CODE PassiveStream::processMessage(
     return ret;
 }
 
+void PassiveStream::notifyMessageReceived(const DcpResponse& response) {
+    switch (response.getEvent()) {
+    case DcpResponse::Event::SnapshotMarker: {
+        const auto& marker = static_cast<const SnapshotMarker&>(response);
+        receivedSnapshotType = (marker.getFlags() & MARKER_FLAG_DISK)
+                                       ? Snapshot::Disk
+                                       : Snapshot::Memory;
+        return;
+    }
+    case DcpResponse::Event::Prepare: {
+        // A Disk snapshot must be fully received before any of it can be
+        // acked (the Active may have de-duplicated Prepares within it)
+        if (receivedSnapshotType != Snapshot::Memory) {
+            return;
+        }
+        VBucketPtr vb = engine->getVBucket(vb_);
+        if (!vb) {
+            return;
+        }
+        const auto& item =
+                static_cast<const MutationConsumerMessage&>(response)
+                        .getItem();
+        vb->notifyPassiveDMOfPrepareReceived(
+                item->getBySeqno(), item->getDurabilityReqs().getLevel());
+        return;
+    }
+    default:
+        return;
+    }
+}
+
 ENGINE_ERROR_CODE PassiveStream::processMutation(
         MutationConsumerMessage* mutation) {
     return processMessage(mutation, MessageType::Mutation);
@@ -211,6 +211,13 @@ protected:
 
     void handleSnapshotEnd(VBucketPtr& vb, uint64_t byseqno);
 
+    /**
+     * Notify the PassiveDM of a received (not yet processed) Prepare so that
+     * it can be acked on receive, see durability_replica_early_ack.
+     * SnapshotMarkers are tracked to only early-ack within memory snapshots.
+     */
+    void notifyMessageReceived(const DcpResponse& response);
+
     virtual void processMarker(SnapshotMarker* marker);
 
     void processSetVBucketState(SetVBucketState* state);
@@ -299,6 +306,13 @@ protected:
     // which will decide if it can stream data to us.
     const Collections::ManifestUid vb_manifest_uid;
 
+    /// Copy of the durability_replica_early_ack config param
+    const bool earlyPrepareAck;
+
+    // Type of the last snapshot received (vs processed, cur_snapshot_type).
+    // Only accessed from the front-end thread in messageReceived().
+    Snapshot receivedSnapshotType{Snapshot::None};
+
     struct Buffer {
         Buffer();
 
@@ -61,10 +61,31 @@ void DcpProducer::BufferLog::setBufferSize(size_t maxBytes) {
     if (maxBytes == 0) {
         bytesOutstanding = 0;
         ackedBytes.reset(0);
+        resetEstimates_UNLOCKED();
     }
 }
 
-bool DcpProducer::BufferLog::insert(size_t bytes) {
+void DcpProducer::BufferLog::setMinBufferSize(size_t minBytes) {
+    std::unique_lock<folly::SharedMutex> wlh(logLock);
+    this->minBytes = minBytes;
+    windowBytes = minBytes;
+}
+
+size_t DcpProducer::BufferLog::getWindowBytes() {
+    std::shared_lock<folly::SharedMutex> rhl(logLock);
+    return getWindow_UNLOCKED();
+}
+
+size_t DcpProducer::BufferLog::getWindow_UNLOCKED() const {
+    if (minBytes == 0) {
+        return maxBytes;
+    }
+    // The consumer's buffer size is the hard limit, even if it is smaller
+    // than the requested minimum.
+    return std::min(std::max(windowBytes, minBytes), maxBytes);
+}
+
+bool DcpProducer::BufferLog::insert(size_t bytes, Clock::time_point now) {
     std::unique_lock<folly::SharedMutex> wlh(logLock);
     bool inserted = false;
     // If the log is not enabled
@@ -72,6 +93,12 @@ bool DcpProducer::BufferLog::insert(size_t bytes) {
     if (!isEnabled_UNLOCKED() || !isFull_UNLOCKED()) {
         bytesOutstanding += bytes;
         inserted = true;
+        if (isEnabled_UNLOCKED() && !probe.inFlight) {
+            probe.inFlight = true;
+            probe.start = now;
+            probe.startAckedBytes = ackedBytes;
+            probe.endAckedBytes = ackedBytes.load() + bytesOutstanding.load();
+        }
     }
     return inserted;
 }
@@ -104,37 +131,84 @@ void DcpProducer::BufferLog::unpauseIfSpaceAvailable() {
         EP_LOG_INFO(
                 "{} Unable to notify paused connection because "
                 "DcpProducer::BufferLog is full; ackedBytes:{}"
-                ", bytesSent:{}, maxBytes:{}",
+                ", bytesSent:{}, maxBytes:{}, window:{}",
                 producer.logHeader(),
                 ackedBytes,
                 uint64_t(bytesOutstanding),
-                uint64_t(maxBytes));
+                uint64_t(maxBytes),
+                uint64_t(getWindow_UNLOCKED()));
     } else {
         producer.scheduleNotify();
     }
 }
 
-void DcpProducer::BufferLog::acknowledge(size_t bytes) {
+void DcpProducer::BufferLog::acknowledge(size_t bytes, Clock::time_point now) {
     std::unique_lock<folly::SharedMutex> wlh(logLock);
     State state = getState_UNLOCKED();
     if (state != Disabled) {
         release_UNLOCKED(bytes);
         ackedBytes += bytes;
+        updateEstimates_UNLOCKED(now);
 
         if (state == Full) {
             EP_LOG_INFO(
                     "{} Notifying paused connection now that "
                     "DcpProducer::BufferLog is no longer full; ackedBytes:{}"
-                    ", bytesSent:{}, maxBytes:{}",
+                    ", bytesSent:{}, maxBytes:{}, window:{}",
                     producer.logHeader(),
                     ackedBytes,
                     uint64_t(bytesOutstanding),
-                    uint64_t(maxBytes));
+                    uint64_t(maxBytes),
+                    uint64_t(getWindow_UNLOCKED()));
             producer.scheduleNotify();
         }
     }
 }
 
+void DcpProducer::BufferLog::updateEstimates_UNLOCKED(Clock::time_point now) {
+    if (!probe.inFlight || ackedBytes < probe.endAckedBytes) {
+        return;
+    }
+    probe.inFlight = false;
+
+    using namespace std::chrono;
+    // Clamp to 1us so a sub-microsecond sample still gives a rate.
+    const auto rtt = std::max(duration_cast<microseconds>(now - probe.start),
+                              microseconds(1));
+    srtt = (srtt.count() == 0) ? rtt : (srtt * 7 + rtt) / 8;
+    if (minRtt.count() == 0 || rtt <= minRtt ||
+        (now - minRttStamp) > minRttExpiry) {
+        minRtt = rtt;
+        minRttStamp = now;
+    }
+
+    const double delivered = ackedBytes.load() - probe.startAckedBytes;
+    const double rate = delivered / duration<double>(rtt).count();
+    throughput = (throughput == 0) ? rate : (throughput * 3 + rate) / 4;
+
+    if (minBytes == 0) {
+        return;
+    }
+
+    // Aim for twice the bandwidth-delay product so the peer can keep
+    // draining while acks are in flight, changing by at most a factor of two
+    // per round trip.
+    const double bdp = throughput * duration<double>(minRtt).count();
+    const auto current = getWindow_UNLOCKED();
+    auto target = static_cast<size_t>(bdp * 2);
+    target = std::max(target, current / 2);
+    target = std::min(target, current * 2);
+    windowBytes = std::max(target, minBytes);
+}
+
+void DcpProducer::BufferLog::resetEstimates_UNLOCKED() {
+    probe = RttProbe{};
+    srtt = std::chrono::microseconds(0);
+    minRtt = std::chrono::microseconds(0);
+    throughput = 0;
+    windowBytes = minBytes;
+}
+
 void DcpProducer::BufferLog::addStats(const AddStatFn& add_stat,
                                       const void* c) {
     std::shared_lock<folly::SharedMutex> rhl(logLock);
@@ -143,6 +217,19 @@ void DcpProducer::BufferLog::addStats(const AddStatFn& add_stat,
         producer.addStat("unacked_bytes", bytesOutstanding, add_stat, c);
         producer.addStat("total_acked_bytes", ackedBytes, add_stat, c);
         producer.addStat("flow_control", "enabled", add_stat, c);
+        producer.addStat("flow_control_adaptive",
+                         minBytes != 0 ? "enabled" : "disabled",
+                         add_stat,
+                         c);
+        producer.addStat(
+                "flow_control_window", getWindow_UNLOCKED(), add_stat, c);
+        producer.addStat("flow_control_rtt_us", srtt.count(), add_stat, c);
+        producer.addStat(
+                "flow_control_min_rtt_us", minRtt.count(), add_stat, c);
+        producer.addStat("flow_control_throughput",
+                         static_cast<uint64_t>(throughput),
+                         add_stat,
+                         c);
     } else {
         producer.addStat("flow_control", "disabled", add_stat, c);
     }
@@ -173,6 +260,7 @@ DcpProducer::DcpProducer(EventuallyPersistentEngine& e,
       log(*this),
       backfillMgr(std::make_shared<BackfillManager>(
               *e.getKVBucket(), e.getDcpConnMap(), e.getConfiguration())),
+      ready(e.getConfiguration().getMaxVbuckets()),
       streams(streamsMapSize),
       itemsSent(0),
       totalBytesSent(0),
@@ -259,13 +347,12 @@ DcpProducer::~DcpProducer() {
 
 void DcpProducer::cancelCheckpointCreatorTask() {
     LockHolder guard(checkpointCreator->mutex);
-    if (checkpointCreator->task) {
-        static_cast<ActiveStreamCheckpointProcessorTask*>(
-                checkpointCreator->task.get())
+    for (auto& task : checkpointCreator->tasks) {
+        static_cast<ActiveStreamCheckpointProcessorTask*>(task.get())
                 ->cancelTask();
-        ExecutorPool::get()->cancel(checkpointCreator->task->getId());
-        checkpointCreator->task.reset();
+        ExecutorPool::get()->cancel(task->getId());
     }
+    checkpointCreator->tasks.clear();
 }
 
 ENGINE_ERROR_CODE DcpProducer::streamRequest(
@@ -531,7 +618,7 @@ ENGINE_ERROR_CODE DcpProducer::streamRequest(
            the stream creation fails later on in the func. The goal is to
            create the 'checkpointProcessorTask' before any valid active stream
            is created */
-        if (createChkPtProcessorTsk && !checkpointCreator->task) {
+        if (createChkPtProcessorTsk && checkpointCreator->tasks.empty()) {
             createCheckpointProcessorTask();
             scheduleCheckpointProcessorTask();
         }
@@ -584,7 +671,7 @@ ENGINE_ERROR_CODE DcpProducer::streamRequest(
     notifyStreamReady(vbucket);
 
     if (callAddVBConnByVBId) {
-        engine_.getDcpConnMap().addVBConnByVBId(*this, vbucket);
+        engine_.getDcpConnMap().addVBConnByVBId(shared_from_this(), vbucket);
     }
 
     return rv;
@@ -960,6 +1047,14 @@ ENGINE_ERROR_CODE DcpProducer::control(uint32_t opaque,
             log.setBufferSize(size);
             return ENGINE_SUCCESS;
         }
+    } else if (keyStr == "connection_buffer_size_min") {
+        uint32_t size;
+        if (parseUint32(valueStr.c_str(), &size)) {
+            /* The consumer allows the buffer to be sized adaptively, down to
+               this minimum. Zero gives a fixed size buffer. */
+            log.setMinBufferSize(size);
+            return ENGINE_SUCCESS;
+        }
     } else if (strncmp(param, "stream_buffer_size", key.size()) == 0) {
         logger->warn(
                 "The ctrl parameter stream_buffer_size is"
@@ -1442,6 +1537,8 @@ void DcpProducer::addStats(const AddStatFn& add_stat, const void* c) {
     addStat("items_sent", getItemsSent(), add_stat, c);
     addStat("items_remaining", getItemsRemaining(), add_stat, c);
     addStat("total_bytes_sent", getTotalBytesSent(), add_stat, c);
+    addStat("oso_backfills", osoBackfills.load(), add_stat, c);
+    addStat("oso_backfills_declined", osoBackfillsDeclined.load(), add_stat, c);
     if (isCompressionEnabled()) {
         addStat("total_uncompressed_data_size", getTotalUncompressedDataSize(),
                 add_stat, c);
@@ -1473,14 +1570,15 @@ void DcpProducer::addStats(const AddStatFn& add_stat, const void* c) {
 
     log.addStats(add_stat, c);
 
-    ExTask pointerCopy;
+    std::vector<ExTask> tasksCopy;
     { // Locking scope
         LockHolder guard(checkpointCreator->mutex);
-        pointerCopy = checkpointCreator->task;
+        tasksCopy = checkpointCreator->tasks;
     }
 
-    if (pointerCopy) {
-        static_cast<ActiveStreamCheckpointProcessorTask*>(pointerCopy.get())
+    addStat("ckpt_processor_lanes", tasksCopy.size(), add_stat, c);
+    for (const auto& task : tasksCopy) {
+        static_cast<ActiveStreamCheckpointProcessorTask*>(task.get())
                 ->addStats(getName(), add_stat, c);
     }
 
@@ -1500,11 +1598,34 @@ void DcpProducer::addStats(const AddStatFn& add_stat, const void* c) {
                       }
                   });
 
+    Hdr1sfMicroSecHistogram itemSendLatency;
     for (const auto& stream : valid_streams) {
         stream->addStats(add_stat, c);
+        const auto* as = dynamic_cast<const ActiveStream*>(stream.get());
+        if (as) {
+            itemSendLatency += as->getItemSendLatencyHisto();
+        }
     }
 
     addStat("num_streams", valid_streams.size(), add_stat, c);
+    addStat("item_send_latency", itemSendLatency, add_stat, c);
+}
+
+Hdr1sfMicroSecHistogram DcpProducer::getItemSendLatencyHisto() const {
+    Hdr1sfMicroSecHistogram histo;
+    std::for_each(streams.begin(),
+                  streams.end(),
+                  [&histo](const StreamsMap::value_type& vt) {
+                      for (auto handle = vt.second->rlock(); !handle.end();
+                           handle.next()) {
+                          const auto* as = dynamic_cast<const ActiveStream*>(
+                                  handle.get().get());
+                          if (as) {
+                              histo += as->getItemSendLatencyHisto();
+                          }
+                      }
+                  });
+    return histo;
 }
 
 void DcpProducer::addTakeoverStats(const AddStatFn& add_stat,
@@ -1567,6 +1688,30 @@ void DcpProducer::aggregateQueueStats(ConnCounter& aggregator) const {
     aggregator.conn_queueRemaining += getItemsRemaining();
 }
 
+void DcpProducer::addMemoryUsage(std::vector<size_t>& readyQueueMemory,
+                                 size_t& backfillBufferBytes) {
+    std::for_each(streams.begin(),
+                  streams.end(),
+                  [&readyQueueMemory](const StreamsMap::value_type& vt) {
+                      for (auto handle = vt.second->rlock(); !handle.end();
+                           handle.next()) {
+                          auto stream = handle.get();
+                          const auto vb = stream->getVBucket().get();
+                          if (vb < readyQueueMemory.size()) {
+                              readyQueueMemory[vb] +=
+                                      stream->getReadyQueueMemory();
+                          }
+                      }
+                  });
+
+    // Possible that the producer has had its streams closed and hence doesn't
+    // have a backfill manager anymore.
+    auto mgr = backfillMgr.load();
+    if (mgr) {
+        backfillBufferBytes += mgr->getBufferBytesRead();
+    }
+}
+
 void DcpProducer::notifySeqnoAvailable(Vbid vbucket,
                                        uint64_t seqno,
                                        SyncWriteOperation syncWrite) {
@@ -1949,26 +2094,36 @@ bool DcpProducer::bufferLogInsert(size_t bytes) {
 }
 
 void DcpProducer::createCheckpointProcessorTask() {
+    const auto lanes = std::max(
+            size_t(1),
+            engine_.getConfiguration()
+                    .getDcpProducerCheckpointProcessorParallelism());
     LockHolder guard(checkpointCreator->mutex);
-    checkpointCreator->task =
-            std::make_shared<ActiveStreamCheckpointProcessorTask>(
-                    engine_, shared_from_this());
+    checkpointCreator->tasks.clear();
+    for (size_t ii = 0; ii < lanes; ++ii) {
+        checkpointCreator->tasks.push_back(
+                std::make_shared<ActiveStreamCheckpointProcessorTask>(
+                        engine_, shared_from_this(), ii, lanes));
+    }
 }
 
 void DcpProducer::scheduleCheckpointProcessorTask() {
     LockHolder guard(checkpointCreator->mutex);
-    ExecutorPool::get()->schedule(checkpointCreator->task);
+    for (auto& task : checkpointCreator->tasks) {
+        ExecutorPool::get()->schedule(task);
+    }
 }
 
 void DcpProducer::scheduleCheckpointProcessorTask(
         std::shared_ptr<ActiveStream> s) {
     LockHolder guard(checkpointCreator->mutex);
-    if (!checkpointCreator->task) {
+    auto& tasks = checkpointCreator->tasks;
+    if (tasks.empty()) {
         throw std::logic_error(
                 "DcpProducer::scheduleCheckpointProcessorTask task is null");
     }
-    static_cast<ActiveStreamCheckpointProcessorTask*>(
-            checkpointCreator->task.get())
+    const auto lane = s->getVBucket().get() % tasks.size();
+    static_cast<ActiveStreamCheckpointProcessorTask*>(tasks[lane].get())
             ->schedule(s);
 }
 
@@ -2059,11 +2214,33 @@ std::string DcpProducer::getConsumerName() const {
     return consumerName;
 }
 
-bool DcpProducer::isOutOfOrderSnapshotsEnabled() const {
-    return outOfOrderSnapshots == OutOfOrderSnapshots::Yes &&
+bool DcpProducer::isOutOfOrderSnapshotsEnabled(bool streamRequested) const {
+    return (streamRequested ||
+            outOfOrderSnapshots == OutOfOrderSnapshots::Yes) &&
            engine_.getKVBucket()->isByIdScanSupported();
 }
 
+bool DcpProducer::shouldBackfillOSO(VBucket& vb, CollectionID cid) {
+    const double maxRatio = engine_.getConfiguration()
+                                    .getDcpOsoBackfillMaxCollectionRatio();
+    const auto vbItems = vb.getNumTotalItems();
+    uint64_t collectionItems = 0;
+    {
+        auto handle = vb.lockCollections();
+        if (handle.exists(cid)) {
+            collectionItems = handle.getItemCount(cid);
+        }
+    }
+
+    if (maxRatio >= 1.0 || vbItems == 0 ||
+        collectionItems <= maxRatio * vbItems) {
+        ++osoBackfills;
+        return true;
+    }
+    ++osoBackfillsDeclined;
+    return false;
+}
+
 std::optional<uint64_t> DcpProducer::getHighSeqnoOfCollections(
         const Collections::VB::Filter& filter, Vbid vbucket) const {
     if (filter.isPassThroughFilter()) {
@@ -30,6 +30,9 @@
 #include <folly/AtomicHashMap.h>
 #include <folly/SharedMutex.h>
 #include <folly/lang/Aligned.h>
+#include <utilities/hdrhistogram.h>
+
+#include <chrono>
 
 class BackfillManager;
 class CheckpointCursor;
@@ -108,12 +111,27 @@ public:
 
     void addStats(const AddStatFn& add_stat, const void* c) override;
 
+    /**
+     * @return the item send latency histograms (see
+     * ActiveStream::getItemSendLatencyHisto) of all of this producer's
+     * streams, aggregated.
+     */
+    Hdr1sfMicroSecHistogram getItemSendLatencyHisto() const;
+
     void addTakeoverStats(const AddStatFn& add_stat,
                           const void* c,
                           const VBucket& vb);
 
     void aggregateQueueStats(ConnCounter& aggregator) const override;
 
+    /**
+     * Add the memory used by the readyQs of the streams of this producer
+     * (to the entry of the vBucket of each stream), and the bytes held in
+     * the backfill buffer.
+     */
+    void addMemoryUsage(std::vector<size_t>& readyQueueMemory,
+                        size_t& backfillBufferBytes);
+
     /**
      * ALERT: Do NOT call this function while holding ConnMap::connLock.
      * The call may acquire the VBucket::stateLock and raise a potential
@@ -256,9 +274,18 @@ public:
      * When the buffer becomes full (outstanding >= limit), the producer is
      * paused. Similarly when data is subsequently acknowledged and outstanding
      * < limit; the producer is un-paused.
+     *
+     * The log also estimates the round-trip time of acknowledgements and the
+     * rate at which the peer drains the buffer. If the peer has set a minimum
+     * buffer size the limit is adaptive: it tracks twice the estimated
+     * bandwidth-delay product (throughput * minimum RTT), between the minimum
+     * and the buffer size. A high-latency link therefore grows the window up
+     * to the size the consumer allowed, while a nearby (or slow) consumer is
+     * not sent more than it can drain in a round trip.
      */
     class BufferLog {
     public:
+        using Clock = std::chrono::steady_clock;
 
         /*
             BufferLog has 3 states.
@@ -278,7 +305,12 @@ public:
         };
 
         explicit BufferLog(DcpProducer& p)
-            : producer(p), maxBytes(0), bytesOutstanding(0), ackedBytes(0) {
+            : producer(p),
+              maxBytes(0),
+              minBytes(0),
+              windowBytes(0),
+              bytesOutstanding(0),
+              ackedBytes(0) {
         }
 
         /**
@@ -287,6 +319,14 @@ public:
          */
         void setBufferSize(size_t maxBytes);
 
+        /**
+         * Set the smallest window the adaptive limit may shrink to. A value
+         * of zero disables adaptive sizing (the limit is the buffer size).
+         * When enabled the window starts at the minimum and grows as the
+         * estimates allow.
+         */
+        void setMinBufferSize(size_t minBytes);
+
         void addStats(const AddStatFn& add_stat, const void* c);
 
         /**
@@ -295,13 +335,24 @@ public:
          * @return false if the log is full, true if the bytes fit or if the
          * buffer log is disabled. The outstanding bytes are increased.
          */
-        bool insert(size_t bytes);
+        bool insert(size_t bytes) {
+            return insert(bytes, Clock::now());
+        }
+
+        /// As insert(bytes), with the current time supplied by the caller.
+        bool insert(size_t bytes, Clock::time_point now);
 
         /**
          * Acknowledge the bytes and unpause the producer if full.
          * The outstanding bytes are decreased.
          */
-        void acknowledge(size_t bytes);
+        void acknowledge(size_t bytes) {
+            acknowledge(bytes, Clock::now());
+        }
+
+        /// As acknowledge(bytes), with the current time supplied by the
+        /// caller.
+        void acknowledge(size_t bytes, Clock::time_point now);
 
         /**
          * Pause the producer if full.
@@ -316,17 +367,30 @@ public:
             return bytesOutstanding;
         }
 
+        /// @return the number of bytes which may currently be outstanding.
+        size_t getWindowBytes();
+
     private:
         bool isEnabled_UNLOCKED() {
             return maxBytes != 0;
         }
 
         bool isFull_UNLOCKED() {
-            return bytesOutstanding >= maxBytes;
+            return bytesOutstanding >= getWindow_UNLOCKED();
         }
 
+        size_t getWindow_UNLOCKED() const;
+
         void release_UNLOCKED(size_t bytes);
 
+        /**
+         * Complete the outstanding RTT probe (if acknowledged) and update the
+         * RTT / throughput estimates and the adaptive window.
+         */
+        void updateEstimates_UNLOCKED(Clock::time_point now);
+
+        void resetEstimates_UNLOCKED();
+
         State getState_UNLOCKED();
 
         folly::SharedMutex logLock;
@@ -336,6 +400,13 @@ public:
         /// outstanding before the buffer is considered full.
         size_t maxBytes;
 
+        /// Smallest adaptive window; zero if adaptive sizing is disabled.
+        size_t minBytes;
+
+        /// Current adaptive window, only used if minBytes is non-zero.
+        /// Bounded to [minBytes, maxBytes] by getWindow_UNLOCKED().
+        size_t windowBytes;
+
         /// Number of bytes currently outstanding (in the buffer). Incremented
         /// upon insert(); and then decremented by acknowledge().
         cb::NonNegativeCounter<size_t> bytesOutstanding;
@@ -343,6 +414,33 @@ public:
         /// Total number of bytes acknowledeged. Should be non-decreasing in
         /// normal usage; but can be reset to zero when buffer size changes.
         Monotonic<size_t> ackedBytes;
+
+        /**
+         * A single RTT probe is in flight at a time: it is started by an
+         * insert and completes once everything outstanding at that point has
+         * been acknowledged.
+         */
+        struct RttProbe {
+            bool inFlight = false;
+            Clock::time_point start;
+            /// ackedBytes when the probe started.
+            size_t startAckedBytes = 0;
+            /// ackedBytes at which the probe completes.
+            size_t endAckedBytes = 0;
+        } probe;
+
+        /// Smoothed RTT of acknowledgements.
+        std::chrono::microseconds srtt{0};
+
+        /// Smallest RTT seen within the last minRttExpiry; approximates the
+        /// RTT without any queueing in the peer.
+        std::chrono::microseconds minRtt{0};
+        Clock::time_point minRttStamp;
+
+        /// Smoothed rate (bytes per second) at which bytes are acknowledged.
+        double throughput = 0;
+
+        static constexpr std::chrono::seconds minRttExpiry{10};
     };
 
     /*
@@ -369,7 +467,24 @@ public:
 
     void setIdleTimeout(size_t newValue);
 
-    bool isOutOfOrderSnapshotsEnabled() const;
+    /**
+     * @param streamRequested true if the stream asked for an OSO backfill
+     *        with DCP_ADD_STREAM_FLAG_OSO_BACKFILL
+     * @return true if OSO snapshots may be sent, i.e. the client enabled them
+     *         for the connection or the stream, and the bucket supports a
+     *         by-id scan
+     */
+    bool isOutOfOrderSnapshotsEnabled(bool streamRequested = false) const;
+
+    /**
+     * Decide if a backfill of the given collection should be OSO (a scan of
+     * the collection's key range) rather than by seqno (a scan of every seqno
+     * of the vBucket, discarding other collections' items). The key range
+     * scan is the cheaper one for a collection which holds a small enough
+     * part of the vBucket's items (dcp_oso_backfill_max_collection_ratio).
+     * Counts the choice in the producer's stats.
+     */
+    bool shouldBackfillOSO(VBucket& vb, CollectionID cid);
 
     /**
      * For filtered DCP, method returns the maximum of all the high-seqnos of
@@ -403,13 +518,13 @@ protected:
     ENGINE_ERROR_CODE maybeSendNoop(struct dcp_message_producers* producers);
 
     /**
-     * Create the ActiveStreamCheckpointProcessorTask and assign to
-     * checkpointCreatorTask
+     * Create the ActiveStreamCheckpointProcessorTasks (one per lane) and
+     * assign to checkpointCreator->tasks
      */
     void createCheckpointProcessorTask();
 
     /**
-     * Schedule the checkpointCreatorTask on the ExecutorPool
+     * Schedule the checkpointCreator->tasks on the ExecutorPool
      */
     void scheduleCheckpointProcessorTask();
 
@@ -623,11 +738,20 @@ protected:
     std::atomic<size_t> totalBytesSent;
     std::atomic<size_t> totalUncompressedDataSize;
 
-    /// Guards access to checkpointCreatorTask, so multiple threads can
-    /// safely access  checkpointCreatorTask shared ptr.
+    /// Number of OSO backfills scheduled
+    cb::RelaxedAtomic<size_t> osoBackfills{0};
+
+    /// Number of backfills which could have been OSO, but were by seqno as
+    /// the collection holds too large a part of the vBucket
+    cb::RelaxedAtomic<size_t> osoBackfillsDeclined{0};
+
+    /// Guards access to the checkpoint processor tasks, so multiple threads
+    /// can safely access the task shared ptrs. The vBuckets are partitioned
+    /// between the tasks by vbid (see
+    /// dcp_producer_checkpoint_processor_parallelism).
     struct CheckpointCreator {
         mutable std::mutex mutex;
-        ExTask task;
+        std::vector<ExTask> tasks;
     };
 
     // MB-30488: padding to keep mutex from sharing cachelines with
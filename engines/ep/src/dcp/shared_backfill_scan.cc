@@ -0,0 +1,237 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "dcp/shared_backfill_scan.h"
+#include "dcp/active_stream.h"
+#include "item.h"
+#include "kvstore.h"
+#include "statistics/collector.h"
+
+#include <algorithm>
+
+bool SharedBackfillScan::Subscriber::push(std::unique_ptr<Item> item) {
+    // As BackfillManager::bytesCheckAndRead; always accept one item.
+    const auto size = item->size();
+    if (items.size() >= maxItems ||
+        (bytes != 0 && bytes + size > maxBytes)) {
+        return false;
+    }
+    bytes += size;
+    lastSeqno = item->getBySeqno();
+    items.push_back(std::move(item));
+    return true;
+}
+
+SharedBackfillScan::SharedBackfillScan(DcpSharedBackfills& registry,
+                                       std::shared_ptr<ActiveStream> stream,
+                                       Vbid vbid,
+                                       ValueFilter valFilter,
+                                       uint64_t startSeqno,
+                                       uint64_t snapshotEnd,
+                                       uint64_t purgeSeqno,
+                                       size_t maxBytes,
+                                       size_t maxItems)
+    : vbid(vbid),
+      valFilter(valFilter),
+      registry(registry),
+      leader(stream),
+      snapshotEnd(snapshotEnd),
+      purgeSeqno(purgeSeqno),
+      maxBytes(maxBytes),
+      maxItems(maxItems),
+      position(startSeqno - 1) {
+}
+
+std::shared_ptr<SharedBackfillScan::Subscriber> SharedBackfillScan::subscribe(
+        std::shared_ptr<ActiveStream> stream,
+        uint64_t startSeqno,
+        uint64_t snapshotEnd,
+        uint64_t purgeSeqno) {
+    if (snapshotEnd != this->snapshotEnd || purgeSeqno != this->purgeSeqno) {
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lh(mutex);
+    if (finished || position >= snapshotEnd) {
+        return {};
+    }
+    // The subscriber reads up to position itself, and skips anything
+    // offered before its start.
+    auto subscriber = std::make_shared<Subscriber>(
+            stream, std::max(position, startSeqno - 1), maxBytes, maxItems);
+    subscribers.push_back(subscriber);
+    registry.subscriptions++;
+    return subscriber;
+}
+
+void SharedBackfillScan::unsubscribe(Subscriber& subscriber) {
+    std::lock_guard<std::mutex> lh(mutex);
+    subscribers.erase(std::remove_if(subscribers.begin(),
+                                     subscribers.end(),
+                                     [&subscriber](const auto& s) {
+                                         return s.get() == &subscriber;
+                                     }),
+                      subscribers.end());
+    std::lock_guard<std::mutex> slh(subscriber.mutex);
+    subscriber.detached = true;
+}
+
+void SharedBackfillScan::finish(bool complete) {
+    std::lock_guard<std::mutex> lh(mutex);
+    finished = true;
+    for (auto& subscriber : subscribers) {
+        std::lock_guard<std::mutex> slh(subscriber->mutex);
+        if (complete) {
+            subscriber->complete = true;
+        } else {
+            subscriber->detached = true;
+            registry.detached++;
+        }
+    }
+    subscribers.clear();
+}
+
+bool SharedBackfillScan::isAllowedBySubscriber(const DocKey& key) const {
+    for (const auto& subscriber : subscribers) {
+        auto stream = subscriber->stream.lock();
+        if (stream && stream->collectionAllowed(key)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SharedBackfillScan::advance(uint64_t seqno) {
+    position = std::max(position, seqno);
+}
+
+ENGINE_ERROR_CODE SharedBackfillScan::lookup(CacheLookup& lookup,
+                                             StatusCallback<CacheLookup>& cb) {
+    std::lock_guard<std::mutex> lh(mutex);
+    if (!subscribers.empty()) {
+        // The subscribers need the item from disk; skip it only if nobody
+        // will send it.
+        const auto& key = lookup.getKey();
+        auto stream = leader.lock();
+        if (!key.isPrepared() &&
+            !(stream && stream->collectionAllowed(key.getDocKey())) &&
+            !isAllowedBySubscriber(key.getDocKey())) {
+            advance(lookup.getBySeqno());
+            return ENGINE_KEY_EEXISTS;
+        }
+        return ENGINE_SUCCESS;
+    }
+
+    cb.callback(lookup);
+    const auto status = cb.getStatus();
+    if (status == ENGINE_KEY_EEXISTS) {
+        // Sent from memory (or skipped) - done with
+        advance(lookup.getBySeqno());
+    }
+    return status;
+}
+
+ENGINE_ERROR_CODE SharedBackfillScan::received(GetValue& val,
+                                               StatusCallback<GetValue>& cb) {
+    std::lock_guard<std::mutex> lh(mutex);
+    if (!val.item) {
+        cb.callback(val);
+        return cb.getStatus();
+    }
+
+    const uint64_t seqno = val.item->getBySeqno();
+    std::unique_ptr<Item> copy;
+    if (!subscribers.empty()) {
+        // The leader's stream takes the item even if it rejects it; copy
+        // it (sharing the value) first.
+        copy = std::make_unique<Item>(*val.item);
+        copy->setFreqCounterValue(0);
+    }
+
+    cb.callback(val);
+    const auto status = cb.getStatus();
+    if (status != ENGINE_SUCCESS) {
+        // Paused; the item is read again when the scan resumes
+        return status;
+    }
+
+    advance(seqno);
+    for (auto it = subscribers.begin(); it != subscribers.end();) {
+        auto& subscriber = **it;
+        std::unique_lock<std::mutex> slh(subscriber.mutex);
+        if (seqno <= subscriber.lastSeqno) {
+            // Before the subscriber's start
+            ++it;
+            continue;
+        }
+        if (!subscriber.push(std::make_unique<Item>(*copy))) {
+            // Too far behind; it continues on its own from lastSeqno
+            subscriber.detached = true;
+            slh.unlock();
+            registry.detached++;
+            it = subscribers.erase(it);
+            continue;
+        }
+        registry.itemsShared++;
+        ++it;
+    }
+    return status;
+}
+
+void DcpSharedBackfills::add(std::shared_ptr<SharedBackfillScan> scan) {
+    std::lock_guard<std::mutex> lh(mutex);
+    running.push_back(std::move(scan));
+    scans++;
+}
+
+void DcpSharedBackfills::remove(const SharedBackfillScan& scan) {
+    std::lock_guard<std::mutex> lh(mutex);
+    running.erase(std::remove_if(running.begin(),
+                                 running.end(),
+                                 [&scan](const auto& s) {
+                                     return s.get() == &scan;
+                                 }),
+                  running.end());
+}
+
+std::vector<std::shared_ptr<SharedBackfillScan>> DcpSharedBackfills::find(
+        Vbid vbid, ValueFilter valFilter) const {
+    std::vector<std::shared_ptr<SharedBackfillScan>> ret;
+    std::lock_guard<std::mutex> lh(mutex);
+    for (const auto& scan : running) {
+        if (scan->vbid == vbid && scan->valFilter == valFilter) {
+            ret.push_back(scan);
+        }
+    }
+    return ret;
+}
+
+void DcpSharedBackfills::addStats(const AddStatFn& add_stat,
+                                  const void* c) const {
+    add_casted_stat(
+            "ep_dcp_backfill_shared_leaders", scans.load(), add_stat, c);
+    add_casted_stat("ep_dcp_backfill_shared_subscriptions",
+                    subscriptions.load(),
+                    add_stat,
+                    c);
+    add_casted_stat(
+            "ep_dcp_backfill_shared_detached", detached.load(), add_stat, c);
+    add_casted_stat("ep_dcp_backfill_shared_items",
+                    itemsShared.load(),
+                    add_stat,
+                    c);
+}
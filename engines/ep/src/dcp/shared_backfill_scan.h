@@ -0,0 +1,259 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "callbacks.h"
+#include "dcp/backfill_disk.h"
+
+#include <memcached/engine_common.h>
+#include <memcached/vbucket.h>
+#include <relaxed_atomic.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ActiveStream;
+class DcpSharedBackfills;
+class Item;
+enum class ValueFilter;
+
+/**
+ * A by-seqno disk backfill whose scan is shared with the backfills of other
+ * ActiveStreams of the same vBucket (and value filter), so that concurrent
+ * backfills of a vBucket (rebalance, indexer rebuilds) read the file once.
+ *
+ * The backfill which starts the scan (the leader) drives it at the pace of
+ * its own stream. Every item the leader's stream accepts is also offered to
+ * each subscriber; it is copied (sharing the value) into the subscriber's
+ * queue, which its own backfill drains into its stream. A subscriber whose
+ * queue is full (it is bounded like the BackfillManager's scan buffer) is
+ * detached and continues with a scan of its own, as are all subscribers if
+ * the leader doesn't complete its scan.
+ *
+ * A subscriber opens a scan context of the same disk snapshot (the same
+ * high and purge seqno) as the leader, and uses it to read the seqnos the
+ * leader has already moved past before it subscribed, and after it was
+ * detached. The position the leader has moved past is only advanced once
+ * an item has been accepted by the leader's stream (or skipped), and a
+ * subscriber joins under the same lock, so every seqno is read by exactly
+ * one of the two.
+ *
+ * While it has subscribers, the leader reads every item (the subscribers
+ * may allow a collection its stream doesn't) from disk rather than sending
+ * the in-memory copy.
+ */
+class SharedBackfillScan {
+public:
+    class Subscriber {
+    public:
+        Subscriber(std::shared_ptr<ActiveStream> stream,
+                   uint64_t lastSeqno,
+                   size_t maxBytes,
+                   size_t maxItems)
+            : stream(stream),
+              headEnd(lastSeqno),
+              lastSeqno(lastSeqno),
+              maxBytes(maxBytes),
+              maxItems(maxItems) {
+        }
+
+        const std::weak_ptr<ActiveStream> stream;
+
+        /// The last seqno the subscriber must read itself before draining
+        /// the queue (what the leader had moved past when it subscribed)
+        const uint64_t headEnd;
+
+        /// Guards all of the following
+        std::mutex mutex;
+        /// The items offered by the leader, not yet sent to the stream
+        std::deque<std::unique_ptr<Item>> items;
+        size_t bytes = 0;
+        /// The last seqno the subscriber has received (or read itself)
+        uint64_t lastSeqno;
+        /// The leader has completed the scan (once items are sent the
+        /// subscriber's backfill is complete)
+        bool complete = false;
+        /// No longer receiving items from the leader; the rest of the
+        /// snapshot (after lastSeqno) must be read by the subscriber
+        bool detached = false;
+
+    private:
+        friend class SharedBackfillScan;
+
+        /// @return false if the queue is full (the item is not taken)
+        bool push(std::unique_ptr<Item> item);
+
+        const size_t maxBytes;
+        const size_t maxItems;
+    };
+
+    /**
+     * @param registry The registry the scan is added to
+     * @param stream The stream of the leader
+     * @param vbid The vBucket scanned
+     * @param valFilter The value filter of the scan
+     * @param startSeqno The first seqno the leader scans
+     * @param snapshotEnd The high seqno of the snapshot scanned
+     * @param purgeSeqno The purge seqno of the snapshot scanned
+     * @param maxBytes The maximum bytes queued for a subscriber
+     * @param maxItems The maximum items queued for a subscriber
+     */
+    SharedBackfillScan(DcpSharedBackfills& registry,
+                       std::shared_ptr<ActiveStream> stream,
+                       Vbid vbid,
+                       ValueFilter valFilter,
+                       uint64_t startSeqno,
+                       uint64_t snapshotEnd,
+                       uint64_t purgeSeqno,
+                       size_t maxBytes,
+                       size_t maxItems);
+
+    /**
+     * Subscribe a backfill of stream whose scan context was opened at the
+     * given snapshot.
+     *
+     * @param startSeqno The first seqno the subscriber needs
+     * @return the subscription, or nullptr if the scan is of another
+     *         snapshot or no longer running
+     */
+    std::shared_ptr<Subscriber> subscribe(std::shared_ptr<ActiveStream> stream,
+                                          uint64_t startSeqno,
+                                          uint64_t snapshotEnd,
+                                          uint64_t purgeSeqno);
+
+    /// Stop offering items to the subscriber (it is detached)
+    void unsubscribe(Subscriber& subscriber);
+
+    /**
+     * The leader's scan has finished; if complete the subscribers complete
+     * once they have sent their queue, otherwise they are detached. No
+     * further subscribers may join.
+     */
+    void finish(bool complete);
+
+    /**
+     * Cache callback of the leader's scan
+     *
+     * @param cb The leader stream's own cache callback
+     * @return the status of the lookup (as for StatusCallback::getStatus)
+     */
+    ENGINE_ERROR_CODE lookup(CacheLookup& lookup,
+                             StatusCallback<CacheLookup>& cb);
+
+    /**
+     * Disk callback of the leader's scan
+     *
+     * @param cb The leader stream's own disk callback
+     * @return the status of the callback (as for StatusCallback::getStatus)
+     */
+    ENGINE_ERROR_CODE received(GetValue& val, StatusCallback<GetValue>& cb);
+
+    const Vbid vbid;
+    const ValueFilter valFilter;
+
+private:
+    /// Is the key allowed by any subscriber's stream? (mutex must be held)
+    bool isAllowedBySubscriber(const DocKey& key) const;
+
+    /// The leader has moved past seqno (mutex must be held)
+    void advance(uint64_t seqno);
+
+    DcpSharedBackfills& registry;
+    const std::weak_ptr<ActiveStream> leader;
+    const uint64_t snapshotEnd;
+    const uint64_t purgeSeqno;
+    const size_t maxBytes;
+    const size_t maxItems;
+
+    /// Guards all of the following. Taken before a stream's or a
+    /// subscriber's mutex.
+    std::mutex mutex;
+    /// Every seqno up to position has been processed by the leader
+    uint64_t position;
+    std::vector<std::shared_ptr<Subscriber>> subscribers;
+    bool finished = false;
+};
+
+/// Cache callback of the leader of a SharedBackfillScan
+class SharedCacheCallback : public StatusCallback<CacheLookup> {
+public:
+    SharedCacheCallback(std::shared_ptr<SharedBackfillScan> scan,
+                        std::unique_ptr<StatusCallback<CacheLookup>> cb)
+        : scan(std::move(scan)), cb(std::move(cb)) {
+    }
+
+    void callback(CacheLookup& lookup) override {
+        setStatus(scan->lookup(lookup, *cb));
+    }
+
+private:
+    const std::shared_ptr<SharedBackfillScan> scan;
+    /// The leader's own callback
+    const std::unique_ptr<StatusCallback<CacheLookup>> cb;
+};
+
+/// Disk callback of the leader of a SharedBackfillScan
+class SharedDiskCallback : public StatusCallback<GetValue> {
+public:
+    SharedDiskCallback(std::shared_ptr<SharedBackfillScan> scan,
+                       std::unique_ptr<StatusCallback<GetValue>> cb)
+        : scan(std::move(scan)), cb(std::move(cb)) {
+    }
+
+    void callback(GetValue& val) override {
+        setStatus(scan->received(val, *cb));
+    }
+
+private:
+    const std::shared_ptr<SharedBackfillScan> scan;
+    /// The leader's own callback
+    const std::unique_ptr<StatusCallback<GetValue>> cb;
+};
+
+/**
+ * The SharedBackfillScans of a bucket which are accepting subscribers
+ * (owned by DcpConnMap).
+ */
+class DcpSharedBackfills {
+public:
+    /// Make scan available for backfills to subscribe to
+    void add(std::shared_ptr<SharedBackfillScan> scan);
+
+    /// The scan no longer accepts subscribers
+    void remove(const SharedBackfillScan& scan);
+
+    /// @return the scans of the vBucket with the value filter
+    std::vector<std::shared_ptr<SharedBackfillScan>> find(
+            Vbid vbid, ValueFilter valFilter) const;
+
+    void addStats(const AddStatFn& add_stat, const void* c) const;
+
+    /// Number of scans started as a leader
+    cb::RelaxedAtomic<size_t> scans;
+    /// Number of backfills which subscribed to a scan
+    cb::RelaxedAtomic<size_t> subscriptions;
+    /// Number of subscribers detached before the leader completed
+    cb::RelaxedAtomic<size_t> detached;
+    /// Number of items subscribers received from a leader
+    cb::RelaxedAtomic<size_t> itemsShared;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<std::shared_ptr<SharedBackfillScan>> running;
+};
@@ -120,6 +120,9 @@ public:
 
     virtual void closeIfRequiredPrivilegesLost(const void* cookie) = 0;
 
+    /// @returns the memory occupied by the messages in the readyQ
+    uint64_t getReadyQueueMemory();
+
 protected:
     void clear_UNLOCKED();
 
@@ -129,8 +132,6 @@ protected:
     /* To be called after getting streamMutex lock */
     std::unique_ptr<DcpResponse> popFromReadyQ();
 
-    uint64_t getReadyQueueMemory();
-
     std::string name_;
     const uint32_t flags_;
     const uint32_t opaque_;
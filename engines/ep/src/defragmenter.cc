@@ -24,6 +24,7 @@
 #include "kv_bucket.h"
 #include "stored-value.h"
 #include <phosphor/phosphor.h>
+#include <algorithm>
 #include <cinttypes>
 
 DefragmenterTask::DefragmenterTask(EventuallyPersistentEngine* e,
@@ -35,7 +36,8 @@ DefragmenterTask::DefragmenterTask(EventuallyPersistentEngine* e,
 
 bool DefragmenterTask::run() {
     TRACE_EVENT0("ep-engine/task", "DefragmenterTask");
-    if (engine->getConfiguration().isDefragmenterEnabled()) {
+    if (engine->getConfiguration().isDefragmenterEnabled() &&
+        isFragmented()) {
         // Get our pause/resume visitor. If we didn't finish the previous pass,
         // then resume from where we last were, otherwise create a new visitor
         // starting from the beginning.
@@ -81,6 +83,8 @@ bool DefragmenterTask::run() {
         const auto deadline = start + getChunkDuration();
         visitor.setDeadline(deadline);
         visitor.setBlobAgeThreshold(getAgeThreshold());
+        visitor.setSparseSlabsOnly(
+                engine->getConfiguration().isDefragmenterSparseSlabsOnly());
         // Only defragment StoredValues of persistent buckets because the
         // HashTable defrag method doesn't yet know how to maintain the
         // ephemeral seqno linked-list
@@ -168,7 +172,36 @@ std::chrono::microseconds DefragmenterTask::maxExpectedDuration() {
 }
 
 double DefragmenterTask::getSleepTime() const {
-    return engine->getConfiguration().getDefragmenterInterval();
+    const auto interval = engine->getConfiguration().getDefragmenterInterval();
+    if (!engine->getConfiguration().isDefragmenterAutoInterval()) {
+        return interval;
+    }
+    // The more fragmented the bucket's memory the sooner the next pass, but
+    // no more often than every tenth of the interval
+    return interval * std::max(0.1, 1.0 - stats.getArenaFragmentationRatio());
+}
+
+bool DefragmenterTask::isFragmented() {
+    const auto threshold = engine->getConfiguration()
+                                   .getDefragmenterFragmentationThreshold();
+    if (threshold == 0) {
+        return true;
+    }
+    const auto ratio = stats.getArenaFragmentationRatio();
+    if (ratio >= threshold) {
+        return true;
+    }
+
+    // Resumed from where we were once fragmented enough again
+    ++stats.defragNumSkipped;
+    EP_LOG_DEBUG(
+            "{} for bucket '{}' skipped, fragmentation ratio:{} is "
+            "below the threshold:{}",
+            getDescription(),
+            engine->getName(),
+            ratio,
+            threshold);
+    return false;
 }
 
 size_t DefragmenterTask::getAgeThreshold() const {
@@ -184,6 +217,7 @@ void DefragmenterTask::updateStats(DefragmentVisitor& visitor) {
     stats.defragStoredValueNumMoved.fetch_add(
             visitor.getStoredValueDefragCount());
     stats.defragNumVisited.fetch_add(visitor.getVisitedCount());
+    stats.defragNumDenseSkipped.fetch_add(visitor.getDenseSkipCount());
 }
 
 size_t DefragmenterTask::getMaxValueSize() {
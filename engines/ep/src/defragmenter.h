@@ -94,6 +94,17 @@ class PauseResumeVBAdapter;
  *
  * Instead, we limit the duration of each defragmention invocation (chunk),
  * pause, and then later start the next chunk form where we left off.
+ *
+ * Each bucket allocates from its own arena, so the fragmentation of the
+ * bucket's memory is known: with defragmenter_fragmentation_threshold set,
+ * the chunks are only run while the arena is at least that fragmented.
+ * With defragmenter_auto_interval set, the task sleeps for less than
+ * defragmenter_interval the more fragmented the arena is.
+ *
+ * Where jemalloc can report the utilisation of the slab an object is on
+ * (experimental.utilization.query), defragmenter_sparse_slabs_only limits
+ * the moves to the objects on slabs less used than the average slab of
+ * their size class, which are the ones whose move helps emptying a slab.
  */
 class DefragmenterTask : public GlobalTask {
 public:
@@ -112,9 +123,19 @@ public:
 
 private:
 
-    /// Duration (in seconds) defragmenter should sleep for between iterations.
+    /**
+     * Duration (in seconds) defragmenter should sleep for between iterations
+     * (scaled down by the fragmentation of the bucket's memory with
+     * defragmenter_auto_interval set).
+     */
     double getSleepTime() const;
 
+    /**
+     * Is the memory of the bucket fragmented enough to be worth a pass
+     * (see defragmenter_fragmentation_threshold)? Counts the skipped passes.
+     */
+    bool isFragmented();
+
     // Minimum age (measured in defragmenter task passes) that a document
     // must be to be considered for defragmentation.
     size_t getAgeThreshold() const;
@@ -18,6 +18,65 @@
 #include "defragmenter_visitor.h"
 #include "vbucket.h"
 
+#if defined(HAVE_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#endif
+
+/**
+ * Is the allocation at ptr on a slab which is less used than the average slab
+ * of its size class (and isn't the slab new allocations of its size go to)?
+ * Moving such an object helps emptying its slab, so the memory can be returned
+ * to the OS.
+ *
+ * Every object is considered to be on a sparse slab if the allocator can't
+ * tell (not jemalloc, or jemalloc without stats).
+ */
+static bool isOnSparseSlab(const void* ptr) {
+#if defined(HAVE_JEMALLOC)
+    // The output of experimental.utilization.query, see jemalloc's ctl.c
+    struct {
+        void* slabcur_addr;
+        size_t nfree;
+        size_t nregs;
+        size_t size;
+        size_t bin_nfree;
+        size_t bin_nregs;
+    } util;
+    size_t len = sizeof(util);
+    if (je_mallctl("experimental.utilization.query",
+                   &util,
+                   &len,
+                   &ptr,
+                   sizeof(ptr)) != 0) {
+        return true;
+    }
+
+    if (util.nregs <= 1) {
+        // Not a small (slab) allocation
+        return false;
+    }
+    if (util.nfree == 0) {
+        // A full slab is as dense as it gets
+        return false;
+    }
+    const auto* slabcur = static_cast<const char*>(util.slabcur_addr);
+    const auto* p = static_cast<const char*>(ptr);
+    if (p >= slabcur && p < slabcur + util.size) {
+        // Reallocating would put the object back on the same slab
+        return false;
+    }
+    if (util.bin_nregs == 0) {
+        // No bin stats to compare with
+        return true;
+    }
+    // nfree / nregs > bin_nfree / bin_nregs
+    return util.nfree * util.bin_nregs > util.bin_nfree * util.nregs;
+#else
+    (void)ptr;
+    return true;
+#endif
+}
+
 // DegragmentVisitor implementation ///////////////////////////////////////////
 
 DefragmentVisitor::DefragmentVisitor(size_t max_size_class)
@@ -43,6 +102,10 @@ void DefragmentVisitor::setStoredValueAgeThreshold(uint8_t age) {
     sv_age_threshold = age;
 }
 
+void DefragmentVisitor::setSparseSlabsOnly(bool value) {
+    sparse_slabs_only = value;
+}
+
 bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
                               StoredValue& v) {
     const size_t value_len = v.valuelen();
@@ -59,8 +122,13 @@ bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
         // should be good enough.
         if (v.getValue()->getAge() >= age_threshold &&
             v.getValue().refCount() < 2) {
-            v.reallocate();
-            defrag_count++;
+            if (!sparse_slabs_only || isOnSparseSlab(v.getValue().get())) {
+                v.reallocate();
+                defrag_count++;
+            } else {
+                // Stays a candidate for when its slab empties
+                dense_skip_count++;
+            }
         } else {
             v.getValue()->incrementAge();
         }
@@ -68,7 +136,11 @@ bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
 
     if (sv_age_threshold) {
         if (v.getAge() >= sv_age_threshold.value()) {
-            defragmentStoredValue(v);
+            if (!sparse_slabs_only || isOnSparseSlab(&v)) {
+                defragmentStoredValue(v);
+            } else {
+                dense_skip_count++;
+            }
         } else {
             v.incrementAge();
         }
@@ -85,6 +157,7 @@ void DefragmentVisitor::clearStats() {
     defrag_count = 0;
     visited_count = 0;
     sv_defrag_count = 0;
+    dense_skip_count = 0;
 }
 
 size_t DefragmentVisitor::getDefragCount() const {
@@ -99,6 +172,10 @@ size_t DefragmentVisitor::getStoredValueDefragCount() const {
     return sv_defrag_count;
 }
 
+size_t DefragmentVisitor::getDenseSkipCount() const {
+    return dense_skip_count;
+}
+
 void DefragmentVisitor::setCurrentVBucket(VBucket& vb) {
     currentVb = &vb;
 }
@@ -45,6 +45,13 @@ public:
      */
     void setStoredValueAgeThreshold(uint8_t age);
 
+    /**
+     * Only move the objects which are on a slab less used than the average
+     * slab of their size class (as reported by the allocator). Moving an
+     * object off a dense slab costs a copy without freeing any memory.
+     */
+    void setSparseSlabsOnly(bool value);
+
     // Implementation of HashTableVisitor interface:
     bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override;
 
@@ -60,6 +67,10 @@ public:
     // Returns the number of StoredValues that have been defragmented.
     size_t getStoredValueDefragCount() const;
 
+    // Returns the number of objects old enough to be defragmented but left
+    // in place as they were on a dense slab.
+    size_t getDenseSkipCount() const;
+
     void setCurrentVBucket(VBucket& vb) override;
 
 private:
@@ -74,6 +85,9 @@ private:
     // How old a blob must be to consider it for defragmentation.
     uint8_t age_threshold{0};
 
+    // Only move the objects on sparse slabs.
+    bool sparse_slabs_only{false};
+
     /* Runtime state */
 
     // Estimates how far we have got, and when we should pause.
@@ -86,6 +100,8 @@ private:
     size_t visited_count;
     // How many stored-values have been defrag'd
     mutable size_t sv_defrag_count{0};
+    // How many objects have been left on a dense slab
+    size_t dense_skip_count{0};
 
     // The current vbucket that is being processed
     VBucket* currentVb;
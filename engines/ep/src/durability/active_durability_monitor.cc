@@ -278,6 +278,8 @@ void ActiveDurabilityMonitor::addSyncWrite(const void* cookie,
     }
 
     state.wlock()->addSyncWrite(cookie, std::move(item));
+
+    notifyNextExpiry(false);
 }
 
 ENGINE_ERROR_CODE ActiveDurabilityMonitor::seqnoAckReceived(
@@ -337,6 +339,10 @@ void ActiveDurabilityMonitor::processTimeout(
     // the correct locks).
     state.wlock()->removeExpired(asOf, *resolvedQueue);
 
+    // The DurabilityTimeoutTask drops a vBucket's deadline when it calls in
+    // here, so always report the next one even if it is unchanged.
+    notifyNextExpiry(true);
+
     checkForResolvedSyncWrites();
 }
 
@@ -427,15 +433,42 @@ void ActiveDurabilityMonitor::addStatsForChain(
 }
 
 void ActiveDurabilityMonitor::checkForResolvedSyncWrites() {
+    // Resolving SyncWrites removes them from trackedWrites, which may have
+    // moved the next deadline.
+    notifyNextExpiry(false);
+
     if (resolvedQueue->empty()) {
         return;
     }
     vb.notifySyncWritesPendingCompletion();
 }
 
+void ActiveDurabilityMonitor::notifyNextExpiry(bool force) {
+    if (!vb.hasSyncWriteExpiryCallback()) {
+        return;
+    }
+
+    std::optional<std::chrono::steady_clock::time_point> nextExpiry;
+    {
+        auto s = state.wlock();
+        nextExpiry = s->getNextExpiry();
+        if (!force && nextExpiry == s->notifiedExpiry) {
+            return;
+        }
+        s->notifiedExpiry = nextExpiry;
+    }
+
+    // Note: Must not hold the State lock here, the callback may wake the
+    // DurabilityTimeoutTask.
+    if (nextExpiry) {
+        vb.notifySyncWriteExpiry(*nextExpiry);
+    }
+}
+
 void ActiveDurabilityMonitor::processCompletedSyncWriteQueue() {
     std::lock_guard<ResolvedQueue::ConsumerLock> lock(
             resolvedQueue->getConsumerLock());
+    CompletionBatch batch;
     while (auto sw = resolvedQueue->try_dequeue(lock)) {
         switch (sw->getStatus()) {
         case SyncWriteStatus::Pending:
@@ -446,14 +479,39 @@ void ActiveDurabilityMonitor::processCompletedSyncWriteQueue() {
                     to_string(sw->getStatus()));
             continue;
         case SyncWriteStatus::ToCommit:
-            commit(*sw);
+            commit(*sw, batch);
             continue;
         case SyncWriteStatus::ToAbort:
-            abort(*sw);
+            abort(*sw, batch);
             continue;
         }
         folly::assume_unreachable();
     };
+    completeBatch(batch);
+}
+
+void ActiveDurabilityMonitor::completeBatch(CompletionBatch& batch) {
+    if (batch.committed || batch.aborted) {
+        auto s = state.wlock();
+        if (batch.lastCommittedSeqno) {
+            s->lastCommittedSeqno = *batch.lastCommittedSeqno;
+        }
+        if (batch.lastAbortedSeqno) {
+            s->lastAbortedSeqno = *batch.lastAbortedSeqno;
+        }
+        s->updateHighCompletedSeqno();
+        s->totalCommitted += batch.committed;
+        s->totalAborted += batch.aborted;
+        // Note:
+        // - Level Majority locally-satisfied first at Active by-logic
+        // - Level MajorityAndPersistOnMaster and PersistToMajority must always
+        //     include the Active for being globally satisfied
+        Ensures(s->lastCommittedSeqno <= s->highPreparedSeqno);
+    }
+
+    // Notify the clients once the State reflects their completion (and
+    // without holding any locks)
+    vb.notifyClientsOfSyncWriteComplete(batch.toNotify);
 }
 
 void ActiveDurabilityMonitor::unresolveCompletedSyncWriteQueue() {
@@ -642,19 +700,30 @@ void ActiveDurabilityMonitor::State::advanceAndAckForPosition(
         pos.it->ack(node);
     }
 
-    // Add a trace event for the ACK from this node (assuming we have a cookie
-    // // for it).
+    // Record the time from the SyncWrite being added to the DM up to the ACK
+    // from this node, and add a trace event for it (assuming we have a cookie
+    // for it).
     // ActiveDM has no visibility of when a replica was sent the prepare
     // (that's managed by CheckpointManager which doesn't know the client
-    // cookie) so just make the start+end the same.
+    // cookie, see dcp_item_send_latency for that stage) so the remote ACK
+    // covers send, receive and (if required) persistence at the replica.
+    const auto ackTime = std::chrono::steady_clock::now();
+    const bool local = (node == getActive());
+    const auto ackDuration =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    ackTime - pos.it->getStartTime());
+    if (local) {
+        adm.stats.syncWriteLocalAckTimes.add(ackDuration);
+    } else {
+        adm.stats.syncWriteRemoteAckTimes.add(ackDuration);
+    }
+
     auto* cookie = pos.it->getCookie();
     if (cookie) {
-        const auto ackTime = std::chrono::steady_clock::now();
-        const auto event = (node == getActive())
-                                   ? cb::tracing::Code::SyncWriteAckLocal
-                                   : cb::tracing::Code::SyncWriteAckRemote;
+        const auto event = local ? cb::tracing::Code::SyncWriteAckLocal
+                                 : cb::tracing::Code::SyncWriteAckRemote;
         TracerStopwatch ackTimer(cookie, event);
-        ackTimer.start(ackTime);
+        ackTimer.start(pos.it->getStartTime());
         ackTimer.stop(ackTime);
     }
 }
@@ -817,14 +886,17 @@ ActiveDurabilityMonitor::State::removeSyncWrite(Container::iterator it,
     return std::move(removed.front());
 }
 
-void ActiveDurabilityMonitor::commit(const ActiveSyncWrite& sw) {
+void ActiveDurabilityMonitor::commit(const ActiveSyncWrite& sw,
+                                     CompletionBatch& batch) {
     const auto& key = sw.getKey();
     auto cHandle = vb.lockCollections(key);
 
     if (!cHandle.valid()) {
         // collection no longer exists, cannot commit
-        vb.notifyClientOfSyncWriteComplete(sw.getCookie(),
-                                           ENGINE_SYNC_WRITE_AMBIGUOUS);
+        if (sw.getCookie()) {
+            batch.toNotify.emplace_back(sw.getCookie(),
+                                        ENGINE_SYNC_WRITE_AMBIGUOUS);
+        }
         return;
     }
 
@@ -841,15 +913,19 @@ void ActiveDurabilityMonitor::commit(const ActiveSyncWrite& sw) {
         prepareDuration.start(sw.getStartTime());
         prepareDuration.stop(prepareEnd);
     }
+    // The client is notified as part of the batch
     auto result = vb.commit(key,
                             sw.getBySeqno() /*prepareSeqno*/,
                             {} /*commitSeqno*/,
                             cHandle,
-                            sw.getCookie());
+                            nullptr /*cookie*/);
     if (result != ENGINE_SUCCESS) {
         throwException<std::logic_error>(
                 __func__, "failed with status:" + std::to_string(result));
     }
+    if (cookie) {
+        batch.toNotify.emplace_back(cookie, ENGINE_SUCCESS);
+    }
 
     // Record the duration of the SyncWrite in histogram.
     const auto index = size_t(sw.getDurabilityReqs().getLevel()) - 1;
@@ -858,42 +934,35 @@ void ActiveDurabilityMonitor::commit(const ActiveSyncWrite& sw) {
                     prepareEnd - sw.getStartTime());
     stats.syncWriteCommitTimes.at(index).add(commitDuration);
 
-    {
-        auto s = state.wlock();
-        s->lastCommittedSeqno = sw.getBySeqno();
-        s->updateHighCompletedSeqno();
-        s->totalCommitted++;
-        // Note:
-        // - Level Majority locally-satisfied first at Active by-logic
-        // - Level MajorityAndPersistOnMaster and PersistToMajority must always
-        //     include the Active for being globally satisfied
-        Ensures(s->lastCommittedSeqno <= s->highPreparedSeqno);
-    }
+    batch.lastCommittedSeqno = sw.getBySeqno();
+    batch.committed++;
 }
 
-void ActiveDurabilityMonitor::abort(const ActiveSyncWrite& sw) {
+void ActiveDurabilityMonitor::abort(const ActiveSyncWrite& sw,
+                                    CompletionBatch& batch) {
     const auto& key = sw.getKey();
 
     auto cHandle = vb.lockCollections(key);
     if (cHandle.valid()) {
+        // The client is notified as part of the batch
         auto result = vb.abort(key,
                                sw.getBySeqno() /*prepareSeqno*/,
                                {} /*abortSeqno*/,
                                cHandle,
-                               sw.getCookie());
+                               nullptr /*cookie*/);
         if (result != ENGINE_SUCCESS) {
             throwException<std::logic_error>(
                     __func__, "failed with status:" + std::to_string(result));
         }
-    } else {
-        // collection no longer exists, don't generate an abort
-        vb.notifyClientOfSyncWriteComplete(sw.getCookie(),
-                                           ENGINE_SYNC_WRITE_AMBIGUOUS);
     }
-    auto s = state.wlock();
-    s->lastAbortedSeqno = sw.getBySeqno();
-    s->updateHighCompletedSeqno();
-    s->totalAborted++;
+    // Either aborted, or the collection no longer exists (and we don't
+    // generate an abort); the outcome is ambiguous to the client
+    if (sw.getCookie()) {
+        batch.toNotify.emplace_back(sw.getCookie(),
+                                    ENGINE_SYNC_WRITE_AMBIGUOUS);
+    }
+    batch.lastAbortedSeqno = sw.getBySeqno();
+    batch.aborted++;
 }
 
 void ActiveDurabilityMonitor::eraseSyncWrite(const DocKey& key, int64_t seqno) {
@@ -946,6 +1015,9 @@ void ActiveDurabilityMonitor::eraseSyncWrite(const DocKey& key, int64_t seqno) {
 
     // And erase
     s->trackedWrites.erase(toErase);
+    s.unlock();
+
+    notifyNextExpiry(false);
 }
 
 std::vector<const void*>
@@ -1260,7 +1332,7 @@ void ActiveDurabilityMonitor::State::transitionFromNullTopology(
         // further than the highPreparedSeqno that we inherited from the PDM
         // due to persistence.
         auto fence = std::max(static_cast<uint64_t>(highPreparedSeqno),
-                              adm.vb.getPersistenceSeqno());
+                              adm.vb.getDurablePersistenceSeqno());
         auto& activePos =
                 newFirstChain.positions.find(newFirstChain.active)->second;
         auto it = trackedWrites.begin();
@@ -1424,6 +1496,14 @@ void ActiveDurabilityMonitor::State::removeExpired(
     }
 }
 
+std::optional<std::chrono::steady_clock::time_point>
+ActiveDurabilityMonitor::State::getNextExpiry() const {
+    if (trackedWrites.empty()) {
+        return {};
+    }
+    return trackedWrites.front().getExpiryTime();
+}
+
 void ActiveDurabilityMonitor::State::updateHighPreparedSeqno(
         ResolvedQueue& completed) {
     // Note: All the logic below relies on the fact that HPS for Active is
@@ -1457,7 +1537,7 @@ void ActiveDurabilityMonitor::State::updateHighPreparedSeqno(
             if ((level == cb::durability::Level::PersistToMajority ||
                  level == cb::durability::Level::MajorityAndPersistOnMaster) &&
                 static_cast<uint64_t>(itr->getBySeqno()) <
-                        adm.vb.getPersistenceSeqno()) {
+                        adm.vb.getDurablePersistenceSeqno()) {
                 return;
             }
 
@@ -1490,7 +1570,7 @@ void ActiveDurabilityMonitor::State::updateHighPreparedSeqno(
     // locally-satisfied all the pending Prepares up to high-persisted-seqno.
     while ((next = getNodeNext(active)) != trackedWrites.end() &&
            static_cast<uint64_t>(next->getBySeqno()) <=
-                   adm.vb.getPersistenceSeqno()) {
+                   adm.vb.getDurablePersistenceSeqno()) {
         highPreparedSeqno = next->getBySeqno();
         advanceNodePosition(active);
         removeForCommitIfSatisfied();
@@ -23,7 +23,10 @@
 #include <folly/SynchronizedPtr.h>
 #include <nlohmann/json_fwd.hpp>
 
+#include <optional>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 struct DocKey;
 class EPStats;
@@ -189,7 +192,8 @@ public:
                                        int64_t preparedSeqno);
 
     /**
-     * Enforce timeout for the expired SyncWrites in the tracked list.
+     * Enforce timeout for the expired SyncWrites in the tracked list, then
+     * report the next expiry-time to the VBucket.
      *
      * @param asOf The time to be compared with tracked-SWs' expiry-time
      * @throw std::logic_error
@@ -300,6 +304,8 @@ public:
     /**
      * For all items in the completedSWQueue, call VBucket::commit /
      * VBucket::abort as appropriate, then remove the item from the queue.
+     * The State is updated and the clients are notified once for all of the
+     * SyncWrites completed by the call.
      */
     void processCompletedSyncWriteQueue();
 
@@ -359,19 +365,41 @@ protected:
     [[noreturn]] void throwException(const std::string& thrower,
                                      const std::string& error) const;
 
+    /**
+     * The SyncWrites completed by a single processCompletedSyncWriteQueue()
+     * call; applied to the State (and clients notified) in one go by
+     * completeBatch().
+     */
+    struct CompletionBatch {
+        std::optional<int64_t> lastCommittedSeqno;
+        std::optional<int64_t> lastAbortedSeqno;
+        size_t committed = 0;
+        size_t aborted = 0;
+        /// Clients to notify (and the status to notify them with)
+        std::vector<std::pair<const void*, ENGINE_ERROR_CODE>> toNotify;
+    };
+
     /**
      * Commit the given SyncWrite.
      *
      * @param sw The SyncWrite to commit
+     * @param batch The batch to record the commit in
      */
-    void commit(const ActiveSyncWrite& sw);
+    void commit(const ActiveSyncWrite& sw, CompletionBatch& batch);
 
     /**
      * Abort the given SyncWrite.
      *
      * @param sw The SyncWrite to abort
+     * @param batch The batch to record the abort in
+     */
+    void abort(const ActiveSyncWrite& sw, CompletionBatch& batch);
+
+    /**
+     * Update the State with the SyncWrites completed in the batch and
+     * notify their clients.
      */
-    void abort(const ActiveSyncWrite& sw);
+    void completeBatch(CompletionBatch& batch);
 
     /**
      * Test only (for now; shortly this will be probably needed at rollback).
@@ -419,6 +447,14 @@ protected:
      */
     void checkForResolvedSyncWrites();
 
+    /**
+     * Reports the expiry-time of the first tracked SyncWrite to the VBucket
+     * (for event-driven timeouts) if it differs from the one last reported.
+     *
+     * @param force Report the expiry-time even if unchanged
+     */
+    void notifyNextExpiry(bool force);
+
     // The stats object for the owning Bucket
     EPStats& stats;
 
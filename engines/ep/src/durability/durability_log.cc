@@ -0,0 +1,400 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "durability_log.h"
+
+#include "bucket_logger.h"
+
+#include <folly/FileUtil.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Unistd.h>
+#include <platform/crc32c.h>
+#include <platform/dirutils.h>
+
+#include <cstring>
+#include <stdexcept>
+
+/*
+ * A log file is a sequence of records, each being the length and the crc32c
+ * of its payload followed by the payload. The payload is the magic, the
+ * version, the base seqno and the vbucket_state (as JSON) followed by the
+ * items of the batch. All integers are little-endian.
+ *
+ * A torn write at the end of the file fails the length or crc check: the
+ * record (which was never acknowledged) is then ignored.
+ */
+static constexpr uint32_t RecordMagic = 0x474f4c44; // "DLOG"
+static constexpr uint32_t RecordVersion = 1;
+static constexpr size_t RecordHeaderSize = 8;
+
+static constexpr uint8_t ItemDeleted = 0x1;
+static constexpr uint8_t ItemMaybeVisible = 0x2;
+static constexpr uint8_t ItemHasValue = 0x4;
+
+static void putLE(std::string& out, uint64_t value, int bytes) {
+    for (int ii = 0; ii < bytes; ++ii) {
+        out.push_back(char(value >> (ii * 8)));
+    }
+}
+
+static uint64_t getLE(const char* in, int bytes) {
+    uint64_t value = 0;
+    for (int ii = 0; ii < bytes; ++ii) {
+        value |= uint64_t(uint8_t(in[ii])) << (ii * 8);
+    }
+    return value;
+}
+
+static uint32_t checksum(std::string_view data) {
+    return crc32c(reinterpret_cast<const unsigned char*>(data.data()),
+                  data.size(),
+                  0);
+}
+
+/// Reads the fields of a record, throwing if it is too short
+class RecordReader {
+public:
+    explicit RecordReader(std::string_view data) : data(data) {
+    }
+
+    uint64_t get(int bytes) {
+        return getLE(take(bytes).data(), bytes);
+    }
+
+    std::string_view take(size_t bytes) {
+        if (data.size() < bytes) {
+            throw std::invalid_argument(
+                    "DurabilityLog::deserialise: record truncated");
+        }
+        auto ret = data.substr(0, bytes);
+        data.remove_prefix(bytes);
+        return ret;
+    }
+
+    bool empty() const {
+        return data.empty();
+    }
+
+private:
+    std::string_view data;
+};
+
+DurabilityLog::DurabilityLog(std::string dir) : dir(std::move(dir)) {
+    cb::io::mkdirp(this->dir);
+}
+
+DurabilityLog::~DurabilityLog() {
+    std::lock_guard<std::mutex> lh(mutex);
+    for (auto& file : files) {
+        folly::closeNoInt(file.second.fd);
+    }
+}
+
+std::string DurabilityLog::getFileName(Vbid vbid) const {
+    return cb::io::sanitizePath(dir + "/durability_log." +
+                                std::to_string(vbid.get()));
+}
+
+DurabilityLog::File* DurabilityLog::getFile(Vbid vbid) {
+    std::lock_guard<std::mutex> lh(mutex);
+    auto itr = files.find(vbid);
+    if (itr != files.end()) {
+        return &itr->second;
+    }
+
+    const auto fname = getFileName(vbid);
+    const int fd =
+            folly::openNoInt(fname.c_str(), O_WRONLY | O_CREAT | O_APPEND);
+    if (fd < 0) {
+        EP_LOG_WARN("DurabilityLog::getFile: {} failed to open '{}': {}",
+                    vbid,
+                    fname,
+                    strerror(errno));
+        return nullptr;
+    }
+    const auto size = lseek(fd, 0, SEEK_END);
+    if (size < 0) {
+        EP_LOG_WARN("DurabilityLog::getFile: {} failed to seek '{}': {}",
+                    vbid,
+                    fname,
+                    strerror(errno));
+        folly::closeNoInt(fd);
+        return nullptr;
+    }
+    return &files.emplace(vbid, File{fd, size_t(size)}).first->second;
+}
+
+void DurabilityLog::closeFile(Vbid vbid) {
+    std::lock_guard<std::mutex> lh(mutex);
+    auto itr = files.find(vbid);
+    if (itr != files.end()) {
+        folly::closeNoInt(itr->second.fd);
+        files.erase(itr);
+    }
+}
+
+bool DurabilityLog::write(Vbid vbid,
+                          uint64_t baseSeqno,
+                          const vbucket_state& vbstate,
+                          const std::vector<queued_item>& items) {
+    auto* file = getFile(vbid);
+    if (!file) {
+        return false;
+    }
+
+    const auto payload = serialise(baseSeqno, vbstate, items);
+    std::string record;
+    record.reserve(RecordHeaderSize + payload.size());
+    putLE(record, payload.size(), 4);
+    putLE(record, checksum(payload), 4);
+    record.append(payload);
+
+    // Every record already in the file has been committed to the vBucket
+    // file, so the file can be emptied rather than growing without bound.
+    if (file->size > 0 && file->size + record.size() > MaxFileSize) {
+        if (folly::ftruncateNoInt(file->fd, 0) != 0) {
+            EP_LOG_WARN("DurabilityLog::write: {} failed to truncate: {}",
+                        vbid,
+                        strerror(errno));
+            remove(vbid);
+            return false;
+        }
+        file->size = 0;
+    }
+
+    if (folly::writeFull(file->fd, record.data(), record.size()) !=
+                ssize_t(record.size()) ||
+        folly::fdatasyncNoInt(file->fd) != 0) {
+        EP_LOG_WARN("DurabilityLog::write: {} failed to write {} bytes: {}",
+                    vbid,
+                    record.size(),
+                    strerror(errno));
+        // A partial record would hide any record appended after it. All the
+        // records in the file are committed, so just start a new file.
+        remove(vbid);
+        return false;
+    }
+    file->size += record.size();
+    return true;
+}
+
+std::optional<DurabilityLog::Batch> DurabilityLog::read(Vbid vbid) {
+    // Writes are only ever appended by the Flusher; drop our handle so the
+    // next write picks up the size of the file as read here
+    closeFile(vbid);
+
+    const auto fname = getFileName(vbid);
+    std::string data;
+    if (!cb::io::isFile(fname) || !folly::readFile(fname.c_str(), data)) {
+        return {};
+    }
+
+    // Find the last complete record
+    std::string_view remaining(data);
+    std::optional<std::string_view> last;
+    while (remaining.size() >= RecordHeaderSize) {
+        const auto length = getLE(remaining.data(), 4);
+        const auto crc = uint32_t(getLE(remaining.data() + 4, 4));
+        if (remaining.size() - RecordHeaderSize < length) {
+            break;
+        }
+        const auto payload = remaining.substr(RecordHeaderSize, length);
+        if (checksum(payload) != crc) {
+            break;
+        }
+        last = payload;
+        remaining.remove_prefix(RecordHeaderSize + length);
+    }
+
+    if (!remaining.empty()) {
+        EP_LOG_INFO(
+                "DurabilityLog::read: {} ignoring {} bytes of incomplete "
+                "record at the end of '{}'",
+                vbid,
+                remaining.size(),
+                fname);
+    }
+    if (!last) {
+        return {};
+    }
+
+    try {
+        auto batch = deserialise(*last);
+        for (auto& item : batch.items) {
+            item->setVBucketId(vbid);
+        }
+        return batch;
+    } catch (const std::exception& e) {
+        EP_LOG_WARN("DurabilityLog::read: {} invalid record in '{}': {}",
+                    vbid,
+                    fname,
+                    e.what());
+        return {};
+    }
+}
+
+void DurabilityLog::remove(Vbid vbid) {
+    closeFile(vbid);
+    const auto fname = getFileName(vbid);
+    if (cb::io::isFile(fname) && ::remove(fname.c_str()) != 0) {
+        EP_LOG_WARN("DurabilityLog::remove: {} failed to remove '{}': {}",
+                    vbid,
+                    fname,
+                    strerror(errno));
+    }
+}
+
+std::string DurabilityLog::serialise(uint64_t baseSeqno,
+                                     const vbucket_state& vbstate,
+                                     const std::vector<queued_item>& items) {
+    const auto state = nlohmann::json(vbstate).dump();
+
+    std::string out;
+    putLE(out, RecordMagic, 4);
+    putLE(out, RecordVersion, 4);
+    putLE(out, baseSeqno, 8);
+    putLE(out, state.size(), 4);
+    out.append(state);
+    putLE(out, items.size(), 4);
+
+    for (const auto& item : items) {
+        uint8_t flags = 0;
+        uint8_t deleteSource = 0;
+        if (item->isDeleted()) {
+            flags |= ItemDeleted;
+            deleteSource = uint8_t(item->deletionSource());
+        }
+        if (item->isPending() &&
+            item->getCommitted() == CommittedState::PreparedMaybeVisible) {
+            flags |= ItemMaybeVisible;
+        }
+        if (item->getValue()) {
+            flags |= ItemHasValue;
+        }
+
+        const auto& key = item->getKey();
+        putLE(out, uint8_t(item->getOperation()), 1);
+        putLE(out, flags, 1);
+        putLE(out, deleteSource, 1);
+        putLE(out, uint8_t(item->getDurabilityReqs().getLevel()), 1);
+        putLE(out, item->getBySeqno(), 8);
+        putLE(out, item->getPrepareSeqno(), 8);
+        putLE(out, item->getRevSeqno(), 8);
+        putLE(out, item->getCas(), 8);
+        putLE(out, item->getFlags(), 4);
+        putLE(out, uint32_t(item->getExptime()), 4);
+        putLE(out, item->getDataType(), 1);
+        putLE(out, key.size(), 2);
+        out.append(reinterpret_cast<const char*>(key.data()), key.size());
+        putLE(out, item->getNBytes(), 4);
+        out.append(item->getData(), item->getNBytes());
+    }
+    return out;
+}
+
+DurabilityLog::Batch DurabilityLog::deserialise(std::string_view data) {
+    RecordReader in(data);
+    if (in.get(4) != RecordMagic || in.get(4) != RecordVersion) {
+        throw std::invalid_argument(
+                "DurabilityLog::deserialise: unknown magic or version");
+    }
+
+    Batch batch;
+    batch.baseSeqno = in.get(8);
+    const auto stateLength = in.get(4);
+    batch.vbstate = nlohmann::json::parse(std::string(in.take(stateLength)))
+                            .get<vbucket_state>();
+
+    const auto count = in.get(4);
+    for (uint64_t ii = 0; ii < count; ++ii) {
+        const auto op = queue_op(in.get(1));
+        const auto flags = uint8_t(in.get(1));
+        const auto deleteSource = DeleteSource(in.get(1));
+        const auto level = cb::durability::Level(in.get(1));
+        const auto bySeqno = int64_t(in.get(8));
+        const auto prepareSeqno = int64_t(in.get(8));
+        const auto revSeqno = in.get(8);
+        const auto cas = in.get(8);
+        const auto itemFlags = uint32_t(in.get(4));
+        const auto exptime = time_t(in.get(4));
+        const auto datatype = protocol_binary_datatype_t(in.get(1));
+        const auto key = in.take(in.get(2));
+        const auto value = in.take(in.get(4));
+
+        const DocKey docKey(reinterpret_cast<const uint8_t*>(key.data()),
+                            key.size(),
+                            DocKeyEncodesCollectionId::Yes);
+        queued_item item;
+        if (flags & ItemHasValue) {
+            item = make_STRCPtr<Item>(docKey,
+                                      itemFlags,
+                                      exptime,
+                                      value.data(),
+                                      value.size(),
+                                      datatype,
+                                      cas,
+                                      bySeqno,
+                                      Vbid(0),
+                                      revSeqno);
+        } else {
+            item = make_STRCPtr<Item>(docKey,
+                                      itemFlags,
+                                      exptime,
+                                      value_t{},
+                                      datatype,
+                                      cas,
+                                      bySeqno,
+                                      Vbid(0),
+                                      revSeqno);
+        }
+
+        switch (op) {
+        case queue_op::mutation:
+            break;
+        case queue_op::pending_sync_write:
+            // As on disk, the timeout of the prepare isn't kept
+            item->setPendingSyncWrite(
+                    {level, cb::durability::Timeout::Infinity()});
+            if (flags & ItemMaybeVisible) {
+                item->setPreparedMaybeVisible();
+            }
+            break;
+        case queue_op::commit_sync_write:
+            item->setCommittedviaPrepareSyncWrite();
+            item->setPrepareSeqno(prepareSeqno);
+            break;
+        case queue_op::abort_sync_write:
+            item->setAbortSyncWrite();
+            item->setPrepareSeqno(prepareSeqno);
+            break;
+        default:
+            throw std::invalid_argument(
+                    "DurabilityLog::deserialise: unexpected op:" +
+                    std::to_string(int(op)));
+        }
+        if (flags & ItemDeleted) {
+            item->setDeleted(deleteSource);
+        }
+        batch.items.push_back(std::move(item));
+    }
+
+    if (!in.empty()) {
+        throw std::invalid_argument(
+                "DurabilityLog::deserialise: trailing data in record");
+    }
+    return batch;
+}
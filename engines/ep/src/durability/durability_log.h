@@ -0,0 +1,122 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "item.h"
+#include "vbucket_state.h"
+
+#include <memcached/vbucket.h>
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * An append-only log of the flush batches holding prepared SyncWrites which
+ * must be persisted (PersistToMajority / MajorityAndPersistOnMaster), with
+ * one file per vBucket. The log is meant to live on a separate, low latency
+ * device.
+ *
+ * The Flusher writes (and syncs) such a batch to the log before committing
+ * it to the vBucket file. Once written, every mutation of the vBucket up to
+ * the highest seqno of the batch can be recovered, so the DurabilityMonitor
+ * is notified of the persistence straight away rather than after the
+ * (slower) commit to the vBucket file.
+ *
+ * Each record is tagged with the high seqno of the vBucket file the batch
+ * applies on top of. A record is only replayed (during Warmup) if the
+ * vBucket file is still at that seqno, i.e. the commit of the batch didn't
+ * complete; older records are obsolete.
+ */
+class DurabilityLog {
+public:
+    /// A flush batch read back from the log
+    struct Batch {
+        /// The high seqno of the vBucket file the batch applies on top of
+        uint64_t baseSeqno = 0;
+        /// The vbucket_state committed along with the batch
+        vbucket_state vbstate;
+        /// The items of the batch, as given to KVStore::set/del
+        std::vector<queued_item> items;
+    };
+
+    /// The size above which the file of a vBucket is truncated on write
+    static constexpr size_t MaxFileSize = 64 * 1024 * 1024;
+
+    /// @param dir the directory of the log files (created if missing)
+    explicit DurabilityLog(std::string dir);
+
+    ~DurabilityLog();
+
+    DurabilityLog(const DurabilityLog&) = delete;
+    DurabilityLog& operator=(const DurabilityLog&) = delete;
+
+    /**
+     * Append the flush batch to the log of the vBucket and sync it.
+     *
+     * Must only be called by the Flusher of the vBucket: all the batches
+     * already in the file must have been committed to the vBucket file.
+     *
+     * @return true if the batch is durable (a failure is logged)
+     */
+    bool write(Vbid vbid,
+               uint64_t baseSeqno,
+               const vbucket_state& vbstate,
+               const std::vector<queued_item>& items);
+
+    /**
+     * @return the last valid batch written to the log of the vBucket, or an
+     *         empty optional if there is none
+     */
+    std::optional<Batch> read(Vbid vbid);
+
+    /// Delete the log of the vBucket (e.g. on rollback or vBucket deletion)
+    void remove(Vbid vbid);
+
+    std::string getFileName(Vbid vbid) const;
+
+    /// Serialise a batch into a record of the log
+    static std::string serialise(uint64_t baseSeqno,
+                                 const vbucket_state& vbstate,
+                                 const std::vector<queued_item>& items);
+
+    /**
+     * Recreate the batch of the record previously written by serialise().
+     * @throws std::invalid_argument if data is not a valid record
+     */
+    static Batch deserialise(std::string_view data);
+
+private:
+    struct File {
+        int fd;
+        size_t size;
+    };
+
+    /// @return the vBucket's log opened for appending, or nullptr
+    File* getFile(Vbid vbid);
+
+    void closeFile(Vbid vbid);
+
+    const std::string dir;
+
+    std::mutex mutex;
+    /// The files opened for appending, by vBucket
+    std::unordered_map<Vbid, File> files;
+};
@@ -192,6 +192,11 @@ public:
      */
     bool isExpired(std::chrono::steady_clock::time_point asOf) const;
 
+    /// @return the time after which this SyncWrite is expired, if any
+    std::optional<std::chrono::steady_clock::time_point> getExpiryTime() const {
+        return expiryTime;
+    }
+
     /**
      * Reset the ack-state for this SyncWrite and set it up for the new
      * given topology. In general, checkDurabilityPossibleAndResetTopology
@@ -496,6 +501,13 @@ struct ActiveDurabilityMonitor::State {
     void removeExpired(std::chrono::steady_clock::time_point asOf,
                        ResolvedQueue& expired);
 
+    /**
+     * @return the expiry-time of the first tracked SyncWrite, if any. Given
+     *     SyncWrites complete In-Order, that is the only deadline at which
+     *     removeExpired() can make progress.
+     */
+    std::optional<std::chrono::steady_clock::time_point> getNextExpiry() const;
+
     /// @returns the name of the active node. Assumes the first chain is valid.
     const std::string& getActive() const;
 
@@ -710,6 +722,10 @@ public:
     // debugging.
     Monotonic<int64_t> highCompletedSeqno{0};
 
+    // The next expiry last reported to the VBucket's SyncWriteExpiryCallback,
+    // used to only notify the DurabilityTimeoutTask when it changes.
+    std::optional<std::chrono::steady_clock::time_point> notifiedExpiry;
+
     // Cumulative count of accepted (tracked) SyncWrites.
     size_t totalAccepted = 0;
     // Cumulative count of Committed SyncWrites.
@@ -138,6 +138,9 @@ void PassiveDurabilityMonitor::addStats(const AddStatFn& addStat,
         checked_snprintf(buf, sizeof(buf), "vb_%d:high_completed_seqno", vbid);
         add_casted_stat(buf, getHighCompletedSeqno(), addStat, cookie);
 
+        checked_snprintf(buf, sizeof(buf), "vb_%d:high_received_seqno", vbid);
+        add_casted_stat(buf, getHighReceivedSeqno(), addStat, cookie);
+
     } catch (const std::exception& e) {
         EP_LOG_WARN(
                 "PassiveDurabilityMonitor::addStats: error building stats: {}",
@@ -255,6 +258,36 @@ void PassiveDurabilityMonitor::notifySnapshotEndReceived(uint64_t snapEnd) {
     sendSeqnoAck();
 }
 
+void PassiveDurabilityMonitor::notifyPrepareReceived(
+        int64_t seqno, cb::durability::Level level) {
+    const auto hps = getHighPreparedSeqno();
+    { // receivedPrepares locking scope
+        auto received = receivedPrepares.wlock();
+        auto& fences = received->fences;
+        while (!fences.empty() && fences.front() <= hps) {
+            fences.pop();
+        }
+
+        if (level != cb::durability::Level::Majority) {
+            // Acking anything from here on would claim that this Prepare
+            // is locally-satisfied too
+            fences.push(seqno);
+            return;
+        }
+        if (!fences.empty()) {
+            return;
+        }
+        received->highReceivedSeqno = seqno;
+    }
+
+    storeSeqnoAck(hps, seqno);
+    sendSeqnoAck();
+}
+
+int64_t PassiveDurabilityMonitor::getHighReceivedSeqno() const {
+    return receivedPrepares.rlock()->highReceivedSeqno;
+}
+
 void PassiveDurabilityMonitor::notifyLocalPersistence() {
     { // state locking scope
         auto s = state.wlock();
@@ -271,20 +304,21 @@ void PassiveDurabilityMonitor::notifyLocalPersistence() {
 
 void PassiveDurabilityMonitor::storeSeqnoAck(int64_t prevHps, int64_t newHps) {
     if (prevHps != newHps) {
-        auto seqno = seqnoToAck.wlock();
-        if (*seqno < newHps) {
-            *seqno = newHps;
+        auto ack = seqnoAck.wlock();
+        if (ack->toAck < newHps) {
+            ack->toAck = newHps;
         }
     }
 }
 
 void PassiveDurabilityMonitor::sendSeqnoAck() {
     // Hold the lock throughout to ensure that we do not race with another ack
-    auto seqno = seqnoToAck.wlock();
-    if (*seqno != 0) {
-        vb.sendSeqnoAck(*seqno);
+    auto ack = seqnoAck.wlock();
+    if (ack->toAck > ack->lastSent) {
+        vb.sendSeqnoAck(ack->toAck);
+        ack->lastSent = ack->toAck;
     }
-    *seqno = 0;
+    ack->toAck = 0;
 }
 
 std::string PassiveDurabilityMonitor::to_string(Resolution res) {
@@ -606,7 +640,7 @@ void PassiveDurabilityMonitor::State::updateHighPreparedSeqno() {
         const auto snapshotEnd = receivedSnapshotEnds.front();
 
         const bool snapshotFullyPersisted =
-                static_cast<int64_t>(pdm.vb.getPersistenceSeqno()) >=
+                static_cast<int64_t>(pdm.vb.getDurablePersistenceSeqno()) >=
                 snapshotEnd.seqno;
 
         const bool isDiskSnapshot = snapshotEnd.type == CheckpointType::Disk;
@@ -21,7 +21,9 @@
 #include "storeddockey_fwd.h"
 
 #include <folly/SynchronizedPtr.h>
+#include <memcached/durability_spec.h>
 #include <optional>
+#include <queue>
 
 #include <vector>
 
@@ -174,6 +176,24 @@ public:
      */
     void notifySnapshotEndReceived(uint64_t snapEnd);
 
+    /**
+     * Notify this PDM that a Prepare has been received (but not necessarily
+     * processed yet) by the PassiveStream of the owning VBucket as part of a
+     * memory snapshot.
+     * Majority Prepares are acked to the Active straight away rather than
+     * when the snapshot-end is received, unless a Prepare of any other level
+     * received before them hasn't been locally-satisfied yet.
+     *
+     * @param seqno The seqno of the Prepare
+     * @param level The durability level of the Prepare
+     */
+    void notifyPrepareReceived(int64_t seqno, cb::durability::Level level);
+
+    /**
+     * @return the highest seqno acked by notifyPrepareReceived()
+     */
+    int64_t getHighReceivedSeqno() const;
+
     /**
      * Notify this PDM that some persistence has happened. Attempts to update
      * the HPS and ack back to the active.
@@ -229,8 +249,25 @@ protected:
     struct State;
     folly::SynchronizedPtr<std::unique_ptr<State>> state;
 
-    /// Outstanding seqno ack to send to the active. 0 if no ack outstanding
-    folly::Synchronized<int64_t> seqnoToAck{0};
+    struct SeqnoAck {
+        /// Outstanding seqno ack to send to the active. 0 if no ack
+        /// outstanding
+        int64_t toAck{0};
+        /// The highest seqno acked so far; acks are never sent backwards (an
+        /// early ack may be ahead of the HPS)
+        int64_t lastSent{0};
+    };
+    folly::Synchronized<SeqnoAck> seqnoAck;
+
+    struct ReceivedPrepares {
+        /// The highest Prepare seqno acked on receive
+        int64_t highReceivedSeqno{0};
+        /// The seqnos of the received non-Majority Prepares which may not
+        /// yet be locally-satisfied. No Prepare after the first of them
+        /// can be acked on receive.
+        std::queue<int64_t> fences;
+    };
+    folly::Synchronized<ReceivedPrepares> receivedPrepares;
 
     // Necessary for implementing ADM(PDM&&)
     friend class ActiveDurabilityMonitor;
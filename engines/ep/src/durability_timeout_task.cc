@@ -17,9 +17,12 @@
 
 #include "durability_timeout_task.h"
 #include "ep_engine.h"
+#include "executorpool.h"
 #include "kv_bucket.h"
+#include "vbucket.h"
 
 #include <phosphor/phosphor.h>
+#include <climits>
 
 class DurabilityTimeoutTask::ConfigChangeListener
     : public ValueChangedListener {
@@ -39,20 +42,104 @@ private:
 };
 
 DurabilityTimeoutTask::DurabilityTimeoutTask(EventuallyPersistentEngine& engine,
-                                             std::chrono::milliseconds interval)
+                                             std::chrono::milliseconds interval,
+                                             bool eventDriven)
     : GlobalTask(&engine,
                  TaskId::DurabilityTimeoutTask,
                  0 /*initial sleep-time in seconds*/,
                  false /*completeBeforeShutdown*/),
+      eventDriven(eventDriven),
+      scheduledFor(std::chrono::steady_clock::now()),
       sleepTime(interval) {
     engine.getConfiguration().addValueChangedListener(
             "durability_timeout_task_interval",
             std::make_unique<ConfigChangeListener>(*this));
 }
 
+/// @return the given time as the seconds from now expected by snooze()
+static double secondsUntil(std::chrono::steady_clock::time_point tp) {
+    const auto delay = tp - std::chrono::steady_clock::now();
+    return std::max(
+            0.0,
+            std::chrono::duration_cast<std::chrono::duration<double>>(delay)
+                    .count());
+}
+
 bool DurabilityTimeoutTask::run() {
     TRACE_EVENT0("ep-engine/task", "DurabilityTimeoutTask");
 
+    if (eventDriven) {
+        runEventDriven();
+    } else {
+        runPolling();
+    }
+
+    // Schedule again if not shutting down
+    return !engine->getEpStats().isShutdown;
+}
+
+void DurabilityTimeoutTask::updateNextExpiry(
+        Vbid vbid, std::chrono::steady_clock::time_point expiry) {
+    std::lock_guard<std::mutex> lh(deadlinesMutex);
+    auto it = vbDeadlines.find(vbid);
+    if (it != vbDeadlines.end()) {
+        if (it->second->first <= expiry) {
+            // Already due no later than that
+            return;
+        }
+        deadlines.erase(it->second);
+        it->second = deadlines.emplace(expiry, vbid);
+    } else {
+        vbDeadlines.emplace(vbid, deadlines.emplace(expiry, vbid));
+    }
+
+    if (expiry < scheduledFor) {
+        // Note: Rescheduled under deadlinesMutex so that concurrent updates
+        // (and runEventDriven) cannot leave the task scheduled for a later
+        // deadline than the earliest one.
+        scheduledFor = expiry;
+        ExecutorPool::get()->snooze(getId(), secondsUntil(expiry));
+    }
+}
+
+void DurabilityTimeoutTask::runEventDriven() {
+    const auto now = std::chrono::steady_clock::now();
+
+    std::vector<Vbid> due;
+    {
+        std::lock_guard<std::mutex> lh(deadlinesMutex);
+        // Deadlines notified while we run are picked up below, no need to
+        // reschedule the (running) task for them.
+        scheduledFor = now;
+        // Note: As per ActiveSyncWrite::isExpired(), a SyncWrite is expired
+        // only once its expiry-time is strictly before asOf.
+        while (!deadlines.empty() && deadlines.begin()->first < now) {
+            const auto vbid = deadlines.begin()->second;
+            due.push_back(vbid);
+            vbDeadlines.erase(vbid);
+            deadlines.erase(deadlines.begin());
+        }
+    }
+
+    // Each ActiveDM reports its next expiry-time again from processTimeout().
+    for (const auto vbid : due) {
+        auto vb = engine->getVBucket(vbid);
+        if (vb) {
+            vb->processDurabilityTimeout(now);
+        }
+    }
+
+    std::lock_guard<std::mutex> lh(deadlinesMutex);
+    if (deadlines.empty()) {
+        scheduledFor = std::chrono::steady_clock::time_point::max();
+        snooze(INT_MAX);
+    } else {
+        scheduledFor = deadlines.begin()->first;
+        snooze(secondsUntil(scheduledFor));
+    }
+}
+
+void DurabilityTimeoutTask::runPolling() {
     // @todo: A meaningful value will be the P99.99
     const auto maxExpectedDurationForVisitorTask =
             std::chrono::milliseconds(100);
@@ -68,9 +155,6 @@ bool DurabilityTimeoutTask::run() {
     snooze(std::chrono::duration_cast<std::chrono::duration<double>>(
                    sleepTime.load())
                    .count());
-
-    // Schedule again if not shutting down
-    return !engine->getEpStats().isShutdown;
 }
 
 void DurabilityTimeoutVisitor::visitBucket(const VBucketPtr& vb) {
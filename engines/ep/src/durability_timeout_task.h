@@ -18,10 +18,25 @@
 
 #include "globaltask.h"
 #include "vb_visitors.h"
+#include <memcached/vbucket.h>
 #include <platform/atomic_duration.h>
 
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
 /*
  * Enforces the Durability Timeout for the SyncWrites tracked in this KVBucket.
+ *
+ * Runs in one of two modes (durability_timeout_mode):
+ *
+ * - polling: every `interval` visits all vBuckets, each checking its tracked
+ *   SyncWrites for expired ones.
+ * - event-driven: each vBucket's ActiveDM reports the expiry-time of its next
+ *   SyncWrite to time out (SyncWrites complete In-Order, so only the first
+ *   tracked one can time out next) via updateNextExpiry(). The task keeps
+ *   those deadlines ordered, sleeps until the earliest one and then only
+ *   processes the vBuckets which are due.
  */
 class DurabilityTimeoutTask : public GlobalTask {
 public:
@@ -29,9 +44,13 @@ public:
 
     /**
      * @param engine The engine that will be visited
+     * @param interval Interval between runs in polling mode
+     * @param eventDriven Sleep until the earliest notified deadline rather
+     *     than visiting all vBuckets every interval
      */
     DurabilityTimeoutTask(EventuallyPersistentEngine& engine,
-                          std::chrono::milliseconds interval);
+                          std::chrono::milliseconds interval,
+                          bool eventDriven);
 
     bool run() override;
 
@@ -50,7 +69,41 @@ public:
         sleepTime = value;
     }
 
+    /**
+     * Event-driven mode: Notifies the task that the given vBucket has a
+     * SyncWrite which expires at the given time. If earlier than the time the
+     * task is currently scheduled for, the task is rescheduled for it.
+     *
+     * A vBucket keeps the earliest deadline it was notified with until the
+     * task processes it, so a stale (earlier) deadline only costs a spurious
+     * visit - at which the ActiveDM reports its actual next expiry.
+     */
+    void updateNextExpiry(Vbid vbid,
+                          std::chrono::steady_clock::time_point expiry);
+
 private:
+    /// Polling mode: visit all vBuckets, then sleep for sleepTime.
+    void runPolling();
+
+    /// Event-driven mode: process the due vBuckets, then sleep until the
+    /// earliest pending deadline.
+    void runEventDriven();
+
+    const bool eventDriven;
+
+    using Deadlines =
+            std::multimap<std::chrono::steady_clock::time_point, Vbid>;
+
+    std::mutex deadlinesMutex;
+
+    // Event-driven mode: The pending vBucket deadlines, earliest first...
+    Deadlines deadlines;
+    // ... and the entry in deadlines of each vBucket (at most one).
+    std::unordered_map<Vbid, Deadlines::iterator> vbDeadlines;
+    // The time the task is currently scheduled to run at; a new deadline only
+    // reschedules the task if earlier.
+    std::chrono::steady_clock::time_point scheduledFor;
+
     // Note: this is the actual minimum interval between subsequent runs.
     // The VBCBAdaptor (which is the actual task that executes this Visitor)
     // has its internal sleep-time which is used for a different purpose,
@@ -18,11 +18,14 @@
 #include "ep_bucket.h"
 
 #include "bgfetcher.h"
+#include "bloomfilter.h"
 #include "bucket_logger.h"
 #include "checkpoint_manager.h"
+#include "compaction_throttle.h"
 #include "collections/manager.h"
 #include "collections/vbucket_manifest_handles.h"
 #include "dcp/dcpconnmap.h"
+#include "durability/durability_log.h"
 #include "ep_engine.h"
 #include "ep_time.h"
 #include "ep_vb.h"
@@ -30,6 +33,7 @@
 #include "failover-table.h"
 #include "flusher.h"
 #include "item.h"
+#include "meta_bounds.h"
 #include "persistence_callback.h"
 #include "replicationthrottle.h"
 #include "rollback_result.h"
@@ -40,12 +44,16 @@
 #include "vbucket_state.h"
 #include "warmup.h"
 
+#include <platform/dirutils.h>
 #include <platform/timeutils.h>
 #include <utilities/hdrhistogram.h>
 #include <utilities/logtags.h>
 
 #include <gsl.h>
 
+#include <cstring>
+#include <optional>
+#include <unordered_set>
 #include <utility>
 
 /**
@@ -178,7 +186,9 @@ bool BloomFilterCallback::initTempFilter(Vbid vbucketId) {
         estimated_count = initial_estimation;
     }
 
-    vb->initTempFilter(estimated_count, config.getBfilterFpProb());
+    vb->initTempFilter(estimated_count,
+                       config.getBfilterFpProb(),
+                       bloomFilterTypeFromString(config.getBfilterType()));
 
     return true;
 }
@@ -208,7 +218,7 @@ public:
 
     void callback(Vbid& vb) override {
         if (shard->getBucket(vb)) {
-            shard->getFlusher()->notifyFlushEvent(vb);
+            shard->getFlusher(vb)->notifyFlushEvent(vb);
         }
     }
 
@@ -224,6 +234,16 @@ public:
     void sizeValueChanged(const std::string& key, size_t value) override {
         if (key == "flusher_total_batch_limit") {
             bucket.setFlusherBatchSplitTrigger(value);
+        } else if (key == "flusher_group_commit_vbuckets") {
+            bucket.setFlusherGroupCommitVBuckets(value);
+        } else if (key == "compaction_bg_fetch_target") {
+            bucket.compactionThrottle->setBgFetchLatencyTarget(
+                    std::chrono::microseconds(value));
+        } else if (key == "compaction_dirty_age_target") {
+            bucket.compactionThrottle->setDirtyAgeTarget(
+                    std::chrono::microseconds(value));
+        } else if (key == "compaction_throttle_min_rate") {
+            bucket.compactionThrottle->setMinRate(value);
         } else if (key == "alog_sleep_time") {
             bucket.setAccessScannerSleeptime(value, false);
         } else if (key == "alog_task_time") {
@@ -270,11 +290,34 @@ EPBucket::EPBucket(EventuallyPersistentEngine& theEngine)
             "flusher_total_batch_limit",
             std::make_unique<ValueChangedListener>(*this));
 
+    setFlusherGroupCommitVBuckets(config.getFlusherGroupCommitVbuckets());
+    config.addValueChangedListener(
+            "flusher_group_commit_vbuckets",
+            std::make_unique<ValueChangedListener>(*this));
+
+    compactionThrottle = std::make_unique<CompactionThrottle>(stats);
+    compactionThrottle->setBgFetchLatencyTarget(
+            std::chrono::microseconds(config.getCompactionBgFetchTarget()));
+    compactionThrottle->setDirtyAgeTarget(
+            std::chrono::microseconds(config.getCompactionDirtyAgeTarget()));
+    compactionThrottle->setMinRate(config.getCompactionThrottleMinRate());
+    for (const auto* key : {"compaction_bg_fetch_target",
+                            "compaction_dirty_age_target",
+                            "compaction_throttle_min_rate"}) {
+        config.addValueChangedListener(
+                key, std::make_unique<ValueChangedListener>(*this));
+    }
+
     retainErroneousTombstones = config.isRetainErroneousTombstones();
     config.addValueChangedListener(
             "retain_erroneous_tombstones",
             std::make_unique<ValueChangedListener>(*this));
 
+    if (!config.getDurabilityLogPath().empty()) {
+        durabilityLog = std::make_unique<DurabilityLog>(cb::io::sanitizePath(
+                config.getDurabilityLogPath() + "/" + engine.getName()));
+    }
+
     initializeWarmupTask();
 }
 
@@ -296,6 +339,14 @@ bool EPBucket::initialize() {
     }
     startFlusher();
 
+    const auto balanceInterval =
+            engine.getConfiguration().getFlusherBalanceInterval();
+    if (balanceInterval > 0 &&
+        vbMap.getShard(EP_PRIMARY_SHARD)->getNumFlushers() > 1) {
+        ExecutorPool::get()->schedule(std::make_shared<FlusherBalancerTask>(
+                *this, std::chrono::seconds(balanceInterval)));
+    }
+
     return true;
 }
 
@@ -313,9 +364,159 @@ std::vector<ExTask> EPBucket::deinitialize() {
     stopFlusher();
     stopBgFetcher();
     stopWarmup();
+    if (!stats.forceShutdown && engine.getConfiguration().isBfilterPersist()) {
+        saveBloomFilters();
+    }
+    if (!stats.forceShutdown &&
+        engine.getConfiguration().getXdcrMetaBoundsSize() != 0) {
+        saveMetaBounds();
+    }
     return KVBucket::deinitialize();
 }
 
+std::string EPBucket::getBloomFilterFileName(Vbid vbid) const {
+    return cb::io::sanitizePath(engine.getConfiguration().getDbname() +
+                                "/bloomfilter." + std::to_string(vbid.get()));
+}
+
+/**
+ * Write a file holding the persisted seqno (little-endian) followed by the
+ * payload. Written to a temporary file and renamed so a partial write is
+ * never loaded.
+ *
+ * @return true if the file was written (a failure is logged)
+ */
+static bool saveSeqnoTaggedFile(const char* caller,
+                                Vbid vbid,
+                                const std::string& fname,
+                                uint64_t seqno,
+                                std::string_view payload) {
+    std::string data;
+    for (int ii = 0; ii < 8; ++ii) {
+        data.push_back(char(seqno >> (ii * 8)));
+    }
+    data.append(payload);
+
+    const auto tmpname = fname + ".tmp";
+    FILE* fp = fopen(tmpname.c_str(), "wb");
+    if (fp == nullptr) {
+        EP_LOG_WARN("{}: {} failed to open '{}': {}",
+                    caller,
+                    vbid,
+                    tmpname,
+                    strerror(errno));
+        return false;
+    }
+    const bool written = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    const bool closed = fclose(fp) == 0;
+    if (!written || !closed || rename(tmpname.c_str(), fname.c_str()) != 0) {
+        EP_LOG_WARN("{}: {} failed to write '{}': {}",
+                    caller,
+                    vbid,
+                    fname,
+                    strerror(errno));
+        remove(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Strip the seqno written by saveSeqnoTaggedFile() from the file data.
+ *
+ * @return the payload, or an empty optional if the seqno doesn't match
+ * @throws std::invalid_argument if the data is too short
+ */
+static std::optional<std::string_view> checkSeqnoTag(const char* caller,
+                                                     std::string_view data,
+                                                     uint64_t persistedSeqno) {
+    if (data.size() < sizeof(uint64_t)) {
+        throw std::invalid_argument(std::string(caller) +
+                                    ": data too short for seqno");
+    }
+    uint64_t seqno = 0;
+    for (int ii = 0; ii < 8; ++ii) {
+        seqno |= uint64_t(uint8_t(data[ii])) << (ii * 8);
+    }
+    if (seqno != persistedSeqno) {
+        // vBucket has been modified since the file was saved (e.g. an
+        // unclean shutdown followed a previous clean one).
+        return {};
+    }
+    return data.substr(sizeof(uint64_t));
+}
+
+void EPBucket::saveBloomFilters() {
+    size_t saved = 0;
+    for (const auto vbid : vbMap.getBuckets()) {
+        auto vb = getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        auto filter = vb->serialiseFilter();
+        if (filter.empty()) {
+            continue;
+        }
+        if (saveSeqnoTaggedFile("EPBucket::saveBloomFilters",
+                                vbid,
+                                getBloomFilterFileName(vbid),
+                                vb->getPersistenceSeqno(),
+                                filter)) {
+            ++saved;
+        }
+    }
+    EP_LOG_INFO("EPBucket::saveBloomFilters: saved {} bloom filters", saved);
+}
+
+std::unique_ptr<BloomFilter> EPBucket::loadBloomFilter(
+        std::string_view data, uint64_t persistedSeqno) {
+    const auto payload =
+            checkSeqnoTag("EPBucket::loadBloomFilter", data, persistedSeqno);
+    if (!payload) {
+        return {};
+    }
+    return BloomFilter::deserialise(*payload);
+}
+
+std::string EPBucket::getMetaBoundsFileName(Vbid vbid) const {
+    return cb::io::sanitizePath(engine.getConfiguration().getDbname() +
+                                "/metabounds." + std::to_string(vbid.get()));
+}
+
+void EPBucket::saveMetaBounds() {
+    size_t saved = 0;
+    for (const auto vbid : vbMap.getBuckets()) {
+        auto vb = getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        const auto bounds = vb->serialiseMetaBounds();
+        if (bounds.empty()) {
+            continue;
+        }
+        if (saveSeqnoTaggedFile("EPBucket::saveMetaBounds",
+                                vbid,
+                                getMetaBoundsFileName(vbid),
+                                vb->getPersistenceSeqno(),
+                                bounds)) {
+            ++saved;
+        }
+    }
+    EP_LOG_INFO("EPBucket::saveMetaBounds: saved the meta bounds of {} "
+                "vBuckets",
+                saved);
+}
+
+std::unique_ptr<MetaBounds> EPBucket::loadMetaBounds(std::string_view data,
+                                                     uint64_t persistedSeqno) {
+    const auto payload =
+            checkSeqnoTag("EPBucket::loadMetaBounds", data, persistedSeqno);
+    if (!payload) {
+        return {};
+    }
+    return MetaBounds::deserialise(*payload);
+}
+
 /**
  * @returns true if the item `candidate` can be de-duplicated (skipped) because
  * `lastFlushed` already supercedes it.
@@ -341,7 +542,67 @@ static bool canDeDuplicate(Item* lastFlushed, Item& candidate) {
     return true;
 }
 
+struct EPBucket::GroupCommit::PendingFlush {
+    LockedVBucketPtr vb;
+    UniqueFlushHandle flushHandle;
+    snapshot_range_t range;
+    std::chrono::steady_clock::time_point flushStart;
+    size_t flushBatchSize;
+    VBucket::AggregatedFlushStats aggStats;
+    std::unique_ptr<VB::Commit> commitData;
+};
+
+EPBucket::GroupCommit::GroupCommit() = default;
+
+EPBucket::GroupCommit::~GroupCommit() {
+    // Flushes not completed by completeGroupCommit() are retried.
+    for (auto& flush : flushes) {
+        flush.flushHandle->markFlushFailed();
+    }
+}
+
+size_t EPBucket::GroupCommit::size() const {
+    return flushes.size();
+}
+
 EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
+    return flushVBucket(vbid, nullptr);
+}
+
+EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid, GroupCommit& group) {
+    return flushVBucket(vbid, &group);
+}
+
+std::vector<Vbid> EPBucket::completeGroupCommit(GroupCommit& group) {
+    std::vector<Vbid> failed;
+    if (group.flushes.empty()) {
+        return failed;
+    }
+
+    if (!group.kvstore->endGroupCommit()) {
+        // None of the group's flush-batches can be assumed durable; reset
+        // the pcursors so the flusher re-attempts all of them.
+        for (auto& flush : group.flushes) {
+            flush.flushHandle->markFlushFailed();
+            failed.push_back(flush.vb->getId());
+        }
+        group.flushes.clear();
+        return failed;
+    }
+
+    for (auto& flush : group.flushes) {
+        flushPersisted(*flush.vb,
+                       flush.range,
+                       flush.flushStart,
+                       flush.flushBatchSize,
+                       flush.aggStats,
+                       flush.commitData->collections);
+    }
+    group.flushes.clear();
+    return failed;
+}
+
+EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid, GroupCommit* group) {
     const auto flushStart = std::chrono::steady_clock::now();
 
     auto vb = getLockedVBucket(vbid, std::try_to_lock);
@@ -389,7 +650,10 @@ EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
     KVStore* rwUnderlying = getRWUnderlying(vb->getId());
 
     while (!rwUnderlying->begin(
-            std::make_unique<EPTransactionContext>(stats, *vb))) {
+            std::make_unique<EPTransactionContext>(
+                    stats,
+                    *vb,
+                    collectionsManager->getEvictOnPersistCollections()))) {
         ++stats.beginFailed;
         EP_LOG_WARN(
                 "Failed to start a transaction!!! "
@@ -413,8 +677,10 @@ EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
         vbstate = *persistedVbState;
     }
 
-    VB::Commit commitData(vb->getManifest(), vbstate);
-    vbucket_state& proposedVBState = commitData.proposedVBState;
+    // Heap allocated as it outlives this call if the flush is completed by a
+    // group commit.
+    auto commitData = std::make_unique<VB::Commit>(vb->getManifest(), vbstate);
+    vbucket_state& proposedVBState = commitData->proposedVBState;
 
     // We need to set a few values from the in-memory state.
     uint64_t maxSeqno = 0;
@@ -468,6 +734,14 @@ EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
 
     VBucket::AggregatedFlushStats aggStats;
 
+    // The items given to the KVStore, if the flush-batch may be written to
+    // the DurabilityLog. That's only worth doing if it holds a Prepare which
+    // waits for persistence; batches with system events are never logged as
+    // the replay doesn't update the collections metadata.
+    std::vector<queued_item> logItems;
+    bool canLog = durabilityLog && persistedVbState;
+    bool mustLog = false;
+
     // Iterate through items, checking if we (a) can skip persisting,
     // (b) can de-duplicate as the previous key was the same, or (c)
     // actually need to persist.
@@ -507,6 +781,12 @@ EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
             Expects(item->getBySeqno() > 0);
             hps = std::max(hps.value_or(0),
                            static_cast<uint64_t>(item->getBySeqno()));
+            mustLog |= item->getDurabilityReqs().getLevel() !=
+                       cb::durability::Level::Majority;
+        }
+
+        if (item->isSystemEvent()) {
+            canLog = false;
         }
 
         if (op == queue_op::set_vbucket_state) {
@@ -548,6 +828,9 @@ EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
             }
 
             flushOneDelOrSet(item, vb.getVB());
+            if (canLog) {
+                logItems.push_back(item);
+            }
 
             maxSeqno = std::max(maxSeqno, (uint64_t)item->getBySeqno());
 
@@ -695,7 +978,7 @@ EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
         // Also, when we re-attempt to flush a set-vbstate item we may fail
         // again because of the optimization at
         // vbucket_state::needsToBePersisted().
-        if (!rwUnderlying->snapshotVBucket(vbid, commitData.proposedVBState)) {
+        if (!rwUnderlying->snapshotVBucket(vbid, proposedVBState)) {
             // @todo: MB-36773, vbstate update is not retried
 
             // Flush failed, we need to reset the pcursor to the original
@@ -707,14 +990,14 @@ EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
         }
 
         // Update in-memory vbstate
-        rwUnderlying->setVBucketState(vbid, commitData.proposedVBState);
+        rwUnderlying->setVBucketState(vbid, proposedVBState);
 
         // The new vbstate was the only thing to flush. All done.
         flushSuccessEpilogue(*vb,
                              flushStart,
                              0 /*itemsFlushed*/,
                              aggStats,
-                             commitData.collections);
+                             commitData->collections);
 
         return {moreAvailable, 0, wakeupCheckpointRemover};
     }
@@ -738,8 +1021,37 @@ EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
         const auto rangesToRelease = std::move(toFlush.ranges);
     }
 
+    if (canLog && mustLog) {
+        // Once in the log the batch survives a crash (it's replayed by
+        // warmup), so the Prepares are locally persisted: notify the DM
+        // without waiting for the commit to the vBucket file.
+        if (durabilityLog->write(vbid,
+                                 static_cast<uint64_t>(vbstate.highSeqno),
+                                 proposedVBState,
+                                 logItems)) {
+            ++stats.durabilityLogWrites;
+            vb->setDurabilityLogSeqno(maxSeqno);
+            vb->notifyPersistenceToDurabilityMonitor();
+        } else {
+            // The Prepares are satisfied by the commit, as without the log
+            ++stats.durabilityLogWriteFailed;
+        }
+    }
+    logItems.clear();
+
+    if (group && !rwUnderlying->supportsGroupCommit()) {
+        group = nullptr;
+    }
+    if (group) {
+        if (!group->kvstore) {
+            group->kvstore = rwUnderlying;
+            rwUnderlying->beginGroupCommit();
+        }
+        Expects(group->kvstore == rwUnderlying);
+    }
+
     // Persist the flush-batch.
-    const auto flushSuccess = commit(vbid, *rwUnderlying, commitData);
+    const auto flushSuccess = commit(vbid, *rwUnderlying, *commitData);
 
     if (!flushSuccess) {
         // Flush failed, we need to reset the pcursor to the original
@@ -753,11 +1065,43 @@ EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
     // Note: We want to update the snap-range only if we have flushed at least
     // one item. I.e. don't appear to be in a snap when you have no data for it
     Expects(range.has_value());
-    vb->setPersistedSnapshot(*range);
 
-    uint64_t highSeqno = rwUnderlying->getLastPersistedSeqno(vbid);
-    if (highSeqno > 0 && highSeqno != vb->getPersistenceSeqno()) {
-        vb->setPersistenceSeqno(highSeqno);
+    if (group) {
+        // The flush-batch is not durable until the group's barrier has been
+        // issued; defer everything which exposes it as persisted.
+        group->flushes.push_back({std::move(vb),
+                                  std::move(toFlush.flushHandle),
+                                  *range,
+                                  flushStart,
+                                  flushBatchSize,
+                                  aggStats,
+                                  std::move(commitData)});
+        return {moreAvailable, flushBatchSize, wakeupCheckpointRemover};
+    }
+
+    flushPersisted(*vb,
+                   *range,
+                   flushStart,
+                   flushBatchSize,
+                   aggStats,
+                   commitData->collections);
+
+    return {moreAvailable, flushBatchSize, wakeupCheckpointRemover};
+}
+
+void EPBucket::flushPersisted(
+        VBucket& vb,
+        const snapshot_range_t& range,
+        const std::chrono::steady_clock::time_point flushStart,
+        size_t itemsFlushed,
+        const VBucket::AggregatedFlushStats& aggStats,
+        const Collections::VB::Flush& collectionFlush) {
+    const auto vbid = vb.getId();
+    vb.setPersistedSnapshot(range);
+
+    uint64_t highSeqno = getRWUnderlying(vbid)->getLastPersistedSeqno(vbid);
+    if (highSeqno > 0 && highSeqno != vb.getPersistenceSeqno()) {
+        vb.setPersistenceSeqno(highSeqno);
     }
 
     // Notify the local DM that the Flusher has run. Persistence
@@ -792,19 +1136,14 @@ EPBucket::FlushResult EPBucket::flushVBucket(Vbid vbid) {
     //     So, given that here we are executing in a slow bg-thread
     //     (write+sync to disk), then we can just afford to calling
     //     back to the DM unconditionally.
-    vb->notifyPersistenceToDurabilityMonitor();
+    vb.notifyPersistenceToDurabilityMonitor();
 
-    flushSuccessEpilogue(*vb,
-                         flushStart,
-                         flushBatchSize /*itemsFlushed*/,
-                         aggStats,
-                         commitData.collections);
+    flushSuccessEpilogue(
+            vb, flushStart, itemsFlushed, aggStats, collectionFlush);
 
     // Handle Seqno Persistence requests
-    vb->notifyHighPriorityRequests(
-            engine, vb->getPersistenceSeqno(), HighPriorityVBNotify::Seqno);
-
-    return {moreAvailable, flushBatchSize, wakeupCheckpointRemover};
+    vb.notifyHighPriorityRequests(
+            engine, vb.getPersistenceSeqno(), HighPriorityVBNotify::Seqno);
 }
 
 void EPBucket::handleCheckpointPersistence(VBucket& vb) const {
@@ -866,6 +1205,14 @@ size_t EPBucket::getFlusherBatchSplitTrigger() {
     return flusherBatchSplitTrigger;
 }
 
+void EPBucket::setFlusherGroupCommitVBuckets(size_t value) {
+    flusherGroupCommitVBuckets = std::max(size_t(1), value);
+}
+
+size_t EPBucket::getFlusherGroupCommitVBuckets() const {
+    return flusherGroupCommitVBuckets;
+}
+
 bool EPBucket::commit(Vbid vbid, KVStore& kvstore, VB::Commit& commitData) {
     BlockTimer timer(&stats.diskCommitHisto, "disk_commit", stats.timingLog);
     auto commit_start = std::chrono::steady_clock::now();
@@ -890,38 +1237,118 @@ bool EPBucket::commit(Vbid vbid, KVStore& kvstore, VB::Commit& commitData) {
     return res;
 }
 
+std::optional<vbucket_state> EPBucket::replayDurabilityLog(
+        Vbid vbid, const vbucket_state& persisted) {
+    if (!durabilityLog) {
+        return {};
+    }
+    auto batch = durabilityLog->read(vbid);
+    if (!batch) {
+        return {};
+    }
+    if (batch->baseSeqno != static_cast<uint64_t>(persisted.highSeqno)) {
+        // The batch was committed to the vBucket file
+        durabilityLog->remove(vbid);
+        return {};
+    }
+
+    KVStore* rwUnderlying = getRWUnderlying(vbid);
+    if (!rwUnderlying->begin(std::make_unique<TransactionContext>(vbid))) {
+        EP_LOG_WARN(
+                "EPBucket::replayDurabilityLog: {} failed to start a "
+                "transaction",
+                vbid);
+        return {};
+    }
+    uint64_t highSeqno = 0;
+    for (const auto& item : batch->items) {
+        if (item->isDeleted() && !item->isPending()) {
+            rwUnderlying->del(item);
+        } else {
+            rwUnderlying->set(item);
+        }
+        highSeqno = std::max(highSeqno, uint64_t(item->getBySeqno()));
+    }
+
+    std::unique_ptr<Collections::VB::Manifest> manifest;
+    if (engine.getConfiguration().isCollectionsEnabled()) {
+        manifest = std::make_unique<Collections::VB::Manifest>(
+                rwUnderlying->getCollectionsManifest(vbid));
+    } else {
+        manifest = std::make_unique<Collections::VB::Manifest>();
+    }
+    VB::Commit commitData(*manifest, batch->vbstate);
+    if (!commit(vbid, *rwUnderlying, commitData)) {
+        // Leave the log in place for the next warmup
+        EP_LOG_CRITICAL(
+                "EPBucket::replayDurabilityLog: {} failed to commit the "
+                "{} items of the durability log up to seqno:{}",
+                vbid,
+                batch->items.size(),
+                highSeqno);
+        return {};
+    }
+    durabilityLog->remove(vbid);
+
+    EP_LOG_INFO(
+            "EPBucket::replayDurabilityLog: {} committed the {} items of the "
+            "durability log from seqno:{} to seqno:{}",
+            vbid,
+            batch->items.size(),
+            batch->baseSeqno,
+            highSeqno);
+    return commitData.proposedVBState;
+}
+
 void EPBucket::startFlusher() {
     for (const auto& shard : vbMap.shards) {
-        shard->getFlusher()->start();
+        shard->forEachFlusher([](Flusher& flusher) { flusher.start(); });
     }
 }
 
+size_t EPBucket::balanceFlushers() {
+    size_t moved = 0;
+    for (const auto& shard : vbMap.shards) {
+        moved += shard->balanceFlushers();
+    }
+    if (moved > 0) {
+        EP_LOG_INFO("EPBucket::balanceFlushers: moved {} vBuckets between "
+                    "flushers",
+                    moved);
+    }
+    return moved;
+}
+
 void EPBucket::stopFlusher() {
     for (const auto& shard : vbMap.shards) {
-        auto* flusher = shard->getFlusher();
-        EP_LOG_INFO(
-                "Attempting to stop the flusher for "
-                "shard:{}",
-                shard->getId());
-        bool rv = flusher->stop(stats.forceShutdown);
-        if (rv && !stats.forceShutdown) {
-            flusher->wait();
-        }
+        shard->forEachFlusher([this, &shard](Flusher& flusher) {
+            EP_LOG_INFO(
+                    "Attempting to stop the flusher for "
+                    "shard:{} lane:{}",
+                    shard->getId(),
+                    flusher.getLane());
+            bool rv = flusher.stop(stats.forceShutdown);
+            if (rv && !stats.forceShutdown) {
+                flusher.wait();
+            }
+        });
     }
 }
 
 bool EPBucket::pauseFlusher() {
     bool rv = true;
     for (const auto& shard : vbMap.shards) {
-        auto* flusher = shard->getFlusher();
-        if (!flusher->pause()) {
-            EP_LOG_WARN(
-                    "Attempted to pause flusher in state "
-                    "[{}], shard = {}",
-                    flusher->stateName(),
-                    shard->getId());
-            rv = false;
-        }
+        shard->forEachFlusher([&rv, &shard](Flusher& flusher) {
+            if (!flusher.pause()) {
+                EP_LOG_WARN(
+                        "Attempted to pause flusher in state "
+                        "[{}], shard = {}, lane = {}",
+                        flusher.stateName(),
+                        shard->getId(),
+                        flusher.getLane());
+                rv = false;
+            }
+        });
     }
     return rv;
 }
@@ -929,15 +1356,17 @@ bool EPBucket::pauseFlusher() {
 bool EPBucket::resumeFlusher() {
     bool rv = true;
     for (const auto& shard : vbMap.shards) {
-        auto* flusher = shard->getFlusher();
-        if (!flusher->resume()) {
-            EP_LOG_WARN(
-                    "Attempted to resume flusher in state [{}], "
-                    "shard = {}",
-                    flusher->stateName(),
-                    shard->getId());
-            rv = false;
-        }
+        shard->forEachFlusher([&rv, &shard](Flusher& flusher) {
+            if (!flusher.resume()) {
+                EP_LOG_WARN(
+                        "Attempted to resume flusher in state [{}], "
+                        "shard = {}, lane = {}",
+                        flusher.stateName(),
+                        shard->getId(),
+                        flusher.getLane());
+                rv = false;
+            }
+        });
     }
     return rv;
 }
@@ -945,7 +1374,7 @@ bool EPBucket::resumeFlusher() {
 void EPBucket::wakeUpFlusher() {
     if (stats.diskQueueSize.load() == 0) {
         for (const auto& shard : vbMap.shards) {
-            shard->getFlusher()->wake();
+            shard->forEachFlusher([](Flusher& flusher) { flusher.wake(); });
         }
     }
 }
@@ -979,7 +1408,8 @@ void EPBucket::stopBgFetcher() {
 
 ENGINE_ERROR_CODE EPBucket::scheduleCompaction(Vbid vbid,
                                                const CompactionConfig& c,
-                                               const void* cookie) {
+                                               const void* cookie,
+                                               std::chrono::seconds delay) {
     ENGINE_ERROR_CODE errCode = checkForDBExistence(c.db_file_id);
     if (errCode != ENGINE_SUCCESS) {
         return errCode;
@@ -992,10 +1422,19 @@ ENGINE_ERROR_CODE EPBucket::scheduleCompaction(Vbid vbid,
     }
 
     LockHolder lh(compactionLock);
+    if (delay.count() > 0 &&
+        !deferredCompactions.insert(c.db_file_id).second) {
+        // A deferred compaction of the vBucket has yet to start, it will
+        // cover this request too.
+        return ENGINE_SUCCESS;
+    }
+
     ExTask task = std::make_shared<CompactTask>(
             *this, c, vb->getPurgeSeqno(), cookie);
     compactionTasks.push_back(std::make_pair(c.db_file_id, task));
-    if (compactionTasks.size() > 1) {
+    if (delay.count() > 0) {
+        task->snooze(delay.count());
+    } else if (compactionTasks.size() > 1) {
         if ((stats.diskQueueSize > compactionWriteQueueCap &&
              compactionTasks.size() > (vbMap.getNumShards() / 2)) ||
             engine.getWorkLoadPolicy().getWorkLoadPattern() == READ_HEAVY) {
@@ -1130,6 +1569,10 @@ std::shared_ptr<compaction_ctx> EPBucket::makeCompactionContext(
                                   std::placeholders::_3,
                                   std::placeholders::_4);
 
+    ctx->writeThrottle = [throttle = compactionThrottle.get()](size_t bytes) {
+        throttle->beforeWrite(bytes);
+    };
+
     ctx->completionCallback = std::bind(&EPBucket::compactionCompletionCallback,
                                         this,
                                         std::placeholders::_1);
@@ -1169,7 +1612,8 @@ void EPBucket::compactInternal(std::unique_lock<std::mutex>& vbLock,
             "purged tombstones:{}, prepares:{}, "
             "collection_items_erased:alive:{},deleted:{}, "
             "size/items/tombstones/purge_seqno pre{{{}, {}, {}, {}}}, "
-            "post{{{}, {}, {}, {}}}",
+            "post{{{}, {}, {}, {}}}, "
+            "copy/commit/swap time{{{}, {}, {}}}",
             config.db_file_id,
             result ? "ok" : "failed",
             ctx->stats.tombstonesPurged,
@@ -1183,7 +1627,10 @@ void EPBucket::compactInternal(std::unique_lock<std::mutex>& vbLock,
             ctx->stats.post.size,
             ctx->stats.post.items,
             ctx->stats.post.deletedItems,
-            ctx->stats.post.purgeSeqno);
+            ctx->stats.post.purgeSeqno,
+            cb::time2text(ctx->stats.copyDuration),
+            cb::time2text(ctx->stats.commitDuration),
+            cb::time2text(ctx->stats.swapDuration));
 }
 
 bool EPBucket::doCompact(CompactionConfig& config,
@@ -1198,6 +1645,13 @@ bool EPBucket::doCompact(CompactionConfig& config,
         return true;
     }
 
+    {
+        // From here on a deferred request must schedule another compaction,
+        // this one may already have read what it is going to purge.
+        LockHolder lh(compactionLock);
+        deferredCompactions.erase(vbid);
+    }
+
     if (vb) {
         compactInternal(vb.getLock(), config, purgeSeqno);
     } else if (cookie) {
@@ -1227,7 +1681,8 @@ void EPBucket::updateCompactionTasks(Vbid db_file_id) {
         if ((*it).first == db_file_id) {
             it = compactionTasks.erase(it);
             erased = true;
-        } else {
+        } else if (deferredCompactions.count((*it).first) == 0) {
+            // Deferred compactions are left to sleep out their delay.
             ExTask& task = (*it).second;
             if (task->getState() == TASK_SNOOZED) {
                 ExecutorPool::get()->wake(task->getId());
@@ -1269,6 +1724,17 @@ ENGINE_ERROR_CODE EPBucket::getFileStats(StatCollector& collector) {
     return ENGINE_SUCCESS;
 }
 
+void EPBucket::getCompactionThrottleStats(StatCollector& collector) const {
+    using namespace cb::stats;
+    collector.addStat(Key::ep_compaction_throttle_state,
+                      CompactionThrottle::to_string(
+                              compactionThrottle->getState()));
+    collector.addStat(Key::ep_compaction_write_rate_limit,
+                      compactionThrottle->getRateLimit());
+    collector.addStat(Key::ep_compaction_write_rate,
+                      compactionThrottle->getWriteRate());
+}
+
 ENGINE_ERROR_CODE EPBucket::getPerVBucketDiskStats(const void* cookie,
                                                    const AddStatFn& add_stat) {
     class DiskStatVisitor : public VBucketVisitor {
@@ -1330,31 +1796,36 @@ VBucketPtr EPBucket::makeVBucket(
     // 1. make_shared doesn't accept a Deleter
     // 2. allocate_shared has inconsistencies between platforms in calling
     //    alloc.destroy (libc++ doesn't call it)
-    return VBucketPtr(new EPVBucket(id,
-                                    state,
-                                    stats,
-                                    engine.getCheckpointConfig(),
-                                    shard,
-                                    lastSeqno,
-                                    lastSnapStart,
-                                    lastSnapEnd,
-                                    std::move(table),
-                                    flusherCb,
-                                    std::move(newSeqnoCb),
-                                    makeSyncWriteResolvedCB(),
-                                    makeSyncWriteCompleteCB(),
-                                    makeSeqnoAckCB(),
-                                    engine.getConfiguration(),
-                                    eviction_policy,
-                                    std::move(manifest),
-                                    initState,
-                                    purgeSeqno,
-                                    maxCas,
-                                    hlcEpochSeqno,
-                                    mightContainXattrs,
-                                    replicationTopology,
-                                    maxVisibleSeqno),
-                      VBucket::DeferredDeleter(engine));
+    VBucketPtr vb(new EPVBucket(id,
+                                state,
+                                stats,
+                                engine.getCheckpointConfig(),
+                                shard,
+                                lastSeqno,
+                                lastSnapStart,
+                                lastSnapEnd,
+                                std::move(table),
+                                flusherCb,
+                                std::move(newSeqnoCb),
+                                makeSyncWriteResolvedCB(),
+                                makeSyncWriteCompleteCB(),
+                                makeSeqnoAckCB(),
+                                engine.getConfiguration(),
+                                eviction_policy,
+                                std::move(manifest),
+                                initState,
+                                purgeSeqno,
+                                maxCas,
+                                hlcEpochSeqno,
+                                mightContainXattrs,
+                                replicationTopology,
+                                maxVisibleSeqno),
+                  VBucket::DeferredDeleter(engine));
+    vb->setSyncWriteCompleteBatchCallback(makeSyncWriteCompleteBatchCB());
+    vb->setSyncWriteExpiryCallback(makeSyncWriteExpiryCB());
+    vb->setSeqnoWaitersNotifyCallback(makeSeqnoWaitersNotifyCB());
+    vb->ht.setValueDeduplicator(valueDeduplicator);
+    return vb;
 }
 
 ENGINE_ERROR_CODE EPBucket::statsVKey(const DocKey& key,
@@ -1569,7 +2040,23 @@ private:
     uint64_t rollbackSeqno;
 };
 
+void EPBucket::vbucketDropped(Vbid vbid) {
+    if (durabilityLog) {
+        durabilityLog->remove(vbid);
+    }
+}
+
 RollbackResult EPBucket::doRollback(Vbid vbid, uint64_t rollbackSeqno) {
+    if (durabilityLog) {
+        // The logged batch (if any) mustn't be replayed over the rolled back
+        // vBucket file
+        durabilityLog->remove(vbid);
+        auto vb = getVBucket(vbid);
+        if (vb) {
+            vb->setDurabilityLogSeqno(0);
+        }
+    }
+
     KVStore* rwUnderlying = vbMap.getShardByVbId(vbid)->getRWUnderlying();
     auto result = rwUnderlying->rollback(
             vbid,
@@ -1581,6 +2068,13 @@ RollbackResult EPBucket::doRollback(Vbid vbid, uint64_t rollbackSeqno) {
 void EPBucket::rollbackUnpersistedItems(VBucket& vb, int64_t rollbackSeqno) {
     std::vector<queued_item> items;
 
+    // The committed items are reverted to their state on disk, which only
+    // needs to be read once per key, and through a single handle on the
+    // rolled back file rather than opening it for every item
+    auto* kvstore = getROUnderlying(vb.getId());
+    auto fileHandle = kvstore->makeFileHandle(vb.getId());
+    std::unordered_set<StoredDocKey> reverted;
+
     // Iterate until we have no more items for the persistence cursor
     CheckpointManager::ItemsForCursor itemsForCursor;
     do {
@@ -1627,8 +2121,16 @@ void EPBucket::rollbackUnpersistedItems(VBucket& vb, int64_t rollbackSeqno) {
             }
 
             // Committed items only past this point
-            GetValue gcb = getROUnderlying(vb.getId())
-                                   ->get(DiskDocKey{*item}, vb.getId());
+            if (!reverted.insert(item->getKey()).second) {
+                continue;
+            }
+            GetValue gcb =
+                    fileHandle
+                            ? kvstore->getWithHeader(*fileHandle,
+                                                     DiskDocKey{*item},
+                                                     vb.getId(),
+                                                     GetMetaOnly::No)
+                            : kvstore->get(DiskDocKey{*item}, vb.getId());
 
             if (gcb.getStatus() == ENGINE_SUCCESS) {
                 vb.setFromInternal(*gcb.item.get());
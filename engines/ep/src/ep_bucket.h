@@ -19,6 +19,13 @@
 
 #include "kv_bucket.h"
 
+#include <optional>
+#include <unordered_set>
+
+class BloomFilter;
+class MetaBounds;
+class CompactionThrottle;
+class DurabilityLog;
 namespace Collections::VB {
 class Flush;
 }
@@ -27,6 +34,7 @@ class Commit;
 }
 enum class ValueFilter;
 struct compaction_ctx;
+struct vbucket_state;
 
 /**
  * Eventually Persistent Bucket
@@ -72,6 +80,49 @@ public:
      */
     FlushResult flushVBucket(Vbid vbid);
 
+    /**
+     * The vBucket flushes of a group commit. Each flush-batch is written to
+     * the KVStore as it is flushed, but a single durability barrier is issued
+     * for the whole group by completeGroupCommit(); until then the flushes
+     * are not exposed as persisted and their vBuckets remain locked.
+     */
+    class GroupCommit {
+    public:
+        GroupCommit();
+        ~GroupCommit();
+
+        /// @return the number of flushes pending completion
+        size_t size() const;
+
+    private:
+        friend class EPBucket;
+        struct PendingFlush;
+
+        /// The KVStore the group is committing to (all flushes of a group
+        /// must be to the same KVStore)
+        KVStore* kvstore = nullptr;
+        std::vector<PendingFlush> flushes;
+    };
+
+    /**
+     * Flushes the items waiting for persistence in a given vbucket as part of
+     * the given group commit. If the underlying KVStore does not support group
+     * commit the flush is completed immediately, as flushVBucket(Vbid).
+     *
+     * @param vbid The id of the vbucket to flush
+     * @param group The group commit to add the flush to
+     * @return an instance of FlushResult, which assumes the group commit
+     *         will succeed
+     */
+    FlushResult flushVBucket(Vbid vbid, GroupCommit& group);
+
+    /**
+     * Make all of the flushes of a group commit durable and complete them.
+     *
+     * @return the vBuckets whose flush failed and must be retried
+     */
+    std::vector<Vbid> completeGroupCommit(GroupCommit& group);
+
     /**
      * Set the number of flusher items which can be included in a
      * single flusher commit. For more details see flusherBatchSplitTrigger
@@ -81,6 +132,11 @@ public:
 
     size_t getFlusherBatchSplitTrigger();
 
+    /// Set the max number of vBuckets a Flusher may group into one commit.
+    void setFlusherGroupCommitVBuckets(size_t value);
+
+    size_t getFlusherGroupCommitVBuckets() const;
+
     /**
      * Persist whatever flush-batch previously queued into KVStore.
      *
@@ -97,6 +153,13 @@ public:
     /// Stop the Flusher for all shards in this bucket.
     void stopFlusher();
 
+    /**
+     * Rebalance the vBuckets of each shard between the shard's Flushers by
+     * their recent flush load.
+     * @return the number of vBuckets moved to another Flusher
+     */
+    size_t balanceFlushers();
+
     bool pauseFlusher() override;
     bool resumeFlusher() override;
 
@@ -111,9 +174,11 @@ public:
     /// Stops the background fetcher for each shard.
     void stopBgFetcher();
 
-    ENGINE_ERROR_CODE scheduleCompaction(Vbid vbid,
-                                         const CompactionConfig& c,
-                                         const void* ck) override;
+    ENGINE_ERROR_CODE scheduleCompaction(
+            Vbid vbid,
+            const CompactionConfig& c,
+            const void* ck,
+            std::chrono::seconds delay = std::chrono::seconds(0)) override;
 
     ENGINE_ERROR_CODE cancelCompaction(Vbid vbid) override;
 
@@ -134,6 +199,25 @@ public:
 
     ENGINE_ERROR_CODE getFileStats(StatCollector& collector) override;
 
+    /// Add the state of the compaction write throttle to the collector.
+    void getCompactionThrottleStats(StatCollector& collector) const;
+
+    /// @returns the bucket's DurabilityLog, or nullptr if it is disabled
+    DurabilityLog* getDurabilityLog() const {
+        return durabilityLog.get();
+    }
+
+    /**
+     * Commit the flush batch left in the DurabilityLog of the vBucket, if
+     * the previous run of the bucket stopped before committing it to the
+     * vBucket file. Called by warmup before the VBucket is created.
+     *
+     * @param persisted the vbucket_state read from the vBucket file
+     * @return the new state of the vBucket file if a batch was replayed
+     */
+    std::optional<vbucket_state> replayDurabilityLog(
+            Vbid vbid, const vbucket_state& persisted);
+
     ENGINE_ERROR_CODE getPerVBucketDiskStats(
             const void* cookie, const AddStatFn& add_stat) override;
     /**
@@ -267,6 +351,51 @@ protected:
 
     void stopWarmup();
 
+    /// @returns the path of the file the given vBucket's bloom filter is
+    /// persisted to at shutdown.
+    std::string getBloomFilterFileName(Vbid vbid) const;
+
+    /**
+     * Write the bloom filter of every vBucket to disk (one file per
+     * vBucket, see getBloomFilterFileName), tagged with the vBucket's
+     * persisted high seqno, so they can be reloaded by the next warmup.
+     * Called on clean shutdown once the flushers have stopped.
+     */
+    void saveBloomFilters();
+
+    /**
+     * Parse the contents of a bloom filter file written by
+     * saveBloomFilters().
+     * @param data file contents
+     * @param persistedSeqno the vBucket's persisted high seqno; the filter is
+     *        only valid if it was saved at this seqno.
+     * @return the filter, or nullptr if it is stale.
+     * @throws std::invalid_argument if the data is malformed.
+     */
+    static std::unique_ptr<BloomFilter> loadBloomFilter(
+            std::string_view data, uint64_t persistedSeqno);
+
+    /// @returns the path of the file the given vBucket's meta bounds are
+    /// persisted to at shutdown.
+    std::string getMetaBoundsFileName(Vbid vbid) const;
+
+    /**
+     * Write the meta bounds (see MetaBounds) of every vBucket which has
+     * them to disk, in the same way as saveBloomFilters().
+     */
+    void saveMetaBounds();
+
+    /**
+     * Parse the contents of a meta bounds file written by saveMetaBounds().
+     * @param data file contents
+     * @param persistedSeqno the vBucket's persisted high seqno; the bounds
+     *        are only valid if they were saved at this seqno.
+     * @return the bounds, or nullptr if they are stale.
+     * @throws std::invalid_argument if the data is malformed.
+     */
+    static std::unique_ptr<MetaBounds> loadMetaBounds(std::string_view data,
+                                                      uint64_t persistedSeqno);
+
     /// function which is passed down to compactor for dropping keys
     virtual void dropKey(Vbid vbid,
                          const DiskDocKey& key,
@@ -288,6 +417,26 @@ protected:
      */
     void handleCheckpointPersistence(VBucket& vb) const;
 
+    FlushResult flushVBucket(Vbid vbid, GroupCommit* group);
+
+    /**
+     * Performs the operations which expose a flush-batch as persisted, once
+     * it has been durably committed.
+     *
+     * @param vb
+     * @param range The snapshot range flushed
+     * @param flushStart Used for updating stats
+     * @param itemsFlushed Used for updating stats
+     * @param aggStats Used for updating stats
+     * @param collectionFlush Used for performing collection-related operations
+     */
+    void flushPersisted(VBucket& vb,
+                        const snapshot_range_t& range,
+                        const std::chrono::steady_clock::time_point flushStart,
+                        size_t itemsFlushed,
+                        const VBucket::AggregatedFlushStats& aggStats,
+                        const Collections::VB::Flush& collectionFlush);
+
     /**
      * Performs operations that must be performed after flush succeeds,
      * regardless of whether we flush non-meta items or a new vbstate only.
@@ -308,6 +457,9 @@ protected:
     bool isValidBucketDurabilityLevel(
             cb::durability::Level level) const override;
 
+    /// A logged flush batch must never be replayed into a new vBucket
+    void vbucketDropped(Vbid vbid) override;
+
     /**
      * Setup shards.
      */
@@ -323,12 +475,37 @@ protected:
      */
     std::atomic<size_t> flusherBatchSplitTrigger;
 
+    /**
+     * Max number of vBuckets whose flushes a Flusher groups into a single
+     * group commit; 1 disables group commit.
+     */
+    std::atomic<size_t> flusherGroupCommitVBuckets{1};
+
     /**
      * Indicates whether erroneous tombstones need to retained or not during
      * compaction
      */
     cb::RelaxedAtomic<bool> retainErroneousTombstones;
 
+    /**
+     * Limits the rate of compaction writes to keep front-end latency under
+     * the configured targets; shared by all of the bucket's compactions.
+     */
+    std::unique_ptr<CompactionThrottle> compactionThrottle;
+
+    /**
+     * Log of the flush batches holding prepared SyncWrites which must be
+     * persisted, written before they are committed to the vBucket files.
+     * Null unless durability_log_path is set.
+     */
+    std::unique_ptr<DurabilityLog> durabilityLog;
+
+    /**
+     * vBuckets with a deferred compaction scheduled but not yet started.
+     * Guarded by compactionLock.
+     */
+    std::unordered_set<Vbid> deferredCompactions;
+
     std::unique_ptr<Warmup> warmupTask;
 };
 
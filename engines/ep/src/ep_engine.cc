@@ -44,20 +44,22 @@
 #include "hash_table_stat_visitor.h"
 #include "htresizer.h"
 #include "kvstore.h"
+#include "range_scan.h"
 #include "replicationthrottle.h"
 #include "server_document_iface_border_guard.h"
 #include "statistics/collector.h"
 #include "stats-info.h"
 #include "string_utils.h"
 #include "trace_helpers.h"
+#include "value_deduplicator.h"
 #include "vb_count_visitor.h"
 #include "warmup.h"
 
-#include <JSON_checker.h>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <logger/logger.h>
+#include <mcbp/protocol/unsigned_leb128.h>
 #include <memcached/audit_interface.h>
 #include <memcached/engine.h>
 #include <memcached/limits.h>
@@ -76,9 +78,12 @@
 #include <statistics/prometheus.h>
 #include <utilities/engine_errc_2_mcbp.h>
 #include <utilities/hdrhistogram.h>
+#include <utilities/json_validator.h>
 #include <utilities/logtags.h>
 #include <xattr/utils.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstring>
 #include <fstream>
@@ -327,6 +332,21 @@ cb::EngineErrorItemPair EventuallyPersistentEngine::get(
     return cb::makeEngineErrorItemPair(cb::engine_errc(ret), itm, this);
 }
 
+void EventuallyPersistentEngine::prefetch(
+        gsl::not_null<const void*> cookie,
+        const std::vector<std::pair<Vbid, DocKey>>& keys) {
+    acquireEngine(this)->getKVBucket()->prefetch(keys);
+}
+
+std::optional<uint64_t> EventuallyPersistentEngine::getDocumentGeneration(
+        gsl::not_null<const void*> cookie, const DocKey& key, Vbid vbucket) {
+    if (!frontendGetCache) {
+        return {};
+    }
+    return acquireEngine(this)->getKVBucket()->getDocumentGeneration(key,
+                                                                     vbucket);
+}
+
 cb::EngineErrorItemPair EventuallyPersistentEngine::get_if(
         gsl::not_null<const void*> cookie,
         const DocKey& key,
@@ -409,13 +429,23 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::get_prometheus_stats(
     try {
         if (cardinality == cb::prometheus::Cardinality::High) {
             doTimingStats(collector);
-            // TODO: collection stats
+            doDcpLatencyStats(collector);
+            doTaskTimingStats(collector);
+            doMemoryBreakdownStats(collector, true /* perVBucket */);
+            Collections::Manager::doCollectionAccessStats(*kvBucket,
+                                                          collector);
+            // TODO: remaining collection stats
             // TODO: scope stats
         } else {
             if (ENGINE_ERROR_CODE status = doEngineStats(collector);
                 status != ENGINE_SUCCESS) {
                 return status;
             }
+            if (ENGINE_ERROR_CODE status =
+                        doMemoryBreakdownStats(collector, false);
+                status != ENGINE_SUCCESS) {
+                return status;
+            }
         }
     } catch (const std::bad_alloc&) {
         return ENGINE_ENOMEM;
@@ -469,6 +499,39 @@ cb::EngineErrorCasPair EventuallyPersistentEngine::store_if(
             cookie, item, cas, operation, predicate, preserveTtl);
 }
 
+void EventuallyPersistentEngine::store_multi(
+        gsl::not_null<const void*> cookie,
+        Vbid vbucket,
+        const std::vector<item*>& items,
+        std::vector<cb::EngineErrorCasPair>& results) {
+    acquireEngine(this)->storeMultiInner(cookie, vbucket, items, results);
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::arithmetic(
+        gsl::not_null<const void*> cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        bool increment,
+        uint64_t delta,
+        uint64_t& result,
+        uint64_t& cas,
+        mutation_descr_t& mutation) {
+    return acquireEngine(this)->arithmeticInner(
+            cookie, key, vbucket, increment, delta, result, cas, mutation);
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::appendPrepend(
+        gsl::not_null<const void*> cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        bool append,
+        std::string_view value,
+        uint64_t& cas,
+        mutation_descr_t& mutation) {
+    return acquireEngine(this)->appendPrependInner(
+            cookie, key, vbucket, append, value, cas, mutation);
+}
+
 void EventuallyPersistentEngine::reset_stats(
         gsl::not_null<const void*> cookie) {
     acquireEngine(this)->resetStats();
@@ -630,6 +693,10 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setExpPagerStime(std::stoull(val));
         } else if (key == "exp_pager_initial_run_time") {
             getConfiguration().setExpPagerInitialRunTime(std::stoll(val));
+        } else if (key == "expiry_pager_concurrency") {
+            getConfiguration().setExpiryPagerConcurrency(std::stoull(val));
+        } else if (key == "flusher_group_commit_vbuckets") {
+            getConfiguration().setFlusherGroupCommitVbuckets(std::stoull(val));
         } else if (key == "flusher_total_batch_limit") {
             getConfiguration().setFlusherTotalBatchLimit(std::stoll(val));
         } else if (key == "getl_default_timeout") {
@@ -663,6 +730,12 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setPagerActiveVbPcnt(std::stoull(val));
         } else if (key == "pager_sleep_time_ms") {
             getConfiguration().setPagerSleepTimeMs(std::stoull(val));
+        } else if (key == "concurrent_pagers") {
+            getConfiguration().setConcurrentPagers(std::stoull(val));
+        } else if (key == "vbucket_stats_cache_ttl_ms") {
+            getConfiguration().setVbucketStatsCacheTtlMs(std::stoull(val));
+        } else if (key == "get_keys_max_response_size") {
+            getConfiguration().setGetKeysMaxResponseSize(std::stoull(val));
         } else if (key == "item_eviction_age_percentage") {
             getConfiguration().setItemEvictionAgePercentage(std::stoull(val));
         } else if (key == "item_eviction_freq_counter_age_threshold") {
@@ -713,6 +786,10 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setItemCompressorInterval(v);
         } else if (key == "item_compressor_chunk_duration") {
             getConfiguration().setItemCompressorChunkDuration(std::stoull(val));
+        } else if (key == "item_compressor_freq_threshold") {
+            getConfiguration().setItemCompressorFreqThreshold(std::stoull(val));
+        } else if (key == "item_compressor_sample_rate") {
+            getConfiguration().setItemCompressorSampleRate(std::stoull(val));
         } else if (key == "defragmenter_age_threshold") {
             getConfiguration().setDefragmenterAgeThreshold(std::stoull(val));
         } else if (key == "defragmenter_chunk_duration") {
@@ -720,12 +797,32 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
         } else if (key == "defragmenter_stored_value_age_threshold") {
             getConfiguration().setDefragmenterStoredValueAgeThreshold(
                     std::stoull(val));
+        } else if (key == "defragmenter_fragmentation_threshold") {
+            getConfiguration().setDefragmenterFragmentationThreshold(
+                    std::stof(val));
+        } else if (key == "defragmenter_auto_interval") {
+            getConfiguration().setDefragmenterAutoInterval(cb_stob(val));
+        } else if (key == "defragmenter_sparse_slabs_only") {
+            getConfiguration().setDefragmenterSparseSlabsOnly(cb_stob(val));
         } else if (key == "defragmenter_run") {
             runDefragmenterTask();
+        } else if (key == "compaction_bg_fetch_target") {
+            getConfiguration().setCompactionBgFetchTarget(std::stoull(val));
+        } else if (key == "compaction_dirty_age_target") {
+            getConfiguration().setCompactionDirtyAgeTarget(std::stoull(val));
+        } else if (key == "compaction_throttle_min_rate") {
+            getConfiguration().setCompactionThrottleMinRate(std::stoull(val));
         } else if (key == "compaction_write_queue_cap") {
             getConfiguration().setCompactionWriteQueueCap(std::stoull(val));
+        } else if (key == "collections_drop_compaction_delay") {
+            getConfiguration().setCollectionsDropCompactionDelay(
+                    std::stoull(val));
         } else if (key == "chk_expel_enabled") {
             getConfiguration().setChkExpelEnabled(cb_stob(val));
+        } else if (key == "chk_expel_eager") {
+            getConfiguration().setChkExpelEager(cb_stob(val));
+        } else if (key == "chk_value_compression") {
+            getConfiguration().setChkValueCompression(cb_stob(val));
         } else if (key == "dcp_min_compression_ratio") {
             getConfiguration().setDcpMinCompressionRatio(std::stof(val));
         } else if (key == "dcp_noop_mandatory_for_v5_features") {
@@ -765,8 +862,12 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             }
         } else if (key == "max_ttl") {
             getConfiguration().setMaxTtl(std::stoull(val));
+        } else if (key == "touch_expiry_tolerance") {
+            getConfiguration().setTouchExpiryTolerance(std::stoull(val));
         } else if (key == "mem_used_merge_threshold_percent") {
             getConfiguration().setMemUsedMergeThresholdPercent(std::stof(val));
+        } else if (key == "collection_mem_quota_percent") {
+            getConfiguration().setCollectionMemQuotaPercent(std::stof(val));
         } else if (key == "retain_erroneous_tombstones") {
             getConfiguration().setRetainErroneousTombstones(cb_stob(val));
         } else if (key == "couchstore_tracing") {
@@ -777,6 +878,8 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setCouchstoreMprotect(cb_stob(val));
         } else if (key == "allow_del_with_meta_prune_user_data") {
             getConfiguration().setAllowDelWithMetaPruneUserData(cb_stob(val));
+        } else if (key == "lock_profiler_enabled") {
+            getConfiguration().setLockProfilerEnabled(cb_stob(val));
         } else if (key == "pitr_enabled") {
             getConfiguration().setPitrEnabled(cb_stob(val));
         } else if (key == "pitr_max_history_age") {
@@ -857,7 +960,12 @@ cb::mcbp::Status EventuallyPersistentEngine::setDcpParam(const std::string& key,
                                                          std::string& msg) {
     auto rv = cb::mcbp::Status::Success;
     try {
-        if (key == "dcp_conn_buffer_size") {
+        if (key == "dcp_backfill_scan_parallelism") {
+            getConfiguration().setDcpBackfillScanParallelism(std::stoull(val));
+        } else if (key == "dcp_backfill_snapshot_chunk_items") {
+            getConfiguration().setDcpBackfillSnapshotChunkItems(
+                    std::stoull(val));
+        } else if (key == "dcp_conn_buffer_size") {
             getConfiguration().setDcpConnBufferSize(std::stoull(val));
         } else if (key == "dcp_conn_buffer_size_max") {
             getConfiguration().setDcpConnBufferSizeMax(std::stoull(val));
@@ -890,9 +998,15 @@ cb::mcbp::Status EventuallyPersistentEngine::setDcpParam(const std::string& key,
             getConfiguration().setDcpIdleTimeout(v);
         } else if (key == "dcp_noop_tx_interval") {
             getConfiguration().setDcpNoopTxInterval(std::stoull(val));
+        } else if (key == "dcp_oso_backfill_max_collection_ratio") {
+            getConfiguration().setDcpOsoBackfillMaxCollectionRatio(
+                    std::stof(val));
         } else if (key == "dcp_producer_snapshot_marker_yield_limit") {
             getConfiguration().setDcpProducerSnapshotMarkerYieldLimit(
                     std::stoull(val));
+        } else if (key == "dcp_stream_ready_queue_max_bytes") {
+            getConfiguration().setDcpStreamReadyQueueMaxBytes(
+                    std::stoull(val));
         } else if (key == "dcp_takeover_max_time") {
             getConfiguration().setDcpTakeoverMaxTime(std::stoull(val));
         } else {
@@ -1086,6 +1200,30 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getReplicaCmd(
         const void* cookie) {
     DocKey key = makeDocKey(cookie, request.getKey());
 
+    auto extras = request.getExtdata();
+    if (extras.size() == sizeof(cb::mcbp::request::GetReplicaPayload)) {
+        // Consistency token: the replica must have reached the given seqno.
+        const auto& token =
+                *reinterpret_cast<const cb::mcbp::request::GetReplicaPayload*>(
+                        extras.data());
+        // If notified after waiting for the seqno, don't wait again.
+        const auto timeout =
+                getEngineSpecific(cookie) != nullptr
+                        ? std::chrono::milliseconds(0)
+                        : std::chrono::milliseconds(token.getTimeout());
+        // Marked before waiting, as the wait may time out (and clear the
+        // mark) before waitForSeqno() returns.
+        storeEngineSpecific(cookie, timeout.count() ? this : nullptr);
+        auto status = getKVBucket()->waitForSeqno(
+                cookie, request.getVBucket(), token.getMinSeqno(), timeout);
+        if (status != ENGINE_EWOULDBLOCK) {
+            storeEngineSpecific(cookie, nullptr);
+        }
+        if (status != ENGINE_SUCCESS) {
+            return status;
+        }
+    }
+
     auto options = static_cast<get_options_t>(
             QUEUE_BG_FETCH | HONOR_STATES | TRACK_REFERENCE | DELETE_TEMP |
             HIDE_LOCKED_CAS | TRACK_STATISTICS);
@@ -1289,6 +1427,8 @@ static ENGINE_ERROR_CODE processUnknownCommand(EventuallyPersistentEngine* h,
     case cb::mcbp::ClientOpcode::AddWithMeta:
     case cb::mcbp::ClientOpcode::AddqWithMeta:
         return h->setWithMeta(cookie, request, response);
+    case cb::mcbp::ClientOpcode::SetWithMetaBatch:
+        return h->setWithMetaBatch(cookie, request, response);
     case cb::mcbp::ClientOpcode::DelWithMeta:
     case cb::mcbp::ClientOpcode::DelqWithMeta:
         return h->deleteWithMeta(cookie, request, response);
@@ -1309,8 +1449,14 @@ static ENGINE_ERROR_CODE processUnknownCommand(EventuallyPersistentEngine* h,
     }
     case cb::mcbp::ClientOpcode::GetRandomKey:
         return h->getRandomKey(cookie, request, response);
+    case cb::mcbp::ClientOpcode::SampleDocuments:
+        return h->sampleDocuments(cookie, request, response);
+    case cb::mcbp::ClientOpcode::GetLockedMeta:
+        return h->getLockedMeta(cookie, request, response);
     case cb::mcbp::ClientOpcode::GetKeys:
         return h->getAllKeys(cookie, request, response);
+    case cb::mcbp::ClientOpcode::RangeScan:
+        return h->rangeScan(cookie, request, response);
     default:
         res = cb::mcbp::Status::UnknownCommand;
     }
@@ -1979,6 +2125,10 @@ bool EventuallyPersistentEngine::isXattrEnabled() {
     return getKVBucket()->isXattrEnabled();
 }
 
+bool EventuallyPersistentEngine::isUnderMemoryPressure() {
+    return getKVBucket()->isUnderMemoryPressure();
+}
+
 cb::HlcTime EventuallyPersistentEngine::getVBucketHlcNow(Vbid vbucket) {
     return getKVBucket()->getVBucket(vbucket)->getHLCNow();
 }
@@ -2138,6 +2288,8 @@ public:
     void booleanValueChanged(const std::string& key, bool b) override {
         if (key == "allow_del_with_meta_prune_user_data") {
             engine.allowDelWithMetaPruneUserData.store(b);
+        } else if (key == "lock_profiler_enabled") {
+            engine.getEpStats().lockProfiler.setEnabled(b);
         }
     }
 
@@ -2195,6 +2347,8 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
         return ENGINE_FAILED;
     }
 
+    frontendGetCache = configuration.isFrontendGetCache();
+
     maxItemSize = configuration.getMaxItemSize();
     configuration.addValueChangedListener(
             "max_item_size",
@@ -2220,6 +2374,11 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
             "allow_del_with_meta_prune_user_data",
             std::make_unique<EpEngineValueChangeListener>(*this));
 
+    stats.lockProfiler.setEnabled(configuration.isLockProfilerEnabled());
+    configuration.addValueChangedListener(
+            "lock_profiler_enabled",
+            std::make_unique<EpEngineValueChangeListener>(*this));
+
     auto numShards = configuration.getMaxNumShards();
     workload = new WorkLoadPolicy(configuration.getMaxNumWorkers(), numShards);
 
@@ -2237,6 +2396,9 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
     } else if (!flowCtlPolicy.compare("aggressive")) {
         dcpFlowControlManager_ =
                 std::make_unique<DcpFlowControlManagerAggressive>(*this);
+    } else if (!flowCtlPolicy.compare("adaptive")) {
+        dcpFlowControlManager_ =
+                std::make_unique<DcpFlowControlManagerAdaptive>(*this);
     } else {
         /* Flow control is not enabled */
         dcpFlowControlManager_ = std::make_unique<DcpFlowControlManager>(*this);
@@ -2561,7 +2723,8 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getLockedInner(
         item** itm,
         const DocKey& key,
         Vbid vbucket,
-        uint32_t lock_timeout) {
+        uint32_t lock_timeout,
+        WantsValue wantsValue) {
     auto default_timeout = static_cast<uint32_t>(getGetlDefaultTimeout());
 
     if (lock_timeout == 0) {
@@ -2576,8 +2739,12 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getLockedInner(
         lock_timeout = default_timeout;
     }
 
-    auto result = kvBucket->getLocked(key, vbucket, ep_current_time(),
-                                      lock_timeout, cookie);
+    auto result = kvBucket->getLocked(key,
+                                      vbucket,
+                                      ep_current_time(),
+                                      lock_timeout,
+                                      cookie,
+                                      wantsValue);
 
     if (result.getStatus() == ENGINE_SUCCESS) {
         ++stats.numOpsGet;
@@ -2587,6 +2754,48 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getLockedInner(
     return result.getStatus();
 }
 
+ENGINE_ERROR_CODE EventuallyPersistentEngine::getLockedMeta(
+        const void* cookie,
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response) {
+    const DocKey key = makeDocKey(cookie, request.getKey());
+    auto priv = checkPrivilege(cookie, cb::rbac::Privilege::Read, key);
+    if (priv != ENGINE_SUCCESS) {
+        return priv;
+    }
+
+    uint32_t lockTimeout = 0;
+    if (request.getExtlen() != 0) {
+        const auto& payload =
+                *reinterpret_cast<const cb::mcbp::request::GetLockedPayload*>(
+                        request.getExtdata().data());
+        lockTimeout = payload.getExpiration();
+    }
+
+    item* itm = nullptr;
+    auto ret = getLockedInner(cookie,
+                              &itm,
+                              key,
+                              request.getVBucket(),
+                              lockTimeout,
+                              WantsValue::No);
+    if (ret != ENGINE_SUCCESS) {
+        return ret;
+    }
+
+    std::unique_ptr<Item> locked(reinterpret_cast<Item*>(itm));
+    // Flags are held in network byte order
+    const uint32_t flags = locked->getFlags();
+    return sendResponse(response,
+                        {}, // key
+                        {reinterpret_cast<const char*>(&flags), sizeof(flags)},
+                        {}, // body
+                        PROTOCOL_BINARY_RAW_BYTES,
+                        cb::mcbp::Status::Success,
+                        locked->getCas(),
+                        cookie);
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::unlockInner(const void* cookie,
                                                           const DocKey& key,
                                                           Vbid vbucket,
@@ -2705,6 +2914,138 @@ cb::EngineErrorCasPair EventuallyPersistentEngine::storeIfInner(
     return {cb::engine_errc(status), item.getCas()};
 }
 
+ENGINE_ERROR_CODE EventuallyPersistentEngine::arithmeticInner(
+        const void* cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        bool increment,
+        uint64_t delta,
+        uint64_t& result,
+        uint64_t& cas,
+        mutation_descr_t& mutation) {
+    if (kvBucket->getMinDurabilityLevel() != cb::durability::Level::None) {
+        // Every update is a SyncWrite, which the frontend must perform
+        return ENGINE_ENOTSUP;
+    }
+    if (isDegradedMode()) {
+        return ENGINE_TMPFAIL;
+    }
+
+    ScopeTimer2<HdrMicroSecStopwatch, TracerStopwatch> timer(
+            HdrMicroSecStopwatch(stats.arithCmdHisto),
+            TracerStopwatch(cookie, cb::tracing::Code::Store));
+
+    auto status = kvBucket->arithmetic(
+            key, vbucket, increment, delta, cookie, result, cas, mutation);
+    switch (status) {
+    case ENGINE_SUCCESS:
+        ++stats.numOpsStore;
+        kvBucket->checkAndMaybeFreeMemory();
+        break;
+    case ENGINE_ENOMEM:
+        status = memoryCondition();
+        break;
+    default:
+        break;
+    }
+    return status;
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::appendPrependInner(
+        const void* cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        bool append,
+        std::string_view value,
+        uint64_t& cas,
+        mutation_descr_t& mutation) {
+    if (kvBucket->getMinDurabilityLevel() != cb::durability::Level::None) {
+        // Every update is a SyncWrite, which the frontend must perform
+        return ENGINE_ENOTSUP;
+    }
+    if (isDegradedMode()) {
+        return ENGINE_TMPFAIL;
+    }
+
+    ScopeTimer2<HdrMicroSecStopwatch, TracerStopwatch> timer(
+            HdrMicroSecStopwatch(stats.storeCmdHisto),
+            TracerStopwatch(cookie, cb::tracing::Code::Store));
+
+    auto status = kvBucket->appendPrepend(
+            key, vbucket, append, value, cookie, cas, mutation);
+    switch (status) {
+    case ENGINE_SUCCESS:
+        ++stats.numOpsStore;
+        kvBucket->checkAndMaybeFreeMemory();
+        break;
+    case ENGINE_ENOMEM:
+        status = memoryCondition();
+        break;
+    default:
+        break;
+    }
+    return status;
+}
+
+void EventuallyPersistentEngine::storeMultiInner(
+        const void* cookie,
+        Vbid vbucket,
+        const std::vector<item*>& items,
+        std::vector<cb::EngineErrorCasPair>& results) {
+    if (kvBucket->getMinDurabilityLevel() != cb::durability::Level::None) {
+        // Every item is a SyncWrite, which must block on its own
+        EngineIface::store_multi(cookie, vbucket, items, results);
+        return;
+    }
+
+    ScopeTimer2<HdrMicroSecStopwatch, TracerStopwatch> timer(
+            HdrMicroSecStopwatch(stats.storeCmdHisto),
+            TracerStopwatch(cookie, cb::tracing::Code::Store));
+
+    results.assign(items.size(), {cb::engine_errc::would_block, 0});
+    if (isDegradedMode()) {
+        std::fill(results.begin(),
+                  results.end(),
+                  cb::EngineErrorCasPair{cb::engine_errc::temporary_failure,
+                                         0});
+        return;
+    }
+
+    std::vector<Item*> batch;
+    batch.reserve(items.size());
+    for (auto* itm : items) {
+        batch.push_back(static_cast<Item*>(itm));
+    }
+
+    std::vector<ENGINE_ERROR_CODE> status(items.size(), ENGINE_EWOULDBLOCK);
+    const auto rv = kvBucket->setMulti(vbucket, batch, status, cookie);
+    if (rv != ENGINE_SUCCESS && rv != ENGINE_EWOULDBLOCK) {
+        // Applies to all of the items
+        std::fill(status.begin(), status.end(), rv);
+    }
+
+    bool stored = false;
+    for (size_t ii = 0; ii < items.size(); ++ii) {
+        auto code = status[ii];
+        switch (code) {
+        case ENGINE_SUCCESS:
+            ++stats.numOpsStore;
+            stored = true;
+            break;
+        case ENGINE_ENOMEM:
+            code = memoryCondition();
+            break;
+        default:
+            break;
+        }
+        results[ii] = {cb::engine_errc(code), batch[ii]->getCas()};
+    }
+
+    if (stored) {
+        kvBucket->checkAndMaybeFreeMemory();
+    }
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::storeInner(
         const void* cookie,
         Item& itm,
@@ -2779,6 +3120,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
         collector.addStat(Key::ep_commit_time, epstats.commit_time);
         collector.addStat(Key::ep_commit_time_total,
                           epstats.cumulativeCommitTime);
+        collector.addStat(Key::ep_durability_log_writes,
+                          epstats.durabilityLogWrites);
+        collector.addStat(Key::ep_durability_log_write_failed,
+                          epstats.durabilityLogWriteFailed);
         collector.addStat(Key::ep_item_begin_failed, epstats.beginFailed);
         collector.addStat(Key::ep_item_commit_failed, epstats.commitFailed);
         collector.addStat(Key::ep_item_flush_expired, epstats.flushExpired);
@@ -2799,6 +3144,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
 
     kvBucket->getFileStats(collector);
 
+    if (auto* epBucket = dynamic_cast<EPBucket*>(kvBucket.get())) {
+        epBucket->getCompactionThrottleStats(collector);
+    }
+
     collector.addStat(Key::ep_persist_vbstate_total,
                       epstats.totalPersistVBState);
 
@@ -2810,6 +3159,7 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
     collector.addStat(Key::ep_mem_high_wat_percent, stats.mem_high_wat_percent);
     collector.addStat(Key::bytes, memUsed);
     collector.addStat(Key::ep_kv_size, stats.getCurrentSize());
+    collector.addStat(Key::ep_ht_huge_page_bytes, stats.htHugePageBytes);
     collector.addStat(Key::ep_blob_num, stats.getNumBlob());
 #if defined(HAVE_JEMALLOC) || defined(HAVE_TCMALLOC)
     collector.addStat(Key::ep_blob_overhead, stats.getBlobOverhead());
@@ -2829,14 +3179,21 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
 
     collector.addStat(Key::ep_oom_errors, stats.oom_errors);
     collector.addStat(Key::ep_tmp_oom_errors, stats.tmp_oom_errors);
+    collector.addStat(Key::ep_tmp_oom_collection_quota_errors,
+                      stats.tmp_oom_collection_quota_errors);
     collector.addStat(Key::ep_mem_tracker_enabled,
                       EPStats::isMemoryTrackingEnabled());
     collector.addStat(Key::ep_bg_fetched, epstats.bg_fetched);
     collector.addStat(Key::ep_bg_meta_fetched, epstats.bg_meta_fetched);
+    collector.addStat(Key::ep_bg_prefetches, epstats.bg_prefetches);
+    collector.addStat(Key::ep_bg_fetch_deadline_exceeded,
+                      epstats.bg_fetch_deadline_exceeded);
     collector.addStat(Key::ep_bg_remaining_items, epstats.numRemainingBgItems);
     collector.addStat(Key::ep_bg_remaining_jobs, epstats.numRemainingBgJobs);
     collector.addStat(Key::ep_num_pager_runs, epstats.pagerRuns);
     collector.addStat(Key::ep_num_expiry_pager_runs, epstats.expiryPagerRuns);
+    collector.addStat(Key::ep_num_expiry_pager_full_scans,
+                      epstats.expiryPagerFullScans);
     collector.addStat(Key::ep_num_freq_decayer_runs, epstats.freqDecayerRuns);
     collector.addStat(Key::ep_items_expelled_from_checkpoints,
                       epstats.itemsExpelledFromCheckpoints);
@@ -2844,6 +3201,8 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                       epstats.itemsRemovedFromCheckpoints);
     collector.addStat(Key::ep_num_value_ejects, epstats.numValueEjects);
     collector.addStat(Key::ep_num_eject_failures, epstats.numFailedEjects);
+    collector.addStat(Key::ep_num_ejects_on_persist,
+                      epstats.numEjectsOnPersist);
     collector.addStat(Key::ep_num_not_my_vbuckets, epstats.numNotMyVBuckets);
 
     collector.addStat(Key::ep_pending_ops, epstats.pendingOps);
@@ -2881,6 +3240,8 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
     collector.addStat(Key::ep_num_access_scanner_runs, epstats.alogRuns);
     collector.addStat(Key::ep_num_access_scanner_skips,
                       epstats.accessScannerSkips);
+    collector.addStat(Key::ep_num_access_scanner_vbuckets_copied,
+                      epstats.alogNumVBucketsCopied);
     collector.addStat(Key::ep_access_scanner_last_runtime, epstats.alogRuntime);
     collector.addStat(Key::ep_access_scanner_num_items, epstats.alogNumItems);
 
@@ -2942,6 +3303,8 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
     collector.addStat(Key::ep_num_ops_del_meta, epstats.numOpsDelMeta);
     collector.addStat(Key::ep_num_ops_set_meta_res_fail,
                       epstats.numOpsSetMetaResolutionFailed);
+    collector.addStat(Key::ep_num_ops_set_meta_res_by_bounds,
+                      epstats.numOpsSetMetaResolvedByBounds);
     collector.addStat(Key::ep_num_ops_del_meta_res_fail,
                       epstats.numOpsDelMetaResolutionFailed);
     collector.addStat(Key::ep_num_ops_set_ret_meta, epstats.numOpsSetRetMeta);
@@ -2956,6 +3319,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
     collector.addStat(Key::ep_defragmenter_num_moved, epstats.defragNumMoved);
     collector.addStat(Key::ep_defragmenter_sv_num_moved,
                       epstats.defragStoredValueNumMoved);
+    collector.addStat(Key::ep_defragmenter_num_skipped,
+                      epstats.defragNumSkipped);
+    collector.addStat(Key::ep_defragmenter_num_dense_skipped,
+                      epstats.defragNumDenseSkipped);
 
     collector.addStat(Key::ep_item_compressor_num_visited,
                       epstats.compressorNumVisited);
@@ -2968,6 +3335,8 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                       epstats.cursorDroppingUThreshold);
     collector.addStat(Key::ep_cursors_dropped, epstats.cursorsDropped);
     collector.addStat(Key::ep_cursor_memory_freed, epstats.cursorMemoryFreed);
+    collector.addStat(Key::ep_cursor_drop_backfill_items,
+                      epstats.cursorDropBackfillItems);
 
     // Note: These are also reported per-shard in 'kvstore' stats, however
     // we want to be able to graph these over time, and hence need to expose
@@ -3168,6 +3537,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doMemoryStats(
     add_casted_stat("ep_oom_errors", stats.oom_errors, add_stat, cookie);
     add_casted_stat(
             "ep_tmp_oom_errors", stats.tmp_oom_errors, add_stat, cookie);
+    add_casted_stat("ep_tmp_oom_collection_quota_errors",
+                    stats.tmp_oom_collection_quota_errors,
+                    add_stat,
+                    cookie);
 
     add_casted_stat("ep_blob_num", stats.getNumBlob(), add_stat, cookie);
 #if defined(HAVE_JEMALLOC) || defined(HAVE_TCMALLOC)
@@ -3188,6 +3561,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doMemoryStats(
             "ep_storedval_num", stats.getNumStoredVal(), add_stat, cookie);
     add_casted_stat("ep_item_num", stats.getNumItem(), add_stat, cookie);
 
+    if (const auto* dedup = kvBucket->getValueDeduplicator()) {
+        dedup->addStats(add_stat, cookie);
+    }
+
     std::unordered_map<std::string, size_t> alloc_stats;
     bool missing = cb::ArenaMalloc::getStats(arena, alloc_stats);
     for (const auto& it : alloc_stats) {
@@ -3197,6 +3574,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doMemoryStats(
     if (missing) {
         add_casted_stat("ep_arena_missing_some_keys", true, add_stat, cookie);
     }
+    add_casted_stat("ep_arena_fragmentation_ratio",
+                    stats.getArenaFragmentationRatio(),
+                    add_stat,
+                    cookie);
     missing = cb::ArenaMalloc::getGlobalStats(alloc_stats);
     for (const auto& it : alloc_stats) {
         add_prefixed_stat("ep_arena_global",
@@ -3359,6 +3740,18 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doHashStats(
                 add_casted_stat(buf, depthVisitor.size, add_stat, cookie);
                 checked_snprintf(buf, sizeof(buf), "vb_%d:resized", vbid.get());
                 add_casted_stat(buf, vb->ht.getNumResizes(), add_stat, cookie);
+                checked_snprintf(buf,
+                                 sizeof(buf),
+                                 "vb_%d:resize_migrated",
+                                 vbid.get());
+                add_casted_stat(buf,
+                                vb->ht.getResizeMigratedBuckets(),
+                                add_stat,
+                                cookie);
+                checked_snprintf(
+                        buf, sizeof(buf), "vb_%d:resize_total", vbid.get());
+                add_casted_stat(
+                        buf, vb->ht.getResizeTotalBuckets(), add_stat, cookie);
                 checked_snprintf(
                         buf, sizeof(buf), "vb_%d:mem_size", vbid.get());
                 add_casted_stat(buf, vb->ht.getItemMemory(), add_stat, cookie);
@@ -3992,6 +4385,18 @@ void EventuallyPersistentEngine::doTimingStats(StatCollector& collector) {
     using namespace cb::stats;
     collector.addStat(Key::bg_wait, stats.bgWaitHisto);
     collector.addStat(Key::bg_load, stats.bgLoadHisto);
+    collector.addStat(Key::bg_fetch_client_read,
+                      stats.bgFetchPriorityHisto[static_cast<size_t>(
+                              BgFetchPriority::ClientRead)]);
+    collector.addStat(Key::bg_fetch_durability,
+                      stats.bgFetchPriorityHisto[static_cast<size_t>(
+                              BgFetchPriority::Durability)]);
+    collector.addStat(Key::bg_fetch_xdcr_meta,
+                      stats.bgFetchPriorityHisto[static_cast<size_t>(
+                              BgFetchPriority::XdcrMeta)]);
+    collector.addStat(Key::bg_fetch_background,
+                      stats.bgFetchPriorityHisto[static_cast<size_t>(
+                              BgFetchPriority::Background)]);
     collector.addStat(Key::set_with_meta, stats.setWithMetaHisto);
     collector.addStat(Key::pending_ops, stats.pendingOpsHisto);
 
@@ -3999,6 +4404,10 @@ void EventuallyPersistentEngine::doTimingStats(StatCollector& collector) {
     collector.addStat(Key::checkpoint_remover, stats.checkpointRemoverHisto);
     collector.addStat(Key::item_pager, stats.itemPagerHisto);
     collector.addStat(Key::expiry_pager, stats.expiryPagerHisto);
+    collector.addStat(Key::rollback_disk, stats.rollbackDiskHisto);
+    collector.addStat(Key::rollback_unpersisted,
+                      stats.rollbackUnpersistedHisto);
+    collector.addStat(Key::rollback_prepares, stats.rollbackPreparesHisto);
     collector.addStat(Key::storage_age, stats.dirtyAgeHisto);
 
     // Regular commands
@@ -4036,6 +4445,134 @@ void EventuallyPersistentEngine::doTimingStats(StatCollector& collector) {
                       stats.syncWriteCommitTimes.at(1));
     collector.addStat(Key::sync_write_commit_persist_to_majority,
                       stats.syncWriteCommitTimes.at(2));
+    collector.addStat(Key::sync_write_ack_local, stats.syncWriteLocalAckTimes);
+    collector.addStat(Key::sync_write_ack_remote,
+                      stats.syncWriteRemoteAckTimes);
+}
+
+void EventuallyPersistentEngine::doDcpLatencyStats(StatCollector& collector) {
+    dcpConnMap_->each([&collector](const std::shared_ptr<ConnHandler>& conn) {
+        if (const auto* producer =
+                    dynamic_cast<const DcpProducer*>(conn.get())) {
+            collector.withLabels({{"connection", producer->getName()}})
+                    .addStat(cb::stats::Key::dcp_item_send_latency,
+                             producer->getItemSendLatencyHisto());
+        } else if (const auto* consumer =
+                           dynamic_cast<const DcpConsumer*>(conn.get())) {
+            collector.withLabels({{"connection", consumer->getName()}})
+                    .addStat(cb::stats::Key::dcp_mutation_processing_time,
+                             consumer->getMutationProcessingHisto());
+        }
+    });
+}
+
+void EventuallyPersistentEngine::doTaskTimingStats(StatCollector& collector) {
+    using namespace cb::stats;
+    for (TaskId id : GlobalTask::allTaskIds) {
+        const auto& scheduling = stats.schedulingHisto[static_cast<int>(id)];
+        const auto& runtime = stats.taskRuntimeHisto[static_cast<int>(id)];
+        if (scheduling.getValueCount() == 0 && runtime.getValueCount() == 0) {
+            // Task has never run in this bucket - the collector would drop
+            // the empty histograms anyway, so skip building their labels.
+            continue;
+        }
+        auto labelled = collector.withLabels(
+                {{"task", GlobalTask::getTaskName(id)},
+                 {"type", to_string(GlobalTask::getTaskType(id))}});
+        labelled.addStat(Key::task_scheduling_time, scheduling);
+        labelled.addStat(Key::task_runtime, runtime);
+    }
+}
+
+/// The components of the memory-breakdown stat group, in the order they are
+/// accumulated by doMemoryBreakdownStats
+static const std::array<cb::stats::Key, 9> memoryBreakdownKeys = {
+        {cb::stats::Key::ep_mem_breakdown_ht_metadata,
+         cb::stats::Key::ep_mem_breakdown_ht_keys,
+         cb::stats::Key::ep_mem_breakdown_ht_values,
+         cb::stats::Key::ep_mem_breakdown_ht_overhead,
+         cb::stats::Key::ep_mem_breakdown_checkpoint_items,
+         cb::stats::Key::ep_mem_breakdown_checkpoint_index,
+         cb::stats::Key::ep_mem_breakdown_checkpoint_queue,
+         cb::stats::Key::ep_mem_breakdown_dcp_ready_queue,
+         cb::stats::Key::ep_mem_breakdown_dcp_backfill_buffer}};
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::doMemoryBreakdownStats(
+        StatCollector& collector, bool perVBucket) {
+    using namespace cb::stats;
+    using Components = std::array<size_t, memoryBreakdownKeys.size()>;
+
+    // Everything summed here is already tracked by the hash tables, the
+    // checkpoint allocators and the DCP streams, so this only costs a walk
+    // of the vBuckets and the streams (no item is visited).
+    const auto& vbMap = kvBucket->getVBuckets();
+    std::vector<size_t> readyQueueMemory(vbMap.getSize());
+    size_t backfillBufferBytes = 0;
+    dcpConnMap_->each([&readyQueueMemory, &backfillBufferBytes](
+                              const std::shared_ptr<ConnHandler>& conn) {
+        auto* producer = dynamic_cast<DcpProducer*>(conn.get());
+        if (producer) {
+            producer->addMemoryUsage(readyQueueMemory, backfillBufferBytes);
+        }
+    });
+
+    Components total{};
+    total.back() = backfillBufferBytes;
+    std::string key;
+    for (auto vbid : vbMap.getBuckets()) {
+        VBucketPtr vb = getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        const auto metadata = vb->ht.getMetadataMemory();
+        const auto keys = vb->ht.getKeyMemory();
+        const auto checkpoints = vb->checkpointManager->getMemoryBreakdown();
+        const Components vbComponents = {
+                {metadata - keys,
+                 keys,
+                 vb->ht.getItemMemory() - metadata,
+                 vb->ht.memorySize(),
+                 checkpoints.queuedItems,
+                 checkpoints.keyIndex,
+                 checkpoints.queue,
+                 readyQueueMemory[vbid.get()],
+                 0}};
+        for (size_t ii = 0; ii < total.size(); ++ii) {
+            total[ii] += vbComponents[ii];
+        }
+        if (!perVBucket) {
+            continue;
+        }
+
+        const auto vbLabel = std::to_string(vbid.get());
+        // The backfill buffer is shared by all the streams of a producer
+        for (size_t ii = 0; ii < total.size() - 1; ++ii) {
+            const auto& def = StatCollector::lookup(memoryBreakdownKeys[ii]);
+            const auto& component = def.labels.at("component");
+            key = "vb_" + vbLabel + ":" + std::string(component);
+            collector.addStat(StatDef(key,
+                                      units::bytes,
+                                      "memory_breakdown_vbucket",
+                                      StatDef::Labels{{"component", component},
+                                                      {"vbucket", vbLabel}}),
+                              vbComponents[ii]);
+        }
+    }
+
+    for (size_t ii = 0; ii < total.size(); ++ii) {
+        collector.addStat(memoryBreakdownKeys[ii], total[ii]);
+    }
+
+    for (const auto& [cid, memUsed] : stats.getAllCollectionsMemUsed()) {
+        const auto collection = cid.to_string();
+        key = "collection_" + collection + ":mem_used";
+        StatDef def(key,
+                    units::bytes,
+                    "memory_breakdown_collection",
+                    StatDef::Labels{{"collection_id", collection}});
+        collector.addStat(def, memUsed);
+    }
+    return ENGINE_SUCCESS;
 }
 
 static std::string getTaskDescrForStats(TaskId id) {
@@ -4123,6 +4660,7 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doWorkloadStats(
         expool->doTaskQStat(ObjectRegistry::getCurrentEngine()->getTaskable(),
                             cookie,
                             add_stat);
+        expool->doAdaptiveThreadsStats(cookie, add_stat);
 
     } catch (std::exception& error) {
         EP_LOG_WARN("doWorkloadStats: Error building stats: {}", error.what());
@@ -4620,6 +5158,14 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getStats(
         doTimingStats(collector);
         return ENGINE_SUCCESS;
     }
+    if (key == "lock-profile"sv) {
+        stats.lockProfiler.addStats(add_stat, cookie);
+        return ENGINE_SUCCESS;
+    }
+    if (key == "memory-breakdown"sv) {
+        CBStatCollector collector{add_stat, cookie};
+        return doMemoryBreakdownStats(collector, true /* perVBucket */);
+    }
     if (key == "dispatcher"sv) {
         return doDispatcherStats(cookie, add_stat);
     }
@@ -5232,34 +5778,46 @@ bool EventuallyPersistentEngine::decodeWithMetaOptions(
         CheckConflicts& checkConflicts,
         PermittedVBStates& permittedVBStates,
         DeleteSource& deleteSource) {
-    bool forceFlag = false;
+    uint32_t options = 0;
     if (extras.size() == 28 || extras.size() == 30) {
         const size_t fixed_extras_size = 24;
-        uint32_t options;
         memcpy(&options, extras.data() + fixed_extras_size, sizeof(options));
         options = ntohl(options);
+    }
+    return decodeWithMetaOptions(options,
+                                 generateCas,
+                                 checkConflicts,
+                                 permittedVBStates,
+                                 deleteSource);
+}
 
-        if (options & SKIP_CONFLICT_RESOLUTION_FLAG) {
-            checkConflicts = CheckConflicts::No;
-        }
+bool EventuallyPersistentEngine::decodeWithMetaOptions(
+        uint32_t options,
+        GenerateCas& generateCas,
+        CheckConflicts& checkConflicts,
+        PermittedVBStates& permittedVBStates,
+        DeleteSource& deleteSource) {
+    bool forceFlag = false;
+    if (options & SKIP_CONFLICT_RESOLUTION_FLAG) {
+        checkConflicts = CheckConflicts::No;
+    }
 
-        if (options & FORCE_ACCEPT_WITH_META_OPS) {
-            forceFlag = true;
-        }
+    if (options & FORCE_ACCEPT_WITH_META_OPS) {
+        forceFlag = true;
+    }
 
-        if (options & REGENERATE_CAS) {
-            generateCas = GenerateCas::Yes;
-        }
+    if (options & REGENERATE_CAS) {
+        generateCas = GenerateCas::Yes;
+    }
 
-        if (options & FORCE_WITH_META_OP) {
-            permittedVBStates.set(vbucket_state_replica);
-            permittedVBStates.set(vbucket_state_pending);
-            checkConflicts = CheckConflicts::No;
-        }
+    if (options & FORCE_WITH_META_OP) {
+        permittedVBStates.set(vbucket_state_replica);
+        permittedVBStates.set(vbucket_state_pending);
+        checkConflicts = CheckConflicts::No;
+    }
 
-        if (options & IS_EXPIRATION) {
-            deleteSource = DeleteSource::TTL;
-        }
+    if (options & IS_EXPIRATION) {
+        deleteSource = DeleteSource::TTL;
     }
 
     // Validate options
@@ -5313,8 +5871,9 @@ protocol_binary_datatype_t EventuallyPersistentEngine::checkForDatatypeJson(
             body = cb::xattr::get_body(body);
         }
 
-        if (checkUTF8JSON(reinterpret_cast<const uint8_t*>(body.data()),
-                          body.size())) {
+        // The validator keeps its buffers between calls
+        static thread_local cb::json::Validator validator;
+        if (validator.validate(body)) {
             datatype |= PROTOCOL_BINARY_DATATYPE_JSON;
         }
     }
@@ -5451,6 +6010,150 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMeta(
     return sendErrorResponse(response, cb::mcbp::Status::Success, cas, cookie);
 }
 
+/**
+ * The progress of a SetWithMetaBatch which had to wait (for the metadata of
+ * one of its documents to be fetched, or for a pending vbucket), kept in
+ * the engine specific of the cookie until the command is executed again.
+ */
+struct SetWithMetaBatchContext {
+    /// The offset in the value of the request of the next document to set
+    size_t offset = 0;
+    /// The status (in network byte order) of each of the documents set
+    std::vector<uint16_t> statuses;
+};
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMetaBatch(
+        const void* cookie,
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response) {
+    std::unique_ptr<SetWithMetaBatchContext> ctx(
+            static_cast<SetWithMetaBatchContext*>(getEngineSpecific(cookie)));
+    storeEngineSpecific(cookie, nullptr);
+    if (!ctx) {
+        ctx = std::make_unique<SetWithMetaBatchContext>();
+    }
+
+    if (isDegradedMode()) {
+        return ENGINE_TMPFAIL;
+    }
+
+    // The options (if any) apply to all of the documents
+    uint32_t options = 0;
+    const auto extras = request.getExtdata();
+    if (extras.size() == sizeof(options)) {
+        memcpy(&options, extras.data(), sizeof(options));
+        options = ntohl(options);
+    }
+    CheckConflicts checkConflicts = CheckConflicts::Yes;
+    PermittedVBStates permittedVBStates{vbucket_state_active};
+    GenerateCas generateCas = GenerateCas::No;
+    DeleteSource deleteSource = DeleteSource::Explicit;
+    if (!decodeWithMetaOptions(options,
+                               generateCas,
+                               checkConflicts,
+                               permittedVBStates,
+                               deleteSource)) {
+        return ENGINE_EINVAL;
+    }
+
+    // Create the items of the documents not set yet (the validator checked
+    // the encoding of the documents). A document which is rejected before
+    // reaching the vbucket gets a null item and its result right away.
+    using cb::mcbp::request::SetWithMetaBatchEntry;
+    const auto vbid = request.getVBucket();
+    const auto value = request.getValue();
+    std::vector<size_t> offsets;
+    std::vector<std::unique_ptr<Item>> items;
+    std::vector<ENGINE_ERROR_CODE> results;
+    ENGINE_ERROR_CODE ret;
+    try {
+        for (auto offset = ctx->offset; offset < value.size();) {
+            const auto& entry = *reinterpret_cast<const SetWithMetaBatchEntry*>(
+                    value.data() + offset);
+            offsets.push_back(offset);
+            offset += entry.getSize();
+
+            const auto key = makeDocKey(cookie, entry.getKey());
+            std::unique_ptr<Item> item;
+            auto rv = checkPrivilege(cookie, cb::rbac::Privilege::MetaWrite, key);
+            if (rv == ENGINE_SUCCESS) {
+                rv = makeItemWithMeta(vbid,
+                                      key,
+                                      entry.getValue(),
+                                      {entry.getCas(),
+                                       entry.getSeqno(),
+                                       entry.getFlagsInNetworkByteOrder(),
+                                       time_t(entry.getExpiration())},
+                                      false /*isDeleted*/,
+                                      entry.getDatatype(),
+                                      cookie,
+                                      item);
+            }
+            items.push_back(std::move(item));
+            results.push_back(rv);
+        }
+
+        ret = kvBucket->setWithMetaBatch(vbid,
+                                         items,
+                                         results,
+                                         cookie,
+                                         permittedVBStates,
+                                         checkConflicts,
+                                         generateCas);
+    } catch (const std::bad_alloc&) {
+        return ENGINE_ENOMEM;
+    }
+
+    size_t done = results.size();
+    if (ret == ENGINE_EWOULDBLOCK) {
+        // The batch stopped at the document waiting for its metadata, or
+        // before the first document if the vbucket is pending
+        done = std::find(results.begin(), results.end(), ENGINE_EWOULDBLOCK) -
+               results.begin();
+        if (done == results.size()) {
+            done = 0;
+        } else {
+            ++stats.numOpsGetMetaOnSetWithMeta;
+        }
+    } else if (ret == ENGINE_ENOMEM) {
+        return memoryCondition();
+    } else if (ret != ENGINE_SUCCESS) {
+        // Let the framework generate the error message
+        return ret;
+    }
+
+    for (size_t ii = 0; ii < done; ++ii) {
+        if (results[ii] == ENGINE_SUCCESS) {
+            ++stats.numOpsSetMeta;
+        }
+        ctx->statuses.push_back(htons(
+                uint16_t(cb::mcbp::to_status(cb::engine_errc(results[ii])))));
+    }
+
+    if (ret == ENGINE_EWOULDBLOCK) {
+        ctx->offset = offsets[done];
+        storeEngineSpecific(cookie, ctx.release());
+        return ENGINE_EWOULDBLOCK;
+    }
+
+    if (!ctx->statuses.empty()) {
+        ServerDocumentIfaceBorderGuard guardedIface(*serverApi->document);
+        guardedIface.audit_document_access(
+                cookie, cb::audit::document::Operation::Modify);
+    }
+
+    return sendResponse(
+            response,
+            {}, // key
+            {}, // extras
+            {reinterpret_cast<const char*>(ctx->statuses.data()),
+             ctx->statuses.size() * sizeof(uint16_t)},
+            PROTOCOL_BINARY_RAW_BYTES,
+            cb::mcbp::Status::Success,
+            0,
+            cookie);
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMeta(
         Vbid vbucket,
         DocKey key,
@@ -5477,6 +6180,47 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMeta(
         }
     }
 
+    std::unique_ptr<Item> item;
+    auto ret = makeItemWithMeta(vbucket,
+                                key,
+                                value,
+                                itemMeta,
+                                isDeleted,
+                                datatype,
+                                cookie,
+                                item);
+    if (ret != ENGINE_SUCCESS) {
+        return ret;
+    }
+
+    ret = kvBucket->setWithMeta(*item,
+                                cas,
+                                seqno,
+                                cookie,
+                                permittedVBStates,
+                                checkConflicts,
+                                allowExisting,
+                                genBySeqno,
+                                genCas,
+                                extendedMetaData.get());
+
+    if (ret == ENGINE_SUCCESS) {
+        cas = item->getCas();
+    } else {
+        cas = 0;
+    }
+    return ret;
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::makeItemWithMeta(
+        Vbid vbucket,
+        DocKey key,
+        cb::const_byte_buffer value,
+        ItemMetaData itemMeta,
+        bool isDeleted,
+        protocol_binary_datatype_t datatype,
+        const void* cookie,
+        std::unique_ptr<Item>& item) {
     if (mcbp::datatype::is_snappy(datatype) &&
         !isDatatypeSupported(cookie, PROTOCOL_BINARY_DATATYPE_SNAPPY)) {
         setErrorContext(cookie, "Client did not negotiate Snappy support");
@@ -5545,36 +6289,20 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMeta(
                         mcbp::datatype::is_snappy(datatype) ?
                         uncompressedValue : payload);
 
-    auto item = std::make_unique<Item>(key,
-                                       itemMeta.flags,
-                                       itemMeta.exptime,
-                                       finalValue.data(),
-                                       finalValue.size(),
-                                       finalDatatype,
-                                       itemMeta.cas,
-                                       -1,
-                                       vbucket);
+    item = std::make_unique<Item>(key,
+                                  itemMeta.flags,
+                                  itemMeta.exptime,
+                                  finalValue.data(),
+                                  finalValue.size(),
+                                  finalDatatype,
+                                  itemMeta.cas,
+                                  -1,
+                                  vbucket);
     item->setRevSeqno(itemMeta.revSeqno);
     if (isDeleted) {
         item->setDeleted();
     }
-    auto ret = kvBucket->setWithMeta(*item,
-                                     cas,
-                                     seqno,
-                                     cookie,
-                                     permittedVBStates,
-                                     checkConflicts,
-                                     allowExisting,
-                                     genBySeqno,
-                                     genCas,
-                                     extendedMetaData.get());
-
-    if (ret == ENGINE_SUCCESS) {
-        cas = item->getCas();
-    } else {
-        cas = 0;
-    }
-    return ret;
+    return ENGINE_SUCCESS;
 }
 
 ENGINE_ERROR_CODE EventuallyPersistentEngine::deleteWithMeta(
@@ -6031,13 +6759,115 @@ EventuallyPersistentEngine::getAllKeys(const void* cookie,
         keysCollection = start_key.getCollectionID();
     }
 
-    ExTask task = std::make_shared<FetchAllKeysTask>(this,
-                                                     cookie,
-                                                     response,
-                                                     start_key,
-                                                     request.getVBucket(),
-                                                     count,
-                                                     keysCollection);
+    ExTask task = std::make_shared<FetchAllKeysTask>(
+            this,
+            cookie,
+            response,
+            start_key,
+            request.getVBucket(),
+            count,
+            configuration.getGetKeysMaxResponseSize(),
+            keysCollection);
+    ExecutorPool::get()->schedule(task);
+    return ENGINE_EWOULDBLOCK;
+}
+
+ENGINE_ERROR_CODE
+EventuallyPersistentEngine::rangeScan(const void* cookie,
+                                      const cb::mcbp::Request& request,
+                                      const AddResponseFn& response) {
+    if (!getKVBucket()->isGetAllKeysSupported()) {
+        return ENGINE_ENOTSUP;
+    }
+
+    {
+        // The RangeScanTask has already sent the response
+        LockHolder lh(lookupMutex);
+        auto it = allKeysLookups.find(cookie);
+        if (it != allKeysLookups.end()) {
+            ENGINE_ERROR_CODE err = it->second;
+            allKeysLookups.erase(it);
+            return err;
+        }
+    }
+
+    const auto vbid = request.getVBucket();
+    if (!getKVBucket()
+                 ->getROUnderlying(vbid)
+                 ->getStorageProperties()
+                 .hasByIdScan()) {
+        return ENGINE_ENOTSUP;
+    }
+
+    VBucketPtr vb = getVBucket(vbid);
+    if (!vb) {
+        return ENGINE_NOT_MY_VBUCKET;
+    }
+
+    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    if (vb->getState() != vbucket_state_active) {
+        return ENGINE_NOT_MY_VBUCKET;
+    }
+
+    using cb::mcbp::request::RangeScanPayload;
+    const auto& payload = *reinterpret_cast<const RangeScanPayload*>(
+            request.getExtdata().data());
+
+    const DocKey startKey = makeDocKey(cookie, request.getKey());
+    auto privTestResult =
+            checkPrivilege(cookie, cb::rbac::Privilege::Read, startKey);
+    if (privTestResult != ENGINE_SUCCESS) {
+        return privTestResult;
+    }
+
+    // The range ends at the given (exclusive) key of the collection, after
+    // the keys with the prefix, or else at the end of the collection.
+    const auto cid = startKey.getCollectionID();
+    std::string endKey;
+    if (payload.isPrefix()) {
+        const auto prefix = startKey.makeDocKeyWithoutCollectionID();
+        endKey = {reinterpret_cast<const char*>(prefix.data()), prefix.size()};
+        while (!endKey.empty() && uint8_t(endKey.back()) == 0xff) {
+            endKey.pop_back();
+        }
+        if (!endKey.empty()) {
+            endKey.back()++;
+        }
+    } else {
+        auto value = request.getValue();
+        endKey = {reinterpret_cast<const char*>(value.data()), value.size()};
+    }
+
+    cb::mcbp::unsigned_leb128<CollectionIDType> nextCollection(uint32_t{cid} +
+                                                               1);
+    ByIdRange range{DiskDocKey{startKey},
+                    endKey.empty() ? DiskDocKey{{nextCollection.data(),
+                                                 nextCollection.size(),
+                                                 DocKeyEncodesCollectionId::Yes}}
+                                   : DiskDocKey{StoredDocKey{endKey, cid}}};
+
+    auto valFilter = ValueFilter::VALUES_DECOMPRESSED;
+    if (payload.isKeyOnly()) {
+        valFilter = ValueFilter::KEYS_ONLY;
+    } else if (isDatatypeSupported(cookie, PROTOCOL_BINARY_DATATYPE_SNAPPY)) {
+        valFilter = ValueFilter::VALUES_COMPRESSED;
+    }
+
+    size_t bufferSize = payload.getBufferSize();
+    if (bufferSize == 0) {
+        bufferSize = RangeScanTask::defaultBufferSize;
+    }
+    bufferSize = std::min(bufferSize, RangeScanTask::maxBufferSize);
+
+    ExTask task = std::make_shared<RangeScanTask>(this,
+                                                  cookie,
+                                                  response,
+                                                  vbid,
+                                                  std::move(range),
+                                                  valFilter,
+                                                  isCollectionsSupported(cookie),
+                                                  bufferSize,
+                                                  payload.getSampleInterval());
     ExecutorPool::get()->schedule(task);
     return ENGINE_EWOULDBLOCK;
 }
@@ -6065,6 +6895,28 @@ void EventuallyPersistentEngine::notifyIOComplete(const void* cookie,
     }
 }
 
+void EventuallyPersistentEngine::notifyIOComplete(
+        const std::map<const void*, ENGINE_ERROR_CODE>& toNotify) {
+    if (toNotify.empty()) {
+        return;
+    }
+    // Keep the (bucket-accounted) vector alive beyond the guard
+    const std::vector<std::pair<const void*, ENGINE_ERROR_CODE>> notifications(
+            toNotify.begin(), toNotify.end());
+    notifyIOComplete(notifications);
+}
+
+void EventuallyPersistentEngine::notifyIOComplete(
+        const std::vector<std::pair<const void*, ENGINE_ERROR_CODE>>&
+                toNotify) {
+    if (toNotify.empty()) {
+        return;
+    }
+    HdrMicroSecBlockTimer bt(&stats.notifyIOHisto);
+    NonBucketAllocationGuard guard;
+    serverApi->cookie->notify_io_complete_batch(toNotify);
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::getRandomKey(
         const void* cookie,
         const cb::mcbp::Request& request,
@@ -6106,6 +6958,59 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getRandomKey(
     return ret;
 }
 
+ENGINE_ERROR_CODE EventuallyPersistentEngine::sampleDocuments(
+        const void* cookie,
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response) {
+    using cb::mcbp::request::SampleDocumentsPayload;
+    const auto& payload = *reinterpret_cast<const SampleDocumentsPayload*>(
+            request.getExtdata().data());
+    CollectionID cid{CollectionID::Default};
+    if (request.getExtlen() == sizeof(SampleDocumentsPayload)) {
+        cid = payload.getCollectionId();
+    }
+
+    auto priv = checkPrivilege(cookie, cb::rbac::Privilege::Read, cid);
+    if (priv != cb::engine_errc::success) {
+        return ENGINE_ERROR_CODE(priv);
+    }
+
+    const size_t count =
+            std::min(size_t(payload.getCount()), maxSampleDocuments);
+    std::vector<std::unique_ptr<Item>> sample;
+    auto ret = kvBucket->sampleDocuments(cid, count, cookie, sample);
+    if (ret != ENGINE_SUCCESS) {
+        return ret;
+    }
+
+    const bool collectionsSupported = isCollectionsSupported(cookie);
+    const bool snappySupported =
+            isDatatypeSupported(cookie, PROTOCOL_BINARY_DATATYPE_SNAPPY);
+    std::vector<char> body;
+    for (auto& item : sample) {
+        if (!snappySupported && !item->decompressValue()) {
+            return ENGINE_FAILED;
+        }
+        // Always return at least one document
+        if (!body.empty() &&
+            body.size() + getScanDocumentSize(
+                                  *item, false, collectionsSupported) >
+                    RangeScanTask::maxBufferSize) {
+            break;
+        }
+        appendScanDocument(body, *item, false, collectionsSupported);
+    }
+
+    return sendResponse(response,
+                        {}, // key
+                        {}, // extra
+                        {body.data(), body.size()},
+                        PROTOCOL_BINARY_RAW_BYTES,
+                        cb::mcbp::Status::Success,
+                        0,
+                        cookie);
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::dcpOpen(
         const void* cookie,
         uint32_t opaque,
@@ -6228,6 +7133,11 @@ void EventuallyPersistentEngine::handleDisconnect(const void *cookie) {
             storeEngineSpecific(cookie, nullptr);
             break;
         }
+        case cb::mcbp::ClientOpcode::SetWithMetaBatch:
+            delete static_cast<SetWithMetaBatchContext*>(
+                    getEngineSpecific(cookie));
+            storeEngineSpecific(cookie, nullptr);
+            break;
             default:
                 break;
             }
@@ -6711,10 +7621,12 @@ void EventuallyPersistentEngine::setMaxDataSize(size_t size) {
                 [size](KVStore* kvs) { kvs->setMaxDataSize(size); });
     }
 
-    // Update the ArenaMalloc threshold
+    // Update the ArenaMalloc threshold (and the untracked estimate's)
     arena.setEstimateUpdateThreshold(
             size, configuration.getMemUsedMergeThresholdPercent());
     cb::ArenaMalloc::setAllocatedThreshold(arena);
+    stats.setMemUsedMergeThreshold(
+            size, configuration.getMemUsedMergeThresholdPercent());
 }
 
 void EventuallyPersistentEngine::set_num_reader_threads(
@@ -30,6 +30,7 @@
 #include <platform/cb_arena_malloc_client.h>
 
 #include <chrono>
+#include <map>
 #include <string>
 #include <unordered_map>
 
@@ -133,6 +134,12 @@ public:
                                 const DocKey& key,
                                 Vbid vbucket,
                                 DocStateFilter documentStateFilter) override;
+    void prefetch(gsl::not_null<const void*> cookie,
+                  const std::vector<std::pair<Vbid, DocKey>>& keys) override;
+    std::optional<uint64_t> getDocumentGeneration(
+            gsl::not_null<const void*> cookie,
+            const DocKey& key,
+            Vbid vbucket) override;
     cb::EngineErrorItemPair get_if(
             gsl::not_null<const void*> cookie,
             const DocKey& key,
@@ -179,6 +186,28 @@ public:
             DocumentState document_state,
             bool preserveTtl) override;
 
+    void store_multi(gsl::not_null<const void*> cookie,
+                     Vbid vbucket,
+                     const std::vector<item*>& items,
+                     std::vector<cb::EngineErrorCasPair>& results) override;
+
+    ENGINE_ERROR_CODE arithmetic(gsl::not_null<const void*> cookie,
+                                 const DocKey& key,
+                                 Vbid vbucket,
+                                 bool increment,
+                                 uint64_t delta,
+                                 uint64_t& result,
+                                 uint64_t& cas,
+                                 mutation_descr_t& mutation) override;
+
+    ENGINE_ERROR_CODE appendPrepend(gsl::not_null<const void*> cookie,
+                                    const DocKey& key,
+                                    Vbid vbucket,
+                                    bool append,
+                                    std::string_view value,
+                                    uint64_t& cas,
+                                    mutation_descr_t& mutation) override;
+
     // Need to explicilty import EngineIface::flush to avoid warning about
     // DCPIface::flush hiding it.
     using EngineIface::flush;
@@ -238,6 +267,8 @@ public:
         return minCompressionRatio;
     }
 
+    bool isUnderMemoryPressure() override;
+
     // DcpIface implementation ////////////////////////////////////////////////
 
     ENGINE_ERROR_CODE step(
@@ -472,7 +503,16 @@ public:
                                      item** itm,
                                      const DocKey& key,
                                      Vbid vbucket,
-                                     uint32_t lock_timeout);
+                                     uint32_t lock_timeout,
+                                     WantsValue wantsValue = WantsValue::Yes);
+
+    /**
+     * Lock a document as get_locked does, sending back only its CAS and
+     * flags (so an evicted value isn't fetched from disk).
+     */
+    ENGINE_ERROR_CODE getLockedMeta(const void* cookie,
+                                    const cb::mcbp::Request& request,
+                                    const AddResponseFn& response);
 
     ENGINE_ERROR_CODE unlockInner(const void* cookie,
                                   const DocKey& key,
@@ -503,6 +543,28 @@ public:
                                         const cb::StoreIfPredicate& predicate,
                                         bool preserveTtl);
 
+    void storeMultiInner(const void* cookie,
+                         Vbid vbucket,
+                         const std::vector<item*>& items,
+                         std::vector<cb::EngineErrorCasPair>& results);
+
+    ENGINE_ERROR_CODE arithmeticInner(const void* cookie,
+                                      const DocKey& key,
+                                      Vbid vbucket,
+                                      bool increment,
+                                      uint64_t delta,
+                                      uint64_t& result,
+                                      uint64_t& cas,
+                                      mutation_descr_t& mutation);
+
+    ENGINE_ERROR_CODE appendPrependInner(const void* cookie,
+                                         const DocKey& key,
+                                         Vbid vbucket,
+                                         bool append,
+                                         std::string_view value,
+                                         uint64_t& cas,
+                                         mutation_descr_t& mutation);
+
     ENGINE_ERROR_CODE dcpOpen(const void* cookie,
                               uint32_t opaque,
                               uint32_t seqno,
@@ -523,6 +585,14 @@ public:
                                   const cb::mcbp::Request& request,
                                   const AddResponseFn& response);
 
+    /**
+     * Set a batch of documents of one vbucket with their meta data, sending
+     * the status of each document back in a single response.
+     */
+    ENGINE_ERROR_CODE setWithMetaBatch(const void* cookie,
+                                       const cb::mcbp::Request& request,
+                                       const AddResponseFn& response);
+
     ENGINE_ERROR_CODE deleteWithMeta(const void* cookie,
                                      const cb::mcbp::Request& request,
                                      const AddResponseFn& response);
@@ -535,12 +605,40 @@ public:
                                  const cb::mcbp::Request& request,
                                  const AddResponseFn& response);
 
+    /**
+     * Scan (one batch of) a range of keys of a collection, sending the
+     * documents in the range back to the connection from a RangeScanTask.
+     */
+    ENGINE_ERROR_CODE rangeScan(const void* cookie,
+                                const cb::mcbp::Request& request,
+                                const AddResponseFn& response);
+
     CONN_PRIORITY getDCPPriority(const void* cookie);
 
     void setDCPPriority(const void* cookie, CONN_PRIORITY priority);
 
     void notifyIOComplete(const void* cookie, ENGINE_ERROR_CODE status);
 
+    /**
+     * Notify a number of cookies that their IO has completed. The cookies
+     * are handed to the core in one call so it can wake each front-end
+     * thread once, rather than once per cookie.
+     *
+     * @param toNotify map of cookie to the status of its io operation
+     */
+    void notifyIOComplete(
+            const std::map<const void*, ENGINE_ERROR_CODE>& toNotify);
+
+    /**
+     * Notify a number of cookies that their IO has completed (in the order
+     * provided).
+     *
+     * @param toNotify the cookies and the status of their io operation
+     */
+    void notifyIOComplete(
+            const std::vector<std::pair<const void*, ENGINE_ERROR_CODE>>&
+                    toNotify);
+
     ENGINE_ERROR_CODE reserveCookie(const void *cookie);
     ENGINE_ERROR_CODE releaseCookie(const void *cookie);
 
@@ -731,6 +829,18 @@ public:
                                    const cb::mcbp::Request& request,
                                    const AddResponseFn& response);
 
+    /**
+     * Sample (up to the requested number of) documents of a collection at
+     * random, sending them back in one response in the encoding of a
+     * RangeScan.
+     */
+    ENGINE_ERROR_CODE sampleDocuments(const void* cookie,
+                                      const cb::mcbp::Request& request,
+                                      const AddResponseFn& response);
+
+    /// The maximum number of documents one SampleDocuments returns
+    static constexpr size_t maxSampleDocuments = 1000;
+
     void setCompressionMode(const std::string& compressModeStr);
 
     void setMinCompressionRatio(float minCompressRatio) {
@@ -748,7 +858,7 @@ public:
 
     /**
      * Method to add a cookie to allKeysLookups to store the result of the
-     * getAllKeys() request.
+     * getAllKeys() (or rangeScan()) request.
      * @param cookie the cookie that the getAllKeys() was processed for
      * @param err Engine error code of the result of getAllKeys()
      */
@@ -953,6 +1063,26 @@ protected:
                                      const AddStatFn& add_stat,
                                      std::string_view sep);
     void doTimingStats(StatCollector& collector);
+    /**
+     * Add the item send latency histogram of each DCP producer and the
+     * mutation processing time histogram of each DCP consumer, labelled
+     * with the connection name.
+     */
+    void doDcpLatencyStats(StatCollector& collector);
+    /**
+     * Add the scheduling (queue wait) and runtime histograms of each task
+     * type which has run at least once, labelled with the task name and type.
+     */
+    void doTaskTimingStats(StatCollector& collector);
+    /**
+     * Add the memory used by the bucket broken down by component (hash
+     * table metadata, keys and values, checkpoints, DCP queues), and the
+     * memory used by each collection.
+     *
+     * @param perVBucket also add each component for each vBucket
+     */
+    ENGINE_ERROR_CODE doMemoryBreakdownStats(StatCollector& collector,
+                                             bool perVBucket);
     ENGINE_ERROR_CODE doSchedulerStats(const void* cookie,
                                        const AddStatFn& add_stat);
     ENGINE_ERROR_CODE doRunTimeStats(const void* cookie,
@@ -1054,6 +1184,13 @@ protected:
                                PermittedVBStates& permittedVBStates,
                                DeleteSource& deleteSource);
 
+    /// decodeWithMetaOptions() of the options already read from the extras
+    bool decodeWithMetaOptions(uint32_t options,
+                               GenerateCas& generateCas,
+                               CheckConflicts& checkConflicts,
+                               PermittedVBStates& permittedVBStates,
+                               DeleteSource& deleteSource);
+
     /**
      * Private wrapper method for decodeWithMetaOptions called from setWithMeta
      * to abstract out deleteSource, which is unused by setWithMeta.
@@ -1159,6 +1296,29 @@ protected:
                                   GenerateCas genCas,
                                   cb::const_byte_buffer emd);
 
+    /**
+     * Create the Item for a set_with_meta with the given buffers/values,
+     * validating the value (and inflating it if required).
+     *
+     * @param vbucket VB to mutate
+     * @param key DocKey initialised with key data
+     * @param value buffer for the mutation's value
+     * @param itemMeta mutation's cas/revseq/flags/expiration
+     * @param isDeleted the Item is deleted (with value)
+     * @param datatype datatype of the mutation
+     * @param cookie connection's cookie
+     * @param item [out] the created Item
+     * @returns ENGINE_SUCCESS if the item was created
+     */
+    ENGINE_ERROR_CODE makeItemWithMeta(Vbid vbucket,
+                                       DocKey key,
+                                       cb::const_byte_buffer value,
+                                       ItemMetaData itemMeta,
+                                       bool isDeleted,
+                                       protocol_binary_datatype_t datatype,
+                                       const void* cookie,
+                                       std::unique_ptr<Item>& item);
+
     /**
      * Process the del_with_meta with the given buffers/values.
      *
@@ -1242,6 +1402,8 @@ protected:
     std::string name;
     size_t maxItemSize;
     size_t maxItemPrivilegedBytes;
+    /// May the frontend cache GET responses (frontend_get_cache)
+    bool frontendGetCache = false;
     size_t getlDefaultTimeout;
     size_t getlMaxTimeout;
     size_t maxFailoverEntries;
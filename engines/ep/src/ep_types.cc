@@ -77,6 +77,20 @@ std::string to_string(CheckpointType checkpointType) {
     folly::assume_unreachable();
 }
 
+std::string to_string(BgFetchPriority priority) {
+    switch (priority) {
+    case BgFetchPriority::ClientRead:
+        return "client_read";
+    case BgFetchPriority::Durability:
+        return "durability";
+    case BgFetchPriority::XdcrMeta:
+        return "xdcr_meta";
+    case BgFetchPriority::Background:
+        return "background";
+    }
+    folly::assume_unreachable();
+}
+
 std::string to_string(HighPriorityVBNotify hpNotifyType) {
     using HighPriorityVBNotifyUType =
             std::underlying_type<HighPriorityVBNotify>::type;
@@ -42,6 +42,7 @@ enum class GenerateCas : char { No, Yes };
 enum class GenerateDeleteTime { No, Yes };
 enum class TrackCasDrift : char { No, Yes };
 enum class WantsDeleted : char { No, Yes };
+enum class WantsValue : char { No, Yes };
 enum class TrackReference : char { No, Yes };
 enum class QueueExpired : char { No, Yes };
 enum class CheckConflicts : char { No, Yes };
@@ -148,6 +149,28 @@ enum get_options_t {
 /// Used to identify if QUEUE_BG_FETCH option is set
 enum class QueueBgFetch {Yes, No};
 
+/**
+ * The priority of a background fetch. The BgFetcher services the fetches of
+ * each pending vBucket in this order, so a client waiting on a read isn't
+ * stuck behind bulk metadata fetches or background work under disk
+ * saturation.
+ */
+enum class BgFetchPriority : uint8_t {
+    /// A client is waiting for the value (or metadata) of the document
+    ClientRead,
+    /// A SyncWrite needs the metadata of the document
+    Durability,
+    /// XDCR (get/set/delWithMeta) needs the metadata of the document
+    XdcrMeta,
+    /// Nobody waits for the fetch (prefetch, compaction expiry)
+    Background,
+};
+
+/// The number of BgFetchPriority values
+constexpr size_t NumBgFetchPriorities = 4;
+
+std::string to_string(BgFetchPriority priority);
+
 /**
  * Used to inform a function whether a get request is for the replica or active
  * item
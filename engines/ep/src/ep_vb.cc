@@ -72,7 +72,10 @@ EPVBucket::EPVBucket(Vbid i,
               lastSnapEnd,
               std::move(table),
               flusherCb,
-              std::make_unique<StoredValueFactory>(st),
+              std::make_unique<StoredValueFactory>(
+                      st,
+                      config.getHtInlineValueSize(),
+                      config.isHtCompactNonResident()),
               std::move(newSeqnoCb),
               syncWriteResolvedCb,
               syncWriteCb,
@@ -326,9 +329,7 @@ void EPVBucket::notifyHighPriorityRequests(EventuallyPersistentEngine& engine,
         shard->highPriorityCount.fetch_sub(toNotify.size());
     }
 
-    for (auto& notify : toNotify) {
-        engine.notifyIOComplete(notify.first, notify.second);
-    }
+    engine.notifyIOComplete(toNotify);
 }
 
 void EPVBucket::notifyAllPendingConnsFailed(EventuallyPersistentEngine& e) {
@@ -353,9 +354,9 @@ void EPVBucket::notifyAllPendingConnsFailed(EventuallyPersistentEngine& e) {
         pendingBGFetches.clear();
     }
 
-    for (auto& notify : toNotify) {
-        e.notifyIOComplete(notify.first, notify.second);
-    }
+    e.notifyIOComplete(toNotify);
+
+    failAllSeqnoWaiters();
 
     fireAllOps(e);
 }
@@ -522,9 +523,25 @@ void EPVBucket::addStats(VBucketStatsDetailLevel detail,
         }
         addStat("db_data_size", spaceUsed, add_stat, c);
         addStat("db_file_size", fileSize, add_stat, c);
+        addStat("flush_queue_wait_count",
+                flushQueueWaitCount.load(),
+                add_stat,
+                c);
+        addStat("flush_queue_wait_total",
+                flushQueueWaitTotal.load(),
+                add_stat,
+                c);
+        addStat("flush_queue_wait_max", flushQueueWaitMax.load(), add_stat, c);
     }
 }
 
+void EPVBucket::recordFlushQueueWait(std::chrono::microseconds wait) {
+    const auto w = static_cast<uint64_t>(wait.count());
+    ++flushQueueWaitCount;
+    flushQueueWaitTotal.fetch_add(w);
+    atomic_setIfBigger(flushQueueWaitMax, w);
+}
+
 UniqueDCPBackfillPtr EPVBucket::createDCPBackfill(
         EventuallyPersistentEngine& e,
         std::shared_ptr<ActiveStream> stream,
@@ -613,6 +630,11 @@ size_t EPVBucket::queueBGFetchItem(const DocKey& key,
         bgfetch_itm_ctx.isMetaOnly = GetMetaOnly::No;
     }
 
+    if (bgfetch_itm_ctx.bgfetched_list.empty() ||
+        fetch->getPriority() < bgfetch_itm_ctx.priority) {
+        bgfetch_itm_ctx.priority = fetch->getPriority();
+    }
+
     fetch->value = &bgfetch_itm_ctx.value;
     bgfetch_itm_ctx.bgfetched_list.push_back(std::move(fetch));
 
@@ -746,12 +768,13 @@ VBNotifyCtx EPVBucket::addNewAbort(const HashTable::HashBucketLock& hbl,
 void EPVBucket::bgFetch(const DocKey& key,
                         const void* cookie,
                         EventuallyPersistentEngine& engine,
-                        const bool isMeta) {
+                        const bool isMeta,
+                        BgFetchPriority priority) {
     // schedule to the current batch of background fetch of the given
     // vbucket
     size_t bgfetch_size = queueBGFetchItem(
             key,
-            std::make_unique<FrontEndBGFetchItem>(cookie, isMeta),
+            std::make_unique<FrontEndBGFetchItem>(cookie, isMeta, priority),
             getShard()->getBgFetcher());
     if (getShard()) {
         getShard()->getBgFetcher()->notifyBGEvent();
@@ -766,14 +789,15 @@ EPVBucket::addTempItemAndBGFetch(HashTable::HashBucketLock& hbl,
                                  const DocKey& key,
                                  const void* cookie,
                                  EventuallyPersistentEngine& engine,
-                                 bool metadataOnly) {
+                                 bool metadataOnly,
+                                 BgFetchPriority priority) {
     auto rv = addTempStoredValue(hbl, key);
     switch (rv.status) {
     case TempAddStatus::NoMem:
         return ENGINE_ENOMEM;
     case TempAddStatus::BgFetch:
         hbl.getHTLock().unlock();
-        bgFetch(key, cookie, engine, metadataOnly);
+        bgFetch(key, cookie, engine, metadataOnly, priority);
         return ENGINE_EWOULDBLOCK;
     }
     folly::assume_unreachable();
@@ -795,6 +819,39 @@ void EPVBucket::bgFetchForCompactionExpiry(const DocKey& key,
                  bgFetchSize);
 }
 
+bool EPVBucket::prefetch(const Collections::VB::CachingReadHandle& cHandle) {
+    auto res = fetchValidValue(WantsDeleted::Yes,
+                               TrackReference::No,
+                               QueueExpired::No,
+                               cHandle);
+    auto* v = res.storedValue;
+    if (v) {
+        // Nothing to do if the value is resident, the key is known to be
+        // deleted / not exist or a fetch is already pending for it
+        if (v->isResident() || v->isTempItem() || v->isDeleted()) {
+            return false;
+        }
+    } else {
+        if (eviction == EvictionPolicy::Value ||
+            !maybeKeyExistsInFilter(cHandle.getKey())) {
+            return false;
+        }
+        if (addTempStoredValue(res.lock, cHandle.getKey()).status !=
+            TempAddStatus::BgFetch) {
+            return false;
+        }
+    }
+    res.lock.getHTLock().unlock();
+
+    auto* bgFetcher = getShard()->getBgFetcher();
+    queueBGFetchItem(cHandle.getKey(),
+                     std::make_unique<PrefetchBGFetchItem>(),
+                     bgFetcher);
+    bgFetcher->notifyBGEvent();
+    ++stats.bg_prefetches;
+    return true;
+}
+
 void EPVBucket::updateBGStats(
         const std::chrono::steady_clock::time_point init,
         const std::chrono::steady_clock::time_point start,
@@ -235,6 +235,12 @@ public:
             std::optional<CollectionID> cid,
             const Collections::VB::WriteHandle& wHandle) override;
 
+    /**
+     * Record how long this vBucket waited in its Flusher's queue before a
+     * flush of it started.
+     */
+    void recordFlushQueueWait(std::chrono::microseconds wait);
+
 protected:
     /**
      * queue a background fetch of the specified item.
@@ -285,18 +291,24 @@ private:
     void bgFetch(const DocKey& key,
                  const void* cookie,
                  EventuallyPersistentEngine& engine,
-                 bool isMeta = false) override;
+                 bool isMeta = false,
+                 BgFetchPriority priority =
+                         BgFetchPriority::ClientRead) override;
 
     ENGINE_ERROR_CODE
-    addTempItemAndBGFetch(HashTable::HashBucketLock& hbl,
-                          const DocKey& key,
-                          const void* cookie,
-                          EventuallyPersistentEngine& engine,
-                          bool metadataOnly) override;
+    addTempItemAndBGFetch(
+            HashTable::HashBucketLock& hbl,
+            const DocKey& key,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            bool metadataOnly,
+            BgFetchPriority priority = BgFetchPriority::ClientRead) override;
 
     void bgFetchForCompactionExpiry(const DocKey& key,
                                     const Item& item) override;
 
+    bool prefetch(const Collections::VB::CachingReadHandle& cHandle) override;
+
     /**
      * Helper function to update stats after completion of a background fetch
      * for either the value of metadata of a key.
@@ -343,5 +355,11 @@ private:
      */
     std::atomic<uint64_t> deferredDeletionFileRevision;
 
+    /// Number of flushes, total and maximum time (in microseconds) this
+    /// vBucket waited in its Flusher's queue.
+    std::atomic<uint64_t> flushQueueWaitCount{0};
+    std::atomic<uint64_t> flushQueueWaitTotal{0};
+    std::atomic<uint64_t> flushQueueWaitMax{0};
+
     friend class EPVBucketTest;
 };
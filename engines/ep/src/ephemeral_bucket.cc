@@ -166,9 +166,11 @@ void EphemeralBucket::attemptToFreeMemory() {
     }
 }
 
-ENGINE_ERROR_CODE EphemeralBucket::scheduleCompaction(Vbid vbid,
-                                                      const CompactionConfig& c,
-                                                      const void* ck) {
+ENGINE_ERROR_CODE EphemeralBucket::scheduleCompaction(
+        Vbid vbid,
+        const CompactionConfig& c,
+        const void* ck,
+        std::chrono::seconds delay) {
     return ENGINE_ENOTSUP;
 }
 
@@ -199,28 +201,33 @@ VBucketPtr EphemeralBucket::makeVBucket(
     // 1. make_shared doesn't accept a Deleter
     // 2. allocate_shared has inconsistencies between platforms in calling
     //    alloc.destroy (libc++ doesn't call it)
-    return VBucketPtr(new EphemeralVBucket(id,
-                                           state,
-                                           stats,
-                                           engine.getCheckpointConfig(),
-                                           shard,
-                                           lastSeqno,
-                                           lastSnapStart,
-                                           lastSnapEnd,
-                                           std::move(table),
-                                           std::move(newSeqnoCb),
-                                           makeSyncWriteResolvedCB(),
-                                           makeSyncWriteCompleteCB(),
-                                           makeSeqnoAckCB(),
-                                           engine.getConfiguration(),
-                                           eviction_policy,
-                                           std::move(manifest),
-                                           initState,
-                                           purgeSeqno,
-                                           maxCas,
-                                           mightContainXattrs,
-                                           replicationTopology),
-                      VBucket::DeferredDeleter(engine));
+    VBucketPtr vb(new EphemeralVBucket(id,
+                                       state,
+                                       stats,
+                                       engine.getCheckpointConfig(),
+                                       shard,
+                                       lastSeqno,
+                                       lastSnapStart,
+                                       lastSnapEnd,
+                                       std::move(table),
+                                       std::move(newSeqnoCb),
+                                       makeSyncWriteResolvedCB(),
+                                       makeSyncWriteCompleteCB(),
+                                       makeSeqnoAckCB(),
+                                       engine.getConfiguration(),
+                                       eviction_policy,
+                                       std::move(manifest),
+                                       initState,
+                                       purgeSeqno,
+                                       maxCas,
+                                       mightContainXattrs,
+                                       replicationTopology),
+                  VBucket::DeferredDeleter(engine));
+    vb->setSyncWriteCompleteBatchCallback(makeSyncWriteCompleteBatchCB());
+    vb->setSyncWriteExpiryCallback(makeSyncWriteExpiryCB());
+    vb->setSeqnoWaitersNotifyCallback(makeSeqnoWaitersNotifyCB());
+    vb->ht.setValueDeduplicator(valueDeduplicator);
+    return vb;
 }
 
 void EphemeralBucket::completeStatsVKey(const void* cookie,
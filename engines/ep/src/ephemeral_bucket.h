@@ -36,9 +36,11 @@ public:
 
     bool initialize() override;
 
-    ENGINE_ERROR_CODE scheduleCompaction(Vbid vbid,
-                                         const CompactionConfig& c,
-                                         const void* ck) override;
+    ENGINE_ERROR_CODE scheduleCompaction(
+            Vbid vbid,
+            const CompactionConfig& c,
+            const void* ck,
+            std::chrono::seconds delay = std::chrono::seconds(0)) override;
 
     ENGINE_ERROR_CODE cancelCompaction(Vbid vbid) override;
 
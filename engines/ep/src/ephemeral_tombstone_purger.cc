@@ -41,6 +41,28 @@ void EphemeralVBucket::HTTombstonePurger::setCurrentVBucket(VBucket& vb) {
     vbucket = &dynamic_cast<EphemeralVBucket&>(vb);
 }
 
+bool EphemeralVBucket::HTTombstonePurger::shouldVisitVBucket(VBucket& vb) {
+    auto& ephVb = dynamic_cast<EphemeralVBucket&>(vb);
+    if (vbucket == &ephVb) {
+        // Resuming a paused visit of this VBucket
+        return true;
+    }
+
+    const auto highSeqno = vb.getHighSeqno();
+    if (highSeqno == ephVb.htTombstonesPurgedSeqno) {
+        return false;
+    }
+    vbStartSeqno = highSeqno;
+    tombstonesRemain = false;
+    return true;
+}
+
+void EphemeralVBucket::HTTombstonePurger::completeVBucket(VBucket& vb) {
+    if (!tombstonesRemain) {
+        vbucket->htTombstonesPurgedSeqno = vbStartSeqno;
+    }
+}
+
 bool EphemeralVBucket::HTTombstonePurger::visit(
         const HashTable::HashBucketLock& hbl, StoredValue& v) {
     auto* osv = v.toOrderedStoredValue();
@@ -66,6 +88,8 @@ bool EphemeralVBucket::HTTombstonePurger::visit(
         }
         ++vbucket->htDeletedPurgeCount;
         ++numPurgedItems;
+    } else if (osv->isDeleted() || osv->isCompleted()) {
+        tombstonesRemain = true;
     }
     ++numVisitedItems;
 
@@ -90,6 +90,15 @@ public:
 
     void setCurrentVBucket(VBucket& vb) override;
 
+    /**
+     * Skips VBuckets which have not changed (their high seqno is the same)
+     * since a previous visit left no tombstones in their HashTable: every
+     * new or updated tombstone gets a new seqno.
+     */
+    bool shouldVisitVBucket(VBucket& vb) override;
+
+    void completeVBucket(VBucket& vb) override;
+
     bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override;
 
     /// Return the number of items visited in the HashTable.
@@ -106,7 +115,14 @@ public:
 
 protected:
     /// VBucket being visited.
-    EphemeralVBucket* vbucket;
+    EphemeralVBucket* vbucket = nullptr;
+
+    /// High seqno of the VBucket being visited when the visit started.
+    int64_t vbStartSeqno = 0;
+
+    /// Has the visit of the current VBucket left any deleted or completed
+    /// items (not yet old enough to purge) in the HashTable?
+    bool tombstonesRemain = false;
 
     /// Time point the purge is running at. Set to ep_real_time in object
     /// creation.
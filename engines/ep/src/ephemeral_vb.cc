@@ -294,9 +294,9 @@ void EphemeralVBucket::notifyAllPendingConnsFailed(
         EventuallyPersistentEngine& e) {
     auto toNotify = tmpFailAndGetAllHpNotifies(e);
 
-    for (auto& notify : toNotify) {
-        e.notifyIOComplete(notify.first, notify.second);
-    }
+    e.notifyIOComplete(toNotify);
+
+    failAllSeqnoWaiters();
 
     fireAllOps(e);
 }
@@ -370,10 +370,14 @@ size_t EphemeralVBucket::purgeStaleItems(std::function<bool()> shouldPauseCbk) {
                                      std::placeholders::_2,
                                      std::placeholders::_3);
 
+    // Only the part of the list holding stale items needs visiting; dropping
+    // a collection requests that the whole list is (see
+    // addSystemEventItem).
     auto seqListPurged = seqList->purgeTombstones(
             static_cast<seqno_t>(seqList->getHighSeqno()) - 1,
             droppedCallback,
-            shouldPauseCbk);
+            shouldPauseCbk,
+            SequenceList::PurgeScope::StaleOnly);
 
     // Update stats and return.
     seqListPurgeCount += seqListPurged;
@@ -842,7 +846,8 @@ void EphemeralVBucket::updateSeqListPostAbort(
 void EphemeralVBucket::bgFetch(const DocKey& key,
                                const void* cookie,
                                EventuallyPersistentEngine& engine,
-                               const bool isMeta) {
+                               const bool isMeta,
+                               BgFetchPriority priority) {
     throw std::logic_error(
             "EphemeralVBucket::bgFetch() is not valid. Called on " +
             getId().to_string() + " for key: " +
@@ -854,7 +859,8 @@ EphemeralVBucket::addTempItemAndBGFetch(HashTable::HashBucketLock& hbl,
                                         const DocKey& key,
                                         const void* cookie,
                                         EventuallyPersistentEngine& engine,
-                                        bool metadataOnly) {
+                                        bool metadataOnly,
+                                        BgFetchPriority priority) {
     /* [EPHE TODO]: Just return error code and make all the callers handle it */
     throw std::logic_error(
             "EphemeralVBucket::addTempItemAndBGFetch() is not valid. "
@@ -872,6 +878,12 @@ void EphemeralVBucket::bgFetchForCompactionExpiry(const DocKey& key,
             std::string(reinterpret_cast<const char*>(key.data()), key.size()));
 }
 
+bool EphemeralVBucket::prefetch(
+        const Collections::VB::CachingReadHandle& cHandle) {
+    // Everything is resident in an ephemeral bucket
+    return false;
+}
+
 GetValue EphemeralVBucket::getInternalNonResident(
         const DocKey& key,
         const void* cookie,
@@ -993,6 +1005,10 @@ int64_t EphemeralVBucket::addSystemEventItem(
         if (i->isDeleted()) {
             stats.dropCollectionStats(*cid);
 
+            // The collection's items are not stale, so the next purge must
+            // visit the whole sequence list to find (and drop) them
+            seqList->requestFullPurge();
+
             // Inform the PDM about the dropped collection so that it knows
             // that it can skip any outstanding prepares until they are cleaned
             // up
@@ -326,18 +326,24 @@ private:
     void bgFetch(const DocKey& key,
                  const void* cookie,
                  EventuallyPersistentEngine& engine,
-                 bool isMeta = false) override;
+                 bool isMeta = false,
+                 BgFetchPriority priority =
+                         BgFetchPriority::ClientRead) override;
 
     ENGINE_ERROR_CODE
-    addTempItemAndBGFetch(HashTable::HashBucketLock& hbl,
-                          const DocKey& key,
-                          const void* cookie,
-                          EventuallyPersistentEngine& engine,
-                          bool metadataOnly) override;
+    addTempItemAndBGFetch(
+            HashTable::HashBucketLock& hbl,
+            const DocKey& key,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            bool metadataOnly,
+            BgFetchPriority priority = BgFetchPriority::ClientRead) override;
 
     void bgFetchForCompactionExpiry(const DocKey& key,
                                     const Item& item) override;
 
+    bool prefetch(const Collections::VB::CachingReadHandle& cHandle) override;
+
     GetValue getInternalNonResident(const DocKey& key,
                                     const void* cookie,
                                     EventuallyPersistentEngine& engine,
@@ -395,6 +401,13 @@ private:
      */
     EPStats::Counter htDeletedPurgeCount;
 
+    /**
+     * High seqno at the start of the last HashTable tombstone purge which
+     * left no deleted or completed items in the HashTable. While the high
+     * seqno is unchanged there is nothing for the purge to do.
+     */
+    cb::RelaxedAtomic<int64_t> htTombstonesPurgedSeqno{0};
+
     /** Count of how many items have been purged from the sequence list
      *  (removed from seqList and deleted).
      */
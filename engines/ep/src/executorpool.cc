@@ -16,12 +16,17 @@
  */
 
 #include "executorpool.h"
+#include "atomic.h"
+#include "bucket_logger.h"
 #include "cb3_executorpool.h"
 #include "configuration.h"
 #include "ep_engine.h"
 #include "folly_executorpool.h"
 #include "objectregistry.h"
 
+#include <statistics/collector.h>
+#include <gsl/gsl>
+
 std::mutex ExecutorPool::initGuard;
 std::atomic<ExecutorPool*> ExecutorPool::instance;
 
@@ -58,12 +63,22 @@ ExecutorPool *ExecutorPool::get() {
                         ThreadPoolConfig::ThreadCount(
                                 config.getNumWriterThreads()),
                         config.getNumAuxioThreads(),
-                        config.getNumNonioThreads());
+                        config.getNumNonioThreads(),
+                        config.isExecutorPoolWorkStealing());
             } else {
                 throw std::invalid_argument(
                         "ExecutorPool::get() Invalid executor_pool_backend '" +
                         config.getExecutorPoolBackend() + "'");
             }
+            if (config.isAdaptiveThreads()) {
+                AdaptiveThreadsConfig adaptive;
+                adaptive.maxThreads = config.getAdaptiveThreadsMax();
+                adaptive.waitThreshold = std::chrono::milliseconds(
+                        config.getAdaptiveThreadsWaitMs());
+                tmp->enableAdaptiveThreads(adaptive);
+                tmp->startAdaptiveThreads(std::chrono::milliseconds(
+                        config.getAdaptiveThreadsIntervalMs()));
+            }
             instance.store(tmp);
         }
     }
@@ -75,6 +90,9 @@ void ExecutorPool::shutdown() {
     auto* tmp = instance.load();
     if (tmp != nullptr) {
         NonBucketAllocationGuard guard;
+        // Stop the controller before the pool (subclass) starts destructing,
+        // as the controller calls into it.
+        tmp->stopAdaptiveThreads();
         delete tmp;
         instance = nullptr;
     }
@@ -85,6 +103,199 @@ ExecutorPool::ExecutorPool(size_t maxThreads)
                                   : Couchbase::get_available_cpu_count()) {
 }
 
+ExecutorPool::~ExecutorPool() {
+    stopAdaptiveThreads();
+}
+
+size_t ExecutorPool::getNumThreads(task_type_t type) {
+    switch (type) {
+    case READER_TASK_IDX:
+        return getNumReaders();
+    case WRITER_TASK_IDX:
+        return getNumWriters();
+    case AUXIO_TASK_IDX:
+        return getNumAuxIO();
+    case NONIO_TASK_IDX:
+        return getNumNonIO();
+    case NO_TASK_TYPE:
+    case NUM_TASK_GROUPS:
+        break;
+    }
+    folly::assume_unreachable();
+}
+
+void ExecutorPool::setNumThreads(task_type_t type, size_t count) {
+    switch (type) {
+    case READER_TASK_IDX:
+        setNumReaders(ThreadPoolConfig::ThreadCount(count));
+        return;
+    case WRITER_TASK_IDX:
+        setNumWriters(ThreadPoolConfig::ThreadCount(count));
+        return;
+    case AUXIO_TASK_IDX:
+        setNumAuxIO(gsl::narrow<uint16_t>(count));
+        return;
+    case NONIO_TASK_IDX:
+        setNumNonIO(gsl::narrow<uint16_t>(count));
+        return;
+    case NO_TASK_TYPE:
+    case NUM_TASK_GROUPS:
+        break;
+    }
+    folly::assume_unreachable();
+}
+
+void ExecutorPool::enableAdaptiveThreads(const AdaptiveThreadsConfig& config) {
+    std::lock_guard<std::mutex> guard(adaptiveMutex);
+    adaptiveConfig = config;
+    if (adaptiveConfig.maxThreads == 0) {
+        adaptiveConfig.maxThreads = maxGlobalThreads;
+    }
+    for (int type = 0; type < NUM_TASK_GROUPS; ++type) {
+        auto& state = adaptiveState[type];
+        state = {};
+        state.minThreads = getNumThreads(task_type_t(type));
+        state.lastThreads = state.minThreads;
+        maxTaskWaitUs[type] = 0;
+    }
+    adaptiveThreadsEnabled = true;
+}
+
+void ExecutorPool::startAdaptiveThreads(std::chrono::milliseconds interval) {
+    Expects(adaptiveThreadsEnabled);
+    std::lock_guard<std::mutex> guard(adaptiveMutex);
+    if (adaptiveThread.joinable()) {
+        return;
+    }
+    adaptiveStop = false;
+    adaptiveThread = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(adaptiveMutex);
+        while (!adaptiveCond.wait_for(
+                lock, interval, [this] { return adaptiveStop; })) {
+            lock.unlock();
+            adjustThreadPools();
+            lock.lock();
+        }
+    });
+}
+
+void ExecutorPool::stopAdaptiveThreads() {
+    {
+        std::lock_guard<std::mutex> guard(adaptiveMutex);
+        if (!adaptiveThread.joinable()) {
+            return;
+        }
+        adaptiveStop = true;
+    }
+    adaptiveCond.notify_all();
+    adaptiveThread.join();
+}
+
+void ExecutorPool::recordTaskWaitImpl(
+        task_type_t type, std::chrono::steady_clock::duration wait) {
+    const auto us =
+            std::chrono::duration_cast<std::chrono::microseconds>(wait).count();
+    atomic_setIfBigger(maxTaskWaitUs[type], int64_t(us));
+}
+
+void ExecutorPool::adjustThreadPools() {
+    if (!adaptiveThreadsEnabled) {
+        return;
+    }
+    NonBucketAllocationGuard allocGuard;
+    std::lock_guard<std::mutex> guard(adaptiveMutex);
+    const auto thresholdUs =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    adaptiveConfig.waitThreshold)
+                    .count();
+
+    for (int typeIdx = 0; typeIdx < NUM_TASK_GROUPS; ++typeIdx) {
+        const auto type = task_type_t(typeIdx);
+        auto& state = adaptiveState[type];
+        const auto threads = getNumThreads(type);
+        if (threads != state.lastThreads) {
+            // Resized by someone else - respect that as the new lower bound.
+            state.minThreads = threads;
+            state.pressuredSteps = 0;
+            state.idleSteps = 0;
+        }
+        const auto maxThreads =
+                std::max(adaptiveConfig.maxThreads, state.minThreads);
+
+        const auto ready = getNumReadyTasksOfType(type);
+        const auto maxWaitUs = maxTaskWaitUs[type].exchange(0);
+        const bool pressured = ready > threads || maxWaitUs > thresholdUs;
+        const bool idle = ready == 0 && maxWaitUs < thresholdUs / 4;
+
+        state.pressuredSteps = pressured ? state.pressuredSteps + 1 : 0;
+        state.idleSteps = idle ? state.idleSteps + 1 : 0;
+
+        auto newThreads = threads;
+        if (state.pressuredSteps >= adaptiveConfig.growAfter &&
+            threads < maxThreads) {
+            newThreads = threads + 1;
+            state.grows++;
+        } else if (state.idleSteps >= adaptiveConfig.shrinkAfter &&
+                   threads > state.minThreads) {
+            newThreads = threads - 1;
+            state.shrinks++;
+        }
+
+        if (newThreads != threads) {
+            state.lastAdjustment = fmt::format(
+                    "{} -> {} threads (ready tasks:{} max wait:{}us)",
+                    threads,
+                    newThreads,
+                    ready,
+                    maxWaitUs);
+            EP_LOG_INFO(
+                    "ExecutorPool: adaptive resize of {} pool from {} to {} "
+                    "threads (ready tasks:{} max wait:{}us bounds:[{},{}])",
+                    to_string(type),
+                    threads,
+                    newThreads,
+                    ready,
+                    maxWaitUs,
+                    state.minThreads,
+                    maxThreads);
+            setNumThreads(type, newThreads);
+            state.pressuredSteps = 0;
+            state.idleSteps = 0;
+        }
+        state.lastThreads = newThreads;
+    }
+}
+
+void ExecutorPool::doAdaptiveThreadsStats(const void* cookie,
+                                          const AddStatFn& add_stat) {
+    if (!adaptiveThreadsEnabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(adaptiveMutex);
+    for (int typeIdx = 0; typeIdx < NUM_TASK_GROUPS; ++typeIdx) {
+        const auto type = task_type_t(typeIdx);
+        const auto& state = adaptiveState[type];
+        const auto prefix = "ep_workload:adaptive:" + to_string(type) + ":";
+        add_casted_stat((prefix + "min_threads").c_str(),
+                        state.minThreads,
+                        add_stat,
+                        cookie);
+        add_casted_stat((prefix + "max_threads").c_str(),
+                        std::max(adaptiveConfig.maxThreads, state.minThreads),
+                        add_stat,
+                        cookie);
+        add_casted_stat(
+                (prefix + "grows").c_str(), state.grows, add_stat, cookie);
+        add_casted_stat(
+                (prefix + "shrinks").c_str(), state.shrinks, add_stat, cookie);
+        add_casted_stat((prefix + "last_adjustment").c_str(),
+                        state.lastAdjustment.empty() ? "none"
+                                                     : state.lastAdjustment,
+                        add_stat,
+                        cookie);
+    }
+}
+
 size_t ExecutorPool::calcNumReaders(
         ThreadPoolConfig::ThreadCount threadCount) const {
     switch (threadCount) {
@@ -19,9 +19,14 @@
 #include <memcached/thread_pool_config.h>
 
 #include "task_type.h"
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 
 class GlobalTask;
 class Taskable;
@@ -164,7 +169,70 @@ public:
                              const void* cookie,
                              const AddStatFn& add_stat) = 0;
 
-    virtual ~ExecutorPool() = default;
+    /**
+     * Bounds and thresholds for the adaptive thread pool controller - see
+     * adjustThreadPools().
+     */
+    struct AdaptiveThreadsConfig {
+        /// Upper bound for the size of any one pool (0 = maxGlobalThreads).
+        size_t maxThreads = 0;
+        /// A pool is under pressure if any task waited longer than this to
+        /// run during the last interval.
+        std::chrono::milliseconds waitThreshold{10};
+        /// Number of consecutive pressured intervals before a pool is grown.
+        size_t growAfter = 2;
+        /// Number of consecutive idle intervals before a pool is shrunk.
+        size_t shrinkAfter = 6;
+    };
+
+    /**
+     * Enable the adaptive thread pool controller. The current size of each
+     * pool becomes its lower bound.
+     * Does not start the background thread which drives the controller - see
+     * startAdaptiveThreads().
+     */
+    void enableAdaptiveThreads(const AdaptiveThreadsConfig& config);
+
+    /**
+     * Start a background thread calling adjustThreadPools() every
+     * `interval`. enableAdaptiveThreads() must have been called first.
+     */
+    void startAdaptiveThreads(std::chrono::milliseconds interval);
+
+    /// Stop (and join) the adaptive controller's background thread, if any.
+    void stopAdaptiveThreads();
+
+    /**
+     * Run one step of the adaptive controller: for each pool, grow it by one
+     * thread if it has been under pressure (more ready tasks than threads,
+     * or a task waited longer than waitThreshold) for growAfter consecutive
+     * steps; shrink it by one if it was idle (nothing ready, waits under a
+     * quarter of the threshold) for shrinkAfter consecutive steps.
+     * Pools stay within [initial size, maxThreads]. If a pool's size was
+     * changed externally (e.g. set_num_reader_threads), the new size becomes
+     * its lower bound.
+     * No-op unless enableAdaptiveThreads() has been called.
+     */
+    void adjustThreadPools();
+
+    /**
+     * Record how long a task of the given type waited between becoming ready
+     * and starting to run. Used by the adaptive controller.
+     */
+    void recordTaskWait(task_type_t type,
+                        std::chrono::steady_clock::duration wait) {
+        if (adaptiveThreadsEnabled) {
+            recordTaskWaitImpl(type, wait);
+        }
+    }
+
+    /**
+     * Generates stats describing the adaptive controller's bounds and the
+     * adjustments it has made (if enabled).
+     */
+    void doAdaptiveThreadsStats(const void* cookie, const AddStatFn& add_stat);
+
+    virtual ~ExecutorPool();
 
     /**
      * Return the thread priority to use for threads of the given task type.
@@ -176,6 +244,15 @@ public:
 protected:
     ExecutorPool(size_t maxThreads);
 
+    /// @returns the number of tasks of the given type ready to run.
+    virtual size_t getNumReadyTasksOfType(task_type_t type) = 0;
+
+    /// @returns the number of threads for the given task type.
+    size_t getNumThreads(task_type_t type);
+
+    /// Set the number of threads for the given task type.
+    void setNumThreads(task_type_t type, size_t count);
+
     /**
      * Calculate the number of Reader threads to use for the given thread limit.
      */
@@ -208,4 +285,36 @@ protected:
      * of available CPU cores.
      */
     const size_t maxGlobalThreads;
+
+private:
+    void recordTaskWaitImpl(task_type_t type,
+                            std::chrono::steady_clock::duration wait);
+
+    /// Per-pool state of the adaptive controller.
+    struct AdaptivePoolState {
+        /// Lower bound for the pool's size.
+        size_t minThreads = 0;
+        /// The size the controller last saw / set.
+        size_t lastThreads = 0;
+        /// Consecutive steps the pool has been under pressure / idle.
+        size_t pressuredSteps = 0;
+        size_t idleSteps = 0;
+        /// Adjustments made so far, and a description of the latest one.
+        size_t grows = 0;
+        size_t shrinks = 0;
+        std::string lastAdjustment;
+    };
+
+    std::atomic<bool> adaptiveThreadsEnabled{false};
+
+    /// Longest wait (in microseconds) of each task type since the last step.
+    std::array<std::atomic<int64_t>, NUM_TASK_GROUPS> maxTaskWaitUs{};
+
+    /// Guards the adaptive controller state below.
+    std::mutex adaptiveMutex;
+    AdaptiveThreadsConfig adaptiveConfig;
+    std::array<AdaptivePoolState, NUM_TASK_GROUPS> adaptiveState;
+    std::condition_variable adaptiveCond;
+    bool adaptiveStop = false;
+    std::thread adaptiveThread;
 };
@@ -0,0 +1,69 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "expiry_index.h"
+
+#include <algorithm>
+#include <iterator>
+
+void ExpiryIndex::enable(size_t max) {
+    maxEntries = max;
+}
+
+void ExpiryIndex::add(const DocKey& key, time_t exptime) {
+    const auto max = maxEntries.load(std::memory_order_relaxed);
+    if (exptime == 0 || max == 0 || isOverflowed()) {
+        return;
+    }
+    if (numEntries.fetch_add(1) >= max) {
+        numEntries--;
+        overflowed = true;
+        return;
+    }
+    auto buckets = shards[key.hash() % NumShards].lock();
+    (*buckets)[exptime / BucketSeconds].emplace_back(key);
+}
+
+std::vector<StoredDocKey> ExpiryIndex::takeDue(time_t now) {
+    const auto end = now / BucketSeconds;
+    std::vector<StoredDocKey> keys;
+    for (auto& shard : shards) {
+        auto locked = shard.lock();
+        auto last = locked->upper_bound(end);
+        for (auto it = locked->begin(); it != last; ++it) {
+            std::move(it->second.begin(),
+                      it->second.end(),
+                      std::back_inserter(keys));
+        }
+        locked->erase(locked->begin(), last);
+    }
+    numEntries -= keys.size();
+    return keys;
+}
+
+void ExpiryIndex::clear() {
+    for (auto& shard : shards) {
+        auto locked = shard.lock();
+        size_t count = 0;
+        for (const auto& bucket : *locked) {
+            count += bucket.second.size();
+        }
+        locked->clear();
+        numEntries -= count;
+    }
+    overflowed = false;
+}
@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "storeddockey.h"
+
+#include <folly/Synchronized.h>
+
+#include <array>
+#include <atomic>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * The keys of the documents of a HashTable which have an expiry time,
+ * bucketed by the time they expire at, so that the ExpiredItemPager only
+ * needs to look at the documents which have expired rather than visiting
+ * the whole HashTable.
+ *
+ * Entries are added when a document is stored with an expiry time, and are
+ * never removed when the document is updated or deleted: the pager takes
+ * the keys which expire before "now" and checks the current version of the
+ * document in the HashTable.
+ *
+ * The index holds at most maxEntries keys. When it overflows it stops
+ * tracking keys and the pager falls back to a full scan of the HashTable,
+ * which rebuilds the index.
+ */
+class ExpiryIndex {
+public:
+    /// The number of seconds covered by one bucket of keys
+    static constexpr time_t BucketSeconds = 60;
+
+    /// Start tracking the keys (by default the index is disabled)
+    void enable(size_t maxEntries);
+
+    bool isEnabled() const {
+        return maxEntries.load(std::memory_order_relaxed) != 0;
+    }
+
+    /// Has a key not been tracked as the index was full?
+    bool isOverflowed() const {
+        return overflowed.load(std::memory_order_relaxed);
+    }
+
+    /// Track the key of a document expiring at exptime (if non-zero)
+    void add(const DocKey& key, time_t exptime);
+
+    /**
+     * Remove the keys of the buckets which are due at now. The bucket now
+     * falls into may hold keys which only expire later than now, which
+     * should be added again.
+     *
+     * @return the keys (of which the documents may since have been updated
+     *         or deleted)
+     */
+    std::vector<StoredDocKey> takeDue(time_t now);
+
+    /// Is a key expiring at exptime taken by takeDue(now)?
+    static bool isDue(time_t exptime, time_t now) {
+        return exptime != 0 && exptime / BucketSeconds <= now / BucketSeconds;
+    }
+
+    /// Forget all of the keys (and any overflow)
+    void clear();
+
+    size_t getNumEntries() const {
+        return numEntries;
+    }
+
+private:
+    static constexpr size_t NumShards = 8;
+
+    using Buckets = std::map<time_t, std::vector<StoredDocKey>>;
+
+    /// Sharded by key hash, the keys are added on the front-end threads
+    std::array<folly::Synchronized<Buckets, std::mutex>, NumShards> shards;
+    std::atomic<size_t> maxEntries{0};
+    std::atomic<size_t> numEntries{0};
+    std::atomic<bool> overflowed{false};
+};
@@ -20,7 +20,10 @@
 #include "bucket_logger.h"
 #include "common.h"
 #include "ep_bucket.h"
+#include "ep_engine.h"
+#include "ep_vb.h"
 #include "executorpool.h"
+#include "kvshard.h"
 #include "tasks.h"
 
 #include <platform/timeutils.h>
@@ -30,15 +33,17 @@
 #include <sstream>
 #include <thread>
 
-Flusher::Flusher(EPBucket* st, KVShard* k)
+Flusher::Flusher(EPBucket* st, KVShard* k, size_t lane)
     : store(st),
       _state(State::Initializing),
       taskId(0),
       forceShutdownReceived(false),
+      lpVbs(st->getEPEngine().getConfiguration().getMaxVbuckets()),
       doHighPriority(false),
       numHighPriority(0),
       pendingMutation(false),
-      shard(k) {
+      shard(k),
+      lane(lane) {
 }
 
 Flusher::~Flusher() {
@@ -156,7 +161,7 @@ void Flusher::initialize() {
 void Flusher::schedule_UNLOCKED() {
     ExecutorPool* iom = ExecutorPool::get();
     ExTask task = std::make_shared<FlusherTask>(
-            ObjectRegistry::getCurrentEngine(), this, shard->getId());
+            ObjectRegistry::getCurrentEngine(), this, shard->getId(), lane);
     this->setTaskId(task->getId());
     iom->schedule(task);
 }
@@ -256,6 +261,10 @@ bool Flusher::flushVB() {
     // Search for any high priority vBuckets to flush.
     if (!doHighPriority && shard->highPriorityCount.load() > 0) {
         for (auto vbid : shard->getVBuckets()) {
+            if (shard->getFlusher(vbid) != this) {
+                // Flushed by another of the shard's Flushers.
+                continue;
+            }
             VBucketPtr vb = store->getVBucket(vbid);
             if (vb && vb->getHighPriorityChkSize() > 0) {
                 hpVbs.push(vbid);
@@ -272,7 +281,9 @@ bool Flusher::flushVB() {
         Vbid vbid = hpVbs.front();
         hpVbs.pop();
 
+        recordQueueWait(vbid);
         const auto res = store->flushVBucket(vbid);
+        shard->recordFlushLoad(vbid, res.numFlushed);
 
         if (res.moreAvailable == EPBucket::MoreAvailable::Yes) {
             // More items still available, add vbid back to pending set.
@@ -297,13 +308,20 @@ bool Flusher::flushVB() {
         doHighPriority = false;
     }
 
+    const auto groupSize = store->getFlusherGroupCommitVBuckets();
+    if (groupSize > 1) {
+        return flushLowPriorityGroup(groupSize);
+    }
+
     Vbid vbid;
     if (!lpVbs.popFront(vbid)) {
         // Return no more so we don't rewake the task
         return false;
     }
 
+    recordQueueWait(vbid);
     const auto res = store->flushVBucket(vbid);
+    shard->recordFlushLoad(vbid, res.numFlushed);
 
     if (res.moreAvailable == EPBucket::MoreAvailable::Yes) {
         // More items still available, add vbid back to pending set.
@@ -319,6 +337,74 @@ bool Flusher::flushVB() {
     return true;
 }
 
+bool Flusher::flushLowPriorityGroup(size_t groupSize) {
+    EPBucket::GroupCommit group;
+    // vBuckets to add back to the pending set once the group is complete;
+    // not added back while grouping so each is flushed at most once per group.
+    std::vector<Vbid> requeue;
+    bool wakeupCkptRemover = false;
+
+    size_t numVBuckets = 0;
+    Vbid vbid;
+    while (numVBuckets < groupSize && lpVbs.popFront(vbid)) {
+        ++numVBuckets;
+        recordQueueWait(vbid);
+        const auto res = store->flushVBucket(vbid, group);
+        shard->recordFlushLoad(vbid, res.numFlushed);
+
+        if (res.moreAvailable == EPBucket::MoreAvailable::Yes) {
+            requeue.push_back(vbid);
+        }
+        if (res.wakeupCkptRemover == EPBucket::WakeCkptRemover::Yes) {
+            wakeupCkptRemover = true;
+        }
+    }
+
+    if (numVBuckets == 0) {
+        // Return no more so we don't rewake the task
+        return false;
+    }
+
+    for (auto failed : store->completeGroupCommit(group)) {
+        if (std::find(requeue.begin(), requeue.end(), failed) ==
+            requeue.end()) {
+            requeue.push_back(failed);
+        }
+    }
+
+    for (auto pending : requeue) {
+        lpVbs.pushUnique(pending);
+    }
+
+    // Flushing may move the persistence cursor to a new checkpoint.
+    if (wakeupCkptRemover) {
+        store->wakeUpCheckpointRemover();
+    }
+
+    // Return more (as we may have low priority vBuckets to flush)
+    return true;
+}
+
+void Flusher::recordQueueWait(Vbid vbid) {
+    std::chrono::steady_clock::time_point queued;
+    {
+        auto locked = queuedSince.wlock();
+        auto itr = locked->find(vbid);
+        if (itr == locked->end()) {
+            return;
+        }
+        queued = itr->second;
+        locked->erase(itr);
+    }
+
+    auto vb = store->getVBucket(vbid);
+    if (vb) {
+        const auto wait = std::chrono::steady_clock::now() - queued;
+        static_cast<EPVBucket&>(*vb).recordFlushQueueWait(
+                std::chrono::duration_cast<std::chrono::microseconds>(wait));
+    }
+}
+
 size_t Flusher::getHPQueueSize() const {
     return hpVbs.size();
 }
@@ -20,10 +20,13 @@
 #include "utility.h"
 #include "vb_ready_queue.h"
 
+#include <folly/Synchronized.h>
 #include <memcached/vbucket.h>
 
+#include <chrono>
 #include <functional>
 #include <queue>
+#include <unordered_map>
 
 #define NO_VBUCKETS_INSTANTIATED 0xFFFF
 #define RETRY_FLUSH_VBUCKET (-1)
@@ -33,10 +36,13 @@ class KVShard;
 
 /**
  * Manage persistence of data for an EPBucket.
+ *
+ * Each Flusher persists a subset of one KVShard's vBuckets; a shard may have
+ * more than one Flusher if its KVStore supports concurrent flushing.
  */
 class Flusher {
 public:
-    Flusher(EPBucket* st, KVShard* k);
+    Flusher(EPBucket* st, KVShard* k, size_t lane = 0);
 
     ~Flusher();
 
@@ -51,6 +57,9 @@ public:
     const char * stateName() const;
 
     void notifyFlushEvent(Vbid vbid) {
+        // Only the first notification since the vBucket was last flushed
+        // starts its queue wait.
+        queuedSince.wlock()->emplace(vbid, std::chrono::steady_clock::now());
         if (!lpVbs.pushUnique(vbid)) {
             // Something is already in the queue, no need to wake the flusher
             return;
@@ -70,6 +79,11 @@ public:
 
     size_t getHighPriorityCount() const;
 
+    /// @returns the index of this Flusher within its shard.
+    size_t getLane() const {
+        return lane;
+    }
+
 private:
     enum class State {
         Initializing,
@@ -87,6 +101,18 @@ private:
      * @return true if there is more work to do
      */
     bool flushVB();
+
+    /**
+     * Flush up to groupSize low priority vBuckets as a single group commit
+     * @return true if there is more work to do
+     */
+    bool flushLowPriorityGroup(size_t groupSize);
+    /**
+     * Record how long the given vBucket waited between being notified and
+     * this Flusher starting to flush it.
+     */
+    void recordQueueWait(Vbid vbid);
+
     void completeFlush();
     void initialize();
     void schedule_UNLOCKED();
@@ -109,6 +135,12 @@ private:
     std::atomic<bool> pendingMutation;
 
     KVShard *shard;
+    const size_t lane;
+
+    /// Time each notified vBucket was first queued since it was last flushed.
+    folly::Synchronized<
+            std::unordered_map<Vbid, std::chrono::steady_clock::time_point>>
+            queuedSince;
 
     DISALLOW_COPY_AND_ASSIGN(Flusher);
 };
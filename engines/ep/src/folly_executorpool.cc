@@ -22,6 +22,7 @@
 #include "globaltask.h"
 #include "taskable.h"
 
+#include <folly/ScopeGuard.h>
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/executors/IOThreadPoolExecutor.h>
 #include <folly/executors/thread_factory/PriorityThreadFactory.h>
@@ -135,7 +136,7 @@ struct FollyExecutorPool::TaskProxy
 
         // Perform work on the appropriate CPU pool.
         // Note this retains a reference to itself (TaskProxy).
-        cpuPool.add([proxy = shared_from_this()] {
+        auto runTask = [proxy = shared_from_this()] {
             if (!proxy->task) {
                 // ExTask has been set to null - Taskable likely unregistered
                 // - nothing to do.
@@ -169,6 +170,9 @@ struct FollyExecutorPool::TaskProxy
                 }
                 proxy->task->getTaskable().logQTime(proxy->task->getTaskId(),
                                                     scheduleOverhead);
+                proxy->executor.recordTaskWait(
+                        GlobalTask::getTaskType(proxy->task->getTaskId()),
+                        scheduleOverhead);
 
                 proxy->task->setState(TASK_RUNNING, TASK_SNOOZED);
                 runAgain = proxy->task->execute();
@@ -196,7 +200,16 @@ struct FollyExecutorPool::TaskProxy
                         auto& executor = proxy->executor;
                         executor.rescheduleTaskAfterRun(std::move(proxy));
                     });
-        });
+        };
+
+        if (executor.workStealing) {
+            executor.enqueueWithStealing(
+                    GlobalTask::getTaskType(task->getTaskId()),
+                    task->getQueuePriority(),
+                    std::move(runTask));
+        } else {
+            cpuPool.add(std::move(runTask));
+        }
     }
 
     /**
@@ -477,8 +490,10 @@ FollyExecutorPool::FollyExecutorPool(size_t maxThreads,
                                      ThreadPoolConfig::ThreadCount maxReaders_,
                                      ThreadPoolConfig::ThreadCount maxWriters_,
                                      size_t maxAuxIO_,
-                                     size_t maxNonIO_)
+                                     size_t maxNonIO_,
+                                     bool workStealing)
     : ExecutorPool(maxThreads),
+      workStealing(workStealing),
       state(std::make_unique<State>()),
       maxReaders(calcNumReaders(maxReaders_)),
       maxWriters(calcNumWriters(maxWriters_)),
@@ -507,14 +522,26 @@ FollyExecutorPool::FollyExecutorPool(size_t maxThreads,
     futurePool = std::make_unique<folly::IOThreadPoolExecutor>(
             1, std::make_shared<folly::NamedThreadFactory>("SchedulerPool"));
 
+    // In work-stealing mode each CPU pool has a queue per priority band
+    // (see toFollyPriority), so ready high priority tasks are dequeued ahead
+    // of any backlog of lower priority ones.
+    const int8_t numPriorities = workStealing ? 3 : 1;
     readerPool = std::make_unique<folly::CPUThreadPoolExecutor>(
-            maxReaders, makeThreadFactory("ReaderPool", READER_TASK_IDX));
+            maxReaders,
+            numPriorities,
+            makeThreadFactory("ReaderPool", READER_TASK_IDX));
     writerPool = std::make_unique<folly::CPUThreadPoolExecutor>(
-            maxWriters, makeThreadFactory("WriterPool", WRITER_TASK_IDX));
+            maxWriters,
+            numPriorities,
+            makeThreadFactory("WriterPool", WRITER_TASK_IDX));
     auxPool = std::make_unique<folly::CPUThreadPoolExecutor>(
-            maxAuxIO, makeThreadFactory("AuxIoPool", AUXIO_TASK_IDX));
+            maxAuxIO,
+            numPriorities,
+            makeThreadFactory("AuxIoPool", AUXIO_TASK_IDX));
     nonIoPool = std::make_unique<folly::CPUThreadPoolExecutor>(
-            maxNonIO, makeThreadFactory("NonIoPool", NONIO_TASK_IDX));
+            maxNonIO,
+            numPriorities,
+            makeThreadFactory("NonIoPool", NONIO_TASK_IDX));
 }
 
 FollyExecutorPool::~FollyExecutorPool() {
@@ -588,6 +615,10 @@ size_t FollyExecutorPool::getNumReadyTasks() {
            nonIoPool->getPendingTaskCount();
 }
 
+size_t FollyExecutorPool::getNumReadyTasksOfType(task_type_t type) {
+    return getPoolForTaskType(type)->getPendingTaskCount();
+}
+
 void FollyExecutorPool::registerTaskable(Taskable& taskable) {
     NonBucketAllocationGuard guard;
 
@@ -880,6 +911,13 @@ void FollyExecutorPool::doTaskQStat(Taskable& taskable,
                     nonIoPool->getTaskQueueSize(),
                     add_stat,
                     cookie);
+
+    if (workStealing) {
+        add_casted_stat("ep_workload:stolen_tasks",
+                        stolenTasks.load(),
+                        add_stat,
+                        cookie);
+    }
 }
 
 folly::CPUThreadPoolExecutor* FollyExecutorPool::getPoolForTaskType(
@@ -901,6 +939,68 @@ folly::CPUThreadPoolExecutor* FollyExecutorPool::getPoolForTaskType(
     folly::assume_unreachable();
 }
 
+int8_t FollyExecutorPool::toFollyPriority(queue_priority_t priority) {
+    // GlobalTask priorities are "lower is more urgent"; fold them into the
+    // three bands folly supports.
+    if (priority <= 1) {
+        return folly::Executor::HI_PRI;
+    }
+    if (priority <= 5) {
+        return folly::Executor::MID_PRI;
+    }
+    return folly::Executor::LO_PRI;
+}
+
+void FollyExecutorPool::enqueueWithStealing(task_type_t homeType,
+                                            queue_priority_t priority,
+                                            folly::Function<void()> func) {
+    // Should only be called from within EventBase thread - this serialises
+    // the choice of pool with all other scheduling decisions.
+    Expects(futurePool->getEventBase()->inRunningEventBaseThread());
+
+    auto idleThreads = [this](task_type_t type) -> size_t {
+        const size_t threads = getPoolForTaskType(type)->numThreads();
+        const size_t outstanding = outstandingTasks[type];
+        return threads > outstanding ? threads - outstanding : 0;
+    };
+
+    // High priority tasks whose own pool has no idle thread are handed to
+    // the pool with the most idle threads, instead of waiting behind the
+    // home pool's backlog. Everything else stays on its home pool so the
+    // per-type thread counts still bound how much of each kind of work runs
+    // concurrently.
+    auto type = homeType;
+    const auto follyPriority = toFollyPriority(priority);
+    if (follyPriority == folly::Executor::HI_PRI &&
+        idleThreads(homeType) == 0) {
+        size_t mostIdle = 0;
+        for (auto candidate : {READER_TASK_IDX,
+                               WRITER_TASK_IDX,
+                               AUXIO_TASK_IDX,
+                               NONIO_TASK_IDX}) {
+            const auto idle = idleThreads(candidate);
+            if (idle > mostIdle) {
+                mostIdle = idle;
+                type = candidate;
+            }
+        }
+        if (type != homeType) {
+            stolenTasks++;
+        }
+    }
+
+    auto& outstanding = outstandingTasks[type];
+    outstanding++;
+    getPoolForTaskType(type)->addWithPriority(
+            [func = std::move(func), &outstanding]() mutable {
+                SCOPE_EXIT {
+                    outstanding--;
+                };
+                func();
+            },
+            follyPriority);
+}
+
 void FollyExecutorPool::rescheduleTaskAfterRun(
         std::shared_ptr<TaskProxy> proxy) {
     // Should only be called from within EventBase thread.
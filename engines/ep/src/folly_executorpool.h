@@ -17,8 +17,12 @@
 #pragma once
 
 #include "executorpool.h"
+#include "globaltask.h"
 #include "task_type.h"
 
+#include <folly/Function.h>
+#include <array>
+#include <atomic>
 #include <memory>
 
 namespace folly {
@@ -123,6 +127,23 @@ class IOThreadPoolExecutor;
  *    design - if the single IO thread / context switches are a bottleneck we
  *    can revisit down the line.
  *
+ * 5. Optionally (workStealing=true) the CPU pools are allowed to pick up
+ *    each others' urgent work:
+ *
+ *    a) Each CPU pool has three run queues (high / medium / low), selected
+ *       from the GlobalTask's priority, so a ready high priority task is
+ *       dequeued ahead of any backlog of lower priority tasks in the same
+ *       pool.
+ *    b) When a high priority task becomes ready and every thread of its own
+ *       pool is busy, it is enqueued on whichever pool currently has the most
+ *       idle threads. Medium and low priority tasks always run on their own
+ *       pool.
+ *
+ *    folly's CPUThreadPoolExecutor has a single shared queue per pool rather
+ *    than per-thread deques, so "stealing" here happens at dispatch time on
+ *    the IO thread (which already serialises all scheduling decisions), using
+ *    a count of tasks enqueued-or-running per pool.
+ *
  * [1] https://github.com/facebook/folly/blob/master/folly/io/async/README.md
  */
 class FollyExecutorPool : public ExecutorPool {
@@ -138,12 +159,16 @@ public:
      * @param maxWriters Number of Writer threads to create.
      * @param maxAuxIO Number of AuxIO threads to create (0 = auto-configure).
      * @param maxNonIO Number of NonIO threads to create (0 = auto-configure).
+     * @param workStealing If true, use per-priority run queues and allow
+     *                     high priority tasks to run on idle threads of other
+     *                     pools (see (5) above).
      */
     FollyExecutorPool(size_t maxThreads,
                       ThreadPoolConfig::ThreadCount maxReaders,
                       ThreadPoolConfig::ThreadCount maxWriters,
                       size_t maxAuxIO,
-                      size_t maxNonIO);
+                      size_t maxNonIO,
+                      bool workStealing = false);
 
     ~FollyExecutorPool() override;
 
@@ -178,6 +203,9 @@ public:
                      const void* cookie,
                      const AddStatFn& add_stat) override;
 
+protected:
+    size_t getNumReadyTasksOfType(task_type_t type) override;
+
 private:
     /// @returns the CPU pool to use for the given task type.
     folly::CPUThreadPoolExecutor* getPoolForTaskType(task_type_t type);
@@ -186,6 +214,28 @@ private:
     /// the task is dead (or should run again).
     void rescheduleTaskAfterRun(std::shared_ptr<TaskProxy> proxy);
 
+    /// @returns the folly run queue priority for the given GlobalTask priority.
+    static int8_t toFollyPriority(queue_priority_t priority);
+
+    /**
+     * Enqueue a ready task on a CPU pool in work-stealing mode - normally its
+     * home pool, but high priority work goes to the pool with the most idle
+     * threads if the home pool is saturated.
+     * Must be called on the futurePool eventBase thread.
+     */
+    void enqueueWithStealing(task_type_t homeType,
+                             queue_priority_t priority,
+                             folly::Function<void()> func);
+
+    /// Is work-stealing mode enabled?
+    const bool workStealing;
+
+    /// Tasks enqueued or running on each CPU pool (work-stealing mode only).
+    std::array<std::atomic<size_t>, NUM_TASK_GROUPS> outstandingTasks{};
+
+    /// Count of tasks which ran on a pool other than their home pool.
+    std::atomic<size_t> stolenTasks{0};
+
     struct State;
     /**
      * FollyExecutorPool internal state. unique_ptr for pimpl.
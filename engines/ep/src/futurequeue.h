@@ -21,36 +21,44 @@
  * The lowest wakeTime (soonest) will be the top() task.
  *
  * FutureQueue provides methods that allow a task's wakeTime to be mutated
- * whilst maintaining the priority ordering.
+ * whilst maintaining the ordering.
+ *
+ * Tasks are held in a map ordered by the wakeTime they had when they were
+ * last pushed or updated via the FutureQueue, alongside an index from task id
+ * to map position. top() is O(1) and push(), pop(), updateWaketime() and
+ * snooze() are O(log n) - a heap needs a linear search to find the task being
+ * woken or snoozed. A task is present at most once; pushing a task which is
+ * already queued moves it to its current wakeTime.
  */
 
 #pragma once
 
-#include <algorithm>
 #include <chrono>
+#include <map>
 #include <mutex>
-#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 
 #include "globaltask.h"
 
-template <class C = std::deque<ExTask>,
-          class Compare = CompareByDueDate>
 class FutureQueue {
 public:
-
     void push(ExTask task) {
         std::lock_guard<std::mutex> lock(queueMutex);
-        queue.push(task);
+        insert_UNLOCKED(std::move(task));
     }
 
     void pop() {
         std::lock_guard<std::mutex> lock(queueMutex);
-        queue.pop();
+        auto itr = queue.begin();
+        index.erase(itr->second->getId());
+        queue.erase(itr);
     }
 
     ExTask top() {
         std::lock_guard<std::mutex> lock(queueMutex);
-        return queue.top();
+        return queue.begin()->second;
     }
 
     size_t size() {
@@ -64,106 +72,94 @@ public:
     }
 
     /*
-     * Update the wakeTime of task and ensure the heap property is
-     * maintained.
+     * Update the wakeTime of task and ensure the ordering is maintained.
      * @returns true if 'task' is in the FutureQueue.
      */
     bool updateWaketime(const ExTask& task,
                         std::chrono::steady_clock::time_point newTime) {
         std::lock_guard<std::mutex> lock(queueMutex);
         task->updateWaketime(newTime);
-        // After modifiying the task's wakeTime, rebuild the heap
-        return queue.heapify(task);
+        return reposition_UNLOCKED(task);
     }
 
     /*
      * snooze the task (by altering its wakeTime) and ensure the
-     * heap property is maintained.
+     * ordering is maintained.
      * @returns true if 'task' is in the FutureQueue.
      */
     bool snooze(const ExTask& task, const double secs) {
         std::lock_guard<std::mutex> lock(queueMutex);
         task->snooze(secs);
-        // After modifiying the task's wakeTime, rebuild the heap
-        return queue.heapify(task);
+        return reposition_UNLOCKED(task);
     }
 
     /**
-     * Checks that the invariants of the future queue are valid.
+     * Checks that the invariants of the future queue are valid, i.e. that
+     * every task is ordered by its current wakeTime and is indexed.
      * If not then throws std::logic_error.
      */
     void assertInvariants() {
-        return queue.verifyHeapProperty();
+        std::lock_guard<std::mutex> lock(queueMutex);
+        bool valid = index.size() == queue.size();
+        for (auto itr = queue.begin(); valid && itr != queue.end(); ++itr) {
+            valid = itr->first == itr->second->getWaketime() &&
+                    index.count(itr->second->getId()) == 1;
+        }
+        if (!valid) {
+            std::string msg =
+                    "FutureQueue::assertInvariants() - ordering invariant "
+                    "broken.\nAll items:\n";
+            for (const auto& entry : queue) {
+                msg += "\t task:" + entry.second->getDescription() +
+                       " key:" +
+                       std::to_string(to_ns_since_epoch(entry.first).count()) +
+                       " wake:" +
+                       std::to_string(to_ns_since_epoch(
+                                              entry.second->getWaketime())
+                                              .count()) +
+                       "\n";
+            }
+            throw std::logic_error(msg);
+        }
     }
 
 protected:
+    using Queue = std::multimap<std::chrono::steady_clock::time_point, ExTask>;
 
-    /*
-     * HeapifiableQueue exposes a method to maintain the heap ordering
-     * of the underlying queue.
-     *
-     * This class is deliberately hidden inside FutureQueue so that any
-     * extensions made to priority_queue can't be accessed without work.
-     * I.e. correct locking and any need to 'heapify'.
-     */
-    class HeapifiableQueue : public std::priority_queue<ExTask, C, Compare> {
-    public:
-        /*
-         * Ensure the heap property is maintained
-         * @returns true if 'task' is in the queue and heapify() did something.
-         */
-        bool heapify(const ExTask& task) {
-            // if the task exists, rebuild
-            if (exists(task)) {
-                if (this->c.back()->getId() == task->getId()) {
-                    std::push_heap(this->c.begin(),
-                                   this->c.end(),
-                                   this->comp);
-                } else {
-                    std::make_heap(this->c.begin(),
-                                   this->c.end(),
-                                   this->comp);
-                }
-                return true;
-            } else {
-                return false;
-            }
+    void insert_UNLOCKED(ExTask task) {
+        auto existing = index.find(task->getId());
+        if (existing != index.end()) {
+            queue.erase(existing->second);
+            index.erase(existing);
         }
+        const auto id = task->getId();
+        const auto waketime = task->getWaketime();
+        // Equal wakeTimes keep their insertion order, as the heap did not
+        // guarantee any particular order for them either.
+        index.emplace(id, queue.emplace(waketime, std::move(task)));
+    }
 
-        void verifyHeapProperty() {
-            auto heap_end = std::is_heap_until(
-                    this->c.begin(), this->c.end(), this->comp);
-            if (heap_end != this->c.end()) {
-                std::string msg;
-                msg += "FutureQueue::verifyHeapProperty() - heap invariant "
-                       "broken. First non-heap is task:" +
-                       (*heap_end)->getDescription() + " wake:" +
-                       std::to_string(
-                               to_ns_since_epoch((*heap_end)->getWaketime())
-                                       .count()) +
-                       "\nAll items:\n";
-
-                for (auto& task : this->c) {
-                    msg += "\t task:" + task->getDescription() + " wake:" +
-                           std::to_string(to_ns_since_epoch(task->getWaketime())
-                                                  .count()) +
-                           "\n";
-                }
-                throw std::logic_error(msg);
-            }
+    /**
+     * Move 'task' (if queued) to the position of its current wakeTime.
+     * @returns true if 'task' is in the queue.
+     */
+    bool reposition_UNLOCKED(const ExTask& task) {
+        auto existing = index.find(task->getId());
+        if (existing == index.end()) {
+            return false;
         }
+        ExTask queued = existing->second->second;
+        queue.erase(existing->second);
+        existing->second = queue.emplace(queued->getWaketime(), queued);
+        return true;
+    }
 
-    protected:
-        bool exists(const ExTask& task) {
-            return std::find_if(this->c.begin(),
-                                this->c.end(),
-                                [&task](const ExTask& qTask) {
-                                    return task->getId() == qTask->getId();
-                                }) != this->c.end();
-        }
+    // Tasks ordered by wakeTime.
+    Queue queue;
 
-    } queue;
+    // Position in queue of each task, by task id.
+    std::unordered_map<size_t, Queue::iterator> index;
 
-    // All access to queue must be done with the queueMutex
+    // All access to queue and index must be done with the queueMutex
     std::mutex queueMutex;
 };
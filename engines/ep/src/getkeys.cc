@@ -29,7 +29,7 @@
 
 void AllKeysCallback::callback(const DiskDocKey& key) {
     setStatus(static_cast<int>(AllKeysCallbackStatus::KeySkipped));
-    if (addedKeyCount >= maxCount) {
+    if (!resumeKey.empty()) {
         return;
     }
 
@@ -53,10 +53,15 @@ void AllKeysCallback::callback(const DiskDocKey& key) {
         }
     }
 
-    if (buffer.size() + outKey.size() + sizeof(uint16_t) > buffer.size()) {
-        // Reserve the 2x space for the copy-to buffer.
-        buffer.reserve(buffer.size() * 2);
+    if (addedKeyCount >= maxCount ||
+        (addedKeyCount > 0 &&
+         buffer.size() + outKey.size() + sizeof(uint16_t) > maxBytes)) {
+        // The chunk is full, the next one starts at this key
+        resumeKey.assign(reinterpret_cast<const char*>(outKey.data()),
+                         outKey.size());
+        return;
     }
+
     uint16_t outlen = htons(outKey.size());
     // insert 1 x u16
     const auto* outlenPtr = reinterpret_cast<const char*>(&outlen);
@@ -75,6 +80,7 @@ FetchAllKeysTask::FetchAllKeysTask(EventuallyPersistentEngine* e,
                                    const DocKey start_key_,
                                    Vbid vbucket,
                                    uint32_t count_,
+                                   size_t maxBytes,
                                    std::optional<CollectionID> collection)
     : GlobalTask(e, TaskId::FetchAllKeysTask, 0, false),
       cookie(c),
@@ -83,6 +89,7 @@ FetchAllKeysTask::FetchAllKeysTask(EventuallyPersistentEngine* e,
       start_key(start_key_),
       vbid(vbucket),
       count(count_),
+      maxBytes(maxBytes),
       collection(std::move(collection)) {
 }
 
@@ -105,11 +112,16 @@ bool FetchAllKeysTask::run() {
                       ? ENGINE_SUCCESS
                       : ENGINE_FAILED;
     } else {
-        auto cb = std::make_shared<AllKeysCallback>(collection, count);
+        auto cb = std::make_shared<AllKeysCallback>(
+                collection, count, maxBytes);
+        // Ask for one more key than we return to find the key to resume at
+        const auto scanCount =
+                count == std::numeric_limits<uint32_t>::max() ? count
+                                                              : count + 1;
         err = engine->getKVBucket()->getROUnderlying(vbid)->getAllKeys(
-                vbid, start_key, count, cb);
+                vbid, start_key, scanCount, cb);
         if (err == ENGINE_SUCCESS) {
-            err = response({}, // key
+            err = response(cb->getResumeKey(),
                            {}, // extra
                            {cb->getAllKeysPtr(), cb->getAllKeysLen()},
                            PROTOCOL_BINARY_RAW_BYTES,
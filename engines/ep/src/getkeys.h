@@ -22,7 +22,9 @@
 #include "globaltask.h"
 
 #include <memcached/engine_common.h>
+#include <limits>
 #include <optional>
+#include <string>
 
 class EventuallyPersistentEngine;
 
@@ -39,13 +41,18 @@ enum class AllKeysCallbackStatus {
  * allKeys to 34000 (1000 * 32 + 1000 * 2), the additional 2 bytes per
  * key is for the keylength.
  *
- * This initially allocated buffersize is doubled whenever the length
- * of the buffer holding all the keys, crosses the buffersize.
+ * The keys are returned in chunks of at most maxCount keys and maxBytes
+ * bytes; when a chunk is full the first key which didn't fit is kept as the
+ * resume key (the key the next request should start at).
  */
 class AllKeysCallback : public StatusCallback<const DiskDocKey&> {
 public:
-    AllKeysCallback(std::optional<CollectionID> collection, uint32_t maxCount)
-        : collection(std::move(collection)), maxCount(maxCount) {
+    AllKeysCallback(std::optional<CollectionID> collection,
+                    uint32_t maxCount,
+                    size_t maxBytes = std::numeric_limits<size_t>::max())
+        : collection(std::move(collection)),
+          maxCount(maxCount),
+          maxBytes(maxBytes) {
         buffer.reserve((avgKeySize + sizeof(uint16_t)) * expNumKeys);
     }
 
@@ -58,11 +65,18 @@ public:
         return buffer.size();
     }
 
+    /// @return the key to resume at (empty if all of the keys were returned)
+    std::string_view getResumeKey() const {
+        return resumeKey;
+    }
+
 private:
     std::vector<char> buffer;
+    std::string resumeKey;
     std::optional<CollectionID> collection;
     uint32_t addedKeyCount = 0;
     uint32_t maxCount = 0;
+    size_t maxBytes = 0;
     static const int avgKeySize = 32;
     static const int expNumKeys = 1000;
 };
@@ -79,6 +93,7 @@ public:
                      const DocKey start_key_,
                      Vbid vbucket,
                      uint32_t count_,
+                     size_t maxBytes,
                      std::optional<CollectionID> collection);
 
     std::string getDescription() override {
@@ -100,5 +115,6 @@ private:
     DiskDocKey start_key;
     Vbid vbid;
     uint32_t count;
+    size_t maxBytes;
     std::optional<CollectionID> collection;
 };
\ No newline at end of file
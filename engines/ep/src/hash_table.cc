@@ -21,6 +21,7 @@
 #include "item.h"
 #include "stats.h"
 #include "stored_value_factories.h"
+#include "value_deduplicator.h"
 
 #include <folly/lang/Assume.h>
 #include <phosphor/phosphor.h>
@@ -29,6 +30,8 @@
 #include <logtags.h>
 #include <nlohmann/json.hpp>
 #include <cstring>
+#include <limits>
+#include <random>
 
 static const ssize_t prime_size_table[] = {
     3, 7, 13, 23, 47, 97, 193, 383, 769, 1531, 3079, 6143, 12289, 24571, 49157,
@@ -92,7 +95,7 @@ HashTable::StoredValueProxy::StoredValueProxy(HashBucketLock&& hbl,
                                               Statistics& stats)
     : lock(std::move(hbl)),
       value(sv),
-      valueStats(stats),
+      valueStats(stats, *this),
       pre(valueStats.get().prologue(sv)) {
 }
 
@@ -137,20 +140,42 @@ StoredValue* HashTable::FindUpdateResult::selectSVToModify(const Item& itm) {
 HashTable::HashTable(EPStats& st,
                      std::unique_ptr<AbstractStoredValueFactory> svFactory,
                      size_t initialSize,
-                     size_t locks)
-    : initialSize(initialSize),
-      size(initialSize),
+                     size_t locks,
+                     HashTableReadMode readMode,
+                     HashTableResizeMode resizeMode,
+                     bool hugePages)
+    : initialSize(resizeMode == HashTableResizeMode::Incremental
+                          ? ((initialSize + locks - 1) / locks) * locks
+                          : initialSize),
+      size(this->initialSize),
+      values(table_type::allocator_type(hugePages, &st.htHugePageBytes)),
+      oldValues(values.get_allocator()),
+      migrationCursor(locks),
+      resizeMode(resizeMode),
       mutexes(locks),
+      readStripes(readMode == HashTableReadMode::Optimistic
+                          ? std::make_unique<
+                                    folly::cacheline_aligned<ReadStripe>[]>(
+                                    locks)
+                          : nullptr),
       stats(st),
+      lockProfiler(st.lockProfiler),
       valFact(std::move(svFactory)),
       visitors(0),
-      valueStats(stats),
+      valueStats(stats, *this),
       numEjects(0),
       numResizes(0),
       maxDeletedRevSeqno(0),
       probabilisticCounter(freqCounterIncFactor) {
     values.resize(size);
     activeState = true;
+    if (readStripes) {
+        std::mt19937_64 random(std::random_device{}());
+        const auto seed = random();
+        for (size_t ii = 0; ii < locks; ++ii) {
+            readStripes[ii]->generation.store(seed);
+        }
+    }
 }
 
 HashTable::~HashTable() {
@@ -177,30 +202,61 @@ void HashTable::clear(bool deactivate) {
         }
     }
     MultiLockHolder mlh(mutexes);
+    AllReadersExcluded excluded(*this);
     clear_UNLOCKED(deactivate);
 }
 
+HashTable::AllReadersExcluded::AllReadersExcluded(const HashTable& ht)
+    : ht(ht) {
+    for (size_t ii = 0; ii < ht.mutexes.size(); ++ii) {
+        if (auto* stripe = ht.getReadStripe(ii)) {
+            stripe->excludeReaders();
+        }
+    }
+}
+
+HashTable::AllReadersExcluded::~AllReadersExcluded() {
+    for (size_t ii = 0; ii < ht.mutexes.size(); ++ii) {
+        if (auto* stripe = ht.getReadStripe(ii)) {
+            stripe->admitReaders();
+        }
+    }
+}
+
 void HashTable::clear_UNLOCKED(bool deactivate) {
     if (deactivate) {
         setActiveState(false);
     }
     size_t clearedMemSize = 0;
     size_t clearedValSize = 0;
-    for (int i = 0; i < (int)size; i++) {
-        while (values[i]) {
-            // Take ownership of the StoredValue from the vector, update
-            // statistics and release it.
-            auto v = std::move(values[i]);
-            clearedMemSize += v->size();
-            clearedValSize += v->valuelen();
-            values[i] = std::move(v->getNext());
+    auto clearTable = [&clearedMemSize, &clearedValSize](table_type& table) {
+        for (auto& chain : table) {
+            while (chain) {
+                // Take ownership of the StoredValue from the vector, update
+                // statistics and release it.
+                auto v = std::move(chain);
+                clearedMemSize += v->size();
+                clearedValSize += v->valuelen();
+                chain = std::move(v->getNext());
+            }
         }
+    };
+    clearTable(values);
+    if (isResizeInProgress()) {
+        // Nothing left to migrate - the resize is trivially complete.
+        clearTable(oldValues);
+        stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
+        oldValues = table_type(values.get_allocator());
+        oldSize = 0;
+        migratedBuckets = 0;
+        stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
     }
 
     stats.coreLocal.get()->currentSize.fetch_sub(clearedMemSize -
                                                  clearedValSize);
 
     valueStats.reset();
+    expiryIndex.clear();
 }
 
 static size_t distance(size_t a, size_t b) {
@@ -235,7 +291,9 @@ void HashTable::resize() {
         new_size = initialSize;
     } else if (0 == i) {
         new_size = prime_size_table[i];
-    }else if (isCurrently(size, prime_size_table[i-1], prime_size_table[i])) {
+    } else if (isCurrently(size,
+                           roundSize(prime_size_table[i - 1]),
+                           roundSize(prime_size_table[i]))) {
         // If one of the candidate sizes is the current size, maintain
         // the current size in order to remain stable.
         new_size = size;
@@ -259,11 +317,30 @@ void HashTable::resize(size_t newSize) {
         return;
     }
 
+    newSize = roundSize(newSize);
+
     // Don't resize to the same size, either.
     if (newSize == size) {
         return;
     }
 
+    if (resizeMode == HashTableResizeMode::Incremental) {
+        if (isResizeInProgress()) {
+            // Must complete the current resize before starting another.
+            return;
+        }
+        TRACE_EVENT2("HashTable",
+                     "beginIncrementalResize",
+                     "size",
+                     size.load(),
+                     "newSize",
+                     newSize);
+        // Allocate the new buckets before acquiring any locks - for large
+        // tables this is a significant cost.
+        beginIncrementalResize(table_type(newSize, values.get_allocator()));
+        return;
+    }
+
     TRACE_EVENT2(
             "HashTable", "resize", "size", size.load(), "newSize", newSize);
 
@@ -275,9 +352,12 @@ void HashTable::resize(size_t newSize) {
         // locks at this point).
         return;
     }
+    // Optimistic readers derive their bucket from {size}, so must also be
+    // excluded while the table is rehashed.
+    AllReadersExcluded excluded(*this);
 
     // Get a place for the new items.
-    table_type newValues(newSize);
+    table_type newValues(newSize, values.get_allocator());
 
     stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
     ++numResizes;
@@ -306,6 +386,103 @@ void HashTable::resize(size_t newSize) {
     stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
 }
 
+size_t HashTable::roundSize(size_t newSize) const {
+    if (resizeMode == HashTableResizeMode::Incremental) {
+        // Both old and new bucket arrays must be a multiple of the lock
+        // count, so bucket B in either maps to lock (B mod locks), which is
+        // (hash mod locks) in both.
+        const auto locks = mutexes.size();
+        return ((newSize + locks - 1) / locks) * locks;
+    }
+    return newSize;
+}
+
+void HashTable::beginIncrementalResize(table_type&& newValues) {
+    MultiLockHolder mlh(mutexes);
+    if (visitors.load() > 0 || isResizeInProgress()) {
+        // As per resize(); don't start while any visitors are processing.
+        return;
+    }
+    AllReadersExcluded excluded(*this);
+
+    stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
+    ++numResizes;
+
+    oldSize.store(size);
+    oldValues = std::move(values);
+    size.store(newValues.size());
+    values = std::move(newValues);
+    for (size_t lock = 0; lock < migrationCursor.size(); ++lock) {
+        migrationCursor[lock] = lock;
+    }
+    migratedBuckets = 0;
+
+    stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
+}
+
+bool HashTable::migrateBuckets_UNLOCKED(size_t lock, size_t maxBuckets) {
+    auto& cursor = migrationCursor[lock];
+    size_t migrated = 0;
+    while (migrated < maxBuckets && cursor < oldSize) {
+        auto& chain = oldValues[cursor];
+        while (chain) {
+            // unlink the front element from the old hash chain, and re-link
+            // it into the correct place in the new bucket array.
+            auto v = std::move(chain);
+            chain = std::move(v->getNext());
+            auto& newChain = values[getBucketForHash(v->getKey().hash())];
+            v->setNext(std::move(newChain));
+            newChain = std::move(v);
+        }
+        cursor += mutexes.size();
+        ++migrated;
+    }
+    migratedBuckets += migrated;
+    return cursor >= oldSize;
+}
+
+void HashTable::migrateAllBucketsForLock(size_t lock) {
+    while (isResizeInProgress()) {
+        HashBucketLock hbl(
+                lock, mutexes[lock], getReadStripe(lock), lockProfiler);
+        if (migrateBuckets_UNLOCKED(lock, resizeStepChunkSize)) {
+            return;
+        }
+    }
+}
+
+bool HashTable::resizeStep(size_t maxBucketsPerLock) {
+    if (!isResizeInProgress()) {
+        return true;
+    }
+    bool complete = true;
+    for (size_t lock = 0; lock < mutexes.size(); ++lock) {
+        HashBucketLock hbl(
+                lock, mutexes[lock], getReadStripe(lock), lockProfiler);
+        complete &= migrateBuckets_UNLOCKED(lock, maxBucketsPerLock);
+    }
+    if (complete) {
+        finishIncrementalResize();
+    }
+    return complete;
+}
+
+void HashTable::finishIncrementalResize() {
+    MultiLockHolder mlh(mutexes);
+    if (!isResizeInProgress()) {
+        return;
+    }
+    AllReadersExcluded excluded(*this);
+    for (size_t lock = 0; lock < migrationCursor.size(); ++lock) {
+        Expects(migrationCursor[lock] >= oldSize);
+    }
+    stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
+    oldValues = table_type(values.get_allocator());
+    oldSize = 0;
+    migratedBuckets = 0;
+    stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
+}
+
 HashTable::FindInnerResult HashTable::findInner(const DocKey& key) {
     if (!isActive()) {
         throw std::logic_error(
@@ -317,7 +494,7 @@ HashTable::FindInnerResult HashTable::findInner(const DocKey& key) {
     // and Pending items with the same key.
     StoredValue* foundCmt = nullptr;
     StoredValue* foundPend = nullptr;
-    for (StoredValue* v = values[hbl.getBucketNum()].get().get(); v;
+    for (StoredValue* v = getChain(hbl).get().get(); v;
          v = v->getNext().get().get()) {
         if (v->hasKey(key)) {
             if (v->isPending() || v->isCompleted()) {
@@ -349,6 +526,71 @@ std::unique_ptr<Item> HashTable::getRandomKey(CollectionID cid, long rnd) {
     return ret;
 }
 
+std::optional<StoredDocKey> HashTable::sampleLeastFrequentKey(
+        size_t sampleSize,
+        const std::function<long()>& random,
+        const std::function<bool(const StoredValue&)>& eligible) {
+    std::optional<StoredDocKey> candidate;
+    uint8_t candidateFreq = std::numeric_limits<uint8_t>::max();
+
+    auto searchChain = [&](const StoredValue::UniquePtr& chain) {
+        for (StoredValue* v = chain.get().get(); v;
+             v = v->getNext().get().get()) {
+            const auto freq = getDecayedFreqCounterValue(*v);
+            if ((!candidate || freq < candidateFreq) && eligible(*v)) {
+                candidate = StoredDocKey(v->getKey());
+                candidateFreq = freq;
+            }
+        }
+    };
+
+    for (size_t i = 0; i < sampleSize; ++i) {
+        const size_t slot = size_t(random()) % size;
+        auto lh = getLockedBucket(slot);
+        searchChain(values[slot]);
+        // During an incremental resize the old bucket with the same index (if
+        // any and not yet migrated) is owned by the same lock.
+        if (isResizeInProgress() && slot < oldSize &&
+            slot >= migrationCursor[slot % mutexes.size()]) {
+            searchChain(oldValues[slot]);
+        }
+    }
+    return candidate;
+}
+
+bool HashTable::visitFromRandomBucket(
+        long rnd, const std::function<bool(const StoredValue&)>& visitor) {
+    auto visitChain = [&visitor](const StoredValue::UniquePtr& chain) {
+        for (StoredValue* v = chain.get().get(); v;
+             v = v->getNext().get().get()) {
+            if (!visitor(*v)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    const size_t start = size_t(labs(rnd)) % size;
+    size_t slot = start;
+    do {
+        auto lh = getLockedBucket(slot);
+        if (!visitChain(values[slot])) {
+            return false;
+        }
+        // During an incremental resize the old bucket with the same index (if
+        // any and not yet migrated) is owned by the same lock.
+        if (isResizeInProgress() && slot < oldSize &&
+            slot >= migrationCursor[slot % mutexes.size()] &&
+            !visitChain(oldValues[slot])) {
+            return false;
+        }
+        if (++slot >= size) {
+            slot = 0;
+        }
+    } while (slot != start);
+    return true;
+}
+
 MutationStatus HashTable::set(const Item& val) {
     auto htRes = findForWrite(val.getKey());
     if (htRes.storedValue) {
@@ -390,8 +632,11 @@ HashTable::UpdateResult HashTable::unlocked_updateStoredValue(
     const auto preProps = valueStats.prologue(&v);
 
     /* setValue() will mark v as undeleted if required */
+    applyFreqDecay(v);
     v.setValue(itm);
+    dedupValue(v);
     updateFreqCounter(v);
+    trackExpiry(v);
 
     valueStats.epilogue(preProps, &v);
 
@@ -445,12 +690,27 @@ StoredValue* HashTable::unlocked_addNewStoredValue(const HashBucketLock& hbl,
     const auto emptyProperties = valueStats.prologue(nullptr);
 
     // Create a new StoredValue and link it into the head of the bucket chain.
-    auto v = (*valFact)(itm, std::move(values[hbl.getBucketNum()]));
+    auto& chain = getChain(hbl);
+    auto v = (*valFact)(itm, std::move(chain));
+    // The counter of the item is up to date
+    v->setFreqDecayEpoch(getFreqDecayEpoch());
+    dedupValue(*v);
+    trackExpiry(*v);
 
     valueStats.epilogue(emptyProperties, v.get().get());
 
-    values[hbl.getBucketNum()] = std::move(v);
-    return values[hbl.getBucketNum()].get().get();
+    chain = std::move(v);
+    return chain.get().get();
+}
+
+void HashTable::dedupValue(StoredValue& v) {
+    if (!valueDeduplicator || !v.isResident() || v.hasInlineValue()) {
+        return;
+    }
+    auto value = valueDeduplicator->dedup(v.getValue());
+    if (value.get().get() != v.getValue().get().get()) {
+        v.replaceValue(value);
+    }
 }
 
 HashTable::Statistics::StoredValueProperties::StoredValueProperties(
@@ -464,6 +724,7 @@ HashTable::Statistics::StoredValueProperties::StoredValueProperties(
     isValid = true;
     size = sv->size();
     metaDataSize = sv->metaDataSize();
+    keySize = sv->getKey().getObjectSize();
     datatype = sv->getDatatype();
     uncompressedSize = sv->uncompressedSize();
     isResident = sv->isResident();
@@ -476,7 +737,18 @@ HashTable::Statistics::StoredValueProperties::StoredValueProperties(
 
 HashTable::Statistics::StoredValueProperties HashTable::Statistics::prologue(
         const StoredValue* v) const {
-    return StoredValueProperties(v);
+    return getProperties(v);
+}
+
+HashTable::Statistics::StoredValueProperties
+HashTable::Statistics::getProperties(const StoredValue* sv) const {
+    StoredValueProperties props(sv);
+    if (props.isValid) {
+        props.isFreqTracked = props.isResident && !props.isDeleted &&
+                              !props.isTempItem && !props.isPreparedSyncWrite;
+        props.freqCounter = ht.getDecayedFreqCounterValue(*sv);
+    }
+    return props;
 }
 
 struct HashTable::Statistics::CacheLocalStatistics {
@@ -521,6 +793,9 @@ struct HashTable::Statistics::CacheLocalStatistics {
     //! Meta-data size (fixed-length fields in StoredValue + keylen).
     std::atomic<ssize_t> metaDataMemory = {};
 
+    //! Key size (the SerialisedDocKeys of the StoredValues).
+    std::atomic<ssize_t> keyMemory = {};
+
     //! Memory consumed by items in this hashtable.
     std::atomic<ssize_t> memSize = {};
 
@@ -528,7 +803,8 @@ struct HashTable::Statistics::CacheLocalStatistics {
     std::atomic<ssize_t> uncompressedMemSize = {};
 };
 
-HashTable::Statistics::Statistics(EPStats& epStats) : epStats(epStats) {
+HashTable::Statistics::Statistics(EPStats& epStats, const HashTable& ht)
+    : epStats(epStats), ht(ht) {
 }
 
 size_t HashTable::Statistics::getNumItems() const {
@@ -589,6 +865,39 @@ HashTable::DatatypeCombo HashTable::Statistics::getDatatypeCounts() const {
     return result;
 }
 
+HashTable::FreqCounts HashTable::Statistics::getFreqCounts() const {
+    FreqCounts result{};
+    for (size_t freq = 0; freq < freqCounts.size(); ++freq) {
+        result[freq] = std::max(int32_t(0), freqCounts[freq].load());
+    }
+    return result;
+}
+
+void HashTable::Statistics::freqCounterChanged(const StoredValue& v,
+                                               uint8_t oldFreq,
+                                               uint8_t newFreq) {
+    if (oldFreq == newFreq || !getProperties(&v).isFreqTracked) {
+        return;
+    }
+    freqCounts[oldFreq].fetch_sub(1, std::memory_order_relaxed);
+    freqCounts[newFreq].fetch_add(1, std::memory_order_relaxed);
+}
+
+void HashTable::Statistics::decayFreqCounts(uint16_t percentage) {
+    const double factor = percentage * 0.01;
+    // Counters only decay downwards, so walking upwards never moves a count
+    // twice.
+    for (size_t freq = 1; freq < freqCounts.size(); ++freq) {
+        // Same rounding as HashTable::getDecayedFreqCounterValue()
+        const uint8_t decayed = uint8_t(freq) * factor;
+        if (decayed == freq) {
+            continue;
+        }
+        const auto count = freqCounts[freq].exchange(0);
+        freqCounts[decayed].fetch_add(count);
+    }
+}
+
 size_t HashTable::Statistics::getCacheSize() const {
     size_t result = 0;
     for (const auto& stripe : llcLocal) {
@@ -605,6 +914,14 @@ size_t HashTable::Statistics::getMetaDataMemory() const {
     return result;
 }
 
+size_t HashTable::Statistics::getKeyMemory() const {
+    size_t result = 0;
+    for (const auto& stripe : llcLocal) {
+        result += stripe.keyMemory;
+    }
+    return result;
+}
+
 size_t HashTable::Statistics::getMemSize() const {
     size_t result = 0;
     for (const auto& stripe : llcLocal) {
@@ -626,10 +943,21 @@ void HashTable::Statistics::epilogue(StoredValueProperties pre,
     // After performing updates to sv; compare with the previous properties and
     // update all statistics for all properties which have changed.
 
-    const auto post = StoredValueProperties(v);
+    const auto post = getProperties(v);
 
     auto& local = llcLocal.get();
 
+    if (pre.isFreqTracked != post.isFreqTracked ||
+        pre.freqCounter != post.freqCounter) {
+        if (pre.isFreqTracked) {
+            freqCounts[pre.freqCounter].fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (post.isFreqTracked) {
+            freqCounts[post.freqCounter].fetch_add(1,
+                                                   std::memory_order_relaxed);
+        }
+    }
+
     // Update size, metadataSize & uncompressed size if pre/post differ.
     if (pre.size != post.size) {
         auto sizeDelta = post.size - pre.size;
@@ -654,6 +982,9 @@ void HashTable::Statistics::epilogue(StoredValueProperties pre,
         epStats.coreLocal.get()->currentSize.fetch_add(post.metaDataSize -
                                                        pre.metaDataSize);
     }
+    if (pre.keySize != post.keySize) {
+        local.keyMemory.fetch_add(post.keySize - pre.keySize);
+    }
     if (pre.uncompressedSize != post.uncompressedSize) {
         local.uncompressedMemSize.fetch_add(post.uncompressedSize -
                                             pre.uncompressedSize);
@@ -726,6 +1057,9 @@ void HashTable::Statistics::reset() {
         core.cacheSize.store(0);
         core.uncompressedMemSize.store(0);
     }
+    for (auto& count : freqCounts) {
+        count.store(0);
+    }
 }
 
 std::pair<StoredValue*, StoredValue::UniquePtr>
@@ -747,15 +1081,15 @@ HashTable::unlocked_replaceByCopy(const HashBucketLock& hbl,
     auto releasedSv = unlocked_release(hbl, &vToCopy);
 
     /* Copy the StoredValue and link it into the head of the bucket chain. */
-    auto newSv = valFact->copyStoredValue(
-            vToCopy, std::move(values[hbl.getBucketNum()]));
+    auto& chain = getChain(hbl);
+    auto newSv = valFact->copyStoredValue(vToCopy, std::move(chain));
 
     // Adding a new item into the HashTable; update stats.
     const auto emptyProperties = valueStats.prologue(nullptr);
     valueStats.epilogue(emptyProperties, newSv.get().get());
 
-    values[hbl.getBucketNum()] = std::move(newSv);
-    return {values[hbl.getBucketNum()].get().get(), std::move(releasedSv)};
+    chain = std::move(newSv);
+    return {chain.get().get(), std::move(releasedSv)};
 }
 
 HashTable::DeleteResult HashTable::unlocked_softDelete(
@@ -848,12 +1182,99 @@ HashTable::FindROResult HashTable::findForRead(
 
     // Found a non-deleted item. Now check if we should update ref-count.
     if (trackReference == TrackReference::Yes) {
+        const auto oldFreq = applyFreqDecay(*sv);
         updateFreqCounter(*sv);
+        valueStats.freqCounterChanged(
+                *sv, oldFreq, sv->getFreqCounterValue());
     }
 
     return {sv, std::move(result.lock)};
 }
 
+std::optional<HashTable::FindROOptimisticResult>
+HashTable::findForReadOptimistic(
+        const DocKey& key,
+        TrackReference trackReference,
+        WantsDeleted wantsDeleted,
+        const ForGetReplicaOp fetchRequestedForReplicaItem) {
+    if (!readStripes) {
+        return {};
+    }
+    if (!isActive()) {
+        throw std::logic_error(
+                "HashTable::findForReadOptimistic: Cannot call on a "
+                "non-active object");
+    }
+
+    const int hash = key.hash();
+    const int bucket = getBucketForHash(hash);
+    auto& stripe = *readStripes[mutexForBucket(bucket)];
+    if (!stripe.tryEnterRead()) {
+        return {};
+    }
+    OptimisticReadGuard guard(stripe);
+    if (bucket != getBucketForHash(hash)) {
+        // Raced with a resize before we were admitted.
+        return {};
+    }
+
+    // Same search as findInner(), and same selection as findForRead().
+    const StoredValue* foundCmt = nullptr;
+    const StoredValue* foundPend = nullptr;
+    for (const StoredValue* v = getChainForHash(hash).get().get(); v;
+         v = v->getNext().get().get()) {
+        if (v->hasKey(key)) {
+            if (v->isPending() || v->isCompleted()) {
+                foundPend = v;
+            } else {
+                foundCmt = v;
+            }
+        }
+    }
+
+    if (fetchRequestedForReplicaItem == ForGetReplicaOp::No && foundPend &&
+        foundPend->isPreparedMaybeVisible()) {
+        return FindROOptimisticResult{foundPend, std::move(guard)};
+    }
+    if (!foundCmt) {
+        return FindROOptimisticResult{nullptr, std::move(guard)};
+    }
+    if (foundCmt->isDeleted()) {
+        return FindROOptimisticResult{
+                (wantsDeleted == WantsDeleted::Yes) ? foundCmt : nullptr,
+                std::move(guard)};
+    }
+
+    // Updating the frequency counter requires modifying the StoredValue,
+    // which optimistic readers are not permitted to do. The counter is
+    // probabilistic and increments become rarer as it grows, so for hot
+    // items this path is taken infrequently (as is applying a pending
+    // decay, at most once per decay).
+    if (trackReference == TrackReference::Yes &&
+        (foundCmt->getFreqDecayEpoch() != getFreqDecayEpoch() ||
+         generateFreqValue(foundCmt->getFreqCounterValue()) !=
+                 foundCmt->getFreqCounterValue())) {
+        return {};
+    }
+
+    return FindROOptimisticResult{foundCmt, std::move(guard)};
+}
+
+std::optional<uint64_t> HashTable::getGeneration(const DocKey& key) {
+    if (!readStripes || !isActive()) {
+        return {};
+    }
+    const auto& stripe =
+            *readStripes[mutexForBucket(getBucketForHash(key.hash()))];
+    // Read the generation before checking for writers; a writer admitted
+    // after the check is ordered after our read.
+    const auto generation = stripe.generation.load();
+    if (stripe.writers.load() != 0) {
+        return {};
+    }
+    return generation;
+}
+
 HashTable::FindResult HashTable::findForWrite(const DocKey& key,
                                               WantsDeleted wantsDeleted) {
     auto result = findInner(key);
@@ -991,7 +1412,7 @@ StoredValue::UniquePtr HashTable::unlocked_release(
     // Remove the first (should only be one) StoredValue matching the given
     // pointer
     auto released = hashChainRemoveFirst(
-            values[hbl.getBucketNum()], [valueToRelease](const StoredValue* v) {
+            getChain(hbl), [valueToRelease](const StoredValue* v) {
                 return v == valueToRelease;
             });
 
@@ -1048,6 +1469,7 @@ MutationStatus HashTable::insertFromWarmup(const Item& itm,
                 v->setFlags(itm.getFlags());
                 v->setExptime(itm.getExptime());
                 v->setRevSeqno(itm.getRevSeqno());
+                trackExpiry(*v);
             } else {
                 return MutationStatus::InvalidCas;
             }
@@ -1071,8 +1493,7 @@ MutationStatus HashTable::insertFromWarmup(const Item& itm,
 
 bool HashTable::reallocateStoredValue(StoredValue&& sv) {
     // Search the chain and reallocate
-    for (StoredValue::UniquePtr* curr =
-                 &values[getBucketForHash(sv.getKey().hash())];
+    for (StoredValue::UniquePtr* curr = &getChainForHash(sv.getKey().hash());
          curr->get().get();
          curr = &curr->get()->getNext()) {
         if (&sv == curr->get().get()) {
@@ -1091,8 +1512,8 @@ void HashTable::dump() const {
 nlohmann::json HashTable::dumpStoredValuesAsJson() const {
     MultiLockHolder mlh(mutexes);
     auto obj = nlohmann::json::array();
-    for (const auto& chain : values) {
-        if (chain) {
+    for (const auto* table : {&values, &oldValues}) {
+        for (const auto& chain : *table) {
             for (StoredValue* sv = chain.get().get(); sv != nullptr;
                  sv = sv->getNext().get().get()) {
                 std::stringstream ss;
@@ -1133,6 +1554,10 @@ void HashTable::visitDepth(HashTableDepthVisitor &visitor) {
     lh.unlock();
 
     for (int l = 0; l < static_cast<int>(mutexes.size()); l++) {
+        // An incremental resize cannot start while we are visiting, but one
+        // may be in progress - ensure all StoredValues owned by this lock are
+        // in the current bucket array before visiting it.
+        migrateAllBucketsForLock(l);
         for (int i = l; i < static_cast<int>(size); i+= mutexes.size()) {
             // (re)acquire mutex on each HashBucket, to minimise any impact
             // on front-end threads.
@@ -1194,6 +1619,9 @@ HashTable::Position HashTable::pauseResumeVisit(HashTableVisitor& visitor,
     size_t hash_bucket = 0;
 
     for (; isActive() && !paused && lock < mutexes.size(); lock++) {
+        // As per visitDepth(), complete migration of any in-progress
+        // incremental resize for this lock before visiting it.
+        migrateAllBucketsForLock(lock);
 
         // If the bucket position is *this* lock, then start from the
         // recorded bucket (as long as we haven't resized).
@@ -1214,7 +1642,8 @@ HashTable::Position HashTable::pauseResumeVisit(HashTableVisitor& visitor,
             // around the HashBucket visit then we need to release it before
             // tearDownHashBucketVisit() is called.
             {
-                HashBucketLock lh(hash_bucket, mutexes[lock]);
+                HashBucketLock lh(
+                        hash_bucket, mutexes[lock], getReadStripe(lock));
 
                 StoredValue* v = values[hash_bucket].get().get();
                 while (!paused && v) {
@@ -1266,14 +1695,32 @@ bool HashTable::unlocked_ejectItem(const HashTable::HashBucketLock&,
     case EvictionPolicy::Value: {
         vptr->ejectValue();
         ++stats.numValueEjects;
+
+        // Drop the memory which was only needed for the value (if
+        // configured), replacing the StoredValue in its chain by the copy
+        auto compacted =
+                valFact->copyNonResidentStoredValue(*vptr, vptr->getNext());
+        if (compacted) {
+            auto* curr = &getChainForHash(vptr->getKey().hash());
+            while (curr->get().get() != vptr) {
+                if (curr->get().get() == nullptr) {
+                    throw std::logic_error(
+                            "HashTable::unlocked_ejectItem: StoredValue not "
+                            "found in its chain");
+                }
+                curr = &curr->get()->getNext();
+            }
+            // compacted now owns (and frees) the original StoredValue
+            curr->swap(compacted);
+            vptr = curr->get().get();
+        }
         valueStats.epilogue(preProps, vptr);
         break;
     }
     case EvictionPolicy::Full: {
         // Remove the item from the hash table.
-        int bucket_num = getBucketForHash(vptr->getKey().hash());
         auto removed = hashChainRemoveFirst(
-                values[bucket_num],
+                getChainForHash(vptr->getKey().hash()),
                 [vptr](const StoredValue* v) { return v == vptr; });
 
         if (removed->isResident()) {
@@ -1293,15 +1740,26 @@ bool HashTable::unlocked_ejectItem(const HashTable::HashBucketLock&,
 std::unique_ptr<Item> HashTable::getRandomKeyFromSlot(CollectionID cid,
                                                       int slot) {
     auto lh = getLockedBucket(slot);
-    for (StoredValue* v = values[slot].get().get(); v;
-            v = v->getNext().get().get()) {
-        if (!v->isTempItem() && !v->isDeleted() && v->isResident() &&
-            v->isCommitted() && v->getKey().getCollectionID() == cid) {
-            return v->toItem(Vbid(0));
+    auto searchChain = [cid](const StoredValue::UniquePtr& chain)
+            -> std::unique_ptr<Item> {
+        for (StoredValue* v = chain.get().get(); v;
+             v = v->getNext().get().get()) {
+            if (!v->isTempItem() && !v->isDeleted() && v->isResident() &&
+                v->isCommitted() && v->getKey().getCollectionID() == cid) {
+                return v->toItem(Vbid(0));
+            }
         }
-    }
+        return nullptr;
+    };
 
-    return nullptr;
+    auto ret = searchChain(values[slot]);
+    // During an incremental resize the old bucket with the same index (if any
+    // and not yet migrated) is owned by the same lock.
+    if (!ret && isResizeInProgress() && size_t(slot) < oldSize &&
+        size_t(slot) >= migrationCursor[slot % mutexes.size()]) {
+        ret = searchChain(oldValues[slot]);
+    }
+    return ret;
 }
 
 bool HashTable::unlocked_restoreValue(
@@ -1314,7 +1772,15 @@ bool HashTable::unlocked_restoreValue(
 
     const auto preProps = valueStats.prologue(&v);
 
+    // Restoring a temporary item sets its expiry time
+    const bool wasTemp = v.isTempItem();
     v.restoreValue(itm);
+    dedupValue(v);
+    // Uses the frequency counter of the item
+    v.setFreqDecayEpoch(getFreqDecayEpoch());
+    if (wasTemp) {
+        trackExpiry(v);
+    }
 
     valueStats.epilogue(preProps, &v);
 
@@ -1339,6 +1805,9 @@ void HashTable::unlocked_restoreMeta(const std::unique_lock<std::mutex>& htLock,
     const auto preProps = valueStats.prologue(&v);
 
     v.restoreMeta(itm);
+    // Uses the frequency counter of the item
+    v.setFreqDecayEpoch(getFreqDecayEpoch());
+    trackExpiry(v);
 
     valueStats.epilogue(preProps, &v);
 }
@@ -1347,12 +1816,63 @@ uint8_t HashTable::generateFreqValue(uint8_t counter) {
     return probabilisticCounter.generateValue(counter);
 }
 
+void HashTable::decayFreqCounters(uint16_t percentage) {
+    freqDecayPercentage = percentage;
+    ++freqDecayEpoch;
+    valueStats.decayFreqCounts(percentage);
+}
+
+void HashTable::unlocked_setFreqCounterValue(const HashBucketLock& hbl,
+                                             StoredValue& v,
+                                             uint8_t freq) {
+    if (!hbl.getHTLock()) {
+        throw std::invalid_argument(
+                "HashTable::unlocked_setFreqCounterValue: htLock not held");
+    }
+    const auto oldFreq = applyFreqDecay(v);
+    v.setFreqCounterValue(freq);
+    valueStats.freqCounterChanged(v, oldFreq, freq);
+}
+
+uint8_t HashTable::unlocked_applyFreqDecay(const HashBucketLock& hbl,
+                                           StoredValue& v) {
+    if (!hbl.getHTLock()) {
+        throw std::invalid_argument(
+                "HashTable::unlocked_applyFreqDecay: htLock not held");
+    }
+    return applyFreqDecay(v);
+}
+
+uint8_t HashTable::getDecayedFreqCounterValue(const StoredValue& v) const {
+    const uint8_t pending =
+            (freqDecayEpoch - v.getFreqDecayEpoch()) &
+            StoredValue::freqDecayEpochMask;
+    uint8_t freq = v.getFreqCounterValue();
+    const double factor = freqDecayPercentage * 0.01;
+    for (uint8_t ii = 0; ii < pending && freq > 0; ++ii) {
+        // Same as decaying the counter once per epoch
+        freq = freq * factor;
+    }
+    return freq;
+}
+
+uint8_t HashTable::applyFreqDecay(StoredValue& v) {
+    const auto epoch = getFreqDecayEpoch();
+    if (v.getFreqDecayEpoch() == epoch) {
+        return v.getFreqCounterValue();
+    }
+    const auto freq = getDecayedFreqCounterValue(v);
+    v.setFreqCounterValue(freq);
+    v.setFreqDecayEpoch(epoch);
+    return freq;
+}
+
 void HashTable::updateFreqCounter(StoredValue& v) {
     // Attempt to increment the storedValue frequency counter
     // value.  Because a probabilistic counter is used the new
     // value will either be the same or an increment of the
     // current value.
-    auto updatedFreqCounterValue = generateFreqValue(v.getFreqCounterValue());
+    auto updatedFreqCounterValue = generateFreqValue(applyFreqDecay(v));
     v.setFreqCounterValue(updatedFreqCounterValue);
 
     if (updatedFreqCounterValue == std::numeric_limits<uint8_t>::max()) {
@@ -1362,6 +1882,48 @@ void HashTable::updateFreqCounter(StoredValue& v) {
     }
 }
 
+std::string to_string(HashTableReadMode mode) {
+    switch (mode) {
+    case HashTableReadMode::Locked:
+        return "locked";
+    case HashTableReadMode::Optimistic:
+        return "optimistic";
+    }
+    folly::assume_unreachable();
+}
+
+std::string to_string(HashTableResizeMode mode) {
+    switch (mode) {
+    case HashTableResizeMode::Blocking:
+        return "blocking";
+    case HashTableResizeMode::Incremental:
+        return "incremental";
+    }
+    folly::assume_unreachable();
+}
+
+HashTableResizeMode htResizeModeFromString(std::string_view mode) {
+    if (mode == "blocking") {
+        return HashTableResizeMode::Blocking;
+    }
+    if (mode == "incremental") {
+        return HashTableResizeMode::Incremental;
+    }
+    throw std::invalid_argument("htResizeModeFromString: unknown mode '" +
+                                std::string(mode) + "'");
+}
+
+HashTableReadMode htReadModeFromString(std::string_view mode) {
+    if (mode == "locked") {
+        return HashTableReadMode::Locked;
+    }
+    if (mode == "optimistic") {
+        return HashTableReadMode::Optimistic;
+    }
+    throw std::invalid_argument("htReadModeFromString: unknown mode '" +
+                                std::string(mode) + "'");
+}
+
 std::ostream& operator<<(std::ostream& os, const HashTable& ht) {
     os << "HashTable[" << &ht << "] with"
        << " numItems:" << ht.getNumItems()
@@ -1372,8 +1934,8 @@ std::ostream& operator<<(std::ostream& os, const HashTable& ht) {
        << " numSystemItems:" << ht.getNumSystemItems()
        << " numPreparedSW:" << ht.getNumPreparedSyncWrites()
        << " values: " << std::endl;
-    for (const auto& chain : ht.values) {
-        if (chain) {
+    for (const auto* table : {&ht.values, &ht.oldValues}) {
+        for (const auto& chain : *table) {
             for (StoredValue* sv = chain.get().get(); sv != nullptr;
                  sv = sv->getNext().get().get()) {
                 os << "    " << *sv << std::endl;
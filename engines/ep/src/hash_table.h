@@ -17,17 +17,25 @@
 
 #pragma once
 
+#include "expiry_index.h"
+#include "huge_page_allocator.h"
+#include "lock_profiler.h"
 #include "probabilistic_counter.h"
 #include "stored-value.h"
 #include "storeddockey.h"
 
+#include <folly/lang/Aligned.h>
 #include <platform/corestore.h>
 #include <platform/non_negative_counter.h>
 
 #include <array>
 #include <functional>
+#include <limits>
+#include <optional>
+#include <thread>
 
 class AbstractStoredValueFactory;
+class ValueDeduplicator;
 class HashTableVisitor;
 class HashTableDepthVisitor;
 
@@ -73,6 +81,37 @@ enum class DeletionStatus : uint8_t {
 };
 
 enum class DeletionDurability : uint8_t {};
+/**
+ * How lookups of the HashTable synchronise with writers.
+ */
+enum class HashTableReadMode : uint8_t {
+    /// All lookups acquire the HashBucket's mutex.
+    Locked,
+    /// Pure lookups via findForReadOptimistic() do not acquire the
+    /// HashBucket's mutex; they only back off to the locked path if a writer
+    /// holds the mutex for the same lock stripe. Writers are serialised by
+    /// the mutex as in Locked mode.
+    Optimistic,
+};
+std::string to_string(HashTableReadMode mode);
+HashTableReadMode htReadModeFromString(std::string_view mode);
+
+/**
+ * How the HashTable rehashes its contents when resized.
+ */
+enum class HashTableResizeMode : uint8_t {
+    /// All buckets are rehashed in a single step while holding all locks.
+    Blocking,
+    /// The old and new bucket arrays are both kept live, and buckets are
+    /// migrated from old to new a chunk at a time (by resizeStep() and
+    /// opportunistically on access), holding only one lock at a time.
+    /// Table sizes are rounded up to a multiple of the number of locks so a
+    /// key maps to the same lock in both arrays.
+    Incremental,
+};
+std::string to_string(HashTableResizeMode mode);
+HashTableResizeMode htResizeModeFromString(std::string_view mode);
+
 /**
  * A container of StoredValue instances.
  *
@@ -145,6 +184,19 @@ enum class DeletionDurability : uint8_t {};
  * re-hashing all elements into the new table. While resizing is occuring all
  * other access to the HashTable is blocked.
  *
+ * Alternatively (HashTableResizeMode::Incremental) the resize keeps both the
+ * old and new vectors of buckets, migrating the old buckets owned by each
+ * lock in order. An old bucket `o` (owned by lock L) has been migrated iff
+ * `o < migrationCursor[L]`; lookups use the old or new vector accordingly, so
+ * at any time each StoredValue is reachable from exactly one bucket.
+ *
+ * Optionally (HashTableReadMode::Optimistic) pure lookups can be performed
+ * via findForReadOptimistic() without acquiring the ht_locks. Each lock has
+ * an associated ReadStripe - writers (anyone acquiring a HashBucketLock, plus
+ * resize / clear) wait for in-flight optimistic readers of that stripe to
+ * finish, and optimistic readers which encounter a writer fall back to the
+ * locked path.
+ *
  * Support for holding both Committed and Pending items requires that we
  * can represent having for each key, either:
  *  1. No item present
@@ -164,6 +216,13 @@ public:
      * Datatype counts; one element for each combination of datatypes
      * (e.g. JSON, JSON+XATTR, JSON+Snappy, etc...)
      */
+    /**
+     * Number of items at each (decayed) frequency counter value. Counts
+     * resident, alive, committed items - those the ItemPager may evict.
+     */
+    using FreqCounts = std::array<uint64_t,
+                                  std::numeric_limits<uint8_t>::max() + 1>;
+
     using DatatypeCombo = std::array<ssize_t,
                                      mcbp::datatype::highest + 1>;
     // Logically could be an array of NonNegativeCounters, but this type
@@ -228,7 +287,7 @@ public:
      */
     class Statistics {
     public:
-        explicit Statistics(EPStats& epStats);
+        Statistics(EPStats& epStats, const HashTable& ht);
 
         /**
          * Set of properties on a StoredValue which are considerd by statistics
@@ -244,6 +303,7 @@ public:
             // equivlent to a non-existent SV.
             int size = 0;
             int metaDataSize = 0;
+            int keySize = 0;
             int uncompressedSize = 0;
             CollectionID cid;
             protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
@@ -253,6 +313,10 @@ public:
             bool isTempItem = false;
             bool isSystemItem = false;
             bool isPreparedSyncWrite = false;
+            // Counted in the frequency histogram (see FreqCounts), at the
+            // (decayed) freqCounter.
+            bool isFreqTracked = false;
+            uint8_t freqCounter = 0;
         };
 
         /**
@@ -310,20 +374,107 @@ public:
 
         DatatypeCombo getDatatypeCounts() const;
 
+        FreqCounts getFreqCounts() const;
+
+        /**
+         * Update the frequency histogram for a change of the frequency
+         * counter of v made outside of prologue() / epilogue().
+         */
+        void freqCounterChanged(const StoredValue& v,
+                                uint8_t oldFreq,
+                                uint8_t newFreq);
+
+        /**
+         * Apply a decay of all frequency counters to the histogram; each
+         * count moves to the value its counters decay to.
+         *
+         * @param percentage the percentage of its value each counter is left
+         *        with
+         */
+        void decayFreqCounts(uint16_t percentage);
+
         size_t getCacheSize() const;
 
         size_t getMetaDataMemory() const;
 
+        size_t getKeyMemory() const;
+
         size_t getMemSize() const;
 
         size_t getUncompressedMemSize() const;
 
     private:
+        /// @return the properties of sv (including its decayed freqCounter)
+        StoredValueProperties getProperties(const StoredValue* sv) const;
+
         struct CacheLocalStatistics;
 
         LastLevelCacheStore<CacheLocalStatistics> llcLocal;
 
         EPStats& epStats;
+
+        const HashTable& ht;
+
+        /**
+         * Frequency histogram, see FreqCounts. Signed as an update racing
+         * with decayFreqCounts() may decrement a count it has just moved;
+         * negative counts read as 0.
+         */
+        std::array<std::atomic<int32_t>,
+                   std::numeric_limits<uint8_t>::max() + 1>
+                freqCounts{};
+    };
+
+    /**
+     * Per-lock state used to exclude optimistic (mutex-free) readers while a
+     * writer holds the corresponding mutex. Only allocated when the HashTable
+     * is created with HashTableReadMode::Optimistic.
+     *
+     * Readers announce themselves by incrementing `readers` and then check
+     * `writers`; writers increment `writers` after acquiring the mutex and
+     * then wait for `readers` to drain. As both sides use sequentially
+     * consistent operations, either the reader observes the writer and backs
+     * off, or the writer observes the reader and waits for it to finish. As
+     * such a StoredValue reached by an admitted reader cannot be modified or
+     * freed until that reader exits.
+     */
+    struct ReadStripe {
+        /// Called by a writer after acquiring the stripe's mutex.
+        void excludeReaders() {
+            writers.fetch_add(1);
+            generation.fetch_add(1);
+            while (readers.load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+
+        /// Called by a writer before (or after) releasing the stripe's mutex.
+        void admitReaders() {
+            writers.fetch_sub(1);
+        }
+
+        /**
+         * Attempt to start an optimistic read.
+         * @return true if the read may proceed (caller must call exitRead()),
+         *         false if a writer is active.
+         */
+        bool tryEnterRead() {
+            readers.fetch_add(1);
+            if (writers.load() != 0) {
+                readers.fetch_sub(1);
+                return false;
+            }
+            return true;
+        }
+
+        void exitRead() {
+            readers.fetch_sub(1);
+        }
+
+        std::atomic<uint32_t> writers{0};
+        std::atomic<uint32_t> readers{0};
+        /// Bumped by every writer (see HashTable::getGeneration())
+        std::atomic<uint64_t> generation{0};
     };
 
     /**
@@ -337,12 +488,50 @@ public:
         HashBucketLock()
             : bucketNum(-1) {}
 
-        HashBucketLock(int bucketNum, std::mutex& mutex)
-            : bucketNum(bucketNum), htLock(mutex) {
+        HashBucketLock(int bucketNum,
+                       std::mutex& mutex,
+                       ReadStripe* readStripe = nullptr)
+            : bucketNum(bucketNum), htLock(mutex), readStripe(readStripe) {
+            if (readStripe) {
+                readStripe->excludeReaders();
+            }
+        }
+
+        /**
+         * Acquire the lock through the given profiler, recording the
+         * contention on it against the function it is acquired from.
+         */
+        HashBucketLock(int bucketNum,
+                       std::mutex& mutex,
+                       ReadStripe* readStripe,
+                       LockProfiler& profiler,
+                       const char* site = LOCK_PROFILER_CALLER)
+            : bucketNum(bucketNum),
+              htLock(profiler.lock(
+                             mutex, LockProfiler::Lock::HashTableBucket, site),
+                     std::adopt_lock),
+              readStripe(readStripe),
+              profiler(&profiler),
+              acquired(profiler.startHold()) {
+            if (readStripe) {
+                readStripe->excludeReaders();
+            }
         }
 
         HashBucketLock(HashBucketLock&& other)
-            : bucketNum(other.bucketNum), htLock(std::move(other.htLock)) {
+            : bucketNum(other.bucketNum),
+              htLock(std::move(other.htLock)),
+              readStripe(std::exchange(other.readStripe, nullptr)),
+              chain(std::exchange(other.chain, nullptr)),
+              profiler(std::exchange(other.profiler, nullptr)),
+              acquired(other.acquired) {
+        }
+
+        ~HashBucketLock() {
+            if (readStripe) {
+                readStripe->admitReaders();
+            }
+            endHold();
         }
 
         // Cannot copy HashBucketLock.
@@ -350,8 +539,16 @@ public:
         HashBucketLock& operator=(const HashBucketLock& other) = delete;
 
         HashBucketLock& operator=(HashBucketLock&& other) {
+            if (readStripe) {
+                readStripe->admitReaders();
+            }
+            endHold();
             bucketNum = other.bucketNum;
             htLock = std::move(other.htLock);
+            readStripe = std::exchange(other.readStripe, nullptr);
+            chain = std::exchange(other.chain, nullptr);
+            profiler = std::exchange(other.profiler, nullptr);
+            acquired = other.acquired;
             return *this;
         }
 
@@ -370,6 +567,32 @@ public:
     private:
         int bucketNum;
         std::unique_lock<std::mutex> htLock;
+        // The hash chain holding the key this lock was acquired for. Only
+        // set when locked by key (as it may then be in the old bucket array
+        // during an incremental resize); otherwise bucketNum indexes the
+        // current bucket array.
+        // Stripe whose optimistic readers are excluded while this lock is
+        // held; nullptr if the HashTable does not permit optimistic reads.
+        ReadStripe* readStripe = nullptr;
+        // The hash chain holding the key this lock was acquired for. Only
+        // set when locked by key (as it may then be in the old bucket array
+        // during an incremental resize); otherwise bucketNum indexes the
+        // current bucket array.
+        StoredValue::UniquePtr* chain = nullptr;
+        // The profiler the lock was acquired through (if any), and when.
+        // The hold time isn't recorded if the lock is released through
+        // getHTLock().
+        LockProfiler* profiler = nullptr;
+        std::chrono::steady_clock::time_point acquired;
+
+        void endHold() {
+            if (profiler && htLock.owns_lock()) {
+                profiler->endHold(LockProfiler::Lock::HashTableBucket,
+                                  acquired);
+            }
+        }
+
+        friend class HashTable;
     };
 
     /**
@@ -379,18 +602,30 @@ public:
      * @param svFactory Factory to use for constructing stored values
      * @param initialSize the number of hash table buckets to initially create.
      * @param locks the number of locks in the hash table
+     * @param readMode whether findForReadOptimistic() may read without
+     *        acquiring the HashBucket's mutex.
+     * @param resizeMode whether resize() rehashes in one step or
+     *        incrementally.
+     * @param hugePages whether to back the bucket array with huge pages
+     *        once it's at least a huge page (see HugePageAllocator).
      */
     HashTable(EPStats& st,
               std::unique_ptr<AbstractStoredValueFactory> svFactory,
               size_t initialSize,
-              size_t locks);
+              size_t locks,
+              HashTableReadMode readMode = HashTableReadMode::Locked,
+              HashTableResizeMode resizeMode = HashTableResizeMode::Blocking,
+              bool hugePages = false);
 
     ~HashTable();
 
     size_t memorySize() {
         return sizeof(HashTable)
-            + (size * sizeof(StoredValue*))
-            + (mutexes.size() * sizeof(std::mutex));
+            + ((size + oldSize) * sizeof(StoredValue*))
+            + (migrationCursor.size() * sizeof(size_t))
+            + (mutexes.size() * sizeof(std::mutex))
+            + (readStripes ? mutexes.size() *
+                    sizeof(folly::cacheline_aligned<ReadStripe>) : 0);
     }
 
     /**
@@ -456,6 +691,32 @@ public:
         frequencyCounterSaturated = callbackFunction;
     }
 
+    /**
+     * Decay the frequency counter of every StoredValue by the given
+     * percentage (of its value). Constant time: the decay is only recorded
+     * (by advancing the frequency decay epoch), and applied to each counter
+     * the next time it is updated or visited (see unlocked_applyFreqDecay).
+     *
+     * @param percentage the percentage of its value each counter is left with
+     */
+    void decayFreqCounters(uint16_t percentage);
+
+    /**
+     * Apply to the frequency counter of v the decays recorded since it was
+     * last decayed. Must be called before using the counter of a StoredValue
+     * to compare it to others.
+     *
+     * @param hbl HashBucketLock that must be held
+     * @param v the StoredValue to decay
+     * @return the (decayed) frequency counter of v
+     */
+    uint8_t unlocked_applyFreqDecay(const HashBucketLock& hbl, StoredValue& v);
+
+    /// @return the frequency decay epoch (modulo 16)
+    uint8_t getFreqDecayEpoch() const {
+        return freqDecayEpoch & StoredValue::freqDecayEpochMask;
+    }
+
     /**
      * Gets a reference to the frequencyCounterSaturated function.
      * Currently used for testing purposes.
@@ -465,6 +726,15 @@ public:
         return frequencyCounterSaturated;
     }
 
+    /**
+     * Share the values of the StoredValues stored from now on with those
+     * of other keys (of any vBucket using the same deduplicator) which have
+     * identical contents.
+     */
+    void setValueDeduplicator(std::shared_ptr<ValueDeduplicator> dedup) {
+        valueDeduplicator = std::move(dedup);
+    }
+
     /**
      * Remove in case of a temporary item
      *
@@ -503,6 +773,14 @@ public:
         return valueStats.getMetaDataMemory();
     }
 
+    /**
+     * Get the memory used by the keys of the StoredValues in this hash table
+     * (included in the metadata memory).
+     */
+    size_t getKeyMemory() const {
+        return valueStats.getKeyMemory();
+    }
+
     size_t getUncompressedItemMemory() const {
         return valueStats.getUncompressedMemSize();
     }
@@ -530,6 +808,27 @@ public:
         return valueStats.getDatatypeCounts();
     }
 
+    /**
+     * Get the number of evictable (resident, alive, committed) items at each
+     * frequency counter value. Maintained as items are added, accessed,
+     * mutated, evicted and decayed, so approximate under concurrent updates.
+     */
+    FreqCounts getFreqCounts() const {
+        return valueStats.getFreqCounts();
+    }
+
+    /**
+     * Set the frequency counter of the given StoredValue, keeping the
+     * frequency histogram (getFreqCounts) up to date.
+     *
+     * @param hbl HashBucketLock that must be held
+     * @param v the StoredValue to update
+     * @param freq the new frequency counter
+     */
+    void unlocked_setFreqCounterValue(const HashBucketLock& hbl,
+                                      StoredValue& v,
+                                      uint8_t freq);
+
     /**
      * Automatically resize to fit the current data.
      */
@@ -537,9 +836,48 @@ public:
 
     /**
      * Resize to the specified size.
+     *
+     * In HashTableResizeMode::Incremental this only begins the resize (if
+     * one is not already in progress); the buckets are migrated by
+     * subsequent calls to resizeStep() and by accesses to the HashTable.
      */
     void resize(size_t to);
 
+    /**
+     * Advance an in-progress incremental resize, migrating up to
+     * `maxBucketsPerLock` old buckets for each lock (acquiring one lock at a
+     * time). Once all buckets have been migrated the old bucket array is
+     * freed.
+     *
+     * @return true if no resize is in progress (any more).
+     */
+    bool resizeStep(size_t maxBucketsPerLock);
+
+    /// @returns true if an incremental resize is in progress.
+    bool isResizeInProgress() const {
+        return oldSize != 0;
+    }
+
+    /**
+     * @returns the number of old buckets migrated so far by the
+     * in-progress incremental resize; zero if not resizing.
+     */
+    size_t getResizeMigratedBuckets() const {
+        return migratedBuckets;
+    }
+
+    /**
+     * @returns the total number of old buckets to be migrated by the
+     * in-progress incremental resize; zero if not resizing.
+     */
+    size_t getResizeTotalBuckets() const {
+        return oldSize;
+    }
+
+    HashTableResizeMode getResizeMode() const {
+        return resizeMode;
+    }
+
     /**
      * Result of the findForRead() method.
      */
@@ -581,6 +919,90 @@ public:
             WantsDeleted wantsDeleted = WantsDeleted::No,
             ForGetReplicaOp fetchRequestedForReplicaItem = ForGetReplicaOp::No);
 
+    /**
+     * RAII holder for an optimistic (mutex-free) read of a lock stripe. While
+     * the guard is held, StoredValues in the HashBucket it was taken for
+     * cannot be modified or freed by writers.
+     */
+    class OptimisticReadGuard {
+    public:
+        OptimisticReadGuard() = default;
+
+        explicit OptimisticReadGuard(ReadStripe& stripe) : stripe(&stripe) {
+        }
+
+        OptimisticReadGuard(OptimisticReadGuard&& other)
+            : stripe(std::exchange(other.stripe, nullptr)) {
+        }
+
+        OptimisticReadGuard(const OptimisticReadGuard&) = delete;
+        OptimisticReadGuard& operator=(const OptimisticReadGuard&) = delete;
+        OptimisticReadGuard& operator=(OptimisticReadGuard&&) = delete;
+
+        ~OptimisticReadGuard() {
+            if (stripe) {
+                stripe->exitRead();
+            }
+        }
+
+    private:
+        ReadStripe* stripe = nullptr;
+    };
+
+    /**
+     * Result of the findForReadOptimistic() method.
+     */
+    struct FindROOptimisticResult {
+        /// If find successful then pointer to found StoredValue; else
+        /// nullptr.
+        const StoredValue* storedValue;
+        /// Guard protecting storedValue; storedValue may only be accessed
+        /// while the guard remains in scope.
+        OptimisticReadGuard guard;
+    };
+
+    /**
+     * Find an item with the specified key for read-only access, without
+     * acquiring the HashBucket's mutex.
+     *
+     * Has the same semantics as findForRead(), except that:
+     * - the StoredValue must not be modified via the result (no
+     *   HashBucketLock is held), nor may any HashTable lock be acquired
+     *   while the result is in scope.
+     * - if the lookup would have to modify the StoredValue (i.e. the
+     *   frequency counter needs incrementing) or conflicts with a concurrent
+     *   writer then no result is returned and the caller should fall back to
+     *   findForRead().
+     *
+     * @return The found (or not found) item, or an empty optional if the
+     *         lookup could not be performed optimistically (including if the
+     *         HashTable was not created in HashTableReadMode::Optimistic).
+     */
+    std::optional<FindROOptimisticResult> findForReadOptimistic(
+            const DocKey& key,
+            TrackReference trackReference = TrackReference::Yes,
+            WantsDeleted wantsDeleted = WantsDeleted::No,
+            ForGetReplicaOp fetchRequestedForReplicaItem = ForGetReplicaOp::No);
+
+    /**
+     * Get the generation of the lock stripe the given key belongs to. It
+     * changes whenever a writer acquires the stripe's lock, so a value read
+     * for the key after getting the generation is unchanged until the
+     * generation changes. The generations start at a random value, so
+     * they're not repeated by a new HashTable.
+     *
+     * @return the generation, or an empty optional if there is a writer of
+     *         the stripe (or the HashTable is not active, or was not created
+     *         in HashTableReadMode::Optimistic)
+     */
+    std::optional<uint64_t> getGeneration(const DocKey& key);
+
+    /// @returns the read mode this HashTable was created with.
+    HashTableReadMode getReadMode() const {
+        return readStripes ? HashTableReadMode::Optimistic
+                           : HashTableReadMode::Locked;
+    }
+
     /**
      * Result of the findFor...() methods which return a non-const result.
      */
@@ -867,6 +1289,29 @@ public:
      */
     FindResult findItem(const Item& item);
 
+    /// The index of the keys which have an expiry time
+    ExpiryIndex& getExpiryIndex() {
+        return expiryIndex;
+    }
+
+    /**
+     * Add the key of the StoredValue to the expiry index if it's a live
+     * document with an expiry time. Must be called (with the bucket lock
+     * held) whenever the expiry time of a StoredValue is set.
+     */
+    void trackExpiry(const StoredValue& v) {
+        if (!v.isDeleted() && !v.isTempItem()) {
+            expiryIndex.add(v.getKey(), v.getExptime());
+        }
+    }
+
+    /**
+     * Replace the value of the StoredValue with the identical value of
+     * another key, if the valueDeduplicator has one. Must be called (with
+     * the bucket lock held) whenever a StoredValue is given a new value.
+     */
+    void dedupValue(StoredValue& v);
+
     /**
      * Find a resident item
      *
@@ -875,6 +1320,36 @@ public:
      */
     std::unique_ptr<Item> getRandomKey(CollectionID cid, long rnd);
 
+    /**
+     * Sample randomly chosen hash buckets and find the least frequently used
+     * (lowest frequency counter) StoredValue which the predicate accepts.
+     * Each bucket is only locked while it is sampled, so the cost is
+     * proportional to sampleSize rather than to the size of the HashTable.
+     *
+     * @param sampleSize the number of hash buckets to sample
+     * @param random source of randomization inputs, one per bucket sampled
+     * @param eligible predicate, called with the bucket lock held
+     * @return the key of the least frequently used eligible StoredValue,
+     *         or nullopt if none of the sampled buckets had one
+     */
+    std::optional<StoredDocKey> sampleLeastFrequentKey(
+            size_t sampleSize,
+            const std::function<long()>& random,
+            const std::function<bool(const StoredValue&)>& eligible);
+
+    /**
+     * Visit the StoredValues of consecutive hash buckets, starting from a
+     * random bucket and wrapping around, until the visitor returns false or
+     * every bucket was visited. Each bucket is only locked while it is
+     * visited.
+     *
+     * @param rnd a randomization input
+     * @param visitor called with the bucket lock held
+     * @return false if the visitor stopped the walk
+     */
+    bool visitFromRandomBucket(
+            long rnd, const std::function<bool(const StoredValue&)>& visitor);
+
     /**
      * Set an Item into the this hashtable
      *
@@ -1048,12 +1523,13 @@ public:
      * @param s the key
      * @return HashBucektLock which contains a lock and the hash bucket number
      */
-    inline HashBucketLock getLockedBucket(const DocKey& key) {
+    inline HashBucketLock getLockedBucket(
+            const DocKey& key, const char* site = LOCK_PROFILER_CALLER) {
         if (!isActive()) {
             throw std::logic_error("HashTable::getLockedBucket: Cannot call on a "
                     "non-active object");
         }
-        return getLockedBucketForHash(key.hash());
+        return getLockedBucketForHash(key.hash(), site);
     }
 
     /**
@@ -1137,6 +1613,9 @@ public:
      * NOTE: Upon a successful ejection (and if full eviction is enabled)
      *       the StoredValue will be deleted, therefore it is *not* safe to
      *       access vptr after calling this function if it returned true.
+     *       With value eviction the StoredValue may be replaced by a smaller
+     *       copy (see AbstractStoredValueFactory::copyNonResidentStoredValue),
+     *       in which case vptr is updated to point at the copy.
      */
     bool unlocked_ejectItem(const HashTable::HashBucketLock& hbl,
                             StoredValue*& vptr,
@@ -1242,7 +1721,8 @@ public:
 
 private:
     // The container for actually holding the StoredValues.
-    using table_type = std::vector<StoredValue::UniquePtr>;
+    using table_type = std::vector<StoredValue::UniquePtr,
+                                   HugePageAllocator<StoredValue::UniquePtr>>;
 
     friend class StoredValue;
     friend std::ostream& operator<<(std::ostream& os, const HashTable& ht);
@@ -1256,10 +1736,30 @@ private:
      * @param bucket the bucket number to lock
      * @return HashBucektLock which contains a lock and the hash bucket number
      */
-    inline HashBucketLock getLockedBucket(int bucket) {
-        return HashBucketLock(bucket, mutexes[mutexForBucket(bucket)]);
+    inline HashBucketLock getLockedBucket(
+            int bucket, const char* site = LOCK_PROFILER_CALLER) {
+        const auto lock = mutexForBucket(bucket);
+        return HashBucketLock(
+                bucket, mutexes[lock], getReadStripe(lock), lockProfiler, site);
     }
 
+    /// @returns the ReadStripe for the given lock, or nullptr if optimistic
+    ///          reads are not enabled.
+    ReadStripe* getReadStripe(size_t lock) const {
+        return readStripes ? &*readStripes[lock] : nullptr;
+    }
+
+    /**
+     * Exclude optimistic readers from all lock stripes. Must be called with
+     * all mutexes held (e.g. via MultiLockHolder); readers are re-admitted
+     * when the returned object goes out of scope.
+     */
+    struct AllReadersExcluded {
+        explicit AllReadersExcluded(const HashTable& ht);
+        ~AllReadersExcluded();
+        const HashTable& ht;
+    };
+
     /**
      * Get a lock holder holding a lock for the bucket for the given
      * hash.
@@ -1267,7 +1767,8 @@ private:
      * @param h the input hash
      * @return HashBucketLock which contains a lock and the hash bucket number
      */
-    inline HashBucketLock getLockedBucketForHash(int h) {
+    inline HashBucketLock getLockedBucketForHash(
+            int h, const char* site = LOCK_PROFILER_CALLER) {
         while (true) {
             if (!isActive()) {
                 throw std::logic_error(
@@ -1275,13 +1776,70 @@ private:
                         "Cannot call on a non-active object");
             }
             int bucket = getBucketForHash(h);
-            HashBucketLock rv(bucket, mutexes[mutexForBucket(bucket)]);
+            const auto lock = mutexForBucket(bucket);
+            HashBucketLock rv(bucket,
+                              mutexes[lock],
+                              getReadStripe(lock),
+                              lockProfiler,
+                              site);
             if (bucket == getBucketForHash(h)) {
+                if (isResizeInProgress()) {
+                    // Opportunistically help the resize along.
+                    migrateBuckets_UNLOCKED(lock, accessMigrationChunkSize);
+                }
+                rv.chain = &getChainForHash(h);
                 return rv;
             }
         }
     }
 
+    /**
+     * @returns the hash chain which the StoredValues with the given hash
+     * are in. Requires the lock for the hash is held (or optimistic readers
+     * admitted).
+     */
+    StoredValue::UniquePtr& getChainForHash(int h) {
+        if (oldSize != 0) {
+            const auto oldBucket =
+                    size_t(abs(h % static_cast<int>(oldSize.load())));
+            if (oldBucket >= migrationCursor[oldBucket % mutexes.size()]) {
+                return oldValues[oldBucket];
+            }
+        }
+        return values[getBucketForHash(h)];
+    }
+
+    /// @returns the hash chain the given HashBucketLock is for.
+    StoredValue::UniquePtr& getChain(const HashBucketLock& hbl) {
+        return hbl.chain ? *hbl.chain : values[hbl.getBucketNum()];
+    }
+
+    /// @returns the size rounded as required by the resize mode.
+    size_t roundSize(size_t size) const;
+
+    /**
+     * Begin an incremental resize to the given size (whose buckets must
+     * already be allocated, as newValues).
+     */
+    void beginIncrementalResize(table_type&& newValues);
+
+    /**
+     * Migrate up to maxBuckets of the old buckets owned by the given lock to
+     * the new bucket array. Caller must hold the lock (as a HashBucketLock,
+     * so optimistic readers are excluded).
+     * @return true if all buckets owned by the lock have been migrated.
+     */
+    bool migrateBuckets_UNLOCKED(size_t lock, size_t maxBuckets);
+
+    /**
+     * Migrate all remaining old buckets owned by the given lock, a chunk at
+     * a time (re-acquiring the lock for each chunk).
+     */
+    void migrateAllBucketsForLock(size_t lock);
+
+    /// Free the old bucket array once all buckets have been migrated.
+    void finishIncrementalResize();
+
     /**
      * Result of the findInner() method.
      */
@@ -1328,14 +1886,36 @@ private:
     // in `values`
     std::atomic<size_t> size;
     table_type values;
+    // State of an in-progress incremental resize. oldSize is non-zero iff a
+    // resize is in progress, in which case oldValues holds the buckets not
+    // yet migrated. Both are only modified while holding all mutexes.
+    table_type oldValues;
+    std::atomic<size_t> oldSize{0};
+    // Per-lock index of the next old bucket to migrate; an old bucket `o`
+    // owned by lock L has been migrated iff `o < migrationCursor[L]`.
+    // Element L is guarded by mutexes[L].
+    std::vector<size_t> migrationCursor;
+    // Count of old buckets migrated so far (for stats).
+    std::atomic<size_t> migratedBuckets{0};
+    const HashTableResizeMode resizeMode;
+    // Number of old buckets to migrate per front-end access to the table.
+    static constexpr size_t accessMigrationChunkSize = 2;
+    // Number of old buckets to migrate per lock acquisition when migrating
+    // in bulk (visitors).
+    static constexpr size_t resizeStepChunkSize = 1024;
     // Mutable so that we can make dumpStoredValuesAsJson const
     mutable std::vector<std::mutex> mutexes;
+    // One element per mutex if optimistic reads are enabled, else nullptr.
+    std::unique_ptr<folly::cacheline_aligned<ReadStripe>[]> readStripes;
     EPStats&             stats;
+    LockProfiler& lockProfiler;
     std::unique_ptr<AbstractStoredValueFactory> valFact;
     std::atomic<size_t>       visitors;
 
     Statistics valueStats;
 
+    ExpiryIndex expiryIndex;
+
     std::atomic<size_t> numEjects;
     std::atomic<size_t>       numResizes;
 
@@ -1357,6 +1937,17 @@ private:
     // responsible for waking the ItemFreqDecayer task.
     std::function<void()> frequencyCounterSaturated{[]() {}};
 
+    /// Shares identical values between keys (null if disabled)
+    std::shared_ptr<ValueDeduplicator> valueDeduplicator;
+
+    // The number of times the frequency counters have been decayed (and the
+    // percentage they were last decayed by). StoredValues record the epoch
+    // they were last decayed to, and the pending decays are applied lazily.
+    // An epoch which is not applied within 16 decays is lost (by then a
+    // counter decayed by the default 50% would have reached 0 anyway).
+    std::atomic<uint8_t> freqDecayEpoch{0};
+    std::atomic<uint16_t> freqDecayPercentage{100};
+
     int getBucketForHash(int h) {
         return abs(h % static_cast<int>(size));
     }
@@ -1416,6 +2007,16 @@ private:
      */
     void updateFreqCounter(StoredValue& v);
 
+    /**
+     * Apply the pending frequency decay of the given stored value (the lock
+     * of its hash bucket must be held).
+     * @return the decayed frequency counter
+     */
+    uint8_t applyFreqDecay(StoredValue& v);
+
+    /// @return the frequency counter of v, with the pending decays applied
+    uint8_t getDecayedFreqCounterValue(const StoredValue& v) const;
+
     DISALLOW_COPY_AND_ASSIGN(HashTable);
     friend class HashTableBench;
 };
@@ -21,6 +21,7 @@
 
 #include "atomic.h"
 
+#include <folly/lang/Align.h>
 #include <memcached/engine.h>
 #include <memcached/engine_common.h>
 #include <platform/checked_snprintf.h>
@@ -82,7 +83,8 @@ public:
     cb::HlcTime peekHLC() const;
 
     /**
-     * Advance the HLC, returning the new time.
+     * Advance the HLC, returning the new time. Every call returns a distinct
+     * value, even when called concurrently.
      */
     uint64_t nextHLC() {
         // Create a monotonic timestamp using part of the HLC algorithm by.
@@ -90,16 +92,20 @@ public:
         // b) dropping 16-bits (done by nowHLC)
         // c) comparing it with the last known time (max_cas)
         // d) returning either now or max_cas + 1
-        uint64_t timeNow = getMasked48(getTime());
+        // The callers normally hold the vbucket's checkpoint queueLock, so
+        // (other than a racing setMaxHLC) the exchange succeeds first time;
+        // the value it installs is the one returned.
+        const uint64_t timeNow = getMasked48(getTime());
         uint64_t l = maxHLC.load();
+        uint64_t next;
+        do {
+            next = timeNow > l ? timeNow : l + 1;
+        } while (!maxHLC.compare_exchange_weak(l, next));
 
-        if (timeNow > l) {
-            atomic_setIfBigger(maxHLC, timeNow);
-            return timeNow;
+        if (next != timeNow) {
+            logicalClockTicks++;
         }
-        logicalClockTicks++;
-        atomic_setIfBigger(maxHLC, l + 1);
-        return l + 1;
+        return next;
     }
 
     void setMaxHLCAndTrackDrift(uint64_t hlc) {
@@ -201,14 +207,17 @@ private:
      * has a larger clock value. nextHLC and setMax* methods change this and can
      * be called from different threads
      */
-    std::atomic<uint64_t> maxHLC;
+    alignas(folly::hardware_destructive_interference_size)
+            std::atomic<uint64_t> maxHLC;
 
     /*
      * The following are used for stats/drift tracking.
      * many threads could be setting cas so they need to be atomically
-     * updated for consisent totals.
+     * updated for consisent totals. They are kept off the cache line of
+     * maxHLC, which every mutation of the vbucket updates.
      */
-    std::atomic<uint64_t> cummulativeDrift;
+    alignas(folly::hardware_destructive_interference_size)
+            std::atomic<uint64_t> cummulativeDrift;
     std::atomic<uint64_t> cummulativeDriftIncrements;
     std::atomic<uint64_t> logicalClockTicks;
     std::atomic<uint32_t> driftAheadExceeded;
@@ -34,7 +34,17 @@ public:
 
     void visitBucket(const VBucketPtr& vb) override {
         vb->ht.resize();
+
+        // Drive any incremental resize to completion. Each step only holds
+        // one HashTable lock at a time (for a bounded number of buckets), so
+        // front-end operations are not blocked for the duration of the
+        // rehash.
+        while (!vb->ht.resizeStep(bucketsPerLockPerStep)) {
+        }
     }
+
+private:
+    static constexpr size_t bucketsPerLockPerStep = 256;
 };
 
 HashtableResizerTask::HashtableResizerTask(KVBucketIface& s, double sleepTime)
@@ -49,9 +59,9 @@ bool HashtableResizerTask::run() {
     TRACE_EVENT0("ep-engine/task", "HashtableResizerTask");
     auto pv = std::make_unique<ResizingVisitor>();
 
-    // [per-VBucket Task] While a Hashtable is resizing no user
-    // requests can be performed (the resizing process needs to
-    // acquire all HT locks). As such we are sensitive to the duration
+    // [per-VBucket Task] While a Hashtable is resizing (in blocking
+    // mode) no user requests can be performed (the resizing process needs
+    // to acquire all HT locks). As such we are sensitive to the duration
     // of this task - we want to log anything which has a
     // non-negligible impact on frontend operations.
     const auto maxExpectedDurationForVisitorTask =
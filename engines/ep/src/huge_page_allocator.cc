@@ -0,0 +1,38 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "huge_page_allocator.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace cb::hugepages {
+void* allocate(size_t bytes) {
+    auto* p = ::operator new(bytes, std::align_val_t(Size));
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // Only a hint: fails if transparent huge pages aren't supported, in
+    // which case the memory is just backed by ordinary pages.
+    (void)madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    return p;
+}
+
+void deallocate(void* p) noexcept {
+    ::operator delete(p, std::align_val_t(Size));
+}
+} // namespace cb::hugepages
@@ -0,0 +1,140 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <platform/relaxed_atomic.h>
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace cb::hugepages {
+/// The size of a (x86-64 / aarch64) transparent huge page.
+constexpr size_t Size = 2 * 1024 * 1024;
+
+/// @return bytes rounded up to a multiple of the huge page size.
+constexpr size_t roundUp(size_t bytes) {
+    return (bytes + Size - 1) & ~(Size - 1);
+}
+
+/**
+ * Allocate (from the bucket's allocator, so it's accounted in mem_used)
+ * bytes aligned to the huge page size, and advise the kernel to back them
+ * with transparent huge pages (Linux only; elsewhere, or if transparent
+ * huge pages are disabled, they are ordinary pages).
+ *
+ * @param bytes the size to allocate, a multiple of the huge page size
+ */
+void* allocate(size_t bytes);
+
+/// Free memory returned by allocate().
+void deallocate(void* p) noexcept;
+} // namespace cb::hugepages
+
+/**
+ * Allocator of large, long-lived arrays which are accessed at random (e.g.
+ * the HashTable bucket array), which can back them with huge pages to
+ * reduce the TLB misses of the accesses.
+ *
+ * When enabled, the allocations of at least a huge page are rounded up to a
+ * multiple of the huge page size and allocated by cb::hugepages::allocate.
+ * Smaller allocations (which would waste most of the page), and all the
+ * allocations of a disabled allocator, are plain operator new.
+ *
+ * The allocator propagates with the container, as memory must be
+ * deallocated by an allocator with the same setting.
+ */
+template <class T>
+class HugePageAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    HugePageAllocator() noexcept = default;
+
+    /**
+     * @param enabled whether to use huge pages for large allocations
+     * @param footprint where to account the bytes allocated with huge pages
+     *        (optional; must outlive the allocator and its allocations)
+     */
+    HugePageAllocator(bool enabled,
+                      cb::RelaxedAtomic<size_t>* footprint) noexcept
+        : enabled(enabled), footprint(footprint) {
+    }
+
+    template <class U>
+    HugePageAllocator(const HugePageAllocator<U>& other) noexcept
+        : enabled(other.isEnabled()), footprint(other.getFootprint()) {
+    }
+
+    value_type* allocate(std::size_t n) {
+        const auto bytes = n * sizeof(T);
+        if (!useHugePages(bytes)) {
+            return static_cast<value_type*>(::operator new(bytes));
+        }
+        const auto rounded = cb::hugepages::roundUp(bytes);
+        auto* p = cb::hugepages::allocate(rounded);
+        if (footprint) {
+            *footprint += rounded;
+        }
+        return static_cast<value_type*>(p);
+    }
+
+    void deallocate(value_type* p, std::size_t n) noexcept {
+        const auto bytes = n * sizeof(T);
+        if (!useHugePages(bytes)) {
+            ::operator delete(p);
+            return;
+        }
+        cb::hugepages::deallocate(p);
+        if (footprint) {
+            *footprint -= cb::hugepages::roundUp(bytes);
+        }
+    }
+
+    bool isEnabled() const {
+        return enabled;
+    }
+
+    cb::RelaxedAtomic<size_t>* getFootprint() const {
+        return footprint;
+    }
+
+private:
+    bool useHugePages(size_t bytes) const {
+        return enabled && bytes >= cb::hugepages::Size;
+    }
+
+    bool enabled = false;
+    cb::RelaxedAtomic<size_t>* footprint = nullptr;
+};
+
+template <class T, class U>
+bool operator==(const HugePageAllocator<T>& a,
+                const HugePageAllocator<U>& b) noexcept {
+    return a.isEnabled() == b.isEnabled() &&
+           a.getFootprint() == b.getFootprint();
+}
+
+template <class T, class U>
+bool operator!=(const HugePageAllocator<T>& a,
+                const HugePageAllocator<U>& b) noexcept {
+    return !(a == b);
+}
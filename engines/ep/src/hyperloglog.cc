@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "hyperloglog.h"
+
+#include "murmurhash3.h"
+
+#include <folly/lang/Bits.h>
+#include <memcached/dockey.h>
+
+#include <cmath>
+
+HyperLogLog::HyperLogLog(const HyperLogLog& other) {
+    *this = other;
+}
+
+HyperLogLog& HyperLogLog::operator=(const HyperLogLog& other) {
+    for (size_t ii = 0; ii < NumRegisters; ++ii) {
+        registers[ii].store(other.registers[ii].load(std::memory_order_relaxed),
+                            std::memory_order_relaxed);
+    }
+    return *this;
+}
+
+void HyperLogLog::add(uint64_t hash) {
+    auto& reg = registers[hash >> (64 - Precision)];
+    const uint64_t rest = hash << Precision;
+    // Rank of the remaining 64 - Precision bits: 1 + their leading zeros
+    const auto rank = uint8_t(
+            rest == 0 ? (64 - Precision + 1) : (65 - folly::findLastSet(rest)));
+    auto current = reg.load(std::memory_order_relaxed);
+    while (rank > current &&
+           !reg.compare_exchange_weak(
+                   current, rank, std::memory_order_relaxed)) {
+    }
+}
+
+void HyperLogLog::add(const DocKey& key) {
+    // The encoded key includes the collection-ID, so equal keys of different
+    // collections hash differently.
+    uint64_t hash[2];
+    MurmurHash3_x64_128(key.data(), int(key.size()), 0, hash);
+    add(hash[0]);
+}
+
+HyperLogLog& HyperLogLog::operator+=(const HyperLogLog& other) {
+    for (size_t ii = 0; ii < NumRegisters; ++ii) {
+        const auto theirs = other.registers[ii].load(std::memory_order_relaxed);
+        if (theirs > registers[ii].load(std::memory_order_relaxed)) {
+            registers[ii].store(theirs, std::memory_order_relaxed);
+        }
+    }
+    return *this;
+}
+
+void HyperLogLog::clear() {
+    for (auto& reg : registers) {
+        reg.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t HyperLogLog::estimate() const {
+    constexpr double m = NumRegisters;
+    constexpr double alpha = 0.7213 / (1.0 + 1.079 / m);
+
+    double sum = 0;
+    size_t zeros = 0;
+    for (const auto& reg : registers) {
+        const auto value = reg.load(std::memory_order_relaxed);
+        sum += std::ldexp(1.0, -int(value));
+        if (value == 0) {
+            ++zeros;
+        }
+    }
+
+    const double raw = alpha * m * m / sum;
+    // Small cardinalities are estimated more accurately by the fraction of
+    // registers still empty (linear counting). With 64-bit hashes no large
+    // range correction is needed.
+    if (raw <= 2.5 * m && zeros != 0) {
+        return uint64_t(std::llround(m * std::log(m / zeros)));
+    }
+    return uint64_t(std::llround(raw));
+}
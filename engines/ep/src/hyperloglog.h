@@ -0,0 +1,66 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+struct DocKey;
+
+/**
+ * A HyperLogLog sketch, estimating how many distinct values were added to it
+ * in a fixed 2^Precision bytes of registers.
+ *
+ * Each value is added as a 64-bit hash: the top Precision bits select a
+ * register, which keeps the maximum "rank" (position of the first set bit) of
+ * the remaining bits seen. The standard error of the estimate is about
+ * 1.04 / sqrt(2^Precision), 6.5% for the 256 registers used here.
+ *
+ * Sketches merge losslessly (register-wise max), so per-vBucket sketches can
+ * be combined into one for the bucket. Registers are relaxed atomics: add()
+ * may be called concurrently with itself and with reads, which then see some
+ * of the concurrent adds.
+ */
+class HyperLogLog {
+public:
+    static constexpr size_t Precision = 8;
+    static constexpr size_t NumRegisters = size_t(1) << Precision;
+
+    HyperLogLog() = default;
+    HyperLogLog(const HyperLogLog& other);
+    HyperLogLog& operator=(const HyperLogLog& other);
+
+    /// Add the value with the given (well mixed, 64-bit) hash
+    void add(uint64_t hash);
+
+    /// Add the given key
+    void add(const DocKey& key);
+
+    /// Merge other into this sketch, which then estimates their union
+    HyperLogLog& operator+=(const HyperLogLog& other);
+
+    /// Forget all values added
+    void clear();
+
+    /// @return the estimated number of distinct values added
+    uint64_t estimate() const;
+
+private:
+    std::array<std::atomic<uint8_t>, NumRegisters> registers{};
+};
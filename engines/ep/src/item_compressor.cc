@@ -68,6 +68,10 @@ bool ItemCompressorTask::run() {
         visitor.clearStats();
         visitor.setCompressionMode(engine->getCompressionMode());
         visitor.setMinCompressionRatio(engine->getMinCompressionRatio());
+        visitor.setFreqThreshold(static_cast<uint8_t>(
+                engine->getConfiguration().getItemCompressorFreqThreshold()));
+        visitor.setSampleRate(
+                engine->getConfiguration().getItemCompressorSampleRate());
 
         // Do it - set off the visitor.
         epstore_position = engine->getKVBucket()->pauseResumeVisit(
@@ -16,9 +16,12 @@
  */
 
 #include "item_compressor_visitor.h"
+#include "collections/vbucket_manifest_handles.h"
 #include "vbucket.h"
 #include <platform/compress.h>
 
+#include <algorithm>
+
 // ItemCompressorVisitor implementation //////////////////////////////
 
 ItemCompressorVisitor::ItemCompressorVisitor()
@@ -41,23 +44,17 @@ bool ItemCompressorVisitor::visit(const HashTable::HashBucketLock& lh,
 
     // Check if the item can be compressed
     if (compressMode == BucketCompressionMode::Active && v.isCompressible()) {
-        cb::compression::Buffer deflated;
-        if (cb::compression::deflate(cb::compression::Algorithm::Snappy,
-                                     {v.getValue()->getData(), v.valuelen()},
-                                     deflated)) {
-            auto comp_ratio = static_cast<float>(v.valuelen()) /
-                              static_cast<float>(deflated.size());
-
-            // Compress the document only if the compression ratio is greater
-            // than or equal to the current minium compression ratio
-            if (comp_ratio >= currentMinCompressionRatio) {
-                currentVb->ht.storeCompressedBuffer(deflated, v);
-
-                // If the value was compressed, increment the count of number
-                // of compressed documents
-                compressed_count++;
+        auto& collection = collections[v.getKey().getCollectionID()];
+        if (currentVb->ht.unlocked_applyFreqDecay(lh, v) > freqThreshold) {
+            // Hot, stays inflated so its reads don't have to inflate it
+            collection.stats.skippedHot++;
+        } else {
+            const bool isJson = mcbp::datatype::is_json(v.getDatatype());
+            auto& sample = collection.samples[isJson];
+            if (shouldTry(sample)) {
+                compress(v, sample, collection);
             } else {
-                v.setUncompressible();
+                collection.stats.skippedSampled++;
             }
         }
     }
@@ -69,6 +66,59 @@ bool ItemCompressorVisitor::visit(const HashTable::HashBucketLock& lh,
     return progressTracker.shouldContinueVisiting(visited_count);
 }
 
+bool ItemCompressorVisitor::shouldTry(Sample& sample) const {
+    if (sample.incompressible < sampleRate) {
+        return true;
+    }
+    if (++sample.skipped < sampleRate) {
+        return false;
+    }
+    sample.skipped = 0;
+    return true;
+}
+
+void ItemCompressorVisitor::compress(StoredValue& v,
+                                     Sample& sample,
+                                     CollectionState& collection) {
+    cb::compression::Buffer deflated;
+    if (!cb::compression::deflate(cb::compression::Algorithm::Snappy,
+                                  {v.getValue()->getData(), v.valuelen()},
+                                  deflated)) {
+        return;
+    }
+    collection.stats.tried++;
+
+    const size_t inflatedSize = v.valuelen();
+    auto comp_ratio = static_cast<float>(inflatedSize) /
+                      static_cast<float>(deflated.size());
+
+    // Compress the document only if the compression ratio is greater
+    // than or equal to the current minium compression ratio
+    if (comp_ratio >= currentMinCompressionRatio) {
+        currentVb->ht.storeCompressedBuffer(deflated, v);
+
+        // If the value was compressed, increment the count of number
+        // of compressed documents
+        compressed_count++;
+        collection.stats.compressed++;
+        if (inflatedSize > deflated.size()) {
+            collection.stats.bytesSaved += inflatedSize - deflated.size();
+        }
+        sample.incompressible = 0;
+    } else {
+        v.setUncompressible();
+        sample.incompressible++;
+    }
+}
+
+void ItemCompressorVisitor::flushCollectionStats(VBucket& vb) {
+    auto handle = vb.lockCollections();
+    for (auto& [cid, collection] : collections) {
+        handle.addCompressorStats(cid, collection.stats);
+        collection.stats = {};
+    }
+}
+
 void ItemCompressorVisitor::clearStats() {
     compressed_count = 0;
     visited_count = 0;
@@ -91,6 +141,22 @@ void ItemCompressorVisitor::setCurrentVBucket(VBucket& vb) {
     currentVb = &vb;
 }
 
+void ItemCompressorVisitor::pauseVBucket(VBucket& vb) {
+    flushCollectionStats(vb);
+}
+
+void ItemCompressorVisitor::completeVBucket(VBucket& vb) {
+    flushCollectionStats(vb);
+}
+
 void ItemCompressorVisitor::setMinCompressionRatio(float minCompressionRatio) {
     currentMinCompressionRatio = minCompressionRatio;
 }
+
+void ItemCompressorVisitor::setFreqThreshold(uint8_t threshold) {
+    freqThreshold = threshold;
+}
+
+void ItemCompressorVisitor::setSampleRate(size_t rate) {
+    sampleRate = std::max(rate, size_t(1));
+}
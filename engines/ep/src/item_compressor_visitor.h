@@ -17,14 +17,30 @@
 
 #pragma once
 
+#include "collections/collections_types.h"
 #include "hash_table.h"
 #include "progress_tracker.h"
 #include "vb_visitors.h"
 #include <memcached/engine.h>
 
+#include <array>
+#include <unordered_map>
+
 /**
  * Item Compressor visitor - visit all objects in a VBucket and compress
  * the values
+ *
+ * Compressing a value needs a trial deflate (with the HashBucketLock held),
+ * and costs an inflate for every read of the value. To only pay where it
+ * saves memory:
+ * - Values accessed more often than the frequency threshold (hot values)
+ *   are left inflated.
+ * - Each collection samples the compressibility of its JSON and binary
+ *   values: once sample_rate values of a datatype in a row didn't compress
+ *   well enough, only one in sample_rate of them is tried until one does.
+ *
+ * What was done with the values of each collection is added to the collection
+ * stats of the VBucket when the visit of the VBucket pauses or completes.
  */
 class ItemCompressorVisitor : public VBucketAwareHTVisitor {
 public:
@@ -41,6 +57,13 @@ public:
     // Set the minimum compression ratio
     void setMinCompressionRatio(float minCompressionRatio);
 
+    // Set the frequency counter value above which values aren't compressed
+    void setFreqThreshold(uint8_t threshold);
+
+    // Set how many incompressible values of a datatype in a row make a
+    // collection only try one in that many of them (1 tries all)
+    void setSampleRate(size_t rate);
+
     // Implementation of HashTableVisitor interface:
     bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override;
 
@@ -55,7 +78,35 @@ public:
 
     void setCurrentVBucket(VBucket& vb) override;
 
+    void pauseVBucket(VBucket& vb) override;
+
+    void completeVBucket(VBucket& vb) override;
+
 private:
+    /// The compressibility sampled for a datatype of a collection
+    struct Sample {
+        // Values tried in a row which didn't compress well enough
+        size_t incompressible{0};
+        // Values not tried since the last one tried
+        size_t skipped{0};
+    };
+
+    struct CollectionState {
+        // Indexed by isJson
+        std::array<Sample, 2> samples;
+        // Counts not yet added to the stats of the collection
+        Collections::CompressorStats stats;
+    };
+
+    /// Should the next value of the sampled datatype be tried?
+    bool shouldTry(Sample& sample) const;
+
+    /// Try compressing the value (and record the outcome)
+    void compress(StoredValue& v, Sample& sample, CollectionState& collection);
+
+    /// Add the counts of the collections to the stats of the VBucket
+    void flushCollectionStats(VBucket& vb);
+
     /* Runtime state */
 
     // Estimates how far we have got, and when we should pause.
@@ -75,4 +126,13 @@ private:
 
     // The current minimum compression ratio supported by the bucket
     float currentMinCompressionRatio;
+
+    // Values with a higher frequency counter aren't compressed
+    uint8_t freqThreshold{std::numeric_limits<uint8_t>::max()};
+
+    // See setSampleRate
+    size_t sampleRate{1};
+
+    // The state of each visited collection (for the whole pass)
+    std::unordered_map<CollectionID, CollectionState> collections;
 };
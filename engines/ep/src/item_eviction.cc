@@ -20,6 +20,8 @@
 
 #include <gsl/gsl>
 
+#include <cmath>
+
 ItemEviction::ItemEviction() {
 }
 
@@ -46,6 +48,20 @@ std::pair<uint16_t, uint64_t> ItemEviction::getThresholds(
     return std::make_pair(freqThreshold, ageThreshold);
 }
 
+uint8_t ItemEviction::getFreqThreshold(const FreqCounts& counts,
+                                       double percentage,
+                                       uint64_t population) {
+    const auto target = uint64_t(std::ceil(population * percentage / 100.0));
+    uint64_t cumulative = 0;
+    for (size_t freq = 0; freq < counts.size(); ++freq) {
+        cumulative += counts[freq];
+        if (cumulative >= target) {
+            return gsl::narrow<uint8_t>(freq);
+        }
+    }
+    return std::numeric_limits<uint8_t>::max();
+}
+
 uint8_t ItemEviction::convertFreqCountToNRUValue(uint8_t probCounter) {
     /*
      * The probabilistic counter has a range form 0 to 255, however the
@@ -19,6 +19,7 @@
 
 #include "hdrhistogram.h"
 
+#include <array>
 #include <cstdlib> // Required due to the use of free
 #include <limits>
 #include <utility>
@@ -51,6 +52,11 @@
  * iterating over the hash table and evict all those values that have a
  * frequency count at or below the threshold.
  *
+ * Alternatively the frequency threshold can be computed before visiting any
+ * item, from the frequency histogram the HashTable maintains as items are
+ * accessed and mutated (see getFreqThreshold(FreqCounts...)). That avoids
+ * the learning phase at the start of each vBucket visit, during which the
+ * threshold is still converging and too few or too many items are evicted.
  */
 class ItemEviction {
 
@@ -94,6 +100,25 @@ public:
     // @param hist  the destination histogram for the copy
     void copyFreqHistogram(HdrHistogram& hist);
 
+    /// Number of items at each frequency counter value
+    using FreqCounts =
+            std::array<uint64_t, std::numeric_limits<uint8_t>::max() + 1>;
+
+    /**
+     * Returns the lowest frequency counter value such that the items with a
+     * counter at or below it account for the given percentage of the
+     * population.
+     *
+     * @param counts Number of evictable items at each frequency counter value
+     * @param percentage Percentage of the population to account for
+     * @param population Number of items the percentage applies to; items not
+     *        in counts (for example non-resident ones) cannot be evicted, so
+     *        are treated as having the maximum counter value.
+     */
+    static uint8_t getFreqThreshold(const FreqCounts& counts,
+                                    double percentage,
+                                    uint64_t population);
+
     // Map from the 8-bit probabilistic counter (256 states) to NRU (4 states).
     static uint8_t convertFreqCountToNRUValue(uint8_t statCounter);
 
@@ -19,9 +19,8 @@
 #include "bucket_logger.h"
 #include "ep_engine.h"
 #include "executorpool.h"
-#include "item_freq_decayer_visitor.h"
 #include "kv_bucket.h"
-#include "stored-value.h"
+#include "vbucket.h"
 
 #include <phosphor/phosphor.h>
 
@@ -30,8 +29,6 @@
 ItemFreqDecayerTask::ItemFreqDecayerTask(EventuallyPersistentEngine* e,
                                          uint16_t percentage_)
     : GlobalTask(e, TaskId::ItemFreqDecayerTask, 0, false),
-      completed(false),
-      epstore_position(engine->getKVBucket()->startPosition()),
       notified(false),
       percentage(percentage_) {
 }
@@ -46,71 +43,26 @@ bool ItemFreqDecayerTask::run() {
 
     ++(engine->getEpStats().freqDecayerRuns);
 
-    // Get our pause/resume visitor. If we didn't finish the previous pass,
-    // then resume from where we last were, otherwise create a new visitor
-    // starting from the beginning.
-    if (!prAdapter) {
-        prAdapter = std::make_unique<PauseResumeVBAdapter>(
-                std::make_unique<ItemFreqDecayerVisitor>(percentage));
-        epstore_position = engine->getKVBucket()->startPosition();
-        completed = false;
-    }
-
-    // Print start status.
-    if (globalBucketLogger->should_log(spdlog::level::debug)) {
-        std::stringstream ss;
-        ss << getDescription() << " for bucket '" << engine->getName() << "'";
-        if (epstore_position == engine->getKVBucket()->startPosition()) {
-            ss << " starting. ";
-        } else {
-            ss << " resuming from " << epstore_position << ", ";
-            ss << prAdapter->getHashtablePosition() << ".";
+    // Record the decay in every vBucket, it is applied to each document
+    // lazily
+    auto* kvBucket = engine->getKVBucket();
+    size_t decayed = 0;
+    for (auto vbid : kvBucket->getVBuckets().getBuckets()) {
+        auto vb = kvBucket->getVBucket(vbid);
+        if (vb) {
+            vb->ht.decayFreqCounters(percentage);
+            ++decayed;
         }
-        ss << " Using chunk_duration=" << getChunkDuration().count() << " ms.";
-        EP_LOG_DEBUG("{}", ss.str());
     }
 
-    // Prepare the underlying visitor.
-    auto& visitor = getItemFreqDecayerVisitor();
-    const auto start = std::chrono::steady_clock::now();
-    const auto deadline = start + getChunkDuration();
-    visitor.setDeadline(deadline);
-    visitor.clearStats();
-
-    // Do it - set off the visitor.
-    epstore_position = engine->getKVBucket()->pauseResumeVisit(
-            *prAdapter, epstore_position);
-    const auto end = std::chrono::steady_clock::now();
-
-    // Check if the visitor completed a full pass.
-    completed = (epstore_position == engine->getKVBucket()->endPosition());
-
-    // Print status.
-    if (globalBucketLogger->should_log(spdlog::level::debug)) {
-        std::stringstream ss;
-        ss << getDescription() << " for bucket '" << engine->getName() << "'";
-        if (completed) {
-            ss << " finished.";
-        } else {
-            ss << " paused at position " << epstore_position << ".";
-        }
-        std::chrono::microseconds duration =
-                std::chrono::duration_cast<std::chrono::microseconds>(end -
-                                                                      start);
-        ss << " Took " << duration.count() << " us. to visit "
-           << visitor.getVisitedCount() << " documents.";
-        EP_LOG_DEBUG("{}", ss.str());
-    }
+    EP_LOG_DEBUG("{} for bucket '{}' decayed {} vBuckets by {}%",
+                 getDescription(),
+                 engine->getName(),
+                 decayed,
+                 percentage);
 
-    // Delete(reset) visitor and allow to be notified if it finished.
-    if (completed) {
-        prAdapter.reset();
-        notified.store(false);
-    } else {
-        // We have not completed decaying all the items so wake the task back
-        // up
-        wakeUp();
-    }
+    // Allow to be notified again.
+    notified.store(false);
 
     if (engine->getEpStats().isShutdown) {
         return false;
@@ -137,19 +89,6 @@ std::string ItemFreqDecayerTask::getDescription() {
 }
 
 std::chrono::microseconds ItemFreqDecayerTask::maxExpectedDuration() {
-    // ItemFreqDecayerTask processes items in chunks, with each chunk
-    // constrained by a ChunkDuration runtime, so we expect to only take that
-    // long.  However, the ProgressTracker used estimates the time remaining,
-    // so apply some headroom to that figure so we don't get inundated with
-    // spurious "slow tasks" which only just exceed the limit.
-    return getChunkDuration() * 10;
-}
-
-std::chrono::milliseconds ItemFreqDecayerTask::getChunkDuration() const {
-    return std::chrono::milliseconds(
-            engine->getConfiguration().getItemFreqDecayerChunkDuration());
-}
-
-ItemFreqDecayerVisitor& ItemFreqDecayerTask::getItemFreqDecayerVisitor() {
-    return dynamic_cast<ItemFreqDecayerVisitor&>(prAdapter->getHTVisitor());
+    // Only visits the vBuckets (not the documents), so should be quick.
+    return std::chrono::milliseconds(1);
 }
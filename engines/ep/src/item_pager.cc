@@ -38,7 +38,9 @@
 #include <iostream>
 #include <limits>
 #include <list>
+#include <set>
 #include <string>
+#include <unordered_set>
 #include <utility>
 
 #include <phosphor/phosphor.h>
@@ -81,6 +83,10 @@ ItemPager::ItemPager(EventuallyPersistentEngine& e, EPStats& st)
       doEvict(false),
       sleepTime(std::chrono::milliseconds(
               e.getConfiguration().getPagerSleepTimeMs())),
+      sampleSize(e.getConfiguration().getBucketType() == "ephemeral"
+                         ? e.getConfiguration()
+                                   .getEphemeralAutoDeleteSampleSize()
+                         : 0),
       notified(false) {
 }
 
@@ -119,6 +125,8 @@ bool ItemPager::run() {
 
         if (current <= lower) {
             // early exit - no need to run a paging visitor
+            *available = true;
+            evictFromCollectionsOverQuota();
             return true;
         }
 
@@ -136,6 +144,19 @@ bool ItemPager::run() {
             activePendingFilter.addVBucket(vbid);
         }
 
+        if (sampleSize > 0) {
+            // Ephemeral bucket; only active vBuckets can be deleted from
+            const bool reachedLowWatermark =
+                    deleteBySampling(activePendingFilter, size_t(lower));
+            *available = true;
+            if (!reachedLowWatermark) {
+                // Out of time for this run, carry on as soon as possible
+                snooze(0);
+            }
+            evictFromCollectionsOverQuota();
+            return true;
+        }
+
         ssize_t bytesToEvict = current - lower;
 
         const double replicaEvictableMem = getEvictableBytes(replicaFilter);
@@ -184,31 +205,167 @@ bool ItemPager::run() {
         // compute active vbuckets evicition bias factor
         const Configuration& cfg = engine.getConfiguration();
 
-        auto pv = std::make_unique<PagingVisitor>(
-                *kvBucket,
-                stats,
-                EvictionRatios{activeAndPendingEvictionRatio,
-                               replicaEvictionRatio},
-                available,
-                ITEM_PAGER,
-                false,
-                filter,
-                cfg.getItemEvictionAgePercentage(),
-                cfg.getItemEvictionFreqCounterAgeThreshold());
+        auto makeVisitor = [&](const VBucketFilter& vbFilter) {
+            auto pv = std::make_unique<PagingVisitor>(
+                    *kvBucket,
+                    stats,
+                    EvictionRatios{activeAndPendingEvictionRatio,
+                                   replicaEvictionRatio},
+                    available,
+                    ITEM_PAGER,
+                    false,
+                    vbFilter,
+                    cfg.getItemEvictionAgePercentage(),
+                    cfg.getItemEvictionFreqCounterAgeThreshold());
+            pv->setFreqThresholdFromHashTable(
+                    cfg.isItemEvictionFreqThresholdFromHashtable());
+            return pv;
+        };
 
         // p99.99 is ~200ms
         const auto maxExpectedDurationForVisitorTask =
                 std::chrono::milliseconds(200);
 
-        kvBucket->visitAsync(std::move(pv),
-                             "Item pager",
-                             TaskId::ItemPagerVisitor,
-                             maxExpectedDurationForVisitorTask);
+        schedulePagingVisitors(*kvBucket,
+                               filter,
+                               getNumConcurrentVisitors(current, upper),
+                               makeVisitor,
+                               "Item pager",
+                               TaskId::ItemPagerVisitor,
+                               maxExpectedDurationForVisitorTask);
     }
 
+    evictFromCollectionsOverQuota();
+
     return true;
 }
 
+size_t ItemPager::getNumConcurrentVisitors(double current,
+                                           double upper) const {
+    const auto maxVisitors = engine.getConfiguration().getConcurrentPagers();
+    const auto quota = static_cast<double>(stats.getMaxDataSize());
+    if (maxVisitors <= 1 || current <= upper) {
+        return 1;
+    }
+    if (quota <= upper) {
+        return maxVisitors;
+    }
+    // Scale with how far memory usage is between the high watermark and
+    // the quota; any amount over the high watermark uses at least two.
+    const double pressure = std::min(1.0, (current - upper) / (quota - upper));
+    return 1 + size_t(std::ceil((maxVisitors - 1) * pressure));
+}
+
+bool ItemPager::deleteBySampling(const VBucketFilter& filter,
+                                 size_t lowWatermark) {
+    const auto& vbids = filter.getVBSet();
+    if (vbids.empty()) {
+        return true;
+    }
+
+    KVBucket* kvBucket = engine.getKVBucket();
+    const auto deadline =
+            std::chrono::steady_clock::now() + maxExpectedDuration();
+    auto it = vbids.begin();
+    // Number of consecutive vBuckets nothing could be deleted from; once
+    // all of them fail there's nothing left to delete.
+    size_t fruitless = 0;
+    while (stats.getEstimatedTotalMemoryUsed() > lowWatermark) {
+        if (fruitless == vbids.size()) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+
+        auto vb = kvBucket->getVBucket(*it);
+        if (++it == vbids.end()) {
+            it = vbids.begin();
+        }
+        if (vb && deleteSampled(*vb)) {
+            fruitless = 0;
+        } else {
+            ++fruitless;
+        }
+    }
+    return true;
+}
+
+bool ItemPager::deleteSampled(VBucket& vb) {
+    // As PagingVisitor, never touch prepares or temp items
+    auto eligible = [](const StoredValue& v) {
+        return !v.isPending() && !v.isCompleted() && !v.isTempItem() &&
+               !v.isDeleted() && v.isResident();
+    };
+    auto key = vb.ht.sampleLeastFrequentKey(sampleSize, std::rand, eligible);
+    if (!key) {
+        return false;
+    }
+
+    auto readHandle = vb.lockCollections();
+    auto res = vb.ht.findForWrite(*key, WantsDeleted::No);
+    StoredValue* v = res.storedValue;
+    if (!v || !eligible(*v)) {
+        // Changed since it was sampled
+        return false;
+    }
+    return vb.pageOut(readHandle, res.lock, v);
+}
+
+void ItemPager::evictFromCollectionsOverQuota() {
+    KVBucket* kvBucket = engine.getKVBucket();
+    const auto overQuota = kvBucket->updateCollectionsOverMemQuota();
+    if (overQuota.empty()) {
+        return;
+    }
+
+    // Only one PagingVisitor runs at a time; if the bucket-wide eviction is
+    // in progress the collections will be re-checked when it completes.
+    bool inverse = true;
+    if (!(*available).compare_exchange_strong(inverse, false)) {
+        return;
+    }
+
+    // Evict each collection down to below its quota, leaving the same
+    // relative headroom as the bucket low/high watermarks provide.
+    const auto quota = static_cast<double>(kvBucket->getCollectionMemQuota());
+    const auto target = quota * (static_cast<double>(stats.mem_low_wat) /
+                                 static_cast<double>(stats.mem_high_wat));
+    double evictionRatio = 0.0;
+    std::unordered_set<CollectionID> collections;
+    for (const auto& [cid, memUsed] : overQuota) {
+        evictionRatio = std::max(evictionRatio, 1.0 - (target / memUsed));
+        collections.insert(cid);
+    }
+
+    EP_LOG_DEBUG(
+            "{} collection(s) over the {} byte collection memory quota, "
+            "paging out {}% of their items",
+            collections.size(),
+            quota,
+            evictionRatio * 100.0);
+
+    const Configuration& cfg = engine.getConfiguration();
+    auto pv = std::make_unique<PagingVisitor>(
+            *kvBucket,
+            stats,
+            EvictionRatios{evictionRatio,
+                           kvBucket->canEvictFromReplicas() ? evictionRatio
+                                                            : 0.0},
+            available,
+            ITEM_PAGER,
+            false,
+            VBucketFilter(),
+            cfg.getItemEvictionAgePercentage(),
+            cfg.getItemEvictionFreqCounterAgeThreshold());
+    pv->setCollectionFilter(std::move(collections));
+
+    kvBucket->visitAsync(std::move(pv),
+                         "Item pager",
+                         TaskId::ItemPagerVisitor,
+                         std::chrono::milliseconds(200));
+}
+
 void ItemPager::scheduleNow() {
     bool expected = false;
     if (notified.compare_exchange_strong(expected, true)) {
@@ -250,6 +407,62 @@ size_t ItemPager::getEvictableBytes(const VBucketFilter& filter) const {
     return visitor.getTotalEvictableMemory();
 }
 
+std::vector<VBucketFilter> splitVBucketFilter(const VBucketFilter& filter,
+                                              size_t count,
+                                              size_t numVBuckets) {
+    if (count <= 1) {
+        return {filter};
+    }
+
+    std::vector<Vbid> vbids;
+    if (filter.empty()) {
+        for (Vbid::id_type id = 0; id < numVBuckets; ++id) {
+            vbids.emplace_back(id);
+        }
+    } else {
+        vbids.assign(filter.getVBSet().begin(), filter.getVBSet().end());
+    }
+    count = std::min(count, vbids.size());
+    if (count <= 1) {
+        return {filter};
+    }
+
+    std::vector<std::set<Vbid>> parts(count);
+    for (size_t ii = 0; ii < vbids.size(); ++ii) {
+        parts[ii % count].insert(vbids[ii]);
+    }
+    std::vector<VBucketFilter> filters;
+    filters.reserve(count);
+    for (auto& part : parts) {
+        filters.emplace_back(std::move(part));
+    }
+    return filters;
+}
+
+void schedulePagingVisitors(
+        KVBucket& bucket,
+        const VBucketFilter& filter,
+        size_t concurrency,
+        std::function<std::unique_ptr<PagingVisitor>(const VBucketFilter&)>
+                makeVisitor,
+        const char* label,
+        TaskId id,
+        std::chrono::microseconds maxExpectedDuration) {
+    auto filters = splitVBucketFilter(
+            filter, concurrency, bucket.getVBuckets().getSize());
+    std::shared_ptr<std::atomic<size_t>> running;
+    if (filters.size() > 1) {
+        running = std::make_shared<std::atomic<size_t>>(filters.size());
+    }
+    for (const auto& vbFilter : filters) {
+        auto pv = makeVisitor(vbFilter);
+        if (running) {
+            pv->setConcurrentVisitors(running);
+        }
+        bucket.visitAsync(std::move(pv), label, id, maxExpectedDuration);
+    }
+}
+
 ExpiredItemPager::ExpiredItemPager(EventuallyPersistentEngine *e,
                                    EPStats &st, size_t stime,
                                    ssize_t taskTime) :
@@ -303,27 +516,32 @@ bool ExpiredItemPager::run() {
 
         VBucketFilter filter;
         Configuration& cfg = engine->getConfiguration();
-        auto pv = std::make_unique<PagingVisitor>(
-                *kvBucket,
-                stats,
-                EvictionRatios{0.0 /* active&pending */,
-                               0.0 /* replica */}, // evict nothing
-                available,
-                EXPIRY_PAGER,
-                true,
-                filter,
-                cfg.getItemEvictionAgePercentage(),
-                cfg.getItemEvictionFreqCounterAgeThreshold());
+        auto makeVisitor = [&](const VBucketFilter& vbFilter) {
+            return std::make_unique<PagingVisitor>(
+                    *kvBucket,
+                    stats,
+                    EvictionRatios{0.0 /* active&pending */,
+                                   0.0 /* replica */}, // evict nothing
+                    available,
+                    EXPIRY_PAGER,
+                    true,
+                    vbFilter,
+                    cfg.getItemEvictionAgePercentage(),
+                    cfg.getItemEvictionFreqCounterAgeThreshold());
+        };
 
         // p99.99 is ~50ms (same as ItemPager).
         const auto maxExpectedDurationForVisitorTask =
                 std::chrono::milliseconds(50);
 
         // track spawned tasks for shutdown..
-        kvBucket->visitAsync(std::move(pv),
-                             "Expired item remover",
-                             TaskId::ExpiredItemPagerVisitor,
-                             maxExpectedDurationForVisitorTask);
+        schedulePagingVisitors(*kvBucket,
+                               filter,
+                               cfg.getExpiryPagerConcurrency(),
+                               makeVisitor,
+                               "Expired item remover",
+                               TaskId::ExpiredItemPagerVisitor,
+                               maxExpectedDurationForVisitorTask);
     }
     snooze(sleepTime);
     updateExpPagerTime(sleepTime);
@@ -20,11 +20,18 @@
 
 #include <memcached/types.h> // for ssize_t
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 typedef std::pair<int64_t, int64_t> row_range_t;
 
 // Forward declaration.
 class EPStats;
 class EventuallyPersistentEngine;
+class KVBucket;
+class PagingVisitor;
+class VBucket;
 class VBucketFilter;
 
 /**
@@ -101,11 +108,48 @@ private:
      */
     size_t getEvictableBytes(const VBucketFilter& filter) const;
 
+    /**
+     * Get how many PagingVisitors to divide the vBuckets between: one unless
+     * memory usage is above the high watermark, scaling up to
+     * concurrent_pagers as memory usage approaches the bucket quota.
+     */
+    size_t getNumConcurrentVisitors(double current, double upper) const;
+
     /**
      * Reset the phase to the default determined by the bucket type
      */
     void resetPhase();
 
+    /**
+     * Check for collections over the per-collection memory quota and, if
+     * there are any, schedule a PagingVisitor which only evicts items of
+     * those collections.
+     */
+    void evictFromCollectionsOverQuota();
+
+    /**
+     * Ephemeral auto_delete by sampling: repeatedly sample
+     * ephemeral_auto_delete_sample_size StoredValues from the HashTable of
+     * the next vBucket in the filter and delete the least frequently used
+     * one, until memory usage drops to the low watermark.
+     * Unlike the PagingVisitor, this doesn't visit the whole HashTable, so
+     * the cost is proportional to the number of items deleted.
+     *
+     * @param filter the vBuckets to delete from
+     * @param lowWatermark memory usage to stop at
+     * @return false if the time budget of the run was exhausted before
+     *         reaching the low watermark (and the pager should run again),
+     *         true otherwise
+     */
+    bool deleteBySampling(const VBucketFilter& filter, size_t lowWatermark);
+
+    /**
+     * Delete the least frequently used of sampleSize StoredValues sampled
+     * from the given vBucket's HashTable.
+     * @return true if an item was deleted
+     */
+    bool deleteSampled(VBucket& vb);
+
     EventuallyPersistentEngine& engine;
     EPStats& stats;
     std::shared_ptr<std::atomic<bool>> available;
@@ -119,10 +163,38 @@ private:
      */
     std::chrono::duration<double> sleepTime;
 
+    /// Value of ephemeral_auto_delete_sample_size; 0 if the PagingVisitor
+    /// should be used for the bucket.
+    const size_t sampleSize;
+
     /// atomic bool used in the task's run trigger
     std::atomic<bool> notified;
 };
 
+/**
+ * Divide the vBuckets accepted by filter (every one of the numVBuckets if
+ * the filter is empty) round-robin between at most count filters.
+ */
+std::vector<VBucketFilter> splitVBucketFilter(const VBucketFilter& filter,
+                                              size_t count,
+                                              size_t numVBuckets);
+
+/**
+ * Divide the vBuckets accepted by filter between up to concurrency
+ * PagingVisitors created by makeVisitor, each scheduled as a separate task
+ * so they visit concurrently. The visitors share the pager's stateFinalizer,
+ * which is only set once all of them have completed.
+ */
+void schedulePagingVisitors(
+        KVBucket& bucket,
+        const VBucketFilter& filter,
+        size_t concurrency,
+        std::function<std::unique_ptr<PagingVisitor>(const VBucketFilter&)>
+                makeVisitor,
+        const char* label,
+        TaskId id,
+        std::chrono::microseconds maxExpectedDuration);
+
 /**
  * Dispatcher job responsible for purging expired items from
  * memory and disk.
@@ -21,6 +21,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <random>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -29,6 +30,7 @@
 #include <memcached/server_document_iface.h>
 #include <nlohmann/json.hpp>
 #include <phosphor/phosphor.h>
+#include <platform/timeutils.h>
 #include <utilities/logtags.h>
 
 #include "access_scanner.h"
@@ -63,6 +65,7 @@
 #include "statistics/collector.h"
 #include "tasks.h"
 #include "trace_helpers.h"
+#include "value_deduplicator.h"
 #include "vb_count_visitor.h"
 #include "vbucket.h"
 #include "vbucket_bgfetch_item.h"
@@ -106,6 +109,7 @@ public:
             store.getEPEngine()
                     .getArenaMallocClient()
                     .setEstimateUpdateThreshold(stats.getMaxDataSize(), value);
+            stats.setMemUsedMergeThreshold(stats.getMaxDataSize(), value);
         } else {
             EP_LOG_WARN(
                     "StatsValueChangeListener(float) failed to change value "
@@ -146,6 +150,8 @@ public:
             store.getEPEngine().getReplicationThrottle().setCapPercent(value);
         } else if (key.compare("max_ttl") == 0) {
             store.setMaxTtl(value);
+        } else if (key.compare("touch_expiry_tolerance") == 0) {
+            store.setTouchExpiryTolerance(value);
         } else {
             EP_LOG_WARN("Failed to change value for unknown variable, {}", key);
         }
@@ -178,6 +184,8 @@ public:
             store.setBfiltersResidencyThreshold(value);
         } else if (key.compare("dcp_min_compression_ratio") == 0) {
             store.getEPEngine().updateDcpMinCompressionRatio(value);
+        } else if (key.compare("collection_mem_quota_percent") == 0) {
+            store.setCollectionMemQuotaPercent(value);
         }
     }
 
@@ -299,11 +307,21 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
       lastTransTimePerItem(0),
       collectionsManager(std::make_unique<Collections::Manager>()),
       xattrEnabled(true),
-      maxTtl(engine.getConfiguration().getMaxTtl()) {
+      maxTtl(engine.getConfiguration().getMaxTtl()),
+      touchExpiryTolerance(
+              engine.getConfiguration().getTouchExpiryTolerance()),
+      collectionMemQuotaRatio(
+              engine.getConfiguration().getCollectionMemQuotaPercent() /
+              100.0) {
     cachedResidentRatio.activeRatio.store(0);
     cachedResidentRatio.replicaRatio.store(0);
 
     Configuration &config = engine.getConfiguration();
+    if (config.getValueDedupMinSize() > 0) {
+        valueDeduplicator = std::make_shared<ValueDeduplicator>(
+                config.getValueDedupMinSize(), config.getValueDedupMaxValues());
+    }
+
     const auto numShards = engine.workload->getNumShards();
     for (uint16_t i = 0; i < numShards; i++) {
         accessLog.emplace_back(
@@ -377,6 +395,10 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
             "mutation_mem_threshold",
             std::make_unique<EPStoreValueChangeListener>(*this));
 
+    config.addValueChangedListener(
+            "collection_mem_quota_percent",
+            std::make_unique<EPStoreValueChangeListener>(*this));
+
     double backfill_threshold = static_cast<double>
                                       (config.getBackfillMemThreshold()) / 100;
     setBackfillMemoryThreshold(backfill_threshold);
@@ -414,6 +436,10 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
     config.addValueChangedListener(
             "max_ttl", std::make_unique<EPStoreValueChangeListener>(*this));
 
+    config.addValueChangedListener(
+            "touch_expiry_tolerance",
+            std::make_unique<EPStoreValueChangeListener>(*this));
+
     xattrEnabled = config.isXattrEnabled();
 
     // Always create the item pager; but initially disable, leaving scheduling
@@ -448,13 +474,17 @@ bool KVBucket::initialize() {
     durabilityTimeoutTask = std::make_shared<DurabilityTimeoutTask>(
             engine,
             std::chrono::milliseconds(
-                    config.getDurabilityTimeoutTaskInterval()));
+                    config.getDurabilityTimeoutTaskInterval()),
+            config.getDurabilityTimeoutMode() == "event_driven");
     ExecutorPool::get()->schedule(durabilityTimeoutTask);
 
     durabilityCompletionTask =
             std::make_shared<DurabilityCompletionTask>(engine);
     ExecutorPool::get()->schedule(durabilityCompletionTask);
 
+    seqnoWaitersTimeoutTask = std::make_shared<SeqnoWaitersTimeoutTask>(engine);
+    ExecutorPool::get()->schedule(seqnoWaitersTimeoutTask);
+
     ExTask workloadMonitorTask =
             std::make_shared<WorkLoadMonitor>(&engine, false);
     ExecutorPool::get()->schedule(workloadMonitorTask);
@@ -691,9 +721,14 @@ ENGINE_ERROR_CODE KVBucket::set(Item& itm,
         // maybe need to adjust expiry of item
         cHandle.processExpiryTime(itm, getMaxTtl());
 
+        if (isCollectionOverMemQuota(itm.getKey().getCollectionID())) {
+            return collectionMemoryCondition();
+        }
+
         result = vb->set(itm, cookie, engine, predicate, cHandle);
         if (result == ENGINE_SUCCESS) {
             cHandle.incrementOpsStore();
+            recordCollectionAccess(cHandle);
         }
     }
 
@@ -704,6 +739,97 @@ ENGINE_ERROR_CODE KVBucket::set(Item& itm,
     return result;
 }
 
+ENGINE_ERROR_CODE KVBucket::updateInEngine(
+        const DocKey& key,
+        Vbid vbucket,
+        const void* cookie,
+        std::function<ENGINE_ERROR_CODE(
+                VBucket&, const Collections::VB::CachingReadHandle&)> update) {
+    VBucketPtr vb = getVBucket(vbucket);
+    if (!vb) {
+        ++stats.numNotMyVBuckets;
+        return ENGINE_NOT_MY_VBUCKET;
+    }
+
+    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    if (vb->getState() == vbucket_state_dead ||
+        vb->getState() == vbucket_state_replica) {
+        ++stats.numNotMyVBuckets;
+        return ENGINE_NOT_MY_VBUCKET;
+    } else if (vb->getState() == vbucket_state_pending) {
+        if (vb->addPendingOp(cookie)) {
+            return ENGINE_EWOULDBLOCK;
+        }
+    } else if (vb->isTakeoverBackedUp()) {
+        EP_LOG_DEBUG(
+                "({}) Returned TMPFAIL to an update in the engine, because "
+                "takeover is lagging",
+                vb->getId());
+        return ENGINE_TMPFAIL;
+    }
+
+    auto cHandle = vb->lockCollections(key);
+    if (!cHandle.valid()) {
+        engine.setUnknownCollectionErrorContext(cookie,
+                                                cHandle.getManifestUid());
+        return ENGINE_UNKNOWN_COLLECTION;
+    }
+
+    if (isCollectionOverMemQuota(key.getCollectionID())) {
+        return collectionMemoryCondition();
+    }
+
+    auto ret = update(*vb, cHandle);
+    if (ret == ENGINE_SUCCESS) {
+        cHandle.incrementOpsStore();
+        recordCollectionAccess(cHandle);
+    }
+    return ret;
+}
+
+ENGINE_ERROR_CODE KVBucket::arithmetic(const DocKey& key,
+                                       Vbid vbucket,
+                                       bool increment,
+                                       uint64_t delta,
+                                       const void* cookie,
+                                       uint64_t& result,
+                                       uint64_t& cas,
+                                       mutation_descr_t& mutation) {
+    return updateInEngine(
+            key,
+            vbucket,
+            cookie,
+            [&](VBucket& vb,
+                const Collections::VB::CachingReadHandle& cHandle) {
+                return vb.arithmetic(increment,
+                                     delta,
+                                     cookie,
+                                     engine,
+                                     cHandle,
+                                     result,
+                                     cas,
+                                     mutation);
+            });
+}
+
+ENGINE_ERROR_CODE KVBucket::appendPrepend(const DocKey& key,
+                                          Vbid vbucket,
+                                          bool append,
+                                          std::string_view value,
+                                          const void* cookie,
+                                          uint64_t& cas,
+                                          mutation_descr_t& mutation) {
+    return updateInEngine(
+            key,
+            vbucket,
+            cookie,
+            [&](VBucket& vb,
+                const Collections::VB::CachingReadHandle& cHandle) {
+                return vb.appendPrepend(
+                        append, value, cookie, engine, cHandle, cas, mutation);
+            });
+}
+
 ENGINE_ERROR_CODE KVBucket::add(Item &itm, const void *cookie)
 {
     VBucketPtr vb = getVBucket(itm.getVBucketId());
@@ -747,9 +873,15 @@ ENGINE_ERROR_CODE KVBucket::add(Item &itm, const void *cookie)
 
         // maybe need to adjust expiry of item
         cHandle.processExpiryTime(itm, getMaxTtl());
+
+        if (isCollectionOverMemQuota(itm.getKey().getCollectionID())) {
+            return collectionMemoryCondition();
+        }
+
         result = vb->add(itm, cookie, engine, cHandle);
         if (result == ENGINE_SUCCESS) {
             cHandle.incrementOpsStore();
+            recordCollectionAccess(cHandle);
         }
     }
 
@@ -793,9 +925,15 @@ ENGINE_ERROR_CODE KVBucket::replace(Item& itm,
 
         // maybe need to adjust expiry of item
         cHandle.processExpiryTime(itm, getMaxTtl());
+
+        if (isCollectionOverMemQuota(itm.getKey().getCollectionID())) {
+            return collectionMemoryCondition();
+        }
+
         result = vb->replace(itm, cookie, engine, predicate, cHandle);
         if (result == ENGINE_SUCCESS) {
             cHandle.incrementOpsStore();
+            recordCollectionAccess(cHandle);
         }
     }
 
@@ -820,6 +958,34 @@ GetValue KVBucket::getReplica(const DocKey& key,
     return getInternal(key, vbucket, cookie, ForGetReplicaOp::Yes, options);
 }
 
+ENGINE_ERROR_CODE KVBucket::waitForSeqno(const void* cookie,
+                                         Vbid vbucket,
+                                         uint64_t seqno,
+                                         std::chrono::milliseconds timeout) {
+    VBucketPtr vb = getVBucket(vbucket);
+    if (!vb) {
+        ++stats.numNotMyVBuckets;
+        return ENGINE_NOT_MY_VBUCKET;
+    }
+
+    if (uint64_t(vb->getHighSeqno()) >= seqno) {
+        return ENGINE_SUCCESS;
+    }
+    if (timeout.count() == 0) {
+        return ENGINE_TMPFAIL;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    if (!vb->addSeqnoWaiter(cookie, seqno, deadline)) {
+        // Reached since checked above
+        return ENGINE_SUCCESS;
+    }
+    if (seqnoWaitersTimeoutTask) {
+        seqnoWaitersTimeoutTask->addDeadline(vbucket, deadline);
+    }
+    return ENGINE_EWOULDBLOCK;
+}
+
 void KVBucket::releaseRegisteredSyncWrites() {
     for (size_t vbid = 0; vbid < vbMap.size; ++vbid) {
         VBucketPtr vb = vbMap.getBucket(Vbid{gsl::narrow<uint16_t>(vbid)});
@@ -1001,8 +1167,16 @@ ENGINE_ERROR_CODE KVBucket::createVBucket_UNLOCKED(
     if (config.isBfilterEnabled()) {
         // Initialize bloom filters upon vbucket creation during
         // bucket creation and rebalance
-        newvb->createFilter(config.getBfilterKeyCount(),
-                            config.getBfilterFpProb());
+        newvb->createFilter(
+                config.getBfilterKeyCount(),
+                config.getBfilterFpProb(),
+                bloomFilterTypeFromString(config.getBfilterType()));
+    }
+
+    if (config.getXdcrMetaBoundsSize() != 0 &&
+        getItemEvictionPolicy() == EvictionPolicy::Full) {
+        // The vBucket is empty, so the bounds start out valid
+        newvb->createMetaBounds(config.getXdcrMetaBoundsSize());
     }
 
     // The first checkpoint for active vbucket should start with id 2.
@@ -1081,6 +1255,7 @@ ENGINE_ERROR_CODE KVBucket::deleteVBucket(Vbid vbid, const void* c) {
 
         // Drop the VB to begin the delete, the last holder of the VB will
         // unknowingly trigger the destructor which schedules a deletion task.
+        vbucketDropped(vbid);
         vbMap.dropVBucketAndSetupDeferredDeletion(vbid, c);
     }
 
@@ -1128,6 +1303,7 @@ bool KVBucket::resetVBucket_UNLOCKED(LockedVBucketPtr& vb,
         vbucket_state_t vbstate = vb->getState();
 
         // 1) Remove the vb from the map and begin the deferred deletion
+        vbucketDropped(vb->getId());
         vbMap.dropVBucketAndSetupDeferredDeletion(vb->getId(),
                                                   nullptr /*no cookie*/);
 
@@ -1178,28 +1354,55 @@ void KVBucket::snapshotStats() {
 }
 
 void KVBucket::getAggregatedVBucketStats(StatCollector& collector) {
+    const std::chrono::milliseconds ttl{
+            engine.getConfiguration().getVbucketStatsCacheTtlMs()};
+    if (ttl.count() == 0) {
+        auto vbStats = visitAggregatedVBucketStats();
+        appendAggregatedVBucketStats(*vbStats.active,
+                                     *vbStats.replica,
+                                     *vbStats.pending,
+                                     *vbStats.dead,
+                                     collector);
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(aggregatedVBucketStatsMutex);
+    const auto now = std::chrono::steady_clock::now();
+    if (!cachedAggregatedVBucketStats ||
+        now - cachedAggregatedVBucketStats->visited >= ttl) {
+        cachedAggregatedVBucketStats = visitAggregatedVBucketStats();
+    }
+    const auto& vbStats = *cachedAggregatedVBucketStats;
+    appendAggregatedVBucketStats(*vbStats.active,
+                                 *vbStats.replica,
+                                 *vbStats.pending,
+                                 *vbStats.dead,
+                                 collector);
+}
+
+KVBucket::AggregatedVBucketStats KVBucket::visitAggregatedVBucketStats() {
     // Create visitors for each of the four vBucket states, and collect
     // stats for each.
-    auto active = makeVBCountVisitor(vbucket_state_active);
-    auto replica = makeVBCountVisitor(vbucket_state_replica);
-    auto pending = makeVBCountVisitor(vbucket_state_pending);
-    auto dead = makeVBCountVisitor(vbucket_state_dead);
+    AggregatedVBucketStats vbStats;
+    vbStats.active = makeVBCountVisitor(vbucket_state_active);
+    vbStats.replica = makeVBCountVisitor(vbucket_state_replica);
+    vbStats.pending = makeVBCountVisitor(vbucket_state_pending);
+    vbStats.dead = makeVBCountVisitor(vbucket_state_dead);
 
     VBucketCountAggregator aggregator;
-    aggregator.addVisitor(active.get());
-    aggregator.addVisitor(replica.get());
-    aggregator.addVisitor(pending.get());
-    aggregator.addVisitor(dead.get());
+    aggregator.addVisitor(vbStats.active.get());
+    aggregator.addVisitor(vbStats.replica.get());
+    aggregator.addVisitor(vbStats.pending.get());
+    aggregator.addVisitor(vbStats.dead.get());
     visit(aggregator);
+    vbStats.visited = std::chrono::steady_clock::now();
 
-    updateCachedResidentRatio(active->getMemResidentPer(),
-                              replica->getMemResidentPer());
-    engine.getReplicationThrottle().adjustWriteQueueCap(active->getNumItems() +
-                                                        replica->getNumItems() +
-                                                        pending->getNumItems());
-
-    // And finally actually return the stats using the AddStatFn callback.
-    appendAggregatedVBucketStats(*active, *replica, *pending, *dead, collector);
+    updateCachedResidentRatio(vbStats.active->getMemResidentPer(),
+                              vbStats.replica->getMemResidentPer());
+    engine.getReplicationThrottle().adjustWriteQueueCap(
+            vbStats.active->getNumItems() + vbStats.replica->getNumItems() +
+            vbStats.pending->getNumItems());
+    return vbStats;
 }
 
 std::unique_ptr<VBucketCountVisitor> KVBucket::makeVBCountVisitor(
@@ -1466,12 +1669,16 @@ void KVBucket::completeBGFetchMulti(
         Vbid vbId,
         std::vector<bgfetched_item_t>& fetchedItems,
         std::chrono::steady_clock::time_point startTime) {
+    // Notify all of the waiting cookies in one batch once every item has
+    // been completed, so each front-end thread is only woken once.
+    std::map<const void*, ENGINE_ERROR_CODE> toNotify;
     VBucketPtr vb = getVBucket(vbId);
     if (vb) {
         for (const auto& item : fetchedItems) {
             auto& key = item.first;
-            item.second->complete(engine, vb, startTime, key);
+            item.second->complete(engine, vb, startTime, key, toNotify);
         }
+        engine.notifyIOComplete(toNotify);
         EP_LOG_DEBUG(
                 "EP Store completes {} of batched background fetch "
                 "for {} endTime = {}",
@@ -1481,13 +1688,10 @@ void KVBucket::completeBGFetchMulti(
                         std::chrono::steady_clock::now().time_since_epoch())
                         .count());
     } else {
-        std::map<const void*, ENGINE_ERROR_CODE> toNotify;
         for (const auto& item : fetchedItems) {
             item.second->abort(engine, ENGINE_NOT_MY_VBUCKET, toNotify);
         }
-        for (auto& notify : toNotify) {
-            engine.notifyIOComplete(notify.first, notify.second);
-        }
+        engine.notifyIOComplete(toNotify);
         EP_LOG_WARN(
                 "EP Store completes {} of batched background fetch for "
                 "for {} that is already deleted",
@@ -1559,11 +1763,49 @@ GetValue KVBucket::getInternal(const DocKey& key,
 
         if (result.getStatus() != ENGINE_EWOULDBLOCK) {
             cHandle.incrementOpsGet();
+            recordCollectionAccess(cHandle);
         }
         return result;
     }
 }
 
+size_t KVBucket::prefetch(const std::vector<std::pair<Vbid, DocKey>>& keys) {
+    size_t queued = 0;
+    for (const auto& [vbid, key] : keys) {
+        auto vb = getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+
+        folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+        if (vb->getState() != vbucket_state_active) {
+            continue;
+        }
+
+        auto cHandle = vb->lockCollections(key);
+        if (cHandle.valid() && vb->prefetch(cHandle)) {
+            ++queued;
+        }
+    }
+    return queued;
+}
+
+std::optional<uint64_t> KVBucket::getDocumentGeneration(const DocKey& key,
+                                                        Vbid vbucket) {
+    auto vb = getVBucket(vbucket);
+    if (!vb || vb->getState() != vbucket_state_active) {
+        return {};
+    }
+
+    // Collections are dropped without touching the HashTable, so check that
+    // the collection still exists every time
+    auto generation = vb->ht.getGeneration(key);
+    if (!generation || !vb->lockCollections(key).valid()) {
+        return {};
+    }
+    return generation;
+}
+
 GetValue KVBucket::getRandomKey(CollectionID cid, const void* cookie) {
     size_t max = vbMap.getSize();
     const Vbid::id_type start = labs(getRandom()) % max;
@@ -1601,6 +1843,67 @@ GetValue KVBucket::getRandomKey(CollectionID cid, const void* cookie) {
     return GetValue(nullptr, ENGINE_KEY_ENOENT);
 }
 
+ENGINE_ERROR_CODE KVBucket::sampleDocuments(
+        CollectionID cid,
+        size_t count,
+        const void* cookie,
+        std::vector<std::unique_ptr<Item>>& sample) {
+    sample.clear();
+    if (count == 0) {
+        return ENGINE_EINVAL;
+    }
+
+    // Reservoir sampling (Algorithm R) of the eligible documents seen by a
+    // walk of the hash tables from a random start
+    std::mt19937_64 rng(getRandom());
+    const size_t maxSeen = count * SampleOversampling;
+    size_t seen = 0;
+
+    const size_t max = vbMap.getSize();
+    const Vbid::id_type start = labs(getRandom()) % max;
+    Vbid::id_type curr = start;
+    do {
+        VBucketPtr vb = getVBucket(Vbid(curr));
+        if (vb) {
+            folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+            if (vb->getState() == vbucket_state_active) {
+                auto cHandle = vb->lockCollections();
+                if (!cHandle.exists(cid)) {
+                    engine.setUnknownCollectionErrorContext(
+                            cookie, cHandle.getManifestUid());
+                    sample.clear();
+                    return ENGINE_UNKNOWN_COLLECTION;
+                }
+                if (cHandle.getItemCount(cid) != 0) {
+                    const auto vbid = vb->getId();
+                    vb->ht.visitFromRandomBucket(
+                            getRandom(), [&](const StoredValue& v) {
+                                if (v.isTempItem() || v.isDeleted() ||
+                                    !v.isResident() || !v.isCommitted() ||
+                                    v.getKey().getCollectionID() != cid) {
+                                    return true;
+                                }
+                                if (sample.size() < count) {
+                                    sample.push_back(v.toItem(vbid));
+                                } else if (const auto slot =
+                                                   rng() % (seen + 1);
+                                           slot < count) {
+                                    sample[slot] = v.toItem(vbid);
+                                }
+                                return ++seen < maxSeen;
+                            });
+                }
+            }
+        }
+
+        if (++curr == max) {
+            curr = 0;
+        }
+    } while (seen < maxSeen && curr != start);
+
+    return sample.empty() ? ENGINE_KEY_ENOENT : ENGINE_SUCCESS;
+}
+
 ENGINE_ERROR_CODE KVBucket::getMetaData(const DocKey& key,
                                         Vbid vbucket,
                                         const void* cookie,
@@ -1702,6 +2005,138 @@ ENGINE_ERROR_CODE KVBucket::setWithMeta(Item& itm,
     return rv;
 }
 
+ENGINE_ERROR_CODE KVBucket::setWithMetaBatch(
+        Vbid vbid,
+        const std::vector<std::unique_ptr<Item>>& items,
+        std::vector<ENGINE_ERROR_CODE>& results,
+        const void* cookie,
+        PermittedVBStates permittedVBStates,
+        CheckConflicts checkConflicts,
+        GenerateCas genCas) {
+    VBucketPtr vb = getVBucket(vbid);
+    if (!vb) {
+        ++stats.numNotMyVBuckets;
+        return ENGINE_NOT_MY_VBUCKET;
+    }
+
+    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    if (!permittedVBStates.test(vb->getState())) {
+        if (vb->getState() == vbucket_state_pending) {
+            if (vb->addPendingOp(cookie)) {
+                return ENGINE_EWOULDBLOCK;
+            }
+        } else {
+            ++stats.numNotMyVBuckets;
+            return ENGINE_NOT_MY_VBUCKET;
+        }
+    } else if (vb->isTakeoverBackedUp()) {
+        EP_LOG_DEBUG(
+                "({}) Returned TMPFAIL to a setWithMetaBatch op"
+                ", because takeover is lagging",
+                vb->getId());
+        return ENGINE_TMPFAIL;
+    }
+
+    bool stored = false;
+    bool blocked = false;
+    for (size_t ii = 0; ii < items.size(); ++ii) {
+        if (!items[ii]) {
+            continue;
+        }
+        auto& itm = *items[ii];
+        if (!Item::isValidCas(itm.getCas())) {
+            results[ii] = ENGINE_KEY_EEXISTS;
+            continue;
+        }
+
+        auto cHandle = vb->lockCollections(itm.getKey());
+        if (!cHandle.valid()) {
+            results[ii] = ENGINE_UNKNOWN_COLLECTION;
+            continue;
+        }
+        cHandle.processExpiryTime(itm, getMaxTtl());
+        results[ii] = vb->setWithMeta(itm,
+                                      0 /*cas*/,
+                                      nullptr /*seqno*/,
+                                      cookie,
+                                      engine,
+                                      checkConflicts,
+                                      true /*allowExisting*/,
+                                      GenerateBySeqno::Yes,
+                                      genCas,
+                                      cHandle);
+        if (results[ii] == ENGINE_EWOULDBLOCK) {
+            blocked = true;
+            break;
+        }
+        stored |= (results[ii] == ENGINE_SUCCESS);
+    }
+
+    if (stored) {
+        checkAndMaybeFreeMemory();
+    }
+    return blocked ? ENGINE_EWOULDBLOCK : ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE KVBucket::setMulti(Vbid vbid,
+                                     const std::vector<Item*>& items,
+                                     std::vector<ENGINE_ERROR_CODE>& results,
+                                     const void* cookie) {
+    VBucketPtr vb = getVBucket(vbid);
+    if (!vb) {
+        ++stats.numNotMyVBuckets;
+        return ENGINE_NOT_MY_VBUCKET;
+    }
+
+    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    if (vb->getState() == vbucket_state_dead ||
+        vb->getState() == vbucket_state_replica) {
+        ++stats.numNotMyVBuckets;
+        return ENGINE_NOT_MY_VBUCKET;
+    } else if (vb->getState() == vbucket_state_pending) {
+        if (vb->addPendingOp(cookie)) {
+            return ENGINE_EWOULDBLOCK;
+        }
+    } else if (vb->isTakeoverBackedUp()) {
+        EP_LOG_DEBUG(
+                "({}) Returned TMPFAIL to a setMulti op, because "
+                "takeover is lagging",
+                vb->getId());
+        return ENGINE_TMPFAIL;
+    }
+
+    for (size_t ii = 0; ii < items.size(); ++ii) {
+        auto& itm = *items[ii];
+        if (itm.getVBucketId() != vbid) {
+            results[ii] = ENGINE_NOT_MY_VBUCKET;
+            continue;
+        }
+
+        auto cHandle = vb->lockCollections(itm.getKey());
+        if (!cHandle.valid()) {
+            engine.setUnknownCollectionErrorContext(cookie,
+                                                    cHandle.getManifestUid());
+            results[ii] = ENGINE_UNKNOWN_COLLECTION;
+            continue;
+        }
+        cHandle.processExpiryTime(itm, getMaxTtl());
+        if (isCollectionOverMemQuota(itm.getKey().getCollectionID())) {
+            results[ii] = collectionMemoryCondition();
+            continue;
+        }
+
+        results[ii] = vb->set(itm, cookie, engine, {}, cHandle);
+        if (results[ii] == ENGINE_EWOULDBLOCK) {
+            return ENGINE_EWOULDBLOCK;
+        }
+        if (results[ii] == ENGINE_SUCCESS) {
+            cHandle.incrementOpsStore();
+            recordCollectionAccess(cHandle);
+        }
+    }
+    return ENGINE_SUCCESS;
+}
+
 ENGINE_ERROR_CODE KVBucket::prepare(Item& itm, const void* cookie) {
     VBucketPtr vb = getVBucket(itm.getVBucketId());
     if (!vb) {
@@ -1786,11 +2221,13 @@ GetValue KVBucket::getAndUpdateTtl(const DocKey& key,
                 cookie,
                 engine,
                 cHandle.processExpiryTime(exptime, getMaxTtl()),
-                cHandle);
+                cHandle,
+                getTouchExpiryTolerance());
 
         if (result.getStatus() == ENGINE_SUCCESS) {
             cHandle.incrementOpsStore();
             cHandle.incrementOpsGet();
+            recordCollectionAccess(cHandle);
         }
         return result;
     }
@@ -1800,7 +2237,8 @@ GetValue KVBucket::getLocked(const DocKey& key,
                              Vbid vbucket,
                              rel_time_t currentTime,
                              uint32_t lockTimeout,
-                             const void* cookie) {
+                             const void* cookie,
+                             WantsValue wantsValue) {
     auto vb = getVBucket(vbucket);
     if (!vb) {
         ++stats.numNotMyVBuckets;
@@ -1820,10 +2258,11 @@ GetValue KVBucket::getLocked(const DocKey& key,
         return GetValue(NULL, ENGINE_UNKNOWN_COLLECTION);
     }
 
-    auto result =
-            vb->getLocked(currentTime, lockTimeout, cookie, engine, cHandle);
+    auto result = vb->getLocked(
+            currentTime, lockTimeout, cookie, engine, cHandle, wantsValue);
     if (result.getStatus() == ENGINE_SUCCESS) {
         cHandle.incrementOpsGet();
+        recordCollectionAccess(cHandle);
     }
     return result;
 }
@@ -2095,6 +2534,15 @@ bool KVBucket::isMemoryUsageTooHigh() {
     return memoryUsed > (maxSize * backfillMemoryThreshold);
 }
 
+bool KVBucket::isUnderMemoryPressure() const {
+    // As VBucket::hasMemoryForStoredValue() for active vBuckets, excluding
+    // the size of the (not yet created) item
+    auto memoryUsed =
+            static_cast<double>(stats.getEstimatedTotalMemoryUsed());
+    auto maxSize = static_cast<double>(stats.getMaxDataSize());
+    return memoryUsed > (maxSize * VBucket::getMutationMemoryThreshold());
+}
+
 // Trigger memory reduction (ItemPager) if we've exceeded high water
 void KVBucket::checkAndMaybeFreeMemory() {
     if (stats.getEstimatedTotalMemoryUsed() > stats.mem_high_wat) {
@@ -2483,7 +2931,12 @@ TaskStatus KVBucket::rollback(Vbid vbid, uint64_t rollbackSeqno) {
         auto prevHighSeqno =
                 static_cast<uint64_t>(vb->checkpointManager->getHighSeqno());
         if (rollbackSeqno != 0) {
+            const auto start = std::chrono::steady_clock::now();
             RollbackResult result = doRollback(vbid, rollbackSeqno);
+            const auto diskDone = std::chrono::steady_clock::now();
+            stats.rollbackDiskHisto.add(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            diskDone - start));
 
             if (result.success /* not success hence reset vbucket to
                                   avoid data loss */
@@ -2492,9 +2945,30 @@ TaskStatus KVBucket::rollback(Vbid vbid, uint64_t rollbackSeqno) {
                                           instead of deleting everything in it
                                         */) {
                 rollbackUnpersistedItems(*vb, result.highSeqno);
+                const auto unpersistedDone = std::chrono::steady_clock::now();
                 loadPreparedSyncWrites(wlh, *vb);
+                const auto preparesDone = std::chrono::steady_clock::now();
                 vb->postProcessRollback(result, prevHighSeqno);
 
+                const auto toMicros = [](auto duration) {
+                    return std::chrono::duration_cast<
+                            std::chrono::microseconds>(duration);
+                };
+                stats.rollbackUnpersistedHisto.add(
+                        toMicros(unpersistedDone - diskDone));
+                stats.rollbackPreparesHisto.add(
+                        toMicros(preparesDone - unpersistedDone));
+                EP_LOG_INFO(
+                        "{} Rolled back to seqno:{} from:{} in {} (disk:{} "
+                        "unpersisted:{} prepares:{})",
+                        vbid,
+                        result.highSeqno,
+                        prevHighSeqno,
+                        cb::time2text(preparesDone - start),
+                        cb::time2text(diskDone - start),
+                        cb::time2text(unpersistedDone - diskDone),
+                        cb::time2text(preparesDone - unpersistedDone));
+
                 // And update collections post rollback
                 vb->collectionsRolledBack(
                         *vbMap.getShardByVbId(vbid)->getROUnderlying());
@@ -2598,7 +3072,7 @@ std::ostream& operator<<(std::ostream& os, const KVBucket::Position& pos) {
 void KVBucket::notifyFlusher(const Vbid vbid) {
     KVShard* shard = vbMap.getShardByVbId(vbid);
     if (shard) {
-        shard->getFlusher()->notifyFlushEvent(vbid);
+        shard->getFlusher(vbid)->notifyFlushEvent(vbid);
     } else {
         throw std::logic_error("KVBucket::notifyFlusher() : shard null for " +
                                vbid.to_string());
@@ -2693,6 +3167,68 @@ void KVBucket::setMaxTtl(size_t max) {
     maxTtl = max;
 }
 
+std::chrono::seconds KVBucket::getTouchExpiryTolerance() const {
+    return std::chrono::seconds{touchExpiryTolerance.load()};
+}
+
+void KVBucket::setTouchExpiryTolerance(size_t seconds) {
+    touchExpiryTolerance = seconds;
+}
+
+size_t KVBucket::getCollectionMemQuota() const {
+    return static_cast<size_t>(stats.getMaxDataSize() *
+                               collectionMemQuotaRatio.load());
+}
+
+void KVBucket::setCollectionMemQuotaPercent(float percent) {
+    collectionMemQuotaRatio = percent / 100.0;
+}
+
+std::unordered_map<CollectionID, size_t>
+KVBucket::updateCollectionsOverMemQuota() {
+    std::unordered_map<CollectionID, size_t> overQuota;
+    const auto quota = getCollectionMemQuota();
+    if (quota != 0) {
+        for (const auto& [cid, memUsed] : stats.getAllCollectionsMemUsed()) {
+            if (memUsed > quota) {
+                overQuota.emplace(cid, memUsed);
+            }
+        }
+    }
+
+    auto locked = collectionsOverMemQuota.wlock();
+    locked->clear();
+    for (const auto& entry : overQuota) {
+        locked->insert(entry.first);
+    }
+    anyCollectionOverMemQuota = !locked->empty();
+    return overQuota;
+}
+
+bool KVBucket::isCollectionOverMemQuota(CollectionID cid) const {
+    if (!anyCollectionOverMemQuota) {
+        return false;
+    }
+    return collectionsOverMemQuota.rlock()->count(cid) != 0;
+}
+
+void KVBucket::recordCollectionAccess(
+        const Collections::VB::CachingReadHandle& cHandle) const {
+    const auto window =
+            engine.getConfiguration().getCollectionAccessSketchWindow();
+    if (window == 0) {
+        return;
+    }
+    cHandle.recordAccess(std::chrono::seconds(window), ep_current_time());
+}
+
+ENGINE_ERROR_CODE KVBucket::collectionMemoryCondition() {
+    ++stats.tmp_oom_errors;
+    ++stats.tmp_oom_collection_quota_errors;
+    wakeItemPager();
+    return ENGINE_TMPFAIL;
+}
+
 uint16_t KVBucket::getNumOfVBucketsInState(vbucket_state_t state) const {
     return vbMap.getVBStateCount(state);
 }
@@ -2729,6 +3265,31 @@ SyncWriteCompleteCallback KVBucket::makeSyncWriteCompleteCB() {
     };
 }
 
+SyncWriteCompleteBatchCallback KVBucket::makeSyncWriteCompleteBatchCB() {
+    auto& engine = this->engine;
+    return [&engine](const SyncWriteCompletions& toNotify) {
+        for (const auto& [cookie, status] : toNotify) {
+            if (status != ENGINE_SUCCESS) {
+                // See makeSyncWriteCompleteCB()
+                engine.storeEngineSpecific(cookie, nullptr);
+            }
+        }
+        engine.notifyIOComplete(toNotify);
+    };
+}
+
+SyncWriteExpiryCallback KVBucket::makeSyncWriteExpiryCB() {
+    if (engine.getConfiguration().getDurabilityTimeoutMode() !=
+        "event_driven") {
+        return {};
+    }
+    return [this](Vbid vbid, std::chrono::steady_clock::time_point expiry) {
+        if (this->durabilityTimeoutTask) {
+            this->durabilityTimeoutTask->updateNextExpiry(vbid, expiry);
+        }
+    };
+}
+
 SeqnoAckCallback KVBucket::makeSeqnoAckCB() const {
     auto& engine = this->engine;
     return [&engine](Vbid vbid, int64_t seqno) {
@@ -2736,6 +3297,20 @@ SeqnoAckCallback KVBucket::makeSeqnoAckCB() const {
     };
 }
 
+SeqnoWaitersNotifyCallback KVBucket::makeSeqnoWaitersNotifyCB() {
+    auto& engine = this->engine;
+    return [&engine](const std::map<const void*, ENGINE_ERROR_CODE>& toNotify) {
+        for (const auto& [cookie, status] : toNotify) {
+            if (status != ENGINE_SUCCESS) {
+                // The request is not re-executed, so clear its marker of
+                // having waited (see getReplicaCmd()).
+                engine.storeEngineSpecific(cookie, nullptr);
+            }
+        }
+        engine.notifyIOComplete(toNotify);
+    };
+}
+
 KVStoreRWRO KVBucket::takeRWRO(size_t shardId) {
     return vbMap.shards[shardId]->takeRWRO();
 }
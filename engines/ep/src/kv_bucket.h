@@ -25,14 +25,25 @@
 #include "vbucket.h"
 #include "vbucketmap.h"
 
+#include <folly/Synchronized.h>
+
 #include <cstdlib>
 #include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
 
 class DurabilityCompletionTask;
+class DurabilityTimeoutTask;
 class ReplicationThrottle;
+class SeqnoWaitersTimeoutTask;
+class ValueDeduplicator;
 class VBucketCountVisitor;
 namespace Collections {
 class Manager;
+namespace VB {
+class CachingReadHandle;
+}
 }
 
 /**
@@ -118,6 +129,23 @@ public:
                           const void* cookie,
                           cb::StoreIfPredicate predicate = {}) override;
 
+    ENGINE_ERROR_CODE arithmetic(const DocKey& key,
+                                 Vbid vbucket,
+                                 bool increment,
+                                 uint64_t delta,
+                                 const void* cookie,
+                                 uint64_t& result,
+                                 uint64_t& cas,
+                                 mutation_descr_t& mutation) override;
+
+    ENGINE_ERROR_CODE appendPrepend(const DocKey& key,
+                                    Vbid vbucket,
+                                    bool append,
+                                    std::string_view value,
+                                    const void* cookie,
+                                    uint64_t& cas,
+                                    mutation_descr_t& mutation) override;
+
     ENGINE_ERROR_CODE add(Item &item, const void *cookie) override;
 
     ENGINE_ERROR_CODE replace(Item& item,
@@ -129,13 +157,46 @@ public:
                  const void* cookie,
                  get_options_t options) override;
 
+    size_t prefetch(const std::vector<std::pair<Vbid, DocKey>>& keys) override;
+
+    std::optional<uint64_t> getDocumentGeneration(const DocKey& key,
+                                                  Vbid vbucket) override;
+
     GetValue getRandomKey(CollectionID cid, const void* cookie) override;
 
+    ENGINE_ERROR_CODE sampleDocuments(
+            CollectionID cid,
+            size_t count,
+            const void* cookie,
+            std::vector<std::unique_ptr<Item>>& sample) override;
+
+    /**
+     * The sample of sampleDocuments() is drawn from the first (from a random
+     * start) count * SampleOversampling eligible documents
+     */
+    static constexpr size_t SampleOversampling = 10;
+
     GetValue getReplica(const DocKey& key,
                         Vbid vbucket,
                         const void* cookie,
                         get_options_t options) override;
 
+    /**
+     * Check that the given vBucket has received (at least) the given seqno -
+     * the consistency token of a replica read. If not, wait up to `timeout`
+     * for it: the connection is notified once the vBucket has reached the
+     * seqno, or with ENGINE_TMPFAIL at the timeout.
+     *
+     * @return ENGINE_SUCCESS if the seqno has been reached,
+     *         ENGINE_EWOULDBLOCK if waiting for it,
+     *         ENGINE_TMPFAIL if it has not been reached and timeout is zero,
+     *         ENGINE_NOT_MY_VBUCKET if the vBucket doesn't exist
+     */
+    ENGINE_ERROR_CODE waitForSeqno(const void* cookie,
+                                   Vbid vbucket,
+                                   uint64_t seqno,
+                                   std::chrono::milliseconds timeout);
+
     ENGINE_ERROR_CODE getMetaData(const DocKey& key,
                                   Vbid vbucket,
                                   const void* cookie,
@@ -155,6 +216,55 @@ public:
             GenerateCas genCas = GenerateCas::No,
             ExtendedMetaData* emd = nullptr) override;
 
+    /**
+     * Set a batch of items of one vBucket with their meta data (see
+     * setWithMeta(); the items may replace existing documents), checking
+     * the state of the vBucket once for the whole batch.
+     *
+     * The items are set in order. If an item needs its metadata to be
+     * fetched from disk first, the fetch is scheduled and the batch stops
+     * at that item (with the result ENGINE_EWOULDBLOCK), to be resumed from
+     * it once the cookie is notified.
+     *
+     * @param vbid the vBucket of all of the items
+     * @param items the items to set; the null items are skipped
+     * @param results [in,out] the result of each of the items (the results
+     *        of the items after the one the batch stopped at are unchanged)
+     * @param cookie the cookie of the connection setting the items
+     * @param permittedVBStates set of VB states that the target VB can be in
+     * @param checkConflicts set to Yes if conflict resolution must be done
+     * @param genCas whether or not to generate the CAS of the items
+     * @return ENGINE_SUCCESS if all of the items were processed,
+     *         ENGINE_EWOULDBLOCK if the batch must be resumed, or the error
+     *         which applies to all of the items (such as NOT_MY_VBUCKET)
+     */
+    ENGINE_ERROR_CODE setWithMetaBatch(
+            Vbid vbid,
+            const std::vector<std::unique_ptr<Item>>& items,
+            std::vector<ENGINE_ERROR_CODE>& results,
+            const void* cookie,
+            PermittedVBStates permittedVBStates,
+            CheckConflicts checkConflicts,
+            GenerateCas genCas);
+
+    /**
+     * Set a batch of items of the same vBucket, checking the vBucket state
+     * once for the batch.
+     *
+     * @param vbid the vBucket of all of the items
+     * @param items the items to set
+     * @param results [in,out] the result of each of the items (the results
+     *        of the items after the one the batch stopped at are unchanged)
+     * @param cookie the cookie of the connection setting the items
+     * @return ENGINE_SUCCESS if all of the items were processed,
+     *         ENGINE_EWOULDBLOCK if the batch must be resumed, or the error
+     *         which applies to all of the items (such as NOT_MY_VBUCKET)
+     */
+    ENGINE_ERROR_CODE setMulti(Vbid vbid,
+                               const std::vector<Item*>& items,
+                               std::vector<ENGINE_ERROR_CODE>& results,
+                               const void* cookie);
+
     ENGINE_ERROR_CODE prepare(Item& item, const void* cookie);
 
     GetValue getAndUpdateTtl(const DocKey& key,
@@ -382,7 +492,8 @@ public:
                        Vbid vbucket,
                        rel_time_t currentTime,
                        uint32_t lockTimeout,
-                       const void* cookie) override ;
+                       const void* cookie,
+                       WantsValue wantsValue = WantsValue::Yes) override;
 
     ENGINE_ERROR_CODE unlockKey(const DocKey& key,
                                 Vbid vbucket,
@@ -478,7 +589,6 @@ public:
     void wakeUpExpiryPager();
 
     /// Wake up the item pager (if enabled), scheduling it for immediate run.
-    /// Currently this is used only during testing.
     void wakeItemPager();
     void enableItemPager();
     void disableItemPager();
@@ -522,6 +632,13 @@ public:
 
     bool isMemoryUsageTooHigh() override;
 
+    /**
+     * @returns true if mem_used is above the threshold (mutation_mem_threshold
+     *          of the quota) at which front-end mutations are rejected with
+     *          a temporary failure
+     */
+    bool isUnderMemoryPressure() const;
+
     /**
      * Check the status of memory used and maybe begin to free memory if
      * required.
@@ -530,6 +647,15 @@ public:
      */
     void checkAndMaybeFreeMemory();
 
+    /**
+     * Called when a mutation is rejected as its collection is over the
+     * per-collection memory quota. Wakes the ItemPager (which targets
+     * eviction at that collection only, rather than the whole bucket).
+     *
+     * @returns ENGINE_TMPFAIL
+     */
+    ENGINE_ERROR_CODE collectionMemoryCondition();
+
     void addKVStoreStats(const AddStatFn& add_stat,
                          const void* cookie,
                          const std::string& args) override;
@@ -681,12 +807,69 @@ public:
         return *replicationThrottle;
     }
 
+    /// @return the table of values shared between keys (null if disabled)
+    const ValueDeduplicator* getValueDeduplicator() const {
+        return valueDeduplicator.get();
+    }
+
     /// return the buckets maxTtl value
     std::chrono::seconds getMaxTtl() const;
 
     /// set the buckets maxTtl
     void setMaxTtl(size_t max);
 
+    /// @return how much touch/GAT must extend an expiry by to be applied
+    std::chrono::seconds getTouchExpiryTolerance() const;
+
+    void setTouchExpiryTolerance(size_t seconds);
+
+    /**
+     * @returns the memory (in bytes) which any single collection may use, or
+     *          0 if there is no per-collection memory quota.
+     */
+    size_t getCollectionMemQuota() const;
+
+    /// set the per-collection memory quota, as a percentage of max_size
+    void setCollectionMemQuotaPercent(float percent);
+
+    /**
+     * Recompute which collections are over the per-collection memory quota,
+     * using the per-collection memory usage tracked by the HashTable
+     * statistics. Front-end mutations of those collections are failed with
+     * TMPFAIL until the next recompute finds them back under quota.
+     *
+     * @returns the collections which are over quota, and their memory usage
+     */
+    std::unordered_map<CollectionID, size_t> updateCollectionsOverMemQuota();
+
+    /**
+     * @returns true if the given collection was over the per-collection
+     *          memory quota when last recomputed.
+     */
+    bool isCollectionOverMemQuota(CollectionID cid) const;
+
+    /**
+     * Record a front-end access of the handle's key in the distinct keys
+     * sketch of its collection, unless collection_access_sketch_window is 0.
+     */
+    void recordCollectionAccess(
+            const Collections::VB::CachingReadHandle& cHandle) const;
+
+    /**
+     * Check that the vbucket and collection of key accept a front-end
+     * update, then run the given update of the document in the engine (see
+     * arithmetic and appendPrepend).
+     *
+     * @return the status of the checks if they failed, else of update
+     */
+    ENGINE_ERROR_CODE updateInEngine(
+            const DocKey& key,
+            Vbid vbucket,
+            const void* cookie,
+            std::function<ENGINE_ERROR_CODE(
+                    VBucket&, const Collections::VB::CachingReadHandle&)>
+                    update);
+
     /**
      * Set the Bucket Minimum Durability Level to the given level.
      *
@@ -707,6 +890,14 @@ protected:
     bool resetVBucket_UNLOCKED(LockedVBucketPtr& vb,
                                std::unique_lock<std::mutex>& vbset);
 
+    /**
+     * Called under the vbset lock, and with the VBucket locked, when the
+     * VBucket is dropped for deletion (before a VBucket with the same id can
+     * be created).
+     */
+    virtual void vbucketDropped(Vbid vbid) {
+    }
+
     /* Notify flusher of a new seqno being added in the vbucket */
     virtual void notifyFlusher(const Vbid vbid);
 
@@ -737,6 +928,19 @@ protected:
     virtual std::unique_ptr<VBucketCountVisitor> makeVBCountVisitor(
             vbucket_state_t state);
 
+    /// The vBucket stats aggregated by a visit of the vBuckets, by state
+    struct AggregatedVBucketStats {
+        std::unique_ptr<VBucketCountVisitor> active;
+        std::unique_ptr<VBucketCountVisitor> replica;
+        std::unique_ptr<VBucketCountVisitor> pending;
+        std::unique_ptr<VBucketCountVisitor> dead;
+        /// When the vBuckets were visited
+        std::chrono::steady_clock::time_point visited;
+    };
+
+    /// Visit all of the vBuckets, aggregating their stats by state
+    AggregatedVBucketStats visitAggregatedVBucketStats();
+
     /**
      * Helper method used by getAggregatedVBucketStats to output aggregated
      * bucket stats.
@@ -760,12 +964,32 @@ protected:
      */
     SyncWriteCompleteCallback makeSyncWriteCompleteCB();
 
+    /**
+     * Returns the callback function to be invoked when a batch of SyncWrites
+     * have been completed. Used by makeVBucket().
+     */
+    SyncWriteCompleteBatchCallback makeSyncWriteCompleteBatchCB();
+
+    /**
+     * Returns the callback function to be invoked when the next SyncWrite
+     * expiry-time of a vBucket changes, or an empty function if SyncWrite
+     * timeouts are polled (durability_timeout_mode=polling). Used by
+     * makeVBucket().
+     */
+    SyncWriteExpiryCallback makeSyncWriteExpiryCB();
+
     /**
      * Returns the callback function to be invoked at Replica for sending a
      * SeqnoAck to the Active.
      */
     SeqnoAckCallback makeSeqnoAckCB() const;
 
+    /**
+     * Returns the callback function to be invoked to notify the connections
+     * waiting for a vBucket to reach a seqno. Used by makeVBucket().
+     */
+    SeqnoWaitersNotifyCallback makeSeqnoWaitersNotifyCB();
+
     /**
      * Chech if the given level is a valid Bucket Durability Level for this
      * Bucket.
@@ -796,12 +1020,15 @@ protected:
 
     // Responsible for enforcing the Durability Timeout for the SyncWrites
     // tracked in this KVBucket.
-    ExTask durabilityTimeoutTask;
+    std::shared_ptr<DurabilityTimeoutTask> durabilityTimeoutTask;
 
     /// Responsible for completing (commiting or aborting SyncWrites which have
     /// completed in this KVBucket.
     std::shared_ptr<DurabilityCompletionTask> durabilityCompletionTask;
 
+    // Times out the connections waiting for a vBucket to reach a seqno.
+    std::shared_ptr<SeqnoWaitersTimeoutTask> seqnoWaitersTimeoutTask;
+
     /* Vector of mutexes for each vbucket
      * Used by flush operations: flushVB, deleteVB, compactVB, snapshotVB */
     std::vector<std::mutex>       vb_mutexes;
@@ -835,6 +1062,14 @@ protected:
     } cachedResidentRatio;
     size_t statsSnapshotTaskId;
     std::atomic<size_t> lastTransTimePerItem;
+
+    /**
+     * The last visit of getAggregatedVBucketStats(), reused by the requests
+     * within vbucket_stats_cache_ttl_ms of it. The mutex is held for the
+     * visit so that concurrent requests share one visit.
+     */
+    std::mutex aggregatedVBucketStatsMutex;
+    std::optional<AggregatedVBucketStats> cachedAggregatedVBucketStats;
     EvictionPolicy eviction_policy;
 
     std::mutex compactionLock;
@@ -852,8 +1087,30 @@ protected:
     /* Contains info about throttling the replication */
     std::unique_ptr<ReplicationThrottle> replicationThrottle;
 
+    /**
+     * Shares identical values between the keys of every vBucket (see
+     * value_dedup_min_size); null if disabled.
+     */
+    std::shared_ptr<ValueDeduplicator> valueDeduplicator;
+
     std::atomic<size_t> maxTtl;
 
+    /// See touch_expiry_tolerance
+    std::atomic<size_t> touchExpiryTolerance;
+
+    /// Per-collection memory quota, as a fraction of max_size (0 = none).
+    std::atomic<double> collectionMemQuotaRatio;
+
+    /// Collections found over quota by updateCollectionsOverMemQuota().
+    folly::Synchronized<std::unordered_set<CollectionID>>
+            collectionsOverMemQuota;
+
+    /**
+     * True if collectionsOverMemQuota is non-empty; allows the write path to
+     * skip locking collectionsOverMemQuota in the common case.
+     */
+    std::atomic<bool> anyCollectionOverMemQuota{false};
+
     /**
      * Allows us to override the random function.  This is used for testing
      * purposes where we want a constant number as opposed to a random one.
@@ -25,6 +25,7 @@
 #include <folly/SharedMutex.h>
 #include <memcached/engine.h>
 #include <nlohmann/json_fwd.hpp>
+#include <chrono>
 #include <list>
 
 /* Forward declarations */
@@ -125,6 +126,53 @@ public:
                                   const void* cookie,
                                   cb::StoreIfPredicate predicate = {}) = 0;
 
+    /**
+     * Increment or decrement the counter stored in an existing document
+     * under a single hold of its HashBucketLock (see
+     * EngineIface::arithmetic).
+     *
+     * @param key the key of the counter
+     * @param vbucket the vbucket the document belongs to
+     * @param increment true to increment the counter, false to decrement it
+     * @param delta the amount to increment or decrement the counter by
+     * @param cookie the cookie representing the client
+     * @param [out] result the new value of the counter
+     * @param [out] cas the CAS of the document after the update
+     * @param [out] mutation the vbucket uuid and seqno of the update
+     * @return the result of the operation; ENGINE_ENOTSUP if the frontend
+     *         must perform it with a get and CAS store
+     */
+    virtual ENGINE_ERROR_CODE arithmetic(const DocKey& key,
+                                         Vbid vbucket,
+                                         bool increment,
+                                         uint64_t delta,
+                                         const void* cookie,
+                                         uint64_t& result,
+                                         uint64_t& cas,
+                                         mutation_descr_t& mutation) = 0;
+
+    /**
+     * Append or prepend data to the value of an existing document under a
+     * single hold of its HashBucketLock (see EngineIface::appendPrepend).
+     *
+     * @param key the key of the document
+     * @param vbucket the vbucket the document belongs to
+     * @param append true to append the data, false to prepend it
+     * @param value the (uncompressed) data to append or prepend
+     * @param cookie the cookie representing the client
+     * @param [out] cas the CAS of the document after the update
+     * @param [out] mutation the vbucket uuid and seqno of the update
+     * @return the result of the operation; ENGINE_ENOTSUP if the frontend
+     *         must perform it with a get and CAS store
+     */
+    virtual ENGINE_ERROR_CODE appendPrepend(const DocKey& key,
+                                            Vbid vbucket,
+                                            bool append,
+                                            std::string_view value,
+                                            const void* cookie,
+                                            uint64_t& cas,
+                                            mutation_descr_t& mutation) = 0;
+
     /**
      * Add an item in the store.
      * @param item the item to add
@@ -161,6 +209,31 @@ public:
                          const void* cookie,
                          get_options_t options) = 0;
 
+    /**
+     * Queue background fetches for any of the given keys which aren't
+     * resident, as they are about to be requested (see
+     * EngineIface::prefetch). Keys in vbuckets which aren't active are
+     * ignored.
+     *
+     * @param keys the keys to prefetch (and the vbucket they belong to)
+     * @return the number of background fetches queued
+     */
+    virtual size_t prefetch(
+            const std::vector<std::pair<Vbid, DocKey>>& keys) = 0;
+
+    /**
+     * Get the generation of a document (see
+     * EngineIface::getDocumentGeneration).
+     *
+     * @param key the key of the document
+     * @param vbucket the vbucket the document belongs to
+     * @return the generation of the HashTable lock stripe of the key, or an
+     *         empty optional if the vbucket isn't active, the collection
+     *         doesn't exist or the generation isn't available
+     */
+    virtual std::optional<uint64_t> getDocumentGeneration(const DocKey& key,
+                                                          Vbid vbucket) = 0;
+
     /**
      * Retrieve a value randomly from the store.
      *
@@ -170,6 +243,23 @@ public:
      */
     virtual GetValue getRandomKey(CollectionID cid, const void* cookie) = 0;
 
+    /**
+     * Sample documents of a collection at random (reservoir sampling over
+     * the resident documents of a part of the active vbuckets' hash tables).
+     *
+     * @param cid collection to sample
+     * @param count the maximum number of documents to sample
+     * @param cookie the connection cookie
+     * @param[out] sample the documents sampled
+     * @return ENGINE_SUCCESS, ENGINE_KEY_ENOENT if no document was found or
+     *         ENGINE_UNKNOWN_COLLECTION
+     */
+    virtual ENGINE_ERROR_CODE sampleDocuments(
+            CollectionID cid,
+            size_t count,
+            const void* cookie,
+            std::vector<std::unique_ptr<Item>>& sample) = 0;
+
     /**
      * Retrieve a value from a vbucket in replica state.
      *
@@ -447,10 +537,15 @@ public:
      * @param vbid The vbucket being compacted
      * @param c The context for compaction of a DB file
      * @param ck cookie used to notify connection of operation completion
+     * @param delay How long to defer the compaction by. Deferred compactions
+     *        of a vBucket are coalesced; while one is pending a further
+     *        deferred request for the vBucket is satisfied by it.
      */
-    virtual ENGINE_ERROR_CODE scheduleCompaction(Vbid vbid,
-                                                 const CompactionConfig& c,
-                                                 const void* ck) = 0;
+    virtual ENGINE_ERROR_CODE scheduleCompaction(
+            Vbid vbid,
+            const CompactionConfig& c,
+            const void* ck,
+            std::chrono::seconds delay = std::chrono::seconds(0)) = 0;
 
     /**
      * Cancels compaction of a database file
@@ -571,11 +666,19 @@ public:
                                     Vbid vbucket,
                                     Item& diskItem) = 0;
 
+    /**
+     * Lock the given key, returning the locked item.
+     *
+     * @param wantsValue if No the item is returned without its value, and a
+     *        resident key with an evicted value is locked without fetching
+     *        the value from disk
+     */
     virtual GetValue getLocked(const DocKey& key,
                                Vbid vbucket,
                                rel_time_t currentTime,
                                uint32_t lockTimeout,
-                               const void* cookie) = 0;
+                               const void* cookie,
+                               WantsValue wantsValue = WantsValue::Yes) = 0;
 
     virtual ENGINE_ERROR_CODE unlockKey(const DocKey& key,
                                         Vbid vbucket,
@@ -15,10 +15,12 @@
  *   limitations under the License.
  */
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 
 #include "bgfetcher.h"
+#include "bucket_logger.h"
 #include "couch-kvstore/couch-kvstore-config.h"
 #include "ep_bucket.h"
 #include "ep_engine.h"
@@ -83,7 +85,26 @@ KVShard::KVShard(EventuallyPersistentEngine& engine, id_type id)
 }
 
 void KVShard::enablePersistence(EPBucket& ep) {
-    flusher = std::make_unique<Flusher>(&ep, this);
+    // Only KVStores which can flush different vBuckets concurrently get
+    // more than one Flusher.
+    size_t numFlushers = 1;
+    if (rwStore->supportsConcurrentFlush()) {
+        const auto& config = ep.getEPEngine().getConfiguration();
+        numFlushers = config.getMaxFlushersPerShard();
+    }
+    flushers.clear();
+    for (size_t ii = 0; ii < numFlushers; ++ii) {
+        flushers.push_back(std::make_unique<Flusher>(&ep, this, ii));
+    }
+    // Consecutive vBuckets of this shard are initially assigned to successive
+    // Flushers.
+    std::vector<std::atomic<uint16_t>> assignment(vbuckets.size());
+    for (size_t index = 0; index < assignment.size(); ++index) {
+        assignment[index] = gsl::narrow_cast<uint16_t>(index % numFlushers);
+    }
+    vbFlusher.swap(assignment);
+    std::vector<std::atomic<uint64_t>> load(vbuckets.size());
+    vbFlushLoad.swap(load);
     bgFetcher = std::make_unique<BgFetcher>(ep, *this);
 }
 
@@ -92,7 +113,91 @@ void KVShard::enablePersistence(EPBucket& ep) {
 KVShard::~KVShard() = default;
 
 Flusher *KVShard::getFlusher() {
-    return flusher.get();
+    return flushers.empty() ? nullptr : flushers.front().get();
+}
+
+Flusher* KVShard::getFlusher(Vbid id) {
+    if (flushers.empty()) {
+        return nullptr;
+    }
+    const auto index = id.get() / kvConfig->getMaxShards();
+    return flushers[vbFlusher.at(index).load()].get();
+}
+
+void KVShard::recordFlushLoad(Vbid id, size_t numFlushed) {
+    if (vbFlushLoad.empty()) {
+        return;
+    }
+    const auto index = id.get() / kvConfig->getMaxShards();
+    vbFlushLoad.at(index).fetch_add(numFlushed, std::memory_order_relaxed);
+}
+
+size_t KVShard::balanceFlushers() {
+    if (flushers.size() < 2) {
+        return 0;
+    }
+
+    // Load of each Flusher, and the (load, index) of each of its vBuckets
+    // which flushed anything.
+    std::vector<uint64_t> flusherLoad(flushers.size());
+    std::vector<std::vector<std::pair<uint64_t, size_t>>> flusherVbs(
+            flushers.size());
+    for (size_t index = 0; index < vbFlushLoad.size(); ++index) {
+        // Halve the history so the balance follows the recent workload.
+        const auto load = vbFlushLoad[index].load();
+        vbFlushLoad[index].fetch_sub(load - load / 2);
+        if (load == 0) {
+            continue;
+        }
+        const auto flusher = vbFlusher[index].load();
+        flusherLoad[flusher] += load;
+        flusherVbs[flusher].emplace_back(load, index);
+    }
+
+    size_t moved = 0;
+    while (moved < vbFlusher.size()) {
+        const auto hottest = std::distance(
+                flusherLoad.begin(),
+                std::max_element(flusherLoad.begin(), flusherLoad.end()));
+        const auto coolest = std::distance(
+                flusherLoad.begin(),
+                std::min_element(flusherLoad.begin(), flusherLoad.end()));
+        const auto gap = flusherLoad[hottest] - flusherLoad[coolest];
+
+        // Moving a vBucket lowers the load of the hottest Flusher without
+        // making the coolest one hotter than it was only if the vBucket's
+        // load is below the gap between them; the largest such vBucket
+        // evens them out the most.
+        auto& candidates = flusherVbs[hottest];
+        auto best = candidates.end();
+        for (auto it = candidates.begin(); it != candidates.end(); ++it) {
+            if (it->first < gap &&
+                (best == candidates.end() || it->first > best->first)) {
+                best = it;
+            }
+        }
+        if (best == candidates.end()) {
+            break;
+        }
+
+        const auto [load, index] = *best;
+        candidates.erase(best);
+        vbFlusher[index] = gsl::narrow_cast<uint16_t>(coolest);
+        flusherLoad[hottest] -= load;
+        flusherLoad[coolest] += load;
+        flusherVbs[coolest].emplace_back(load, index);
+        ++moved;
+
+        EP_LOG_DEBUG(
+                "KVShard::balanceFlushers: shard:{} moved vb:{} (load:{}) "
+                "from flusher:{} to flusher:{}",
+                getId(),
+                index * kvConfig->getMaxShards() + getId(),
+                load,
+                hottest,
+                coolest);
+    }
+    return moved;
 }
 
 BgFetcher *KVShard::getBgFetcher() {
@@ -44,7 +44,7 @@
  *   |                                 |
  *   | vbuckets: VBucket[] (partitions)|----> [(VBucket),(VBucket)..]
  *   |                                 |
- *   | flusher: Flusher                |
+ *   | flushers: Flusher[]             |
  *   | BGFetcher: bgFetcher            |
  *   |                                 |
  *   | rwUnderlying: KVStore (write)   |----> (CouchKVStore)
@@ -66,6 +66,12 @@
  *     ...
  *     1022            2
  *     1023               3
+ *
+ * If the shard's KVStore supports concurrent flushing then its vBuckets are
+ * further divided between max_flushers_per_shard Flushers - see
+ * KVShard::getFlusher(Vbid). That division starts round-robin and is then
+ * periodically rebalanced by the items each vBucket flushes - see
+ * KVShard::balanceFlushers().
  */
 class BgFetcher;
 class Configuration;
@@ -114,7 +120,48 @@ public:
         f(rwStore.get());
     }
 
+    /// @returns the shard's first Flusher.
     Flusher *getFlusher();
+
+    /**
+     * @returns the Flusher responsible for persisting the given vBucket. Each
+     * vBucket is owned by exactly one Flusher, so at most one flush of a
+     * given vBucket is in-flight at a time.
+     */
+    Flusher* getFlusher(Vbid id);
+
+    size_t getNumFlushers() const {
+        return flushers.size();
+    }
+
+    /**
+     * Records that the given number of items have been flushed for the given
+     * vBucket, the load used by balanceFlushers().
+     */
+    void recordFlushLoad(Vbid id, size_t numFlushed);
+
+    /**
+     * Moves vBuckets from the most loaded of this shard's Flushers to the
+     * least loaded one, for as long as that lowers the load of the most
+     * loaded. The load of each vBucket is the number of items it flushed
+     * (see recordFlushLoad), halved at every call so the balance follows the
+     * recent workload.
+     *
+     * A vBucket may still be queued in its previous Flusher when moved; both
+     * Flushers flushing it is safe as EPBucket::flushVBucket() only flushes
+     * a vBucket once at a time.
+     *
+     * @return the number of vBuckets moved
+     */
+    size_t balanceFlushers();
+
+    template <class UnaryFunction>
+    void forEachFlusher(UnaryFunction f) {
+        for (auto& flusher : flushers) {
+            f(*flusher);
+        }
+    }
+
     BgFetcher *getBgFetcher();
 
     VBucketPtr getBucket(Vbid id) const;
@@ -250,7 +297,15 @@ private:
     std::unique_ptr<KVStore> rwStore;
     std::unique_ptr<KVStore> roStore;
 
-    std::unique_ptr<Flusher> flusher;
+    /// Flushers of this shard; vBuckets are divided between them.
+    std::vector<std::unique_ptr<Flusher>> flushers;
+
+    /**
+     * Index (into flushers) of the Flusher owning each vBucket, and the
+     * (decaying) number of items each vBucket flushed. Indexed like vbuckets.
+     */
+    std::vector<std::atomic<uint16_t>> vbFlusher;
+    std::vector<std::atomic<uint64_t>> vbFlushLoad;
     std::unique_ptr<BgFetcher> bgFetcher;
 
 public:
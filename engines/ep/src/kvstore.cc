@@ -134,15 +134,22 @@ void FileStats::reset() {
     syncTimeHisto.reset();
     readCountHisto.reset();
     writeCountHisto.reset();
+    submittedWriteCountHisto.reset();
     totalBytesRead = 0;
     totalBytesWritten = 0;
+    // mmapMappedBytes is a gauge of the current mappings, so isn't reset.
+    mmapFallbackReads = 0;
+    mmapMajorFaults = 0;
+    scanReadaheadBytes = 0;
+    scanDroppedBytes = 0;
 }
 
 size_t FileStats::getMemFootPrint() const {
     return readTimeHisto.getMemFootPrint() + readSeekHisto.getMemFootPrint() +
            readSizeHisto.getMemFootPrint() + writeTimeHisto.getMemFootPrint() +
            writeSizeHisto.getMemFootPrint() + syncTimeHisto.getMemFootPrint() +
-           readCountHisto.getMemFootPrint() + writeCountHisto.getMemFootPrint();
+           readCountHisto.getMemFootPrint() + writeCountHisto.getMemFootPrint() +
+           submittedWriteCountHisto.getMemFootPrint();
 }
 
 KVStoreStats::KVStoreStats() = default;
@@ -172,6 +179,9 @@ void KVStoreStats::reset() {
     delTimeHisto.reset();
     commitHisto.reset();
     compactHisto.reset();
+    compactCopyHisto.reset();
+    compactCommitHisto.reset();
+    compactSwapHisto.reset();
     saveDocsHisto.reset();
     batchSize.reset();
     snapshotHisto.reset();
@@ -418,6 +428,32 @@ void KVStore::addStats(const AddStatFn& add_stat,
                            st.fsStatsCompaction.totalBytesWritten.load();
     add_prefixed_stat(prefix, "io_total_write_bytes", written, add_stat, c);
 
+    add_prefixed_stat(prefix,
+                      "io_mmap_mapped_bytes",
+                      st.fsStats.mmapMappedBytes,
+                      add_stat,
+                      c);
+    add_prefixed_stat(prefix,
+                      "io_mmap_fallback_reads",
+                      st.fsStats.mmapFallbackReads,
+                      add_stat,
+                      c);
+    add_prefixed_stat(prefix,
+                      "io_mmap_major_faults",
+                      st.fsStats.mmapMajorFaults,
+                      add_stat,
+                      c);
+    add_prefixed_stat(prefix,
+                      "io_scan_readahead_bytes",
+                      st.fsStats.scanReadaheadBytes,
+                      add_stat,
+                      c);
+    add_prefixed_stat(prefix,
+                      "io_scan_dropped_bytes",
+                      st.fsStats.scanDroppedBytes,
+                      add_stat,
+                      c);
+
     if (!isReadOnly()) {
         // Flusher Write Amplification - ratio of bytes written to disk by
         // flusher to "useful" user data written - i.e. doesn't include bytes
@@ -462,6 +498,12 @@ void KVStore::addTimingStats(const AddStatFn& add_stat, const void* c) {
 
     add_prefixed_stat(prefix, "commit", st.commitHisto, add_stat, c);
     add_prefixed_stat(prefix, "compact", st.compactHisto, add_stat, c);
+    add_prefixed_stat(
+            prefix, "compact_copy", st.compactCopyHisto, add_stat, c);
+    add_prefixed_stat(
+            prefix, "compact_commit", st.compactCommitHisto, add_stat, c);
+    add_prefixed_stat(
+            prefix, "compact_swap", st.compactSwapHisto, add_stat, c);
     add_prefixed_stat(prefix, "snapshot", st.snapshotHisto, add_stat, c);
     add_prefixed_stat(prefix, "delete", st.delTimeHisto, add_stat, c);
     add_prefixed_stat(prefix, "save_documents", st.saveDocsHisto, add_stat, c);
@@ -501,6 +543,11 @@ void KVStore::addTimingStats(const AddStatFn& add_stat, const void* c) {
             prefix, "fsReadCount", st.fsStats.readCountHisto, add_stat, c);
     add_prefixed_stat(
             prefix, "fsWriteCount", st.fsStats.writeCountHisto, add_stat, c);
+    add_prefixed_stat(prefix,
+                      "fsSubmittedWriteCount",
+                      st.fsStats.submittedWriteCountHisto,
+                      add_stat,
+                      c);
 }
 
 void KVStore::optimizeWrites(std::vector<queued_item>& items) {
@@ -537,6 +584,16 @@ void KVStore::prepareToCreate(Vbid vbid) {
     prepareToCreateImpl(vbid);
 }
 
+std::optional<vbucket_state> KVStore::exportSnapshot(
+        const KVFileHandle& kvFileHandle, Vbid vbid, const std::string& path) {
+    throw std::runtime_error("Backend does not support exportSnapshot()");
+}
+
+std::optional<vbucket_state> KVStore::importSnapshot(Vbid vbid,
+                                                     const std::string& path) {
+    throw std::runtime_error("Backend does not support importSnapshot()");
+}
+
 void KVStore::resetCachedVBState(Vbid vbid) {
     vbucket_state* state = getVBucketState(vbid);
     if (state) {
@@ -545,13 +602,14 @@ void KVStore::resetCachedVBState(Vbid vbid) {
 }
 
 void KVStore::applySetSystemEvent(const Item& item) {
+    auto& meta = getCollectionsMeta();
     switch (SystemEvent(item.getFlags())) {
     case SystemEvent::Collection: {
-        collectionsMeta.recordCreateCollection(item);
+        meta.recordCreateCollection(item);
         break;
     }
     case SystemEvent::Scope: {
-        collectionsMeta.recordCreateScope(item);
+        meta.recordCreateScope(item);
         break;
     }
     default:
@@ -559,7 +617,7 @@ void KVStore::applySetSystemEvent(const Item& item) {
                 "KVStore::applySetSystemEvent: unknown event:" +
                 std::to_string(item.getFlags()));
     }
-    collectionsMeta.setReadyForCommit();
+    meta.setReadyForCommit();
 }
 
 void KVStore::setSystemEvent(const queued_item item) {
@@ -568,13 +626,14 @@ void KVStore::setSystemEvent(const queued_item item) {
 }
 
 void KVStore::applyDeleteSystemEvent(const Item& item) {
+    auto& meta = getCollectionsMeta();
     switch (SystemEvent(item.getFlags())) {
     case SystemEvent::Collection: {
-        collectionsMeta.recordDropCollection(item);
+        meta.recordDropCollection(item);
         break;
     }
     case SystemEvent::Scope: {
-        collectionsMeta.recordDropScope(item);
+        meta.recordDropScope(item);
         break;
     }
     default:
@@ -582,7 +641,7 @@ void KVStore::applyDeleteSystemEvent(const Item& item) {
                 "KVStore::applyDeleteSystemEvent: unknown event:" +
                 std::to_string(item.getFlags()));
     }
-    collectionsMeta.setReadyForCommit();
+    meta.setReadyForCommit();
 }
 
 void KVStore::delSystemEvent(const queued_item item) {
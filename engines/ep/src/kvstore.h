@@ -30,6 +30,7 @@
 #include <cstring>
 #include <list>
 #include <map>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -99,6 +100,14 @@ struct CompactionStats {
     uint64_t preparesPurged = 0;
     FileInfo pre;
     FileInfo post;
+
+    /// Time spent copying the live data into the new file (by-seqno copy
+    /// and by-id rebuild).
+    std::chrono::microseconds copyDuration{0};
+    /// Time spent updating local documents and committing the new file.
+    std::chrono::microseconds commitDuration{0};
+    /// Time spent switching over to (and reopening) the new file.
+    std::chrono::microseconds swapDuration{0};
 };
 
 struct CompactionConfig {
@@ -133,6 +142,13 @@ struct compaction_ctx {
      */
     std::function<void(compaction_ctx&)> completionCallback;
 
+    /**
+     * If set, called with the size of each write the compaction makes to the
+     * new file before making it; may block to limit the compaction's write
+     * rate.
+     */
+    std::function<void(size_t)> writeThrottle;
+
     /// The SyncRepl HCS, can purge any prepares before the HCS.
     uint64_t highCompletedSeqno = 0;
 };
@@ -357,12 +373,27 @@ struct FileStats {
     Hdr1sfInt32Histogram readCountHisto;
     // Write count per open() / close() pair
     Hdr1sfInt32Histogram writeCountHisto;
+    // Write count per open() / close() pair submitted by couchstore, before
+    // being coalesced (see CoalescingWriteOps)
+    Hdr1sfInt32Histogram submittedWriteCountHisto;
 
     // total bytes read from disk.
     cb::RelaxedAtomic<size_t> totalBytesRead{0};
     // Total bytes written to disk.
     cb::RelaxedAtomic<size_t> totalBytesWritten{0};
 
+    // Bytes of files currently memory mapped for reading (see MmapReadOps).
+    cb::RelaxedAtomic<size_t> mmapMappedBytes{0};
+    // Reads of mapped files which could not be served from the mapping.
+    cb::RelaxedAtomic<size_t> mmapFallbackReads{0};
+    // Major page faults taken while reading mapped files.
+    cb::RelaxedAtomic<size_t> mmapMajorFaults{0};
+
+    // Bytes by-seqno scans advised to be read ahead (see ScanReadaheadOps).
+    cb::RelaxedAtomic<size_t> scanReadaheadBytes{0};
+    // Bytes by-seqno scans advised to be dropped from the page cache.
+    cb::RelaxedAtomic<size_t> scanDroppedBytes{0};
+
     size_t getMemFootPrint() const;
 
     void reset();
@@ -427,6 +458,10 @@ public:
     Hdr1sfMicroSecHistogram commitHisto;
     // Time spent in compaction
     Hdr1sfMicroSecHistogram compactHisto;
+    // Time spent in each phase of compaction (see CompactionStats)
+    Hdr1sfMicroSecHistogram compactCopyHisto;
+    Hdr1sfMicroSecHistogram compactCommitHisto;
+    Hdr1sfMicroSecHistogram compactSwapHisto;
     // Time spent in saving documents to disk
     Hdr1sfMicroSecHistogram saveDocsHisto;
     // Batch size while saving documents
@@ -462,6 +497,9 @@ public:
                writeTimeHisto.getMemFootPrint() +
                writeSizeHisto.getMemFootPrint() +
                delTimeHisto.getMemFootPrint() + compactHisto.getMemFootPrint() +
+               compactCopyHisto.getMemFootPrint() +
+               compactCommitHisto.getMemFootPrint() +
+               compactSwapHisto.getMemFootPrint() +
                snapshotHisto.getMemFootPrint() + commitHisto.getMemFootPrint() +
                saveDocsHisto.getMemFootPrint() + batchSize.getMemFootPrint() +
                getMultiFsReadHisto.getMemFootPrint() +
@@ -497,18 +535,26 @@ public:
 
     enum class ByIdScan : bool { Yes, No };
 
+    /**
+     * Can the KVStore purge a dropped collection by compacting just the
+     * collection's key range (rather than rewriting the whole vBucket)?
+     */
+    enum class EfficientCollectionDrop : bool { Yes, No };
+
     StorageProperties(EfficientVBDump evb,
                       EfficientVBDeletion evd,
                       PersistedDeletion pd,
                       EfficientGet eget,
                       ConcurrentWriteCompact cwc,
-                      ByIdScan byIdScan)
+                      ByIdScan byIdScan,
+                      EfficientCollectionDrop ecd)
         : efficientVBDump(evb),
           efficientVBDeletion(evd),
           persistedDeletions(pd),
           efficientGet(eget),
           concWriteCompact(cwc),
-          byIdScan(byIdScan) {
+          byIdScan(byIdScan),
+          efficientCollectionDrop(ecd) {
     }
 
     /* True if we can efficiently dump a single vbucket */
@@ -541,6 +587,10 @@ public:
         return byIdScan == ByIdScan::Yes;
     }
 
+    bool hasEfficientCollectionDrop() const {
+        return efficientCollectionDrop == EfficientCollectionDrop::Yes;
+    }
+
 private:
     EfficientVBDump efficientVBDump;
     EfficientVBDeletion efficientVBDeletion;
@@ -548,6 +598,7 @@ private:
     EfficientGet efficientGet;
     ConcurrentWriteCompact concWriteCompact;
     ByIdScan byIdScan;
+    EfficientCollectionDrop efficientCollectionDrop;
 };
 
 
@@ -624,7 +675,7 @@ public:
      *
      * @return false if we cannot begin a transaction
      */
-    bool begin(std::unique_ptr<TransactionContext> txCtx);
+    virtual bool begin(std::unique_ptr<TransactionContext> txCtx);
 
     /**
      * Commit a transaction (unless not currently in one).
@@ -683,6 +734,19 @@ public:
         throw std::runtime_error("Backend does not support getMulti()");
     }
 
+    /**
+     * Retrieve multiple documents as getMulti(), for a bulk load (such as
+     * warming up from the access log) where the time to fetch all of them
+     * matters rather than the latency of each. Backends may reorder the
+     * reads by their location on disk and read ahead.
+     *
+     * @param vb vbucket id of a document
+     * @param itms list of items whose documents are going to be retrieved
+     */
+    virtual void getMultiBulk(Vbid vb, vb_bgfetch_queue_t& itms) {
+        getMulti(vb, itms);
+    }
+
     /**
      * Callback for getRange().
      * @param value The fetched value. Note r-value receiver can modify (e.g.
@@ -885,6 +949,40 @@ public:
         return false;
     }
 
+    /**
+     * Does the backend support flushing different vBuckets concurrently, i.e.
+     * may the begin() / set() / del() / commit() sequences of different
+     * vBuckets run at the same time on different threads.
+     */
+    virtual bool supportsConcurrentFlush() const {
+        return false;
+    }
+
+    /// Does the backend support group commit (see beginGroupCommit)
+    virtual bool supportsGroupCommit() const {
+        return false;
+    }
+
+    /**
+     * Begin a group commit. Until endGroupCommit() is called, commit() writes
+     * each flush-batch as normal but may defer making it durable, so that the
+     * durability barriers of several vBucket commits can be issued together.
+     * Only valid if supportsGroupCommit() returns true.
+     */
+    virtual void beginGroupCommit() {
+    }
+
+    /**
+     * End a group commit, making every commit() since beginGroupCommit()
+     * durable.
+     *
+     * @return false if any of the commits could not be made durable, in which
+     *         case all of them must be treated as failed
+     */
+    virtual bool endGroupCommit() {
+        return true;
+    }
+
     /**
      * Create a KVStore seqno range Scan Context with the given options.
      * On success, returns a unique_pointer to the ScanContext. The caller can
@@ -991,6 +1089,46 @@ public:
      */
     virtual std::unique_ptr<KVFileHandle> makeFileHandle(Vbid vbid) = 0;
 
+    /// Does the backend support exportSnapshot / importSnapshot
+    virtual bool supportsSnapshotTransfer() const {
+        return false;
+    }
+
+    /**
+     * Write a self-contained copy of the vBucket, as of the snapshot the
+     * given handle was opened at, to a new file. The file can be installed
+     * on another node with importSnapshot(), moving the vBucket without
+     * backfilling it item by item; mutations after the high seqno of the
+     * snapshot must then be streamed (e.g. by DCP) on top of it.
+     * Only valid if supportsSnapshotTransfer() returns true.
+     *
+     * @param kvFileHandle a handle (see makeFileHandle) into the vBucket
+     * @param vbid the vBucket of the handle
+     * @param path the file to write, replaced if it exists
+     * @return the vbucket_state of the snapshot, or an empty optional if the
+     *         export failed
+     */
+    virtual std::optional<vbucket_state> exportSnapshot(
+            const KVFileHandle& kvFileHandle,
+            Vbid vbid,
+            const std::string& path);
+
+    /**
+     * Install a file written by exportSnapshot() as the data file of the
+     * vBucket, replacing the current one. The file is moved, so it must be
+     * on the same filesystem as the data directory.
+     * The caller must ensure nothing else accesses the vBucket's data file
+     * meanwhile (it must not be flushed, scanned or compacted), e.g. by
+     * installing it before the VBucket object is created.
+     * Only valid if supportsSnapshotTransfer() returns true.
+     *
+     * @return the vbucket_state of the installed file, or an empty optional
+     *         if the file could not be installed (the current data file is
+     *         then left untouched)
+     */
+    virtual std::optional<vbucket_state> importSnapshot(
+            Vbid vbid, const std::string& path);
+
     /**
      * Retrieve the stored item count for the given collection, does not error
      * for collection not found as that's a legitimate state (and returns 0)
@@ -1147,6 +1285,11 @@ protected:
     /// Metadata that the underlying implementation must persist
     Collections::KVStore::CommitMetaData collectionsMeta;
 
+    /// @return the collections metadata of the current flush transaction
+    virtual Collections::KVStore::CommitMetaData& getCollectionsMeta() {
+        return collectionsMeta;
+    }
+
     /**
      * Callback function to be invoked when the underlying KVStore needs to
      * create a compaction context.
@@ -34,7 +34,8 @@ BasicLinkedList::BasicLinkedList(Vbid vbucketId, EPStats& st)
       numDeletedItems(0),
       vbid(vbucketId),
       st(st),
-      pausedPurgePoint(seqList.end()) {
+      pausedPurgePoint(seqList.end()),
+      firstStalePoint(seqList.end()) {
 }
 
 BasicLinkedList::~BasicLinkedList() {
@@ -66,23 +67,28 @@ SequenceList::UpdateStatus BasicLinkedList::updateListElem(
         std::lock_guard<std::mutex>& seqLock,
         std::lock_guard<std::mutex>& writeLock,
         OrderedStoredValue& v) {
-    auto range = rangeLockManager.getLockedRange();
-
-    if (range.contains(v.getBySeqno())) {
+    if (rangeLockManager.isLocked(v.getBySeqno())) {
         /* OSV is in middle of a point-in-time snapshot, hence we cannot
-           move the element to the end of the list. Return a temp failure */
+           move the element to the end of the list. Return a temp failure.
+           Only the seqnos still to be read by a range lock holder are
+           checked, so items between disjoint range locks (or already
+           passed by a backfill) are still updated in place */
         return UpdateStatus::Append;
     }
 
     /* Since there is no other reads or writes happening in this range, we can
        move the item to the end of the list */
     auto it = seqList.iterator_to(v);
-    /* If the list is being updated at 'pausedPurgePoint', then we must save
-       the new 'pausedPurgePoint' */
-    if (pausedPurgePoint == it) {
-        pausedPurgePoint = seqList.erase(it);
-    } else {
-        seqList.erase(it);
+    /* If the list is being updated at 'pausedPurgePoint' (or
+       'firstStalePoint'), then we must save the new 'pausedPurgePoint' */
+    const bool atPausedPurgePoint = (pausedPurgePoint == it);
+    const bool atFirstStalePoint = (firstStalePoint == it);
+    auto next = seqList.erase(it);
+    if (atPausedPurgePoint) {
+        pausedPurgePoint = next;
+    }
+    if (atFirstStalePoint) {
+        firstStalePoint = next;
     }
     seqList.push_back(v);
 
@@ -244,13 +250,28 @@ void BasicLinkedList::markItemStale(std::lock_guard<std::mutex>& listWriteLg,
     st.coreLocal.get()->currentSize.fetch_add(v->metaDataSize());
 
     ++numStaleItems;
-    v->toOrderedStoredValue()->markStale(listWriteLg, newSv);
+    auto* osv = v->toOrderedStoredValue();
+    osv->markStale(listWriteLg, newSv);
+    maybeLowerFirstStalePoint(listWriteLg, seqList.iterator_to(*osv));
+}
+
+void BasicLinkedList::maybeLowerFirstStalePoint(
+        std::lock_guard<std::mutex>& writeLock, OrderedLL::iterator it) {
+    // Only the last item of the list can be without a seqno, so it is never
+    // before any other item.
+    if (firstStalePoint == seqList.end() ||
+        (it->getBySeqno() > 0 &&
+         (firstStalePoint->getBySeqno() <= 0 ||
+          it->getBySeqno() < firstStalePoint->getBySeqno()))) {
+        firstStalePoint = it;
+    }
 }
 
 size_t BasicLinkedList::purgeTombstones(
         seqno_t purgeUpToSeqno,
         Collections::IsDroppedEphemeralCb isDroppedKeyCb,
-        std::function<bool()> shouldPause) {
+        std::function<bool()> shouldPause,
+        PurgeScope scope) {
     // Purge items marked as stale from the seqList.
     //
     // Strategy - we try to ensure that this function does not block
@@ -266,13 +287,19 @@ size_t BasicLinkedList::purgeTombstones(
     // here - the only OSVs we can safely access are ones marked stale as they
     // are no longer in the HashTable (and hence subject to HashTable locks).
     // To check if an item is stale we need to acquire the writeLock
-    // (OSV::stale is guarded by it) for each list item. While this isn't
-    // ideal (that's the same lock needed by front-end operations), we can
-    // release the lock between each element so front-end operations can
-    // have the opportunity to acquire it.
+    // (OSV::stale is guarded by it). That's the same lock needed by front-end
+    // operations, so rather than acquiring it (up to twice) per element we
+    // check and later remove a batch of up to PurgeBatchSize elements per
+    // acquisition, releasing the lock in between so front-end operations have
+    // the opportunity to acquire it.
     //
     // Attempt to acquire the readRangeLock, to block anyone else concurrently
     // reading from the list while we remove elements from it.
+    //
+    // Unless resuming a paused purge, a PurgeScope::StaleOnly purge starts at
+    // firstStalePoint - every item before it has already been visited since
+    // it was last marked stale - so it only walks the part of the list which
+    // changed since the last purge.
 
     // Determine the start and end iterators.
     OrderedLL::iterator startIt;
@@ -287,16 +314,24 @@ size_t BasicLinkedList::purgeTombstones(
 
         // Determine the start
         if (pausedPurgePoint != seqList.end()) {
-            // resume
+            // resume. If the purge can't run now the next one must still
+            // visit the rest of the paused purge, whatever its scope.
             startIt = pausedPurgePoint;
             pausedPurgePoint = seqList.end();
+            maybeLowerFirstStalePoint(writeGuard, startIt);
+        } else if (scope == PurgeScope::StaleOnly) {
+            if (firstStalePoint == seqList.end()) {
+                /* Nothing marked stale since the last purge */
+                return 0;
+            }
+            startIt = firstStalePoint;
         } else {
             startIt = seqList.begin();
         }
 
         startSeqno = startIt->getBySeqno();
 
-        if (startSeqno > purgeUpToSeqno) {
+        if (startSeqno <= 0 || startSeqno > purgeUpToSeqno) {
             /* Nothing to purge */
             return 0;
         }
@@ -311,26 +346,33 @@ size_t BasicLinkedList::purgeTombstones(
             // long-running, return without blocking.
             return 0;
         }
-    }
 
-    if (range.getRange().getBegin() != startSeqno) {
-        // a partial range lock was acquired, but the start had to
-        // be moved forward. Can't efficiently advance the iterator
-        // to the correct item and it would need to be under the write lock -
-        // the items from startIt to the locked seqno are not protected
-        // by the range lock, so we can't iterate through them safely outside
-        // the write lock.
-        EP_LOG_FMT(spdlog::level::level_enum::info,
-                   "{} BasicLinkedList::purgeTombstones tried to lock seqno "
-                   "range [{},{}] "
-                   "but got [{},{}] instead. Start is different - cannot purge "
-                   "right now",
-                   vbid,
-                   range.getRange().getBegin(),
-                   range.getRange().getEnd(),
-                   startSeqno,
-                   purgeUpToSeqno);
-        return 0;
+        if (range.getRange().getBegin() != startSeqno) {
+            // a partial range lock was acquired, but the start had to
+            // be moved forward. Can't efficiently advance the iterator
+            // to the correct item and it would need to be under the write
+            // lock - the items from startIt to the locked seqno are not
+            // protected by the range lock, so we can't iterate through them
+            // safely outside the write lock.
+            EP_LOG_FMT(spdlog::level::level_enum::info,
+                       "{} BasicLinkedList::purgeTombstones tried to lock "
+                       "seqno range [{},{}] "
+                       "but got [{},{}] instead. Start is different - cannot "
+                       "purge right now",
+                       vbid,
+                       range.getRange().getBegin(),
+                       range.getRange().getEnd(),
+                       startSeqno,
+                       purgeUpToSeqno);
+            return 0;
+        }
+
+        // This purge visits every item from startIt onwards (or pauses, or
+        // records where it stopped), so only stale items marked from now on
+        // need to move firstStalePoint.
+        if (firstStalePoint == startIt || startIt == seqList.begin()) {
+            firstStalePoint = seqList.end();
+        }
     }
 
     // purge may have to stop at a lower seqno if the range lock
@@ -347,63 +389,108 @@ size_t BasicLinkedList::purgeTombstones(
     // Iterate across all but the last item in the seqList, looking
     // for stale items. May stop early if the range lock could only
     // cover a section of the seqList (see BasicLinkedList::tryLockSeqnoRange)
+    std::vector<PurgeCandidate> candidates;
+    candidates.reserve(PurgeBatchSize);
+    std::vector<PurgeCandidate> toPurge;
+    toPurge.reserve(PurgeBatchSize);
+
     size_t purgedCount = 0;
-    bool stale;
-    for (auto it = startIt; it != seqList.end();) {
-        if (it->getBySeqno() > lastLockedSeqno) {
-            if (lastLockedSeqno != purgeUpToSeqno) {
-                //  have reached the end of the locked range, but the original
-                //  requested end was higher i.e., the range lock was partial. Pause
-                //  so next time purge is attempted it will resume from here (the
-                //  range lock "blocking" part of the requested seqno range may have
-                //  moved/gone)
-                pausedPurgePoint = it;
+    bool done = false;
+    auto it = startIt;
+    while (!done) {
+        candidates.clear();
+        toPurge.clear();
+
+        // Gather the next batch, checking staleness under a single
+        // acquisition of the writeLock
+        {
+            std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+            while (candidates.size() < PurgeBatchSize) {
+                if (it == seqList.end()) {
+                    done = true;
+                    break;
+                }
+                if (it->getBySeqno() > lastLockedSeqno) {
+                    if (lastLockedSeqno != purgeUpToSeqno) {
+                        // have reached the end of the locked range, but the
+                        // original requested end was higher i.e., the range
+                        // lock was partial. Pause so next time purge is
+                        // attempted it will resume from here (the range lock
+                        // "blocking" part of the requested seqno range may
+                        // have moved/gone)
+                        pausedPurgePoint = it;
+                    } else {
+                        // the last item(s) of the list are left for the next
+                        // purge
+                        maybeLowerFirstStalePoint(writeGuard, it);
+                    }
+                    // reached the end of the locked range, stop
+                    done = true;
+                    break;
+                }
+                if (it->getBySeqno() <= 0) {
+                    /* last item with no valid seqno yet */
+                    maybeLowerFirstStalePoint(writeGuard, it);
+                    done = true;
+                    break;
+                }
+                candidates.push_back({it, it->isStale(writeGuard)});
+                ++it;
             }
-            // reached the end of the locked range, stop
-            break;
         }
 
-        if (it->getBySeqno() <= 0) {
-            /* last item with no valid seqno yet */
-            break;
-        }
-
-        // As we move past the items in the list, increment the begin of
-        // the range lock to reduce the window of creating stale items during
-        // updates
-        if (it->getBySeqno() > startSeqno) {
-            range.updateRangeStart(it->getBySeqno());
-        }
+        // Decide what to purge outside of the writeLock (the dropped-key
+        // callback takes the collections lock)
+        bool droppedPending = false;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            const auto& candidate = candidates[i];
+
+            // As we move past the items in the list, increment the begin of
+            // the range lock to reduce the window of creating stale items
+            // during updates. Stale items are owned by the list so are never
+            // relocated, but a (non-stale) dropped item must stay covered
+            // until it has been removed.
+            if (!droppedPending && candidate.it->getBySeqno() > startSeqno) {
+                range.updateRangeStart(candidate.it->getBySeqno());
+            }
 
-        {
-            std::lock_guard<std::mutex> writeGuard(getListWriteLock());
-            stale = it->isStale(writeGuard);
-        }
+            bool isDropped = false;
+            if (!candidate.stale && isDroppedKeyCb) {
+                isDropped = isDroppedKeyCb(candidate.it->getKey(),
+                                           candidate.it->getBySeqno(),
+                                           candidate.it->isPending());
+            }
 
-        bool isDropped = false;
-        if (!stale && isDroppedKeyCb) {
-            isDropped = isDroppedKeyCb(
-                    it->getKey(), it->getBySeqno(), it->isPending());
-        }
+            // Only stale or dropped items are purged.
+            if (candidate.stale || isDropped) {
+                toPurge.push_back(candidate);
+                droppedPending |= isDropped;
+            }
 
-        // Only stale or dropped items are purged.
-        if (stale || isDropped) {
-            // Checks pass, remove from list and delete.
-            it = purgeListElem(it, stale);
-            ++purgedCount;
-        } else {
-            ++it;
+            if (shouldPause()) {
+                pausedPurgePoint =
+                        (i + 1 < candidates.size()) ? candidates[i + 1].it : it;
+                done = true;
+                break;
+            }
         }
 
-        if (shouldPause()) {
-            pausedPurgePoint = it;
-            break;
-        }
+        // Checks pass, remove from list (under one writeLock acquisition)
+        // and delete.
+        purgeListElems(toPurge);
+        purgedCount += toPurge.size();
     }
 
     return purgedCount;
 }
 
+void BasicLinkedList::requestFullPurge() {
+    std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+    if (!seqList.empty()) {
+        firstStalePoint = seqList.begin();
+    }
+}
+
 void BasicLinkedList::updateNumDeletedItems(bool oldDeleted, bool newDeleted) {
     if (oldDeleted && !newDeleted) {
         --numDeletedItems;
@@ -425,7 +512,6 @@ size_t BasicLinkedList::getStaleMetadataBytes() const {
 }
 
 uint64_t BasicLinkedList::getNumDeletedItems() const {
-    std::lock_guard<std::mutex> lckGd(getListWriteLock());
     return numDeletedItems;
 }
 
@@ -435,12 +521,10 @@ uint64_t BasicLinkedList::getNumItems() const {
 }
 
 uint64_t BasicLinkedList::getHighSeqno() const {
-    std::lock_guard<std::mutex> lckGd(getListWriteLock());
     return highSeqno;
 }
 
 uint64_t BasicLinkedList::getHighestDedupedSeqno() const {
-    std::lock_guard<std::mutex> lckGd(getListWriteLock());
     return highestDedupedSeqno;
 }
 
@@ -449,7 +533,6 @@ seqno_t BasicLinkedList::getHighestPurgedDeletedSeqno() const {
 }
 
 uint64_t BasicLinkedList::getMaxVisibleSeqno() const {
-    std::lock_guard<std::mutex> lg(getListWriteLock());
     return maxVisibleSeqno;
 }
 
@@ -498,34 +581,42 @@ std::ostream& operator <<(std::ostream& os, const BasicLinkedList& ll) {
     return os;
 }
 
-OrderedLL::iterator BasicLinkedList::purgeListElem(OrderedLL::iterator it,
-                                                   bool isStale) {
-    std::unique_ptr<OrderedStoredValue> purged;
-    auto next = it;
+void BasicLinkedList::purgeListElems(const std::vector<PurgeCandidate>& elems) {
+    if (elems.empty()) {
+        return;
+    }
+
     {
         std::lock_guard<std::mutex> lckGd(getListWriteLock());
-        next = seqList.erase(it);
-        purged.reset(&*it);
+        for (const auto& elem : elems) {
+            if (firstStalePoint == elem.it) {
+                firstStalePoint = seqList.erase(elem.it);
+            } else {
+                seqList.erase(elem.it);
+            }
+        }
     }
 
-    if (isStale) {
-        /* Update the stats tracking the memory owned by the list */
-        staleSize.fetch_sub(purged->size());
-        staleMetaDataSize.fetch_sub(purged->metaDataSize());
-        --numStaleItems;
-    }
+    for (const auto& elem : elems) {
+        std::unique_ptr<OrderedStoredValue> purged(&*elem.it);
+        if (elem.stale) {
+            /* Update the stats tracking the memory owned by the list */
+            staleSize.fetch_sub(purged->size());
+            staleMetaDataSize.fetch_sub(purged->metaDataSize());
+            --numStaleItems;
+        }
 
-    st.coreLocal.get()->currentSize.fetch_sub(purged->metaDataSize());
+        st.coreLocal.get()->currentSize.fetch_sub(purged->metaDataSize());
 
-    if (purged->isDeleted()) {
-        --numDeletedItems;
-    }
+        if (purged->isDeleted()) {
+            --numDeletedItems;
+        }
 
-    if (purged->isDeleted() &&
-        purged->getBySeqno() > highestPurgedDeletedSeqno.load()) {
-        highestPurgedDeletedSeqno = purged->getBySeqno();
+        if (purged->isDeleted() &&
+            purged->getBySeqno() > highestPurgedDeletedSeqno.load()) {
+            highestPurgedDeletedSeqno = purged->getBySeqno();
+        }
     }
-    return next;
 }
 
 std::unique_ptr<BasicLinkedList::RangeIteratorLL>
@@ -644,21 +735,24 @@ void BasicLinkedList::RangeIteratorLL::incrOperatorHelper() {
     /* Check if the iterator is pointing to the last element. Increment beyond
        the last element indicates the end of the iteration */
     if (curr() == itrRange.getEnd() - 1) {
-        /* We reset the range lock here so that any iterator client that
-         * does not delete the iterator obj will not end up holding the list
-         * range lock forever */
-        rangeGuard.reset();
-        auto severity = isBackfill ? spdlog::level::level_enum::info
-                                   : spdlog::level::level_enum::debug;
-        EP_LOG_FMT(severity, "{} Releasing the range iterator", list.vbid);
-
-        /* Update the begin to end() so the client can see that the iteration
-           has ended */
-        itrRange.setBegin(end());
+        finish();
         return;
     }
 
-    ++currIt;
+    if (truncated) {
+        /* The elements after the truncated range are not protected by the
+           range lock and may be relocated concurrently; check (under the
+           writeLock) if the next element is still within our range */
+        std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
+        auto next = std::next(currIt);
+        if (next == list.seqList.end() || next->getBySeqno() > back()) {
+            finish();
+            return;
+        }
+        currIt = next;
+    } else {
+        ++currIt;
+    }
 
     /* As the iterator moves we reduce the snapshot range being read on the
        linked list. This helps reduce the stale items in the list during
@@ -669,6 +763,50 @@ void BasicLinkedList::RangeIteratorLL::incrOperatorHelper() {
     itrRange.setBegin(currIt->getBySeqno());
 }
 
+void BasicLinkedList::RangeIteratorLL::finish() {
+    /* We reset the range lock here so that any iterator client that
+     * does not delete the iterator obj will not end up holding the list
+     * range lock forever */
+    rangeGuard.reset();
+    auto severity = isBackfill ? spdlog::level::level_enum::info
+                               : spdlog::level::level_enum::debug;
+    EP_LOG_FMT(severity, "{} Releasing the range iterator", list.vbid);
+
+    /* Update the begin to end() so the client can see that the iteration
+       has ended */
+    itrRange.setBegin(end());
+}
+
+void BasicLinkedList::RangeIteratorLL::truncate(seqno_t lastSeqno) {
+    if (curr() == end() || lastSeqno >= back()) {
+        /* Nothing left to read, or nothing to release */
+        return;
+    }
+
+    if (lastSeqno < curr()) {
+        /* Nothing left to read in the truncated range */
+        itrRange.setEnd(curr());
+        numRemaining = 0;
+        rangeGuard.reset();
+        auto severity = isBackfill ? spdlog::level::level_enum::info
+                                   : spdlog::level::level_enum::debug;
+        EP_LOG_FMT(severity, "{} Releasing the range iterator", list.vbid);
+        return;
+    }
+
+    rangeGuard.updateRangeEnd(lastSeqno);
+    itrRange.setEnd(lastSeqno + 1);
+    truncated = true;
+
+    auto severity = isBackfill ? spdlog::level::level_enum::info
+                               : spdlog::level::level_enum::debug;
+    EP_LOG_FMT(severity,
+               "{} Truncated range iterator to {} to {}",
+               list.vbid,
+               itrRange.getBegin(),
+               itrRange.getEnd());
+}
+
 bool BasicLinkedList::RangeIteratorLL::itrRangeContainsAnUpdatedVersion() {
     /* Check if this OSV has been made stale and has been superseded by a
        newer version. If it has, and the replacement is /also/ in the range
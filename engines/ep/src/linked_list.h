@@ -117,8 +117,10 @@ public:
             seqno_t purgeUpToSeqno,
             Collections::IsDroppedEphemeralCb isDroppedKeyCb =
                     [](const DocKey, int64_t, bool) { return false; },
-            std::function<bool()> shouldPause =
-                    []() { return false; }) override;
+            std::function<bool()> shouldPause = []() { return false; },
+            PurgeScope scope = PurgeScope::All) override;
+
+    void requestFullPurge() override;
 
     void updateNumDeletedItems(bool oldDeleted, bool newDeleted) override;
 
@@ -223,7 +225,31 @@ protected:
     cb::RelaxedAtomic<size_t> staleMetaDataSize;
 
 private:
-    OrderedLL::iterator purgeListElem(OrderedLL::iterator it, bool isStale);
+    /// An element the tombstone purger has checked while holding the
+    /// writeLock, and whether it was stale at the time.
+    struct PurgeCandidate {
+        OrderedLL::iterator it;
+        bool stale;
+    };
+
+    /**
+     * Number of elements the tombstone purger checks (and removes) per
+     * acquisition of the writeLock.
+     */
+    static constexpr size_t PurgeBatchSize = 64;
+
+    /**
+     * Removes the given elements from the list under a single acquisition of
+     * the writeLock, then deletes them and updates the stats.
+     */
+    void purgeListElems(const std::vector<PurgeCandidate>& elems);
+
+    /**
+     * Lowers firstStalePoint to 'it' if 'it' has a lower seqno (or
+     * firstStalePoint is unset).
+     */
+    void maybeLowerFirstStalePoint(std::lock_guard<std::mutex>& writeLock,
+                                   OrderedLL::iterator it);
 
     /**
      * We need to keep track of the highest seqno separately because there is a
@@ -233,17 +259,20 @@ private:
      * highseqno is monotonically increasing and is reset to a lower value
      * only in case of a rollback.
      *
-     * Guarded by writeLock.
+     * Written under writeLock; atomic so that stats and other lone readers
+     * don't need to contend on the writeLock with front-end appends.
      */
-    Monotonic<seqno_t> highSeqno;
+    AtomicMonotonic<seqno_t> highSeqno;
 
     /**
      * We need to this to send out point-in-time snapshots in range read
      *
      * highestDedupedSeqno is monotonically increasing and is reset to a lower
      * value only in case of a rollback.
+     *
+     * Written under writeLock, atomic as highSeqno.
      */
-    Monotonic<seqno_t> highestDedupedSeqno;
+    AtomicMonotonic<seqno_t> highestDedupedSeqno;
 
     /**
      * The sequence number of the highest purged element.
@@ -259,7 +288,7 @@ private:
      * Sent into the SnapshotMarker for backfill-snapshots. This is the seqno
      * of the last item sent in backfill-snapshots to non-SyncRepl consumers.
      */
-    Monotonic<uint64_t> maxVisibleSeqno{0};
+    AtomicMonotonic<uint64_t> maxVisibleSeqno{0};
 
     /**
      * Indicates the number of elements in the list that are stale (old,
@@ -285,6 +314,14 @@ private:
     /* Point at which the tombstone purging was paused */
     OrderedLL::iterator pausedPurgePoint;
 
+    /**
+     * Point at or before the lowest seqno stale item not yet visited by a
+     * purge; end() if there is no such item. Lets a PurgeScope::StaleOnly
+     * purge start here instead of at the beginning of the list.
+     * Guarded by writeLock.
+     */
+    OrderedLL::iterator firstStalePoint;
+
     friend std::ostream& operator<<(std::ostream& os,
                                     const BasicLinkedList& ll);
 
@@ -339,6 +376,8 @@ private:
             return maxVisibleSeqno;
         }
 
+        void truncate(seqno_t lastSeqno) override;
+
     private:
         /* We have a private constructor because we want to create the iterator
            optionally, that is, only when it is possible to get a read lock */
@@ -362,6 +401,12 @@ private:
          */
         void incrOperatorHelper();
 
+        /**
+         * Release the range lock and move the iterator to end(), as there
+         * are no more items to be read.
+         */
+        void finish();
+
         /**
          * Indicates if there is a newer version of the curr item in the
          * iterator range
@@ -398,6 +443,12 @@ private:
         /* Indicates if the range iterator is for DCP backfill
            (for debug) */
         bool isBackfill;
+
+        /* Set once the range has been truncated to end before the last
+           element of the list; the iterator must then check the seqno of the
+           next element (which is outside of the range lock) under the list
+           writeLock before moving to it */
+        bool truncated = false;
     };
 
     friend class RangeIteratorLL;
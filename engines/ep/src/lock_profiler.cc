@@ -0,0 +1,126 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "lock_profiler.h"
+
+#include <statistics/collector.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static const char* getLockName(LockProfiler::Lock lock) {
+    switch (lock) {
+    case LockProfiler::Lock::HashTableBucket:
+        return "hash_table_bucket";
+    case LockProfiler::Lock::CheckpointQueue:
+        return "checkpoint_queue";
+    case LockProfiler::Lock::Count:
+        break;
+    }
+    return "unknown";
+}
+
+void LockProfiler::recordWait(Profile& profile,
+                              const char* site,
+                              std::chrono::steady_clock::duration wait) {
+    const auto waitTime =
+            std::chrono::duration_cast<std::chrono::microseconds>(wait);
+    profile.contended++;
+    profile.waitHisto.add(waitTime);
+
+    // The sites are string literals, so are identified by their address.
+    // Claim the first free entry the first time a site is seen (entries are
+    // never released other than by reset()).
+    auto* entry = &profile.otherSites;
+    for (auto& candidate : profile.sites) {
+        const char* name = candidate.name.load(std::memory_order_acquire);
+        if (name == nullptr &&
+            candidate.name.compare_exchange_strong(name, site)) {
+            name = site;
+        }
+        if (name == site) {
+            entry = &candidate;
+            break;
+        }
+    }
+    entry->contended++;
+    entry->waitTime += waitTime.count();
+}
+
+void LockProfiler::addStats(const AddStatFn& add_stat,
+                            const void* cookie) const {
+    add_casted_stat("lock_profiler_enabled", isEnabled(), add_stat, cookie);
+    for (size_t ii = 0; ii < profiles.size(); ++ii) {
+        const auto& profile = profiles[ii];
+        const std::string lock = getLockName(Lock(ii));
+        add_prefixed_stat(lock,
+                          "acquisitions",
+                          profile.acquisitions.load(),
+                          add_stat,
+                          cookie);
+        add_prefixed_stat(
+                lock, "contended", profile.contended.load(), add_stat, cookie);
+        add_prefixed_stat(lock, "wait", profile.waitHisto, add_stat, cookie);
+        add_prefixed_stat(lock, "hold", profile.holdHisto, add_stat, cookie);
+
+        // The call sites, most waited for first
+        std::vector<std::pair<const char*, const Site*>> sites;
+        for (const auto& site : profile.sites) {
+            const char* name = site.name.load(std::memory_order_acquire);
+            if (name && site.contended != 0) {
+                sites.emplace_back(name, &site);
+            }
+        }
+        if (profile.otherSites.contended != 0) {
+            sites.emplace_back("other", &profile.otherSites);
+        }
+        std::sort(sites.begin(), sites.end(), [](const auto& a, const auto& b) {
+            return a.second->waitTime > b.second->waitTime;
+        });
+        for (const auto& [name, site] : sites) {
+            const auto prefix = lock + ":site:" + name;
+            add_prefixed_stat(prefix,
+                              "contended",
+                              site->contended.load(),
+                              add_stat,
+                              cookie);
+            add_prefixed_stat(prefix,
+                              "wait_time_us",
+                              site->waitTime.load(),
+                              add_stat,
+                              cookie);
+        }
+    }
+}
+
+void LockProfiler::reset() {
+    for (auto& profile : profiles) {
+        profile.acquisitions = 0;
+        profile.contended = 0;
+        profile.waitHisto.reset();
+        profile.holdHisto.reset();
+        // Leave the names in place, the threads racing with the reset would
+        // otherwise claim a second entry for the same site
+        for (auto& site : profile.sites) {
+            site.contended = 0;
+            site.waitTime = 0;
+        }
+        profile.otherSites.contended = 0;
+        profile.otherSites.waitTime = 0;
+    }
+}
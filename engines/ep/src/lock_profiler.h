@@ -0,0 +1,173 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "hdrhistogram.h"
+
+#include <memcached/engine_common.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+/*
+ * The name of the function calling the function this is the default argument
+ * of, used to record where a profiled lock was acquired from.
+ */
+#if defined(__GNUC__) || defined(__clang__) || \
+        (defined(_MSC_VER) && _MSC_VER >= 1926)
+#define LOCK_PROFILER_CALLER __builtin_FUNCTION()
+#else
+#define LOCK_PROFILER_CALLER "unknown"
+#endif
+
+/**
+ * Opt-in profiler of the contention on the major mutexes of a bucket
+ * (enabled with the "lock_profiler_enabled" configuration parameter, and
+ * reported by the "lock-profile" stat group).
+ *
+ * While enabled, every acquisition of a profiled lock records how long the
+ * lock was held, and every contended acquisition (one which had to wait for
+ * another thread to release the lock) records how long it waited and the
+ * function the lock was acquired from. While disabled, acquiring a profiled
+ * lock only costs an additional (relaxed) load of the enabled flag.
+ */
+class LockProfiler {
+public:
+    /// The profiled locks
+    enum class Lock {
+        /// The HashTable bucket (stripe) locks
+        HashTableBucket,
+        /// CheckpointManager::queueLock
+        CheckpointQueue,
+        Count
+    };
+
+    /// The number of call sites recorded per lock; any further contended
+    /// call sites are accounted in a single "other" entry.
+    static const size_t MaxSites = 32;
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void setEnabled(bool value) {
+        enabled.store(value);
+    }
+
+    /**
+     * Acquire the given mutex, recording the wait (and the call site) if
+     * it is contended.
+     *
+     * @returns the mutex, to be adopted by the lock holder
+     */
+    template <class Mutex>
+    Mutex& lock(Mutex& mutex, Lock lock, const char* site) {
+        if (!isEnabled()) {
+            mutex.lock();
+            return mutex;
+        }
+        auto& profile = profiles[size_t(lock)];
+        profile.acquisitions++;
+        if (mutex.try_lock()) {
+            return mutex;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        mutex.lock();
+        recordWait(profile, site, std::chrono::steady_clock::now() - start);
+        return mutex;
+    }
+
+    /**
+     * @returns the time a lock is acquired at to pass to endHold() when it
+     * is released (the epoch if the profiler is disabled)
+     */
+    std::chrono::steady_clock::time_point startHold() const {
+        return isEnabled() ? std::chrono::steady_clock::now()
+                           : std::chrono::steady_clock::time_point{};
+    }
+
+    /// Record the time the lock was held for (if it was acquired profiled)
+    void endHold(Lock lock, std::chrono::steady_clock::time_point acquired) {
+        if (acquired != std::chrono::steady_clock::time_point{}) {
+            profiles[size_t(lock)].holdHisto.add(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - acquired));
+        }
+    }
+
+    void addStats(const AddStatFn& add_stat, const void* cookie) const;
+
+    void reset();
+
+private:
+    /// A place the lock was acquired from while contended
+    struct Site {
+        /// The name of the function (a string literal; nullptr if unused)
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> contended{0};
+        std::atomic<uint64_t> waitTime{0};
+    };
+
+    struct Profile {
+        std::atomic<uint64_t> acquisitions{0};
+        std::atomic<uint64_t> contended{0};
+        /// The time waited by the contended acquisitions
+        Hdr1sfMicroSecHistogram waitHisto;
+        /// The time the lock was held for by each acquisition
+        Hdr1sfMicroSecHistogram holdHisto;
+        /// The contended call sites, in the order they were first seen
+        std::array<Site, MaxSites> sites;
+        Site otherSites;
+    };
+
+    void recordWait(Profile& profile,
+                    const char* site,
+                    std::chrono::steady_clock::duration wait);
+
+    std::atomic_bool enabled{false};
+    std::array<Profile, size_t(Lock::Count)> profiles;
+};
+
+/**
+ * A LockHolder for a mutex profiled by a LockProfiler. It derives from
+ * LockHolder so it may be passed as the proof the lock is held to the
+ * functions which require it.
+ */
+class ProfiledLockHolder : public std::lock_guard<std::mutex> {
+public:
+    ProfiledLockHolder(std::mutex& mutex,
+                       LockProfiler& profiler,
+                       LockProfiler::Lock lock,
+                       const char* site = LOCK_PROFILER_CALLER)
+        : std::lock_guard<std::mutex>(profiler.lock(mutex, lock, site),
+                                      std::adopt_lock),
+          profiler(profiler),
+          lock(lock),
+          acquired(profiler.startHold()) {
+    }
+
+    ~ProfiledLockHolder() {
+        profiler.endHold(lock, acquired);
+    }
+
+private:
+    LockProfiler& profiler;
+    const LockProfiler::Lock lock;
+    const std::chrono::steady_clock::time_point acquired;
+};
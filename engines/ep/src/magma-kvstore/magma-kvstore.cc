@@ -28,12 +28,15 @@
 #include "vbucket.h"
 #include "vbucket_state.h"
 
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <mcbp/protocol/request.h>
 #include <nlohmann/json.hpp>
 #include <utilities/logtags.h>
 
 #include <string.h>
 #include <algorithm>
+#include <future>
 #include <limits>
 #include <utility>
 #include <mcbp/protocol/unsigned_leb128.h>
@@ -408,6 +411,22 @@ bool MagmaKVStore::compactionCallBack(MagmaKVStore::MagmaCompactionCB& cbCtx,
         }
     }
 
+    if (cbCtx.rebuildBloomFilter && cbCtx.ctx->bloomFilterCallback) {
+        // Magma may visit a key more than once, adding it again is harmless
+        bool deleted = magmakv::isDeleted(metaSlice);
+        auto diskKey = makeDiskDocKey(keySlice);
+        try {
+            cbCtx.ctx->bloomFilterCallback->callback(
+                    vbid, diskKey.getDocKey(), deleted);
+        } catch (std::runtime_error& re) {
+            logger->warn(
+                    "MagmaCompactionCB: {} exception occurred when invoking "
+                    "the bloomfilter callback - Details: {}",
+                    vbid,
+                    re.what());
+        }
+    }
+
     if (logger->should_log(spdlog::level::TRACE)) {
         logger->TRACE("MagmaCompactionCB: {} KEEP {}",
                       vbid,
@@ -531,7 +550,40 @@ MagmaKVStore::MagmaKVStore(MagmaKVStoreConfig& configuration)
     }
 }
 
+struct MagmaKVStore::PipelinedCommit {
+    PipelinedCommit(std::unique_ptr<PendingRequestQueue> reqs,
+                    std::unique_ptr<TransactionContext> transactionCtx,
+                    VB::Commit& commitData)
+        : reqs(std::move(reqs)),
+          transactionCtx(std::move(transactionCtx)),
+          kvctx(commitData) {
+        for (const auto& req : *this->reqs) {
+            bytes += sizeof(MagmaRequest) + req.getRawKeyLen() +
+                     req.getBodySize();
+        }
+    }
+
+    std::unique_ptr<PendingRequestQueue> reqs;
+    std::unique_ptr<TransactionContext> transactionCtx;
+    kvstats_ctx kvctx;
+    /// Memory used by reqs
+    size_t bytes = 0;
+    /// Set by the commit thread to the result of saveDocs()
+    std::promise<int> written;
+};
+
 MagmaKVStore::~MagmaKVStore() {
+    if (commitExecutor) {
+        // Let the writes in flight finish before magma is closed; batches
+        // not completed by endGroupCommit() are dropped with their flushes.
+        commitExecutor->join();
+        if (!pipelinedCommits.empty()) {
+            logger->warn(
+                    "MagmaKVStore::~MagmaKVStore: {} pipelined commits not "
+                    "completed",
+                    pipelinedCommits.size());
+        }
+    }
     if (!inTransaction) {
         magma->Sync(true);
     }
@@ -555,11 +607,30 @@ bool MagmaKVStore::commit(VB::Commit& commitData) {
         return true;
     }
 
+    // The flusher updates the cached vbstate from the proposed one as soon
+    // as commit() returns, so set the highSeqno here rather than once the
+    // batch has been written.
+    int64_t lastSeqno = 0;
+    for (auto& req : *pendingReqs) {
+        if (req.getDocMeta().bySeqno > lastSeqno) {
+            lastSeqno = req.getDocMeta().bySeqno;
+        }
+    }
+    commitData.proposedVBState.highSeqno = lastSeqno;
+
+    if (inGroupCommit && !collectionsMeta.isReadyForCommit()) {
+        submitPipelinedCommit(commitData);
+        return true;
+    }
+
     kvstats_ctx kvctx(commitData);
     bool success = true;
 
     // Flush all documents to disk
-    auto errCode = saveDocs(commitData, kvctx);
+    auto errCode = saveDocs(*pendingReqs,
+                            commitData,
+                            kvctx,
+                            collectionsMeta.isReadyForCommit());
     if (errCode != ENGINE_SUCCESS) {
         logger->warn("MagmaKVStore::commit: saveDocs {} errCode:{}",
                      pendingReqs->front().getVbID(),
@@ -571,7 +642,7 @@ bool MagmaKVStore::commit(VB::Commit& commitData) {
         postFlushHook();
     }
 
-    commitCallback(errCode, kvctx);
+    commitCallback(errCode, *pendingReqs, *transactionCtx);
 
     // This behaviour is to replicate the one in Couchstore.
     // Set `in_transanction = false` only if `commit` is successful.
@@ -586,9 +657,11 @@ bool MagmaKVStore::commit(VB::Commit& commitData) {
     return success;
 }
 
-void MagmaKVStore::commitCallback(int errCode, kvstats_ctx&) {
+void MagmaKVStore::commitCallback(int errCode,
+                                  PendingRequestQueue& reqs,
+                                  TransactionContext& txnCtx) {
     const auto flushSuccess = (errCode == Status::Code::Ok);
-    for (const auto& req : *pendingReqs) {
+    for (const auto& req : reqs) {
         size_t mutationSize =
                 req.getRawKeyLen() + req.getBodySize() + req.getMetaSize();
         st.io_num_write++;
@@ -613,12 +686,12 @@ void MagmaKVStore::commitCallback(int errCode, kvstats_ctx&) {
             logger->TRACE(
                     "MagmaKVStore::commitCallback(Delete) {} key:{} errCode:{} "
                     "deleteState:{}",
-                    pendingReqs->front().getVbID(),
+                    req.getVbID(),
                     cb::UserData(req.getKey().to_string()),
                     errCode,
                     to_string(state));
 
-            transactionCtx->deleteCallback(req.getItem(), state);
+            txnCtx.deleteCallback(req.getItem(), state);
         } else {
             FlushStateMutation state;
             if (flushSuccess) {
@@ -639,16 +712,90 @@ void MagmaKVStore::commitCallback(int errCode, kvstats_ctx&) {
             logger->TRACE(
                     "MagmaKVStore::commitCallback(Set) {} key:{} errCode:{} "
                     "setState:{}",
-                    pendingReqs->front().getVbID(),
+                    req.getVbID(),
                     cb::UserData(req.getKey().to_string()),
                     errCode,
                     to_string(state));
 
-            transactionCtx->setCallback(req.getItem(), state);
+            txnCtx.setCallback(req.getItem(), state);
         }
     }
 }
 
+bool MagmaKVStore::supportsGroupCommit() const {
+    return configuration.getMagmaPipelinedCommit();
+}
+
+void MagmaKVStore::beginGroupCommit() {
+    if (!commitExecutor) {
+        commitExecutor = std::make_unique<folly::CPUThreadPoolExecutor>(
+                1,
+                std::make_shared<folly::NamedThreadFactory>("MagmaCommit"));
+    }
+    inGroupCommit = true;
+}
+
+bool MagmaKVStore::endGroupCommit() {
+    while (!pipelinedCommits.empty()) {
+        completeOldestPipelinedCommit();
+    }
+    inGroupCommit = false;
+    return !std::exchange(pipelinedCommitFailed, false);
+}
+
+void MagmaKVStore::submitPipelinedCommit(VB::Commit& commitData) {
+    auto batch = std::make_unique<PipelinedCommit>(
+            std::move(pendingReqs), std::move(transactionCtx), commitData);
+    pendingReqs = std::make_unique<PendingRequestQueue>();
+    inTransaction = false;
+
+    // There is always room for one batch, however large.
+    while (!pipelinedCommits.empty() &&
+           pipelinedCommitBytes + batch->bytes >
+                   configuration.getMagmaMaxPipelinedBytes()) {
+        completeOldestPipelinedCommit();
+    }
+
+    pipelinedCommitBytes += batch->bytes;
+    auto& toWrite = *batch;
+    pipelinedCommits.push_back(std::move(batch));
+    commitExecutor->add([this, &toWrite]() {
+        // Account the memory magma allocates for the write to the bucket.
+        configuration.magmaCfg.SetupThreadContext();
+        try {
+            toWrite.written.set_value(saveDocs(*toWrite.reqs,
+                                               toWrite.kvctx.commitData,
+                                               toWrite.kvctx,
+                                               false));
+        } catch (...) {
+            toWrite.written.set_exception(std::current_exception());
+        }
+        configuration.magmaCfg.ResetThreadContext();
+    });
+}
+
+void MagmaKVStore::completeOldestPipelinedCommit() {
+    auto batch = std::move(pipelinedCommits.front());
+    pipelinedCommits.pop_front();
+
+    const auto errCode = batch->written.get_future().get();
+    pipelinedCommitBytes -= batch->bytes;
+    if (errCode != ENGINE_SUCCESS) {
+        logger->warn(
+                "MagmaKVStore::completeOldestPipelinedCommit: saveDocs {} "
+                "errCode:{}",
+                batch->reqs->front().getVbID(),
+                errCode);
+        pipelinedCommitFailed = true;
+    }
+
+    if (postFlushHook) {
+        postFlushHook();
+    }
+
+    commitCallback(errCode, *batch->reqs, *batch->transactionCtx);
+}
+
 void MagmaKVStore::rollback() {
     if (inTransaction) {
         inTransaction = false;
@@ -662,7 +809,8 @@ StorageProperties MagmaKVStore::getStorageProperties() {
                          StorageProperties::PersistedDeletion::No,
                          StorageProperties::EfficientGet::Yes,
                          StorageProperties::ConcurrentWriteCompact::Yes,
-                         StorageProperties::ByIdScan::No);
+                         StorageProperties::ByIdScan::No,
+                         StorageProperties::EfficientCollectionDrop::Yes);
     return rv;
 }
 
@@ -1063,10 +1211,13 @@ GetValue MagmaKVStore::makeGetValue(Vbid vb,
                     false);
 }
 
-int MagmaKVStore::saveDocs(VB::Commit& commitData, kvstats_ctx& kvctx) {
+int MagmaKVStore::saveDocs(PendingRequestQueue& reqs,
+                           VB::Commit& commitData,
+                           kvstats_ctx& kvctx,
+                           bool updateCollectionsMeta) {
     uint64_t ninserts = 0;
     uint64_t ndeletes = 0;
-    auto vbid = transactionCtx->vbid;
+    auto vbid = reqs.front().getVbID();
 
     auto writeDocsCB = [this, &commitData, &kvctx, &ninserts, &ndeletes, vbid](
                                const Magma::WriteOperation& op,
@@ -1154,13 +1305,12 @@ int MagmaKVStore::saveDocs(VB::Commit& commitData, kvstats_ctx& kvctx) {
     // and stat updates as WriteOps is non-owning.
     LocalDbReqs localDbReqs;
     MagmaDbStats magmaDbStats;
-    int64_t lastSeqno = 0;
 
     auto postWriteDocsCB = [this,
                             &commitData,
                             &kvctx,
                             &localDbReqs,
-                            &lastSeqno,
+                            updateCollectionsMeta,
                             &vbid,
                             &ninserts,
                             &ndeletes,
@@ -1178,14 +1328,13 @@ int MagmaKVStore::saveDocs(VB::Commit& commitData, kvstats_ctx& kvctx) {
         }
         addStatUpdateToWriteOps(magmaDbStats, postWriteOps);
 
-        auto& vbstate = commitData.proposedVBState;
-        vbstate.highSeqno = lastSeqno;
+        // Write out current vbstate (highSeqno set by commit()) to the
+        // CommitBatch.
+        addVBStateUpdateToLocalDbReqs(localDbReqs,
+                                      commitData.proposedVBState,
+                                      kvstoreRevList[vbid.get()]);
 
-        // Write out current vbstate to the CommitBatch.
-        addVBStateUpdateToLocalDbReqs(
-                localDbReqs, vbstate, kvstoreRevList[vbid.get()]);
-
-        if (collectionsMeta.isReadyForCommit()) {
+        if (updateCollectionsMeta) {
             updateCollectionsMeta(vbid, localDbReqs, commitData.collections);
         }
         addLocalDbReqs(localDbReqs, postWriteOps);
@@ -1195,17 +1344,14 @@ int MagmaKVStore::saveDocs(VB::Commit& commitData, kvstats_ctx& kvctx) {
 
     // Vector of updates to be written to the data store.
     WriteOps writeOps;
-    writeOps.reserve(pendingReqs->size());
+    writeOps.reserve(reqs.size());
 
     // TODO: Replace writeOps with Magma::WriteOperations when it
-    // becomes available. This will allow us to pass pendingReqs
-    // in and create the WriteOperation from the pendingReqs queue.
-    for (auto& req : *pendingReqs) {
+    // becomes available. This will allow us to pass reqs
+    // in and create the WriteOperation from the reqs queue.
+    for (auto& req : reqs) {
         auto& docMeta = req.getDocMeta();
         Slice valSlice{req.getBodyData(), req.getBodySize()};
-        if (req.getDocMeta().bySeqno > lastSeqno) {
-            lastSeqno = req.getDocMeta().bySeqno;
-        }
         writeOps.emplace_back(Magma::WriteOperation::NewDocUpdate(
                 {req.getRawKey(), req.getRawKeyLen()},
                 {reinterpret_cast<char*>(&docMeta), sizeof(magmakv::MetaData)},
@@ -1239,8 +1385,8 @@ int MagmaKVStore::saveDocs(VB::Commit& commitData, kvstats_ctx& kvctx) {
     st.commitHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
             std::chrono::steady_clock::now() - begin));
 
-    st.batchSize.add(pendingReqs->size());
-    st.docsCommitted = pendingReqs->size();
+    st.batchSize.add(reqs.size());
+    st.docsCommitted = reqs.size();
 
     return status.ErrorCode();
 }
@@ -1896,10 +2042,18 @@ bool MagmaKVStore::compactDBInternal(std::shared_ptr<compaction_ctx> ctx) {
 
     Status status;
     if (dropped.empty()) {
-        // Compact the entire key range
+        // Compact the entire key range. This visits every key, so (unlike
+        // the compactions of the ranges below, or the implicit ones) it
+        // rebuilds the bloom filter of the vBucket.
+        auto fullCompactionCB = [this, ctx]() {
+            auto cb = std::make_unique<MagmaKVStore::MagmaCompactionCB>(*this,
+                                                                        ctx);
+            cb->rebuildBloomFilter = true;
+            return cb;
+        };
         Slice nullKey;
         status = magma->CompactKVStore(
-                vbid.get(), nullKey, nullKey, compactionCB);
+                vbid.get(), nullKey, nullKey, fullCompactionCB);
         if (!status) {
             logger->warn(
                     "MagmaKVStore::compactDBInternal CompactKVStore failed. "
@@ -2298,6 +2452,12 @@ void MagmaKVStore::addStats(const AddStatFn& add_stat,
     magma->GetStats(stats);
     auto statName = prefix + ":magma";
     add_casted_stat(statName.c_str(), stats.JSON().dump(), add_stat, c);
+
+    add_prefixed_stat(prefix,
+                      "pipelined_commit_bytes",
+                      pipelinedCommitBytes.load(),
+                      add_stat,
+                      c);
 }
 
 void MagmaKVStore::pendingTasks() {
@@ -29,6 +29,8 @@
 #include <platform/dirutils.h>
 #include <platform/non_negative_counter.h>
 
+#include <atomic>
+#include <deque>
 #include <map>
 #include <queue>
 #include <shared_mutex>
@@ -36,6 +38,10 @@
 #include <utility>
 #include <vector>
 
+namespace folly {
+class CPUThreadPoolExecutor;
+} // namespace folly
+
 namespace magma {
 class Slice;
 class Status;
@@ -238,6 +244,25 @@ public:
      */
     void rollback() override;
 
+    /// Group commit is supported when magma_pipelined_commit is enabled.
+    bool supportsGroupCommit() const override;
+
+    /**
+     * Begin a group commit. Until endGroupCommit(), commit() hands each
+     * flush-batch to the commit thread and returns once it is queued, so the
+     * flusher can prepare the next vBucket's batch while it is written. A
+     * batch which also persists collections metadata is written by commit()
+     * itself, as that metadata is shared by all of the vBuckets.
+     */
+    void beginGroupCommit() override;
+
+    /**
+     * End a group commit: wait for the write of every batch handed to the
+     * commit thread since beginGroupCommit() and invoke their persistence
+     * callbacks.
+     */
+    bool endGroupCommit() override;
+
     StorageProperties getStorageProperties() override;
 
     void setMaxDataSize(size_t size) override;
@@ -614,9 +639,44 @@ protected:
                           const magma::Slice& valueSlice,
                           GetMetaOnly getMetaOnly = GetMetaOnly::No);
 
-    virtual int saveDocs(VB::Commit& commitData, kvstats_ctx& kvctx);
+    /**
+     * Container for pending Magma requests.
+     *
+     * Using deque as as the expansion behaviour is less aggressive compared to
+     * std::vector (MagmaRequest objects are ~176 bytes in size).
+     */
+    using PendingRequestQueue = std::deque<MagmaRequest>;
+
+    /**
+     * Write a flush-batch to magma.
+     *
+     * @param reqs The (non-empty) requests of the batch, all for one vBucket
+     * @param commitData The flush's Commit data
+     * @param kvctx The stats context of the batch
+     * @param updateCollectionsMeta Also persist collectionsMeta (only valid on
+     *        the flusher thread, as collectionsMeta is shared)
+     */
+    virtual int saveDocs(PendingRequestQueue& reqs,
+                         VB::Commit& commitData,
+                         kvstats_ctx& kvctx,
+                         bool updateCollectionsMeta);
+
+    void commitCallback(int status,
+                        PendingRequestQueue& reqs,
+                        TransactionContext& txnCtx);
 
-    void commitCallback(int status, kvstats_ctx& kvctx);
+    /**
+     * Hand the current transaction's batch to the commit thread, first
+     * waiting for in-flight batches until it fits in
+     * magma_max_pipelined_bytes.
+     */
+    void submitPipelinedCommit(VB::Commit& commitData);
+
+    /**
+     * Wait for the write of the oldest batch handed to the commit thread
+     * and invoke its persistence callbacks.
+     */
+    void completeOldestPipelinedCommit();
 
     static ENGINE_ERROR_CODE magmaErr2EngineErr(magma::Status::Code err,
                                                 bool found = true);
@@ -664,6 +724,11 @@ protected:
         std::shared_ptr<compaction_ctx> ctx;
 
         MagmaDbStats magmaDbStats;
+
+        // Set for an explicit compaction of the entire key range, which
+        // visits every key of the vBucket, so the bloom filter may be
+        // rebuilt from the keys kept (as couchstore compaction does)
+        bool rebuildBloomFilter = false;
     };
 
     /**
@@ -692,14 +757,6 @@ protected:
      */
     std::unique_ptr<magma::Magma> magma;
 
-    /**
-     * Container for pending Magma requests.
-     *
-     * Using deque as as the expansion behaviour is less aggressive compared to
-     * std::vector (MagmaRequest objects are ~176 bytes in size).
-     */
-    using PendingRequestQueue = std::deque<MagmaRequest>;
-
     // Used for queueing mutation requests (in `set` and `del`) and flushing
     // them to disk (in `commit`).
     // unique_ptr for pimpl.
@@ -723,4 +780,23 @@ protected:
 
     folly::Synchronized<std::queue<std::tuple<Vbid, uint64_t>>>
             pendingVbucketDeletions;
+
+    /// A flush-batch handed to the commit thread by a pipelined commit.
+    struct PipelinedCommit;
+
+    /// Single thread writing the batches of pipelined commits, in order.
+    /// Created by the first beginGroupCommit().
+    std::unique_ptr<folly::CPUThreadPoolExecutor> commitExecutor;
+
+    /// Batches handed to the commit thread, oldest first. Only accessed by
+    /// the flusher.
+    std::deque<std::unique_ptr<PipelinedCommit>> pipelinedCommits;
+
+    /// Memory used by the requests of pipelinedCommits
+    std::atomic<size_t> pipelinedCommitBytes{0};
+
+    bool inGroupCommit{false};
+
+    /// Did the write of any batch of the current group commit fail?
+    bool pipelinedCommitFailed{false};
 };
@@ -59,6 +59,8 @@ MagmaKVStoreConfig::MagmaKVStoreConfig(Configuration& config,
     magmaInitialWalBufferSize = config.getMagmaInitialWalBufferSize();
     magmaCommitPointEveryBatch = config.isMagmaCommitPointEveryBatch();
     magmaEnableUpsert = config.isMagmaEnableUpsert();
+    magmaPipelinedCommit = config.isMagmaPipelinedCommit();
+    magmaMaxPipelinedBytes = config.getMagmaMaxPipelinedBytes();
     magmaExpiryFragThreshold = config.getMagmaExpiryFragThreshold();
     magmaExpiryPurgerInterval =
             std::chrono::seconds(config.getMagmaExpiryPurgerInterval());
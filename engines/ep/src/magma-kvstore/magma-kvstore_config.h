@@ -73,6 +73,12 @@ public:
     bool getMagmaEnableUpsert() const {
         return magmaEnableUpsert;
     }
+    bool getMagmaPipelinedCommit() const {
+        return magmaPipelinedCommit;
+    }
+    size_t getMagmaMaxPipelinedBytes() const {
+        return magmaMaxPipelinedBytes;
+    }
     float getMagmaExpiryFragThreshold() const {
         return magmaExpiryFragThreshold;
     }
@@ -174,6 +180,13 @@ private:
     // not be maintained.
     bool magmaEnableUpsert;
 
+    // When true, group commits write each flush-batch on a separate thread
+    // while the flusher prepares the next.
+    bool magmaPipelinedCommit;
+
+    // Memory limit of the flush-batches in flight in pipelined commits.
+    size_t magmaMaxPipelinedBytes;
+
     // Ratio of available memory that magma write cache can utilized up
     // to the magmaMaxWriteCache limit.
     float magmaWriteCacheRatio;
@@ -0,0 +1,118 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "meta_bounds.h"
+
+#include "murmurhash3.h"
+
+#include <stdexcept>
+
+/*
+ * Serialised layout: the magic, the version and the slot count followed by
+ * the CAS and revision seqno of each slot, all little-endian.
+ */
+static constexpr uint32_t SerialisedMagic = 0x4d424e44; // "MBND"
+static constexpr uint32_t SerialisedVersion = 1;
+static constexpr size_t SerialisedHeaderSize = 16;
+
+static void putLE(std::string& out, uint64_t value, int bytes) {
+    for (int ii = 0; ii < bytes; ++ii) {
+        out.push_back(char(value >> (ii * 8)));
+    }
+}
+
+static uint64_t getLE(const char* in, int bytes) {
+    uint64_t value = 0;
+    for (int ii = 0; ii < bytes; ++ii) {
+        value |= uint64_t(uint8_t(in[ii])) << (ii * 8);
+    }
+    return value;
+}
+
+/// Raise value to at least candidate
+static void raise(std::atomic<uint64_t>& value, uint64_t candidate) {
+    auto current = value.load(std::memory_order_relaxed);
+    while (current < candidate &&
+           !value.compare_exchange_weak(current, candidate)) {
+    }
+}
+
+MetaBounds::MetaBounds(size_t size)
+    : size(size), slots(std::make_unique<Slot[]>(size)) {
+    if (size == 0) {
+        throw std::invalid_argument("MetaBounds: size must be greater than 0");
+    }
+}
+
+void MetaBounds::add(const DocKey& key, uint64_t cas, uint64_t revSeqno) {
+    auto& slot = slots[getSlot(key)];
+    raise(slot.cas, cas);
+    raise(slot.revSeqno, revSeqno);
+}
+
+MetaBounds::Bounds MetaBounds::get(const DocKey& key) const {
+    const auto& slot = slots[getSlot(key)];
+    return {slot.cas.load(), slot.revSeqno.load()};
+}
+
+size_t MetaBounds::getSlot(const DocKey& key) const {
+    // The hash must be stable across restarts (the bounds are persisted)
+    uint64_t hash[2];
+    MurmurHash3_x64_128(key.data(), int(key.size()), 0, hash);
+    return size_t(hash[0] % size);
+}
+
+std::string MetaBounds::serialise() const {
+    std::string out;
+    out.reserve(SerialisedHeaderSize + size * 16);
+    putLE(out, SerialisedMagic, 4);
+    putLE(out, SerialisedVersion, 4);
+    putLE(out, size, 8);
+    for (size_t ii = 0; ii < size; ++ii) {
+        putLE(out, slots[ii].cas.load(), 8);
+        putLE(out, slots[ii].revSeqno.load(), 8);
+    }
+    return out;
+}
+
+std::unique_ptr<MetaBounds> MetaBounds::deserialise(std::string_view data) {
+    if (data.size() < SerialisedHeaderSize) {
+        throw std::invalid_argument(
+                "MetaBounds::deserialise: data too short for header");
+    }
+    if (getLE(data.data(), 4) != SerialisedMagic ||
+        getLE(data.data() + 4, 4) != SerialisedVersion) {
+        throw std::invalid_argument(
+                "MetaBounds::deserialise: unknown magic or version");
+    }
+    const auto size = getLE(data.data() + 8, 8);
+    const auto body = data.substr(SerialisedHeaderSize);
+    if (size == 0 || body.size() / 16 != size || body.size() % 16 != 0) {
+        throw std::invalid_argument(
+                "MetaBounds::deserialise: inconsistent size:" +
+                std::to_string(size) + " body:" + std::to_string(body.size()));
+    }
+
+    auto bounds = std::make_unique<MetaBounds>(size);
+    const char* in = body.data();
+    for (size_t ii = 0; ii < size; ++ii) {
+        bounds->slots[ii].cas.store(getLE(in, 8));
+        bounds->slots[ii].revSeqno.store(getLE(in + 8, 8));
+        in += 16;
+    }
+    return bounds;
+}
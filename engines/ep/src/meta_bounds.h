@@ -0,0 +1,87 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/dockey.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * The upper bounds of the CAS and revision seqno of the documents
+ * (including the tombstones) of a full-eviction vBucket, by key hash.
+ *
+ * Every document queued for persistence raises the bounds of the slot its
+ * key hashes to, so that a setWithMeta whose metadata exceeds the bounds
+ * of its slot is known to win the conflict resolution against whatever
+ * version of the document may be on disk, and may be applied without
+ * fetching the metadata of a non-resident key.
+ *
+ * The bounds are only valid if they have seen every document of the
+ * vBucket: they're created with an (empty) vBucket, or saved on clean
+ * shutdown and reloaded during warmup. They never decrease.
+ */
+class MetaBounds {
+public:
+    struct Bounds {
+        uint64_t cas;
+        uint64_t revSeqno;
+    };
+
+    /// @param size the number of slots (must be greater than 0)
+    explicit MetaBounds(size_t size);
+
+    /// Raise the bounds of the key's slot to cover the given metadata
+    void add(const DocKey& key, uint64_t cas, uint64_t revSeqno);
+
+    /// @returns the bounds of the key's slot
+    Bounds get(const DocKey& key) const;
+
+    size_t getSize() const {
+        return size;
+    }
+
+    size_t getMemoryUsage() const {
+        return sizeof(*this) + size * sizeof(Slot);
+    }
+
+    /**
+     * Serialise the bounds into a platform-independent byte string
+     * suitable for persisting to disk.
+     */
+    std::string serialise() const;
+
+    /**
+     * Recreate the bounds previously written by serialise().
+     * @throws std::invalid_argument if data is not valid serialised bounds
+     */
+    static std::unique_ptr<MetaBounds> deserialise(std::string_view data);
+
+protected:
+    struct Slot {
+        std::atomic<uint64_t> cas{0};
+        std::atomic<uint64_t> revSeqno{0};
+    };
+
+    size_t getSlot(const DocKey& key) const;
+
+    const size_t size;
+    std::unique_ptr<Slot[]> slots;
+};
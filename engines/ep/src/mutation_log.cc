@@ -16,6 +16,7 @@
  */
 
 #include <fcntl.h>
+#include <platform/crc32c.h>
 #include <platform/dirutils.h>
 #include <platform/strerror.h>
 #include <sys/stat.h>
@@ -411,6 +412,15 @@ void MutationLog::readInitialBlock() {
     }
     }
 
+    switch (headerBlock.checksum()) {
+    case MutationLogChecksum::Crc32:
+    case MutationLogChecksum::Crc32c:
+        break;
+    default:
+        throw ReadException("HeaderBlock checksum is unknown " +
+                            std::to_string(int(headerBlock.checksum())));
+    }
+
     if (headerBlock.blockCount() != 1) {
         std::stringstream ss;
         ss << "HeaderBlock blockCount mismatch " +
@@ -421,6 +431,17 @@ void MutationLog::readInitialBlock() {
     blockSize = headerBlock.blockSize();
 }
 
+uint16_t MutationLog::blockChecksum(const uint8_t* buf, size_t len) const {
+    switch (headerBlock.checksum()) {
+    case MutationLogChecksum::Crc32:
+        return crc32buf(const_cast<uint8_t*>(buf), len) & 0xffff;
+    case MutationLogChecksum::Crc32c:
+        return crc32c(buf, len, 0) & 0xffff;
+    }
+    throw std::logic_error("MutationLog::blockChecksum: unknown checksum " +
+                           std::to_string(int(headerBlock.checksum())));
+}
+
 void MutationLog::updateInitialBlock() {
     if (readOnly) {
         throw std::logic_error("MutationLog::updateInitialBlock: Not valid on "
@@ -670,8 +691,8 @@ bool MutationLog::flush() {
         entries = htons(entries);
         memcpy(blockBuffer.get() + 2, &entries, sizeof(entries));
 
-        uint32_t crc32(crc32buf(blockBuffer.get() + 2, blockSize - 2));
-        uint16_t crc16(htons(crc32 & 0xffff));
+        uint16_t crc16(htons(blockChecksum(blockBuffer.get() + 2,
+                                           blockSize - 2)));
         memcpy(blockBuffer.get(), &crc16, sizeof(crc16));
 
         if (writeFully(file, blockBuffer.get(), blockSize)) {
@@ -964,8 +985,8 @@ void MutationLog::iterator::nextBlock() {
     offset += bytesread;
 
     // block starts with 2 byte crc and 2 byte item count
-    uint32_t crc32(crc32buf(buf.data() + sizeof(uint16_t), buf.size() - sizeof(uint16_t)));
-    uint16_t computed_crc16(crc32 & 0xffff);
+    uint16_t computed_crc16(log->blockChecksum(
+            buf.data() + sizeof(uint16_t), buf.size() - sizeof(uint16_t)));
     uint16_t retrieved_crc16;
     memcpy(&retrieved_crc16, buf.data(), sizeof(retrieved_crc16));
     retrieved_crc16 = ntohs(retrieved_crc16);
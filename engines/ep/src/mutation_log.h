@@ -75,6 +75,18 @@ const size_t HEADER_RESERVED(4);
 
 enum class MutationLogVersion { V1 = 1, V2 = 2, V3 = 3, Current = V3 };
 
+/**
+ * The checksum of the blocks of a log, recorded in the header block. Logs
+ * written before the field existed have zeros there, i.e. Crc32.
+ */
+enum class MutationLogChecksum {
+    /// Low 16 bits of the (table-based) CRC-32 of crc32buf()
+    Crc32 = 0,
+    /// Low 16 bits of the (hardware accelerated) CRC-32C of crc32c()
+    Crc32c = 1,
+    Current = Crc32c
+};
+
 const size_t LOG_ENTRY_BUF_SIZE(512);
 
 const uint8_t SYNC_COMMIT_1(1);
@@ -93,11 +105,13 @@ const uint8_t DEFAULT_SYNC_CONF(FLUSH_COMMIT_2 | SYNC_COMMIT_2);
 class LogHeaderBlock {
 public:
     explicit LogHeaderBlock(
-            MutationLogVersion version = MutationLogVersion::Current)
+            MutationLogVersion version = MutationLogVersion::Current,
+            MutationLogChecksum checksum = MutationLogChecksum::Current)
         : _version(htonl(int(version))),
           _blockSize(0),
           _blockCount(0),
-          _rdwr(1) {
+          _rdwr(1),
+          _checksum(htonl(int(checksum))) {
     }
 
     void set(uint32_t bs, uint32_t bc=1) {
@@ -114,6 +128,8 @@ public:
         memcpy(&_blockCount, buf.data() + offset, sizeof(_blockCount));
         offset += sizeof(_blockCount);
         memcpy(&_rdwr, buf.data() + offset, sizeof(_rdwr));
+        offset += sizeof(_rdwr);
+        memcpy(&_checksum, buf.data() + offset, sizeof(_checksum));
     }
 
     MutationLogVersion version() const {
@@ -136,12 +152,17 @@ public:
         _rdwr = htonl(nval);
     }
 
+    MutationLogChecksum checksum() const {
+        return MutationLogChecksum(ntohl(_checksum));
+    }
+
 private:
 
     uint32_t _version;
     uint32_t _blockSize;
     uint32_t _blockCount;
     uint32_t _rdwr;
+    uint32_t _checksum;
 };
 
 /**
@@ -456,6 +477,9 @@ private:
     void readInitialBlock();
     void updateInitialBlock();
 
+    /// @return the checksum (as of the header block) of a block's contents
+    uint16_t blockChecksum(const uint8_t* buf, size_t len) const;
+
     bool prepareWrites();
 
     file_handle_t fd() const { return file; }
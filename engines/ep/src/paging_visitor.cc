@@ -18,6 +18,7 @@
 #include "paging_visitor.h"
 #include "bucket_logger.h"
 #include "checkpoint_manager.h"
+#include "collections/manager.h"
 #include "connmap.h"
 #include "dcp/dcpconnmap.h"
 #include "ep_engine.h"
@@ -67,6 +68,23 @@ PagingVisitor::PagingVisitor(KVBucket& s,
       freqCounterAgeThreshold(freqCounterAgeThreshold),
       maxCas(0) {
     setVBucketFilter(vbFilter);
+    if (owner == ITEM_PAGER) {
+        evictionWeights = store.getCollectionsManager().getEvictionWeights();
+    }
+}
+
+uint8_t PagingVisitor::getWeightedFreqCounter(CollectionID cid,
+                                              uint8_t freqCounter) const {
+    if (evictionWeights.empty()) {
+        return freqCounter;
+    }
+    const auto itr = evictionWeights.find(cid);
+    if (itr == evictionWeights.end()) {
+        return freqCounter;
+    }
+    return static_cast<uint8_t>(
+            std::min(double(std::numeric_limits<uint8_t>::max()),
+                     std::round(freqCounter / itr->second)));
 }
 
 bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
@@ -85,6 +103,10 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
         return true;
     }
 
+    if (rebuildingExpiryIndex) {
+        currentBucket->ht.trackExpiry(v);
+    }
+
     // We don't skip temp initial items (state_temp_init) here. This means that
     // we could evict one before a BG fetch completes. This is fine as it may be
     // desirable to do so under extremely high memory pressure and this ensures
@@ -100,12 +122,30 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
         return true;
     }
 
+    if (!collectionFilter.empty() &&
+        collectionFilter.count(v.getKey().getCollectionID()) == 0) {
+        return true;
+    }
+
     /*
      * We take a copy of the freqCounterValue because calling
      * doEviction can modify the value, and when we want to
      * add it to the histogram we want to use the original value.
+     * Any pending decay of the counter is applied first.
+     */
+    const auto storedValueFreqCounter =
+            currentBucket->ht.unlocked_applyFreqDecay(lh, v);
+
+    /*
+     * The frequency counter compared against the thresholds (and added to
+     * the histogram they are derived from) is scaled by the collection's
+     * eviction weight; items of a collection with weight 2 appear half as
+     * frequently accessed as they are, so are evicted first. As both the
+     * histogram and the comparison use the weighted value the proportion
+     * of items evicted still matches the eviction ratio.
      */
-    auto storedValueFreqCounter = v.getFreqCounterValue();
+    auto weightedFreqCounter = getWeightedFreqCounter(
+            v.getKey().getCollectionID(), storedValueFreqCounter);
     bool evicted = true;
 
     /*
@@ -127,7 +167,7 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
     age = age >> ItemEviction::casBitsNotTime;
 
     const bool belowMFUThreshold =
-            storedValueFreqCounter <= freqCounterThreshold;
+            weightedFreqCounter <= freqCounterThreshold;
     // age exceeds threshold (from age histogram, set by config param
     // item_eviction_age_percentage
     // OR
@@ -137,7 +177,7 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
     // to be evicted even if it is "young".
     const bool meetsAgeRequirements =
             age >= ageThreshold ||
-            storedValueFreqCounter < freqCounterAgeThreshold;
+            weightedFreqCounter < freqCounterAgeThreshold;
 
     // For replica vbuckets, young items are not protected from eviction.
     const bool isReplica = currentBucket->getState() == vbucket_state_replica;
@@ -156,14 +196,14 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
          */
         if (!doEviction(lh, &v)) {
             evicted = false;
-            storedValueFreqCounter = std::numeric_limits<uint8_t>::max();
+            weightedFreqCounter = std::numeric_limits<uint8_t>::max();
         }
     } else {
         evicted = false;
         // If the storedValue is NOT eligible for eviction then
         // we want to add the maximum value (255).
         if (!currentBucket->eligibleToPageOut(lh, v)) {
-            storedValueFreqCounter = std::numeric_limits<uint8_t>::max();
+            weightedFreqCounter = std::numeric_limits<uint8_t>::max();
         } else {
             /*
              * MB-29333 - For items that we have visited and did not
@@ -174,11 +214,12 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
              * incremented in between visits of the item pager).
              */
             if (storedValueFreqCounter > 0) {
-                v.setFreqCounterValue(storedValueFreqCounter - 1);
+                currentBucket->ht.unlocked_setFreqCounterValue(
+                        lh, v, storedValueFreqCounter - 1);
             }
         }
     }
-    itemEviction.addFreqAndAgeToHistograms(storedValueFreqCounter, age);
+    itemEviction.addFreqAndAgeToHistograms(weightedFreqCounter, age);
 
     if (evicted) {
         /**
@@ -198,11 +239,14 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
 
     // Whilst we are learning it is worth always updating the
     // threshold. We also want to update the threshold at periodic
-    // intervals.
+    // intervals. (The age of items changes over time, so the age threshold
+    // is always learnt from the items visited.)
     if (itemEviction.isLearning() || itemEviction.isRequiredToUpdate()) {
         auto thresholds =
                 itemEviction.getThresholds(evictionRatio * 100.0, agePercentage);
-        freqCounterThreshold = thresholds.first;
+        if (!freqThresholdUpFront) {
+            freqCounterThreshold = thresholds.first;
+        }
         ageThreshold = thresholds.second;
     }
 
@@ -217,9 +261,25 @@ void PagingVisitor::visitBucket(const VBucketPtr& vb) {
     if (owner == EXPIRY_PAGER) {
         if (vBucketFilter(vb->getId())) {
             currentBucket = vb;
-            // EvictionPolicy is not required when running expiry item
-            // pager
+            auto& index = vb->ht.getExpiryIndex();
+            if (index.isEnabled() && !index.isOverflowed()) {
+                // Only expire the items of an active vbucket, the entries
+                // of a replica are kept for when it's promoted
+                if (vb->getState() == vbucket_state_active) {
+                    visitExpiredFromIndex(*vb);
+                }
+                return;
+            }
+            // Rebuild the expiry index (if enabled) while visiting all of
+            // the items. EvictionPolicy is not required when running
+            // expiry item pager
+            rebuildingExpiryIndex = index.isEnabled();
+            if (rebuildingExpiryIndex) {
+                index.clear();
+                ++stats.expiryPagerFullScans;
+            }
             vb->ht.visit(*this);
+            rebuildingExpiryIndex = false;
         }
         return;
     }
@@ -228,18 +288,32 @@ void PagingVisitor::visitBucket(const VBucketPtr& vb) {
     auto current = static_cast<double>(stats.getEstimatedTotalMemoryUsed());
     auto lower = static_cast<double>(stats.mem_low_wat);
     auto high = static_cast<double>(stats.mem_high_wat);
-    if (vb->getState() == vbucket_state_active && current < high &&
+    // Eviction targeted at specific collections is independent of the bucket
+    // watermarks and resident ratios.
+    const bool targetCollections = !collectionFilter.empty();
+    if (!targetCollections && vb->getState() == vbucket_state_active &&
+        current < high &&
         store.getActiveResidentRatio() < store.getReplicaResidentRatio()) {
         return;
     }
 
-    if (current > lower) {
+    if (current > lower || targetCollections) {
         if (vBucketFilter(vb->getId())) {
             currentBucket = vb;
             maxCas = currentBucket->getMaxCas();
             itemEviction.reset();
             freqCounterThreshold = 0;
 
+            freqThresholdUpFront = freqThresholdFromHashTable &&
+                                   collectionFilter.empty() &&
+                                   evictionWeights.empty();
+            if (freqThresholdUpFront) {
+                freqCounterThreshold = ItemEviction::getFreqThreshold(
+                        vb->ht.getFreqCounts(),
+                        evictionRatios.getForState(vb->getState()) * 100.0,
+                        vb->ht.getNumItems());
+            }
+
             // Percent of items in the hash table to be visited
             // between updating the interval.
             const double percentOfItems = 0.1;
@@ -287,6 +361,24 @@ void PagingVisitor::visitBucket(const VBucketPtr& vb) {
     }
 }
 
+void PagingVisitor::visitExpiredFromIndex(VBucket& vb) {
+    for (const auto& key : vb.ht.getExpiryIndex().takeDue(startTime)) {
+        // The document may have been updated, deleted or evicted (in which
+        // case compaction expires it) since the key was indexed
+        auto result = vb.ht.findOnlyCommitted(key);
+        if (!result.storedValue) {
+            continue;
+        }
+        auto& v = *result.storedValue;
+        if (v.isExpired(startTime)) {
+            visit(result.lock, v);
+        } else if (ExpiryIndex::isDue(v.getExptime(), startTime)) {
+            // Expires later within the current bucket of the index
+            vb.ht.trackExpiry(v);
+        }
+    }
+}
+
 void PagingVisitor::update() {
     store.deleteExpiredItems(expired, ExpireBy::Pager);
 
@@ -319,6 +411,12 @@ void PagingVisitor::complete() {
         stats.expiryPagerHisto.add(elapsed_time);
     }
 
+    if (runningVisitors && runningVisitors->fetch_sub(1) != 1) {
+        // Other visitors of this run are still going; the last one to
+        // complete finishes the run.
+        return;
+    }
+
     bool inverse = false;
     (*stateFinalizer).compare_exchange_strong(inverse, true);
 
@@ -335,6 +433,11 @@ void PagingVisitor::complete() {
         // the stateFinalizer, which ensures the ItemPager doesn't just
         // ignore a request.
         store.checkAndMaybeFreeMemory();
+        if (!collectionFilter.empty()) {
+            // Allow mutations of the collections we've brought back under
+            // quota without waiting for the next ItemPager run.
+            store.updateCollectionsOverMemQuota();
+        }
     }
 }
 
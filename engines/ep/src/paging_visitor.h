@@ -25,6 +25,8 @@
 
 #include <atomic>
 #include <list>
+#include <unordered_map>
+#include <unordered_set>
 
 class EPStats;
 class Item;
@@ -105,6 +107,37 @@ public:
         return ejected;
     }
 
+    /**
+     * Restrict eviction to items of the given collections. Used to bring
+     * collections which are over the per-collection memory quota back under
+     * it, in which case the bucket watermarks are not considered.
+     */
+    void setCollectionFilter(std::unordered_set<CollectionID> collections) {
+        collectionFilter = std::move(collections);
+    }
+
+    /**
+     * Compute the frequency counter threshold of each vBucket before visiting
+     * it, from the frequency histogram its HashTable maintains, rather than
+     * learning it from the items visited. Not applied when eviction is
+     * targeted at collections or collections have eviction weights, as the
+     * histogram covers all of the vBucket's items, unweighted.
+     */
+    void setFreqThresholdFromHashTable(bool value) {
+        freqThresholdFromHashTable = value;
+    }
+
+    /**
+     * Share the visit with other PagingVisitors, each visiting a disjoint
+     * subset of the vBuckets concurrently. running counts the visitors which
+     * have not completed yet; only the last to complete clears the
+     * stateFinalizer and re-checks memory usage, so the pager doesn't start
+     * another visit while part of this one is still running.
+     */
+    void setConcurrentVisitors(std::shared_ptr<std::atomic<size_t>> running) {
+        runningVisitors = std::move(running);
+    }
+
 protected:
     // Protected for testing purposes
     // Holds the data structures used during the selection of documents to
@@ -125,6 +158,13 @@ protected:
     // items from the hash table.
     uint64_t ageThreshold;
 
+    // See setFreqThresholdFromHashTable()
+    bool freqThresholdFromHashTable = false;
+
+    // True if freqCounterThreshold of the current vBucket was computed from
+    // its HashTable's frequency histogram (so is not updated while visiting).
+    bool freqThresholdUpFront = false;
+
 private:
     // Removes checkpoints that are both closed and unreferenced, thereby
     // freeing the associated memory.
@@ -133,8 +173,21 @@ private:
 
     bool doEviction(const HashTable::HashBucketLock& lh, StoredValue* v);
 
+    /// Visit the items of the vbucket which the expiry index says expired
+    void visitExpiredFromIndex(VBucket& vb);
+
+    /**
+     * @returns the given frequency counter value of an item in collection
+     *          cid, divided by the collection's eviction weight (if any).
+     */
+    uint8_t getWeightedFreqCounter(CollectionID cid,
+                                   uint8_t freqCounter) const;
+
     std::list<Item> expired;
 
+    /// Set while the expiry pager visits a HashTable to rebuild its index
+    bool rebuildingExpiryIndex = false;
+
     KVBucket& store;
     EPStats& stats;
     EvictionRatios evictionRatios;
@@ -163,4 +216,14 @@ private:
     // The VB::Manifest read handle that we use to lock around HashBucket
     // visits. Will contain a nullptr if we aren't currently locking anything.
     Collections::VB::ReadHandle readHandle;
+
+    // If non-empty, only items of these collections are evicted.
+    std::unordered_set<CollectionID> collectionFilter;
+
+    // Eviction weights of the collections which define one, from the
+    // collections manifest at the time the visitor was created.
+    std::unordered_map<CollectionID, float> evictionWeights;
+
+    // See setConcurrentVisitors(); null if this is the only visitor.
+    std::shared_ptr<std::atomic<size_t>> runningVisitors;
 };
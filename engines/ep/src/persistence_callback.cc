@@ -47,6 +47,21 @@ void PersistenceCallback::operator()(TransactionContext& txCtx,
             if (v && (v->getBySeqno() == queuedItem->getBySeqno())) {
                 Expects(v->isDirty());
                 v->markClean();
+
+                // Write-once collections: eject the item right away, unless
+                // it has been read since written (the frequency counter
+                // starts at initialFreqCount and is bumped by reads)
+                const auto policy = vbucket.getEvictionPolicy();
+                if (!epCtx.evictOnPersist.empty() &&
+                    epCtx.evictOnPersist.count(
+                            queuedItem->getKey().getCollectionID()) &&
+                    vbucket.ht.unlocked_applyFreqDecay(res.lock, *v) <=
+                            Item::initialFreqCount &&
+                    v->eligibleForEviction(policy) &&
+                    vbucket.ht.unlocked_ejectItem(res.lock, v, policy)) {
+                    // Note: v may be deleted (full eviction)
+                    ++epCtx.stats.numEjectsOnPersist;
+                }
             }
         }
         // Update general flush stats
@@ -115,8 +130,14 @@ void PersistenceCallback::operator()(TransactionContext& txCtx,
     folly::assume_unreachable();
 }
 
-EPTransactionContext::EPTransactionContext(EPStats& stats, VBucket& vbucket)
-    : TransactionContext(vbucket.getId()), stats(stats), vbucket(vbucket) {
+EPTransactionContext::EPTransactionContext(
+        EPStats& stats,
+        VBucket& vbucket,
+        std::unordered_set<CollectionID> evictOnPersist)
+    : TransactionContext(vbucket.getId()),
+      stats(stats),
+      vbucket(vbucket),
+      evictOnPersist(std::move(evictOnPersist)) {
 }
 
 void EPTransactionContext::setCallback(const queued_item& item,
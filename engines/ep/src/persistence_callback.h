@@ -18,6 +18,8 @@
 
 #include "kvstore.h"
 
+#include <unordered_set>
+
 class EPStats;
 class VBucket;
 
@@ -49,7 +51,14 @@ public:
 };
 
 struct EPTransactionContext : public TransactionContext {
-    EPTransactionContext(EPStats& stats, VBucket& vbucket);
+    /**
+     * @param evictOnPersist the collections whose items are ejected once
+     *        persisted (see Collections::Manager)
+     */
+    EPTransactionContext(
+            EPStats& stats,
+            VBucket& vbucket,
+            std::unordered_set<CollectionID> evictOnPersist = {});
 
     void setCallback(const queued_item&, KVStore::FlushStateMutation) override;
 
@@ -58,6 +67,7 @@ struct EPTransactionContext : public TransactionContext {
 
     EPStats& stats;
     VBucket& vbucket;
+    const std::unordered_set<CollectionID> evictOnPersist;
 
 protected:
     PersistenceCallback cb;
@@ -20,6 +20,8 @@
 #include <boost/range/join.hpp>
 #include <boost/range/numeric.hpp>
 
+#include <algorithm>
+
 const SeqRange SeqRange::invalid = {0, 0};
 
 SeqRange::SeqRange(seqno_t beginVal, seqno_t endVal)
@@ -41,6 +43,16 @@ void SeqRange::setBegin(const seqno_t start) {
     begin = start;
 }
 
+void SeqRange::setEnd(const seqno_t newEnd) {
+    if (newEnd < begin) {
+        throw std::invalid_argument("Trying to set incorrect end " +
+                                    std::to_string(newEnd) + " on SeqRange: [" +
+                                    std::to_string(begin) + ", " +
+                                    std::to_string(end) + "]");
+    }
+    end = newEnd;
+}
+
 SeqRange SeqRange::makeNonOverlapping(const SeqRange& other) const {
     if (!valid() || !other.valid()) {
         return {0, 0};
@@ -103,6 +115,11 @@ void RangeGuard::updateRangeStart(seqno_t newStart) {
     rlm->updateRangeLockStart(itrToRange, newStart);
 }
 
+void RangeGuard::updateRangeEnd(seqno_t newEnd) {
+    Expects(valid());
+    rlm->updateRangeLockEnd(itrToRange, newEnd);
+}
+
 void RangeGuard::reset() {
     if (valid()) {
         rlm->release(itrToRange, exclusive);
@@ -191,6 +208,21 @@ RangeGuard RangeLockManager::tryLockRangeShared(seqno_t start, seqno_t end) {
     return {*this, std::prev(r->shared.end()), false};
 }
 
+bool RangeLockManager::isLocked(seqno_t seqno) const {
+    auto r = ranges.lock();
+
+    if (!r->unionedRange.contains(seqno)) {
+        return false;
+    }
+
+    const auto allRanges = boost::range::join(r->shared, r->exclusive);
+    return std::any_of(allRanges.begin(),
+                       allRanges.end(),
+                       [seqno](const SeqRange& range) {
+                           return range.contains(seqno);
+                       });
+}
+
 void RangeLockManager::release(const RangeGuard::ItrType& itrToRange,
                                bool exclusive) {
     auto r = ranges.lock();
@@ -229,6 +261,29 @@ void RangeLockManager::updateRangeLockStart(
     }
 }
 
+void RangeLockManager::updateRangeLockEnd(
+        const RangeGuard::ItrType& itrToRange, seqno_t newEnd) {
+    auto r = ranges.lock();
+
+    auto previousEnd = itrToRange->getEnd();
+
+    if (newEnd >= previousEnd || newEnd < itrToRange->getBegin()) {
+        using std::to_string;
+        throw std::logic_error(
+                std::string("RangeLockManager::updateRangeLockEnd: "
+                            "tried to update end of range:") +
+                to_string(*itrToRange) + "to :{" + to_string(newEnd) + "}");
+    }
+
+    itrToRange->setEnd(newEnd);
+
+    if (previousEnd == r->unionedRange.getEnd()) {
+        // As for updateRangeLockStart; if this range read was the upper
+        // bound of the overall protected range it may have shrunk.
+        r->updateUnionedRange();
+    }
+}
+
 void RangeLockManager::LockedRanges::updateUnionedRange() {
     // clear the existing combined range, it is about to be regenerated
     // from the remaining range reads, and may cover a smaller range of seqnos.
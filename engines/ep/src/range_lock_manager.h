@@ -136,6 +136,8 @@ public:
         return end;
     }
 
+    void setEnd(const seqno_t newEnd);
+
     const static SeqRange invalid;
 
 private:
@@ -190,6 +192,19 @@ public:
      */
     void updateRangeStart(seqno_t newStart);
 
+    /**
+     * Move the end of the guarded range lock backwards, releasing the lock
+     * on any seqnos after newEnd.
+     *
+     * This movement is strictly monotonic, and calls with a seqno
+     * greater than or equal to the current range end, or less than the
+     * current range start, will throw a std::logic_error.
+     * Should only be called on valid RangeGuards.
+     *
+     * @param newEnd seqno to set the range end to.
+     */
+    void updateRangeEnd(seqno_t newEnd);
+
     /**
      * Check if the RangeGuard is initialized and currently
      * holds a range lock (which would be released on destruction).
@@ -315,6 +330,16 @@ public:
         return ranges.lock()->unionedRange;
     }
 
+    /**
+     * Check if the given seqno is covered by any of the current range locks.
+     *
+     * Unlike testing against getLockedRange(), seqnos in the gaps between
+     * disjoint range locks (e.g., between two backfills at different points
+     * in the list) are not considered locked, so front end ops may update
+     * them in place rather than creating stale copies.
+     */
+    bool isLocked(seqno_t seqno) const;
+
 protected:
     /**
      * Release the currently held range lock. Only to be used internally
@@ -337,6 +362,16 @@ protected:
     void updateRangeLockStart(const RangeGuard::ItrType& itrToRange,
                               seqno_t newStart);
 
+    /**
+     * Pull back the end of the currently locked range ("releasing" any
+     * seqnos that are no longer within the range) and recompute the unioned
+     * range. The range end may only be moved backwards.
+     *
+     * Used through RangeGuard.
+     */
+    void updateRangeLockEnd(const RangeGuard::ItrType& itrToRange,
+                            seqno_t newEnd);
+
     struct LockedRanges {
         /**
          * Compute a single range lock spanning all required individual ranges
@@ -350,22 +385,19 @@ protected:
          *
          * This is a computed value, derived from the range locks in `all`.
          * It is generated when adding or removing values from `all`, so that
-         * front end ops can test seqnos against a single range, rather than
-         * against every element of `all`.
+         * front end ops can rule out most seqnos against a single range,
+         * rather than against every element of `all`.
          */
         SeqRange unionedRange = SeqRange::invalid;
         /**
          * List of currently held read ranges which can "share" seqnos (are
          * allowed to overlap with each other).
          *
-         * For simplicity (and front end performance) when multiple concurrent
-         * read ranges are required, it is treated as if there is a single read
-         * range spanning over all required seqnos - i.e., an effective read
-         * range from the lowest range start to the highest range end. This
-         * means if the range locks are disjoint, some items will be included
-         * that don't strictly need to be - this may lead to more stale items
-         * than necessary, but means that front end ops only need to check
-         * existing seqlist items against a single range, rather than many.
+         * For front end performance, seqnos are first tested against a
+         * single range spanning over all required seqnos (`unionedRange`);
+         * only seqnos within it are tested against the individual ranges
+         * (see isLocked()), so seqnos in the gaps between disjoint range
+         * locks do not create stale items.
          *
          * In general it is not expected that there will be many concurrent
          * range locks (largely limited by the max number of replicas).
@@ -0,0 +1,191 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "range_scan.h"
+
+#include "ep_engine.h"
+#include "item.h"
+#include "kv_bucket.h"
+
+#include <mcbp/protocol/datatype.h>
+#include <mcbp/protocol/status.h>
+#include <phosphor/phosphor.h>
+
+/// @returns the key as the connection encodes it
+static DocKey getClientKey(const DocKey& key, bool collectionsSupported) {
+    return collectionsSupported ? key : key.makeDocKeyWithoutCollectionID();
+}
+
+template <typename T>
+static void append(std::vector<char>& buffer, T value) {
+    const auto* ptr = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), ptr, ptr + sizeof(T));
+}
+
+size_t getScanDocumentSize(const Item& item,
+                           bool keyOnly,
+                           bool collectionsSupported) {
+    const auto key = getClientKey(item.getKey(), collectionsSupported);
+    size_t docSize = sizeof(uint16_t) + key.size();
+    if (!keyOnly) {
+        docSize += sizeof(uint32_t) * 3 + sizeof(uint64_t) * 2 +
+                   sizeof(uint8_t) + item.getNBytes();
+    }
+    return docSize;
+}
+
+void appendScanDocument(std::vector<char>& buffer,
+                        const Item& item,
+                        bool keyOnly,
+                        bool collectionsSupported) {
+    const auto key = getClientKey(item.getKey(), collectionsSupported);
+    buffer.reserve(buffer.size() +
+                   getScanDocumentSize(item, keyOnly, collectionsSupported));
+    append(buffer, htons(uint16_t(key.size())));
+    buffer.insert(buffer.end(), key.data(), key.data() + key.size());
+    if (keyOnly) {
+        return;
+    }
+
+    // Flags are held in network byte order
+    append(buffer, item.getFlags());
+    append(buffer, htonl(uint32_t(item.getExptime())));
+    append(buffer, htonll(uint64_t(item.getBySeqno())));
+    append(buffer, htonll(item.getCas()));
+    append(buffer, uint8_t(item.getDataType()));
+    append(buffer, htonl(item.getNBytes()));
+    buffer.insert(
+            buffer.end(), item.getData(), item.getData() + item.getNBytes());
+}
+
+RangeScanCallback::RangeScanCallback(bool keyOnly,
+                                     bool collectionsSupported,
+                                     size_t bufferSize,
+                                     uint32_t sampleInterval)
+    : keyOnly(keyOnly),
+      collectionsSupported(collectionsSupported),
+      bufferSize(bufferSize),
+      sampleInterval(sampleInterval),
+      sampler(std::random_device{}()) {
+}
+
+void RangeScanCallback::callback(GetValue& val) {
+    setStatus(ENGINE_SUCCESS);
+    if (sampleInterval > 1 &&
+        std::uniform_int_distribution<uint32_t>(1, sampleInterval)(sampler) !=
+                1) {
+        return;
+    }
+
+    const auto& item = *val.item;
+    const auto docSize =
+            getScanDocumentSize(item, keyOnly, collectionsSupported);
+
+    // Always return at least one document so that every scan progresses
+    if (!buffer.empty() && buffer.size() + docSize > bufferSize) {
+        // Pause the scan, it resumes from this document
+        setStatus(ENGINE_ENOMEM);
+        return;
+    }
+
+    appendScanDocument(buffer, item, keyOnly, collectionsSupported);
+}
+
+RangeScanTask::RangeScanTask(EventuallyPersistentEngine* e,
+                             const void* c,
+                             AddResponseFn resp,
+                             Vbid vbucket,
+                             ByIdRange range,
+                             ValueFilter valFilter,
+                             bool collectionsSupported,
+                             size_t bufferSize,
+                             uint32_t sampleInterval)
+    : GlobalTask(e, TaskId::RangeScanTask, 0, false),
+      cookie(c),
+      description("Running a range scan on " + vbucket.to_string()),
+      response(std::move(resp)),
+      vbid(vbucket),
+      range(std::move(range)),
+      valFilter(valFilter),
+      collectionsSupported(collectionsSupported),
+      bufferSize(bufferSize),
+      sampleInterval(sampleInterval) {
+}
+
+bool RangeScanTask::run() {
+    TRACE_EVENT0("ep-engine/task", "RangeScanTask");
+    ENGINE_ERROR_CODE err = ENGINE_FAILED;
+    auto vb = engine->getKVBucket()->getVBucket(vbid);
+    if (!vb) {
+        err = ENGINE_NOT_MY_VBUCKET;
+    } else if (vb->isBucketCreation()) {
+        // There aren't any documents during the vbucket file creation
+        err = sendResponse({}, {});
+    } else {
+        auto* kvstore = engine->getKVBucket()->getROUnderlying(vbid);
+        auto cb = std::make_unique<RangeScanCallback>(
+                valFilter == ValueFilter::KEYS_ONLY,
+                collectionsSupported,
+                bufferSize,
+                sampleInterval);
+        auto& scanned = *cb;
+        auto scanCtx = kvstore->initByIdScanContext(
+                std::move(cb),
+                std::make_unique<NoLookupCallback>(),
+                vbid,
+                {range},
+                DocumentFilter::NO_DELETES,
+                valFilter);
+        if (scanCtx) {
+            switch (kvstore->scan(*scanCtx)) {
+            case scan_success:
+                err = sendResponse({}, scanned.getBody());
+                break;
+            case scan_again: {
+                // The batch is full, the client resumes from the first
+                // document which didn't fit.
+                auto resumeKey = getClientKey(scanCtx->lastReadKey.getDocKey(),
+                                              collectionsSupported);
+                err = sendResponse({reinterpret_cast<const char*>(
+                                            resumeKey.data()),
+                                    resumeKey.size()},
+                                   scanned.getBody());
+                break;
+            }
+            case scan_failed:
+                break;
+            }
+        }
+    }
+
+    engine->addLookupAllKeys(cookie, err);
+    engine->notifyIOComplete(cookie, err);
+    return false;
+}
+
+ENGINE_ERROR_CODE RangeScanTask::sendResponse(std::string_view resumeKey,
+                                              std::string_view body) {
+    return response(resumeKey,
+                    {}, // extra
+                    body,
+                    PROTOCOL_BINARY_RAW_BYTES,
+                    cb::mcbp::Status::Success,
+                    0,
+                    cookie)
+                   ? ENGINE_SUCCESS
+                   : ENGINE_FAILED;
+}
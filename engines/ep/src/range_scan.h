@@ -0,0 +1,143 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "callbacks.h"
+#include "diskdockey.h"
+#include "globaltask.h"
+#include "kvstore.h"
+
+#include <memcached/engine_common.h>
+#include <random>
+#include <vector>
+
+class EventuallyPersistentEngine;
+class Item;
+
+/**
+ * @returns the size of the document in the encoding of appendScanDocument()
+ */
+size_t getScanDocumentSize(const Item& item,
+                           bool keyOnly,
+                           bool collectionsSupported);
+
+/**
+ * Append the document to a response body in the encoding described by
+ * RangeScanCallback (which SampleDocuments shares).
+ *
+ * @param keyOnly only encode the key of the document
+ * @param collectionsSupported encode the key with its collection ID
+ */
+void appendScanDocument(std::vector<char>& buffer,
+                        const Item& item,
+                        bool keyOnly,
+                        bool collectionsSupported);
+
+/**
+ * Callback of a RangeScanTask, encoding each document read from disk into
+ * the response body until the body reaches the requested buffer size.
+ *
+ * The body is a sequence of documents, each of which is:
+ *   key length (uint16_t), key
+ * followed (unless the scan is key-only) by:
+ *   flags (uint32_t), expiry (uint32_t), seqno (uint64_t), cas (uint64_t),
+ *   datatype (uint8_t), value length (uint32_t), value
+ * with all integers in network byte order.
+ */
+class RangeScanCallback : public StatusCallback<GetValue> {
+public:
+    /**
+     * @param keyOnly only encode the keys of the documents
+     * @param collectionsSupported encode keys with their collection ID
+     *        (otherwise the scan is of the default collection)
+     * @param bufferSize size at which the body is considered full
+     * @param sampleInterval encode (on average) one in this many documents
+     */
+    RangeScanCallback(bool keyOnly,
+                      bool collectionsSupported,
+                      size_t bufferSize,
+                      uint32_t sampleInterval);
+
+    void callback(GetValue& val) override;
+
+    std::string_view getBody() const {
+        return {buffer.data(), buffer.size()};
+    }
+
+private:
+    const bool keyOnly;
+    const bool collectionsSupported;
+    const size_t bufferSize;
+    const uint32_t sampleInterval;
+    std::mt19937 sampler;
+    std::vector<char> buffer;
+};
+
+/**
+ * Task which scans one batch of a range of keys in a vBucket's ById index
+ * and sends the documents found to the connection. When the batch fills up
+ * before the range is exhausted, the response key is the key to resume the
+ * scan from.
+ */
+class RangeScanTask : public GlobalTask {
+public:
+    RangeScanTask(EventuallyPersistentEngine* e,
+                  const void* c,
+                  AddResponseFn resp,
+                  Vbid vbucket,
+                  ByIdRange range,
+                  ValueFilter valFilter,
+                  bool collectionsSupported,
+                  size_t bufferSize,
+                  uint32_t sampleInterval);
+
+    std::string getDescription() override {
+        return description;
+    }
+
+    std::chrono::microseconds maxExpectedDuration() override {
+        // A scan is limited by its buffer size, so by default returns ~1MB
+        return std::chrono::milliseconds(100);
+    }
+
+    bool run() override;
+
+    /// Buffer size of a request which doesn't specify one
+    static const size_t defaultBufferSize = 1024 * 1024;
+
+    /// Largest buffer size a request may use
+    static const size_t maxBufferSize = 20 * 1024 * 1024;
+
+private:
+    /**
+     * Send the response to the connection
+     * @param resumeKey key to resume the scan from (empty if complete)
+     * @param body the encoded documents
+     */
+    ENGINE_ERROR_CODE sendResponse(std::string_view resumeKey,
+                                   std::string_view body);
+
+    const void* cookie;
+    const std::string description;
+    AddResponseFn response;
+    Vbid vbid;
+    ByIdRange range;
+    const ValueFilter valFilter;
+    const bool collectionsSupported;
+    const size_t bufferSize;
+    const uint32_t sampleInterval;
+};
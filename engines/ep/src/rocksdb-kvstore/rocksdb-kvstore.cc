@@ -701,30 +701,54 @@ GetValue RocksDBKVStore::getWithHeader(const DiskDocKey& key,
 }
 
 void RocksDBKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
-    // TODO RDB: RocksDB supports a multi get which we should use here.
+    if (itms.empty()) {
+        return;
+    }
+
+    // Look up the whole batch with a single MultiGet, which groups the keys
+    // by SST file and data block, reading each block once and the blocks of
+    // a file together rather than one key at a time.
+    std::vector<rocksdb::Slice> keys;
+    keys.reserve(itms.size());
+    for (const auto& it : itms) {
+        keys.push_back(getKeySlice(it.first));
+    }
+    std::vector<rocksdb::PinnableSlice> values(keys.size());
+    std::vector<rocksdb::Status> statuses(keys.size());
+
+    const auto vbh = getVBHandle(vb);
+    rdb->MultiGet(rocksdb::ReadOptions(),
+                  vbh->defaultCFH.get(),
+                  keys.size(),
+                  keys.data(),
+                  values.data(),
+                  statuses.data(),
+                  false /*sorted_input*/);
+
+    size_t i = 0;
     for (auto& it : itms) {
-        auto& key = it.first;
-        rocksdb::Slice keySlice = getKeySlice(key);
-        rocksdb::PinnableSlice value;
-        const auto vbh = getVBHandle(vb);
-        rocksdb::Status s = rdb->Get(rocksdb::ReadOptions(),
-                                     vbh->defaultCFH.get(),
-                                     keySlice,
-                                     &value);
-        if (s.ok()) {
+        const auto& status = statuses[i];
+        const auto& value = values[i];
+        if (status.ok()) {
             it.second.value =
-                    makeGetValue(vb, key, value, it.second.isMetaOnly);
-            GetValue* rv = &it.second.value;
-            for (auto& fetch : it.second.bgfetched_list) {
-                fetch->value = rv;
-            }
+                    makeGetValue(vb, it.first, value, it.second.isMetaOnly);
             ++st.io_bg_fetch_docs_read;
-            st.io_bgfetch_doc_bytes += keySlice.size() + value.size();
+            st.io_bgfetch_doc_bytes += keys[i].size() + value.size();
         } else {
-            for (auto& fetch : it.second.bgfetched_list) {
-                fetch->value->setStatus(ENGINE_KEY_ENOENT);
+            if (!status.IsNotFound()) {
+                ++st.numGetFailure;
+                logger.warn(
+                        "RocksDBKVStore::getMulti: MultiGet error:{}, {}",
+                        status.ToString(),
+                        vb);
             }
+            it.second.value.setStatus(ENGINE_KEY_ENOENT);
+        }
+        GetValue* rv = &it.second.value;
+        for (auto& fetch : it.second.bgfetched_list) {
+            fetch->value = rv;
         }
+        ++i;
     }
 }
 
@@ -914,6 +938,39 @@ bool RocksDBKVStore::getStat(const char* name_, size_t& value) {
                                      value);
     }
 
+    // Block Cache usage (the cache is shared by all of the shard's DBs)
+    else if (name == "block_cache_usage") {
+        if (!blockCache) {
+            return false;
+        }
+        value = blockCache->GetUsage();
+        return true;
+    } else if (name == "block_cache_pinned_usage") {
+        if (!blockCache) {
+            return false;
+        }
+        value = blockCache->GetPinnedUsage();
+        return true;
+    } else if (name == "block_cache_capacity") {
+        if (!blockCache) {
+            return false;
+        }
+        value = blockCache->GetCapacity();
+        return true;
+    }
+
+    // Bloom filter effectiveness
+    else if (name == "rocksdb.bloom.filter.useful") {
+        return getStatFromStatistics(rocksdb::Tickers::BLOOM_FILTER_USEFUL,
+                                     value);
+    } else if (name == "rocksdb.bloom.filter.full.positive") {
+        return getStatFromStatistics(
+                rocksdb::Tickers::BLOOM_FILTER_FULL_POSITIVE, value);
+    } else if (name == "rocksdb.bloom.filter.full.true.positive") {
+        return getStatFromStatistics(
+                rocksdb::Tickers::BLOOM_FILTER_FULL_TRUE_POSITIVE, value);
+    }
+
     // Disk Usage per Column Family
     else if (name == "default_kTotalSstFilesSize") {
         return getStatFromProperties(
@@ -943,12 +1000,10 @@ StorageProperties RocksDBKVStore::getStorageProperties() {
     StorageProperties rv(StorageProperties::EfficientVBDump::Yes,
                          StorageProperties::EfficientVBDeletion::Yes,
                          StorageProperties::PersistedDeletion::No,
-                         // TODO RDB: Not strictly true, multiGet
-                         // does not yet use the underlying multi get
-                         // of RocksDB
                          StorageProperties::EfficientGet::Yes,
                          StorageProperties::ConcurrentWriteCompact::Yes,
-                         StorageProperties::ByIdScan::No);
+                         StorageProperties::ByIdScan::No,
+                         StorageProperties::EfficientCollectionDrop::No);
     return rv;
 }
 
@@ -1834,6 +1889,34 @@ void RocksDBKVStore::addStats(const AddStatFn& add_stat,
         add_prefixed_stat(
                 prefix, "rocksdb_block_cache_filter_miss", val, add_stat, c);
     }
+    // Block Cache usage
+    if (getStat("block_cache_usage", val)) {
+        add_prefixed_stat(prefix, "rocksdb_block_cache_usage", val, add_stat, c);
+    }
+    if (getStat("block_cache_pinned_usage", val)) {
+        add_prefixed_stat(
+                prefix, "rocksdb_block_cache_pinned_usage", val, add_stat, c);
+    }
+    if (getStat("block_cache_capacity", val)) {
+        add_prefixed_stat(
+                prefix, "rocksdb_block_cache_capacity", val, add_stat, c);
+    }
+    // Bloom filter effectiveness
+    if (getStat("rocksdb.bloom.filter.useful", val)) {
+        add_prefixed_stat(
+                prefix, "rocksdb_bloom_filter_useful", val, add_stat, c);
+    }
+    if (getStat("rocksdb.bloom.filter.full.positive", val)) {
+        add_prefixed_stat(
+                prefix, "rocksdb_bloom_filter_full_positive", val, add_stat, c);
+    }
+    if (getStat("rocksdb.bloom.filter.full.true.positive", val)) {
+        add_prefixed_stat(prefix,
+                          "rocksdb_bloom_filter_full_true_positive",
+                          val,
+                          add_stat,
+                          c);
+    }
     // BlockCache Hit Ratio
     size_t hit = 0;
     size_t miss = 0;
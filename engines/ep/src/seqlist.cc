@@ -59,3 +59,7 @@ seqno_t SequenceList::RangeIterator::getEarlySnapShotEnd() const {
 uint64_t SequenceList::RangeIterator::getMaxVisibleSeqno() const {
     return rangeIterImpl->getMaxVisibleSeqno();
 }
+
+void SequenceList::RangeIterator::truncate(seqno_t lastSeqno) {
+    rangeIterImpl->truncate(lastSeqno);
+}
@@ -125,6 +125,12 @@ protected:
         virtual seqno_t getEarlySnapShotEnd() const = 0;
 
         virtual uint64_t getMaxVisibleSeqno() const = 0;
+
+        /**
+         * Stop the iteration after lastSeqno, releasing the range lock over
+         * any later seqnos. No-op if lastSeqno >= back().
+         */
+        virtual void truncate(seqno_t lastSeqno) = 0;
     };
 
 public:
@@ -135,6 +141,18 @@ public:
      */
     enum class UpdateStatus { Success, Append };
 
+    /**
+     * Which items a (non-resumed) purgeTombstones() needs to look at.
+     */
+    enum class PurgeScope {
+        /// Every item in the list; needed to find the items of dropped
+        /// collections, which are not stale.
+        All,
+        /// Only the items from the lowest seqno item marked stale since the
+        /// last purge.
+        StaleOnly
+    };
+
     /**
      * RangeIterator for a SequenceList objects.
      *
@@ -225,6 +243,15 @@ public:
 
         uint64_t getMaxVisibleSeqno() const;
 
+        /**
+         * Shrink the iterator (and the range it holds locked on the list) to
+         * end after lastSeqno (inclusive). Items after lastSeqno are then
+         * free to be de-duplicated by front end ops rather than being left
+         * as stale items until the iterator completes.
+         * If lastSeqno < curr() the iteration ends immediately.
+         */
+        void truncate(seqno_t lastSeqno);
+
     private:
         /* Pointer to the abstract class of range iterator implementation */
         std::unique_ptr<RangeIteratorImpl> rangeIterImpl;
@@ -377,6 +404,13 @@ public:
 
             std::function<bool()> shouldPause = []() { return false; }) = 0;
 
+    /**
+     * Makes the next PurgeScope::StaleOnly purge visit the whole list, as
+     * items which need purging but are not stale (those of a dropped
+     * collection) may now be anywhere in it.
+     */
+    virtual void requestFullPurge() = 0;
+
     /**
      * Updates the number of deleted items in the sequence list whenever
      * an item is modified.
@@ -21,6 +21,8 @@
 
 #include <platform/cb_arena_malloc.h>
 
+#include <iterator>
+
 #ifndef DEFAULT_MAX_DATA_SIZE
 /* Something something something ought to be enough for anybody */
 #define DEFAULT_MAX_DATA_SIZE (std::numeric_limits<size_t>::max())
@@ -39,6 +41,8 @@ EPStats::EPStats()
       diskQueueSize(0),
       flusher_todo(0),
       flusherCommits(0),
+      durabilityLogWrites(0),
+      durabilityLogWriteFailed(0),
       cumulativeFlushTime(0),
       cumulativeCommitTime(0),
       tooYoung(0),
@@ -66,17 +70,22 @@ EPStats::EPStats()
       cursorDroppingUThreshold(0),
       cursorsDropped(0),
       cursorMemoryFreed(0),
+      cursorDropBackfillItems(0),
       pagerRuns(0),
       expiryPagerRuns(0),
+      expiryPagerFullScans(0),
       freqDecayerRuns(0),
       itemsExpelledFromCheckpoints(0),
       itemsRemovedFromCheckpoints(0),
       numValueEjects(0),
       numFailedEjects(0),
+      numEjectsOnPersist(0),
       numNotMyVBuckets(0),
+      htHugePageBytes(0),
       forceShutdown(false),
       oom_errors(0),
       tmp_oom_errors(0),
+      tmp_oom_collection_quota_errors(0),
       pendingOps(0),
       pendingOpsTotal(0),
       pendingOpsMax(0),
@@ -84,6 +93,8 @@ EPStats::EPStats()
       pendingCompactions(0),
       bg_fetched(0),
       bg_meta_fetched(0),
+      bg_prefetches(0),
+      bg_fetch_deadline_exceeded(0),
       numRemainingBgItems(0),
       numRemainingBgJobs(0),
       bgNumOperations(0),
@@ -103,12 +114,14 @@ EPStats::EPStats()
       numOpsSetMeta(0),
       numOpsDelMeta(0),
       numOpsSetMetaResolutionFailed(0),
+      numOpsSetMetaResolvedByBounds(0),
       numOpsDelMetaResolutionFailed(0),
       numOpsSetRetMeta(0),
       numOpsDelRetMeta(0),
       numOpsGetMetaOnSetWithMeta(0),
       alogRuns(0),
       accessScannerSkips(0),
+      alogNumVBucketsCopied(0),
       alogNumItems(0),
       alogTime(0),
       alogRuntime(0),
@@ -118,6 +131,8 @@ EPStats::EPStats()
       defragNumVisited(0),
       defragNumMoved(0),
       defragStoredValueNumMoved(0),
+      defragNumSkipped(0),
+      defragNumDenseSkipped(0),
       compressorNumVisited(0),
       compressorNumCompressed(0),
       dirtyAgeHisto(),
@@ -125,6 +140,12 @@ EPStats::EPStats()
       timingLog(nullptr),
       maxDataSize(DEFAULT_MAX_DATA_SIZE) {
     trackCollectionStats(CollectionID::Default);
+    for (auto& core : coreLocal) {
+        core->currentSize.setMergeTarget(&mergedMemoryUsed,
+                                         &memUsedMergeThreshold);
+        core->memOverhead.setMergeTarget(&mergedMemoryUsed,
+                                         &memUsedMergeThreshold);
+    }
 }
 
 EPStats::~EPStats() {
@@ -137,6 +158,21 @@ void EPStats::setMaxDataSize(size_t size) {
     }
 }
 
+void MemoryCounter::setMergeTarget(std::atomic<int64_t>* target,
+                                   const std::atomic<int64_t>* threshold) {
+    this->target = target;
+    this->threshold = threshold;
+    target->fetch_add(load());
+}
+
+void EPStats::setMemUsedMergeThreshold(size_t maxDataSize, float percent) {
+    const auto cores =
+            std::max(std::distance(coreLocal.begin(), coreLocal.end()),
+                     std::ptrdiff_t(1));
+    const auto total = double(maxDataSize) * percent / 100.0;
+    memUsedMergeThreshold = int64_t(total / cores);
+}
+
 size_t EPStats::getPreciseTotalMemoryUsed() const {
     if (isMemoryTrackingEnabled()) {
         return cb::ArenaMalloc::getPreciseAllocated(arena);
@@ -144,6 +180,16 @@ size_t EPStats::getPreciseTotalMemoryUsed() const {
     return size_t(std::max(size_t(0), getCurrentSize() + getMemOverhead()));
 }
 
+double EPStats::getArenaFragmentationRatio() const {
+    // {allocated, resident}
+    const auto fragStats = cb::ArenaMalloc::getFragmentationStats(arena);
+    if (fragStats.second == 0 || fragStats.second < fragStats.first) {
+        return 0.0;
+    }
+    return double(fragStats.second - fragStats.first) /
+           double(fragStats.second);
+}
+
 size_t EPStats::getCurrentSize() const {
     int64_t result = 0;
     for (const auto& core : coreLocal) {
@@ -263,15 +309,20 @@ void EPStats::reset() {
     commit_time.store(0);
     cursorsDropped.store(0);
     cursorMemoryFreed.store(0);
+    cursorDropBackfillItems.store(0);
     pagerRuns.store(0);
     expiryPagerRuns.store(0);
+    expiryPagerFullScans.store(0);
     freqDecayerRuns.store(0);
     itemsExpelledFromCheckpoints.store(0);
     itemsRemovedFromCheckpoints.store(0);
     numValueEjects.store(0);
     numFailedEjects.store(0);
+    numEjectsOnPersist.store(0);
     numNotMyVBuckets.store(0);
     bg_fetched.store(0);
+    bg_prefetches.store(0);
+    bg_fetch_deadline_exceeded.store(0);
     bgNumOperations.store(0);
     bgWait.store(0);
     bgLoad.store(0);
@@ -281,6 +332,7 @@ void EPStats::reset() {
     bgMaxLoad.store(0);
     oom_errors.store(0);
     tmp_oom_errors.store(0);
+    tmp_oom_collection_quota_errors.store(0);
     pendingOps.store(0);
     pendingOpsTotal.store(0);
     pendingOpsMax.store(0);
@@ -289,20 +341,30 @@ void EPStats::reset() {
     vbucketDelTotWalltime.store(0);
 
     alogRuns.store(0);
+    alogNumVBucketsCopied.store(0);
     accessScannerSkips.store(0), defragNumVisited.store(0),
             defragNumMoved.store(0);
+    defragNumSkipped.store(0);
+    defragNumDenseSkipped.store(0);
 
     compressorNumVisited.store(0);
     compressorNumCompressed.store(0);
 
     pendingOpsHisto.reset();
+    lockProfiler.reset();
     bgWaitHisto.reset();
     bgLoadHisto.reset();
+    for (auto& histo : bgFetchPriorityHisto) {
+        histo.reset();
+    }
     setWithMetaHisto.reset();
     accessScannerHisto.reset();
     checkpointRemoverHisto.reset();
     itemPagerHisto.reset();
     expiryPagerHisto.reset();
+    rollbackDiskHisto.reset();
+    rollbackUnpersistedHisto.reset();
+    rollbackPreparesHisto.reset();
     getVbucketCmdHisto.reset();
     setVbucketCmdHisto.reset();
     delVbucketCmdHisto.reset();
@@ -331,6 +393,8 @@ void EPStats::reset() {
     for (auto& hist : syncWriteCommitTimes) {
         hist.reset();
     }
+    syncWriteLocalAckTimes.reset();
+    syncWriteRemoteAckTimes.reset();
 }
 
 size_t EPStats::getMemFootPrint() const {
@@ -344,13 +408,21 @@ size_t EPStats::getMemFootPrint() const {
         taskHistogramSizes +=
                 taskRuntimeHisto.size() * taskRuntimeHisto[0].getMemFootPrint();
     }
+    size_t bgFetchHistogramSizes = 0;
+    for (const auto& histo : bgFetchPriorityHisto) {
+        bgFetchHistogramSizes += histo.getMemFootPrint();
+    }
 
     return pendingOpsHisto.getMemFootPrint() + bgWaitHisto.getMemFootPrint() +
+           bgFetchHistogramSizes +
            bgLoadHisto.getMemFootPrint() + setWithMetaHisto.getMemFootPrint() +
            accessScannerHisto.getMemFootPrint() +
            checkpointRemoverHisto.getMemFootPrint() +
            itemPagerHisto.getMemFootPrint() +
            expiryPagerHisto.getMemFootPrint() +
+           rollbackDiskHisto.getMemFootPrint() +
+           rollbackUnpersistedHisto.getMemFootPrint() +
+           rollbackPreparesHisto.getMemFootPrint() +
            getVbucketCmdHisto.getMemFootPrint() +
            setVbucketCmdHisto.getMemFootPrint() +
            delVbucketCmdHisto.getMemFootPrint() +
@@ -17,7 +17,9 @@
 
 #pragma once
 
+#include "ep_types.h"
 #include "hdrhistogram.h"
+#include "lock_profiler.h"
 #include "objectregistry.h"
 
 #include <folly/Synchronized.h>
@@ -35,6 +37,7 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <cstdlib>
 #include <mutex>
 
 // If we're running with TSAN/ASAN our global new operator replacement does
@@ -46,6 +49,73 @@ constexpr bool GlobalNewDeleteIsOurs = false;
 constexpr bool GlobalNewDeleteIsOurs = true;
 #endif
 
+/**
+ * A core-local counter of memory, whose changes are also merged into a
+ * counter shared by all of the cores once they add up (on this core) to more
+ * than a threshold. Reading the shared counter doesn't have to touch the
+ * cache line of every core, and it lags behind the sum of the core-local
+ * counters by at most the threshold per core.
+ *
+ * The shared counter and the threshold are set by EPStats; until then the
+ * changes aren't merged anywhere.
+ */
+class MemoryCounter {
+public:
+    int64_t load() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    operator int64_t() const {
+        return load();
+    }
+
+    void fetch_add(int64_t delta) {
+        value.fetch_add(delta, std::memory_order_relaxed);
+        merge(delta);
+    }
+
+    void fetch_sub(int64_t delta) {
+        fetch_add(-delta);
+    }
+
+    void store(int64_t newValue) {
+        merge(newValue - value.exchange(newValue, std::memory_order_relaxed));
+    }
+
+    MemoryCounter& operator=(int64_t newValue) {
+        store(newValue);
+        return *this;
+    }
+
+    /**
+     * Merge the changes into the given counter once they add up to more than
+     * the given threshold.
+     */
+    void setMergeTarget(std::atomic<int64_t>* target,
+                        const std::atomic<int64_t>* threshold);
+
+private:
+    void merge(int64_t delta) {
+        if (!target) {
+            return;
+        }
+        const auto pending =
+                unmerged.fetch_add(delta, std::memory_order_relaxed) + delta;
+        if (std::abs(pending) > threshold->load(std::memory_order_relaxed)) {
+            // Take all of the pending changes (which may include the changes
+            // of another thread of the core getting here too)
+            target->fetch_add(unmerged.exchange(0, std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<int64_t> value{0};
+    // The changes to value not yet merged into the target
+    std::atomic<int64_t> unmerged{0};
+    std::atomic<int64_t>* target{nullptr};
+    const std::atomic<int64_t>* threshold{nullptr};
+};
+
 /**
  * Core-local statistics
  *
@@ -76,7 +146,7 @@ public:
     using Counter = cb::RelaxedAtomic<int64_t>;
 
     //! Total size of stored objects.
-    Counter currentSize;
+    MemoryCounter currentSize;
 
     //! Total number of blob objects
     Counter numBlob;
@@ -94,7 +164,7 @@ public:
     Counter totalStoredValSize;
 
     //! Amount of memory used to track items and what-not.
-    Counter memOverhead;
+    MemoryCounter memOverhead;
 
     //! Total number of Item objects
     Counter numItem;
@@ -146,7 +216,7 @@ public:
      *
      * Note that some non-production configurations the ArenaMalloc cannot track
      * deallocation, so in that case just return the getCurrentSize() +
-     * getMemOverhead()
+     * getMemOverhead() as merged from the cores (getMergedMemoryUsed).
      *
      * @return a estimate of the total memory allocated to the engine
      */
@@ -154,9 +224,26 @@ public:
         if (isMemoryTrackingEnabled()) {
             return cb::ArenaMalloc::getEstimatedAllocated(arena);
         }
-        return size_t(std::max(size_t(0), getCurrentSize() + getMemOverhead()));
+        return getMergedMemoryUsed();
+    }
+
+    /**
+     * @return getCurrentSize() + getMemOverhead() as merged from the
+     * core-local counters, lagging behind by at most the merge threshold per
+     * core (see setMemUsedMergeThreshold).
+     */
+    size_t getMergedMemoryUsed() const {
+        const auto merged = mergedMemoryUsed.load(std::memory_order_relaxed);
+        return size_t(std::max(int64_t(0), merged));
     }
 
+    /**
+     * Set how far getMergedMemoryUsed may lag behind, as a percentage of the
+     * bucket quota shared by the cores (the same threshold as the
+     * ArenaMalloc estimate, mem_used_merge_threshold_percent).
+     */
+    void setMemUsedMergeThreshold(size_t maxDataSize, float percent);
+
     /**
      * @return a "precise" memory used value. This asks the underlying platform
      * ArenaMalloc how much is allocated to the engine. When this method is
@@ -164,6 +251,12 @@ public:
      */
     size_t getPreciseTotalMemoryUsed() const;
 
+    /**
+     * @returns the fraction of the resident memory of the bucket's arena
+     * which isn't allocated (0 if unknown)
+     */
+    double getArenaFragmentationRatio() const;
+
     /// @returns total size of stored objects.
     size_t getCurrentSize() const;
 
@@ -256,6 +349,11 @@ public:
     Counter flusher_todo;
     //! Number of transaction commits.
     Counter flusherCommits;
+    //! Number of flush batches written to the DurabilityLog.
+    Counter durabilityLogWrites;
+    //! Number of flush batches which failed to be written to the
+    //! DurabilityLog.
+    Counter durabilityLogWriteFailed;
     //! Total time spent flushing.
     Counter cumulativeFlushTime;
     //! Total time spent committing.
@@ -323,10 +421,16 @@ public:
     //! Amount of memory we have freed by dropping cursors
     std::atomic<size_t> cursorMemoryFreed;
 
+    //! Estimated number of items the streams of dropped cursors must backfill
+    Counter cursorDropBackfillItems;
+
     //! Number of times we needed to kick in the pager
     Counter pagerRuns;
     //! Number of times the expiry pager runs for purging expired items
     Counter expiryPagerRuns;
+    //! Number of vBuckets the expiry pager fully scanned to rebuild the
+    //! expiry index
+    Counter expiryPagerFullScans;
     //! Number of times the item frequency decayer runs
     Counter freqDecayerRuns;
     //! The number items expelled from checkpoints
@@ -337,18 +441,30 @@ public:
     Counter numValueEjects;
     //! Number of times a value could not be ejected
     Counter numFailedEjects;
+    //! Number of items ejected by the flusher (evict-on-persist collections)
+    Counter numEjectsOnPersist;
     //! Number of times "Not my bucket" happened
     Counter numNotMyVBuckets;
+    //! Bytes of HashTable bucket arrays allocated with huge pages (gauge)
+    Counter htHugePageBytes;
 
     //! Core-local statistics
     CoreStore<folly::cacheline_aligned<CoreLocalStats>> coreLocal;
 
+    //! The currentSize and memOverhead of the cores, see MemoryCounter
+    std::atomic<int64_t> mergedMemoryUsed{0};
+    //! How far each core may let the merged memory lag behind
+    std::atomic<int64_t> memUsedMergeThreshold{0};
+
     //! Whether or not to force engine shutdown.
     std::atomic<bool> forceShutdown;
     //! Number of times unrecoverable oom errors happened while processing operations.
     Counter oom_errors;
     //! Number of times temporary oom errors encountered while processing operations.
     Counter tmp_oom_errors;
+    //! Number of temporary oom errors due to a collection being over the
+    //! per-collection memory quota (a subset of tmp_oom_errors).
+    Counter tmp_oom_collection_quota_errors;
 
     //! Number of ops blocked on all vbuckets in pending state
     Counter pendingOps;
@@ -369,6 +485,12 @@ public:
     Counter bg_fetched;
     //! Number of times meta background fetches occurred.
     Counter bg_meta_fetched;
+    //! Number of background fetches queued as a prefetch (a hint from the
+    //! front end that the key is about to be requested)
+    Counter bg_prefetches;
+    //! Number of background fetches dropped as the deadline of the request
+    //! waiting for them passed before they started
+    Counter bg_fetch_deadline_exceeded;
     //! Number of remaining bg fetch items
     Counter numRemainingBgItems;
     //! Number of remaining bg fetch jobs.
@@ -400,6 +522,11 @@ public:
     //! Histogram of background wait loads.
     Hdr1sfMicroSecHistogram bgLoadHisto;
 
+    //! Histograms of the time from queueing a background fetch until it
+    //! completed, indexed by its BgFetchPriority.
+    std::array<Hdr1sfMicroSecHistogram, NumBgFetchPriorities>
+            bgFetchPriorityHisto;
+
     //! Max wall time of deleting a vbucket
     std::atomic<hrtime_t> vbucketDelMaxWalltime;
     //! Total wall time of deleting vbuckets
@@ -417,6 +544,13 @@ public:
     //! Histogram of expiry pager run times
     Hdr1sfMicroSecHistogram expiryPagerHisto;
 
+    //! Histograms of the phases of a vBucket rollback: rolling back the
+    //! disk (and the items it discarded), reverting the unpersisted items,
+    //! and reloading the prepared SyncWrites.
+    Hdr1sfMicroSecHistogram rollbackDiskHisto;
+    Hdr1sfMicroSecHistogram rollbackUnpersistedHisto;
+    Hdr1sfMicroSecHistogram rollbackPreparesHisto;
+
     //! Percentage of memory in use before we throttle replication input
     std::atomic<double> replicationThrottleThreshold;
 
@@ -435,6 +569,9 @@ public:
     Counter  numOpsDelMeta;
     //! The number of failed set meta ops due to conflict resoltion
     Counter numOpsSetMetaResolutionFailed;
+    //! The number of set meta ops for non-resident keys resolved by the
+    //! vBucket's meta bounds (without fetching the metadata)
+    Counter numOpsSetMetaResolvedByBounds;
     //! The number of failed del meta ops due to conflict resoltion
     Counter numOpsDelMetaResolutionFailed;
     //! The number of set returning meta operations
@@ -448,6 +585,9 @@ public:
     Counter alogRuns;
     //! The number of times the access scanner skips generating access log
     Counter accessScannerSkips;
+    //! The number of vBuckets the access scanner copied from the previous
+    //! access log instead of visiting
+    Counter alogNumVBucketsCopied;
     //! The number of items that last access scanner task swept to log
     Counter alogNumItems;
     //! The next access scanner task schedule time (GMT)
@@ -480,6 +620,18 @@ public:
      */
     Counter defragStoredValueNumMoved;
 
+    /**
+     * The number of defragmenter task passes skipped, as the memory of the
+     * bucket wasn't fragmented enough.
+     */
+    Counter defragNumSkipped;
+
+    /**
+     * The number of objects old enough to be moved but left in place by the
+     * defragmenter task, as they were on a dense slab.
+     */
+    Counter defragNumDenseSkipped;
+
     Counter compressorNumVisited;
     Counter compressorNumCompressed;
 
@@ -582,6 +734,9 @@ public:
     // ! Histograms of various task run times, one per Task.
     std::vector<Hdr1sfMicroSecHistogram> taskRuntimeHisto;
 
+    /// The contention on the major locks (see "lock-profile" stats)
+    LockProfiler lockProfiler;
+
     //! Checkpoint Cursor histograms
     Hdr1sfMicroSecHistogram persistenceCursorGetItemsHisto;
     Hdr1sfMicroSecHistogram dcpCursorsGetItemsHisto;
@@ -594,6 +749,15 @@ public:
                size_t(cb::durability::Level::PersistToMajority)>
             syncWriteCommitTimes;
 
+    /// Histograms of the durations from when a SyncWrite is added to the
+    /// durability monitor up to when it is acked by the active itself
+    /// (local queueing and, for persist levels, local persistence) and by each
+    /// replica (DCP send, replica receive and replica persistence).
+    /// Together with syncWriteCommitTimes they break down where the time of a
+    /// SyncWrite goes.
+    Hdr1sfMicroSecHistogram syncWriteLocalAckTimes;
+    Hdr1sfMicroSecHistogram syncWriteRemoteAckTimes;
+
     cb::ArenaMallocClient arena;
 
     //! Reset all stats to reasonable values.
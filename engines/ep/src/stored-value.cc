@@ -39,7 +39,8 @@ const int64_t StoredValue::state_temp_init = -5;
 StoredValue::StoredValue(const Item& itm,
                          UniquePtr n,
                          EPStats& stats,
-                         bool isOrdered)
+                         bool isOrdered,
+                         uint8_t inlineCapacity)
     : value(itm.getValue()),
       chain_next_or_replacement(std::move(n)),
       cas(itm.getCas()),
@@ -49,7 +50,9 @@ StoredValue::StoredValue(const Item& itm,
       revSeqno(itm.getRevSeqno()),
       datatype(itm.getDataType()),
       deletionSource(0),
-      committed(static_cast<uint8_t>(CommittedState::CommittedViaMutation)) {
+      committed(static_cast<uint8_t>(CommittedState::CommittedViaMutation)),
+      freqDecayEpoch(0),
+      inlineValueCapacity(inlineCapacity) {
     // Initialise bit fields
     setDeletedPriv(itm.isDeleted());
     setOrdered(isOrdered);
@@ -63,6 +66,9 @@ StoredValue::StoredValue(const Item& itm,
     // object.
     new (key()) SerialisedDocKey(itm.getKey());
 
+    // (and the value in the inline value buffer after the key)
+    storeValueInline(itm.getValue());
+
     if (isTempInitialItem()) {
         markClean();
     } else {
@@ -84,7 +90,10 @@ StoredValue::~StoredValue() {
     ObjectRegistry::onDeleteStoredValue(this);
 }
 
-StoredValue::StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
+StoredValue::StoredValue(const StoredValue& other,
+                         UniquePtr n,
+                         EPStats& stats,
+                         uint8_t inlineCapacity)
     : value(other.value), // Implicitly also copies the frequency counter
       chain_next_or_replacement(std::move(n)),
       cas(other.cas),
@@ -94,7 +103,9 @@ StoredValue::StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
       exptime(other.exptime),
       flags(other.flags),
       revSeqno(other.revSeqno),
-      datatype(other.datatype) {
+      datatype(other.datatype),
+      freqDecayEpoch(other.freqDecayEpoch),
+      inlineValueCapacity(inlineCapacity) {
     setDirty(other.isDirty());
     setDeletedPriv(other.isDeleted());
     setOrdered(other.isOrdered());
@@ -106,6 +117,10 @@ StoredValue::StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
     // object.
     StoredDocKey sKey(other.getKey());
     new (key()) SerialisedDocKey(sKey);
+    if (other.hasInlineValue()) {
+        // Don't keep the other StoredValue's memory referenced
+        storeValueInline(other.value);
+    }
 
     if (isDeleted()) {
         setDeletionSource(other.getDeletionSource());
@@ -141,7 +156,9 @@ void StoredValue::restoreValue(const Item& itm) {
     auto freq = itm.getFreqCounterValue();
     auto age = getAge();
 
-    value = itm.getValue();
+    if (!storeValueInline(itm.getValue())) {
+        value = itm.getValue();
+    }
 
     setFreqCounterValue(freq);
     setCommitted(itm.getCommitted());
@@ -184,8 +201,39 @@ bool StoredValue::del(DeleteSource delSource) {
     }
 }
 
-size_t StoredValue::getRequiredStorage(const DocKey& key) {
-    return sizeof(StoredValue) + SerialisedDocKey::getObjectSize(key.size());
+size_t StoredValue::getRequiredStorage(const DocKey& key,
+                                       size_t inlineValueCapacity) {
+    const auto size =
+            sizeof(StoredValue) + SerialisedDocKey::getObjectSize(key.size());
+    if (inlineValueCapacity == 0) {
+        return size;
+    }
+    return getInlineValueOffset(size) +
+           Blob::getInlineStorage(inlineValueCapacity);
+}
+
+bool StoredValue::storeValueInline(const value_t& newValue) {
+    if (!newValue || newValue->valueSize() > inlineValueCapacity) {
+        return false;
+    }
+    if (newValue.get().get() == getInlineValueBuffer()) {
+        return true;
+    }
+    if (hasInlineValue() && value.refCount() > 1) {
+        // Someone is still looking at the current inline value
+        return false;
+    }
+
+    // newValue may be a reference to our value, keep it alive while copying
+    const value_t source = newValue;
+    // Maintain the tag
+    auto tag = getValueTag();
+    value.reset();
+    auto* blob = Blob::NewInline(const_cast<void*>(getInlineValueBuffer()),
+                                 source->getData(),
+                                 source->valueSize());
+    value.reset({blob, tag.raw});
+    return true;
 }
 
 std::unique_ptr<Item> StoredValue::toItem(
@@ -239,6 +287,10 @@ std::unique_ptr<Item> StoredValue::toItemAbort(Vbid vbid) const {
 }
 
 void StoredValue::reallocate() {
+    if (hasInlineValue()) {
+        // Moves with the StoredValue itself
+        return;
+    }
     // Allocate a new Blob for this stored value; copy the existing Blob to
     // the new one and free the old.
     replaceValue(std::unique_ptr<Blob>{Blob::Copy(*value)});
@@ -312,11 +364,18 @@ bool StoredValue::deleteImpl(DeleteSource delSource) {
 std::unique_ptr<Item> StoredValue::toItemBase(Vbid vbid,
                                               HideLockedCas hideLockedCas,
                                               IncludeValue includeValue) const {
+    value_t itemValue;
+    if (includeValue == IncludeValue::Yes) {
+        // The Item may outlive the inline value buffer, so it gets a copy
+        itemValue = hasInlineValue()
+                            ? value_t{TaggedPtr<Blob>(Blob::Copy(*value))}
+                            : value;
+    }
     auto item = std::make_unique<Item>(
             getKey(),
             getFlags(),
             getExptime(),
-            includeValue == IncludeValue::Yes ? value : value_t{},
+            itemValue,
             datatype,
             hideLockedCas == HideLockedCas::Yes ? static_cast<uint64_t>(-1)
                                                 : getCas(),
@@ -29,6 +29,7 @@
 #include <platform/n_byte_integer.h>
 
 #include <boost/intrusive/list.hpp>
+#include <limits>
 #include <memcached/durability_spec.h>
 #include <relaxed_atomic.h>
 
@@ -195,6 +196,21 @@ public:
         return getValueTag().fields.frequencyCounter;
     }
 
+    /**
+     * The HashTable's frequency decay epoch the frequency counter was last
+     * decayed to (see HashTable::unlocked_applyFreqDecay), modulo 16
+     */
+    uint8_t getFreqDecayEpoch() const {
+        return freqDecayEpoch;
+    }
+
+    void setFreqDecayEpoch(uint8_t epoch) {
+        freqDecayEpoch = epoch & freqDecayEpochMask;
+    }
+
+    /// The frequency decay epochs wrap around (4 bits)
+    static constexpr uint8_t freqDecayEpochMask = 0xf;
+
     /**
      * Mark this item as needing to be persisted.
      */
@@ -228,6 +244,11 @@ public:
         if (mcbp::datatype::is_snappy(datatype) || !valuelen()) {
             return false;
         }
+        if (hasInlineValue()) {
+            // Small enough already, and compressing would move it out of
+            // the inline value buffer
+            return false;
+        }
         return value->isCompressible();
     }
 
@@ -277,11 +298,28 @@ public:
 
     /**
      * Get this item's value.
+     *
+     * An inline value (see hasInlineValue()) lives in the memory of this
+     * StoredValue, so references to it mustn't outlive the StoredValue
+     * (toItem() copies it).
      */
     const value_t &getValue() const {
         return value;
     }
 
+    /**
+     * Is the value stored in the inline value buffer of this StoredValue
+     * (instead of a separately allocated Blob)?
+     */
+    bool hasInlineValue() const {
+        return value && value.get().get() == getInlineValueBuffer();
+    }
+
+    /// @return the size of the inline value buffer (zero if none)
+    uint8_t getInlineValueCapacity() const {
+        return inlineValueCapacity;
+    }
+
     /**
      * Get the expiration time of this item.
      *
@@ -507,7 +545,8 @@ public:
      * @return the amount of memory used by this item.
      */
     size_t size() const {
-        return getObjectSize() + valuelen();
+        // An inline value is a part of the object
+        return getObjectSize() + (hasInlineValue() ? 0 : valuelen());
     }
 
     /**
@@ -518,7 +557,7 @@ public:
      * For uncompressed items this is the same as size().
      */
     size_t uncompressedSize() const {
-        return getObjectSize() + uncompressedValuelen();
+        return size() + uncompressedValuelen() - valuelen();
     }
 
     size_t metaDataSize() const {
@@ -579,10 +618,14 @@ public:
     }
 
     /**
-     * Replace the value with the given value_t
+     * Replace the value with the given value_t (copied into the inline
+     * value buffer if it fits)
      * @param value replace current value with this one
      */
     void replaceValue(const value_t& value) {
+        if (storeValueInline(value)) {
+            return;
+        }
         // Maintain the tag
         auto tag = getValueTag();
         this->value = value;
@@ -726,8 +769,9 @@ public:
     static const int64_t state_temp_init;
 
     /**
-     * Return the size in byte of this object; both the fixed fields and the
-     * variable-length key. Doesn't include value size (allocated externally).
+     * Return the size in byte of this object; the fixed fields, the
+     * variable-length key and the inline value buffer (if any). Doesn't
+     * include the size of a value allocated externally.
      */
     inline size_t getObjectSize() const;
 
@@ -757,8 +801,19 @@ public:
 
     bool operator!=(const StoredValue& other) const;
 
-    /// Return how many bytes are need to store item given key as a StoredValue
-    static size_t getRequiredStorage(const DocKey& key);
+    /**
+     * Return how many bytes are need to store item given key as a StoredValue
+     *
+     * @param key the key of the item
+     * @param inlineValueCapacity the size of the biggest value to fit in the
+     *        inline value buffer (zero for no buffer)
+     */
+    static size_t getRequiredStorage(const DocKey& key,
+                                     size_t inlineValueCapacity = 0);
+
+    /// The biggest inline value buffer a StoredValue may have
+    static constexpr size_t MaxInlineValueCapacity =
+            std::numeric_limits<uint8_t>::max();
 
     /**
      * @return the deletion source of the stored value
@@ -831,11 +886,15 @@ protected:
      *           which the new item is being inserted).
      * @param stats EPStats to update for this new StoredValue
      * @param isOrdered Are we constructing an OrderedStoredValue?
+     * @param inlineCapacity The size of the inline value buffer allocated
+     *        after the key (see getRequiredStorage()). Not supported for
+     *        OrderedStoredValue.
      */
     StoredValue(const Item& itm,
                 UniquePtr n,
                 EPStats& stats,
-                bool isOrdered);
+                bool isOrdered,
+                uint8_t inlineCapacity = 0);
 
     // Destructor. protected, as needs to be carefully deleted (via
     // StoredValue::Destructor) depending on the value of isOrdered flag.
@@ -852,9 +911,20 @@ protected:
      *           which the new item is being inserted).
      * @param stats EPStats to update for this new StoredValue
      */
+    StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
+        : StoredValue(other, std::move(n), stats, other.inlineValueCapacity) {
+    }
+
+    /**
+     * Copy constructor allocating a different inline value buffer (see
+     * getRequiredStorage()) to the StoredValue being copied. Only a
+     * non-resident StoredValue may be copied without an inline value
+     * buffer large enough for its value.
+     */
     StoredValue(const StoredValue& other,
                 UniquePtr n,
-                EPStats& stats);
+                EPStats& stats,
+                uint8_t inlineCapacity);
 
     /* Do not allow assignment */
     StoredValue& operator=(const StoredValue& other) = delete;
@@ -864,6 +934,25 @@ protected:
      */
     inline SerialisedDocKey* key();
 
+    /**
+     * Get the address of the inline value buffer (after the key), or
+     * nullptr if this StoredValue doesn't have one.
+     */
+    inline const void* getInlineValueBuffer() const;
+
+    /// Offset of the inline value buffer, after the given fixed size and key
+    static size_t getInlineValueOffset(size_t offset) {
+        return (offset + alignof(Blob) - 1) & ~(alignof(Blob) - 1);
+    }
+
+    /**
+     * Copy the given value into the inline value buffer, if it fits (and
+     * the inline value currently there isn't referenced by anyone else).
+     *
+     * @return true if the value was copied
+     */
+    bool storeValueInline(const value_t& newValue);
+
     /**
      * Logically mark this SV as deleted.
      * Implementation for StoredValue instances (dispatched to by del() based
@@ -1027,6 +1116,12 @@ protected:
     uint8_t deletionSource : 1;
     /// 3-bit value which encodes the CommittedState of the StoredValue
     uint8_t committed : 3;
+    /// 4-bit frequency decay epoch (see getFreqDecayEpoch)
+    uint8_t freqDecayEpoch : 4;
+
+    /// The size of the biggest value which fits in the inline value buffer
+    /// (zero if this StoredValue doesn't have one). Uses a padding byte.
+    const uint8_t inlineValueCapacity;
 
     friend std::ostream& operator<<(std::ostream& os, const StoredValue& sv);
     friend void to_json(nlohmann::json& json, const StoredValue& sv);
@@ -1202,9 +1297,22 @@ SerialisedDocKey* StoredValue::key() {
 
 size_t StoredValue::getObjectSize() const {
     // Size of fixed part of OrderedStoredValue or StoredValue, plus size of
-    // (variable) key.
+    // (variable) key, plus the inline value buffer.
     if (isOrdered()) {
         return sizeof(OrderedStoredValue) + getKey().getObjectSize();
     }
-    return sizeof(*this) + getKey().getObjectSize();
+    const auto size = sizeof(*this) + getKey().getObjectSize();
+    if (inlineValueCapacity == 0) {
+        return size;
+    }
+    return getInlineValueOffset(size) +
+           Blob::getInlineStorage(inlineValueCapacity);
+}
+
+const void* StoredValue::getInlineValueBuffer() const {
+    if (inlineValueCapacity == 0) {
+        return nullptr;
+    }
+    return reinterpret_cast<const char*>(this) +
+           getInlineValueOffset(sizeof(*this) + getKey().getObjectSize());
 }
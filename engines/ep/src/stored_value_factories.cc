@@ -19,16 +19,37 @@
 
 #include "item.h"
 
+#include <algorithm>
+
+StoredValueFactory::StoredValueFactory(EPStats& s,
+                                       size_t inlineValueSize,
+                                       bool compactNonResident)
+    : stats(&s),
+      inlineValueSize(static_cast<uint8_t>(std::min(
+              inlineValueSize, StoredValue::MaxInlineValueCapacity))),
+      compactNonResident(compactNonResident) {
+}
+
 StoredValue::UniquePtr StoredValueFactory::operator()(
         const Item& itm, StoredValue::UniquePtr next) {
+    // Leave a little room for the value to grow in place (e.g. counters)
+    size_t inlineValueCapacity = 0;
+    const auto nbytes = itm.getNBytes();
+    if (nbytes > 0 && nbytes <= inlineValueSize) {
+        inlineValueCapacity =
+                std::min(size_t(inlineValueSize), (nbytes + 7) & ~size_t(7));
+    }
+
     // Allocate a buffer to store the StoredValue and any trailing bytes
     // that maybe required.
     return StoredValue::UniquePtr(TaggedPtr<StoredValue>(
-            new (::operator new(StoredValue::getRequiredStorage(itm.getKey())))
+            new (::operator new(StoredValue::getRequiredStorage(
+                    itm.getKey(), inlineValueCapacity)))
                     StoredValue(itm,
                                 std::move(next),
                                 *stats,
-                                /*isOrdered*/ false),
+                                /*isOrdered*/ false,
+                                uint8_t(inlineValueCapacity)),
             TaggedPtrBase::NoTagValue));
 }
 
@@ -42,6 +63,19 @@ StoredValue::UniquePtr StoredValueFactory::copyStoredValue(
             TaggedPtrBase::NoTagValue));
 }
 
+StoredValue::UniquePtr StoredValueFactory::copyNonResidentStoredValue(
+        const StoredValue& other, StoredValue::UniquePtr& next) {
+    if (!compactNonResident || other.isResident() ||
+        other.getInlineValueCapacity() == 0) {
+        return {};
+    }
+    return StoredValue::UniquePtr(TaggedPtr<StoredValue>(
+            new (::operator new(
+                    StoredValue::getRequiredStorage(other.getKey(), 0)))
+                    StoredValue(other, std::move(next), *stats, 0),
+            TaggedPtrBase::NoTagValue));
+}
+
 StoredValue::UniquePtr OrderedStoredValueFactory::operator()(
         const Item& itm, StoredValue::UniquePtr next) {
     // Allocate a buffer to store the OrderStoredValue and any trailing
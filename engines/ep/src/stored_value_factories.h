@@ -54,17 +54,43 @@ public:
      */
     virtual StoredValue::UniquePtr copyStoredValue(const StoredValue& other,
                                                    StoredValue::UniquePtr next) = 0;
+
+    /**
+     * Create a smaller copy of the given non-resident StoredValue, without
+     * the memory which is only needed to hold its value (the inline value
+     * buffer), if the factory is configured to do so.
+     *
+     * @param other The non-resident StoredValue to be copied
+     * @param next The StoredValue following other in the hash bucket chain;
+     *             only moved from if a copy is made.
+     * @return the copy, or an empty UniquePtr if it wouldn't be any smaller
+     */
+    virtual StoredValue::UniquePtr copyNonResidentStoredValue(
+            const StoredValue& other, StoredValue::UniquePtr& next) = 0;
 };
 
 /**
  * Creator of StoredValue instances.
+ *
+ * The values of up to inlineValueSize bytes are stored inline, in the
+ * same allocation as the StoredValue (after the key) instead of in a Blob
+ * of their own. Optionally the StoredValues are reallocated without the
+ * inline value buffer once their value is ejected.
  */
 class StoredValueFactory : public AbstractStoredValueFactory {
 public:
     using value_type = StoredValue;
 
-    explicit StoredValueFactory(EPStats& s) : stats(&s) {
-    }
+    /**
+     * @param s the stats of the bucket
+     * @param inlineValueSize the biggest value to store inline (at most
+     *        StoredValue::MaxInlineValueCapacity), zero to always use a Blob
+     * @param compactNonResident whether copyNonResidentStoredValue() drops
+     *        the inline value buffer
+     */
+    explicit StoredValueFactory(EPStats& s,
+                                size_t inlineValueSize = 0,
+                                bool compactNonResident = false);
 
     /**
      * Create an concrete StoredValue object.
@@ -75,8 +101,13 @@ public:
     StoredValue::UniquePtr copyStoredValue(
             const StoredValue& other, StoredValue::UniquePtr next) override;
 
+    StoredValue::UniquePtr copyNonResidentStoredValue(
+            const StoredValue& other, StoredValue::UniquePtr& next) override;
+
 private:
     EPStats* stats;
+    const uint8_t inlineValueSize;
+    const bool compactNonResident;
 };
 
 /**
@@ -101,6 +132,15 @@ public:
     StoredValue::UniquePtr copyStoredValue(
             const StoredValue& other, StoredValue::UniquePtr next) override;
 
+    /**
+     * OrderedStoredValues have no inline value buffer (and the values of
+     * ephemeral buckets are never ejected), so never copied.
+     */
+    StoredValue::UniquePtr copyNonResidentStoredValue(
+            const StoredValue& other, StoredValue::UniquePtr& next) override {
+        return {};
+    }
+
 private:
     EPStats* stats;
 };
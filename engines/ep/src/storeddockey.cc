@@ -15,6 +15,7 @@
  */
 
 #include "storeddockey.h"
+#include "checkpoint_arena.h"
 #include <mcbp/protocol/unsigned_leb128.h>
 #include <memory_tracking_allocator.h>
 #include <iomanip>
@@ -102,6 +103,7 @@ const char* StoredDocKeyT<Allocator>::c_str() const {
 
 template class StoredDocKeyT<std::allocator>;
 template class StoredDocKeyT<MemoryTrackingAllocator>;
+template class StoredDocKeyT<CheckpointArenaAllocator>;
 
 CollectionID SerialisedDocKey::getCollectionID() const {
     return cb::mcbp::unsigned_leb128<CollectionIDType>::decode({bytes, length})
@@ -102,5 +102,5 @@ private:
                         CompareByPriority> readyQueue;
 
     // sorted by waketime. Guarded by `mutex`.
-    FutureQueue<> futureQueue;
+    FutureQueue futureQueue;
 };
@@ -20,8 +20,10 @@
 #include "ep_engine.h"
 #include "executorpool.h"
 #include "flusher.h"
+#include "vbucket.h"
 #include "warmup.h"
 
+#include <algorithm>
 #include <climits>
 #include <type_traits>
 
@@ -33,6 +35,23 @@ bool FlusherTask::run() {
     return flusher->step(this);
 }
 
+FlusherBalancerTask::FlusherBalancerTask(EPBucket& bucket,
+                                         std::chrono::seconds interval)
+    : GlobalTask(&bucket.getEPEngine(),
+                 TaskId::FlusherBalancerTask,
+                 interval.count(),
+                 false),
+      bucket(bucket),
+      interval(interval) {
+}
+
+bool FlusherBalancerTask::run() {
+    TRACE_EVENT0("ep-engine/task", "FlusherBalancerTask");
+    bucket.balanceFlushers();
+    snooze(interval.count());
+    return !engine->getEpStats().isShutdown;
+}
+
 CompactTask::CompactTask(EPBucket& bucket,
                          const CompactionConfig& c,
                          uint64_t purgeSeqno,
@@ -153,3 +172,59 @@ bool WorkLoadMonitor::run() {
     }
     return true;
 }
+
+SeqnoWaitersTimeoutTask::SeqnoWaitersTimeoutTask(EventuallyPersistentEngine& e)
+    : GlobalTask(&e, TaskId::SeqnoWaitersTimeoutTask, INT_MAX, false),
+      scheduledFor(std::chrono::steady_clock::time_point::max()) {
+}
+
+/// @return the given time as the seconds from now expected by snooze()
+static double secondsUntil(std::chrono::steady_clock::time_point tp) {
+    const auto delay = tp - std::chrono::steady_clock::now();
+    return std::max(
+            0.0,
+            std::chrono::duration_cast<std::chrono::duration<double>>(delay)
+                    .count());
+}
+
+void SeqnoWaitersTimeoutTask::addDeadline(
+        Vbid vbid, std::chrono::steady_clock::time_point deadline) {
+    std::lock_guard<std::mutex> lh(deadlinesMutex);
+    deadlines.emplace(deadline, vbid);
+    if (deadline < scheduledFor) {
+        scheduledFor = deadline;
+        ExecutorPool::get()->snooze(getId(), secondsUntil(deadline));
+    }
+}
+
+bool SeqnoWaitersTimeoutTask::run() {
+    TRACE_EVENT0("ep-engine/task", "SeqnoWaitersTimeoutTask");
+    const auto now = std::chrono::steady_clock::now();
+
+    std::vector<Vbid> due;
+    {
+        std::lock_guard<std::mutex> lh(deadlinesMutex);
+        scheduledFor = now;
+        while (!deadlines.empty() && deadlines.begin()->first < now) {
+            due.push_back(deadlines.begin()->second);
+            deadlines.erase(deadlines.begin());
+        }
+    }
+
+    for (const auto vbid : due) {
+        auto vb = engine->getVBucket(vbid);
+        if (vb && vb->getNumSeqnoWaiters() > 0) {
+            vb->notifySeqnoWaiters(vb->getHighSeqno(), now);
+        }
+    }
+
+    std::lock_guard<std::mutex> lh(deadlinesMutex);
+    if (deadlines.empty()) {
+        scheduledFor = std::chrono::steady_clock::time_point::max();
+        snooze(INT_MAX);
+    } else {
+        scheduledFor = deadlines.begin()->first;
+        snooze(secondsUntil(scheduledFor));
+    }
+    return !engine->getEpStats().isShutdown;
+}
@@ -30,12 +30,15 @@
 // Read IO tasks
 TASK(MultiBGFetcherTask, READER_TASK_IDX, 0)
 TASK(FetchAllKeysTask, READER_TASK_IDX, 0)
+TASK(RangeScanTask, READER_TASK_IDX, 0)
 TASK(Warmup, READER_TASK_IDX, 0)
 TASK(WarmupInitialize, READER_TASK_IDX, 0)
+TASK(WarmupReplayDurabilityLog, READER_TASK_IDX, 0)
 TASK(WarmupCreateVBuckets, READER_TASK_IDX, 0)
 TASK(WarmupLoadingCollectionCounts, READER_TASK_IDX, 0)
 TASK(WarmupEstimateDatabaseItemCount, READER_TASK_IDX, 0)
 TASK(WarmupLoadPreparedSyncWrites, READER_TASK_IDX, 0)
+TASK(WarmupLoadBloomFilters, READER_TASK_IDX, 0)
 TASK(WarmupPopulateVBucketMap, READER_TASK_IDX, 0)
 TASK(WarmupKeyDump, READER_TASK_IDX, 0)
 TASK(WarmupCheckforAccessLog, READER_TASK_IDX, 0)
@@ -51,6 +54,7 @@ TASK(AccessScanner, AUXIO_TASK_IDX, 3)
 TASK(AccessScannerVisitor, AUXIO_TASK_IDX, 3)
 TASK(ActiveStreamCheckpointProcessorTask, AUXIO_TASK_IDX, 5)
 TASK(BackfillManagerTask, AUXIO_TASK_IDX, 8)
+TASK(BackfillScanLaneTask, AUXIO_TASK_IDX, 8)
 
 
 // Read/Write IO tasks
@@ -81,6 +85,8 @@ TASK(ItemCompressorTask, NONIO_TASK_IDX, 7)
 TASK(EphTombstoneHTCleaner, NONIO_TASK_IDX, 7)
 TASK(EphTombstoneStaleItemDeleter, NONIO_TASK_IDX, 7)
 TASK(ItemFreqDecayerTask, NONIO_TASK_IDX, 7)
+TASK(FlusherBalancerTask, NONIO_TASK_IDX, 7)
+TASK(SeqnoWaitersTimeoutTask, NONIO_TASK_IDX, 1)
 TASK(ConnManager, NONIO_TASK_IDX, 8)
 TASK(WorkLoadMonitor, NONIO_TASK_IDX, 10)
 TASK(HashtableResizerTask, NONIO_TASK_IDX, 211)
@@ -23,6 +23,8 @@
 
 #include <array>
 #include <chrono>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -35,12 +37,18 @@ class EventuallyPersistentEngine;
 class Flusher;
 class FlusherTask : public GlobalTask {
 public:
-    FlusherTask(EventuallyPersistentEngine *e, Flusher* f, uint16_t shardid,
+    FlusherTask(EventuallyPersistentEngine* e,
+                Flusher* f,
+                uint16_t shardid,
+                size_t lane = 0,
                 bool completeBeforeShutdown = true)
         : GlobalTask(e, TaskId::FlusherTask, 0, completeBeforeShutdown),
           flusher(f) {
         std::stringstream ss;
         ss<<"Running a flusher loop: shard "<<shardid;
+        if (lane > 0) {
+            ss << " lane " << lane;
+        }
         desc = ss.str();
     }
 
@@ -65,6 +73,30 @@ private:
     std::string desc;
 };
 
+/**
+ * A task which periodically rebalances each shard's vBuckets between the
+ * shard's Flushers by the items they flushed - see KVShard::balanceFlushers().
+ */
+class FlusherBalancerTask : public GlobalTask {
+public:
+    FlusherBalancerTask(EPBucket& bucket, std::chrono::seconds interval);
+
+    bool run() override;
+
+    std::string getDescription() override {
+        return "Balancing vBuckets between flushers";
+    }
+
+    std::chrono::microseconds maxExpectedDuration() override {
+        // Only walks the per-vBucket flush load of each shard.
+        return std::chrono::milliseconds(10);
+    }
+
+private:
+    EPBucket& bucket;
+    const std::chrono::seconds interval;
+};
+
 /**
  * A task for compacting a vbucket db file
  */
@@ -234,3 +266,38 @@ private:
     size_t prevNumMutations;
     size_t prevNumGets;
 };
+
+/**
+ * A task which times out the connections waiting for a vBucket to reach a
+ * seqno (see VBucket::addSeqnoWaiter()). Sleeps until the earliest deadline
+ * it has been told of; waiters which reach their seqno are notified by the
+ * vBucket itself.
+ */
+class SeqnoWaitersTimeoutTask : public GlobalTask {
+public:
+    explicit SeqnoWaitersTimeoutTask(EventuallyPersistentEngine& e);
+
+    bool run() override;
+
+    std::string getDescription() override {
+        return "Timing out seqno waiters";
+    }
+
+    std::chrono::microseconds maxExpectedDuration() override {
+        // Only visits the vBuckets with a due deadline.
+        return std::chrono::milliseconds(10);
+    }
+
+    /**
+     * Reschedule the task (if needed) to process the given vBucket's seqno
+     * waiters at the given deadline.
+     */
+    void addDeadline(Vbid vbid, std::chrono::steady_clock::time_point deadline);
+
+private:
+    std::mutex deadlinesMutex;
+    // The pending deadlines, earliest first (one per waiter)
+    std::multimap<std::chrono::steady_clock::time_point, Vbid> deadlines;
+    // The time the task is currently scheduled to run at
+    std::chrono::steady_clock::time_point scheduledFor;
+};
@@ -0,0 +1,114 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "value_deduplicator.h"
+
+#include "murmurhash3.h"
+
+#include <statistics/collector.h>
+
+#include <algorithm>
+#include <cstring>
+
+ValueDeduplicator::ValueDeduplicator(size_t minSize, size_t maxValues)
+    : minSize(std::max(minSize, size_t(1))),
+      maxValuesPerShard(std::max(maxValues / NumShards, size_t(1))) {
+}
+
+value_t ValueDeduplicator::dedup(const value_t& value) {
+    // The memory of an inline Blob belongs to its StoredValue
+    if (!value || value->isInline() || value->valueSize() < minSize) {
+        return value;
+    }
+
+    const auto* data = value->getData();
+    const auto size = value->valueSize();
+    uint64_t hash[2];
+    MurmurHash3_x64_128(data, int(size), 0, hash);
+
+    auto& shard = shards[hash[0] % NumShards];
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto range = shard.values.equal_range(hash[0]);
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto& candidate = it->second;
+        if (candidate.get().get() == value.get().get()) {
+            return value;
+        }
+        if (candidate->valueSize() == size &&
+            std::memcmp(candidate->getData(), data, size) == 0) {
+            hits++;
+            return candidate;
+        }
+    }
+
+    misses++;
+    if (shard.values.size() >= maxValuesPerShard) {
+        shard.prune();
+        if (shard.values.size() >= maxValuesPerShard) {
+            return value;
+        }
+    }
+    // Without the tag (the frequency counter) of the StoredValue it came from
+    shard.values.emplace(hash[0], value_t{TaggedPtr<Blob>(value.get().get())});
+    return value;
+}
+
+void ValueDeduplicator::Shard::prune() {
+    // Another reference can only be taken from a StoredValue (or Item)
+    // already referencing the value, or from the table under the mutex
+    for (auto it = values.begin(); it != values.end();) {
+        if (it->second.refCount() == 1) {
+            it = values.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ValueDeduplicator::addStats(const AddStatFn& add_stat,
+                                 const void* c) const {
+    size_t numValues = 0;
+    size_t bytes = 0;
+    size_t bytesSaved = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        numValues += shard.values.size();
+        for (const auto& entry : shard.values) {
+            const auto& value = entry.second;
+            bytes += value->getSize();
+            // Every reference but the table's and the first would otherwise
+            // have had a copy of its own
+            const auto refs = size_t(value.refCount());
+            if (refs > 2) {
+                bytesSaved += (refs - 2) * value->getSize();
+            }
+        }
+    }
+
+    const size_t h = hits;
+    const size_t m = misses;
+    add_casted_stat("ep_value_dedup_min_size", minSize, add_stat, c);
+    add_casted_stat("ep_value_dedup_values", numValues, add_stat, c);
+    add_casted_stat("ep_value_dedup_bytes", bytes, add_stat, c);
+    add_casted_stat("ep_value_dedup_hits", h, add_stat, c);
+    add_casted_stat("ep_value_dedup_misses", m, add_stat, c);
+    add_casted_stat("ep_value_dedup_hit_ratio",
+                    (h + m) ? double(h) / double(h + m) : 0.0,
+                    add_stat,
+                    c);
+    add_casted_stat("ep_value_dedup_bytes_saved", bytesSaved, add_stat, c);
+}
@@ -0,0 +1,85 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "blob.h"
+
+#include <memcached/engine_common.h>
+#include <relaxed_atomic.h>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * A bucket-wide, content-addressed table of values (enabled with
+ * value_dedup_min_size), letting the StoredValues of different keys with
+ * identical values share a single Blob.
+ *
+ * Blobs are never modified once created (a new value always gets a Blob
+ * of its own) and already shared by reference count with the Items
+ * created from a StoredValue, so sharing them across StoredValues needs
+ * no copy-on-write.
+ *
+ * The table holds a reference to every value it hands out. The values
+ * nothing else references any more are dropped when a shard of the table
+ * is full; a value which doesn't fit even then isn't shared.
+ */
+class ValueDeduplicator {
+public:
+    /**
+     * @param minSize the smallest value to share
+     * @param maxValues the maximum number of values held by the table
+     */
+    ValueDeduplicator(size_t minSize, size_t maxValues);
+
+    /**
+     * @return the value held by the table with the same contents as
+     *         value if there is one, otherwise value (which is held by the
+     *         table from now on if there's space)
+     */
+    value_t dedup(const value_t& value);
+
+    size_t getMinSize() const {
+        return minSize;
+    }
+
+    void addStats(const AddStatFn& add_stat, const void* c) const;
+
+protected:
+    struct Shard {
+        /// Drop the values nothing but the table references
+        void prune();
+
+        mutable std::mutex mutex;
+        /// The values by hash of their contents
+        std::unordered_multimap<uint64_t, value_t> values;
+    };
+
+    static constexpr size_t NumShards = 16;
+
+    const size_t minSize;
+    const size_t maxValuesPerShard;
+    std::array<Shard, NumShards> shards;
+
+    /// Values which were replaced by one the table held
+    cb::RelaxedAtomic<size_t> hits;
+    /// Values (big enough to share) which weren't
+    cb::RelaxedAtomic<size_t> misses;
+};
@@ -38,10 +38,10 @@ void VBucketCountVisitor::visitBucket(const VBucketPtr& vb) {
         numExpiredItems += vb->numExpiredItems;
         metaDataMemory += vb->ht.getMetadataMemory();
         metaDataDisk += vb->metaDataDisk;
-        checkpointMemory += vb->getChkMgrMemUsage();
-        checkpointMemoryUnreferenced +=
-                vb->getChkMgrMemUsageOfUnrefCheckpoints();
-        checkpointMemoryOverhead += vb->getChkMgrMemUsageOverhead();
+        const auto checkpointUsage = vb->getChkMgrMemUsages();
+        checkpointMemory += checkpointUsage.usage;
+        checkpointMemoryUnreferenced += checkpointUsage.unreferenced;
+        checkpointMemoryOverhead += checkpointUsage.overhead;
         opsCreate += vb->opsCreate;
         opsDelete += vb->opsDelete;
         opsGet += vb->opsGet;
@@ -17,102 +17,87 @@
 
 #include "vb_ready_queue.h"
 
-#include "locks.h"
 #include "statistics/collector.h"
 
+#include <stdexcept>
+
+VBReadyQueue::VBReadyQueue(size_t maxVBuckets)
+    : readyQueue(maxVBuckets), queuedValues(maxVBuckets) {
+}
+
 bool VBReadyQueue::exists(Vbid vbucket) {
-    LockHolder lh(lock);
-    return (queuedValues.count(vbucket) != 0);
+    return queuedValues.at(vbucket.get()).load();
 }
 
 bool VBReadyQueue::popFront(Vbid& frontValue) {
-    LockHolder lh(lock);
-    if (!readyQueue.empty()) {
-        frontValue = readyQueue.front();
-        readyQueue.pop();
-        queuedValues.erase(frontValue);
-        return true;
+    if (!readyQueue.read(frontValue)) {
+        return false;
     }
-    return false;
+    // Clear the flag *before* the caller processes the vBucket; a
+    // concurrent pushUnique from now on will re-queue it so no notification
+    // can be lost.
+    queuedValues[frontValue.get()].store(false);
+    queueSize.fetch_sub(1);
+    return true;
 }
 
 void VBReadyQueue::pop() {
-    LockHolder lh(lock);
-    if (!readyQueue.empty()) {
-        queuedValues.erase(readyQueue.front());
-        readyQueue.pop();
-    }
+    Vbid ignored;
+    popFront(ignored);
 }
 
 bool VBReadyQueue::pushUnique(Vbid vbucket) {
-    bool wasEmpty;
-    {
-        LockHolder lh(lock);
-        wasEmpty = queuedValues.empty();
-        const bool inserted = queuedValues.emplace(vbucket).second;
-        if (inserted) {
-            readyQueue.push(vbucket);
-        }
+    auto& queued = queuedValues.at(vbucket.get());
+    // Fast path: already queued - don't touch the shared counter or queue.
+    if (queued.load() || queued.exchange(true)) {
+        return false;
+    }
+    const bool wasEmpty = queueSize.fetch_add(1) == 0;
+    if (!readyQueue.write(vbucket)) {
+        // Can only happen if a vbucket was queued twice, which the
+        // queuedValues flag prevents.
+        throw std::logic_error("VBReadyQueue::pushUnique: queue is full for " +
+                               vbucket.to_string());
     }
     return wasEmpty;
 }
 
 size_t VBReadyQueue::size() const {
-    LockHolder lh(lock);
-    return readyQueue.size();
+    return queueSize.load();
 }
 
 bool VBReadyQueue::empty() {
-    LockHolder lh(lock);
-    return readyQueue.empty();
+    return queueSize.load() == 0;
 }
 
 void VBReadyQueue::clear() {
-    LockHolder lh(lock);
-    while (!readyQueue.empty()) {
-        readyQueue.pop();
+    Vbid ignored;
+    while (popFront(ignored)) {
     }
-    queuedValues.clear();
 }
 
 void VBReadyQueue::addStats(const std::string& prefix,
                             const AddStatFn& add_stat,
                             const void* c) const {
-    // Take a copy of the queue data under lock; then format it to stats.
-    std::queue<Vbid> qCopy;
-    std::unordered_set<Vbid> qMapCopy;
-    {
-        LockHolder lh(lock);
-        qCopy = readyQueue;
-        qMapCopy = queuedValues;
-    }
+    add_casted_stat((prefix + "size").c_str(), size(), add_stat, c);
 
-    add_casted_stat((prefix + "size").c_str(), qCopy.size(), add_stat, c);
-    add_casted_stat(
-            (prefix + "map_size").c_str(), qMapCopy.size(), add_stat, c);
-
-    // Form a comma-separated string of the queue's contents.
+    // Form a comma-separated string of the queued vBuckets. The MPMCQueue
+    // cannot be iterated so this is based on the per-vBucket flags (and is
+    // in vbid, not queue, order).
     std::string contents;
-    while (!qCopy.empty()) {
-        contents += std::to_string(qCopy.front().get()) + ",";
-        qCopy.pop();
+    size_t mapSize = 0;
+    for (size_t vbid = 0; vbid < queuedValues.size(); ++vbid) {
+        if (queuedValues[vbid].load()) {
+            contents += std::to_string(vbid) + ",";
+            ++mapSize;
+        }
     }
     if (!contents.empty()) {
         contents.pop_back();
     }
+    add_casted_stat((prefix + "map_size").c_str(), mapSize, add_stat, c);
     add_casted_stat(
             (prefix + "contents").c_str(), contents.c_str(), add_stat, c);
-
-    // Form a comma-separated string of the queue map's contents.
-    std::string qMapContents;
-    for (auto& vbid : qMapCopy) {
-        qMapContents += std::to_string(vbid.get()) + ",";
-    }
-    if (!qMapContents.empty()) {
-        qMapContents.pop_back();
-    }
-    add_casted_stat((prefix + "map_contents").c_str(),
-                    qMapContents.c_str(),
-                    add_stat,
-                    c);
+    add_casted_stat(
+            (prefix + "map_contents").c_str(), contents.c_str(), add_stat, c);
 }
@@ -17,23 +17,34 @@
 
 #pragma once
 
+#include <folly/MPMCQueue.h>
 #include <memcached/engine_common.h>
 #include <memcached/vbucket.h>
 
-#include <mutex>
-#include <queue>
-#include <unordered_set>
+#include <atomic>
+#include <vector>
 
 /**
- * VBReadyQueue is a std::queue wrapper for managing a queue of vbuckets that
- * are ready for some task to process. The queue does not allow duplicates and
- * the push_unique method enforces this.
+ * VBReadyQueue manages a queue of vbuckets that are ready for some task to
+ * process. The queue does not allow duplicates and the push_unique method
+ * enforces this.
  *
- * Internally a std::queue and std::set track the contents and the std::set
- * enables a fast exists method which is used by front-end threads.
+ * The queue is lock-free: each vBucket has an atomic "queued" flag which
+ * enforces uniqueness (and provides a cheap exists() for front-end threads),
+ * and the queued vBucket IDs are held in a bounded folly::MPMCQueue. As a
+ * vBucket can be in the queue at most once the MPMCQueue is sized to the
+ * maximum number of vBuckets and a push can never find it full. This avoids
+ * the mutex contention seen when many front-end threads notify the same
+ * queue (e.g. many DCP producers being told about new seqnos).
  */
 class VBReadyQueue {
 public:
+    /**
+     * @param maxVBuckets The number of vBuckets which may be pushed; all
+     *        vbids pushed must be less than this.
+     */
+    explicit VBReadyQueue(size_t maxVBuckets);
+
     bool exists(Vbid vbucket);
 
     /**
@@ -75,16 +86,20 @@ public:
                   const void* c) const;
 
 private:
-    // Mutable so that we can lock in addStats (const) to copy the queue/set
-    mutable std::mutex lock;
-
     /* a queue of vbuckets that are ready for producing */
-    std::queue<Vbid> readyQueue;
+    folly::MPMCQueue<Vbid> readyQueue;
+
+    /**
+     * Per-vBucket flag recording if the vBucket is in the readyQueue.
+     * exists() is performed by front-end threads so we want it to be
+     * efficient so just an atomic load is required.
+     */
+    std::vector<std::atomic<bool>> queuedValues;
 
     /**
-     * maintain a std::unordered_set of values that are in the readyQueue.
-     * find() is performed by front-end threads so we want it to be
-     * efficient so just a set lookup is required.
+     * Number of vBuckets with their queuedValues flag set. Incremented
+     * before the vBucket is written to the readyQueue, hence it may
+     * transiently exceed the number of elements readable from readyQueue.
      */
-    std::unordered_set<Vbid> queuedValues;
+    std::atomic<size_t> queueSize{0};
 };
@@ -51,6 +51,10 @@ bool PauseResumeVBAdapter::visit(VBucket& vb) {
         ht_start = hashtable_position;
     }
 
+    if (!htVisitor->shouldVisitVBucket(vb)) {
+        return true;
+    }
+
     htVisitor->setCurrentVBucket(vb);
     hashtable_position = vb.ht.pauseResumeVisit(*htVisitor, ht_start);
 
@@ -58,8 +62,10 @@ bool PauseResumeVBAdapter::visit(VBucket& vb) {
         // We didn't get to the end of this VBucket. Record the vbucket_id
         // we got to and return false.
         resume_vbucket_id = vb.getId();
+        htVisitor->pauseVBucket(vb);
         return false;
     } else {
+        htVisitor->completeVBucket(vb);
         return true;
     }
 }
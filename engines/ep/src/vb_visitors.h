@@ -177,6 +177,28 @@ public:
      */
     virtual void setCurrentVBucket(VBucket& vb) {
     }
+
+    /**
+     * Called (before setCurrentVBucket()) whenever we move to a different
+     * VBucket, or resume visiting one. Return false to skip the VBucket.
+     */
+    virtual bool shouldVisitVBucket(VBucket& vb) {
+        return true;
+    }
+
+    /**
+     * Called once the whole of the current VBucket's HashTable has been
+     * visited.
+     */
+    virtual void completeVBucket(VBucket& vb) {
+    }
+
+    /**
+     * Called when the visit of the current VBucket's HashTable pauses before
+     * reaching the end (it is resumed with another setCurrentVBucket()).
+     */
+    virtual void pauseVBucket(VBucket& vb) {
+    }
 };
 
 /**
@@ -35,6 +35,7 @@
 #include "hash_table_stat_visitor.h"
 #include "kvshard.h"
 #include "kvstore.h"
+#include "meta_bounds.h"
 #include "pre_link_document_context.h"
 #include "rollback_result.h"
 #include "statistics/collector.h"
@@ -47,13 +48,16 @@
 #include <folly/lang/Assume.h>
 #include <memcached/protocol_binary.h>
 #include <memcached/server_document_iface.h>
+#include <memcached/util.h>
 #include <platform/compress.h>
 #include <platform/optional.h>
+#include <utilities/json_validator.h>
 #include <xattr/blob.h>
 #include <xattr/utils.h>
 
 #include <gsl.h>
 #include <logtags.h>
+#include <cstring>
 #include <functional>
 #include <list>
 #include <set>
@@ -189,7 +193,13 @@ VBucket::VBucket(Vbid i,
                  bool mightContainXattrs,
                  const nlohmann::json* replTopology,
                  uint64_t maxVisibleSeqno)
-    : ht(st, std::move(valFact), config.getHtSize(), config.getHtLocks()),
+    : ht(st,
+         std::move(valFact),
+         config.getHtSize(),
+         config.getHtLocks(),
+         htReadModeFromString(config.getHtReadMode()),
+         htResizeModeFromString(config.getHtResizeMode()),
+         config.isHtHugePages()),
       checkpointManager(std::make_unique<CheckpointManager>(st,
                                                             i,
                                                             chkConfig,
@@ -252,6 +262,10 @@ VBucket::VBucket(Vbid i,
 
     setupSyncReplication(replTopology);
 
+    if (config.isExpiryIndexEnabled()) {
+        ht.getExpiryIndex().enable(config.getExpiryIndexMaxEntries());
+    }
+
     EP_LOG_INFO(
             "VBucket: created {} with state:{} initialState:{} lastSeqno:{} "
             "persistedRange:{{{},{}}} max_cas:{} uuid:{} topology:{}",
@@ -313,6 +327,10 @@ size_t VBucket::getChkMgrMemUsageOverhead() const {
     return checkpointManager->getMemoryOverhead();
 }
 
+CheckpointMemoryUsage VBucket::getChkMgrMemUsages() const {
+    return checkpointManager->getMemoryUsages();
+}
+
 size_t VBucket::getSyncWriteAcceptedCount() const {
     folly::SharedMutex::ReadHolder lh(stateLock);
     if (!durabilityMonitor) {
@@ -697,6 +715,13 @@ void VBucket::notifySyncWritesPendingCompletion() {
     syncWriteResolvedCb(getId());
 }
 
+void VBucket::notifySyncWriteExpiry(
+        std::chrono::steady_clock::time_point expiry) {
+    if (syncWriteExpiryCb) {
+        syncWriteExpiryCb(getId(), expiry);
+    }
+}
+
 void VBucket::processResolvedSyncWrites() {
     // Acquire shared access on stateLock as need to ensure the vbucket is
     // active (and we have an ActiveDM).
@@ -1024,10 +1049,37 @@ void VBucket::notifyClientOfSyncWriteComplete(const void* cookie,
     syncWriteCompleteCb(cookie, result);
 }
 
+void VBucket::notifyClientsOfSyncWriteComplete(
+        const SyncWriteCompletions& toNotify) {
+    if (toNotify.empty()) {
+        return;
+    }
+    if (syncWriteCompleteBatchCb) {
+        EP_LOG_DEBUG(
+                "VBucket::notifyClientsOfSyncWriteComplete ({}) cookies:{}",
+                id,
+                toNotify.size());
+        syncWriteCompleteBatchCb(toNotify);
+        return;
+    }
+    for (const auto& [cookie, result] : toNotify) {
+        notifyClientOfSyncWriteComplete(cookie, result);
+    }
+}
+
 void VBucket::notifyPassiveDMOfSnapEndReceived(uint64_t snapEnd) {
     getPassiveDM().notifySnapshotEndReceived(snapEnd);
 }
 
+void VBucket::notifyPassiveDMOfPrepareReceived(int64_t seqno,
+                                               cb::durability::Level level) {
+    folly::SharedMutex::ReadHolder rlh(stateLock);
+    if (state != vbucket_state_replica && state != vbucket_state_pending) {
+        return;
+    }
+    getPassiveDM().notifyPrepareReceived(seqno, level);
+}
+
 void VBucket::sendSeqnoAck(int64_t seqno) {
     Expects(state == vbucket_state_replica || state == vbucket_state_pending);
     seqnoAckCb(getId(), seqno);
@@ -1069,27 +1121,31 @@ bool VBucket::isResidentRatioUnderThreshold(float threshold) {
     }
 }
 
-void VBucket::createFilter(size_t key_count, double probability) {
+void VBucket::createFilter(size_t key_count,
+                           double probability,
+                           BloomFilterType type) {
     // Create the actual bloom filter upon vbucket creation during
     // scenarios:
     //      - Bucket creation
     //      - Rebalance
     LockHolder lh(bfMutex);
     if (bFilter == nullptr && tempFilter == nullptr) {
-        bFilter = std::make_unique<BloomFilter>(key_count, probability,
-                                        BFILTER_ENABLED);
+        bFilter = std::make_unique<BloomFilter>(
+                key_count, probability, BFILTER_ENABLED, type);
     } else {
         EP_LOG_WARN("({}) Bloom filter / Temp filter already exist!", id);
     }
 }
 
-void VBucket::initTempFilter(size_t key_count, double probability) {
+void VBucket::initTempFilter(size_t key_count,
+                             double probability,
+                             BloomFilterType type) {
     // Create a temp bloom filter with status as COMPACTING,
     // if the main filter is found to exist, set its state to
     // COMPACTING as well.
     LockHolder lh(bfMutex);
-    tempFilter = std::make_unique<BloomFilter>(key_count, probability,
-                                     BFILTER_COMPACTING);
+    tempFilter = std::make_unique<BloomFilter>(
+            key_count, probability, BFILTER_COMPACTING, type);
     if (bFilter) {
         bFilter->setStatus(BFILTER_COMPACTING);
     }
@@ -1193,6 +1249,45 @@ std::string VBucket::getFilterStatusString() {
     }
 }
 
+void VBucket::createMetaBounds(size_t size) {
+    metaBounds = std::make_unique<MetaBounds>(size);
+}
+
+void VBucket::restoreMetaBounds(std::unique_ptr<MetaBounds> bounds) {
+    metaBounds = std::move(bounds);
+}
+
+std::string VBucket::serialiseMetaBounds() const {
+    return metaBounds ? metaBounds->serialise() : std::string{};
+}
+
+bool VBucket::winsAgainstMetaBounds(const Item& item) const {
+    if (!metaBounds) {
+        return false;
+    }
+    const auto bounds = metaBounds->get(item.getKey());
+    return conflictResolver->winsAgainstBounds(
+            item.getMetaData(), bounds.cas, bounds.revSeqno);
+}
+
+std::string VBucket::serialiseFilter() {
+    LockHolder lh(bfMutex);
+    if (bFilter && (bFilter->getStatus() == BFILTER_COMPACTING ||
+                    bFilter->getStatus() == BFILTER_ENABLED)) {
+        return bFilter->serialise();
+    }
+    return {};
+}
+
+bool VBucket::restoreFilter(std::unique_ptr<BloomFilter> filter) {
+    LockHolder lh(bfMutex);
+    if (bFilter || tempFilter) {
+        return false;
+    }
+    bFilter = std::move(filter);
+    return true;
+}
+
 size_t VBucket::getFilterSize() {
     LockHolder lh(bfMutex);
     if (bFilter) {
@@ -1230,6 +1325,12 @@ VBNotifyCtx VBucket::queueItem(queued_item& item, const VBQueueItemCtx& ctx) {
                                               ctx.preLinkDocumentContext);
         notifyCtx.notifyReplication = true;
     notifyCtx.bySeqno = item->getBySeqno();
+
+    // Every version of a document passes through here before it's
+    // persisted, so the bounds cover all of the documents on disk
+    if (metaBounds && !item->isPending() && !item->isAbort()) {
+        metaBounds->add(item->getKey(), item->getCas(), item->getRevSeqno());
+    }
     notifyCtx.syncWrite = item->isPending() ? SyncWriteOperation::Yes
                                             : SyncWriteOperation::No;
 
@@ -1311,6 +1412,19 @@ VBNotifyCtx VBucket::queueDirty(const HashTable::HashBucketLock& hbl,
         setMightContainXattrs();
     }
 
+    // The item shares the value with the StoredValue; compressing it
+    // leaves the HashTable's value as it is, and gives the checkpoints (and
+    // everything reading from them) a compressed copy. It is then
+    // compressed once rather than by every DCP stream wanting it
+    // compressed, and sent to disk as-is.
+    if (checkpointManager->getCheckpointConfig().isValueCompressionEnabled() &&
+        qi->getNBytes() > 0 && !qi->compressValue()) {
+        EP_LOG_WARN(
+                "VBucket::queueDirty: {} Failed to snappy compress the value "
+                "of a queued item",
+                getId());
+    }
+
     // Enqueue the item for persistence and replication
     VBNotifyCtx notifyCtx = queueItem(qi, ctx);
 
@@ -1659,6 +1773,190 @@ ENGINE_ERROR_CODE VBucket::set(
     return ret;
 }
 
+StoredValue* VBucket::selectSVForUpdateInEngine(
+        const HashTable::FindUpdateResult& htRes) const {
+    auto* v = htRes.committed;
+    if (htRes.pending || !v || v->isTempItem() || v->isDeleted() ||
+        !v->isResident() || v->isLocked(ep_current_time()) ||
+        v->isExpired(ep_real_time())) {
+        return nullptr;
+    }
+    return v;
+}
+
+ENGINE_ERROR_CODE VBucket::storeUpdateInEngine(
+        HashTable::FindUpdateResult& htRes,
+        StoredValue* v,
+        Item& itm,
+        const void* cookie,
+        EventuallyPersistentEngine& engine,
+        const Collections::VB::CachingReadHandle& cHandle,
+        uint64_t& cas,
+        mutation_descr_t& mutInfo) {
+    PreLinkDocumentContext preLinkDocumentContext(engine, cookie, &itm);
+    VBQueueItemCtx queueItmCtx;
+    queueItmCtx.preLinkDocumentContext = &preLinkDocumentContext;
+    auto [status, notifyCtx] = processSet(htRes,
+                                          v,
+                                          itm,
+                                          itm.getCas(),
+                                          /*allowExisting*/ true,
+                                          /*hasMetaData*/ false,
+                                          queueItmCtx,
+                                          cb::StoreIfStatus::Continue);
+    switch (status) {
+    case MutationStatus::NoMem:
+        return ENGINE_ENOMEM;
+    case MutationStatus::WasDirty:
+    case MutationStatus::WasClean:
+        notifyNewSeqno(*notifyCtx);
+        doCollectionsStats(cHandle, *notifyCtx);
+        cas = v->getCas();
+        mutInfo.seqno = v->getBySeqno();
+        mutInfo.vbucket_uuid = failovers->getLatestUUID();
+        return ENGINE_SUCCESS;
+    case MutationStatus::InvalidCas:
+    case MutationStatus::IsLocked:
+    case MutationStatus::NotFound:
+    case MutationStatus::NeedBgFetch:
+    case MutationStatus::IsPendingSyncWrite:
+        // Excluded by selectSVForUpdateInEngine; leave any such case to the
+        // frontend
+        break;
+    }
+    return ENGINE_ENOTSUP;
+}
+
+ENGINE_ERROR_CODE VBucket::arithmetic(
+        bool increment,
+        uint64_t delta,
+        const void* cookie,
+        EventuallyPersistentEngine& engine,
+        const Collections::VB::CachingReadHandle& cHandle,
+        uint64_t& result,
+        uint64_t& cas,
+        mutation_descr_t& mutInfo) {
+    auto htRes = ht.findForUpdate(cHandle.getKey());
+    auto* v = selectSVForUpdateInEngine(htRes);
+    if (!v) {
+        return ENGINE_ENOTSUP;
+    }
+
+    const auto datatype = v->getDatatype();
+    if (mcbp::datatype::is_xattr(datatype) ||
+        mcbp::datatype::is_snappy(datatype)) {
+        return ENGINE_ENOTSUP;
+    }
+
+    const auto& value = v->getValue();
+    if (!value) {
+        return ENGINE_DELTA_BADVAL;
+    }
+    uint64_t counter = 0;
+    const std::string payload(value->getData(), value->valueSize());
+    if (!safe_strtoull(payload.c_str(), counter)) {
+        return ENGINE_DELTA_BADVAL;
+    }
+
+    if (increment) {
+        counter += delta;
+    } else {
+        counter = counter < delta ? 0 : counter - delta;
+    }
+    const auto newValue = std::to_string(counter);
+
+    Item itm(cHandle.getKey(),
+             v->getFlags(),
+             v->getExptime(),
+             newValue.data(),
+             newValue.size(),
+             PROTOCOL_BINARY_DATATYPE_JSON,
+             v->getCas(),
+             -1,
+             getId());
+    auto ret = storeUpdateInEngine(
+            htRes, v, itm, cookie, engine, cHandle, cas, mutInfo);
+    if (ret == ENGINE_SUCCESS) {
+        result = counter;
+    }
+    return ret;
+}
+
+ENGINE_ERROR_CODE VBucket::appendPrepend(
+        bool append,
+        std::string_view value,
+        const void* cookie,
+        EventuallyPersistentEngine& engine,
+        const Collections::VB::CachingReadHandle& cHandle,
+        uint64_t& cas,
+        mutation_descr_t& mutInfo) {
+    auto htRes = ht.findForUpdate(cHandle.getKey());
+    auto* v = selectSVForUpdateInEngine(htRes);
+    if (!v) {
+        return ENGINE_ENOTSUP;
+    }
+
+    std::string_view old;
+    if (v->getValue()) {
+        old = {v->getValue()->getData(), v->getValue()->valueSize()};
+    }
+    cb::compression::Buffer inflated;
+    if (mcbp::datatype::is_snappy(v->getDatatype())) {
+        try {
+            if (!cb::compression::inflate(
+                        cb::compression::Algorithm::Snappy, old, inflated)) {
+                return ENGINE_FAILED;
+            }
+        } catch (const std::bad_alloc&) {
+            return ENGINE_ENOMEM;
+        }
+        old = {inflated.data(), inflated.size()};
+    }
+
+    if (old.size() + value.size() > engine.getMaxItemSize()) {
+        return ENGINE_E2BIG;
+    }
+
+    // Any xattrs stay in front of the body
+    auto datatype = PROTOCOL_BINARY_RAW_BYTES;
+    size_t bodyOffset = 0;
+    if (mcbp::datatype::is_xattr(v->getDatatype())) {
+        datatype |= PROTOCOL_BINARY_DATATYPE_XATTR;
+        bodyOffset = cb::xattr::get_body_offset(old);
+    }
+
+    // Build the new value directly in the Blob of the new Item
+    Item itm(cHandle.getKey(),
+             v->getFlags(),
+             v->getExptime(),
+             nullptr,
+             old.size() + value.size(),
+             datatype,
+             v->getCas(),
+             -1,
+             getId());
+    auto* body = const_cast<char*>(itm.getData());
+    if (append) {
+        std::memcpy(body, old.data(), old.size());
+        std::memcpy(body + old.size(), value.data(), value.size());
+    } else {
+        std::memcpy(body, old.data(), bodyOffset);
+        std::memcpy(body + bodyOffset, value.data(), value.size());
+        std::memcpy(body + bodyOffset + value.size(),
+                    old.data() + bodyOffset,
+                    old.size() - bodyOffset);
+    }
+
+    // The validator keeps its buffers between calls
+    static thread_local cb::json::Validator validator;
+    if (validator.validate({body + bodyOffset, itm.getNBytes() - bodyOffset})) {
+        itm.setDataType(datatype | PROTOCOL_BINARY_DATATYPE_JSON);
+    }
+
+    return storeUpdateInEngine(
+            htRes, v, itm, cookie, engine, cHandle, cas, mutInfo);
+}
+
 ENGINE_ERROR_CODE VBucket::replace(
         Item& itm,
         const void* cookie,
@@ -1922,10 +2220,19 @@ ENGINE_ERROR_CODE VBucket::prepare(
         // + full eviction.
         if (v) { // temp item is already created. Simply schedule a
             hbl.getHTLock().unlock(); // bg fetch job.
-            bgFetch(itm.getKey(), cookie, engine, true);
+            bgFetch(itm.getKey(),
+                    cookie,
+                    engine,
+                    true,
+                    BgFetchPriority::Durability);
             return ENGINE_EWOULDBLOCK;
         }
-        ret = addTempItemAndBGFetch(hbl, itm.getKey(), cookie, engine, true);
+        ret = addTempItemAndBGFetch(hbl,
+                                    itm.getKey(),
+                                    cookie,
+                                    engine,
+                                    true,
+                                    BgFetchPriority::Durability);
         break;
     }
     case MutationStatus::IsPendingSyncWrite:
@@ -1963,7 +2270,11 @@ ENGINE_ERROR_CODE VBucket::setWithMeta(
     if (checkConflicts == CheckConflicts::Yes) {
         if (v) {
             if (v->isTempInitialItem()) {
-                bgFetch(itm.getKey(), cookie, engine, true);
+                bgFetch(itm.getKey(),
+                        cookie,
+                        engine,
+                        true,
+                        BgFetchPriority::XdcrMeta);
                 return ENGINE_EWOULDBLOCK;
             }
 
@@ -1981,8 +2292,17 @@ ENGINE_ERROR_CODE VBucket::setWithMeta(
             }
         } else {
             if (maybeKeyExistsInFilter(itm.getKey())) {
-                return addTempItemAndBGFetch(
-                        hbl, itm.getKey(), cookie, engine, true);
+                if (!allowExisting || !winsAgainstMetaBounds(itm)) {
+                    return addTempItemAndBGFetch(hbl,
+                                                 itm.getKey(),
+                                                 cookie,
+                                                 engine,
+                                                 true,
+                                                 BgFetchPriority::XdcrMeta);
+                }
+                // The item wins against whatever version of the document
+                // may be on disk; store it without fetching the metadata
+                ++stats.numOpsSetMetaResolvedByBounds;
             } else {
                 maybeKeyExists = false;
             }
@@ -2061,10 +2381,19 @@ ENGINE_ERROR_CODE VBucket::setWithMeta(
         // + full eviction.
         if (v) { // temp item is already created. Simply schedule a
             hbl.getHTLock().unlock(); // bg fetch job.
-            bgFetch(itm.getKey(), cookie, engine, true);
+            bgFetch(itm.getKey(),
+                    cookie,
+                    engine,
+                    true,
+                    BgFetchPriority::XdcrMeta);
             return ENGINE_EWOULDBLOCK;
         }
-        ret = addTempItemAndBGFetch(hbl, itm.getKey(), cookie, engine, true);
+        ret = addTempItemAndBGFetch(hbl,
+                                    itm.getKey(),
+                                    cookie,
+                                    engine,
+                                    true,
+                                    BgFetchPriority::XdcrMeta);
         break;
     }
     case MutationStatus::IsPendingSyncWrite:
@@ -2260,7 +2589,7 @@ ENGINE_ERROR_CODE VBucket::deleteWithMeta(
     if (checkConflicts == CheckConflicts::Yes) {
         if (v) {
             if (v->isTempInitialItem()) {
-                bgFetch(key, cookie, engine, true);
+                bgFetch(key, cookie, engine, true, BgFetchPriority::XdcrMeta);
                 return ENGINE_EWOULDBLOCK;
             }
 
@@ -2275,7 +2604,12 @@ ENGINE_ERROR_CODE VBucket::deleteWithMeta(
             // Item is 1) deleted or not existent in the value eviction case OR
             // 2) deleted or evicted in the full eviction.
             if (maybeKeyExistsInFilter(key)) {
-                return addTempItemAndBGFetch(hbl, key, cookie, engine, true);
+                return addTempItemAndBGFetch(hbl,
+                                             key,
+                                             cookie,
+                                             engine,
+                                             true,
+                                             BgFetchPriority::XdcrMeta);
             } else {
                 // Even though bloomfilter predicted that item doesn't exist
                 // on disk, we must put this delete on disk if the cas is valid.
@@ -2395,7 +2729,7 @@ ENGINE_ERROR_CODE VBucket::deleteWithMeta(
     }
     case MutationStatus::NeedBgFetch:
         hbl.getHTLock().unlock();
-        bgFetch(key, cookie, engine, metaBgFetch);
+        bgFetch(key, cookie, engine, metaBgFetch, BgFetchPriority::XdcrMeta);
         return ENGINE_EWOULDBLOCK;
 
     case MutationStatus::IsPendingSyncWrite:
@@ -2586,7 +2920,8 @@ std::pair<MutationStatus, GetValue> VBucket::processGetAndUpdateTtl(
         HashTable::HashBucketLock& hbl,
         StoredValue* v,
         time_t exptime,
-        const Collections::VB::CachingReadHandle& cHandle) {
+        const Collections::VB::CachingReadHandle& cHandle,
+        std::chrono::seconds touchTolerance) {
     if (v) {
         if (isLogicallyNonExistent(*v, cHandle)) {
             ht.cleanupIfTemporaryItem(hbl, *v);
@@ -2602,12 +2937,22 @@ std::pair<MutationStatus, GetValue> VBucket::processGetAndUpdateTtl(
                     GetValue(nullptr, ENGINE_KEY_EEXISTS, 0)};
         }
 
-        const bool exptime_mutated = exptime != v->getExptime();
+        // Extending the expiry by less than the tolerance is skipped: the
+        // document expires slightly earlier than asked, but a burst of
+        // touches (e.g. sessions) doesn't queue, persist and replicate the
+        // whole document each time.
+        const auto currentExptime = v->getExptime();
+        const bool withinTolerance =
+                currentExptime != 0 && exptime > currentExptime &&
+                exptime - currentExptime < touchTolerance.count();
+        const bool exptime_mutated =
+                exptime != currentExptime && !withinTolerance;
         auto bySeqNo = v->getBySeqno();
         if (exptime_mutated) {
             v->markDirty();
             v->setExptime(exptime);
             v->setRevSeqno(v->getRevSeqno() + 1);
+            ht.trackExpiry(*v);
 
             auto committedState = v->getCommitted();
 
@@ -2664,7 +3009,8 @@ GetValue VBucket::getAndUpdateTtl(
         const void* cookie,
         EventuallyPersistentEngine& engine,
         time_t exptime,
-        const Collections::VB::CachingReadHandle& cHandle) {
+        const Collections::VB::CachingReadHandle& cHandle,
+        std::chrono::seconds touchTolerance) {
     auto res = fetchValueForWrite(cHandle, QueueExpired::Yes);
     switch (res.status) {
     case FetchForWriteResult::Status::OkFound:
@@ -2673,8 +3019,11 @@ GetValue VBucket::getAndUpdateTtl(
         // if currently vacant it might exist after bgfetch.
         GetValue gv;
         MutationStatus status;
-        std::tie(status, gv) = processGetAndUpdateTtl(
-                res.lock, res.storedValue, exptime, cHandle);
+        std::tie(status, gv) = processGetAndUpdateTtl(res.lock,
+                                                      res.storedValue,
+                                                      exptime,
+                                                      cHandle,
+                                                      touchTolerance);
 
         if (status == MutationStatus::NeedBgFetch) {
             if (res.storedValue) {
@@ -2709,6 +3058,53 @@ GetValue VBucket::getInternal(const void* cookie,
     const bool getDeletedValue = (options & GET_DELETED_VALUE);
     const bool bgFetchRequired = (options & QUEUE_BG_FETCH);
 
+    // Fast path: if the HashTable permits optimistic reads, attempt to
+    // serve the common cases (resident, live item or a definite miss)
+    // without acquiring the HashBucket mutex. Anything needing the lock
+    // (expiry, temp items, bgFetches, ...) falls back to the locked path.
+    if (!getDeletedValue) {
+        if (auto fast = ht.findForReadOptimistic(cHandle.getKey(),
+                                                 trackReference,
+                                                 WantsDeleted::No,
+                                                 getReplicaItem)) {
+            const auto* v = fast->storedValue;
+            if (!v) {
+                if (eviction == EvictionPolicy::Value) {
+                    return GetValue();
+                }
+            } else if (v->isPreparedMaybeVisible()) {
+                return GetValue(nullptr,
+                                ENGINE_SYNC_WRITE_RECOMMIT_IN_PROGRESS);
+            } else if (cHandle.isLogicallyDeleted(v->getBySeqno())) {
+                return GetValue();
+            } else if (!v->isTempItem() && v->isResident() &&
+                       !v->isExpired(ep_real_time())) {
+                std::unique_ptr<Item> item;
+                if (getKeyOnly == GetKeyOnly::Yes) {
+                    item = v->toItem(getId(),
+                                     StoredValue::HideLockedCas::No,
+                                     StoredValue::IncludeValue::No);
+                } else {
+                    const auto hideLockedCas =
+                            ((options & HIDE_LOCKED_CAS) &&
+                                             v->isLocked(ep_current_time())
+                                     ? StoredValue::HideLockedCas::Yes
+                                     : StoredValue::HideLockedCas::No);
+                    item = v->toItem(getId(), hideLockedCas);
+                }
+
+                if (options & TRACK_STATISTICS) {
+                    opsGet++;
+                }
+
+                return GetValue(std::move(item),
+                                ENGINE_SUCCESS,
+                                v->getBySeqno(),
+                                false);
+            }
+        }
+    }
+
     auto res = fetchValidValue(WantsDeleted::Yes,
                                trackReference,
                                QueueExpired::Yes,
@@ -2829,7 +3225,11 @@ ENGINE_ERROR_CODE VBucket::getMetaData(
         stats.numOpsGetMeta++;
         if (v->isTempInitialItem()) {
             // Need bg meta fetch.
-            bgFetch(cHandle.getKey(), cookie, engine, true);
+            bgFetch(cHandle.getKey(),
+                    cookie,
+                    engine,
+                    true,
+                    BgFetchPriority::XdcrMeta);
             return ENGINE_EWOULDBLOCK;
         } else if (v->isTempNonExistentItem()) {
             metadata.cas = v->getCas();
@@ -2865,8 +3265,12 @@ ENGINE_ERROR_CODE VBucket::getMetaData(
         // existent on disk by the bloomfilter.
 
         if (maybeKeyExistsInFilter(cHandle.getKey())) {
-            return addTempItemAndBGFetch(
-                    hbl, cHandle.getKey(), cookie, engine, true);
+            return addTempItemAndBGFetch(hbl,
+                                         cHandle.getKey(),
+                                         cookie,
+                                         engine,
+                                         true,
+                                         BgFetchPriority::XdcrMeta);
         } else {
             stats.numOpsGetMeta++;
             return ENGINE_KEY_ENOENT;
@@ -2933,7 +3337,8 @@ GetValue VBucket::getLocked(rel_time_t currentTime,
                             uint32_t lockTimeout,
                             const void* cookie,
                             EventuallyPersistentEngine& engine,
-                            const Collections::VB::CachingReadHandle& cHandle) {
+                            const Collections::VB::CachingReadHandle& cHandle,
+                            WantsValue wantsValue) {
     auto res = fetchValueForWrite(cHandle, QueueExpired::Yes);
     switch (res.status) {
     case FetchForWriteResult::Status::OkFound: {
@@ -2948,8 +3353,9 @@ GetValue VBucket::getLocked(rel_time_t currentTime,
             return GetValue(NULL, ENGINE_LOCKED_TMPFAIL);
         }
 
-        // If the value is not resident, wait for it...
-        if (!v->isResident()) {
+        // If the value is not resident, wait for it (the lock is held by
+        // the StoredValue, so only needs the value if the caller wants it)
+        if (!v->isResident() && wantsValue == WantsValue::Yes) {
             if (cookie) {
                 bgFetch(cHandle.getKey(), cookie, engine);
             }
@@ -2959,7 +3365,11 @@ GetValue VBucket::getLocked(rel_time_t currentTime,
         // acquire lock and increment cas value
         v->lock(currentTime + lockTimeout);
 
-        auto it = v->toItem(getId());
+        auto it = v->toItem(getId(),
+                            StoredValue::HideLockedCas::No,
+                            wantsValue == WantsValue::Yes
+                                    ? StoredValue::IncludeValue::Yes
+                                    : StoredValue::IncludeValue::No);
         it->setCas(nextHLCCas());
         v->setCas(it->getCas());
 
@@ -3755,6 +4165,65 @@ void VBucket::notifyNewSeqno(
     if (newSeqnoCb) {
         newSeqnoCb->callback(getId(), notifyCtx);
     }
+    if (numSeqnoWaiters > 0) {
+        notifySeqnoWaiters(notifyCtx.bySeqno, std::chrono::steady_clock::now());
+    }
+}
+
+bool VBucket::addSeqnoWaiter(const void* cookie,
+                             uint64_t seqno,
+                             std::chrono::steady_clock::time_point deadline) {
+    std::lock_guard<std::mutex> lh(seqnoWaitersMutex);
+    // Counted before checking the high seqno, so that a concurrent new seqno
+    // either is seen here or sees the waiter.
+    ++numSeqnoWaiters;
+    if (uint64_t(getHighSeqno()) >= seqno) {
+        --numSeqnoWaiters;
+        return false;
+    }
+    seqnoWaiters.push_back({cookie, seqno, deadline});
+    return true;
+}
+
+void VBucket::notifySeqnoWaiters(uint64_t seqno,
+                                 std::chrono::steady_clock::time_point now) {
+    std::map<const void*, ENGINE_ERROR_CODE> toNotify;
+    {
+        std::lock_guard<std::mutex> lh(seqnoWaitersMutex);
+        auto it = seqnoWaiters.begin();
+        while (it != seqnoWaiters.end()) {
+            if (it->seqno <= seqno) {
+                toNotify[it->cookie] = ENGINE_SUCCESS;
+            } else if (it->deadline < now) {
+                toNotify[it->cookie] = ENGINE_TMPFAIL;
+            } else {
+                ++it;
+                continue;
+            }
+            it = seqnoWaiters.erase(it);
+        }
+        numSeqnoWaiters = seqnoWaiters.size();
+    }
+
+    if (!toNotify.empty() && seqnoWaitersNotifyCb) {
+        seqnoWaitersNotifyCb(toNotify);
+    }
+}
+
+void VBucket::failAllSeqnoWaiters() {
+    std::map<const void*, ENGINE_ERROR_CODE> toNotify;
+    {
+        std::lock_guard<std::mutex> lh(seqnoWaitersMutex);
+        for (const auto& waiter : seqnoWaiters) {
+            toNotify[waiter.cookie] = ENGINE_TMPFAIL;
+        }
+        seqnoWaiters.clear();
+        numSeqnoWaiters = 0;
+    }
+
+    if (!toNotify.empty() && seqnoWaitersNotifyCb) {
+        seqnoWaitersNotifyCb(toNotify);
+    }
 }
 
 void VBucket::doCollectionsStats(
@@ -35,6 +35,7 @@
 #include <relaxed_atomic.h>
 #include <atomic>
 #include <list>
+#include <map>
 #include <queue>
 
 class ActiveDurabilityMonitor;
@@ -52,6 +53,7 @@ class EventuallyPersistentEngine;
 class GetValue;
 class ItemMetaData;
 class KVStore;
+class MetaBounds;
 class PassiveDurabilityMonitor;
 class PreLinkDocumentContext;
 class RollbackResult;
@@ -119,6 +121,15 @@ using SyncWriteCompleteCallback =
 const SyncWriteCompleteCallback NoopSyncWriteCompleteCb =
         [](const void* cookie, ENGINE_ERROR_CODE status) {};
 
+/**
+ * Callback function invoked when a batch of accepted SyncWrite operations
+ * have been completed; notifies all of the cookies (in order) at once.
+ */
+using SyncWriteCompletions =
+        std::vector<std::pair<const void*, ENGINE_ERROR_CODE>>;
+using SyncWriteCompleteBatchCallback =
+        std::function<void(const SyncWriteCompletions& toNotify)>;
+
 /**
  * Callback function invoked at Replica for sending a SeqnoAck message to the
  * Active. That is triggered at Replica by High Prepared Seqno updates within
@@ -126,6 +137,22 @@ const SyncWriteCompleteCallback NoopSyncWriteCompleteCb =
  */
 using SeqnoAckCallback = std::function<void(Vbid vbid, int64_t seqno)>;
 
+/**
+ * Callback function invoked by ActiveDurabilityMonitor when the expiry-time of
+ * its next SyncWrite to time out changes. Used to wake the
+ * DurabilityTimeoutTask for the vBucket at that time rather than have it poll
+ * every vBucket.
+ */
+using SyncWriteExpiryCallback = std::function<void(
+        Vbid vbid, std::chrono::steady_clock::time_point expiry)>;
+
+/**
+ * Callback function invoked to tell the connections waiting for a seqno of a
+ * vBucket (see VBucket::addSeqnoWaiter()) the outcome of their wait.
+ */
+using SeqnoWaitersNotifyCallback = std::function<void(
+        const std::map<const void*, ENGINE_ERROR_CODE>& toNotify)>;
+
 /// Instance of SeqnoAckCallback which does nothing.
 const SeqnoAckCallback NoopSeqnoAckCb = [](Vbid vbid, int64_t seqno) {};
 
@@ -207,6 +234,9 @@ public:
 
     size_t getChkMgrMemUsageOverhead() const;
 
+    /// The three getChkMgrMemUsage* values under a single checkpoint lock
+    CheckpointMemoryUsage getChkMgrMemUsages() const;
+
     uint64_t getPurgeSeqno() const {
         return purge_seqno;
     }
@@ -390,11 +420,30 @@ public:
         persistenceSeqno.store(seqno);
     }
 
+    /**
+     * @returns the seqno up to which the mutations of the VBucket survive a
+     * crash: either persisted to the vBucket file, or written to the
+     * DurabilityLog and not yet committed. This is what satisfies the
+     * persistence of prepared SyncWrites.
+     */
+    uint64_t getDurablePersistenceSeqno() const {
+        return std::max(getPersistenceSeqno(), durabilityLogSeqno.load());
+    }
+
+    /// Set the high seqno of the last batch written to the DurabilityLog
+    void setDurabilityLogSeqno(uint64_t seqno) {
+        durabilityLogSeqno.store(seqno);
+    }
+
     Vbid getId() const {
         return id;
     }
     vbucket_state_t getState() const { return state.load(); }
 
+    EvictionPolicy getEvictionPolicy() const {
+        return eviction;
+    }
+
     /**
      * Sets the vbucket state to a desired state
      *
@@ -438,6 +487,17 @@ public:
 
     void notifySyncWritesPendingCompletion();
 
+    /// @return true if a SyncWriteExpiryCallback has been set
+    bool hasSyncWriteExpiryCallback() const {
+        return bool(syncWriteExpiryCb);
+    }
+
+    /**
+     * Notify the SyncWriteExpiryCallback (if set) of the expiry-time of the
+     * next SyncWrite to time out in this VBucket.
+     */
+    void notifySyncWriteExpiry(std::chrono::steady_clock::time_point expiry);
+
     /**
      * For all SyncWrites which the DurabilityMonitor has resolved (to be
      * committed or aborted), perform the appropriate operation - i.e.
@@ -653,8 +713,12 @@ public:
     /**
      * BloomFilter operations for vbucket
      */
-    void createFilter(size_t key_count, double probability);
-    void initTempFilter(size_t key_count, double probability);
+    void createFilter(size_t key_count,
+                      double probability,
+                      BloomFilterType type = BloomFilterType::Classic);
+    void initTempFilter(size_t key_count,
+                        double probability,
+                        BloomFilterType type = BloomFilterType::Classic);
     void addToFilter(const DocKey& key);
     virtual bool maybeKeyExistsInFilter(const DocKey& key);
     bool isTempFilterAvailable();
@@ -663,6 +727,39 @@ public:
     void clearFilter();
     void setFilterStatus(bfilter_status_t to);
     std::string getFilterStatusString();
+
+    /**
+     * @returns the main bloom filter serialised (see BloomFilter::serialise)
+     * for persisting, or an empty string if there is no populated filter.
+     */
+    std::string serialiseFilter();
+
+    /**
+     * Install the given filter (e.g. loaded from disk at warmup) as the main
+     * bloom filter.
+     * @return true if installed, false if a filter already exists.
+     */
+    bool restoreFilter(std::unique_ptr<BloomFilter> filter);
+
+    /**
+     * Create the (empty) bounds of the CAS and revision seqno of the
+     * documents of the vBucket (see MetaBounds). Must only be called for
+     * a new (empty) vBucket, before it's made visible.
+     */
+    void createMetaBounds(size_t size);
+
+    /**
+     * Install the bounds loaded from disk at warmup (before the vBucket is
+     * made visible).
+     */
+    void restoreMetaBounds(std::unique_ptr<MetaBounds> bounds);
+
+    /**
+     * @returns the bounds of the documents serialised (see
+     * MetaBounds::serialise) for persisting, or an empty string if the
+     * vBucket has no bounds.
+     */
+    std::string serialiseMetaBounds() const;
     size_t getFilterSize();
     size_t getNumOfKeysInFilter();
 
@@ -1009,6 +1106,63 @@ public:
                           cb::StoreIfPredicate predicate,
                           const Collections::VB::CachingReadHandle& cHandle);
 
+    /**
+     * Increment or decrement the counter stored in an existing document,
+     * reading and updating it under a single hold of its HashBucketLock
+     * (see EngineIface::arithmetic).
+     *
+     * Only resident, unlocked documents with a plain (uncompressed, no
+     * xattrs) value and no SyncWrite in progress are updated; for anything
+     * else ENGINE_ENOTSUP is returned and the frontend falls back to a get
+     * and CAS store.
+     *
+     * @param increment true to increment the counter, false to decrement it
+     * @param delta the amount to increment or decrement the counter by
+     * @param cookie the connection cookie
+     * @param engine Reference to ep engine
+     * @param cHandle Collections readhandle (caching mode) for this key
+     * @param [out] result the new value of the counter
+     * @param [out] cas the CAS of the document after the update
+     * @param [out] mutInfo the vbucket uuid and seqno of the update
+     * @return ENGINE_ERROR_CODE status notified to be to the front end
+     */
+    ENGINE_ERROR_CODE arithmetic(
+            bool increment,
+            uint64_t delta,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            const Collections::VB::CachingReadHandle& cHandle,
+            uint64_t& result,
+            uint64_t& cas,
+            mutation_descr_t& mutInfo);
+
+    /**
+     * Append or prepend to the value of an existing document, building the
+     * new value and storing it under a single hold of its HashBucketLock
+     * (see EngineIface::appendPrepend).
+     *
+     * Only resident, unlocked documents with no SyncWrite in progress are
+     * updated; for anything else ENGINE_ENOTSUP is returned and the
+     * frontend falls back to a get and CAS store.
+     *
+     * @param append true to append the value, false to prepend it
+     * @param value the (uncompressed) data to append or prepend
+     * @param cookie the connection cookie
+     * @param engine Reference to ep engine
+     * @param cHandle Collections readhandle (caching mode) for this key
+     * @param [out] cas the CAS of the document after the update
+     * @param [out] mutInfo the vbucket uuid and seqno of the update
+     * @return ENGINE_ERROR_CODE status notified to be to the front end
+     */
+    ENGINE_ERROR_CODE appendPrepend(
+            bool append,
+            std::string_view value,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            const Collections::VB::CachingReadHandle& cHandle,
+            uint64_t& cas,
+            mutation_descr_t& mutInfo);
+
     /**
      * Replace (overwrite existing) an item in the vbucket.
      *
@@ -1220,13 +1374,16 @@ public:
      * @param engine Reference to ep engine
      * @param exptime the new expiry time for the object
      * @param cHandle Collections readhandle (caching mode) for this key
+     * @param touchTolerance extensions of an existing expiry time by less
+     *        than this are not applied (see touch_expiry_tolerance)
      *
      * @return a GetValue representing the result of the request
      */
     GetValue getAndUpdateTtl(const void* cookie,
                              EventuallyPersistentEngine& engine,
                              time_t exptime,
-                             const Collections::VB::CachingReadHandle& cHandle);
+                             const Collections::VB::CachingReadHandle& cHandle,
+                             std::chrono::seconds touchTolerance);
     /**
      * Add a system event Item to the vbucket and return its seqno. Does
      * not set the collection high seqno of the item as that requires a read
@@ -1273,6 +1430,17 @@ public:
                          const Collections::VB::CachingReadHandle& cHandle,
                          ForGetReplicaOp getReplicaItem = ForGetReplicaOp::No);
 
+    /**
+     * Start loading the value for the given key into memory if it isn't
+     * resident, without anyone waiting for it. Used when the front end
+     * tells us it will request the key soon, so that the fetch can be
+     * part of the same BgFetcher batch as the request it is blocked on.
+     *
+     * @param cHandle Collections readhandle (caching mode) for this key
+     * @return true if a background fetch was queued for the key
+     */
+    virtual bool prefetch(const Collections::VB::CachingReadHandle& cHandle) = 0;
+
     /**
      * Retrieve the meta data for given key
      *
@@ -1323,6 +1491,8 @@ public:
      * @param cookie The client's cookie
      * @param engine Reference to ep engine
      * @param cHandle Collections readhandle (caching mode) for this key
+     * @param wantsValue if No return the item without its value (and don't
+     *                   fetch an evicted value)
      *
      * @return the result of the operation (contains locked item on success)
      */
@@ -1330,7 +1500,8 @@ public:
                        uint32_t lockTimeout,
                        const void* cookie,
                        EventuallyPersistentEngine& engine,
-                       const Collections::VB::CachingReadHandle& cHandle);
+                       const Collections::VB::CachingReadHandle& cHandle,
+                       WantsValue wantsValue = WantsValue::Yes);
 
     /**
      * Perform a commit against the given pending Sync Write.
@@ -1402,6 +1573,63 @@ public:
     void notifyClientOfSyncWriteComplete(const void* cookie,
                                          ENGINE_ERROR_CODE result);
 
+    /**
+     * Notify a batch of client connections that the processing of their
+     * SyncWrites has been completed.
+     *
+     * @param toNotify The client cookies and the result of their SyncWrite
+     */
+    void notifyClientsOfSyncWriteComplete(
+            const SyncWriteCompletions& toNotify);
+
+    /**
+     * Set the callback used by notifyClientsOfSyncWriteComplete(). If not set
+     * each client is notified individually with the SyncWriteCompleteCallback.
+     */
+    void setSyncWriteCompleteBatchCallback(SyncWriteCompleteBatchCallback cb) {
+        syncWriteCompleteBatchCb = std::move(cb);
+    }
+
+    /**
+     * Set the callback used by notifySyncWriteExpiry(). If not set the
+     * ActiveDM doesn't track its next expiry-time, and SyncWrites are only
+     * timed out by a periodic processDurabilityTimeout().
+     */
+    void setSyncWriteExpiryCallback(SyncWriteExpiryCallback cb) {
+        syncWriteExpiryCb = std::move(cb);
+    }
+
+    /**
+     * Register a connection to be notified once this vBucket has received (at
+     * least) the given seqno, or the deadline has passed - whichever is
+     * first. Used by replica reads carrying a consistency token.
+     *
+     * @return false if the seqno has already been reached (the connection
+     *         will not be notified)
+     */
+    bool addSeqnoWaiter(const void* cookie,
+                        uint64_t seqno,
+                        std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * Notify (via the SeqnoWaitersNotifyCallback) the seqno waiters for which
+     * this vBucket has reached the given seqno with ENGINE_SUCCESS, and those
+     * whose deadline is before `now` with ENGINE_TMPFAIL.
+     */
+    void notifySeqnoWaiters(uint64_t seqno,
+                            std::chrono::steady_clock::time_point now);
+
+    /// Notify all seqno waiters with ENGINE_TMPFAIL.
+    void failAllSeqnoWaiters();
+
+    size_t getNumSeqnoWaiters() const {
+        return numSeqnoWaiters;
+    }
+
+    void setSeqnoWaitersNotifyCallback(SeqnoWaitersNotifyCallback cb) {
+        seqnoWaitersNotifyCb = std::move(cb);
+    }
+
     /**
      * Notify the PassiveDM that the snapshot-end mutation for the currently
      * processed snapshot has been received.
@@ -1413,6 +1641,17 @@ public:
      */
     void notifyPassiveDMOfSnapEndReceived(uint64_t snapEnd);
 
+    /**
+     * Notify the PassiveDM that a Prepare has been received by the
+     * PassiveStream (ahead of it being processed), so Majority Prepares
+     * may be acked to the Active on receive.
+     *
+     * @param seqno The seqno of the Prepare
+     * @param level The durability level of the Prepare
+     */
+    void notifyPassiveDMOfPrepareReceived(int64_t seqno,
+                                          cb::durability::Level level);
+
     /**
      * Send a SeqnoAck message on the PassiveStream (if any) for this VBucket.
      *
@@ -1576,6 +1815,11 @@ public:
      */
     static void setMutationMemoryThreshold(size_t memThreshold);
 
+    /// @return the fraction of the bucket quota mutations may use
+    static double getMutationMemoryThreshold() {
+        return mutationMemThreshold;
+    }
+
     /**
      * Check if this StoredValue has become logically non-existent.
      * By logically non-existent, the item has been deleted
@@ -1728,7 +1972,8 @@ protected:
             HashTable::HashBucketLock& hbl,
             StoredValue* v,
             time_t exptime,
-            const Collections::VB::CachingReadHandle& cHandle);
+            const Collections::VB::CachingReadHandle& cHandle,
+            std::chrono::seconds touchTolerance);
     /**
      * This function checks cas, expiry and other partition (vbucket) related
      * rules before setting an item into other in-memory structure like HT,
@@ -1754,6 +1999,31 @@ protected:
      * @return Result indicating the status of the operation and notification
      *                info (if operation was successful).
      */
+    /**
+     * @return the committed StoredValue found by htRes if the frontend may
+     *         leave its update to the engine (see arithmetic and
+     *         appendPrepend), else nullptr
+     */
+    StoredValue* selectSVForUpdateInEngine(
+            const HashTable::FindUpdateResult& htRes) const;
+
+    /**
+     * Store the update (built by the engine from v) of a document selected
+     * by selectSVForUpdateInEngine, still holding the HashBucketLock.
+     *
+     * @param [out] cas the CAS of the document after the update
+     * @param [out] mutInfo the vbucket uuid and seqno of the update
+     */
+    ENGINE_ERROR_CODE storeUpdateInEngine(
+            HashTable::FindUpdateResult& htRes,
+            StoredValue* v,
+            Item& itm,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            const Collections::VB::CachingReadHandle& cHandle,
+            uint64_t& cas,
+            mutation_descr_t& mutInfo);
+
     std::pair<MutationStatus, std::optional<VBNotifyCtx>> processSet(
             HashTable::FindUpdateResult& htRes,
             StoredValue*& v,
@@ -2031,6 +2301,12 @@ protected:
             UseActiveVBMemThreshold useActiveVBMemThrehsold =
                     UseActiveVBMemThreshold::No);
 
+    /**
+     * Does the item (from setWithMeta) win the conflict resolution against
+     * any version of its document the vBucket may have (see MetaBounds)?
+     */
+    bool winsAgainstMetaBounds(const Item& item) const;
+
     void _addStats(VBucketStatsDetailLevel detail,
                    const AddStatFn& add_stat,
                    const void* c);
@@ -2050,6 +2326,9 @@ protected:
     /* last seqno that is persisted on the disk */
     std::atomic<uint64_t> persistenceSeqno;
 
+    /* high seqno of the last flush batch written to the DurabilityLog */
+    std::atomic<uint64_t> durabilityLogSeqno{0};
+
     /* holds all high priority async requests to the vbucket */
     std::list<HighPriorityVBEntry> hpVBReqs;
 
@@ -2271,6 +2550,7 @@ private:
      * @param engine Reference to ep engine
      * @param metadataOnly whether the fetch is for a non-resident value or
      *                     metadata of a (possibly) deleted item
+     * @param priority the priority of the fetch
      *
      * @return ENGINE_ERROR_CODE status notified to be to the front end
      */
@@ -2279,7 +2559,8 @@ private:
             const DocKey& key,
             const void* cookie,
             EventuallyPersistentEngine& engine,
-            bool metadataOnly) = 0;
+            bool metadataOnly,
+            BgFetchPriority priority = BgFetchPriority::ClientRead) = 0;
 
     /**
      * Enqueue a background fetch for a key.
@@ -2289,11 +2570,14 @@ private:
      * @param engine Reference to ep engine
      * @param isMeta whether the fetch is for a non-resident value or metadata
      *               of a (possibly) deleted item
+     * @param priority the priority of the fetch
      */
-    virtual void bgFetch(const DocKey& key,
-                         const void* cookie,
-                         EventuallyPersistentEngine& engine,
-                         bool isMeta = false) = 0;
+    virtual void bgFetch(
+            const DocKey& key,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            bool isMeta = false,
+            BgFetchPriority priority = BgFetchPriority::ClientRead) = 0;
 
     /**
      * Enqueue a background fetch (due to compaction) to expire a key.
@@ -2460,6 +2744,12 @@ private:
     std::unique_ptr<BloomFilter> bFilter;
     std::unique_ptr<BloomFilter> tempFilter;    // Used during compaction.
 
+    /**
+     * The bounds of the CAS and revision seqno of the documents of the
+     * vBucket, if they're known (only set before the vBucket is visible)
+     */
+    std::unique_ptr<MetaBounds> metaBounds;
+
     std::atomic<uint64_t> rollbackItemCount;
 
     HLC hlc;
@@ -2493,6 +2783,28 @@ private:
      */
     SyncWriteCompleteCallback syncWriteCompleteCb;
 
+    // Callback invoked (if set) for a batch of completed SyncWrites
+    SyncWriteCompleteBatchCallback syncWriteCompleteBatchCb;
+
+    // Callback invoked (if set) when the next SyncWrite expiry-time changes
+    SyncWriteExpiryCallback syncWriteExpiryCb;
+
+    struct SeqnoWaiter {
+        const void* cookie;
+        uint64_t seqno;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    // Connections waiting for the vBucket to reach a seqno (see
+    // addSeqnoWaiter())
+    std::vector<SeqnoWaiter> seqnoWaiters;
+    std::mutex seqnoWaitersMutex;
+    // Size of seqnoWaiters, so that new seqnos don't need to take the mutex
+    std::atomic<size_t> numSeqnoWaiters{0};
+
+    // Callback invoked (if set) to notify the seqno waiters
+    SeqnoWaitersNotifyCallback seqnoWaitersNotifyCb;
+
     /**
      * Callback invoked by a Replica VBucket after a High Prepared Seqno update
      * within the PassiveDurabilityMonitor.
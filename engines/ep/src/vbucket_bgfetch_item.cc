@@ -26,8 +26,12 @@ FrontEndBGFetchItem::FrontEndBGFetchItem(
         GetValue* value,
         std::chrono::steady_clock::time_point initTime,
         bool metaOnly,
-        const void* cookie)
-    : BGFetchItem(value, initTime), cookie(cookie), metaOnly(metaOnly) {
+        const void* cookie,
+        BgFetchPriority priority)
+    : BGFetchItem(value, initTime),
+      cookie(cookie),
+      metaOnly(metaOnly),
+      priority(priority) {
     auto* traceable = cookie2traceable(cookie);
     if (traceable && traceable->isTracingEnabled()) {
         NonBucketAllocationGuard guard;
@@ -40,10 +44,11 @@ void FrontEndBGFetchItem::complete(
         EventuallyPersistentEngine& engine,
         VBucketPtr& vb,
         std::chrono::steady_clock::time_point startTime,
-        const DiskDocKey& key) const {
+        const DiskDocKey& key,
+        std::map<const void*, ENGINE_ERROR_CODE>& toNotify) const {
     ENGINE_ERROR_CODE status =
             vb->completeBGFetchForSingleItem(key, *this, startTime);
-    engine.notifyIOComplete(cookie, status);
+    toNotify[cookie] = status;
 }
 
 void FrontEndBGFetchItem::abort(
@@ -54,11 +59,29 @@ void FrontEndBGFetchItem::abort(
     engine.storeEngineSpecific(cookie, nullptr);
 }
 
+void PrefetchBGFetchItem::complete(
+        EventuallyPersistentEngine& engine,
+        VBucketPtr& vb,
+        std::chrono::steady_clock::time_point startTime,
+        const DiskDocKey& key,
+        std::map<const void*, ENGINE_ERROR_CODE>& toNotify) const {
+    vb->completeBGFetchForSingleItem(key, *this, startTime);
+}
+
+void PrefetchBGFetchItem::abort(
+        EventuallyPersistentEngine& engine,
+        ENGINE_ERROR_CODE status,
+        std::map<const void*, ENGINE_ERROR_CODE>& toNotify) const {
+    // Do nothing. Nobody is waiting for a prefetch; the request which
+    // follows it will BGFetch the key again.
+}
+
 void CompactionBGFetchItem::complete(
         EventuallyPersistentEngine& engine,
         VBucketPtr& vb,
         std::chrono::steady_clock::time_point startTime,
-        const DiskDocKey& key) const {
+        const DiskDocKey& key,
+        std::map<const void*, ENGINE_ERROR_CODE>& toNotify) const {
     auto* epvb = dynamic_cast<EPVBucket*>(vb.get());
     Expects(epvb);
     epvb->completeCompactionExpiryBgFetch(key, *this);
@@ -19,12 +19,14 @@
 
 #include "callbacks.h"
 #include "diskdockey.h"
+#include "ep_types.h"
 #include "item.h"
 #include "objectregistry.h"
 #include "trace_helpers.h"
 #include "vbucket_fwd.h"
 
 #include <list>
+#include <map>
 #include <unordered_map>
 
 enum class GetMetaOnly;
@@ -41,17 +43,21 @@ public:
     virtual ~BGFetchItem() = default;
 
     /**
-     * Complete the BG Fetch.
+     * Complete the BG Fetch and add the cookie waiting for it (if any) to the
+     * toNotify map.
      *
      * @param engine EPEngine instance
      * @param vb VBucket pointer
      * @param startTime Time at which we started the BG Fetch
      * @param key Key of the item
+     * @param [out]toNotify Map to add cookie and status code to
      */
-    virtual void complete(EventuallyPersistentEngine& engine,
-                          VBucketPtr& vb,
-                          std::chrono::steady_clock::time_point startTime,
-                          const DiskDocKey& key) const = 0;
+    virtual void complete(
+            EventuallyPersistentEngine& engine,
+            VBucketPtr& vb,
+            std::chrono::steady_clock::time_point startTime,
+            const DiskDocKey& key,
+            std::map<const void*, ENGINE_ERROR_CODE>& toNotify) const = 0;
 
     /**
      * Abort the BG Fetch and add it to the toNotify map.
@@ -70,6 +76,21 @@ public:
      */
     virtual bool metaDataOnly() const = 0;
 
+    /**
+     * @return the cookie waiting for the BG Fetch, or nullptr if nobody
+     *         waits for it
+     */
+    virtual const void* getCookie() const {
+        return nullptr;
+    }
+
+    /**
+     * @return the priority with which the BgFetcher services the fetch
+     */
+    virtual BgFetchPriority getPriority() const {
+        return BgFetchPriority::Background;
+    }
+
     GetValue* value;
     const std::chrono::steady_clock::time_point initTime;
 };
@@ -80,20 +101,30 @@ public:
  */
 class FrontEndBGFetchItem : public BGFetchItem {
 public:
-    FrontEndBGFetchItem(const void* cookie, bool metaOnly)
-        : FrontEndBGFetchItem(
-                  nullptr, std::chrono::steady_clock::now(), metaOnly, cookie) {
+    FrontEndBGFetchItem(
+            const void* cookie,
+            bool metaOnly,
+            BgFetchPriority priority = BgFetchPriority::ClientRead)
+        : FrontEndBGFetchItem(nullptr,
+                              std::chrono::steady_clock::now(),
+                              metaOnly,
+                              cookie,
+                              priority) {
     }
 
-    FrontEndBGFetchItem(GetValue* value,
-                        std::chrono::steady_clock::time_point initTime,
-                        bool metaOnly,
-                        const void* cookie);
+    FrontEndBGFetchItem(
+            GetValue* value,
+            std::chrono::steady_clock::time_point initTime,
+            bool metaOnly,
+            const void* cookie,
+            BgFetchPriority priority = BgFetchPriority::ClientRead);
 
-    void complete(EventuallyPersistentEngine& engine,
-                  VBucketPtr& vb,
-                  std::chrono::steady_clock::time_point startTime,
-                  const DiskDocKey& key) const override;
+    void complete(
+            EventuallyPersistentEngine& engine,
+            VBucketPtr& vb,
+            std::chrono::steady_clock::time_point startTime,
+            const DiskDocKey& key,
+            std::map<const void*, ENGINE_ERROR_CODE>& toNotify) const override;
 
     void abort(
             EventuallyPersistentEngine& engine,
@@ -104,9 +135,42 @@ public:
         return metaOnly;
     }
 
+    const void* getCookie() const override {
+        return cookie;
+    }
+
+    BgFetchPriority getPriority() const override {
+        return priority;
+    }
+
     const void* cookie;
     cb::tracing::SpanId traceSpanId;
     bool metaOnly;
+    const BgFetchPriority priority;
+};
+
+/**
+ * BGFetch context class for a prefetch (a hint from the front end that the
+ * key is about to be requested). It restores the value into the HashTable
+ * like a front end fetch, but there is no cookie to notify.
+ */
+class PrefetchBGFetchItem : public FrontEndBGFetchItem {
+public:
+    PrefetchBGFetchItem()
+        : FrontEndBGFetchItem(nullptr, false, BgFetchPriority::Background) {
+    }
+
+    void complete(
+            EventuallyPersistentEngine& engine,
+            VBucketPtr& vb,
+            std::chrono::steady_clock::time_point startTime,
+            const DiskDocKey& key,
+            std::map<const void*, ENGINE_ERROR_CODE>& toNotify) const override;
+
+    void abort(
+            EventuallyPersistentEngine& engine,
+            ENGINE_ERROR_CODE status,
+            std::map<const void*, ENGINE_ERROR_CODE>& toNotify) const override;
 };
 
 /**
@@ -120,10 +184,12 @@ public:
           compactionItem(item) {
     }
 
-    void complete(EventuallyPersistentEngine& engine,
-                  VBucketPtr& vb,
-                  std::chrono::steady_clock::time_point startTime,
-                  const DiskDocKey& key) const override;
+    void complete(
+            EventuallyPersistentEngine& engine,
+            VBucketPtr& vb,
+            std::chrono::steady_clock::time_point startTime,
+            const DiskDocKey& key,
+            std::map<const void*, ENGINE_ERROR_CODE>& toNotify) const override;
 
     void abort(
             EventuallyPersistentEngine& engine,
@@ -145,5 +211,8 @@ public:
 struct vb_bgfetch_item_ctx_t {
     std::list<std::unique_ptr<BGFetchItem>> bgfetched_list;
     GetMetaOnly isMetaOnly;
+    /// The highest priority of the items in bgfetched_list; the key is
+    /// fetched once for all of them
+    BgFetchPriority priority = BgFetchPriority::Background;
     GetValue value;
 };
@@ -43,9 +43,11 @@
 #include <utilities/logtags.h>
 
 #include <array>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <random>
+#include <stdexcept>
 #include <string>
 #include <utility>
 
@@ -157,6 +159,41 @@ private:
     Warmup* _warmup;
 };
 
+class WarmupReplayDurabilityLog : public GlobalTask {
+public:
+    WarmupReplayDurabilityLog(EPBucket& st, uint16_t sh, Warmup& w)
+        : GlobalTask(&st.getEPEngine(),
+                     TaskId::WarmupReplayDurabilityLog,
+                     0,
+                     false),
+          shardId(sh),
+          warmup(w) {
+        warmup.addToTaskSet(uid);
+    }
+
+    std::string getDescription() override {
+        return "Warmup - replaying durability log: shard " +
+               std::to_string(shardId);
+    }
+
+    std::chrono::microseconds maxExpectedDuration() override {
+        // Usually there's nothing to replay; otherwise at most one flush
+        // batch per vBucket is committed.
+        return std::chrono::seconds(1);
+    }
+
+    bool run() override {
+        TRACE_EVENT0("ep-engine/task", "WarmupReplayDurabilityLog");
+        warmup.replayDurabilityLog(shardId);
+        warmup.removeFromTaskSet(uid);
+        return false;
+    }
+
+private:
+    uint16_t shardId;
+    Warmup& warmup;
+};
+
 class WarmupCreateVBuckets : public GlobalTask {
 public:
     WarmupCreateVBuckets(EPBucket& st, uint16_t sh, Warmup* w)
@@ -305,6 +342,42 @@ private:
     const std::string description;
 };
 
+class WarmupLoadBloomFilters : public GlobalTask {
+public:
+    WarmupLoadBloomFilters(EPBucket& st, uint16_t shard, Warmup& warmup)
+        : GlobalTask(&st.getEPEngine(),
+                     TaskId::WarmupLoadBloomFilters,
+                     0,
+                     false),
+          shardId(shard),
+          warmup(warmup),
+          description("Warmup - loading bloom filters: shard " +
+                      std::to_string(shardId)){};
+
+    std::string getDescription() override {
+        return description;
+    }
+
+    std::chrono::microseconds maxExpectedDuration() override {
+        // Runtime is a function of the size of the persisted filters; each
+        // is typically a few hundred KB to a few MB.
+        return std::chrono::seconds(1);
+    }
+
+    bool run() override {
+        TRACE_EVENT1(
+                "ep-engine/task", "WarmupLoadBloomFilters", "shard", shardId);
+        warmup.loadBloomFiltersForShard(shardId);
+        warmup.removeFromTaskSet(uid);
+        return false;
+    }
+
+private:
+    uint16_t shardId;
+    Warmup& warmup;
+    const std::string description;
+};
+
 /**
  * Warmup task which moves all warmed-up VBuckets into the bucket's vbMap
  */
@@ -520,6 +593,55 @@ private:
     const std::string _description;
 };
 
+/**
+ * One of the tasks loading vBuckets in parallel in the LoadingKVPairs or
+ * LoadingData phase (see Warmup::scheduleLoadingVBuckets). Each run loads
+ * the next vBucket in Warmup's load queue.
+ */
+class WarmupLoadVBuckets : public GlobalTask {
+public:
+    WarmupLoadVBuckets(EPBucket& st,
+                       TaskId taskId,
+                       size_t taskNum,
+                       bool maybeEnableTraffic,
+                       Warmup* w)
+        : GlobalTask(&st.getEPEngine(), taskId, 0, false),
+          _maybeEnableTraffic(maybeEnableTraffic),
+          _warmup(w),
+          _description(
+                  std::string(taskId == TaskId::WarmupLoadingKVPairs
+                                      ? "Warmup - loading KV Pairs: task "
+                                      : "Warmup - loading data: task ") +
+                  std::to_string(taskNum)) {
+        _warmup->addToTaskSet(uid);
+    }
+
+    std::string getDescription() override {
+        return _description;
+    }
+
+    std::chrono::microseconds maxExpectedDuration() override {
+        // Runtime is a function of the number of documents in the vBucket
+        // which can be held in RAM (and need to be loaded from disk).
+        return std::chrono::hours(1);
+    }
+
+    bool run() override {
+        TRACE_EVENT0("ep-engine/task", "WarmupLoadVBuckets");
+        if (_warmup->loadNextVBucket(_maybeEnableTraffic)) {
+            return true;
+        }
+        _warmup->removeFromTaskSet(uid);
+        _warmup->loadVBucketsTaskDone();
+        return false;
+    }
+
+private:
+    const bool _maybeEnableTraffic;
+    Warmup* _warmup;
+    const std::string _description;
+};
+
 class WarmupCompletion : public GlobalTask {
 public:
     WarmupCompletion(EPBucket& st, Warmup* w)
@@ -567,7 +689,9 @@ static bool batchWarmupCallback(Vbid vbId,
             bg_itm_ctx.bgfetched_list.back()->value = &bg_itm_ctx.value;
         }
 
-        c->epstore->getROUnderlying(vbId)->getMulti(vbId, items2fetch);
+        // Fetch in bulk - the bodies are read in file order with readahead,
+        // rather than in key order.
+        c->epstore->getROUnderlying(vbId)->getMultiBulk(vbId, items2fetch);
 
         // applyItem controls the  mode this loop operates in.
         // true we will attempt the callback (attempt a HashTable insert)
@@ -620,6 +744,8 @@ const char* WarmupState::getStateDescription(State st) const {
     switch (st) {
     case State::Initialize:
         return "initialize";
+    case State::ReplayDurabilityLog:
+        return "replaying durability log";
     case State::CreateVBuckets:
         return "creating vbuckets";
     case State::LoadingCollectionCounts:
@@ -628,6 +754,8 @@ const char* WarmupState::getStateDescription(State st) const {
         return "estimating database item count";
     case State::LoadPreparedSyncWrites:
         return "loading prepared SyncWrites";
+    case State::LoadingBloomFilters:
+        return "loading bloom filters";
     case State::PopulateVBucketMap:
         return "populating vbucket map";
     case State::KeyDump:
@@ -664,6 +792,8 @@ void WarmupState::transition(State to, bool allowAnystate) {
 bool WarmupState::legalTransition(State to) const {
     switch (state.load()) {
     case State::Initialize:
+        return (to == State::ReplayDurabilityLog);
+    case State::ReplayDurabilityLog:
         return (to == State::CreateVBuckets);
     case State::CreateVBuckets:
         return (to == State::LoadingCollectionCounts);
@@ -672,6 +802,8 @@ bool WarmupState::legalTransition(State to) const {
     case State::EstimateDatabaseItemCount:
         return (to == State::LoadPreparedSyncWrites);
     case State::LoadPreparedSyncWrites:
+        return (to == State::LoadingBloomFilters);
+    case State::LoadingBloomFilters:
         return (to == State::PopulateVBucketMap);
     case State::PopulateVBucketMap:
         return (to == State::KeyDump || to == State::CheckForAccessLog);
@@ -990,7 +1122,34 @@ void Warmup::initialize()
     }
 
     populateShardVbStates();
-    transition(WarmupState::State::CreateVBuckets);
+    transition(WarmupState::State::ReplayDurabilityLog);
+}
+
+void Warmup::scheduleReplayDurabilityLog() {
+    threadtask_count = 0;
+    for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
+        ExTask task =
+                std::make_shared<WarmupReplayDurabilityLog>(store, i, *this);
+        ExecutorPool::get()->schedule(task);
+    }
+}
+
+void Warmup::replayDurabilityLog(uint16_t shardId) {
+    if (store.getDurabilityLog()) {
+        for (auto& itr : shardVbStates[shardId]) {
+            const auto vbid = itr.first;
+            auto state = store.replayDurabilityLog(vbid, itr.second);
+            if (state) {
+                // The RO KVStore caches the vbucket_state too
+                store.getROUnderlying(vbid)->setVBucketState(vbid, *state);
+                itr.second = *state;
+            }
+        }
+    }
+
+    if (++threadtask_count == store.vbMap.getNumShards()) {
+        transition(WarmupState::State::CreateVBuckets);
+    }
 }
 
 void Warmup::scheduleCreateVBuckets()
@@ -1254,6 +1413,100 @@ void Warmup::loadPreparedSyncWrites(uint16_t shardId) {
     }
 
     if (++threadtask_count == store.vbMap.getNumShards()) {
+        transition(WarmupState::State::LoadingBloomFilters);
+    }
+}
+
+void Warmup::scheduleLoadingBloomFilters() {
+    threadtask_count = 0;
+    bloomFilterStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
+        ExTask task = std::make_shared<WarmupLoadBloomFilters>(store, i, *this);
+        ExecutorPool::get()->schedule(task);
+    }
+}
+
+void Warmup::loadMetaBounds(VBucket& vb) {
+    const auto fname = store.getMetaBoundsFileName(vb.getId());
+    if (!cb::io::isFile(fname)) {
+        return;
+    }
+
+    try {
+        if (config.getXdcrMetaBoundsSize() != 0 &&
+            store.getItemEvictionPolicy() == EvictionPolicy::Full) {
+            auto bounds = EPBucket::loadMetaBounds(cb::io::loadFile(fname),
+                                                   vb.getPersistenceSeqno());
+            if (bounds) {
+                vb.restoreMetaBounds(std::move(bounds));
+            }
+        }
+    } catch (const std::exception& e) {
+        EP_LOG_WARN(
+                "Warmup::loadMetaBounds: {} ignoring meta bounds file '{}': "
+                "{}",
+                vb.getId(),
+                fname,
+                e.what());
+    }
+
+    // As with the bloom filters, the bounds are only valid for the state at
+    // the last clean shutdown
+    if (remove(fname.c_str()) != 0) {
+        EP_LOG_WARN("Warmup::loadMetaBounds: {} failed to remove '{}': {}",
+                    vb.getId(),
+                    fname,
+                    strerror(errno));
+    }
+}
+
+void Warmup::loadBloomFiltersForShard(uint16_t shardId) {
+    for (const auto vbid : shardVbIds[shardId]) {
+        auto itr = warmedUpVbuckets.find(vbid.get());
+        if (itr == warmedUpVbuckets.end()) {
+            continue;
+        }
+        loadMetaBounds(*(itr->second));
+        const auto fname = store.getBloomFilterFileName(vbid);
+        if (!cb::io::isFile(fname)) {
+            continue;
+        }
+
+        auto& vb = *(itr->second);
+        try {
+            const auto data = cb::io::loadFile(fname);
+            if (config.isBfilterEnabled() && config.isBfilterPersist()) {
+                auto filter = EPBucket::loadBloomFilter(
+                        data, vb.getPersistenceSeqno());
+                if (filter && vb.restoreFilter(std::move(filter))) {
+                    ++bloomFiltersLoaded;
+                    bloomFilterBytesLoaded += data.size();
+                }
+            }
+        } catch (const std::exception& e) {
+            EP_LOG_WARN(
+                    "Warmup::loadBloomFiltersForShard: {} ignoring bloom "
+                    "filter file '{}': {}",
+                    vbid,
+                    fname,
+                    e.what());
+        }
+
+        // The persisted filter is only valid for the state at the last clean
+        // shutdown; remove it so it cannot be reused after a crash.
+        if (remove(fname.c_str()) != 0) {
+            EP_LOG_WARN(
+                    "Warmup::loadBloomFiltersForShard: {} failed to remove "
+                    "'{}': {}",
+                    vbid,
+                    fname,
+                    strerror(errno));
+        }
+    }
+
+    if (++threadtask_count == store.vbMap.getNumShards()) {
+        bloomFilterTime.store(std::chrono::steady_clock::now() -
+                              bloomFilterStart);
         transition(WarmupState::State::PopulateVBucketMap);
     }
 }
@@ -1483,6 +1736,13 @@ void Warmup::scheduleLoadingKVPairs()
     // keys have been warmed up at this point.
     setEstimatedWarmupCount(estimatedItemCount);
 
+    if (config.isWarmupParallelVbucketLoad()) {
+        scheduleLoadingVBuckets(
+                TaskId::WarmupLoadingKVPairs,
+                store.getItemEvictionPolicy() == EvictionPolicy::Full);
+        return;
+    }
+
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
         ExTask task = std::make_shared<WarmupLoadingKVPairs>(store, i, this);
@@ -1532,6 +1792,11 @@ void Warmup::scheduleLoadingData()
     size_t estimatedCount = store.getEPEngine().getEpStats().warmedUpKeys;
     setEstimatedWarmupCount(estimatedCount);
 
+    if (config.isWarmupParallelVbucketLoad()) {
+        scheduleLoadingVBuckets(TaskId::WarmupLoadingData, true);
+        return;
+    }
+
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
         ExTask task = std::make_shared<WarmupLoadingData>(store, i, this);
@@ -1539,6 +1804,108 @@ void Warmup::scheduleLoadingData()
     }
 }
 
+void Warmup::scheduleLoadingVBuckets(TaskId taskId, bool maybeEnableTraffic) {
+    // Interleave the shards' vBuckets, keeping each shard's in the order it
+    // would have loaded them (active first).
+    std::vector<Vbid> queue;
+    for (size_t ii = 0;; ++ii) {
+        bool more = false;
+        for (const auto& vbids : shardVbIds) {
+            if (ii < vbids.size()) {
+                queue.push_back(vbids[ii]);
+                more = true;
+            }
+        }
+        if (!more) {
+            break;
+        }
+    }
+
+    // Always schedule at least one task, so the phase completes (and
+    // transitions) on a task as it does when loading by shard.
+    const auto numTasks = std::max(
+            size_t(1),
+            std::min(ExecutorPool::get()->getNumReaders(), queue.size()));
+    {
+        std::lock_guard<std::mutex> lh(loadQueueMutex);
+        loadQueue = std::move(queue);
+        loadQueueNext = 0;
+        loadQueueStopped = false;
+        vbLoadProgress.clear();
+        for (const auto vbid : loadQueue) {
+            vbLoadProgress[vbid] = {VBLoadState::Pending, {}};
+        }
+    }
+
+    numLoadVBucketsTasks = numTasks;
+    threadtask_count = 0;
+    for (size_t i = 0; i < numTasks; i++) {
+        ExTask task = std::make_shared<WarmupLoadVBuckets>(
+                store, taskId, i, maybeEnableTraffic, this);
+        ExecutorPool::get()->schedule(task);
+    }
+}
+
+bool Warmup::loadNextVBucket(bool maybeEnableTraffic) {
+    Vbid vbid;
+    {
+        std::lock_guard<std::mutex> lh(loadQueueMutex);
+        if (loadQueueStopped || loadQueueNext == loadQueue.size()) {
+            return false;
+        }
+        vbid = loadQueue[loadQueueNext++];
+        vbLoadProgress[vbid].state = VBLoadState::Loading;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    KVStore* kvstore = store.getROUnderlying(vbid);
+    auto ctx = kvstore->initBySeqnoScanContext(
+            std::make_unique<LoadStorageKVPairCallback>(
+                    store, maybeEnableTraffic, state.getState()),
+            std::make_unique<LoadValueCallback>(store.vbMap, state.getState()),
+            vbid,
+            0,
+            DocumentFilter::NO_DELETES,
+            store.getValueFilterForCompressionMode(),
+            SnapshotSource::Head);
+    auto loadState = VBLoadState::Done;
+    if (ctx && kvstore->scan(*ctx) == scan_again) { // ENGINE_ENOMEM
+        // Memory limit reached; stop loading the remaining vBuckets.
+        loadState = VBLoadState::Incomplete;
+    }
+
+    std::lock_guard<std::mutex> lh(loadQueueMutex);
+    auto& progress = vbLoadProgress[vbid];
+    progress.state = loadState;
+    progress.duration = std::chrono::steady_clock::now() - start;
+    if (loadState == VBLoadState::Incomplete) {
+        loadQueueStopped = true;
+        return false;
+    }
+    return true;
+}
+
+void Warmup::loadVBucketsTaskDone() {
+    if (++threadtask_count == numLoadVBucketsTasks) {
+        transition(WarmupState::State::Done);
+    }
+}
+
+const char* Warmup::to_string(VBLoadState state) {
+    switch (state) {
+    case VBLoadState::Pending:
+        return "pending";
+    case VBLoadState::Loading:
+        return "loading";
+    case VBLoadState::Done:
+        return "done";
+    case VBLoadState::Incomplete:
+        return "incomplete";
+    }
+    throw std::invalid_argument("Warmup::to_string: invalid state:" +
+                                std::to_string(int(state)));
+}
+
 void Warmup::loadDataforShard(uint16_t shardId)
 {
     scan_error_t errorCode = scan_success;
@@ -1590,6 +1957,9 @@ void Warmup::step() {
     case WarmupState::State::Initialize:
         scheduleInitialize();
         return;
+    case WarmupState::State::ReplayDurabilityLog:
+        scheduleReplayDurabilityLog();
+        return;
     case WarmupState::State::CreateVBuckets:
         scheduleCreateVBuckets();
         return;
@@ -1605,6 +1975,9 @@ void Warmup::step() {
     case WarmupState::State::LoadPreparedSyncWrites:
         scheduleLoadPreparedSyncWrites();
         return;
+    case WarmupState::State::LoadingBloomFilters:
+        scheduleLoadingBloomFilters();
+        return;
     case WarmupState::State::KeyDump:
         scheduleKeyDump();
         return;
@@ -1708,12 +2081,39 @@ void Warmup::addStats(const AddStatFn& add_stat, const void* c) const {
         addStat("access_log", "corrupt", add_stat, c);
     }
 
+    addStat("bloom_filter_count", bloomFiltersLoaded.load(), add_stat, c);
+    addStat("bloom_filter_bytes", bloomFilterBytesLoaded.load(), add_stat, c);
+    auto bf_time = bloomFilterTime.load();
+    if (bf_time > bf_time.zero()) {
+        addStat("bloom_filter_time",
+                duration_cast<microseconds>(bf_time).count(),
+                add_stat,
+                c);
+    }
+
     size_t warmupCount = estimatedWarmupCount.load();
     if (warmupCount == std::numeric_limits<size_t>::max()) {
         addStat("estimated_value_count", "unknown", add_stat, c);
     } else {
         addStat("estimated_value_count", warmupCount, add_stat, c);
     }
+
+    // Per-vBucket progress of the parallel vBucket load, if used.
+    std::lock_guard<std::mutex> lh(loadQueueMutex);
+    for (const auto& [vbid, progress] : vbLoadProgress) {
+        const auto prefix = "vb_" + std::to_string(vbid.get());
+        addStat((prefix + "_load_state").c_str(),
+                to_string(progress.state),
+                add_stat,
+                c);
+        if (progress.state == VBLoadState::Done ||
+            progress.state == VBLoadState::Incomplete) {
+            addStat((prefix + "_load_time").c_str(),
+                    duration_cast<microseconds>(progress.duration).count(),
+                    add_stat,
+                    c);
+        }
+    }
 }
 
 /* In the case of CouchKVStore, all vbucket states of all the shards
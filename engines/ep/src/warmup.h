@@ -41,6 +41,7 @@ class GetValue;
 class MutationLog;
 class VBucketMap;
 class Vbid;
+enum class TaskId : int;
 
 struct vbucket_state;
 
@@ -61,10 +62,12 @@ public:
     /// Set of possible states warmup can be in.
     enum class State {
         Initialize,
+        ReplayDurabilityLog,
         CreateVBuckets,
         LoadingCollectionCounts,
         EstimateDatabaseItemCount,
         LoadPreparedSyncWrites,
+        LoadingBloomFilters,
         PopulateVBucketMap,
         KeyDump,
         LoadingAccessLog,
@@ -123,6 +126,9 @@ private:
  *                [Initialise]
  *                     |
  *                     V
+ *            [ReplayDurabilityLog]
+ *                     |
+ *                     V
  *              [CreateVBuckets]
  *                     |
  *                     V
@@ -135,6 +141,9 @@ private:
  *          [LoadPreparedSyncWrites]
  *                     |
  *                     V
+ *           [LoadingBloomFilters]
+ *                     |
+ *                     V
  *            [PopulateVBucketMap]
  *                     |
  *                Eviction mode?
@@ -173,10 +182,12 @@ private:
  * Whilst the following phases are incomplete:
  *
  *    Initialise
+ *    ReplayDurabilityLog
  *    CreateVBuckets
  *    LoadingCollectionCounts
  *    EstimateDatabaseItemCount
  *    LoadPreparedSyncWrites
+ *    LoadingBloomFilters
  *    PopulateVBucketMap
  *
  *  1) setVBucket requests are queued (using the EWOULDBLOCK mechanism)
@@ -304,6 +315,14 @@ private:
      */
     void initialize();
 
+    /**
+     * Commits the flush batches left in the DurabilityLog (if enabled) for
+     * the vBuckets of the given shard, updating their on-disk state (see
+     * EPBucket::replayDurabilityLog). Must run before the VBucket objects
+     * are created from that state.
+     */
+    void replayDurabilityLog(uint16_t shardId);
+
     /**
      * Creates VBucket objects in memory for the given shard:
      * - For each vbucket found on disk; create an in-memory VBucket object
@@ -332,6 +351,22 @@ private:
      */
     void loadPreparedSyncWrites(uint16_t shardId);
 
+    /**
+     * Loads the bloom filter persisted by the last clean shutdown (see
+     * EPBucket::saveBloomFilters) for each vBucket in the given shard, if
+     * it is still consistent with the vBucket's persisted high seqno. The
+     * persisted filters are then removed so they cannot be re-used after a
+     * subsequent unclean shutdown.
+     * Runs before PopulateVBucketMap so full-eviction reads of non-existent
+     * keys are filtered as soon as they are processed.
+     * The meta bounds saved by EPBucket::saveMetaBounds are loaded (and
+     * removed) in the same way.
+     */
+    void loadBloomFiltersForShard(uint16_t shardId);
+
+    /// Load (and remove) the meta bounds file of the given vBucket
+    void loadMetaBounds(VBucket& vb);
+
     /**
      * Adds all warmed up vbuckets (for the shard) to the bucket's VBMap, once
      * added to the VBMap the rest of the system will be able to locate and
@@ -377,6 +412,24 @@ private:
      */
     void loadDataforShard(uint16_t shardId);
 
+    /**
+     * [warmup_parallel_vbucket_load]
+     * Schedule the tasks loading the vBuckets of all shards in parallel for
+     * the LoadingKVPairs / LoadingData phase (as given by taskId): one per
+     * Reader thread, each loading the next vBucket of the load queue until
+     * it is empty or the memory limit is reached.
+     */
+    void scheduleLoadingVBuckets(TaskId taskId, bool maybeEnableTraffic);
+
+    /**
+     * Load the next vBucket of the load queue.
+     * @return false if there are no more vBuckets to load.
+     */
+    bool loadNextVBucket(bool maybeEnableTraffic);
+
+    /// Called by each loading task once the load queue is exhausted.
+    void loadVBucketsTaskDone();
+
     /* Terminal state of warmup. Updates statistics and marks warmup as
      * completed
      */
@@ -388,10 +441,12 @@ private:
     void populateShardVbStates();
 
     void scheduleInitialize();
+    void scheduleReplayDurabilityLog();
     void scheduleCreateVBuckets();
     void scheduleLoadingCollectionCounts();
     void scheduleEstimateDatabaseItemCount();
     void scheduleLoadPreparedSyncWrites();
+    void scheduleLoadingBloomFilters();
     void schedulePopulateVBucketMap();
     void scheduleKeyDump();
     void scheduleCheckForAccessLog();
@@ -402,6 +457,11 @@ private:
 
     void transition(WarmupState::State to, bool force = false);
 
+    /// Progress of a vBucket in the parallel vBucket load.
+    enum class VBLoadState { Pending, Loading, Done, Incomplete };
+
+    static const char* to_string(VBLoadState state);
+
     WarmupState state;
 
     EPBucket& store;
@@ -430,7 +490,37 @@ private:
     /// contains all vBucket IDs which are present for the given shard.
     std::vector<std::vector<Vbid>> shardVbIds;
 
+    /**
+     * [warmup_parallel_vbucket_load]
+     * The vBuckets of all shards in the order they are to be loaded, the
+     * index of the next one to load, and whether loading has been stopped
+     * (by reaching the memory limit). Guarded by loadQueueMutex, as is
+     * vbLoadProgress.
+     */
+    mutable std::mutex loadQueueMutex;
+    std::vector<Vbid> loadQueue;
+    size_t loadQueueNext{0};
+    bool loadQueueStopped{false};
+
+    struct VBLoadProgress {
+        VBLoadState state;
+        /// Time taken to load the vBucket, once loaded.
+        std::chrono::steady_clock::duration duration;
+    };
+    std::map<Vbid, VBLoadProgress> vbLoadProgress;
+
+    /// Number of tasks scheduled by scheduleLoadingVBuckets().
+    size_t numLoadVBucketsTasks{0};
+
     cb::AtomicDuration<> estimateTime;
+
+    /// Start time of, and time taken by, the LoadingBloomFilters phase.
+    std::chrono::steady_clock::time_point bloomFilterStart;
+    cb::AtomicDuration<> bloomFilterTime;
+    /// Number and total serialised size of bloom filters loaded from disk.
+    std::atomic<size_t> bloomFiltersLoaded{0};
+    std::atomic<size_t> bloomFilterBytesLoaded{0};
+
     std::atomic<size_t> estimatedItemCount{std::numeric_limits<size_t>::max()};
     bool cleanShutdown{true};
     bool corruptAccessLog{false};
@@ -457,15 +547,18 @@ private:
     // To avoid making a number of methods on Warmup public; grant friendship
     // to the various Tasks which run the stages of warmup.
     friend class WarmupInitialize;
+    friend class WarmupReplayDurabilityLog;
     friend class WarmupCreateVBuckets;
     friend class WarmupLoadingCollectionCounts;
     friend class WarmupEstimateDatabaseItemCount;
     friend class WarmupLoadPreparedSyncWrites;
+    friend class WarmupLoadBloomFilters;
     friend class WarmupPopulateVBucketMap;
     friend class WarmupKeyDump;
     friend class WarmupCheckforAccessLog;
     friend class WarmupLoadAccessLog;
     friend class WarmupLoadingKVPairs;
     friend class WarmupLoadingData;
+    friend class WarmupLoadVBuckets;
     friend class WarmupCompletion;
 };
@@ -37,6 +37,7 @@
 #include <folly/Portability.h>
 #include <memcached/engine.h>
 #include <memcached/engine_testapp.h>
+#include <nlohmann/json.hpp>
 #include <platform/cbassert.h>
 #include <platform/platform_thread.h>
 #include <platform/platform_time.h>
@@ -282,6 +283,39 @@ void renderToXML(const std::string& name, const std::string& description,
     file << "</testsuites>\n";
 }
 
+// Render the specified value stats as JSON (including all of the samples,
+// scaled like the XML output), for scripts/perf_regression.py to compare
+// against a baseline.
+template <typename T>
+void renderToJSON(const std::string& name,
+                  const std::string& description,
+                  const std::vector<Stats<T>>& value_stats,
+                  const std::string& unit) {
+    nlohmann::json json = {{"name", name},
+                           {"description", description},
+                           {"unit", unit},
+                           {"bucket_type", testHarness->bucket_type},
+                           {"lower_is_better", true}};
+    auto& results = json["results"];
+    for (const auto& stats : value_stats) {
+        std::vector<double> samples;
+        samples.reserve(stats.values->size());
+        for (const auto& value : *stats.values) {
+            samples.push_back(value / 1e3);
+        }
+        results[stats.name] = {{"median", stats.median / 1e3},
+                               {"pct95", stats.pct95 / 1e3},
+                               {"pct99", stats.pct99 / 1e3},
+                               {"mean", stats.mean / 1e3},
+                               {"stddev", stats.stddev / 1e3},
+                               {"samples", samples}};
+    }
+
+    std::ofstream file(std::string(testHarness->output_file_prefix) + name +
+                       ".json");
+    file << json.dump() << std::endl;
+}
+
 // Given a vector of values (each a vector<T>) calculate metrics on them
 // and print in the format specified by {testHarness->output_format}.
 template<typename T>
@@ -328,6 +362,10 @@ void output_result(const std::string& name,
     case OutputFormat::XML:
         renderToXML(new_name, description, value_stats, unit);
         break;
+
+    case OutputFormat::JSON:
+        renderToJSON(new_name, description, value_stats, unit);
+        break;
     }
 }
 /* Add a sentinel document (one with a the key SENTINEL_KEY).
@@ -3536,6 +3536,23 @@ static enum test_result test_access_scanner(EngineIface* h) {
           (std::string("access log file (") + name +
            ") should exist (got errno:" + std::to_string(errno))
                   .c_str());
+    checkeq(0,
+            get_int_stat(h, "ep_num_access_scanner_vbuckets_copied"),
+            "Expected the first access log to visit every vBucket");
+
+    /* Without any change since the last run the next run copies vb:0 from
+     * the current access log rather than visiting it */
+    check(set_param(h,
+                    cb::mcbp::request::SetParamPayload::Type::Flush,
+                    "access_scanner_run",
+                    "true"),
+          "Failed to trigger access scanner");
+    wait_for_stat_to_be(h, "ep_num_access_scanner_runs", 2 * num_shards);
+    checkeq(1,
+            get_int_stat(h, "ep_num_access_scanner_vbuckets_copied"),
+            "Expected vb:0 to be copied from the previous access log");
+    check(cb::io::isFile(name), "access log file should exist");
+    check(cb::io::isFile(prev), ".old access log file should exist");
 
     /* Increase resident ratio by deleting items */
     checkeq(ENGINE_SUCCESS, vbucketDelete(h, Vbid(0)), "Expected success");
@@ -3842,6 +3859,7 @@ static enum test_result test_worker_stats(EngineIface* h) {
     tasklist.insert("Warmup - initialize");
     tasklist.insert("Warmup - creating vbuckets");
     tasklist.insert("Warmup - estimate item count");
+    tasklist.insert("Warmup - loading bloom filters");
     tasklist.insert("Warmup - key dump");
     tasklist.insert("Warmup - check for access log");
     tasklist.insert("Warmup - loading access log");
@@ -6662,6 +6680,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "ro_0:io_bg_fetch_doc_bytes",
                 "ro_0:io_total_read_bytes",
                 "ro_0:io_total_write_bytes",
+                "ro_0:io_mmap_mapped_bytes",
+                "ro_0:io_mmap_fallback_reads",
+                "ro_0:io_mmap_major_faults",
+                "ro_0:io_scan_readahead_bytes",
+                "ro_0:io_scan_dropped_bytes",
                 "ro_0:io_document_write_bytes",
                 "ro_0:numLoadedVb",
                 "ro_0:open",
@@ -6677,6 +6700,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "ro_1:io_bg_fetch_doc_bytes",
                 "ro_1:io_total_read_bytes",
                 "ro_1:io_total_write_bytes",
+                "ro_1:io_mmap_mapped_bytes",
+                "ro_1:io_mmap_fallback_reads",
+                "ro_1:io_mmap_major_faults",
+                "ro_1:io_scan_readahead_bytes",
+                "ro_1:io_scan_dropped_bytes",
                 "ro_1:io_document_write_bytes",
                 "ro_1:numLoadedVb",
                 "ro_1:open",
@@ -6692,6 +6720,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "ro_2:io_bg_fetch_doc_bytes",
                 "ro_2:io_total_read_bytes",
                 "ro_2:io_total_write_bytes",
+                "ro_2:io_mmap_mapped_bytes",
+                "ro_2:io_mmap_fallback_reads",
+                "ro_2:io_mmap_major_faults",
+                "ro_2:io_scan_readahead_bytes",
+                "ro_2:io_scan_dropped_bytes",
                 "ro_2:io_document_write_bytes",
                 "ro_2:numLoadedVb",
                 "ro_2:open",
@@ -6707,6 +6740,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "ro_3:io_bg_fetch_doc_bytes",
                 "ro_3:io_total_read_bytes",
                 "ro_3:io_total_write_bytes",
+                "ro_3:io_mmap_mapped_bytes",
+                "ro_3:io_mmap_fallback_reads",
+                "ro_3:io_mmap_major_faults",
+                "ro_3:io_scan_readahead_bytes",
+                "ro_3:io_scan_dropped_bytes",
                 "ro_3:io_document_write_bytes",
                 "ro_3:numLoadedVb",
                 "ro_3:open"
@@ -6730,6 +6768,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_0:io_bg_fetch_doc_bytes",
                 "rw_0:io_total_read_bytes",
                 "rw_0:io_total_write_bytes",
+                "rw_0:io_mmap_mapped_bytes",
+                "rw_0:io_mmap_fallback_reads",
+                "rw_0:io_mmap_major_faults",
+                "rw_0:io_scan_readahead_bytes",
+                "rw_0:io_scan_dropped_bytes",
                 "rw_0:io_document_write_bytes",
                 "rw_0:lastCommDocs",
                 "rw_0:numLoadedVb",
@@ -6751,6 +6794,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_1:io_bg_fetch_doc_bytes",
                 "rw_1:io_total_read_bytes",
                 "rw_1:io_total_write_bytes",
+                "rw_1:io_mmap_mapped_bytes",
+                "rw_1:io_mmap_fallback_reads",
+                "rw_1:io_mmap_major_faults",
+                "rw_1:io_scan_readahead_bytes",
+                "rw_1:io_scan_dropped_bytes",
                 "rw_1:io_document_write_bytes",
                 "rw_1:lastCommDocs",
                 "rw_1:numLoadedVb",
@@ -6772,6 +6820,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_2:io_bg_fetch_doc_bytes",
                 "rw_2:io_total_read_bytes",
                 "rw_2:io_total_write_bytes",
+                "rw_2:io_mmap_mapped_bytes",
+                "rw_2:io_mmap_fallback_reads",
+                "rw_2:io_mmap_major_faults",
+                "rw_2:io_scan_readahead_bytes",
+                "rw_2:io_scan_dropped_bytes",
                 "rw_2:io_document_write_bytes",
                 "rw_2:lastCommDocs",
                 "rw_2:numLoadedVb",
@@ -6793,6 +6846,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "rw_3:io_bg_fetch_doc_bytes",
                 "rw_3:io_total_read_bytes",
                 "rw_3:io_total_write_bytes",
+                "rw_3:io_mmap_mapped_bytes",
+                "rw_3:io_mmap_fallback_reads",
+                "rw_3:io_mmap_major_faults",
+                "rw_3:io_scan_readahead_bytes",
+                "rw_3:io_scan_dropped_bytes",
                 "rw_3:io_document_write_bytes",
                 "rw_3:lastCommDocs",
                 "rw_3:numLoadedVb",
@@ -6820,7 +6878,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "chk_items",
               "estimate"}},
             {"dcp",
-             {"ep_dcp_count",
+             {"ep_dcp_backfill_shared_detached",
+              "ep_dcp_backfill_shared_items",
+              "ep_dcp_backfill_shared_leaders",
+              "ep_dcp_backfill_shared_subscriptions",
+              "ep_dcp_count",
               "ep_dcp_dead_conn_count",
               "ep_dcp_items_remaining",
               "ep_dcp_items_sent",
@@ -6956,22 +7018,37 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
             {"info", {"info"}},
             {"config",
              {"ep_allow_del_with_meta_prune_user_data",
+              "ep_adaptive_threads",
+              "ep_adaptive_threads_interval_ms",
+              "ep_adaptive_threads_max",
+              "ep_adaptive_threads_wait_ms",
               "ep_backend",
               "ep_backfill_mem_threshold",
               "ep_bfilter_enabled",
               "ep_bfilter_fp_prob",
               "ep_bfilter_key_count",
+              "ep_bfilter_persist",
               "ep_bfilter_residency_threshold",
+              "ep_bfilter_type",
               "ep_bucket_type",
               "ep_cache_size",
+              "ep_chk_expel_eager",
               "ep_chk_expel_enabled",
               "ep_chk_max_items",
               "ep_chk_period",
               "ep_chk_remover_stime",
+              "ep_chk_value_compression",
+              "ep_collection_access_sketch_window",
+              "ep_collection_mem_quota_percent",
+              "ep_collections_drop_compaction_delay",
               "ep_collections_enabled",
+              "ep_compaction_bg_fetch_target",
+              "ep_compaction_dirty_age_target",
               "ep_compaction_exp_mem_threshold",
+              "ep_compaction_throttle_min_rate",
               "ep_compaction_write_queue_cap",
               "ep_compression_mode",
+              "ep_concurrent_pagers",
               "ep_conflict_resolution_type",
               "ep_connection_manager_interval",
               "ep_couch_bucket",
@@ -6982,56 +7059,92 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_data_traffic_enabled",
               "ep_dbname",
               "ep_dcp_backfill_byte_limit",
+              "ep_dcp_backfill_scan_parallelism",
+              "ep_dcp_backfill_shared_scans",
+              "ep_dcp_backfill_snapshot_chunk_items",
               "ep_dcp_conn_buffer_size",
               "ep_dcp_conn_buffer_size_aggr_mem_threshold",
               "ep_dcp_conn_buffer_size_aggressive_perc",
               "ep_dcp_conn_buffer_size_max",
               "ep_dcp_conn_buffer_size_perc",
               "ep_dcp_enable_noop",
+              "ep_dcp_encoding_cache_size",
               "ep_dcp_flow_control_policy",
               "ep_dcp_min_compression_ratio",
               "ep_dcp_idle_timeout",
               "ep_dcp_noop_mandatory_for_v5_features",
               "ep_dcp_noop_tx_interval",
+              "ep_dcp_oso_backfill_max_collection_ratio",
+              "ep_dcp_producer_checkpoint_processor_parallelism",
               "ep_dcp_producer_snapshot_marker_yield_limit",
               "ep_dcp_consumer_process_buffered_messages_yield_limit",
+              "ep_dcp_consumer_frame_compression",
               "ep_dcp_consumer_process_buffered_messages_batch_size",
+              "ep_dcp_consumer_process_buffered_messages_parallelism",
               "ep_dcp_scan_byte_limit",
               "ep_dcp_scan_item_limit",
+              "ep_dcp_stream_ready_queue_max_bytes",
               "ep_dcp_takeover_max_time",
               "ep_defragmenter_age_threshold",
+              "ep_defragmenter_auto_interval",
               "ep_defragmenter_chunk_duration",
               "ep_defragmenter_enabled",
+              "ep_defragmenter_fragmentation_threshold",
               "ep_defragmenter_interval",
+              "ep_defragmenter_sparse_slabs_only",
               "ep_defragmenter_stored_value_age_threshold",
+              "ep_durability_timeout_mode",
               "ep_durability_timeout_task_interval",
               "ep_durability_min_level",
+              "ep_durability_replica_early_ack",
               "ep_executor_pool_backend",
+              "ep_executor_pool_work_stealing",
               "ep_exp_pager_enabled",
               "ep_exp_pager_initial_run_time",
               "ep_exp_pager_stime",
+              "ep_expiry_index_enabled",
+              "ep_expiry_index_max_entries",
+              "ep_expiry_pager_concurrency",
               "ep_failpartialwarmup",
+              "ep_flusher_balance_interval",
+              "ep_flusher_group_commit_vbuckets",
               "ep_flusher_total_batch_limit",
+              "ep_frontend_get_cache",
               "ep_fsync_after_every_n_bytes_written",
               "ep_couchstore_tracing",
               "ep_couchstore_write_validation",
               "ep_couchstore_mprotect",
+              "ep_couchstore_bgfetch_readahead",
               "ep_couchstore_file_cache_max_size",
+              "ep_couchstore_write_coalesce_size",
+              "ep_couchstore_mmap_reads",
+              "ep_couchstore_backfill_readahead_size",
+              "ep_couchstore_backfill_drop_behind",
+              "ep_get_keys_max_response_size",
               "ep_getl_default_timeout",
               "ep_getl_max_timeout",
               "ep_hlc_drift_ahead_threshold_us",
               "ep_hlc_drift_behind_threshold_us",
+              "ep_ht_compact_non_resident",
+              "ep_ht_huge_pages",
+              "ep_ht_inline_value_size",
               "ep_ht_locks",
+              "ep_ht_read_mode",
               "ep_ht_resize_interval",
+              "ep_ht_resize_mode",
               "ep_ht_size",
               "ep_item_compressor_chunk_duration",
+              "ep_item_compressor_freq_threshold",
               "ep_item_compressor_interval",
+              "ep_item_compressor_sample_rate",
               "ep_item_eviction_age_percentage",
               "ep_item_eviction_freq_counter_age_threshold",
+              "ep_item_eviction_freq_threshold_from_hashtable",
               "ep_item_freq_decayer_chunk_duration",
               "ep_item_freq_decayer_percent",
               "ep_item_num_based_new_chk",
               "ep_keep_closed_chks",
+              "ep_lock_profiler_enabled",
               "ep_magma_commit_point_every_batch",
               "ep_magma_commit_point_interval",
               "ep_magma_delete_frag_ratio",
@@ -7044,14 +7157,17 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_magma_flusher_thread_percentage",
               "ep_magma_max_commit_points",
               "ep_magma_max_default_storage_threads",
+              "ep_magma_max_pipelined_bytes",
               "ep_magma_max_write_cache",
               "ep_magma_mem_quota_ratio",
+              "ep_magma_pipelined_commit",
               "ep_magma_value_separation_size",
               "ep_magma_initial_wal_buffer_size",
               "ep_magma_write_cache_ratio",
               "ep_magma_expiry_purger_interval",
               "ep_max_checkpoints",
               "ep_max_failover_entries",
+              "ep_max_flushers_per_shard",
               "ep_max_item_privileged_bytes",
               "ep_max_item_size",
               "ep_max_num_shards",
@@ -7093,11 +7209,16 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_rocksdb_uc_max_size_amplification_percent",
               "ep_sync_writes_max_allowed_replicas",
               "ep_time_synchronization",
+              "ep_touch_expiry_tolerance",
               "ep_uuid",
+              "ep_value_dedup_max_values",
+              "ep_value_dedup_min_size",
+              "ep_vbucket_stats_cache_ttl_ms",
               "ep_warmup_batch_size",
               "ep_warmup_min_items_threshold",
               "ep_warmup_min_memory_threshold",
-              "ep_xattr_enabled"}},
+              "ep_xattr_enabled",
+              "ep_xdcr_meta_bounds_size"}},
             {"workload",
              {"ep_workload:num_readers",
               "ep_workload:num_writers",
@@ -7145,15 +7266,23 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_active_datatype_xattr",
               "ep_active_hlc_drift",
               "ep_active_hlc_drift_count",
+              "ep_adaptive_threads",
+              "ep_adaptive_threads_interval_ms",
+              "ep_adaptive_threads_max",
+              "ep_adaptive_threads_wait_ms",
               "ep_backend",
               "ep_backfill_mem_threshold",
               "ep_bfilter_enabled",
               "ep_bfilter_fp_prob",
               "ep_bfilter_key_count",
+              "ep_bfilter_persist",
               "ep_bfilter_residency_threshold",
+              "ep_bfilter_type",
               "ep_bg_fetch_avg_read_amplification",
+              "ep_bg_fetch_deadline_exceeded",
               "ep_bg_fetched",
               "ep_bg_meta_fetched",
+              "ep_bg_prefetches",
               "ep_bg_remaining_items",
               "ep_bg_remaining_jobs",
               "ep_blob_num",
@@ -7161,16 +7290,25 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_bucket_priority",
               "ep_bucket_type",
               "ep_cache_size",
+              "ep_chk_expel_eager",
               "ep_chk_expel_enabled",
               "ep_chk_max_items",
               "ep_chk_period",
               "ep_chk_persistence_remains",
               "ep_chk_remover_stime",
+              "ep_chk_value_compression",
               "ep_clock_cas_drift_threshold_exceeded",
+              "ep_collection_access_sketch_window",
+              "ep_collection_mem_quota_percent",
+              "ep_collections_drop_compaction_delay",
               "ep_collections_enabled",
+              "ep_compaction_bg_fetch_target",
+              "ep_compaction_dirty_age_target",
               "ep_compaction_exp_mem_threshold",
+              "ep_compaction_throttle_min_rate",
               "ep_compaction_write_queue_cap",
               "ep_compression_mode",
+              "ep_concurrent_pagers",
               "ep_conflict_resolution_type",
               "ep_connection_manager_interval",
               "ep_couch_bucket",
@@ -7182,34 +7320,49 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_cursor_dropping_checkpoint_mem_lower_mark",
               "ep_cursors_dropped",
               "ep_cursor_memory_freed",
+              "ep_cursor_drop_backfill_items",
               "ep_data_read_failed",
               "ep_data_write_failed",
               "ep_data_traffic_enabled",
               "ep_dbname",
               "ep_dcp_backfill_byte_limit",
+              "ep_dcp_backfill_scan_parallelism",
+              "ep_dcp_backfill_shared_scans",
+              "ep_dcp_backfill_snapshot_chunk_items",
               "ep_dcp_conn_buffer_size",
               "ep_dcp_conn_buffer_size_aggr_mem_threshold",
               "ep_dcp_conn_buffer_size_aggressive_perc",
               "ep_dcp_conn_buffer_size_max",
               "ep_dcp_conn_buffer_size_perc",
+              "ep_dcp_consumer_frame_compression",
               "ep_dcp_consumer_process_buffered_messages_batch_size",
+              "ep_dcp_consumer_process_buffered_messages_parallelism",
               "ep_dcp_consumer_process_buffered_messages_yield_limit",
               "ep_dcp_enable_noop",
+              "ep_dcp_encoding_cache_size",
               "ep_dcp_flow_control_policy",
               "ep_dcp_idle_timeout",
               "ep_dcp_min_compression_ratio",
               "ep_dcp_noop_mandatory_for_v5_features",
               "ep_dcp_noop_tx_interval",
+              "ep_dcp_oso_backfill_max_collection_ratio",
+              "ep_dcp_producer_checkpoint_processor_parallelism",
               "ep_dcp_producer_snapshot_marker_yield_limit",
               "ep_dcp_scan_byte_limit",
               "ep_dcp_scan_item_limit",
+              "ep_dcp_stream_ready_queue_max_bytes",
               "ep_dcp_takeover_max_time",
               "ep_defragmenter_age_threshold",
+              "ep_defragmenter_auto_interval",
               "ep_defragmenter_chunk_duration",
               "ep_defragmenter_enabled",
+              "ep_defragmenter_fragmentation_threshold",
               "ep_defragmenter_interval",
+              "ep_defragmenter_num_dense_skipped",
               "ep_defragmenter_num_moved",
+              "ep_defragmenter_num_skipped",
               "ep_defragmenter_num_visited",
+              "ep_defragmenter_sparse_slabs_only",
               "ep_defragmenter_stored_value_age_threshold",
               "ep_defragmenter_sv_num_moved",
               "ep_degraded_mode",
@@ -7218,30 +7371,51 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_diskqueue_items",
               "ep_diskqueue_memory",
               "ep_diskqueue_pending",
+              "ep_durability_timeout_mode",
               "ep_durability_timeout_task_interval",
               "ep_durability_min_level",
+              "ep_durability_replica_early_ack",
               "ep_executor_pool_backend",
+              "ep_executor_pool_work_stealing",
               "ep_exp_pager_enabled",
               "ep_exp_pager_initial_run_time",
               "ep_exp_pager_stime",
               "ep_expired_access",
               "ep_expired_compactor",
               "ep_expired_pager",
+              "ep_expiry_index_enabled",
+              "ep_expiry_index_max_entries",
+              "ep_expiry_pager_concurrency",
               "ep_expiry_pager_task_time",
               "ep_failpartialwarmup",
               "ep_flush_duration_total",
+              "ep_flusher_balance_interval",
+              "ep_flusher_group_commit_vbuckets",
               "ep_flusher_total_batch_limit",
+              "ep_frontend_get_cache",
               "ep_fsync_after_every_n_bytes_written",
               "ep_couchstore_tracing",
               "ep_couchstore_write_validation",
               "ep_couchstore_mprotect",
+              "ep_couchstore_bgfetch_readahead",
               "ep_couchstore_file_cache_max_size",
+              "ep_couchstore_write_coalesce_size",
+              "ep_couchstore_mmap_reads",
+              "ep_couchstore_backfill_readahead_size",
+              "ep_couchstore_backfill_drop_behind",
+              "ep_get_keys_max_response_size",
               "ep_getl_default_timeout",
               "ep_getl_max_timeout",
               "ep_hlc_drift_ahead_threshold_us",
               "ep_hlc_drift_behind_threshold_us",
+              "ep_ht_compact_non_resident",
+              "ep_ht_huge_page_bytes",
+              "ep_ht_huge_pages",
+              "ep_ht_inline_value_size",
               "ep_ht_locks",
+              "ep_ht_read_mode",
               "ep_ht_resize_interval",
+              "ep_ht_resize_mode",
               "ep_ht_size",
               "ep_io_bg_fetch_read_count",
               "ep_io_compaction_read_bytes",
@@ -7252,11 +7426,14 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_io_total_write_amplification",
               "ep_io_total_write_bytes",
               "ep_item_compressor_chunk_duration",
+              "ep_item_compressor_freq_threshold",
               "ep_item_compressor_interval",
               "ep_item_compressor_num_compressed",
               "ep_item_compressor_num_visited",
+              "ep_item_compressor_sample_rate",
               "ep_item_eviction_age_percentage",
               "ep_item_eviction_freq_counter_age_threshold",
+              "ep_item_eviction_freq_threshold_from_hashtable",
               "ep_item_freq_decayer_chunk_duration",
               "ep_item_freq_decayer_percent",
               "ep_item_num",
@@ -7265,8 +7442,10 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_items_rm_from_checkpoints",
               "ep_keep_closed_chks",
               "ep_kv_size",
+              "ep_lock_profiler_enabled",
               "ep_max_checkpoints",
               "ep_max_failover_entries",
+              "ep_max_flushers_per_shard",
               "ep_max_item_privileged_bytes",
               "ep_max_item_size",
               "ep_max_num_shards",
@@ -7322,8 +7501,10 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_magma_flusher_thread_percentage",
               "ep_magma_max_commit_points",
               "ep_magma_max_default_storage_threads",
+              "ep_magma_max_pipelined_bytes",
               "ep_magma_max_write_cache",
               "ep_magma_mem_quota_ratio",
+              "ep_magma_pipelined_commit",
               "ep_magma_value_separation_size",
               "ep_magma_initial_wal_buffer_size",
               "ep_magma_write_cache_ratio",
@@ -7380,22 +7561,28 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_storedval_size",
               "ep_sync_writes_max_allowed_replicas",
               "ep_time_synchronization",
+              "ep_tmp_oom_collection_quota_errors",
               "ep_tmp_oom_errors",
               "ep_total_cache_size",
               "ep_total_deduplicated",
               "ep_total_del_items",
               "ep_total_enqueued",
               "ep_total_new_items",
+              "ep_touch_expiry_tolerance",
               "ep_uuid",
+              "ep_value_dedup_max_values",
+              "ep_value_dedup_min_size",
               "ep_value_size",
               "ep_vb_total",
               "ep_vbucket_del",
               "ep_vbucket_del_fail",
+              "ep_vbucket_stats_cache_ttl_ms",
               "ep_warmup_batch_size",
               "ep_warmup_min_items_threshold",
               "ep_warmup_min_memory_threshold",
               "ep_workload_pattern",
               "ep_xattr_enabled",
+              "ep_xdcr_meta_bounds_size",
               "mem_used",
               "mem_used_estimate",
               "rollback_item_count",
@@ -7517,6 +7704,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_arena_global:retained",
               "ep_arena_global:small.allocated",
 #endif
+              "ep_arena_fragmentation_ratio",
               "ep_blob_num",
               "ep_blob_overhead",
               "ep_item_num",
@@ -7531,6 +7719,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_storedval_num",
               "ep_storedval_overhead",
               "ep_storedval_size",
+              "ep_tmp_oom_collection_quota_errors",
               "ep_tmp_oom_errors",
               "ep_value_size",
               "mem_used",
@@ -7565,10 +7754,16 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
         eng_stats.insert(eng_stats.end(),
                          std::initializer_list<std::string>{"ep_flusher_state",
                                                             "ep_flusher_todo"});
+        eng_stats.insert(eng_stats.end(),
+                         {"ep_compaction_throttle_state",
+                          "ep_compaction_write_rate_limit",
+                          "ep_compaction_write_rate"});
         eng_stats.insert(eng_stats.end(),
                          {"ep_commit_num",
                           "ep_commit_time",
                           "ep_commit_time_total",
+                          "ep_durability_log_writes",
+                          "ep_durability_log_write_failed",
                           "ep_item_begin_failed",
                           "ep_item_commit_failed",
                           "ep_item_flush_expired",
@@ -7586,9 +7781,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                 "ep_alog_resident_ratio_threshold",
                 "ep_alog_sleep_time",
                 "ep_alog_task_time",
+                "ep_durability_log_path",
                 "ep_item_eviction_policy",
                 "ep_persistent_metadata_purge_age",
-                "ep_warmup"};
+                "ep_warmup",
+                "ep_warmup_parallel_vbucket_load"};
         eng_stats.insert(eng_stats.end(), persistentConfig);
 
         // 'diskinfo and 'diskinfo detail' keys should be present now.
@@ -7610,6 +7807,9 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
         auto& vb_details = statsKeys.at("vbucket-details 0");
         vb_details.emplace_back("vb_0:db_data_size");
         vb_details.emplace_back("vb_0:db_file_size");
+        vb_details.emplace_back("vb_0:flush_queue_wait_count");
+        vb_details.emplace_back("vb_0:flush_queue_wait_total");
+        vb_details.emplace_back("vb_0:flush_queue_wait_max");
 
         // Config variables only valid for persistent
         auto& config_stats = statsKeys.at("config");
@@ -7619,7 +7819,8 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
     if (isEphemeralBucket(h)) {
         auto& eng_stats = statsKeys.at("");
         eng_stats.insert(eng_stats.end(),
-                         {"ep_ephemeral_full_policy",
+                         {"ep_ephemeral_auto_delete_sample_size",
+                          "ep_ephemeral_full_policy",
                           "ep_ephemeral_metadata_mark_stale_chunk_duration",
                           "ep_ephemeral_metadata_purge_age",
                           "ep_ephemeral_metadata_purge_interval",
@@ -7674,7 +7875,8 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
         auto& config_stats = statsKeys.at("config");
         config_stats.insert(
                 config_stats.end(),
-                {"ep_ephemeral_full_policy",
+                {"ep_ephemeral_auto_delete_sample_size",
+                 "ep_ephemeral_full_policy",
                  "ep_ephemeral_metadata_mark_stale_chunk_duration",
                  "ep_ephemeral_metadata_purge_age",
                  "ep_ephemeral_metadata_purge_interval",
@@ -7786,6 +7988,19 @@ static enum test_result test_mb19687_variable(EngineIface* h) {
               "key_flags",
               "key_is_dirty",
               "key_vb_state"}},
+            // Also reports each component of each vBucket and collection
+            {"memory-breakdown",
+             {"ep_mem_breakdown_ht_metadata",
+              "ep_mem_breakdown_ht_keys",
+              "ep_mem_breakdown_ht_values",
+              "ep_mem_breakdown_ht_overhead",
+              "ep_mem_breakdown_checkpoint_items",
+              "ep_mem_breakdown_checkpoint_index",
+              "ep_mem_breakdown_checkpoint_queue",
+              "ep_mem_breakdown_dcp_ready_queue",
+              "ep_mem_breakdown_dcp_backfill_buffer",
+              "vb_0:ht_keys",
+              "vb_0:checkpoint_items"}},
 
             // These stat groups return histograms so we can't guess the
             // key names...
@@ -7806,7 +8021,9 @@ static enum test_result test_mb19687_variable(EngineIface* h) {
                                         "ep_warmup_min_memory_threshold",
                                         "ep_warmup_min_item_threshold",
                                         "ep_warmup_estimated_key_count",
-                                        "ep_warmup_estimated_value_count" } });
+                                        "ep_warmup_estimated_value_count",
+                                        "ep_warmup_bloom_filter_count",
+                                        "ep_warmup_bloom_filter_bytes" } });
     }
 
     if (isPersistentBucket(h)) {
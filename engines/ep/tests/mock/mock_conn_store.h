@@ -18,24 +18,44 @@
 #pragma once
 
 #include "conn_store.h"
+#include "connhandler.h"
 
 #include <memcached/vbucket.h>
 
+#include <optional>
+#include <vector>
+
 class MockConnStore : public ConnStore {
 public:
     explicit MockConnStore(EventuallyPersistentEngine& engine)
         : ConnStore(engine) {
     }
 
-    VBToConnsMap& getVBToConnsMap() {
-        return vbToConns;
+    size_t getNumVBuckets() const {
+        return vbToConns.size();
+    }
+
+    /// @return the current snapshot of the VBConns of every vBucket
+    std::vector<std::shared_ptr<const VBConnList>> getVBConnsSnapshot() const {
+        std::vector<std::shared_ptr<const VBConnList>> snapshot;
+        for (const auto& conns : vbToConns) {
+            snapshot.push_back(conns.load());
+        }
+        return snapshot;
     }
 
-    VBToConnsMap::value_type::iterator getVBToConnsItr(
-            Vbid vbid, const ConnHandler& conn) {
-        size_t lock_num = vbid.get() % vbConnLocks.size();
-        std::unique_lock<std::mutex> lh(vbConnLocks[lock_num]);
+    /// @return the current snapshot of the VBConns of the given vBucket
+    std::shared_ptr<const VBConnList> getVBConns(Vbid vbid) const {
+        return vbToConns[vbid.get()].load();
+    }
 
-        return ConnStore::getVBToConnsItr(lh, vbid, conn);
+    /// @return a copy of the VBConn of the given ConnHandler, if any
+    std::optional<VBConn> getVBConn(Vbid vbid, const ConnHandler& conn) const {
+        auto list = getVBConns(vbid);
+        auto itr = findVBConn(*list, conn.getCookie());
+        if (itr == list->end()) {
+            return {};
+        }
+        return *itr;
     }
 };
@@ -78,15 +78,16 @@ public:
                     "MockCouchKVStore::set: Not valid on a read-only "
                     "object.");
         }
-        if (!inTransaction) {
+        auto& txn = getFlushTransaction();
+        if (!txn.inTransaction) {
             throw std::invalid_argument(
                     "MockCouchKVStore::set: inTransaction must be "
                     "true to perform a set operation.");
         }
 
         // each req will be de-allocated after commit
-        pendingReqsQ.emplace_back(itm);
-        return static_cast<MockCouchRequest*>(&pendingReqsQ.back());
+        txn.pendingReqsQ.emplace_back(itm);
+        return static_cast<MockCouchRequest*>(&txn.pendingReqsQ.back());
     }
 
     bool commit(VB::Commit& commitData) override {
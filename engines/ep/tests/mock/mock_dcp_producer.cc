@@ -114,10 +114,18 @@ std::shared_ptr<Stream> MockDcpProducer::findStream(Vbid vbid) {
 }
 
 ActiveStreamCheckpointProcessorTask*
-MockDcpProducer::getCheckpointSnapshotTask() const {
+MockDcpProducer::getCheckpointSnapshotTask(size_t lane) const {
     LockHolder guard(checkpointCreator->mutex);
+    if (lane >= checkpointCreator->tasks.size()) {
+        return nullptr;
+    }
     return static_cast<ActiveStreamCheckpointProcessorTask*>(
-            checkpointCreator->task.get());
+            checkpointCreator->tasks[lane].get());
+}
+
+size_t MockDcpProducer::getNumCheckpointProcessorLanes() const {
+    LockHolder guard(checkpointCreator->mutex);
+    return checkpointCreator->tasks.size();
 }
 
 std::pair<std::shared_ptr<Stream>, bool> MockDcpProducer::findStream(
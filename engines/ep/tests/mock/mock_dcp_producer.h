@@ -91,21 +91,25 @@ public:
     }
 
     /**
-     * Create the ActiveStreamCheckpointProcessorTask and assign to
-     * checkpointCreator->task
+     * Create the ActiveStreamCheckpointProcessorTasks and assign to
+     * checkpointCreator->tasks
      */
     void createCheckpointProcessorTask() {
         DcpProducer::createCheckpointProcessorTask();
     }
 
     /**
-     * Schedule the checkpointCreator->task on the ExecutorPool
+     * Schedule the checkpointCreator->tasks on the ExecutorPool
      */
     void scheduleCheckpointProcessorTask() {
         DcpProducer::scheduleCheckpointProcessorTask();
     }
 
-    ActiveStreamCheckpointProcessorTask* getCheckpointSnapshotTask() const;
+    /// @return the checkpoint processor task of the given lane (or null)
+    ActiveStreamCheckpointProcessorTask* getCheckpointSnapshotTask(
+            size_t lane = 0) const;
+
+    size_t getNumCheckpointProcessorLanes() const;
 
     /**
      * Finds the stream for a given vbucket
@@ -150,6 +154,18 @@ public:
         return log.acknowledge(bytes);
     }
 
+    bool insertBytes(size_t bytes, BufferLog::Clock::time_point now) {
+        return log.insert(bytes, now);
+    }
+
+    void ackBytes(size_t bytes, BufferLog::Clock::time_point now) {
+        log.acknowledge(bytes, now);
+    }
+
+    size_t getFlowControlWindow() {
+        return log.getWindowBytes();
+    }
+
     VBReadyQueue& getReadyQueue() {
         return ready;
     }
@@ -120,7 +120,7 @@ void MockEPBucket::setDurabilityCompletionTask(
 }
 
 Flusher* MockEPBucket::getFlusherNonConst(Vbid vbid) {
-    return vbMap.getShardByVbId(vbid)->getFlusher();
+    return vbMap.getShardByVbId(vbid)->getFlusher(vbid);
 }
 
 void MockEPBucket::setCollectionsManagerPreSetStateAtWarmupHook(
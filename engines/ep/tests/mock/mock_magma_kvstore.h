@@ -40,12 +40,16 @@ public:
         return MagmaKVStore::readVBStateFromDisk(vbid, snapshot);
     }
 
-    int saveDocs(VB::Commit& commitData, kvstats_ctx& kvctx) override {
+    int saveDocs(PendingRequestQueue& reqs,
+                 VB::Commit& commitData,
+                 kvstats_ctx& kvctx,
+                 bool updateCollectionsMeta) override {
         if (saveDocsErrorInjector) {
             return saveDocsErrorInjector(commitData, kvctx);
         }
 
-        return MagmaKVStore::saveDocs(commitData, kvctx);
+        return MagmaKVStore::saveDocs(
+                reqs, commitData, kvctx, updateCollectionsMeta);
     }
 
     magma::Status addLocalDoc(Vbid vbid,
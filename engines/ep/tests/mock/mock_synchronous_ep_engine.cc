@@ -72,6 +72,9 @@ SynchronousEPEngine::SynchronousEPEngine(const cb::ArenaMallocClient& client,
     // Simplified setup for switching FlowControl on/off
     if (configuration.getDcpFlowControlPolicy() == "none") {
         dcpFlowControlManager_ = std::make_unique<DcpFlowControlManager>(*this);
+    } else if (configuration.getDcpFlowControlPolicy() == "adaptive") {
+        dcpFlowControlManager_ =
+                std::make_unique<DcpFlowControlManagerAdaptive>(*this);
     } else {
         dcpFlowControlManager_ =
                 std::make_unique<DcpFlowControlManagerAggressive>(*this);
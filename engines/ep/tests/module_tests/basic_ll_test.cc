@@ -444,6 +444,30 @@ TEST_F(BasicLinkedListTest, UpdateDuringRangeRead) {
     EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
 }
 
+TEST_F(BasicLinkedListTest, UpdateBetweenDisjointRangeReads) {
+    const int numItems = 5;
+    const std::string keyPrefix("key");
+
+    /* Add 5 new items */
+    addNewItemsToList(1, keyPrefix, numItems);
+
+    /* Two range reads at different points of the list, e.g. two backfills */
+    auto range1 = basicLL->registerFakeSharedRangeLock(1, 2);
+    auto range2 = basicLL->registerFakeSharedRangeLock(4, 5);
+
+    /* An item between the range reads is not read by either of them, so it
+       is moved to the end of the list without creating a stale copy */
+    updateItem(numItems, keyPrefix + std::to_string(3));
+    EXPECT_EQ(0, basicLL->getNumStaleItems());
+
+    /* An item within a range read still must not be moved */
+    updateItemDuringRangeRead(numItems + 1, keyPrefix + std::to_string(4));
+    EXPECT_EQ(1, basicLL->getNumStaleItems());
+
+    std::vector<seqno_t> expectedSeqno = {1, 2, 4, 5, 6, 7};
+    EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
+}
+
 TEST_F(BasicLinkedListTest, DeletedItem) {
     const std::string keyPrefix("key");
     const int numItems = 1;
@@ -694,6 +718,62 @@ TEST_F(BasicLinkedListTest, RangeIteratorUpdateItemDuringRead) {
     }
 }
 
+TEST_F(BasicLinkedListTest, RangeIteratorTruncate) {
+    const int numItems = 5;
+    const std::string keyPrefix("key");
+
+    /* Add 5 new items */
+    addNewItemsToList(1, keyPrefix, numItems);
+
+    auto itr = getRangeIterator();
+    EXPECT_EQ(std::make_pair(uint64_t(1), uint64_t(numItems)),
+              basicLL->getRangeRead());
+
+    /* Read one item, then only read up to seqno 3 */
+    std::vector<seqno_t> actualSeqno;
+    actualSeqno.push_back((*itr).getBySeqno());
+    ++itr;
+    itr.truncate(3);
+    EXPECT_EQ(3, itr.back());
+    EXPECT_EQ(std::make_pair(uint64_t(2), uint64_t(3)),
+              basicLL->getRangeRead());
+
+    /* The items after the truncated range are no longer locked; updating one
+       relocates it rather than creating a stale item */
+    updateItem(numItems, keyPrefix + std::to_string(5));
+    EXPECT_EQ(0, basicLL->getNumStaleItems());
+
+    while (itr.curr() != itr.end()) {
+        actualSeqno.push_back((*itr).getBySeqno());
+        ++itr;
+    }
+    EXPECT_EQ(std::vector<seqno_t>({1, 2, 3}), actualSeqno);
+
+    /* The range lock is released once the truncated range has been read */
+    EXPECT_EQ(std::make_pair(uint64_t(0), uint64_t(0)),
+              basicLL->getRangeRead());
+}
+
+/* Truncating an iterator, where the next item to read is after the new end
+   (e.g. the item at the requested end was de-duplicated), ends the iteration
+   and releases the range lock */
+TEST_F(BasicLinkedListTest, RangeIteratorTruncateBeforeCurr) {
+    const int numItems = 3;
+    const std::string keyPrefix("key");
+
+    /* Add 3 new items */
+    addNewItemsToList(1, keyPrefix, numItems);
+
+    auto itr = getRangeIterator();
+    ++itr;
+    EXPECT_EQ(2, itr.curr());
+
+    itr.truncate(1);
+    EXPECT_EQ(itr.curr(), itr.end());
+    EXPECT_EQ(std::make_pair(uint64_t(0), uint64_t(0)),
+              basicLL->getRangeRead());
+}
+
 /* Creates 2 range iterators such that iterator2 is created after iterator1
    has read all items, and has hence released the rangeReadLock, but before
    iterator1 is deleted */
@@ -1183,6 +1263,83 @@ TEST_F(BasicLinkedListTest, PurgePauseResume) {
     EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
 }
 
+/* Purge more items than the purger checks per writeLock acquisition, pausing
+   part way through a batch */
+TEST_F(BasicLinkedListTest, PurgePauseResumeAcrossBatches) {
+    const int numStale = 100;
+    std::vector<seqno_t> expectedSeqno;
+    seqno_t seqno = 1;
+    for (int i = 0; i < numStale; ++i) {
+        auto added = addNewItemsToList(seqno++, "key", 1);
+        expectedSeqno.insert(expectedSeqno.end(), added.begin(), added.end());
+        addStaleItem("stale" + std::to_string(i), seqno++);
+    }
+    /* The last element is never purged by the vbucket */
+    addNewItemsToList(seqno, "key", 1);
+    expectedSeqno.push_back(seqno);
+    ASSERT_EQ(numStale, basicLL->getNumStaleItems());
+
+    /* Pause once, part way through the first batch */
+    int calls = 0;
+    auto purged = basicLL->purgeTombstones(
+            seqno - 1, {}, [&calls]() { return ++calls == 10; });
+    EXPECT_EQ(5, purged);
+    purged += basicLL->purgeTombstones(seqno - 1);
+
+    EXPECT_EQ(numStale, purged);
+    EXPECT_EQ(0, basicLL->getNumStaleItems());
+    EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
+}
+
+/* A StaleOnly purge only visits the list from the first item marked stale
+   since the previous purge */
+TEST_F(BasicLinkedListTest, PurgeStaleOnlyFromFirstStaleItem) {
+    const int numItems = 10;
+    const std::string keyPrefix("key");
+    const auto scope = SequenceList::PurgeScope::StaleOnly;
+
+    addNewItemsToList(1, keyPrefix, numItems);
+    addStaleItem("stale1", numItems + 1);
+    addNewItemsToList(numItems + 2, keyPrefix, 2);
+
+    size_t visited = 0;
+    auto countVisits = [&visited]() {
+        ++visited;
+        return false;
+    };
+
+    /* Only seqnos 11 and 12 are visited, the last one is left for next time */
+    EXPECT_EQ(1,
+              basicLL->purgeTombstones(
+                      numItems + 2, {}, countVisits, scope));
+    EXPECT_EQ(2, visited);
+
+    /* Nothing new, nothing to visit */
+    visited = 0;
+    EXPECT_EQ(0,
+              basicLL->purgeTombstones(
+                      numItems + 2, {}, countVisits, scope));
+    EXPECT_EQ(0, visited);
+
+    /* Resumes from the item left last time (seqno 13) */
+    addStaleItem("stale2", numItems + 4);
+    addNewItemsToList(numItems + 5, keyPrefix, 1);
+    visited = 0;
+    EXPECT_EQ(1,
+              basicLL->purgeTombstones(
+                      numItems + 4, {}, countVisits, scope));
+    EXPECT_EQ(2, visited);
+    EXPECT_EQ(0, basicLL->getNumStaleItems());
+
+    /* A full purge is requested, e.g. for a dropped collection */
+    basicLL->requestFullPurge();
+    visited = 0;
+    EXPECT_EQ(0,
+              basicLL->purgeTombstones(
+                      numItems + 4, {}, countVisits, scope));
+    EXPECT_EQ(numItems + 2, visited);
+}
+
 TEST_F(BasicLinkedListTest, PurgePauseResumeWithUpdate) {
     const int numItems = 2, numPurgeItems = 1;
     const std::string keyPrefix("key");
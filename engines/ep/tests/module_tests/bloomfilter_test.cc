@@ -100,6 +100,123 @@ TEST_F(BloomFilterTest, FalsePositiveRate) {
                 expectedFalsePositives * 0.1);
 }
 
+// Blocked filters are rounded up to whole 512-bit blocks and always use one
+// bit per 64-bit word of a block.
+TEST_F(BloomFilterTest, BlockedSizeCalculation) {
+    for (size_t keys : {1, 10, 100, 1000, 10000, 100000}) {
+        BloomFilter classic(keys, 0.01, BFILTER_ENABLED);
+        BloomFilter blocked(
+                keys, 0.01, BFILTER_ENABLED, BloomFilterType::Blocked);
+        EXPECT_EQ(BloomFilterType::Blocked, blocked.getType());
+        EXPECT_EQ(0, blocked.getFilterSize() % 512) << "For keys=" << keys;
+        EXPECT_GE(blocked.getFilterSize(), classic.getFilterSize())
+                << "For keys=" << keys;
+        EXPECT_LT(blocked.getFilterSize(), classic.getFilterSize() + 512)
+                << "For keys=" << keys;
+        EXPECT_EQ(8, blocked.getNoOfHashes()) << "For keys=" << keys;
+    }
+}
+
+TEST_F(BloomFilterTest, BlockedPositiveCheck) {
+    const int numKeys = 10000;
+    BloomFilter bf(numKeys, 0.01, BFILTER_ENABLED, BloomFilterType::Blocked);
+    for (int i = 0; i < numKeys; i++) {
+        bf.addKey(makeStoredDocKey("key_" + std::to_string(i)));
+    }
+    EXPECT_NEAR(numKeys, bf.getNumOfKeysInFilter(), numKeys * 0.05);
+
+    for (int i = 0; i < numKeys; i++) {
+        auto key = makeStoredDocKey("key_" + std::to_string(i));
+        EXPECT_TRUE(bf.maybeKeyExists(key)) << "For key:" << key.to_string();
+    }
+}
+
+// The blocked layout trades some accuracy for locality; check the false
+// positive rate is still within 2x of the target.
+TEST_F(BloomFilterTest, BlockedFalsePositiveRate) {
+    const int numKeys = 10000;
+    const double targetFalsePositive = 0.01;
+    BloomFilter bf(numKeys,
+                   targetFalsePositive,
+                   BFILTER_ENABLED,
+                   BloomFilterType::Blocked);
+    for (int i = 0; i < numKeys; i++) {
+        bf.addKey(makeStoredDocKey("key_" + std::to_string(i)));
+    }
+
+    int falsePositives = 0;
+    for (int i = 0; i < numKeys; i++) {
+        if (bf.maybeKeyExists(
+                    makeStoredDocKey("key_" + std::to_string(numKeys + i)))) {
+            falsePositives++;
+        }
+    }
+    EXPECT_LT(falsePositives, 2 * numKeys * targetFalsePositive);
+}
+
+// Blocked filters follow the same status transitions as classic ones.
+TEST_F(BloomFilterTest, BlockedStatus) {
+    BloomFilter bf(100, 0.01, BFILTER_COMPACTING, BloomFilterType::Blocked);
+    auto key = makeStoredDocKey("key");
+    bf.addKey(key);
+    bf.setStatus(BFILTER_ENABLED);
+    EXPECT_EQ(BFILTER_ENABLED, bf.getStatus());
+    EXPECT_TRUE(bf.maybeKeyExists(key));
+    EXPECT_EQ(1, bf.getNumOfKeysInFilter());
+
+    bf.setStatus(BFILTER_DISABLED);
+    EXPECT_EQ(0, bf.getFilterSize());
+    EXPECT_EQ(0, bf.getNumOfKeysInFilter());
+    // Disabled filters cannot say a key doesn't exist.
+    EXPECT_TRUE(bf.maybeKeyExists(makeStoredDocKey("other")));
+}
+
+TEST_F(BloomFilterTest, TypeFromString) {
+    for (auto type : {BloomFilterType::Classic, BloomFilterType::Blocked}) {
+        EXPECT_EQ(type, bloomFilterTypeFromString(to_string(type)));
+    }
+    EXPECT_THROW(bloomFilterTypeFromString("unknown"), std::invalid_argument);
+}
+
+TEST_F(BloomFilterTest, SerialiseRoundTrip) {
+    for (auto type : {BloomFilterType::Classic, BloomFilterType::Blocked}) {
+        const int numKeys = 1000;
+        BloomFilter bf(numKeys, 0.01, BFILTER_ENABLED, type);
+        for (int i = 0; i < numKeys; i++) {
+            bf.addKey(makeStoredDocKey("key_" + std::to_string(i)));
+        }
+
+        auto copy = BloomFilter::deserialise(bf.serialise());
+        ASSERT_TRUE(copy);
+        EXPECT_EQ(type, copy->getType());
+        EXPECT_EQ(BFILTER_ENABLED, copy->getStatus());
+        EXPECT_EQ(bf.getFilterSize(), copy->getFilterSize());
+        EXPECT_EQ(bf.getNoOfHashes(), copy->getNoOfHashes());
+        EXPECT_EQ(bf.getNumOfKeysInFilter(), copy->getNumOfKeysInFilter());
+        for (int i = 0; i < numKeys * 2; i++) {
+            auto key = makeStoredDocKey("key_" + std::to_string(i));
+            EXPECT_EQ(bf.maybeKeyExists(key), copy->maybeKeyExists(key))
+                    << "For key:" << key.to_string();
+        }
+    }
+}
+
+TEST_F(BloomFilterTest, DeserialiseInvalid) {
+    BloomFilter bf(100, 0.01, BFILTER_ENABLED);
+    const auto data = bf.serialise();
+
+    EXPECT_THROW(BloomFilter::deserialise({}), std::invalid_argument);
+    EXPECT_THROW(BloomFilter::deserialise(data.substr(0, data.size() - 1)),
+                 std::invalid_argument);
+    auto badMagic = data;
+    badMagic[0] ^= 0xff;
+    EXPECT_THROW(BloomFilter::deserialise(badMagic), std::invalid_argument);
+
+    // Only populated filters can be serialised.
+    BloomFilter disabled(100, 0.01, BFILTER_DISABLED);
+    EXPECT_THROW(disabled.serialise(), std::logic_error);
+}
+
 class BloomFilterDocKeyTest
     : public BloomFilter,
       public ::testing::TestWithParam<std::tuple<CollectionID, CollectionID>> {
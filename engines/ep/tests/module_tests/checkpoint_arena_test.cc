@@ -0,0 +1,108 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the CheckpointArena and CheckpointArenaAllocator classes.
+ */
+
+#include "checkpoint_arena.h"
+
+#include <folly/portability/GTest.h>
+
+#include <cstdint>
+#include <list>
+#include <vector>
+
+class CheckpointArenaTest : public ::testing::Test {
+protected:
+    std::shared_ptr<CheckpointArena> arena =
+            std::make_shared<CheckpointArena>();
+    const size_t perElementOverhead = 3 * sizeof(uintptr_t);
+};
+
+TEST_F(CheckpointArenaTest, Alignment) {
+    for (size_t align : {1, 2, 4, 8, 16}) {
+        auto* p = arena->allocate(3, align);
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) % align);
+    }
+    EXPECT_EQ(1, arena->getNumBlocks());
+}
+
+// Blocks grow geometrically, so the space reserved stays proportional to
+// the space used.
+TEST_F(CheckpointArenaTest, BlockGrowth) {
+    size_t used = 0;
+    for (int ii = 0; ii < 10000; ++ii) {
+        arena->allocate(64, 8);
+        used += 64;
+    }
+    EXPECT_GE(arena->getReservedBytes(), used);
+    EXPECT_LT(arena->getReservedBytes(),
+              used + 2 * CheckpointArena::MaxBlockSize);
+    EXPECT_LT(arena->getNumBlocks(), 20);
+}
+
+// Bytes are accounted the same as MemoryTrackingAllocator, and are served
+// from the arena; deallocation does not return the memory to the heap.
+TEST_F(CheckpointArenaTest, ListFromArena) {
+    CheckpointArenaAllocator<int> allocator(arena);
+    std::list<int, CheckpointArenaAllocator<int>> list(allocator);
+    for (int ii = 0; ii < 1000; ++ii) {
+        list.push_back(ii);
+    }
+    EXPECT_EQ(perElementOverhead * 1000,
+              *(list.get_allocator().getBytesAllocated()));
+    const auto reserved = arena->getReservedBytes();
+    EXPECT_GE(reserved, perElementOverhead * 1000);
+
+    list.clear();
+    EXPECT_EQ(0, *(list.get_allocator().getBytesAllocated()));
+    EXPECT_EQ(reserved, arena->getReservedBytes());
+}
+
+// Large allocations (e.g. a container's growing array) bypass the arena.
+TEST_F(CheckpointArenaTest, LargeAllocationsBypassArena) {
+    CheckpointArenaAllocator<char> allocator(arena);
+    std::vector<char, CheckpointArenaAllocator<char>> vec(allocator);
+    vec.reserve(CheckpointArena::MaxAllocationSize + 1);
+    EXPECT_EQ(CheckpointArena::MaxAllocationSize + 1,
+              *(vec.get_allocator().getBytesAllocated()));
+    EXPECT_EQ(0, arena->getReservedBytes());
+}
+
+// A default constructed allocator has no arena and allocates from the heap.
+TEST_F(CheckpointArenaTest, DefaultAllocatorUsesHeap) {
+    CheckpointArenaAllocator<int> allocator;
+    EXPECT_FALSE(allocator.getArena());
+    std::list<int, CheckpointArenaAllocator<int>> list(allocator);
+    list.push_back(1);
+    EXPECT_EQ(perElementOverhead, *(list.get_allocator().getBytesAllocated()));
+    list.clear();
+    EXPECT_EQ(0, *(list.get_allocator().getBytesAllocated()));
+}
+
+// Containers keep the arena alive after the allocator they were created with
+// has gone.
+TEST_F(CheckpointArenaTest, ContainerSharesArenaOwnership) {
+    std::list<int, CheckpointArenaAllocator<int>> list(
+            CheckpointArenaAllocator<int>{arena});
+    EXPECT_EQ(arena, list.get_allocator().getArena());
+    std::weak_ptr<CheckpointArena> weak = arena;
+    arena.reset();
+    list.push_back(1);
+    EXPECT_FALSE(weak.expired());
+}
@@ -247,6 +247,43 @@ TEST_F(CheckpointRemoverEPTest, CursorsEligibleToDrop) {
     ASSERT_EQ(activeStream.getCursor().lock(), cursors[0].lock());
 }
 
+/**
+ * Test that the cursor drop candidates carry the cost model inputs used by
+ * the cursor dropper: the memory of the checkpoint the cursor pins and the
+ * number of items the stream would need to backfill.
+ */
+TEST_F(CheckpointRemoverEPTest, CursorDropCandidateCost) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    auto vb = store->getVBuckets().getBucket(vbid);
+    auto* checkpointManager =
+            static_cast<MockCheckpointManager*>(vb->checkpointManager.get());
+
+    auto producer = createDcpProducer(cookie, IncludeDeleteTime::Yes);
+    createDcpStream(*producer);
+
+    for (size_t i = 0; i < getMaxCheckpointItems(*vb) + 10; i++) {
+        std::string doc_key = "key_" + std::to_string(i);
+        store_item(vbid, makeStoredDocKey(doc_key), "value");
+    }
+    ASSERT_EQ(2, checkpointManager->getNumCheckpoints());
+    flush_vbucket_to_disk(vbid, getMaxCheckpointItems(*vb) + 10);
+
+    auto candidates = checkpointManager->getCursorDropCandidates();
+    ASSERT_EQ(1, candidates.size());
+    ActiveStream& activeStream =
+            reinterpret_cast<ActiveStream&>(*producer->findStream(vbid));
+    EXPECT_EQ(activeStream.getCursor().lock(), candidates[0].cursor.lock());
+
+    const auto& checkpointList =
+            CheckpointManagerTestIntrospector::public_getCheckpointList(
+                    *checkpointManager);
+    EXPECT_EQ(checkpointList.front()->getMemConsumption(),
+              candidates[0].memoryFreed);
+    EXPECT_EQ(checkpointManager->getNumItemsForCursor(
+                      candidates[0].cursor.lock().get()),
+              candidates[0].backfillItems);
+}
+
 /**
  * Check that the memory of unreferenced checkpoints after we drop all cursors
  * in a checkpoint is equal to the size of the items that were contained within
@@ -2026,6 +2026,44 @@ TEST_P(CheckpointTest, testExpelCheckpointItemsDisk) {
     testExpelCheckpointItems();
 }
 
+// Test that with eager expel the items are expelled by the slowest cursor
+// moving past them, and not before.
+TEST_P(CheckpointTest, EagerExpelBehindSlowestCursor) {
+    this->checkpoint_config = CheckpointConfig(DEFAULT_CHECKPOINT_PERIOD,
+                                               DEFAULT_CHECKPOINT_ITEMS,
+                                               /*numCheckpoints*/ 2,
+                                               /*itemBased*/ true,
+                                               /*keepClosed*/ false,
+                                               persistent(),
+                                               /*eagerExpel*/ true);
+    createManager();
+
+    auto slowCursor = this->manager->registerCursorBySeqno("slow_cursor", 0)
+                              .cursor.lock();
+    ASSERT_TRUE(slowCursor);
+
+    const int itemCount{3};
+    for (auto ii = 0; ii < itemCount; ++ii) {
+        EXPECT_TRUE(this->queueNewItem("key" + std::to_string(ii)));
+    }
+
+    // The slow cursor still references all the items
+    std::vector<queued_item> items;
+    this->manager->getNextItemsForCursor(cursor, items);
+    EXPECT_EQ(itemCount + 1, items.size()); // checkpoint_start + mutations
+    EXPECT_EQ(0, this->global_stats.itemsExpelledFromCheckpoints);
+
+    // Moving the slowest cursor expels everything behind it, but for the item
+    // with the checkpoint high-seqno
+    items.clear();
+    this->manager->getNextItemsForCursor(slowCursor.get(), items);
+    EXPECT_EQ(itemCount + 1, items.size());
+    EXPECT_EQ(itemCount, this->global_stats.itemsExpelledFromCheckpoints);
+
+    // The full checkpoint still contains the 3 items added.
+    EXPECT_EQ(itemCount, this->manager->getNumOpenChkItems());
+}
+
 // Test that we correctly handle duplicates, where the initial version of the
 // document has been expelled.
 TEST_P(CheckpointTest, expelCheckpointItemsWithDuplicateTest) {
@@ -180,6 +180,57 @@ TEST_F(CollectionsOSODcpTest, two_collections_backfill_pause) {
     testTwoCollections(true);
 }
 
+// The collection holds half of the vBucket's items, more than the configured
+// dcp_oso_backfill_max_collection_ratio, so a key range (OSO) scan would not
+// be cheaper - expect a by-seqno backfill
+TEST_F(CollectionsOSODcpTest, large_collection_backfills_by_seqno) {
+    setupTwoCollections();
+
+    // Reset so we have to stream from backfill
+    resetEngineAndWarmup("dcp_oso_backfill_max_collection_ratio=0.25");
+
+    // Filter on vegetable collection (this will request from seqno:0)
+    createDcpObjects({{R"({"collections":["a"]})"}}, true /* enable oso */);
+    runBackfill();
+
+    EXPECT_EQ(ENGINE_SUCCESS, producer->stepWithBorderGuard(*producers));
+    EXPECT_EQ(cb::mcbp::ClientOpcode::DcpSnapshotMarker, producers->last_op);
+
+    std::map<std::string, std::string> stats;
+    producer->addStats(
+            [&stats](std::string_view key,
+                     std::string_view value,
+                     gsl::not_null<const void*> cookie) {
+                stats[std::string(key)] = std::string(value);
+            },
+            cookieP);
+    auto prefix = producer->getName() + ":";
+    EXPECT_EQ("0", stats[prefix + "oso_backfills"]);
+    EXPECT_EQ("1", stats[prefix + "oso_backfills_declined"]);
+}
+
+// A stream can opt in to OSO with DCP_ADD_STREAM_FLAG_OSO_BACKFILL, without
+// the connection enabling out of order snapshots
+TEST_F(CollectionsOSODcpTest, stream_flag_enables_oso) {
+    setupTwoCollections();
+
+    // Reset so we have to stream from backfill
+    resetEngineAndWarmup();
+
+    // Filter on vegetable collection (this will request from seqno:0)
+    createDcpObjects({{R"({"collections":["a"]})"}},
+                     false /* connection oso */,
+                     DCP_ADD_STREAM_FLAG_OSO_BACKFILL);
+    // see comment in createDcpObjects, OSO cannot be passed to the replica
+    producers->consumer = nullptr;
+    runBackfill();
+
+    EXPECT_EQ(ENGINE_SUCCESS, producer->stepWithBorderGuard(*producers));
+    EXPECT_EQ(cb::mcbp::ClientOpcode::DcpOsoSnapshot, producers->last_op);
+    EXPECT_EQ(uint32_t(cb::mcbp::request::DcpOsoSnapshotFlags::Start),
+              producers->last_oso_snapshot_flags);
+}
+
 TEST_F(CollectionsOSODcpTest, dropped_collection) {
     auto setup = setupTwoCollections();
 
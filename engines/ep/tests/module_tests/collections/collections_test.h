@@ -51,6 +51,11 @@ protected:
                                   std::optional<uint32_t> maxCount,
                                   const AddResponseFn& response);
 
+    ENGINE_ERROR_CODE sendRangeScan(std::string startKey,
+                                    std::string endKey,
+                                    uint32_t flags,
+                                    uint32_t bufferSize);
+
     std::set<std::string> generateExpectedKeys(
             std::string_view keyPrefix,
             size_t numOfItems,
@@ -839,6 +839,30 @@ TEST_P(CollectionsEraserTest, DropEmptyCollection) {
     runEraser();
 }
 
+// Couchstore must rewrite the vBucket to purge a dropped collection, with a
+// drop compaction delay the drops flushed within it share one compaction.
+TEST_P(CollectionsEraserTest, DeferredDropCompactionsCoalesce) {
+    if (!persistent() || isMagma() || isRocksDB()) {
+        return;
+    }
+    engine->getConfiguration().setCollectionsDropCompactionDelay(60);
+
+    CollectionsManifest cm(CollectionEntry::dairy);
+    vb->updateFromManifest(makeManifest(cm.add(CollectionEntry::fruit)));
+    flush_vbucket_to_disk(vbid, 2 /* 2 x system */);
+
+    auto& writerQ = *task_executor->getLpTaskQ()[WRITER_TASK_IDX];
+    const auto initialTasks = writerQ.getFutureQueueSize();
+
+    vb->updateFromManifest(makeManifest(cm.remove(CollectionEntry::dairy)));
+    flush_vbucket_to_disk(vbid, 1 /* 1 x system */);
+    EXPECT_EQ(initialTasks + 1, writerQ.getFutureQueueSize());
+
+    vb->updateFromManifest(makeManifest(cm.remove(CollectionEntry::fruit)));
+    flush_vbucket_to_disk(vbid, 1 /* 1 x system */);
+    EXPECT_EQ(initialTasks + 1, writerQ.getFutureQueueSize());
+}
+
 class CollectionsEraserSyncWriteTest : public CollectionsEraserTest {
 public:
     void SetUp() override {
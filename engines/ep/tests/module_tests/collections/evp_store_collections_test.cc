@@ -46,6 +46,7 @@
 #include <folly/portability/GMock.h>
 
 #include <spdlog/fmt/fmt.h>
+#include <cstring>
 #include <functional>
 #include <optional>
 #include <thread>
@@ -2169,6 +2170,7 @@ TEST_F(CollectionsTest, GetScopeIdForGivenKeyNoVbid) {
 }
 
 static std::set<std::string> lastGetKeysResult;
+static std::string lastGetKeysResumeKey;
 
 bool getAllKeysResponseHandler(std::string_view key,
                                std::string_view extras,
@@ -2178,6 +2180,7 @@ bool getAllKeysResponseHandler(std::string_view key,
                                uint64_t cas,
                                const void* cookie) {
     lastGetKeysResult.clear();
+    lastGetKeysResumeKey = key;
 
     const char* strPtr = body.data();
     auto* sizePtr = reinterpret_cast<const uint16_t*>(strPtr);
@@ -2411,6 +2414,181 @@ TEST_F(CollectionsTest, GetAllKeysCollectionConnection) {
               sendGetKeys(startKey, {}, getAllKeysResponseHandler));
 }
 
+// The keys are returned in chunks of count keys, each response holding the
+// key the next chunk starts at
+TEST_F(CollectionsTest, GetAllKeysResumeKey) {
+    store_items(5, vbid, makeStoredDocKey("default"), "value");
+    flushVBucketToDiskIfPersistent(vbid, 5);
+
+    EXPECT_EQ(ENGINE_EWOULDBLOCK,
+              sendGetKeys("default0", {3}, getAllKeysResponseHandler));
+    runNextTask(*task_executor->getLpTaskQ()[READER_TASK_IDX],
+                "Running the ALL_DOCS api on vb:0");
+    std::set<std::string> expected{"default0", "default1", "default2"};
+    EXPECT_EQ(expected, lastGetKeysResult);
+    const auto resumeKey = lastGetKeysResumeKey;
+    EXPECT_EQ("default3", resumeKey);
+    EXPECT_EQ(ENGINE_SUCCESS,
+              sendGetKeys("default0", {3}, getAllKeysResponseHandler));
+
+    EXPECT_EQ(ENGINE_EWOULDBLOCK,
+              sendGetKeys(resumeKey, {3}, getAllKeysResponseHandler));
+    runNextTask(*task_executor->getLpTaskQ()[READER_TASK_IDX],
+                "Running the ALL_DOCS api on vb:0");
+    expected = {"default3", "default4"};
+    EXPECT_EQ(expected, lastGetKeysResult);
+    EXPECT_TRUE(lastGetKeysResumeKey.empty());
+}
+
+// A response holds no more than get_keys_max_response_size bytes of keys
+TEST_F(CollectionsTest, GetAllKeysMaxResponseSize) {
+    store_items(5, vbid, makeStoredDocKey("default"), "value");
+    flushVBucketToDiskIfPersistent(vbid, 5);
+
+    // Each key takes 10 bytes (8 for the key and 2 for its length)
+    engine->getConfiguration().setGetKeysMaxResponseSize(25);
+
+    std::set<std::string> keys;
+    std::string startKey = "default0";
+    int responses = 0;
+    do {
+        EXPECT_EQ(ENGINE_EWOULDBLOCK,
+                  sendGetKeys(startKey, {}, getAllKeysResponseHandler));
+        runNextTask(*task_executor->getLpTaskQ()[READER_TASK_IDX],
+                    "Running the ALL_DOCS api on vb:0");
+        EXPECT_LE(lastGetKeysResult.size(), 2);
+        keys.insert(lastGetKeysResult.begin(), lastGetKeysResult.end());
+        const auto resumeKey = lastGetKeysResumeKey;
+        EXPECT_EQ(ENGINE_SUCCESS,
+                  sendGetKeys(startKey, {}, getAllKeysResponseHandler));
+        startKey = resumeKey;
+        ++responses;
+    } while (!startKey.empty() && responses < 5);
+
+    EXPECT_EQ(3, responses);
+    EXPECT_EQ(generateExpectedKeys("default", 5), keys);
+}
+
+static std::vector<std::string> lastRangeScanKeys;
+static std::string lastRangeScanResumeKey;
+static bool lastRangeScanKeyOnly = false;
+
+bool rangeScanResponseHandler(std::string_view key,
+                              std::string_view extras,
+                              std::string_view body,
+                              uint8_t datatype,
+                              cb::mcbp::Status status,
+                              uint64_t cas,
+                              const void* cookie) {
+    lastRangeScanResumeKey = std::string{key};
+    lastRangeScanKeys.clear();
+
+    // Each document is the key, then (unless key-only) its meta and value
+    const size_t metaSize = 4 + 4 + 8 + 8 + 1;
+    while (!body.empty()) {
+        uint16_t keyLen;
+        std::memcpy(&keyLen, body.data(), sizeof(keyLen));
+        keyLen = ntohs(keyLen);
+        body.remove_prefix(sizeof(keyLen));
+        lastRangeScanKeys.emplace_back(body.substr(0, keyLen));
+        body.remove_prefix(keyLen);
+        if (!lastRangeScanKeyOnly) {
+            body.remove_prefix(metaSize);
+            uint32_t valueLen;
+            std::memcpy(&valueLen, body.data(), sizeof(valueLen));
+            valueLen = ntohl(valueLen);
+            body.remove_prefix(sizeof(valueLen));
+            EXPECT_EQ("value", body.substr(0, valueLen));
+            body.remove_prefix(valueLen);
+        }
+    }
+    return true;
+}
+
+ENGINE_ERROR_CODE CollectionsTest::sendRangeScan(std::string startKey,
+                                                 std::string endKey,
+                                                 uint32_t flags,
+                                                 uint32_t bufferSize) {
+    using namespace cb::mcbp;
+    request::RangeScanPayload payload;
+    payload.setFlags(flags);
+    payload.setBufferSize(bufferSize);
+    lastRangeScanKeyOnly = payload.isKeyOnly();
+
+    auto ext = payload.getBuffer();
+    auto request = createPacket(ClientOpcode::RangeScan,
+                                vbid,
+                                0,
+                                {reinterpret_cast<const char*>(ext.data()),
+                                 ext.size()},
+                                startKey,
+                                endKey);
+    return engine->rangeScan(cookie, *request, rangeScanResponseHandler);
+}
+
+TEST_F(CollectionsTest, RangeScanCollectionConnection) {
+    mock_set_collections_support(cookie, true);
+
+    CollectionsManifest cm(CollectionEntry::meat);
+    engine->set_collection_manifest(cookie, std::string{cm});
+    flushVBucketToDiskIfPersistent(vbid, 1);
+
+    store_items(
+            10, vbid, makeStoredDocKey("beef", CollectionEntry::meat), "value");
+    store_items(5, vbid, makeStoredDocKey("default"), "value");
+    flushVBucketToDiskIfPersistent(vbid, 15);
+
+    // Scan the meat collection, each batch only has room for two documents
+    std::vector<std::string> scanned;
+    auto startKey = makeCollectionEncodedString("beef", CollectionEntry::meat);
+    int batches = 0;
+    do {
+        ASSERT_EQ(ENGINE_EWOULDBLOCK, sendRangeScan(startKey, {}, 0, 100));
+        runNextTask(*task_executor->getLpTaskQ()[READER_TASK_IDX],
+                    "Running a range scan on vb:0");
+        // The task sent the response
+        ASSERT_EQ(ENGINE_SUCCESS, sendRangeScan(startKey, {}, 0, 100));
+        scanned.insert(scanned.end(),
+                       lastRangeScanKeys.begin(),
+                       lastRangeScanKeys.end());
+        startKey = lastRangeScanResumeKey;
+        batches++;
+    } while (!startKey.empty());
+
+    EXPECT_EQ(5, batches);
+    auto expected = generateExpectedKeys("beef", 10, CollectionEntry::meat);
+    EXPECT_EQ(std::vector<std::string>(expected.begin(), expected.end()),
+              scanned);
+
+    // A key-only scan of a range of the default collection
+    const auto keyOnly =
+            uint32_t(cb::mcbp::request::RangeScanFlags::KeyOnly);
+    startKey =
+            makeCollectionEncodedString("default1", CollectionEntry::defaultC);
+    EXPECT_EQ(ENGINE_EWOULDBLOCK,
+              sendRangeScan(startKey, "default3", keyOnly, 0));
+    runNextTask(*task_executor->getLpTaskQ()[READER_TASK_IDX],
+                "Running a range scan on vb:0");
+    EXPECT_EQ(std::vector<std::string>(
+                      {makeCollectionEncodedString("default1",
+                                                   CollectionEntry::defaultC),
+                       makeCollectionEncodedString("default2",
+                                                   CollectionEntry::defaultC)}),
+              lastRangeScanKeys);
+    EXPECT_TRUE(lastRangeScanResumeKey.empty());
+    EXPECT_EQ(ENGINE_SUCCESS, sendRangeScan(startKey, "default3", keyOnly, 0));
+
+    // A prefix scan only returns the keys starting with the prefix
+    const auto prefix =
+            keyOnly | uint32_t(cb::mcbp::request::RangeScanFlags::Prefix);
+    startKey = makeCollectionEncodedString("beef", CollectionEntry::meat);
+    EXPECT_EQ(ENGINE_EWOULDBLOCK, sendRangeScan(startKey, {}, prefix, 0));
+    runNextTask(*task_executor->getLpTaskQ()[READER_TASK_IDX],
+                "Running a range scan on vb:0");
+    EXPECT_EQ(10, lastRangeScanKeys.size());
+    EXPECT_EQ(ENGINE_SUCCESS, sendRangeScan(startKey, {}, prefix, 0));
+}
+
 static bool wasKeyStatsResponseHandlerCalled = false;
 bool getKeyStatsResponseHandler(std::string_view key,
                                 std::string_view value,
@@ -2804,6 +2982,54 @@ TEST_P(CollectionsPersistentParameterizedTest, SystemEventsDoNotCount) {
     { EXPECT_EQ(0, store->getVBucket(vbid)->getNumTotalItems()); }
 }
 
+// Items of an evictOnPersist collection are ejected by the flusher, unless
+// read since written
+TEST_P(CollectionsPersistentParameterizedTest, EvictOnPersist) {
+    CollectionsManifest cm;
+    cm.add(CollectionEntry::fruit);
+    auto json = cm.getJson();
+    for (auto& collection : json["scopes"][0]["collections"]) {
+        if (collection["name"] == CollectionEntry::fruit.name) {
+            collection["evictOnPersist"] = true;
+        }
+    }
+    store->setCollections(json.dump());
+    flushVBucketToDiskIfPersistent(vbid, 1);
+
+    StoredDocKey cold{"cold", CollectionEntry::fruit};
+    StoredDocKey hot{"hot", CollectionEntry::fruit};
+    StoredDocKey other{"other", CollectionEntry::defaultC};
+    store_item(vbid, cold, "value");
+    store_item(vbid, hot, "value");
+    store_item(vbid, other, "value");
+
+    auto vb = store->getVBucket(vbid);
+    {
+        // Simulate a read of the item
+        auto res = vb->ht.findForWrite(hot);
+        ASSERT_TRUE(res.storedValue);
+        res.storedValue->setFreqCounterValue(Item::initialFreqCount + 1);
+    }
+
+    flushVBucketToDiskIfPersistent(vbid, 3);
+    EXPECT_EQ(1, engine->getEpStats().numEjectsOnPersist);
+
+    {
+        auto res = vb->ht.findForRead(cold);
+        if (fullEviction()) {
+            EXPECT_FALSE(res.storedValue);
+        } else {
+            ASSERT_TRUE(res.storedValue);
+            EXPECT_FALSE(res.storedValue->isResident());
+        }
+    }
+    for (const auto& key : {hot, other}) {
+        auto res = vb->ht.findForRead(key);
+        ASSERT_TRUE(res.storedValue);
+        EXPECT_TRUE(res.storedValue->isResident());
+    }
+}
+
 TEST_P(CollectionsParameterizedTest, ScopeIDIsValid) {
     CollectionsManifest cm;
     cm.add(CollectionEntry::fruit);
@@ -280,6 +280,29 @@ TEST(ManifestTest, validation) {
                 "scopes":[{"name":"_default", "uid":"0",
                 "collections":[{"name":"_default","uid":"0"},
                                {"name":"brewery","uid":"9","maxTTL":4294967296}]}]})",
+
+            // evictionWeight invalid cases
+            // wrong type
+            R"({"uid" : "1",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9","evictionWeight":"2"}]}]})",
+            // zero (weights must be positive)
+            R"({"uid" : "1",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9","evictionWeight":0}]}]})",
+            // negative
+            R"({"uid" : "1",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9","evictionWeight":-1.5}]}]})",
+            // evictOnPersist invalid cases
+            // wrong type
+            R"({"uid" : "1",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9","evictOnPersist":1}]}]})",
             // Test duplicate scope names
             R"({"uid" : "1",
                 "scopes":[{"name":"_default", "uid":"0",
@@ -408,6 +431,16 @@ TEST(ManifestTest, validation) {
                 "collections":[{"name":"_default","uid":"0"},
                                {"name":"brewery","uid":"9","maxTTL":4294967295}]}]})",
 
+            // evictionWeight valid cases (integer or float)
+            R"({"uid" : "1",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0"},
+                               {"name":"brewery","uid":"9","evictionWeight":4}]}]})",
+            R"({"uid" : "1",
+                "scopes":[{"name":"_default", "uid":"0",
+                "collections":[{"name":"_default","uid":"0","evictionWeight":0.25},
+                               {"name":"brewery","uid":"9"}]}]})",
+
             R"({"uid" : "1",
                 "scopes":[{"name":"_default", "uid":"0",
                 "collections":[{"name":"brewery","uid":"8"}]}]})",
@@ -627,6 +660,78 @@ TEST(ManifestTest, toJson) {
 }
 #endif // !defined(__clang_major__) || __clang_major__ > 7
 
+// evictionWeight is optional, should be retained by toJson and is part of the
+// collection's identity when comparing manifests.
+TEST(ManifestTest, evictionWeight) {
+    const std::string json = R"({"uid" : "1",
+        "scopes":[{"name":"_default", "uid":"0",
+        "collections":[{"name":"_default","uid":"0"},
+                       {"name":"brewery","uid":"9","evictionWeight":2.5}]}]})";
+    Collections::Manifest m{json};
+
+    Collections::IsVisibleFunction isVisible =
+            [](ScopeID, std::optional<CollectionID>) -> bool { return true; };
+    auto output = m.toJson(isVisible);
+    for (const auto& collection : output["scopes"][0]["collections"]) {
+        if (collection["name"] == "brewery") {
+            EXPECT_FLOAT_EQ(2.5f, collection["evictionWeight"].get<float>());
+        } else {
+            EXPECT_EQ(collection.end(), collection.find("evictionWeight"));
+        }
+    }
+
+    // Round-trips
+    EXPECT_EQ(m, Collections::Manifest{output.dump()});
+
+    // A different weight is a different manifest
+    auto changed = output;
+    for (auto& collection : changed["scopes"][0]["collections"]) {
+        if (collection["name"] == "brewery") {
+            collection["evictionWeight"] = 0.5;
+        }
+    }
+    EXPECT_NE(m, Collections::Manifest{changed.dump()});
+}
+
+// evictOnPersist is optional (default false), should be retained by toJson
+// and is part of the collection's identity when comparing manifests.
+TEST(ManifestTest, evictOnPersist) {
+    const std::string json = R"({"uid" : "1",
+        "scopes":[{"name":"_default", "uid":"0",
+        "collections":[{"name":"_default","uid":"0"},
+                       {"name":"brewery","uid":"9","evictOnPersist":true}]}]})";
+    Collections::Manifest m{json};
+
+    Collections::IsVisibleFunction isVisible =
+            [](ScopeID, std::optional<CollectionID>) -> bool { return true; };
+    auto output = m.toJson(isVisible);
+    for (const auto& collection : output["scopes"][0]["collections"]) {
+        if (collection["name"] == "brewery") {
+            EXPECT_TRUE(collection["evictOnPersist"].get<bool>());
+        } else {
+            EXPECT_EQ(collection.end(), collection.find("evictOnPersist"));
+        }
+    }
+
+    // Round-trips
+    EXPECT_EQ(m, Collections::Manifest{output.dump()});
+
+    // Turning it off is a different manifest, the same as not setting it
+    auto disabled = output;
+    auto unset = output;
+    for (auto& collection : disabled["scopes"][0]["collections"]) {
+        if (collection["name"] == "brewery") {
+            collection["evictOnPersist"] = false;
+        }
+    }
+    for (auto& collection : unset["scopes"][0]["collections"]) {
+        collection.erase("evictOnPersist");
+    }
+    EXPECT_NE(m, Collections::Manifest{disabled.dump()});
+    EXPECT_EQ(Collections::Manifest{unset.dump()},
+              Collections::Manifest{disabled.dump()});
+}
+
 TEST(ManifestTest, badNames) {
     for (char c = 127; c >= 0; c--) {
         std::string name(1, c);
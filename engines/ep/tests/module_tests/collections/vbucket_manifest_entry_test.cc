@@ -17,9 +17,13 @@
 
 #include "collections/vbucket_manifest_entry.h"
 #include "test_manifest.h"
+#include "tests/module_tests/test_helpers.h"
 
 #include <folly/portability/GTest.h>
 
+#include <thread>
+#include <vector>
+
 using namespace std::chrono_literals;
 
 // Basic ManifestEntry construction checks
@@ -80,3 +84,77 @@ TEST(ManifestEntry, construct_assign) {
     EXPECT_EQ(101, entry1.getHighSeqno());
     EXPECT_EQ(99, entry1.getPersistedHighSeqno());
 }
+
+// The op counters are striped over the cores; check the counts of every
+// thread are summed, and carried across a copy
+TEST(ManifestEntry, op_counters) {
+    Collections::VB::ManifestEntry entry(ScopeEntry::defaultS, {}, 0);
+    const int numThreads = 8;
+    const int opsPerThread = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&entry]() {
+            for (int i = 0; i < opsPerThread; ++i) {
+                entry.incrementOpsStore();
+                entry.incrementOpsGet();
+                entry.incrementOpsGet();
+            }
+            entry.incrementOpsDelete();
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(numThreads * opsPerThread, entry.getOpsStore());
+    EXPECT_EQ(2 * numThreads * opsPerThread, entry.getOpsGet());
+    EXPECT_EQ(numThreads, entry.getOpsDelete());
+
+    Collections::VB::ManifestEntry copy(entry);
+    EXPECT_EQ(numThreads * opsPerThread, copy.getOpsStore());
+    EXPECT_EQ(2 * numThreads * opsPerThread, copy.getOpsGet());
+    EXPECT_EQ(numThreads, copy.getOpsDelete());
+    EXPECT_EQ(entry, copy);
+}
+
+// Accesses are counted per window; the sketches rotate once a window ends
+// and are carried across a copy
+TEST(ManifestEntry, accessed_keys) {
+    Collections::VB::ManifestEntry entry(ScopeEntry::defaultS, {}, 0);
+    EXPECT_EQ(0, entry.getAccessedKeys(0).current.estimate());
+
+    const auto window = 10s;
+    for (int i = 0; i < 100; ++i) {
+        // Each key accessed twice
+        entry.recordAccess(
+                makeStoredDocKey("key" + std::to_string(i % 50)), window, 5);
+    }
+    auto keys = entry.getAccessedKeys(5);
+    // 50 distinct keys, within the error of the sketch
+    EXPECT_NEAR(50, keys.current.estimate(), 8);
+    EXPECT_EQ(0, keys.previous.estimate());
+
+    Collections::VB::ManifestEntry copy(entry);
+    EXPECT_EQ(keys.current.estimate(),
+              copy.getAccessedKeys(5).current.estimate());
+
+    // Next window, no access yet
+    keys = entry.getAccessedKeys(15);
+    const auto previous = entry.getAccessedKeys(5).current.estimate();
+    EXPECT_EQ(0, keys.current.estimate());
+    EXPECT_EQ(previous, keys.previous.estimate());
+
+    entry.recordAccess(makeStoredDocKey("key"), window, 15);
+    keys = entry.getAccessedKeys(15);
+    EXPECT_EQ(1, keys.current.estimate());
+    EXPECT_EQ(previous, keys.previous.estimate());
+
+    // Windows without an access forget the older ones
+    keys = entry.getAccessedKeys(35);
+    EXPECT_EQ(0, keys.current.estimate());
+    EXPECT_EQ(0, keys.previous.estimate());
+    entry.recordAccess(makeStoredDocKey("key"), window, 35);
+    keys = entry.getAccessedKeys(35);
+    EXPECT_EQ(1, keys.current.estimate());
+    EXPECT_EQ(0, keys.previous.estimate());
+}
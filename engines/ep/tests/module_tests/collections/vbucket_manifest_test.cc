@@ -569,6 +569,23 @@ TEST_F(VBucketManifestTest, updates) {
     EXPECT_TRUE(manifest.exists(CollectionEntry::meat));
 }
 
+// The events of an update with several changes are queued into a single new
+// checkpoint, rather than a checkpoint each
+TEST_F(VBucketManifestTest, bulk_update_single_checkpoint) {
+    EXPECT_TRUE(manifest.update(cm));
+    auto& ckptMgr = *manifest.getActiveVB().checkpointManager;
+    const auto checkpointId = ckptMgr.getOpenCheckpointId();
+
+    EXPECT_TRUE(manifest.update(cm.add(ScopeEntry::shop1)
+                                        .add(CollectionEntry::fruit)
+                                        .add(CollectionEntry::meat)
+                                        .add(CollectionEntry::dairy,
+                                             ScopeEntry::shop1)));
+    EXPECT_EQ(checkpointId + 1, ckptMgr.getOpenCheckpointId());
+    EXPECT_TRUE(manifest.checkSize(5));
+    EXPECT_TRUE(manifest.exists(CollectionEntry::dairy));
+}
+
 TEST_F(VBucketManifestTest, updates2) {
     EXPECT_TRUE(manifest.update(cm.add(CollectionEntry::fruit)
                                         .add(CollectionEntry::meat)
@@ -0,0 +1,158 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the CompactStoredValueIndex class.
+ */
+
+#include "compact_stored_value_index.h"
+#include "item.h"
+#include "stats.h"
+#include "stored_value_factories.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <folly/portability/GTest.h>
+
+#include <set>
+
+class CompactStoredValueIndexTest : public ::testing::Test {
+protected:
+    CompactStoredValueIndexTest() : factory(stats) {
+    }
+
+    StoredValue::UniquePtr makeSV(const std::string& key,
+                                  bool pending = false) {
+        auto item = make_item(Vbid(0), makeStoredDocKey(key), "value");
+        if (pending) {
+            item.setPendingSyncWrite({});
+        }
+        return factory(item, {});
+    }
+
+    void insertMany(size_t count) {
+        for (size_t ii = 0; ii < count; ++ii) {
+            index.insert(makeSV("key_" + std::to_string(ii)));
+        }
+    }
+
+    EPStats stats;
+    StoredValueFactory factory;
+    CompactStoredValueIndex index;
+};
+
+TEST_F(CompactStoredValueIndexTest, Empty) {
+    EXPECT_EQ(0, index.size());
+    EXPECT_EQ(CompactStoredValueIndex::GroupSize, index.capacity());
+    EXPECT_FALSE(index.find(makeStoredDocKey("missing")));
+}
+
+TEST_F(CompactStoredValueIndexTest, InsertFind) {
+    const size_t numItems = 10000;
+    insertMany(numItems);
+    EXPECT_EQ(numItems, index.size());
+    // Load factor must be bounded at 7/8.
+    EXPECT_LE(index.size() * 8, index.capacity() * 7);
+
+    for (size_t ii = 0; ii < numItems; ++ii) {
+        const auto key = makeStoredDocKey("key_" + std::to_string(ii));
+        auto* sv = index.find(key);
+        ASSERT_TRUE(sv) << key;
+        EXPECT_TRUE(sv->hasKey(key));
+        EXPECT_FALSE(index.find(key, /*pending*/ true));
+    }
+    EXPECT_FALSE(index.find(makeStoredDocKey("missing")));
+}
+
+// Committed and Pending SVs for the same key are held independently.
+TEST_F(CompactStoredValueIndexTest, CommittedAndPending) {
+    auto* committed = index.insert(makeSV("key"));
+    auto* pending = index.insert(makeSV("key", /*pending*/ true));
+    ASSERT_NE(committed, pending);
+
+    const auto key = makeStoredDocKey("key");
+    EXPECT_EQ(committed, index.find(key));
+    EXPECT_EQ(pending, index.find(key, true));
+
+    auto released = index.release(pending);
+    EXPECT_EQ(pending, released.get().get());
+    EXPECT_FALSE(index.find(key, true));
+    EXPECT_EQ(committed, index.find(key));
+}
+
+TEST_F(CompactStoredValueIndexTest, Release) {
+    const size_t numItems = 1000;
+    insertMany(numItems);
+
+    // Release every other key; the remainder must still be found.
+    for (size_t ii = 0; ii < numItems; ii += 2) {
+        const auto key = makeStoredDocKey("key_" + std::to_string(ii));
+        auto* sv = index.find(key);
+        ASSERT_TRUE(sv);
+        EXPECT_TRUE(index.release(sv));
+        EXPECT_FALSE(index.release(sv)) << "Double release should fail";
+    }
+    EXPECT_EQ(numItems / 2, index.size());
+    for (size_t ii = 0; ii < numItems; ++ii) {
+        const auto key = makeStoredDocKey("key_" + std::to_string(ii));
+        EXPECT_EQ(ii % 2 != 0, index.find(key) != nullptr) << key;
+    }
+
+    // Re-inserting must re-use tombstones rather than growing unboundedly.
+    const auto capacity = index.capacity();
+    for (int round = 0; round < 10; ++round) {
+        for (size_t ii = 0; ii < numItems; ii += 2) {
+            index.insert(makeSV("key_" + std::to_string(ii)));
+        }
+        for (size_t ii = 0; ii < numItems; ii += 2) {
+            const auto key = makeStoredDocKey("key_" + std::to_string(ii));
+            ASSERT_TRUE(index.release(index.find(key)));
+        }
+    }
+    EXPECT_EQ(capacity, index.capacity());
+}
+
+TEST_F(CompactStoredValueIndexTest, PauseResumeVisit) {
+    const size_t numItems = 1000;
+    insertMany(numItems);
+
+    std::set<std::string> visited;
+    CompactStoredValueIndex::Position pos;
+    int pauses = 0;
+    while (pos != index.endPosition()) {
+        size_t visitedThisPass = 0;
+        pos = index.pauseResumeVisit(
+                [&visited, &visitedThisPass](StoredValue& sv) {
+                    EXPECT_TRUE(visited.insert(sv.getKey().to_string()).second)
+                            << "Visited twice:" << sv.getKey();
+                    // Pause after every 10 items.
+                    return ++visitedThisPass < 10;
+                },
+                pos);
+        ++pauses;
+    }
+    EXPECT_EQ(numItems, visited.size());
+    EXPECT_GE(pauses, numItems / 10);
+}
+
+TEST_F(CompactStoredValueIndexTest, Clear) {
+    insertMany(100);
+    index.clear();
+    EXPECT_EQ(0, index.size());
+    EXPECT_FALSE(index.find(makeStoredDocKey("key_0")));
+    index.insert(makeSV("key_0"));
+    EXPECT_TRUE(index.find(makeStoredDocKey("key_0")));
+}
@@ -0,0 +1,118 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the CompactionThrottle class.
+ */
+
+#include "compaction_throttle.h"
+#include "stats.h"
+
+#include <folly/portability/GTest.h>
+
+using namespace std::chrono_literals;
+
+class CompactionThrottleTest : public ::testing::Test {
+protected:
+    CompactionThrottleTest() : throttle(stats) {
+        throttle.setMinRate(1000);
+        // Start the first interval.
+        EXPECT_EQ(0ns, throttle.acquire(0, start));
+    }
+
+    std::chrono::nanoseconds acquireAt(std::chrono::milliseconds time,
+                                       size_t bytes) {
+        return throttle.acquire(bytes, start + time);
+    }
+
+    EPStats stats;
+    CompactionThrottle throttle;
+    const std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+};
+
+TEST_F(CompactionThrottleTest, DisabledByDefault) {
+    stats.bgNumOperations = 10;
+    stats.bgWait = 10 * 1000000;
+    stats.dirtyAge = 1000000;
+
+    EXPECT_EQ(0ns, acquireAt(50ms, 100000));
+    EXPECT_EQ(0ns, acquireAt(100ms, 100000));
+    EXPECT_EQ(CompactionThrottle::State::Disabled, throttle.getState());
+    EXPECT_EQ(0, throttle.getRateLimit());
+}
+
+TEST_F(CompactionThrottleTest, UnderTarget) {
+    throttle.setBgFetchLatencyTarget(1000us);
+    stats.bgNumOperations = 10;
+    stats.bgWait = 10 * 500;
+
+    EXPECT_EQ(0ns, acquireAt(50ms, 100000));
+    EXPECT_EQ(0ns, acquireAt(100ms, 100000));
+    EXPECT_EQ(CompactionThrottle::State::Unthrottled, throttle.getState());
+    EXPECT_EQ(1000000, throttle.getWriteRate());
+    EXPECT_EQ(0, throttle.getRateLimit());
+}
+
+TEST_F(CompactionThrottleTest, BgFetchLatencyOverTarget) {
+    throttle.setBgFetchLatencyTarget(100us);
+    EXPECT_EQ(0ns, acquireAt(50ms, 100000));
+
+    stats.bgNumOperations = 10;
+    stats.bgWait = 10 * 400;
+    stats.bgLoad = 10 * 100;
+
+    // 100000 bytes in the first 100ms was 1MB/s; the limit halves that, so
+    // the next 100000 bytes (200ms at 500KB/s) wait for a whole interval.
+    EXPECT_EQ(100ms, acquireAt(100ms, 100000));
+    EXPECT_EQ(CompactionThrottle::State::Throttled, throttle.getState());
+    EXPECT_EQ(1000000, throttle.getWriteRate());
+    EXPECT_EQ(500000, throttle.getRateLimit());
+
+    // Still over target; halved again.
+    stats.bgNumOperations += 10;
+    stats.bgWait += 10 * 500;
+    acquireAt(200ms, 0);
+    EXPECT_EQ(250000, throttle.getRateLimit());
+
+    // No BgFetches since; the limit is raised by the minimum rate while
+    // compaction keeps writing at it...
+    acquireAt(250ms, 25000);
+    acquireAt(300ms, 0);
+    EXPECT_EQ(251000, throttle.getRateLimit());
+
+    // ... and removed once it no longer does.
+    acquireAt(400ms, 0);
+    EXPECT_EQ(0, throttle.getRateLimit());
+    EXPECT_EQ(CompactionThrottle::State::Unthrottled, throttle.getState());
+}
+
+TEST_F(CompactionThrottleTest, DirtyAgeOverTarget) {
+    throttle.setDirtyAgeTarget(1000us);
+    stats.dirtyAge = 2000;
+
+    acquireAt(50ms, 100000);
+    acquireAt(100ms, 0);
+    EXPECT_EQ(CompactionThrottle::State::Throttled, throttle.getState());
+    EXPECT_EQ(500000, throttle.getRateLimit());
+
+    // The limit never drops below the minimum rate.
+    for (int i = 2; i < 20; ++i) {
+        acquireAt(i * 100ms, 0);
+    }
+    EXPECT_EQ(1000, throttle.getRateLimit());
+}
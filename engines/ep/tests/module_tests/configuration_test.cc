@@ -21,6 +21,7 @@
 
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
+#include <programs/engine_testapp/mock_server.h>
 #include <memory>
 
 /* Like EXPECT_THROW except you can check the exception's `what()` */
@@ -283,6 +284,7 @@ class ConfigurationShim : public Configuration {
      */
 
 public:
+    using Configuration::addCache;
     using Configuration::addParameter;
     using Configuration::getParameter;
     using Configuration::setParameter;
@@ -307,6 +309,34 @@ TEST(ConfigurationTest, SetGetWorks) {
     EXPECT_EQ(configuration.getParameter<std::string>("string"), "hello");
 }
 
+// Test that the atomic copy of a parameter tracks its value, including
+// through the generated (lock-free) getters.
+TEST(ConfigurationTest, CacheTracksValue) {
+    ConfigurationShim configuration;
+    std::atomic<size_t> cache{0};
+
+    configuration.addParameter("size", (size_t)100, true);
+    configuration.addCache("size", cache);
+    EXPECT_EQ(100, cache);
+
+    configuration.setParameter("size", (size_t)200);
+    EXPECT_EQ(200, cache);
+
+    // A rejected value doesn't change it
+    configuration.setValueValidator("size",
+                                    (new SizeRangeValidator())->max(300));
+    EXPECT_THROW(configuration.setParameter("size", (size_t)301),
+                 std::range_error);
+    EXPECT_EQ(200, cache);
+
+    configuration.setMaxItemSize(1234);
+    EXPECT_EQ(1234, configuration.getMaxItemSize());
+    EXPECT_EQ(1234, configuration.getParameter<size_t>("max_item_size"));
+    configuration.parseConfiguration("max_item_size=4321",
+                                     get_mock_server_api());
+    EXPECT_EQ(4321, configuration.getMaxItemSize());
+}
+
 TEST(ConfigurationTest, ValidatorWorks) {
     ConfigurationShim configuration;
     std::string key{"test_key"};
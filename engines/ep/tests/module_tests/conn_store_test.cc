@@ -55,60 +55,59 @@ void ConnStoreTest::removeConnHandler(const void* cookie) {
     ASSERT_EQ(max, handle->copyCookieToConn().size());
 }
 
-void ConnStoreTest::addVbConn(Vbid vb, ConnHandler& conn) {
+void ConnStoreTest::addVbConn(Vbid vb, std::shared_ptr<ConnHandler> conn) {
     // We are assuming that the cookie and vbid are valid
-    auto& map = connStore->getVBToConnsMap();
-    auto& list = map[vb.get()];
-    auto listSize = list.size();
+    auto listSize = connStore->getVBConns(vb)->size();
 
-    auto itr = connStore->getVBToConnsItr(vb, conn);
+    auto vbConn = connStore->getVBConn(vb, *conn);
     auto refCount = 0;
-    if (itr != list.end()) {
-        refCount = itr->refCount;
+    if (vbConn) {
+        refCount = vbConn->refCount;
     }
 
     ASSERT_NO_THROW(connStore->addVBConnByVbid(vb, conn));
 
-    itr = connStore->getVBToConnsItr(vb, conn);
-    ASSERT_NE(itr, list.end());
-    ASSERT_EQ(refCount + 1, itr->refCount);
+    vbConn = connStore->getVBConn(vb, *conn);
+    ASSERT_TRUE(vbConn);
+    ASSERT_EQ(refCount + 1, vbConn->refCount);
 
     if (listSize == 0) {
-        ASSERT_EQ(listSize + 1, list.size());
+        auto list = connStore->getVBConns(vb);
+        ASSERT_EQ(listSize + 1, list->size());
 
         // We'll put the new connection at the back of the list so grab the last
         // one And the cookie should match
-        ASSERT_EQ(conn.getCookie(), list.back().connHandler.getCookie());
+        ASSERT_EQ(conn->getCookie(), list->back().connHandler->getCookie());
     }
 }
 
 void ConnStoreTest::removeVbConn(Vbid vb, const void* cookie) {
     // We are assuming that the cookie and vbid are valid
-    auto& map = connStore->getVBToConnsMap();
-    auto& list = map[vb.get()];
+    auto list = connStore->getVBConns(vb);
 
     // Check beforehand if we should delete anything
     auto itr = std::find_if(
-            list.begin(), list.end(), [cookie](ConnStore::VBConn conn) {
-                return cookie == conn.connHandler.getCookie();
+            list->begin(), list->end(), [cookie](const ConnStore::VBConn& conn) {
+                return cookie == conn.connHandler->getCookie();
             });
 
-    int expectedSize = list.size();
-    if (itr != list.end()) {
+    int expectedSize = list->size();
+    if (itr != list->end()) {
         expectedSize = std::max(0, expectedSize - 1);
     }
 
     ASSERT_NO_THROW(connStore->removeVBConnByVbid(vb, cookie));
 
-    ASSERT_EQ(expectedSize, list.size());
+    list = connStore->getVBConns(vb);
+    ASSERT_EQ(expectedSize, list->size());
 
     // Check that we removed the element for this cookie
     itr = std::find_if(
-            list.begin(), list.end(), [cookie](ConnStore::VBConn conn) {
-                return cookie == conn.connHandler.getCookie();
+            list->begin(), list->end(), [cookie](const ConnStore::VBConn& conn) {
+                return cookie == conn.connHandler->getCookie();
             });
 
-    ASSERT_EQ(list.end(), itr);
+    ASSERT_EQ(list->end(), itr);
 }
 
 TEST_F(ConnStoreTest, AddConnHandler) {
@@ -133,49 +132,48 @@ TEST_F(ConnStoreTest, RemoveConnHandler) {
 // should not exist in the map
 TEST_F(ConnStoreTest, AddVBConnInvalidVbid) {
     auto consumer = addConnHandler(cookie, "consumer");
-    EXPECT_THROW(connStore->addVBConnByVbid(Vbid(-1), *consumer.get()),
+    EXPECT_THROW(connStore->addVBConnByVbid(Vbid(-1), consumer),
                  std::out_of_range);
     EXPECT_THROW(connStore->addVBConnByVbid(
                          Vbid(engine->getConfiguration().getMaxVbuckets() + 1),
-                         *consumer.get()),
+                         consumer),
                  std::out_of_range);
 }
 
 TEST_F(ConnStoreTest, AddVbConnValid) {
     auto consumer = addConnHandler(cookie, "consumer");
-    addVbConn(Vbid(0), *consumer.get());
+    addVbConn(Vbid(0), consumer);
 }
 
 TEST_F(ConnStoreTest, AddMultipleVbConnsOneConnHandler) {
-    auto& map = connStore->getVBToConnsMap();
     // vbToConns should be empty
-    for (const auto& list : map) {
-        ASSERT_EQ(0, list.size());
+    for (const auto& list : connStore->getVBConnsSnapshot()) {
+        ASSERT_EQ(0, list->size());
     }
 
     auto consumer = addConnHandler(cookie, "consumer");
 
     Vbid vb(0);
-    addVbConn(vb, *consumer.get());
+    addVbConn(vb, consumer);
 
-    for (size_t i = 0; i < map.size(); i++) {
-        auto list = map[i];
+    for (size_t i = 0; i < connStore->getNumVBuckets(); i++) {
+        auto list = connStore->getVBConns(Vbid(i));
         if (i == vb.get()) {
-            EXPECT_EQ(1, list.size());
+            EXPECT_EQ(1, list->size());
         } else {
-            EXPECT_EQ(0, list.size());
+            EXPECT_EQ(0, list->size());
         }
     }
 
-    connStore->addVBConnByVbid(vb, *consumer.get());
+    connStore->addVBConnByVbid(vb, consumer);
 
     // Don't add duplicates
-    for (size_t i = 0; i < map.size(); i++) {
-        auto list = map[i];
+    for (size_t i = 0; i < connStore->getNumVBuckets(); i++) {
+        auto list = connStore->getVBConns(Vbid(i));
         if (i == vb.get()) {
-            EXPECT_EQ(1, list.size());
+            EXPECT_EQ(1, list->size());
         } else {
-            EXPECT_EQ(0, list.size());
+            EXPECT_EQ(0, list->size());
         }
     }
 }
@@ -200,81 +198,101 @@ TEST_F(ConnStoreTest, RemoveVbConnInvalidCookie) {
 TEST_F(ConnStoreTest, RemoveVbConnValid) {
     Vbid vb(0);
     auto consumer = addConnHandler(cookie, "consumer");
-    addVbConn(vb, *consumer.get());
+    addVbConn(vb, consumer);
     removeVbConn(vb, cookie);
 }
 
 // Test that we remove all vbConns for the given ConnHandler if we remove the
 // ConnHandler
 TEST_F(ConnStoreTest, RemoveConnHandlerWithVbConns) {
-    auto& map = connStore->getVBToConnsMap();
     // vbToConns should be empty
-    for (const auto& list : map) {
-        ASSERT_EQ(0, list.size());
+    for (const auto& list : connStore->getVBConnsSnapshot()) {
+        ASSERT_EQ(0, list->size());
     }
 
     auto consumer = addConnHandler(cookie, "consumer");
 
-    for (size_t i = 0; i < map.size(); i++) {
+    for (size_t i = 0; i < connStore->getNumVBuckets(); i++) {
         Vbid vb(i);
-        addVbConn(vb, *consumer.get());
+        addVbConn(vb, consumer);
     }
 
-    for (const auto& list : map) {
-        EXPECT_EQ(1, list.size());
+    for (const auto& list : connStore->getVBConnsSnapshot()) {
+        EXPECT_EQ(1, list->size());
     }
 
     removeConnHandler(cookie);
 
     // We should have removed the ConnHandler from all lists in vbToConns
     // map
-    for (const auto& list : map) {
-        EXPECT_EQ(0, list.size());
+    for (const auto& list : connStore->getVBConnsSnapshot()) {
+        EXPECT_EQ(0, list->size());
     }
 }
 
+// A reader's handle is a snapshot, it is unaffected by (and keeps alive the
+// ConnHandlers across) concurrent removal
+TEST_F(ConnStoreTest, ConnsForVBHandleIsSnapshot) {
+    Vbid vb(0);
+    auto consumer = addConnHandler(cookie, "consumer");
+    addVbConn(vb, consumer);
+
+    auto handle = connStore->getConnsForVBHandle(vb);
+    std::weak_ptr<ConnHandler> weak = consumer;
+    removeConnHandler(cookie);
+    consumer.reset();
+
+    EXPECT_EQ(0, connStore->getVBConns(vb)->size());
+    EXPECT_FALSE(weak.expired());
+    size_t count = 0;
+    for (const auto& vbConn : handle) {
+        EXPECT_EQ(cookie, vbConn.connHandler->getCookie());
+        ++count;
+    }
+    EXPECT_EQ(1, count);
+}
+
 // Test that we don't mess up other ConnHandlers when removing one
 TEST_F(ConnStoreTest, RemoveOneConnHandlerWithVbConns) {
-    auto& map = connStore->getVBToConnsMap();
     // vbToConns should be empty
-    for (const auto& list : map) {
-        ASSERT_EQ(0, list.size());
+    for (const auto& list : connStore->getVBConnsSnapshot()) {
+        ASSERT_EQ(0, list->size());
     }
 
     auto consumer1 = addConnHandler(cookie, "consumer1");
 
     // Add the vbConns
-    for (size_t i = 0; i < map.size(); i++) {
+    for (size_t i = 0; i < connStore->getNumVBuckets(); i++) {
         Vbid vb(i);
-        addVbConn(vb, *consumer1.get());
+        addVbConn(vb, consumer1);
     }
 
     // Check we added something
-    for (const auto& list : map) {
-        EXPECT_EQ(1, list.size());
+    for (const auto& list : connStore->getVBConnsSnapshot()) {
+        EXPECT_EQ(1, list->size());
     }
 
     auto cookie2 = create_mock_cookie();
     auto consumer2 = addConnHandler(cookie2, "consumer2");
 
     // Add the vbConns
-    for (size_t i = 0; i < map.size(); i++) {
+    for (size_t i = 0; i < connStore->getNumVBuckets(); i++) {
         Vbid vb(i);
-        addVbConn(vb, *consumer2.get());
+        addVbConn(vb, consumer2);
     }
 
     // Check we added something
-    for (const auto& list : map) {
-        EXPECT_EQ(2, list.size());
+    for (const auto& list : connStore->getVBConnsSnapshot()) {
+        EXPECT_EQ(2, list->size());
     }
 
     // Remove consumer1
     removeConnHandler(cookie);
 
     // We should have removed the ConnHandler for cookie1
-    for (const auto& list : map) {
-        EXPECT_EQ(1, list.size());
-        EXPECT_EQ(consumer2->getCookie(), list.front().connHandler.getCookie());
+    for (const auto& list : connStore->getVBConnsSnapshot()) {
+        EXPECT_EQ(1, list->size());
+        EXPECT_EQ(consumer2->getCookie(), list->front().connHandler->getCookie());
     }
 
     destroy_mock_cookie(cookie2);
@@ -36,6 +36,7 @@
 #include <folly/portability/GMock.h>
 #include <platform/dirutils.h>
 
+#include <cstdlib>
 #include <fstream>
 #include <memory>
 
@@ -79,6 +80,210 @@ TEST_F(CouchKVStoreTest, StatsTest) {
     EXPECT_GE(io_total_write_bytes, io_write_bytes);
 }
 
+// Verify that with couchstore_write_coalesce_size set the writes of a flush
+// are coalesced into fewer filesystem writes, and the data can be read back.
+TEST_F(CouchKVStoreTest, CoalescedWrites) {
+    CouchKVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    // Disable couchstore's own buffering so each doc body / node is written
+    // separately.
+    config.setBuffered(false);
+    config.setCouchstoreWriteCoalesceSize(1024 * 1024);
+    auto kvstore = setup_kv_store(config);
+
+    std::vector<queued_item> items;
+    kvstore->begin(std::make_unique<TransactionContext>(vbid));
+    for (int ii = 0; ii < 100; ++ii) {
+        auto item = makeCommittedItem(
+                makeStoredDocKey("key" + std::to_string(ii)), "value");
+        item->setBySeqno(ii + 1);
+        kvstore->set(item);
+        items.push_back(item);
+    }
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    const auto& fsStats = kvstore->getKVStoreStat().fsStats;
+    EXPECT_GT(fsStats.submittedWriteCountHisto.getMaxValue(),
+              fsStats.writeCountHisto.getMaxValue());
+
+    for (const auto& item : items) {
+        auto gv = kvstore->get(DiskDocKey{*item}, vbid);
+        ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+        EXPECT_EQ("value", gv.item->getValueView());
+    }
+}
+
+#ifndef WIN32
+// Verify that with couchstore_mmap_reads set, files opened read-only are
+// mapped while open and reads of them (including after a newer header has
+// been written) are served from the mapping.
+TEST_F(CouchKVStoreTest, MmapReads) {
+    CouchKVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    config.setCouchstoreMmapReads(true);
+    auto kvstore = setup_kv_store(config);
+    const auto& fsStats = kvstore->getKVStoreStat().fsStats;
+
+    std::vector<queued_item> items;
+    for (int batch = 0; batch < 2; ++batch) {
+        kvstore->begin(std::make_unique<TransactionContext>(vbid));
+        for (int ii = 0; ii < 50; ++ii) {
+            const auto seqno = batch * 50 + ii + 1;
+            auto item = makeCommittedItem(
+                    makeStoredDocKey("key" + std::to_string(seqno)),
+                    std::string(seqno * 10, 'x'));
+            item->setBySeqno(seqno);
+            kvstore->set(item);
+            items.push_back(item);
+        }
+        EXPECT_TRUE(kvstore->commit(flush));
+
+        for (const auto& item : items) {
+            auto gv = kvstore->get(DiskDocKey{*item}, vbid);
+            ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+            EXPECT_EQ(item->getValueView(), gv.item->getValueView());
+        }
+    }
+
+    {
+        auto handle = kvstore->makeFileHandle(vbid);
+        ASSERT_TRUE(handle);
+        EXPECT_GT(fsStats.mmapMappedBytes, 0);
+    }
+    EXPECT_EQ(0, fsStats.mmapMappedBytes);
+    EXPECT_EQ(0, fsStats.mmapFallbackReads);
+}
+#endif
+
+#ifdef __linux__
+// Verify that with couchstore_backfill_readahead_size and
+// couchstore_backfill_drop_behind set, a by-seqno scan of a file reads
+// ahead of itself and drops what it moved past, and still returns every
+// document.
+TEST_F(CouchKVStoreTest, ScanReadaheadAndDropBehind) {
+    CouchKVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    config.setCouchstoreBackfillReadaheadSize(1024 * 1024);
+    config.setCouchstoreBackfillDropBehind(true);
+    auto kvstore = setup_kv_store(config);
+    const auto& fsStats = kvstore->getKVStoreStat().fsStats;
+
+    // Enough (incompressible) data for the scan to move well past
+    // DropBatch.
+    const int numItems = 2000;
+    kvstore->begin(std::make_unique<TransactionContext>(vbid));
+    for (int ii = 1; ii <= numItems; ++ii) {
+        std::string value(4096, '\0');
+        for (auto& c : value) {
+            c = char(std::rand());
+        }
+        auto item = makeCommittedItem(
+                makeStoredDocKey("key" + std::to_string(ii)), value);
+        item->setBySeqno(ii);
+        kvstore->set(item);
+    }
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    int64_t lastSeqno = 0;
+    auto ctx = kvstore->initBySeqnoScanContext(
+            std::make_unique<CustomCallback<GetValue>>([&lastSeqno](
+                                                               GetValue gv) {
+                EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+                EXPECT_EQ(lastSeqno + 1, gv.item->getBySeqno());
+                lastSeqno = gv.item->getBySeqno();
+            }),
+            std::make_unique<CustomCallback<CacheLookup>>(),
+            vbid,
+            1,
+            DocumentFilter::ALL_ITEMS,
+            ValueFilter::VALUES_DECOMPRESSED,
+            SnapshotSource::Head);
+    ASSERT_TRUE(ctx);
+    ASSERT_EQ(scan_success, kvstore->scan(*ctx));
+    EXPECT_EQ(numItems, lastSeqno);
+
+    EXPECT_GT(fsStats.scanReadaheadBytes, 0);
+    EXPECT_GT(fsStats.scanDroppedBytes, 0);
+}
+#endif
+
+// Verify that getMulti with bgfetch readahead (deferred body reads) returns
+// the same results as the default path, for found, missing and meta-only
+// fetches.
+TEST_F(CouchKVStoreTest, GetMultiReadahead) {
+    CouchKVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    config.setCouchstoreBgFetchReadaheadEnabled(true);
+    auto kvstore = setup_kv_store(config);
+
+    const int numItems = 100;
+    kvstore->begin(std::make_unique<TransactionContext>(vbid));
+    for (int i = 0; i < numItems; i++) {
+        // Vary the value size so bodies span blocks differently.
+        auto qi = makeCommittedItem(makeStoredDocKey("key" + std::to_string(i)),
+                                    std::string(i * 100, 'x'));
+        qi->setBySeqno(i + 1);
+        kvstore->set(qi);
+    }
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    vb_bgfetch_queue_t q;
+    for (int i = 0; i < numItems + 1; i++) {
+        vb_bgfetch_item_ctx_t ctx;
+        ctx.isMetaOnly = (i % 10 == 0) ? GetMetaOnly::Yes : GetMetaOnly::No;
+        q[makeDiskDocKey("key" + std::to_string(i))] = std::move(ctx);
+    }
+    kvstore->getMulti(vbid, q);
+
+    for (int i = 0; i < numItems; i++) {
+        auto& fetched = q[makeDiskDocKey("key" + std::to_string(i))];
+        ASSERT_EQ(ENGINE_SUCCESS, fetched.value.getStatus()) << "key" << i;
+        if (fetched.isMetaOnly == GetMetaOnly::No) {
+            EXPECT_EQ(std::string(i * 100, 'x'),
+                      fetched.value.item->getValue()->to_s())
+                    << "key" << i;
+        }
+    }
+    // The key past the end was never written.
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              q[makeDiskDocKey("key" + std::to_string(numItems))]
+                      .value.getStatus());
+    EXPECT_EQ(numItems, kvstore->getKVStoreStat().io_bg_fetch_docs_read);
+    EXPECT_EQ(0, kvstore->getKVStoreStat().numGetFailure);
+}
+
+// getMultiBulk() reads in file order even when couchstore_bgfetch_readahead
+// is disabled, and returns the same as getMulti() would.
+TEST_F(CouchKVStoreTest, GetMultiBulk) {
+    CouchKVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    config.setCouchstoreBgFetchReadaheadEnabled(false);
+    auto kvstore = setup_kv_store(config);
+
+    const int numItems = 100;
+    kvstore->begin(std::make_unique<TransactionContext>(vbid));
+    for (int i = 0; i < numItems; i++) {
+        auto qi = makeCommittedItem(makeStoredDocKey("key" + std::to_string(i)),
+                                    std::string(i * 100, 'x'));
+        qi->setBySeqno(i + 1);
+        kvstore->set(qi);
+    }
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    vb_bgfetch_queue_t q;
+    for (int i = 0; i < numItems + 1; i++) {
+        q[makeDiskDocKey("key" + std::to_string(i))] = vb_bgfetch_item_ctx_t{};
+    }
+    kvstore->getMultiBulk(vbid, q);
+
+    for (int i = 0; i < numItems; i++) {
+        auto& fetched = q[makeDiskDocKey("key" + std::to_string(i))];
+        ASSERT_EQ(ENGINE_SUCCESS, fetched.value.getStatus()) << "key" << i;
+        EXPECT_EQ(std::string(i * 100, 'x'),
+                  fetched.value.item->getValue()->to_s())
+                << "key" << i;
+    }
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              q[makeDiskDocKey("key" + std::to_string(numItems))]
+                      .value.getStatus());
+    EXPECT_EQ(numItems, kvstore->getKVStoreStat().io_bg_fetch_docs_read);
+}
+
 // Verify the compaction stats returned from operations are accurate.
 TEST_F(CouchKVStoreTest, CompactStatsTest) {
     CouchKVStoreConfig config(1, 4, data_dir, "couchdb", 0);
@@ -121,6 +326,13 @@ TEST_F(CouchKVStoreTest, CompactStatsTest) {
     EXPECT_GT(io_total_write_bytes, io_compaction_write_bytes);
     EXPECT_GE(io_total_write_bytes, io_write_bytes * 2);
     EXPECT_GE(io_compaction_write_bytes, io_write_bytes);
+
+    // Each phase of the compaction is timed.
+    const auto& kvStats = kvstore->getKVStoreStat();
+    EXPECT_EQ(1, kvStats.compactHisto.getValueCount());
+    EXPECT_EQ(1, kvStats.compactCopyHisto.getValueCount());
+    EXPECT_EQ(1, kvStats.compactCommitHisto.getValueCount());
+    EXPECT_EQ(1, kvStats.compactSwapHisto.getValueCount());
 }
 
 // Regression test for MB-17517 - ensure that if a couchstore file has a max
@@ -145,6 +357,99 @@ TEST_F(CouchKVStoreTest, MB_17517MaxCasOfMinus1) {
     EXPECT_EQ(0u, kvstore.rw->listPersistedVbuckets()[0]->maxCas);
 }
 
+// Check that the RO store starts with the vBucket states the RW store read
+// at startup (which it copies rather than reading them again)
+TEST_F(CouchKVStoreTest, ReadOnlyStoreHasPersistedVBucketStates) {
+    CouchKVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = KVStoreFactory::create(config);
+    ASSERT_NE(nullptr, kvstore.rw);
+
+    vbucket_state state;
+    state.transition.state = vbucket_state_replica;
+    state.maxCas = 1234;
+    EXPECT_TRUE(kvstore.rw->snapshotVBucket(Vbid(0), state));
+
+    // Close the file, then re-open.
+    kvstore = KVStoreFactory::create(config);
+    ASSERT_NE(nullptr, kvstore.ro);
+
+    const auto* roState = kvstore.ro->getVBucketState(Vbid(0));
+    ASSERT_NE(nullptr, roState);
+    EXPECT_EQ(vbucket_state_replica, roState->transition.state);
+    EXPECT_EQ(1234u, roState->maxCas);
+    EXPECT_EQ(nullptr, kvstore.ro->getVBucketState(Vbid(1)));
+
+    std::map<std::string, std::string> stats;
+    kvstore.ro->addStats(add_stat_callback, &stats, "");
+    EXPECT_EQ("1", stats["ro_0:numLoadedVb"]);
+}
+
+// Check that a vBucket exported from the snapshot of a file handle can be
+// installed in another KVStore, and holds exactly the data of that snapshot
+TEST_F(CouchKVStoreTest, ExportImportSnapshot) {
+    CouchKVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+    ASSERT_TRUE(kvstore->supportsSnapshotTransfer());
+
+    auto flushItems = [&kvstore, this](int first, int last) {
+        kvstore->begin(std::make_unique<TransactionContext>(vbid));
+        for (int ii = first; ii <= last; ++ii) {
+            auto item = makeCommittedItem(
+                    makeStoredDocKey("key" + std::to_string(ii)), "value");
+            item->setBySeqno(ii);
+            kvstore->set(item);
+        }
+        flush.proposedVBState.lastSnapStart = last;
+        flush.proposedVBState.lastSnapEnd = last;
+        EXPECT_TRUE(kvstore->commit(flush));
+    };
+    flushItems(1, 10);
+
+    // Mutations flushed after the handle was opened are not exported
+    auto handle = kvstore->makeFileHandle(vbid);
+    ASSERT_TRUE(handle);
+    flushItems(11, 20);
+
+    const auto snapshot = data_dir + "/snapshot";
+    auto exported = kvstore->exportSnapshot(*handle, vbid, snapshot);
+    handle.reset();
+    ASSERT_TRUE(exported);
+    EXPECT_EQ(10, exported->highSeqno);
+    EXPECT_EQ(10, exported->lastSnapEnd);
+
+    const std::string destDir = data_dir + "-dest";
+    cb::io::rmrf(destDir);
+    CouchKVStoreConfig destConfig(1024, 4, destDir, "couchdb", 0);
+    auto dest = KVStoreFactory::create(destConfig);
+    ASSERT_NE(nullptr, dest.rw);
+    // Move the file onto the filesystem of the destination
+    ASSERT_EQ(0, rename(snapshot.c_str(), (destDir + "/snapshot").c_str()));
+
+    auto imported = dest.rw->importSnapshot(vbid, destDir + "/snapshot");
+    ASSERT_TRUE(imported);
+    EXPECT_EQ(*exported, *imported);
+    EXPECT_FALSE(cb::io::isFile(destDir + "/snapshot"));
+    EXPECT_EQ(10, dest.rw->getItemCount(vbid));
+    ASSERT_NE(nullptr, dest.rw->getVBucketState(vbid));
+    EXPECT_EQ(10, dest.rw->getVBucketState(vbid)->highSeqno);
+
+    for (int ii = 1; ii <= 20; ++ii) {
+        auto gv = dest.rw->get(
+                DiskDocKey{makeStoredDocKey("key" + std::to_string(ii))},
+                vbid);
+        EXPECT_EQ(ii <= 10 ? ENGINE_SUCCESS : ENGINE_KEY_ENOENT,
+                  gv.getStatus())
+                << ii;
+    }
+
+    // A missing file leaves the installed vBucket untouched
+    EXPECT_FALSE(dest.rw->importSnapshot(vbid, destDir + "/snapshot"));
+    EXPECT_EQ(10, dest.rw->getItemCount(vbid));
+
+    dest = {};
+    cb::io::rmrf(destDir);
+}
+
 // Regression test for MB-19430 - ensure that an attempt to get the
 // item count from a file which doesn't exist yet propagates the
 // error so the caller can detect (and retry as necessary).
@@ -735,6 +1040,54 @@ TEST_F(CouchKVStoreErrorInjectionTest, commit_commit) {
     }
 }
 
+/**
+ * A commit during a group commit defers the sync of the header until
+ * CouchKVStore::endGroupCommit; the data is still synced before the header is
+ * written.
+ */
+TEST_F(CouchKVStoreErrorInjectionTest, groupCommit_defers_header_sync) {
+    generate_items(1);
+
+    kvstore->beginGroupCommit();
+    kvstore->begin(std::make_unique<TransactionContext>(vbid));
+    kvstore->set(items.front());
+
+    EXPECT_CALL(ops, sync(_, _)).Times(1);
+    EXPECT_TRUE(kvstore->commit(flush));
+    ::testing::Mock::VerifyAndClearExpectations(&ops);
+
+    EXPECT_CALL(ops, sync(_, _)).Times(1);
+    EXPECT_TRUE(kvstore->endGroupCommit());
+}
+
+/**
+ * Injects error during CouchKVStore::endGroupCommit/sync
+ */
+TEST_F(CouchKVStoreErrorInjectionTest, endGroupCommit_sync) {
+    generate_items(1);
+
+    kvstore->beginGroupCommit();
+    kvstore->begin(std::make_unique<TransactionContext>(vbid));
+    kvstore->set(items.front());
+    EXPECT_TRUE(kvstore->commit(flush));
+    {
+        /* Establish Logger expectation */
+        EXPECT_CALL(logger, mlog(_, _)).Times(AnyNumber());
+        EXPECT_CALL(logger,
+                    mlog(Ge(spdlog::level::level_enum::warn),
+                         VCE(COUCHSTORE_ERROR_WRITE)))
+                .Times(1)
+                .RetiresOnSaturation();
+
+        /* Establish FileOps expectation */
+        EXPECT_CALL(ops, sync(_, _))
+                .WillOnce(Return(COUCHSTORE_ERROR_WRITE))
+                .RetiresOnSaturation();
+
+        EXPECT_FALSE(kvstore->endGroupCommit());
+    }
+}
+
 /**
  * Injects error during CouchKVStore::get/couchstore_docinfo_by_id
  */
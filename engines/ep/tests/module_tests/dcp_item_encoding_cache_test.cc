@@ -0,0 +1,91 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the DcpItemEncodingCache class.
+ */
+
+#include "dcp/item_encoding_cache.h"
+#include "item.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <folly/portability/GTest.h>
+
+class DcpItemEncodingCacheTest : public ::testing::Test {
+protected:
+    queued_item makeQueuedItem(const std::string& key) {
+        return queued_item(new Item(
+                make_item(Vbid(0), makeStoredDocKey(key), "value")));
+    }
+
+    const DcpItemEncodingCache::Encoding keysOnly{
+            IncludeValue::No,
+            IncludeXattrs::No,
+            IncludeDeletedUserXattrs::No,
+            false,
+            false};
+    const DcpItemEncodingCache::Encoding compressed{
+            IncludeValue::Yes,
+            IncludeXattrs::Yes,
+            IncludeDeletedUserXattrs::Yes,
+            true,
+            true};
+
+    DcpItemEncodingCache cache{16};
+};
+
+TEST_F(DcpItemEncodingCacheTest, InvalidSize) {
+    EXPECT_THROW(DcpItemEncodingCache(0), std::invalid_argument);
+}
+
+TEST_F(DcpItemEncodingCacheTest, HitAndMiss) {
+    auto source = makeQueuedItem("key");
+    EXPECT_FALSE(cache.find(source, compressed));
+    EXPECT_EQ(1, cache.getMisses());
+
+    auto encoded = queued_item(new Item(*source));
+    cache.insert(source, compressed, encoded);
+
+    // The same encoded Item is shared on a hit.
+    EXPECT_EQ(encoded.get(), cache.find(source, compressed).get());
+    EXPECT_EQ(1, cache.getHits());
+    EXPECT_EQ(encoded->getNBytes(), cache.getBytesSaved());
+
+    // A different encoding of the same Item misses.
+    EXPECT_FALSE(cache.find(source, keysOnly));
+    EXPECT_EQ(2, cache.getMisses());
+
+    // As does a different Item with the same content, as items are
+    // identified by address.
+    EXPECT_FALSE(cache.find(makeQueuedItem("key"), compressed));
+    EXPECT_EQ(3, cache.getMisses());
+}
+
+// The cache holds a reference to both the source and encoded Item until
+// the entry is replaced or cleared.
+TEST_F(DcpItemEncodingCacheTest, HoldsReferences) {
+    auto source = makeQueuedItem("key");
+    auto encoded = queued_item(new Item(*source));
+    cache.insert(source, compressed, encoded);
+    EXPECT_EQ(2, source.refCount());
+    EXPECT_EQ(2, encoded.refCount());
+
+    cache.clear();
+    EXPECT_EQ(1, source.refCount());
+    EXPECT_EQ(1, encoded.refCount());
+    EXPECT_FALSE(cache.find(source, compressed));
+}
@@ -774,6 +774,25 @@ TEST_P(StreamTest, MB17653_ItemsRemaining) {
     destroy_dcp_stream();
 }
 
+// Check that the time from queueing to sending is recorded for items sent
+// from memory, and not for meta items (snapshot markers).
+TEST_P(StreamTest, ItemSendLatency) {
+    store_item(vbid, "key", "value");
+    store_item(vbid, "key_2", "value");
+
+    setup_dcp_stream();
+    EXPECT_EQ(0, stream->getItemSendLatencyHisto().getValueCount());
+
+    stream->nextCheckpointItemTask();
+    std::unique_ptr<DcpResponse> response;
+    do {
+        response = stream->public_nextQueuedItem();
+    } while (response);
+
+    EXPECT_EQ(2, stream->getItemSendLatencyHisto().getValueCount());
+    destroy_dcp_stream();
+}
+
 /* Stream items from a DCP backfill */
 TEST_P(StreamTest, BackfillOnly) {
     /* Add 3 items */
@@ -1975,6 +1994,242 @@ TEST_P(SingleThreadedActiveStreamTest, BackfillSequential) {
     ASSERT_EQ(backfill_finished, bfm.backfill());
 }
 
+// A by-seqno disk backfill split across scan lanes must deliver every item
+// exactly once and in seqno order, however the lane tasks and the backfill
+// interleave.
+TEST_P(SingleThreadedActiveStreamTest, BackfillParallelLanes) {
+    if (!persistent()) {
+        return;
+    }
+    stream.reset();
+
+    const int numItems = 7;
+    for (int i = 0; i < numItems; i++) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(i)), "value");
+    }
+    auto vb = engine->getVBucket(vbid);
+    auto& ckptMgr = *vb->checkpointManager;
+    ckptMgr.createNewCheckpoint();
+    flushVBucketToDiskIfPersistent(vbid, numItems);
+    bool newCKptCreated;
+    ASSERT_EQ(numItems,
+              ckptMgr.removeClosedUnrefCheckpoints(*vb, newCKptCreated));
+
+    // Chunks of 2 seqnos over 2 lanes; the last chunk is a partial one.
+    engine->getConfiguration().setDcpScanItemLimit(2);
+    engine->getConfiguration().setDcpBackfillScanParallelism(2);
+    setupProducer();
+    ASSERT_TRUE(stream->isBackfilling());
+
+    // Run whichever of BackfillManagerTask and the lane tasks is next until
+    // the backfill completes.
+    auto& lpAuxioQ = *task_executor->getLpTaskQ()[AUXIO_TASK_IDX];
+    for (int i = 0; i < 100 && stream->isBackfilling(); i++) {
+        runNextTask(lpAuxioQ);
+    }
+    ASSERT_FALSE(stream->isBackfilling());
+
+    ASSERT_EQ(numItems + 1, stream->public_readyQSize());
+    auto resp = stream->public_popFromReadyQ();
+    EXPECT_EQ(DcpResponse::Event::SnapshotMarker, resp->getEvent());
+    for (int seqno = 1; seqno <= numItems; seqno++) {
+        resp = stream->public_popFromReadyQ();
+        ASSERT_EQ(DcpResponse::Event::Mutation, resp->getEvent());
+        EXPECT_EQ(seqno, *resp->getBySeqno());
+    }
+}
+
+// With dcp_backfill_shared_scans, a second backfill of the same vBucket
+// subscribes to the scan of the first: it reads what the first had already
+// moved past itself, then receives the rest from the first's scan. If it
+// falls too far behind it continues on its own. Either way both streams
+// must receive every item exactly once and in seqno order.
+class SharedBackfillScanTest : public SingleThreadedActiveStreamTest {
+protected:
+    void test(bool detach);
+};
+
+void SharedBackfillScanTest::test(bool detach) {
+    stream.reset();
+
+    const int numItems = 10;
+    for (int i = 0; i < numItems; i++) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(i)), "value");
+    }
+    auto vb = engine->getVBucket(vbid);
+    auto& ckptMgr = *vb->checkpointManager;
+    ckptMgr.createNewCheckpoint();
+    flushVBucketToDiskIfPersistent(vbid, numItems);
+    bool newCKptCreated;
+    ASSERT_EQ(numItems,
+              ckptMgr.removeClosedUnrefCheckpoints(*vb, newCKptCreated));
+
+    auto& config = engine->getConfiguration();
+    config.setDcpBackfillSharedScans(true);
+    if (detach) {
+        // A subscriber can only queue a single item
+        config.setDcpScanItemLimit(1);
+    }
+    auto& shared = engine->getDcpConnMap().getSharedBackfills();
+
+    // The first backfill reads a few items per run
+    setupProducer();
+    producer->public_getBackfillScanBuffer().maxItems = 3;
+    ASSERT_TRUE(stream->isBackfilling());
+    auto& bfm = producer->getBFM();
+    ASSERT_EQ(backfill_success, bfm.backfill()); // create
+    ASSERT_EQ(backfill_success, bfm.backfill()); // scan 3 items
+    EXPECT_EQ(1, shared.scans);
+
+    auto* cookie2 = create_mock_cookie();
+    auto producer2 = std::make_shared<MockDcpProducer>(
+            *engine, cookie2, "test_producer2", 0, false /*startTask*/);
+    auto stream2 = std::make_shared<MockActiveStream>(
+            engine.get(), producer2, 0, 0 /*opaque*/, *vb);
+    stream2->setActive();
+    ASSERT_TRUE(stream2->isBackfilling());
+    auto& bfm2 = producer2->getBFM();
+    ASSERT_EQ(backfill_success, bfm2.backfill()); // create (subscribe)
+    EXPECT_EQ(1, shared.subscriptions);
+
+    for (int i = 0; i < 100 &&
+                    (stream->isBackfilling() || stream2->isBackfilling());
+         i++) {
+        bfm.backfill();
+        if (!detach || i % 4 == 0) {
+            bfm2.backfill();
+        }
+    }
+    ASSERT_FALSE(stream->isBackfilling());
+    ASSERT_FALSE(stream2->isBackfilling());
+
+    for (auto* s : {stream.get(), stream2.get()}) {
+        ASSERT_EQ(numItems + 1, s->public_readyQSize());
+        auto resp = s->public_popFromReadyQ();
+        EXPECT_EQ(DcpResponse::Event::SnapshotMarker, resp->getEvent());
+        for (int seqno = 1; seqno <= numItems; seqno++) {
+            resp = s->public_popFromReadyQ();
+            ASSERT_EQ(DcpResponse::Event::Mutation, resp->getEvent());
+            EXPECT_EQ(seqno, *resp->getBySeqno());
+        }
+    }
+
+    if (detach) {
+        EXPECT_EQ(1, shared.detached);
+    } else {
+        // The first 3 items were read by the second backfill itself
+        EXPECT_EQ(0, shared.detached);
+        EXPECT_EQ(numItems - 3, shared.itemsShared);
+    }
+
+    stream2.reset();
+    producer2.reset();
+    destroy_mock_cookie(cookie2);
+}
+
+TEST_P(SharedBackfillScanTest, Subscribe) {
+    test(false);
+}
+
+TEST_P(SharedBackfillScanTest, SubscriberDetached) {
+    test(true);
+}
+
+// With dcp_backfill_snapshot_chunk_items a disk backfill is sent as a series
+// of snapshots, each ending at the last item it carries.
+TEST_P(SingleThreadedActiveStreamTest, BackfillSnapshotChunks) {
+    stream.reset();
+
+    const int numItems = 5;
+    for (int i = 0; i < numItems; i++) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(i)), "value");
+    }
+    auto vb = engine->getVBucket(vbid);
+    auto& ckptMgr = *vb->checkpointManager;
+    ckptMgr.createNewCheckpoint();
+    flushVBucketToDiskIfPersistent(vbid, numItems);
+    bool newCKptCreated;
+    ASSERT_EQ(numItems,
+              ckptMgr.removeClosedUnrefCheckpoints(*vb, newCKptCreated));
+
+    engine->getConfiguration().setDcpBackfillSnapshotChunkItems(2);
+    setupProducer();
+    ASSERT_TRUE(stream->isBackfilling());
+    auto& bfm = producer->getBFM();
+    for (int i = 0; i < 10 && stream->isBackfilling(); i++) {
+        bfm.backfill();
+    }
+    ASSERT_FALSE(stream->isBackfilling());
+
+    // {1,2}, {3,4} and the remainder {5}
+    const std::vector<std::pair<uint64_t, uint64_t>> chunks{
+            {1, 2}, {3, 4}, {5, 5}};
+    ASSERT_EQ(chunks.size() + numItems, stream->public_readyQSize());
+    for (const auto& [start, end] : chunks) {
+        auto resp = stream->public_popFromReadyQ();
+        ASSERT_EQ(DcpResponse::Event::SnapshotMarker, resp->getEvent());
+        const auto& marker = dynamic_cast<SnapshotMarker&>(*resp);
+        EXPECT_EQ(MARKER_FLAG_DISK | MARKER_FLAG_CHK, marker.getFlags());
+        EXPECT_EQ(start == 1 ? 0 : start, marker.getStartSeqno());
+        EXPECT_EQ(end, marker.getEndSeqno());
+        for (auto seqno = start; seqno <= end; seqno++) {
+            resp = stream->public_popFromReadyQ();
+            ASSERT_EQ(DcpResponse::Event::Mutation, resp->getEvent());
+            EXPECT_EQ(seqno, *resp->getBySeqno());
+        }
+    }
+}
+
+// An in-memory stream whose readyQ exceeds dcp_stream_ready_queue_max_bytes
+// stops reading from the checkpoint, dropping its cursor, and backfills the
+// items it didn't read once the readyQ has been drained.
+TEST_P(SingleThreadedActiveStreamTest, ReadyQueueMaxBytesSpillsToBackfill) {
+    stream.reset();
+    engine->getConfiguration().setDcpStreamReadyQueueMaxBytes(1);
+    setupProducer();
+    ASSERT_TRUE(stream->isInMemory());
+
+    store_item(vbid, makeStoredDocKey("key1"), "value");
+    store_item(vbid, makeStoredDocKey("key2"), "value");
+    flushVBucketToDiskIfPersistent(vbid, 2);
+
+    // The readyQ is empty so the items are read from the checkpoint
+    stream->nextCheckpointItemTask();
+    ASSERT_EQ(3, stream->public_readyQSize());
+    ASSERT_TRUE(stream->getCursor().lock());
+
+    store_item(vbid, makeStoredDocKey("key3"), "value");
+    flushVBucketToDiskIfPersistent(vbid, 1);
+
+    // Now above the limit: the cursor is dropped, nothing more is read
+    stream->nextCheckpointItemTask();
+    EXPECT_EQ(3, stream->public_readyQSize());
+    EXPECT_FALSE(stream->getCursor().lock());
+    EXPECT_TRUE(stream->isInMemory());
+
+    // Drain the readyQ, the stream then switches to backfilling
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(stream->next());
+    }
+    EXPECT_FALSE(stream->next());
+    ASSERT_TRUE(stream->isBackfilling());
+
+    auto& bfm = producer->getBFM();
+    for (int i = 0; i < 10 && stream->isBackfilling(); i++) {
+        bfm.backfill();
+    }
+    EXPECT_TRUE(stream->getCursor().lock());
+
+    auto resp = stream->public_popFromReadyQ();
+    ASSERT_TRUE(resp);
+    ASSERT_EQ(DcpResponse::Event::SnapshotMarker, resp->getEvent());
+    EXPECT_EQ(3, dynamic_cast<SnapshotMarker&>(*resp).getStartSeqno());
+    resp = stream->public_popFromReadyQ();
+    ASSERT_TRUE(resp);
+    ASSERT_EQ(DcpResponse::Event::Mutation, resp->getEvent());
+    EXPECT_EQ(3, *resp->getBySeqno());
+}
+
 /**
  * Unit test for MB-36146 to ensure that CheckpointCursor do not try to
  * use the currentCheckpoint member variable if its not point to a valid
@@ -3690,6 +3945,12 @@ INSTANTIATE_TEST_SUITE_P(AllBucketTypes,
                          STParameterizedBucketTest::allConfigValues(),
                          STParameterizedBucketTest::PrintToStringParamName);
 
+INSTANTIATE_TEST_SUITE_P(
+        AllBucketTypes,
+        SharedBackfillScanTest,
+        STParameterizedBucketTest::persistentAllBackendsConfigValues(),
+        STParameterizedBucketTest::PrintToStringParamName);
+
 INSTANTIATE_TEST_SUITE_P(
         AllBucketTypes,
         SingleThreadedPassiveStreamTest,
@@ -161,6 +161,10 @@ public:
     in_port_t get_connected_port(gsl::not_null<const void*> cookie) override {
         return wrapped->get_connected_port(cookie);
     }
+    std::optional<std::chrono::steady_clock::time_point> get_deadline(
+            gsl::not_null<const void*> cookie) override {
+        return wrapped->get_deadline(cookie);
+    }
     void set_error_context(gsl::not_null<void*> cookie,
                            std::string_view message) override {
         wrapped->set_error_context(cookie, message);
@@ -1992,6 +1996,48 @@ TEST_P(ConnectionTest, test_not_using_backfill_queue) {
     destroy_mock_cookie(cookie);
 }
 
+// The consumer records the time taken to process each mutation received
+TEST_P(ConnectionTest, ConsumerMutationProcessingTime) {
+    ASSERT_EQ(ENGINE_SUCCESS, set_vb_state(vbid, vbucket_state_replica));
+
+    const void* cookie = create_mock_cookie(engine);
+    auto consumer =
+            std::make_shared<MockDcpConsumer>(*engine, cookie, "test_consumer");
+    ASSERT_EQ(ENGINE_SUCCESS,
+              consumer->addStream(/*opaque*/ 0, vbid, /*flags*/ 0));
+    consumer->snapshotMarker(/*opaque*/ 1,
+                             vbid,
+                             /*start_seqno*/ 0,
+                             /*end_seqno*/ 2,
+                             /*flags*/ 0x1,
+                             /*HCS*/ {},
+                             /*maxVisibleSeqno*/ {});
+    EXPECT_EQ(0, consumer->getMutationProcessingHisto().getValueCount());
+
+    const DocKey docKey{nullptr, 0, DocKeyEncodesCollectionId::No};
+    for (uint64_t seqno = 1; seqno <= 2; ++seqno) {
+        EXPECT_EQ(ENGINE_SUCCESS,
+                  consumer->mutation(/*opaque*/ 1,
+                                     docKey,
+                                     {}, // value
+                                     0, // priv bytes
+                                     PROTOCOL_BINARY_RAW_BYTES,
+                                     0, // cas
+                                     vbid,
+                                     0, // flags
+                                     seqno,
+                                     0, // rev seqno
+                                     0, // exptime
+                                     0, // locktime
+                                     {}, // meta
+                                     0)); // nru
+    }
+    EXPECT_EQ(2, consumer->getMutationProcessingHisto().getValueCount());
+
+    ASSERT_EQ(ENGINE_SUCCESS, consumer->closeStream(/*opaque*/ 0, vbid));
+    destroy_mock_cookie(cookie);
+}
+
 /*
  * The following test has been adapted following the removal of vbucket DCP
  * backfill queue. It now demonstrates some of the 'new' behaviour of
@@ -3521,6 +3567,97 @@ TEST_F(SingleThreadedKVBucketTest, ProducerIdleTimeoutUpdatedOnConfigChange) {
     connMap.removeConn(cookie);
 }
 
+/*
+ * Test that with an adaptive buffer the producer's window grows towards the
+ * consumer's buffer size when acks take a long round trip, and shrinks back
+ * to the minimum when a small amount in flight is acked quickly.
+ */
+TEST_F(SingleThreadedKVBucketTest, ProducerAdaptiveBufferLog) {
+    auto producer = std::make_shared<MockDcpProducer>(*engine,
+                                                      cookie,
+                                                      "test_producer",
+                                                      /*flags*/ 0);
+    const size_t maxBytes = 50 * 1024 * 1024;
+    const size_t minBytes = 10 * 1024 * 1024;
+    ASSERT_EQ(ENGINE_SUCCESS,
+              producer->control(0,
+                                "connection_buffer_size",
+                                std::to_string(maxBytes)));
+    EXPECT_EQ(maxBytes, producer->getFlowControlWindow());
+
+    ASSERT_EQ(ENGINE_SUCCESS,
+              producer->control(0,
+                                "connection_buffer_size_min",
+                                std::to_string(minBytes)));
+    EXPECT_EQ(minBytes, producer->getFlowControlWindow());
+
+    const size_t chunk = 1024 * 1024;
+    auto now = DcpProducer::BufferLog::Clock::now();
+
+    // High-latency link: fill the window, ack it all 100ms later. The window
+    // is the bottleneck so it grows each round trip (by at most 2x) until it
+    // reaches the consumer's buffer size.
+    for (int round = 0; round < 8; ++round) {
+        const auto window = producer->getFlowControlWindow();
+        while (producer->insertBytes(chunk, now)) {
+        }
+        EXPECT_GE(producer->getBytesOutstanding(), window);
+        now += std::chrono::milliseconds(100);
+        producer->ackBytes(producer->getBytesOutstanding(), now);
+        if (window < maxBytes) {
+            EXPECT_GT(producer->getFlowControlWindow(), window);
+        }
+        EXPECT_LE(producer->getFlowControlWindow(),
+                  std::min(window * 2, maxBytes));
+    }
+    EXPECT_EQ(maxBytes, producer->getFlowControlWindow());
+
+    // Nearby consumer: a single chunk acked 1ms later. The bandwidth-delay
+    // product is ~1 chunk, so the window halves each round trip down to the
+    // minimum.
+    for (int round = 0; round < 4; ++round) {
+        ASSERT_TRUE(producer->insertBytes(chunk, now));
+        now += std::chrono::milliseconds(1);
+        producer->ackBytes(chunk, now);
+    }
+    EXPECT_EQ(minBytes, producer->getFlowControlWindow());
+
+    // A minimum of zero restores the fixed size window.
+    ASSERT_EQ(ENGINE_SUCCESS,
+              producer->control(0, "connection_buffer_size_min", "0"));
+    EXPECT_EQ(maxBytes, producer->getFlowControlWindow());
+}
+
+void AdaptiveFlowControlTest::SetUp() {
+    config_string = "dcp_flow_control_policy=adaptive";
+    KVBucketTest::SetUp();
+}
+
+// The consumer sends the minimum buffer size after the buffer size, and acks
+// relative to the minimum.
+TEST_F(AdaptiveFlowControlTest, ConsumerSendsMinBufferSize) {
+    auto consumer = std::make_shared<MockDcpConsumer>(
+            *engine, cookie, "test_consumer");
+    auto& flowControl = consumer->public_flowControl();
+    ASSERT_TRUE(flowControl.isEnabled());
+
+    MockDcpMessageProducers producers(engine);
+    EXPECT_EQ(ENGINE_SUCCESS, flowControl.handleFlowCtl(&producers));
+    EXPECT_EQ(cb::mcbp::ClientOpcode::DcpControl, producers.last_op);
+    EXPECT_EQ("connection_buffer_size", producers.last_key);
+    EXPECT_EQ(std::to_string(flowControl.getFlowControlBufSize()),
+              producers.last_value);
+
+    const auto minBytes = engine->getConfiguration().getDcpConnBufferSize();
+    EXPECT_EQ(ENGINE_SUCCESS, flowControl.handleFlowCtl(&producers));
+    EXPECT_EQ(cb::mcbp::ClientOpcode::DcpControl, producers.last_op);
+    EXPECT_EQ("connection_buffer_size_min", producers.last_key);
+    EXPECT_EQ(std::to_string(minBytes), producers.last_value);
+
+    flowControl.incrFreedBytes(minBytes * 0.2 + 1);
+    EXPECT_TRUE(flowControl.isBufferSufficientlyDrained());
+}
+
 void FlowControlTest::SetUp() {
     flowControlEnabled = GetParam();
     const std::string policy = flowControlEnabled ? "aggressive" : "none";
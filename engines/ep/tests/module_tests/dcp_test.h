@@ -126,4 +126,9 @@ protected:
     void SetUp() override;
 
     bool flowControlEnabled;
+};
+
+class AdaptiveFlowControlTest : public KVBucketTest {
+protected:
+    void SetUp() override;
 };
\ No newline at end of file
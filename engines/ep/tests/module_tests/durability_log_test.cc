@@ -0,0 +1,192 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "durability/durability_log.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <folly/FileUtil.h>
+#include <folly/portability/GTest.h>
+#include <platform/dirutils.h>
+
+class DurabilityLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = dbnameFromCurrentGTestInfo();
+        cb::io::rmrf(dir);
+        log = std::make_unique<DurabilityLog>(dir);
+    }
+
+    void TearDown() override {
+        log.reset();
+        cb::io::rmrf(dir);
+    }
+
+    /// @return a batch made of a prepare, a commit, an abort and a deletion
+    std::vector<queued_item> makeBatch(int64_t seqno) {
+        std::vector<queued_item> items;
+
+        auto prepare = makePendingItem(
+                makeStoredDocKey("prepare"),
+                "value",
+                {cb::durability::Level::PersistToMajority,
+                 cb::durability::Timeout()});
+        prepare->setBySeqno(seqno++);
+        prepare->setPreparedMaybeVisible();
+        items.push_back(prepare);
+
+        auto commit = makeCommittedviaPrepareItem(makeStoredDocKey("commit"),
+                                                  "committed");
+        commit->setBySeqno(seqno++);
+        commit->setPrepareSeqno(1);
+        items.push_back(commit);
+
+        queued_item abort(new Item(makeStoredDocKey("abort"),
+                                   vbid,
+                                   queue_op::abort_sync_write,
+                                   0,
+                                   seqno++));
+        abort->setPrepareSeqno(2);
+        abort->setDeleted();
+        items.push_back(abort);
+
+        auto deleted = makeCommittedItem(makeStoredDocKey("deleted"), {});
+        deleted->setBySeqno(seqno++);
+        deleted->setDeleted(DeleteSource::TTL);
+        items.push_back(deleted);
+
+        return items;
+    }
+
+    void expectEqual(const std::vector<queued_item>& expected,
+                     const std::vector<queued_item>& actual) {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t ii = 0; ii < expected.size(); ++ii) {
+            const auto& e = *expected[ii];
+            const auto& a = *actual[ii];
+            EXPECT_EQ(e.getKey(), a.getKey());
+            EXPECT_EQ(e.getOperation(), a.getOperation());
+            EXPECT_EQ(e.getBySeqno(), a.getBySeqno());
+            EXPECT_EQ(e.getRevSeqno(), a.getRevSeqno());
+            EXPECT_EQ(e.getCas(), a.getCas());
+            EXPECT_EQ(e.getFlags(), a.getFlags());
+            EXPECT_EQ(e.getExptime(), a.getExptime());
+            EXPECT_EQ(e.getDataType(), a.getDataType());
+            EXPECT_EQ(e.isDeleted(), a.isDeleted());
+            EXPECT_EQ(e.getCommitted(), a.getCommitted());
+            EXPECT_EQ(std::string_view(e.getData(), e.getNBytes()),
+                      std::string_view(a.getData(), a.getNBytes()));
+            if (e.isDeleted()) {
+                EXPECT_EQ(e.deletionSource(), a.deletionSource());
+            }
+            if (e.isPending()) {
+                EXPECT_EQ(e.getDurabilityReqs().getLevel(),
+                          a.getDurabilityReqs().getLevel());
+            }
+            if (e.isCommitSyncWrite() || e.isAbort()) {
+                EXPECT_EQ(e.getPrepareSeqno(), a.getPrepareSeqno());
+            }
+        }
+    }
+
+    const Vbid vbid = Vbid(0);
+    std::string dir;
+    std::unique_ptr<DurabilityLog> log;
+};
+
+TEST_F(DurabilityLogTest, SerialiseRoundTrip) {
+    vbucket_state vbstate;
+    vbstate.highSeqno = 14;
+    vbstate.maxCas = 1234;
+    const auto items = makeBatch(11);
+
+    auto batch = DurabilityLog::deserialise(
+            DurabilityLog::serialise(10, vbstate, items));
+    EXPECT_EQ(10, batch.baseSeqno);
+    EXPECT_EQ(vbstate, batch.vbstate);
+    expectEqual(items, batch.items);
+}
+
+TEST_F(DurabilityLogTest, DeserialiseRejectsBadData) {
+    vbucket_state vbstate;
+    const auto data = DurabilityLog::serialise(0, vbstate, makeBatch(1));
+
+    EXPECT_THROW(DurabilityLog::deserialise({}), std::invalid_argument);
+    EXPECT_THROW(DurabilityLog::deserialise("not a durability log record"),
+                 std::invalid_argument);
+    EXPECT_THROW(DurabilityLog::deserialise(
+                         std::string_view(data).substr(0, data.size() - 1)),
+                 std::invalid_argument);
+    EXPECT_THROW(DurabilityLog::deserialise(data + "x"),
+                 std::invalid_argument);
+}
+
+TEST_F(DurabilityLogTest, ReadReturnsLastBatch) {
+    EXPECT_FALSE(log->read(vbid));
+
+    vbucket_state vbstate;
+    vbstate.highSeqno = 4;
+    ASSERT_TRUE(log->write(vbid, 0, vbstate, makeBatch(1)));
+    vbstate.highSeqno = 8;
+    const auto items = makeBatch(5);
+    ASSERT_TRUE(log->write(vbid, 4, vbstate, items));
+
+    auto batch = log->read(vbid);
+    ASSERT_TRUE(batch);
+    EXPECT_EQ(4, batch->baseSeqno);
+    EXPECT_EQ(vbstate, batch->vbstate);
+    expectEqual(items, batch->items);
+    for (const auto& item : batch->items) {
+        EXPECT_EQ(vbid, item->getVBucketId());
+    }
+
+    // Other vBuckets have their own log
+    EXPECT_FALSE(log->read(Vbid(1)));
+}
+
+// A record torn by a crash part way through the write is ignored, the
+// previous (complete) record is returned
+TEST_F(DurabilityLogTest, TornRecordIgnored) {
+    vbucket_state vbstate;
+    vbstate.highSeqno = 4;
+    ASSERT_TRUE(log->write(vbid, 0, vbstate, makeBatch(1)));
+
+    std::string data;
+    ASSERT_TRUE(folly::readFile(log->getFileName(vbid).c_str(), data));
+    const auto size = data.size();
+    vbstate.highSeqno = 8;
+    ASSERT_TRUE(log->write(vbid, 4, vbstate, makeBatch(5)));
+    ASSERT_TRUE(folly::readFile(log->getFileName(vbid).c_str(), data));
+    data.resize(size + (data.size() - size) / 2);
+    ASSERT_TRUE(folly::writeFile(data, log->getFileName(vbid).c_str()));
+
+    auto batch = log->read(vbid);
+    ASSERT_TRUE(batch);
+    EXPECT_EQ(0, batch->baseSeqno);
+    EXPECT_EQ(4, batch->vbstate.highSeqno);
+}
+
+TEST_F(DurabilityLogTest, Remove) {
+    vbucket_state vbstate;
+    ASSERT_TRUE(log->write(vbid, 0, vbstate, makeBatch(1)));
+    log->remove(vbid);
+    EXPECT_FALSE(cb::io::isFile(log->getFileName(vbid)));
+    EXPECT_FALSE(log->read(vbid));
+
+    // The log can be written again after removal
+    ASSERT_TRUE(log->write(vbid, 0, vbstate, makeBatch(1)));
+    EXPECT_TRUE(log->read(vbid));
+}
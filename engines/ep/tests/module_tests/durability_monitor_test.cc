@@ -3253,6 +3253,29 @@ TEST_P(ActiveDurabilityMonitorTest, MaintainSyncWriteAckCount) {
     }
 }
 
+TEST_P(ActiveDurabilityMonitorTest, AckDurationsRecorded) {
+    auto& stats = engine->getEpStats();
+    auto& localAcks = stats.syncWriteLocalAckTimes;
+    auto& remoteAcks = stats.syncWriteRemoteAckTimes;
+    localAcks.reset();
+    remoteAcks.reset();
+
+    addSyncWrite(1);
+    EXPECT_EQ(1, localAcks.getValueCount());
+    EXPECT_EQ(0, remoteAcks.getValueCount());
+
+    testSeqnoAckReceived(replica1,
+                         1 /*ackSeqno*/,
+                         1 /*expectedLastWriteSeqno*/,
+                         1 /*expectedLastAckSeqno*/,
+                         0 /*expectedNumTracked*/,
+                         1 /*expectedHPS*/,
+                         1 /*expectedHCS*/);
+    EXPECT_EQ(1, localAcks.getValueCount());
+    EXPECT_EQ(1, remoteAcks.getValueCount());
+    EXPECT_EQ(1, stats.syncWriteCommitTimes.at(0).getValueCount());
+}
+
 TEST_P(ActiveDurabilityMonitorTest, MaintainSyncWriteAckCount_SecondChain) {
     // Add the secondChain with the new node
     getActiveDM().setReplicationTopology(
@@ -3514,6 +3537,48 @@ TEST_P(PassiveDurabilityMonitorTest, SendSeqnoAckRace) {
     EXPECT_EQ(2, ackedSeqno);
 }
 
+TEST_P(PassiveDurabilityMonitorTest, EarlyAckMajorityPrepareOnReceive) {
+    auto& pdm = getPassiveDM();
+    std::vector<int64_t> acks;
+    VBucketTestIntrospector::setSeqnoAckCb(
+            *vb, [&acks](Vbid vbid, uint64_t hps) {
+                acks.push_back(static_cast<int64_t>(hps));
+            });
+
+    // Majority Prepares are acked as soon as they are received
+    using namespace cb::durability;
+    pdm.notifyPrepareReceived(1, Level::Majority);
+    pdm.notifyPrepareReceived(2, Level::Majority);
+    EXPECT_EQ(std::vector<int64_t>({1, 2}), acks);
+    EXPECT_EQ(2, pdm.getHighReceivedSeqno());
+
+    // A PersistToMajority Prepare fences any further early ack until the
+    // HPS has moved past it
+    pdm.notifyPrepareReceived(3, Level::PersistToMajority);
+    pdm.notifyPrepareReceived(4, Level::Majority);
+    EXPECT_EQ(std::vector<int64_t>({1, 2}), acks);
+    EXPECT_EQ(2, pdm.getHighReceivedSeqno());
+
+    // Processing the snapshot doesn't ack backwards, only persistence of
+    // the fence moves the ack on
+    addSyncWrite(1, Requirements{Level::Majority, Timeout::Infinity()});
+    addSyncWrite(2, Requirements{Level::Majority, Timeout::Infinity()});
+    addSyncWrite(3,
+                 Requirements{Level::PersistToMajority, Timeout::Infinity()});
+    addSyncWrite(4, Requirements{Level::Majority, Timeout::Infinity()});
+    pdm.notifySnapshotEndReceived(4);
+    EXPECT_EQ(std::vector<int64_t>({1, 2}), acks);
+
+    vb->setPersistenceSeqno(4);
+    pdm.notifyLocalPersistence();
+    EXPECT_EQ(std::vector<int64_t>({1, 2, 4}), acks);
+
+    // The fence has been satisfied, Majority Prepares are early-acked again
+    pdm.notifyPrepareReceived(5, Level::Majority);
+    EXPECT_EQ(std::vector<int64_t>({1, 2, 4, 5}), acks);
+    EXPECT_EQ(5, pdm.getHighReceivedSeqno());
+}
+
 TEST_P(PassiveDurabilityMonitorTest, dropKey) {
     auto& pdm = getPassiveDM();
 
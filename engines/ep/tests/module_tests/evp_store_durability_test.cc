@@ -1043,6 +1043,62 @@ TEST_P(DurabilityBucketTest, SyncWriteDelete) {
     ASSERT_EQ(1, ckptList.back()->getNumItems());
 }
 
+// With event-driven timeouts the ActiveDM reports the expiry-time of the
+// first tracked SyncWrite (the only one which can time out next) whenever it
+// changes, and again after every processDurabilityTimeout().
+TEST_P(DurabilityBucketTest, SyncWriteNextExpiryNotified) {
+    using namespace cb::durability;
+
+    setVBucketStateAndRunPersistTask(
+            vbid,
+            vbucket_state_active,
+            {{"topology", nlohmann::json::array({{"active", "replica"}})}});
+    auto& vb = *store->getVBucket(vbid);
+
+    std::vector<std::chrono::steady_clock::time_point> notified;
+    vb.setSyncWriteExpiryCallback(
+            [&notified](Vbid, std::chrono::steady_clock::time_point expiry) {
+                notified.push_back(expiry);
+            });
+
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(ENGINE_SYNC_WRITE_PENDING,
+              store->set(*makePendingItem(makeStoredDocKey("key1"),
+                                          "value",
+                                          {Level::Majority, Timeout(10000)}),
+                         cookie));
+    ASSERT_EQ(1, notified.size());
+    EXPECT_GE(notified.back(), start + std::chrono::milliseconds(10000));
+
+    // Not the first tracked SyncWrite, the next expiry is unchanged
+    ASSERT_EQ(ENGINE_SYNC_WRITE_PENDING,
+              store->set(*makePendingItem(makeStoredDocKey("key2"),
+                                          "value",
+                                          {Level::Majority, Timeout(20000)}),
+                         cookie));
+    EXPECT_EQ(1, notified.size());
+
+    // Nothing expired yet; still re-notified as the caller consumed the
+    // previous deadline
+    vb.processDurabilityTimeout(start);
+    ASSERT_EQ(2, notified.size());
+    EXPECT_EQ(notified.front(), notified.back());
+
+    // key1 times out, key2 is next
+    vb.processDurabilityTimeout(notified.front() +
+                                std::chrono::milliseconds(1));
+    ASSERT_EQ(3, notified.size());
+    EXPECT_GE(notified.back(), start + std::chrono::milliseconds(20000));
+    EXPECT_EQ(1, vb.getDurabilityMonitor().getNumTracked());
+
+    // Nothing left to time out
+    vb.processDurabilityTimeout(notified.back() +
+                                std::chrono::milliseconds(1));
+    EXPECT_EQ(3, notified.size());
+    EXPECT_EQ(0, vb.getDurabilityMonitor().getNumTracked());
+    vb.processResolvedSyncWrites();
+}
+
 TEST_P(DurabilityBucketTest, SyncWriteComparesToCorrectCas) {
     setVBucketStateAndRunPersistTask(
             vbid,
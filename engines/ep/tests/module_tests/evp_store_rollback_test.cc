@@ -592,6 +592,34 @@ TEST_P(RollbackTest, RollbackAfterMutationNoFlush) {
     rollback_after_mutation_test(/*flush_before_rollback*/false);
 }
 
+// An unpersisted key updated in several checkpoints is reverted to its
+// state on disk, and the phases of the rollback are timed
+TEST_P(RollbackTest, RollbackUnpersistedKeyUpdatedInManyCheckpoints) {
+    StoredDocKey a = makeStoredDocKey("a");
+    auto item_v1 = store_item(vbid, a, "old");
+    ASSERT_EQ(FlushResult(MoreAvailable::No, 1, WakeCkptRemover::No),
+              getEPBucket().flushVBucket(vbid));
+
+    auto vb = store->getVBucket(vbid);
+    for (int ii = 0; ii < 3; ++ii) {
+        vb->checkpointManager->createNewCheckpoint();
+        store_item(vbid, a, "new" + std::to_string(ii));
+    }
+
+    store->setVBucketState(vbid, vbStateAtRollback);
+    ASSERT_EQ(TaskStatus::Complete,
+              store->rollback(vbid, item_v1.getBySeqno()));
+
+    auto result = store->get(a, vbid, nullptr, {});
+    ASSERT_EQ(ENGINE_SUCCESS, result.getStatus());
+    EXPECT_EQ(item_v1, *result.item);
+
+    const auto& stats = engine->getEpStats();
+    EXPECT_EQ(1, stats.rollbackDiskHisto.getValueCount());
+    EXPECT_EQ(1, stats.rollbackUnpersistedHisto.getValueCount());
+    EXPECT_EQ(1, stats.rollbackPreparesHisto.getValueCount());
+}
+
 TEST_P(RollbackTest, RollbackAfterDeletion) {
     rollback_after_deletion_test(/*flush_before_rollback*/ true);
 }
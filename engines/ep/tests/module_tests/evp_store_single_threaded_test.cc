@@ -47,7 +47,6 @@
 #include "evp_store_test.h"
 #include "failover-table.h"
 #include "fakes/fake_executorpool.h"
-#include "item_freq_decayer_visitor.h"
 #include "kv_bucket.h"
 #ifdef EP_USE_MAGMA
 #include "../mock/mock_magma_kvstore.h"
@@ -2156,6 +2155,147 @@ TEST_F(SingleThreadedEPBucketTest, MB18452_yield_dcp_processor) {
     consumer->closeStream(/*opaque*/0, vbid);
 }
 
+/*
+ * Test that with dcp_consumer_process_buffered_messages_parallelism > 1 the
+ * consumer's vBuckets are partitioned between processor lanes, and each lane
+ * only processes the buffered messages of its own vBuckets.
+ */
+TEST_F(SingleThreadedEPBucketTest, ParallelProcessBufferedItems) {
+    engine->getConfiguration().setDcpConsumerProcessBufferedMessagesParallelism(
+            2);
+
+    const Vbid vbids[] = {Vbid(0), Vbid(1)};
+    for (auto vb : vbids) {
+        setVBucketStateAndRunPersistTask(vb, vbucket_state_replica);
+    }
+
+    auto consumer = std::make_shared<MockDcpConsumer>(*engine, cookie, "test");
+    EXPECT_EQ(2, consumer->getNumProcessorLanes());
+
+    // Force the streams to buffer rather than process messages immediately
+    const ssize_t queueCap =
+            engine->getEpStats().replicationThrottleWriteQueueCap;
+    engine->getEpStats().replicationThrottleWriteQueueCap = 0;
+
+    const int messages = 3;
+    uint32_t opaque = 0;
+    for (auto vb : vbids) {
+        EXPECT_EQ(ENGINE_SUCCESS,
+                  consumer->addStream(/*opaque*/ 0, vb, /*flags*/ 0));
+        ++opaque;
+        consumer->snapshotMarker(opaque,
+                                 vb,
+                                 /*startseq*/ 1,
+                                 /*endseq*/ messages,
+                                 /*flags*/ 0,
+                                 /*HCS*/ {},
+                                 /*maxVisibleSeqno*/ {});
+        for (int ii = 1; ii <= messages; ii++) {
+            const std::string key = "key" + std::to_string(ii);
+            const DocKey docKey{key, DocKeyEncodesCollectionId::No};
+            std::string value = "value";
+            consumer->mutation(opaque,
+                               docKey,
+                               {(const uint8_t*)value.c_str(), value.length()},
+                               0, // privileged bytes
+                               PROTOCOL_BINARY_RAW_BYTES, // datatype
+                               0, // cas
+                               vb, // vbucket
+                               0, // flags
+                               ii, // bySeqno
+                               0, // revSeqno
+                               0, // exptime
+                               0, // locktime
+                               {}, // meta
+                               0); // nru
+        }
+    }
+    engine->getEpStats().replicationThrottleWriteQueueCap = queueCap;
+
+    auto stream0 = std::dynamic_pointer_cast<MockPassiveStream>(
+            consumer->getVbucketStream(vbids[0]));
+    auto stream1 = std::dynamic_pointer_cast<MockPassiveStream>(
+            consumer->getVbucketStream(vbids[1]));
+    ASSERT_TRUE(stream0);
+    ASSERT_TRUE(stream1);
+    EXPECT_EQ(messages + 1, stream0->getNumBufferItems());
+    EXPECT_EQ(messages + 1, stream1->getNumBufferItems());
+
+    for (auto vb : vbids) {
+        consumer->public_notifyVbucketReady(vb);
+    }
+
+    // vb:1 belongs to lane 1; draining it must leave vb:0 untouched.
+    EXPECT_EQ(more_to_process, consumer->processBufferedItems(1));
+    EXPECT_EQ(all_processed, consumer->processBufferedItems(1));
+    EXPECT_EQ(0, stream1->getNumBufferItems());
+    EXPECT_EQ(messages + 1, stream0->getNumBufferItems());
+    EXPECT_EQ(messages, store->getVBucket(vbids[1])->getHighSeqno());
+    EXPECT_EQ(0, store->getVBucket(vbids[0])->getHighSeqno());
+
+    EXPECT_EQ(more_to_process, consumer->processBufferedItems(0));
+    EXPECT_EQ(all_processed, consumer->processBufferedItems(0));
+    EXPECT_EQ(0, stream0->getNumBufferItems());
+    EXPECT_EQ(messages, store->getVBucket(vbids[0])->getHighSeqno());
+
+    for (auto vb : vbids) {
+        consumer->closeStream(/*opaque*/ 0, vb);
+    }
+}
+
+/*
+ * Test that with dcp_producer_checkpoint_processor_parallelism > 1 the
+ * producer's vBuckets are partitioned between checkpoint processor lanes, and
+ * each lane only processes the checkpoints of its own vBuckets.
+ */
+TEST_F(SingleThreadedEPBucketTest, ParallelCheckpointProcessors) {
+    engine->getConfiguration().setDcpProducerCheckpointProcessorParallelism(2);
+
+    auto producer = createDcpProducer(cookie, IncludeDeleteTime::No);
+    ASSERT_EQ(2, producer->getNumCheckpointProcessorLanes());
+
+    const Vbid vbids[] = {Vbid(0), Vbid(1)};
+    std::vector<std::shared_ptr<MockActiveStream>> streams;
+    for (auto vb : vbids) {
+        setVBucketStateAndRunPersistTask(vb, vbucket_state_active);
+        streams.push_back(
+                producer->mockActiveStreamRequest(/*flags*/ 0,
+                                                  /*opaque*/ 0,
+                                                  *store->getVBucket(vb),
+                                                  /*st_seqno*/ 0,
+                                                  /*en_seqno*/ ~0,
+                                                  /*vb_uuid*/ 0xabcd,
+                                                  /*snap_start_seqno*/ 0,
+                                                  /*snap_end_seqno*/ ~0));
+        store_item(vb, makeStoredDocKey("key"), "value");
+        flushVBucketToDiskIfPersistent(vb, 1);
+
+        // Advance the stream to in-memory, then schedule its checkpoint
+        // processor.
+        EXPECT_FALSE(streams.back()->next());
+        EXPECT_TRUE(streams.back()->isInMemory());
+        EXPECT_FALSE(streams.back()->next());
+    }
+
+    auto* lane0 = producer->getCheckpointSnapshotTask(0);
+    auto* lane1 = producer->getCheckpointSnapshotTask(1);
+    EXPECT_EQ(1, lane0->queueSize());
+    EXPECT_EQ(1, lane1->queueSize());
+
+    // vb:1 belongs to lane 1; running it must leave vb:0 untouched.
+    lane1->run();
+    EXPECT_EQ(0, lane1->queueSize());
+    EXPECT_EQ(1, lane0->queueSize());
+    EXPECT_NE(0, streams[1]->public_readyQSize());
+    EXPECT_EQ(0, streams[0]->public_readyQSize());
+
+    lane0->run();
+    EXPECT_EQ(0, lane0->queueSize());
+    EXPECT_NE(0, streams[0]->public_readyQSize());
+
+    producer->cancelCheckpointCreatorTask();
+}
+
 /**
  * MB-29861: Ensure that a delete time is generated for a document
  * that is received on the consumer side as a result of a disk
@@ -2909,12 +3049,13 @@ TEST_P(STParamPersistentBucketTest, mb25273) {
 TEST_F(SingleThreadedEPBucketTest, ItemFreqDecayerTaskTest) {
     setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
 
-    // ProgressTracker:INITIAL_VISIT_COUNT_CHECK = 100 and therefore
-    // add 110 documents to the hash table to ensure all documents cannot be
-    // visited in a single pass.
-    for (uint32_t ii = 1; ii < 110; ii++) {
-        auto key = makeStoredDocKey("DOC_" + std::to_string(ii));
-        store_item(vbid, key, "value");
+    auto key = makeStoredDocKey("key");
+    store_item(vbid, key, "value");
+    auto vb = store->getVBucket(vbid);
+    {
+        auto item = vb->ht.findForWrite(key);
+        ASSERT_TRUE(item.storedValue);
+        item.storedValue->setFreqCounterValue(200);
     }
 
     auto& lpNonioQ = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
@@ -2926,12 +3067,15 @@ TEST_F(SingleThreadedEPBucketTest, ItemFreqDecayerTaskTest) {
     EXPECT_EQ(1, lpNonioQ.getFutureQueueSize());
     itemFreqDecayerTask->wakeup();
 
-    EXPECT_FALSE(itemFreqDecayerTask->isCompleted());
-    runNextTask(lpNonioQ, "Item frequency count decayer task");
-    EXPECT_FALSE(itemFreqDecayerTask->isCompleted());
+    // A single run decays all the vBuckets (without visiting the items)
     runNextTask(lpNonioQ, "Item frequency count decayer task");
-    // The item freq decayer task should have completed.
-    EXPECT_TRUE(itemFreqDecayerTask->isCompleted());
+    EXPECT_EQ(1, vb->ht.getFreqDecayEpoch());
+
+    auto item = vb->ht.findForWrite(key);
+    ASSERT_TRUE(item.storedValue);
+    EXPECT_EQ(200, item.storedValue->getFreqCounterValue());
+    EXPECT_EQ(100,
+              vb->ht.unlocked_applyFreqDecay(item.lock, *item.storedValue));
 }
 
 // Test to confirm that the ItemFreqDecayerTask gets created on kv_bucket
@@ -5218,6 +5362,30 @@ TEST_P(STParamPersistentBucketTest, AbortDoesNotIncrementOpsDelete) {
     testAbortDoesNotIncrementOpsDelete(true /*flusherDedup*/);
 }
 
+// A compaction of the whole vBucket rebuilds its bloom filter from the keys
+// it keeps, for every backend
+TEST_P(STParamPersistentBucketTest, CompactionRebuildsBloomFilter) {
+    if (!isBloomFilterEnabled()) {
+        return;
+    }
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+
+    auto key = makeStoredDocKey("key");
+    store_item(vbid, key, "value");
+    flush_vbucket_to_disk(vbid, 1);
+    delete_item(vbid, key);
+    flush_vbucket_to_disk(vbid, 1);
+
+    auto vb = store->getVBucket(vbid);
+    vb->clearFilter();
+    ASSERT_EQ("DOESN'T EXIST", vb->getFilterStatusString());
+
+    runCompaction();
+
+    EXPECT_EQ("ENABLED", vb->getFilterStatusString());
+    EXPECT_TRUE(vb->maybeKeyExistsInFilter(key));
+}
+
 TEST_P(STParamPersistentBucketTest,
        AbortDoesNotIncrementOpsDelete_FlusherDedup) {
     testAbortDoesNotIncrementOpsDelete(false /*flusherDedup*/);
@@ -591,6 +591,101 @@ TEST_P(EPBucketTest, checkIfResidentAfterBgFetch) {
     EXPECT_TRUE(result.storedValue->isResident());
 }
 
+// Prefetched keys are loaded by the next BgFetcher run without any cookie
+// being notified, and are then resident for the following get.
+TEST_P(EPBucketTest, PrefetchNonResident) {
+    const auto key1 = makeStoredDocKey("key1");
+    const auto key2 = makeStoredDocKey("key2");
+    store_item(vbid, key1, "value");
+    store_item(vbid, key2, "value");
+    flush_vbucket_to_disk(vbid, 2);
+    evict_key(vbid, key1);
+    evict_key(vbid, key2);
+
+    // Keys in vbuckets we don't have are ignored
+    EXPECT_EQ(0, store->prefetch({{Vbid(1), key1}}));
+
+    EXPECT_EQ(2, store->prefetch({{vbid, key1}, {vbid, key2}}));
+    EXPECT_EQ(2, engine->getEpStats().bg_prefetches);
+    EXPECT_TRUE(store->getVBucket(vbid)->hasPendingBGFetchItems());
+
+    runBGFetcherTask();
+
+    auto options = static_cast<get_options_t>(
+            QUEUE_BG_FETCH | HONOR_STATES | TRACK_REFERENCE | DELETE_TEMP |
+            HIDE_LOCKED_CAS | TRACK_STATISTICS);
+    for (const auto& key : {key1, key2}) {
+        auto gv = store->get(key, vbid, cookie, options);
+        EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus()) << key;
+    }
+
+    // Nothing to fetch for keys which are resident
+    EXPECT_EQ(0, store->prefetch({{vbid, key1}, {vbid, key2}}));
+}
+
+// A background fetch of a request whose deadline passed while it was queued
+// is dropped, and the request fails with a temporary failure.
+TEST_P(EPBucketTest, BgFetchPastDeadlineIsAborted) {
+    const auto key = makeStoredDocKey("key");
+    store_item(vbid, key, "value");
+    flush_vbucket_to_disk(vbid, 1);
+    evict_key(vbid, key);
+
+    auto* mockCookie = cookie_to_mock_cookie(cookie);
+    mockCookie->deadline =
+            std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    auto options = static_cast<get_options_t>(QUEUE_BG_FETCH | HONOR_STATES);
+    ASSERT_EQ(ENGINE_EWOULDBLOCK,
+              store->get(key, vbid, cookie, options).getStatus());
+
+    runBGFetcherTask();
+    EXPECT_EQ(ENGINE_TMPFAIL, mockCookie->status);
+    auto& stats = engine->getEpStats();
+    EXPECT_EQ(1, stats.bg_fetch_deadline_exceeded);
+    EXPECT_EQ(0, stats.bg_fetched);
+    EXPECT_EQ(0, stats.numRemainingBgItems);
+
+    // Without the deadline the key is fetched as usual
+    mockCookie->deadline.reset();
+    ASSERT_EQ(ENGINE_EWOULDBLOCK,
+              store->get(key, vbid, cookie, options).getStatus());
+    runBGFetcherTask();
+    EXPECT_EQ(ENGINE_SUCCESS, mockCookie->status);
+    EXPECT_EQ(1, stats.bg_fetched);
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->get(key, vbid, cookie, options).getStatus());
+}
+
+// Background fetches are batched and timed by priority; a key queued for
+// fetches of different priorities is fetched once, at the highest of them.
+TEST_P(EPBucketTest, BgFetchPriorityHistograms) {
+    const auto key1 = makeStoredDocKey("key1");
+    const auto key2 = makeStoredDocKey("key2");
+    store_item(vbid, key1, "value");
+    store_item(vbid, key2, "value");
+    flush_vbucket_to_disk(vbid, 2);
+    evict_key(vbid, key1);
+    evict_key(vbid, key2);
+
+    auto& histos = engine->getEpStats().bgFetchPriorityHisto;
+    auto count = [&histos](BgFetchPriority priority) {
+        return histos[static_cast<size_t>(priority)].getValueCount();
+    };
+
+    // key1 is only prefetched; key2 is prefetched and read by a client
+    ASSERT_EQ(2, store->prefetch({{vbid, key1}, {vbid, key2}}));
+    auto options = static_cast<get_options_t>(QUEUE_BG_FETCH | HONOR_STATES);
+    ASSERT_EQ(ENGINE_EWOULDBLOCK,
+              store->get(key2, vbid, cookie, options).getStatus());
+
+    runBGFetcherTask();
+    EXPECT_EQ(1, count(BgFetchPriority::Background));
+    EXPECT_EQ(2, count(BgFetchPriority::ClientRead));
+    EXPECT_EQ(0, count(BgFetchPriority::Durability));
+    EXPECT_EQ(0, count(BgFetchPriority::XdcrMeta));
+    EXPECT_EQ(0, engine->getEpStats().numRemainingBgItems);
+}
+
 TEST_P(EPBucketFullEvictionTest, xattrExpiryOnFullyEvictedItem) {
     cb::xattr::Blob builder;
 
@@ -20,6 +20,7 @@
 #include "../mock/mock_ep_bucket.h"
 #include "../mock/mock_item_freq_decayer.h"
 #include "../mock/mock_synchronous_ep_engine.h"
+#include "bloomfilter.h"
 #include "checkpoint_manager.h"
 #include "collections/vbucket_manifest_handles.h"
 #include "dcp/response.h"
@@ -35,6 +36,8 @@
 #include "vbucket_state.h"
 #include "warmup.h"
 
+#include <platform/dirutils.h>
+
 class WarmupTest : public SingleThreadedKVBucketTest {
 public:
     void MB_31450(bool newCheckpoint);
@@ -552,6 +555,86 @@ TEST_F(WarmupTest, SetVBState) {
     EXPECT_EQ(vbucket_state_replica, store->getVBucket(vbid)->getState());
 }
 
+// With warmup_parallel_vbucket_load enabled the values of every vBucket (of
+// all shards) are loaded by the parallel loading tasks, and each vBucket's
+// progress is reported in the warmup stats.
+TEST_F(WarmupTest, ParallelVBucketLoad) {
+    const std::vector<Vbid> vbids{Vbid(0), Vbid(1), Vbid(2), Vbid(3)};
+    for (const auto vb : vbids) {
+        setVBucketStateAndRunPersistTask(vb, vbucket_state_active);
+        for (int ii = 0; ii < 10; ++ii) {
+            store_item(vb, makeStoredDocKey("key" + std::to_string(ii)), "v");
+        }
+        flush_vbucket_to_disk(vb, 10);
+    }
+
+    resetEngineAndWarmup("warmup_parallel_vbucket_load=true");
+
+    EXPECT_EQ(40, engine->getEpStats().warmedUpValues);
+
+    std::map<std::string, std::string> stats;
+    store->getWarmup()->addStats(
+            [&stats](std::string_view key, std::string_view value, auto) {
+                stats[std::string(key)] = std::string(value);
+            },
+            this);
+    for (const auto vb : vbids) {
+        const auto prefix = "ep_warmup_vb_" + std::to_string(vb.get());
+        EXPECT_EQ("done", stats[prefix + "_load_state"]) << vb;
+        EXPECT_EQ(1, stats.count(prefix + "_load_time")) << vb;
+    }
+}
+
+// With bfilter_persist enabled, a vBucket's bloom filter saved on clean
+// shutdown is reloaded by warmup (and the file then removed).
+TEST_F(WarmupTest, BloomFilterPersisted) {
+    resetEngineAndWarmup("bfilter_persist=true");
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    const auto key = makeStoredDocKey("key");
+    store_item(vbid, key, "value");
+    flush_vbucket_to_disk(vbid);
+    {
+        auto vb = store->getVBucket(vbid);
+        vb->addToFilter(key);
+        ASSERT_EQ(1, vb->getNumOfKeysInFilter());
+    }
+
+    resetEngineAndWarmup("bfilter_persist=true");
+
+    auto vb = store->getVBucket(vbid);
+    EXPECT_EQ("ENABLED", vb->getFilterStatusString());
+    EXPECT_EQ(1, vb->getNumOfKeysInFilter());
+    EXPECT_TRUE(vb->maybeKeyExistsInFilter(key));
+    auto& epBucket = dynamic_cast<EPBucket&>(*store);
+    EXPECT_FALSE(cb::io::isFile(epBucket.getBloomFilterFileName(vbid)));
+}
+
+// Without bfilter_persist no filter is restored.
+TEST_F(WarmupTest, BloomFilterNotPersisted) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    store_item(vbid, makeStoredDocKey("key"), "value");
+    flush_vbucket_to_disk(vbid);
+
+    resetEngineAndWarmup();
+
+    EXPECT_EQ("DOESN'T EXIST",
+              store->getVBucket(vbid)->getFilterStatusString());
+}
+
+// A persisted filter saved at a different seqno to the one on disk is stale
+// and must not be used.
+TEST_F(WarmupTest, BloomFilterStaleSeqno) {
+    BloomFilter bf(10, 0.01, BFILTER_ENABLED);
+    std::string data(8, '\0');
+    data[0] = 5; // saved at seqno 5
+    data.append(bf.serialise());
+
+    EXPECT_TRUE(EPBucket::loadBloomFilter(data, 5));
+    EXPECT_FALSE(EPBucket::loadBloomFilter(data, 6));
+    EXPECT_THROW(EPBucket::loadBloomFilter(data.substr(0, 4), 5),
+                 std::invalid_argument);
+}
+
 TEST_F(WarmupTest, TwoStateChangesAtSameSeqno) {
     // 1) Do a normal state change to replica
     EXPECT_EQ(ENGINE_SUCCESS,
@@ -26,6 +26,7 @@
 #include "tests/mock/mock_synchronous_ep_engine.h"
 #include "tests/module_tests/test_helpers.h"
 
+#include <mcbp/protocol/framebuilder.h>
 #include <programs/engine_testapp/mock_cookie.h>
 #include <string_utilities.h>
 #include <utilities/engine_errc_2_mcbp.h>
@@ -122,6 +123,71 @@ public:
         }
     }
 
+    /// A document of a SetWithMetaBatch
+    struct BatchDocument {
+        std::string key;
+        std::string value;
+        ItemMetaData meta;
+    };
+
+    /// Build a SetWithMetaBatch packet of the given documents
+    std::vector<char> buildWithMetaBatch(
+            const std::vector<BatchDocument>& docs) const {
+        std::vector<uint8_t> body;
+        for (const auto& doc : docs) {
+            cb::mcbp::request::SetWithMetaBatchEntry entry;
+            entry.setFlagsInNetworkByteOrder(doc.meta.flags);
+            entry.setExpiration(uint32_t(doc.meta.exptime));
+            entry.setSeqno(doc.meta.revSeqno);
+            entry.setCas(doc.meta.cas);
+            entry.setKeyLength(uint16_t(doc.key.size()));
+            entry.setValueLength(uint32_t(doc.value.size()));
+            entry.setDatatype(PROTOCOL_BINARY_RAW_BYTES);
+            const auto* ptr = reinterpret_cast<const uint8_t*>(&entry);
+            body.insert(body.end(), ptr, ptr + sizeof(entry));
+            body.insert(body.end(), doc.key.begin(), doc.key.end());
+            body.insert(body.end(), doc.value.begin(), doc.value.end());
+        }
+
+        std::vector<char> packet(sizeof(cb::mcbp::Request) + body.size());
+        cb::mcbp::RequestBuilder builder(
+                {reinterpret_cast<uint8_t*>(packet.data()), packet.size()});
+        builder.setMagic(cb::mcbp::Magic::ClientRequest);
+        builder.setOpcode(cb::mcbp::ClientOpcode::SetWithMetaBatch);
+        builder.setDatatype(cb::mcbp::Datatype::Raw);
+        builder.setVBucket(vbid);
+        builder.setValue({body.data(), body.size()});
+        return packet;
+    }
+
+    /**
+     * Call setWithMetaBatch, returning the per-document statuses from the
+     * response (if the command completed)
+     */
+    ENGINE_ERROR_CODE callBatch(std::vector<char>& packet,
+                                std::vector<cb::mcbp::Status>& statuses) {
+        auto* req = reinterpret_cast<cb::mcbp::Request*>(packet.data());
+        return engine->setWithMetaBatch(
+                cookie,
+                *req,
+                [&statuses](std::string_view,
+                            std::string_view,
+                            std::string_view body,
+                            uint8_t,
+                            cb::mcbp::Status status,
+                            uint64_t,
+                            const void*) {
+                    EXPECT_EQ(cb::mcbp::Status::Success, status);
+                    statuses.clear();
+                    for (size_t ii = 0; ii + 1 < body.size(); ii += 2) {
+                        uint16_t value;
+                        memcpy(&value, body.data() + ii, sizeof(value));
+                        statuses.push_back(cb::mcbp::Status(ntohs(value)));
+                    }
+                    return true;
+                });
+    }
+
     /**
      * Get the item and check its value, if called for a delete, assuming
      * delete with value
@@ -263,6 +329,15 @@ public:
     }
 };
 
+class WithMetaBoundsTest : public WithMetaTest {
+public:
+    void SetUp() override {
+        config_string +=
+                "item_eviction_policy=full_eviction;xdcr_meta_bounds_size=1024";
+        WithMetaTest::SetUp();
+    }
+};
+
 class DelWithMetaTest
     : public WithMetaTest,
       public ::testing::WithParamInterface<
@@ -1568,3 +1643,106 @@ INSTANTIATE_TEST_SUITE_P(AddSetDelXattrMeta,
                          // Bool for snappy on/off
                          ::testing::Combine(::testing::Bool(), opcodeValues),
                          PrintToStringCombinedNameSnappyOnOff());
+
+// A setWithMeta of a non-resident key which beats the meta bounds shouldn't
+// need to fetch the metadata from disk
+TEST_F(WithMetaBoundsTest, setWithMetaResolvedByBounds) {
+    const std::string mykey = "mykey";
+    auto key = makeStoredDocKey(mykey);
+    ItemMetaData itemMeta{100 /*cas*/, 10 /*revSeq*/, 0, expiry};
+    auto swm = buildWithMeta(
+            cb::mcbp::ClientOpcode::SetWithMeta, itemMeta, mykey, "value");
+    ASSERT_EQ(ENGINE_SUCCESS,
+              callEngine(cb::mcbp::ClientOpcode::SetWithMeta, swm));
+    EXPECT_EQ(FlushResult(MoreAvailable::No, 1, WakeCkptRemover::No),
+              getEPBucket().flushVBucket(vbid));
+    evict_key(vbid, key);
+
+    // Not above the bounds (the same revSeqno, but a higher cas) - the
+    // metadata must be fetched
+    updateMeta(swm, 101, 10, 0, uint32_t(expiry));
+    EXPECT_EQ(ENGINE_EWOULDBLOCK,
+              callEngine(cb::mcbp::ClientOpcode::SetWithMeta, swm));
+    EXPECT_EQ(0, engine->getEpStats().numOpsSetMetaResolvedByBounds);
+    runBGFetcherTask();
+    EXPECT_EQ(ENGINE_SUCCESS,
+              callEngine(cb::mcbp::ClientOpcode::SetWithMeta, swm));
+    EXPECT_EQ(FlushResult(MoreAvailable::No, 1, WakeCkptRemover::No),
+              getEPBucket().flushVBucket(vbid));
+    evict_key(vbid, key);
+
+    // Above the bounds - no bgfetch
+    updateMeta(swm, 102, 11, 0, uint32_t(expiry));
+    EXPECT_EQ(ENGINE_SUCCESS,
+              callEngine(cb::mcbp::ClientOpcode::SetWithMeta, swm));
+    EXPECT_EQ(1, engine->getEpStats().numOpsSetMetaResolvedByBounds);
+    EXPECT_EQ(FlushResult(MoreAvailable::No, 1, WakeCkptRemover::No),
+              getEPBucket().flushVBucket(vbid));
+
+    checkGetItem(mykey, "value", {102, 11, 0, expiry});
+}
+
+TEST_F(WithMetaTest, setWithMetaBatch) {
+    // An existing document which beats the one in the batch
+    ItemMetaData existing{100 /*cas*/, 100 /*revSeq*/, 0, expiry};
+    auto swm = buildWithMeta(
+            cb::mcbp::ClientOpcode::SetWithMeta, existing, "key2", "old");
+    ASSERT_EQ(ENGINE_SUCCESS,
+              callEngine(cb::mcbp::ClientOpcode::SetWithMeta, swm));
+
+    auto batch = buildWithMetaBatch({{"key1", "value1", {1, 1, 0, expiry}},
+                                     {"key2", "value2", {100, 50, 0, expiry}},
+                                     {"key3", "value3", {2, 1, 0, expiry}}});
+    std::vector<cb::mcbp::Status> statuses;
+    ASSERT_EQ(ENGINE_SUCCESS, callBatch(batch, statuses));
+    EXPECT_EQ((std::vector<cb::mcbp::Status>{cb::mcbp::Status::Success,
+                                             cb::mcbp::Status::KeyEexists,
+                                             cb::mcbp::Status::Success}),
+              statuses);
+
+    EXPECT_EQ(FlushResult(MoreAvailable::No, 3, WakeCkptRemover::No),
+              getEPBucket().flushVBucket(vbid));
+    checkGetItem("key1", "value1", {1, 1, 0, expiry});
+    checkGetItem("key2", "old", existing);
+    checkGetItem("key3", "value3", {2, 1, 0, expiry});
+}
+
+TEST_F(WithMetaTest, setWithMetaBatchNotMyVbucket) {
+    store->setVBucketState(vbid, vbucket_state_replica);
+    auto batch = buildWithMetaBatch({{"key1", "value1", {1, 1, 0, expiry}}});
+    std::vector<cb::mcbp::Status> statuses;
+    EXPECT_EQ(ENGINE_NOT_MY_VBUCKET, callBatch(batch, statuses));
+    EXPECT_TRUE(statuses.empty());
+}
+
+// A document which needs its metadata fetched from disk pauses the batch,
+// which resumes from that document
+TEST_F(WithMetaBoundsTest, setWithMetaBatchResumesAfterBgFetch) {
+    auto swm = buildWithMeta(cb::mcbp::ClientOpcode::SetWithMeta,
+                             {100, 10, 0, expiry},
+                             "key2",
+                             "old");
+    ASSERT_EQ(ENGINE_SUCCESS,
+              callEngine(cb::mcbp::ClientOpcode::SetWithMeta, swm));
+    EXPECT_EQ(FlushResult(MoreAvailable::No, 1, WakeCkptRemover::No),
+              getEPBucket().flushVBucket(vbid));
+    evict_key(vbid, makeStoredDocKey("key2"));
+
+    // key2 doesn't beat the bounds (the same revSeqno), so must be fetched
+    auto batch = buildWithMetaBatch({{"key1", "value1", {1, 1, 0, expiry}},
+                                     {"key2", "value2", {101, 10, 0, expiry}},
+                                     {"key3", "value3", {1, 1, 0, expiry}}});
+    std::vector<cb::mcbp::Status> statuses;
+    ASSERT_EQ(ENGINE_EWOULDBLOCK, callBatch(batch, statuses));
+    runBGFetcherTask();
+    ASSERT_EQ(ENGINE_SUCCESS, callBatch(batch, statuses));
+    EXPECT_EQ((std::vector<cb::mcbp::Status>{cb::mcbp::Status::Success,
+                                             cb::mcbp::Status::Success,
+                                             cb::mcbp::Status::Success}),
+              statuses);
+
+    // key1 was only set once
+    EXPECT_EQ(FlushResult(MoreAvailable::No, 3, WakeCkptRemover::No),
+              getEPBucket().flushVBucket(vbid));
+    checkGetItem("key2", "value2", {101, 10, 0, expiry});
+}
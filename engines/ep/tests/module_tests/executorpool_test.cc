@@ -422,6 +422,47 @@ TYPED_TEST(ExecutorPoolTest, increase_workers) {
     this->pool->unregisterTaskable(taskable, false);
 }
 
+// Verifies that the adaptive controller grows a pool under sustained
+// pressure and shrinks it again once idle, within its bounds.
+TYPED_TEST(ExecutorPoolTest, AdaptiveThreads) {
+    this->makePool(10, 2, 2, 2, 2);
+    NiceMock<MockTaskable> taskable;
+    this->pool->registerTaskable(taskable);
+
+    ExecutorPool::AdaptiveThreadsConfig config;
+    config.maxThreads = 3;
+    config.waitThreshold = 10ms;
+    config.growAfter = 2;
+    config.shrinkAfter = 3;
+    this->pool->enableAdaptiveThreads(config);
+
+    // A single long wait isn't enough to grow the pool...
+    this->pool->recordTaskWait(READER_TASK_IDX, 50ms);
+    this->pool->adjustThreadPools();
+    EXPECT_EQ(2, this->pool->getNumReaders());
+
+    // ... but a second consecutive one is.
+    this->pool->recordTaskWait(READER_TASK_IDX, 50ms);
+    this->pool->adjustThreadPools();
+    EXPECT_EQ(3, this->pool->getNumReaders());
+
+    // Never grows beyond maxThreads.
+    for (int i = 0; i < 4; ++i) {
+        this->pool->recordTaskWait(READER_TASK_IDX, 50ms);
+        this->pool->adjustThreadPools();
+    }
+    EXPECT_EQ(3, this->pool->getNumReaders());
+    EXPECT_EQ(2, this->pool->getNumWriters());
+
+    // Once idle, shrinks back - but not below the initial size.
+    for (int i = 0; i < 10; ++i) {
+        this->pool->adjustThreadPools();
+    }
+    EXPECT_EQ(2, this->pool->getNumReaders());
+
+    this->pool->unregisterTaskable(taskable, false);
+}
+
 // Verifies the priority of the different thread types. On Windows and Linux
 // the Writer threads should be low priority.
 TYPED_TEST(ExecutorPoolTest, ThreadPriorities) {
@@ -946,6 +987,40 @@ TYPED_TEST(ExecutorPoolDynamicWorkerTest, reschedule_dead_task) {
     EXPECT_EQ(2, runCount);
 }
 
+using WorkStealingExecutorPoolTest =
+        ExecutorPoolTest<WorkStealingFollyExecutorPool>;
+
+/// Test that a high priority task still runs promptly when every thread of its
+/// own pool is busy, by running on an idle thread of another pool.
+TEST_F(WorkStealingExecutorPoolTest, HighPriorityTaskStealsIdleThread) {
+    makePool(10, 1, 1, 2, 1);
+    NiceMock<MockTaskable> taskable;
+    pool->registerTaskable(taskable);
+
+    // Occupy the only NonIO thread with a low priority task.
+    folly::Baton blockerRunning;
+    folly::Baton releaseBlocker;
+    auto blocker = std::make_shared<LambdaTask>(
+            taskable, TaskId::WorkLoadMonitor, 0, true, [&](LambdaTask&) {
+                blockerRunning.post();
+                releaseBlocker.wait();
+                return false;
+            });
+    pool->schedule(blocker);
+    blockerRunning.wait();
+
+    // Test: a high priority NonIO task should run on one of the idle pools
+    // while the NonIO thread is still blocked.
+    ThreadGate tg{1};
+    pool->schedule(makeTask(taskable, tg, TaskId::PendingOpsNotification));
+    tg.waitFor(std::chrono::seconds(10));
+    EXPECT_TRUE(tg.isComplete())
+            << "High priority task did not run while its pool was saturated";
+
+    releaseBlocker.post();
+    pool->unregisterTaskable(taskable, false);
+}
+
 /* Testing to ensure that repeatedly scheduling a task does not result in
  * multiple entries in the taskQueue - this could cause a deadlock in
  * _unregisterTaskable when the taskLocator is empty but duplicate tasks remain
@@ -25,6 +25,7 @@
 #include "../mock/mock_taskable.h"
 #include "executorpool.h"
 #include "fakes/fake_executorpool.h"
+#include "folly_executorpool.h"
 #include "thread_gate.h"
 #include <folly/portability/GTest.h>
 #include <thread>
@@ -43,6 +44,23 @@ public:
     ~TestExecutorPool() override = default;
 };
 
+/// FollyExecutorPool with work-stealing mode enabled.
+class WorkStealingFollyExecutorPool : public FollyExecutorPool {
+public:
+    WorkStealingFollyExecutorPool(size_t maxThreads,
+                                  ThreadPoolConfig::ThreadCount maxReaders,
+                                  ThreadPoolConfig::ThreadCount maxWriters,
+                                  size_t maxAuxIO,
+                                  size_t maxNonIO)
+        : FollyExecutorPool(maxThreads,
+                            maxReaders,
+                            maxWriters,
+                            maxAuxIO,
+                            maxNonIO,
+                            true) {
+    }
+};
+
 template <typename T>
 class ExecutorPoolTest : public ::testing::Test {
 protected:
@@ -0,0 +1,80 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "expiry_index.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <folly/portability/GTest.h>
+
+#include <algorithm>
+
+class ExpiryIndexTest : public ::testing::Test {
+protected:
+    static constexpr time_t now = 100 * ExpiryIndex::BucketSeconds;
+};
+
+TEST_F(ExpiryIndexTest, DisabledByDefault) {
+    ExpiryIndex index;
+    EXPECT_FALSE(index.isEnabled());
+    index.add(makeStoredDocKey("key"), now - 1);
+    EXPECT_EQ(0, index.getNumEntries());
+    EXPECT_TRUE(index.takeDue(now).empty());
+}
+
+TEST_F(ExpiryIndexTest, TakeDue) {
+    ExpiryIndex index;
+    index.enable(10);
+    index.add(makeStoredDocKey("no_expiry"), 0);
+    index.add(makeStoredDocKey("expired"), now - ExpiryIndex::BucketSeconds);
+    index.add(makeStoredDocKey("current"), now + 1);
+    index.add(makeStoredDocKey("future"), now + ExpiryIndex::BucketSeconds);
+    EXPECT_EQ(3, index.getNumEntries());
+
+    // The keys of the bucket now falls into are due (even those expiring
+    // later than now)
+    auto keys = index.takeDue(now);
+    std::sort(keys.begin(), keys.end());
+    std::vector<StoredDocKey> expected{makeStoredDocKey("current"),
+                                       makeStoredDocKey("expired")};
+    EXPECT_EQ(expected, keys);
+    EXPECT_EQ(1, index.getNumEntries());
+    EXPECT_TRUE(index.takeDue(now).empty());
+
+    EXPECT_TRUE(ExpiryIndex::isDue(now + 1, now));
+    EXPECT_FALSE(ExpiryIndex::isDue(now + ExpiryIndex::BucketSeconds, now));
+    EXPECT_FALSE(ExpiryIndex::isDue(0, now));
+}
+
+TEST_F(ExpiryIndexTest, Overflow) {
+    ExpiryIndex index;
+    index.enable(2);
+    for (int ii = 0; ii < 3; ++ii) {
+        index.add(makeStoredDocKey("key_" + std::to_string(ii)), now);
+    }
+    EXPECT_TRUE(index.isOverflowed());
+    EXPECT_EQ(2, index.getNumEntries());
+
+    // No keys are tracked once overflowed, until cleared
+    index.takeDue(now);
+    index.add(makeStoredDocKey("key"), now);
+    EXPECT_EQ(0, index.getNumEntries());
+
+    index.clear();
+    EXPECT_FALSE(index.isOverflowed());
+    index.add(makeStoredDocKey("key"), now);
+    EXPECT_EQ(1, index.getNumEntries());
+}
@@ -118,3 +118,41 @@ TEST_F(FileCacheTest, shrink) {
     auto itr2 = CouchKVStoreFileCache::get().getHandle()->find("k2");
     EXPECT_NE(itr2, CouchKVStoreFileCache::get().getHandle()->end());
 }
+
+TEST_F(FileCacheTest, pinnedFileIsNotEvicted) {
+    auto handle = CouchKVStoreFileCache::get().getHandle();
+    handle->resize(2);
+
+    handle->set("k1", DbHolder(*store));
+    handle->pin("k1");
+    handle->set("k2", DbHolder(*store));
+
+    // k2 is evicted rather than the (older) pinned k1
+    handle->set("k3", DbHolder(*store));
+    EXPECT_EQ(2, handle->numFiles());
+    EXPECT_NE(handle->end(), handle->find("k1"));
+    EXPECT_EQ(handle->end(), handle->find("k2"));
+
+    // Once unpinned k1 (now older than k3) is evicted
+    handle->unpin("k1");
+    handle->find("k3");
+    handle->set("k4", DbHolder(*store));
+    EXPECT_EQ(handle->end(), handle->find("k1"));
+    EXPECT_NE(handle->end(), handle->find("k3"));
+}
+
+TEST_F(FileCacheTest, hitsAndMisses) {
+    auto handle = CouchKVStoreFileCache::get().getHandle();
+    const auto hits = handle->getHits();
+    const auto misses = handle->getMisses();
+
+    EXPECT_THROW(handle->get("k1"), std::out_of_range);
+    EXPECT_EQ(misses + 1, handle->getMisses());
+
+    handle->set("k1", DbHolder(*store));
+    { // Scope for the LockedPtr
+        auto dbHolder = handle->get("k1");
+    }
+    EXPECT_EQ(hits + 1, handle->getHits());
+    EXPECT_EQ(misses + 1, handle->getMisses());
+}
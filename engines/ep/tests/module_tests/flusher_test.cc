@@ -149,4 +149,121 @@ TEST_F(FlusherTest, GetToLowPrioWhenSomeHighPriIsPending) {
     // Run the FLusher again, should drain the low-priority queue
     task_executor->runNextTask(WRITER_TASK_IDX, flusherName);
     ASSERT_EQ(0, flusher->getLPQueueSize());
-}
\ No newline at end of file
+}
+/**
+ * Test fixture for a bucket whose shards have two Flushers, which divide the
+ * shard's vBuckets between them.
+ */
+class FlusherLanesTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        SingleThreadedExecutorPool::replaceExecutorPoolWithFake();
+        // Balancing is driven explicitly by the tests.
+        engine = SynchronousEPEngine::build(
+                "max_flushers_per_shard=2;flusher_balance_interval=0");
+        task_executor = reinterpret_cast<SingleThreadedExecutorPool*>(
+                ExecutorPool::get());
+
+        auto* bucket = dynamic_cast<MockEPBucket*>(engine->getKVBucket());
+        // Consecutive vBuckets of a shard are owned by successive Flushers.
+        const auto shards = bucket->getVBuckets().getNumShards();
+        lane1Vbid = Vbid(shards);
+        flusher0 = bucket->getFlusherNonConst(vbid0);
+        flusher1 = bucket->getFlusherNonConst(lane1Vbid);
+
+        // Create flushers and advance them to running state; run each a
+        // second time so it snoozes before the next is started.
+        flusher0->start();
+        task_executor->runNextTask(WRITER_TASK_IDX, flusher0Name);
+        task_executor->runNextTask(WRITER_TASK_IDX, flusher0Name);
+        flusher1->start();
+        task_executor->runNextTask(WRITER_TASK_IDX, flusher1Name);
+        task_executor->runNextTask(WRITER_TASK_IDX, flusher1Name);
+    }
+
+    void TearDown() override {
+        flusher0->stop();
+        task_executor->runNextTask(WRITER_TASK_IDX, flusher0Name);
+        flusher1->stop();
+        task_executor->runNextTask(WRITER_TASK_IDX, flusher1Name);
+
+        engine.reset();
+        ExecutorPool::shutdown();
+    }
+
+    SynchronousEPEngineUniquePtr engine;
+
+    // Non-owning pointer to SingleThreadedExecutorPool.
+    SingleThreadedExecutorPool* task_executor;
+
+    // Non-owning pointers to the two Flushers of the first shard.
+    Flusher* flusher0;
+    Flusher* flusher1;
+
+    static constexpr const char* flusher0Name =
+            "Running a flusher loop: shard 0";
+    static constexpr const char* flusher1Name =
+            "Running a flusher loop: shard 0 lane 1";
+
+    const Vbid vbid0 = Vbid(0);
+    Vbid lane1Vbid;
+};
+
+TEST_F(FlusherLanesTest, VBucketsDividedBetweenFlushers) {
+    auto* bucket = dynamic_cast<MockEPBucket*>(engine->getKVBucket());
+    const auto shards = bucket->getVBuckets().getNumShards();
+
+    EXPECT_NE(flusher0, flusher1);
+    EXPECT_EQ(0, flusher0->getLane());
+    EXPECT_EQ(1, flusher1->getLane());
+    EXPECT_EQ(flusher0, bucket->getFlusherNonConst(Vbid(2 * shards)));
+    EXPECT_EQ(flusher1, bucket->getFlusherNonConst(Vbid(3 * shards)));
+}
+
+// Each Flusher only flushes the vBuckets it owns, so a busy vBucket of one
+// Flusher does not delay the vBuckets of the other.
+TEST_F(FlusherLanesTest, FlushersFlushIndependently) {
+    auto* kvBucket = engine->getKVBucket();
+    kvBucket->setVBucketState(lane1Vbid, vbucket_state_active);
+    EXPECT_EQ(0, flusher0->getLPQueueSize());
+    ASSERT_EQ(1, flusher1->getLPQueueSize());
+
+    // The second Flusher persists its vBucket without the first running.
+    task_executor->runNextTask(WRITER_TASK_IDX, flusher1Name);
+    EXPECT_EQ(0, flusher1->getLPQueueSize());
+    // Nothing more to flush; the second Flusher snoozes.
+    task_executor->runNextTask(WRITER_TASK_IDX, flusher1Name);
+
+    kvBucket->setVBucketState(vbid0, vbucket_state_active);
+    EXPECT_EQ(1, flusher0->getLPQueueSize());
+    EXPECT_EQ(0, flusher1->getLPQueueSize());
+    task_executor->runNextTask(WRITER_TASK_IDX, flusher0Name);
+    EXPECT_EQ(0, flusher0->getLPQueueSize());
+    task_executor->runNextTask(WRITER_TASK_IDX, flusher0Name);
+}
+
+// Hot vBuckets sharing a Flusher are moved to a less loaded one, as long as
+// that lowers the load of the most loaded Flusher.
+TEST_F(FlusherLanesTest, BalanceMovesLoadBetweenFlushers) {
+    auto* bucket = dynamic_cast<MockEPBucket*>(engine->getKVBucket());
+    const auto shards = bucket->getVBuckets().getNumShards();
+    auto& shard = *bucket->getVBuckets().getShard(0);
+    const auto hot1 = vbid0;
+    const auto hot2 = Vbid(2 * shards);
+    ASSERT_EQ(flusher0, bucket->getFlusherNonConst(hot2));
+
+    // Nothing flushed yet - nothing to balance.
+    EXPECT_EQ(0, shard.balanceFlushers());
+
+    shard.recordFlushLoad(hot1, 100);
+    shard.recordFlushLoad(hot2, 100);
+    shard.recordFlushLoad(lane1Vbid, 10);
+    EXPECT_EQ(1, shard.balanceFlushers());
+    EXPECT_NE(bucket->getFlusherNonConst(hot1),
+              bucket->getFlusherNonConst(hot2));
+    // lane1Vbid is too small to be worth moving back.
+    EXPECT_EQ(flusher1, bucket->getFlusherNonConst(lane1Vbid));
+
+    // Balanced (with the halved history); no further moves.
+    EXPECT_EQ(0, shard.balanceFlushers());
+}
@@ -19,13 +19,14 @@
 #include "ep_time.h"
 #include "hash_table_stat_visitor.h"
 #include "item.h"
-#include "item_freq_decayer_visitor.h"
+#include "item_eviction.h"
 #include "kv_bucket.h"
 #include "programs/engine_testapp/mock_server.h"
 #include "stats.h"
 #include "stored_value_factories.h"
 #include "tests/module_tests/test_helpers.h"
 #include "threadtests.h"
+#include "value_deduplicator.h"
 
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
@@ -35,6 +36,7 @@
 #include <algorithm>
 #include <limits>
 #include <string>
+#include <thread>
 #include <utility>
 
 EPStats global_stats;
@@ -300,6 +302,209 @@ TEST_F(HashTableTest, ConcurrentAccessResize) {
     getCompletedThreads(4, &gen);
 }
 
+TEST_F(HashTableTest, IncrementalResize) {
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                3,
+                HashTableReadMode::Locked,
+                HashTableResizeMode::Incremental);
+    // Sizes are rounded up to a multiple of the lock count.
+    EXPECT_EQ(6, h.getSize());
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    h.resize(6143);
+    EXPECT_EQ(6144, h.getSize());
+    EXPECT_TRUE(h.isResizeInProgress());
+    EXPECT_EQ(6, h.getResizeTotalBuckets());
+    EXPECT_EQ(1, h.getNumResizes());
+
+    // Keys are found (and can be added) mid-migration.
+    verifyFound(h, keys);
+    auto moreKeys = generateKeys(2000, 1000);
+    storeMany(h, moreKeys);
+
+    // Cannot begin another resize until this one completes.
+    h.resize(769);
+    EXPECT_EQ(6144, h.getSize());
+
+    while (!h.resizeStep(1)) {
+        verifyFound(h, keys);
+        verifyFound(h, moreKeys);
+    }
+    EXPECT_FALSE(h.isResizeInProgress());
+    EXPECT_EQ(0, h.getResizeMigratedBuckets());
+    EXPECT_EQ(0, h.getResizeTotalBuckets());
+
+    verifyFound(h, keys);
+    verifyFound(h, moreKeys);
+    EXPECT_EQ(2000, count(h));
+}
+
+// Visiting during an incremental resize must see every item exactly once.
+TEST_F(HashTableTest, IncrementalResizeVisit) {
+    HashTable h(global_stats,
+                makeFactory(),
+                6,
+                3,
+                HashTableReadMode::Locked,
+                HashTableResizeMode::Incremental);
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    h.resize(769);
+    ASSERT_TRUE(h.isResizeInProgress());
+    EXPECT_EQ(1000, count(h));
+
+    // Visiting migrated everything; the next step just frees the old array.
+    EXPECT_TRUE(h.resizeStep(1));
+    EXPECT_FALSE(h.isResizeInProgress());
+    verifyFound(h, keys);
+}
+
+TEST_F(HashTableTest, IncrementalResizeClear) {
+    HashTable h(global_stats,
+                makeFactory(),
+                6,
+                3,
+                HashTableReadMode::Locked,
+                HashTableResizeMode::Incremental);
+    auto keys = generateKeys(100);
+    storeMany(h, keys);
+
+    h.resize(769);
+    ASSERT_TRUE(h.isResizeInProgress());
+    h.clear();
+    EXPECT_FALSE(h.isResizeInProgress());
+    EXPECT_EQ(0, h.getNumItems());
+    EXPECT_EQ(0, count(h));
+}
+
+TEST_F(HashTableTest, OptimisticReadDisabledByDefault) {
+    HashTable h(global_stats, makeFactory(), 5, 1);
+    EXPECT_EQ(HashTableReadMode::Locked, h.getReadMode());
+
+    auto key = makeStoredDocKey("key");
+    store(h, key);
+    EXPECT_FALSE(h.findForReadOptimistic(key, TrackReference::No));
+}
+
+TEST_F(HashTableTest, OptimisticRead) {
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                3,
+                HashTableReadMode::Optimistic);
+    EXPECT_EQ(HashTableReadMode::Optimistic, h.getReadMode());
+
+    auto keys = generateKeys(100);
+    storeMany(h, keys);
+
+    for (const auto& key : keys) {
+        auto res = h.findForReadOptimistic(key, TrackReference::No);
+        ASSERT_TRUE(res) << key;
+        ASSERT_TRUE(res->storedValue) << key;
+        EXPECT_TRUE(res->storedValue->hasKey(key));
+    }
+
+    auto missing = h.findForReadOptimistic(makeStoredDocKey("missing"),
+                                           TrackReference::No);
+    ASSERT_TRUE(missing);
+    EXPECT_FALSE(missing->storedValue);
+}
+
+// An optimistic read must back off while a writer holds the HashBucketLock
+// for the same key, and succeed again once it is released.
+TEST_F(HashTableTest, OptimisticReadConflictsWithWriter) {
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                1,
+                HashTableReadMode::Optimistic);
+    auto key = makeStoredDocKey("key");
+    store(h, key);
+
+    {
+        auto hbl = h.getLockedBucket(key);
+        EXPECT_FALSE(h.findForReadOptimistic(key, TrackReference::No));
+    }
+
+    auto res = h.findForReadOptimistic(key, TrackReference::No);
+    ASSERT_TRUE(res);
+    EXPECT_TRUE(res->storedValue);
+}
+
+// The generation of a key's lock stripe changes with every writer of the
+// stripe, and isn't available while a writer holds the lock.
+TEST_F(HashTableTest, Generation) {
+    HashTable locked(global_stats, makeFactory(), 5, 1);
+    EXPECT_FALSE(locked.getGeneration(makeStoredDocKey("key")));
+
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                1,
+                HashTableReadMode::Optimistic);
+    auto key = makeStoredDocKey("key");
+    store(h, key);
+
+    const auto generation = h.getGeneration(key);
+    ASSERT_TRUE(generation);
+    ASSERT_TRUE(h.findForReadOptimistic(key, TrackReference::No));
+    EXPECT_EQ(generation, h.getGeneration(key));
+
+    {
+        auto hbl = h.getLockedBucket(key);
+        EXPECT_FALSE(h.getGeneration(key));
+    }
+    const auto next = h.getGeneration(key);
+    ASSERT_TRUE(next);
+    EXPECT_NE(*generation, *next);
+
+    store(h, key);
+    EXPECT_NE(next, h.getGeneration(key));
+}
+
+// Optimistic readers running concurrently with resize and deletion must only
+// ever observe a consistent view of the HashTable.
+TEST_F(HashTableTest, ConcurrentOptimisticReadResize) {
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                3,
+                HashTableReadMode::Optimistic);
+
+    auto keys = generateKeys(2000);
+    h.resize(keys.size());
+    storeMany(h, keys);
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    for (int ii = 0; ii < 3; ++ii) {
+        readers.emplace_back([&h, &keys, &done]() {
+            while (!done) {
+                for (const auto& key : keys) {
+                    auto res = h.findForReadOptimistic(key);
+                    if (res && res->storedValue) {
+                        EXPECT_TRUE(res->storedValue->hasKey(key));
+                    }
+                }
+            }
+        });
+    }
+
+    srand(918475);
+    AccessGenerator gen(keys, h);
+    gen();
+    done = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+    EXPECT_EQ(0, h.getNumItems());
+}
+
 TEST_F(HashTableTest, AutoResize) {
     HashTable h(global_stats, makeFactory(), 5, 3);
 
@@ -358,6 +563,7 @@ protected:
     void SetUp() override {
         global_stats.reset();
         ASSERT_EQ(0, ht.getItemMemory());
+        ASSERT_EQ(0, ht.getKeyMemory());
         ASSERT_EQ(0, ht.getCacheSize());
         ASSERT_EQ(0, ht.getUncompressedItemMemory());
         initialSize = stats.getCurrentSize();
@@ -376,6 +582,7 @@ protected:
 
     void TearDown() override {
         EXPECT_EQ(0, ht.getItemMemory());
+        EXPECT_EQ(0, ht.getKeyMemory());
         EXPECT_EQ(0, ht.getUncompressedItemMemory());
         EXPECT_EQ(0, ht.getCacheSize());
         EXPECT_EQ(initialSize, stats.getCurrentSize());
@@ -421,6 +628,16 @@ TEST_P(HashTableStatsTest, Size) {
     del(ht, key);
 }
 
+// The key memory is the size of the keys of the StoredValues, and is
+// included in the metadata memory.
+TEST_P(HashTableStatsTest, KeyMemory) {
+    EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
+    EXPECT_EQ(SerialisedDocKey::getObjectSize(key), ht.getKeyMemory());
+    EXPECT_LT(ht.getKeyMemory(), ht.getMetadataMemory());
+
+    del(ht, key);
+}
+
 TEST_P(HashTableStatsTest, SizeFlush) {
     EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
 
@@ -1044,44 +1261,224 @@ TEST_F(HashTableTest, PauseResumeHashBucket) {
     ht.pauseResumeVisit(mockVisitor, start);
 }
 
-// Test the itemFreqDecayerVisitor by adding 256 documents to the hash table.
-// Then set the frequency count of each document in the range 0 to 255.  We
-// then visit each document and decay it by 50%.  The test checks that the
-// frequency count of each document has been decayed by 50%.
-TEST_F(HashTableTest, ItemFreqDecayerVisitorTest) {
+// Sampling every hash bucket should find the least frequently used eligible
+// StoredValue.
+TEST_F(HashTableTest, SampleLeastFrequentKey) {
+    HashTable ht(global_stats, makeFactory(true), 128, 1);
+    auto keys = generateKeys(256);
+    storeMany(ht, keys);
+    for (int ii = 0; ii < 256; ii++) {
+        auto key = makeStoredDocKey(std::to_string(ii));
+        ht.findForWrite(key).storedValue->setFreqCounterValue(
+                ii == 7 ? 0 : std::min(ii + 1, 255));
+    }
+
+    long slot = 0;
+    std::function<long()> everySlot = [&slot]() { return slot++; };
+    auto any = [](const StoredValue&) { return true; };
+    auto key = ht.sampleLeastFrequentKey(ht.getSize(), everySlot, any);
+    ASSERT_TRUE(key);
+    EXPECT_EQ(makeStoredDocKey("7"), *key);
+
+    auto not7 = [](const StoredValue& v) {
+        return makeStoredDocKey("7") != v.getKey();
+    };
+    key = ht.sampleLeastFrequentKey(ht.getSize(), everySlot, not7);
+    ASSERT_TRUE(key);
+    EXPECT_EQ(makeStoredDocKey("0"), *key);
+
+    auto none = [](const StoredValue&) { return false; };
+    EXPECT_FALSE(ht.sampleLeastFrequentKey(ht.getSize(), everySlot, none));
+}
+
+// Test that the HashTable's frequency histogram tracks the frequency counters
+// of its resident items across insertion, update, decay and removal.
+TEST_F(HashTableTest, FreqCountsTracked) {
+    HashTable ht(global_stats, makeFactory(true), 128, 1);
+    auto keys = generateKeys(256);
+    storeMany(ht, keys);
+
+    auto counts = ht.getFreqCounts();
+    EXPECT_EQ(256, counts[Item::initialFreqCount]);
+
+    for (int ii = 0; ii < 256; ii++) {
+        auto key = makeStoredDocKey(std::to_string(ii));
+        auto item = ht.findForWrite(key);
+        ht.unlocked_setFreqCounterValue(item.lock, *item.storedValue, ii);
+    }
+    counts = ht.getFreqCounts();
+    for (int ii = 0; ii < 256; ii++) {
+        EXPECT_EQ(1, counts[ii]) << "freq:" << ii;
+    }
+    EXPECT_EQ(127, ItemEviction::getFreqThreshold(counts, 50.0, 256));
+
+    // Decaying by 50% maps each pair of counts onto one.
+    ht.decayFreqCounters(50);
+    counts = ht.getFreqCounts();
+    for (int ii = 0; ii < 128; ii++) {
+        EXPECT_EQ(2, counts[ii]) << "freq:" << ii;
+    }
+    for (int ii = 128; ii < 256; ii++) {
+        EXPECT_EQ(0, counts[ii]) << "freq:" << ii;
+    }
+
+    // Items no longer resident are not tracked.
+    auto item = ht.findForWrite(makeStoredDocKey("0"));
+    ht.unlocked_del(item.lock, item.storedValue);
+    counts = ht.getFreqCounts();
+    EXPECT_EQ(1, counts[0]);
+}
+
+// Test the lazy decay of the frequency counters by adding 256 documents to
+// the hash table. Then set the frequency count of each document in the range
+// 0 to 255.  We then decay the counters by 50% (twice).  The test checks that
+// the frequency count of each document has been decayed by 50% each time,
+// but only once visited, and that new documents are not decayed.
+TEST_F(HashTableTest, ItemFreqDecayTest) {
     HashTable ht(global_stats, makeFactory(true), 128, 1);
     auto keys = generateKeys(256);
     // Add 256 documents to the hash table
     storeMany(ht, keys);
-    StoredValue* v;
 
     // Set the frequency count of each document in the range 0 to 255.
     for (int ii = 0; ii < 256; ii++) {
         auto key = makeStoredDocKey(std::to_string(ii));
-        v = ht.findForWrite(key).storedValue;
-        v->setFreqCounterValue(ii);
-       }
-
-       ItemFreqDecayerVisitor itemFreqDecayerVisitor(
-               Configuration().getItemFreqDecayerPercent());
-       // Decay the frequency count of each document by the configuration
-       // default of 50%
-       for (int ii = 0; ii < 256; ii++) {
-           auto key = makeStoredDocKey(std::to_string(ii));
-           auto item = ht.findForWrite(key);
-           itemFreqDecayerVisitor.visit(item.lock, *item.storedValue);
-       }
-
-       // Confirm we visited all the documents
-       EXPECT_EQ(256, itemFreqDecayerVisitor.getVisitedCount());
-
-       // Check the frequency of the docs have been decayed by 50%.
-       for (int ii = 0; ii < 256; ii++) {
-           auto key = makeStoredDocKey(std::to_string(ii));
-           v = ht.findForWrite(key).storedValue;
-           uint16_t expectVal = ii * 0.5;
-           EXPECT_EQ(expectVal, v->getFreqCounterValue());
-       }
+        auto item = ht.findForWrite(key);
+        item.storedValue->setFreqCounterValue(ii);
+        EXPECT_EQ(ii, ht.unlocked_applyFreqDecay(item.lock, *item.storedValue));
+    }
+
+    // Decay the frequency count of each document by the configuration
+    // default of 50%
+    const auto percentage = Configuration().getItemFreqDecayerPercent();
+    ht.decayFreqCounters(percentage);
+    EXPECT_EQ(1, ht.getFreqDecayEpoch());
+
+    // Not applied until visited
+    for (int ii = 0; ii < 256; ii++) {
+        auto key = makeStoredDocKey(std::to_string(ii));
+        EXPECT_EQ(ii, ht.findForWrite(key).storedValue->getFreqCounterValue());
+    }
+
+    // Check the frequency of the docs have been decayed by 50% (once).
+    for (int ii = 0; ii < 256; ii++) {
+        auto key = makeStoredDocKey(std::to_string(ii));
+        auto item = ht.findForWrite(key);
+        uint8_t expectVal = ii * 0.5;
+        EXPECT_EQ(expectVal,
+                  ht.unlocked_applyFreqDecay(item.lock, *item.storedValue));
+        // Only applied once
+        EXPECT_EQ(expectVal,
+                  ht.unlocked_applyFreqDecay(item.lock, *item.storedValue));
+        EXPECT_EQ(expectVal, item.storedValue->getFreqCounterValue());
+    }
+
+    // Two pending decays are both applied
+    ht.decayFreqCounters(percentage);
+    ht.decayFreqCounters(percentage);
+    const auto newKey = makeStoredDocKey("new");
+    store(ht, newKey);
+    for (int ii = 0; ii < 256; ii++) {
+        auto key = makeStoredDocKey(std::to_string(ii));
+        auto item = ht.findForWrite(key);
+        uint8_t expectVal = ii * 0.5;
+        expectVal = expectVal * 0.5;
+        expectVal = expectVal * 0.5;
+        EXPECT_EQ(expectVal,
+                  ht.unlocked_applyFreqDecay(item.lock, *item.storedValue));
+    }
+
+    // A document added after the decays doesn't get decayed
+    auto item = ht.findForWrite(newKey);
+    EXPECT_EQ(Item::initialFreqCount,
+              ht.unlocked_applyFreqDecay(item.lock, *item.storedValue));
+}
+
+// With ht_compact_non_resident the StoredValues are reallocated without
+// their inline value buffer when their value is ejected
+TEST_F(HashTableTest, CompactNonResidentOnEject) {
+    HashTable ht(global_stats,
+                 std::make_unique<StoredValueFactory>(global_stats, 64, true),
+                 2,
+                 1);
+    const auto key = makeStoredDocKey("key");
+    const auto other = makeStoredDocKey("other");
+    ASSERT_EQ(MutationStatus::WasClean,
+              ht.set(make_item(Vbid(0), key, "value")));
+    ASSERT_EQ(MutationStatus::WasClean,
+              ht.set(make_item(Vbid(0), other, "value")));
+    const auto memory = ht.getItemMemory();
+
+    {
+        auto item = ht.findForWrite(key);
+        ASSERT_TRUE(item.storedValue);
+        ASSERT_TRUE(item.storedValue->hasInlineValue());
+        item.storedValue->markClean();
+        item.storedValue->setFreqCounterValue(100);
+        const auto size = item.storedValue->getObjectSize();
+
+        auto* sv = item.storedValue;
+        EXPECT_TRUE(
+                ht.unlocked_ejectItem(item.lock, sv, EvictionPolicy::Value));
+        EXPECT_NE(item.storedValue, sv);
+        EXPECT_FALSE(sv->isResident());
+        EXPECT_EQ(0, sv->getInlineValueCapacity());
+        EXPECT_EQ(100, sv->getFreqCounterValue());
+        EXPECT_EQ(StoredValue::getRequiredStorage(key), sv->getObjectSize());
+        EXPECT_EQ(memory - (size - sv->getObjectSize()), ht.getItemMemory());
+    }
+
+    // Both items are still in the chain
+    EXPECT_EQ(2, ht.getNumItems());
+    EXPECT_EQ(1, ht.getNumInMemoryNonResItems());
+    EXPECT_TRUE(ht.findForWrite(key).storedValue);
+    EXPECT_TRUE(ht.findForWrite(other).storedValue);
+
+    // The value is restored to a Blob of its own
+    auto item = ht.findForWrite(key);
+    ASSERT_TRUE(ht.unlocked_restoreValue(item.lock.getHTLock(),
+                                         make_item(Vbid(0), key, "value"),
+                                         *item.storedValue));
+    EXPECT_TRUE(item.storedValue->isResident());
+    EXPECT_FALSE(item.storedValue->hasInlineValue());
+    EXPECT_EQ("value", item.storedValue->getValue()->to_s());
+}
+
+// The bucket arrays of at least a huge page are allocated with huge pages
+TEST_F(HashTableTest, HugePages) {
+    EPStats stats;
+    constexpr size_t bigSize =
+            cb::hugepages::Size / sizeof(StoredValue::UniquePtr) + 1;
+    {
+        HashTable ht(stats,
+                     makeFactory(),
+                     5,
+                     1,
+                     HashTableReadMode::Locked,
+                     HashTableResizeMode::Blocking,
+                     true);
+        EXPECT_EQ(0, stats.htHugePageBytes);
+
+        auto keys = generateKeys(10);
+        storeMany(ht, keys);
+        ht.resize(bigSize);
+        ASSERT_EQ(bigSize, ht.getSize());
+        EXPECT_EQ(2 * cb::hugepages::Size, stats.htHugePageBytes);
+        for (const auto& key : keys) {
+            EXPECT_TRUE(ht.findForRead(key).storedValue);
+        }
+
+        ht.resize(5);
+        EXPECT_EQ(0, stats.htHugePageBytes);
+        ht.resize(bigSize);
+        EXPECT_EQ(2 * cb::hugepages::Size, stats.htHugePageBytes);
+        ht.clear();
+    }
+    EXPECT_EQ(0, stats.htHugePageBytes);
+
+    // Not used unless enabled
+    HashTable ht(stats, makeFactory(), bigSize, 1);
+    EXPECT_EQ(0, stats.htHugePageBytes);
 }
 
 // Test the reallocateStoredValue method.
@@ -1190,4 +1587,38 @@ TEST_F(HashTableTest, ReplaceValueAndDatatype) {
     EXPECT_EQ(initialFreqCounter, sv->getFreqCounterValue());
     EXPECT_EQ(initialAge, sv->getAge());
     EXPECT_EQ(initialCommittedState, sv->getCommitted());
-}
\ No newline at end of file
+}
+// With a ValueDeduplicator, the StoredValues of the keys with identical values
+// share a single Blob
+TEST_F(HashTableTest, DeduplicatedValues) {
+    HashTable ht(global_stats, makeFactory(), 5, 1);
+    ht.setValueDeduplicator(std::make_shared<ValueDeduplicator>(16, 64));
+
+    auto getBlob = [&ht](const std::string& key) {
+        return ht.findForRead(makeStoredDocKey(key))
+                .storedValue->getValue()
+                .get()
+                .get();
+    };
+
+    const std::string big(32, 'x');
+    const std::string small = "small";
+    for (const std::string key : {"a", "b"}) {
+        Item item(makeStoredDocKey(key), 0, 0, big.data(), big.size());
+        ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+        Item smallItem(
+                makeStoredDocKey(key + "_small"), 0, 0, small.data(), 5);
+        ASSERT_EQ(MutationStatus::WasClean, ht.set(smallItem));
+    }
+    EXPECT_EQ(getBlob("a"), getBlob("b"));
+    // Too small to be shared
+    EXPECT_NE(getBlob("a_small"), getBlob("b_small"));
+
+    // A new value for one of the keys leaves the other one's alone
+    const std::string other(32, 'y');
+    Item item(makeStoredDocKey("b"), 0, 0, other.data(), other.size());
+    ASSERT_EQ(MutationStatus::WasDirty, ht.set(item));
+    EXPECT_NE(getBlob("a"), getBlob("b"));
+    const auto* a = getBlob("a");
+    EXPECT_EQ(big, std::string(a->getData(), a->valueSize()));
+}
@@ -400,6 +400,33 @@ TEST(HdrHistogramTest, aggregationTestEmptyRhs) {
     EXPECT_EQ(0, histogramTwo.getValueCount());
 }
 
+// Test the subtraction operator gives the values added between snapshots
+TEST(HdrHistogramTest, subtractionTest) {
+    HdrHistogram histogram{0, 200, 3};
+    for (int i = 0; i < 100; i++) {
+        histogram.addValue(i);
+    }
+    const HdrHistogram snapshot{histogram};
+    for (int i = 50; i < 150; i++) {
+        histogram.addValue(i);
+    }
+
+    HdrHistogram interval{histogram};
+    interval -= snapshot;
+    EXPECT_EQ(100, interval.getValueCount());
+    EXPECT_EQ(50, interval.getMinValue());
+    EXPECT_EQ(149, interval.getMaxValue());
+
+    // Subtracting a histogram with more values leaves nothing
+    interval -= histogram;
+    EXPECT_EQ(0, interval.getValueCount());
+
+    // And subtracting an empty histogram doesn't change anything
+    interval = histogram;
+    interval -= HdrHistogram{0, 200, 3};
+    EXPECT_EQ(200, interval.getValueCount());
+}
+
 TEST(HdrHistogramTest, int32MaxSizeTest) {
     // Histogram type doesn't really matter for this but we first saw this with
     // a percentiles histogram so that's what we'll use here
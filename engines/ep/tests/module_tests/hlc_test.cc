@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "hlc.h"
+
+#include <folly/portability/GTest.h>
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <vector>
+
+class HLCTest : public ::testing::Test {
+protected:
+    HLC hlc{0,
+            0,
+            std::chrono::microseconds::max(),
+            std::chrono::microseconds::max()};
+};
+
+TEST_F(HLCTest, NextIsMonotonic) {
+    auto last = hlc.nextHLC();
+    for (int ii = 0; ii < 1000; ++ii) {
+        const auto next = hlc.nextHLC();
+        EXPECT_LT(last, next);
+        last = next;
+    }
+    EXPECT_EQ(last, hlc.getMaxHLC());
+}
+
+TEST_F(HLCTest, NextIsAfterMax) {
+    // A peer far ahead of us switches to the logical clock
+    const uint64_t max = std::numeric_limits<uint64_t>::max() >> 1;
+    hlc.setMaxHLC(max);
+    EXPECT_EQ(max + 1, hlc.nextHLC());
+    EXPECT_EQ(max + 2, hlc.nextHLC());
+}
+
+// Concurrent callers must never be handed the same value
+TEST_F(HLCTest, ConcurrentNextIsUnique) {
+    const int numThreads = 4;
+    const int numCalls = 10000;
+    std::vector<std::vector<uint64_t>> values(numThreads);
+    std::vector<std::thread> threads;
+    for (int tt = 0; tt < numThreads; ++tt) {
+        threads.emplace_back([this, &values, tt]() {
+            for (int ii = 0; ii < numCalls; ++ii) {
+                values[tt].push_back(hlc.nextHLC());
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::vector<uint64_t> all;
+    for (const auto& v : values) {
+        EXPECT_TRUE(std::is_sorted(v.begin(), v.end()));
+        all.insert(all.end(), v.begin(), v.end());
+    }
+    std::sort(all.begin(), all.end());
+    EXPECT_EQ(all.end(), std::adjacent_find(all.begin(), all.end()));
+}
@@ -0,0 +1,83 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "hyperloglog.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <folly/portability/GTest.h>
+
+#include <string>
+
+// Allow 4 standard errors (6.5% each), the tests hash fixed keys so are
+// deterministic.
+static void expectEstimate(size_t expected, const HyperLogLog& hll) {
+    EXPECT_NEAR(double(expected), double(hll.estimate()), expected * 0.26);
+}
+
+TEST(HyperLogLogTest, Empty) {
+    HyperLogLog hll;
+    EXPECT_EQ(0, hll.estimate());
+}
+
+// Adding the same keys again doesn't change the estimate
+TEST(HyperLogLogTest, Duplicates) {
+    HyperLogLog hll;
+    for (int i = 0; i < 10; ++i) {
+        hll.add(makeStoredDocKey("key"));
+    }
+    EXPECT_EQ(1, hll.estimate());
+}
+
+TEST(HyperLogLogTest, Estimate) {
+    for (size_t count : {100, 1000, 10000, 100000}) {
+        HyperLogLog hll;
+        for (size_t i = 0; i < count; ++i) {
+            hll.add(makeStoredDocKey("key_" + std::to_string(i)));
+            hll.add(makeStoredDocKey("key_" + std::to_string(i)));
+        }
+        expectEstimate(count, hll);
+    }
+}
+
+// The same key of different collections is a different key
+TEST(HyperLogLogTest, Collections) {
+    HyperLogLog hll;
+    for (size_t i = 0; i < 1000; ++i) {
+        hll.add(makeStoredDocKey("key_" + std::to_string(i)));
+        hll.add(makeStoredDocKey("key_" + std::to_string(i), CollectionID(8)));
+    }
+    expectEstimate(2000, hll);
+}
+
+// A merged sketch estimates the union of the keys
+TEST(HyperLogLogTest, Merge) {
+    HyperLogLog a;
+    HyperLogLog b;
+    for (size_t i = 0; i < 1000; ++i) {
+        a.add(makeStoredDocKey("key_" + std::to_string(i)));
+        b.add(makeStoredDocKey("key_" + std::to_string(i + 500)));
+    }
+    a += b;
+    expectEstimate(1500, a);
+
+    HyperLogLog copy(a);
+    EXPECT_EQ(a.estimate(), copy.estimate());
+
+    a.clear();
+    EXPECT_EQ(0, a.estimate());
+    EXPECT_NE(0, copy.estimate());
+}
@@ -16,6 +16,7 @@
  */
 
 #include "item_compressor_test.h"
+#include "collections/vbucket_manifest_handles.h"
 #include "item.h"
 #include "item_compressor_visitor.h"
 #include "test_helpers.h"
@@ -128,6 +129,82 @@ TEST_P(ItemCompressorTest, testStoreUncompressedInActiveMode) {
     EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, v->getDatatype());
 }
 
+// Test that values accessed more often than the frequency threshold are left
+// inflated, and counted in the collection stats
+TEST_P(ItemCompressorTest, testHotItemsStayInflatedInActiveMode) {
+    std::string compressibleValue(
+            "{\"product\": \"car\",\"price\": \"100\"},"
+            "{\"product\": \"bus\",\"price\": \"1000\"},"
+            "{\"product\": \"Train\",\"price\": \"100000\"}");
+
+    auto hotKey = makeStoredDocKey("hot");
+    auto coldKey = makeStoredDocKey("cold");
+    for (const auto& key : {hotKey, coldKey}) {
+        auto item = make_item(vbucket->getId(),
+                              key,
+                              compressibleValue,
+                              0,
+                              PROTOCOL_BINARY_DATATYPE_JSON);
+        ASSERT_EQ(MutationStatus::WasClean, public_processSet(item, 0));
+    }
+    findValue(hotKey)->setFreqCounterValue(200);
+    findValue(coldKey)->setFreqCounterValue(Item::initialFreqCount);
+
+    PauseResumeVBAdapter prAdapter(std::make_unique<ItemCompressorVisitor>());
+
+    auto& visitor =
+            dynamic_cast<ItemCompressorVisitor&>(prAdapter.getHTVisitor());
+    visitor.setCompressionMode(BucketCompressionMode::Active);
+    visitor.setMinCompressionRatio(config.getMinCompressionRatio());
+    visitor.setFreqThreshold(Item::initialFreqCount);
+    prAdapter.visit(*vbucket);
+
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, findValue(hotKey)->getDatatype());
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON | PROTOCOL_BINARY_DATATYPE_SNAPPY,
+              findValue(coldKey)->getDatatype());
+
+    Collections::Summary summary;
+    vbucket->lockCollections().updateSummary(summary);
+    const auto& stats = summary[CollectionID::Default].compressor;
+    EXPECT_EQ(1, stats.skippedHot);
+    EXPECT_EQ(1, stats.tried);
+    EXPECT_EQ(1, stats.compressed);
+    EXPECT_LT(0, stats.bytesSaved);
+}
+
+// Test that once values of a datatype of a collection don't compress, only
+// one in sample rate of them is tried
+TEST_P(ItemCompressorTest, testIncompressibleDatatypeIsSampled) {
+    const size_t values = 6;
+    for (size_t ii = 0; ii < values; ++ii) {
+        auto item = make_item(vbucket->getId(),
+                              makeStoredDocKey("key" + std::to_string(ii)),
+                              "qx" + std::to_string(ii) + "zj",
+                              0,
+                              PROTOCOL_BINARY_RAW_BYTES);
+        ASSERT_EQ(MutationStatus::WasClean, public_processSet(item, 0));
+    }
+
+    PauseResumeVBAdapter prAdapter(std::make_unique<ItemCompressorVisitor>());
+
+    auto& visitor =
+            dynamic_cast<ItemCompressorVisitor&>(prAdapter.getHTVisitor());
+    visitor.setCompressionMode(BucketCompressionMode::Active);
+    visitor.setMinCompressionRatio(config.getMinCompressionRatio());
+    visitor.setSampleRate(2);
+    prAdapter.visit(*vbucket);
+
+    // The first two are tried, then one in two: tried, tried, skipped, tried,
+    // skipped, tried
+    Collections::Summary summary;
+    vbucket->lockCollections().updateSummary(summary);
+    const auto& stats = summary[CollectionID::Default].compressor;
+    EXPECT_EQ(4, stats.tried);
+    EXPECT_EQ(0, stats.compressed);
+    EXPECT_EQ(2, stats.skippedSampled);
+    EXPECT_EQ(values, stats.tried + stats.skippedSampled);
+}
+
 INSTANTIATE_TEST_SUITE_P(
         AllVBTypesAllEvictionModes,
         ItemCompressorTest,
@@ -53,3 +53,20 @@ TEST(ItemEvictionClassTest, freqThreshold) {
     EXPECT_EQ(255, result100.first);
     EXPECT_EQ(510, result100.second);
 }
+
+// Test the getFreqThreshold function computing a threshold from a histogram
+// of frequency counts.
+TEST(ItemEvictionClassTest, freqThresholdFromCounts) {
+    ItemEviction::FreqCounts counts{};
+    EXPECT_EQ(0, ItemEviction::getFreqThreshold(counts, 50.0, 0));
+
+    counts[0] = 10;
+    counts[4] = 80;
+    counts[200] = 10;
+    EXPECT_EQ(0, ItemEviction::getFreqThreshold(counts, 10.0, 100));
+    EXPECT_EQ(4, ItemEviction::getFreqThreshold(counts, 11.0, 100));
+    EXPECT_EQ(4, ItemEviction::getFreqThreshold(counts, 90.0, 100));
+    EXPECT_EQ(200, ItemEviction::getFreqThreshold(counts, 95.0, 100));
+    // The population may exceed the tracked items (e.g. non-resident items).
+    EXPECT_EQ(255, ItemEviction::getFreqThreshold(counts, 100.0, 200));
+}
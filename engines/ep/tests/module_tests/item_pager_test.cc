@@ -33,10 +33,12 @@
 #include "kvstore.h"
 #include "test_helpers.h"
 #include "tests/mock/mock_synchronous_ep_engine.h"
+#include "tests/module_tests/collections/collections_test_helpers.h"
 
 #include <folly/portability/GTest.h>
 #include <programs/engine_testapp/mock_server.h>
 #include <string_utilities.h>
+#include <utilities/test_manifest.h>
 #include <xattr/blob.h>
 #include <xattr/utils.h>
 
@@ -1083,6 +1085,85 @@ TEST_P(STItemPagerTest, ActiveEvictedIfReplicaEvictionInsufficient) {
     EXPECT_LT(replicaRR, 5);
 }
 
+// Test that a collection over the per-collection memory quota has its
+// mutations temporarily failed, and is paged out by the ItemPager without
+// evicting items of other collections.
+TEST_P(STItemPagerTest, CollectionOverMemQuotaEvictedAlone) {
+    if (std::get<1>(GetParam()) == "fail_new_data") {
+        // fail_new_data buckets have no ItemPager.
+        GTEST_SKIP();
+    }
+
+    // Make sure the bucket as a whole stays well below the low watermark, so
+    // only the collection quota can trigger eviction.
+    increaseQuota(100 * 1024 * 1024);
+
+    auto vb = store->getVBucket(vbid);
+    CollectionsManifest cm(CollectionEntry::fruit);
+    vb->updateFromManifest(makeManifest(cm));
+
+    const std::string value(512, 'x');
+    auto storeItems = [this, &value](CollectionID cid, int count) {
+        for (int ii = 0; ii < count; ++ii) {
+            auto item = make_item(
+                    vbid, StoredDocKey{"key_" + std::to_string(ii), cid}, value);
+            // Set freqCount to 0 so will be a candidate for paging out
+            // straight away.
+            item.setFreqCounterValue(0);
+            ASSERT_EQ(ENGINE_SUCCESS, storeItem(item));
+        }
+    };
+    storeItems(CollectionEntry::defaultC, 10);
+    storeItems(CollectionEntry::fruit, 100);
+    vb->checkpointManager->createNewCheckpoint();
+    flushDirectlyIfPersistent(vbid);
+
+    auto& stats = engine->getEpStats();
+    const auto defaultMem =
+            stats.getCollectionMemUsed(CollectionEntry::defaultC);
+    const auto fruitMem = stats.getCollectionMemUsed(CollectionEntry::fruit);
+    ASSERT_GT(fruitMem, defaultMem * 4);
+
+    // Allow each collection half of the fruit collection's current usage.
+    engine->getConfiguration().setCollectionMemQuotaPercent(
+            50.0 * fruitMem / stats.getMaxDataSize());
+    const auto quota = store->getCollectionMemQuota();
+    ASSERT_GT(quota, defaultMem);
+    ASSERT_LT(quota, fruitMem);
+
+    // The quota is applied to the write path once the collections over it
+    // have been (re)computed, which is normally done by the ItemPager.
+    store->updateCollectionsOverMemQuota();
+    EXPECT_TRUE(store->isCollectionOverMemQuota(CollectionEntry::fruit));
+    EXPECT_FALSE(store->isCollectionOverMemQuota(CollectionEntry::defaultC));
+
+    // Mutations of the fruit collection are temporarily failed, but other
+    // collections are unaffected.
+    auto fruitItem = make_item(
+            vbid, StoredDocKey{"new", CollectionEntry::fruit}, value);
+    EXPECT_EQ(ENGINE_TMPFAIL, storeItem(fruitItem));
+    EXPECT_EQ(1, stats.tmp_oom_collection_quota_errors.load());
+
+    auto defaultItem = make_item(
+            vbid, StoredDocKey{"new", CollectionEntry::defaultC}, value);
+    EXPECT_EQ(ENGINE_SUCCESS, storeItem(defaultItem));
+    const auto newDefaultMem =
+            stats.getCollectionMemUsed(CollectionEntry::defaultC);
+
+    // The TMPFAIL woke the ItemPager, which schedules a PagingVisitor to
+    // evict from the fruit collection only.
+    auto& lpNonioQ = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
+    runNextTask(lpNonioQ, "Paging out items.");
+    runNextTask(lpNonioQ, "Item pager no vbucket assigned");
+    EXPECT_LT(stats.getCollectionMemUsed(CollectionEntry::fruit), quota);
+    EXPECT_EQ(newDefaultMem,
+              stats.getCollectionMemUsed(CollectionEntry::defaultC));
+
+    // Back under quota, so mutations of the fruit collection succeed again.
+    EXPECT_FALSE(store->isCollectionOverMemQuota(CollectionEntry::fruit));
+    EXPECT_EQ(ENGINE_SUCCESS, storeItem(fruitItem));
+}
+
 /**
  * Test fixture for Ephemeral-only item pager tests.
  */
@@ -1142,6 +1223,36 @@ TEST_P(STEphemeralItemPagerTest, ReplicaNotPaged) {
     }
 }
 
+/**
+ * Test fixture for Ephemeral auto_delete by sampling (rather than visiting the
+ * whole HashTable with a PagingVisitor).
+ */
+class STEphemeralSampledItemPagerTest : public STItemPagerTest {
+protected:
+    void SetUp() override {
+        config_string += "ephemeral_auto_delete_sample_size=5;";
+        STItemPagerTest::SetUp();
+    }
+};
+
+TEST_P(STEphemeralSampledItemPagerTest, ServerQuotaReached) {
+    size_t count = populateUntilTmpFail(vbid);
+    ASSERT_GE(count, 50) << "Too few documents stored";
+
+    // Sampling deletes items from within the ItemPager task itself, no
+    // PagingVisitor task is scheduled.
+    auto& lpNonioQ = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
+    runNextTask(lpNonioQ, "Paging out items.");
+    EXPECT_EQ(initialNonIoTasks, lpNonioQ.getFutureQueueSize());
+
+    auto& stats = engine->getEpStats();
+    EXPECT_LT(stats.getPreciseTotalMemoryUsed(), stats.mem_low_wat.load())
+            << "Expected to be below low watermark after running item pager";
+    auto vb = store->getVBucket(vbid);
+    EXPECT_LT(vb->getNumItems(), count);
+    EXPECT_GT(vb->getNumItems(), 0);
+}
+
 /**
  * Test fixture for expiry pager tests - enables the Expiry Pager (in addition
  * to what the parent class does).
@@ -1277,6 +1388,49 @@ TEST_P(STExpiryPagerTest, ExpiredItemsDeleted) {
     expiredItemsDeleted();
 }
 
+// With expiry_pager_concurrency > 1 the vBuckets are divided between
+// concurrent visitor tasks, and the pager doesn't start another run until
+// all of them have completed.
+TEST_P(STExpiryPagerTest, ConcurrentVisitors) {
+    engine->getConfiguration().setExpiryPagerConcurrency(2);
+    const Vbid vbid1(1);
+    setVBucketStateAndRunPersistTask(vbid1, vbucket_state_active);
+
+    for (auto vb : {vbid, vbid1}) {
+        auto item = make_item(vb,
+                              makeStoredDocKey("key"),
+                              "value",
+                              ep_abs_time(ep_current_time() + 10));
+        ASSERT_EQ(ENGINE_SUCCESS, store->set(item, cookie));
+        flushDirectlyIfPersistent(vb,
+                                  {MoreAvailable::No, 1, WakeCkptRemover::No});
+    }
+    TimeTraveller docBrown(11);
+
+    auto& lpNonioQ = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
+    store->wakeUpExpiryPager();
+    runNextTask(lpNonioQ, "Paging expired items.");
+    EXPECT_EQ(initialNonIoTasks + 2, lpNonioQ.getFutureQueueSize());
+    runNextTask(lpNonioQ, "Expired item remover no vbucket assigned");
+    EXPECT_EQ(initialNonIoTasks + 1, lpNonioQ.getFutureQueueSize());
+
+    // One visitor is still running, so the pager doesn't start another
+    store->wakeUpExpiryPager();
+    runNextTask(lpNonioQ, "Paging expired items.");
+    EXPECT_EQ(initialNonIoTasks + 1, lpNonioQ.getFutureQueueSize());
+
+    runNextTask(lpNonioQ, "Expired item remover no vbucket assigned");
+    EXPECT_EQ(initialNonIoTasks, lpNonioQ.getFutureQueueSize());
+    for (auto vb : {vbid, vbid1}) {
+        flushDirectlyIfPersistent(vb,
+                                  {MoreAvailable::No, 1, WakeCkptRemover::Yes});
+        EXPECT_EQ(0, engine->getVBucket(vb)->getNumItems());
+    }
+
+    // Now all have completed the pager runs again
+    wakeUpExpiryPager();
+}
+
 // Test that when an expired system-xattr document is fetched with getMeta
 // it can be successfully expired again
 TEST_P(STExpiryPagerTest, MB_25650) {
@@ -1418,6 +1572,54 @@ TEST_P(STExpiryPagerTest, MB_25671) {
     EXPECT_EQ(metadata.revSeqno, item.item->getRevSeqno());
 }
 
+/**
+ * Expiry pager tests with the expiry index enabled, the pager only visits
+ * the items the index says are due.
+ */
+class STExpiryIndexPagerTest : public STExpiryPagerTest {
+protected:
+    void SetUp() override {
+        config_string += "expiry_index_enabled=true;";
+        STExpiryPagerTest::SetUp();
+    }
+
+    ExpiryIndex& getExpiryIndex() {
+        return store->getVBucket(vbid)->ht.getExpiryIndex();
+    }
+};
+
+TEST_P(STExpiryIndexPagerTest, ExpiredItemsDeleted) {
+    expiredItemsDeleted();
+
+    // All of the items were found through the index
+    EXPECT_EQ(0, engine->getEpStats().expiryPagerFullScans);
+    EXPECT_EQ(0, getExpiryIndex().getNumEntries());
+}
+
+// An index which overflowed is rebuilt by visiting the whole HashTable
+TEST_P(STExpiryIndexPagerTest, OverflowFallsBackToFullScan) {
+    getExpiryIndex().enable(1);
+    for (size_t ii = 0; ii < 2; ii++) {
+        auto item = make_item(vbid,
+                              makeStoredDocKey("key_" + std::to_string(ii)),
+                              "value",
+                              ep_abs_time(ep_current_time() + 10));
+        ASSERT_EQ(ENGINE_SUCCESS, storeItem(item));
+    }
+    flushDirectlyIfPersistent(vbid,
+                              {MoreAvailable::No, 2, WakeCkptRemover::No});
+    EXPECT_TRUE(getExpiryIndex().isOverflowed());
+
+    TimeTraveller billAndTed(11);
+    wakeUpExpiryPager();
+    flushDirectlyIfPersistent(vbid,
+                              {MoreAvailable::No, 2, WakeCkptRemover::Yes});
+
+    EXPECT_EQ(1, engine->getEpStats().expiryPagerFullScans);
+    EXPECT_EQ(0, engine->getVBucket(vbid)->getNumItems());
+    EXPECT_FALSE(getExpiryIndex().isOverflowed());
+}
+
 /**
  * Subclass for expiry tests only applicable to Value eviction persistent
  * buckets.
@@ -1721,6 +1923,11 @@ INSTANTIATE_TEST_SUITE_P(EphemeralOrPersistent,
                          STParameterizedBucketTest::allConfigValues(),
                          STParameterizedBucketTest::PrintToStringParamName);
 
+INSTANTIATE_TEST_SUITE_P(EphemeralOrPersistent,
+                         STExpiryIndexPagerTest,
+                         STParameterizedBucketTest::allConfigValues(),
+                         STParameterizedBucketTest::PrintToStringParamName);
+
 INSTANTIATE_TEST_SUITE_P(ValueOnly,
                          STValueEvictionExpiryPagerTest,
                          STValueEvictionExpiryPagerTest::configValues(),
@@ -1736,6 +1943,13 @@ INSTANTIATE_TEST_SUITE_P(Ephemeral,
                          STParameterizedBucketTest::ephConfigValues(),
                          STParameterizedBucketTest::PrintToStringParamName);
 
+INSTANTIATE_TEST_SUITE_P(
+        Ephemeral,
+        STEphemeralSampledItemPagerTest,
+        ::testing::Values(std::make_tuple(std::string("ephemeral"),
+                                          std::string("auto_delete"))),
+        STParameterizedBucketTest::PrintToStringParamName);
+
 INSTANTIATE_TEST_SUITE_P(PersistentFullValue,
                          MB_36087,
                          STParameterizedBucketTest::persistentConfigValues(),
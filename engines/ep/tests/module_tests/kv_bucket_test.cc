@@ -63,6 +63,7 @@
 #include <xattr/utils.h>
 
 #include <chrono>
+#include <set>
 #include <thread>
 
 KVBucketTest::KVBucketTest() : test_dbname(dbnameFromCurrentGTestInfo()) {
@@ -506,6 +507,39 @@ TEST_P(KVBucketParamTest, GetKeyStatsResident) {
     EXPECT_FALSE(kstats.logically_deleted);
 }
 
+// With chk_value_compression the checkpoint holds a compressed copy of the
+// value, and the HashTable keeps the value as stored
+TEST_P(KVBucketParamTest, CheckpointValueCompression) {
+    engine->getConfiguration().setChkValueCompression(true);
+
+    const auto key = makeStoredDocKey("key");
+    const std::string value(1024, 'a');
+    store_item(vbid, key, value);
+
+    auto vb = store->getVBucket(vbid);
+    {
+        auto result = vb->ht.findForRead(key);
+        ASSERT_TRUE(result.storedValue);
+        EXPECT_FALSE(mcbp::datatype::is_snappy(
+                result.storedValue->getDatatype()));
+    }
+
+    auto& ckptMgr = *vb->checkpointManager;
+    auto cursor = ckptMgr.registerCursorBySeqno("test", 0).cursor.lock();
+    ASSERT_TRUE(cursor);
+    std::vector<queued_item> items;
+    ckptMgr.getNextItemsForCursor(cursor.get(), items);
+    ASSERT_FALSE(items.empty());
+    const auto& queued = *items.back();
+    ASSERT_EQ(key, queued.getKey());
+    EXPECT_TRUE(mcbp::datatype::is_snappy(queued.getDataType()));
+    EXPECT_LT(queued.getNBytes(), value.size());
+
+    Item inflated(queued);
+    ASSERT_TRUE(inflated.decompressValue());
+    EXPECT_EQ(value, inflated.getValue()->to_s());
+}
+
 // Create then delete an item, checking we get keyWasOnDisk reporting the item
 // as deleted.
 TEST_P(KVBucketParamTest, GetKeyStatsDeleted) {
@@ -738,6 +772,104 @@ TEST_P(KVBucketParamTest, AddNMVB) {
     EXPECT_EQ(ENGINE_NOT_MY_VBUCKET, store->add(item, cookie));
 }
 
+// Counters are updated in a single step by the engine; documents it can't
+// update that way are left to the frontend.
+TEST_P(KVBucketParamTest, Arithmetic) {
+    const auto key = makeStoredDocKey("counter");
+    uint64_t result = 0;
+    uint64_t cas = 0;
+    mutation_descr_t mutation{};
+    auto arithmetic = [&](bool increment, uint64_t delta) {
+        return store->arithmetic(
+                key, vbid, increment, delta, cookie, result, cas, mutation);
+    };
+
+    // The frontend creates missing counters
+    EXPECT_EQ(ENGINE_ENOTSUP, arithmetic(true, 1));
+
+    auto item = make_item(vbid, key, "10");
+    ASSERT_EQ(ENGINE_SUCCESS, store->set(item, cookie));
+
+    EXPECT_EQ(ENGINE_SUCCESS, arithmetic(true, 5));
+    EXPECT_EQ(15, result);
+    EXPECT_NE(item.getCas(), cas);
+    EXPECT_EQ(item.getBySeqno() + 1, int64_t(mutation.seqno));
+
+    // Decrement stops at 0
+    EXPECT_EQ(ENGINE_SUCCESS, arithmetic(false, 20));
+    EXPECT_EQ(0, result);
+
+    auto gv = store->get(key, vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ("0", gv.item->getValue()->to_s());
+    EXPECT_EQ(cas, gv.item->getCas());
+
+    auto notCounter = make_item(vbid, key, "value");
+    ASSERT_EQ(ENGINE_SUCCESS, store->set(notCounter, cookie));
+    EXPECT_EQ(ENGINE_DELTA_BADVAL, arithmetic(true, 1));
+
+    EXPECT_EQ(ENGINE_NOT_MY_VBUCKET,
+              store->arithmetic(key,
+                                Vbid(vbid.get() + 1),
+                                true,
+                                1,
+                                cookie,
+                                result,
+                                cas,
+                                mutation));
+}
+
+// Append and prepend are performed by the engine in a single step, keeping
+// any xattrs in front of the body.
+TEST_P(KVBucketParamTest, AppendPrepend) {
+    const auto key = makeStoredDocKey("log");
+    uint64_t cas = 0;
+    mutation_descr_t mutation{};
+    auto appendPrepend = [&](bool append, std::string_view value) {
+        return store->appendPrepend(
+                key, vbid, append, value, cookie, cas, mutation);
+    };
+
+    // The frontend reports missing documents
+    EXPECT_EQ(ENGINE_ENOTSUP, appendPrepend(true, "x"));
+
+    auto item = make_item(vbid, key, "[1");
+    ASSERT_EQ(ENGINE_SUCCESS, store->set(item, cookie));
+    EXPECT_EQ(ENGINE_SUCCESS, appendPrepend(true, ",2"));
+    EXPECT_NE(item.getCas(), cas);
+    EXPECT_EQ(item.getBySeqno() + 1, int64_t(mutation.seqno));
+
+    auto gv = store->get(key, vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ("[1,2", gv.item->getValue()->to_s());
+    EXPECT_FALSE(mcbp::datatype::is_json(gv.item->getDataType()));
+
+    // The datatype follows the new value
+    EXPECT_EQ(ENGINE_SUCCESS, appendPrepend(true, "]"));
+    gv = store->get(key, vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ("[1,2]", gv.item->getValue()->to_s());
+    EXPECT_TRUE(mcbp::datatype::is_json(gv.item->getDataType()));
+    EXPECT_EQ(cas, gv.item->getCas());
+
+    // Prepend goes after the xattrs
+    auto xattrValue = createXattrValue("body");
+    auto xattrItem = make_item(vbid,
+                               key,
+                               xattrValue,
+                               0,
+                               PROTOCOL_BINARY_DATATYPE_XATTR);
+    ASSERT_EQ(ENGINE_SUCCESS, store->set(xattrItem, cookie));
+    EXPECT_EQ(ENGINE_SUCCESS, appendPrepend(false, "new"));
+    gv = store->get(key, vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    ASSERT_TRUE(mcbp::datatype::is_xattr(gv.item->getDataType()));
+    EXPECT_EQ("newbody",
+              std::string(cb::xattr::get_body(
+                      {gv.item->getData(), gv.item->getNBytes()})));
+    EXPECT_EQ(createXattrValue("newbody"), gv.item->getValue()->to_s());
+}
+
 // SetWithMeta tests //////////////////////////////////////////////////////////
 
 // Test basic setWithMeta
@@ -1119,6 +1251,83 @@ TEST_P(KVBucketParamTest, unlockKeyTempDeletedTest) {
     EXPECT_EQ(0, store->getVBucket(vbid)->getNumTempItems());
 }
 
+// Test that getLocked without the value locks a document whose value is
+// evicted without a background fetch, and the lock is honoured as usual
+TEST_P(KVBucketParamTest, GetLockedWithoutValue) {
+    if (!isPersistent() || isFullEviction()) {
+        GTEST_SKIP();
+    }
+    auto key = makeStoredDocKey("key");
+    store_item(vbid, key, "value");
+    flushVBucketToDiskIfPersistent(vbid, 1);
+    evict_key(vbid, key);
+
+    auto gv = store->getLocked(
+            key, vbid, ep_current_time(), 10, cookie, WantsValue::No);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(0, gv.item->getNBytes());
+    const auto cas = gv.item->getCas();
+
+    // Still locked (and not resident), whether or not the value is wanted
+    EXPECT_EQ(ENGINE_LOCKED_TMPFAIL,
+              store->getLocked(key, vbid, ep_current_time(), 10, cookie)
+                      .getStatus());
+    EXPECT_EQ(ENGINE_LOCKED_TMPFAIL,
+              store->getLocked(key,
+                               vbid,
+                               ep_current_time(),
+                               10,
+                               cookie,
+                               WantsValue::No)
+                      .getStatus());
+    auto vb = store->getVBucket(vbid);
+    {
+        auto res = vb->ht.findForRead(key);
+        ASSERT_TRUE(res.storedValue);
+        EXPECT_FALSE(res.storedValue->isResident());
+    }
+
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->unlockKey(key, vbid, cas, ep_current_time(), cookie));
+}
+
+// Test that store_multi stores a batch of items, reporting the result of
+// each of the items
+TEST_P(KVBucketParamTest, StoreMulti) {
+    auto item1 = make_item(vbid, makeStoredDocKey("key1"), "value1");
+    auto item2 = make_item(vbid, makeStoredDocKey("key2"), "value2");
+    // A collection which the vBucket doesn't know of
+    auto unknown = make_item(
+            vbid, makeStoredDocKey("key3", CollectionID(100)), "value3");
+    auto otherVb = make_item(Vbid(1), makeStoredDocKey("key4"), "value4");
+    std::vector<item*> items = {&item1, &unknown, &otherVb, &item2};
+
+    std::vector<cb::EngineErrorCasPair> results;
+    engine->store_multi(cookie, vbid, items, results);
+    ASSERT_EQ(items.size(), results.size());
+    EXPECT_EQ(cb::engine_errc::success, results[0].status);
+    EXPECT_EQ(cb::engine_errc::unknown_collection, results[1].status);
+    EXPECT_EQ(cb::engine_errc::not_my_vbucket, results[2].status);
+    EXPECT_EQ(cb::engine_errc::success, results[3].status);
+    EXPECT_NE(0, results[3].cas);
+    EXPECT_NE(results[0].cas, results[3].cas);
+
+    for (const auto& key : {"key1", "key2"}) {
+        auto gv = store->get(makeStoredDocKey(key), vbid, cookie, {});
+        ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus()) << key;
+    }
+    EXPECT_EQ(results[3].cas,
+              store->get(makeStoredDocKey("key2"), vbid, cookie, {})
+                      .item->getCas());
+
+    // The state of the vBucket applies to all of the items
+    store->setVBucketState(vbid, vbucket_state_replica);
+    engine->store_multi(cookie, vbid, {&item1, &item2}, results);
+    ASSERT_EQ(2, results.size());
+    EXPECT_EQ(cb::engine_errc::not_my_vbucket, results[0].status);
+    EXPECT_EQ(cb::engine_errc::not_my_vbucket, results[1].status);
+}
+
 // Test that getLocked correctly returns ESyncWriteInProgress if targetted at
 // a key which has a prepared SyncWrite in progress.
 TEST_P(KVBucketParamTest, GetLockedWithPreparedSyncWrite) {
@@ -1187,6 +1396,52 @@ TEST_P(KVBucketParamTest, GetAndUpdateTtlWithPreparedSyncWrite) {
     EXPECT_EQ(ENGINE_SYNC_WRITE_IN_PROGRESS, gv.getStatus());
 }
 
+// Touches extending the expiry by less than touch_expiry_tolerance should
+// leave the item (and the vBucket) unchanged; others should be applied.
+TEST_P(KVBucketParamTest, GetAndUpdateTtlWithinTolerance) {
+    engine->getConfiguration().setTouchExpiryTolerance(60);
+
+    auto key = makeStoredDocKey("key");
+    const uint32_t exptime = ep_real_time() + 3600;
+    store_item(vbid, key, "value", exptime);
+    auto vb = store->getVBucket(vbid);
+    const auto seqno = vb->getHighSeqno();
+
+    auto gv = store->getAndUpdateTtl(key, vbid, cookie, exptime + 30);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(exptime, gv.item->getExptime());
+    EXPECT_EQ(seqno, vb->getHighSeqno());
+
+    gv = store->getAndUpdateTtl(key, vbid, cookie, exptime + 60);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(exptime + 60, gv.item->getExptime());
+    EXPECT_EQ(seqno + 1, vb->getHighSeqno());
+
+    // Shortening the expiry, or removing it, is always applied
+    gv = store->getAndUpdateTtl(key, vbid, cookie, exptime + 50);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(exptime + 50, gv.item->getExptime());
+    EXPECT_EQ(seqno + 2, vb->getHighSeqno());
+
+    gv = store->getAndUpdateTtl(key, vbid, cookie, 0);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(0, gv.item->getExptime());
+    EXPECT_EQ(seqno + 3, vb->getHighSeqno());
+}
+
+TEST_P(KVBucketParamTest, IsUnderMemoryPressure) {
+    EXPECT_FALSE(store->isUnderMemoryPressure());
+    EXPECT_FALSE(engine->isUnderMemoryPressure());
+
+    const size_t size = engine->getEpStats().getMaxDataSize();
+    engine->getEpStats().setMaxDataSize(1);
+    EXPECT_TRUE(store->isUnderMemoryPressure());
+    EXPECT_TRUE(engine->isUnderMemoryPressure());
+    engine->getEpStats().setMaxDataSize(size); // undo the quota adjustment
+
+    EXPECT_FALSE(store->isUnderMemoryPressure());
+}
+
 TEST_P(KVBucketParamTest, replaceTempDeletedTest) {
     //This test is to check if the replace function will
     //remove temporary deleted items from memory
@@ -1496,6 +1751,42 @@ TEST_P(KVBucketParamTest, ReplicaExpiredItem) {
     EXPECT_EQ(ENGINE_KEY_ENOENT, result.getStatus());
 }
 
+// Test that the consistency token of a replica read fails fast if asked not to
+// wait, else waits until the vBucket reaches the seqno or the timeout passes.
+TEST_P(KVBucketParamTest, WaitForSeqno) {
+    auto key = makeStoredDocKey("key");
+    store_item(vbid, key, "value");
+    auto vb = store->getVBucket(vbid);
+    const uint64_t highSeqno = vb->getHighSeqno();
+    const auto noWait = std::chrono::milliseconds(0);
+    const auto timeout = std::chrono::seconds(60);
+
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->waitForSeqno(cookie, vbid, highSeqno, noWait));
+    EXPECT_EQ(ENGINE_TMPFAIL,
+              store->waitForSeqno(cookie, vbid, highSeqno + 1, noWait));
+
+    // Notified once the seqno is reached
+    ASSERT_EQ(ENGINE_EWOULDBLOCK,
+              store->waitForSeqno(cookie, vbid, highSeqno + 1, timeout));
+    EXPECT_EQ(1, vb->getNumSeqnoWaiters());
+    EXPECT_EQ(0, get_number_of_mock_cookie_io_notifications(cookie));
+    store_item(vbid, key, "value2");
+    EXPECT_EQ(0, vb->getNumSeqnoWaiters());
+    EXPECT_EQ(1, get_number_of_mock_cookie_io_notifications(cookie));
+
+    // Notified once the timeout has passed
+    ASSERT_EQ(ENGINE_EWOULDBLOCK,
+              store->waitForSeqno(cookie, vbid, highSeqno + 2, timeout));
+    vb->notifySeqnoWaiters(vb->getHighSeqno(),
+                           std::chrono::steady_clock::now() + timeout * 2);
+    EXPECT_EQ(0, vb->getNumSeqnoWaiters());
+    EXPECT_EQ(2, get_number_of_mock_cookie_io_notifications(cookie));
+
+    EXPECT_EQ(ENGINE_NOT_MY_VBUCKET,
+              store->waitForSeqno(cookie, Vbid(1), highSeqno, noWait));
+}
+
 /***
  * Test class to expose the behaviour needed to create an ItemAccessVisitor
  */
@@ -1564,6 +1855,41 @@ TEST_P(KVBucketParamTest, MB31495_GetRandomKey) {
     EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
 }
 
+// Check that sampleDocuments returns distinct documents, at most the number
+// requested, and every document when there are fewer than that
+TEST_P(KVBucketParamTest, SampleDocuments) {
+    std::vector<std::unique_ptr<Item>> sample;
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              store->sampleDocuments(CollectionID::Default, 5, cookie, sample));
+    EXPECT_TRUE(sample.empty());
+
+    const int numItems = 20;
+    for (int ii = 0; ii < numItems; ++ii) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(ii)), "value");
+    }
+    flushVBucketToDiskIfPersistent(vbid, numItems);
+
+    ASSERT_EQ(ENGINE_SUCCESS,
+              store->sampleDocuments(CollectionID::Default, 5, cookie, sample));
+    EXPECT_EQ(5, sample.size());
+    std::set<std::string> keys;
+    for (const auto& item : sample) {
+        EXPECT_EQ("value", item->getValue()->to_s());
+        keys.insert(item->getKey().to_string());
+    }
+    EXPECT_EQ(5, keys.size());
+
+    ASSERT_EQ(ENGINE_SUCCESS,
+              store->sampleDocuments(
+                      CollectionID::Default, 2 * numItems, cookie, sample));
+    EXPECT_EQ(numItems, sample.size());
+
+    // A collection which doesn't exist
+    EXPECT_EQ(ENGINE_UNKNOWN_COLLECTION,
+              store->sampleDocuments(CollectionID(8), 5, cookie, sample));
+    EXPECT_TRUE(sample.empty());
+}
+
 // MB-33702: Test that SetVBucket state creates a new failover table entry when
 // transitioning from non-active to active.
 TEST_P(KVBucketParamTest, FailoverEntryAddedNonActiveToActive) {
@@ -324,6 +324,37 @@ TEST_P(KVStoreParamTest, GetMultiMissNumGetFailure) {
     EXPECT_EQ(0, kvstore->getKVStoreStat().io_bgfetch_doc_bytes);
 }
 
+// A getMulti of several keys returns each of them (and only them)
+TEST_P(KVStoreParamTest, GetMultiBatch) {
+    kvstore->begin(std::make_unique<TransactionContext>(vbid));
+    for (int i = 0; i < 10; i += 2) {
+        auto qi = makeCommittedItem(makeStoredDocKey("key" + std::to_string(i)),
+                                    "value" + std::to_string(i));
+        qi->setBySeqno(i + 1);
+        kvstore->set(qi);
+    }
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    vb_bgfetch_queue_t q;
+    for (int i = 0; i < 10; i++) {
+        q[makeDiskDocKey("key" + std::to_string(i))] = vb_bgfetch_item_ctx_t{};
+    }
+    kvstore->getMulti(vbid, q);
+
+    for (int i = 0; i < 10; i++) {
+        auto& fetched = q[makeDiskDocKey("key" + std::to_string(i))];
+        if (i % 2) {
+            EXPECT_EQ(ENGINE_KEY_ENOENT, fetched.value.getStatus()) << i;
+            continue;
+        }
+        ASSERT_EQ(ENGINE_SUCCESS, fetched.value.getStatus()) << i;
+        EXPECT_EQ("value" + std::to_string(i),
+                  fetched.value.item->getValue()->to_s());
+    }
+    EXPECT_EQ(5, kvstore->getKVStoreStat().io_bg_fetch_docs_read);
+    EXPECT_EQ(0, kvstore->getKVStoreStat().numGetFailure);
+}
+
 TEST_P(KVStoreParamTest, GetRangeMissNumGetFailure) {
     std::vector<GetValue> results;
     kvstore->getRange(
@@ -1091,6 +1122,16 @@ TEST_F(RocksDBKVStoreTest, StatsTest) {
     EXPECT_TRUE(kvstore->getStat("rocksdb.block.cache.index.miss", value));
     EXPECT_TRUE(kvstore->getStat("rocksdb.block.cache.filter.hit", value));
     EXPECT_TRUE(kvstore->getStat("rocksdb.block.cache.filter.miss", value));
+    EXPECT_TRUE(kvstore->getStat("block_cache_usage", value));
+    EXPECT_TRUE(kvstore->getStat("block_cache_pinned_usage", value));
+    EXPECT_TRUE(kvstore->getStat("block_cache_capacity", value));
+    EXPECT_NE(0, value);
+
+    // Bloom filter
+    EXPECT_TRUE(kvstore->getStat("rocksdb.bloom.filter.useful", value));
+    EXPECT_TRUE(kvstore->getStat("rocksdb.bloom.filter.full.positive", value));
+    EXPECT_TRUE(
+            kvstore->getStat("rocksdb.bloom.filter.full.true.positive", value));
 
     // Disk Usage per-CF
     EXPECT_TRUE(kvstore->getStat("default_kTotalSstFilesSize", value));
@@ -39,6 +39,7 @@ protected:
         if (rollbackTest) {
             configStr += ";" + magmaRollbackConfig;
         }
+        configStr += extraConfig;
         Configuration config;
         config.parseConfiguration(configStr.c_str(), get_mock_server_api());
         WorkLoadPolicy workload(config.getMaxNumWorkers(),
@@ -59,6 +60,9 @@ protected:
         rollbackTest = true;
     }
 
+    /// Appended to the configuration of the kvstore
+    std::string extraConfig;
+
 private:
     bool rollbackTest{false};
 };
@@ -71,6 +75,72 @@ protected:
     }
 };
 
+class MagmaKVStorePipelinedCommitTest : public MagmaKVStoreTest {
+protected:
+    void SetUp() override {
+        extraConfig = ";magma_pipelined_commit=true";
+        MagmaKVStoreTest::SetUp();
+        initialize_kv_store(kvstore.get(), Vbid(1));
+    }
+
+    /// Begin a transaction for vb and set a single item in it
+    MockTransactionContext& setOne(Vbid vb, int64_t seqno) {
+        auto tc = std::make_unique<MockTransactionContext>(vb);
+        auto& mockTC = *tc;
+        kvstore->begin(std::move(tc));
+        auto qi = makeCommittedItem(makeStoredDocKey("key"), "value");
+        qi->setBySeqno(seqno);
+        kvstore->set(qi);
+        return mockTC;
+    }
+};
+
+// The commits of a group return once handed to the commit thread; the
+// persistence callbacks are invoked by endGroupCommit().
+TEST_F(MagmaKVStorePipelinedCommitTest, GroupCommit) {
+    ASSERT_TRUE(kvstore->supportsGroupCommit());
+
+    kvstore->beginGroupCommit();
+    VB::Commit flush0(manifest);
+    auto& tc0 = setOne(Vbid(0), 1);
+    EXPECT_CALL(tc0, setCallback(_, KVStore::FlushStateMutation::Insert))
+            .Times(1);
+    EXPECT_TRUE(kvstore->commit(flush0));
+
+    VB::Commit flush1(manifest);
+    auto& tc1 = setOne(Vbid(1), 2);
+    EXPECT_CALL(tc1, setCallback(_, KVStore::FlushStateMutation::Insert))
+            .Times(1);
+    EXPECT_TRUE(kvstore->commit(flush1));
+    EXPECT_EQ(2, flush1.proposedVBState.highSeqno);
+
+    EXPECT_TRUE(kvstore->endGroupCommit());
+
+    EXPECT_EQ(ENGINE_SUCCESS,
+              kvstore->get(makeDiskDocKey("key"), Vbid(0)).getStatus());
+    EXPECT_EQ(ENGINE_SUCCESS,
+              kvstore->get(makeDiskDocKey("key"), Vbid(1)).getStatus());
+}
+
+// A failed write fails the whole group.
+TEST_F(MagmaKVStorePipelinedCommitTest, GroupCommitFailure) {
+    kvstore->saveDocsErrorInjector = [](VB::Commit& cmt,
+                                        kvstats_ctx& ctx) -> int {
+        return magma::Status::IOError;
+    };
+
+    kvstore->beginGroupCommit();
+    VB::Commit flush0(manifest);
+    auto& tc0 = setOne(Vbid(0), 1);
+    EXPECT_CALL(tc0, setCallback(_, KVStore::FlushStateMutation::Failed))
+            .Times(1);
+    EXPECT_TRUE(kvstore->commit(flush0));
+
+    EXPECT_FALSE(kvstore->endGroupCommit());
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              kvstore->get(makeDiskDocKey("key"), Vbid(0)).getStatus());
+}
+
 TEST_F(MagmaKVStoreRollbackTest, Rollback) {
     uint64_t seqno = 1;
 
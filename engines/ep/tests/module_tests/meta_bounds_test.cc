@@ -0,0 +1,84 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "meta_bounds.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <folly/portability/GTest.h>
+
+class MetaBoundsTest : public ::testing::Test {};
+
+TEST_F(MetaBoundsTest, ZeroSizeIsRejected) {
+    EXPECT_THROW(MetaBounds(0), std::invalid_argument);
+}
+
+TEST_F(MetaBoundsTest, InitiallyZero) {
+    MetaBounds bounds(16);
+    auto b = bounds.get(makeStoredDocKey("key"));
+    EXPECT_EQ(0, b.cas);
+    EXPECT_EQ(0, b.revSeqno);
+}
+
+// The bounds only ever increase, each field independently
+TEST_F(MetaBoundsTest, AddKeepsMaximum) {
+    MetaBounds bounds(1);
+    auto key = makeStoredDocKey("key");
+    bounds.add(key, 10, 5);
+    bounds.add(key, 20, 2);
+    bounds.add(key, 15, 3);
+
+    auto b = bounds.get(key);
+    EXPECT_EQ(20, b.cas);
+    EXPECT_EQ(5, b.revSeqno);
+
+    // With a single slot every key shares the bounds
+    b = bounds.get(makeStoredDocKey("other"));
+    EXPECT_EQ(20, b.cas);
+    EXPECT_EQ(5, b.revSeqno);
+}
+
+TEST_F(MetaBoundsTest, SerialiseRoundTrip) {
+    MetaBounds bounds(64);
+    for (int ii = 0; ii < 100; ++ii) {
+        bounds.add(makeStoredDocKey("key_" + std::to_string(ii)),
+                   1000 + ii,
+                   ii);
+    }
+
+    auto restored = MetaBounds::deserialise(bounds.serialise());
+    ASSERT_TRUE(restored);
+    EXPECT_EQ(bounds.getSize(), restored->getSize());
+    for (int ii = 0; ii < 100; ++ii) {
+        auto key = makeStoredDocKey("key_" + std::to_string(ii));
+        EXPECT_EQ(bounds.get(key).cas, restored->get(key).cas);
+        EXPECT_EQ(bounds.get(key).revSeqno, restored->get(key).revSeqno);
+    }
+}
+
+TEST_F(MetaBoundsTest, DeserialiseRejectsInvalidData) {
+    MetaBounds bounds(8);
+    const auto data = bounds.serialise();
+
+    EXPECT_THROW(MetaBounds::deserialise({}), std::invalid_argument);
+    // Truncated
+    EXPECT_THROW(MetaBounds::deserialise({data.data(), data.size() - 1}),
+                 std::invalid_argument);
+    // Bad magic
+    auto corrupt = data;
+    corrupt[0] ^= 0xff;
+    EXPECT_THROW(MetaBounds::deserialise(corrupt), std::invalid_argument);
+}
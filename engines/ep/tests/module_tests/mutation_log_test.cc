@@ -539,8 +539,9 @@ public:
 };
 
 TEST_F(MutationLogTest, upgrade) {
-    // Craft a V1 format file
-    LogHeaderBlock headerBlock(MutationLogVersion::V1);
+    // Craft a V1 format file (which predates Crc32c)
+    LogHeaderBlock headerBlock(MutationLogVersion::V1,
+                               MutationLogChecksum::Crc32);
     headerBlock.set(MIN_LOG_HEADER_SIZE);
     const auto* ptr = reinterpret_cast<uint8_t*>(&headerBlock);
 
@@ -629,6 +630,61 @@ TEST_F(MutationLogTest, upgrade) {
     }
 }
 
+// New logs checksum their blocks with Crc32c, logs written with Crc32 keep
+// using it when appended to
+TEST_F(MutationLogTest, BlockChecksum) {
+    auto readChecksum = [this]() {
+        std::array<uint8_t, MIN_LOG_HEADER_SIZE> buf;
+        std::ifstream logFile(tmp_log_filename, std::ios::binary);
+        logFile.read(reinterpret_cast<char*>(buf.data()), buf.size());
+        LogHeaderBlock header;
+        header.set(buf);
+        return header.checksum();
+    };
+    auto writeAndRead = [this](const std::string& key) {
+        {
+            MutationLog ml(tmp_log_filename.c_str());
+            ml.open();
+            ml.newItem(Vbid(0), makeStoredDocKey(key));
+            ml.commit1();
+            ml.commit2();
+        }
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open(true);
+        std::set<StoredDocKey> keys;
+        for (const auto& entry : ml) {
+            if (entry->type() == MutationLogType::New) {
+                keys.emplace(entry->key());
+            }
+        }
+        return keys;
+    };
+
+    EXPECT_EQ(std::set<StoredDocKey>{makeStoredDocKey("key1")},
+              writeAndRead("key1"));
+    EXPECT_EQ(MutationLogChecksum::Crc32c, readChecksum());
+
+    // Craft an empty log with the legacy checksum
+    cb::io::rmrf(tmp_log_filename);
+    LogHeaderBlock headerBlock(MutationLogVersion::Current,
+                               MutationLogChecksum::Crc32);
+    headerBlock.set(MIN_LOG_HEADER_SIZE);
+    const auto* ptr = reinterpret_cast<uint8_t*>(&headerBlock);
+    std::vector<uint8_t> toWrite(ptr, ptr + sizeof(LogHeaderBlock));
+    toWrite.resize(MIN_LOG_HEADER_SIZE);
+    {
+        std::ofstream logFile(tmp_log_filename,
+                              std::ios::out | std::ofstream::binary);
+        std::copy(toWrite.begin(),
+                  toWrite.end(),
+                  std::ostreambuf_iterator<char>(logFile));
+    }
+
+    EXPECT_EQ(std::set<StoredDocKey>{makeStoredDocKey("key2")},
+              writeAndRead("key2"));
+    EXPECT_EQ(MutationLogChecksum::Crc32, readChecksum());
+}
+
 // matcher testing a DocKey against an expected key (std::string)
 MATCHER_P(_key, expected, "") {
     auto key =
@@ -16,10 +16,14 @@
  */
 
 #include "common.h"
+#include "lock_profiler.h"
 #include "lock_timer.h"
 #include "locks.h"
 #include <folly/portability/GTest.h>
 #include <iostream>
+#include <future>
+#include <map>
+#include <string>
 #include <thread>
 
 TEST(LockTimerTest, LockHolder) {
@@ -29,3 +33,63 @@ TEST(LockTimerTest, LockHolder) {
         std::this_thread::sleep_for(std::chrono::milliseconds(2));
     }
 }
+
+static std::map<std::string, std::string> getLockProfile(
+        const LockProfiler& profiler) {
+    std::map<std::string, std::string> stats;
+    profiler.addStats(
+            [&stats](std::string_view key, std::string_view value, auto) {
+                stats[std::string(key)] = std::string(value);
+            },
+            &stats);
+    return stats;
+}
+
+TEST(LockProfilerTest, DisabledRecordsNothing) {
+    LockProfiler profiler;
+    std::mutex m;
+    {
+        ProfiledLockHolder lh(m, profiler, LockProfiler::Lock::CheckpointQueue);
+    }
+    auto stats = getLockProfile(profiler);
+    EXPECT_EQ("false", stats["lock_profiler_enabled"]);
+    EXPECT_EQ("0", stats["checkpoint_queue:acquisitions"]);
+}
+
+TEST(LockProfilerTest, RecordsContendedSite) {
+    LockProfiler profiler;
+    profiler.setEnabled(true);
+    std::mutex m;
+    {
+        ProfiledLockHolder lh(m, profiler, LockProfiler::Lock::CheckpointQueue);
+    }
+
+    // Hold the lock from another thread so the next acquisition waits
+    std::promise<void> locked;
+    std::thread holder([&m, &locked, &profiler]() {
+        ProfiledLockHolder lh(m, profiler, LockProfiler::Lock::HashTableBucket);
+        locked.set_value();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    locked.get_future().wait();
+    {
+        ProfiledLockHolder lh(
+                m, profiler, LockProfiler::Lock::CheckpointQueue, "waiter");
+    }
+    holder.join();
+
+    auto stats = getLockProfile(profiler);
+    EXPECT_EQ("true", stats["lock_profiler_enabled"]);
+    EXPECT_EQ("2", stats["checkpoint_queue:acquisitions"]);
+    EXPECT_EQ("1", stats["checkpoint_queue:contended"]);
+    EXPECT_EQ("1", stats["checkpoint_queue:site:waiter:contended"]);
+    EXPECT_LT(0,
+              std::stoul(stats["checkpoint_queue:site:waiter:wait_time_us"]));
+    EXPECT_EQ("1", stats["hash_table_bucket:acquisitions"]);
+    EXPECT_EQ("0", stats["hash_table_bucket:contended"]);
+
+    profiler.reset();
+    stats = getLockProfile(profiler);
+    EXPECT_EQ("0", stats["checkpoint_queue:acquisitions"]);
+    EXPECT_EQ(0, stats.count("checkpoint_queue:site:waiter:contended"));
+}
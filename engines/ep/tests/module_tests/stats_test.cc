@@ -29,6 +29,7 @@
 #include "kv_bucket.h"
 #include "statistics/collector.h"
 #include "statistics/labelled_collector.h"
+#include "statistics/prometheus_text_collector.h"
 #include "tasks.h"
 #include "test_helpers.h"
 #include "tests/mock/mock_stat_collector.h"
@@ -44,6 +45,8 @@
 #include <statistics/units.h>
 
 #include <functional>
+#include <set>
+#include <sstream>
 #include <thread>
 
 void StatTest::SetUp() {
@@ -551,6 +554,157 @@ TEST_F(StatTest, StringStats) {
     engine->doEngineStats(collector);
 }
 
+// The aggregated vBucket stats are reused for vbucket_stats_cache_ttl_ms
+TEST_F(StatTest, AggregatedVBucketStatsCached) {
+    engine->getConfiguration().setVbucketStatsCacheTtlMs(3600 * 1000);
+    auto vals = get_stat(nullptr);
+    EXPECT_EQ("0", vals["curr_items"]);
+
+    store_item(vbid, makeStoredDocKey("key"), "value");
+    vals = get_stat(nullptr);
+    EXPECT_EQ("0", vals["curr_items"]);
+
+    // Disabling the cache visits the vBuckets again
+    engine->getConfiguration().setVbucketStatsCacheTtlMs(0);
+    vals = get_stat(nullptr);
+    EXPECT_EQ("1", vals["curr_items"]);
+}
+
+TEST_F(StatTest, TaskTimingPrometheusStats) {
+    // Confirm that per-task scheduling and runtime histograms are added to
+    // the high cardinality Prometheus stats, labelled with the task name and
+    // type - and only for tasks which have recorded a value.
+
+    using namespace std::string_view_literals;
+    using namespace testing;
+
+    NiceMock<MockStatCollector> collector;
+
+    // Ignore all stats except the task timings.
+    EXPECT_CALL(collector, addStat(_, Matcher<const HistogramData&>(_), _))
+            .Times(AnyNumber());
+
+    auto& stats = engine->getEpStats();
+    for (TaskId id : GlobalTask::allTaskIds) {
+        stats.schedulingHisto[static_cast<int>(id)].reset();
+        stats.taskRuntimeHisto[static_cast<int>(id)].reset();
+    }
+    const auto flusher = static_cast<int>(TaskId::FlusherTask);
+    stats.schedulingHisto[flusher].add(std::chrono::microseconds(15000));
+    stats.taskRuntimeHisto[flusher].add(std::chrono::microseconds(200));
+
+    const auto flusherLabels =
+            AllOf(Contains(Pair("task"sv, "FlusherTask"sv)),
+                  Contains(Pair("type"sv, "Writer"sv)));
+    EXPECT_CALL(collector,
+                addStat(StatDefNameMatcher("task_scheduling_time"),
+                        Matcher<const HistogramData&>(
+                                Field(&HistogramData::sampleCount, 1)),
+                        flusherLabels));
+    EXPECT_CALL(collector,
+                addStat(StatDefNameMatcher("task_runtime"),
+                        Matcher<const HistogramData&>(
+                                Field(&HistogramData::sampleCount, 1)),
+                        flusherLabels));
+    // Tasks which have never run are not reported.
+    EXPECT_CALL(collector,
+                addStat(_,
+                        Matcher<const HistogramData&>(_),
+                        Contains(Pair("task"sv, "ItemPager"sv))))
+            .Times(0);
+
+    engine->get_prometheus_stats(collector, cb::prometheus::Cardinality::High);
+}
+
+TEST_F(StatTest, PrometheusTextCollector) {
+    // Confirm that the engine's Prometheus stats are written in the text
+    // exposition format, in chunks of at least ChunkSize (except the last).
+    std::vector<std::string> chunks;
+    {
+        PrometheusTextStatCollector collector(
+                [&chunks](std::string_view chunk) {
+                    chunks.emplace_back(chunk);
+                });
+        auto labelled = collector.withLabels({{"bucket", "default"}});
+        engine->get_prometheus_stats(labelled,
+                                     cb::prometheus::Cardinality::Low);
+        engine->get_prometheus_stats(labelled,
+                                     cb::prometheus::Cardinality::High);
+    }
+
+    ASSERT_FALSE(chunks.empty());
+    std::string text;
+    for (size_t ii = 0; ii < chunks.size(); ++ii) {
+        if (ii + 1 < chunks.size()) {
+            EXPECT_GE(chunks[ii].size(),
+                      PrometheusTextStatCollector::ChunkSize);
+        }
+        text += chunks[ii];
+    }
+    ASSERT_EQ('\n', text.back());
+
+    std::set<std::string> families;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.rfind("# TYPE ", 0) == 0) {
+            // Each family has a single TYPE
+            const auto name = line.substr(7, line.find(' ', 7) - 7);
+            EXPECT_TRUE(families.insert(name).second) << line;
+            continue;
+        }
+        EXPECT_EQ(0, line.rfind("kv_", 0)) << line;
+        EXPECT_NE(std::string::npos, line.find(R"(bucket="default")"))
+                << line;
+    }
+    EXPECT_FALSE(families.empty());
+}
+
+TEST(MemoryCounterTest, MergesOnceOverThreshold) {
+    std::atomic<int64_t> merged{0};
+    std::atomic<int64_t> threshold{100};
+    MemoryCounter counter;
+    counter.fetch_add(10);
+    // The changes made before the target is set are merged with it
+    counter.setMergeTarget(&merged, &threshold);
+    EXPECT_EQ(10, merged);
+
+    counter.fetch_add(60);
+    counter.fetch_sub(20);
+    EXPECT_EQ(50, counter.load());
+    EXPECT_EQ(10, merged);
+
+    // Over the threshold, all of the pending changes are merged
+    counter.fetch_add(70);
+    EXPECT_EQ(120, counter.load());
+    EXPECT_EQ(120, merged);
+
+    counter = 0;
+    EXPECT_EQ(0, counter.load());
+    EXPECT_EQ(0, merged);
+}
+
+TEST(MemoryCounterTest, EPStatsMergedMemoryUsedLagIsBounded) {
+    EPStats stats;
+    const size_t quota = 100 * 1024 * 1024;
+    stats.setMemUsedMergeThreshold(quota, 1.0);
+    const size_t cores = std::distance(stats.coreLocal.begin(),
+                                       stats.coreLocal.end());
+    const size_t maxLag = quota / 100 / cores;
+
+    // 10MB in total, more than the 1MB all of the cores may lag by
+    const auto before = stats.getMergedMemoryUsed();
+    for (int ii = 0; ii < 10000; ++ii) {
+        stats.coreLocal.get()->memOverhead.fetch_add(1024);
+        const auto precise = stats.getCurrentSize() + stats.getMemOverhead();
+        const auto merged = stats.getMergedMemoryUsed();
+        ASSERT_LE(merged, precise);
+        // This thread only updates one core (at a time)
+        ASSERT_LE(precise - merged, maxLag * cores);
+    }
+    EXPECT_LT(before, stats.getMergedMemoryUsed());
+}
+
 TEST_P(DatatypeStatTest, datatypesInitiallyZero) {
     // Check that the datatype stats initialise to 0
     auto vals = get_stat(nullptr);
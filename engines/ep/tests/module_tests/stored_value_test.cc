@@ -500,3 +500,95 @@ TYPED_TEST(StoredValueProtectedTest, MB_32835) {
 
     EXPECT_EQ(*this->sv, *sv2);
 }
+
+/**
+ * Test fixture for the StoredValues with an inline value buffer.
+ */
+class InlineStoredValueTest : public ::testing::Test {
+public:
+    InlineStoredValueTest() : factory(stats, 64) {
+    }
+
+    StoredValue::UniquePtr makeStoredValue(const std::string& value) {
+        return factory(make_item(Vbid(0), makeStoredDocKey("key"), value),
+                       {});
+    }
+
+    EPStats stats;
+    StoredValueFactory factory;
+};
+
+TEST_F(InlineStoredValueTest, SmallValueInline) {
+    auto sv = makeStoredValue("value");
+    ASSERT_TRUE(sv->hasInlineValue());
+    EXPECT_EQ("value", sv->getValue()->to_s());
+    EXPECT_EQ(1, sv->getValue().refCount());
+
+    // The buffer leaves some room for the value to grow
+    EXPECT_EQ(StoredValue::getRequiredStorage(makeStoredDocKey("key"), 8),
+              sv->getObjectSize());
+    EXPECT_EQ(sv->getObjectSize(), sv->size());
+}
+
+TEST_F(InlineStoredValueTest, LargeValueNotInline) {
+    auto sv = makeStoredValue(std::string(65, 'x'));
+    EXPECT_FALSE(sv->hasInlineValue());
+    EXPECT_EQ(StoredValue::getRequiredStorage(makeStoredDocKey("key")),
+              sv->getObjectSize());
+
+    StoredValueFactory noInline(stats);
+    sv = noInline(make_item(Vbid(0), makeStoredDocKey("key"), "value"), {});
+    EXPECT_FALSE(sv->hasInlineValue());
+}
+
+// The Items created from the StoredValue get a copy of an inline value, as
+// they may outlive the StoredValue
+TEST_F(InlineStoredValueTest, ToItemCopiesValue) {
+    auto sv = makeStoredValue("value");
+    auto item = sv->toItem(Vbid(0));
+    EXPECT_NE(sv->getValue().get().get(), item->getValue().get().get());
+    EXPECT_FALSE(item->getValue()->isInline());
+
+    sv.reset();
+    EXPECT_EQ("value", item->getValue()->to_s());
+}
+
+TEST_F(InlineStoredValueTest, SetValueInPlace) {
+    auto sv = makeStoredValue("1234");
+    const auto* buffer = sv->getValue().get().get();
+
+    sv->setValue(make_item(Vbid(0), makeStoredDocKey("key"), "12345"));
+    EXPECT_EQ(buffer, sv->getValue().get().get());
+    EXPECT_EQ("12345", sv->getValue()->to_s());
+
+    // Doesn't fit in the buffer
+    sv->setValue(make_item(Vbid(0), makeStoredDocKey("key"), "123456789"));
+    EXPECT_FALSE(sv->hasInlineValue());
+    EXPECT_EQ("123456789", sv->getValue()->to_s());
+
+    sv->setValue(make_item(Vbid(0), makeStoredDocKey("key"), "123"));
+    EXPECT_EQ(buffer, sv->getValue().get().get());
+    EXPECT_EQ("123", sv->getValue()->to_s());
+}
+
+// An inline value still referenced isn't overwritten
+TEST_F(InlineStoredValueTest, SetValueReferenced) {
+    auto sv = makeStoredValue("value");
+    const auto value = sv->getValue();
+
+    sv->setValue(make_item(Vbid(0), makeStoredDocKey("key"), "other"));
+    EXPECT_FALSE(sv->hasInlineValue());
+    EXPECT_EQ("other", sv->getValue()->to_s());
+    EXPECT_EQ("value", value->to_s());
+}
+
+TEST_F(InlineStoredValueTest, CopyStoredValue) {
+    auto sv = makeStoredValue("value");
+    auto copy = factory.copyStoredValue(*sv, {});
+    ASSERT_TRUE(copy->hasInlineValue());
+    EXPECT_EQ(1, sv->getValue().refCount());
+    EXPECT_EQ(sv->getObjectSize(), copy->getObjectSize());
+
+    sv.reset();
+    EXPECT_EQ("value", copy->getValue()->to_s());
+}
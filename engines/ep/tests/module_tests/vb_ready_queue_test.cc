@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "vb_ready_queue.h"
+
+#include <folly/portability/GTest.h>
+
+#include <thread>
+#include <vector>
+
+class VBReadyQueueTest : public ::testing::Test {
+public:
+    VBReadyQueue queue{1024};
+};
+
+TEST_F(VBReadyQueueTest, initAssumptions) {
+    EXPECT_EQ(0u, queue.size());
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.exists(Vbid(0)));
+}
+
+TEST_F(VBReadyQueueTest, pushUniqueRejectsDuplicates) {
+    EXPECT_TRUE(queue.pushUnique(Vbid(1)));
+    EXPECT_FALSE(queue.pushUnique(Vbid(2)));
+    EXPECT_FALSE(queue.pushUnique(Vbid(1)));
+    EXPECT_EQ(2u, queue.size());
+    EXPECT_TRUE(queue.exists(Vbid(1)));
+    EXPECT_TRUE(queue.exists(Vbid(2)));
+
+    Vbid vbid;
+    ASSERT_TRUE(queue.popFront(vbid));
+    EXPECT_EQ(Vbid(1), vbid);
+    EXPECT_FALSE(queue.exists(Vbid(1)));
+    ASSERT_TRUE(queue.popFront(vbid));
+    EXPECT_EQ(Vbid(2), vbid);
+    EXPECT_FALSE(queue.popFront(vbid));
+    EXPECT_TRUE(queue.empty());
+
+    // Once popped a vBucket can be queued again.
+    EXPECT_TRUE(queue.pushUnique(Vbid(1)));
+}
+
+TEST_F(VBReadyQueueTest, clear) {
+    for (uint16_t vb = 0; vb < 1024; ++vb) {
+        queue.pushUnique(Vbid(vb));
+    }
+    EXPECT_EQ(1024u, queue.size());
+    queue.clear();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.exists(Vbid(0)));
+    EXPECT_FALSE(queue.exists(Vbid(1023)));
+}
+
+TEST_F(VBReadyQueueTest, outOfRangeVbid) {
+    EXPECT_THROW(queue.pushUnique(Vbid(1024)), std::out_of_range);
+}
+
+/// Many writers concurrently pushing overlapping vBuckets while a single
+/// consumer drains the queue; each vBucket must be seen at most once per
+/// drain and every vBucket must have been seen by the end.
+TEST_F(VBReadyQueueTest, ConcurrentPushUnique) {
+    const int numWriters = 8;
+    const int iterations = 10000;
+    std::atomic<bool> writersDone{false};
+    std::vector<std::thread> writers;
+    for (int w = 0; w < numWriters; ++w) {
+        writers.emplace_back([this, w]() {
+            for (int ii = 0; ii < iterations; ++ii) {
+                queue.pushUnique(Vbid((w * iterations + ii) % 1024));
+            }
+        });
+    }
+
+    std::vector<bool> seen(1024);
+    auto drain = [this, &seen]() {
+        Vbid vbid;
+        while (queue.popFront(vbid)) {
+            seen[vbid.get()] = true;
+        }
+    };
+    std::thread consumer([&]() {
+        while (!writersDone) {
+            drain();
+        }
+    });
+
+    for (auto& t : writers) {
+        t.join();
+    }
+    writersDone = true;
+    consumer.join();
+    drain();
+
+    EXPECT_TRUE(queue.empty());
+    for (size_t vb = 0; vb < seen.size(); ++vb) {
+        EXPECT_TRUE(seen[vb]) << "vb:" << vb;
+    }
+}
@@ -2426,6 +2426,38 @@ TEST_P(VBucketDurabilityTest, ActiveDM_DoubleSetVBState) {
     }
 }
 
+// Test that the SyncWrites completed by a single seqno ack are committed as a
+// batch, notifying all of their clients with a single callback (in seqno
+// order).
+TEST_P(VBucketDurabilityTest, ActiveDM_CommitBatchNotifiesOnce) {
+    std::vector<SyncWriteCompletions> batches;
+    vbucket->setSyncWriteCompleteBatchCallback(
+            [&batches](const SyncWriteCompletions& toNotify) {
+                batches.push_back(toNotify);
+            });
+
+    auto& adm = VBucketTestIntrospector::public_getActiveDM(*vbucket);
+    const std::vector<SyncWriteSpec> seqnos{1, 2, 3};
+    testAddPrepare(seqnos);
+    adm.checkForCommit();
+    ASSERT_EQ(seqnos.back().seqno, adm.getHighPreparedSeqno());
+
+    adm.seqnoAckReceived(replica1, seqnos.back().seqno);
+    vbucket->processResolvedSyncWrites();
+
+    EXPECT_EQ(0, adm.getNumTracked());
+    EXPECT_EQ(seqnos.back().seqno, adm.getHighCompletedSeqno());
+    // The per-cookie callback is not used
+    EXPECT_EQ(SWCompleteTrace(0 /*count*/, nullptr, ENGINE_EINVAL),
+              swCompleteTrace);
+    ASSERT_EQ(1, batches.size());
+    ASSERT_EQ(seqnos.size(), batches.front().size());
+    for (const auto& entry : batches.front()) {
+        EXPECT_EQ(cookie, entry.first);
+        EXPECT_EQ(ENGINE_SUCCESS, entry.second);
+    }
+}
+
 TEST_P(EPVBucketDurabilityTest,
        ActiveDM_SecondChainNodeWriteSeqnoMaintainedOntopologyChange) {
     // Set a topology with 2 chains - i.e. approaching the end of a replica swap
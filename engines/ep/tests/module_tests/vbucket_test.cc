@@ -294,12 +294,14 @@ bool VBucketTestBase::public_deleteStoredValue(const DocKey& key) {
 }
 
 std::pair<MutationStatus, GetValue> VBucketTestBase::public_getAndUpdateTtl(
-        const DocKey& key, time_t exptime) {
+        const DocKey& key,
+        time_t exptime,
+        std::chrono::seconds touchTolerance) {
     // Need to take the collections read handle before the hbl
     auto cHandle = vbucket->lockCollections(key);
     auto hbl = lockAndFind(StoredDocKey(key));
     return vbucket->processGetAndUpdateTtl(
-            hbl.first, hbl.second, exptime, cHandle);
+            hbl.first, hbl.second, exptime, cHandle, touchTolerance);
 }
 
 bool operator==(const SWCompleteTrace& lhs, const SWCompleteTrace& rhs) {
@@ -117,7 +117,9 @@ protected:
     bool public_deleteStoredValue(const DocKey& key);
 
     std::pair<MutationStatus, GetValue> public_getAndUpdateTtl(
-            const DocKey& key, time_t exptime);
+            const DocKey& key,
+            time_t exptime,
+            std::chrono::seconds touchTolerance = std::chrono::seconds{0});
 
     SWCompleteTrace swCompleteTrace;
 
@@ -27,6 +27,7 @@
 #include <map>
 
 std::stringstream prototypes;
+std::stringstream members;
 std::stringstream initialization;
 std::stringstream implementation;
 std::stringstream stat_definitions;
@@ -402,9 +403,23 @@ static void generate(const nlohmann::json& params, const std::string& key) {
     std::string validator = getValidator(key, json);
     std::string requirements = getRequirements(key, json, params);
 
+    // Scalar parameters are mirrored into an atomic member, so their getters
+    // don't need to take the Configuration mutex.
+    const bool cached = type != "std::string";
+
     // Generate prototypes
-    prototypes << "    " << type << " " << getGetterPrefix(type) << cppName
-               << "() const;" << std::endl;
+    if (cached) {
+        prototypes << "    " << type << " " << getGetterPrefix(type) << cppName
+                   << "() const {" << std::endl
+                   << "        return cached" << cppName
+                   << ".load(std::memory_order_relaxed);" << std::endl
+                   << "    }" << std::endl;
+        members << "    std::atomic<" << type << "> cached" << cppName << "{};"
+                << std::endl;
+    } else {
+        prototypes << "    " << type << " " << getGetterPrefix(type) << cppName
+                   << "() const;" << std::endl;
+    }
     const auto dynamic = !isReadOnly(json);
 
     if (dynamic) {
@@ -420,6 +435,10 @@ static void generate(const nlohmann::json& params, const std::string& key) {
         initialization << type << "(" << defaultVal << "), ";
     }
     initialization << dynamic << ");" << std::endl;
+    if (cached) {
+        initialization << "    addCache(\"" << key << "\", cached" << cppName
+                       << ");" << std::endl;
+    }
 
     if (!validator.empty()) {
         initialization << "    setValueValidator(\"" << key << "\", "
@@ -436,13 +455,15 @@ static void generate(const nlohmann::json& params, const std::string& key) {
         }
     }
 
-    // Generate the getter
-    implementation << type << " Configuration::" << getGetterPrefix(type)
-                   << cppName << "() const {" << std::endl
-                   << "    return "
-                   << "getParameter<" << datatypes[type] << ">(\"" << key
-                   << "\");" << std::endl
-                   << "}" << std::endl;
+    // Generate the getter (of a parameter without an atomic copy)
+    if (!cached) {
+        implementation << type << " Configuration::" << getGetterPrefix(type)
+                       << cppName << "() const {" << std::endl
+                       << "    return "
+                       << "getParameter<" << datatypes[type] << ">(\"" << key
+                       << "\");" << std::endl
+                       << "}" << std::endl;
+    }
 
     if (!isReadOnly(json)) {
         // generate the setter
@@ -511,7 +532,10 @@ int main(int argc, char **argv) {
         std::cerr << "Unable to create header file : " << header << std::endl;
         return 1;
     }
-    headerfile << prototypes.str();
+    headerfile << prototypes.str() << std::endl
+               << "private:" << std::endl
+               << members.str() << std::endl
+               << "public:" << std::endl;
     headerfile.close();
 
     std::ofstream implfile(source);
@@ -353,6 +353,11 @@ public:
         }
     }
 
+    void prefetch(gsl::not_null<const void*> cookie,
+                  const std::vector<std::pair<Vbid, DocKey>>& keys) override {
+        real_engine->prefetch(cookie, keys);
+    }
+
     cb::EngineErrorItemPair get_if(
             gsl::not_null<const void*> cookie,
             const DocKey& key,
@@ -719,6 +724,10 @@ public:
         return real_engine->getMinCompressionRatio();
     }
 
+    bool isUnderMemoryPressure() override {
+        return real_engine->isUnderMemoryPressure();
+    }
+
     ///////////////////////////////////////////////////////////////////////////
     //             All of the methods used in the DCP interface              //
     //                                                                       //
@@ -21,6 +21,7 @@
 #include <cbsasl/domain.h>
 #include <cbsasl/error.h>
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <utility>
@@ -66,6 +67,24 @@ void set_hmac_iteration_count(int count);
  */
 void set_scramsha_fallback_salt(const std::string& salt);
 
+/**
+ * Set the number of users the SCRAM server keeps the keys derived from
+ * their salted password cached for (0 disables the cache). The entries
+ * are only added once the user authenticated successfully.
+ */
+void set_scram_key_cache_size(size_t size);
+
+struct KeyCacheStats {
+    size_t capacity;
+    size_t size;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+/// Get the statistics of the SCRAM key cache
+KeyCacheStats get_scram_key_cache_stats();
+
 class ServerContext;
 
 class MechanismBackend {
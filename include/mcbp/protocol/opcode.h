@@ -142,6 +142,7 @@ enum class ClientOpcode : uint8_t {
     DcpAbort = 0x63,
     DcpSeqnoAdvanced = 0x64,
     DcpOsoSnapshot = 0x65,
+    DcpCompressedFrames = 0x66,
     /* End DCP */
 
     StopPersistence = 0x80,
@@ -263,6 +264,30 @@ enum class ClientOpcode : uint8_t {
      */
     CollectionsGetScopeID = 0xbc,
 
+    /**
+     * Command to scan a range of keys of a collection, returning the
+     * documents in batches
+     */
+    RangeScan = 0xbd,
+
+    /**
+     * Command to set a batch of documents of a vbucket with their meta
+     * data (a batched SetWithMeta), returning the status of each document
+     */
+    SetWithMetaBatch = 0xbe,
+
+    /**
+     * Command to get a random sample of the (resident) documents of a
+     * collection
+     */
+    SampleDocuments = 0xbf,
+
+    /**
+     * Command to lock a document (as GetLocked) returning only its meta
+     * data, so that it doesn't need to fetch an evicted value
+     */
+    GetLockedMeta = 0xc0,
+
     /**
      * Commands for GO-XDCR
      */
@@ -48,6 +48,7 @@ enum class FrameInfoId {
     OpenTracingContext = 3,
     Impersonate = 4,
     PreserveTtl = 5,
+    Deadline = 6,
 };
 }
 
@@ -290,19 +290,70 @@ struct DocKeyInterface {
         return static_cast<const T*>(this)->to_string();
     }
 
+    /**
+     * Hash the logical key (CollectionID and key), so that a key of the
+     * default collection hashes the same with and without the encoded
+     * CollectionID.
+     *
+     * The key is consumed 8 bytes at a time and the result goes through a
+     * final avalanche, so all of the bits (including the low bits which
+     * HashTable::getBucketForHash uses) depend on every byte of the key.
+     */
     uint32_t hash() const {
-        uint32_t h = 5381;
-
-        if (getEncoding() == DocKeyEncodesCollectionId::No) {
-            h = ((h << 5) + h) ^ uint32_t(DefaultCollectionLeb128Encoded);
+        auto* ptr = data();
+        size_t remaining = size();
+
+        // The leb128 prefix, which a key not encoding the CollectionID
+        // has as DefaultCollectionLeb128Encoded
+        uint64_t prefix = DefaultCollectionLeb128Encoded;
+        if (getEncoding() == DocKeyEncodesCollectionId::Yes) {
+            prefix = 0;
+            for (int shift = 0; remaining > 0; shift += 8) {
+                const uint8_t byte = *ptr++;
+                --remaining;
+                prefix |= uint64_t(byte) << shift;
+                if ((byte & 0x80) == 0) {
+                    break;
+                }
+            }
         }
-        // else hash the entire data which includes an encoded CollectionID
 
-        for (auto c : cb::const_byte_buffer(data(), size())) {
-            h = ((h << 5) + h) ^ uint32_t(c);
+        uint64_t h = (prefix + HashPrime5) ^ (remaining * HashPrime1);
+        uint64_t word;
+        for (; remaining >= sizeof(word); remaining -= sizeof(word)) {
+            std::memcpy(&word, ptr, sizeof(word));
+            h = hashRound(h, word);
+            ptr += sizeof(word);
+        }
+        if (remaining > 0) {
+            word = 0;
+            std::memcpy(&word, ptr, remaining);
+            h = hashRound(h, word);
         }
 
-        return h;
+        // The MurmurHash3 fmix64 finaliser
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return uint32_t(h);
+    }
+
+private:
+    // The xxHash64 primes and accumulate round
+    static constexpr uint64_t HashPrime1 = 0x9e3779b185ebca87ULL;
+    static constexpr uint64_t HashPrime2 = 0xc2b2ae3d27d4eb4fULL;
+    static constexpr uint64_t HashPrime4 = 0x85ebca77c2b2ae63ULL;
+    static constexpr uint64_t HashPrime5 = 0x27d4eb2f165667c5ULL;
+
+    static uint64_t rotl(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    static uint64_t hashRound(uint64_t h, uint64_t word) {
+        h ^= rotl(word * HashPrime2, 31) * HashPrime1;
+        return rotl(h, 27) * HashPrime1 + HashPrime4;
     }
 };
 
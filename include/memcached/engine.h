@@ -8,6 +8,7 @@
 #include <string_view>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <gsl/gsl>
 #include <optional>
@@ -331,6 +332,44 @@ struct MEMCACHED_PUBLIC_CLASS EngineIface {
                                         Vbid vbucket,
                                         DocStateFilter documentStateFilter) = 0;
 
+    /**
+     * Hint to the engine that the given keys are about to be retrieved
+     * (e.g. they're GETs pipelined by the client behind a GET which is
+     * blocked waiting for the engine). The engine may use the hint to start
+     * loading the keys which aren't resident in memory, so that they're
+     * fetched in the same batch as the blocked request.
+     *
+     * The engine must not notify the cookie as part of a prefetch.
+     *
+     * @param cookie The cookie provided by the frontend
+     * @param keys The keys to prefetch (and the vbucket they belong to)
+     */
+    virtual void prefetch(gsl::not_null<const void*> cookie,
+                          const std::vector<std::pair<Vbid, DocKey>>& keys) {
+        // empty
+    }
+
+    /**
+     * Get the generation of a document, used by the frontend to tell if a
+     * GET response it cached for the document is still valid. The
+     * generation must change whenever the document may have changed (it
+     * may change more often), reading it must be cheap, and it must only
+     * be returned if a GET of the document by the cookie would be allowed
+     * (the vbucket is active, the cookie may read the collection...).
+     *
+     * @param cookie The cookie provided by the frontend
+     * @param key the key of the document
+     * @param vbucket the virtual bucket id
+     * @return the generation, or an empty optional if the GETs of the
+     *         document must not be served from a cache (the default)
+     */
+    virtual std::optional<uint64_t> getDocumentGeneration(
+            gsl::not_null<const void*> cookie,
+            const DocKey& key,
+            Vbid vbucket) {
+        return {};
+    }
+
     /**
      * Optionally retrieve an item. Only non-deleted items may be fetched
      * through this interface (Documents in deleted state may be evicted
@@ -444,6 +483,112 @@ struct MEMCACHED_PUBLIC_CLASS EngineIface {
             DocumentState document_state,
             bool preserveTtl) = 0;
 
+    /**
+     * Store a batch of items of the same vbucket, as store() would with
+     * OPERATION_SET, no CAS, no durability requirements and the documents
+     * alive. The engine may take the locks shared by the items once for
+     * the whole batch rather than once per item.
+     *
+     * Optional interface; the default stores the items one at a time.
+     *
+     * @param cookie The cookie provided by the frontend
+     * @param vbucket the vbucket of all of the items
+     * @param items the items to store
+     * @param results [out] the status and the new CAS of each of the items.
+     *        If an item must block it has the status would_block and
+     *        neither it nor the items after it are stored (they have the
+     *        status would_block too); the frontend must store them again
+     *        once the cookie is notified.
+     */
+    virtual void store_multi(gsl::not_null<const void*> cookie,
+                             Vbid vbucket,
+                             const std::vector<item*>& items,
+                             std::vector<cb::EngineErrorCasPair>& results) {
+        results.assign(items.size(), {cb::engine_errc::would_block, 0});
+        for (size_t ii = 0; ii < items.size(); ++ii) {
+            uint64_t cas = 0;
+            const auto status = store(cookie,
+                                      items[ii],
+                                      cas,
+                                      OPERATION_SET,
+                                      {},
+                                      DocumentState::Alive,
+                                      false);
+            if (status == ENGINE_EWOULDBLOCK) {
+                break;
+            }
+            results[ii] = {cb::engine_errc(status), cas};
+        }
+    }
+
+    /**
+     * Increment or decrement the counter stored in an existing document in
+     * a single step, without the frontend reading the document and storing
+     * it back with CAS (which retries under contention on the key).
+     *
+     * Optional interface; the engine may also refuse any particular
+     * request (e.g. the document isn't resident, has xattrs or is being
+     * modified by a SyncWrite) by returning ENGINE_ENOTSUP, in which case
+     * the frontend performs the operation by a get and a CAS store. The
+     * default refuses every request.
+     *
+     * Increment wraps on overflow, decrement stops at 0.
+     *
+     * @param cookie The cookie provided by the frontend
+     * @param key the key of the counter
+     * @param vbucket the virtual bucket id
+     * @param increment true to increment the counter, false to decrement it
+     * @param delta the amount to increment or decrement the counter by
+     * @param [out] result the new value of the counter
+     * @param [out] cas the CAS of the document after the update
+     * @param [out] mutation the vbucket uuid and seqno of the update
+     * @return ENGINE_SUCCESS if the counter was updated, ENGINE_ENOTSUP if the
+     *         frontend must perform the operation itself
+     */
+    virtual ENGINE_ERROR_CODE arithmetic(gsl::not_null<const void*> cookie,
+                                         const DocKey& key,
+                                         Vbid vbucket,
+                                         bool increment,
+                                         uint64_t delta,
+                                         uint64_t& result,
+                                         uint64_t& cas,
+                                         mutation_descr_t& mutation) {
+        return ENGINE_ENOTSUP;
+    }
+
+    /**
+     * Append or prepend data to the value of an existing document in a
+     * single step, without the frontend reading the document and storing
+     * the combined value back with CAS.
+     *
+     * Optional interface with the same fallback as arithmetic(): the
+     * engine returns ENGINE_ENOTSUP for the requests (or documents) it
+     * doesn't support, and the frontend then performs the operation by a
+     * get and a CAS store. The default refuses every request.
+     *
+     * Any xattrs of the document are preserved (and stay in front of the
+     * body).
+     *
+     * @param cookie The cookie provided by the frontend
+     * @param key the key of the document
+     * @param vbucket the virtual bucket id
+     * @param append true to append the data, false to prepend it
+     * @param value the (uncompressed) data to append or prepend
+     * @param [out] cas the CAS of the document after the update
+     * @param [out] mutation the vbucket uuid and seqno of the update
+     * @return ENGINE_SUCCESS if the document was updated, ENGINE_ENOTSUP if
+     *         the frontend must perform the operation itself
+     */
+    virtual ENGINE_ERROR_CODE appendPrepend(gsl::not_null<const void*> cookie,
+                                            const DocKey& key,
+                                            Vbid vbucket,
+                                            bool append,
+                                            std::string_view value,
+                                            uint64_t& cas,
+                                            mutation_descr_t& mutation) {
+        return ENGINE_ENOTSUP;
+    }
+
     /**
      * Store an item into the underlying engine with the given
      * state only if the predicate argument returns true when called against an
@@ -663,6 +808,19 @@ struct MEMCACHED_PUBLIC_CLASS EngineIface {
     virtual float getMinCompressionRatio() {
         return default_min_compression_ratio;
     }
+
+    /**
+     * A cheap check (made before every mutation is executed) of whether the
+     * bucket is too short of memory to accept mutations, which would then
+     * be rejected with a temporary failure. The front-end uses it to stop
+     * reading mutations from a connection for a while, rather than
+     * accepting and rejecting them.
+     *
+     * @returns true if mutations are likely to fail for lack of memory
+     */
+    virtual bool isUnderMemoryPressure() {
+        return false;
+    }
 };
 
 namespace cb {
@@ -9,6 +9,7 @@
 enum class OutputFormat {
     Text,
     XML,
+    JSON,
 };
 
 enum test_result {
@@ -244,6 +244,39 @@ static_assert(sizeof(TouchPayload) == 4, "Unexpected size");
 using GatPayload = TouchPayload;
 using GetLockedPayload = TouchPayload;
 
+/**
+ * The optional extras of GetReplica: a consistency token requiring the
+ * replica to have received (at least) the given seqno of the vbucket before
+ * serving the read.
+ */
+class GetReplicaPayload {
+public:
+    uint64_t getMinSeqno() const {
+        return ntohll(min_seqno);
+    }
+    void setMinSeqno(uint64_t seqno) {
+        GetReplicaPayload::min_seqno = htonll(seqno);
+    }
+
+    /// Milliseconds to wait for the replica to reach the seqno (0 = fail
+    /// with Etmpfail immediately if it has not)
+    uint32_t getTimeout() const {
+        return ntohl(timeout);
+    }
+    void setTimeout(uint32_t timeout) {
+        GetReplicaPayload::timeout = htonl(timeout);
+    }
+
+    cb::const_byte_buffer getBuffer() const {
+        return {reinterpret_cast<const uint8_t*>(this), sizeof(*this)};
+    }
+
+protected:
+    uint64_t min_seqno = 0;
+    uint32_t timeout = 0;
+};
+static_assert(sizeof(GetReplicaPayload) == 12, "Unexpected size");
+
 class SetCtrlTokenPayload {
 public:
     uint64_t getCas() const {
@@ -679,6 +712,13 @@ protected:
  * the server returns ENGINE_ROLLBACK error.
  */
 #define DCP_ADD_STREAM_STRICT_VBUUID 32
+/**
+ * Indicate that the client accepts an Out of Sequence Order (OSO) backfill
+ * for this stream, without having to enable out of order snapshots for the
+ * whole connection (DCP control enable_out_of_order_snapshots).
+ * Only a stream filtered to a single collection is eligible.
+ */
+#define DCP_ADD_STREAM_FLAG_OSO_BACKFILL 64
     uint32_t flags = 0;
 };
 static_assert(sizeof(DcpAddStreamPayload) == 4, "Unexpected struct size");
@@ -2054,6 +2094,176 @@ protected:
     uint16_t version = 0;
 };
 static_assert(sizeof(GetErrmapPayload) == 2, "Unexpected struct size");
+
+enum class RangeScanFlags : uint32_t {
+    /// Only return the keys of the documents in the range
+    KeyOnly = 0x01,
+    /// The key is a prefix; scan every key starting with it. The value
+    /// (the end key) must be empty
+    Prefix = 0x02,
+};
+
+/**
+ * Message format for CMD_RANGE_SCAN
+ *
+ * The key is the (collection encoded) key the scan starts from, and the
+ * optional value the (exclusive) key of the same collection it ends at.
+ * See engines/ep/docs/protocol/range_scan.md for more information.
+ */
+class RangeScanPayload {
+public:
+    uint32_t getFlags() const {
+        return ntohl(flags);
+    }
+    void setFlags(uint32_t flags) {
+        RangeScanPayload::flags = htonl(flags);
+    }
+    uint32_t getBufferSize() const {
+        return ntohl(buffer_size);
+    }
+    void setBufferSize(uint32_t bufferSize) {
+        buffer_size = htonl(bufferSize);
+    }
+    uint32_t getSampleInterval() const {
+        return ntohl(sample_interval);
+    }
+    void setSampleInterval(uint32_t interval) {
+        sample_interval = htonl(interval);
+    }
+
+    bool isKeyOnly() const {
+        return (getFlags() & uint32_t(RangeScanFlags::KeyOnly)) != 0;
+    }
+    bool isPrefix() const {
+        return (getFlags() & uint32_t(RangeScanFlags::Prefix)) != 0;
+    }
+
+    cb::const_byte_buffer getBuffer() const {
+        return {reinterpret_cast<const uint8_t*>(this), sizeof(*this)};
+    }
+
+protected:
+    uint32_t flags = 0;
+    /// Maximum size of the documents returned by one response (0 = default)
+    uint32_t buffer_size = 0;
+    /// Return (on average) one in this many documents (0 or 1 = all)
+    uint32_t sample_interval = 0;
+};
+static_assert(sizeof(RangeScanPayload) == 12, "Unexpected struct size");
+
+/**
+ * The header of each of the documents in the value of a
+ * CMD_SET_WITH_META_BATCH request. It is followed by the (collection
+ * encoded if collections are enabled) key and then the value of the
+ * document.
+ * See engines/ep/docs/protocol/set_with_meta_batch.md for more information.
+ */
+class SetWithMetaBatchEntry {
+public:
+    uint32_t getFlagsInNetworkByteOrder() const {
+        return flags;
+    }
+    void setFlagsInNetworkByteOrder(uint32_t flags) {
+        SetWithMetaBatchEntry::flags = flags;
+    }
+    uint32_t getExpiration() const {
+        return ntohl(expiration);
+    }
+    void setExpiration(uint32_t expiration) {
+        SetWithMetaBatchEntry::expiration = htonl(expiration);
+    }
+    uint64_t getSeqno() const {
+        return ntohll(seqno);
+    }
+    void setSeqno(uint64_t seqno) {
+        SetWithMetaBatchEntry::seqno = htonll(seqno);
+    }
+    uint64_t getCas() const {
+        return ntohll(cas);
+    }
+    void setCas(uint64_t cas) {
+        SetWithMetaBatchEntry::cas = htonll(cas);
+    }
+    uint32_t getValueLength() const {
+        return ntohl(valuelen);
+    }
+    void setValueLength(uint32_t length) {
+        valuelen = htonl(length);
+    }
+    uint16_t getKeyLength() const {
+        return ntohs(keylen);
+    }
+    void setKeyLength(uint16_t length) {
+        keylen = htons(length);
+    }
+    uint8_t getDatatype() const {
+        return datatype;
+    }
+    void setDatatype(uint8_t datatype) {
+        SetWithMetaBatchEntry::datatype = datatype;
+    }
+
+    /// The total size of the entry (the header, key and value)
+    size_t getSize() const {
+        return sizeof(*this) + getKeyLength() + getValueLength();
+    }
+
+    cb::const_byte_buffer getKey() const {
+        return {reinterpret_cast<const uint8_t*>(this) + sizeof(*this),
+                getKeyLength()};
+    }
+
+    cb::const_byte_buffer getValue() const {
+        return {reinterpret_cast<const uint8_t*>(this) + sizeof(*this) +
+                        getKeyLength(),
+                getValueLength()};
+    }
+
+protected:
+    uint32_t flags = 0;
+    uint32_t expiration = 0;
+    uint64_t seqno = 0;
+    uint64_t cas = 0;
+    uint32_t valuelen = 0;
+    uint16_t keylen = 0;
+    uint8_t datatype = 0;
+};
+static_assert(sizeof(SetWithMetaBatchEntry) == 31, "Unexpected struct size");
+
+/**
+ * Message format for CMD_SAMPLE_DOCUMENTS
+ *
+ * The collection ID is only sent by collection enabled connections (the
+ * others sample the default collection).
+ * See engines/ep/docs/protocol/sample_documents.md for more information.
+ */
+class SampleDocumentsPayload {
+public:
+    SampleDocumentsPayload() = default;
+    SampleDocumentsPayload(uint32_t count, uint32_t collectionId)
+        : count(htonl(count)), collectionId(htonl(collectionId)) {
+    }
+
+    uint32_t getCount() const {
+        return ntohl(count);
+    }
+    void setCount(uint32_t count) {
+        SampleDocumentsPayload::count = htonl(count);
+    }
+    CollectionID getCollectionId() const {
+        return ntohl(collectionId);
+    }
+
+    cb::const_byte_buffer getBuffer() const {
+        return {reinterpret_cast<const uint8_t*>(this), sizeof(*this)};
+    }
+
+protected:
+    /// The number of documents to sample
+    uint32_t count = 0;
+    CollectionIDType collectionId = 0;
+};
+static_assert(sizeof(SampleDocumentsPayload) == 8, "Unexpected struct size");
 #pragma pack()
 } // namespace request
 } // namespace mcbp
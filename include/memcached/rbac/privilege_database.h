@@ -299,7 +299,7 @@ public:
                      const PrivilegeMask& m,
                      std::shared_ptr<const Bucket> bucket)
         : generation(gen), domain(domain), mask(m), bucket(std::move(bucket)) {
-        // empty
+        updateEffectiveMask();
     }
 
     /**
@@ -363,6 +363,10 @@ public:
 protected:
     void setBucketPrivilegeBits(bool value);
 
+    /// Recalculate the effective mask (must be called every time mask,
+    /// bucket or dropped change)
+    void updateEffectiveMask();
+
     /// The Database version this mask belongs to
     uint32_t generation;
     /// The Domain the mask belongs to
@@ -373,8 +377,14 @@ protected:
     /// The Bucket rbac setting
     std::shared_ptr<const Bucket> bucket;
 
-    /// The list of dropped privileges
-    std::vector<Privilege> droppedPrivileges;
+    /// The privileges dropped over the connection
+    PrivilegeMask dropped;
+
+    /// The privileges granted by mask and the bucket level privileges of
+    /// bucket, minus the dropped privileges. This allows check() to grant
+    /// access with a single test unless the bucket delegates the privilege
+    /// to its scopes and collections.
+    PrivilegeMask effective;
 };
 
 /**
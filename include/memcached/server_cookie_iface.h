@@ -25,7 +25,10 @@
 #include <mcbp/protocol/opcode.h>
 #include <nlohmann/json_fwd.hpp>
 #include <gsl/gsl>
+#include <chrono>
+#include <optional>
 #include <string>
+#include <utility>
 
 namespace cb {
 namespace mcbp {
@@ -135,6 +138,24 @@ struct ServerCookieIface {
     virtual void notify_io_complete(gsl::not_null<const void*> cookie,
                                     ENGINE_ERROR_CODE status) = 0;
 
+    /**
+     * Let a number of connections know that IO has completed.
+     *
+     * Functionally equivalent to calling notify_io_complete() for each
+     * element, but allows the core to group the cookies by the thread
+     * serving them and wake each thread only once.
+     *
+     * @param notifications the cookies to notify, and the status for each
+     *                      cookie's io operation
+     */
+    virtual void notify_io_complete_batch(
+            gsl::span<const std::pair<const void*, ENGINE_ERROR_CODE>>
+                    notifications) {
+        for (const auto& notification : notifications) {
+            notify_io_complete(notification.first, notification.second);
+        }
+    }
+
     /**
      * Notify the core that we're holding on to this cookie for
      * future use. (The core guarantees it will not invalidate the
@@ -320,4 +341,14 @@ struct ServerCookieIface {
     virtual std::string_view get_inflated_payload(
             gsl::not_null<const void*> cookie,
             const cb::mcbp::Request& request) = 0;
+
+    /**
+     * Get the deadline of the command (if the client sent one), after
+     * which the client no longer waits for the response
+     *
+     * @param cookie The cookie representing this command
+     * @return the deadline, or an empty optional if the command has none
+     */
+    virtual std::optional<std::chrono::steady_clock::time_point> get_deadline(
+            gsl::not_null<const void*> cookie) = 0;
 };
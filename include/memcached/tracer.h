@@ -74,19 +74,25 @@ public:
  */
 class MEMCACHED_PUBLIC_CLASS Tracer {
 public:
-    /// Begin a Span starting from the specified time point (defaults to now)
+    /// Begin a Span starting now (as read from cb::FastClock)
+    SpanId begin(Code tracecode);
+
+    /// Begin a Span starting from the specified time point
     SpanId begin(Code tracecode,
-                 std::chrono::steady_clock::time_point startTime =
-                         std::chrono::steady_clock::now());
+                 std::chrono::steady_clock::time_point startTime);
+
+    /// End a Span, stopping now (as read from cb::FastClock)
+    bool end(SpanId spanId);
 
-    /// End a Span, stopping at the specified time point (defaults to now).
-    bool end(SpanId spanId,
-             std::chrono::steady_clock::time_point endTime =
-                     std::chrono::steady_clock::now());
+    /// End a Span, stopping at the specified time point
+    bool end(SpanId spanId, std::chrono::steady_clock::time_point endTime);
 
     // Extract the trace vector (and clears the internal trace vector)
     std::vector<Span> extractDurations();
 
+    /// Get a copy of the trace vector
+    std::vector<Span> getSpans() const;
+
     Span::Duration getTotalMicros() const;
 
     uint16_t getEncodedMicros() const;
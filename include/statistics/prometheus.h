@@ -21,10 +21,8 @@
 
 #include <platform/socket.h>
 
-namespace prometheus {
 // forward declaration
-class Exposer;
-} // namespace prometheus
+class CivetServer;
 
 namespace cb::prometheus {
 
@@ -41,8 +39,9 @@ void initialize(const std::pair<in_port_t, sa_family_t>& config);
 /**
  * Global manager for exposing stats for Prometheus.
  *
- * Callbacks may be registered which will be called when the
- * appropriate HTTP endpoint is scraped.
+ * Serves the low and high cardinality stats on their HTTP endpoints. The
+ * stats are formatted in the text exposition format as they are collected
+ * and streamed into the response (see PrometheusTextStatCollector).
  */
 class MetricServer {
 public:
@@ -66,7 +65,7 @@ public:
      * Check if the HTTP server was created successfully and
      * can server incoming requests.
      *
-     * Creating the server (Exposer) may have failed if the port is
+     * Creating the server may have failed if the port is
      * in use.
      */
     [[nodiscard]] bool isAlive() const;
@@ -75,20 +74,20 @@ public:
      * Get the port the HTTP server is listening on. Useful if the
      * port was specified as 0 and a random free port was allocated.
      *
-     * Requires that the exposer was created successfully, so
+     * Requires that the server was created successfully, so
      * isAlive() should always be checked first.
      */
     [[nodiscard]] in_port_t getListeningPort() const;
 
 private:
-    class KVCollectable;
+    class KVHandler;
 
-    // Prometheus exposer takes weak pointers to `Collectable`s
-    std::shared_ptr<KVCollectable> stats;
-    std::shared_ptr<KVCollectable> statsHC;
+    // The server keeps raw pointers to the handlers; they must outlive it
+    std::unique_ptr<KVHandler> stats;
+    std::unique_ptr<KVHandler> statsHC;
 
-    // May be empty if the exposer could not be initialised
+    // May be empty if the server could not be initialised
     // e.g., port already in use
-    std::unique_ptr<::prometheus::Exposer> exposer;
+    std::unique_ptr<CivetServer> server;
 };
 } // namespace cb::prometheus
\ No newline at end of file
@@ -0,0 +1,127 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "collector.h"
+#include "definitions.h"
+
+#include <fmt/format.h>
+#include <functional>
+#include <string>
+#include <unordered_set>
+
+/**
+ * StatCollector implementation which formats stats in the Prometheus text
+ * exposition format as they are added, rather than building
+ * prometheus::MetricFamily objects for every stat (see
+ * PrometheusStatCollector).
+ *
+ * The text is buffered and handed to the provided output function in chunks
+ * of (roughly) ChunkSize bytes, so a scrape can be streamed into the HTTP
+ * response. The last chunk is written by flush() (or the destructor).
+ *
+ * The samples of a metric family are not grouped together (the families of
+ * each bucket are interleaved); the TYPE of a family is written before its
+ * first sample.
+ */
+class PrometheusTextStatCollector : public StatCollector {
+public:
+    using OutputFn = std::function<void(std::string_view)>;
+
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    explicit PrometheusTextStatCollector(OutputFn output,
+                                         std::string prefix = "kv_")
+        : output(std::move(output)), prefix(std::move(prefix)) {
+    }
+
+    ~PrometheusTextStatCollector() override;
+
+    // Allow usage of the "helper" methods defined in the base type.
+    // They would otherwise be shadowed
+    using StatCollector::addStat;
+
+    void addStat(const cb::stats::StatDef& k,
+                 std::string_view v,
+                 const Labels& labels) override {
+        // silently discard text stats (for now). Prometheus can't expose them
+    }
+
+    void addStat(const cb::stats::StatDef& k,
+                 bool v,
+                 const Labels& labels) override {
+        addStat(k, double(v), labels);
+    }
+
+    void addStat(const cb::stats::StatDef& k,
+                 int64_t v,
+                 const Labels& labels) override {
+        addStat(k, double(v), labels);
+    }
+
+    void addStat(const cb::stats::StatDef& k,
+                 uint64_t v,
+                 const Labels& labels) override {
+        addStat(k, double(v), labels);
+    }
+
+    void addStat(const cb::stats::StatDef& k,
+                 double v,
+                 const Labels& labels) override;
+
+    void addStat(const cb::stats::StatDef& k,
+                 const HistogramData& hist,
+                 const Labels& labels) override;
+
+    /// Write any buffered text to the output function
+    void flush();
+
+protected:
+    /**
+     * Write the TYPE of the family if this is its first sample
+     * @return the name of the metric family (including the prefix)
+     */
+    std::string_view beginFamily(const cb::stats::StatDef& key,
+                                 std::string_view type);
+
+    /**
+     * Write a sample line:
+     *   <name><suffix>{<labels>[,<extraLabel>]} <value>
+     */
+    void writeSample(std::string_view name,
+                     std::string_view suffix,
+                     const cb::stats::StatDef& key,
+                     const Labels& additionalLabels,
+                     std::string_view extraLabel,
+                     double value);
+
+    void writeLabel(std::string_view label, std::string_view value);
+
+    void maybeFlush() {
+        if (buffer.size() >= ChunkSize) {
+            flush();
+        }
+    }
+
+    const OutputFn output;
+    const std::string prefix;
+
+    fmt::memory_buffer buffer;
+
+    // The (prefixed) names of the families whose TYPE has been written
+    std::unordered_set<std::string> families;
+};
@@ -89,6 +89,8 @@ STAT(ep_diskqueue_items, count, , , )
 STAT(ep_commit_num, count, , , )
 STAT(ep_commit_time, microseconds, , , )
 STAT(ep_commit_time_total, microseconds, , , )
+STAT(ep_durability_log_writes, count, , , )
+STAT(ep_durability_log_write_failed, count, , , )
 STAT(ep_item_begin_failed, count, , , )
 STAT(ep_item_commit_failed, count, , , )
 STAT(ep_item_flush_expired, count, , , )
@@ -118,6 +120,7 @@ STAT(ep_mem_high_wat_percent, percent, , , )
  */
 STAT(bytes, bytes, total_memory_used, , )
 STAT(ep_kv_size, bytes, memory_used, for, hashtable)
+STAT(ep_ht_huge_page_bytes, bytes, , , )
 STAT(ep_blob_num, count, , , )
 STAT(ep_blob_overhead,
      bytes,
@@ -134,18 +137,23 @@ STAT(ep_overhead, bytes, total_memory_overhead, , )
 STAT(ep_item_num, count, , , )
 STAT(ep_oom_errors, count, , , )
 STAT(ep_tmp_oom_errors, count, , , )
+STAT(ep_tmp_oom_collection_quota_errors, count, , , )
 STAT(ep_mem_tracker_enabled, none, , , )
 STAT(ep_bg_fetched, count, , , )
 STAT(ep_bg_meta_fetched, count, , , )
+STAT(ep_bg_prefetches, count, , , )
+STAT(ep_bg_fetch_deadline_exceeded, count, , , )
 STAT(ep_bg_remaining_items, count, , , )
 STAT(ep_bg_remaining_jobs, count, , , )
 STAT(ep_num_pager_runs, count, , , )
 STAT(ep_num_expiry_pager_runs, count, , , )
+STAT(ep_num_expiry_pager_full_scans, count, , , )
 STAT(ep_num_freq_decayer_runs, count, , , )
 STAT(ep_items_expelled_from_checkpoints, count, , , )
 STAT(ep_items_rm_from_checkpoints, count, , , )
 STAT(ep_num_value_ejects, count, , , )
 STAT(ep_num_eject_failures, count, , , )
+STAT(ep_num_ejects_on_persist, count, , , )
 STAT(ep_num_not_my_vbuckets, count, , , )
 STAT(ep_pending_ops, count, , , )
 STAT(ep_pending_ops_total,
@@ -176,6 +184,7 @@ STAT(ep_bg_load, microseconds, , , )
 STAT(ep_degraded_mode, none, , , )
 STAT(ep_num_access_scanner_runs, count, , , )
 STAT(ep_num_access_scanner_skips, count, , , )
+STAT(ep_num_access_scanner_vbuckets_copied, count, , , )
 STAT(ep_access_scanner_last_runtime,
      seconds,
      ,
@@ -198,6 +207,11 @@ STAT(ep_num_ops_get_meta, count, num_ops, op, get_meta)
 STAT(ep_num_ops_set_meta, count, num_ops, op, set_meta)
 STAT(ep_num_ops_del_meta, count, num_ops, op, del_meta)
 STAT(ep_num_ops_set_meta_res_fail, count, num_ops_failed, op, set_meta)
+STAT(ep_num_ops_set_meta_res_by_bounds,
+     count,
+     num_ops_resolved_by_bounds,
+     op,
+     set_meta)
 STAT(ep_num_ops_del_meta_res_fail, count, num_ops_failed, op, del_meta)
 STAT(ep_num_ops_set_ret_meta, count, num_ops, op, set_ret_meta)
 STAT(ep_num_ops_del_ret_meta, count, num_ops, op, del_ret_meta)
@@ -206,12 +220,15 @@ STAT(ep_workload_pattern, none, , , )
 STAT(ep_defragmenter_num_visited, count, , , )
 STAT(ep_defragmenter_num_moved, count, , , )
 STAT(ep_defragmenter_sv_num_moved, count, , , )
+STAT(ep_defragmenter_num_skipped, count, , , )
+STAT(ep_defragmenter_num_dense_skipped, count, , , )
 STAT(ep_item_compressor_num_visited, count, , , )
 STAT(ep_item_compressor_num_compressed, count, , , )
 STAT(ep_cursor_dropping_lower_threshold, bytes, , , )
 STAT(ep_cursor_dropping_upper_threshold, bytes, , , )
 STAT(ep_cursors_dropped, count, , , )
 STAT(ep_cursor_memory_freed, bytes, , , )
+STAT(ep_cursor_drop_backfill_items, count, , , )
 STAT(ep_data_write_failed, count, , , )
 STAT(ep_data_read_failed, count, , , )
 STAT(ep_io_document_write_bytes, bytes, , , )
@@ -238,16 +255,30 @@ STAT(ep_rocksdb_scan_oldSeqnoHits, count, , , )
 // EPBucket::getFileStats
 STAT(ep_db_data_size, bytes, , , )
 STAT(ep_db_file_size, bytes, , , )
+STAT(ep_compaction_throttle_state, none, , , )
+STAT(ep_compaction_write_rate_limit, bytes, , , )
+STAT(ep_compaction_write_rate, bytes, , , )
 
 // Timing stats
 STAT(bg_wait, microseconds, , , )
 STAT(bg_load, microseconds, , , )
+STAT(bg_fetch_client_read,
+     microseconds,
+     bg_fetch_time,
+     priority,
+     client_read)
+STAT(bg_fetch_durability, microseconds, bg_fetch_time, priority, durability)
+STAT(bg_fetch_xdcr_meta, microseconds, bg_fetch_time, priority, xdcr_meta)
+STAT(bg_fetch_background, microseconds, bg_fetch_time, priority, background)
 STAT(set_with_meta, microseconds, , , )
 STAT(pending_ops, microseconds, , , )
 STAT(access_scanner, microseconds, , , )
 STAT(checkpoint_remover, microseconds, , , )
 STAT(item_pager, microseconds, , , )
 STAT(expiry_pager, microseconds, , , )
+STAT(rollback_disk, microseconds, , , )
+STAT(rollback_unpersisted, microseconds, , , )
+STAT(rollback_prepares, microseconds, , , )
 STAT(storage_age, microseconds, , , )
 STAT(get_cmd, microseconds, cmd_time_taken, op, get)
 STAT(store_cmd, microseconds, cmd_time_taken, op, store)
@@ -282,6 +313,22 @@ STAT(dcp_cursors_get_all_items,
      cursor_get_all_items_time,
      cursor_type,
      dcp)
+STAT(dcp_item_send_latency,
+     microseconds,
+     , // labelled with the producer connection name
+     , )
+STAT(dcp_mutation_processing_time,
+     microseconds,
+     , // labelled with the consumer connection name
+     , )
+STAT(task_scheduling_time,
+     microseconds,
+     , // labelled with the task name and type
+     , )
+STAT(task_runtime,
+     microseconds,
+     , // labelled with the task name and type
+     , )
 STAT(sync_write_commit_majority,
      microseconds,
      sync_write_commit_duration,
@@ -297,6 +344,16 @@ STAT(sync_write_commit_persist_to_majority,
      sync_write_commit_duration,
      level,
      persist_to_majority)
+STAT(sync_write_ack_local,
+     microseconds,
+     sync_write_ack_duration,
+     node,
+     local)
+STAT(sync_write_ack_remote,
+     microseconds,
+     sync_write_ack_duration,
+     node,
+     remote)
 
 // server_stats
 STAT(uptime, seconds, , , )
@@ -313,6 +370,8 @@ STAT(curr_connections, count, , , )
 STAT(system_connections, count, , , )
 STAT(total_connections, count, , , ) // total since start/reset
 STAT(connection_structures, count, , , )
+STAT(pooled_buffers, count, , , )
+STAT(borrowed_buffers, count, , , )
 STAT(cmd_get, count, operations, op, get)
 STAT(cmd_set, count, operations, op, set)
 STAT(cmd_flush, count, operations, op, flush)
@@ -326,6 +385,8 @@ STAT(bytes_subdoc_lookup_total,
 STAT(bytes_subdoc_lookup_extracted, bytes, subdoc_lookup_extracted, , )
 STAT(bytes_subdoc_mutation_total, bytes, subdoc_mutation_updated, , )
 STAT(bytes_subdoc_mutation_inserted, bytes, subdoc_mutation_inserted, , )
+STAT(subdoc_path_cache_hits, count, , , )
+STAT(subdoc_path_cache_misses, count, , , )
 // aggregates over all buckets
 STAT(cmd_total_sets, count, , , )
 STAT(cmd_total_gets, count, , , )
@@ -352,8 +413,23 @@ STAT(bytes_written, bytes, written, , )
 STAT(rejected_conns, count, , , )
 STAT(threads, count, , , )
 STAT(conn_yields, count, , , )
+STAT(conn_migrations, count, , , )
+STAT(mutations_deferred, count, , , )
 STAT(iovused_high_watermark, none, , , )
 STAT(msgused_high_watermark, none, , , )
+STAT(zero_copy_bytes, bytes, zero_copy_sent, , )
+STAT(zero_copy_fallbacks, count, , , )
+STAT(zero_copy_completions, count, , , )
+// us suffix would be confusing in Prometheus as the stat is scaled to seconds
+STAT(zero_copy_completion_us, microseconds, zero_copy_completion_duration, , )
+STAT(tls_records_sent, count, , , )
+STAT(tls_record_bytes, bytes, tls_record_payload, , )
+STAT(tls_full_handshakes, count, , , )
+STAT(tls_resumed_handshakes, count, , , )
+STAT(response_sends, count, , , )
+STAT(responses_sent, count, , , )
+STAT(get_cache_hits, count, , , )
+STAT(cmd_deadline_exceeded, count, , , )
 STAT(lock_errors, count, , , )
 STAT(cmd_lookup_10s_count, count, , , )
 // us suffix would be confusing in Prometheus as the stat is scaled to seconds
@@ -422,6 +498,38 @@ STAT(ep_meta_data_disk, bytes, , , )
 STAT(ep_checkpoint_memory, bytes, , , )
 STAT(ep_checkpoint_memory_unreferenced, bytes, , , )
 STAT(ep_checkpoint_memory_overhead, bytes, , , )
+// The memory-breakdown stat group. Each component is also reported per
+// vBucket (and the memory used per collection) with labels built at runtime.
+STAT(ep_mem_breakdown_ht_metadata,
+     bytes,
+     memory_breakdown,
+     component, ht_metadata)
+STAT(ep_mem_breakdown_ht_keys, bytes, memory_breakdown, component, ht_keys)
+STAT(ep_mem_breakdown_ht_values, bytes, memory_breakdown, component, ht_values)
+STAT(ep_mem_breakdown_ht_overhead,
+     bytes,
+     memory_breakdown,
+     component, ht_overhead)
+STAT(ep_mem_breakdown_checkpoint_items,
+     bytes,
+     memory_breakdown,
+     component, checkpoint_items)
+STAT(ep_mem_breakdown_checkpoint_index,
+     bytes,
+     memory_breakdown,
+     component, checkpoint_index)
+STAT(ep_mem_breakdown_checkpoint_queue,
+     bytes,
+     memory_breakdown,
+     component, checkpoint_queue)
+STAT(ep_mem_breakdown_dcp_ready_queue,
+     bytes,
+     memory_breakdown,
+     component, dcp_ready_queue)
+STAT(ep_mem_breakdown_dcp_backfill_buffer,
+     bytes,
+     memory_breakdown,
+     component, dcp_backfill_buffer)
 STAT(ep_total_cache_size, bytes, , , )
 STAT(rollback_item_count, count, , , )
 STAT(ep_num_non_resident, count, , , )
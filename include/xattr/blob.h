@@ -20,7 +20,10 @@
 #include <platform/compress.h>
 #include <xattr/utils.h>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string_view>
+#include <vector>
 
 namespace cb {
 namespace xattr {
@@ -97,12 +100,19 @@ public:
     /**
      * Get the value for a given key located in the blob
      *
+     * The first lookup scans the blob. From the second lookup in a blob
+     * with more than IndexThreshold keys (and until it is modified) the
+     * key is looked up in a sorted index of the keys instead.
+     *
      * @param key The key to look up
      * @return a buffer containing it's value. If not found the buffer length
      *         is 0
      */
     cb::char_buffer get(std::string_view key) const;
 
+    /// The minimum number of keys in the blob for get() to build an index
+    static constexpr size_t IndexThreshold = 8;
+
     /**
      * Remove a given key (and its value) from the blob.
      *
@@ -267,9 +277,36 @@ protected:
      */
     void remove_segment(const size_t offset, const size_t size);
 
+    /**
+     * Look up the offset of the kv-pair for the given key by scanning the
+     * blob (and collect the index of the keys if requested)
+     *
+     * @return the offset of the length field of the kv-pair, or 0 if the
+     *         key isn't present
+     */
+    size_t scan(std::string_view key, bool buildIndex) const;
+
+    /// Drop the index (the layout of the blob changed)
+    void invalidate_index() {
+        index.clear();
+        lookups = 0;
+    }
+
 private:
     cb::char_buffer blob;
 
+    struct IndexEntry {
+        /// The key (points into the blob)
+        std::string_view key;
+        /// The offset of the length field of the kv-pair
+        uint32_t offset;
+    };
+
+    /// The keys in the blob sorted by the key (empty until built by get())
+    mutable std::vector<IndexEntry> index;
+    /// The number of lookups since the layout of the blob last changed
+    mutable uint32_t lookups = 0;
+
     /// When the incoming data is compressed will auto-decompress into this
     cb::compression::Buffer decompressed;
 
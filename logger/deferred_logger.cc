@@ -0,0 +1,236 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "deferred_logger.h"
+#include "deferred_logger_internal.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cb::logger {
+
+/**
+ * The ring buffer of a thread. It is a single producer (the owning thread)
+ * single consumer (whoever holds DeferredLogger::drainMutex) queue.
+ */
+struct DeferredRing {
+    static constexpr size_t Size = 512;
+
+    detail::DeferredSlot* reserve() {
+        const auto h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Size) {
+            return nullptr;
+        }
+        return &slots[h % Size];
+    }
+
+    void commit() {
+        head.store(head.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+    /// Pass all of the published messages to the logger
+    void drain(spdlog::logger* logger) {
+        auto t = tail.load(std::memory_order_relaxed);
+        const auto h = head.load(std::memory_order_acquire);
+        std::string message;
+        for (; t != h; ++t) {
+            auto& slot = slots[t % Size];
+            if (logger) {
+                slot.consume(slot.storage, &message);
+                logger->log(slot.time, {}, slot.level, message);
+            } else {
+                slot.consume(slot.storage, nullptr);
+            }
+            tail.store(t + 1, std::memory_order_release);
+        }
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) ==
+               tail.load(std::memory_order_acquire);
+    }
+
+    std::array<detail::DeferredSlot, Size> slots;
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    /// Set when the owning thread exits
+    std::atomic_bool orphaned{false};
+};
+
+/// The (lazily created) ring of the calling thread
+struct ThreadRing {
+    ~ThreadRing() {
+        if (ring) {
+            ring->orphaned = true;
+        }
+    }
+    std::shared_ptr<DeferredRing> ring;
+};
+
+class DeferredLogger {
+public:
+    static DeferredLogger& instance() {
+        static DeferredLogger logger;
+        return logger;
+    }
+
+    ~DeferredLogger() {
+        stop();
+    }
+
+    void start(std::shared_ptr<spdlog::logger> l) {
+        stop();
+        std::lock_guard<std::mutex> guard(mutex);
+        logger = std::move(l);
+        running = true;
+        enabled = true;
+        thread = std::thread([this]() { run(); });
+    }
+
+    void stop() {
+        enabled = false;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            running = false;
+        }
+        cond.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+        drainAll();
+        std::lock_guard<std::mutex> guard(mutex);
+        logger.reset();
+    }
+
+    detail::DeferredSlot* reserve() {
+        if (!enabled.load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        thread_local ThreadRing local;
+        if (!local.ring) {
+            local.ring = std::make_shared<DeferredRing>();
+            std::lock_guard<std::mutex> guard(mutex);
+            rings.push_back(local.ring);
+        }
+        current = local.ring.get();
+        return current->reserve();
+    }
+
+    void commit() {
+        current->commit();
+    }
+
+    /// Format all of the messages queued so far
+    void drainAll() {
+        std::shared_ptr<spdlog::logger> l;
+        std::vector<std::shared_ptr<DeferredRing>> snapshot;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            l = logger;
+            snapshot = rings;
+        }
+
+        std::lock_guard<std::mutex> guard(drainMutex);
+        for (auto& ring : snapshot) {
+            ring->drain(l.get());
+        }
+
+        // Forget the rings of the threads which exited (the thread may
+        // have logged after the drain above, so only once they're empty)
+        std::lock_guard<std::mutex> lock(mutex);
+        rings.erase(std::remove_if(rings.begin(),
+                                   rings.end(),
+                                   [](const auto& ring) {
+                                       return ring->orphaned && ring->empty();
+                                   }),
+                    rings.end());
+    }
+
+    bool isEnabled() const {
+        return enabled;
+    }
+
+protected:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            lock.unlock();
+            drainAll();
+            lock.lock();
+            cond.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+
+    /// The ring the calling thread reserved its last slot in
+    static thread_local DeferredRing* current;
+
+    std::atomic_bool enabled{false};
+
+    /// Protects logger, rings and running
+    std::mutex mutex;
+    std::shared_ptr<spdlog::logger> logger;
+    std::vector<std::shared_ptr<DeferredRing>> rings;
+    bool running = false;
+    std::condition_variable cond;
+
+    /// Held while draining the rings (only one thread may consume them)
+    std::mutex drainMutex;
+    std::thread thread;
+};
+
+thread_local DeferredRing* DeferredLogger::current = nullptr;
+
+namespace detail {
+
+LOGGER_PUBLIC_API
+DeferredSlot* reserveDeferredSlot() {
+    return DeferredLogger::instance().reserve();
+}
+
+LOGGER_PUBLIC_API
+void commitDeferredSlot() {
+    DeferredLogger::instance().commit();
+}
+
+void startDeferredFormatting(std::shared_ptr<spdlog::logger> logger) {
+    DeferredLogger::instance().start(std::move(logger));
+}
+
+void stopDeferredFormatting() {
+    DeferredLogger::instance().stop();
+}
+
+} // namespace detail
+
+LOGGER_PUBLIC_API
+void flushDeferred() {
+    DeferredLogger::instance().drainAll();
+}
+
+LOGGER_PUBLIC_API
+bool isDeferredFormattingEnabled() {
+    return DeferredLogger::instance().isEnabled();
+}
+
+} // namespace cb::logger
@@ -0,0 +1,189 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Deferred formatting of the log messages (enabled with the
+ * "deferred_formatting" logger setting).
+ *
+ * Rather than formatting the message on the calling thread, a message with
+ * a string literal format takes a copy of its arguments into a ring buffer
+ * owned by the calling thread, and a dedicated thread formats the messages
+ * and hands them to the logger (with the time they were logged at).
+ *
+ * Only arguments which are safe to copy and format later are deferred:
+ * arithmetic types, enums and strings (std::string, string views and C
+ * strings are copied into a std::string). A message with any other
+ * argument (for instance a view into memory the caller owns), or which
+ * doesn't fit into a ring buffer slot, or logged while the ring buffer of
+ * the thread is full is formatted on the calling thread as usual. The
+ * messages therefore keep their timestamps, but the deferred messages may
+ * be written after a message the same thread logged later.
+ */
+
+#pragma once
+
+#include <logger/visibility.h>
+#include <spdlog/logger.h>
+
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace cb::logger {
+
+/// Specialise (with a member type "type" the argument is stored as) to
+/// allow the messages with an argument of type T to be deferred
+template <class T, class = void>
+struct DeferredArgument {};
+
+template <class T>
+struct DeferredArgument<
+        T,
+        std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>> {
+    using type = T;
+};
+
+template <>
+struct DeferredArgument<std::string> {
+    using type = std::string;
+};
+
+template <>
+struct DeferredArgument<std::string_view> {
+    using type = std::string;
+};
+
+template <>
+struct DeferredArgument<const char*> {
+    using type = std::string;
+};
+
+template <>
+struct DeferredArgument<char*> {
+    using type = std::string;
+};
+
+namespace detail {
+
+/// A message waiting in a ring buffer to be formatted
+struct DeferredSlot {
+    static constexpr size_t StorageSize = 192;
+
+    spdlog::level::level_enum level;
+    spdlog::log_clock::time_point time;
+    /// Format the message into out (unless out is nullptr) and destroy
+    /// the message stored in storage
+    void (*consume)(void* storage, std::string* out);
+    alignas(std::max_align_t) unsigned char storage[StorageSize];
+};
+
+/**
+ * Reserve the next slot in the ring buffer of the calling thread
+ *
+ * @return the slot to populate and pass to commitDeferredSlot(), or
+ *         nullptr if deferred formatting is disabled or the ring is full
+ */
+LOGGER_PUBLIC_API
+DeferredSlot* reserveDeferredSlot();
+
+/// Make the slot returned by reserveDeferredSlot() visible to the
+/// formatting thread
+LOGGER_PUBLIC_API
+void commitDeferredSlot();
+
+template <class T, class = void>
+struct IsDeferrable : std::false_type {};
+
+template <class T>
+struct IsDeferrable<T, std::void_t<typename DeferredArgument<T>::type>>
+    : std::true_type {};
+
+template <class... Args>
+struct DeferredMessage {
+    const char* format;
+    std::tuple<typename DeferredArgument<std::decay_t<Args>>::type...> args;
+
+    static void consume(void* storage, std::string* out) {
+        auto* message = static_cast<DeferredMessage*>(storage);
+        if (out) {
+            try {
+                *out = std::apply(
+                        [message](const auto&... a) {
+                            return fmt::format(message->format, a...);
+                        },
+                        message->args);
+            } catch (const std::exception& e) {
+                *out = std::string{"Failed to format log message \""} +
+                       message->format + "\": " + e.what();
+            }
+        }
+        message->~DeferredMessage();
+    }
+};
+
+} // namespace detail
+
+/**
+ * Log the message (the severity is already checked by the caller). It is
+ * deferred if the format is a string literal and all of the arguments are
+ * deferrable, otherwise it is formatted right away.
+ */
+template <size_t N, class... Args>
+void logMessage(spdlog::logger& logger,
+                spdlog::level::level_enum severity,
+                const char (&format)[N],
+                const Args&... args) {
+    if constexpr (sizeof...(Args) > 0 &&
+                  (detail::IsDeferrable<std::decay_t<Args>>::value && ...)) {
+        using Message = detail::DeferredMessage<Args...>;
+        if constexpr (sizeof(Message) <= detail::DeferredSlot::StorageSize &&
+                      alignof(Message) <= alignof(std::max_align_t)) {
+            auto* slot = detail::reserveDeferredSlot();
+            if (slot) {
+                new (slot->storage)
+                        Message{format, decltype(Message::args)(args...)};
+                slot->level = severity;
+                slot->time = spdlog::log_clock::now();
+                slot->consume = &Message::consume;
+                detail::commitDeferredSlot();
+                return;
+            }
+        }
+    }
+    logger.log(severity, format, args...);
+}
+
+template <class... Args>
+void logMessage(spdlog::logger& logger,
+                spdlog::level::level_enum severity,
+                const Args&... args) {
+    logger.log(severity, args...);
+}
+
+/// Format and log all of the deferred messages logged so far
+LOGGER_PUBLIC_API
+void flushDeferred();
+
+/// Is deferred formatting enabled?
+LOGGER_PUBLIC_API
+bool isDeferredFormattingEnabled();
+
+} // namespace cb::logger
@@ -0,0 +1,31 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <spdlog/logger.h>
+#include <memory>
+
+namespace cb::logger::detail {
+
+/// Start the thread formatting the deferred messages and passing them
+/// on to logger
+void startDeferredFormatting(std::shared_ptr<spdlog::logger> logger);
+
+/// Format the remaining deferred messages and stop the thread
+void stopDeferredFormatting();
+
+} // namespace cb::logger::detail
@@ -31,6 +31,7 @@
 
 #pragma once
 
+#include <logger/deferred_logger.h>
 #include <logger/visibility.h>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/logger.h>
@@ -163,12 +164,12 @@ LOGGER_PUBLIC_API bool isInitialized();
 } // namespace logger
 } // namespace cb
 
-#define CB_LOG_ENTRY(severity, ...)                       \
-    do {                                                  \
-        auto _logger_ = cb::logger::get();                \
-        if (_logger_ && _logger_->should_log(severity)) { \
-            _logger_->log(severity, __VA_ARGS__);         \
-        }                                                 \
+#define CB_LOG_ENTRY(severity, ...)                                   \
+    do {                                                              \
+        auto _logger_ = cb::logger::get();                            \
+        if (_logger_ && _logger_->should_log(severity)) {             \
+            cb::logger::logMessage(*_logger_, severity, __VA_ARGS__); \
+        }                                                             \
     } while (false)
 
 #define LOG_TRACE(...) \
@@ -27,7 +27,11 @@
  */
 class LoggerBench : public benchmark::Fixture {
 protected:
-    void SetUp(const benchmark::State& state) override;
+    void SetUp(const benchmark::State& state) override {
+        setUpLogger(state, false);
+    }
+
+    void setUpLogger(const benchmark::State& state, bool deferred);
 
     void TearDown(const benchmark::State& state) override {
         if (state.thread_index == 0) {
@@ -42,13 +46,14 @@ protected:
     }
 };
 
-void LoggerBench::SetUp(const benchmark::State& state) {
+void LoggerBench::setUpLogger(const benchmark::State& state, bool deferred) {
     if (state.thread_index == 0) {
         cb::logger::Config config{};
         config.cyclesize = 2048;
         config.buffersize = 8192;
         config.unit_test = true;
         config.console = false;
+        config.deferred_formatting = deferred;
 
         auto init = cb::logger::initialize(config);
         if (init) {
@@ -60,6 +65,14 @@ void LoggerBench::SetUp(const benchmark::State& state) {
     }
 }
 
+/// The same as LoggerBench, but with the deferred formatting enabled
+class LoggerBench_Deferred : public LoggerBench {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        setUpLogger(state, true);
+    }
+};
+
 class LoggerBench_Blackhole : public LoggerBench {
 protected:
     void SetUp(const benchmark::State& state) override {
@@ -99,6 +112,49 @@ BENCHMARK_DEFINE_F(LoggerBench, LogToLoggerWithEnabledLogLevel)
     }
 }
 
+/**
+ * Benchmark the cost of logging a message with a few arguments to a level
+ * which is enabled, formatting it on the calling thread.
+ */
+BENCHMARK_DEFINE_F(LoggerBench, LogWithArguments)(benchmark::State& state) {
+    if (state.thread_index == 0) {
+        cb::logger::get()->set_level(spdlog::level::level_enum::trace);
+    }
+    const std::string name = "eq_dcpq:replication:ns_1@127.0.0.1->ns_1@host";
+    uint64_t seqno = 0;
+    while (state.KeepRunning()) {
+        LOG_TRACE("{} (vb:{}) Sending snapshot marker {}-{} flags:{:x}",
+                  name,
+                  uint16_t(771),
+                  seqno,
+                  seqno + 10,
+                  0x2);
+        ++seqno;
+    }
+}
+
+/**
+ * The same as LogWithArguments, but the messages are formatted by the
+ * deferred formatting thread.
+ */
+BENCHMARK_DEFINE_F(LoggerBench_Deferred, LogWithArguments)
+(benchmark::State& state) {
+    if (state.thread_index == 0) {
+        cb::logger::get()->set_level(spdlog::level::level_enum::trace);
+    }
+    const std::string name = "eq_dcpq:replication:ns_1@127.0.0.1->ns_1@host";
+    uint64_t seqno = 0;
+    while (state.KeepRunning()) {
+        LOG_TRACE("{} (vb:{}) Sending snapshot marker {}-{} flags:{:x}",
+                  name,
+                  uint16_t(771),
+                  seqno,
+                  seqno + 10,
+                  0x2);
+        ++seqno;
+    }
+}
+
 /**
  * Benchmark the cost of grabbing the logger (which means checking
  * for it's existence and copy a shared pointer).
@@ -117,6 +173,10 @@ BENCHMARK_REGISTER_F(LoggerBench, LogToLoggerWithDisabledLogLevel)
 BENCHMARK_REGISTER_F(LoggerBench, LogToLoggerWithEnabledLogLevel)
         ->Threads(1)
         ->Threads(16);
+BENCHMARK_REGISTER_F(LoggerBench, LogWithArguments)->Threads(1)->Threads(16);
+BENCHMARK_REGISTER_F(LoggerBench_Deferred, LogWithArguments)
+        ->Threads(1)
+        ->Threads(16);
 
 int main(int argc, char** argv) {
     ::benchmark::Initialize(&argc, argv);
@@ -44,6 +44,9 @@ struct LOGGER_PUBLIC_API Config {
     bool unit_test = false;
     /// Should messages be passed on to the console via stderr
     bool console = true;
+    /// Should the messages be formatted by a separate thread rather than
+    /// by the thread logging them (see deferred_logger.h)
+    bool deferred_formatting = false;
     /// The default log level to initialize the logger to
     spdlog::level::level_enum log_level = spdlog::level::level_enum::info;
 };
@@ -247,3 +247,68 @@ TEST_F(SpdloggerTest, ShutdownRace) {
     EXPECT_EQ(1, countInFile(files.front(), "CRITICAL and this one"));
     EXPECT_EQ(1, countInFile(files.front(), "CRITICAL " + str));
 }
+
+/**
+ * Test class for the tests running with the deferred formatting
+ */
+class DeferredFormattingTest : public SpdloggerTest {
+protected:
+    void SetUp() override {
+        config.deferred_formatting = true;
+        setUpLogger();
+    }
+};
+
+TEST_F(DeferredFormattingTest, Enabled) {
+    EXPECT_TRUE(cb::logger::isDeferredFormattingEnabled());
+    cb::logger::shutdown();
+    EXPECT_FALSE(cb::logger::isDeferredFormattingEnabled());
+}
+
+/**
+ * The deferred messages are formatted with the arguments as they were when
+ * logged (the strings are copied)
+ */
+TEST_F(DeferredFormattingTest, ArgumentsAreCopied) {
+    std::string value = "before";
+    const char* cstring = value.c_str();
+    LOG_INFO("DeferredFormatting {} {} {} {:x}",
+             value,
+             cstring,
+             std::string_view{value},
+             0xdeadbeef);
+    value = "after!";
+    cb::logger::shutdown();
+    files = cb::io::findFilesWithPrefix(config.filename);
+    ASSERT_EQ(1, files.size()) << "We should only have a single logfile";
+    EXPECT_EQ(1,
+              countInFile(files.front(),
+                          "INFO DeferredFormatting before before before "
+                          "deadbeef"));
+}
+
+/// The messages which can't be deferred are still logged
+TEST_F(DeferredFormattingTest, NotDeferrable) {
+    LOG_INFO("DeferredFormatting {}", Vbid(1023));
+    LOG_INFO(std::string{"DeferredFormatting std::string"});
+    cb::logger::shutdown();
+    files = cb::io::findFilesWithPrefix(config.filename);
+    ASSERT_EQ(1, files.size()) << "We should only have a single logfile";
+    EXPECT_EQ(1, countInFile(files.front(), "INFO DeferredFormatting vb:1023"));
+    EXPECT_EQ(1,
+              countInFile(files.front(),
+                          "INFO DeferredFormatting std::string"));
+}
+
+/// Messages logged while the ring buffer is full are formatted right away
+TEST_F(DeferredFormattingTest, RingFull) {
+    for (int ii = 0; ii < 2000; ++ii) {
+        LOG_INFO("DeferredFormatting {}", ii);
+    }
+    cb::logger::shutdown();
+    const auto content = getLogContents();
+    for (int ii = 0; ii < 2000; ++ii) {
+        const auto msg = "INFO DeferredFormatting " + std::to_string(ii) + "\n";
+        EXPECT_NE(std::string::npos, content.find(msg)) << msg;
+    }
+}
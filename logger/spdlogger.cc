@@ -15,6 +15,7 @@
  *   limitations under the License.
  */
 #include "custom_rotating_file_sink.h"
+#include "deferred_logger_internal.h"
 
 #include "logger.h"
 #include "logger_config.h"
@@ -51,6 +52,7 @@ static std::shared_ptr<spdlog::logger> file_logger;
 
 LOGGER_PUBLIC_API
 void cb::logger::flush() {
+    flushDeferred();
     if (file_logger) {
         file_logger->flush();
     }
@@ -58,6 +60,9 @@ void cb::logger::flush() {
 
 LOGGER_PUBLIC_API
 void cb::logger::shutdown() {
+    // Format the remaining deferred messages (and stop deferring them)
+    detail::stopDeferredFormatting();
+
     // Force a flush (posts a message to the async logger if we are not in unit
     // test mode)
     flush();
@@ -148,6 +153,7 @@ std::optional<std::string> cb::logger::initialize(
             sink->add_sink(stderrsink);
         }
 
+        detail::stopDeferredFormatting();
         spdlog::drop(logger_name);
 
         if (logger_settings.unit_test) {
@@ -173,6 +179,10 @@ std::optional<std::string> cb::logger::initialize(
         spdlog::flush_every(std::chrono::seconds(1));
 
         spdlog::register_logger(file_logger);
+
+        if (logger_settings.deferred_formatting) {
+            detail::startDeferredFormatting(file_logger);
+        }
     } catch (const spdlog::spdlog_ex& ex) {
         std::string msg =
                 std::string{"Log initialization failed: "} + ex.what();
@@ -187,12 +197,14 @@ spdlog::logger* cb::logger::get() {
 
 LOGGER_PUBLIC_API
 void cb::logger::reset() {
+    detail::stopDeferredFormatting();
     spdlog::drop(logger_name);
     file_logger.reset();
 }
 
 void cb::logger::createBlackholeLogger() {
     // delete if already exists
+    detail::stopDeferredFormatting();
     spdlog::drop(logger_name);
 
     file_logger = std::make_shared<spdlog::logger>(
@@ -206,6 +218,7 @@ void cb::logger::createBlackholeLogger() {
 
 void cb::logger::createConsoleLogger() {
     // delete if already exists
+    detail::stopDeferredFormatting();
     spdlog::drop(logger_name);
 
     auto stderrsink = std::make_shared<spdlog::sinks::stderr_color_sink_st>();
@@ -0,0 +1,848 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+// clusterperf starts a cluster of memcached nodes on this machine (using
+// the cluster_framework, with the replication between the nodes run by
+// the DcpReplicator), runs a client workload against it while running one
+// of the scenarios below, and prints what it measured:
+//
+//   steady     Just the workload
+//   rebalance  Move the active copy of the vBuckets to one of their
+//              replicas, one vBucket after the other (see
+//              Bucket::moveActive)
+//   failover   Fail over one of the nodes (see Bucket::failover)
+//   durable    A storm of durable writes (all of the operations are writes
+//              with durability level majority, from 16 threads)
+//
+// The client latency is the time from sending an operation until it
+// succeeded (including the retries of operations sent to a node no longer
+// active for the vBucket, or which failed with a temporary failure). The
+// replication lag is sampled by storing a document in a vBucket (round
+// robin) every --lag-interval, and timing how long it takes until the
+// high seqno of all of the replicas of the vBucket covers it. The takeover
+// time is the time from starting to move (or fail over) a vBucket until
+// the new active accepted a write for it.
+
+#include <cluster_framework/bucket.h>
+#include <cluster_framework/cluster.h>
+#include <event2/thread.h>
+#include <getopt.h>
+#include <memcached/durability_spec.h>
+#include <nlohmann/json.hpp>
+#include <platform/dirutils.h>
+#include <platform/socket.h>
+#include <protocol/connection/client_connection.h>
+#include <protocol/connection/client_mcbp_commands.h>
+#include <protocol/connection/frameinfo.h>
+#include <utilities/hdrhistogram.h>
+#include <utilities/terminate_handler.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+static unsigned long strtoul(const std::string& arg) {
+    try {
+        size_t end = 0;
+        auto ret = std::stoul(arg, &end, 10);
+        if (end != arg.size()) {
+            std::cerr << "Failed to parse string (extra characters at the "
+                         "end): "
+                      << arg.substr(end) << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        return ret;
+    } catch (const std::exception& exception) {
+        std::cerr << "Failed to parse string \"" << arg
+                  << "\": " << exception.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+enum class Scenario { Steady, Rebalance, Failover, Durable };
+
+static Scenario to_scenario(const std::string& name) {
+    if (name == "steady") {
+        return Scenario::Steady;
+    } else if (name == "rebalance") {
+        return Scenario::Rebalance;
+    } else if (name == "failover") {
+        return Scenario::Failover;
+    } else if (name == "durable") {
+        return Scenario::Durable;
+    }
+    throw std::invalid_argument("Unknown scenario: " + name);
+}
+
+static std::string to_string(Scenario scenario) {
+    switch (scenario) {
+    case Scenario::Steady:
+        return "steady";
+    case Scenario::Rebalance:
+        return "rebalance";
+    case Scenario::Failover:
+        return "failover";
+    case Scenario::Durable:
+        return "durable";
+    }
+    return "unknown";
+}
+
+struct Config {
+    Scenario scenario = Scenario::Steady;
+    size_t nodes = 4;
+    size_t vbuckets = 16;
+    size_t replicas = 2;
+    size_t threads = 4;
+    size_t keys = 10000;
+    size_t valueSize = 256;
+    /// The percentage of the operations which are gets
+    size_t reads = 50;
+    cb::durability::Level durability = cb::durability::Level::None;
+    std::chrono::seconds duration{30};
+    std::chrono::milliseconds lagInterval{100};
+    /// The node to fail over (failover scenario)
+    size_t failoverNode = 0;
+    /// The number of vBuckets to move (rebalance scenario)
+    size_t moves = 0;
+    bool json = false;
+};
+
+/// The histograms used for all of the timings (in us, up to 1 minute)
+static HdrHistogram createHistogram() {
+    return HdrHistogram(1, 60 * 1000 * 1000, 2);
+}
+
+/**
+ * The clients' view of the vBucket map. It is updated by the scenario
+ * thread after every change to the map of the bucket, and copied by the
+ * clients when they're told they sent an operation to the wrong node.
+ */
+class Topology {
+public:
+    explicit Topology(const cb::test::Bucket& bucket) {
+        update(bucket);
+    }
+
+    void update(const cb::test::Bucket& bucket) {
+        std::lock_guard<std::mutex> guard(mutex);
+        map = bucket.getVbucketMap();
+    }
+
+    std::vector<std::vector<int>> get() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return map;
+    }
+
+protected:
+    mutable std::mutex mutex;
+    std::vector<std::vector<int>> map;
+};
+
+/// Connect to the bucket on the given node
+static std::unique_ptr<MemcachedConnection> connectBucket(
+        const cb::test::Cluster& cluster,
+        const cb::test::Bucket& bucket,
+        size_t node) {
+    auto conn = cluster.getConnection(node);
+    conn->authenticate("@admin", "password", "PLAIN");
+    conn->selectBucket(bucket.getName());
+    conn->setFeatures({cb::mcbp::Feature::MUTATION_SEQNO,
+                       cb::mcbp::Feature::XERROR,
+                       cb::mcbp::Feature::SELECT_BUCKET});
+    return conn;
+}
+
+/**
+ * Should the operation which failed with the error be retried (it was
+ * sent to a node no longer active for the vBucket, or the vBucket is
+ * changing state)?
+ */
+static bool isRetriable(const ConnectionError& error) {
+    using cb::mcbp::Status;
+    return error.isNotMyVbucket() || error.isTemporaryFailure() ||
+           error.getReason() == Status::SyncWriteInProgress ||
+           error.getReason() == Status::SyncWriteReCommitInProgress;
+}
+
+/**
+ * A client running the workload: every operation is a get or a (durable)
+ * set of one of the keys chosen at random, sent to the node the client
+ * believes is active for the vBucket of the key.
+ */
+class Worker {
+public:
+    struct Stats {
+        HdrHistogram get = createHistogram();
+        HdrHistogram set = createHistogram();
+        uint64_t retries = 0;
+        uint64_t errors = 0;
+    };
+
+    Worker(const Config& config,
+           const cb::test::Cluster& cluster,
+           const cb::test::Bucket& bucket,
+           const Topology& topology,
+           size_t id)
+        : config(config),
+          cluster(cluster),
+          bucket(bucket),
+          topology(topology),
+          map(topology.get()),
+          connections(cluster.size()),
+          random(id),
+          value(config.valueSize, 'x') {
+    }
+
+    void run(const std::atomic_bool& stop) {
+        std::uniform_int_distribution<size_t> keys(0, config.keys - 1);
+        std::uniform_int_distribution<size_t> percent(0, 99);
+        while (!stop) {
+            const auto key = keys(random);
+            const Vbid vbid(uint16_t(key % config.vbuckets));
+            const auto id = "key_" + std::to_string(key);
+            const bool read = percent(random) < config.reads;
+            const auto start = std::chrono::steady_clock::now();
+            bool success;
+            if (read) {
+                success = execute(vbid, [&id, vbid](MemcachedConnection& c) {
+                    try {
+                        c.get(id, vbid);
+                    } catch (const ConnectionError& error) {
+                        if (!error.isNotFound()) {
+                            throw;
+                        }
+                    }
+                });
+            } else {
+                success = execute(
+                        vbid, [this, &id, vbid](MemcachedConnection& c) {
+                            set(c, id, vbid);
+                        });
+            }
+            if (success) {
+                const auto elapsed =
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - start);
+                (read ? stats.get : stats.set).addValue(elapsed.count());
+            }
+        }
+    }
+
+    const Stats& getStats() const {
+        return stats;
+    }
+
+protected:
+    void set(MemcachedConnection& conn, const std::string& id, Vbid vbid) {
+        Document doc;
+        doc.info.id = id;
+        doc.info.datatype = cb::mcbp::Datatype::Raw;
+        doc.value = value;
+        if (config.durability == cb::durability::Level::None) {
+            conn.mutate(doc, vbid, MutationType::Set);
+        } else {
+            const auto level = config.durability;
+            conn.mutate(doc, vbid, MutationType::Set, [level]() {
+                FrameInfoVector ret;
+                ret.emplace_back(std::make_unique<DurabilityFrameInfo>(level));
+                return ret;
+            });
+        }
+    }
+
+    /**
+     * Execute the operation on the node active for the vBucket, retrying
+     * it (with a fresh copy of the topology) until it succeeds (or fails
+     * with an error which isn't retriable)
+     *
+     * @return true if the operation succeeded
+     */
+    bool execute(Vbid vbid,
+                 const std::function<void(MemcachedConnection&)>& operation) {
+        while (true) {
+            try {
+                operation(getConnection(map[vbid.get()][0]));
+                return true;
+            } catch (const ConnectionError& error) {
+                if (!isRetriable(error)) {
+                    ++stats.errors;
+                    return false;
+                }
+                ++stats.retries;
+                map = topology.get();
+                std::this_thread::sleep_for(100us);
+            }
+        }
+    }
+
+    MemcachedConnection& getConnection(size_t node) {
+        auto& conn = connections[node];
+        if (!conn) {
+            conn = connectBucket(cluster, bucket, node);
+        }
+        return *conn;
+    }
+
+    const Config& config;
+    const cb::test::Cluster& cluster;
+    const cb::test::Bucket& bucket;
+    const Topology& topology;
+    std::vector<std::vector<int>> map;
+    std::vector<std::unique_ptr<MemcachedConnection>> connections;
+    std::mt19937_64 random;
+    const std::string value;
+    Stats stats;
+};
+
+/// Get the high seqno of the vBucket on the node the connection is to
+static uint64_t getHighSeqno(MemcachedConnection& conn, Vbid vbid) {
+    const auto vb = std::to_string(vbid.get());
+    const auto stats = conn.statsMap("vbucket-seqno " + vb);
+    const auto iter = stats.find("vb_" + vb + ":high_seqno");
+    return iter == stats.end() ? 0 : std::stoull(iter->second);
+}
+
+/**
+ * Samples the replication lag by storing a document in one vBucket
+ * after the other, and polling the replicas of the vBucket until they
+ * have all received it.
+ */
+class LagSampler {
+public:
+    LagSampler(const Config& config,
+               const cb::test::Cluster& cluster,
+               const cb::test::Bucket& bucket,
+               const Topology& topology)
+        : config(config),
+          cluster(cluster),
+          bucket(bucket),
+          topology(topology),
+          connections(cluster.size()) {
+    }
+
+    void run(const std::atomic_bool& stop) {
+        size_t next = 0;
+        while (!stop) {
+            const auto started = std::chrono::steady_clock::now();
+            sample(Vbid(uint16_t(next++ % config.vbuckets)), stop);
+            std::this_thread::sleep_until(started + config.lagInterval);
+        }
+    }
+
+    const HdrHistogram& getLag() const {
+        return lag;
+    }
+
+    uint64_t getTimeouts() const {
+        return timeouts;
+    }
+
+protected:
+    void sample(Vbid vbid, const std::atomic_bool& stop) {
+        const auto chain = topology.get()[vbid.get()];
+        uint64_t seqno;
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            seqno = getConnection(chain[0])
+                            .store("lag_probe_" + std::to_string(vbid.get()),
+                                   vbid,
+                                   "probe")
+                            .seqno;
+        } catch (const ConnectionError& error) {
+            if (isRetriable(error)) {
+                // The vBucket is moving, try the next one
+                return;
+            }
+            throw;
+        }
+
+        const auto deadline = start + 10s;
+        for (auto iter = chain.begin() + 1; iter != chain.end(); ++iter) {
+            if (*iter == -1) {
+                continue;
+            }
+            auto& replica = getConnection(*iter);
+            while (getHighSeqno(replica, vbid) < seqno) {
+                if (stop || std::chrono::steady_clock::now() > deadline) {
+                    ++timeouts;
+                    return;
+                }
+                std::this_thread::sleep_for(100us);
+            }
+        }
+        lag.addValue(std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count());
+    }
+
+    MemcachedConnection& getConnection(size_t node) {
+        auto& conn = connections[node];
+        if (!conn) {
+            conn = connectBucket(cluster, bucket, node);
+        }
+        return *conn;
+    }
+
+    const Config& config;
+    const cb::test::Cluster& cluster;
+    const cb::test::Bucket& bucket;
+    const Topology& topology;
+    std::vector<std::unique_ptr<MemcachedConnection>> connections;
+    HdrHistogram lag = createHistogram();
+    uint64_t timeouts = 0;
+};
+
+/// Keep writing to the vBucket until the node active for it accepts it
+static void awaitWritable(const cb::test::Cluster& cluster,
+                          const cb::test::Bucket& bucket,
+                          Vbid vbid) {
+    auto conn = connectBucket(
+            cluster, bucket, bucket.getVbucketMap()[vbid.get()][0]);
+    while (true) {
+        try {
+            conn->store("takeover_probe", vbid, "probe");
+            return;
+        } catch (const ConnectionError& error) {
+            if (!isRetriable(error)) {
+                throw;
+            }
+            std::this_thread::sleep_for(100us);
+        }
+    }
+}
+
+/// The results of the rebalance and failover scenarios
+struct ScenarioResult {
+    HdrHistogram takeover = createHistogram();
+    std::chrono::microseconds total{0};
+};
+
+static ScenarioResult runRebalance(const Config& config,
+                                   const cb::test::Cluster& cluster,
+                                   cb::test::Bucket& bucket,
+                                   Topology& topology) {
+    ScenarioResult result;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t vb = 0; vb < config.moves; ++vb) {
+        const Vbid vbid(uint16_t(vb % config.vbuckets));
+        const auto begin = std::chrono::steady_clock::now();
+        bucket.moveActive(vbid);
+        topology.update(bucket);
+        awaitWritable(cluster, bucket, vbid);
+        const auto now = std::chrono::steady_clock::now();
+        result.takeover.addValue(
+                std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                                      begin)
+                        .count());
+    }
+    result.total = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    return result;
+}
+
+static ScenarioResult runFailover(const Config& config,
+                                  const cb::test::Cluster& cluster,
+                                  cb::test::Bucket& bucket,
+                                  Topology& topology) {
+    std::vector<Vbid> affected;
+    const auto& map = bucket.getVbucketMap();
+    for (size_t vb = 0; vb < map.size(); ++vb) {
+        if (map[vb][0] == int(config.failoverNode)) {
+            affected.emplace_back(uint16_t(vb));
+        }
+    }
+
+    ScenarioResult result;
+    const auto start = std::chrono::steady_clock::now();
+    bucket.failover(config.failoverNode);
+    topology.update(bucket);
+    for (const auto& vbid : affected) {
+        awaitWritable(cluster, bucket, vbid);
+        result.takeover.addValue(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count());
+    }
+    result.total = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    return result;
+}
+
+static nlohmann::json to_json(const HdrHistogram& histogram) {
+    return {{"count", histogram.getValueCount()},
+            {"mean", uint64_t(histogram.getMean())},
+            {"p50", histogram.getValueAtPercentile(50)},
+            {"p90", histogram.getValueAtPercentile(90)},
+            {"p99", histogram.getValueAtPercentile(99)},
+            {"p99.9", histogram.getValueAtPercentile(99.9)},
+            {"max", histogram.getMaxValue()}};
+}
+
+static void printRow(const std::string& name,
+                     const HdrHistogram& histogram,
+                     std::chrono::microseconds duration) {
+    const auto count = histogram.getValueCount();
+    std::cout << std::left << std::setw(14) << name << std::right
+              << std::setw(11) << count << std::setw(10)
+              << count * 1000000 /
+                         std::max(uint64_t(1), uint64_t(duration.count()))
+              << std::setw(10) << uint64_t(histogram.getMean())
+              << std::setw(10) << histogram.getValueAtPercentile(50)
+              << std::setw(10) << histogram.getValueAtPercentile(90)
+              << std::setw(10) << histogram.getValueAtPercentile(99)
+              << std::setw(10) << histogram.getValueAtPercentile(99.9)
+              << std::setw(10) << histogram.getMaxValue() << std::endl;
+}
+
+static void usage() {
+    std::cerr << R"(Usage: clusterperf [options]
+
+Options:
+
+  --scenario name       The scenario to run: steady, rebalance, failover or
+                        durable (default steady)
+  --nodes num           The number of nodes in the cluster (default 4)
+  --vbuckets num        The number of vBuckets (default 16)
+  --replicas num        The number of replicas (default 2)
+  --threads num         The number of client threads (default 4, 16 for
+                        the durable scenario)
+  --keys num            The number of keys in the key space (default 10000)
+  --value-size num      The size of the values stored (default 256)
+  --reads percent       The percentage of the operations which are gets
+                        (default 50, 0 for the durable scenario)
+  --durability level    The durability level of the writes: none, majority,
+                        majority_and_persist_on_master or
+                        persist_to_majority (default none, majority for the
+                        durable scenario)
+  --duration seconds    How long to run the workload for (default 30). The
+                        rebalance and failover start once a third of it
+                        has passed, and the workload keeps running until
+                        they completed.
+  --lag-interval ms     The interval between the replication lag samples
+                        (default 100)
+  --moves num           The number of vBuckets to move in the rebalance
+                        scenario (default all of them)
+  --failover-node num   The node to fail over in the failover scenario
+                        (default the last one)
+  --directory path      The directory to create the nodes in (default
+                        ./cluster_XXXXX)
+  --json                Print the results as JSON
+  --help                This help text
+
+)";
+}
+
+int main(int argc, char** argv) {
+    // Make sure that we dump callstacks on the console
+    install_backtrace_terminate_handler();
+    // Initialize the socket subsystem
+    cb_initialize_sockets();
+
+#if defined(EVTHREAD_USE_WINDOWS_THREADS_IMPLEMENTED)
+    const auto failed = evthread_use_windows_threads() == -1;
+#elif defined(EVTHREAD_USE_PTHREADS_IMPLEMENTED)
+    const auto failed = evthread_use_pthreads() == -1;
+#else
+#error "No locking mechanism for libevent available!"
+#endif
+
+    if (failed) {
+        std::cerr << "Failed to enable libevent locking. Terminating program"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int cmd;
+    Config config;
+    std::optional<size_t> threads;
+    std::optional<size_t> reads;
+    std::optional<cb::durability::Level> durability;
+    std::optional<size_t> failoverNode;
+    std::optional<std::string> directory;
+
+    std::vector<option> long_options = {
+            {"scenario", required_argument, nullptr, 's'},
+            {"nodes", required_argument, nullptr, 'n'},
+            {"vbuckets", required_argument, nullptr, 'V'},
+            {"replicas", required_argument, nullptr, 'r'},
+            {"threads", required_argument, nullptr, 'T'},
+            {"keys", required_argument, nullptr, 'k'},
+            {"value-size", required_argument, nullptr, 'S'},
+            {"reads", required_argument, nullptr, 'R'},
+            {"durability", required_argument, nullptr, 'D'},
+            {"duration", required_argument, nullptr, 'd'},
+            {"lag-interval", required_argument, nullptr, 'l'},
+            {"moves", required_argument, nullptr, 'm'},
+            {"failover-node", required_argument, nullptr, 'f'},
+            {"directory", required_argument, nullptr, 'o'},
+            {"json", no_argument, nullptr, 'j'},
+            {"help", no_argument, nullptr, 0},
+            {nullptr, 0, nullptr, 0}};
+
+    try {
+        while ((cmd = getopt_long(argc,
+                                  argv,
+                                  "s:n:V:r:T:k:S:R:D:d:l:m:f:o:j",
+                                  long_options.data(),
+                                  nullptr)) != EOF) {
+            switch (cmd) {
+            case 's':
+                config.scenario = to_scenario(optarg);
+                break;
+            case 'n':
+                config.nodes = strtoul(optarg);
+                break;
+            case 'V':
+                config.vbuckets = strtoul(optarg);
+                break;
+            case 'r':
+                config.replicas = strtoul(optarg);
+                break;
+            case 'T':
+                threads = strtoul(optarg);
+                break;
+            case 'k':
+                config.keys = strtoul(optarg);
+                break;
+            case 'S':
+                config.valueSize = strtoul(optarg);
+                break;
+            case 'R':
+                reads = strtoul(optarg);
+                break;
+            case 'D':
+                durability = cb::durability::to_level(optarg);
+                break;
+            case 'd':
+                config.duration = std::chrono::seconds(strtoul(optarg));
+                break;
+            case 'l':
+                config.lagInterval = std::chrono::milliseconds(strtoul(optarg));
+                break;
+            case 'm':
+                config.moves = strtoul(optarg);
+                break;
+            case 'f':
+                failoverNode = strtoul(optarg);
+                break;
+            case 'o':
+                directory = optarg;
+                break;
+            case 'j':
+                config.json = true;
+                break;
+            default:
+                usage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const bool durable = config.scenario == Scenario::Durable;
+    config.threads = threads.value_or(durable ? 16 : 4);
+    config.reads = reads.value_or(durable ? 0 : 50);
+    config.durability = durability.value_or(
+            durable ? cb::durability::Level::Majority
+                    : cb::durability::Level::None);
+    config.failoverNode = failoverNode.value_or(config.nodes - 1);
+    if (config.moves == 0) {
+        config.moves = config.vbuckets;
+    }
+
+    if (config.nodes == 0 || config.vbuckets == 0 || config.threads == 0 ||
+        config.keys == 0 || config.reads > 100) {
+        std::cerr << "The number of nodes, vBuckets, threads and keys must be "
+                     "at least 1, and the reads a percentage"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (config.replicas >= config.nodes) {
+        std::cerr << "There must be more nodes than replicas" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if ((config.scenario == Scenario::Rebalance ||
+         config.scenario == Scenario::Failover) &&
+        config.replicas == 0) {
+        std::cerr << "The " << to_string(config.scenario)
+                  << " scenario needs at least one replica" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (config.failoverNode >= config.nodes) {
+        std::cerr << "Invalid node to fail over" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto isasl_file_name = cb::io::sanitizePath(
+            SOURCE_ROOT "/tests/testapp_cluster/cbsaslpw.json");
+
+    // Add the file to the exec environment
+    static std::array<char, 1024> isasl_env_var;
+    snprintf(isasl_env_var.data(),
+             isasl_env_var.size(),
+             "CBSASL_PWFILE=%s",
+             isasl_file_name.c_str());
+    putenv(isasl_env_var.data());
+
+#ifndef WIN32
+    if (sigignore(SIGPIPE) == -1) {
+        std::cerr << "Fatal: failed to ignore SIGPIPE; sigaction" << std::endl;
+        return EXIT_FAILURE;
+    }
+#endif
+
+    try {
+        auto cluster = cb::test::Cluster::create(config.nodes, directory);
+        auto bucket = cluster->createBucket(
+                "default",
+                {{"replicas", config.replicas},
+                 {"max_vbuckets", config.vbuckets}});
+        Topology topology(*bucket);
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        for (size_t ii = 0; ii < config.threads; ++ii) {
+            workers.emplace_back(std::make_unique<Worker>(
+                    config, *cluster, *bucket, topology, ii));
+        }
+        LagSampler sampler(config, *cluster, *bucket, topology);
+
+        std::atomic_bool stop{false};
+        std::atomic_bool error{false};
+        std::vector<std::thread> clients;
+        auto spawn = [&stop, &error, &clients](auto& runner) {
+            clients.emplace_back([&runner, &stop, &error]() {
+                try {
+                    runner.run(stop);
+                } catch (const std::exception& ex) {
+                    std::cerr << ex.what() << std::endl;
+                    error = true;
+                    stop = true;
+                }
+            });
+        };
+        for (auto& worker : workers) {
+            spawn(*worker);
+        }
+        spawn(sampler);
+
+        const auto start = std::chrono::steady_clock::now();
+        std::optional<ScenarioResult> result;
+        std::this_thread::sleep_for(config.duration / 3);
+        if (config.scenario == Scenario::Rebalance) {
+            result = runRebalance(config, *cluster, *bucket, topology);
+        } else if (config.scenario == Scenario::Failover) {
+            result = runFailover(config, *cluster, *bucket, topology);
+        }
+        std::this_thread::sleep_until(start + config.duration);
+
+        stop = true;
+        for (auto& thread : clients) {
+            thread.join();
+        }
+        const auto duration =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start);
+        if (error) {
+            return EXIT_FAILURE;
+        }
+
+        auto get = createHistogram();
+        auto set = createHistogram();
+        uint64_t retries = 0;
+        uint64_t errors = 0;
+        for (const auto& worker : workers) {
+            const auto& stats = worker->getStats();
+            get += stats.get;
+            set += stats.set;
+            retries += stats.retries;
+            errors += stats.errors;
+        }
+        const auto setName =
+                config.durability == cb::durability::Level::None
+                        ? std::string{"set"}
+                        : "set (" + to_string(config.durability) + ")";
+
+        if (config.json) {
+            nlohmann::json json = {
+                    {"scenario", to_string(config.scenario)},
+                    {"nodes", config.nodes},
+                    {"vbuckets", config.vbuckets},
+                    {"replicas", config.replicas},
+                    {"threads", config.threads},
+                    {"durability", to_string(config.durability)},
+                    {"duration_us", duration.count()},
+                    {"get", to_json(get)},
+                    {"set", to_json(set)},
+                    {"retries", retries},
+                    {"errors", errors},
+                    {"replication_lag", to_json(sampler.getLag())},
+                    {"replication_lag_timeouts", sampler.getTimeouts()}};
+            if (result) {
+                json["takeover"] = to_json(result->takeover);
+                json["scenario_time_us"] = result->total.count();
+            }
+            std::cout << json.dump(2) << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        std::cout << "Scenario " << to_string(config.scenario) << ": "
+                  << config.nodes << " nodes, " << config.vbuckets
+                  << " vBuckets, " << config.replicas << " replicas, "
+                  << config.threads << " threads, " << duration.count() / 1000
+                  << " ms" << std::endl
+                  << std::endl;
+        std::cout << std::left << std::setw(14) << "" << std::right
+                  << std::setw(11) << "count" << std::setw(10) << "per sec"
+                  << std::setw(10) << "mean" << std::setw(10) << "p50"
+                  << std::setw(10) << "p90" << std::setw(10) << "p99"
+                  << std::setw(10) << "p99.9" << std::setw(10) << "max"
+                  << "  (us)" << std::endl;
+        printRow("get", get, duration);
+        printRow(setName, set, duration);
+        printRow("repl. lag", sampler.getLag(), duration);
+        if (result) {
+            printRow("takeover", result->takeover, duration);
+        }
+        std::cout << std::endl
+                  << "Retried " << retries << " operations, " << errors
+                  << " failed" << std::endl
+                  << sampler.getTimeouts()
+                  << " replication lag samples timed out" << std::endl;
+        if (result) {
+            std::cout << "The " << to_string(config.scenario) << " took "
+                      << result->total.count() / 1000 << " ms" << std::endl;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -23,11 +23,17 @@
 #include <platform/socket.h>
 #include <programs/getpass.h>
 #include <programs/hostname_utils.h>
+#include <memcached/protocol_binary.h>
 #include <protocol/connection/client_connection.h>
 #include <protocol/connection/client_mcbp_commands.h>
+#include <protocol/connection/frameinfo.h>
 #include <utilities/terminate_handler.h>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <thread>
 #include <vector>
 
 static void usage() {
@@ -51,9 +57,23 @@ Options:
   -C or --csv                    Print out the result as csv (ms;bytes;#items)
   -M or --memcached              Connect to a memcached bucket (no cccp)
   -N or --name                   The dcp name to use
+  -n or --num-connections num    The number of DCP connections to open to each
+                                 node, with the node's vBuckets spread over
+                                 them [Default = 1]
+  -T or --num-threads num        The number of threads to drive the
+                                 connections from [Default = 1]
   -v or --verbose                Add more output
+  -V or --vbucket-stats          Print the throughput of each vBucket
   -4 or --ipv4                   Connect over IPv4
   -6 or --ipv6                   Connect over IPv6
+  --collections filter           Enable collections and stream the
+                                 collections of the given filter (JSON, see
+                                 docs/dcp/documentation/stream-request-value.md)
+                                 Use '{}' (or an empty filter) for all
+  --stream-id                    Enable DCP stream-IDs (each stream uses id 1)
+  --force-compression            Ask the producer to compress all values
+  --disable-snappy               Don't negotiate Snappy (values are
+                                 received inflated)
   --help                         This help text
 )";
 
@@ -96,14 +116,30 @@ bool isPacketAvailable(evbuffer* input) {
     return false;
 }
 
-size_t stream_end = 0;
-size_t mutations = 0;
 size_t buffersize = 13421772;
-size_t current_buffer_window = 0;
-size_t total_bytes = 0;
-size_t max_vbuckets = 0;
 bool verbose = false;
 
+/// The throughput counters of a vBucket (only updated by the thread of the
+/// connection streaming it)
+struct VBucketStats {
+    /// Mutations, deletions and expirations received
+    size_t items = 0;
+    /// Bytes of all the DCP messages received
+    size_t bytes = 0;
+    /// The items and bytes received in disk snapshots (from backfills)
+    size_t backfillItems = 0;
+    size_t backfillBytes = 0;
+    /// Is the current snapshot a disk snapshot?
+    bool diskSnapshot = false;
+    /// When the last message of a disk snapshot was received
+    std::chrono::steady_clock::time_point backfillEnd;
+    /// When the stream ended
+    std::chrono::steady_clock::time_point end;
+};
+
+/// Indexed by vBucket id
+std::vector<VBucketStats> vbstats;
+
 static void handleDcpNoop(const cb::mcbp::Request& header, bufferevent* bev) {
     cb::mcbp::Response resp = {};
     resp.setMagic(cb::mcbp::Magic::ClientResponse);
@@ -114,9 +150,95 @@ static void handleDcpNoop(const cb::mcbp::Request& header, bufferevent* bev) {
     }
 }
 
-void read_callback(bufferevent* bev, void*) {
-    static cb::compression::Buffer buffer;
+/// @return the flags of a (V1 or V2.x) snapshot marker
+static uint32_t getSnapshotMarkerFlags(const cb::mcbp::Request& req) {
+    using cb::mcbp::request::DcpSnapshotMarkerV1Payload;
+    // V2.x markers carry the V1 fields (and more) in the value
+    auto payload = req.getExtdata();
+    if (payload.size() != sizeof(DcpSnapshotMarkerV1Payload)) {
+        payload = req.getValue();
+    }
+    if (payload.size() < sizeof(DcpSnapshotMarkerV1Payload)) {
+        throw std::runtime_error("Invalid DcpSnapshotMarker received");
+    }
+    DcpSnapshotMarkerV1Payload marker;
+    std::memcpy(&marker, payload.data(), sizeof(marker));
+    return marker.getFlags();
+}
+
+/**
+ * A DCP connection streaming some of the vBuckets of a node, driven by the
+ * event loop of one of the threads.
+ */
+class DcpConnection {
+public:
+    explicit DcpConnection(std::vector<uint16_t> vbuckets)
+        : vbuckets(std::move(vbuckets)) {
+    }
+
+    static void read_callback(bufferevent* bev, void* ctx) {
+        static_cast<DcpConnection*>(ctx)->read(bev);
+    }
+
+    static void event_callback(bufferevent* bev, short event, void*) {
+        if (((event & BEV_EVENT_EOF) == BEV_EVENT_EOF) ||
+            ((event & BEV_EVENT_ERROR) == BEV_EVENT_ERROR)) {
+            std::cerr << "Other side closed connection: " << event
+                      << std::endl;
+            bufferevent_disable(bev, EV_READ | EV_WRITE);
+        }
+    }
+
+    const std::vector<uint16_t> vbuckets;
+    cb::libevent::unique_bufferevent_ptr bev;
+    size_t mutations = 0;
+    size_t total_bytes = 0;
 
+protected:
+    void read(bufferevent* bev);
+    void handleMessage(const cb::mcbp::Request& req, size_t size);
+
+    size_t stream_end = 0;
+    size_t current_buffer_window = 0;
+};
+
+void DcpConnection::handleMessage(const cb::mcbp::Request& req, size_t size) {
+    const auto vbid = req.getVBucket().get();
+    if (vbid >= vbstats.size()) {
+        return;
+    }
+    auto& vb = vbstats[vbid];
+    vb.bytes += size;
+
+    switch (req.getClientOpcode()) {
+    case cb::mcbp::ClientOpcode::DcpSnapshotMarker:
+        vb.diskSnapshot =
+                (getSnapshotMarkerFlags(req) &
+                 uint32_t(cb::mcbp::request::DcpSnapshotMarkerFlag::Disk)) !=
+                0;
+        break;
+    case cb::mcbp::ClientOpcode::DcpMutation:
+    case cb::mcbp::ClientOpcode::DcpDeletion:
+    case cb::mcbp::ClientOpcode::DcpExpiration:
+        ++vb.items;
+        if (vb.diskSnapshot) {
+            ++vb.backfillItems;
+        }
+        break;
+    case cb::mcbp::ClientOpcode::DcpStreamEnd:
+        vb.end = std::chrono::steady_clock::now();
+        break;
+    default:
+        break;
+    }
+
+    if (vb.diskSnapshot) {
+        vb.backfillBytes += size;
+        vb.backfillEnd = std::chrono::steady_clock::now();
+    }
+}
+
+void DcpConnection::read(bufferevent* bev) {
     auto* input = bufferevent_get_input(bev);
     while (isPacketAvailable(input)) {
         const auto* header = reinterpret_cast<const cb::mcbp::Header*>(
@@ -126,6 +248,7 @@ void read_callback(bufferevent* bev, void*) {
             std::cout << "< " << header->toJSON(false) << std::endl;
         }
 
+        const auto size = header->getBodylen() + sizeof(cb::mcbp::Header);
         if (header->isRequest()) {
             const auto& req = header->getRequest();
             bool dcpmsg = false;
@@ -169,9 +292,12 @@ void read_callback(bufferevent* bev, void*) {
                           << req.toJSON(false) << std::endl;
             }
 
+            if (dcpmsg) {
+                handleMessage(req, size);
+            }
+
             if (dcpmsg && buffersize > 0) {
-                current_buffer_window +=
-                        header->getBodylen() + sizeof(cb::mcbp::Header);
+                current_buffer_window += size;
                 if (current_buffer_window > (buffersize / 2)) {
                     // send buffer ack
                     std::array<uint8_t, sizeof(cb::mcbp::Header) + 4> backing;
@@ -190,11 +316,11 @@ void read_callback(bufferevent* bev, void*) {
                 }
             }
 
-            total_bytes += header->getBodylen() + sizeof(cb::mcbp::Header);
+            total_bytes += size;
         }
 
-        evbuffer_drain(input, header->getBodylen() + sizeof(cb::mcbp::Header));
-        if (stream_end == max_vbuckets) {
+        evbuffer_drain(input, size);
+        if (stream_end == vbuckets.size()) {
             // Received all stream end messages.. shut down our read
             // side and wait for our send pipe to be drained to cause
             // the bufferevent loop to stop
@@ -204,17 +330,10 @@ void read_callback(bufferevent* bev, void*) {
     }
 }
 
-void event_callback(bufferevent* bev, short event, void*) {
-    if (((event & BEV_EVENT_EOF) == BEV_EVENT_EOF) ||
-        ((event & BEV_EVENT_ERROR) == BEV_EVENT_ERROR)) {
-        std::cerr << "Other side closed connection: " << event << std::endl;
-        bufferevent_free(bev);
-    }
-}
-
-std::string calculateThroughput(size_t bytes, size_t sec) {
-    if (sec > 1) {
-        bytes /= sec;
+std::string calculateThroughput(size_t bytes,
+                                std::chrono::milliseconds duration) {
+    if (duration.count() > 1000) {
+        bytes = size_t(double(bytes) * 1000 / duration.count());
     }
 
     std::vector<const char*> suffix = {"B/s", "kB/s", "MB/s", "GB/s"};
@@ -287,37 +406,57 @@ std::pair<std::string, std::string> parseControlMessage(std::string value) {
                                                     value.substr(idx + 1));
 }
 
-// The vbucket map is a vector of pairs where the first entry is a connection
-// to a node, and the second entry is a vector containing all of the vbuckets
-// located on that node
-std::vector<
-        std::pair<std::unique_ptr<MemcachedConnection>, std::vector<uint16_t>>>
-        vbmap;
+/// @return items per second (or items if it took less than a second)
+static size_t calculateRate(size_t items, std::chrono::milliseconds duration) {
+    if (duration.count() > 1000) {
+        return size_t(double(items) * 1000 / duration.count());
+    }
+    return items;
+}
+
+// A node in the cluster and the vBuckets located on it
+struct Node {
+    std::string host;
+    in_port_t port;
+    std::vector<uint16_t> vbuckets;
+};
+
+std::vector<Node> nodes;
+size_t max_vbuckets = 0;
+
+static std::unique_ptr<MemcachedConnection> connect(
+        const std::string& host,
+        in_port_t in_port,
+        sa_family_t family,
+        const std::string& user,
+        const std::string& password,
+        const std::string& bucket,
+        const std::vector<cb::mcbp::Feature>& features) {
+    auto c = std::make_unique<MemcachedConnection>(
+            host, in_port, family, false);
+    c->connect();
+
+    if (!user.empty()) {
+        c->authenticate(user, password, c->getSaslMechanisms());
+    }
+
+    c->setFeatures(features);
+    c->selectBucket(bucket);
+    return c;
+}
 
 void setupVBMap(const std::string& host,
                 in_port_t in_port,
                 sa_family_t family,
                 const std::string& user,
                 const std::string& password,
-                const std::string& bucket) {
-    MemcachedConnection connection(host, in_port, family, false);
-    connection.connect();
-
-    if (!user.empty()) {
-        connection.authenticate(user, password, connection.getSaslMechanisms());
-    }
-
-    std::vector<cb::mcbp::Feature> features = {
-            {cb::mcbp::Feature::MUTATION_SEQNO,
-             cb::mcbp::Feature::XATTR,
-             cb::mcbp::Feature::XERROR,
-             cb::mcbp::Feature::SNAPPY,
-             cb::mcbp::Feature::JSON}};
-    connection.setFeatures(features);
-    connection.selectBucket(bucket);
+                const std::string& bucket,
+                const std::vector<cb::mcbp::Feature>& features) {
+    auto connection =
+            connect(host, in_port, family, user, password, bucket, features);
 
     // get the CCCP
-    auto rsp = connection.execute(
+    auto rsp = connection->execute(
             BinprotGenericCommand{cb::mcbp::ClientOpcode::GetClusterConfig});
     if (!rsp.isSuccess()) {
         std::cout << "Failed to fetch cluster map: "
@@ -327,38 +466,48 @@ void setupVBMap(const std::string& host,
     auto json = nlohmann::json::parse(rsp.getDataString());
     auto vbservermap = json["vBucketServerMap"];
 
-    auto nodes = vbservermap["serverList"];
-    for (const auto& n : nodes) {
+    auto serverList = vbservermap["serverList"];
+    for (const auto& n : serverList) {
         auto h = n.get<std::string>();
         auto idx = h.find(':');
-        auto p = strtoul(h.substr(idx + 1).c_str());
+        auto p = in_port_t(strtoul(h.substr(idx + 1).c_str()));
         h.resize(idx);
         if (h.find("$HOST") != std::string::npos) {
             h = host;
         }
-        auto c = std::make_unique<MemcachedConnection>(h, p, family, false);
-        c->connect();
-
-        if (!user.empty()) {
-            c->authenticate(user, password, c->getSaslMechanisms());
-        }
-
-        c->setFeatures(features);
-        c->selectBucket(bucket);
-
-        vbmap.emplace_back(
-                std::make_pair<std::unique_ptr<MemcachedConnection>,
-                               std::vector<uint16_t>>(std::move(c), {}));
+        nodes.push_back({h, p, {}});
     }
 
     auto map = vbservermap["vBucketMap"];
     max_vbuckets = 0;
     for (const auto& e : map) {
         int nodeidx = e[0].get<int>();
-        vbmap[nodeidx].second.emplace_back(max_vbuckets++);
+        nodes[nodeidx].vbuckets.emplace_back(max_vbuckets++);
     }
 }
 
+/// Print the items/s and bytes/s of a (vBucket's or the total) stream
+static void printThroughput(std::ostream& out,
+                            size_t items,
+                            size_t bytes,
+                            size_t backfillItems,
+                            size_t backfillBytes,
+                            std::chrono::milliseconds duration,
+                            std::chrono::milliseconds backfillDuration) {
+    const auto memoryDuration = duration - backfillDuration;
+    out << items << " items (" << calculateRate(items, duration)
+        << " items/s), " << bytes << " bytes ("
+        << calculateThroughput(bytes, duration) << "); backfill: "
+        << backfillItems << " items in " << backfillDuration.count()
+        << " ms (" << calculateRate(backfillItems, backfillDuration)
+        << " items/s, " << calculateThroughput(backfillBytes, backfillDuration)
+        << "); in-memory: " << items - backfillItems << " items in "
+        << memoryDuration.count() << " ms ("
+        << calculateRate(items - backfillItems, memoryDuration)
+        << " items/s, "
+        << calculateThroughput(bytes - backfillBytes, memoryDuration) << ")";
+}
+
 int main(int argc, char** argv) {
     // Make sure that we dump callstacks on the console
     install_backtrace_terminate_handler();
@@ -372,12 +521,28 @@ int main(int argc, char** argv) {
     sa_family_t family = AF_UNSPEC;
     bool csv = false;
     bool memcached = false;
+    bool printVBucketStats = false;
     std::vector<std::pair<std::string, std::string>> controls;
     std::string name = "dcpdrain";
+    size_t numConnections = 1;
+    size_t numThreads = 1;
+    bool collections = false;
+    nlohmann::json collectionsFilter;
+    bool streamId = false;
+    bool forceCompression = false;
+    bool snappy = true;
 
     /* Initialize the socket subsystem */
     cb_initialize_sockets();
 
+    // Long options without a short option
+    enum class Option : int {
+        Collections = 256,
+        StreamId,
+        ForceCompression,
+        DisableSnappy
+    };
+
     std::vector<option> long_options = {
             {"ipv4", no_argument, nullptr, '4'},
             {"ipv6", no_argument, nullptr, '6'},
@@ -392,12 +557,28 @@ int main(int argc, char** argv) {
             {"csv", no_argument, nullptr, 'C'},
             {"memcached", no_argument, nullptr, 'M'},
             {"name", required_argument, nullptr, 'N'},
+            {"num-connections", required_argument, nullptr, 'n'},
+            {"num-threads", required_argument, nullptr, 'T'},
             {"verbose", no_argument, nullptr, 'v'},
+            {"vbucket-stats", no_argument, nullptr, 'V'},
+            {"collections",
+             required_argument,
+             nullptr,
+             int(Option::Collections)},
+            {"stream-id", no_argument, nullptr, int(Option::StreamId)},
+            {"force-compression",
+             no_argument,
+             nullptr,
+             int(Option::ForceCompression)},
+            {"disable-snappy",
+             no_argument,
+             nullptr,
+             int(Option::DisableSnappy)},
             {nullptr, 0, nullptr, 0}};
 
     while ((cmd = getopt_long(argc,
                               argv,
-                              "46h:p:u:b:P:B:c:vCMN:",
+                              "46h:p:u:b:P:B:c:vVCMN:n:T:",
                               long_options.data(),
                               nullptr)) != EOF) {
         switch (cmd) {
@@ -431,6 +612,9 @@ int main(int argc, char** argv) {
         case 'v':
             verbose = true;
             break;
+        case 'V':
+            printVBucketStats = true;
+            break;
         case 'C':
             csv = true;
             break;
@@ -440,12 +624,48 @@ int main(int argc, char** argv) {
         case 'N':
             name = optarg;
             break;
+        case 'n':
+            numConnections = strtoul(optarg);
+            break;
+        case 'T':
+            numThreads = strtoul(optarg);
+            break;
+        case int(Option::Collections):
+            collections = true;
+            try {
+                if (*optarg) {
+                    collectionsFilter = nlohmann::json::parse(optarg);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid collections filter: " << e.what()
+                          << std::endl;
+                return EXIT_FAILURE;
+            }
+            break;
+        case int(Option::StreamId):
+            // stream-IDs are only supported by collection aware producers
+            streamId = true;
+            collections = true;
+            break;
+        case int(Option::ForceCompression):
+            forceCompression = true;
+            break;
+        case int(Option::DisableSnappy):
+            snappy = false;
+            break;
         default:
             usage();
             return EXIT_FAILURE;
         }
     }
 
+    if (numConnections == 0 || numThreads == 0) {
+        std::cerr << "The number of connections and threads must be at "
+                     "least 1"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
     if (memcached) {
         // memcached don't implement flow control
         buffersize = 0;
@@ -465,8 +685,24 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
 
-    cb::libevent::unique_event_base_ptr base(event_base_new());
-    std::vector<cb::libevent::unique_bufferevent_ptr> events;
+    std::vector<cb::mcbp::Feature> features = {
+            {cb::mcbp::Feature::MUTATION_SEQNO,
+             cb::mcbp::Feature::XATTR,
+             cb::mcbp::Feature::XERROR,
+             cb::mcbp::Feature::JSON}};
+    if (snappy) {
+        features.push_back(cb::mcbp::Feature::SNAPPY);
+    }
+    if (collections) {
+        features.push_back(cb::mcbp::Feature::Collections);
+    }
+
+    // One event loop per thread, the connections are spread over them
+    std::vector<cb::libevent::unique_event_base_ptr> bases;
+    for (size_t ii = 0; ii < numThreads; ++ii) {
+        bases.emplace_back(event_base_new());
+    }
+    std::vector<std::unique_ptr<DcpConnection>> connections;
     try {
         in_port_t in_port;
         sa_family_t fam;
@@ -477,67 +713,16 @@ int main(int argc, char** argv) {
         }
 
         if (memcached) {
-            std::vector<cb::mcbp::Feature> features = {
-                    {cb::mcbp::Feature::MUTATION_SEQNO,
-                     cb::mcbp::Feature::XATTR,
-                     cb::mcbp::Feature::XERROR,
-                     cb::mcbp::Feature::SNAPPY,
-                     cb::mcbp::Feature::JSON}};
-
-            auto c = std::make_unique<MemcachedConnection>(
-                    host, in_port, family, false);
-            c->connect();
-
-            if (!user.empty()) {
-                c->authenticate(user, password, c->getSaslMechanisms());
-            }
-
-            c->setFeatures(features);
-            c->selectBucket(bucket);
-
-            vbmap.emplace_back(
-                    std::make_pair<std::unique_ptr<MemcachedConnection>,
-                                   std::vector<uint16_t>>(std::move(c), {}));
-            vbmap[0].second.emplace_back(max_vbuckets++);
+            nodes.push_back({host, in_port, {0}});
+            max_vbuckets = 1;
         } else {
-            setupVBMap(host, in_port, family, user, password, bucket);
+            setupVBMap(host, in_port, family, user, password, bucket, features);
         }
+        vbstats.resize(max_vbuckets);
 
-        // set up all of the connections
-        for (const auto& [c, vbuckets] : vbmap) {
-            auto rsp = c->execute(BinprotDcpOpenCommand{
-                    name, cb::mcbp::request::DcpOpenPayload::Producer});
-            if (!rsp.isSuccess()) {
-                std::cerr << "Failed to open DCP stream: "
-                          << to_string(rsp.getStatus()) << std::endl
-                          << "\t" << rsp.getDataString() << std::endl;
-                return EXIT_FAILURE;
-            }
-
-            if (buffersize == 0) {
-                if (verbose) {
-                    std::cout << "Not using DCP flow control" << std::endl;
-                }
-            } else {
-                if (verbose) {
-                    std::cout << "Using DCP flow control with buffer size: "
-                              << buffersize << std::endl;
-                }
-                if (!c->execute(BinprotGenericCommand{
-                                        cb::mcbp::ClientOpcode::DcpControl,
-                                        "connection_buffer_size",
-                                        std::to_string(buffersize)})
-                             .isSuccess()) {
-                    std::cerr << "Failed to set connection buffer size to "
-                              << buffersize << std::endl;
-                    std::exit(EXIT_FAILURE);
-                }
-            }
-
-            if (!memcached) {
-                if (controls.empty()) {
-                    controls = {
-                            {{"enable_noop", "true"},
+        if (!memcached) {
+            if (controls.empty()) {
+                controls = {{{"enable_noop", "true"},
                              {"set_noop_interval", "1"},
                              {"set_priority", "high"},
                              {"enable_ext_metadata", "true"},
@@ -545,36 +730,116 @@ int main(int argc, char** argv) {
                              {"supports_hifi_MFU", "true"},
                              {"send_stream_end_on_client_close_stream", "true"},
                              {"enable_expiry_opcode", "true"}}};
-                }
-                setControlMessages(*c, controls);
             }
+            if (streamId) {
+                controls.emplace_back("enable_stream_id", "true");
+            }
+            if (forceCompression) {
+                controls.emplace_back("force_value_compression", "true");
+            }
+        }
+
+        // set up all of the connections, spreading the vBuckets of each
+        // node over numConnections connections
+        for (const auto& node : nodes) {
+            for (size_t ii = 0; ii < numConnections; ++ii) {
+                std::vector<uint16_t> vbuckets;
+                for (size_t jj = ii; jj < node.vbuckets.size();
+                     jj += numConnections) {
+                    vbuckets.push_back(node.vbuckets[jj]);
+                }
+                if (vbuckets.empty()) {
+                    continue;
+                }
+
+                auto c = connect(node.host,
+                                 node.port,
+                                 family,
+                                 user,
+                                 password,
+                                 bucket,
+                                 features);
+
+                // The connections to a node need unique names (opening a
+                // connection with the name of an existing one replaces it)
+                const auto connectionName =
+                        numConnections == 1
+                                ? name
+                                : name + ":" + std::to_string(ii);
+                auto rsp = c->execute(BinprotDcpOpenCommand{
+                        connectionName,
+                        cb::mcbp::request::DcpOpenPayload::Producer});
+                if (!rsp.isSuccess()) {
+                    std::cerr << "Failed to open DCP stream: "
+                              << to_string(rsp.getStatus()) << std::endl
+                              << "\t" << rsp.getDataString() << std::endl;
+                    return EXIT_FAILURE;
+                }
+
+                if (buffersize == 0) {
+                    if (verbose) {
+                        std::cout << "Not using DCP flow control" << std::endl;
+                    }
+                } else {
+                    if (verbose) {
+                        std::cout << "Using DCP flow control with buffer size: "
+                                  << buffersize << std::endl;
+                    }
+                    if (!c->execute(BinprotGenericCommand{
+                                            cb::mcbp::ClientOpcode::DcpControl,
+                                            "connection_buffer_size",
+                                            std::to_string(buffersize)})
+                                 .isSuccess()) {
+                        std::cerr << "Failed to set connection buffer size to "
+                                  << buffersize << std::endl;
+                        std::exit(EXIT_FAILURE);
+                    }
+                }
+
+                if (!memcached) {
+                    setControlMessages(*c, controls);
+                }
 
-            auto socket = c->releaseSocket();
-            evutil_make_socket_nonblocking(socket);
-
-            auto* bev = bufferevent_socket_new(
-                    base.get(),
-                    socket,
-                    BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS);
-
-            events.emplace_back(bev);
-            bufferevent_setcb(bev, read_callback, {}, event_callback, nullptr);
-            bufferevent_enable(bev, EV_READ);
-
-            for (auto vb : vbuckets) {
-                BinprotDcpStreamRequestCommand streamRequestCommand;
-                streamRequestCommand.setDcpFlags(DCP_ADD_STREAM_FLAG_LATEST);
-                streamRequestCommand.setDcpReserved(0);
-                streamRequestCommand.setDcpStartSeqno(0);
-                streamRequestCommand.setDcpEndSeqno(0xffffffff);
-                streamRequestCommand.setDcpVbucketUuid(0);
-                streamRequestCommand.setDcpSnapStartSeqno(0);
-                streamRequestCommand.setDcpSnapEndSeqno(0xfffffff);
-                streamRequestCommand.setVBucket(Vbid(vb));
-
-                std::vector<uint8_t> vec;
-                streamRequestCommand.encode(vec);
-                bufferevent_write(bev, vec.data(), vec.size());
+                auto socket = c->releaseSocket();
+                evutil_make_socket_nonblocking(socket);
+
+                auto connection = std::make_unique<DcpConnection>(vbuckets);
+                auto* bev = bufferevent_socket_new(
+                        bases[connections.size() % numThreads].get(),
+                        socket,
+                        BEV_OPT_CLOSE_ON_FREE | BEV_OPT_DEFER_CALLBACKS);
+                connection->bev.reset(bev);
+                bufferevent_setcb(bev,
+                                  DcpConnection::read_callback,
+                                  {},
+                                  DcpConnection::event_callback,
+                                  connection.get());
+                bufferevent_enable(bev, EV_READ);
+
+                for (auto vb : vbuckets) {
+                    BinprotDcpStreamRequestCommand streamRequestCommand;
+                    streamRequestCommand.setDcpFlags(
+                            DCP_ADD_STREAM_FLAG_LATEST);
+                    streamRequestCommand.setDcpReserved(0);
+                    streamRequestCommand.setDcpStartSeqno(0);
+                    streamRequestCommand.setDcpEndSeqno(0xffffffff);
+                    streamRequestCommand.setDcpVbucketUuid(0);
+                    streamRequestCommand.setDcpSnapStartSeqno(0);
+                    streamRequestCommand.setDcpSnapEndSeqno(0xfffffff);
+                    streamRequestCommand.setVBucket(Vbid(vb));
+                    if (!collectionsFilter.empty()) {
+                        streamRequestCommand.setValue(collectionsFilter);
+                    }
+                    if (streamId) {
+                        streamRequestCommand.addFrameInfo(
+                                DcpStreamIdFrameInfo(1));
+                    }
+
+                    std::vector<uint8_t> vec;
+                    streamRequestCommand.encode(vec);
+                    bufferevent_write(bev, vec.data(), vec.size());
+                }
+                connections.emplace_back(std::move(connection));
             }
         }
     } catch (const ConnectionError& ex) {
@@ -585,13 +850,33 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
 
+    if (verbose) {
+        std::cout << "Streaming " << max_vbuckets << " vBuckets over "
+                  << connections.size() << " connections from "
+                  << bases.size() << " threads" << std::endl;
+    }
+
     const auto start = std::chrono::steady_clock::now();
-    event_base_loop(base.get(), 0);
+    std::vector<std::thread> threads;
+    for (auto& base : bases) {
+        threads.emplace_back(
+                [&base]() { event_base_loop(base.get(), 0); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
     const auto stop = std::chrono::steady_clock::now();
 
     const auto duration =
             std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
 
+    size_t mutations = 0;
+    size_t total_bytes = 0;
+    for (const auto& c : connections) {
+        mutations += c->mutations;
+        total_bytes += c->total_bytes;
+    }
+
     if (csv) {
         std::cout << duration.count() << ';' << total_bytes << ';' << mutations
                   << std::endl;
@@ -599,8 +884,56 @@ int main(int argc, char** argv) {
         std::cout << "Took " << duration.count() << " ms - " << mutations
                   << " mutations with a total of " << total_bytes
                   << " bytes received ("
-                  << calculateThroughput(total_bytes, duration.count() / 1000)
-                  << ")" << std::endl;
+                  << calculateThroughput(total_bytes, duration) << ")"
+                  << std::endl;
+    }
+
+    if (printVBucketStats || !csv) {
+        // The durations of the phases of each vBucket's stream (all the
+        // streams are requested before the clock starts)
+        auto elapsed = [start, stop](std::chrono::steady_clock::time_point t) {
+            if (t == std::chrono::steady_clock::time_point{}) {
+                t = stop;
+            }
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::max(t, start) - start);
+        };
+
+        VBucketStats total;
+        std::chrono::milliseconds backfillDuration{0};
+        for (size_t vbid = 0; vbid < vbstats.size(); ++vbid) {
+            const auto& vb = vbstats[vbid];
+            const auto vbBackfill =
+                    vb.backfillBytes ? elapsed(vb.backfillEnd)
+                                     : std::chrono::milliseconds{0};
+            if (printVBucketStats) {
+                std::cout << "vb:" << vbid << " ";
+                printThroughput(std::cout,
+                                vb.items,
+                                vb.bytes,
+                                vb.backfillItems,
+                                vb.backfillBytes,
+                                std::max(elapsed(vb.end), vbBackfill),
+                                vbBackfill);
+                std::cout << std::endl;
+            }
+            total.items += vb.items;
+            total.bytes += vb.bytes;
+            total.backfillItems += vb.backfillItems;
+            total.backfillBytes += vb.backfillBytes;
+            backfillDuration = std::max(backfillDuration, vbBackfill);
+        }
+        if (!csv) {
+            std::cout << "Total: ";
+            printThroughput(std::cout,
+                            total.items,
+                            total.bytes,
+                            total.backfillItems,
+                            total.backfillBytes,
+                            duration,
+                            std::min(backfillDuration, duration));
+            std::cout << std::endl;
+        }
     }
     return EXIT_SUCCESS;
 }
@@ -20,6 +20,12 @@
 // store a single document. Once the document is received over DCP it is sent
 // the same document is stored once again on the server. We'll loop doing this
 // until we performed the requested number of iterations.
+//
+// With --server-latency the server side view of the latency (the time from
+// the mutation being queued in the checkpoint until the DCP producer handed
+// it to the connection, see the item_send_latency DCP stat) is read from the
+// producer once the test completes, to tell apart the time spent in the
+// server from the time spent on the network and in the client.
 
 #include <event2/buffer.h>
 #include <event2/util.h>
@@ -33,6 +39,7 @@
 #include <utilities/terminate_handler.h>
 #include <cstdlib>
 #include <iostream>
+#include <map>
 
 std::vector<uint8_t> mutation;
 size_t count = 0;
@@ -133,9 +140,10 @@ std::unique_ptr<MemcachedConnection> createConnection(
     return ret;
 }
 
-void setupDcpConnection(MemcachedConnection& connection) {
+void setupDcpConnection(MemcachedConnection& connection,
+                        const std::string& name) {
     auto rsp = connection.execute(BinprotDcpOpenCommand{
-            "dcpdrain", cb::mcbp::request::DcpOpenPayload::Producer});
+            name, cb::mcbp::request::DcpOpenPayload::Producer});
     if (!rsp.isSuccess()) {
         std::cerr << "Failed to open DCP stream: " << to_string(rsp.getStatus())
                   << std::endl
@@ -178,6 +186,59 @@ static void setupTest(size_t size) {
     mutation[1] = static_cast<uint8_t>(cb::mcbp::ClientOpcode::Setq);
 }
 
+/**
+ * Print the item_send_latency histogram reported by the DCP producer with
+ * the given name (mean and percentiles, in microseconds).
+ */
+static void printServerLatency(MemcachedConnection& connection,
+                               const std::string& name) {
+    // ep-engine prefixes the name of all DCP producers
+    const auto prefix = "eq_dcpq:" + name + ":item_send_latency_";
+    uint64_t mean = 0;
+    // Bucket upper bound => count
+    std::map<uint64_t, uint64_t> buckets;
+    uint64_t total = 0;
+    for (const auto& [key, value] : connection.statsMap("dcp")) {
+        if (key.rfind(prefix, 0) != 0) {
+            continue;
+        }
+        const auto suffix = key.substr(prefix.size());
+        if (suffix == "mean") {
+            mean = std::stoull(value);
+            continue;
+        }
+        // Buckets are reported as <prefix><low>,<high>
+        const auto comma = suffix.find(',');
+        if (comma == std::string::npos) {
+            continue;
+        }
+        const auto count = std::stoull(value);
+        buckets[std::stoull(suffix.substr(comma + 1))] += count;
+        total += count;
+    }
+
+    if (total == 0) {
+        std::cerr << "No item_send_latency stats found for DCP producer "
+                  << name << std::endl;
+        return;
+    }
+
+    auto percentile = [&buckets, total](double pct) -> uint64_t {
+        uint64_t seen = 0;
+        for (const auto& [upper, count] : buckets) {
+            seen += count;
+            if (seen >= total * pct / 100) {
+                return upper;
+            }
+        }
+        return buckets.rbegin()->first;
+    };
+
+    std::cout << "server;mean:" << mean << ";p50:" << percentile(50)
+              << ";p99:" << percentile(99) << ";p99.9:" << percentile(99.9)
+              << std::endl;
+}
+
 static unsigned long strtoul(const char* arg) {
     try {
         char* end = nullptr;
@@ -218,6 +279,7 @@ int main(int argc, char** argv) {
     sa_family_t family = AF_UNSPEC;
     std::string name = "dcplatency";
     std::size_t size = 8192;
+    bool serverLatency = false;
 
     std::vector<option> long_options = {
             {"ipv4", no_argument, nullptr, '4'},
@@ -232,6 +294,7 @@ int main(int argc, char** argv) {
             {"verbose", no_argument, nullptr, 'v'},
             {"size", required_argument, nullptr, 's'},
             {"iterations", required_argument, nullptr, 'i'},
+            {"server-latency", no_argument, nullptr, 'S'},
             {nullptr, 0, nullptr, 0}};
 
     while ((cmd = getopt_long(argc, argv, "", long_options.data(), nullptr)) !=
@@ -270,6 +333,9 @@ int main(int argc, char** argv) {
         case 'i':
             iterations = strtoul(optarg);
             break;
+        case 'S':
+            serverLatency = true;
+            break;
         default:
             std::cerr << R"(Usage: dcplatency [options]
 
@@ -286,6 +352,9 @@ Options:
   --name                   The dcp name to use
   --size size              The document size (in bytes)
   --verbose                Add more output
+  --server-latency         Also print the latency measured by the server
+                           (from the mutation being queued until it is
+                           handed to the DCP connection)
   --ipv4                   Connect over IPv4
   --ipv6                   Connect over IPv6
   --help                   This help text
@@ -311,8 +380,8 @@ Options:
 
     cb::libevent::unique_event_base_ptr base(event_base_new());
     std::vector<cb::libevent::unique_bufferevent_ptr> events;
+    in_port_t in_port;
     try {
-        in_port_t in_port;
         sa_family_t fam;
         std::tie(host, in_port, fam) = cb::inet::parse_hostname(host, port);
 
@@ -327,7 +396,7 @@ Options:
 
         auto dcpConnection =
                 createConnection(host, in_port, family, user, password, bucket);
-        setupDcpConnection(*dcpConnection);
+        setupDcpConnection(*dcpConnection, name);
 
         // Setup the Client
         auto socket = loadClient->releaseSocket();
@@ -377,5 +446,19 @@ Options:
             std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
     std::cout << size << ";" << duration.count() / iterations << std::endl;
 
+    if (serverLatency) {
+        // Read the stats while the DCP connection (and hence the producer)
+        // is still open.
+        try {
+            auto statsClient = createConnection(
+                    host, in_port, family, user, password, bucket);
+            printServerLatency(*statsClient, name);
+        } catch (const std::exception& ex) {
+            std::cerr << "Failed to read server latency: " << ex.what()
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
     return EXIT_SUCCESS;
 }
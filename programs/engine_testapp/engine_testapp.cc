@@ -47,6 +47,8 @@ static void usage() {
     printf("-a <attempts>                Maximum number of attempts for a test.\n");
     printf("-e <engine_config>           Engine configuration string passed to\n");
     printf("                             the engine.\n");
+    printf("-f <text|xml|json>           Output format of the performance\n");
+    printf("                             results (default text).\n");
     printf("-q                           Only print errors.");
     printf("-.                           Print a . for each executed test.");
     printf("\n");
@@ -484,7 +486,7 @@ int main(int argc, char **argv) {
                     "C:" /* Test case id */
                     "s" /* spinlock the program */
                     "X" /* Use stderr logger */
-                    "f:" /* output format. Valid values are: 'text' and 'xml' */
+                    "f:" /* output format. Valid values are: 'text', 'xml' and 'json' */
                     )) != -1) {
         switch (c) {
         case 'a':
@@ -511,9 +513,11 @@ int main(int argc, char **argv) {
                 harness.output_format = OutputFormat::Text;
             } else if (std::string(optarg) == "xml") {
                 harness.output_format = OutputFormat::XML;
+            } else if (std::string(optarg) == "json") {
+                harness.output_format = OutputFormat::JSON;
             } else {
                 fprintf(stderr, "Invalid option for output format '%s'. Valid "
-                    "options are 'text' and 'xml'.\n", optarg);
+                    "options are 'text', 'xml' and 'json'.\n", optarg);
                 return 1;
             }
             break;
@@ -22,8 +22,10 @@
 #include <platform/compression/buffer.h>
 #include <atomic>
 #include <bitset>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
+#include <optional>
 #include <string>
 
 struct MockCookie : cb::tracing::Traceable {
@@ -59,6 +61,7 @@ struct MockCookie : cb::tracing::Traceable {
     uint64_t num_processed_notifications{};
     std::string authenticatedUser{"nobody"};
     in_port_t parent_port{666};
+    std::optional<std::chrono::steady_clock::time_point> deadline;
 
     void validate() const;
 
@@ -164,6 +164,10 @@ struct MockEngine : public EngineIface, public DcpIface {
         return the_engine->getMinCompressionRatio();
     }
 
+    bool isUnderMemoryPressure() override {
+        return the_engine->isUnderMemoryPressure();
+    }
+
     cb::engine::FeatureSet getFeatures() override {
         return the_engine->getFeatures();
     }
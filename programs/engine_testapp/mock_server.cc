@@ -375,6 +375,12 @@ struct MockServerCookieApi : public ServerCookieIface {
         return c->parent_port;
     }
 
+    std::optional<std::chrono::steady_clock::time_point> get_deadline(
+            gsl::not_null<const void*> cookie) override {
+        auto* c = cookie_to_mock_cookie(cookie.get());
+        return c->deadline;
+    }
+
     void set_error_context(gsl::not_null<void*> cookie,
                            std::string_view message) override {
     }
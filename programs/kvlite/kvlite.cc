@@ -25,10 +25,17 @@
 #include <platform/dirutils.h>
 #include <platform/socket.h>
 #include <programs/getpass.h>
+#include <protocol/connection/client_connection.h>
+#include <protocol/connection/client_mcbp_commands.h>
 #include <utilities/string_utilities.h>
 #include <utilities/terminate_handler.h>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 static std::unique_ptr<cb::test::Cluster> cluster;
@@ -64,6 +71,29 @@ bool check_credentials(struct evhttp_request* req) {
     }
 }
 
+/// Create the cluster and the user (if any) the REST interface accepts
+static void createCluster(size_t nodes,
+                          const std::string& username,
+                          const std::string& password) {
+    cluster = cb::test::Cluster::create(nodes);
+    if (username.empty()) {
+        return;
+    }
+
+    credentials = cb::base64::encode(username + ":" + password, false);
+    cluster->getAuthProviderService().upsertUser({username, password, R"({
+    "buckets": {
+      "*": [
+        "all"
+      ]
+    },
+    "privileges": [
+      "all"
+    ],
+    "domain": "external"
+})"_json});
+}
+
 static void add_default_headers(struct evhttp_request* req,
                                 const char* contentType,
                                 size_t contentLength) {
@@ -158,21 +188,7 @@ static void settings_web_callback(struct evhttp_request* req, void*) {
                               nullptr);
             return;
         }
-        credentials = cb::base64::encode(
-                username->second + ":" + password->second, false);
-        cluster = cb::test::Cluster::create(4);
-        cluster->getAuthProviderService().upsertUser(
-                {username->second, password->second, R"({
-    "buckets": {
-      "*": [
-        "all"
-      ]
-    },
-    "privileges": [
-      "all"
-    ],
-    "domain": "external"
-})"_json});
+        createCluster(4, username->second, password->second);
     } else if (password != params.cend()) {
         evhttp_send_reply(req,
                           HTTP_BADREQUEST,
@@ -180,7 +196,7 @@ static void settings_web_callback(struct evhttp_request* req, void*) {
                           nullptr);
         return;
     } else {
-        cluster = cb::test::Cluster::create(4);
+        createCluster(4, {}, {});
     }
 
     evhttp_send_reply(req, HTTP_OK, "OK", nullptr);
@@ -301,6 +317,14 @@ static void pools_default_b_callback(struct evhttp_request* req, void*) {
     evhttp_send_reply(req, HTTP_OK, "OK", buf.get());
 }
 
+static void add_bucket_callback(evhttp* http, const cb::test::Bucket& bucket) {
+    // @todo This might not be a smart thing to do ;)
+    //       I need to kill it when I'm done with it by
+    //       using evhttp_del_cb
+    std::string terse = "/pools/default/b/" + bucket.getName();
+    evhttp_set_cb(http, terse.c_str(), pools_default_b_callback, nullptr);
+}
+
 static void pools_default_buckets_callback(struct evhttp_request* req,
                                            void* http) {
     if (!check_credentials(req)) {
@@ -369,14 +393,7 @@ static void pools_default_buckets_callback(struct evhttp_request* req,
     config["max_vbuckets"] = 64;
 
     auto bucket = cluster->createBucket(params["name"], config, {}, false);
-    // @todo This might not be a smart thing to do ;)
-    //       I need to kill it when I'm done with it by
-    //       using evhttp_del_cb
-    std::string terse = "/pools/default/b/" + bucket->getName();
-    evhttp_set_cb(static_cast<evhttp*>(http),
-                  terse.c_str(),
-                  pools_default_b_callback,
-                  nullptr);
+    add_bucket_callback(static_cast<evhttp*>(http), *bucket);
     evhttp_send_reply(req, HTTP_OK, "OK", nullptr);
 }
 
@@ -432,6 +449,190 @@ static void pools_callback(struct evhttp_request* req, void*) {
     }
 }
 
+/**
+ * A predefined cluster (and bucket) for kvlite to bring up at startup
+ * (with --profile) rather than waiting to be configured over REST.
+ */
+struct Profile {
+    std::string name;
+    std::string description;
+    size_t nodes;
+    /// The attributes of the bucket (as passed to Cluster::createBucket)
+    nlohmann::json bucket;
+};
+
+static const std::vector<Profile>& getProfiles() {
+    static const std::vector<Profile> profiles = {
+            {"default",
+             "4 nodes, couchstore, value eviction, 1 replica",
+             4,
+             {{"replicas", 1}}},
+            {"single",
+             "1 node, couchstore, value eviction, no replicas",
+             1,
+             {{"replicas", 0}}},
+            {"full-eviction",
+             "4 nodes, couchstore, full eviction, 1 replica",
+             4,
+             {{"replicas", 1}, {"item_eviction_policy", "full_eviction"}}},
+            {"magma",
+             "4 nodes, magma, value eviction, 1 replica",
+             4,
+             {{"replicas", 1}, {"backend", "magma"}}},
+            {"ephemeral",
+             "4 nodes, ephemeral, 1 replica",
+             4,
+             {{"replicas", 1},
+              {"bucket_type", "ephemeral"},
+              {"item_eviction_policy", nullptr}}},
+            {"durable",
+             "4 nodes, couchstore, 2 replicas, minimum durability majority",
+             4,
+             {{"replicas", 2}, {"durability_min_level", "majority"}}}};
+    return profiles;
+}
+
+static const Profile* findProfile(const std::string& name) {
+    for (const auto& profile : getProfiles()) {
+        if (profile.name == name) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+/// The CRC32 (as used by the clients to map a key to its vbucket)
+static uint32_t crc32(std::string_view key) {
+    uint32_t crc = 0xffffffff;
+    for (const auto c : key) {
+        crc ^= uint8_t(c);
+        for (int ii = 0; ii < 8; ++ii) {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/// Get the vbucket the clients would store the key in
+static Vbid getVbucket(std::string_view key, size_t vbuckets) {
+    return Vbid(uint16_t(((crc32(key) >> 16) & 0x7fff) % vbuckets));
+}
+
+/**
+ * Populate the bucket with documents named key_0 to key_<count - 1>, each
+ * stored in the vbucket the clients would hash the key to (so the
+ * documents may be read back by any client).
+ *
+ * The key space is split between the threads, and every thread has a
+ * connection to each of the nodes. A thread sends up to pipeline sets
+ * (spread over its connections) before reading back the responses, and
+ * resends the sets which failed with a temporary failure (the bucket is
+ * out of memory until the items are persisted or ejected).
+ */
+static void bulkLoad(const cb::test::Bucket& bucket,
+                     size_t count,
+                     size_t valueSize,
+                     size_t numThreads,
+                     size_t pipeline) {
+    const auto& map = bucket.getVbucketMap();
+    const std::string value(valueSize, 'x');
+    std::atomic<size_t> tmpfails{0};
+    std::atomic_bool failed{false};
+
+    auto loader = [&](size_t begin, size_t end) {
+        std::vector<std::unique_ptr<MemcachedConnection>> connections(
+                cluster->size());
+        for (size_t node = 0; node < connections.size(); ++node) {
+            auto& conn = connections[node];
+            conn = cluster->getConnection(node);
+            conn->authenticate("@admin", "password", "PLAIN");
+            conn->selectBucket(bucket.getName());
+        }
+
+        // The keys sent but not yet acknowledged (in the order they were
+        // sent on each connection), and the keys to resend
+        std::vector<std::vector<size_t>> inflight(connections.size());
+        std::vector<size_t> retry;
+        size_t numInflight = 0;
+        auto next = begin;
+        while (!failed && (next < end || !retry.empty())) {
+            while (numInflight < pipeline && (next < end || !retry.empty())) {
+                size_t key;
+                if (retry.empty()) {
+                    key = next++;
+                } else {
+                    key = retry.back();
+                    retry.pop_back();
+                }
+                const auto id = "key_" + std::to_string(key);
+                const auto vbid = getVbucket(id, map.size());
+                const auto node = map[vbid.get()][0];
+                BinprotMutationCommand cmd;
+                cmd.setMutationType(MutationType::Set);
+                cmd.setKey(id);
+                cmd.setVBucket(vbid);
+                cmd.addValueBuffer(
+                        {reinterpret_cast<const uint8_t*>(value.data()),
+                         value.size()});
+                connections[node]->sendCommand(cmd);
+                inflight[node].push_back(key);
+                ++numInflight;
+            }
+
+            for (size_t node = 0; node < connections.size(); ++node) {
+                for (const auto key : inflight[node]) {
+                    BinprotResponse rsp;
+                    connections[node]->recvResponse(rsp);
+                    if (rsp.getStatus() == cb::mcbp::Status::Etmpfail) {
+                        retry.push_back(key);
+                        ++tmpfails;
+                    } else if (!rsp.isSuccess()) {
+                        throw ConnectionError("bulkLoad: Failed to store key_" +
+                                                      std::to_string(key),
+                                              rsp);
+                    }
+                }
+                inflight[node].clear();
+            }
+            numInflight = 0;
+            if (!retry.empty()) {
+                // Give the bucket a chance to free up some memory
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < numThreads; ++ii) {
+        const auto begin = count * ii / numThreads;
+        const auto end = count * (ii + 1) / numThreads;
+        threads.emplace_back([&loader, &failed, begin, end]() {
+            try {
+                loader(begin, end);
+            } catch (const std::exception& e) {
+                std::cerr << "Bulk load failed: " << e.what() << std::endl;
+                failed = true;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (failed) {
+        throw std::runtime_error("bulkLoad: Failed to load " +
+                                 bucket.getName());
+    }
+
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    std::cout << "Loaded " << count << " documents of " << valueSize
+              << " bytes into " << bucket.getName() << " in " << ms << " ms ("
+              << count * 1000 / std::max(int64_t(1), int64_t(ms))
+              << " ops/s, " << tmpfails << " temporary failures)" << std::endl;
+}
+
 int main(int argc, char** argv) {
     install_backtrace_terminate_handler();
     bool failed;
@@ -452,27 +653,127 @@ int main(int argc, char** argv) {
 
     int cmd;
     std::string port{"6666"};
+    const Profile* profile = nullptr;
+    std::string username;
+    std::string password;
+    std::string bucketName{"default"};
+    size_t vbuckets = 64;
+    size_t memory = 256;
+    size_t load = 0;
+    size_t valueSize = 1024;
+    size_t loadThreads = 4;
+    size_t pipeline = 512;
 
     std::vector<option> long_options = {
             {"port", required_argument, nullptr, 'p'},
+            {"profile", required_argument, nullptr, 'P'},
+            {"list-profiles", no_argument, nullptr, 'L'},
+            {"username", required_argument, nullptr, 'u'},
+            {"password", required_argument, nullptr, 'w'},
+            {"bucket", required_argument, nullptr, 'b'},
+            {"vbuckets", required_argument, nullptr, 'V'},
+            {"memory", required_argument, nullptr, 'm'},
+            {"load", required_argument, nullptr, 'l'},
+            {"value-size", required_argument, nullptr, 's'},
+            {"load-threads", required_argument, nullptr, 'T'},
+            {"pipeline", required_argument, nullptr, 'd'},
             {nullptr, 0, nullptr, 0}};
 
-    while ((cmd = getopt_long(argc, argv, "", long_options.data(), nullptr)) !=
-           EOF) {
-        switch (cmd) {
-        case 'p':
-            port.assign(optarg);
-            break;
-        default:
-            std::cerr << R"(
+    try {
+        while ((cmd = getopt_long(
+                        argc, argv, "", long_options.data(), nullptr)) != EOF) {
+            switch (cmd) {
+            case 'p':
+                port.assign(optarg);
+                break;
+            case 'P':
+                profile = findProfile(optarg);
+                if (profile == nullptr) {
+                    std::cerr << "Unknown profile: " << optarg << std::endl;
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'L':
+                for (const auto& p : getProfiles()) {
+                    std::cout << std::left << std::setw(16) << p.name
+                              << p.description << std::endl;
+                }
+                return EXIT_SUCCESS;
+            case 'u':
+                username.assign(optarg);
+                break;
+            case 'w':
+                password.assign(optarg);
+                break;
+            case 'b':
+                bucketName.assign(optarg);
+                break;
+            case 'V':
+                vbuckets = std::stoul(optarg);
+                break;
+            case 'm':
+                memory = std::stoul(optarg);
+                break;
+            case 'l':
+                load = std::stoul(optarg);
+                break;
+            case 's':
+                valueSize = std::stoul(optarg);
+                break;
+            case 'T':
+                loadThreads = std::stoul(optarg);
+                break;
+            case 'd':
+                pipeline = std::stoul(optarg);
+                break;
+            default:
+                std::cerr << R"(
 usage: kvlite [options]
 
 options:
-  --port #     Bind to the provided port
+  --port #              Bind to the provided port
+  --profile name        Create the cluster and a bucket described by the
+                        named profile at startup, rather than waiting for
+                        the cluster to be set up over REST
+  --list-profiles       List the available profiles
+  --username name       The user to create (with --profile)
+  --password password   The password of the user (with --profile)
+  --bucket name         The name of the bucket to create (with --profile,
+                        default "default")
+  --vbuckets #          The number of vbuckets (with --profile, default 64)
+  --memory #            The memory quota of the bucket in MB (with
+                        --profile, default 256)
+  --load #              Populate the bucket with # documents named key_0 to
+                        key_<#-1> (with --profile)
+  --value-size #        The size of the documents to load (default 1024)
+  --load-threads #      The number of threads loading the documents
+                        (default 4)
+  --pipeline #          The number of sets each loader thread sends before
+                        reading their responses (default 512)
 
 )";
-            return EXIT_FAILURE;
+                return EXIT_FAILURE;
+            }
         }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid argument: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!profile && load != 0) {
+        std::cerr << "--load requires --profile" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (username.empty() != password.empty()) {
+        std::cerr << "The username and password must be provided together"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (vbuckets == 0 || loadThreads == 0 || pipeline == 0) {
+        std::cerr << "The number of vbuckets, load threads and the pipeline "
+                     "depth must be at least 1"
+                  << std::endl;
+        return EXIT_FAILURE;
     }
 
     // @todo I need to fix this in a better way ;)
@@ -511,6 +812,32 @@ options:
     evhttp_set_cb(http, "/settings/stats", settings_stats_callback, nullptr);
     evhttp_set_cb(http, "/settings/web", settings_web_callback, nullptr);
 
+    if (profile) {
+        try {
+            const auto start = std::chrono::steady_clock::now();
+            createCluster(profile->nodes, username, password);
+            auto config = profile->bucket;
+            config["max_vbuckets"] = vbuckets;
+            config["max_size"] = memory * 1024 * 1024;
+            auto bucket = cluster->createBucket(
+                    bucketName, config, {}, config["replicas"] != 0);
+            add_bucket_callback(http, *bucket);
+            const auto elapsed =
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - start);
+            std::cout << "Started the " << profile->name << " profile ("
+                      << profile->description << ") in " << elapsed.count()
+                      << " ms" << std::endl;
+            if (load != 0) {
+                bulkLoad(*bucket, load, valueSize, loadThreads, pipeline);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to start the " << profile->name
+                      << " profile: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
     event_base_loop(base.get(), 0);
     evhttp_free(http);
 
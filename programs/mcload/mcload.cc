@@ -0,0 +1,872 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+// mcload is a load generator built on top of our own client connection
+// (so that the overhead of the load generator is known and small). It
+// runs a configurable mix of get, set, subdoc and durable write operations
+// from a number of threads, each driving a number of connections with a
+// configurable pipelining depth, and prints the latency percentiles of each
+// operation once done.
+//
+// The vBucket map is fetched from the server (CCCP) so that it may be used
+// against a cluster (like the ones started by kvlite or the cluster
+// framework): key N lives in vBucket N % number of vBuckets and is sent
+// to the node which is active for that vBucket. Against a memcached bucket
+// all keys live in vBucket 0.
+
+#include <getopt.h>
+#include <memcached/durability_spec.h>
+#include <nlohmann/json.hpp>
+#include <platform/socket.h>
+#include <programs/getpass.h>
+#include <programs/hostname_utils.h>
+#include <protocol/connection/client_connection.h>
+#include <protocol/connection/client_mcbp_commands.h>
+#include <protocol/connection/frameinfo.h>
+#include <utilities/hdrhistogram.h>
+#include <utilities/terminate_handler.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+enum class Operation { Get, Set, SubdocGet, SubdocSet, DurableSet };
+static constexpr size_t NumOperations = 5;
+
+static std::string to_string(Operation op) {
+    switch (op) {
+    case Operation::Get:
+        return "get";
+    case Operation::Set:
+        return "set";
+    case Operation::SubdocGet:
+        return "subdoc-get";
+    case Operation::SubdocSet:
+        return "subdoc-set";
+    case Operation::DurableSet:
+        return "durable-set";
+    }
+    throw std::invalid_argument("to_string(Operation): invalid operation");
+}
+
+static Operation to_operation(const std::string& name) {
+    for (size_t ii = 0; ii < NumOperations; ++ii) {
+        if (name == to_string(Operation(ii))) {
+            return Operation(ii);
+        }
+    }
+    throw std::invalid_argument("Unknown operation: " + name);
+}
+
+static unsigned long strtoul(const std::string& arg) {
+    try {
+        size_t end = 0;
+        auto ret = std::stoul(arg, &end, 10);
+        const auto rest = arg.substr(end);
+        if (rest == "k" || rest == "K") {
+            ret *= 1024;
+        } else if (rest == "m" || rest == "M") {
+            ret *= 1024 * 1024;
+        } else if (!rest.empty()) {
+            std::cerr << "Failed to parse string (extra characters at the "
+                         "end): "
+                      << rest << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        return ret;
+    } catch (const std::exception& exception) {
+        std::cerr << "Failed to parse string \"" << arg
+                  << "\": " << exception.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+static std::vector<std::string> split(const std::string& value, char sep) {
+    std::vector<std::string> ret;
+    std::string::size_type start = 0;
+    std::string::size_type end;
+    while ((end = value.find(sep, start)) != std::string::npos) {
+        ret.emplace_back(value.substr(start, end - start));
+        start = end + 1;
+    }
+    ret.emplace_back(value.substr(start));
+    return ret;
+}
+
+/**
+ * The distribution of the keys accessed:
+ *
+ *   uniform              All keys are equally likely
+ *   zipfian[:theta]      A few keys are accessed much more often than the
+ *                        rest (theta = 0.99 by default, must be below 1)
+ *   hotset[:keys:access] The given percentage of the keys (10 by default)
+ *                        gets the given percentage of the accesses (90 by
+ *                        default)
+ */
+class KeyDistribution {
+public:
+    KeyDistribution(const std::string& spec, uint64_t numKeys)
+        : numKeys(numKeys) {
+        const auto params = split(spec, ':');
+        if (params[0] == "uniform" && params.size() == 1) {
+            type = Type::Uniform;
+        } else if (params[0] == "zipfian" && params.size() <= 2) {
+            type = Type::Zipfian;
+            if (params.size() == 2) {
+                theta = std::stod(params[1]);
+            }
+            if (theta <= 0 || theta >= 1) {
+                throw std::invalid_argument(
+                        "The zipfian theta must be between 0 and 1");
+            }
+            // Gray et al, "Quickly generating billion-record synthetic
+            // databases" (the constants only depend on the number of keys)
+            zetan = zeta(numKeys, theta);
+            alpha = 1.0 / (1.0 - theta);
+            eta = (1 - std::pow(2.0 / numKeys, 1 - theta)) /
+                  (1 - zeta(2, theta) / zetan);
+        } else if (params[0] == "hotset" && params.size() <= 3) {
+            type = Type::HotSet;
+            if (params.size() > 1) {
+                hotKeys = std::stod(params[1]) / 100;
+            }
+            if (params.size() > 2) {
+                hotAccess = std::stod(params[2]) / 100;
+            }
+            if (hotKeys <= 0 || hotKeys >= 1 || hotAccess < 0 ||
+                hotAccess > 1) {
+                throw std::invalid_argument(
+                        "The hot set percentages must be between 0 and 100");
+            }
+        } else {
+            throw std::invalid_argument("Invalid key distribution: " + spec);
+        }
+    }
+
+    uint64_t next(std::mt19937_64& rng) const {
+        std::uniform_real_distribution<double> real(0, 1);
+        switch (type) {
+        case Type::Uniform:
+            return std::uniform_int_distribution<uint64_t>(0, numKeys - 1)(
+                    rng);
+        case Type::Zipfian: {
+            const auto u = real(rng);
+            const auto uz = u * zetan;
+            if (uz < 1) {
+                return 0;
+            }
+            if (uz < 1 + std::pow(0.5, theta)) {
+                return std::min(uint64_t(1), numKeys - 1);
+            }
+            const auto ret = uint64_t(numKeys *
+                                      std::pow(eta * u - eta + 1, alpha));
+            return std::min(ret, numKeys - 1);
+        }
+        case Type::HotSet: {
+            const auto hot = std::max(uint64_t(1), uint64_t(numKeys * hotKeys));
+            if (hot >= numKeys || real(rng) < hotAccess) {
+                return std::uniform_int_distribution<uint64_t>(
+                        0, std::min(hot, numKeys) - 1)(rng);
+            }
+            return std::uniform_int_distribution<uint64_t>(hot,
+                                                           numKeys - 1)(rng);
+        }
+        }
+        throw std::logic_error("KeyDistribution::next: invalid type");
+    }
+
+protected:
+    static double zeta(uint64_t n, double theta) {
+        double ret = 0;
+        for (uint64_t ii = 1; ii <= n; ++ii) {
+            ret += 1 / std::pow(double(ii), theta);
+        }
+        return ret;
+    }
+
+    enum class Type { Uniform, Zipfian, HotSet };
+    Type type = Type::Uniform;
+    const uint64_t numKeys;
+
+    double theta = 0.99;
+    double zetan = 0;
+    double alpha = 0;
+    double eta = 0;
+
+    double hotKeys = 0.1;
+    double hotAccess = 0.9;
+};
+
+/**
+ * The distribution of the value sizes:
+ *
+ *   size                 All values are of the given size
+ *   uniform:min:max      Uniformly distributed between min and max
+ *   normal:mean:stddev   Normally distributed (clamped to [1, 2*mean])
+ */
+class ValueSizeDistribution {
+public:
+    explicit ValueSizeDistribution(const std::string& spec) {
+        const auto params = split(spec, ':');
+        if (params.size() == 1) {
+            min = max = strtoul(params[0]);
+        } else if (params[0] == "uniform" && params.size() == 3) {
+            type = Type::Uniform;
+            min = strtoul(params[1]);
+            max = strtoul(params[2]);
+        } else if (params[0] == "normal" && params.size() == 3) {
+            type = Type::Normal;
+            mean = strtoul(params[1]);
+            stddev = strtoul(params[2]);
+            min = 1;
+            max = 2 * mean;
+        } else {
+            throw std::invalid_argument("Invalid value size distribution: " +
+                                        spec);
+        }
+        if (min > max || max == 0) {
+            throw std::invalid_argument("Invalid value size distribution: " +
+                                        spec);
+        }
+    }
+
+    size_t next(std::mt19937_64& rng) const {
+        switch (type) {
+        case Type::Fixed:
+            return min;
+        case Type::Uniform:
+            return std::uniform_int_distribution<size_t>(min, max)(rng);
+        case Type::Normal: {
+            std::normal_distribution<double> normal(mean, stddev);
+            return size_t(std::clamp(normal(rng), double(min), double(max)));
+        }
+        }
+        throw std::logic_error("ValueSizeDistribution::next: invalid type");
+    }
+
+    size_t getMax() const {
+        return max;
+    }
+
+protected:
+    enum class Type { Fixed, Uniform, Normal };
+    Type type = Type::Fixed;
+    size_t min = 0;
+    size_t max = 0;
+    size_t mean = 0;
+    size_t stddev = 0;
+};
+
+/// The nodes of the cluster and the vBucket map
+struct ClusterMap {
+    struct Node {
+        std::string host;
+        in_port_t port;
+    };
+    std::vector<Node> nodes;
+    /// vBucket => index of the active node
+    std::vector<size_t> vbuckets;
+};
+
+/// The settings shared by all threads
+struct Config {
+    std::string user;
+    std::string password;
+    std::string bucket;
+    sa_family_t family = AF_UNSPEC;
+    size_t numConnections = 1;
+    size_t pipeline = 1;
+    uint64_t numKeys = 100000;
+    std::string keyPrefix = "mcload";
+    std::chrono::seconds duration{10};
+    cb::durability::Level durability = cb::durability::Level::Majority;
+    std::array<double, NumOperations> mix{{80, 20, 0, 0, 0}};
+};
+
+/// What each thread records for an operation
+struct OperationStats {
+    Hdr2sfMicroSecHistogram latency;
+    /// Not found (get and subdoc-get of keys not stored yet)
+    uint64_t misses = 0;
+    /// Any other failure
+    uint64_t errors = 0;
+};
+
+using Stats = std::array<OperationStats, NumOperations>;
+
+static std::unique_ptr<MemcachedConnection> connect(const Config& config,
+                                                    const std::string& host,
+                                                    in_port_t port) {
+    auto ret = std::make_unique<MemcachedConnection>(
+            host, port, config.family, false);
+    ret->connect();
+    if (!config.user.empty()) {
+        ret->authenticate(
+                config.user, config.password, ret->getSaslMechanisms());
+    }
+    ret->setFeatures({cb::mcbp::Feature::MUTATION_SEQNO,
+                      cb::mcbp::Feature::XATTR,
+                      cb::mcbp::Feature::XERROR,
+                      cb::mcbp::Feature::JSON});
+    ret->selectBucket(config.bucket);
+    return ret;
+}
+
+/**
+ * Fetch the vBucket map from the node. A memcached bucket don't have a
+ * map, in which case all operations go to vBucket 0 of the node.
+ */
+static ClusterMap getClusterMap(const Config& config,
+                                const std::string& host,
+                                in_port_t port,
+                                bool verbose) {
+    auto connection = connect(config, host, port);
+    ClusterMap ret;
+
+    auto rsp = connection->execute(
+            BinprotGenericCommand{cb::mcbp::ClientOpcode::GetClusterConfig});
+    if (!rsp.isSuccess()) {
+        if (verbose) {
+            std::cout << "No cluster map (" << to_string(rsp.getStatus())
+                      << "), using vBucket 0 on " << host << ":" << port
+                      << std::endl;
+        }
+        ret.nodes.push_back({host, port});
+        ret.vbuckets.push_back(0);
+        return ret;
+    }
+
+    auto json = nlohmann::json::parse(rsp.getDataString());
+    const auto& vbservermap = json["vBucketServerMap"];
+    for (const auto& n : vbservermap["serverList"]) {
+        auto h = n.get<std::string>();
+        const auto idx = h.rfind(':');
+        const auto p = in_port_t(strtoul(h.substr(idx + 1)));
+        h.resize(idx);
+        if (h.find("$HOST") != std::string::npos) {
+            h = host;
+        }
+        ret.nodes.push_back({h, p});
+    }
+    for (const auto& e : vbservermap["vBucketMap"]) {
+        const auto node = e[0].get<int>();
+        if (node < 0) {
+            throw std::runtime_error("vBucket " +
+                                     std::to_string(ret.vbuckets.size()) +
+                                     " has no active node");
+        }
+        ret.vbuckets.push_back(size_t(node));
+    }
+    if (verbose) {
+        std::cout << "Using " << ret.vbuckets.size() << " vBuckets on "
+                  << ret.nodes.size() << " nodes" << std::endl;
+    }
+    return ret;
+}
+
+/**
+ * A client of the load generator: a connection to every node of the
+ * cluster, and the operations sent to them and not yet responded to.
+ */
+class Client {
+public:
+    Client(const Config& config, const ClusterMap& map) {
+        for (const auto& node : map.nodes) {
+            connections.emplace_back(connect(config, node.host, node.port));
+        }
+    }
+
+    struct InFlight {
+        MemcachedConnection* connection;
+        Operation op;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    std::vector<std::unique_ptr<MemcachedConnection>> connections;
+    std::vector<InFlight> inflight;
+};
+
+/// The JSON document stored for a key ({"counter":0,"data":"xxx..."})
+static std::string makeDocument(size_t size) {
+    std::string ret = R"({"counter":0,"data":")";
+    const auto overhead = ret.size() + 2;
+    ret.append(size > overhead ? size - overhead : 0, 'x');
+    ret.append("\"}");
+    return ret;
+}
+
+/**
+ * The body of each thread: run the operations on its clients until the
+ * deadline, sending up to "pipeline" operations on each client before
+ * reading the responses.
+ */
+class Worker {
+public:
+    Worker(const Config& config,
+           const ClusterMap& map,
+           const KeyDistribution& keys,
+           const ValueSizeDistribution& sizes,
+           size_t seed)
+        : config(config),
+          map(map),
+          keys(keys),
+          sizes(sizes),
+          rng(seed),
+          operations(config.mix.begin(), config.mix.end()) {
+        for (size_t ii = 0; ii < config.numConnections; ++ii) {
+            clients.emplace_back(config, map);
+        }
+    }
+
+    /// Store the keys [first, last) (in batches of the pipeline depth)
+    void populate(uint64_t first, uint64_t last) {
+        auto& client = clients.front();
+        while (first < last) {
+            for (size_t ii = 0; ii < config.pipeline && first < last; ++ii) {
+                send(client, Operation::Set, first++);
+            }
+            receive(client, nullptr);
+        }
+    }
+
+    void run(std::chrono::steady_clock::time_point deadline) {
+        while (std::chrono::steady_clock::now() < deadline) {
+            for (auto& client : clients) {
+                for (size_t ii = 0; ii < config.pipeline; ++ii) {
+                    send(client, Operation(operations(rng)), keys.next(rng));
+                }
+            }
+            for (auto& client : clients) {
+                receive(client, &stats);
+            }
+        }
+    }
+
+    const Stats& getStats() const {
+        return stats;
+    }
+
+protected:
+    void send(Client& client, Operation op, uint64_t key) {
+        const auto vbid = Vbid(uint16_t(key % map.vbuckets.size()));
+        auto* connection =
+                client.connections[map.vbuckets[vbid.get()]].get();
+        const auto name = config.keyPrefix + "_" + std::to_string(key);
+
+        auto dispatch = [&client, connection, op](const BinprotCommand& cmd) {
+            client.inflight.push_back(
+                    {connection, op, std::chrono::steady_clock::now()});
+            connection->sendCommand(cmd);
+        };
+
+        switch (op) {
+        case Operation::Get: {
+            BinprotGetCommand cmd;
+            cmd.setKey(name);
+            cmd.setVBucket(vbid);
+            dispatch(cmd);
+            return;
+        }
+        case Operation::Set:
+        case Operation::DurableSet: {
+            BinprotMutationCommand cmd;
+            cmd.setKey(name);
+            cmd.setVBucket(vbid);
+            cmd.setMutationType(MutationType::Set);
+            cmd.setDatatype(cb::mcbp::Datatype::JSON);
+            cmd.setValue(makeDocument(sizes.next(rng)));
+            if (op == Operation::DurableSet) {
+                cmd.addFrameInfo(DurabilityFrameInfo(config.durability));
+            }
+            dispatch(cmd);
+            return;
+        }
+        case Operation::SubdocGet: {
+            BinprotSubdocCommand cmd(
+                    cb::mcbp::ClientOpcode::SubdocGet, name, "counter");
+            cmd.setVBucket(vbid);
+            dispatch(cmd);
+            return;
+        }
+        case Operation::SubdocSet: {
+            BinprotSubdocCommand cmd(cb::mcbp::ClientOpcode::SubdocCounter,
+                                     name,
+                                     "counter",
+                                     "1");
+            cmd.setVBucket(vbid);
+            dispatch(cmd);
+            return;
+        }
+        }
+        throw std::logic_error("Worker::send: invalid operation");
+    }
+
+    /// Read the responses of all of the operations in flight on the client
+    void receive(Client& client, Stats* record) {
+        // Each connection returns the responses in the order the commands
+        // were sent, so read them back in the same order
+        for (const auto& op : client.inflight) {
+            BinprotResponse rsp;
+            op.connection->recvResponse(rsp);
+            if (record == nullptr) {
+                if (!rsp.isSuccess()) {
+                    throw std::runtime_error("Failed to populate the keys: " +
+                                             to_string(rsp.getStatus()));
+                }
+                continue;
+            }
+            auto& opStats = (*record)[size_t(op.op)];
+            opStats.latency.add(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - op.start));
+            if (rsp.getStatus() == cb::mcbp::Status::KeyEnoent) {
+                ++opStats.misses;
+            } else if (!rsp.isSuccess()) {
+                ++opStats.errors;
+            }
+        }
+        client.inflight.clear();
+    }
+
+    const Config& config;
+    const ClusterMap& map;
+    const KeyDistribution& keys;
+    const ValueSizeDistribution& sizes;
+    std::mt19937_64 rng;
+    std::discrete_distribution<size_t> operations;
+    std::vector<Client> clients;
+    Stats stats;
+};
+
+static void printStats(const Stats& stats, std::chrono::milliseconds duration) {
+    std::cout << std::left << std::setw(12) << "operation" << std::right
+              << std::setw(11) << "ops" << std::setw(10) << "ops/s"
+              << std::setw(9) << "misses" << std::setw(9) << "errors"
+              << std::setw(9) << "mean" << std::setw(9) << "p50"
+              << std::setw(9) << "p90" << std::setw(9) << "p99"
+              << std::setw(9) << "p99.9" << std::setw(9) << "max"
+              << "  (latency in us)" << std::endl;
+    for (size_t ii = 0; ii < NumOperations; ++ii) {
+        const auto& op = stats[ii];
+        const auto count = op.latency.getValueCount();
+        if (count == 0) {
+            continue;
+        }
+        std::cout << std::left << std::setw(12) << to_string(Operation(ii))
+                  << std::right << std::setw(11) << count << std::setw(10)
+                  << count * 1000 / std::max(uint64_t(1),
+                                             uint64_t(duration.count()))
+                  << std::setw(9) << op.misses << std::setw(9) << op.errors
+                  << std::setw(9) << uint64_t(op.latency.getMean())
+                  << std::setw(9) << op.latency.getValueAtPercentile(50)
+                  << std::setw(9) << op.latency.getValueAtPercentile(90)
+                  << std::setw(9) << op.latency.getValueAtPercentile(99)
+                  << std::setw(9) << op.latency.getValueAtPercentile(99.9)
+                  << std::setw(9) << op.latency.getMaxValue() << std::endl;
+    }
+}
+
+static void usage() {
+    std::cerr << R"(Usage: mcload [options]
+
+Options:
+
+  --host hostname[:port]   The host (with an optional port) to connect to
+                           (for IPv6 use: [address]:port if you'd like to
+                           specify port). The vBucket map is fetched from
+                           this node, so any node of a cluster will do.
+  --port port              The port number to connect to
+  --bucket bucketname      The name of the bucket to operate on
+  --user username          The name of the user to authenticate as
+  --password password      The passord to use for authentication
+                           (use '-' to read from standard input)
+  --threads num            The number of threads to use (default 1)
+  --connections num        The number of connections per thread
+                           (default 1). Each connection connects to all
+                           of the nodes of the cluster.
+  --pipeline num           The number of operations sent on a connection
+                           before reading the responses (default 1)
+  --duration seconds       The time to run the load for (default 10)
+  --mix op=weight[,...]    The operations to run, and their weights: get,
+                           set, subdoc-get, subdoc-set (a counter in the
+                           document) and durable-set (default get=80,set=20)
+  --durability level       The durability level of durable-set (default
+                           majority)
+  --keys num               The number of keys (default 100000)
+  --key-prefix prefix      The prefix of the keys (default mcload)
+  --key-distribution spec  uniform, zipfian[:theta] (theta=0.99 by default)
+                           or hotset[:keys:access] (keys% of the keys get
+                           access% of the accesses, 10:90 by default)
+  --value-size spec        size, uniform:min:max or normal:mean:stddev
+                           (default 1024)
+  --populate               Store all of the keys before running the load
+  --verbose                Add more output
+  --ipv4                   Connect over IPv4
+  --ipv6                   Connect over IPv6
+  --help                   This help text
+
+)";
+}
+
+int main(int argc, char** argv) {
+    // Make sure that we dump callstacks on the console
+    install_backtrace_terminate_handler();
+    // Initialize the socket subsystem
+    cb_initialize_sockets();
+
+    int cmd;
+    std::string port{"11210"};
+    std::string host{"localhost"};
+    size_t numThreads = 1;
+    std::string keyDistribution = "uniform";
+    std::string valueSize = "1024";
+    bool populate = false;
+    bool verbose = false;
+    Config config;
+
+    std::vector<option> long_options = {
+            {"ipv4", no_argument, nullptr, '4'},
+            {"ipv6", no_argument, nullptr, '6'},
+            {"host", required_argument, nullptr, 'h'},
+            {"port", required_argument, nullptr, 'p'},
+            {"bucket", required_argument, nullptr, 'b'},
+            {"password", required_argument, nullptr, 'P'},
+            {"user", required_argument, nullptr, 'u'},
+            {"help", no_argument, nullptr, 0},
+            {"threads", required_argument, nullptr, 'T'},
+            {"connections", required_argument, nullptr, 'n'},
+            {"pipeline", required_argument, nullptr, 'd'},
+            {"duration", required_argument, nullptr, 't'},
+            {"mix", required_argument, nullptr, 'm'},
+            {"durability", required_argument, nullptr, 'D'},
+            {"keys", required_argument, nullptr, 'k'},
+            {"key-prefix", required_argument, nullptr, 'K'},
+            {"key-distribution", required_argument, nullptr, 'r'},
+            {"value-size", required_argument, nullptr, 's'},
+            {"populate", no_argument, nullptr, 'L'},
+            {"verbose", no_argument, nullptr, 'v'},
+            {nullptr, 0, nullptr, 0}};
+
+    try {
+        while ((cmd = getopt_long(argc,
+                                  argv,
+                                  "46h:p:u:b:P:T:n:d:t:m:D:k:K:r:s:Lv",
+                                  long_options.data(),
+                                  nullptr)) != EOF) {
+            switch (cmd) {
+            case '6':
+                config.family = AF_INET6;
+                break;
+            case '4':
+                config.family = AF_INET;
+                break;
+            case 'h':
+                host.assign(optarg);
+                break;
+            case 'p':
+                port.assign(optarg);
+                break;
+            case 'b':
+                config.bucket.assign(optarg);
+                break;
+            case 'u':
+                config.user.assign(optarg);
+                break;
+            case 'P':
+                config.password.assign(optarg);
+                break;
+            case 'T':
+                numThreads = strtoul(optarg);
+                break;
+            case 'n':
+                config.numConnections = strtoul(optarg);
+                break;
+            case 'd':
+                config.pipeline = strtoul(optarg);
+                break;
+            case 't':
+                config.duration = std::chrono::seconds(strtoul(optarg));
+                break;
+            case 'm':
+                config.mix.fill(0);
+                for (const auto& entry : split(optarg, ',')) {
+                    const auto idx = entry.find('=');
+                    if (idx == std::string::npos) {
+                        throw std::invalid_argument("Invalid mix entry: " +
+                                                    entry);
+                    }
+                    const auto op = to_operation(entry.substr(0, idx));
+                    config.mix[size_t(op)] = std::stod(entry.substr(idx + 1));
+                }
+                break;
+            case 'D':
+                config.durability = cb::durability::to_level(optarg);
+                break;
+            case 'k':
+                config.numKeys = strtoul(optarg);
+                break;
+            case 'K':
+                config.keyPrefix.assign(optarg);
+                break;
+            case 'r':
+                keyDistribution.assign(optarg);
+                break;
+            case 's':
+                valueSize.assign(optarg);
+                break;
+            case 'L':
+                populate = true;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                usage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (numThreads == 0 || config.numConnections == 0 ||
+        config.pipeline == 0 || config.numKeys == 0) {
+        std::cerr << "The number of threads, connections, keys and the "
+                     "pipeline depth must be at least 1"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (std::all_of(config.mix.begin(), config.mix.end(), [](auto weight) {
+            return weight <= 0;
+        })) {
+        std::cerr << "The operation mix must contain at least one operation"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (config.password == "-") {
+        config.password.assign(getpass());
+    } else if (config.password.empty()) {
+        const char* env_password = std::getenv("CB_PASSWORD");
+        if (env_password) {
+            config.password = env_password;
+        }
+    }
+
+    if (config.bucket.empty()) {
+        std::cerr << "Please specify bucket with -b" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<KeyDistribution> keys;
+    std::unique_ptr<ValueSizeDistribution> sizes;
+    ClusterMap map;
+    try {
+        in_port_t in_port;
+        sa_family_t fam;
+        std::tie(host, in_port, fam) = cb::inet::parse_hostname(host, port);
+
+        if (config.family == AF_UNSPEC) { // The user may have used -4 or -6
+            config.family = fam;
+        }
+
+        keys = std::make_unique<KeyDistribution>(keyDistribution,
+                                                 config.numKeys);
+        sizes = std::make_unique<ValueSizeDistribution>(valueSize);
+        map = getClusterMap(config, host, in_port, verbose);
+
+        std::random_device rd;
+        for (size_t ii = 0; ii < numThreads; ++ii) {
+            workers.emplace_back(std::make_unique<Worker>(
+                    config, map, *keys, *sizes, rd()));
+        }
+    } catch (const ConnectionError& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Run the given function on every worker (in a thread of its own)
+    auto runWorkers = [&workers](auto function) {
+        std::atomic<bool> failed{false};
+        std::vector<std::thread> threads;
+        for (size_t ii = 0; ii < workers.size(); ++ii) {
+            threads.emplace_back([&workers, &function, &failed, ii]() {
+                try {
+                    function(*workers[ii], ii);
+                } catch (const std::exception& ex) {
+                    std::cerr << ex.what() << std::endl;
+                    failed = true;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        if (failed) {
+            std::exit(EXIT_FAILURE);
+        }
+    };
+
+    if (populate) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto perThread = (config.numKeys + numThreads - 1) / numThreads;
+        runWorkers([&config, perThread](Worker& worker, size_t ii) {
+            worker.populate(std::min(config.numKeys, ii * perThread),
+                            std::min(config.numKeys, (ii + 1) * perThread));
+        });
+        if (verbose) {
+            std::cout << "Stored " << config.numKeys << " keys in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count()
+                      << " ms" << std::endl;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + config.duration;
+    runWorkers([deadline](Worker& worker, size_t) { worker.run(deadline); });
+    const auto stop = std::chrono::steady_clock::now();
+
+    Stats total;
+    for (const auto& worker : workers) {
+        const auto& stats = worker->getStats();
+        for (size_t ii = 0; ii < NumOperations; ++ii) {
+            total[ii].latency += stats[ii].latency;
+            total[ii].misses += stats[ii].misses;
+            total[ii].errors += stats[ii].errors;
+        }
+    }
+
+    printStats(total,
+               std::chrono::duration_cast<std::chrono::milliseconds>(stop -
+                                                                     start));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,711 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+// mcreplay replays a workload captured by memcached (see the
+// "workload_capture_file" setting) against a (test) cluster, at the speed
+// it was captured at or scaled up or down, and prints the latency
+// percentiles of each opcode once done.
+//
+// The captured connections are spread over the threads of mcreplay, so
+// the requests of a connection are replayed in order. Every thread sends
+// the requests which are due (pipelined) and then reads their responses.
+// The requests are sent to the node which is active for the vBucket they
+// were captured for (the vBucket number modulo the number of vBuckets of
+// the bucket), as the cluster map is fetched from the server (CCCP).
+//
+// The capture don't contain the values, so the documents stored are
+// filled with 'x' (in a JSON document if the captured datatype was JSON)
+// up to the captured size. If the keys are hashed, the keys are the hex
+// representation of the hash (repeated or truncated to the captured
+// length). The get, mutation (set, add, replace, append and prepend) and
+// delete requests are replayed (the quiet ones as their non-quiet
+// versions); the other requests are skipped.
+
+#include <getopt.h>
+#include <nlohmann/json.hpp>
+#include <platform/socket.h>
+#include <programs/getpass.h>
+#include <programs/hostname_utils.h>
+#include <protocol/connection/client_connection.h>
+#include <protocol/connection/client_mcbp_commands.h>
+#include <utilities/hdrhistogram.h>
+#include <utilities/terminate_handler.h>
+#include <utilities/workload_capture_format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+
+using cb::mcbp::ClientOpcode;
+
+static unsigned long strtoul(const std::string& arg) {
+    try {
+        size_t end = 0;
+        auto ret = std::stoul(arg, &end, 10);
+        if (end != arg.size()) {
+            std::cerr << "Failed to parse string (extra characters at the "
+                         "end): "
+                      << arg.substr(end) << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        return ret;
+    } catch (const std::exception& exception) {
+        std::cerr << "Failed to parse string \"" << arg
+                  << "\": " << exception.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/// A request read back from the capture
+struct Request {
+    std::chrono::nanoseconds timestamp;
+    uint32_t connectionId;
+    uint32_t valueSize;
+    uint16_t vbucket;
+    ClientOpcode opcode;
+    uint8_t datatype;
+    std::string key;
+};
+
+/// The hex representation of the hash, repeated or truncated to length
+static std::string makeKey(uint64_t hash, size_t length) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    std::string ret;
+    while (ret.size() < std::max(length, size_t(1))) {
+        ret.append(hex);
+    }
+    ret.resize(std::max(length, size_t(1)));
+    return ret;
+}
+
+/**
+ * Read all of the requests of the capture (ordered by the time they were
+ * received).
+ *
+ * @throws std::runtime_error if the file isn't a valid capture
+ */
+static std::vector<Request> loadCapture(const std::string& path) {
+    std::unique_ptr<FILE, decltype(&fclose)> fp(fopen(path.c_str(), "rb"),
+                                                &fclose);
+    if (!fp) {
+        throw std::runtime_error("Failed to open " + path + ": " +
+                                 std::strerror(errno));
+    }
+
+    cb::workload::FileHeader header;
+    if (fread(&header, sizeof(header), 1, fp.get()) != 1 ||
+        std::memcmp(header.magic,
+                    cb::workload::FileMagic,
+                    sizeof(header.magic)) != 0) {
+        throw std::runtime_error(path + " is not a workload capture");
+    }
+    if (header.version != cb::workload::FileVersion) {
+        throw std::runtime_error("Unsupported workload capture version " +
+                                 std::to_string(header.version));
+    }
+    const bool hashed = (header.flags & cb::workload::FlagKeysHashed) != 0;
+
+    std::vector<Request> ret;
+    cb::workload::RecordHeader record;
+    while (fread(&record, sizeof(record), 1, fp.get()) == 1) {
+        Request request{std::chrono::nanoseconds(record.timestamp),
+                        record.connectionId,
+                        record.valueSize,
+                        record.vbucket,
+                        ClientOpcode(record.opcode),
+                        record.datatype,
+                        {}};
+        if (hashed) {
+            uint64_t hash;
+            if (fread(&hash, sizeof(hash), 1, fp.get()) != 1) {
+                break;
+            }
+            request.key = makeKey(hash, record.keyLength);
+        } else {
+            request.key.resize(record.keyLength);
+            if (record.keyLength != 0 &&
+                fread(&request.key[0], record.keyLength, 1, fp.get()) != 1) {
+                break;
+            }
+        }
+        ret.emplace_back(std::move(request));
+    }
+
+    // The records of each thread are written in batches
+    std::stable_sort(ret.begin(), ret.end(), [](const auto& a, const auto& b) {
+        return a.timestamp < b.timestamp;
+    });
+    return ret;
+}
+
+/// The nodes of the cluster and the vBucket map
+struct ClusterMap {
+    struct Node {
+        std::string host;
+        in_port_t port;
+    };
+    std::vector<Node> nodes;
+    /// vBucket => index of the active node
+    std::vector<size_t> vbuckets;
+};
+
+/// The settings shared by all threads
+struct Config {
+    std::string user;
+    std::string password;
+    std::string bucket;
+    sa_family_t family = AF_UNSPEC;
+    /// The speed to replay at (relative to the captured speed, 0 = as fast
+    /// as the cluster allows)
+    double speed = 1.0;
+    /// The maximum number of requests sent before reading the responses
+    size_t pipeline = 64;
+};
+
+/// What each thread records for an opcode
+struct OpcodeStats {
+    Hdr2sfMicroSecHistogram latency;
+    /// Not found or not stored (the key don't exist in the test cluster)
+    uint64_t misses = 0;
+    /// Any other failure
+    uint64_t errors = 0;
+};
+
+/// The stats of a thread
+struct Stats {
+    std::map<ClientOpcode, OpcodeStats> opcodes;
+    /// The requests of the capture which aren't replayed
+    uint64_t skipped = 0;
+    /// How late the requests were sent (compared to the schedule)
+    Hdr2sfMicroSecHistogram lag;
+
+    Stats& operator+=(const Stats& other) {
+        for (const auto& [opcode, op] : other.opcodes) {
+            auto& mine = opcodes[opcode];
+            mine.latency += op.latency;
+            mine.misses += op.misses;
+            mine.errors += op.errors;
+        }
+        skipped += other.skipped;
+        lag += other.lag;
+        return *this;
+    }
+};
+
+static std::unique_ptr<MemcachedConnection> connect(const Config& config,
+                                                    const std::string& host,
+                                                    in_port_t port) {
+    auto ret = std::make_unique<MemcachedConnection>(
+            host, port, config.family, false);
+    ret->connect();
+    if (!config.user.empty()) {
+        ret->authenticate(
+                config.user, config.password, ret->getSaslMechanisms());
+    }
+    ret->setFeatures({cb::mcbp::Feature::MUTATION_SEQNO,
+                      cb::mcbp::Feature::XATTR,
+                      cb::mcbp::Feature::XERROR,
+                      cb::mcbp::Feature::JSON});
+    ret->selectBucket(config.bucket);
+    return ret;
+}
+
+/**
+ * Fetch the vBucket map from the node. A memcached bucket don't have a
+ * map, in which case all requests go to vBucket 0 of the node.
+ */
+static ClusterMap getClusterMap(const Config& config,
+                                const std::string& host,
+                                in_port_t port,
+                                bool verbose) {
+    auto connection = connect(config, host, port);
+    ClusterMap ret;
+
+    auto rsp = connection->execute(
+            BinprotGenericCommand{ClientOpcode::GetClusterConfig});
+    if (!rsp.isSuccess()) {
+        if (verbose) {
+            std::cout << "No cluster map (" << to_string(rsp.getStatus())
+                      << "), using vBucket 0 on " << host << ":" << port
+                      << std::endl;
+        }
+        ret.nodes.push_back({host, port});
+        ret.vbuckets.push_back(0);
+        return ret;
+    }
+
+    auto json = nlohmann::json::parse(rsp.getDataString());
+    const auto& vbservermap = json["vBucketServerMap"];
+    for (const auto& n : vbservermap["serverList"]) {
+        auto h = n.get<std::string>();
+        const auto idx = h.rfind(':');
+        const auto p = in_port_t(strtoul(h.substr(idx + 1)));
+        h.resize(idx);
+        if (h.find("$HOST") != std::string::npos) {
+            h = host;
+        }
+        ret.nodes.push_back({h, p});
+    }
+    for (const auto& e : vbservermap["vBucketMap"]) {
+        const auto node = e[0].get<int>();
+        if (node < 0) {
+            throw std::runtime_error("vBucket " +
+                                     std::to_string(ret.vbuckets.size()) +
+                                     " has no active node");
+        }
+        ret.vbuckets.push_back(size_t(node));
+    }
+    if (verbose) {
+        std::cout << "Using " << ret.vbuckets.size() << " vBuckets on "
+                  << ret.nodes.size() << " nodes" << std::endl;
+    }
+    return ret;
+}
+
+/// The value stored for a captured mutation of the given size and datatype
+static std::string makeValue(size_t size, uint8_t datatype) {
+    if ((datatype & uint8_t(cb::mcbp::Datatype::JSON)) == 0) {
+        return std::string(size, 'x');
+    }
+    std::string ret = R"({"data":")";
+    const auto overhead = ret.size() + 2;
+    ret.append(size > overhead ? size - overhead : 0, 'x');
+    ret.append("\"}");
+    return ret;
+}
+
+/**
+ * The body of each thread: replay the requests of the captured connections
+ * assigned to the thread, on a connection to every node of the cluster.
+ */
+class Worker {
+public:
+    Worker(const Config& config, const ClusterMap& map)
+        : config(config), map(map) {
+        for (const auto& node : map.nodes) {
+            connections.emplace_back(connect(config, node.host, node.port));
+        }
+    }
+
+    void add(const Request* request) {
+        requests.push_back(request);
+    }
+
+    void run(std::chrono::steady_clock::time_point start) {
+        auto next = requests.begin();
+        while (next != requests.end()) {
+            // Wait for the next request to be due, and send it along with
+            // all of the others which are due by then
+            const auto due = getDue(start, **next);
+            if (due > std::chrono::steady_clock::now()) {
+                std::this_thread::sleep_until(due);
+            }
+            const auto now = std::chrono::steady_clock::now();
+            while (next != requests.end() &&
+                   inflight.size() < config.pipeline &&
+                   getDue(start, **next) <= now) {
+                send(**next, now);
+                ++next;
+            }
+            receive();
+        }
+    }
+
+    const Stats& getStats() const {
+        return stats;
+    }
+
+protected:
+    std::chrono::steady_clock::time_point getDue(
+            std::chrono::steady_clock::time_point start,
+            const Request& request) const {
+        if (config.speed == 0) {
+            return start;
+        }
+        return start + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               request.timestamp / config.speed);
+    }
+
+    void send(const Request& request,
+              std::chrono::steady_clock::time_point due) {
+        const auto vbid =
+                Vbid(uint16_t(request.vbucket % map.vbuckets.size()));
+        auto* connection = connections[map.vbuckets[vbid.get()]].get();
+
+        auto dispatch = [this, connection, &request](BinprotCommand& cmd) {
+            const auto now = std::chrono::steady_clock::now();
+            inflight.push_back({connection, cmd.getOp(), now});
+            connection->sendCommand(cmd);
+        };
+
+        switch (request.opcode) {
+        case ClientOpcode::Get:
+        case ClientOpcode::Getq:
+        case ClientOpcode::Getk:
+        case ClientOpcode::Getkq: {
+            BinprotGetCommand cmd;
+            cmd.setKey(request.key);
+            cmd.setVBucket(vbid);
+            dispatch(cmd);
+            break;
+        }
+        case ClientOpcode::Set:
+        case ClientOpcode::Setq:
+        case ClientOpcode::Add:
+        case ClientOpcode::Addq:
+        case ClientOpcode::Replace:
+        case ClientOpcode::Replaceq:
+        case ClientOpcode::Append:
+        case ClientOpcode::Appendq:
+        case ClientOpcode::Prepend:
+        case ClientOpcode::Prependq: {
+            BinprotMutationCommand cmd;
+            cmd.setKey(request.key);
+            cmd.setVBucket(vbid);
+            cmd.setMutationType(getMutationType(request.opcode));
+            cmd.setDatatype(uint8_t(request.datatype &
+                                    uint8_t(cb::mcbp::Datatype::JSON)));
+            cmd.setValue(makeValue(request.valueSize, request.datatype));
+            dispatch(cmd);
+            break;
+        }
+        case ClientOpcode::Delete:
+        case ClientOpcode::Deleteq: {
+            BinprotRemoveCommand cmd;
+            cmd.setKey(request.key);
+            cmd.setVBucket(vbid);
+            dispatch(cmd);
+            break;
+        }
+        default:
+            ++stats.skipped;
+            return;
+        }
+        stats.lag.add(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - due));
+    }
+
+    static MutationType getMutationType(ClientOpcode opcode) {
+        switch (opcode) {
+        case ClientOpcode::Add:
+        case ClientOpcode::Addq:
+            return MutationType::Add;
+        case ClientOpcode::Replace:
+        case ClientOpcode::Replaceq:
+            return MutationType::Replace;
+        case ClientOpcode::Append:
+        case ClientOpcode::Appendq:
+            return MutationType::Append;
+        case ClientOpcode::Prepend:
+        case ClientOpcode::Prependq:
+            return MutationType::Prepend;
+        default:
+            return MutationType::Set;
+        }
+    }
+
+    /// Read the responses of all of the requests in flight
+    void receive() {
+        // Each connection returns the responses in the order the commands
+        // were sent, so read them back in the same order
+        for (const auto& op : inflight) {
+            BinprotResponse rsp;
+            op.connection->recvResponse(rsp);
+            auto& opStats = stats.opcodes[op.opcode];
+            opStats.latency.add(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - op.start));
+            const auto status = rsp.getStatus();
+            if (status == cb::mcbp::Status::KeyEnoent ||
+                status == cb::mcbp::Status::NotStored ||
+                status == cb::mcbp::Status::KeyEexists) {
+                ++opStats.misses;
+            } else if (!rsp.isSuccess()) {
+                ++opStats.errors;
+            }
+        }
+        inflight.clear();
+    }
+
+    struct InFlight {
+        MemcachedConnection* connection;
+        ClientOpcode opcode;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    const Config& config;
+    const ClusterMap& map;
+    std::vector<std::unique_ptr<MemcachedConnection>> connections;
+    /// The requests to replay (in the order they were captured)
+    std::vector<const Request*> requests;
+    std::vector<InFlight> inflight;
+    Stats stats;
+};
+
+static void printStats(const Stats& stats, std::chrono::milliseconds duration) {
+    std::cout << std::left << std::setw(12) << "opcode" << std::right
+              << std::setw(11) << "ops" << std::setw(10) << "ops/s"
+              << std::setw(9) << "misses" << std::setw(9) << "errors"
+              << std::setw(9) << "mean" << std::setw(9) << "p50"
+              << std::setw(9) << "p90" << std::setw(9) << "p99"
+              << std::setw(9) << "p99.9" << std::setw(9) << "max"
+              << "  (latency in us)" << std::endl;
+    for (const auto& [opcode, op] : stats.opcodes) {
+        const auto count = op.latency.getValueCount();
+        std::cout << std::left << std::setw(12) << to_string(opcode)
+                  << std::right << std::setw(11) << count << std::setw(10)
+                  << count * 1000 / std::max(uint64_t(1),
+                                             uint64_t(duration.count()))
+                  << std::setw(9) << op.misses << std::setw(9) << op.errors
+                  << std::setw(9) << uint64_t(op.latency.getMean())
+                  << std::setw(9) << op.latency.getValueAtPercentile(50)
+                  << std::setw(9) << op.latency.getValueAtPercentile(90)
+                  << std::setw(9) << op.latency.getValueAtPercentile(99)
+                  << std::setw(9) << op.latency.getValueAtPercentile(99.9)
+                  << std::setw(9) << op.latency.getMaxValue() << std::endl;
+    }
+    std::cout << std::endl
+              << "Skipped " << stats.skipped << " requests" << std::endl;
+    if (stats.lag.getValueCount() != 0) {
+        std::cout << "Schedule lag (us): p50 "
+                  << stats.lag.getValueAtPercentile(50) << ", p99 "
+                  << stats.lag.getValueAtPercentile(99) << ", max "
+                  << stats.lag.getMaxValue() << std::endl;
+    }
+}
+
+static void usage() {
+    std::cerr << R"(Usage: mcreplay [options] capture-file
+
+Options:
+
+  --host hostname[:port]   The host (with an optional port) to connect to
+                           (for IPv6 use: [address]:port if you'd like to
+                           specify port). The vBucket map is fetched from
+                           this node, so any node of a cluster will do.
+  --port port              The port number to connect to
+  --bucket bucketname      The name of the bucket to operate on
+  --user username          The name of the user to authenticate as
+  --password password      The passord to use for authentication
+                           (use '-' to read from standard input)
+  --threads num            The number of threads to use (default 4). The
+                           captured connections are spread over the
+                           threads, and each thread connects to all of the
+                           nodes of the cluster.
+  --speed factor           The speed to replay the capture at relative to
+                           the captured speed (default 1, 2 replays it
+                           twice as fast). 0 replays it as fast as the
+                           cluster allows.
+  --pipeline num           The maximum number of requests sent by a thread
+                           before reading the responses (default 64)
+  --verbose                Add more output
+  --ipv4                   Connect over IPv4
+  --ipv6                   Connect over IPv6
+  --help                   This help text
+
+)";
+}
+
+int main(int argc, char** argv) {
+    // Make sure that we dump callstacks on the console
+    install_backtrace_terminate_handler();
+    // Initialize the socket subsystem
+    cb_initialize_sockets();
+
+    int cmd;
+    std::string port{"11210"};
+    std::string host{"localhost"};
+    size_t numThreads = 4;
+    bool verbose = false;
+    Config config;
+
+    std::vector<option> long_options = {
+            {"ipv4", no_argument, nullptr, '4'},
+            {"ipv6", no_argument, nullptr, '6'},
+            {"host", required_argument, nullptr, 'h'},
+            {"port", required_argument, nullptr, 'p'},
+            {"bucket", required_argument, nullptr, 'b'},
+            {"password", required_argument, nullptr, 'P'},
+            {"user", required_argument, nullptr, 'u'},
+            {"help", no_argument, nullptr, 0},
+            {"threads", required_argument, nullptr, 'T'},
+            {"speed", required_argument, nullptr, 's'},
+            {"pipeline", required_argument, nullptr, 'd'},
+            {"verbose", no_argument, nullptr, 'v'},
+            {nullptr, 0, nullptr, 0}};
+
+    try {
+        while ((cmd = getopt_long(argc,
+                                  argv,
+                                  "46h:p:u:b:P:T:s:d:v",
+                                  long_options.data(),
+                                  nullptr)) != EOF) {
+            switch (cmd) {
+            case '6':
+                config.family = AF_INET6;
+                break;
+            case '4':
+                config.family = AF_INET;
+                break;
+            case 'h':
+                host.assign(optarg);
+                break;
+            case 'p':
+                port.assign(optarg);
+                break;
+            case 'b':
+                config.bucket.assign(optarg);
+                break;
+            case 'u':
+                config.user.assign(optarg);
+                break;
+            case 'P':
+                config.password.assign(optarg);
+                break;
+            case 'T':
+                numThreads = strtoul(optarg);
+                break;
+            case 's':
+                config.speed = std::stod(optarg);
+                break;
+            case 'd':
+                config.pipeline = strtoul(optarg);
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                usage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (optind + 1 != argc) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (numThreads == 0 || config.pipeline == 0 || config.speed < 0) {
+        std::cerr << "The number of threads and the pipeline depth must be "
+                     "at least 1, and the speed can't be negative"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (config.password == "-") {
+        config.password.assign(getpass());
+    } else if (config.password.empty()) {
+        const char* env_password = std::getenv("CB_PASSWORD");
+        if (env_password) {
+            config.password = env_password;
+        }
+    }
+
+    if (config.bucket.empty()) {
+        std::cerr << "Please specify bucket with -b" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Request> requests;
+    std::vector<std::unique_ptr<Worker>> workers;
+    ClusterMap map;
+    try {
+        requests = loadCapture(argv[optind]);
+        if (verbose) {
+            std::cout << "Loaded " << requests.size() << " requests"
+                      << std::endl;
+        }
+
+        in_port_t in_port;
+        sa_family_t fam;
+        std::tie(host, in_port, fam) = cb::inet::parse_hostname(host, port);
+
+        if (config.family == AF_UNSPEC) { // The user may have used -4 or -6
+            config.family = fam;
+        }
+
+        map = getClusterMap(config, host, in_port, verbose);
+        for (size_t ii = 0; ii < numThreads; ++ii) {
+            workers.emplace_back(std::make_unique<Worker>(config, map));
+        }
+    } catch (const ConnectionError& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Spread the captured connections round robin over the threads (in the
+    // order they first show up in the capture)
+    std::map<uint32_t, size_t> owner;
+    for (const auto& request : requests) {
+        auto iter = owner.find(request.connectionId);
+        if (iter == owner.end()) {
+            const auto thread = owner.size() % numThreads;
+            iter = owner.emplace(request.connectionId, thread).first;
+        }
+        workers[iter->second]->add(&request);
+    }
+    if (verbose) {
+        std::cout << "Replaying " << owner.size() << " connections"
+                  << std::endl;
+    }
+
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (auto& worker : workers) {
+        threads.emplace_back([&worker, &failed, start]() {
+            try {
+                worker->run(start);
+            } catch (const std::exception& ex) {
+                std::cerr << ex.what() << std::endl;
+                failed = true;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    if (failed) {
+        return EXIT_FAILURE;
+    }
+
+    Stats total;
+    for (const auto& worker : workers) {
+        total += worker->getStats();
+    }
+
+    printStats(total,
+               std::chrono::duration_cast<std::chrono::milliseconds>(stop -
+                                                                     start));
+    return EXIT_SUCCESS;
+}
@@ -25,15 +25,24 @@
 #include <protocol/connection/client_connection.h>
 #include <protocol/connection/client_mcbp_commands.h>
 #include <spdlog/fmt/fmt.h>
+#include <utilities/hdrhistogram.h>
 #include <utilities/json_utilities.h>
 #include <utilities/terminate_handler.h>
 
 #include <getopt.h>
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cinttypes>
+#include <cmath>
 #include <cstdlib>
+#include <ctime>
+#include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 #define JSON_DUMP_INDENT_SIZE 4
 
@@ -362,6 +371,257 @@ void dumpHistogramFromFile(const std::string& file) {
     }
 }
 
+/// A command or statistic to poll the timings of
+struct Target {
+    std::string name;
+    /// Set if the target is a command (else it's a statistic)
+    std::optional<cb::mcbp::ClientOpcode> opcode;
+};
+
+/**
+ * A server (and bucket) to poll the timings from, along with the timings
+ * returned by the previous poll.
+ */
+struct Source {
+    std::string label;
+    std::string bucket;
+    std::unique_ptr<MemcachedConnection> connection;
+    /// The timings of each target at the previous poll
+    std::map<std::string, HdrHistogram> previous;
+};
+
+/**
+ * Get the timings of the target from the server
+ *
+ * @return the timings, or null if the server has none for the target
+ * @throws std::runtime_error if the server failed the request
+ */
+static nlohmann::json fetch_timings(Source& source, const Target& target) {
+    if (!target.opcode) {
+        auto map = source.connection->statsMap(target.name);
+        auto iter = map.find("0");
+        if (iter == map.end()) {
+            return {};
+        }
+        return nlohmann::json::parse(iter->second);
+    }
+
+    BinprotGetCmdTimerCommand cmd;
+    cmd.setBucket(source.bucket);
+    cmd.setOpcode(*target.opcode);
+    source.connection->sendCommand(cmd);
+
+    BinprotGetCmdTimerResponse resp;
+    source.connection->recvResponse(resp);
+    if (!resp.isSuccess()) {
+        throw std::runtime_error(fmt::format("{}: Failed to get the timings "
+                                             "of \"{}\": {}",
+                                             source.label,
+                                             target.name,
+                                             to_string(resp.getStatus())));
+    }
+    return resp.getTimings();
+}
+
+/**
+ * Rebuild a histogram from the JSON returned by the server. The server only
+ * sends the high value of each (percentile) bucket, so all the values of a
+ * bucket are accounted at its high value.
+ */
+static HdrHistogram to_histogram(const nlohmann::json& json) {
+    // Up to an hour, in microseconds
+    HdrHistogram histogram{0, 3600ULL * 1000 * 1000, 2};
+    if (json.is_object()) {
+        if (json.find("error") != json.end()) {
+            throw std::runtime_error(json["error"].get<std::string>());
+        }
+        if (json.find("data") != json.end()) {
+            for (const auto& bucket : json["data"]) {
+                histogram.addValueAndCount(bucket[0].get<uint64_t>(),
+                                           bucket[1].get<uint64_t>());
+            }
+        }
+    }
+    return histogram;
+}
+
+/// Format a duration in microseconds with a unit suitable for its size
+static std::string format_us(uint64_t us) {
+    if (us >= 1000000) {
+        return fmt::format("{:.2f}s", us / 1000000.0);
+    }
+    if (us >= 1000) {
+        return fmt::format("{:.2f}ms", us / 1000.0);
+    }
+    return fmt::format("{}us", us);
+}
+
+static std::string current_time() {
+    const auto now = time(nullptr);
+    struct tm tm;
+#ifdef WIN32
+    localtime_s(&tm, &now);
+#else
+    localtime_r(&now, &tm);
+#endif
+    std::array<char, 32> buffer;
+    strftime(buffer.data(), buffer.size(), "%H:%M:%S", &tm);
+    return buffer.data();
+}
+
+static const std::array<double, 5> Percentiles = {{50, 90, 99, 99.9, 100}};
+
+static void print_percentiles_header() {
+    fmt::print(stdout,
+               "{:<9} {:<10} {:<24} {:>10} {:>9} {:>9} {:>9} {:>9} {:>9}\n",
+               "time",
+               "source",
+               "command",
+               "ops",
+               "p50",
+               "p90",
+               "p99",
+               "p99.9",
+               "max");
+}
+
+static void print_percentiles(const std::string& time,
+                              const std::string& label,
+                              const std::string& name,
+                              const HdrHistogram& histogram) {
+    fmt::print(stdout,
+               "{:<9} {:<10} {:<24} {:>10}",
+               time,
+               label,
+               name,
+               histogram.getValueCount());
+    for (const auto percentile : Percentiles) {
+        fmt::print(stdout,
+                   " {:>9}",
+                   format_us(histogram.getValueAtPercentile(percentile)));
+    }
+    fmt::print(stdout, "\n");
+}
+
+/// The heatmap has one column per power of two microseconds up to this
+static const int HeatmapColumns = 24;
+static const std::string_view HeatmapShades = " .:-=+*#%@";
+
+static void print_heatmap_header() {
+    // Label the columns of 1us, ~1ms (1024us) and ~1s (2^20us)
+    std::string scale(HeatmapColumns, ' ');
+    scale.replace(0, 3, "1us");
+    scale.replace(10, 3, "1ms");
+    scale.replace(20, 2, "1s");
+    fmt::print(stdout,
+               "{:<9} {:<10} {:<24} {:>10} |{}|\n",
+               "time",
+               "source",
+               "command",
+               "ops",
+               scale);
+}
+
+/**
+ * Print the histogram as a single row; each column is the number of
+ * operations which took up to the next power of two microseconds, shaded
+ * relative to the column with the most operations (on a log scale, so that
+ * the tail is visible).
+ */
+static void print_heatmap(const std::string& time,
+                          const std::string& label,
+                          const std::string& name,
+                          const HdrHistogram& histogram) {
+    std::array<uint64_t, HeatmapColumns> columns{};
+    auto iter = histogram.makeRecordedIterator();
+    while (auto valueAndCount = histogram.getNextValueAndCount(iter)) {
+        int column = 0;
+        while (column < HeatmapColumns - 1 &&
+               valueAndCount->first >= (uint64_t(1) << (column + 1))) {
+            ++column;
+        }
+        columns[column] += valueAndCount->second;
+    }
+
+    const auto max = *std::max_element(columns.begin(), columns.end());
+    std::string row;
+    for (const auto count : columns) {
+        size_t shade = 0;
+        if (count > 0) {
+            shade = 1 + size_t((HeatmapShades.size() - 2) *
+                               std::log(double(count)) /
+                               std::log(double(std::max(max, uint64_t(2)))));
+            shade = std::min(shade, HeatmapShades.size() - 1);
+        }
+        row.push_back(HeatmapShades[shade]);
+    }
+    fmt::print(stdout,
+               "{:<9} {:<10} {:<24} {:>10} |{}|\n",
+               time,
+               label,
+               name,
+               histogram.getValueCount(),
+               row);
+}
+
+/**
+ * Poll the timings of the targets from each source every interval, and print
+ * the operations recorded during each interval (as percentiles or as a
+ * heatmap). If interval is zero the current timings are printed once.
+ */
+static void poll_timings(std::vector<Source>& sources,
+                         const std::vector<Target>& targets,
+                         std::chrono::seconds interval,
+                         size_t count,
+                         bool heatmap) {
+    if (heatmap) {
+        print_heatmap_header();
+    } else {
+        print_percentiles_header();
+    }
+
+    // The first poll of an interval only takes the baseline snapshots
+    const bool once = interval.count() == 0;
+    for (size_t poll = 0; once ? poll < 1 : (count == 0 || poll <= count);
+         ++poll) {
+        if (poll > 0) {
+            std::this_thread::sleep_for(interval);
+        }
+        const auto time = current_time();
+        for (auto& source : sources) {
+            for (const auto& target : targets) {
+                auto json = fetch_timings(source, target);
+                if (json.is_null()) {
+                    continue;
+                }
+                auto histogram = to_histogram(json);
+                auto iter = source.previous.find(target.name);
+                if (iter == source.previous.end()) {
+                    source.previous.emplace(target.name, histogram);
+                    if (!once) {
+                        continue;
+                    }
+                } else {
+                    auto current = histogram;
+                    histogram -= iter->second;
+                    iter->second = current;
+                }
+                if (histogram.getValueCount() == 0 && targets.size() > 1) {
+                    // Only print the commands used (when polling several)
+                    continue;
+                }
+                if (heatmap) {
+                    print_heatmap(time, source.label, target.name, histogram);
+                } else {
+                    print_percentiles(
+                            time, source.label, target.name, histogram);
+                }
+            }
+        }
+        fflush(stdout);
+    }
+}
+
 void usage() {
     fmt::print(stderr,
                "Usage mctimings [options] [opcode / statname]\n{}\n",
@@ -381,12 +641,60 @@ void usage() {
   -j or --json[=pretty]          Print JSON instead of histograms
   -f or --file path.json         Dump Histogram data from a json file produced
                                  from mctimings using the --json arg
+  --interval seconds             Poll the timings every interval and print
+                                 the percentiles of the operations of each
+                                 interval
+  --count number                 The number of intervals to print (default
+                                 until interrupted)
+  --heatmap                      Print each interval as a heatmap row (one
+                                 column per power of two microseconds)
+  --compare-host host[:port]     Also print the timings of the given host
+                                 (with the same credentials)
+  --compare-bucket bucketname    Also print the timings of the given bucket
+                                 (on the compared host if specified)
   --help                         This help text
 
 )");
     fmt::print(stderr,
                "Example:\n     mctimings --user operator --bucket /all/ "
-               "--password - --verbose GET SET\n");
+               "--password - --verbose GET SET\n"
+               "     mctimings --user operator --bucket default "
+               "--compare-bucket other --interval 5 --heatmap GET\n");
+}
+
+static std::unique_ptr<MemcachedConnection> connect_to_server(
+        std::string host,
+        const std::string& port,
+        sa_family_t family,
+        bool secure,
+        const std::string& user,
+        const std::string& password,
+        const std::string& bucket) {
+    in_port_t in_port;
+    sa_family_t fam;
+    std::tie(host, in_port, fam) = cb::inet::parse_hostname(host, port);
+
+    if (family == AF_UNSPEC) { // The user may have used -4 or -6
+        family = fam;
+    }
+    auto connection = std::make_unique<MemcachedConnection>(
+            host, in_port, family, secure);
+
+    connection->connect();
+
+    // MEMCACHED_VERSION contains the git sha
+    connection->setAgentName("mctimings " MEMCACHED_VERSION);
+    connection->setFeatures({cb::mcbp::Feature::XERROR});
+
+    if (!user.empty()) {
+        connection->authenticate(
+                user, password, connection->getSaslMechanisms());
+    }
+
+    if (!bucket.empty() && bucket != "/all/") {
+        connection->selectBucket(bucket);
+    }
+    return connection;
 }
 
 int main(int argc, char** argv) {
@@ -404,6 +712,11 @@ int main(int argc, char** argv) {
     bool verbose = false;
     bool secure = false;
     bool json = false;
+    std::chrono::seconds interval{0};
+    size_t count = 0;
+    bool heatmap = false;
+    std::string compareHost;
+    std::string compareBucket;
 
     /* Initialize the socket subsystem */
     cb_initialize_sockets();
@@ -420,6 +733,11 @@ int main(int argc, char** argv) {
             {"verbose", no_argument, nullptr, 'v'},
             {"json", optional_argument, nullptr, 'j'},
             {"file", required_argument, nullptr, 'f'},
+            {"interval", required_argument, nullptr, 'I'},
+            {"count", required_argument, nullptr, 'C'},
+            {"heatmap", no_argument, nullptr, 'H'},
+            {"compare-host", required_argument, nullptr, 'A'},
+            {"compare-bucket", required_argument, nullptr, 'B'},
             {"help", no_argument, nullptr, 0},
             {nullptr, 0, nullptr, 0}};
 
@@ -466,6 +784,21 @@ int main(int argc, char** argv) {
         case 'f':
             file.assign(optarg);
             break;
+        case 'I':
+            interval = std::chrono::seconds(std::stoul(optarg));
+            break;
+        case 'C':
+            count = std::stoul(optarg);
+            break;
+        case 'H':
+            heatmap = true;
+            break;
+        case 'A':
+            compareHost.assign(optarg);
+            break;
+        case 'B':
+            compareBucket.assign(optarg);
+            break;
         default:
             usage();
             return cmd == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -493,29 +826,62 @@ int main(int argc, char** argv) {
     }
 
     try {
-        in_port_t in_port;
-        sa_family_t fam;
-        std::tie(host, in_port, fam) = cb::inet::parse_hostname(host, port);
-
-        if (family == AF_UNSPEC) { // The user may have used -4 or -6
-            family = fam;
-        }
-        MemcachedConnection connection(host, in_port, family, secure);
-
-        connection.connect();
-
-        // MEMCACHED_VERSION contains the git sha
-        connection.setAgentName("mctimings " MEMCACHED_VERSION);
-        connection.setFeatures({cb::mcbp::Feature::XERROR});
+        if (interval.count() > 0 || heatmap || !compareHost.empty() ||
+            !compareBucket.empty()) {
+            std::vector<Source> sources;
+            sources.push_back(
+                    {host + "/" + bucket,
+                     bucket,
+                     connect_to_server(host,
+                                       port,
+                                       family,
+                                       secure,
+                                       user,
+                                       password,
+                                       bucket),
+                     {}});
+            if (!compareHost.empty() || !compareBucket.empty()) {
+                const auto& otherHost =
+                        compareHost.empty() ? host : compareHost;
+                const auto& otherBucket =
+                        compareBucket.empty() ? bucket : compareBucket;
+                sources.push_back({otherHost + "/" + otherBucket,
+                                   otherBucket,
+                                   connect_to_server(otherHost,
+                                                     port,
+                                                     family,
+                                                     secure,
+                                                     user,
+                                                     password,
+                                                     otherBucket),
+                                   {}});
+            }
 
-        if (!user.empty()) {
-            connection.authenticate(user, password,
-                                    connection.getSaslMechanisms());
+            std::vector<Target> targets;
+            if (optind == argc) {
+                for (int ii = 0; ii < 256; ++ii) {
+                    const auto opcode = cb::mcbp::ClientOpcode(ii);
+                    if (cb::mcbp::is_valid_opcode(opcode)) {
+                        targets.push_back({opcode2string(opcode), opcode});
+                    }
+                }
+            } else {
+                for (; optind < argc; ++optind) {
+                    try {
+                        targets.push_back(
+                                {argv[optind], to_opcode(argv[optind])});
+                    } catch (const std::invalid_argument&) {
+                        targets.push_back({argv[optind], {}});
+                    }
+                }
+            }
+            poll_timings(sources, targets, interval, count, heatmap);
+            return EXIT_SUCCESS;
         }
 
-        if (!bucket.empty() && bucket != "/all/") {
-            connection.selectBucket(bucket);
-        }
+        auto connectionPtr = connect_to_server(
+                host, port, family, secure, user, password, bucket);
+        auto& connection = *connectionPtr;
 
         if (verbose) {
             fmt::print(stdout, histogramInfo);
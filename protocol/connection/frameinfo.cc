@@ -26,6 +26,7 @@ DcpStreamIdFrameInfo::~DcpStreamIdFrameInfo() = default;
 OpenTracingContextFrameInfo::~OpenTracingContextFrameInfo() = default;
 ImpersonateUserFrameInfo::~ImpersonateUserFrameInfo() = default;
 PreserveTtlFrameInfo::~PreserveTtlFrameInfo() = default;
+DeadlineFrameInfo::~DeadlineFrameInfo() = default;
 
 using cb::mcbp::request::FrameInfoId;
 
@@ -122,3 +123,10 @@ std::vector<uint8_t> PreserveTtlFrameInfo::encode() const {
     ret.push_back(uint8_t(FrameInfoId::PreserveTtl) << 0x04U);
     return ret;
 }
+
+std::vector<uint8_t> DeadlineFrameInfo::encode() const {
+    auto value = htons(gsl::narrow<uint16_t>(timeout.count()));
+    return FrameInfo::encode(
+            FrameInfoId::Deadline,
+            {reinterpret_cast<const uint8_t*>(&value), sizeof(value)});
+}
@@ -17,6 +17,7 @@
 
 #include <mcbp/protocol/request.h>
 #include <memcached/durability_spec.h>
+#include <chrono>
 #include <cstdint>
 #include <vector>
 
@@ -98,3 +99,15 @@ public:
     ~PreserveTtlFrameInfo() override;
     std::vector<uint8_t> encode() const override;
 };
+
+class DeadlineFrameInfo : public FrameInfo {
+public:
+    explicit DeadlineFrameInfo(std::chrono::milliseconds timeout)
+        : timeout(timeout) {
+    }
+    ~DeadlineFrameInfo() override;
+    std::vector<uint8_t> encode() const override;
+
+protected:
+    const std::chrono::milliseconds timeout;
+};
@@ -259,6 +259,12 @@ protected:
                                   reinterpret_cast<const char*>(payload.data()),
                                   payload.size()};
                     break;
+                case cb::mcbp::request::FrameInfoId::Deadline:
+                    ss << " Timeout="
+                       << ntohs(*reinterpret_cast<const uint16_t*>(
+                                  payload.data()))
+                       << "ms";
+                    break;
                 }
 
                 vector.emplace_back(ss.str());
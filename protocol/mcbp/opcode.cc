@@ -116,6 +116,7 @@ bool is_valid_opcode(ClientOpcode opcode) {
     case ClientOpcode::DcpAbort:
     case ClientOpcode::DcpSeqnoAdvanced:
     case ClientOpcode::DcpOsoSnapshot:
+    case ClientOpcode::DcpCompressedFrames:
     case ClientOpcode::StopPersistence:
     case ClientOpcode::StartPersistence:
     case ClientOpcode::SetParam:
@@ -160,6 +161,10 @@ bool is_valid_opcode(ClientOpcode opcode) {
     case ClientOpcode::CollectionsGetManifest:
     case ClientOpcode::CollectionsGetID:
     case ClientOpcode::CollectionsGetScopeID:
+    case ClientOpcode::RangeScan:
+    case ClientOpcode::SetWithMetaBatch:
+    case ClientOpcode::SampleDocuments:
+    case ClientOpcode::GetLockedMeta:
     case ClientOpcode::SetDriftCounterState_Unsupported:
     case ClientOpcode::GetAdjustedTime_Unsupported:
     case ClientOpcode::SubdocGet:
@@ -312,6 +317,7 @@ bool is_durability_supported(ClientOpcode opcode) {
     case ClientOpcode::DcpAbort:
     case ClientOpcode::DcpSeqnoAdvanced:
     case ClientOpcode::DcpOsoSnapshot:
+    case ClientOpcode::DcpCompressedFrames:
     case ClientOpcode::StopPersistence:
     case ClientOpcode::StartPersistence:
     case ClientOpcode::SetParam:
@@ -356,6 +362,10 @@ bool is_durability_supported(ClientOpcode opcode) {
     case ClientOpcode::CollectionsGetManifest:
     case ClientOpcode::CollectionsGetID:
     case ClientOpcode::CollectionsGetScopeID:
+    case ClientOpcode::RangeScan:
+    case ClientOpcode::SetWithMetaBatch:
+    case ClientOpcode::SampleDocuments:
+    case ClientOpcode::GetLockedMeta:
     case ClientOpcode::SetDriftCounterState_Unsupported:
     case ClientOpcode::GetAdjustedTime_Unsupported:
     case ClientOpcode::SubdocGet:
@@ -402,8 +412,10 @@ bool is_reorder_supported(ClientOpcode opcode) {
     case ClientOpcode::Touch:
     case ClientOpcode::EvictKey:
     case ClientOpcode::GetLocked:
+    case ClientOpcode::GetLockedMeta:
     case ClientOpcode::UnlockKey:
     case ClientOpcode::GetReplica:
+    case ClientOpcode::GetKeys:
         return true;
 
     case ClientOpcode::Getq:
@@ -483,6 +495,7 @@ bool is_reorder_supported(ClientOpcode opcode) {
     case ClientOpcode::DcpAbort:
     case ClientOpcode::DcpSeqnoAdvanced:
     case ClientOpcode::DcpOsoSnapshot:
+    case ClientOpcode::DcpCompressedFrames:
     case ClientOpcode::StopPersistence:
     case ClientOpcode::StartPersistence:
     case ClientOpcode::SetParam:
@@ -518,11 +531,13 @@ bool is_reorder_supported(ClientOpcode opcode) {
     case ClientOpcode::GetClusterConfig:
     case ClientOpcode::GetRandomKey:
     case ClientOpcode::SeqnoPersistence:
-    case ClientOpcode::GetKeys:
     case ClientOpcode::CollectionsSetManifest:
     case ClientOpcode::CollectionsGetManifest:
     case ClientOpcode::CollectionsGetID:
     case ClientOpcode::CollectionsGetScopeID:
+    case ClientOpcode::RangeScan:
+    case ClientOpcode::SetWithMetaBatch:
+    case ClientOpcode::SampleDocuments:
     case ClientOpcode::SetDriftCounterState_Unsupported:
     case ClientOpcode::GetAdjustedTime_Unsupported:
     case ClientOpcode::SubdocGet:
@@ -591,6 +606,7 @@ bool is_collection_command(ClientOpcode opcode) {
     case ClientOpcode::GetReplica:
     case ClientOpcode::EvictKey:
     case ClientOpcode::GetLocked:
+    case ClientOpcode::GetLockedMeta:
     case ClientOpcode::UnlockKey:
     case ClientOpcode::GetMeta:
     case ClientOpcode::GetqMeta:
@@ -678,6 +694,7 @@ bool is_collection_command(ClientOpcode opcode) {
     case ClientOpcode::DcpSeqnoAcknowledged:
     case ClientOpcode::DcpSeqnoAdvanced:
     case ClientOpcode::DcpOsoSnapshot:
+    case ClientOpcode::DcpCompressedFrames:
     // MB-39650: DCP input are not collection commands in this context. They do
     // represent changes to collections, but they are not privilege checked
     // against anything other than bucket level Privilege::DcpConsumer there
@@ -719,6 +736,9 @@ bool is_collection_command(ClientOpcode opcode) {
     case ClientOpcode::CollectionsGetManifest:
     case ClientOpcode::CollectionsGetID:
     case ClientOpcode::CollectionsGetScopeID:
+    case ClientOpcode::RangeScan:
+    case ClientOpcode::SetWithMetaBatch:
+    case ClientOpcode::SampleDocuments:
     case ClientOpcode::SetDriftCounterState_Unsupported:
     case ClientOpcode::GetAdjustedTime_Unsupported:
     case ClientOpcode::Scrub:
@@ -847,6 +867,7 @@ bool is_preserve_ttl_supported(ClientOpcode opcode) {
     case ClientOpcode::DcpAbort:
     case ClientOpcode::DcpSeqnoAdvanced:
     case ClientOpcode::DcpOsoSnapshot:
+    case ClientOpcode::DcpCompressedFrames:
     case ClientOpcode::StopPersistence:
     case ClientOpcode::StartPersistence:
     case ClientOpcode::SetParam:
@@ -891,6 +912,10 @@ bool is_preserve_ttl_supported(ClientOpcode opcode) {
     case ClientOpcode::CollectionsGetManifest:
     case ClientOpcode::CollectionsGetID:
     case ClientOpcode::CollectionsGetScopeID:
+    case ClientOpcode::RangeScan:
+    case ClientOpcode::SetWithMetaBatch:
+    case ClientOpcode::SampleDocuments:
+    case ClientOpcode::GetLockedMeta:
     case ClientOpcode::SetDriftCounterState_Unsupported:
     case ClientOpcode::GetAdjustedTime_Unsupported:
     case ClientOpcode::SubdocGet:
@@ -1105,6 +1130,8 @@ std::string to_string(cb::mcbp::ClientOpcode opcode) {
         return "DCP_SEQNO_ADVANCED";
     case ClientOpcode::DcpOsoSnapshot:
         return "DCP_OSO_SNAPSHOT";
+    case ClientOpcode::DcpCompressedFrames:
+        return "DCP_COMPRESSED_FRAMES";
     case ClientOpcode::StopPersistence:
         return "STOP_PERSISTENCE";
     case ClientOpcode::StartPersistence:
@@ -1193,6 +1220,14 @@ std::string to_string(cb::mcbp::ClientOpcode opcode) {
         return "COLLECTIONS_GET_ID";
     case ClientOpcode::CollectionsGetScopeID:
         return "COLLECTIONS_GET_SCOPE_ID";
+    case ClientOpcode::RangeScan:
+        return "RANGE_SCAN";
+    case ClientOpcode::SetWithMetaBatch:
+        return "SET_WITH_META_BATCH";
+    case ClientOpcode::SampleDocuments:
+        return "SAMPLE_DOCUMENTS";
+    case ClientOpcode::GetLockedMeta:
+        return "GET_LOCKED_META";
     case ClientOpcode::SetDriftCounterState_Unsupported:
         return "SET_DRIFT_COUNTER_STATE";
     case ClientOpcode::GetAdjustedTime_Unsupported:
@@ -116,6 +116,7 @@ const std::map<cb::mcbp::ClientOpcode, std::string> client_blueprint = {
          {ClientOpcode::DcpAbort, "DCP_ABORT"},
          {ClientOpcode::DcpSeqnoAdvanced, "DCP_SEQNO_ADVANCED"},
          {ClientOpcode::DcpOsoSnapshot, "DCP_OSO_SNAPSHOT"},
+         {ClientOpcode::DcpCompressedFrames, "DCP_COMPRESSED_FRAMES"},
          {ClientOpcode::StopPersistence, "STOP_PERSISTENCE"},
          {ClientOpcode::StartPersistence, "START_PERSISTENCE"},
          {ClientOpcode::SetParam, "SET_PARAM"},
@@ -163,6 +164,10 @@ const std::map<cb::mcbp::ClientOpcode, std::string> client_blueprint = {
          {ClientOpcode::CollectionsGetManifest, "COLLECTIONS_GET_MANIFEST"},
          {ClientOpcode::CollectionsGetID, "COLLECTIONS_GET_ID"},
          {ClientOpcode::CollectionsGetScopeID, "COLLECTIONS_GET_SCOPE_ID"},
+         {ClientOpcode::RangeScan, "RANGE_SCAN"},
+         {ClientOpcode::SetWithMetaBatch, "SET_WITH_META_BATCH"},
+         {ClientOpcode::SampleDocuments, "SAMPLE_DOCUMENTS"},
+         {ClientOpcode::GetLockedMeta, "GET_LOCKED_META"},
          {ClientOpcode::SetDriftCounterState_Unsupported,
           "SET_DRIFT_COUNTER_STATE"},
          {ClientOpcode::GetAdjustedTime_Unsupported, "GET_ADJUSTED_TIME"},
@@ -302,6 +307,7 @@ TEST(ClientOpcode, is_reorder_supported) {
                    {{ClientOpcode::Get,
                      ClientOpcode::Getk,
                      ClientOpcode::GetLocked,
+                     ClientOpcode::GetLockedMeta,
                      ClientOpcode::UnlockKey,
                      ClientOpcode::Touch,
                      ClientOpcode::Gat,
@@ -310,6 +316,7 @@ TEST(ClientOpcode, is_reorder_supported) {
                      ClientOpcode::Decrement,
                      ClientOpcode::EvictKey,
                      ClientOpcode::GetReplica,
+                     ClientOpcode::GetKeys,
                      ClientOpcode::Add,
                      ClientOpcode::Set,
                      ClientOpcode::Replace,
@@ -348,6 +355,7 @@ TEST(ClientOpcode, is_collection_command) {
                      ClientOpcode::GetReplica,
                      ClientOpcode::EvictKey,
                      ClientOpcode::GetLocked,
+                     ClientOpcode::GetLockedMeta,
                      ClientOpcode::UnlockKey,
                      ClientOpcode::GetMeta,
                      ClientOpcode::GetqMeta,
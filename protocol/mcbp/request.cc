@@ -171,6 +171,7 @@ bool Request::isQuiet() const {
         case ClientOpcode::DcpAbort:
         case ClientOpcode::DcpSeqnoAdvanced:
         case ClientOpcode::DcpOsoSnapshot:
+        case ClientOpcode::DcpCompressedFrames:
         case ClientOpcode::StopPersistence:
         case ClientOpcode::StartPersistence:
         case ClientOpcode::SetParam:
@@ -183,6 +184,7 @@ bool Request::isQuiet() const {
         case ClientOpcode::Observe:
         case ClientOpcode::EvictKey:
         case ClientOpcode::GetLocked:
+        case ClientOpcode::GetLockedMeta:
         case ClientOpcode::UnlockKey:
         case ClientOpcode::GetFailoverLog:
         case ClientOpcode::LastClosedCheckpoint:
@@ -211,6 +213,9 @@ bool Request::isQuiet() const {
         case ClientOpcode::CollectionsGetManifest:
         case ClientOpcode::CollectionsGetID:
         case ClientOpcode::CollectionsGetScopeID:
+        case ClientOpcode::RangeScan:
+        case ClientOpcode::SetWithMetaBatch:
+        case ClientOpcode::SampleDocuments:
         case ClientOpcode::SetDriftCounterState_Unsupported:
         case ClientOpcode::GetAdjustedTime_Unsupported:
         case ClientOpcode::SubdocGet:
@@ -368,6 +373,11 @@ nlohmann::json Request::toJSON(bool validated) const {
                     break;
                 case request::FrameInfoId::PreserveTtl:
                     frameid["Preserve TTL"] = true;
+                    break;
+                case request::FrameInfoId::Deadline:
+                    frameid["deadline"] = ntohs(
+                            *reinterpret_cast<const uint16_t*>(buffer.data()));
+                    break;
                 }
 
                 return true;
@@ -422,6 +432,8 @@ std::string to_string(cb::mcbp::request::FrameInfoId id) {
         return "Impersonate";
     case FrameInfoId::PreserveTtl:
         return "PreserveTtl";
+    case FrameInfoId::Deadline:
+        return "Deadline";
     }
 
     throw std::invalid_argument("to_string(): Invalid frame id: " +
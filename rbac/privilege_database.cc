@@ -427,8 +427,17 @@ const UserEntry& PrivilegeDatabase::lookup(const std::string& user) const {
 void PrivilegeContext::dropPrivilege(Privilege privilege) {
     // Given that we're using a shared_ptr to the buckets we can't modify
     // the privilege mask for the buckets/scopes/collections.
-    // Keep them around in a vector and check it later on.
-    droppedPrivileges.push_back(privilege);
+    // Keep them around in a mask and check it later on.
+    dropped.set(size_t(privilege));
+    updateEffectiveMask();
+}
+
+void PrivilegeContext::updateEffectiveMask() {
+    effective = mask;
+    if (bucket) {
+        effective |= bucket->getPrivileges();
+    }
+    effective &= ~dropped;
 }
 
 bool PrivilegeContext::isStale() const {
@@ -450,20 +459,17 @@ PrivilegeAccess PrivilegeContext::check(Privilege privilege,
                 "PrivilegeContext::check: can't provide cid and no sid");
     }
 
-    // Check if the user dropped the privilege over the connection.
-    if (!droppedPrivileges.empty()) {
-        if (std::find(droppedPrivileges.begin(),
-                      droppedPrivileges.end(),
-                      privilege) != droppedPrivileges.end()) {
-            return PrivilegeAccessFail;
-        }
+    if (effective.test(idx)) {
+        return PrivilegeAccessOk;
     }
 
-    if (mask.test(idx)) {
-        return PrivilegeAccessOk;
+    // Check if the user dropped the privilege over the connection.
+    if (dropped.test(idx)) {
+        return PrivilegeAccessFail;
     }
 
-    if (bucket && is_bucket_privilege(privilege)) {
+    if (bucket && bucket->hasScopePrivileges() &&
+        is_bucket_privilege(privilege)) {
         return bucket->check(
                 privilege,
                 sid,
@@ -508,6 +514,7 @@ void PrivilegeContext::setBucketPrivilegeBits(bool value) {
             mask[ii] = value;
         }
     }
+    updateEffectiveMask();
 }
 
 PrivilegeContext createContext(const UserIdent& user,
@@ -147,3 +147,53 @@ TEST(PrivilegeDatabaseTest, to_json) {
     EXPECT_EQ(json.dump(2), db.to_json(cb::rbac::Domain::External).dump(2))
             << db.to_json(cb::rbac::Domain::External).dump(2);
 }
+
+TEST(PrivilegeContextTest, DropBucketPrivilege) {
+    nlohmann::json json;
+    json["trond"]["privileges"] = {"Audit"};
+    json["trond"]["buckets"]["mybucket"]["privileges"] = {"Read", "Upsert"};
+    json["trond"]["domain"] = "local";
+    cb::rbac::PrivilegeDatabase db(json, cb::rbac::Domain::Local);
+
+    auto ctx = db.createContext("trond", cb::rbac::Domain::Local, "mybucket");
+    using cb::rbac::Privilege;
+    EXPECT_TRUE(ctx.check(Privilege::Audit, {}, {}).success());
+    EXPECT_TRUE(ctx.check(Privilege::Read, {}, {}).success());
+    EXPECT_TRUE(ctx.check(Privilege::Upsert, {}, {}).success());
+    EXPECT_TRUE(ctx.check(Privilege::Delete, {}, {}).failed());
+
+    // The privileges granted by the bucket may be dropped as well as the
+    // global privileges
+    ctx.dropPrivilege(Privilege::Upsert);
+    ctx.dropPrivilege(Privilege::Audit);
+    EXPECT_TRUE(ctx.check(Privilege::Audit, {}, {}).failed());
+    EXPECT_TRUE(ctx.check(Privilege::Read, {}, {}).success());
+    EXPECT_TRUE(ctx.check(Privilege::Upsert, {}, {}).failed());
+    EXPECT_TRUE(ctx.check(Privilege::Upsert, ScopeID{8}, {}).failed());
+
+    // And stay dropped when the bucket privileges are set
+    ctx.setBucketPrivileges();
+    EXPECT_TRUE(ctx.check(Privilege::Delete, {}, {}).success());
+    EXPECT_TRUE(ctx.check(Privilege::Upsert, {}, {}).failed());
+}
+
+TEST(PrivilegeContextTest, ScopePrivileges) {
+    nlohmann::json json;
+    json["trond"]["buckets"]["mybucket"]["privileges"] = {"Read"};
+    json["trond"]["buckets"]["mybucket"]["scopes"]["8"]["privileges"] = {
+            "Upsert"};
+    json["trond"]["domain"] = "local";
+    cb::rbac::PrivilegeDatabase db(json, cb::rbac::Domain::Local);
+
+    auto ctx = db.createContext("trond", cb::rbac::Domain::Local, "mybucket");
+    using cb::rbac::Privilege;
+    EXPECT_TRUE(ctx.check(Privilege::Read, ScopeID{9}, {}).success());
+    EXPECT_TRUE(ctx.check(Privilege::Upsert, ScopeID{8}, {}).success());
+    EXPECT_TRUE(ctx.check(Privilege::Upsert, ScopeID{8}, CollectionID{8})
+                        .success());
+    EXPECT_TRUE(ctx.check(Privilege::Upsert, ScopeID{9}, {}).failed());
+    EXPECT_TRUE(ctx.check(Privilege::Upsert, {}, {}).failed());
+
+    ctx.dropPrivilege(Privilege::Upsert);
+    EXPECT_TRUE(ctx.check(Privilege::Upsert, ScopeID{8}, {}).failed());
+}
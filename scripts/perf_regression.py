@@ -0,0 +1,301 @@
+#!/usr/bin/env python2.7
+
+"""
+Copyright 2020 Couchbase, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+This script tracks performance regressions of ep_perfsuite and the Google
+Benchmark testsuites against a stored baseline.
+
+'record' collects the samples of each metric from the JSON output of
+ep_perfsuite (-f json) and/or Google Benchmark (--benchmark_out_format=json,
+run with --benchmark_repetitions so that there is more than one sample per
+benchmark) into a results file keyed by the git sha of the build:
+
+    python perf_regression.py record --perfsuite output.*.json \\
+        --benchmark benchmark_output.json --output results.json
+
+'compare' compares a results file against a baseline results file, and
+fails if any metric regressed: the samples are worse with statistical
+significance (one-sided Mann-Whitney U test, --alpha) and the median is
+worse by more than --threshold percent. If the baseline doesn't exist, the
+results are stored as the baseline:
+
+    python perf_regression.py compare --baseline baseline.json \\
+        --current results.json --junit perf_regression.xml
+"""
+
+import argparse
+import collections
+import datetime
+import json
+import math
+import os
+import subprocess
+import sys
+
+
+def git_sha():
+    try:
+        return subprocess.check_output(
+            ['git', 'rev-parse', 'HEAD'],
+            cwd=os.path.dirname(os.path.abspath(__file__))).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return 'unknown'
+
+
+def load_json(path):
+    try:
+        with open(path, 'r') as f:
+            return json.load(f)
+    except (IOError, ValueError) as e:
+        print('Failed to load JSON data from {}:\n\t {}'.format(path, e))
+        sys.exit(-1)
+
+
+def perfsuite_metrics(path):
+    """The metrics of a JSON file written by ep_perfsuite -f json"""
+    data = load_json(path)
+    suite = 'ep-perfsuite'
+    if data.get('bucket_type'):
+        suite += '-' + data['bucket_type']
+    metrics = {}
+    for name, result in data['results'].items():
+        metrics['{}/{}.{}'.format(suite, data['name'], name)] = {
+            'lower_is_better': data.get('lower_is_better', True),
+            'samples': result['samples']}
+    return metrics
+
+
+def benchmark_metrics(path, names, higher_is_better):
+    """
+    The metrics of a Google Benchmark JSON file: one sample per repetition
+    of each benchmark (the aggregates are ignored).
+    """
+    data = load_json(path)
+    metrics = collections.OrderedDict()
+    for bench in data['benchmarks']:
+        if bench.get('run_type') == 'aggregate':
+            continue
+        run_name = bench.get('run_name', bench['name'])
+        for name in names:
+            if name not in bench:
+                continue
+            metric = metrics.setdefault(
+                '{}.{}'.format(run_name, name),
+                {'lower_is_better': name not in higher_is_better,
+                 'samples': []})
+            metric['samples'].append(bench[name])
+    return metrics
+
+
+def median(values):
+    ordered = sorted(values)
+    mid = len(ordered) // 2
+    if len(ordered) % 2:
+        return ordered[mid]
+    return (ordered[mid - 1] + ordered[mid]) / 2.0
+
+
+def mann_whitney_greater(a, b):
+    """
+    One-sided Mann-Whitney U test. Returns the probability of the samples
+    of a being (stochastically) this much greater than the samples of b if
+    they came from the same distribution (normal approximation, with tie
+    and continuity correction).
+    """
+    combined = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    n = len(combined)
+    rank_sum = 0.0
+    ties = 0.0
+    i = 0
+    while i < n:
+        j = i
+        while j + 1 < n and combined[j + 1][0] == combined[i][0]:
+            j += 1
+        rank = (i + j) / 2.0 + 1
+        count = j - i + 1
+        ties += count ** 3 - count
+        rank_sum += rank * sum(1 for k in range(i, j + 1)
+                               if combined[k][1] == 0)
+        i = j + 1
+
+    n1 = len(a)
+    n2 = len(b)
+    u = rank_sum - n1 * (n1 + 1) / 2.0
+    mean = n1 * n2 / 2.0
+    variance = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if variance <= 0:
+        # All samples are identical
+        return 1.0
+    z = (u - mean - 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def record(options):
+    metrics = collections.OrderedDict()
+    for path in options.perfsuite:
+        metrics.update(perfsuite_metrics(path))
+    for path in options.benchmark:
+        metrics.update(benchmark_metrics(path,
+                                         options.metrics.split(','),
+                                         options.higher_is_better.split(',')))
+    if not metrics:
+        print('No metrics found')
+        sys.exit(-1)
+
+    results = {'git_sha': options.sha or git_sha(),
+               'timestamp': datetime.datetime.utcnow().isoformat(),
+               'metrics': metrics}
+    with open(options.output, 'w') as f:
+        json.dump(results, f)
+    print('Recorded {} metrics for {}'.format(len(metrics),
+                                              results['git_sha']))
+
+
+def compare(options):
+    current = load_json(options.current)
+    if not os.path.exists(options.baseline):
+        with open(options.baseline, 'w') as f:
+            json.dump(current, f)
+        print('No baseline found, stored the results of {} as {}'.format(
+            current['git_sha'], options.baseline))
+        return 0
+
+    baseline = load_json(options.baseline)
+    print('Comparing {} against the baseline {}'.format(
+        current['git_sha'], baseline['git_sha']))
+
+    regressions = 0
+    testcases = []
+    for name, metric in sorted(current['metrics'].items()):
+        if name not in baseline['metrics']:
+            continue
+        new = metric['samples']
+        old = baseline['metrics'][name]['samples']
+        if len(new) < options.min_samples or len(old) < options.min_samples:
+            print('{}: not enough samples'.format(name))
+            continue
+
+        old_median = median(old)
+        new_median = median(new)
+        change = 0.0
+        if old_median != 0:
+            change = (new_median - old_median) * 100.0 / abs(old_median)
+
+        if metric['lower_is_better']:
+            p = mann_whitney_greater(new, old)
+            worse = change
+        else:
+            p = mann_whitney_greater(old, new)
+            worse = -change
+
+        regressed = p < options.alpha and worse > options.threshold
+        if regressed:
+            regressions += 1
+        print('{}: {} -> {} ({:+.1f}%, p={:.4f}){}'.format(
+            name, old_median, new_median, change, p,
+            ' REGRESSION' if regressed else ''))
+        testcases.append((name, regressed, old_median, new_median, change, p))
+
+    if options.junit:
+        write_junit(options.junit, testcases, baseline['git_sha'])
+
+    if regressions:
+        print('{} metrics regressed'.format(regressions))
+        return 1
+
+    if options.update_baseline:
+        with open(options.baseline, 'w') as f:
+            json.dump(current, f)
+    return 0
+
+
+def write_junit(path, testcases, baseline_sha):
+    failures = sum(1 for t in testcases if t[1])
+    with open(path, 'w') as f:
+        f.write('<testsuites>\n')
+        f.write('  <testsuite name="perf_regression" tests="{}" '
+                'failures="{}">\n'.format(len(testcases), failures))
+        for name, regressed, old, new, change, p in testcases:
+            f.write('    <testcase name="{}" classname="perf_regression"'
+                    .format(name))
+            if not regressed:
+                f.write('/>\n')
+                continue
+            f.write('>\n      <failure message="Regressed {:+.1f}% against '
+                    '{} ({} -> {}, p={:.4f})"/>\n    </testcase>\n'.format(
+                        change, baseline_sha, old, new, p))
+        f.write('  </testsuite>\n')
+        f.write('</testsuites>\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Track performance regressions against a baseline')
+    subparsers = parser.add_subparsers(dest='command')
+
+    record_args = subparsers.add_parser(
+        'record', help='Collect the results of a run')
+    record_args.add_argument('--perfsuite', nargs='*', default=[],
+                             help='The JSON files written by ep_perfsuite')
+    record_args.add_argument('--benchmark', nargs='*', default=[],
+                             help='The JSON files written by Google '
+                                  'Benchmark')
+    record_args.add_argument('--metrics', default='real_time',
+                             help='The Google Benchmark metrics to record, '
+                                  'comma separated (default real_time)')
+    record_args.add_argument('--higher_is_better',
+                             default='items_per_second,bytes_per_second',
+                             help='The Google Benchmark metrics where a '
+                                  'higher value is better, comma separated')
+    record_args.add_argument('--sha',
+                             help='The git sha of the build (default: the '
+                                  'HEAD of this repository)')
+    record_args.add_argument('--output', required=True,
+                             help='The results file to write')
+
+    compare_args = subparsers.add_parser(
+        'compare', help='Compare the results of a run against a baseline')
+    compare_args.add_argument('--baseline', required=True,
+                              help='The baseline results file')
+    compare_args.add_argument('--current', required=True,
+                              help='The results file to compare')
+    compare_args.add_argument('--alpha', type=float, default=0.01,
+                              help='The significance level (default 0.01)')
+    compare_args.add_argument('--threshold', type=float, default=5.0,
+                              help='The change of the median (in percent) '
+                                   'to consider a regression (default 5)')
+    compare_args.add_argument('--min_samples', type=int, default=5,
+                              help='The minimum number of samples of a '
+                                   'metric to compare it (default 5)')
+    compare_args.add_argument('--junit',
+                              help='Write the results as JUnit XML to the '
+                                   'given file')
+    compare_args.add_argument('--update_baseline', action='store_true',
+                              help='Replace the baseline with the results '
+                                   'if nothing regressed')
+
+    options = parser.parse_args()
+    if options.command == 'record':
+        record(options)
+        return 0
+    if options.command == 'compare':
+        return compare(options)
+    parser.print_help()
+    return -2
+
+
+if __name__ == '__main__':
+    sys.exit(main())
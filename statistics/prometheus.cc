@@ -16,15 +16,18 @@
  */
 
 #include "statistics/prometheus.h"
-#include "statistics/prometheus_collector.h"
+#include "statistics/prometheus_text_collector.h"
 
+#include <CivetServer.h>
 #include <daemon/log_macros.h>
 #include <daemon/settings.h>
 #include <daemon/stats.h>
+#include <folly/Synchronized.h>
 #include <logger/logger.h>
-#include <prometheus/exposer.h>
 #include <gsl/gsl>
 
+#include <chrono>
+
 namespace cb::prometheus {
 
 std::unique_ptr<MetricServer> instance;
@@ -43,7 +46,7 @@ void initialize(const std::pair<in_port_t, sa_family_t>& config) {
     instance = std::make_unique<MetricServer>(port, family);
     if (!instance->isAlive()) {
         FATAL_ERROR(EXIT_FAILURE,
-                    fmt::format("Failed to start Prometheus exposer on "
+                    fmt::format("Failed to start Prometheus server on "
                                 "family:{} port:{}",
                                 (family == AF_INET) ? "inet" : "inet6",
                                 port));
@@ -61,38 +64,85 @@ void initialize(const std::pair<in_port_t, sa_family_t>& config) {
              port);
 }
 
-class MetricServer::KVCollectable : public ::prometheus::Collectable {
+class MetricServer::KVHandler : public CivetHandler {
 public:
-    explicit KVCollectable(Cardinality cardinality) : cardinality(cardinality) {
+    explicit KVHandler(Cardinality cardinality) : cardinality(cardinality) {
     }
+
     /**
-     * Gathers high or low cardinality metrics
-     * and returns them in the prometheus required structure.
+     * Gathers high or low cardinality metrics, streaming them into the
+     * response in the text exposition format.
      */
-    [[nodiscard]] std::vector<::prometheus::MetricFamily> Collect()
-            const override {
-        PrometheusStatCollector collector;
-        server_prometheus_stats(collector, cardinality);
-        const auto& statsMap = collector.getCollectedStats();
-
-        std::vector<::prometheus::MetricFamily> result;
+    bool handleGet(CivetServer*, mg_connection* conn) override {
+        mg_printf(conn,
+                  "HTTP/1.1 200 OK\r\n"
+                  "Content-Type: text/plain; version=0.0.4\r\n"
+                  "Transfer-Encoding: chunked\r\n"
+                  "\r\n");
+
+        auto send = [conn](std::string_view chunk) {
+            mg_send_chunk(conn, chunk.data(), unsigned(chunk.size()));
+        };
+
+        const auto interval =
+                Settings::instance().getPrometheusHighCardinalityInterval();
+        if (cardinality == Cardinality::High && interval.count() != 0) {
+            sendSampled(interval, send);
+        } else {
+            PrometheusTextStatCollector collector(send);
+            server_prometheus_stats(collector, cardinality);
+        }
 
-        result.reserve(statsMap.size());
+        // terminating chunk
+        mg_send_chunk(conn, "", 0);
+        return true;
+    }
 
-        for (const auto& statEntry : statsMap) {
-            result.push_back(statEntry.second /* MetricFamily */);
+private:
+    /**
+     * Send the stats collected by the last scrape if it was less than
+     * the interval ago, otherwise collect (and keep) new ones. Lets the
+     * (per-collection) high cardinality stats be sampled at a lower rate
+     * than the scrapes.
+     */
+    template <typename SendFn>
+    void sendSampled(std::chrono::seconds interval, SendFn&& send) {
+        auto locked = sampled.lock();
+        const auto now = std::chrono::steady_clock::now();
+        if (locked->text.empty() || now - locked->collected >= interval) {
+            locked->text.clear();
+            {
+                PrometheusTextStatCollector collector(
+                        [&text = locked->text](std::string_view chunk) {
+                            text.append(chunk);
+                        });
+                server_prometheus_stats(collector, cardinality);
+            }
+            locked->text.shrink_to_fit();
+            locked->collected = now;
         }
 
-        return result;
+        std::string_view text = locked->text;
+        while (!text.empty()) {
+            const auto size = std::min(text.size(),
+                                       PrometheusTextStatCollector::ChunkSize);
+            send(text.substr(0, size));
+            text.remove_prefix(size);
+        }
     }
 
-private:
-    Cardinality cardinality;
+    const Cardinality cardinality;
+
+    struct Sampled {
+        std::chrono::steady_clock::time_point collected;
+        std::string text;
+    };
+    folly::Synchronized<Sampled, std::mutex> sampled;
 };
 
 MetricServer::MetricServer(in_port_t port, sa_family_t family)
-    : stats(std::make_shared<KVCollectable>(Cardinality::Low)),
-      statsHC(std::make_shared<KVCollectable>(Cardinality::High)) {
+    : stats(std::make_unique<KVHandler>(Cardinality::Low)),
+      statsHC(std::make_unique<KVHandler>(Cardinality::High)) {
     try {
         /*
          * The connectionStr should meet the spec for civetweb's
@@ -110,32 +160,35 @@ MetricServer::MetricServer(in_port_t port, sa_family_t family)
 
         auto connectionStr = fmt::format("{}:{}", localhost, port);
 
-        exposer = std::make_unique<::prometheus::Exposer>(connectionStr);
+        server = std::make_unique<CivetServer>(std::vector<std::string>{
+                "listening_ports", connectionStr, "num_threads", "2"});
 
-        // TODO: register on separate endpoints when supported
-        exposer->RegisterCollectable(stats, "/_prometheusMetrics");
-        exposer->RegisterCollectable(statsHC, "/_prometheusMetricsHigh");
+        server->addHandler("/_prometheusMetrics", stats.get());
+        server->addHandler("/_prometheusMetricsHigh", statsHC.get());
     } catch (const std::exception& e) {
-        LOG_ERROR("Failed start Prometheus Exposer: {}", e.what());
+        LOG_ERROR("Failed start Prometheus server: {}", e.what());
     }
 }
 
-// defined here as Exposer must be a complete type. Avoids
-// polluting the header with prometheus headers.
-MetricServer::~MetricServer() = default;
+// defined here as CivetServer must be a complete type. Avoids
+// polluting the header with civetweb headers.
+MetricServer::~MetricServer() {
+    // stop serving before the handlers are destroyed
+    server.reset();
+}
 
 bool MetricServer::isAlive() const {
-    // if exposer was successfully created, it is running
+    // if the server was successfully created, it is running
     // and can serve Prometheus scrapes.
-    return bool(exposer);
+    return bool(server);
 }
 
 in_port_t MetricServer::getListeningPort() const {
-    // Caller should always check the exposer is alive first.
+    // Caller should always check the server is alive first.
     Expects(isAlive());
-    std::vector<int> listeningPorts = exposer->GetListeningPorts();
+    std::vector<int> listeningPorts = server->getListeningPorts();
     // only one port should have been specified when constructing
-    // the exposer.
+    // the server.
     Expects(listeningPorts.size() == 1);
 
     return in_port_t(listeningPorts[0]);
@@ -0,0 +1,158 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <statistics/prometheus_text_collector.h>
+
+#include <cmath>
+#include <gsl/gsl>
+
+PrometheusTextStatCollector::~PrometheusTextStatCollector() {
+    flush();
+}
+
+void PrometheusTextStatCollector::flush() {
+    if (buffer.size() > 0) {
+        output({buffer.data(), buffer.size()});
+        buffer.clear();
+    }
+}
+
+/// Append a sample value as the exposition format expects it
+static void formatValue(fmt::memory_buffer& buffer, double value) {
+    if (std::isnan(value)) {
+        format_to(buffer, "NaN");
+    } else if (std::isinf(value)) {
+        format_to(buffer, value > 0 ? "+Inf" : "-Inf");
+    } else {
+        format_to(buffer, "{}", value);
+    }
+}
+
+void PrometheusTextStatCollector::addStat(const cb::stats::StatDef& spec,
+                                          const HistogramData& hist,
+                                          const Labels& additionalLabels) {
+    const auto name = beginFamily(spec, "histogram");
+
+    uint64_t cumulativeCount = 0;
+    for (const auto& bucket : hist.buckets) {
+        cumulativeCount += bucket.count;
+        fmt::memory_buffer le;
+        formatValue(le, spec.unit.toBaseUnit(bucket.upperBound));
+        writeSample(name,
+                    "_bucket",
+                    spec,
+                    additionalLabels,
+                    {le.data(), le.size()},
+                    double(cumulativeCount));
+    }
+    writeSample(name,
+                "_bucket",
+                spec,
+                additionalLabels,
+                "+Inf",
+                double(hist.sampleCount));
+    writeSample(name,
+                "_sum",
+                spec,
+                additionalLabels,
+                {},
+                double(hist.sampleSum));
+    writeSample(name,
+                "_count",
+                spec,
+                additionalLabels,
+                {},
+                double(hist.sampleCount));
+    maybeFlush();
+}
+
+void PrometheusTextStatCollector::addStat(const cb::stats::StatDef& spec,
+                                          double v,
+                                          const Labels& additionalLabels) {
+    const auto name = beginFamily(spec, "untyped");
+    writeSample(name, {}, spec, additionalLabels, {}, spec.unit.toBaseUnit(v));
+    maybeFlush();
+}
+
+std::string_view PrometheusTextStatCollector::beginFamily(
+        const cb::stats::StatDef& key, std::string_view type) {
+    auto [itr, inserted] = families.insert(prefix + key.metricFamily);
+    if (inserted) {
+        format_to(buffer, "# TYPE {} {}\n", *itr, type);
+    }
+    return *itr;
+}
+
+void PrometheusTextStatCollector::writeSample(std::string_view name,
+                                              std::string_view suffix,
+                                              const cb::stats::StatDef& key,
+                                              const Labels& additionalLabels,
+                                              std::string_view extraLabel,
+                                              double value) {
+    buffer.append(name.data(), name.data() + name.size());
+    buffer.append(suffix.data(), suffix.data() + suffix.size());
+
+    const bool hasLabels = !additionalLabels.empty() || !key.labels.empty() ||
+                           !extraLabel.empty();
+    if (hasLabels) {
+        buffer.push_back('{');
+        // start with the labels passed down from the collector, then the
+        // labels specific to this stat (specified in stats.def.h). As in
+        // PrometheusStatCollector these are not expected to overlap.
+        for (const auto& [label, val] : additionalLabels) {
+            writeLabel(label, val);
+        }
+        for (const auto& [label, val] : key.labels) {
+            Expects(!additionalLabels.count(label));
+            writeLabel(label, val);
+        }
+        if (!extraLabel.empty()) {
+            // the upper bound of a histogram bucket
+            writeLabel("le", extraLabel);
+        }
+        // replace the trailing ','
+        buffer.resize(buffer.size() - 1);
+        buffer.push_back('}');
+    }
+    buffer.push_back(' ');
+    formatValue(buffer, value);
+    buffer.push_back('\n');
+}
+
+void PrometheusTextStatCollector::writeLabel(std::string_view label,
+                                             std::string_view value) {
+    buffer.append(label.data(), label.data() + label.size());
+    buffer.push_back('=');
+    buffer.push_back('"');
+    for (const auto c : value) {
+        switch (c) {
+        case '\\':
+            format_to(buffer, "\\\\");
+            break;
+        case '"':
+            format_to(buffer, "\\\"");
+            break;
+        case '\n':
+            format_to(buffer, "\\n");
+            break;
+        default:
+            buffer.push_back(c);
+        }
+    }
+    buffer.push_back('"');
+    buffer.push_back(',');
+}
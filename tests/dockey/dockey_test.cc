@@ -19,6 +19,8 @@
 #include <memcached/dockey.h>
 
 #include <array>
+#include <string>
+#include <vector>
 
 class DocKeyTest : public ::testing::Test {
 protected:
@@ -175,3 +177,61 @@ TEST_F(DocKeyTest, no_prepare) {
         // do nothing - expected to throw
     }
 }
+
+// A key of the default collection must hash the same with and without the
+// encoded CollectionID (for every length of the tail of the key)
+TEST_F(DocKeyTest, hash_encoding) {
+    std::string key;
+    for (int ii = 0; ii < 40; ++ii) {
+        std::vector<uint8_t> encoded = {DefaultCollectionLeb128Encoded};
+        encoded.insert(encoded.end(), key.begin(), key.end());
+        DocKey key1(key, DocKeyEncodesCollectionId::No);
+        DocKey key2(encoded.data(),
+                    encoded.size(),
+                    DocKeyEncodesCollectionId::Yes);
+        EXPECT_EQ(key1.hash(), key2.hash()) << key;
+        key.push_back('a' + ii % 26);
+    }
+}
+
+TEST_F(DocKeyTest, hash_collection) {
+    std::array<uint8_t, 4> data1 = {{0, 'k', 'e', 'y'}};
+    std::array<uint8_t, 4> data2 = {{8, 'k', 'e', 'y'}};
+    std::array<uint8_t, 5> data3 = {{0x88, 1, 'k', 'e', 'y'}};
+    DocKey key1(data1.data(), data1.size(), DocKeyEncodesCollectionId::Yes);
+    DocKey key2(data2.data(), data2.size(), DocKeyEncodesCollectionId::Yes);
+    DocKey key3(data3.data(), data3.size(), DocKeyEncodesCollectionId::Yes);
+    EXPECT_NE(key1.hash(), key2.hash());
+    EXPECT_NE(key1.hash(), key3.hash());
+    EXPECT_NE(key2.hash(), key3.hash());
+
+    // A zero padded tail isn't the same key
+    std::array<uint8_t, 5> data4 = {{0, 'k', 'e', 'y', 0}};
+    DocKey key4(data4.data(), data4.size(), DocKeyEncodesCollectionId::Yes);
+    EXPECT_NE(key1.hash(), key4.hash());
+}
+
+// HashTable::getBucketForHash takes the hash modulo the number of buckets,
+// check that sequential keys spread evenly over a prime and a power of two
+// number of buckets
+TEST_F(DocKeyTest, hash_distribution) {
+    const size_t numKeys = 100000;
+    for (size_t numBuckets : {3079, 4096}) {
+        std::vector<size_t> buckets(numBuckets);
+        for (size_t ii = 0; ii < numKeys; ++ii) {
+            const auto key = "key_" + std::to_string(ii);
+            DocKey docKey(key, DocKeyEncodesCollectionId::No);
+            buckets[docKey.hash() % numBuckets]++;
+        }
+
+        // The chi-squared statistic of a uniform distribution is about
+        // numBuckets (with a standard deviation of ~sqrt(2 * numBuckets))
+        const double expected = double(numKeys) / numBuckets;
+        double chiSquared = 0;
+        for (auto count : buckets) {
+            EXPECT_NE(0u, count);
+            chiSquared += (count - expected) * (count - expected) / expected;
+        }
+        EXPECT_LT(chiSquared, numBuckets * 1.5) << numBuckets;
+    }
+}
@@ -0,0 +1,65 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmark of the cost of reading the time for command timings: FastClock
+ * against steady_clock and the coarse (tick granularity) clock_gettime.
+ */
+
+#include <benchmark/benchmark.h>
+#include <utilities/fast_clock.h>
+
+#include <chrono>
+#include <ctime>
+#include <thread>
+
+static void bench_steady_clock(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(std::chrono::steady_clock::now());
+    }
+}
+
+static void bench_fast_clock(benchmark::State& state) {
+    // Let the clock calibrate so the TSC is measured
+    const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (std::chrono::steady_clock::now() < deadline) {
+        cb::FastClock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(cb::FastClock::now());
+    }
+    state.SetLabel(cb::FastClock::isUsingTsc() ? "tsc" : "steady_clock");
+}
+
+#ifdef CLOCK_MONOTONIC_COARSE
+static void bench_monotonic_coarse(benchmark::State& state) {
+    timespec ts;
+    while (state.KeepRunning()) {
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        benchmark::DoNotOptimize(ts);
+    }
+}
+BENCHMARK(bench_monotonic_coarse)->ThreadRange(1, 8);
+#endif
+
+BENCHMARK(bench_steady_clock)->ThreadRange(1, 8);
+BENCHMARK(bench_fast_clock)->ThreadRange(1, 8);
+
+BENCHMARK_MAIN();
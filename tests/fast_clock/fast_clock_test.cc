@@ -0,0 +1,63 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <folly/portability/GTest.h>
+#include <utilities/fast_clock.h>
+
+#include <thread>
+
+using namespace std::chrono_literals;
+
+// FastClock never goes backwards on a thread, including across calibration
+TEST(FastClockTest, Monotonic) {
+    auto previous = cb::FastClock::now();
+    const auto deadline = std::chrono::steady_clock::now() + 300ms;
+    while (std::chrono::steady_clock::now() < deadline) {
+        const auto now = cb::FastClock::now();
+        ASSERT_GE(now, previous);
+        previous = now;
+    }
+}
+
+// FastClock readings are steady_clock time points, so they can be compared
+// against steady_clock readings; they should be close.
+TEST(FastClockTest, TracksSteadyClock) {
+    // Run past the initial calibration
+    for (int ii = 0; ii < 30; ++ii) {
+        cb::FastClock::now();
+        std::this_thread::sleep_for(10ms);
+    }
+
+    for (int ii = 0; ii < 10; ++ii) {
+        const auto before = std::chrono::steady_clock::now();
+        const auto fast = cb::FastClock::now();
+        const auto after = std::chrono::steady_clock::now();
+        // Allow for the drift between calibrations
+        EXPECT_GE(fast, before - 1ms);
+        EXPECT_LE(fast, after + 1ms);
+        std::this_thread::sleep_for(20ms);
+    }
+}
+
+// A duration measured with FastClock matches the time slept
+TEST(FastClockTest, MeasuresDuration) {
+    const auto start = cb::FastClock::now();
+    std::this_thread::sleep_for(50ms);
+    const auto elapsed = cb::FastClock::now() - start;
+    EXPECT_GE(elapsed, 49ms);
+    EXPECT_LT(elapsed, 5s);
+}
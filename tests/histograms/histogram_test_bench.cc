@@ -21,10 +21,14 @@
 
 #include <benchmark/benchmark.h>
 #include <daemon/timing_histogram.h>
+#include <daemon/timings.h>
 #include <folly/portability/GTest.h>
 #include <nlohmann/json.hpp>
 #include <utilities/hdrhistogram.h>
+#include <condition_variable>
+#include <mutex>
 #include <random>
+#include <thread>
 
 #define LOG_NORMAL_MEAN 0
 #define LOG_NORMAL_STD 2.0
@@ -203,6 +207,76 @@ void HistogramToJson(benchmark::State& state) {
     }
 }
 
+// Contention on the command completion path: every thread records into a
+// single histogram shared by all threads (how Timings used to be), vs
+// Timings::collect() recording into per thread histograms.
+static void SharedHistogramContention(benchmark::State& state) {
+    static Hdr1sfMicroSecHistogram histogram;
+    if (state.thread_index == 0) {
+        histogram.reset();
+    }
+
+    uint64_t value = 0;
+    while (state.KeepRunning()) {
+        histogram.add(std::chrono::microseconds(1 + value++ % 1000));
+    }
+}
+
+static void TimingsCollectContention(benchmark::State& state) {
+    static Timings timings;
+    if (state.thread_index == 0) {
+        timings.reset();
+    }
+
+    uint64_t value = 0;
+    while (state.KeepRunning()) {
+        timings.collect(cb::mcbp::ClientOpcode::Get,
+                        std::chrono::microseconds(1 + value++ % 1000));
+    }
+}
+
+// Cost of reading the merged histogram of an opcode with 8 threads having
+// recorded timings.
+static void TimingsGetHistogram(benchmark::State& state) {
+    Timings timings;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    size_t ready = 0;
+    for (int ii = 0; ii < 8; ++ii) {
+        threads.emplace_back([&]() {
+            for (int jj = 0; jj < 1000; ++jj) {
+                timings.collect(cb::mcbp::ClientOpcode::Get,
+                                std::chrono::microseconds(jj));
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            ++ready;
+            cond.notify_all();
+            // Keep the thread (and its histograms) alive while reading
+            cond.wait(lock, [&done]() { return done; });
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&ready]() { return ready == 8; });
+    }
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(timings.get_timing_histogram(
+                uint8_t(cb::mcbp::ClientOpcode::Get)));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    cond.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
 BENCHMARK_TEMPLATE(HistogramConstructionDestructionHeap, TimingHistogram);
 BENCHMARK_TEMPLATE(HistogramConstructionDestructionHeap, HdrHistogramBench);
 BENCHMARK_TEMPLATE(HistogramConstructionDestructionHeap, HdrHistogramEmpty);
@@ -239,4 +313,8 @@ BENCHMARK_TEMPLATE(HistogramReset, HdrHistogramEmpty);
 BENCHMARK_TEMPLATE(HistogramAggregation, TimingHistogram)->Arg(100);
 BENCHMARK_TEMPLATE(HistogramAggregation, HdrHistogramBench)->Arg(100);
 
+BENCHMARK(SharedHistogramContention)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(TimingsCollectContention)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(TimingsGetHistogram);
+
 BENCHMARK_MAIN();
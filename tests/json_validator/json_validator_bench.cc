@@ -0,0 +1,107 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmark of the vectorised JSON validator against JSON_checker on
+ * typical document payloads.
+ */
+
+#include <JSON_checker.h>
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <utilities/json_validator.h>
+
+enum class Payload { Small, Profile, Text, Numbers, Binary };
+
+/// A document of roughly the given size
+static nlohmann::json makeDocument(Payload type, size_t size) {
+    nlohmann::json doc;
+    switch (type) {
+    case Payload::Small:
+        doc = {{"id", 1234}, {"name", "user"}, {"active", true}};
+        break;
+    case Payload::Profile:
+        // Many short keys and values
+        for (size_t ii = 0; doc.dump().size() < size; ++ii) {
+            doc["orders"].push_back({{"id", ii},
+                                     {"date", "2020-04-04T18:17:04Z"},
+                                     {"status", "shipped"},
+                                     {"total", 12.5 * ii},
+                                     {"gift", ii % 2 == 0}});
+        }
+        break;
+    case Payload::Text:
+        // A few long string values
+        for (size_t ii = 0; doc.dump().size() < size; ++ii) {
+            doc["paragraphs"].push_back(
+                    std::string(1024, "abcdefghijklmnopqrstuvwxyz "[ii % 27]));
+        }
+        break;
+    case Payload::Numbers:
+        for (size_t ii = 0; doc.dump().size() < size; ++ii) {
+            doc.push_back(ii * 7919);
+        }
+        break;
+    case Payload::Binary:
+        break;
+    }
+    return doc;
+}
+
+static std::string makePayload(const benchmark::State& state) {
+    const auto type = Payload(state.range(0));
+    const auto size = size_t(state.range(1));
+    if (type == Payload::Binary) {
+        // Not JSON: the validator only looks at the first byte
+        return std::string(size, '\x01');
+    }
+    return makeDocument(type, size).dump();
+}
+
+static void bench_json_validator(benchmark::State& state) {
+    const auto payload = makePayload(state);
+    cb::json::Validator validator;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(validator.validate(payload));
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+    state.SetLabel(std::string(cb::json::getValidatorInstructionSet()));
+}
+
+static void bench_json_checker(benchmark::State& state) {
+    const auto payload = makePayload(state);
+    JSON_checker::Validator validator;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(validator.validate(payload));
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+static void generateBenchmarkArguments(benchmark::internal::Benchmark* b) {
+    b->Args({int(Payload::Small), 0});
+    for (int size : {1024, 16 * 1024, 256 * 1024}) {
+        b->Args({int(Payload::Profile), size});
+        b->Args({int(Payload::Text), size});
+        b->Args({int(Payload::Numbers), size});
+    }
+    b->Args({int(Payload::Binary), 16 * 1024});
+}
+
+BENCHMARK(bench_json_validator)->Apply(generateBenchmarkArguments);
+BENCHMARK(bench_json_checker)->Apply(generateBenchmarkArguments);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,131 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <folly/portability/GTest.h>
+#include <utilities/json_validator.h>
+
+class JsonValidatorTest : public ::testing::Test {
+protected:
+    bool validate(std::string_view document) {
+        return validator.validate(document);
+    }
+
+    cb::json::Validator validator;
+};
+
+TEST_F(JsonValidatorTest, Scalars) {
+    EXPECT_TRUE(validate("0"));
+    EXPECT_TRUE(validate("-0"));
+    EXPECT_TRUE(validate("12345"));
+    EXPECT_TRUE(validate("-1.5e+10"));
+    EXPECT_TRUE(validate("2E-3"));
+    EXPECT_TRUE(validate(" true "));
+    EXPECT_TRUE(validate("false"));
+    EXPECT_TRUE(validate("null"));
+    EXPECT_TRUE(validate(R"("string")"));
+
+    EXPECT_FALSE(validate(""));
+    EXPECT_FALSE(validate(" "));
+    EXPECT_FALSE(validate("-"));
+    EXPECT_FALSE(validate("01"));
+    EXPECT_FALSE(validate("1."));
+    EXPECT_FALSE(validate(".5"));
+    EXPECT_FALSE(validate("1e"));
+    EXPECT_FALSE(validate("+1"));
+    EXPECT_FALSE(validate("tru"));
+    EXPECT_FALSE(validate("nulll"));
+    EXPECT_FALSE(validate("NaN"));
+    EXPECT_FALSE(validate("1 2"));
+}
+
+TEST_F(JsonValidatorTest, Containers) {
+    EXPECT_TRUE(validate("{}"));
+    EXPECT_TRUE(validate("[]"));
+    EXPECT_TRUE(validate(R"({"a":1,"b":[true,{"c":null}],"d":"e"})"));
+    EXPECT_TRUE(validate(" [ 1 , [ ] , { } ] "));
+    EXPECT_TRUE(validate("[[[[[[]]]]]]"));
+
+    EXPECT_FALSE(validate("{"));
+    EXPECT_FALSE(validate("[1,]"));
+    EXPECT_FALSE(validate("[,1]"));
+    EXPECT_FALSE(validate("{,}"));
+    EXPECT_FALSE(validate(R"({"a":})"));
+    EXPECT_FALSE(validate(R"({"a" 1})"));
+    EXPECT_FALSE(validate(R"({"a":1,})"));
+    EXPECT_FALSE(validate("{1:2}"));
+    EXPECT_FALSE(validate("[1}"));
+    EXPECT_FALSE(validate(R"({"a":1])"));
+    EXPECT_FALSE(validate("[[[[[[]]]]]"));
+    EXPECT_FALSE(validate("{}x"));
+}
+
+TEST_F(JsonValidatorTest, Strings) {
+    EXPECT_TRUE(validate(R"("\" \\ \/ \b \f \n \r \t")"));
+    EXPECT_TRUE(validate(R"("\u00e9\uD83D\uDE00")"));
+
+    EXPECT_FALSE(validate(R"("unterminated)"));
+    EXPECT_FALSE(validate(R"("\x")"));
+    EXPECT_FALSE(validate(R"("\u12g4")"));
+    EXPECT_FALSE(validate(R"("\u123")"));
+    EXPECT_FALSE(validate("\"tab\tin string\""));
+    EXPECT_FALSE(validate(std::string_view("\"\0\"", 3)));
+}
+
+TEST_F(JsonValidatorTest, Utf8) {
+    EXPECT_TRUE(validate("\"\xc3\xa9\""));
+    EXPECT_TRUE(validate("\"\xe2\x82\xac\""));
+    EXPECT_TRUE(validate("\"\xf0\x9f\x98\x80\""));
+
+    // Overlong encodings
+    EXPECT_FALSE(validate("\"\xc0\xaf\""));
+    EXPECT_FALSE(validate("\"\xe0\x80\xaf\""));
+    // Surrogates
+    EXPECT_FALSE(validate("\"\xed\xa0\x80\""));
+    // Above U+10FFFF
+    EXPECT_FALSE(validate("\"\xf4\x90\x80\x80\""));
+    // Truncated and stray continuation bytes
+    EXPECT_FALSE(validate("\"\xe2\x82\""));
+    EXPECT_FALSE(validate("\"\x80\""));
+    // Not in a string
+    EXPECT_FALSE(validate("\xc3\xa9"));
+}
+
+// The strings are scanned a vector at a time; check that the special bytes
+// are found at every position of a vector, and at the tail of a string.
+TEST_F(JsonValidatorTest, SpecialBytesAtEveryOffset) {
+    for (size_t length = 0; length < 100; ++length) {
+        const std::string prefix = "\"" + std::string(length, 'x');
+        EXPECT_TRUE(validate(prefix + "\"")) << length;
+        EXPECT_TRUE(validate(prefix + "\\n\"")) << length;
+        EXPECT_TRUE(validate(prefix + "\xc3\xa9yy\"")) << length;
+        EXPECT_FALSE(validate(prefix + "\x01\"")) << length;
+        EXPECT_FALSE(validate(prefix + "\x7f\xff\"")) << length;
+        EXPECT_FALSE(validate(prefix)) << length;
+    }
+}
+
+TEST_F(JsonValidatorTest, ReusedAfterFailure) {
+    EXPECT_FALSE(validate("[[[{"));
+    EXPECT_TRUE(validate("[1]"));
+}
+
+TEST_F(JsonValidatorTest, InstructionSet) {
+    const auto isa = cb::json::getValidatorInstructionSet();
+    EXPECT_TRUE(isa == "avx2" || isa == "sse2" || isa == "neon" ||
+                isa == "scalar")
+            << isa;
+}
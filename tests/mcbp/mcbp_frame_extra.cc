@@ -172,6 +172,32 @@ TEST_F(FrameExtrasValidatorTests, PreserveTtlInvalidSize) {
               validate_error_context(ClientOpcode::Set, blob, Status::Einval));
 }
 
+TEST_F(FrameExtrasValidatorTests, Deadline) {
+    uint16_t timeout = htons(100);
+    auto fe = encodeFrameInfo(
+            FrameInfoId::Deadline,
+            {reinterpret_cast<const uint8_t*>(&timeout), sizeof(timeout)});
+    builder.setFramingExtras({fe.data(), fe.size()});
+    EXPECT_EQ(Status::Success, validate(ClientOpcode::Set, blob));
+}
+
+TEST_F(FrameExtrasValidatorTests, DeadlineInvalidSize) {
+    auto fe = encodeFrameInfo(FrameInfoId::Deadline, {blob, 1});
+    builder.setFramingExtras({fe.data(), fe.size()});
+    EXPECT_EQ("Deadline invalid size:1",
+              validate_error_context(ClientOpcode::Set, blob, Status::Einval));
+}
+
+TEST_F(FrameExtrasValidatorTests, DeadlineZero) {
+    uint16_t timeout = 0;
+    auto fe = encodeFrameInfo(
+            FrameInfoId::Deadline,
+            {reinterpret_cast<const uint8_t*>(&timeout), sizeof(timeout)});
+    builder.setFramingExtras({fe.data(), fe.size()});
+    EXPECT_EQ("Deadline cannot be 0",
+              validate_error_context(ClientOpcode::Set, blob, Status::Einval));
+}
+
 TEST_F(FrameExtrasValidatorTests, UnknownFrameId) {
     auto fe = encodeFrameInfo(FrameInfoId(0xff), {});
     builder.setFramingExtras({fe.data(), fe.size()});
@@ -422,6 +422,232 @@ TEST_P(GetKeysValidatorTest, InvalidBodylen) {
     EXPECT_EQ(cb::mcbp::Status::Einval, validate());
 }
 
+class RangeScanValidatorTest : public ::testing::WithParamInterface<bool>,
+                               public ValidatorTest {
+public:
+    RangeScanValidatorTest()
+        : ValidatorTest(GetParam()), req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        req.setExtlen(sizeof(cb::mcbp::request::RangeScanPayload));
+        req.setKeylen(2);
+        req.setBodylen(req.getExtlen() + req.getKeylen());
+    }
+
+protected:
+    cb::mcbp::request::RangeScanPayload& payload() {
+        return *reinterpret_cast<cb::mcbp::request::RangeScanPayload*>(
+                request.bytes + 24);
+    }
+
+    cb::mcbp::Request& req;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(cb::mcbp::ClientOpcode::RangeScan,
+                                       static_cast<void*>(&request));
+    }
+};
+
+TEST_P(RangeScanValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+
+    // With an end key
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(RangeScanValidatorTest, InvalidExtlen) {
+    req.setExtlen(4);
+    req.setBodylen(req.getExtlen() + req.getKeylen());
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(RangeScanValidatorTest, Flags) {
+    using cb::mcbp::request::RangeScanFlags;
+    payload().setFlags(uint32_t(RangeScanFlags::KeyOnly) |
+                       uint32_t(RangeScanFlags::Prefix));
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+    payload().setFlags(0x04);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(RangeScanValidatorTest, PrefixWithEndKey) {
+    payload().setFlags(uint32_t(cb::mcbp::request::RangeScanFlags::Prefix));
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(RangeScanValidatorTest, InvalidKey) {
+    // The key must be present
+    req.setKeylen(0);
+    req.setBodylen(req.getExtlen());
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(RangeScanValidatorTest, InvalidCas) {
+    req.setCas(0xff);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+using cb::mcbp::request::SampleDocumentsPayload;
+
+class SampleDocumentsValidatorTest
+    : public ::testing::WithParamInterface<bool>,
+      public ValidatorTest {
+public:
+    SampleDocumentsValidatorTest()
+        : ValidatorTest(GetParam()), req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        // Collections expects the collection-id after the count
+        req.setExtlen(GetParam() ? sizeof(SampleDocumentsPayload)
+                                 : sizeof(uint32_t));
+        req.setBodylen(req.getExtlen());
+        payload().setCount(10);
+    }
+
+protected:
+    SampleDocumentsPayload& payload() {
+        return *reinterpret_cast<SampleDocumentsPayload*>(request.bytes + 24);
+    }
+
+    cb::mcbp::Request& req;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(cb::mcbp::ClientOpcode::SampleDocuments,
+                                       static_cast<void*>(&request));
+    }
+};
+
+TEST_P(SampleDocumentsValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(SampleDocumentsValidatorTest, InvalidExtlen) {
+    req.setExtlen(GetParam() ? sizeof(uint32_t)
+                             : sizeof(SampleDocumentsPayload));
+    req.setBodylen(req.getExtlen());
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SampleDocumentsValidatorTest, ZeroCount) {
+    payload().setCount(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SampleDocumentsValidatorTest, InvalidKey) {
+    req.setKeylen(2);
+    req.setBodylen(req.getExtlen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SampleDocumentsValidatorTest, InvalidCas) {
+    req.setCas(0xff);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+class SetWithMetaBatchValidatorTest
+    : public ::testing::WithParamInterface<bool>,
+      public ValidatorTest {
+public:
+    SetWithMetaBatchValidatorTest()
+        : ValidatorTest(GetParam()), req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        addDocument("key", "value");
+    }
+
+protected:
+    /// Append a document to the value of the request
+    void addDocument(const std::string& key,
+                     const std::string& value,
+                     uint8_t datatype = PROTOCOL_BINARY_RAW_BYTES) {
+        const auto encodedKey =
+                (collectionsEnabled && !key.empty()) ? '\0' + key : key;
+        cb::mcbp::request::SetWithMetaBatchEntry entry;
+        entry.setCas(1);
+        entry.setKeyLength(uint16_t(encodedKey.size()));
+        entry.setValueLength(uint32_t(value.size()));
+        entry.setDatatype(datatype);
+
+        auto* ptr = blob + sizeof(req) + req.getBodylen();
+        memcpy(ptr, &entry, sizeof(entry));
+        ptr += sizeof(entry);
+        memcpy(ptr, encodedKey.data(), encodedKey.size());
+        ptr += encodedKey.size();
+        memcpy(ptr, value.data(), value.size());
+        req.setBodylen(req.getBodylen() + uint32_t(entry.getSize()));
+    }
+
+    cb::mcbp::Request& req;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(
+                cb::mcbp::ClientOpcode::SetWithMetaBatch,
+                static_cast<void*>(&request));
+    }
+};
+
+TEST_P(SetWithMetaBatchValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+
+    addDocument("other", "", PROTOCOL_BINARY_DATATYPE_JSON);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(SetWithMetaBatchValidatorTest, Options) {
+    req.setExtlen(sizeof(uint32_t));
+    req.setBodylen(req.getExtlen());
+    addDocument("key", "value");
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(SetWithMetaBatchValidatorTest, InvalidExtlen) {
+    req.setExtlen(8);
+    req.setBodylen(req.getExtlen());
+    addDocument("key", "value");
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaBatchValidatorTest, NoDocuments) {
+    req.setBodylen(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaBatchValidatorTest, TruncatedDocument) {
+    // Truncated value
+    req.setBodylen(req.getBodylen() - 1);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+
+    // Truncated header
+    req.setBodylen(
+            uint32_t(sizeof(cb::mcbp::request::SetWithMetaBatchEntry) - 1));
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaBatchValidatorTest, InvalidKey) {
+    // The key must be in the documents, not in the request
+    req.setKeylen(1);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+
+    req.setKeylen(0);
+    addDocument("", "value");
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaBatchValidatorTest, InvalidXattr) {
+    addDocument("xattr", "not a xattr blob", PROTOCOL_BINARY_DATATYPE_XATTR);
+    EXPECT_EQ(cb::mcbp::Status::XattrEinval, validate());
+}
+
+TEST_P(SetWithMetaBatchValidatorTest, InvalidCas) {
+    req.setCas(0xff);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
 class SetParamValidatorTest : public ::testing::WithParamInterface<bool>,
                               public ValidatorTest {
 public:
@@ -506,6 +732,12 @@ TEST_P(GetReplicaValidatorTest, InvalidExtlen) {
     EXPECT_EQ(cb::mcbp::Status::Einval, validate());
 }
 
+TEST_P(GetReplicaValidatorTest, ConsistencyToken) {
+    req.setExtlen(sizeof(cb::mcbp::request::GetReplicaPayload));
+    req.setBodylen(sizeof(cb::mcbp::request::GetReplicaPayload) + 2);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
 TEST_P(GetReplicaValidatorTest, InvalidDatatype) {
     req.setDatatype(cb::mcbp::Datatype::JSON);
     EXPECT_EQ(cb::mcbp::Status::Einval, validate());
@@ -924,6 +1156,21 @@ INSTANTIATE_TEST_SUITE_P(CollectionsOnOff,
                          ::testing::Bool(),
                          ::testing::PrintToStringParamName());
 
+INSTANTIATE_TEST_SUITE_P(CollectionsOnOff,
+                         RangeScanValidatorTest,
+                         ::testing::Bool(),
+                         ::testing::PrintToStringParamName());
+
+INSTANTIATE_TEST_SUITE_P(CollectionsOnOff,
+                         SampleDocumentsValidatorTest,
+                         ::testing::Bool(),
+                         ::testing::PrintToStringParamName());
+
+INSTANTIATE_TEST_SUITE_P(CollectionsOnOff,
+                         SetWithMetaBatchValidatorTest,
+                         ::testing::Bool(),
+                         ::testing::PrintToStringParamName());
+
 INSTANTIATE_TEST_SUITE_P(CollectionsOnOff,
                          SetParamValidatorTest,
                          ::testing::Bool(),
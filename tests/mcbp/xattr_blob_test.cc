@@ -230,3 +230,55 @@ TEST(XattrBlob, iterator_insert) {
         }
     }
 }
+
+/**
+ * Verify that the lookups through the index (built from the second lookup
+ * of a blob with enough keys) return the same as the lookups scanning the
+ * blob, and that the index follows the modifications of the blob
+ */
+TEST(XattrBlob, IndexedLookup) {
+    cb::xattr::Blob blob;
+    const size_t numKeys = cb::xattr::Blob::IndexThreshold * 3;
+    for (size_t ii = 0; ii < numKeys; ++ii) {
+        // Insert in the reverse order to make the index differ from the
+        // layout of the blob
+        const auto key = "_key" + std::to_string(numKeys - ii);
+        blob.set(key, "\"" + key + "\"");
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t ii = 1; ii <= numKeys; ++ii) {
+            const auto key = "_key" + std::to_string(ii);
+            EXPECT_EQ("\"" + key + "\"", to_string(blob.get(key)));
+        }
+        EXPECT_TRUE(to_string(blob.get("_key")).empty());
+        EXPECT_TRUE(to_string(blob.get("_key0")).empty());
+        EXPECT_TRUE(to_string(blob.get("_nokey")).empty());
+    }
+
+    // An in-place replacement keeps the index
+    blob.set("_key1", "\"_KEY1\"");
+    EXPECT_EQ("\"_KEY1\"", to_string(blob.get("_key1")));
+    EXPECT_EQ("\"_key2\"", to_string(blob.get("_key2")));
+
+    // Resizing a value moves the following keys
+    blob.set("_key20", "\"a longer value than it used to have\"");
+    blob.remove("_key10");
+    blob.set("_new", "\"new\"");
+    EXPECT_TRUE(cb::xattr::validate(blob.finalize()));
+    for (int pass = 0; pass < 2; ++pass) {
+        EXPECT_EQ("\"a longer value than it used to have\"",
+                  to_string(blob.get("_key20")));
+        EXPECT_TRUE(to_string(blob.get("_key10")).empty());
+        EXPECT_EQ("\"new\"", to_string(blob.get("_new")));
+        EXPECT_EQ("\"_key11\"", to_string(blob.get("_key11")));
+        EXPECT_EQ("\"_KEY1\"", to_string(blob.get("_key1")));
+    }
+
+    // The copy gets its own index
+    cb::xattr::Blob copy(blob);
+    blob.prune_user_keys();
+    EXPECT_EQ("\"new\"", to_string(copy.get("_new")));
+    EXPECT_EQ("\"new\"", to_string(copy.get("_new")));
+    EXPECT_EQ("\"_key11\"", to_string(copy.get("_key11")));
+}
@@ -163,6 +163,20 @@ TEST_P(BucketTest, TestDeleteNonexistingBucket) {
     }
 }
 
+// A bucket deleted with force releases its name as soon as the clients are
+// disconnected, so it may be recreated while the engine shuts down
+TEST_P(BucketTest, RecreateAfterForceDelete) {
+    auto& conn = getAdminConnection();
+    conn.createBucket("bucket", "", BucketType::Memcached);
+
+    const auto rsp = conn.execute(BinprotGenericCommand{
+            cb::mcbp::ClientOpcode::DeleteBucket, "bucket", "force=true"});
+    ASSERT_TRUE(rsp.isSuccess()) << to_string(rsp.getStatus());
+
+    conn.createBucket("bucket", "", BucketType::Memcached);
+    conn.deleteBucket("bucket");
+}
+
 /**
  * Delete a bucket with a 5 second timeout
  *
@@ -201,6 +201,50 @@ TEST_P(ClusterConfigTest, CccpPushNotification) {
     EXPECT_EQ(R"({"rev":666})", config);
 }
 
+// Rapid successive revisions may be coalesced, but the client should
+// always end up with the latest one (and never go backwards)
+TEST_P(ClusterConfigTest, CccpPushNotificationCoalesced) {
+    auto& conn = getAdminConnection();
+    conn.selectBucket("default");
+
+    auto second = conn.clone();
+
+    second->setFeature(cb::mcbp::Feature::UnorderedExecution, true);
+    second->setDuplexSupport(true);
+    second->setClustermapChangeNotification(true);
+
+    for (int rev = 700; rev < 710; ++rev) {
+        ASSERT_TRUE(conn.execute(BinprotSetClusterConfigCommand{
+                                         token,
+                                         R"({"rev":)" + std::to_string(rev) +
+                                                 "}"})
+                            .isSuccess());
+    }
+
+    uint32_t revno = 0;
+    Frame frame;
+    do {
+        second->recvFrame(frame);
+        ASSERT_EQ(cb::mcbp::Magic::ServerRequest, frame.getMagic());
+        auto* request = frame.getRequest();
+        ASSERT_EQ(cb::mcbp::ServerOpcode::ClustermapChangeNotification,
+                  request->getServerOpcode());
+        auto extras = request->getExtdata();
+        uint32_t rev;
+        std::copy(extras.begin(),
+                  extras.end(),
+                  reinterpret_cast<uint8_t*>(&rev));
+        rev = ntohl(rev);
+        ASSERT_LT(revno, rev);
+        revno = rev;
+
+        auto value = request->getValue();
+        const std::string config{reinterpret_cast<const char*>(value.data()),
+                                 value.size()};
+        EXPECT_EQ(R"({"rev":)" + std::to_string(rev) + "}", config);
+    } while (revno != 709);
+}
+
 TEST_P(ClusterConfigTest, SetGlobalClusterConfig) {
     // Set one for the default bucket
     setClusterConfig(token, R"({"rev":1000})");
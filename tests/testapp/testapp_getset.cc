@@ -956,6 +956,31 @@ TEST_P(GetSetTest, TestCorrectWithXattrs) {
     EXPECT_TRUE(hasCorrectDatatype(stored, expected));
 }
 
+// Test that a large compressed document fetched by a client which didn't
+// enable Snappy is inflated (in the background) before it is returned.
+TEST_P(GetSetTest, TestBackgroundInflate) {
+    memcached_cfg["background_inflate_threshold"] = 1024;
+    reconfigure();
+    setCompressionMode("passive");
+
+    const std::string valueData(4096, 'a');
+    document.info.datatype = cb::mcbp::Datatype::Raw;
+    document.value = valueData;
+    document.compress();
+
+    MemcachedConnection& conn = getConnection();
+    conn.mutate(document, Vbid(0), MutationType::Set);
+
+    conn.setFeature(cb::mcbp::Feature::SNAPPY, false);
+    const auto stored = conn.get(name, Vbid(0));
+    EXPECT_TRUE(hasCorrectDatatype(stored, cb::mcbp::Datatype::Raw));
+    EXPECT_EQ(valueData, stored.value);
+    conn.setFeature(cb::mcbp::Feature::SNAPPY, true);
+
+    memcached_cfg["background_inflate_threshold"] = 1024 * 1024;
+    reconfigure();
+}
+
 // Test sending compressed raw data; check server handles correctly.
 TEST_P(GetSetSnappyOnOffTest, TestCompressedData) {
     doTestCompressedRawData("off");
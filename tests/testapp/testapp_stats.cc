@@ -96,6 +96,62 @@ TEST_P(StatsTest, TestGetMeta) {
     EXPECT_EQ(0, get_hits);
 }
 
+TEST_P(StatsTest, TestZeroCopySend) {
+    memcached_cfg["zero_copy_send_threshold"] = 64 * 1024;
+    reconfigure();
+
+    MemcachedConnection& conn = getConnection();
+    Document doc;
+    doc.info.cas = mcbp::cas::Wildcard;
+    doc.info.id = name;
+    doc.value = std::string(256 * 1024, 'z');
+    conn.mutate(doc, Vbid(0), MutationType::Set);
+
+    const auto stored = conn.get(name, Vbid(0));
+    EXPECT_EQ(doc.value, stored.value);
+
+    // Every GET of a value above the threshold over a plain connection is
+    // either sent with MSG_ZEROCOPY or counted as a fallback (if the socket
+    // doesn't support it). TLS connections never use it.
+    auto stats = conn.stats("");
+    const auto attempts = stats["zero_copy_bytes"].get<size_t>() +
+                          stats["zero_copy_fallbacks"].get<size_t>();
+    if (GetParam() == TransportProtocols::McbpSsl) {
+        EXPECT_EQ(0, attempts);
+    } else {
+#ifdef __linux__
+        EXPECT_NE(0, attempts);
+#endif
+    }
+
+    memcached_cfg["zero_copy_send_threshold"] = 0;
+    reconfigure();
+}
+
+TEST_P(StatsTest, TestTlsRecords) {
+    MemcachedConnection& conn = getConnection();
+    Document doc;
+    doc.info.cas = mcbp::cas::Wildcard;
+    doc.info.id = name;
+    doc.value = std::string(64 * 1024, 't');
+    conn.mutate(doc, Vbid(0), MutationType::Set);
+    EXPECT_EQ(doc.value, conn.get(name, Vbid(0)).value);
+
+    auto stats = conn.stats("");
+    const auto records = stats["tls_records_sent"].get<size_t>();
+    const auto bytes = stats["tls_record_bytes"].get<size_t>();
+    if (GetParam() == TransportProtocols::McbpSsl) {
+        if (records != 0) {
+            // The value spans multiple full records
+            EXPECT_LE(4, records);
+            EXPECT_LE(doc.value.size(), bytes);
+        }
+    } else {
+        EXPECT_EQ(0, records);
+        EXPECT_EQ(0, bytes);
+    }
+}
+
 TEST_P(StatsTest, StatsResetIsPrivileged) {
     MemcachedConnection& conn = getConnection();
 
@@ -326,9 +382,11 @@ TEST_P(StatsTest, TestAudit) {
     conn.authenticate("@admin", "password", "PLAIN");
 
     auto stats = conn.stats("audit");
-    EXPECT_EQ(2, stats.size());
+    EXPECT_EQ(6, stats.size());
     EXPECT_EQ(false, stats["enabled"].get<bool>());
     EXPECT_EQ(0, stats["dropped_events"].get<size_t>());
+    EXPECT_EQ(0, stats["blocked_events"].get<size_t>());
+    EXPECT_EQ(false, stats["block_when_full"].get<bool>());
 
     conn.reconnect();
 }
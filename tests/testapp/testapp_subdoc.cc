@@ -222,6 +222,38 @@ TEST_P(SubdocTestappTest, SubdocExists_DictSimpleCompressed) {
                                   cb::mcbp::ClientOpcode::SubdocExists);
 }
 
+// Repeated lookups are served from the path cache until the document
+// changes.
+TEST_P(SubdocTestappTest, SubdocGet_PathCache) {
+    memcached_cfg["subdoc_path_cache_size"] = 1024;
+    reconfigure();
+
+    store_document("dict", R"({"name":"one","list":[1,2,3]})");
+    EXPECT_SD_VALEQ(BinprotSubdocCommand(
+                            cb::mcbp::ClientOpcode::SubdocGet, "dict", "list"),
+                    "[1,2,3]");
+
+    auto stats = request_stats();
+    const auto hits = extract_single_stat(stats, "subdoc_path_cache_hits");
+    EXPECT_SD_VALEQ(BinprotSubdocCommand(
+                            cb::mcbp::ClientOpcode::SubdocGet, "dict", "list"),
+                    "[1,2,3]");
+    stats = request_stats();
+    EXPECT_EQ(hits + 1, extract_single_stat(stats, "subdoc_path_cache_hits"));
+
+    // A new version of the document must be parsed again
+    store_document("dict", R"({"list":[4,5],"name":"two"})");
+    EXPECT_SD_VALEQ(BinprotSubdocCommand(
+                            cb::mcbp::ClientOpcode::SubdocGet, "dict", "list"),
+                    "[4,5]");
+    stats = request_stats();
+    EXPECT_EQ(hits + 1, extract_single_stat(stats, "subdoc_path_cache_hits"));
+
+    delete_object("dict");
+    memcached_cfg["subdoc_path_cache_size"] = 0;
+    reconfigure();
+}
+
 // JSON document containing nested dictionary.
 void SubdocTestappTest::test_subdoc_fetch_dict_nested(
         bool compressed, cb::mcbp::ClientOpcode cmd) {
@@ -215,6 +215,46 @@ TEST_P(SubdocTestappTest, SubdocMultiMutation_DictAddMulti) {
     delete_object("dict");
 }
 
+// Test multi-path mutation command - a mix of mutations which grow and shrink
+// the document, so later paths operate on a document spliced in place by the
+// earlier ones.
+TEST_P(SubdocTestappTest, SubdocMultiMutation_GrowAndShrink) {
+    store_document("dict",
+                   R"({"small":1,"large":"0123456789012345678901234567890",)"
+                   R"("array":[1,2,3],"nested":{"a":true}})");
+
+    SubdocMultiMutationCmd mutation;
+    mutation.key = "dict";
+    mutation.specs.push_back({cb::mcbp::ClientOpcode::SubdocReplace,
+                              SUBDOC_FLAG_NONE,
+                              "small",
+                              R"("a much longer value than before")"});
+    mutation.specs.push_back({cb::mcbp::ClientOpcode::SubdocReplace,
+                              SUBDOC_FLAG_NONE,
+                              "large",
+                              "2"});
+    mutation.specs.push_back({cb::mcbp::ClientOpcode::SubdocArrayPushLast,
+                              SUBDOC_FLAG_NONE,
+                              "array",
+                              "4"});
+    mutation.specs.push_back({cb::mcbp::ClientOpcode::SubdocDelete,
+                              SUBDOC_FLAG_NONE,
+                              "nested.a",
+                              {}});
+    mutation.specs.push_back({cb::mcbp::ClientOpcode::SubdocDictUpsert,
+                              SUBDOC_FLAG_NONE,
+                              "nested.b",
+                              "false"});
+    expect_subdoc_cmd(mutation, cb::mcbp::Status::Success, {});
+
+    validate_json_document(
+            "dict",
+            R"({"small":"a much longer value than before","large":2,)"
+            R"("array":[1,2,3,4],"nested":{"b":false}})");
+
+    delete_object("dict");
+}
+
 // Test multi-path mutation command - test maximum supported SUBDOC_DICT_ADD
 // paths.
 static void test_subdoc_multi_mutation_dict_add_max() {
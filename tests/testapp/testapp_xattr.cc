@@ -1762,6 +1762,39 @@ TEST_P(XattrTest, MB_28524_TestReplaceWithXattrCompressed) {
     doReplaceWithXattrTest(true);
 }
 
+// Lookups which only access the xattrs of a compressed document only
+// inflate the xattrs; check they see the same values as lookups which
+// inflate the whole document.
+TEST_P(XattrTest, XattrOnlyLookupOfCompressedDocument) {
+    const std::string body =
+            R"({"padding":")" + std::string(16 * 1024, 'x') + R"("})";
+    setBodyAndXattr(body, {{sysXattr, xattrVal}, {"user", R"({"a":1})"}});
+
+    EXPECT_EQ(xattrVal, getXattr(sysXattr).getDataString());
+    EXPECT_EQ(R"({"a":1})", getXattr("user").getDataString());
+
+    BinprotSubdocMultiLookupCommand cmd;
+    cmd.setKey(name);
+    cmd.addGet(sysXattr, SUBDOC_FLAG_XATTR_PATH);
+    cmd.addGet("user.a", SUBDOC_FLAG_XATTR_PATH);
+    auto& conn = getConnection();
+    conn.sendCommand(cmd);
+    BinprotSubdocMultiLookupResponse multiResp;
+    conn.recvResponse(multiResp);
+    ASSERT_EQ(cb::mcbp::Status::Success, multiResp.getStatus());
+    EXPECT_EQ(xattrVal, multiResp.getResults()[0].value);
+    EXPECT_EQ("1", multiResp.getResults()[1].value);
+
+    // With the body accessed too
+    cmd.addLookup("", cb::mcbp::ClientOpcode::Get, SUBDOC_FLAG_NONE);
+    conn.sendCommand(cmd);
+    multiResp.clear();
+    conn.recvResponse(multiResp);
+    ASSERT_EQ(cb::mcbp::Status::Success, multiResp.getStatus());
+    EXPECT_EQ("1", multiResp.getResults()[1].value);
+    EXPECT_EQ(body, multiResp.getResults()[2].value);
+}
+
 /**
  * If the client tries to fetch a mix of multiple virtual xattrs it might not
  * work as expected.  Ex:
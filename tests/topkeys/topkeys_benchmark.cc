@@ -18,6 +18,7 @@
 #include <benchmark/benchmark.h>
 #include <daemon/settings.h>
 #include <daemon/topkeys.h>
+#include <nlohmann/json.hpp>
 #include <algorithm>
 #include <iostream>
 #include <memory>
@@ -100,8 +101,53 @@ BENCHMARK_DEFINE_F(TopkeysBench, UpdateRandomKey)(benchmark::State& state) {
     }
 }
 
+/**
+ * Benchmark a skewed workload like we see in production: 90% of the
+ * operations use 1% of the keys.
+ */
+BENCHMARK_DEFINE_F(TopkeysBench, UpdateSkewedKeys)(benchmark::State& state) {
+    if (state.thread_index == 0) {
+        Settings::instance().setTopkeysEnabled(true);
+    }
+
+    const auto size = keys.size();
+    const auto hot = size / 100;
+    std::mt19937 g(state.thread_index);
+    std::vector<size_t> indexes;
+    for (int ii = 0; ii < 65536; ii++) {
+        indexes.push_back(g() % 10 == 0 ? hot + g() % (size - hot)
+                                        : g() % hot);
+    }
+
+    size_t start = 0;
+    while (state.KeepRunning()) {
+        const auto& element = keys[indexes[start++ % indexes.size()]];
+        topkeys->updateKey(element.data(), element.size(), 10);
+        ::benchmark::ClobberMemory();
+    }
+}
+
+/**
+ * Benchmark collecting the stats, which merges the sketches of all the
+ * threads which have updated keys.
+ */
+BENCHMARK_DEFINE_F(TopkeysBench, JsonStats)(benchmark::State& state) {
+    Settings::instance().setTopkeysEnabled(true);
+    for (const auto& key : keys) {
+        topkeys->updateKey(key.data(), key.size(), 10);
+    }
+
+    while (state.KeepRunning()) {
+        nlohmann::json json;
+        topkeys->json_stats(json, 10);
+        ::benchmark::DoNotOptimize(json);
+    }
+}
+
 BENCHMARK_REGISTER_F(TopkeysBench, TopkeysDisabled)->Threads(8)->Threads(24);
 BENCHMARK_REGISTER_F(TopkeysBench, UpdateSameKey)->Threads(8)->Threads(24);
 BENCHMARK_REGISTER_F(TopkeysBench, UpdateRandomKey)->Threads(8)->Threads(24);
+BENCHMARK_REGISTER_F(TopkeysBench, UpdateSkewedKeys)->Threads(8)->Threads(24);
+BENCHMARK_REGISTER_F(TopkeysBench, JsonStats);
 
 BENCHMARK_MAIN();
@@ -18,7 +18,10 @@
 #include "daemon/settings.h"
 #include "daemon/topkeys.h"
 #include <folly/portability/GTest.h>
+#include <nlohmann/json.hpp>
 #include <memory>
+#include <random>
+#include <thread>
 
 class TopKeysTest : public ::testing::Test {
 protected:
@@ -72,3 +75,61 @@ TEST_F(TopKeysTest, FewerThan80Keys) {
     testWithNKeys(5);
     testWithNKeys(20);
 }
+
+// A key used much more often than the others should be reported first, even
+// when there are many more distinct keys than can be tracked.
+TEST_F(TopKeysTest, HeavyHitter) {
+    std::mt19937 generator(0);
+    const std::string hot = "hot_key";
+    for (int ii = 0; ii < 100000; ii++) {
+        if (ii % 10 == 0) {
+            topkeys->updateKey(hot.data(), hot.size(), 1);
+        } else {
+            const auto key = "cold_key_" + std::to_string(generator() % 50000);
+            topkeys->updateKey(key.data(), key.size(), 1);
+        }
+    }
+
+    nlohmann::json json;
+    topkeys->json_stats(json, 1);
+    ASSERT_FALSE(json["topkeys"].empty());
+    EXPECT_EQ(hot, json["topkeys"][0]["key"]);
+    // The count is an estimate, but may only over count
+    EXPECT_GE(json["topkeys"][0]["access_count"].get<uint32_t>(), 10000u);
+}
+
+// Each thread has its own sketch; counts of the same key are merged.
+TEST_F(TopKeysTest, MultipleThreads) {
+    const std::string key = "shared_key";
+    std::vector<std::thread> threads;
+    for (int ii = 0; ii < 4; ii++) {
+        threads.emplace_back([this, &key]() {
+            for (int jj = 0; jj < 1000; jj++) {
+                topkeys->updateKey(key.data(), key.size(), 1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    nlohmann::json json;
+    topkeys->json_stats(json, 1);
+    ASSERT_EQ(1, json["topkeys"].size());
+    EXPECT_EQ(key, json["topkeys"][0]["key"]);
+    EXPECT_EQ(4000, json["topkeys"][0]["access_count"]);
+}
+
+// Sampled accesses are counted with their weight
+TEST_F(TopKeysTest, WeightedUpdate) {
+    const std::string key = "sampled_key";
+    for (int ii = 0; ii < 100; ii++) {
+        topkeys->updateKey(key.data(), key.size(), 1, 16);
+    }
+
+    nlohmann::json json;
+    topkeys->json_stats(json, 1);
+    ASSERT_EQ(1, json["topkeys"].size());
+    EXPECT_EQ(key, json["topkeys"][0]["key"]);
+    EXPECT_EQ(1600, json["topkeys"][0]["access_count"]);
+}
@@ -26,6 +26,8 @@
 #include <programs/engine_testapp/mock_cookie.h>
 #include <programs/engine_testapp/mock_engine.h>
 #include <programs/engine_testapp/mock_server.h>
+#include <chrono>
+#include <thread>
 #include <vector>
 
 using namespace std::string_view_literals;
@@ -522,6 +524,184 @@ TEST_F(BasicEngineTestsuite, Datatype) {
     ASSERT_EQ(1, ii.datatype);
 }
 
+/*
+ * Verify that the LRU crawler reclaims the expired items in the background
+ */
+TEST_F(BasicEngineTestsuite, LruCrawler) {
+    engine = createBucket(BucketType::Memcached, "lru_crawler_interval=1");
+    DocKey key("crawler_key", DocKeyEncodesCollectionId::No);
+    uint64_t cas = 0;
+
+    auto ret = engine->allocate(
+            cookie.get(), key, 1, 0, 10, PROTOCOL_BINARY_RAW_BYTES, Vbid(0));
+    ASSERT_EQ(cb::engine_errc::success, ret.first);
+    ASSERT_EQ(ENGINE_SUCCESS,
+              engine->store(cookie.get(),
+                            ret.second.get(),
+                            cas,
+                            OPERATION_SET,
+                            {},
+                            DocumentState::Alive,
+                            false));
+    ret.second.reset();
+
+    uint64_t reclaimed = 0;
+    auto stats_handler = [&reclaimed](std::string_view key,
+                                      std::string_view value,
+                                      gsl::not_null<const void*>) {
+        if (key == "crawler_reclaimed"sv) {
+            reclaimed = std::stoull(std::string{value});
+        }
+    };
+
+    // The crawler runs on the scrubber thread (which wakes up every second)
+    mock_time_travel(20);
+    const auto timeout =
+            std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  engine->get_stats(cookie.get(), {}, {}, stats_handler));
+    } while (reclaimed == 0 && std::chrono::steady_clock::now() < timeout);
+    mock_time_travel(-20);
+
+    EXPECT_EQ(1, reclaimed);
+}
+
+/*
+ * Verify that a slab is moved to the slab class evicting items from a slab
+ * class which doesn't
+ */
+TEST_F(BasicEngineTestsuite, SlabAutomove) {
+    engine = createBucket(BucketType::Memcached, "cache_size=4194304");
+
+    auto store = [this](const std::string& name, size_t size) {
+        DocKey key(name, DocKeyEncodesCollectionId::No);
+        auto ret = engine->allocate(cookie.get(),
+                                    key,
+                                    size,
+                                    0,
+                                    0,
+                                    PROTOCOL_BINARY_RAW_BYTES,
+                                    Vbid(0));
+        ASSERT_EQ(cb::engine_errc::success, ret.first);
+        uint64_t cas = 0;
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  engine->store(cookie.get(),
+                                ret.second.get(),
+                                cas,
+                                OPERATION_SET,
+                                {},
+                                DocumentState::Alive,
+                                false));
+    };
+
+    // Use most of the memory for small items, and then keep on evicting
+    // large items
+    for (int ii = 0; ii < 2500; ++ii) {
+        store("small_" + std::to_string(ii), 1000);
+    }
+
+    uint64_t moved = 0;
+    auto stats_handler = [&moved](std::string_view key,
+                                  std::string_view value,
+                                  gsl::not_null<const void*>) {
+        if (key == "slabs_moved"sv) {
+            moved = std::stoull(std::string{value});
+        }
+    };
+
+    // The automover runs on the scrubber thread (which wakes up every
+    // second), and looks at the evictions over 10 second windows
+    int travelled = 0;
+    for (int round = 0; round < 10 && moved == 0; ++round) {
+        for (int ii = 0; ii < 20; ++ii) {
+            store("large_" + std::to_string(ii), 200 * 1024);
+        }
+        mock_time_travel(11);
+        travelled += 11;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  engine->get_stats(cookie.get(), "slabs"sv, {}, stats_handler));
+    }
+    mock_time_travel(-travelled);
+
+    EXPECT_LT(0, moved);
+}
+
+/*
+ * Verify that the values of the cold items are moved to the flash tier
+ * when the memory is full, and read back when accessed
+ */
+TEST_F(BasicEngineTestsuite, ExtStore) {
+    const auto path = cb::io::mktemp("extstore");
+    engine = createBucket(BucketType::Memcached,
+                          "cache_size=4194304;ext_size=16777216;ext_path=" +
+                                  path);
+
+    const std::string value(10 * 1024, 'x');
+    for (int ii = 0; ii < 350; ++ii) {
+        DocKey key("key_" + std::to_string(ii), DocKeyEncodesCollectionId::No);
+        auto ret = engine->allocate(cookie.get(),
+                                    key,
+                                    value.size(),
+                                    0,
+                                    0,
+                                    PROTOCOL_BINARY_RAW_BYTES,
+                                    Vbid(0));
+        ASSERT_EQ(cb::engine_errc::success, ret.first);
+        item_info info;
+        ASSERT_TRUE(engine->get_item_info(ret.second.get(), &info));
+        std::copy(value.begin(),
+                  value.end(),
+                  static_cast<char*>(info.value[0].iov_base));
+        uint64_t cas = 0;
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  engine->store(cookie.get(),
+                                ret.second.get(),
+                                cas,
+                                OPERATION_SET,
+                                {},
+                                DocumentState::Alive,
+                                false));
+    }
+
+    uint64_t ext_items = 0;
+    auto stats_handler = [&ext_items](std::string_view key,
+                                      std::string_view value,
+                                      gsl::not_null<const void*>) {
+        if (key == "ext_items"sv) {
+            ext_items = std::stoull(std::string{value});
+        }
+    };
+
+    // The values are moved by the scrubber thread (which wakes up every
+    // second)
+    for (int ii = 0; ii < 10 && ext_items == 0; ++ii) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  engine->get_stats(cookie.get(), {}, {}, stats_handler));
+    }
+    ASSERT_LT(0, ext_items);
+
+    // The oldest items are the first ones moved
+    DocKey key("key_0", DocKeyEncodesCollectionId::No);
+    auto ret = engine->get(cookie.get(), key, Vbid(0), DocStateFilter::Alive);
+    ASSERT_EQ(cb::engine_errc::would_block, ret.first);
+    lock_mock_cookie(cookie.get());
+    waitfor_mock_cookie(cookie.get());
+    unlock_mock_cookie(cookie.get());
+    EXPECT_EQ(ENGINE_SUCCESS, cookie->status);
+
+    ret = engine->get(cookie.get(), key, Vbid(0), DocStateFilter::Alive);
+    ASSERT_EQ(cb::engine_errc::success, ret.first);
+    item_info info;
+    ASSERT_TRUE(engine->get_item_info(ret.second.get(), &info));
+    EXPECT_EQ(value,
+              std::string(static_cast<const char*>(info.value[0].iov_base),
+                          info.value[0].iov_len));
+}
+
 /*
  * Destroy many buckets - this test is really more interesting with valgrind
  *  destroy should invoke a background cleaner thread and at exit time there
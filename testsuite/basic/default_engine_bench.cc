@@ -0,0 +1,124 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmark of the throughput of get and set operations on a memcached
+ * bucket from an increasing number of threads (to measure the scalability
+ * of the locking in the default engine).
+ */
+
+#include <benchmark/benchmark.h>
+#include <daemon/enginemap.h>
+#include <logger/logger.h>
+#include <memcached/engine.h>
+#include <programs/engine_testapp/mock_cookie.h>
+#include <programs/engine_testapp/mock_server.h>
+
+#include <string>
+#include <vector>
+
+static const size_t numKeys = 100000;
+static EngineIface* engine;
+static std::vector<std::string> keys;
+
+static void storeDocument(MockCookie& cookie, const std::string& name) {
+    DocKey key(name, DocKeyEncodesCollectionId::No);
+    auto ret = engine->allocate(
+            &cookie, key, 256, 0, 0, PROTOCOL_BINARY_RAW_BYTES, Vbid(0));
+    if (ret.first != cb::engine_errc::success) {
+        throw std::runtime_error("storeDocument: allocate failed");
+    }
+    uint64_t cas = 0;
+    engine->store(&cookie,
+                  ret.second.get(),
+                  cas,
+                  OPERATION_SET,
+                  {},
+                  DocumentState::Alive,
+                  false);
+}
+
+static void bench_get(benchmark::State& state) {
+    MockCookie cookie;
+    // Spread the threads over the key space
+    size_t next = state.thread_index * (numKeys / state.threads);
+    while (state.KeepRunning()) {
+        DocKey key(keys[next], DocKeyEncodesCollectionId::No);
+        benchmark::DoNotOptimize(
+                engine->get(&cookie, key, Vbid(0), DocStateFilter::Alive));
+        next = (next + 1) % numKeys;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void bench_set(benchmark::State& state) {
+    MockCookie cookie;
+    size_t next = state.thread_index * (numKeys / state.threads);
+    while (state.KeepRunning()) {
+        storeDocument(cookie, keys[next]);
+        next = (next + 1) % numKeys;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/// 90% get and 10% set
+static void bench_mixed(benchmark::State& state) {
+    MockCookie cookie;
+    size_t next = state.thread_index * (numKeys / state.threads);
+    while (state.KeepRunning()) {
+        if (next % 10 == 0) {
+            storeDocument(cookie, keys[next]);
+        } else {
+            DocKey key(keys[next], DocKeyEncodesCollectionId::No);
+            benchmark::DoNotOptimize(
+                    engine->get(&cookie, key, Vbid(0), DocStateFilter::Alive));
+        }
+        next = (next + 1) % numKeys;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(bench_get)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(bench_set)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(bench_mixed)->ThreadRange(1, 64)->UseRealTime();
+
+int main(int argc, char** argv) {
+    cb::logger::createBlackholeLogger();
+    init_mock_server();
+
+    auto handle = new_engine_instance(BucketType::Memcached,
+                                      &get_mock_server_api);
+    if (!handle || handle->initialize("cache_size=1073741824") !=
+                           ENGINE_SUCCESS) {
+        std::cerr << "Failed to create the bucket" << std::endl;
+        return EXIT_FAILURE;
+    }
+    engine = handle.get();
+
+    MockCookie cookie;
+    for (size_t ii = 0; ii < numKeys; ++ii) {
+        keys.emplace_back("key_" + std::to_string(ii));
+        storeDocument(cookie, keys.back());
+    }
+
+    ::benchmark::Initialize(&argc, argv);
+    ::benchmark::RunSpecifiedBenchmarks();
+
+    handle.reset();
+    shutdown_all_engines();
+    return EXIT_SUCCESS;
+}
@@ -15,6 +15,7 @@
  *   limitations under the License.
  */
 #include <memcached/tracer.h>
+#include <utilities/fast_clock.h>
 
 #include <algorithm>
 #include <cmath>
@@ -30,6 +31,10 @@ std::chrono::microseconds to_micros(
 
 namespace cb::tracing {
 
+SpanId Tracer::begin(Code tracecode) {
+    return begin(tracecode, cb::FastClock::now());
+}
+
 SpanId Tracer::begin(Code tracecode,
                      std::chrono::steady_clock::time_point startTime) {
     return vecSpans.withLock([tracecode, startTime](auto& spans) {
@@ -38,6 +43,10 @@ SpanId Tracer::begin(Code tracecode,
     });
 }
 
+bool Tracer::end(SpanId spanId) {
+    return end(spanId, cb::FastClock::now());
+}
+
 bool Tracer::end(SpanId spanId, std::chrono::steady_clock::time_point endTime) {
     return vecSpans.withLock([spanId, endTime](auto& spans) {
         if (spanId >= spans.size()) {
@@ -57,6 +66,10 @@ std::vector<Span> Tracer::extractDurations() {
     return ret;
 }
 
+std::vector<Span> Tracer::getSpans() const {
+    return *vecSpans.lock();
+}
+
 Span::Duration Tracer::getTotalMicros() const {
     return vecSpans.withLock([](auto& spans) -> Span::Duration {
         if (spans.empty()) {
@@ -66,7 +79,7 @@ Span::Duration Tracer::getTotalMicros() const {
         // If the Span has not yet been closed; return the duration up to now.
         if (top.duration == Span::Duration::max()) {
             return std::chrono::duration_cast<Span::Duration>(
-                    std::chrono::steady_clock::now() - top.start);
+                    cb::FastClock::now() - top.start);
         }
         return top.duration;
     });
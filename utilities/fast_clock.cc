@@ -0,0 +1,179 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "fast_clock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#include <x86intrin.h>
+#define CB_FAST_CLOCK_TSC 1
+#endif
+
+namespace cb {
+
+/// How long the TSC is measured against steady_clock before it is used
+static constexpr int64_t MinCalibrationNs = 100 * 1000 * 1000;
+
+#ifdef CB_FAST_CLOCK_TSC
+/// @return true if the CPU has an invariant TSC (constant rate in all
+///         P-, C- and T-states, so usable as a clock)
+static bool hasInvariantTsc() {
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 ||
+        eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+}
+
+static inline uint64_t readTsc() {
+    return __rdtsc();
+}
+#else
+static bool hasInvariantTsc() {
+    return false;
+}
+
+static inline uint64_t readTsc() {
+    return 0;
+}
+#endif
+
+static const bool tscUsable = hasInvariantTsc();
+
+static int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+namespace {
+/**
+ * The current anchor and scale converting TSC readings to steady_clock
+ * nanoseconds, published by calibrate() under a sequence lock: readers
+ * retry if sequence was odd or changed while they read the fields.
+ */
+struct Calibration {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> baseTsc{0};
+    std::atomic<int64_t> baseNs{0};
+    /// 0 until the TSC has been measured for MinCalibrationNs
+    std::atomic<double> nsPerTick{0};
+    /// TSC ticks after baseTsc at which to re-anchor (about a second)
+    std::atomic<uint64_t> recalibrateTicks{0};
+
+    /// Serialises calibrate(), and guards the first anchor
+    std::mutex mutex;
+    uint64_t firstTsc = 0;
+    int64_t firstNs = 0;
+};
+
+Calibration calibration;
+
+/// The last reading on this thread, so a re-anchor never goes backwards
+thread_local int64_t lastNs = 0;
+} // namespace
+
+void FastClock::calibrate() noexcept {
+    std::unique_lock<std::mutex> lock(calibration.mutex, std::try_to_lock);
+    if (!lock) {
+        // Another thread is already calibrating
+        return;
+    }
+
+    // Pair the steady_clock reading with the TSC midway through it
+    const auto tsc0 = readTsc();
+    const auto ns = steadyNowNs();
+    const auto tsc = tsc0 + (readTsc() - tsc0) / 2;
+
+    if (calibration.firstTsc == 0) {
+        calibration.firstTsc = tsc;
+        calibration.firstNs = ns;
+        return;
+    }
+    if (ns - calibration.firstNs < MinCalibrationNs ||
+        tsc <= calibration.firstTsc) {
+        return;
+    }
+
+    const double nsPerTick = double(ns - calibration.firstNs) /
+                             double(tsc - calibration.firstTsc);
+
+    const auto seq = calibration.sequence.load(std::memory_order_relaxed);
+    calibration.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    calibration.baseTsc.store(tsc, std::memory_order_relaxed);
+    calibration.baseNs.store(ns, std::memory_order_relaxed);
+    calibration.nsPerTick.store(nsPerTick, std::memory_order_relaxed);
+    calibration.recalibrateTicks.store(uint64_t(1e9 / nsPerTick),
+                                       std::memory_order_relaxed);
+    calibration.sequence.store(seq + 2, std::memory_order_release);
+}
+
+FastClock::time_point FastClock::now() noexcept {
+    if (!tscUsable) {
+        return std::chrono::steady_clock::now();
+    }
+
+    uint64_t baseTsc;
+    int64_t baseNs;
+    double nsPerTick;
+    uint64_t recalibrateTicks;
+    uint64_t seq;
+    do {
+        seq = calibration.sequence.load(std::memory_order_acquire);
+        baseTsc = calibration.baseTsc.load(std::memory_order_relaxed);
+        baseNs = calibration.baseNs.load(std::memory_order_relaxed);
+        nsPerTick = calibration.nsPerTick.load(std::memory_order_relaxed);
+        recalibrateTicks =
+                calibration.recalibrateTicks.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) != 0 ||
+             seq != calibration.sequence.load(std::memory_order_relaxed));
+
+    int64_t ns;
+    if (nsPerTick == 0) {
+        // Not calibrated yet
+        calibrate();
+        ns = steadyNowNs();
+    } else {
+        const auto tsc = readTsc();
+        const auto ticks = tsc > baseTsc ? tsc - baseTsc : 0;
+        if (ticks > recalibrateTicks) {
+            calibrate();
+        }
+        ns = baseNs + int64_t(double(ticks) * nsPerTick);
+    }
+
+    ns = std::max(ns, lastNs);
+    lastNs = ns;
+    return time_point(std::chrono::duration_cast<duration>(
+            std::chrono::nanoseconds(ns)));
+}
+
+bool FastClock::isUsingTsc() noexcept {
+    return tscUsable &&
+           calibration.nsPerTick.load(std::memory_order_relaxed) != 0;
+}
+
+} // namespace cb
@@ -0,0 +1,55 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+
+namespace cb {
+
+/**
+ * A cheaper std::chrono::steady_clock for timing the command path.
+ *
+ * FastClock returns steady_clock time points, so its readings may be mixed
+ * with (and compared against) steady_clock::now(). On x86-64 CPUs with an
+ * invariant TSC it reads the TSC and scales it, instead of calling
+ * clock_gettime(); elsewhere (or until calibrated) it is steady_clock.
+ *
+ * The TSC frequency is calibrated against steady_clock over the whole time
+ * since the first reading, and the clock is re-anchored to steady_clock
+ * about once a second, by whichever thread first notices. Readings may
+ * therefore differ from steady_clock by the TSC drift over a second (a
+ * few microseconds at most), but never go backwards on a thread.
+ */
+class FastClock {
+public:
+    using duration = std::chrono::steady_clock::duration;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::steady_clock::time_point;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept;
+
+    /// @return true if readings come from the TSC (rather than steady_clock)
+    static bool isUsingTsc() noexcept;
+
+private:
+    /// Take a new steady_clock anchor and refine the TSC frequency
+    static void calibrate() noexcept;
+};
+
+} // namespace cb
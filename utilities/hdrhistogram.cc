@@ -20,6 +20,7 @@
 #include <hdr_histogram.h>
 #include <nlohmann/json.hpp>
 #include <platform/cb_malloc.h>
+#include <algorithm>
 #include <iostream>
 #include <optional>
 #include <sstream>
@@ -86,6 +87,26 @@ HdrHistogram& HdrHistogram::operator+=(const HdrHistogram& other) {
     return *this;
 }
 
+HdrHistogram& HdrHistogram::operator-=(const HdrHistogram& other) {
+    if (other.histogram == nullptr || other.getValueCount() == 0) {
+        return *this;
+    }
+    // Both histograms store the values with the same bias, so the values
+    // iterated can be used as is
+    auto iter = other.makeRecordedIterator();
+    while (hdr_iter_next(&iter)) {
+        const auto count =
+                std::min(hdr_count_at_value(histogram.get(), iter.value),
+                         iter.count);
+        if (count > 0) {
+            hdr_record_values(histogram.get(), iter.value, -count);
+        }
+    }
+    // Recalculate the total count and the min/max from the remaining counts
+    hdr_reset_internal_counters(histogram.get());
+    return *this;
+}
+
 bool HdrHistogram::addValue(uint64_t v) {
     // A hdr_histogram cannot store 0, therefore we add a bias of +1.
     int64_t vBiased = v + 1;
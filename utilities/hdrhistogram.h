@@ -140,6 +140,17 @@ public:
      */
     HdrHistogram& operator+=(const HdrHistogram& other);
 
+    /**
+     * Subtraction assignment operator, to get the values recorded between
+     * two snapshots of a histogram (the later snapshot minus the earlier).
+     * The count of each bucket is clamped at zero, so values of the other
+     * histogram which are not in this histogram are ignored.
+     * @param other histogram to subtract from this one
+     * @return returns this histogram without the values of the other
+     * histogram
+     */
+    HdrHistogram& operator-=(const HdrHistogram& other);
+
     /**
      * Adds a value to the histogram.
      * @param v value to be added to the histogram and account for by 1 count
@@ -0,0 +1,457 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "json_validator.h"
+
+#include <folly/lang/Bits.h>
+
+#include <array>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CB_JSON_VALIDATOR_AVX2 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace cb::json {
+
+/// The bytes of a string which may be skipped without further checks
+static constexpr std::array<bool, 256> makePlainStringBytes() {
+    std::array<bool, 256> plain{};
+    for (size_t c = 0x20; c < 0x80; ++c) {
+        plain[c] = c != '"' && c != '\\';
+    }
+    return plain;
+}
+static constexpr auto plainStringBytes = makePlainStringBytes();
+
+/**
+ * A function returning the first byte of [pos, end) which is a quote, a
+ * backslash, a control character or not ASCII (or end if there isn't one)
+ */
+using StringScanner = const uint8_t* (*)(const uint8_t* pos,
+                                         const uint8_t* end);
+
+static const uint8_t* scanStringScalar(const uint8_t* pos,
+                                       const uint8_t* end) {
+    while (pos < end && plainStringBytes[*pos]) {
+        ++pos;
+    }
+    return pos;
+}
+
+#if defined(__SSE2__)
+static const uint8_t* scanStringSse2(const uint8_t* pos, const uint8_t* end) {
+    const auto quote = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto space = _mm_set1_epi8(' ');
+    while (end - pos >= 16) {
+        const auto chunk =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        // A signed compare: bytes of 0x80 and above are negative, so below
+        // a space as well as the control characters.
+        const auto special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                             _mm_cmpeq_epi8(chunk, backslash)),
+                _mm_cmplt_epi8(chunk, space));
+        const auto mask = uint32_t(_mm_movemask_epi8(special));
+        if (mask != 0) {
+            return pos + folly::findFirstSet(mask) - 1;
+        }
+        pos += 16;
+    }
+    return scanStringScalar(pos, end);
+}
+#endif
+
+#if defined(CB_JSON_VALIDATOR_AVX2)
+__attribute__((target("avx2"))) static const uint8_t* scanStringAvx2(
+        const uint8_t* pos, const uint8_t* end) {
+    const auto quote = _mm256_set1_epi8('"');
+    const auto backslash = _mm256_set1_epi8('\\');
+    const auto space = _mm256_set1_epi8(' ');
+    while (end - pos >= 32) {
+        const auto chunk =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+        const auto special = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                                _mm256_cmpeq_epi8(chunk, backslash)),
+                _mm256_cmpgt_epi8(space, chunk));
+        const auto mask = uint32_t(_mm256_movemask_epi8(special));
+        if (mask != 0) {
+            return pos + folly::findFirstSet(mask) - 1;
+        }
+        pos += 32;
+    }
+    return scanStringScalar(pos, end);
+}
+#endif
+
+#if defined(__aarch64__)
+static const uint8_t* scanStringNeon(const uint8_t* pos, const uint8_t* end) {
+    const auto quote = vdupq_n_u8('"');
+    const auto backslash = vdupq_n_u8('\\');
+    const auto space = vdupq_n_u8(' ');
+    const auto ascii = vdupq_n_u8(0x80);
+    while (end - pos >= 16) {
+        const auto chunk = vld1q_u8(pos);
+        const auto special =
+                vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote),
+                                  vceqq_u8(chunk, backslash)),
+                         vorrq_u8(vcltq_u8(chunk, space),
+                                  vcgeq_u8(chunk, ascii)));
+        if (vmaxvq_u8(special) != 0) {
+            // NEON has no movemask; find the byte in this chunk
+            break;
+        }
+        pos += 16;
+    }
+    return scanStringScalar(pos, end);
+}
+#endif
+
+static StringScanner selectStringScanner() {
+#if defined(CB_JSON_VALIDATOR_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        return scanStringAvx2;
+    }
+#endif
+#if defined(__SSE2__)
+    return scanStringSse2;
+#elif defined(__aarch64__)
+    return scanStringNeon;
+#else
+    return scanStringScalar;
+#endif
+}
+
+static StringScanner getStringScanner() {
+    static const StringScanner scanner = selectStringScanner();
+    return scanner;
+}
+
+std::string_view getValidatorInstructionSet() {
+    const auto scanner = getStringScanner();
+#if defined(CB_JSON_VALIDATOR_AVX2)
+    if (scanner == scanStringAvx2) {
+        return "avx2";
+    }
+#endif
+#if defined(__SSE2__)
+    if (scanner == scanStringSse2) {
+        return "sse2";
+    }
+#endif
+#if defined(__aarch64__)
+    if (scanner == scanStringNeon) {
+        return "neon";
+    }
+#endif
+    return "scalar";
+}
+
+static bool isWhitespace(uint8_t c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static const uint8_t* skipWhitespace(const uint8_t* pos, const uint8_t* end) {
+    while (pos < end && isWhitespace(*pos)) {
+        ++pos;
+    }
+    return pos;
+}
+
+static bool isDigit(uint8_t c) {
+    return c >= '0' && c <= '9';
+}
+
+static const uint8_t* skipDigits(const uint8_t* pos, const uint8_t* end) {
+    while (pos < end && isDigit(*pos)) {
+        ++pos;
+    }
+    return pos;
+}
+
+static bool isHexDigit(uint8_t c) {
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/**
+ * Validate the multi-byte UTF-8 sequence at pos (RFC 3629: no overlong
+ * encodings, surrogates or code points above U+10FFFF)
+ *
+ * @return the end of the sequence, or nullptr if invalid
+ */
+static const uint8_t* parseUtf8(const uint8_t* pos, const uint8_t* end) {
+    const auto c = *pos;
+    size_t length;
+    // The range of the second byte
+    uint8_t min = 0x80;
+    uint8_t max = 0xbf;
+    if (c >= 0xc2 && c <= 0xdf) {
+        length = 2;
+    } else if (c == 0xe0) {
+        length = 3;
+        min = 0xa0;
+    } else if (c == 0xed) {
+        length = 3;
+        max = 0x9f;
+    } else if (c >= 0xe1 && c <= 0xef) {
+        length = 3;
+    } else if (c == 0xf0) {
+        length = 4;
+        min = 0x90;
+    } else if (c >= 0xf1 && c <= 0xf3) {
+        length = 4;
+    } else if (c == 0xf4) {
+        length = 4;
+        max = 0x8f;
+    } else {
+        return nullptr;
+    }
+
+    if (size_t(end - pos) < length || pos[1] < min || pos[1] > max) {
+        return nullptr;
+    }
+    for (size_t ii = 2; ii < length; ++ii) {
+        if ((pos[ii] & 0xc0) != 0x80) {
+            return nullptr;
+        }
+    }
+    return pos + length;
+}
+
+/**
+ * Validate the string starting after the opening quote at pos
+ *
+ * @return the position after the closing quote, or nullptr if invalid
+ */
+static const uint8_t* parseString(const uint8_t* pos,
+                                  const uint8_t* end,
+                                  StringScanner scanString) {
+    for (;;) {
+        pos = scanString(pos, end);
+        if (pos == end) {
+            return nullptr;
+        }
+
+        const auto c = *pos;
+        if (c == '"') {
+            return pos + 1;
+        }
+        if (c == '\\') {
+            if (++pos == end) {
+                return nullptr;
+            }
+            switch (*pos) {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                ++pos;
+                break;
+            case 'u':
+                if (end - pos < 5 || !isHexDigit(pos[1]) ||
+                    !isHexDigit(pos[2]) || !isHexDigit(pos[3]) ||
+                    !isHexDigit(pos[4])) {
+                    return nullptr;
+                }
+                pos += 5;
+                break;
+            default:
+                return nullptr;
+            }
+        } else if (c < 0x20) {
+            return nullptr;
+        } else if ((pos = parseUtf8(pos, end)) == nullptr) {
+            return nullptr;
+        }
+    }
+}
+
+/**
+ * Validate the number at pos
+ *
+ * @return the position after the number, or nullptr if invalid
+ */
+static const uint8_t* parseNumber(const uint8_t* pos, const uint8_t* end) {
+    if (*pos == '-') {
+        ++pos;
+    }
+    if (pos == end) {
+        return nullptr;
+    }
+    if (*pos == '0') {
+        ++pos;
+    } else if (isDigit(*pos)) {
+        pos = skipDigits(pos, end);
+    } else {
+        return nullptr;
+    }
+
+    if (pos != end && *pos == '.') {
+        const auto* digits = skipDigits(++pos, end);
+        if (digits == pos) {
+            return nullptr;
+        }
+        pos = digits;
+    }
+
+    if (pos != end && (*pos == 'e' || *pos == 'E')) {
+        ++pos;
+        if (pos != end && (*pos == '+' || *pos == '-')) {
+            ++pos;
+        }
+        const auto* digits = skipDigits(pos, end);
+        if (digits == pos) {
+            return nullptr;
+        }
+        pos = digits;
+    }
+    return pos;
+}
+
+static const uint8_t* parseLiteral(const uint8_t* pos,
+                                   const uint8_t* end,
+                                   std::string_view literal) {
+    if (size_t(end - pos) < literal.size() ||
+        std::memcmp(pos, literal.data(), literal.size()) != 0) {
+        return nullptr;
+    }
+    return pos + literal.size();
+}
+
+/**
+ * Validate an object member's key and the colon following it, starting at
+ * the opening quote of the key
+ *
+ * @return the position of the member's value, or nullptr if invalid
+ */
+static const uint8_t* parseMemberKey(const uint8_t* pos,
+                                     const uint8_t* end,
+                                     StringScanner scanString) {
+    if (pos == end || *pos != '"') {
+        return nullptr;
+    }
+    pos = parseString(pos + 1, end, scanString);
+    if (pos == nullptr) {
+        return nullptr;
+    }
+    pos = skipWhitespace(pos, end);
+    if (pos == end || *pos != ':') {
+        return nullptr;
+    }
+    return skipWhitespace(pos + 1, end);
+}
+
+bool Validator::validate(std::string_view document) {
+    const auto scanString = getStringScanner();
+    const auto* pos = reinterpret_cast<const uint8_t*>(document.data());
+    const auto* const end = pos + document.size();
+    stack.clear();
+
+    pos = skipWhitespace(pos, end);
+    for (;;) {
+        // pos is at the start of a value
+        if (pos == end) {
+            return false;
+        }
+
+        switch (*pos) {
+        case '{':
+            pos = skipWhitespace(pos + 1, end);
+            if (pos != end && *pos == '}') {
+                ++pos;
+                break;
+            }
+            stack.push_back('{');
+            pos = parseMemberKey(pos, end, scanString);
+            if (pos == nullptr) {
+                return false;
+            }
+            continue;
+        case '[':
+            pos = skipWhitespace(pos + 1, end);
+            if (pos != end && *pos == ']') {
+                ++pos;
+                break;
+            }
+            stack.push_back('[');
+            continue;
+        case '"':
+            pos = parseString(pos + 1, end, scanString);
+            break;
+        case 't':
+            pos = parseLiteral(pos, end, "true");
+            break;
+        case 'f':
+            pos = parseLiteral(pos, end, "false");
+            break;
+        case 'n':
+            pos = parseLiteral(pos, end, "null");
+            break;
+        default:
+            pos = parseNumber(pos, end);
+        }
+        if (pos == nullptr) {
+            return false;
+        }
+
+        // A value is complete; close the containers it completes until
+        // another value is expected.
+        for (;;) {
+            pos = skipWhitespace(pos, end);
+            if (stack.empty()) {
+                return pos == end;
+            }
+            if (pos == end) {
+                return false;
+            }
+
+            const bool object = stack.back() == '{';
+            if (*pos == ',') {
+                pos = skipWhitespace(pos + 1, end);
+                if (object) {
+                    pos = parseMemberKey(pos, end, scanString);
+                    if (pos == nullptr) {
+                        return false;
+                    }
+                }
+                break;
+            }
+            if (*pos != (object ? '}' : ']')) {
+                return false;
+            }
+            ++pos;
+            stack.pop_back();
+        }
+    }
+}
+
+} // namespace cb::json
@@ -0,0 +1,63 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace cb::json {
+
+/**
+ * Validator deciding if a value is a JSON document (RFC 8259, with any
+ * value allowed at the top level, in UTF-8), used to set the JSON datatype
+ * of the values stored.
+ *
+ * Most of the bytes of typical documents are inside strings, so the
+ * validator scans string contents a vector register at a time (AVX2 or
+ * SSE2 on x86-64, NEON on AArch64 - picked at runtime) for the bytes which
+ * need a closer look: quotes, escapes, control characters and the start of
+ * multi-byte UTF-8 sequences. Everything else is validated by a scalar
+ * state machine, which is used for the whole document on other CPUs.
+ *
+ * An instance keeps its buffers between calls, so should be reused (it is
+ * not thread safe).
+ */
+class Validator {
+public:
+    /**
+     * Check if a value is a JSON document
+     *
+     * @param document the value to check
+     * @return true if the value is JSON
+     */
+    bool validate(std::string_view document);
+
+    bool validate(const uint8_t* data, size_t size) {
+        return validate({reinterpret_cast<const char*>(data), size});
+    }
+
+private:
+    /// The containers which are open ('{' or '['), innermost last
+    std::vector<uint8_t> stack;
+};
+
+/// @returns the instruction set the validator uses to scan strings
+std::string_view getValidatorInstructionSet();
+
+} // namespace cb::json
@@ -0,0 +1,81 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2020 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+/*
+ * The file format of the workload captures written by memcached (see the
+ * "workload_capture_file" setting) and replayed by mcreplay.
+ *
+ * The file starts with a FileHeader, followed by one record per request
+ * received from a client: a RecordHeader followed by the key (or, if the
+ * keys are hashed, by the 64 bit hash of the key). All of the integers are
+ * stored in the byte order of the host which wrote the file.
+ *
+ * The records of each front end thread are written in batches, so the
+ * records are only ordered by timestamp within a connection.
+ */
+
+#include <cstdint>
+#include <string_view>
+
+namespace cb::workload {
+
+static const char FileMagic[8] = {'M', 'C', 'W', 'L', 'C', 'A', 'P', '\0'};
+static const uint32_t FileVersion = 1;
+
+/// The keys are stored as their hash (see hashKey)
+static const uint32_t FlagKeysHashed = 0x1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    /// When the capture started (nanoseconds since the epoch)
+    uint64_t startTime;
+};
+
+#pragma pack(push, 1)
+struct RecordHeader {
+    /// When the request was received (nanoseconds since the capture started)
+    uint64_t timestamp;
+    /// The id of the connection the request was received on
+    uint32_t connectionId;
+    /// The size of the value of the request (0 if it has none)
+    uint32_t valueSize;
+    uint16_t vbucket;
+    /// The length of the key in the request (even if the key is hashed)
+    uint16_t keyLength;
+    uint8_t magic;
+    uint8_t opcode;
+    uint8_t datatype;
+    uint8_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(RecordHeader) == 24, "Unexpected RecordHeader size");
+
+/// The key (FNV-1a) hash stored in place of the key
+inline uint64_t hashKey(std::string_view key) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const auto c : key) {
+        hash ^= uint8_t(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+} // namespace cb::workload
@@ -81,38 +81,79 @@ Blob& Blob::assign(std::string_view buffer, bool compressed) {
         // empty blob
         blob = {};
     }
+    invalidate_index();
     return *this;
 }
 
 cb::char_buffer Blob::get(std::string_view key) const {
+    size_t offset = 0;
+    if (!index.empty()) {
+        auto iter = std::lower_bound(
+                index.begin(),
+                index.end(),
+                key,
+                [](const IndexEntry& entry, std::string_view k) {
+                    return entry.key < k;
+                });
+        if (iter != index.end() && iter->key == key) {
+            offset = iter->offset;
+        }
+    } else {
+        offset = scan(key, ++lookups == 2);
+    }
+
+    if (offset == 0) {
+        // Not found!
+        return {nullptr, 0};
+    }
+
+    auto* value = blob.buf + offset + 4 + key.size() + 1;
+    return {value, strlen(value)};
+}
+
+size_t Blob::scan(std::string_view key, bool buildIndex) const {
+    size_t found = 0;
+    std::vector<IndexEntry> keys;
     try {
         size_t current = 4;
         while (current < blob.size()) {
             // Get the length of the next kv-pair
             const auto size = read_length(current);
-            current += 4;
-            if (size > key.size()) {
+            const auto* ptr = blob.data() + current + 4;
+            if (buildIndex) {
+                keys.push_back({{ptr, strlen(ptr)}, uint32_t(current)});
+            }
+            if (found == 0 && size > key.size()) {
                 // This may be the next key
-                if (blob[current + key.size()] == '\0' &&
-                    std::memcmp(blob.data() + current,
-                                key.data(),
-                                key.size()) == 0) {
+                if (ptr[key.size()] == '\0' &&
+                    std::memcmp(ptr, key.data(), key.size()) == 0) {
                     // Yay this is the key!!!
-                    auto* value = blob.buf + current + key.size() + 1;
-                    return {value, strlen(value)};
-                } else {
-                    // jump to the next key!!
-                    current += size;
+                    found = current;
+                    if (!buildIndex) {
+                        break;
+                    }
                 }
-            } else {
-                current += size;
             }
+            // jump to the next key!!
+            current += 4 + size;
         }
     } catch (const std::out_of_range&) {
+        // Don't index a blob we failed to parse
+        keys.clear();
+    }
+
+    if (keys.size() > IndexThreshold) {
+        // stable so that a duplicate key resolves to the first kv-pair,
+        // as it does when scanning
+        std::stable_sort(keys.begin(),
+                         keys.end(),
+                         [](const IndexEntry& a, const IndexEntry& b) {
+                             return a.key < b.key;
+                         });
+        index = std::move(keys);
     }
 
-    // Not found!
-    return {nullptr, 0};
+    return found;
 }
 
 void Blob::prune_user_keys() {
@@ -156,7 +197,8 @@ void Blob::set(std::string_view key, std::string_view value) {
     // Locate the old value
     const auto old = get(key);
     if (old.size() == value.size()) {
-        // lets do an in-place replacement
+        // lets do an in-place replacement (which doesn't move any of the
+        // keys, so the index is still valid)
         std::copy(value.begin(), value.end(), old.buf);
         return;
     } else if (old.size() == 0) {
@@ -184,6 +226,7 @@ void Blob::set(std::string_view key, std::string_view value) {
             blob = {allocator.get(),
                     newsize - 4 - key.size() - 1 - value.size() - 1};
             alloc_size = newsize;
+            invalidate_index();
         }
 
         append_kvpair(key, value);
@@ -198,6 +241,7 @@ void Blob::grow_buffer(uint32_t size) {
             allocator.swap(temp);
             blob = {allocator.get(), size};
             alloc_size = size;
+            invalidate_index();
         } else {
             blob = {allocator.get(), size};
         }
@@ -207,6 +251,7 @@ void Blob::grow_buffer(uint32_t size) {
 void Blob::write_kvpair(size_t offset,
                         std::string_view key,
                         std::string_view value) {
+    invalidate_index();
     // offset points to where we want to inject the value
     write_length(offset, uint32_t(key.size() + 1 + value.size() + 1));
     offset += 4;
@@ -234,6 +279,7 @@ void Blob::append_kvpair(std::string_view key, std::string_view value) {
 }
 
 void Blob::remove_segment(const size_t offset, const size_t size) {
+    invalidate_index();
     if (offset + size == blob.size()) {
         // No need to do anyting as this was the last thing in our blob..
         // just change the length